@@ -33,12 +33,16 @@
 
 #include <jni.h>
 
+#include <cstring>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "base/android_jni_proxy.h"
 #include "base/android_util.h"
 #include "base/file_util.h"
 #include "base/logging.h"
+#include "base/protobuf/coded_stream.h"
 #include "base/scheduler.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
@@ -87,6 +91,70 @@ JavaVM *GetJavaVm(JNIEnv *env) {
 // The global instance of Mozc system to be initialized in onPostLoad().
 std::unique_ptr<SessionHandlerInterface> g_session_handler;
 
+// The output which didn't fit in the buffer passed to evalCommandDirect or
+// evalCommandsDirect.  It is taken by takePendingOutput.  The methods of
+// MozcJNI which touch it are synchronized.
+string g_pending_output;
+
+// The commands of the last batch, reused to keep their allocations.
+std::vector<commands::Command> g_batch_commands;
+
+void EvalCommandInternal(commands::Command *command) {
+  if (g_session_handler) {
+    g_session_handler->EvalCommand(command);
+  } else {
+    LOG(DFATAL) << "Mozc session handler is not yet initialized";
+  }
+}
+
+// Returns the address of the direct ByteBuffer |buffer| and sets its capacity
+// to |capacity|.  Returns nullptr if |buffer| is not a direct buffer.
+uint8 *GetDirectBuffer(JNIEnv *env, jobject buffer, jlong *capacity) {
+  if (buffer == nullptr) {
+    LOG(DFATAL) << "ByteBuffer is null";
+    return nullptr;
+  }
+  uint8 *address = static_cast<uint8 *>(env->GetDirectBufferAddress(buffer));
+  *capacity = env->GetDirectBufferCapacity(buffer);
+  if (address == nullptr || *capacity < 0) {
+    LOG(DFATAL) << "ByteBuffer is not a direct buffer";
+    return nullptr;
+  }
+  return address;
+}
+
+// Serializes |commands| into |out| of |capacity| bytes.  If |delimited| is
+// true, each command is prefixed by its size in varint as
+// MessageLite.writeDelimitedTo does.  If the output doesn't fit in |out|,
+// keeps it in |g_pending_output| and returns the negated size.
+jint WriteCommands(const commands::Command *commands, size_t num_commands,
+                   bool delimited, uint8 *out, jlong capacity) {
+  size_t total_size = 0;
+  for (size_t i = 0; i < num_commands; ++i) {
+    const size_t size = commands[i].ByteSize();
+    if (delimited) {
+      total_size += protobuf::io::CodedOutputStream::VarintSize32(size);
+    }
+    total_size += size;
+  }
+
+  const bool fits = total_size <= static_cast<size_t>(capacity);
+  uint8 *target = out;
+  if (!fits) {
+    g_pending_output.resize(total_size);
+    target = reinterpret_cast<uint8 *>(&g_pending_output[0]);
+  }
+  for (size_t i = 0; i < num_commands; ++i) {
+    if (delimited) {
+      // ByteSize() above has cached the sizes.
+      target = protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+          commands[i].GetCachedSize(), target);
+    }
+    target = commands[i].SerializeWithCachedSizesToArray(target);
+  }
+  return fits ? static_cast<jint>(total_size) : -static_cast<jint>(total_size);
+}
+
 // Concrete implementation for MozcJni.evalCommand
 jbyteArray JNICALL evalCommand(JNIEnv *env,
                                jclass clazz,
@@ -95,11 +163,7 @@ jbyteArray JNICALL evalCommand(JNIEnv *env,
   const jsize in_size = env->GetArrayLength(in_bytes_array);
   mozc::commands::Command command;
   command.ParseFromArray(in_bytes, in_size);
-  if (g_session_handler) {
-    g_session_handler->EvalCommand(&command);
-  } else {
-    LOG(DFATAL) << "Mozc session handler is not yet initialized";
-  }
+  EvalCommandInternal(&command);
 
   // Use JNI_ABORT because in_bytes is read only.
   env->ReleaseByteArrayElements(in_bytes_array, in_bytes, JNI_ABORT);
@@ -115,6 +179,94 @@ jbyteArray JNICALL evalCommand(JNIEnv *env,
   return out_bytes_array;
 }
 
+// Concrete implementation for MozcJni.evalCommandDirect
+// Parses a command from the first |in_size| bytes of the direct ByteBuffer
+// |in| and writes the result into the direct ByteBuffer |out|, without
+// copying them into Java byte arrays.  Returns the size of the result.  If
+// |out| is too small, returns the negated size and the result is taken by
+// takePendingOutput.
+jint JNICALL evalCommandDirect(JNIEnv *env,
+                               jclass clazz,
+                               jobject in,
+                               jint in_size,
+                               jobject out) {
+  jlong in_capacity = 0;
+  jlong out_capacity = 0;
+  const uint8 *in_bytes = GetDirectBuffer(env, in, &in_capacity);
+  uint8 *out_bytes = GetDirectBuffer(env, out, &out_capacity);
+  if (in_bytes == nullptr || out_bytes == nullptr || in_size < 0 ||
+      in_size > in_capacity) {
+    return 0;
+  }
+
+  commands::Command command;
+  command.ParseFromArray(in_bytes, in_size);
+  EvalCommandInternal(&command);
+  return WriteCommands(&command, 1, false, out_bytes, out_capacity);
+}
+
+// Concrete implementation for MozcJni.evalCommandsDirect
+// Same as evalCommandDirect, but |in| holds a sequence of commands in the
+// length delimited format of MessageLite.writeDelimitedTo.  The commands are
+// evaluated in order and the results are written in the same format, so that
+// a series of key events costs one JNI transition.
+jint JNICALL evalCommandsDirect(JNIEnv *env,
+                                jclass clazz,
+                                jobject in,
+                                jint in_size,
+                                jobject out) {
+  jlong in_capacity = 0;
+  jlong out_capacity = 0;
+  const uint8 *in_bytes = GetDirectBuffer(env, in, &in_capacity);
+  uint8 *out_bytes = GetDirectBuffer(env, out, &out_capacity);
+  if (in_bytes == nullptr || out_bytes == nullptr || in_size < 0 ||
+      in_size > in_capacity) {
+    return 0;
+  }
+
+  protobuf::io::CodedInputStream input(in_bytes, in_size);
+  size_t num_commands = 0;
+  uint32 size = 0;
+  while (input.ReadVarint32(&size)) {
+    if (num_commands == g_batch_commands.size()) {
+      g_batch_commands.resize(num_commands + 1);
+    }
+    commands::Command *command = &g_batch_commands[num_commands];
+    command->Clear();
+    const protobuf::io::CodedInputStream::Limit limit = input.PushLimit(size);
+    if (!command->ParseFromCodedStream(&input) ||
+        !input.ConsumedEntireMessage()) {
+      LOG(ERROR) << "Broken command in the batch";
+      break;
+    }
+    input.PopLimit(limit);
+    EvalCommandInternal(command);
+    ++num_commands;
+  }
+  return WriteCommands(g_batch_commands.data(), num_commands, true, out_bytes,
+                       out_capacity);
+}
+
+// Concrete implementation for MozcJni.takePendingOutput
+// Copies the result which didn't fit in the buffer of the last call into the
+// direct ByteBuffer |out|.  Returns the size of the copied result, or the
+// negated size if |out| is still too small.
+jint JNICALL takePendingOutput(JNIEnv *env, jclass clazz, jobject out) {
+  jlong out_capacity = 0;
+  uint8 *out_bytes = GetDirectBuffer(env, out, &out_capacity);
+  if (out_bytes == nullptr) {
+    return 0;
+  }
+  const jint size = static_cast<jint>(g_pending_output.size());
+  if (size > out_capacity) {
+    return -size;
+  }
+  memcpy(out_bytes, g_pending_output.data(), size);
+  // Releases the memory as the large output is rare.
+  string().swap(g_pending_output);
+  return size;
+}
+
 string JstringToCcString(JNIEnv *env, jstring j_string) {
   const char *cstr = env->GetStringUTFChars(j_string, nullptr);
   const string cc_string(cstr);
@@ -218,6 +370,15 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
       {"evalCommand",
        "([B)[B",
        reinterpret_cast<void*>(&mozc::jni::evalCommand)},
+      {"evalCommandDirect",
+       "(Ljava/nio/ByteBuffer;ILjava/nio/ByteBuffer;)I",
+       reinterpret_cast<void*>(&mozc::jni::evalCommandDirect)},
+      {"evalCommandsDirect",
+       "(Ljava/nio/ByteBuffer;ILjava/nio/ByteBuffer;)I",
+       reinterpret_cast<void*>(&mozc::jni::evalCommandsDirect)},
+      {"takePendingOutput",
+       "(Ljava/nio/ByteBuffer;)I",
+       reinterpret_cast<void*>(&mozc::jni::takePendingOutput)},
       {"onPostLoad",
        "(Ljava/lang/String;Ljava/lang/String;)Z",
        reinterpret_cast<void*>(&mozc::jni::onPostLoad)},
@@ -244,6 +405,7 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
 
 JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void *reserved) {
   mozc::jni::g_session_handler.reset();
+  mozc::jni::g_batch_commands.clear();
   mozc::jni::JavaHttpClientProxy::SetJavaVM(nullptr);
 }
 
@@ -32,13 +32,18 @@ package org.mozc.android.inputmethod.japanese.session;
 import org.mozc.android.inputmethod.japanese.MozcLog;
 import org.mozc.android.inputmethod.japanese.protobuf.ProtoCommands.Command;
 import com.google.common.base.Preconditions;
-import com.google.protobuf.InvalidProtocolBufferException;
 
 import android.content.Context;
 import android.content.pm.ApplicationInfo;
 import android.content.pm.PackageManager.NameNotFoundException;
 
 import java.io.File;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.List;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
 
@@ -50,6 +55,62 @@ class LocalSessionHandler implements SessionHandler {
 
   private static final String USER_PROFILE_DIRECTORY_NAME = ".mozc";
 
+  /** The initial size of the direct buffers, which holds most of the commands. */
+  private static final int INITIAL_BUFFER_SIZE = 64 * 1024;
+
+  /**
+   * Direct buffers reused to pass the commands to and from JNI without copying them into byte
+   * arrays. Guarded by {@code MozcJNI.class}.
+   */
+  private static ByteBuffer inBuffer = ByteBuffer.allocateDirect(INITIAL_BUFFER_SIZE);
+  private static ByteBuffer outBuffer = ByteBuffer.allocateDirect(INITIAL_BUFFER_SIZE);
+
+  /** {@link OutputStream} writing to the direct buffer. */
+  private static class ByteBufferOutputStream extends OutputStream {
+    private final ByteBuffer buffer;
+
+    ByteBufferOutputStream(ByteBuffer buffer) {
+      this.buffer = buffer;
+    }
+
+    @Override
+    public void write(int b) {
+      buffer.put((byte) b);
+    }
+
+    @Override
+    public void write(byte[] bytes, int offset, int length) {
+      buffer.put(bytes, offset, length);
+    }
+  }
+
+  /** {@link InputStream} reading from the direct buffer. */
+  private static class ByteBufferInputStream extends InputStream {
+    private final ByteBuffer buffer;
+
+    ByteBufferInputStream(ByteBuffer buffer) {
+      this.buffer = buffer;
+    }
+
+    @Override
+    public int read() {
+      return buffer.hasRemaining() ? (buffer.get() & 0xFF) : -1;
+    }
+
+    @Override
+    public int read(byte[] bytes, int offset, int length) {
+      if (length == 0) {
+        return 0;
+      }
+      if (!buffer.hasRemaining()) {
+        return -1;
+      }
+      int size = Math.min(length, buffer.remaining());
+      buffer.get(bytes, offset, size);
+      return size;
+    }
+  }
+
   @Override
   public void initialize(Context context) {
     try {
@@ -86,16 +147,80 @@ class LocalSessionHandler implements SessionHandler {
 
   @Override
   public Command evalCommand(Command command) {
-    byte[] inBytes = Preconditions.checkNotNull(command).toByteArray();
-    byte[] outBytes = null;
-    outBytes = MozcJNI.evalCommand(inBytes);
+    Preconditions.checkNotNull(command);
     try {
-      return Command.parseFrom(outBytes);
-    } catch (InvalidProtocolBufferException e) {
-      MozcLog.w("InvalidProtocolBufferException is thrown."
+      synchronized (MozcJNI.class) {
+        ensureInputCapacity(command.getSerializedSize());
+        command.writeTo(new ByteBufferOutputStream(inBuffer));
+        int outSize = MozcJNI.evalCommandDirect(inBuffer, inBuffer.position(), outBuffer);
+        return Command.parseFrom(new ByteBufferInputStream(takeOutput(outSize)));
+      }
+    } catch (IOException e) {
+      MozcLog.w("IOException is thrown."
           + "We can do nothing so just return default instance.");
       MozcLog.w(e.toString());
       return Command.getDefaultInstance();
     }
   }
+
+  /**
+   * Evaluates {@code commands} in order by one JNI call.
+   *
+   * @return the results in the same order. A result is the default instance if it is broken.
+   */
+  public List<Command> evalCommands(List<Command> commands) {
+    Preconditions.checkNotNull(commands);
+    List<Command> results = new ArrayList<Command>(commands.size());
+    try {
+      synchronized (MozcJNI.class) {
+        int inSize = 0;
+        for (Command command : commands) {
+          // 5 bytes are enough for the varint of the size.
+          inSize += command.getSerializedSize() + 5;
+        }
+        ensureInputCapacity(inSize);
+        OutputStream output = new ByteBufferOutputStream(inBuffer);
+        for (Command command : commands) {
+          command.writeDelimitedTo(output);
+        }
+        int outSize = MozcJNI.evalCommandsDirect(inBuffer, inBuffer.position(), outBuffer);
+        InputStream input = new ByteBufferInputStream(takeOutput(outSize));
+        for (int i = 0; i < commands.size(); ++i) {
+          Command result = Command.parseDelimitedFrom(input);
+          results.add(result == null ? Command.getDefaultInstance() : result);
+        }
+      }
+    } catch (IOException e) {
+      MozcLog.w("IOException is thrown."
+          + "We can do nothing so just return default instances.");
+      MozcLog.w(e.toString());
+      while (results.size() < commands.size()) {
+        results.add(Command.getDefaultInstance());
+      }
+    }
+    return results;
+  }
+
+  /** Clears {@code inBuffer} after growing it to hold {@code size} bytes. */
+  private static void ensureInputCapacity(int size) {
+    if (inBuffer.capacity() < size) {
+      inBuffer = ByteBuffer.allocateDirect(Math.max(size, inBuffer.capacity() * 2));
+    }
+    inBuffer.clear();
+  }
+
+  /**
+   * Returns {@code outBuffer} holding the result of {@code outSize} bytes, which is returned by
+   * the last call of JNI. Takes the pending output after growing the buffer if it didn't fit.
+   */
+  private static ByteBuffer takeOutput(int outSize) {
+    if (outSize < 0) {
+      outBuffer = ByteBuffer.allocateDirect(Math.max(-outSize, outBuffer.capacity() * 2));
+      outSize = MozcJNI.takePendingOutput(outBuffer);
+      Preconditions.checkState(outSize >= 0);
+    }
+    outBuffer.clear();
+    outBuffer.limit(outSize);
+    return outBuffer;
+  }
 }
@@ -32,6 +32,8 @@ package org.mozc.android.inputmethod.japanese.session;
 import org.mozc.android.inputmethod.japanese.MozcLog;
 import com.google.common.base.Preconditions;
 
+import java.nio.ByteBuffer;
+
 /**
  * The wrapper for JNI Mozc server.
  *
@@ -95,6 +97,35 @@ class MozcJNI {
    */
   static synchronized native byte[] evalCommand(byte[] command);
 
+  /**
+   * Same as {@link #evalCommand(byte[])}, but passes the blobs through direct buffers so that
+   * they are not copied across JNI.
+   *
+   * <p>The caller must hold the lock of {@code MozcJNI.class} until the pending output is taken
+   * by {@link #takePendingOutput(ByteBuffer)}.
+   *
+   * @param in direct buffer whose first {@code inSize} bytes are the blob of Command message.
+   * @param out direct buffer to which the blob of the result is written from its beginning.
+   * @return the size of the result, or its negated size if {@code out} is too small. In the
+   *     latter case, the result must be taken by {@link #takePendingOutput(ByteBuffer)}.
+   */
+  static synchronized native int evalCommandDirect(ByteBuffer in, int inSize, ByteBuffer out);
+
+  /**
+   * Batched version of {@link #evalCommandDirect(ByteBuffer, int, ByteBuffer)}.
+   *
+   * <p>{@code in} holds Command messages written by {@code writeDelimitedTo}. They are evaluated
+   * in order, and the results are written in the same format.
+   */
+  static synchronized native int evalCommandsDirect(ByteBuffer in, int inSize, ByteBuffer out);
+
+  /**
+   * Copies the result of the last call which didn't fit in its {@code out} buffer.
+   *
+   * @return the size of the result, or its negated size if {@code out} is still too small.
+   */
+  static synchronized native int takePendingOutput(ByteBuffer out);
+
   /**
    * This method initializes the internal state of mozc server, especially dictionary data
    * and session related stuff. We cannot do this in JNI_OnLoad, which is the callback API
@@ -0,0 +1,164 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/access_profiler.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/number_util.h"
+#include "base/singleton.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace {
+
+// The counts are keyed by the pointer of the name, as Record() is called
+// with string literals; the same names are merged in GetEntries().
+struct Registry {
+  Mutex mutex;
+  std::map<const char *, std::unordered_map<uint32, uint64>> counts;
+};
+
+}  // namespace
+
+std::atomic<bool> AccessProfiler::enabled_(false);
+
+// static
+void AccessProfiler::SetEnabled(bool enabled) {
+  Registry *registry = Singleton<Registry>::get();
+  scoped_lock lock(&registry->mutex);
+  if (enabled && !IsEnabled()) {
+    registry->counts.clear();
+  }
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+// static
+void AccessProfiler::RecordInternal(const char *name, uint32 index) {
+  Registry *registry = Singleton<Registry>::get();
+  scoped_lock lock(&registry->mutex);
+  ++registry->counts[name][index];
+}
+
+// static
+void AccessProfiler::GetEntries(std::vector<Entry> *entries) {
+  DCHECK(entries);
+  entries->clear();
+
+  std::map<string, std::unordered_map<uint32, uint64>> merged;
+  {
+    Registry *registry = Singleton<Registry>::get();
+    scoped_lock lock(&registry->mutex);
+    for (const auto &data : registry->counts) {
+      std::unordered_map<uint32, uint64> *counts = &merged[data.first];
+      for (const auto &entry : data.second) {
+        (*counts)[entry.first] += entry.second;
+      }
+    }
+  }
+
+  std::vector<std::pair<uint64, string>> totals;
+  for (const auto &data : merged) {
+    uint64 total = 0;
+    for (const auto &entry : data.second) {
+      total += entry.second;
+    }
+    totals.push_back(std::make_pair(total, data.first));
+  }
+  // Hotter data first, and the names for the ties.
+  std::sort(totals.begin(), totals.end(),
+            [](const std::pair<uint64, string> &x,
+               const std::pair<uint64, string> &y) {
+              return x.first != y.first ? x.first > y.first :
+                                          x.second < y.second;
+            });
+
+  for (const auto &total : totals) {
+    const std::unordered_map<uint32, uint64> &counts = merged[total.second];
+    const size_t begin = entries->size();
+    for (const auto &entry : counts) {
+      Entry e;
+      e.name = total.second;
+      e.index = entry.first;
+      e.count = entry.second;
+      entries->push_back(e);
+    }
+    std::sort(entries->begin() + begin, entries->end(),
+              [](const Entry &x, const Entry &y) {
+                return x.count != y.count ? x.count > y.count :
+                                            x.index < y.index;
+              });
+  }
+}
+
+// static
+void AccessProfiler::Write(std::ostream *os) {
+  DCHECK(os);
+  std::vector<Entry> entries;
+  GetEntries(&entries);
+  *os << "# name\tindex\tcount" << std::endl;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    *os << entries[i].name << '\t' << entries[i].index << '\t'
+        << entries[i].count << '\n';
+  }
+  os->flush();
+}
+
+// static
+bool AccessProfiler::Read(std::istream *is, std::vector<Entry> *entries) {
+  DCHECK(is);
+  DCHECK(entries);
+  entries->clear();
+  string line;
+  while (!getline(*is, line).fail()) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<StringPiece> fields;
+    Util::SplitStringUsing(line, "\t", &fields);
+    Entry entry;
+    if (fields.size() != 3 ||
+        !NumberUtil::SafeStrToUInt32(fields[1], &entry.index) ||
+        !NumberUtil::SafeStrToUInt64(fields[2], &entry.count)) {
+      LOG(ERROR) << "Malformed access profile line: " << line;
+      return false;
+    }
+    fields[0].CopyToString(&entry.name);
+    entries->push_back(entry);
+  }
+  return true;
+}
+
+}  // namespace mozc
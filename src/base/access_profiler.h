@@ -0,0 +1,100 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_ACCESS_PROFILER_H_
+#define MOZC_BASE_ACCESS_PROFILER_H_
+
+#include <atomic>
+#include <istream>  // NOLINT
+#include <ostream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// Counts the accesses to the entries of the data set, e.g. the keys of the
+// system dictionary and the rows of the connection matrix, while replaying
+// traffic.  The data generators read the profile to place the hot entries
+// together, so that a conversion touches fewer pages of the mmapped data.
+//
+// Recording takes a lock, which is fine for the profiling runs only.  While
+// disabled, which is the default, Record() is a relaxed atomic load.
+//
+// The profile is a text file of "<data name>\t<index>\t<count>" lines, where
+// the data name is the one in the data set, e.g. "dict" or "conn".  The data
+// are ordered by the total count, and the entries of each data by the count,
+// both in descending order.  Lines starting with '#' are comments.
+class AccessProfiler {
+ public:
+  struct Entry {
+    string name;
+    uint32 index;
+    uint64 count;
+  };
+
+  // The profiling is disabled by default.  Enabling it discards the counts
+  // recorded before.
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Records an access to the |index|-th entry of the data |name|, which must
+  // live until the process exits.
+  static void Record(const char *name, uint32 index) {
+    if (IsEnabled()) {
+      RecordInternal(name, index);
+    }
+  }
+
+  // Returns the counts recorded since the profiling was enabled, in the
+  // order of the profile.
+  static void GetEntries(std::vector<Entry> *entries);
+
+  // Writes the counts recorded since the profiling was enabled.
+  static void Write(std::ostream *os);
+
+  // Reads a profile written by Write().  Returns false if a line is
+  // malformed.
+  static bool Read(std::istream *is, std::vector<Entry> *entries);
+
+ private:
+  static void RecordInternal(const char *name, uint32 index);
+
+  static std::atomic<bool> enabled_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(AccessProfiler);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_ACCESS_PROFILER_H_
@@ -0,0 +1,100 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/access_profiler.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(AccessProfilerTest, DisabledByDefault) {
+  AccessProfiler::Record("conn", 1);
+  std::vector<AccessProfiler::Entry> entries;
+  AccessProfiler::GetEntries(&entries);
+  EXPECT_TRUE(entries.empty());
+}
+
+TEST(AccessProfilerTest, RecordAndWrite) {
+  AccessProfiler::SetEnabled(true);
+  AccessProfiler::Record("conn", 3);
+  AccessProfiler::Record("dict", 10);
+  AccessProfiler::Record("dict", 20);
+  AccessProfiler::Record("dict", 20);
+  AccessProfiler::SetEnabled(false);
+  // Not recorded while disabled.
+  AccessProfiler::Record("conn", 3);
+
+  std::vector<AccessProfiler::Entry> entries;
+  AccessProfiler::GetEntries(&entries);
+  ASSERT_EQ(3, entries.size());
+  // "dict" is hotter than "conn" in total.
+  EXPECT_EQ("dict", entries[0].name);
+  EXPECT_EQ(20, entries[0].index);
+  EXPECT_EQ(2, entries[0].count);
+  EXPECT_EQ("dict", entries[1].name);
+  EXPECT_EQ(10, entries[1].index);
+  EXPECT_EQ(1, entries[1].count);
+  EXPECT_EQ("conn", entries[2].name);
+  EXPECT_EQ(3, entries[2].index);
+  EXPECT_EQ(1, entries[2].count);
+
+  std::stringstream profile;
+  AccessProfiler::Write(&profile);
+  std::vector<AccessProfiler::Entry> read_entries;
+  ASSERT_TRUE(AccessProfiler::Read(&profile, &read_entries));
+  ASSERT_EQ(entries.size(), read_entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i].name, read_entries[i].name);
+    EXPECT_EQ(entries[i].index, read_entries[i].index);
+    EXPECT_EQ(entries[i].count, read_entries[i].count);
+  }
+
+  // Enabling again discards the counts.
+  AccessProfiler::SetEnabled(true);
+  AccessProfiler::SetEnabled(false);
+  AccessProfiler::GetEntries(&entries);
+  EXPECT_TRUE(entries.empty());
+}
+
+TEST(AccessProfilerTest, ReadMalformedProfile) {
+  std::vector<AccessProfiler::Entry> entries;
+  std::istringstream missing_count("conn\t1\n");
+  EXPECT_FALSE(AccessProfiler::Read(&missing_count, &entries));
+  std::istringstream negative_index("conn\t-1\t2\n");
+  EXPECT_FALSE(AccessProfiler::Read(&negative_index, &entries));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -45,6 +45,7 @@
         'run_level.cc',
         'scheduler.cc',
         'stopwatch.cc',
+        'thread_pool.cc',
         'unnamed_event.cc',
       ],
       'dependencies': [
@@ -101,16 +102,22 @@
       'sources': [
         '<(gen_out_dir)/character_set.h',
         '<(gen_out_dir)/version_def.h',
+        'access_profiler.cc',
         'file_stream.cc',
         'file_util.cc',
         'init_mozc.cc',
+        'io_stats.cc',
         'japanese_util_rule.cc',
         'logging.cc',
+        'memory_stats.cc',
         'mmap.cc',
         'number_util.cc',
+        'perf_counter.cc',
         'system_util.cc',
         'text_normalizer.cc',
         'thread.cc',
+        'trace.cc',
+        'utf8_kernel.cc',
         'util.cc',
         'version.cc',
         'win_util.cc',
@@ -447,6 +454,26 @@
         'debug.cc',
       ],
     },
+    {
+      'target_name': 'utf8_kernel_benchmark_main',
+      'type': 'executable',
+      'sources': [
+        'utf8_kernel_benchmark_main.cc',
+      ],
+      'dependencies': [
+        'base_core',
+      ],
+    },
+    {
+      'target_name': 'logging_benchmark_main',
+      'type': 'executable',
+      'sources': [
+        'logging_benchmark_main.cc',
+      ],
+      'dependencies': [
+        'base_core',
+      ],
+    },
     {
       'target_name': 'serialized_string_array',
       'type': 'static_library',
@@ -81,8 +81,10 @@
       'sources': [
         'codegen_bytearray_stream_test.cc',
         'cpu_stats_test.cc',
+        'freelist_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
+        'thread_pool_test.cc',
         'unnamed_event_test.cc',
       ],
       'conditions': [
@@ -133,16 +135,22 @@
       'target_name': 'base_core_test',
       'type': 'executable',
       'sources': [
+        'access_profiler_test.cc',
         'bitarray_test.cc',
         'flags_test.cc',
+        'init_mozc_test.cc',
+        'io_stats_test.cc',
         'iterator_adapter_test.cc',
         'logging_test.cc',
+        'memory_stats_test.cc',
         'mmap_test.cc',
+        'perf_counter_test.cc',
         'singleton_test.cc',
         'stl_util_test.cc',
         'string_piece_test.cc',
         'text_normalizer_test.cc',
         'thread_test.cc',
+        'trace_test.cc',
         'version_test.cc',
       ],
       'conditions': [
@@ -224,6 +232,7 @@
       'target_name': 'util_test',
       'type': 'executable',
       'sources': [
+        'utf8_kernel_test.cc',
         'util_test.cc',
       ],
       'dependencies': [
@@ -38,6 +38,7 @@
 #include <sstream>
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
@@ -90,6 +91,28 @@ class OnMemoryFileMap {
 };
 
 #include "base/config_file_stream_data.h"
+
+// Opens the local file.  The whole file is recorded as read, since the
+// streams are usually read to the end.
+std::istream *OpenInputFileStream(const string &filename,
+                                  ios_base::openmode mode) {
+  IOStats::ScopedOperation operation(IOStats::CONFIG_FILE_STREAM,
+                                     IOStats::READ);
+  InputFileStream *ifs = new InputFileStream(filename.c_str(), mode);
+  CHECK(ifs);
+  if (!ifs->good()) {
+    delete ifs;
+    return NULL;
+  }
+  ifs->seekg(0, std::ios::end);
+  const std::streamoff size = ifs->tellg();
+  if (size > 0) {
+    operation.set_bytes(static_cast<size_t>(size));
+  }
+  ifs->clear();
+  ifs->seekg(0, std::ios::beg);
+  return ifs;
+}
 }  // namespace
 
 std::istream *ConfigFileStream::Open(const string &filename,
@@ -114,23 +137,11 @@ std::istream *ConfigFileStream::Open(const string &filename,
     const string new_filename =
         FileUtil::JoinPath(SystemUtil::GetUserProfileDirectory(),
                            RemovePrefix(kUserPrefix, filename));
-    InputFileStream *ifs = new InputFileStream(new_filename.c_str(), mode);
-    CHECK(ifs);
-    if (ifs->good()) {
-      return ifs;
-    }
-    delete ifs;
-    return NULL;
+    return OpenInputFileStream(new_filename, mode);
   // file:///foo.map
   } else if (Util::StartsWith(filename, kFilePrefix)) {
     const string new_filename = RemovePrefix(kFilePrefix, filename);
-    InputFileStream *ifs = new InputFileStream(new_filename.c_str(), mode);
-    CHECK(ifs);
-    if (ifs->good()) {
-      return ifs;
-    }
-    delete ifs;
-    return NULL;
+    return OpenInputFileStream(new_filename, mode);
   } else if (Util::StartsWith(filename, kMemoryPrefix)) {
     std::istringstream *ifs = new std::istringstream(
         Singleton<OnMemoryFileMap>::get()->get(filename), mode);
@@ -142,13 +153,7 @@ std::istream *ConfigFileStream::Open(const string &filename,
     return NULL;
   } else {
     LOG(WARNING) << filename << " has no prefix. open from localfile";
-    InputFileStream *ifs = new InputFileStream(filename.c_str(), mode);
-    CHECK(ifs);
-    if (ifs->good()) {
-      return ifs;
-    }
-    delete ifs;
-    return NULL;
+    return OpenInputFileStream(filename, mode);
   }
 
   return NULL;
@@ -171,6 +176,9 @@ bool ConfigFileStream::AtomicUpdate(const string &filename,
     return false;
   }
 
+  IOStats::ScopedOperation operation(IOStats::CONFIG_FILE_STREAM,
+                                     IOStats::WRITE);
+  operation.set_bytes(new_binary_contens.size());
   const string tmp_filename = real_filename + ".tmp";
   {
     OutputFileStream ofs(tmp_filename.c_str(),
@@ -60,12 +60,16 @@ namespace mozc {
 // Stores a byte data of file and its file size.  To create this structure, use
 // embed_file.py.  The first address of embedded file data is aligned at 64 bit
 // boundary, so we can embed data that requires normal alignment (8, 16, etc.).
+// The generated array is const, so it is placed in the read-only section of
+// the binary and its pages are shared by all the processes loading it.
 struct EmbeddedFile {
   const uint64 *const data;
   const size_t size;
 };
 
-// Interprets EmbeddedFile as a byte array.
+// Interprets EmbeddedFile as a byte array.  No copy is made; the returned
+// piece points to the embedded data itself, so callers should keep using it in
+// place rather than materializing it on the heap.
 inline StringPiece LoadEmbeddedFile(EmbeddedFile f) {
   return StringPiece(reinterpret_cast<const char*>(f.data), f.size);
 }
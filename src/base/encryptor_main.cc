@@ -36,6 +36,8 @@
 #include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/mmap.h"
+#include "base/stopwatch.h"
+#include "base/unverified_aes256.h"
 #include "base/util.h"
 
 DEFINE_string(password, "", "password");
@@ -53,17 +55,95 @@ DEFINE_string(output_file, "", "input file");
 // used for making a golden data for unittesting
 DEFINE_string(test_input, "", "test input string");
 
+// measure the throughput of each AES implementation
+DEFINE_bool(benchmark, false, "benchmark mode");
+DEFINE_int32(benchmark_size, 1 << 20, "buffer size in bytes for --benchmark");
+DEFINE_int32(benchmark_iterations, 100,
+             "the number of transformations for --benchmark");
+
 namespace {
 string Escape(const string &buf) {
   string tmp;
   mozc::Util::Escape(buf, &tmp);
   return tmp;
 }
+
+const char *GetImplementationName(
+    mozc::internal::UnverifiedAES256::Implementation impl) {
+  switch (impl) {
+    case mozc::internal::UnverifiedAES256::SCALAR:
+      return "scalar";
+    case mozc::internal::UnverifiedAES256::AESNI:
+      return "AES-NI";
+    case mozc::internal::UnverifiedAES256::ARMV8_CRYPTO:
+      return "ARMv8 Crypto";
+    default:
+      return "unknown";
+  }
+}
+
+// Returns the throughput in MB/s.
+double GetThroughput(size_t bytes, mozc::Stopwatch *stopwatch) {
+  const double seconds = stopwatch->GetElapsedMicroseconds() / 1000000.0;
+  return seconds > 0.0 ? bytes / seconds / (1 << 20) : 0.0;
+}
+
+void Benchmark() {
+  typedef mozc::internal::UnverifiedAES256 AES;
+  const AES::Implementation kImplementations[] = {
+    AES::SCALAR, AES::AESNI, AES::ARMV8_CRYPTO,
+  };
+  const size_t num_blocks = FLAGS_benchmark_size / AES::kBlockBytes;
+  CHECK_GT(num_blocks, 0) << "--benchmark_size is too small";
+  uint8 key[AES::kKeyBytes];
+  uint8 iv[AES::kBlockBytes];
+  mozc::Util::GetRandomSequence(reinterpret_cast<char *>(key), sizeof(key));
+  mozc::Util::GetRandomSequence(reinterpret_cast<char *>(iv), sizeof(iv));
+  string original(num_blocks * AES::kBlockBytes, '\0');
+  mozc::Util::GetRandomSequence(&original[0], original.size());
+  const size_t total_bytes =
+      num_blocks * AES::kBlockBytes * FLAGS_benchmark_iterations;
+
+  std::cout << "Default: " << GetImplementationName(
+      AES::GetDefaultImplementation()) << std::endl;
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    if (!AES::IsAvailable(kImplementations[i])) {
+      continue;
+    }
+    string buf = original;
+    uint8 *data = reinterpret_cast<uint8 *>(&buf[0]);
+
+    mozc::Stopwatch encrypt = mozc::Stopwatch::StartNew();
+    for (int j = 0; j < FLAGS_benchmark_iterations; ++j) {
+      AES::TransformCBCWithImplementation(kImplementations[i], key, iv, data,
+                                          num_blocks);
+    }
+    encrypt.Stop();
+
+    mozc::Stopwatch decrypt = mozc::Stopwatch::StartNew();
+    for (int j = 0; j < FLAGS_benchmark_iterations; ++j) {
+      AES::InverseTransformCBCWithImplementation(kImplementations[i], key, iv,
+                                                 data, num_blocks);
+    }
+    decrypt.Stop();
+    CHECK(buf == original);
+
+    std::cout << GetImplementationName(kImplementations[i])
+              << ": encrypt " << GetThroughput(total_bytes, &encrypt)
+              << " MB/s, decrypt " << GetThroughput(total_bytes, &decrypt)
+              << " MB/s" << std::endl;
+  }
+}
 }  // namespace
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, false);
 
+  if (FLAGS_benchmark) {
+    Benchmark();
+    return 0;
+  }
+
   if (!FLAGS_iv.empty()) {
     CHECK_EQ(16, FLAGS_iv.size()) << "iv size must be 16 byte";
   }
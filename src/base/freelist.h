@@ -30,6 +30,7 @@
 #ifndef MOZC_BASE_FREELIST_H_
 #define MOZC_BASE_FREELIST_H_
 
+#include <algorithm>
 #include <vector>
 #include "base/port.h"
 
@@ -47,7 +48,8 @@ namespace mozc {
 template <class T> class FreeList {
  public:
   explicit FreeList(size_t size)
-      : current_index_(0), chunk_index_(0), size_(size) {
+      : current_index_(0), chunk_index_(0), size_(size),
+        high_water_mark_(0) {
   }
 
   ~FreeList() {
@@ -84,6 +86,9 @@ template <class T> class FreeList {
     if (chunk_index_ == pool_.size()) {
       pool_.push_back(new T[size_]);
     }
+    if (chunk_index_ >= high_water_mark_) {
+      high_water_mark_ = chunk_index_ + 1;
+    }
 
     T* r = pool_[chunk_index_] + current_index_;
     current_index_ += len;
@@ -94,11 +99,37 @@ template <class T> class FreeList {
     size_ = size;
   }
 
+  // Deletes the chunks which have not been used since the last call of
+  // Shrink(), keeping the ones in use.  Calling this periodically, e.g., on
+  // idle, releases the memory kept after a peak of usage once the usage goes
+  // down, while the chunks needed by the recent usage are kept for reuse.
+  // Note that a chunk is deleted even if it's the first one.
+  void Shrink() {
+    const size_t num_chunks_in_use =
+        (chunk_index_ == 0 && current_index_ == 0) ? 0 : chunk_index_ + 1;
+    const size_t num_chunks_to_keep =
+        std::max(num_chunks_in_use, high_water_mark_);
+    for (size_t i = num_chunks_to_keep; i < pool_.size(); ++i) {
+      delete [] pool_[i];
+    }
+    if (pool_.size() > num_chunks_to_keep) {
+      pool_.resize(num_chunks_to_keep);
+    }
+    high_water_mark_ = num_chunks_in_use;
+  }
+
+  // Returns the number of elements held by the allocated chunks.
+  size_t capacity() const {
+    return pool_.size() * size_;
+  }
+
  private:
   std::vector<T *> pool_;
   size_t current_index_;
   size_t chunk_index_;
   size_t size_;
+  // The number of chunks used since the last Shrink().
+  size_t high_water_mark_;
 
   DISALLOW_COPY_AND_ASSIGN(FreeList);
 };
@@ -116,6 +147,14 @@ template <class T> class ObjectPool {
     freelist_.Free();
   }
 
+  // Makes all the objects available again without freeing any memory.  As
+  // the objects are not destructed, they keep their resources, e.g., the
+  // capacity of strings, for the next use.
+  void Reset() {
+    released_.clear();
+    freelist_.Reset();
+  }
+
   T* Alloc() {
     if (!released_.empty()) {
       T *result = released_.back();
@@ -133,6 +172,21 @@ template <class T> class ObjectPool {
     freelist_.set_size(size);
   }
 
+  // Deletes the objects in the chunks which have not been used since the last
+  // Shrink().  See FreeList::Shrink().  The objects in use, including the
+  // released ones, are kept.
+  void Shrink() {
+    freelist_.Shrink();
+    if (released_.empty()) {
+      std::vector<T *>().swap(released_);
+    }
+  }
+
+  // Returns the number of objects held by the pool.
+  size_t capacity() const {
+    return freelist_.capacity();
+  }
+
  private:
   std::vector<T *> released_;
   FreeList<T> freelist_;
@@ -0,0 +1,103 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/freelist.h"
+
+#include <string>
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(FreeListTest, ShrinkKeepsChunksUsedSinceLastShrink) {
+  FreeList<int> freelist(4);
+  for (int i = 0; i < 10; ++i) {
+    freelist.Alloc();
+  }
+  // Alloc() moves to the next chunk when the current one has only one
+  // element left, so 10 elements take 4 chunks.
+  EXPECT_EQ(16, freelist.capacity());
+
+  // All the chunks have been used since the construction.
+  freelist.Reset();
+  freelist.Shrink();
+  EXPECT_EQ(16, freelist.capacity());
+
+  // Only the first chunk is used after the last Shrink().
+  freelist.Alloc();
+  freelist.Reset();
+  freelist.Alloc();
+  freelist.Shrink();
+  EXPECT_EQ(4, freelist.capacity());
+
+  // The chunk in use is kept.
+  freelist.Shrink();
+  EXPECT_EQ(4, freelist.capacity());
+
+  // Nothing is used.
+  freelist.Reset();
+  freelist.Shrink();
+  EXPECT_EQ(4, freelist.capacity());
+  freelist.Shrink();
+  EXPECT_EQ(0, freelist.capacity());
+
+  // Chunks are allocated again.
+  int *p = freelist.Alloc();
+  *p = 1;
+  EXPECT_EQ(4, freelist.capacity());
+}
+
+TEST(ObjectPoolTest, ShrinkKeepsObjectsInUse) {
+  ObjectPool<string> pool(3);
+  std::vector<string *> objects;
+  for (int i = 0; i < 5; ++i) {
+    objects.push_back(pool.Alloc());
+    objects.back()->assign("test");
+  }
+  pool.Release(objects[4]);
+  pool.Release(objects[3]);
+  pool.Shrink();
+  pool.Shrink();
+  EXPECT_EQ(9, pool.capacity());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ("test", *objects[i]);
+  }
+  // The released objects are still reused.
+  EXPECT_EQ(objects[3], pool.Alloc());
+
+  pool.Reset();
+  pool.Shrink();
+  pool.Shrink();
+  EXPECT_EQ(0, pool.capacity());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -29,6 +29,8 @@
 
 #include "base/hash.h"
 
+#include <cstring>
+
 #include "base/port.h"
 
 namespace mozc {
@@ -38,6 +40,13 @@ const uint32 kFingerPrint32Seed = 0xfd12deff;
 const uint32 kFingerPrintSeed0 = 0x6d6f;
 const uint32 kFingerPrintSeed1 = 0x7a63;
 
+// The constants of MurmurHash64A.
+const uint64 kFingerprintV2Multiplier = GG_ULONGLONG(0xc6a4a7935bd1e995);
+const int kFingerprintV2Shift = 47;
+
+// Fingerprints never return 0 and 1, which are replaced with this value.
+const uint64 kFingerprintForZeroAndOne = GG_ULONGLONG(0x130f9bef94a0a928);
+
 }  // namespace
 
 #define Mix(a, b, c) {            \
@@ -126,9 +135,58 @@ uint64 Hash::FingerprintWithSeed(StringPiece str, uint32 seed) {
   const uint32 lo = Fingerprint32WithSeed(str, kFingerPrintSeed1);
   uint64 result = static_cast<uint64>(hi) << 32 | static_cast<uint64>(lo);
   if ((hi == 0) && (lo < 2)) {
-    result ^= GG_ULONGLONG(0x130f9bef94a0a928);
+    result ^= kFingerprintForZeroAndOne;
   }
   return result;
 }
 
+uint64 Hash::FingerprintV2(StringPiece str) {
+  return FingerprintV2WithSeed(str, kFingerPrintSeed0);
+}
+
+// MurmurHash64A by Austin Appleby, which is in the public domain.
+uint64 Hash::FingerprintV2WithSeed(StringPiece str, uint32 seed) {
+  const uint64 m = kFingerprintV2Multiplier;
+  const int r = kFingerprintV2Shift;
+  uint64 h = seed ^ (static_cast<uint64>(str.size()) * m);
+
+  const char *ptr = str.data();
+  const char *end = ptr + (str.size() & ~static_cast<size_t>(7));
+  for (; ptr != end; ptr += 8) {
+    uint64 k;
+    memcpy(&k, ptr, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  const size_t rest = str.size() & 7;
+  if (rest > 0) {
+    uint64 k = 0;
+    memcpy(&k, ptr, rest);
+    h ^= k;
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  if (h < 2) {
+    h ^= kFingerprintForZeroAndOne;
+  }
+  return h;
+}
+
+uint64 Hash::FingerprintWithVersion(FingerprintVersion version,
+                                    StringPiece str, uint32 seed) {
+  // The callers validate the versions read from the data, so the unknown
+  // versions are not expected here.
+  if (version == FINGERPRINT_V2) {
+    return FingerprintV2WithSeed(str, seed);
+  }
+  return FingerprintWithSeed(str, seed);
+}
+
 }  // namespace mozc
@@ -39,10 +39,32 @@ namespace mozc {
 
 class Hash {
  public:
+  // Versions of the 64-bit fingerprint.  The data which persist fingerprints
+  // record the version, so that the existing data keep being looked up with
+  // the fingerprint they were built with.
+  enum FingerprintVersion {
+    // Fingerprint() and FingerprintWithSeed().
+    FINGERPRINT_V1 = 0,
+    // FingerprintV2() and FingerprintV2WithSeed().
+    FINGERPRINT_V2 = 1,
+    NUM_FINGERPRINT_VERSIONS,
+  };
+
   // Calculates 64-bit fingerprint.
   static uint64 Fingerprint(StringPiece str);
   static uint64 FingerprintWithSeed(StringPiece str, uint32 seed);
 
+  // Calculates 64-bit fingerprint in a single pass reading 8 bytes at once,
+  // which is several times faster than Fingerprint().  The values are
+  // different from Fingerprint().
+  // Note: This function depends on endian.
+  static uint64 FingerprintV2(StringPiece str);
+  static uint64 FingerprintV2WithSeed(StringPiece str, uint32 seed);
+
+  // Calculates 64-bit fingerprint of |version|.
+  static uint64 FingerprintWithVersion(FingerprintVersion version,
+                                       StringPiece str, uint32 seed);
+
   // Calculates 32-bit fingerprint.
   static uint32 Fingerprint32(StringPiece str);
   static uint32 Fingerprint32WithSeed(StringPiece str, uint32 seed);
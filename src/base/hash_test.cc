@@ -57,6 +57,39 @@ TEST(HashTest, Basic) {
   EXPECT_EQ(0xe3fd29979d4f0b39, Hash::FingerprintWithSeed(s, 0xdeadbeef));
 }
 
+TEST(HashTest, FingerprintV2) {
+  string s = "";
+  EXPECT_EQ(0x3cbe66fd3078c1e7, Hash::FingerprintV2(s));
+  EXPECT_EQ(0xb04ce6229407c882, Hash::FingerprintV2WithSeed(s, 0xdeadbeef));
+
+  s = "google";
+  EXPECT_EQ(0x910b14fee2e4b0ed, Hash::FingerprintV2(s));
+  EXPECT_EQ(0xd1e7eacb8f707660, Hash::FingerprintV2WithSeed(s, 0xdeadbeef));
+
+  s = "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.";
+  EXPECT_EQ(0x138b94be25a2cf07, Hash::FingerprintV2(s));
+  EXPECT_EQ(0x5f02bf8c7e3fd2ca, Hash::FingerprintV2WithSeed(s, 0xdeadbeef));
+
+  // Each of the trailing bytes, which don't fill 8 bytes, should be hashed.
+  const string long_str = "0123456789abcdef";
+  for (size_t len = 0; len < long_str.size(); ++len) {
+    EXPECT_NE(Hash::FingerprintV2(long_str.substr(0, len)),
+              Hash::FingerprintV2(long_str.substr(0, len + 1)));
+  }
+}
+
+TEST(HashTest, FingerprintWithVersion) {
+  const char *kStrings[] = {"", "google", "Hello, world!"};
+  for (size_t i = 0; i < arraysize(kStrings); ++i) {
+    EXPECT_EQ(Hash::FingerprintWithSeed(kStrings[i], 0xdeadbeef),
+              Hash::FingerprintWithVersion(Hash::FINGERPRINT_V1, kStrings[i],
+                                           0xdeadbeef));
+    EXPECT_EQ(Hash::FingerprintV2WithSeed(kStrings[i], 0xdeadbeef),
+              Hash::FingerprintWithVersion(Hash::FINGERPRINT_V2, kStrings[i],
+                                           0xdeadbeef));
+  }
+}
+
 TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   const uint32 seed = 0xabcdef;
   {
@@ -36,9 +36,12 @@
 
 #include <string>
 
+#include "base/clock.h"
 #include "base/file_util.h"
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/mutex.h"
+#include "base/thread.h"
 #ifndef MOZC_BUILDTOOL_BUILD
 #include "base/system_util.h"
 #endif  // MOZC_BUILDTOOL_BUILD
@@ -79,6 +82,39 @@ string GetLogFilePathFromProgramName(const string &program_name) {
   return FileUtil::JoinPath(FLAGS_log_dir, basename);
 }
 
+// The initializers are registered during the static initialization, so they
+// are kept in plain arrays rather than in an object with a constructor.
+const size_t kMaxSingletonInitializers = 64;
+
+struct SingletonInitializerEntry {
+  const char *name;
+  SingletonInitializer::InitFunc func;
+  bool done;
+  uint64 microseconds;
+};
+
+SingletonInitializerEntry g_singleton_initializers[kMaxSingletonInitializers];
+size_t g_num_singleton_initializers = 0;
+
+// Guards |done| and |microseconds| of g_singleton_initializers.
+struct SingletonInitializerMutex {
+  Mutex mutex;
+};
+
+class SingletonInitializerThread : public Thread {
+ public:
+  void Run() override {
+    SingletonInitializer::RunAll();
+  }
+};
+
+uint64 GetMicroseconds() {
+  uint64 sec = 0;
+  uint32 usec = 0;
+  Clock::GetTimeOfDay(&sec, &usec);
+  return sec * 1000000 + usec;
+}
+
 }  // namespace
 
 void InitMozc(const char *arg0, int *argc, char ***argv, bool remove_flags) {
@@ -98,4 +134,60 @@ void InitMozc(const char *arg0, int *argc, char ***argv, bool remove_flags) {
 
 }
 
+bool SingletonInitializer::Register(const char *name, InitFunc func) {
+  DCHECK_LT(g_num_singleton_initializers, kMaxSingletonInitializers);
+  if (g_num_singleton_initializers < kMaxSingletonInitializers) {
+    SingletonInitializerEntry *entry =
+        &g_singleton_initializers[g_num_singleton_initializers++];
+    entry->name = name;
+    entry->func = func;
+    entry->done = false;
+    entry->microseconds = 0;
+  }
+  return true;
+}
+
+void SingletonInitializer::RunAll() {
+  scoped_lock l(&Singleton<SingletonInitializerMutex>::get()->mutex);
+  const uint64 start = GetMicroseconds();
+  for (size_t i = 0; i < g_num_singleton_initializers; ++i) {
+    SingletonInitializerEntry *entry = &g_singleton_initializers[i];
+    if (entry->done) {
+      continue;
+    }
+    const uint64 begin = GetMicroseconds();
+    (*entry->func)();
+    entry->microseconds = GetMicroseconds() - begin;
+    entry->done = true;
+    VLOG(1) << "Initialized " << entry->name << " in "
+            << entry->microseconds << " usec";
+  }
+  VLOG(1) << "Singleton initializers finished in "
+          << GetMicroseconds() - start << " usec";
+}
+
+void SingletonInitializer::StartInBackground() {
+  Singleton<SingletonInitializerThread>::get()->Start("SingletonInitializer");
+}
+
+void SingletonInitializer::Wait() {
+  Singleton<SingletonInitializerThread>::get()->Join();
+}
+
+void SingletonInitializer::GetCosts(std::vector<Cost> *costs) {
+  DCHECK(costs);
+  costs->clear();
+  scoped_lock l(&Singleton<SingletonInitializerMutex>::get()->mutex);
+  for (size_t i = 0; i < g_num_singleton_initializers; ++i) {
+    const SingletonInitializerEntry &entry = g_singleton_initializers[i];
+    if (!entry.done) {
+      continue;
+    }
+    Cost cost;
+    cost.name = entry.name;
+    cost.microseconds = entry.microseconds;
+    costs->push_back(cost);
+  }
+}
+
 }  // namespace mozc
@@ -30,11 +30,65 @@
 #ifndef MOZC_BASE_INIT_MOZC_H_
 #define MOZC_BASE_INIT_MOZC_H_
 
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/singleton.h"
+
 namespace mozc {
 
 // Initializes all the modules, such as flags and logging.
 void InitMozc(const char *arg0, int *argc, char ***argv, bool remove_flags);
 
+// Registry of the functions which construct heavyweight singletons, e.g. the
+// tables built by Singleton<Foo>::get() on first use.  The server runs them on
+// a background thread at startup so that the first key event doesn't pay for
+// the construction.  Singleton<T>::get() is thread-safe, so a key event which
+// needs a singleton under construction just waits for it.
+//
+// Usage (at namespace scope in foo.cc):
+//   const bool kFooRegistered =
+//       SingletonInitializer::Register("Foo", &InitSingleton<Foo>);
+class SingletonInitializer {
+ public:
+  typedef void (*InitFunc)();
+
+  struct Cost {
+    string name;
+    // Wall time of the initializer.  Close to zero if the singleton had been
+    // constructed on demand before the initializer ran.
+    uint64 microseconds;
+  };
+
+  // Registers |func| under |name|.  Always returns true so that the result
+  // can initialize a static variable.
+  static bool Register(const char *name, InitFunc func);
+
+  // Runs the registered initializers which haven't run yet on the calling
+  // thread.
+  static void RunAll();
+
+  // Runs RunAll() on a background thread.  Does nothing if the thread has
+  // already been started.
+  static void StartInBackground();
+
+  // Waits for the thread started by StartInBackground().
+  static void Wait();
+
+  // Returns the costs of the initializers which have run, in the order of
+  // registration.
+  static void GetCosts(std::vector<Cost> *costs);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(SingletonInitializer);
+};
+
+template <typename T>
+void InitSingleton() {
+  Singleton<T>::get();
+}
+
 }  // namespace mozc
 
 #endif  // MOZC_BASE_INIT_MOZC_H_
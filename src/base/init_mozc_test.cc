@@ -0,0 +1,101 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/init_mozc.h"
+
+#include <string>
+#include <vector>
+
+#include "base/singleton.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+int g_num_constructed = 0;
+int g_num_counter_calls = 0;
+
+class HeavyTable {
+ public:
+  HeavyTable() {
+    ++g_num_constructed;
+  }
+};
+
+void CountCalls() {
+  ++g_num_counter_calls;
+}
+
+bool FindCost(const std::vector<SingletonInitializer::Cost> &costs,
+              const string &name) {
+  for (size_t i = 0; i < costs.size(); ++i) {
+    if (costs[i].name == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST(SingletonInitializerTest, RunAll) {
+  g_num_counter_calls = 0;
+  SingletonInitializer::Register("Counter", &CountCalls);
+
+  std::vector<SingletonInitializer::Cost> costs;
+  SingletonInitializer::GetCosts(&costs);
+  EXPECT_FALSE(FindCost(costs, "Counter"));
+
+  SingletonInitializer::RunAll();
+  EXPECT_EQ(1, g_num_counter_calls);
+  SingletonInitializer::GetCosts(&costs);
+  EXPECT_TRUE(FindCost(costs, "Counter"));
+
+  // Each initializer runs only once.
+  SingletonInitializer::RunAll();
+  EXPECT_EQ(1, g_num_counter_calls);
+}
+
+TEST(SingletonInitializerTest, StartInBackground) {
+  g_num_constructed = 0;
+  SingletonInitializer::Register("HeavyTable", &InitSingleton<HeavyTable>);
+  SingletonInitializer::StartInBackground();
+
+  // The singleton is constructed only once even if it is requested while
+  // the background thread is running.
+  Singleton<HeavyTable>::get();
+  SingletonInitializer::Wait();
+  EXPECT_EQ(1, g_num_constructed);
+
+  std::vector<SingletonInitializer::Cost> costs;
+  SingletonInitializer::GetCosts(&costs);
+  EXPECT_TRUE(FindCost(costs, "HeavyTable"));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,131 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/io_stats.h"
+
+#include <atomic>
+
+#include "base/clock.h"
+#include "base/logging.h"
+
+namespace mozc {
+namespace {
+
+struct Counters {
+  std::atomic<uint64> read_bytes;
+  std::atomic<uint64> read_count;
+  std::atomic<uint64> write_bytes;
+  std::atomic<uint64> write_count;
+  std::atomic<uint64> sync_count;
+  std::atomic<uint64> time_microseconds;
+};
+
+// Zero-initialized before any dynamic initialization.
+Counters g_counters[IOStats::NUM_COMPONENTS];
+
+const char *kComponentNames[] = {
+  "LRUStorage",
+  "EncryptedStringStorage",
+  "TinyStorage",
+  "UserHistoryStorage",
+  "UserDictionaryStorage",
+  "ConfigFileStream",
+};
+static_assert(arraysize(kComponentNames) == IOStats::NUM_COMPONENTS,
+              "kComponentNames must cover all the components");
+
+}  // namespace
+
+IOStats::ScopedOperation::ScopedOperation(Component component,
+                                          OperationType type)
+    : component_(component), type_(type), start_ticks_(Clock::GetTicks()),
+      bytes_(0) {}
+
+IOStats::ScopedOperation::~ScopedOperation() {
+  const uint64 frequency = Clock::GetFrequency();
+  const uint64 elapsed_ticks = Clock::GetTicks() - start_ticks_;
+  Record(component_, type_, bytes_,
+         frequency == 0 ? 0 : static_cast<uint64>(
+             elapsed_ticks * 1000000.0 / frequency));
+}
+
+void IOStats::Record(Component component, OperationType type, size_t bytes,
+                     uint64 microseconds) {
+  DCHECK_GE(component, 0);
+  DCHECK_LT(component, NUM_COMPONENTS);
+  Counters *counters = &g_counters[component];
+  switch (type) {
+    case READ:
+      counters->read_bytes += bytes;
+      ++counters->read_count;
+      break;
+    case WRITE:
+      counters->write_bytes += bytes;
+      ++counters->write_count;
+      break;
+    case SYNC:
+      counters->write_bytes += bytes;
+      ++counters->sync_count;
+      break;
+  }
+  counters->time_microseconds += microseconds;
+}
+
+void IOStats::GetStats(Component component, Stats *stats) {
+  DCHECK_GE(component, 0);
+  DCHECK_LT(component, NUM_COMPONENTS);
+  DCHECK(stats);
+  const Counters &counters = g_counters[component];
+  stats->read_bytes = counters.read_bytes;
+  stats->read_count = counters.read_count;
+  stats->write_bytes = counters.write_bytes;
+  stats->write_count = counters.write_count;
+  stats->sync_count = counters.sync_count;
+  stats->time_microseconds = counters.time_microseconds;
+}
+
+const char *IOStats::GetComponentName(Component component) {
+  DCHECK_GE(component, 0);
+  DCHECK_LT(component, NUM_COMPONENTS);
+  return kComponentNames[component];
+}
+
+void IOStats::ClearForTest() {
+  for (size_t i = 0; i < NUM_COMPONENTS; ++i) {
+    g_counters[i].read_bytes = 0;
+    g_counters[i].read_count = 0;
+    g_counters[i].write_bytes = 0;
+    g_counters[i].write_count = 0;
+    g_counters[i].sync_count = 0;
+    g_counters[i].time_microseconds = 0;
+  }
+}
+
+}  // namespace mozc
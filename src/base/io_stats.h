@@ -0,0 +1,117 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_IO_STATS_H_
+#define MOZC_BASE_IO_STATS_H_
+
+#include <cstddef>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// Process-wide counters of the file I/O of the storage components, to find
+// the components which read or write too much.  The counters are updated
+// atomically, so they can be recorded from any thread.
+//
+// Each component records its operations at its own level.  For example, the
+// loads of UserHistoryStorage count the bytes of the serialized history, and
+// the reads of the encrypted files under it are also recorded for
+// EncryptedStringStorage.
+class IOStats {
+ public:
+  enum Component {
+    LRU_STORAGE,
+    ENCRYPTED_STRING_STORAGE,
+    TINY_STORAGE,
+    USER_HISTORY_STORAGE,
+    USER_DICTIONARY_STORAGE,
+    CONFIG_FILE_STREAM,
+    NUM_COMPONENTS,
+  };
+
+  enum OperationType {
+    READ,
+    WRITE,
+    // Writes the data back to the disk and waits for it, e.g. msync.  The
+    // bytes are counted as written, but not the number of writes.
+    SYNC,
+  };
+
+  struct Stats {
+    uint64 read_bytes;
+    uint64 read_count;
+    uint64 write_bytes;
+    uint64 write_count;
+    uint64 sync_count;
+    // The time spent in all the operations.
+    uint64 time_microseconds;
+  };
+
+  // Records an operation of a component, which takes the time from the
+  // construction to the destruction of this object.  For example:
+  //   IOStats::ScopedOperation operation(IOStats::TINY_STORAGE,
+  //                                      IOStats::WRITE);
+  //   ... write the data ...
+  //   operation.set_bytes(data.size());
+  class ScopedOperation {
+   public:
+    ScopedOperation(Component component, OperationType type);
+    ~ScopedOperation();
+
+    void set_bytes(size_t bytes) { bytes_ = bytes; }
+
+   private:
+    const Component component_;
+    const OperationType type_;
+    const uint64 start_ticks_;
+    size_t bytes_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedOperation);
+  };
+
+  // Records an operation of |bytes| which took |microseconds|.
+  static void Record(Component component, OperationType type, size_t bytes,
+                     uint64 microseconds);
+
+  static void GetStats(Component component, Stats *stats);
+
+  // Returns the name of |component| in CamelCase, e.g. "LRUStorage".
+  static const char *GetComponentName(Component component);
+
+  static void ClearForTest();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(IOStats);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_IO_STATS_H_
@@ -0,0 +1,107 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/io_stats.h"
+
+#include <string>
+
+#include "base/port.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class IOStatsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    IOStats::ClearForTest();
+  }
+
+  void TearDown() override {
+    IOStats::ClearForTest();
+  }
+};
+
+TEST_F(IOStatsTest, Record) {
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::READ, 100, 10);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::READ, 20, 1);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::WRITE, 50, 5);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::SYNC, 0, 30);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::SYNC, 8, 0);
+
+  IOStats::Stats stats;
+  IOStats::GetStats(IOStats::TINY_STORAGE, &stats);
+  EXPECT_EQ(120, stats.read_bytes);
+  EXPECT_EQ(2, stats.read_count);
+  EXPECT_EQ(58, stats.write_bytes);
+  EXPECT_EQ(1, stats.write_count);
+  EXPECT_EQ(2, stats.sync_count);
+  EXPECT_EQ(46, stats.time_microseconds);
+
+  // The other components are not affected.
+  IOStats::GetStats(IOStats::LRU_STORAGE, &stats);
+  EXPECT_EQ(0, stats.read_bytes);
+  EXPECT_EQ(0, stats.read_count);
+  EXPECT_EQ(0, stats.time_microseconds);
+
+  IOStats::ClearForTest();
+  IOStats::GetStats(IOStats::TINY_STORAGE, &stats);
+  EXPECT_EQ(0, stats.read_bytes);
+  EXPECT_EQ(0, stats.sync_count);
+}
+
+TEST_F(IOStatsTest, ScopedOperation) {
+  {
+    IOStats::ScopedOperation operation(IOStats::CONFIG_FILE_STREAM,
+                                       IOStats::WRITE);
+    operation.set_bytes(1234);
+  }
+  {
+    IOStats::ScopedOperation operation(IOStats::CONFIG_FILE_STREAM,
+                                       IOStats::SYNC);
+  }
+
+  IOStats::Stats stats;
+  IOStats::GetStats(IOStats::CONFIG_FILE_STREAM, &stats);
+  EXPECT_EQ(0, stats.read_count);
+  EXPECT_EQ(1234, stats.write_bytes);
+  EXPECT_EQ(1, stats.write_count);
+  EXPECT_EQ(1, stats.sync_count);
+}
+
+TEST_F(IOStatsTest, GetComponentName) {
+  EXPECT_EQ("LRUStorage",
+            string(IOStats::GetComponentName(IOStats::LRU_STORAGE)));
+  EXPECT_EQ("ConfigFileStream",
+            string(IOStats::GetComponentName(IOStats::CONFIG_FILE_STREAM)));
+}
+
+}  // namespace
+}  // namespace mozc
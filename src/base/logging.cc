@@ -47,9 +47,13 @@
 #endif  // OS_WIN
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <mutex>  // NOLINT
 #include <sstream>
 #include <string>
 
@@ -60,12 +64,15 @@
 #include "base/flags.h"
 #include "base/mutex.h"
 #include "base/singleton.h"
+#include "base/thread.h"
 
 DEFINE_bool(colored_log, true, "Enables colored log messages on tty devices");
 DEFINE_bool(logtostderr,
             false,
             "log messages go to stderr instead of logfiles");
 DEFINE_int32(v, 0, "verbose level");
+DEFINE_bool(async_logging, false,
+            "log messages are written by a background thread");
 
 namespace mozc {
 
@@ -155,6 +162,9 @@ void Logging::InitLogStream(const string &log_file_path) {
 void Logging::CloseLogStream() {
 }
 
+void Logging::FlushLogStream() {
+}
+
 std::ostream &Logging::GetWorkingLogStream() {
   // Never called.
   return *(new std::ostringstream);
@@ -196,6 +206,165 @@ void Logging::SetConfigVerboseLevel(int verboselevel) {
 
 namespace {
 
+// The verbose level set by the config.  This is read for each VLOG, so it is
+// kept out of LogStreamImpl to avoid the lock and the singleton lookup.
+std::atomic<int> g_config_verbose_level(0);
+
+// A bounded queue of log messages with multiple producers and a single
+// consumer.  The producers claim a slot by a CAS on |tail_| and publish it by
+// the sequence number of the slot, so LOG never waits for the file I/O of the
+// consumer.  The algorithm is Dmitry Vyukov's bounded MPMC queue.
+class LogRingBuffer {
+ public:
+  // Must be a power of 2.
+  static const size_t kSize = 1024;
+
+  LogRingBuffer() : head_(0), tail_(0) {
+    for (size_t i = 0; i < kSize; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Moves |log| into the buffer.  Returns false if the buffer is full.
+  bool Push(LogSeverity severity, string *log) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot *slot = &slots_[pos & (kSize - 1)];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot->severity = severity;
+          slot->log.swap(*log);
+          slot->sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Moves the oldest message to |log|.  Returns false if the buffer is empty.
+  // Only the writer thread calls this method.
+  bool Pop(LogSeverity *severity, string *log) {
+    const size_t pos = head_.load(std::memory_order_relaxed);
+    Slot *slot = &slots_[pos & (kSize - 1)];
+    if (slot->sequence.load(std::memory_order_acquire) != pos + 1) {
+      return false;
+    }
+    *severity = slot->severity;
+    log->swap(slot->log);
+    slot->log.clear();
+    slot->sequence.store(pos + kSize, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns true if the oldest message is ready to be popped.
+  bool HasMessage() const {
+    const size_t pos = head_.load(std::memory_order_relaxed);
+    return slots_[pos & (kSize - 1)].sequence.load(
+        std::memory_order_acquire) == pos + 1;
+  }
+
+  // The number of the messages claimed by the producers so far.
+  size_t pushed() const { return tail_.load(std::memory_order_acquire); }
+
+  // The number of the messages taken by the consumer so far.
+  size_t popped() const { return head_.load(std::memory_order_acquire); }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    LogSeverity severity;
+    string log;
+  };
+
+  Slot slots_[kSize];
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogRingBuffer);
+};
+
+class LogStreamImpl;
+
+// Background thread which writes the messages in LogRingBuffer to
+// LogStreamImpl.  The thread blocks while the buffer is empty, and once woken
+// up, waits for kBatchDelay so that a burst of messages costs one wakeup.
+class AsyncLogWriter : public Thread {
+ public:
+  explicit AsyncLogWriter(LogStreamImpl *impl)
+      : impl_(impl), sleeping_(false), quit_(false), num_flush_requests_(0) {}
+
+  // Returns false if the buffer is full, in which case the caller should
+  // write |log| by itself.
+  bool Push(LogSeverity severity, string *log) {
+    if (!buffer_.Push(severity, log)) {
+      return false;
+    }
+    // Pairs with the fence in Run() so that either the writer sees the
+    // message or this thread sees |sleeping_|.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) ||
+        buffer_.pushed() - buffer_.popped() == LogRingBuffer::kSize / 2) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.notify_one();
+    }
+    return true;
+  }
+
+  // Waits until the messages pushed before this call are written.
+  void Flush() {
+    const size_t target = buffer_.pushed();
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++num_flush_requests_;
+    wake_.notify_one();
+    flushed_.wait(lock, [this, target] {
+      return buffer_.popped() >= target || !IsRunning();
+    });
+    --num_flush_requests_;
+  }
+
+  void Stop() {
+    if (!IsRunning()) {
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      quit_ = true;
+      wake_.notify_one();
+    }
+    Join();
+    quit_ = false;
+  }
+
+  void Run() override;
+
+ private:
+  static const std::chrono::milliseconds kBatchDelay;
+
+  LogStreamImpl *impl_;
+  LogRingBuffer buffer_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  // True while the writer waits for a message, so that Push() takes
+  // |mutex_| to wake it up only if needed.
+  std::atomic<bool> sleeping_;
+  bool quit_;
+  int num_flush_requests_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogWriter);
+};
+
+const std::chrono::milliseconds AsyncLogWriter::kBatchDelay(1);
+
 class LogStreamImpl {
  public:
   LogStreamImpl();
@@ -203,9 +372,16 @@ class LogStreamImpl {
 
   void Init(const string &log_file_path);
   void Reset();
+  void Close();
 
-  int verbose_level() const {
-    return max(FLAGS_v, config_verbose_level_);
+  void Flush() {
+    if (async_.load(std::memory_order_acquire)) {
+      writer_.Flush();
+    }
+    scoped_lock l(&mutex_);
+    if (real_log_stream_) {
+      real_log_stream_->flush();
+    }
   }
 
   void set_verbose_level(int level) {
@@ -214,28 +390,74 @@ class LogStreamImpl {
   }
 
   void set_config_verbose_level(int level) {
-    scoped_lock l(&mutex_);
-    config_verbose_level_ = level;
+    g_config_verbose_level.store(level, std::memory_order_relaxed);
   }
 
   bool support_color() const {
     return support_color_;
   }
 
-  void Write(LogSeverity, const string &log);
+  // Queues |log| for the writer thread if --async_logging is enabled.
+  // Otherwise, or if the queue is full, writes |log| synchronously.
+  void Write(LogSeverity, string *log);
+
+  // Writes |log| to the real log stream.
+  void WriteSync(LogSeverity, const string &log);
 
  private:
   // Real backing log stream.
   // This is not thread-safe so must be guarded.
   // If std::cerr is real log stream, this is nullptr.
   std::ostream *real_log_stream_;
-  int config_verbose_level_;
   bool support_color_;
   bool use_cerr_;
   Mutex mutex_;
+  std::atomic<bool> async_;
+  AsyncLogWriter writer_;
 };
 
-void LogStreamImpl::Write(LogSeverity severity, const string &log) {
+void AsyncLogWriter::Run() {
+  LogSeverity severity;
+  string log;
+  while (true) {
+    while (buffer_.Pop(&severity, &log)) {
+      impl_->WriteSync(severity, log);
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_.notify_all();
+    if (buffer_.HasMessage()) {
+      continue;
+    }
+    if (quit_) {
+      return;
+    }
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake_.wait(lock, [this] {
+      return quit_ || num_flush_requests_ > 0 || buffer_.HasMessage();
+    });
+    sleeping_.store(false, std::memory_order_relaxed);
+    wake_.wait_for(lock, kBatchDelay, [this] {
+      return quit_ || num_flush_requests_ > 0 ||
+          buffer_.pushed() - buffer_.popped() >= LogRingBuffer::kSize / 2;
+    });
+  }
+}
+
+void LogStreamImpl::Write(LogSeverity severity, string *log) {
+  if (async_.load(std::memory_order_acquire)) {
+    if (severity >= LOG_FATAL) {
+      // The process exits right after a fatal message, so write the queued
+      // messages and the fatal message here.
+      writer_.Flush();
+    } else if (writer_.Push(severity, log)) {
+      return;
+    }
+  }
+  WriteSync(severity, *log);
+}
+
+void LogStreamImpl::WriteSync(LogSeverity severity, const string &log) {
   scoped_lock l(&mutex_);
   if (use_cerr_) {
     std::cerr << log;
@@ -256,7 +478,8 @@ void LogStreamImpl::Write(LogSeverity severity, const string &log) {
   }
 }
 
-LogStreamImpl::LogStreamImpl() : real_log_stream_(nullptr) {
+LogStreamImpl::LogStreamImpl()
+    : real_log_stream_(nullptr), async_(false), writer_(this) {
   Reset();
 }
 
@@ -268,9 +491,16 @@ LogStreamImpl::LogStreamImpl() : real_log_stream_(nullptr) {
 // Others,  true  => true,  nullptr
 // Others,  false => true,  non-null
 void LogStreamImpl::Init(const string &log_file_path) {
+  // The writer thread takes |mutex_|, so stop it before taking the lock.
+  Close();
   scoped_lock l(&mutex_);
   Reset();
 
+  if (FLAGS_async_logging) {
+    writer_.Start("AsyncLogWriter");
+    async_.store(writer_.IsRunning(), std::memory_order_release);
+  }
+
   if (use_cerr_) {
     // OS_NACL always reaches here.
     return;
@@ -295,11 +525,19 @@ void LogStreamImpl::Init(const string &log_file_path) {
   DCHECK(!use_cerr_ || !real_log_stream_);
 }
 
+// Writes the queued messages and closes the real log stream.
+void LogStreamImpl::Close() {
+  if (async_.exchange(false, std::memory_order_acq_rel)) {
+    writer_.Stop();
+  }
+  Reset();
+}
+
 void LogStreamImpl::Reset() {
   scoped_lock l(&mutex_);
   delete real_log_stream_;
   real_log_stream_ = nullptr;
-  config_verbose_level_ = 0;
+  g_config_verbose_level.store(0, std::memory_order_relaxed);
 #if defined(OS_NACL)
     // In NaCl, we only use stderr to output logs.
     use_cerr_ = true;
@@ -322,7 +560,7 @@ void LogStreamImpl::Reset() {
 }
 
 LogStreamImpl::~LogStreamImpl() {
-  Reset();
+  Close();
 }
 }  // namespace
 
@@ -334,7 +572,11 @@ void Logging::InitLogStream(const string &log_file_path) {
 }
 
 void Logging::CloseLogStream() {
-  Singleton<LogStreamImpl>::get()->Reset();
+  Singleton<LogStreamImpl>::get()->Close();
+}
+
+void Logging::FlushLogStream() {
+  Singleton<LogStreamImpl>::get()->Flush();
 }
 
 std::ostream &Logging::GetWorkingLogStream() {
@@ -344,8 +586,8 @@ std::ostream &Logging::GetWorkingLogStream() {
 void Logging::FinalizeWorkingLogStream(LogSeverity severity,
                                        std::ostream *working_stream) {
   *working_stream << std::endl;
-  Singleton<LogStreamImpl>::get()->Write(
-      severity, static_cast<std::ostringstream*>(working_stream)->str());
+  string log = static_cast<std::ostringstream*>(working_stream)->str();
+  Singleton<LogStreamImpl>::get()->Write(severity, &log);
   // The working stream is new'd in LogStreamImpl::GetWorkingLogStream().
   // Must be deleted by finalizer.
   delete working_stream;
@@ -411,7 +653,7 @@ const char *Logging::GetEndColorEscapeSequence() {
 }
 
 int Logging::GetVerboseLevel() {
-  return Singleton<LogStreamImpl>::get()->verbose_level();
+  return max(FLAGS_v, g_config_verbose_level.load(std::memory_order_relaxed));
 }
 
 void Logging::SetVerboseLevel(int verboselevel) {
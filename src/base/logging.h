@@ -78,11 +78,18 @@ class NullLogStream;
 class Logging {
  public:
   // Initializes log stream with the output file path and --logtostderr.
+  // With --async_logging, the messages are queued to a ring buffer and
+  // written by a background thread, so that the callers don't wait for the
+  // file I/O.
   static void InitLogStream(const string &log_file_path);
 
   // Closes the logging stream
   static void CloseLogStream();
 
+  // Waits until the messages queued for the background writer are written,
+  // and flushes the real log stream.
+  static void FlushLogStream();
+
   // Gets working log stream. The log message can be written to the stream.
   // The stream must be finalized by FinalizeWorkingLogStream().
   static std::ostream &GetWorkingLogStream();
@@ -103,7 +110,8 @@ class Logging {
   // Returns "YYYY-MM-DD HH:MM:SS PID TID", e.g. "2008 11-16 19:40:21 100 20"
   static string GetLogMessageHeader();
 
-  // Returns FLAGS_v
+  // Returns max(FLAGS_v, config_verbose_level).  This is called for each
+  // VLOG, so it doesn't take a lock.
   static int GetVerboseLevel();
 
   // Sets FLAGS_v
@@ -229,6 +237,8 @@ class NullLogFinalizer {
   << " [" << #condition << "] "
 #endif  // end NO_LOGGING
 
+// The right hand side of VLOG, e.g. DebugString(), is evaluated only when
+// VLOG_IS_ON(verboselevel) holds, so VLOG costs a comparison when disabled.
 #define VLOG_IS_ON(verboselevel) \
 (mozc::Logging::GetVerboseLevel() >= verboselevel)
 
@@ -281,6 +291,7 @@ class NullLogFinalizer {
 #define DVLOG(verboselevel) DLOG_IF(INFO, VLOG_IS_ON(verboselevel))
 
 DECLARE_bool(logtostderr);
+DECLARE_bool(async_logging);
 
 
 #define DVLOG_IF(verboselevel, condition) \
@@ -0,0 +1,119 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the cost of the disabled VLOG with an expensive right hand side,
+// and the cost of LOG(INFO) written synchronously and by the background
+// writer of --async_logging.
+//
+// Usage:
+//   logging_benchmark_main --log_file=/tmp/logging_benchmark.log
+
+#include <iostream>  // NOLINT
+#include <string>
+
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+
+DEFINE_string(log_file, "/tmp/logging_benchmark.log",
+              "file to which the messages are written");
+DEFINE_int32(iterations, 100000, "number of the messages");
+
+namespace mozc {
+namespace {
+
+int g_num_debug_strings = 0;
+
+// Stands for Lattice::DebugString() and the like.
+string ExpensiveDebugString(int i) {
+  ++g_num_debug_strings;
+  string result;
+  for (int j = 0; j < 100; ++j) {
+    result.append(1, static_cast<char>('a' + (i + j) % 26));
+  }
+  return result;
+}
+
+template <typename Func>
+void Measure(const string &name, Func func) {
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    func(i);
+  }
+  stopwatch.Stop();
+  const double ns_per_message =
+      stopwatch.GetElapsedNanoseconds() /
+      static_cast<double>(FLAGS_iterations);
+  std::cout << "  " << name << ": " << ns_per_message << " ns/message"
+            << std::endl;
+}
+
+void MeasureLogging(const string &name) {
+  Measure(name, [](int i) {
+    LOG(INFO) << "message " << i;
+  });
+  // The time to drain the queue is not hidden from the total.
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  Logging::FlushLogStream();
+  stopwatch.Stop();
+  std::cout << "  " << name << " flush: "
+            << stopwatch.GetElapsedMilliseconds() << " ms" << std::endl;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  FLAGS_logtostderr = false;
+
+  mozc::Logging::SetVerboseLevel(0);
+  mozc::g_num_debug_strings = 0;
+  mozc::Measure("disabled VLOG", [](int i) {
+    VLOG(2) << mozc::ExpensiveDebugString(i);
+  });
+  std::cout << "  debug strings built: " << mozc::g_num_debug_strings
+            << std::endl;
+
+  FLAGS_async_logging = false;
+  mozc::Logging::InitLogStream(FLAGS_log_file);
+  mozc::MeasureLogging("sync LOG(INFO)");
+
+  FLAGS_async_logging = true;
+  mozc::Logging::InitLogStream(FLAGS_log_file);
+  mozc::MeasureLogging("async LOG(INFO)");
+
+  mozc::Logging::CloseLogStream();
+  mozc::FileUtil::Unlink(FLAGS_log_file);
+  return 0;
+}
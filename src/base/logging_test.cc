@@ -29,8 +29,12 @@
 
 #include "base/logging.h"
 
+#include <fstream>
 #include <sstream>
+#include <string>
 
+#include "base/file_util.h"
+#include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -215,5 +219,74 @@ TEST(LoggingTest, RightHandSideEvaluation) {
   EXPECT_EQ(0, g_counter);
 }
 
+TEST(LoggingTest, VerboseLevelSkipsRightHandSide) {
+  const int original_level = Logging::GetVerboseLevel();
+
+  Logging::SetVerboseLevel(0);
+  g_counter = 0;
+  VLOG(1) << "test: " << DebugString();
+  VLOG(2) << "test: " << DebugString();
+  VLOG_IF(1, true) << "test: " << DebugString();
+  EXPECT_EQ(0, g_counter);
+
+  Logging::SetVerboseLevel(1);
+  g_counter = 0;
+  VLOG(1) << "test: " << DebugString();
+  VLOG(2) << "test: " << DebugString();
+#ifdef NO_LOGGING
+  EXPECT_EQ(0, g_counter);
+#else
+  EXPECT_EQ(1, g_counter);
+#endif
+
+  Logging::SetVerboseLevel(original_level);
+}
+
+#ifndef NO_LOGGING
+TEST(LoggingTest, AsyncLogging) {
+  const string log_path =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "async_logging_test.log");
+  FileUtil::Unlink(log_path);
+  const bool original_logtostderr = FLAGS_logtostderr;
+  FLAGS_logtostderr = false;
+  FLAGS_async_logging = true;
+  Logging::InitLogStream(log_path);
+
+  // More messages than the ring buffer holds, so some of them are written
+  // synchronously.
+  const int kNumMessages = 5000;
+  for (int i = 0; i < kNumMessages; ++i) {
+    LOG(INFO) << "async message " << i;
+  }
+  Logging::FlushLogStream();
+
+  int num_lines = 0;
+  {
+    std::ifstream ifs(log_path.c_str());
+    string line;
+    while (std::getline(ifs, line)) {
+      if (line.find("async message ") != string::npos) {
+        ++num_lines;
+      }
+    }
+  }
+  EXPECT_EQ(kNumMessages, num_lines);
+
+  // The messages logged after flushing are written when closing.
+  LOG(INFO) << "last async message";
+  Logging::CloseLogStream();
+  {
+    std::ifstream ifs(log_path.c_str());
+    const string content((std::istreambuf_iterator<char>(ifs)),
+                         std::istreambuf_iterator<char>());
+    EXPECT_NE(string::npos, content.find("last async message"));
+  }
+
+  FLAGS_async_logging = false;
+  FLAGS_logtostderr = original_logtostderr;
+  FileUtil::Unlink(log_path);
+}
+#endif  // NO_LOGGING
+
 }  // namespace
 }  // namespace mozc
@@ -0,0 +1,183 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/memory_stats.h"
+
+#if !defined(OS_WIN) && !defined(OS_NACL)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // !OS_WIN && !OS_NACL
+
+#include <map>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/logging.h"
+
+namespace mozc {
+namespace {
+
+#if !defined(OS_WIN) && !defined(OS_NACL)
+size_t GetPageSize() {
+  static const size_t kPageSize = getpagesize();
+  return kPageSize;
+}
+#endif  // !OS_WIN && !OS_NACL
+
+}  // namespace
+
+// static
+MemoryStats::Usage MemoryStats::HeapUsage(StringPiece component, size_t bytes,
+                                          size_t count) {
+  Usage usage;
+  component.CopyToString(&usage.component);
+  usage.virtual_bytes = bytes;
+  usage.resident_bytes = bytes;
+  usage.count = count;
+  return usage;
+}
+
+// static
+MemoryStats::Usage MemoryStats::MappedUsage(StringPiece component,
+                                            const void *data, size_t size) {
+  Usage usage;
+  component.CopyToString(&usage.component);
+  usage.virtual_bytes = size;
+  usage.resident_bytes = GetResidentBytes(data, size);
+  usage.shared_bytes = usage.resident_bytes;
+  return usage;
+}
+
+// static
+size_t MemoryStats::GetHeapBytes(const string &str) {
+  const char *object = reinterpret_cast<const char *>(&str);
+  if (str.data() >= object && str.data() < object + sizeof(str)) {
+    return 0;
+  }
+  return str.capacity() + 1;
+}
+
+#if !defined(OS_WIN) && !defined(OS_NACL)
+// static
+size_t MemoryStats::GetResidentBytes(const void *data, size_t size) {
+  if (data == nullptr || size == 0) {
+    return 0;
+  }
+  // mincore() requires the page aligned address.  The pages at both ends are
+  // counted as a whole, so the result may exceed |size|.
+  const size_t page_size = GetPageSize();
+  const uintptr_t begin =
+      reinterpret_cast<uintptr_t>(data) & ~(page_size - 1);
+  const uintptr_t end = reinterpret_cast<uintptr_t>(data) + size;
+  const size_t num_pages = (end - begin + page_size - 1) / page_size;
+#ifdef OS_MACOSX
+  std::vector<char> pages(num_pages);
+#else  // OS_MACOSX
+  std::vector<unsigned char> pages(num_pages);
+#endif  // OS_MACOSX
+  if (mincore(reinterpret_cast<void *>(begin), end - begin,
+              pages.data()) != 0) {
+    VLOG(1) << "mincore() failed for " << size << " bytes";
+    return 0;
+  }
+  size_t num_resident_pages = 0;
+  for (size_t i = 0; i < num_pages; ++i) {
+    num_resident_pages += pages[i] & 1;
+  }
+  return num_resident_pages * page_size;
+}
+#else  // !OS_WIN && !OS_NACL
+// static
+size_t MemoryStats::GetResidentBytes(const void *data, size_t size) {
+  return 0;
+}
+#endif  // !OS_WIN && !OS_NACL
+
+#if defined(OS_LINUX) && !defined(OS_NACL)
+// static
+bool MemoryStats::GetProcessUsage(Usage *usage) {
+  DCHECK(usage);
+  // The first three fields are the total, resident and shared (file backed)
+  // pages.
+  InputFileStream ifs("/proc/self/statm");
+  uint64 total_pages = 0, resident_pages = 0, shared_pages = 0;
+  if (!(ifs >> total_pages >> resident_pages >> shared_pages)) {
+    return false;
+  }
+  const size_t page_size = GetPageSize();
+  *usage = Usage();
+  usage->component = "process";
+  usage->virtual_bytes = total_pages * page_size;
+  usage->resident_bytes = resident_pages * page_size;
+  usage->shared_bytes = shared_pages * page_size;
+  return true;
+}
+#else  // OS_LINUX && !OS_NACL
+// static
+bool MemoryStats::GetProcessUsage(Usage *usage) {
+  return false;
+}
+#endif  // OS_LINUX && !OS_NACL
+
+// static
+void MemoryStats::Merge(std::vector<Usage> *usages) {
+  DCHECK(usages);
+  std::map<string, size_t> indices;
+  size_t size = 0;
+  for (size_t i = 0; i < usages->size(); ++i) {
+    const Usage &usage = (*usages)[i];
+    const auto inserted = indices.insert(std::make_pair(usage.component, size));
+    if (inserted.second) {
+      (*usages)[size++] = usage;
+      continue;
+    }
+    Usage *merged = &(*usages)[inserted.first->second];
+    merged->virtual_bytes += usage.virtual_bytes;
+    merged->resident_bytes += usage.resident_bytes;
+    merged->shared_bytes += usage.shared_bytes;
+    merged->count += usage.count;
+  }
+  usages->resize(size);
+}
+
+// static
+void MemoryStats::Write(const std::vector<Usage> &usages, std::ostream *os) {
+  DCHECK(os);
+  *os << "# component\tvirtual_bytes\tresident_bytes\tshared_bytes\tcount"
+      << std::endl;
+  for (size_t i = 0; i < usages.size(); ++i) {
+    const Usage &usage = usages[i];
+    *os << usage.component << '\t' << usage.virtual_bytes << '\t'
+        << usage.resident_bytes << '\t' << usage.shared_bytes << '\t'
+        << usage.count << '\n';
+  }
+  os->flush();
+}
+
+}  // namespace mozc
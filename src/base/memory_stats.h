@@ -0,0 +1,111 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_MEMORY_STATS_H_
+#define MOZC_BASE_MEMORY_STATS_H_
+
+#include <cstddef>
+#include <ostream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+// A breakdown of the memory of the process by component, to see which one
+// makes the server large.  The components append their usages to a list with
+// CollectMemoryUsage() methods, e.g. EngineInterface::CollectMemoryUsage().
+//
+// The usages are estimates.  The heap of a component is the capacity of its
+// containers and strings, which is counted as resident since it's usually
+// touched, and doesn't include the overhead of the allocator.  The usage of
+// a mapped region is measured with mincore(), where it's supported.
+class MemoryStats {
+ public:
+  struct Usage {
+    Usage() : virtual_bytes(0), resident_bytes(0), shared_bytes(0), count(0) {}
+
+    // The name of the component, e.g. "dataset:conn" or "user_history".
+    string component;
+    // Bytes of the address space reserved for the component.
+    uint64 virtual_bytes;
+    // Bytes of |virtual_bytes| currently in physical memory.
+    uint64 resident_bytes;
+    // Bytes of |resident_bytes| shared with other processes.  For the mapped
+    // regions measured with mincore(), all the resident pages are counted as
+    // they are clean pages of the files, which can be shared.
+    uint64 shared_bytes;
+    // The number of the items, e.g. entries or sessions, if applicable.
+    uint64 count;
+  };
+
+  // Returns the usage of |bytes| allocated in the heap for |count| items.
+  static Usage HeapUsage(StringPiece component, size_t bytes, size_t count);
+
+  // Returns the usage of the region [data, data + size) of a file mapped
+  // read only, whose resident pages are counted as shared.
+  static Usage MappedUsage(StringPiece component, const void *data,
+                           size_t size);
+
+  // Returns the bytes allocated in heap by |str|, not including the object
+  // itself.  It's 0 for a short string stored in the object.
+  static size_t GetHeapBytes(const string &str);
+
+  // Returns the bytes allocated in heap by |vec| for its elements, not
+  // including the memory owned by the elements.
+  template <typename T>
+  static size_t GetHeapBytes(const std::vector<T> &vec) {
+    return vec.capacity() * sizeof(T);
+  }
+
+  // Returns the bytes of the pages in physical memory which the region
+  // [data, data + size) spans.  Returns 0 if it's not supported on the
+  // platform.
+  static size_t GetResidentBytes(const void *data, size_t size);
+
+  // Fills the total of the process as the component "process".  Currently
+  // supported only on Linux, where it's read from /proc/self/statm.
+  static bool GetProcessUsage(Usage *usage);
+
+  // Sums up the usages of the same component into the first one, keeping the
+  // order of the others.
+  static void Merge(std::vector<Usage> *usages);
+
+  // Writes |usages| as tab separated values with a header line.
+  static void Write(const std::vector<Usage> &usages, std::ostream *os);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(MemoryStats);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_MEMORY_STATS_H_
@@ -0,0 +1,118 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/memory_stats.h"
+
+#if defined(OS_LINUX) && !defined(OS_NACL)
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_NACL
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(MemoryStatsTest, HeapUsage) {
+  const MemoryStats::Usage usage = MemoryStats::HeapUsage("heap", 100, 3);
+  EXPECT_EQ("heap", usage.component);
+  EXPECT_EQ(100, usage.virtual_bytes);
+  EXPECT_EQ(100, usage.resident_bytes);
+  EXPECT_EQ(0, usage.shared_bytes);
+  EXPECT_EQ(3, usage.count);
+}
+
+TEST(MemoryStatsTest, GetHeapBytes) {
+  const string long_string(1000, 'a');
+  EXPECT_LT(1000, MemoryStats::GetHeapBytes(long_string));
+  string empty_string;
+  EXPECT_GE(empty_string.capacity() + 1,
+            MemoryStats::GetHeapBytes(empty_string));
+}
+
+TEST(MemoryStatsTest, GetResidentBytes) {
+  EXPECT_EQ(0, MemoryStats::GetResidentBytes(nullptr, 0));
+#if defined(OS_LINUX) && !defined(OS_NACL)
+  // The touched buffer is in physical memory.
+  const size_t kSize = 1 << 20;
+  std::unique_ptr<char[]> buffer(new char[kSize]);
+  for (size_t i = 0; i < kSize; ++i) {
+    buffer[i] = static_cast<char>(i);
+  }
+  const size_t resident = MemoryStats::GetResidentBytes(buffer.get(), kSize);
+  EXPECT_LE(kSize, resident);
+  EXPECT_GT(kSize + 2 * getpagesize(), resident);
+
+  const MemoryStats::Usage usage =
+      MemoryStats::MappedUsage("mapped", buffer.get(), kSize);
+  EXPECT_EQ(kSize, usage.virtual_bytes);
+  EXPECT_EQ(resident, usage.resident_bytes);
+  EXPECT_EQ(resident, usage.shared_bytes);
+#endif  // OS_LINUX && !OS_NACL
+}
+
+#if defined(OS_LINUX) && !defined(OS_NACL)
+TEST(MemoryStatsTest, GetProcessUsage) {
+  MemoryStats::Usage usage;
+  ASSERT_TRUE(MemoryStats::GetProcessUsage(&usage));
+  EXPECT_EQ("process", usage.component);
+  EXPECT_LT(0, usage.resident_bytes);
+  EXPECT_LE(usage.resident_bytes, usage.virtual_bytes);
+  EXPECT_LE(usage.shared_bytes, usage.resident_bytes);
+}
+#endif  // OS_LINUX && !OS_NACL
+
+TEST(MemoryStatsTest, MergeAndWrite) {
+  std::vector<MemoryStats::Usage> usages;
+  usages.push_back(MemoryStats::HeapUsage("segments", 10, 1));
+  usages.push_back(MemoryStats::HeapUsage("candidate_list", 20, 2));
+  usages.push_back(MemoryStats::HeapUsage("segments", 30, 4));
+  MemoryStats::Merge(&usages);
+  ASSERT_EQ(2, usages.size());
+  EXPECT_EQ("segments", usages[0].component);
+  EXPECT_EQ(40, usages[0].virtual_bytes);
+  EXPECT_EQ(40, usages[0].resident_bytes);
+  EXPECT_EQ(5, usages[0].count);
+  EXPECT_EQ("candidate_list", usages[1].component);
+  EXPECT_EQ(20, usages[1].virtual_bytes);
+
+  std::ostringstream os;
+  MemoryStats::Write(usages, &os);
+  EXPECT_EQ("# component\tvirtual_bytes\tresident_bytes\tshared_bytes\tcount\n"
+            "segments\t40\t40\t0\t5\n"
+            "candidate_list\t20\t20\t0\t2\n",
+            os.str());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -40,8 +40,11 @@
 #include <unistd.h>
 #endif  // OS_WIN
 
+#include <cstdlib>
 #include <cstring>
+#include <string>
 
+#include "base/file_stream.h"
 #include "base/port.h"
 #include "base/logging.h"
 #include "base/util.h"
@@ -56,6 +59,38 @@
 
 namespace mozc {
 
+#if !defined(OS_WIN) && !defined(OS_NACL)
+namespace {
+
+// Returns the range of the pages which [addr, addr + len) spans, since
+// madvise() and msync() require a page aligned address.
+void GetPageRange(const void *addr, size_t len, void **aligned_addr,
+                  size_t *aligned_len) {
+  const uintptr_t page_size = ::sysconf(_SC_PAGESIZE);
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t aligned_begin = begin & ~(page_size - 1);
+  *aligned_addr = reinterpret_cast<void *>(aligned_begin);
+  *aligned_len = len + (begin - aligned_begin);
+}
+
+int GetMAdviceForPattern(Mmap::AccessPattern pattern) {
+  switch (pattern) {
+    case Mmap::RANDOM_ACCESS:
+      return MADV_RANDOM;
+    case Mmap::SEQUENTIAL_ACCESS:
+      return MADV_SEQUENTIAL;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+}  // namespace
+#endif  // !defined(OS_WIN) && !defined(OS_NACL)
+
+bool Mmap::Open(const char *filename, const char *mode) {
+  return Open(filename, mode, NORMAL_ACCESS);
+}
+
 #ifndef MOZC_USE_PEPPER_FILE_IO
 
 Mmap::Mmap() : text_(NULL), size_(0) {
@@ -63,7 +98,8 @@ Mmap::Mmap() : text_(NULL), size_(0) {
 
 #ifdef OS_WIN
 
-bool Mmap::Open(const char *filename, const char *mode) {
+bool Mmap::Open(const char *filename, const char *mode,
+                AccessPattern pattern) {
   Close();
   uint32 mode1, mode2, mode3, mode4;
   if (strcmp(mode, "r") == 0) {
@@ -86,9 +122,15 @@ bool Mmap::Open(const char *filename, const char *mode) {
     return false;
   }
 
+  DWORD flags = FILE_ATTRIBUTE_NORMAL;
+  if (pattern == RANDOM_ACCESS) {
+    flags |= FILE_FLAG_RANDOM_ACCESS;
+  } else if (pattern == SEQUENTIAL_ACCESS) {
+    flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+  }
   ScopedHandle handle(
       ::CreateFileW(filename_wide.c_str(), mode1, mode4,
-                    0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0));
+                    0, OPEN_EXISTING, flags, 0));
   if (handle.get() == NULL) {
     LOG(ERROR) << "CreateFile() failed: " << filename;
     return false;
@@ -143,7 +185,8 @@ class ScopedCloser {
 };
 }  // namespace
 
-bool Mmap::Open(const char *filename, const char *mode) {
+bool Mmap::Open(const char *filename, const char *mode,
+                AccessPattern pattern) {
   Close();
 
   int flag;
@@ -169,6 +212,14 @@ bool Mmap::Open(const char *filename, const char *mode) {
     return false;
   }
 
+#if defined(OS_LINUX) && !defined(OS_NACL)
+  if (pattern != NORMAL_ACCESS) {
+    ::posix_fadvise(fd, 0, 0,
+                    pattern == RANDOM_ACCESS ? POSIX_FADV_RANDOM
+                                             : POSIX_FADV_SEQUENTIAL);
+  }
+#endif  // defined(OS_LINUX) && !defined(OS_NACL)
+
   int prot = PROT_READ;
   if (flag == O_RDWR) {
     prot |= PROT_WRITE;
@@ -179,6 +230,11 @@ bool Mmap::Open(const char *filename, const char *mode) {
     LOG(WARNING) << "mmap() failed: " << filename;
     return false;
   }
+#ifndef OS_NACL
+  if (pattern != NORMAL_ACCESS) {
+    ::madvise(ptr, st.st_size, GetMAdviceForPattern(pattern));
+  }
+#endif  // OS_NACL
 
   MaybeMLock(ptr, size_);
   text_ = reinterpret_cast<char *>(ptr);
@@ -202,7 +258,9 @@ void Mmap::Close() {
 Mmap::Mmap() : write_mode_(false), size_(0) {
 }
 
-bool Mmap::Open(const char *filename, const char *mode) {
+// The data are read into memory, so |pattern| doesn't matter.
+bool Mmap::Open(const char *filename, const char *mode,
+                AccessPattern pattern) {
   Close();
 
   if (strcmp(mode, "r") == 0) {
@@ -255,6 +313,69 @@ bool Mmap::SyncToFile() {
 }
 #endif  // MOZC_USE_PEPPER_FILE_IO
 
+#if defined(OS_LINUX) && !defined(OS_NACL)
+namespace {
+
+// Parses a "<name>: <value> kB" line of /proc/self/smaps.
+bool ParseSmapsField(const string &line, StringPiece name, size_t *bytes) {
+  if (!Util::StartsWith(line, name)) {
+    return false;
+  }
+  *bytes = strtoull(line.c_str() + name.size(), NULL, 10) * 1024;
+  return true;
+}
+
+}  // namespace
+
+bool Mmap::GetMemoryUsage(MemoryUsage *usage) const {
+  if (text_ == NULL) {
+    return false;
+  }
+  InputFileStream ifs("/proc/self/smaps");
+  if (!ifs) {
+    return false;
+  }
+  usage->resident_bytes = 0;
+  usage->shared_bytes = 0;
+  usage->anonymous_bytes = 0;
+
+  // Each mapping starts with a "<start>-<end> <perms> ..." line followed by
+  // "<name>: <value> kB" lines.  The region may be split into several
+  // mappings (e.g., after madvise() on a part of it), so sum all of them.
+  const uint64 begin = reinterpret_cast<uintptr_t>(text_);
+  const uint64 end = begin + size_;
+  bool found = false;
+  bool in_region = false;
+  string line;
+  while (getline(ifs, line)) {
+    char *rest = NULL;
+    const uint64 start = strtoull(line.c_str(), &rest, 16);
+    if (rest != line.c_str() && *rest == '-') {
+      in_region = (begin <= start && start < end);
+      found |= in_region;
+      continue;
+    }
+    if (!in_region) {
+      continue;
+    }
+    size_t bytes = 0;
+    if (ParseSmapsField(line, "Rss:", &bytes)) {
+      usage->resident_bytes += bytes;
+    } else if (ParseSmapsField(line, "Shared_Clean:", &bytes) ||
+               ParseSmapsField(line, "Shared_Dirty:", &bytes)) {
+      usage->shared_bytes += bytes;
+    } else if (ParseSmapsField(line, "Anonymous:", &bytes)) {
+      usage->anonymous_bytes += bytes;
+    }
+  }
+  return found;
+}
+#else  // defined(OS_LINUX) && !defined(OS_NACL)
+bool Mmap::GetMemoryUsage(MemoryUsage *usage) const {
+  return false;
+}
+#endif  // defined(OS_LINUX) && !defined(OS_NACL)
+
 // Define a macro (MOZC_HAVE_MLOCK) to indicate mlock support.
 #if defined(OS_WIN) || defined(OS_ANDROID) || defined(OS_NACL)
 # define MOZC_HAVE_MLOCK 0
@@ -298,4 +419,96 @@ int Mmap::MaybeMUnlock(const void *addr, size_t len) {
 
 #undef MOZC_HAVE_MLOCK
 
+#if defined(OS_NACL)
+bool Mmap::MaybePrefetch(const void *addr, size_t len) {
+  return false;
+}
+
+bool Mmap::MaybeAdvise(const void *addr, size_t len, AccessPattern pattern) {
+  return false;
+}
+#elif defined(OS_WIN)
+bool Mmap::MaybePrefetch(const void *addr, size_t len) {
+  // PrefetchVirtualMemory() and WIN32_MEMORY_RANGE_ENTRY are available only
+  // on Windows 8 or later.
+  struct MemoryRangeEntry {
+    PVOID virtual_address;
+    SIZE_T number_of_bytes;
+  };
+  typedef BOOL (WINAPI *PrefetchVirtualMemoryFunc)(
+      HANDLE process, ULONG_PTR number_of_entries,
+      MemoryRangeEntry *virtual_addresses, ULONG flags);
+  static const PrefetchVirtualMemoryFunc prefetch_virtual_memory =
+      reinterpret_cast<PrefetchVirtualMemoryFunc>(::GetProcAddress(
+          ::GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory"));
+  if (prefetch_virtual_memory == NULL) {
+    return false;
+  }
+  MemoryRangeEntry entry = {const_cast<void *>(addr), len};
+  return prefetch_virtual_memory(::GetCurrentProcess(), 1, &entry, 0) != 0;
+}
+
+bool Mmap::MaybeAdvise(const void *addr, size_t len, AccessPattern pattern) {
+  return false;
+}
+#else  // defined(OS_NACL)
+bool Mmap::MaybePrefetch(const void *addr, size_t len) {
+  void *aligned_addr = NULL;
+  size_t aligned_len = 0;
+  GetPageRange(addr, len, &aligned_addr, &aligned_len);
+  return ::madvise(aligned_addr, aligned_len, MADV_WILLNEED) == 0;
+}
+
+bool Mmap::MaybeAdvise(const void *addr, size_t len, AccessPattern pattern) {
+  void *aligned_addr = NULL;
+  size_t aligned_len = 0;
+  GetPageRange(addr, len, &aligned_addr, &aligned_len);
+  return ::madvise(aligned_addr, aligned_len,
+                   GetMAdviceForPattern(pattern)) == 0;
+}
+#endif  // defined(OS_NACL)
+
+#if defined(OS_LINUX) && !defined(OS_NACL) && defined(MADV_HUGEPAGE)
+bool Mmap::MaybeUseHugePages(const void *addr, size_t len) {
+  void *aligned_addr = NULL;
+  size_t aligned_len = 0;
+  GetPageRange(addr, len, &aligned_addr, &aligned_len);
+  return ::madvise(aligned_addr, aligned_len, MADV_HUGEPAGE) == 0;
+}
+#else  // defined(OS_LINUX) && !defined(OS_NACL) && defined(MADV_HUGEPAGE)
+bool Mmap::MaybeUseHugePages(const void *addr, size_t len) {
+  return false;
+}
+#endif  // defined(OS_LINUX) && !defined(OS_NACL) && defined(MADV_HUGEPAGE)
+
+#if defined(OS_NACL) || defined(OS_WIN)
+bool Mmap::MaybeRelease(const void *addr, size_t len) {
+  return false;
+}
+#else  // defined(OS_NACL) || defined(OS_WIN)
+bool Mmap::MaybeRelease(const void *addr, size_t len) {
+  void *aligned_addr = NULL;
+  size_t aligned_len = 0;
+  GetPageRange(addr, len, &aligned_addr, &aligned_len);
+  return ::madvise(aligned_addr, aligned_len, MADV_DONTNEED) == 0;
+}
+#endif  // defined(OS_NACL) || defined(OS_WIN)
+
+#if defined(OS_NACL)
+bool Mmap::MaybeFlush(void *addr, size_t len) {
+  return false;
+}
+#elif defined(OS_WIN)
+bool Mmap::MaybeFlush(void *addr, size_t len) {
+  return ::FlushViewOfFile(addr, len) != 0;
+}
+#else  // defined(OS_NACL)
+bool Mmap::MaybeFlush(void *addr, size_t len) {
+  void *aligned_addr = NULL;
+  size_t aligned_len = 0;
+  GetPageRange(addr, len, &aligned_addr, &aligned_len);
+  return ::msync(aligned_addr, aligned_len, MS_SYNC) == 0;
+}
+#endif  // defined(OS_NACL)
+
 }  // namespace mozc
@@ -42,12 +42,49 @@ namespace mozc {
 
 class Mmap : public MmapSyncInterface {
  public:
+  // Memory usage of the mapped region.
+  struct MemoryUsage {
+    // Bytes of the region currently in physical memory.
+    size_t resident_bytes;
+    // Bytes of |resident_bytes| that are also mapped by other processes.
+    size_t shared_bytes;
+    // Bytes of the region copied into anonymous memory of this process, e.g.,
+    // on copy-on-write.  This is always zero for the read only mapping.
+    size_t anonymous_bytes;
+  };
+
+  // Access patterns of the mapped pages, which control the readahead.
+  enum AccessPattern {
+    // The default readahead.
+    NORMAL_ACCESS,
+    // No readahead, for the data looked up at random, e.g., tries and
+    // tables.  Only the touched pages are read.
+    RANDOM_ACCESS,
+    // Aggressive readahead, and the pages are freed soon after they are read.
+    SEQUENTIAL_ACCESS,
+  };
+
   Mmap();
   virtual ~Mmap() { Close(); }
 
+  // Maps the file in one of the following modes:
+  //   "r":  read only and shared (MAP_SHARED / FILE_MAP_READ).  The pages
+  //         come from the page cache and are shared by all the processes
+  //         mapping the same file; no private copy is made.
+  //   "r+": writable and shared.  Writes go to the file.
   bool Open(const char *filename, const char *mode = "r");
+  // Same as above, but hints |pattern| for the whole file: posix_fadvise()
+  // for the page cache and madvise() for the mapping on POSIX, and
+  // FILE_FLAG_RANDOM_ACCESS or FILE_FLAG_SEQUENTIAL_SCAN on Windows.  The
+  // hint is ignored where it's not supported.
+  bool Open(const char *filename, const char *mode, AccessPattern pattern);
   void Close();
 
+  // Fills |usage| for the mapped region.  Currently supported only on Linux,
+  // where the numbers are taken from /proc/self/smaps.  Returns false on the
+  // other platforms or when nothing is mapped.
+  bool GetMemoryUsage(MemoryUsage *usage) const;
+
   // Following mlock/munlock related functions work based on target environment.
   // In Android, Native Client, and Windows, we don't implement mlock, so these
   // functions returns false and -1. For other target platforms, these functions
@@ -63,6 +100,39 @@ class Mmap : public MmapSyncInterface {
   static int MaybeMLock(const void *addr, size_t len);
   static int MaybeMUnlock(const void *addr, size_t len);
 
+  // Hints that [addr, addr + len) will be accessed soon so that the pages are
+  // read ahead asynchronously (madvise(MADV_WILLNEED) /
+  // PrefetchVirtualMemory, which is available on Windows 8 or later).
+  // Returns false if the hint is not supported (Native Client and older
+  // Windows) or failed.
+  static bool MaybePrefetch(const void *addr, size_t len);
+
+  // Hints that [addr, addr + len) is accessed in |pattern| (madvise()), e.g.,
+  // for a section of a file opened with another pattern.  Returns false if
+  // the hint is not supported (Windows and Native Client) or failed.
+  static bool MaybeAdvise(const void *addr, size_t len, AccessPattern pattern);
+
+  // Asks to back [addr, addr + len) with transparent huge pages
+  // (madvise(MADV_HUGEPAGE)) to reduce the TLB misses.  The file backed
+  // mappings get huge pages only if the kernel supports them for the file
+  // system.  Returns false on the platforms other than Linux, or if it
+  // failed.
+  static bool MaybeUseHugePages(const void *addr, size_t len);
+
+  // Drops the pages of [addr, addr + len) of a read only mapping from this
+  // process (madvise(MADV_DONTNEED)), e.g., on memory pressure.  The pages
+  // are read again from the file when they are accessed next.  Must not be
+  // called for a writable mapping, whose unsaved changes would be lost.
+  // Returns false if it's not supported (Windows and Native Client) or
+  // failed, e.g., for the locked pages.
+  static bool MaybeRelease(const void *addr, size_t len);
+
+  // Writes the modified pages in [addr, addr + len) of a writable mapping
+  // back to the file and waits for the completion (msync(MS_SYNC) /
+  // FlushViewOfFile).  Returns false if it's not supported (Native Client,
+  // where SyncToFile() is used instead) or failed.
+  static bool MaybeFlush(void *addr, size_t len);
+
 #ifndef MOZC_USE_PEPPER_FILE_IO
   char &operator[](size_t n) { return *(text_ + n); }
   char operator[](size_t n) const { return *(text_ + n); }
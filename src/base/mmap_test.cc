@@ -97,6 +97,120 @@ TEST(MmapTest, MmapTest) {
   }
 }
 
+TEST(MmapTest, GetMemoryUsage) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.db");
+  const size_t kFileSize = 8192;
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    ofs << string(kFileSize, 'a');
+  }
+
+  Mmap mmap;
+  Mmap::MemoryUsage usage;
+  EXPECT_FALSE(mmap.GetMemoryUsage(&usage));
+  ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+#if defined(OS_LINUX) && !defined(OS_NACL)
+  // Touch every byte so that all the pages become resident.
+  int num_a = 0;
+  for (size_t i = 0; i < mmap.size(); ++i) {
+    num_a += (mmap[i] == 'a');
+  }
+  EXPECT_EQ(kFileSize, num_a);
+  ASSERT_TRUE(mmap.GetMemoryUsage(&usage));
+  EXPECT_EQ(kFileSize, usage.resident_bytes);
+  EXPECT_LE(usage.shared_bytes, usage.resident_bytes);
+  EXPECT_EQ(0, usage.anonymous_bytes);
+#else  // defined(OS_LINUX) && !defined(OS_NACL)
+  EXPECT_FALSE(mmap.GetMemoryUsage(&usage));
+#endif  // defined(OS_LINUX) && !defined(OS_NACL)
+  mmap.Close();
+  FileUtil::Unlink(filename);
+}
+
+TEST(MmapTest, MaybePrefetch) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.db");
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    ofs << string(10000, 'a');
+  }
+  Mmap mmap;
+  ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+#if defined(OS_NACL)
+  EXPECT_FALSE(Mmap::MaybePrefetch(mmap.begin() + 100, 5000));
+#elif defined(OS_WIN)
+  // PrefetchVirtualMemory() is not available before Windows 8.
+  Mmap::MaybePrefetch(mmap.begin() + 100, 5000);
+#else  // defined(OS_NACL)
+  // The address doesn't need to be page aligned.
+  EXPECT_TRUE(Mmap::MaybePrefetch(mmap.begin() + 100, 5000));
+#endif  // defined(OS_NACL)
+  EXPECT_EQ('a', mmap[9999]);
+  mmap.Close();
+  FileUtil::Unlink(filename);
+}
+
+TEST(MmapTest, AccessPattern) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.db");
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    ofs << string(10000, 'a') << string(10000, 'b');
+  }
+  const Mmap::AccessPattern kPatterns[] = {
+    Mmap::NORMAL_ACCESS, Mmap::RANDOM_ACCESS, Mmap::SEQUENTIAL_ACCESS,
+  };
+  for (size_t i = 0; i < arraysize(kPatterns); ++i) {
+    Mmap mmap;
+    ASSERT_TRUE(mmap.Open(filename.c_str(), "r", kPatterns[i]));
+    ASSERT_EQ(20000, mmap.size());
+    EXPECT_EQ('a', mmap[9999]);
+    EXPECT_EQ('b', mmap[19999]);
+
+#if defined(OS_WIN) || defined(OS_NACL)
+    EXPECT_FALSE(Mmap::MaybeAdvise(mmap.begin() + 100, 5000, kPatterns[i]));
+#else  // defined(OS_WIN) || defined(OS_NACL)
+    // The address doesn't need to be page aligned.
+    EXPECT_TRUE(Mmap::MaybeAdvise(mmap.begin() + 100, 5000, kPatterns[i]));
+#endif  // defined(OS_WIN) || defined(OS_NACL)
+    EXPECT_EQ('a', mmap[100]);
+  }
+
+  // The huge pages are not necessarily available for the file, but the data
+  // should be readable regardless of the result.
+  {
+    Mmap mmap;
+    ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+    Mmap::MaybeUseHugePages(mmap.begin(), mmap.size());
+    EXPECT_EQ('b', mmap[10000]);
+  }
+  FileUtil::Unlink(filename);
+}
+
+TEST(MmapTest, MaybeRelease) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.db");
+  const size_t kFileSize = 8192;
+  {
+    OutputFileStream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    ofs << string(kFileSize, 'a');
+  }
+  Mmap mmap;
+  ASSERT_TRUE(mmap.Open(filename.c_str(), "r"));
+  EXPECT_EQ('a', mmap[0]);
+#if defined(OS_WIN) || defined(OS_NACL)
+  EXPECT_FALSE(Mmap::MaybeRelease(mmap.begin(), mmap.size()));
+#else  // defined(OS_WIN) || defined(OS_NACL)
+  EXPECT_TRUE(Mmap::MaybeRelease(mmap.begin(), mmap.size()));
+#if defined(OS_LINUX)
+  Mmap::MemoryUsage usage;
+  ASSERT_TRUE(mmap.GetMemoryUsage(&usage));
+  EXPECT_EQ(0, usage.resident_bytes);
+#endif  // defined(OS_LINUX)
+#endif  // defined(OS_WIN) || defined(OS_NACL)
+  // The released pages are read again from the file.
+  EXPECT_EQ('a', mmap[kFileSize - 1]);
+  mmap.Close();
+  FileUtil::Unlink(filename);
+}
+
 TEST(MmapTest, MaybeMLockTest) {
   const size_t data_len = 32;
   std::unique_ptr<void, void (*)(void*)> addr(malloc(data_len), &free);
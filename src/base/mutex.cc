@@ -33,8 +33,11 @@
 #include <Windows.h>
 #else
 #include <pthread.h>
+#include <sched.h>
 #endif
 
+#include <vector>
+
 #ifdef OS_MACOSX
 #include <libkern/OSAtomic.h>
 #endif  // OS_MACOSX
@@ -292,6 +295,131 @@ bool ReaderWriterMutex::MultipleReadersThreadsSupported() {
 
 #endif  // OS_WIN or pthread
 
+namespace {
+
+// The state of a thread for ReadCopyUpdate.  Each slot is written only by
+// its thread and is padded so that the slots don't share a cache line.
+struct RcuReaderSlot {
+  RcuReaderSlot() : epoch(0), nesting(0), in_use(false) {}
+
+  // The global epoch when the thread entered the outermost read-side
+  // critical section, or 0 outside.
+  std::atomic<uint64> epoch;
+  // Accessed only by the thread.
+  int nesting;
+  // Guarded by GetRcuMutex().
+  bool in_use;
+  char padding[64];
+};
+
+Mutex *GetRcuMutex() {
+  static Mutex *mutex = new Mutex;
+  return mutex;
+}
+
+// All the slots ever allocated, guarded by GetRcuMutex().  The slots of the
+// exited threads are reused and never deleted, so Synchronize() can wait on
+// them without the lock.
+std::vector<RcuReaderSlot *> *GetRcuReaderSlots() {
+  static std::vector<RcuReaderSlot *> *slots =
+      new std::vector<RcuReaderSlot *>;
+  return slots;
+}
+
+std::atomic<uint64> g_rcu_epoch(1);
+
+// Assigns a slot to the current thread and releases it at the exit.
+class RcuReaderRegistration {
+ public:
+  RcuReaderRegistration() : slot_(nullptr) {
+    scoped_lock l(GetRcuMutex());
+    std::vector<RcuReaderSlot *> *slots = GetRcuReaderSlots();
+    for (size_t i = 0; i < slots->size(); ++i) {
+      if (!(*slots)[i]->in_use) {
+        slot_ = (*slots)[i];
+        break;
+      }
+    }
+    if (slot_ == nullptr) {
+      slot_ = new RcuReaderSlot;
+      slots->push_back(slot_);
+    }
+    slot_->in_use = true;
+  }
+
+  ~RcuReaderRegistration() {
+    scoped_lock l(GetRcuMutex());
+    slot_->in_use = false;
+  }
+
+  RcuReaderSlot *slot() {
+    return slot_;
+  }
+
+ private:
+  RcuReaderSlot *slot_;
+
+  DISALLOW_COPY_AND_ASSIGN(RcuReaderRegistration);
+};
+
+RcuReaderSlot *GetCurrentRcuReaderSlot() {
+  static thread_local RcuReaderRegistration registration;
+  return registration.slot();
+}
+
+void YieldThread() {
+#ifdef OS_WIN
+  ::SwitchToThread();
+#else
+  sched_yield();
+#endif  // OS_WIN
+}
+
+}  // namespace
+
+void ReadCopyUpdate::ReadLock() {
+  RcuReaderSlot *slot = GetCurrentRcuReaderSlot();
+  if (slot->nesting++ > 0) {
+    return;
+  }
+  slot->epoch.store(g_rcu_epoch.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  // Orders the store above before the loads of the protected pointers.  It
+  // pairs with the fence in Synchronize().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void ReadCopyUpdate::ReadUnlock() {
+  RcuReaderSlot *slot = GetCurrentRcuReaderSlot();
+  if (--slot->nesting > 0) {
+    return;
+  }
+  slot->epoch.store(0, std::memory_order_release);
+}
+
+void ReadCopyUpdate::Synchronize() {
+  // Readers which enter after this see the new pointers.
+  const uint64 epoch = g_rcu_epoch.fetch_add(1) + 1;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // The lock is not held while waiting so that new threads can register.
+  std::vector<RcuReaderSlot *> slots;
+  {
+    scoped_lock l(GetRcuMutex());
+    slots = *GetRcuReaderSlots();
+  }
+  for (size_t i = 0; i < slots.size(); ++i) {
+    while (true) {
+      const uint64 reader_epoch =
+          slots[i]->epoch.load(std::memory_order_acquire);
+      if (reader_epoch == 0 || reader_epoch >= epoch) {
+        break;
+      }
+      YieldThread();
+    }
+  }
+}
+
 void CallOnce(once_t *once, void (*func)()) {
   if (once == NULL || func == NULL) {
     return;
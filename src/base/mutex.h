@@ -34,6 +34,8 @@
 #include <pthread.h>
 #endif  // MOZC_USE_PEPPER_FILE_IO
 
+#include <atomic>
+
 #include "base/port.h"
 #include "base/thread_annotations.h"
 
@@ -193,6 +195,82 @@ typedef scoped_lock MutexLock;
 typedef scoped_reader_lock ReaderMutexLock;
 typedef scoped_writer_lock WriterMutexLock;
 
+// Read-copy-update for read-mostly data.  Readers don't write to any memory
+// shared with the other threads, so they don't contend with each other on a
+// cache line like ReaderWriterMutex readers do.  A writer publishes a new copy
+// with RcuPtr::Reset(), which waits until all the readers which may see the
+// old copy leave their critical sections before deleting it.
+//
+// usage:
+// RcuPtr<Index> index_(new Index);
+//
+// void Lookup() const {
+//   scoped_rcu_read_lock l;
+//   const Index *index = index_.get();
+//   ...  // |index| is valid until |l| is released.
+// }
+//
+// void Update() {
+//   index_.Reset(new Index(...));
+// }
+class ReadCopyUpdate {
+ public:
+  // Enters and leaves a read-side critical section of the current thread.
+  // They can be nested.  The first call on a thread registers the thread,
+  // which takes a lock.
+  static void ReadLock();
+  static void ReadUnlock();
+
+  // Blocks until every read-side critical section entered before this call
+  // is left.  Must not be called in a read-side critical section.
+  static void Synchronize();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ReadCopyUpdate);
+};
+
+class scoped_rcu_read_lock {
+ public:
+  scoped_rcu_read_lock() {
+    ReadCopyUpdate::ReadLock();
+  }
+  ~scoped_rcu_read_lock() {
+    ReadCopyUpdate::ReadUnlock();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(scoped_rcu_read_lock);
+};
+
+// Owns an object read under scoped_rcu_read_lock.  Reset() calls must be
+// serialized by the caller.
+template <typename T>
+class RcuPtr {
+ public:
+  explicit RcuPtr(T *value) : value_(value) {}
+  ~RcuPtr() {
+    delete value_.load(std::memory_order_relaxed);
+  }
+
+  // The returned object is valid until the read-side critical section of the
+  // caller is left.
+  T *get() const {
+    return value_.load(std::memory_order_acquire);
+  }
+
+  // Publishes |value| and deletes the old object after the readers leave.
+  void Reset(T *value) {
+    T *old_value = value_.exchange(value, std::memory_order_acq_rel);
+    ReadCopyUpdate::Synchronize();
+    delete old_value;
+  }
+
+ private:
+  std::atomic<T *> value_;
+
+  DISALLOW_COPY_AND_ASSIGN(RcuPtr);
+};
+
 enum CallOnceState {
   ONCE_INIT = 0,
   ONCE_DONE = 1,
@@ -29,10 +29,15 @@
 
 #include "base/mutex.h"
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "base/clock.h"
 #include "base/logging.h"
 #include "base/thread.h"
 #include "base/thread_annotations.h"
+#include "base/unnamed_event.h"
 #include "base/util.h"
 #include "testing/base/public/gunit.h"
 
@@ -283,5 +288,157 @@ TEST(CallOnceTest, CallOnceBasicTest) {
   CallOnce(&once, CallbackFunc);
   EXPECT_EQ(1, g_counter);
 }
+
+// Counts its deletion in |num_deleted|.
+struct RcuTestValue {
+  RcuTestValue(int value, std::atomic<int> *num_deleted)
+      : value(value), copy(value), num_deleted(num_deleted) {}
+  ~RcuTestValue() {
+    copy = -1;
+    ++*num_deleted;
+  }
+
+  const int value;
+  int copy;
+  std::atomic<int> *num_deleted;
+};
+
+class RcuResetThread : public Thread {
+ public:
+  RcuResetThread(RcuPtr<RcuTestValue> *ptr, RcuTestValue *value,
+                 UnnamedEvent *done_event)
+      : ptr_(ptr), value_(value), done_event_(done_event) {}
+
+  void Run() override {
+    ptr_->Reset(value_);
+    done_event_->Notify();
+  }
+
+ private:
+  RcuPtr<RcuTestValue> *ptr_;
+  RcuTestValue *value_;
+  UnnamedEvent *done_event_;
+};
+
+class RcuHoldingReaderThread : public Thread {
+ public:
+  RcuHoldingReaderThread(RcuPtr<RcuTestValue> *ptr,
+                         UnnamedEvent *entered_event,
+                         UnnamedEvent *release_event)
+      : ptr_(ptr), entered_event_(entered_event),
+        release_event_(release_event), value_(0) {}
+
+  void Run() override {
+    scoped_rcu_read_lock l;
+    const RcuTestValue *value = ptr_->get();
+    entered_event_->Notify();
+    release_event_->Wait(-1);
+    value_ = value->copy;
+  }
+
+  int value() const { return value_; }
+
+ private:
+  RcuPtr<RcuTestValue> *ptr_;
+  UnnamedEvent *entered_event_;
+  UnnamedEvent *release_event_;
+  int value_;
+};
+
+TEST(ReadCopyUpdateTest, ResetWaitsForReaders) {
+  std::atomic<int> num_deleted(0);
+  RcuPtr<RcuTestValue> ptr(new RcuTestValue(1, &num_deleted));
+
+  UnnamedEvent entered_event, release_event, reset_event;
+  RcuHoldingReaderThread reader(&ptr, &entered_event, &release_event);
+  reader.SetJoinable(true);
+  reader.Start("RcuReader");
+  ASSERT_TRUE(entered_event.Wait(10000));
+
+  RcuResetThread writer(&ptr, new RcuTestValue(2, &num_deleted),
+                        &reset_event);
+  writer.SetJoinable(true);
+  writer.Start("RcuWriter");
+
+  // The old value is kept while the reader holds it.
+  EXPECT_FALSE(reset_event.Wait(100));
+  EXPECT_EQ(0, num_deleted);
+  {
+    // New readers see the new value without waiting for the writer.
+    scoped_rcu_read_lock l;
+    EXPECT_EQ(2, ptr.get()->value);
+  }
+
+  release_event.Notify();
+  EXPECT_TRUE(reset_event.Wait(10000));
+  reader.Join();
+  writer.Join();
+  EXPECT_EQ(1, reader.value());
+  EXPECT_EQ(1, num_deleted);
+}
+
+TEST(ReadCopyUpdateTest, NestedReadLock) {
+  std::atomic<int> num_deleted(0);
+  RcuPtr<RcuTestValue> ptr(new RcuTestValue(1, &num_deleted));
+  {
+    scoped_rcu_read_lock l1;
+    {
+      scoped_rcu_read_lock l2;
+      EXPECT_EQ(1, ptr.get()->value);
+    }
+    EXPECT_EQ(1, ptr.get()->copy);
+  }
+  // Returns immediately as no reader is left.
+  ptr.Reset(new RcuTestValue(2, &num_deleted));
+  EXPECT_EQ(1, num_deleted);
+}
+
+class RcuReaderThread : public Thread {
+ public:
+  RcuReaderThread(RcuPtr<RcuTestValue> *ptr, const std::atomic<bool> *quit)
+      : ptr_(ptr), quit_(quit), num_errors_(0) {}
+
+  void Run() override {
+    while (!*quit_) {
+      scoped_rcu_read_lock l;
+      const RcuTestValue *value = ptr_->get();
+      if (value->value != value->copy) {
+        ++num_errors_;
+      }
+    }
+  }
+
+  int num_errors() const { return num_errors_; }
+
+ private:
+  RcuPtr<RcuTestValue> *ptr_;
+  const std::atomic<bool> *quit_;
+  int num_errors_;
+};
+
+TEST(ReadCopyUpdateTest, ConcurrentReadersAndWriter) {
+  const size_t kNumReaders = 4;
+  const int kNumResets = 1000;
+
+  std::atomic<int> num_deleted(0);
+  std::atomic<bool> quit(false);
+  RcuPtr<RcuTestValue> ptr(new RcuTestValue(0, &num_deleted));
+  std::vector<std::unique_ptr<RcuReaderThread>> readers;
+  for (size_t i = 0; i < kNumReaders; ++i) {
+    readers.emplace_back(new RcuReaderThread(&ptr, &quit));
+    readers.back()->SetJoinable(true);
+    readers.back()->Start("RcuReader");
+  }
+  for (int i = 1; i <= kNumResets; ++i) {
+    ptr.Reset(new RcuTestValue(i, &num_deleted));
+  }
+  quit = true;
+  for (size_t i = 0; i < readers.size(); ++i) {
+    readers[i]->Join();
+    EXPECT_EQ(0, readers[i]->num_errors());
+  }
+  EXPECT_EQ(kNumResets, num_deleted);
+}
+
 }  // namespace
 }  // namespace mozc
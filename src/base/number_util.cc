@@ -161,29 +161,66 @@ const char kAsciiZero = '0';
 const char kAsciiOne = '1';
 const char kAsciiNine = '9';
 
-template <typename T>
-string SimpleItoaImpl(T number) {
-  std::stringstream ss;
-  ss << number;
-  return ss.str();
+size_t FastUInt64ToBuffer(uint64 number, char *buffer) {
+  // Writes the digits from the end of |digits| and copies them.
+  char digits[NumberUtil::kFastItoaBufferSize];
+  char *begin = digits + arraysize(digits);
+  do {
+    *--begin = kAsciiZero + static_cast<char>(number % 10);
+    number /= 10;
+  } while (number != 0);
+  const size_t length = digits + arraysize(digits) - begin;
+  memcpy(buffer, begin, length);
+  return length;
+}
+
+size_t FastInt64ToBuffer(int64 number, char *buffer) {
+  if (number >= 0) {
+    return FastUInt64ToBuffer(static_cast<uint64>(number), buffer);
+  }
+  // Negating kint64min as int64 overflows, so negate as uint64.
+  buffer[0] = '-';
+  return 1 + FastUInt64ToBuffer(0 - static_cast<uint64>(number), buffer + 1);
 }
 
 }  // namespace
 
+const size_t NumberUtil::kFastItoaBufferSize;
+
+size_t NumberUtil::FastItoa(int32 number, char *buffer) {
+  return FastInt64ToBuffer(number, buffer);
+}
+
+size_t NumberUtil::FastItoa(uint32 number, char *buffer) {
+  return FastUInt64ToBuffer(number, buffer);
+}
+
+size_t NumberUtil::FastItoa(int64 number, char *buffer) {
+  return FastInt64ToBuffer(number, buffer);
+}
+
+size_t NumberUtil::FastItoa(uint64 number, char *buffer) {
+  return FastUInt64ToBuffer(number, buffer);
+}
+
 string NumberUtil::SimpleItoa(int32 number) {
-  return SimpleItoaImpl(number);
+  char buffer[kFastItoaBufferSize];
+  return string(buffer, FastItoa(number, buffer));
 }
 
 string NumberUtil::SimpleItoa(uint32 number) {
-  return SimpleItoaImpl(number);
+  char buffer[kFastItoaBufferSize];
+  return string(buffer, FastItoa(number, buffer));
 }
 
 string NumberUtil::SimpleItoa(int64 number) {
-  return SimpleItoaImpl(number);
+  char buffer[kFastItoaBufferSize];
+  return string(buffer, FastItoa(number, buffer));
 }
 
 string NumberUtil::SimpleItoa(uint64 number) {
-  return SimpleItoaImpl(number);
+  char buffer[kFastItoaBufferSize];
+  return string(buffer, FastItoa(number, buffer));
 }
 
 int NumberUtil::SimpleAtoi(StringPiece str) {
@@ -265,18 +302,81 @@ const size_t kOldTwoTenLength = arraysize(kOldTwoTen) - 1;
 // "廿"
 const char kOldTwenty[] = "\xE5\xBB\xBF";
 
-}  // namespace
+// The digits of each DigitStyle packed into one string.  Every digit of a
+// style has the same length, so a digit is converted by indexing.
+const struct DigitTable {
+  const char *digits;
+  size_t char_length;
+} kDigitTables[] = {
+  // HALFWIDTH_DIGITS
+  {"0123456789", 1},
+  // FULLWIDTH_DIGITS: "０１２３４５６７８９"
+  {"\xEF\xBC\x90" "\xEF\xBC\x91" "\xEF\xBC\x92" "\xEF\xBC\x93"
+   "\xEF\xBC\x94" "\xEF\xBC\x95" "\xEF\xBC\x96" "\xEF\xBC\x97"
+   "\xEF\xBC\x98" "\xEF\xBC\x99", 3},
+  // KANJI_DIGITS: "〇一二三四五六七八九"
+  {"\xE3\x80\x87" "\xE4\xB8\x80" "\xE4\xBA\x8C" "\xE4\xB8\x89"
+   "\xE5\x9B\x9B" "\xE4\xBA\x94" "\xE5\x85\xAD" "\xE4\xB8\x83"
+   "\xE5\x85\xAB" "\xE4\xB9\x9D", 3},
+};
 
-bool NumberUtil::ArabicToKanji(StringPiece input_num,
-                               std::vector<NumberString> *output) {
+inline void AppendDigit(const DigitTable &table, char digit, string *output) {
+  output->append(table.digits + (digit - kAsciiZero) * table.char_length,
+                 table.char_length);
+}
+
+typedef NumberUtil::NumberString NumberString;
+
+// |input_num| of the ArabicToXxx() functions, which is validated once and
+// converted to uint64 on demand.
+class ArabicNumber {
+ public:
+  explicit ArabicNumber(StringPiece str)
+      : str_(str),
+        is_integer_(NumberUtil::IsDecimalInteger(str)),
+        value_state_(kValueUnknown),
+        value_(0) {}
+
+  StringPiece str() const { return str_; }
+  bool is_integer() const { return is_integer_; }
+
+  // Returns false if the number is not an integer or is too large.
+  bool GetUInt64(uint64 *value) {
+    if (value_state_ == kValueUnknown) {
+      value_state_ =
+          is_integer_ && NumberUtil::SafeStrToUInt64(str_, &value_) ?
+          kValueAvailable : kValueUnavailable;
+    }
+    *value = value_;
+    return value_state_ == kValueAvailable;
+  }
+
+ private:
+  enum ValueState {
+    kValueUnknown,
+    kValueAvailable,
+    kValueUnavailable,
+  };
+
+  const StringPiece str_;
+  const bool is_integer_;
+  ValueState value_state_;
+  uint64 value_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArabicNumber);
+};
+
+bool ArabicToKanjiImpl(const ArabicNumber &number,
+                       std::vector<NumberString> *output) {
   DCHECK(output);
   // "零"
   const char *const kNumZero = "\xe9\x9b\xb6";
   const int kDigitsInBigRank = 4;
 
-  if (!IsDecimalInteger(input_num)) {
+  if (!number.is_integer()) {
     return false;
   }
+  const StringPiece input_num = number.str();
 
   {
     // We don't convert a number starting with '0', other than 0 itself.
@@ -298,19 +398,21 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
   }
 
   // Fill '0' in the beginning of input_num to make its length
-  // (N * kDigitsInBigRank).
+  // (N * kDigitsInBigRank).  The input is short enough for a stack buffer.
   const int filled_zero_num = (kDigitsInBigRank -
       (input_num.size() % kDigitsInBigRank)) % kDigitsInBigRank;
-  string input(filled_zero_num, kAsciiZero);
-  input_num.AppendToString(&input);
+  char input_buffer[arraysize(kNumKanjiBiggerRanks) * kDigitsInBigRank];
+  memset(input_buffer, kAsciiZero, filled_zero_num);
+  memcpy(input_buffer + filled_zero_num, input_num.data(), input_num.size());
+  const StringPiece input(input_buffer, filled_zero_num + input_num.size());
 
   // Segment into kDigitsInBigRank-digits pieces
-  std::vector<string> ranked_numbers;
+  StringPiece ranked_numbers[arraysize(kNumKanjiBiggerRanks)];
+  size_t rank_size = 0;
   for (int i = static_cast<int>(input.size()) - kDigitsInBigRank; i >= 0;
        i -= kDigitsInBigRank) {
-    ranked_numbers.push_back(input.substr(i, kDigitsInBigRank));
+    ranked_numbers[rank_size++] = input.substr(i, kDigitsInBigRank);
   }
-  const size_t rank_size = ranked_numbers.size();
 
   for (size_t variation_index = 0;
        variation_index < arraysize(kKanjiVariations); ++variation_index) {
@@ -334,13 +436,14 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
       bigger_ranks = kNumKanjiBiggerRanks;
     }
 
-    // TODO(peria): Bring |result| out if it improves the performance.
     string result;
+    // Each digit and rank takes at most 3 bytes in UTF-8.
+    result.reserve(input.size() * 6);
 
     // Converts each segment, and merges them with rank Kanjis.
     for (int rank = rank_size - 1; rank >= 0; --rank) {
-      const string &segment = ranked_numbers[rank];
-      string segment_result;
+      const StringPiece segment = ranked_numbers[rank];
+      const size_t rank_begin = result.size();
       bool leading = true;
       for (size_t i = 0; i < segment.size(); ++i) {
         if (leading && segment[i] == kAsciiZero) {
@@ -350,7 +453,7 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
         leading = false;
         if (style == NumberString::NUMBER_ARABIC_AND_KANJI_HALFWIDTH ||
             style == NumberString::NUMBER_ARABIC_AND_KANJI_FULLWIDTH) {
-          segment_result += digits[segment[i] - kAsciiZero];
+          result.append(digits[segment[i] - kAsciiZero]);
         } else {
           if (segment[i] == kAsciiZero) {
             continue;
@@ -358,13 +461,13 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
           // In "大字" style, "壱" is also required on every rank.
           if (style == NumberString::NUMBER_OLD_KANJI ||
               i == kDigitsInBigRank - 1 || segment[i] != kAsciiOne) {
-            segment_result += digits[segment[i] - kAsciiZero];
+            result.append(digits[segment[i] - kAsciiZero]);
           }
-          segment_result += ranks[kDigitsInBigRank - i];
+          result.append(ranks[kDigitsInBigRank - i]);
         }
       }
-      if (!segment_result.empty()) {
-        result += segment_result + bigger_ranks[rank];
+      if (result.size() > rank_begin) {
+        result.append(bigger_ranks[rank]);
       }
     }
 
@@ -399,21 +502,23 @@ bool NumberUtil::ArabicToKanji(StringPiece input_num,
   return true;
 }
 
-namespace {
-
-const NumberStringVariation kNumDigitsVariations[] = {
+const struct {
+  NumberUtil::DigitStyle digit_style;
+  const char *description;
+  const char *separator;
+  const char *point;
+  NumberString::Style style;
+} kNumDigitsVariations[] = {
   // "数字"
-  {kNumHalfWidthDigits, 10, "\xE6\x95\xB0\xE5\xAD\x97", ",", ".",
-   NumberUtil::NumberString::NUMBER_SEPARATED_ARABIC_HALFWIDTH},
+  {NumberUtil::HALFWIDTH_DIGITS, "\xE6\x95\xB0\xE5\xAD\x97", ",", ".",
+   NumberString::NUMBER_SEPARATED_ARABIC_HALFWIDTH},
   // "数字", "，", "．"
-  {kNumFullWidthDigits, 10, "\xE6\x95\xB0\xE5\xAD\x97", "\xef\xbc\x8c",
-   "\xEF\xBC\x8E", NumberUtil::NumberString::NUMBER_SEPARATED_ARABIC_FULLWIDTH},
+  {NumberUtil::FULLWIDTH_DIGITS, "\xE6\x95\xB0\xE5\xAD\x97", "\xef\xbc\x8c",
+   "\xEF\xBC\x8E", NumberString::NUMBER_SEPARATED_ARABIC_FULLWIDTH},
 };
 
-}  // namespace
-
-bool NumberUtil::ArabicToSeparatedArabic(
-    StringPiece input_num, std::vector<NumberString> *output) {
+bool ArabicToSeparatedArabicImpl(StringPiece input_num,
+                                 std::vector<NumberString> *output) {
   DCHECK(output);
 
   if (!IsDecimalNumber(input_num)) {
@@ -431,84 +536,81 @@ bool NumberUtil::ArabicToSeparatedArabic(
       input_num.substr(point_pos, input_num.size() - point_pos);
 
   // We don't add separator to number whose integral part starts with '0'
-  if (integer[0] == kAsciiZero) {
+  if (integer.empty() || integer[0] == kAsciiZero) {
     return false;
   }
 
   for (size_t i = 0; i < arraysize(kNumDigitsVariations); ++i) {
-    const NumberStringVariation &variation = kNumDigitsVariations[i];
-    const char *const *const digits = variation.digits;
-    // TODO(peria): Bring |result| out if it improves the performance.
+    const DigitTable &table =
+        kDigitTables[kNumDigitsVariations[i].digit_style];
+    const char *separator = kNumDigitsVariations[i].separator;
     string result;
+    // Separators and the point take at most as many bytes as the digits.
+    result.reserve(input_num.size() * table.char_length * 2);
 
     // integral part
     for (StringPiece::size_type j = 0; j < integer.size(); ++j) {
       // We don't add separater first
       if (j != 0 && (integer.size() - j) % 3 == 0) {
-        result.append(variation.separator);
-      }
-      const uint32 d = static_cast<uint32>(integer[j] - kAsciiZero);
-      if (d <= 9 && digits[d]) {
-        result.append(digits[d]);
+        result.append(separator);
       }
+      AppendDigit(table, integer[j], &result);
     }
 
     // fractional part
     if (!fraction.empty()) {
       DCHECK_EQ(fraction[0], '.');
-      result.append(variation.point);
+      result.append(kNumDigitsVariations[i].point);
       for (StringPiece::size_type j = 1; j < fraction.size(); ++j) {
-        result.append(digits[static_cast<int>(fraction[j] - kAsciiZero)]);
+        AppendDigit(table, fraction[j], &result);
       }
     }
 
-    output->push_back(
-        NumberString(result, variation.description, variation.style));
+    output->push_back(NumberString(result,
+                                   kNumDigitsVariations[i].description,
+                                   kNumDigitsVariations[i].style));
   }
   return true;
 }
 
-namespace {
-
 // use default for wide Arabic, because half/full width for
 // normal number is learned by charactor form manager.
-const NumberStringVariation kSingleDigitsVariations[] = {
+const struct {
+  NumberUtil::DigitStyle digit_style;
+  const char *description;
+  NumberString::Style style;
+} kSingleDigitsVariations[] = {
   // "漢数字"
-  {kNumKanjiDigits, 10, "\xE6\xBC\xA2\xE6\x95\xB0\xE5\xAD\x97",
-   nullptr, nullptr, NumberUtil::NumberString::NUMBER_KANJI_ARABIC},
+  {NumberUtil::KANJI_DIGITS, "\xE6\xBC\xA2\xE6\x95\xB0\xE5\xAD\x97",
+   NumberString::NUMBER_KANJI_ARABIC},
   // "数字"
-  {kNumFullWidthDigits, 10, "\xE6\x95\xB0\xE5\xAD\x97",
-   nullptr, nullptr, NumberUtil::NumberString::DEFAULT_STYLE},
+  {NumberUtil::FULLWIDTH_DIGITS, "\xE6\x95\xB0\xE5\xAD\x97",
+   NumberString::DEFAULT_STYLE},
 };
 
-}  // namespace
-
-bool NumberUtil::ArabicToWideArabic(
-    StringPiece input_num, std::vector<NumberString> *output) {
+bool ArabicToWideArabicImpl(const ArabicNumber &number,
+                            std::vector<NumberString> *output) {
   DCHECK(output);
 
-  if (!IsDecimalInteger(input_num)) {
+  if (!number.is_integer()) {
     return false;
   }
 
   for (size_t i = 0; i < arraysize(kSingleDigitsVariations); ++i) {
-    const NumberStringVariation &variation = kSingleDigitsVariations[i];
-    // TODO(peria): Bring |result| out if it improves the performance.
+    const DigitTable &table =
+        kDigitTables[kSingleDigitsVariations[i].digit_style];
     string result;
-    for (StringPiece::size_type j = 0; j < input_num.size(); ++j) {
-      result.append(
-          variation.digits[static_cast<int>(input_num[j] - kAsciiZero)]);
-    }
-    if (!result.empty()) {
-      output->push_back(
-          NumberString(result, variation.description, variation.style));
+    result.reserve(number.str().size() * table.char_length);
+    for (StringPiece::size_type j = 0; j < number.str().size(); ++j) {
+      AppendDigit(table, number.str()[j], &result);
     }
+    output->push_back(NumberString(result,
+                                   kSingleDigitsVariations[i].description,
+                                   kSingleDigitsVariations[i].style));
   }
   return true;
 }
 
-namespace {
-
 const NumberStringVariation kSpecialNumericVariations[] = {
   {kRomanNumbersCapital, arraysize(kRomanNumbersCapital),
    // "ローマ数字(大文字)",
@@ -526,13 +628,11 @@ const NumberStringVariation kSpecialNumericVariations[] = {
    nullptr, nullptr, NumberUtil::NumberString::NUMBER_CIRCLED},
 };
 
-}  // namespace
-
-bool NumberUtil::ArabicToOtherForms(
-    StringPiece input_num, std::vector<NumberString> *output) {
+bool ArabicToOtherFormsImpl(ArabicNumber *number,
+                            std::vector<NumberString> *output) {
   DCHECK(output);
 
-  if (!IsDecimalInteger(input_num)) {
+  if (!number->is_integer()) {
     return false;
   }
 
@@ -545,7 +645,7 @@ bool NumberUtil::ArabicToOtherForms(
         "100000000000000000000000000000000000000000000000000"
         "00000000000000000000000000000000000000000000000000";
 
-    if (input_num == kNumGoogol) {
+    if (number->str() == kNumGoogol) {
       output->push_back(
           NumberString("Googol", "", NumberString::DEFAULT_STYLE));
       converted = true;
@@ -554,7 +654,7 @@ bool NumberUtil::ArabicToOtherForms(
 
   // Following conversions require uint64 number.
   uint64 n;
-  if (!SafeStrToUInt64(input_num, &n)) {
+  if (!number->GetUInt64(&n)) {
     return converted;
   }
 
@@ -572,24 +672,16 @@ bool NumberUtil::ArabicToOtherForms(
   return converted;
 }
 
-namespace {
-
 // Enough size to store MAX_INT64 in octal digits with prefix.
 // Must be larger than or equal to Ceil(64 / 3) + 1 ("0") + 1 ('\0') = 24
 const int kMaxInt64Size = 24;
 
-}  // namespace
-
-bool NumberUtil::ArabicToOtherRadixes(
-    StringPiece input_num, std::vector<NumberString> *output) {
+bool ArabicToOtherRadixesImpl(ArabicNumber *number,
+                              std::vector<NumberString> *output) {
   DCHECK(output);
 
-  if (!IsDecimalInteger(input_num)) {
-    return false;
-  }
-
   uint64 n;
-  if (!SafeStrToUInt64(input_num, &n)) {
+  if (!number->GetUInt64(&n)) {
     return false;
   }
 
@@ -614,21 +706,106 @@ bool NumberUtil::ArabicToOtherRadixes(
 
   // Binary
   if (n > 1) {
-    string binary;
+    // "0b" and at most 64 digits.
+    char binary[66];
+    char *end = binary + arraysize(binary);
+    char *begin = end;
     for (uint64 num = n; num; num >>= 1) {
-      binary.push_back(kAsciiZero + static_cast<char>(num & 0x1));
+      *--begin = kAsciiZero + static_cast<char>(num & 0x1);
     }
-    // "b0" will be "0b" in head of |binary|
-    binary.append("b0");
-    std::reverse(binary.begin(), binary.end());
+    *--begin = 'b';
+    *--begin = kAsciiZero;
     // "2進数"
-    output->push_back(NumberString(binary, "2\xE9\x80\xB2\xE6\x95\xB0",
+    output->push_back(NumberString(StringPiece(begin, end - begin),
+                                   "2\xE9\x80\xB2\xE6\x95\xB0",
                                    NumberString::NUMBER_BIN));
   }
 
   return (n > 1);
 }
 
+}  // namespace
+
+bool NumberUtil::ArabicToKanji(StringPiece input_num,
+                               std::vector<NumberString> *output) {
+  return ArabicToKanjiImpl(ArabicNumber(input_num), output);
+}
+
+bool NumberUtil::ArabicToSeparatedArabic(
+    StringPiece input_num, std::vector<NumberString> *output) {
+  return ArabicToSeparatedArabicImpl(input_num, output);
+}
+
+bool NumberUtil::ArabicToWideArabic(
+    StringPiece input_num, std::vector<NumberString> *output) {
+  return ArabicToWideArabicImpl(ArabicNumber(input_num), output);
+}
+
+bool NumberUtil::ArabicToOtherForms(
+    StringPiece input_num, std::vector<NumberString> *output) {
+  ArabicNumber number(input_num);
+  return ArabicToOtherFormsImpl(&number, output);
+}
+
+bool NumberUtil::ArabicToOtherRadixes(
+    StringPiece input_num, std::vector<NumberString> *output) {
+  ArabicNumber number(input_num);
+  return ArabicToOtherRadixesImpl(&number, output);
+}
+
+bool NumberUtil::ArabicToNumberStrings(StringPiece input_num,
+                                       uint32 conversions,
+                                       std::vector<NumberString> *output) {
+  DCHECK(output);
+  ArabicNumber number(input_num);
+  // The kanji forms are the most numerous: up to 5 strings.
+  output->reserve(output->size() + 16);
+  bool converted = false;
+  if ((conversions & KANJI) && (conversions & KANJI_FIRST)) {
+    converted |= ArabicToKanjiImpl(number, output);
+  }
+  if (conversions & HALF_ARABIC) {
+    output->push_back(
+        NumberString(input_num, "", NumberString::DEFAULT_STYLE));
+    converted = true;
+  }
+  if (conversions & WIDE_ARABIC) {
+    converted |= ArabicToWideArabicImpl(number, output);
+  }
+  if (conversions & SEPARATED_ARABIC) {
+    converted |= ArabicToSeparatedArabicImpl(input_num, output);
+  }
+  if ((conversions & KANJI) && !(conversions & KANJI_FIRST)) {
+    converted |= ArabicToKanjiImpl(number, output);
+  }
+  if (conversions & OTHER_FORMS) {
+    converted |= ArabicToOtherFormsImpl(&number, output);
+  }
+  if (conversions & OTHER_RADIXES) {
+    converted |= ArabicToOtherRadixesImpl(&number, output);
+  }
+  return converted;
+}
+
+size_t NumberUtil::ConvertDigits(StringPiece input_num, DigitStyle style,
+                                 char *buffer, size_t buffer_size) {
+  DCHECK(buffer);
+  const DigitTable &table = kDigitTables[style];
+  if (input_num.size() * table.char_length > buffer_size) {
+    return 0;
+  }
+  char *out = buffer;
+  for (size_t i = 0; i < input_num.size(); ++i) {
+    const uint32 d = static_cast<uint32>(input_num[i] - kAsciiZero);
+    if (d > 9) {
+      return 0;
+    }
+    memcpy(out, table.digits + d * table.char_length, table.char_length);
+    out += table.char_length;
+  }
+  return out - buffer;
+}
+
 namespace {
 
 const StringPiece SkipWhiteSpace(StringPiece str) {
@@ -48,6 +48,16 @@ class NumberUtil {
   static string SimpleItoa(int64 number);
   static string SimpleItoa(uint64 number);
 
+  // Writes the decimal representation of the number to |buffer|, which must
+  // have kFastItoaBufferSize bytes, and returns the number of the bytes
+  // written.  The result is not null-terminated.  Unlike SimpleItoa(), this
+  // doesn't allocate.
+  static const size_t kFastItoaBufferSize = 24;
+  static size_t FastItoa(int32 number, char *buffer);
+  static size_t FastItoa(uint32 number, char *buffer);
+  static size_t FastItoa(int64 number, char *buffer);
+  static size_t FastItoa(uint64 number, char *buffer);
+
   // Converts the string to a number and return it.
   static int SimpleAtoi(StringPiece str);
 
@@ -148,6 +158,41 @@ class NumberUtil {
   static bool ArabicToOtherRadixes(StringPiece input_num,
                                    std::vector<NumberString> *output);
 
+  // Conversions for ArabicToNumberStrings().
+  enum Conversion {
+    // |input_num| itself with DEFAULT_STYLE and no description.
+    HALF_ARABIC = 1 << 0,
+    WIDE_ARABIC = 1 << 1,       // ArabicToWideArabic()
+    SEPARATED_ARABIC = 1 << 2,  // ArabicToSeparatedArabic()
+    KANJI = 1 << 3,             // ArabicToKanji()
+    OTHER_FORMS = 1 << 4,       // ArabicToOtherForms()
+    OTHER_RADIXES = 1 << 5,     // ArabicToOtherRadixes()
+    // Moves the results of KANJI to the front.
+    KANJI_FIRST = 1 << 6,
+  };
+
+  // Runs the conversions in |conversions|, a bitwise OR of Conversion, in
+  // the order of the enum and appends the results to |output|.  The result
+  // is the same as calling the corresponding functions one by one, but
+  // |input_num| is validated and parsed only once.  Returns true if any of
+  // the conversions succeeds.
+  static bool ArabicToNumberStrings(StringPiece input_num, uint32 conversions,
+                                    std::vector<NumberString> *output);
+
+  // Styles of the digits for ConvertDigits().
+  enum DigitStyle {
+    HALFWIDTH_DIGITS,  // "0123456789"
+    FULLWIDTH_DIGITS,  // "０１２３４５６７８９"
+    KANJI_DIGITS,      // "〇一二三四五六七八九"
+  };
+
+  // Converts each ASCII digit of |input_num| to |style| and writes the result
+  // to |buffer| of |buffer_size| bytes.  Returns the number of the bytes
+  // written, or 0 if |input_num| has a non-digit character or the result
+  // doesn't fit in |buffer|.  The result is not null-terminated.
+  static size_t ConvertDigits(StringPiece input_num, DigitStyle style,
+                              char *buffer, size_t buffer_size);
+
   // Converts the string to a 32-/64-bit signed/unsigned int.  Returns true if
   // success or false if the string is in the wrong format.
   static bool SafeStrToInt16(StringPiece str, int16 *value);
@@ -50,6 +50,44 @@ TEST(NumberUtilTest, SimpleItoa) {
   EXPECT_EQ("18446744073709551615", NumberUtil::SimpleItoa(kuint64max));
 }
 
+TEST(NumberUtilTest, FastItoa) {
+  char buffer[NumberUtil::kFastItoaBufferSize];
+  EXPECT_EQ("0", string(buffer, NumberUtil::FastItoa(0, buffer)));
+  EXPECT_EQ("-1", string(buffer, NumberUtil::FastItoa(-1, buffer)));
+  EXPECT_EQ("-2147483648",
+            string(buffer, NumberUtil::FastItoa(kint32min, buffer)));
+  EXPECT_EQ("4294967295",
+            string(buffer, NumberUtil::FastItoa(kuint32max, buffer)));
+  EXPECT_EQ("-9223372036854775808",
+            string(buffer, NumberUtil::FastItoa(kint64min, buffer)));
+  EXPECT_EQ("18446744073709551615",
+            string(buffer, NumberUtil::FastItoa(kuint64max, buffer)));
+}
+
+TEST(NumberUtilTest, ConvertDigits) {
+  char buffer[32];
+  EXPECT_EQ("0129", string(buffer, NumberUtil::ConvertDigits(
+      "0129", NumberUtil::HALFWIDTH_DIGITS, buffer, sizeof(buffer))));
+  // "０１２９"
+  EXPECT_EQ("\xEF\xBC\x90\xEF\xBC\x91\xEF\xBC\x92\xEF\xBC\x99",
+            string(buffer, NumberUtil::ConvertDigits(
+                "0129", NumberUtil::FULLWIDTH_DIGITS, buffer,
+                sizeof(buffer))));
+  // "〇一二九"
+  EXPECT_EQ("\xE3\x80\x87\xE4\xB8\x80\xE4\xBA\x8C\xE4\xB9\x9D",
+            string(buffer, NumberUtil::ConvertDigits(
+                "0129", NumberUtil::KANJI_DIGITS, buffer, sizeof(buffer))));
+
+  // Non-digit.
+  EXPECT_EQ(0, NumberUtil::ConvertDigits(
+      "12a", NumberUtil::HALFWIDTH_DIGITS, buffer, sizeof(buffer)));
+  // Too small buffer.
+  EXPECT_EQ(0, NumberUtil::ConvertDigits(
+      "123", NumberUtil::KANJI_DIGITS, buffer, 8));
+  EXPECT_EQ(9, NumberUtil::ConvertDigits(
+      "123", NumberUtil::KANJI_DIGITS, buffer, 9));
+}
+
 TEST(NumberUtilTest, SimpleAtoi) {
   EXPECT_EQ(0, NumberUtil::SimpleAtoi("0"));
   EXPECT_EQ(123, NumberUtil::SimpleAtoi("123"));
@@ -1213,6 +1251,53 @@ TEST(NumberUtilTest, ArabicToOtherFormsTest) {
 }
 
 // ArabicToOtherRadixes
+TEST(NumberUtilTest, ArabicToNumberStrings) {
+  const char *kInputs[] = {
+    "0", "1", "10", "20", "1000", "12345", "100000000", "00123", "1.5",
+    "18446744073709551616", "",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    SCOPED_TRACE(kInputs[i]);
+    std::vector<NumberUtil::NumberString> expected;
+    expected.push_back(NumberUtil::NumberString(
+        kInputs[i], "", NumberUtil::NumberString::DEFAULT_STYLE));
+    NumberUtil::ArabicToWideArabic(kInputs[i], &expected);
+    NumberUtil::ArabicToSeparatedArabic(kInputs[i], &expected);
+    NumberUtil::ArabicToKanji(kInputs[i], &expected);
+    NumberUtil::ArabicToOtherForms(kInputs[i], &expected);
+    NumberUtil::ArabicToOtherRadixes(kInputs[i], &expected);
+
+    std::vector<NumberUtil::NumberString> actual;
+    EXPECT_TRUE(NumberUtil::ArabicToNumberStrings(
+        kInputs[i],
+        NumberUtil::HALF_ARABIC | NumberUtil::WIDE_ARABIC |
+        NumberUtil::SEPARATED_ARABIC | NumberUtil::KANJI |
+        NumberUtil::OTHER_FORMS | NumberUtil::OTHER_RADIXES,
+        &actual));
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].value, actual[j].value);
+      EXPECT_EQ(expected[j].description, actual[j].description);
+      EXPECT_EQ(expected[j].style, actual[j].style);
+    }
+  }
+
+  // KANJI_FIRST moves the kanji forms to the front.
+  std::vector<NumberUtil::NumberString> output;
+  EXPECT_TRUE(NumberUtil::ArabicToNumberStrings(
+      "20", NumberUtil::HALF_ARABIC | NumberUtil::KANJI |
+      NumberUtil::KANJI_FIRST, &output));
+  ASSERT_LE(2, output.size());
+  // "二十"
+  EXPECT_EQ("\xE4\xBA\x8C\xE5\x8D\x81", output[0].value);
+  EXPECT_EQ("20", output.back().value);
+
+  output.clear();
+  EXPECT_FALSE(NumberUtil::ArabicToNumberStrings(
+      "abc", NumberUtil::KANJI | NumberUtil::OTHER_RADIXES, &output));
+  EXPECT_TRUE(output.empty());
+}
+
 TEST(NumberUtilTest, ArabicToOtherRadixesTest) {
   string arabic;
   std::vector<NumberUtil::NumberString> output;
@@ -0,0 +1,230 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/perf_counter.h"
+
+#ifdef OS_WIN
+#include <Windows.h>
+#else  // OS_WIN
+#ifdef OS_MACOSX
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#endif  // OS_MACOSX
+#include <time.h>
+#endif  // OS_WIN
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MOZC_PERF_COUNTER_USE_TSC
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif  // OS_LINUX && x86
+
+namespace mozc {
+namespace {
+
+const uint64 kNanosecondsPerSecond = 1000000000ULL;
+
+// Returns the monotonic time of the OS in nanoseconds on POSIX, or the
+// ticks of the performance counter on Windows.
+uint64 GetOSTicks() {
+#if defined(OS_WIN)
+  LARGE_INTEGER counter;
+  ::QueryPerformanceCounter(&counter);
+  return static_cast<uint64>(counter.QuadPart);
+#elif defined(OS_MACOSX)
+  return mach_absolute_time();
+#else  // POSIX
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64>(ts.tv_sec) * kNanosecondsPerSecond + ts.tv_nsec;
+#endif  // OS_WIN, OS_MACOSX or POSIX
+}
+
+uint64 GetOSFrequency() {
+#if defined(OS_WIN)
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  return static_cast<uint64>(frequency.QuadPart);
+#elif defined(OS_MACOSX)
+  mach_timebase_info_data_t timebase_info;
+  mach_timebase_info(&timebase_info);
+  return static_cast<uint64>(
+      1.0e9 * timebase_info.denom / timebase_info.numer);
+#else  // POSIX
+  return kNanosecondsPerSecond;
+#endif  // OS_WIN, OS_MACOSX or POSIX
+}
+
+#ifdef MOZC_PERF_COUNTER_USE_TSC
+// The TSC of the processors which don't advertise the invariant TSC may
+// change its rate with the power state.
+bool HasInvariantTSC() {
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+      eax < 0x80000007) {
+    return false;
+  }
+  if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+    return false;
+  }
+  return (edx & (1 << 8)) != 0;
+}
+
+// Measures the TSC rate against the OS clock over |kCalibrationNanoseconds|.
+// Returns 0 if the rate is implausible.
+uint64 CalibrateTSC() {
+  const uint64 kCalibrationNanoseconds = 2 * 1000 * 1000;  // 2 msec.
+  const uint64 begin_nanoseconds = GetOSTicks();
+  const uint64 begin_tsc = __rdtsc();
+  uint64 end_nanoseconds = begin_nanoseconds;
+  while (end_nanoseconds - begin_nanoseconds < kCalibrationNanoseconds) {
+    end_nanoseconds = GetOSTicks();
+  }
+  const uint64 end_tsc = __rdtsc();
+  if (end_tsc <= begin_tsc) {
+    return 0;
+  }
+  const double frequency =
+      static_cast<double>(end_tsc - begin_tsc) * kNanosecondsPerSecond /
+      (end_nanoseconds - begin_nanoseconds);
+  // Less than 100 MHz is not a TSC of a processor running this code.
+  return frequency < 1.0e8 ? 0 : static_cast<uint64>(frequency);
+}
+#endif  // MOZC_PERF_COUNTER_USE_TSC
+
+struct TickSource {
+  bool use_tsc;
+  uint64 frequency;
+};
+
+TickSource InitTickSource() {
+  TickSource source = {false, GetOSFrequency()};
+#ifdef MOZC_PERF_COUNTER_USE_TSC
+  if (HasInvariantTSC()) {
+    const uint64 frequency = CalibrateTSC();
+    if (frequency != 0) {
+      source.use_tsc = true;
+      source.frequency = frequency;
+    }
+  }
+#endif  // MOZC_PERF_COUNTER_USE_TSC
+  return source;
+}
+
+const TickSource &GetTickSource() {
+  static const TickSource source = InitTickSource();
+  return source;
+}
+
+// Converts |ticks| to the |units_per_second| units without overflowing for
+// the intervals of the instrumentation.
+uint64 ConvertTicks(uint64 ticks, uint64 units_per_second) {
+  const uint64 frequency = GetTickSource().frequency;
+  const uint64 seconds = ticks / frequency;
+  const uint64 remainder = ticks % frequency;
+  return seconds * units_per_second + remainder * units_per_second / frequency;
+}
+
+}  // namespace
+
+std::atomic<bool> PerfCounter::enabled_(false);
+
+// static
+uint64 PerfCounter::GetTicks() {
+#ifdef MOZC_PERF_COUNTER_USE_TSC
+  if (GetTickSource().use_tsc) {
+    return __rdtsc();
+  }
+#endif  // MOZC_PERF_COUNTER_USE_TSC
+  return GetOSTicks();
+}
+
+// static
+uint64 PerfCounter::GetFrequency() {
+  return GetTickSource().frequency;
+}
+
+// static
+uint64 PerfCounter::TicksToNanoseconds(uint64 ticks) {
+  return ConvertTicks(ticks, kNanosecondsPerSecond);
+}
+
+// static
+uint64 PerfCounter::TicksToMicroseconds(uint64 ticks) {
+  return ConvertTicks(ticks, 1000000);
+}
+
+// static
+uint64 PerfCounter::GetThreadCPUNanoseconds() {
+#if defined(OS_WIN)
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!::GetThreadTimes(::GetCurrentThread(), &creation_time, &exit_time,
+                        &kernel_time, &user_time)) {
+    return 0;
+  }
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernel_time.dwLowDateTime;
+  kernel.HighPart = kernel_time.dwHighDateTime;
+  user.LowPart = user_time.dwLowDateTime;
+  user.HighPart = user_time.dwHighDateTime;
+  // FILETIME is in 100 nanoseconds.
+  return (kernel.QuadPart + user.QuadPart) * 100;
+#elif defined(OS_MACOSX)
+  mach_port_t thread = mach_thread_self();
+  thread_basic_info_data_t info;
+  mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+  const kern_return_t result = thread_info(
+      thread, THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info),
+      &count);
+  mach_port_deallocate(mach_task_self(), thread);
+  if (result != KERN_SUCCESS) {
+    return 0;
+  }
+  return (static_cast<uint64>(info.user_time.seconds) +
+          info.system_time.seconds) * kNanosecondsPerSecond +
+         (static_cast<uint64>(info.user_time.microseconds) +
+          info.system_time.microseconds) * 1000;
+#elif defined(OS_NACL)
+  return 0;
+#else  // POSIX
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return 0;
+  }
+  return static_cast<uint64>(ts.tv_sec) * kNanosecondsPerSecond + ts.tv_nsec;
+#endif  // OS_WIN, OS_MACOSX, OS_NACL or POSIX
+}
+
+// static
+bool PerfCounter::IsTSCUsed() {
+  return GetTickSource().use_tsc;
+}
+
+}  // namespace mozc
@@ -0,0 +1,124 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// PerfCounter is the clock for the instrumentation of the server, e.g. the
+// traces and the latency stats.  Unlike Clock::GetTicks(), which may follow
+// the wall clock and is replaced by ClockMock in tests, the ticks are
+// monotonic and cheap to read: the invariant TSC on x86 calibrated once
+// against the OS clock, or the monotonic clock of the OS otherwise.  It also
+// samples the CPU time of the current thread.
+//
+// The measurements are taken only while PerfCounter::IsEnabled(), which is a
+// relaxed atomic load, so that the instrumented code costs almost nothing
+// by default.
+//
+// usage:
+// uint64 wall_nsec = 0, cpu_nsec = 0;
+// {
+//   PerfCounter::Scope scope(&wall_nsec, &cpu_nsec);
+//   ...
+// }
+// // |wall_nsec| and |cpu_nsec| are left 0 if the counter is disabled.
+
+#ifndef MOZC_BASE_PERF_COUNTER_H_
+#define MOZC_BASE_PERF_COUNTER_H_
+
+#include <atomic>
+
+#include "base/port.h"
+
+namespace mozc {
+
+class PerfCounter {
+ public:
+  // The counter is disabled by default.
+  static void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the monotonic ticks and the number of ticks per second.  The
+  // first call may take a few milliseconds for the calibration.
+  static uint64 GetTicks();
+  static uint64 GetFrequency();
+
+  static uint64 TicksToNanoseconds(uint64 ticks);
+  static uint64 TicksToMicroseconds(uint64 ticks);
+
+  // Returns the CPU time consumed by the current thread in nanoseconds, or 0
+  // if the platform doesn't provide it.
+  static uint64 GetThreadCPUNanoseconds();
+
+  // Returns true if GetTicks() reads the TSC.
+  static bool IsTSCUsed();
+
+  // Measures the wall time and the CPU time of the current thread from the
+  // construction to the destruction if the counter is enabled at the
+  // construction.  Either of the outputs can be NULL.
+  class Scope {
+   public:
+    Scope(uint64 *wall_nanoseconds, uint64 *cpu_nanoseconds)
+        : wall_nanoseconds_(IsEnabled() ? wall_nanoseconds : nullptr),
+          cpu_nanoseconds_(IsEnabled() ? cpu_nanoseconds : nullptr),
+          begin_ticks_(wall_nanoseconds_ != nullptr ? GetTicks() : 0),
+          begin_cpu_nanoseconds_(cpu_nanoseconds_ != nullptr ?
+                                 GetThreadCPUNanoseconds() : 0) {}
+    ~Scope() {
+      if (cpu_nanoseconds_ != nullptr) {
+        *cpu_nanoseconds_ = GetThreadCPUNanoseconds() - begin_cpu_nanoseconds_;
+      }
+      if (wall_nanoseconds_ != nullptr) {
+        // The TSCs of the processors may differ slightly when the thread
+        // moves between them.
+        const uint64 end_ticks = GetTicks();
+        *wall_nanoseconds_ = end_ticks > begin_ticks_ ?
+            TicksToNanoseconds(end_ticks - begin_ticks_) : 0;
+      }
+    }
+
+   private:
+    uint64 *wall_nanoseconds_;
+    uint64 *cpu_nanoseconds_;
+    const uint64 begin_ticks_;
+    const uint64 begin_cpu_nanoseconds_;
+
+    DISALLOW_COPY_AND_ASSIGN(Scope);
+  };
+
+ private:
+  static std::atomic<bool> enabled_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(PerfCounter);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_PERF_COUNTER_H_
@@ -0,0 +1,128 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/perf_counter.h"
+
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class PerfCounterTest : public testing::Test {
+ protected:
+  void TearDown() override {
+    PerfCounter::SetEnabled(false);
+  }
+};
+
+// Burns the CPU time of the current thread for about |nanoseconds|.
+void BusyLoop(uint64 nanoseconds) {
+  const uint64 begin_ticks = PerfCounter::GetTicks();
+  volatile uint64 sink = 0;
+  while (PerfCounter::TicksToNanoseconds(PerfCounter::GetTicks() -
+                                         begin_ticks) < nanoseconds) {
+    for (int i = 0; i < 1000; ++i) {
+      sink += i;
+    }
+  }
+}
+
+TEST_F(PerfCounterTest, Ticks) {
+  const uint64 frequency = PerfCounter::GetFrequency();
+  ASSERT_LT(0, frequency);
+
+  const uint64 begin_ticks = PerfCounter::GetTicks();
+  Util::Sleep(50);
+  const uint64 end_ticks = PerfCounter::GetTicks();
+  ASSERT_LE(begin_ticks, end_ticks);
+
+  // Sleep() may take longer on a busy machine but never shorter.
+  const uint64 elapsed_usec =
+      PerfCounter::TicksToMicroseconds(end_ticks - begin_ticks);
+  EXPECT_LE(45 * 1000, elapsed_usec);
+  EXPECT_GT(10 * 1000 * 1000, elapsed_usec);
+}
+
+TEST_F(PerfCounterTest, TicksToNanoseconds) {
+  const uint64 frequency = PerfCounter::GetFrequency();
+  EXPECT_EQ(0, PerfCounter::TicksToNanoseconds(0));
+  EXPECT_EQ(1000000000, PerfCounter::TicksToNanoseconds(frequency));
+  EXPECT_EQ(1000000, PerfCounter::TicksToMicroseconds(frequency));
+  // One day does not overflow.
+  EXPECT_EQ(86400ULL * 1000000000,
+            PerfCounter::TicksToNanoseconds(86400 * frequency));
+}
+
+TEST_F(PerfCounterTest, ThreadCPUTime) {
+  const uint64 begin_nsec = PerfCounter::GetThreadCPUNanoseconds();
+  if (begin_nsec == 0) {
+    LOG(INFO) << "The thread CPU time is not available. Skipping.";
+    return;
+  }
+  BusyLoop(20 * 1000 * 1000);
+  EXPECT_LT(begin_nsec, PerfCounter::GetThreadCPUNanoseconds());
+}
+
+TEST_F(PerfCounterTest, ScopeIsNoopWhileDisabled) {
+  ASSERT_FALSE(PerfCounter::IsEnabled());
+  uint64 wall_nsec = 0, cpu_nsec = 0;
+  {
+    PerfCounter::Scope scope(&wall_nsec, &cpu_nsec);
+    BusyLoop(1000 * 1000);
+  }
+  EXPECT_EQ(0, wall_nsec);
+  EXPECT_EQ(0, cpu_nsec);
+}
+
+TEST_F(PerfCounterTest, Scope) {
+  PerfCounter::SetEnabled(true);
+  uint64 wall_nsec = 0, cpu_nsec = 0;
+  {
+    PerfCounter::Scope scope(&wall_nsec, &cpu_nsec);
+    BusyLoop(10 * 1000 * 1000);
+  }
+  EXPECT_LE(10 * 1000 * 1000, wall_nsec);
+  if (PerfCounter::GetThreadCPUNanoseconds() != 0) {
+    EXPECT_LT(0, cpu_nsec);
+  }
+
+  // Either of the outputs can be omitted.
+  uint64 only_wall_nsec = 0;
+  {
+    PerfCounter::Scope scope(&only_wall_nsec, nullptr);
+    BusyLoop(1000 * 1000);
+  }
+  EXPECT_LE(1000 * 1000, only_wall_nsec);
+}
+
+}  // namespace
+}  // namespace mozc
@@ -29,9 +29,10 @@
 
 #include "base/scheduler.h"
 
+#include <algorithm>
 #include <cstdlib>
-#include <functional>
 #include <map>
+#include <memory>
 #include <utility>
 
 #include "base/clock.h"
@@ -40,172 +41,158 @@
 #include "base/port.h"
 #include "base/singleton.h"
 #include "base/thread.h"
+#include "base/thread_pool.h"
 #include "base/unnamed_event.h"
 #include "base/util.h"
 
 namespace mozc {
 namespace {
 
-class TimerThread final : public Thread {
- public:
-  TimerThread(std::function<void()> callback,
-              uint32 due_time,
-              uint32 interval)
-      : callback_(callback),
-        due_time_(due_time),
-        interval_(interval) {
-    CHECK(due_time_ != 0 || interval_ != 0)
-        << "Either of due_time or interval must be non 0.";
-  }
-
-  ~TimerThread() override {
-    SignalQuit();
-    Join();
+// A job may run earlier than its due time by this fraction of its interval
+// so that it shares a wakeup with another job, but not by more than
+// kMaxCoalesceMsec.
+const uint32 kCoalesceIntervalDivisor = 8;
+const uint64 kMaxCoalesceMsec = 60 * 1000;  // 1 min.
+
+// The user is regarded as active for kUserActiveMsec after the last
+// NotifyUserActivity().  Jobs due while the user is active wait for the user
+// to become idle, but not longer than kMaxIdleWaitMsec.
+const uint64 kUserActiveMsec = 2 * 1000;      // 2 sec.
+const uint64 kMaxIdleWaitMsec = 60 * 1000;    // 1 min.
+
+// Returns the monotonic time in milliseconds.
+uint64 GetCurrentMsec() {
+  const uint64 frequency = Clock::GetFrequency();
+  if (frequency >= 1000) {
+    return Clock::GetTicks() / (frequency / 1000);
   }
-
-  void Run() override {
-    if (event_.Wait(due_time_)) {
-      VLOG(1) << "Received notification event";
-      return;
-    }
-
-    VLOG(2) << "call TimerCallback()";
-    callback_();
-
-    if (interval_ == 0) {
-      VLOG(2) << "Run() end";
-      return;
-    }
-
-    while (true) {
-      if (event_.Wait(interval_)) {
-        VLOG(1) << "Received notification event";
-        return;
-      }
-      VLOG(2) << "call TimerCallback()";
-      callback_();
-    }
-  }
-
- private:
-  void SignalQuit() {
-    const bool result = event_.Notify();
-    DCHECK(result);
-  }
-
-  std::function<void()> callback_;
-
-  // The amount of time to elapse before the timer is to be set to the
-  // signaled state for the first time, in milliseconds.
-  uint32 due_time_;
-
-  // The period of the timer, in milliseconds. If this is zero, the
-  // timer is one-shot timer. If this is greater than zero, the timer
-  // is periodic.
-  uint32 interval_;
-
-  UnnamedEvent event_;
-
-  DISALLOW_COPY_AND_ASSIGN(TimerThread);
-};
-
-class QueueTimer final {
- public:
-  QueueTimer(std::function<void()> callback,
-             uint32 due_time,
-             uint32 period)
-      : timer_thread_(callback, due_time, period) {
-  }
-
-  void Start() {
-    timer_thread_.Start("QueueTimer");
-  }
-
- private:
-  TimerThread timer_thread_;
-
-  DISALLOW_COPY_AND_ASSIGN(QueueTimer);
-};
+  return Clock::GetTicks() * 1000 / frequency;
+}
 
 class Job {
  public:
-  explicit Job(const Scheduler::JobSetting &setting) :
-      setting_(setting),
-      skip_count_(0),
-      backoff_count_(0),
-      timer_(NULL),
-      running_(false) {}
-
-  ~Job() {
-    set_timer(NULL);
-  }
-
-  const Scheduler::JobSetting setting() const {
+  Job(const Scheduler::JobSetting &setting, uint64 due_msec)
+      : setting_(setting),
+        skip_count_(0),
+        backoff_count_(0),
+        due_msec_(due_msec),
+        succeeded_(false) {}
+
+  const Scheduler::JobSetting &setting() const {
     return setting_;
   }
 
-  void set_skip_count(uint32 skip_count) {
-    skip_count_ = skip_count;
-  }
-
-  uint32 skip_count() const {
-    return skip_count_;
+  uint64 due_msec() const {
+    return due_msec_;
   }
 
-  void set_backoff_count(uint32 backoff_count) {
-    backoff_count_ = backoff_count;
+  // Returns how much earlier than due_msec() the job may run.
+  uint64 coalesce_msec() const {
+    return std::min<uint64>(
+        setting_.default_interval() / kCoalesceIntervalDivisor,
+        kMaxCoalesceMsec);
   }
 
-  uint32 backoff_count() const {
-    return backoff_count_;
-  }
-
-  void set_timer(QueueTimer *timer) {
-    if (timer_ != NULL) {
-      delete timer_;
+  // Called by the timer thread on each tick of the job.  Starts the callback
+  // on |pool| unless the previous call is still running or the job is
+  // backing off.
+  void Tick(uint64 now_msec, ThreadPool *pool) {
+    due_msec_ = now_msec + setting_.default_interval();
+    if (task_ != nullptr) {
+      if (!task_->IsDone()) {
+        return;
+      }
+      UpdateBackoff(succeeded_);
+      task_.reset();
     }
-    timer_ = timer;
-  }
-
-  const QueueTimer *timer() const {
-    return timer_;
-  }
-
-  QueueTimer *mutable_timer() {
-    return timer_;
+    if (skip_count_ > 0) {
+      --skip_count_;
+      VLOG(3) << "Backoff = " << backoff_count_
+              << " skip_count = " << skip_count_;
+      return;
+    }
+    VLOG(2) << "Run " << setting_.name();
+    task_ = pool->Schedule(ThreadPool::BACKGROUND, [this]() {
+      Scheduler::JobSetting::CallbackFunc callback = setting_.callback();
+      DCHECK(callback != NULL);
+      succeeded_ = callback(setting_.data());
+    });
   }
 
-  void set_running(bool running) {
-    running_ = running;
+  // Prevents the callback from starting and waits for the running one.  Must
+  // be called without the lock of the scheduler.
+  void Stop() {
+    if (task_ != nullptr) {
+      task_->Cancel();
+      task_->Wait();
+      task_.reset();
+    }
   }
 
-  bool running() const {
-    return running_;
+ private:
+  void UpdateBackoff(bool success) {
+    if (success) {
+      backoff_count_ = 0;
+      return;
+    }
+    const uint32 new_backoff_count = (backoff_count_ == 0) ?
+        1 : backoff_count_ * 2;
+    if (new_backoff_count * setting_.default_interval()
+        < setting_.max_interval()) {
+      backoff_count_ = new_backoff_count;
+    }
+    skip_count_ = backoff_count_;
   }
 
- private:
-  Scheduler::JobSetting setting_;
+  const Scheduler::JobSetting setting_;
   uint32 skip_count_;
   uint32 backoff_count_;
-  QueueTimer *timer_;
-  bool running_;
+  uint64 due_msec_;
+  // The last call of the callback.  |succeeded_| is written by the task and
+  // read only after the task is done.
+  ThreadPool::TaskHandle task_;
+  bool succeeded_;
 
-  // TODO(hsumita): Use DISALLOW_COPY_AND_ASSIGN(Job).
+  DISALLOW_COPY_AND_ASSIGN(Job);
 };
 
+// All the jobs share one timer thread, which sleeps until the earliest due
+// time and then runs every job due within its coalescing window, so jobs due
+// close together cause a single wakeup.  The callbacks run on the shared
+// ThreadPool so that a slow job doesn't delay the others.
 class SchedulerImpl : public Scheduler::SchedulerInterface {
  public:
-  SchedulerImpl() {
+  SchedulerImpl()
+      // The pool is obtained first so that the singleton outlives this.
+      : pool_(ThreadPool::GetSharedInstance()),
+        last_activity_msec_(0),
+        has_activity_(false),
+        quit_(false),
+        timer_thread_(this) {
     Util::SetRandomSeed(static_cast<uint32>(Clock::GetTime()));
+    timer_thread_.SetJoinable(true);
+    timer_thread_.Start("Scheduler");
   }
 
   virtual ~SchedulerImpl() {
     RemoveAllJobs();
+    {
+      scoped_lock l(&mutex_);
+      quit_ = true;
+    }
+    wake_event_.Notify();
+    timer_thread_.Join();
   }
 
   virtual void RemoveAllJobs() {
-    scoped_lock l(&mutex_);
-    jobs_.clear();
+    std::map<string, std::unique_ptr<Job>> jobs;
+    {
+      scoped_lock l(&mutex_);
+      jobs.swap(jobs_);
+    }
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+      it->second->Stop();
+    }
   }
 
   void ValidateSetting(const Scheduler::JobSetting &job_setting) const {
@@ -217,78 +204,124 @@ class SchedulerImpl : public Scheduler::SchedulerInterface {
   }
 
   virtual bool AddJob(const Scheduler::JobSetting &job_setting) {
-    scoped_lock l(&mutex_);
-
-    ValidateSetting(job_setting);
-    if (HasJob(job_setting.name())) {
-      LOG(WARNING) << "Job " << job_setting.name() << " is already registered";
-      return false;
-    }
+    {
+      scoped_lock l(&mutex_);
+
+      ValidateSetting(job_setting);
+      if (HasJobLocked(job_setting.name())) {
+        LOG(WARNING) << "Job " << job_setting.name()
+                     << " is already registered";
+        return false;
+      }
 
-    std::pair<std::map<string, Job>::iterator, bool> insert_result =
-        jobs_.insert(std::make_pair(job_setting.name(), Job(job_setting)));
-    if (!insert_result.second) {
-      LOG(ERROR) << "insert failed";
-      return false;
+      const uint64 due_msec = GetCurrentMsec() + CalcDelay(job_setting);
+      jobs_[job_setting.name()].reset(new Job(job_setting, due_msec));
     }
-    Job *job = &insert_result.first->second;
-    DCHECK(job);
-
-    const uint32 delay = CalcDelay(job_setting);
-    // DON'T copy job instance after set_timer() not to delete timer twice.
-    // TODO(hsumita): Make Job class uncopiable.
-    job->set_timer(new QueueTimer(std::bind(TimerCallback, job), delay,
-                                  job_setting.default_interval()));
-    if (job->timer() == NULL) {
-      LOG(ERROR) << "failed to create QueueTimer";
-      return false;
-    }
-    job->mutable_timer()->Start();
+    wake_event_.Notify();
     return true;
   }
 
   virtual bool RemoveJob(const string &name) {
-    scoped_lock l(&mutex_);
-    if (!HasJob(name)) {
-      LOG(WARNING) << "Job " << name << " is not registered";
-      return false;
+    std::unique_ptr<Job> job;
+    {
+      scoped_lock l(&mutex_);
+      std::map<string, std::unique_ptr<Job>>::iterator it = jobs_.find(name);
+      if (it == jobs_.end()) {
+        LOG(WARNING) << "Job " << name << " is not registered";
+        return false;
+      }
+      job = std::move(it->second);
+      jobs_.erase(it);
     }
-    return (jobs_.erase(name) != 0);
+    job->Stop();
+    return true;
   }
 
   virtual bool HasJob(const string &name) const {
-    return (jobs_.find(name) != jobs_.end());
+    scoped_lock l(&mutex_);
+    return HasJobLocked(name);
+  }
+
+  virtual void NotifyUserActivity() {
+    scoped_lock l(&mutex_);
+    last_activity_msec_ = GetCurrentMsec();
+    has_activity_ = true;
   }
 
  private:
-  static void TimerCallback(void *param) {
-    Job *job = reinterpret_cast<Job *>(param);
-    DCHECK(job);
-    if (job->running()) {
-      return;
+  class TimerThread : public Thread {
+   public:
+    explicit TimerThread(SchedulerImpl *scheduler) : scheduler_(scheduler) {}
+
+    void Run() override {
+      scheduler_->RunTimer();
     }
-    if (job->skip_count()) {
-      job->set_skip_count(job->skip_count() - 1);
-      VLOG(3) << "Backoff = " << job->backoff_count()
-              << " skip_count = " << job->skip_count();
-      return;
+
+   private:
+    SchedulerImpl *scheduler_;
+
+    DISALLOW_COPY_AND_ASSIGN(TimerThread);
+  };
+
+  bool HasJobLocked(const string &name) const {
+    return (jobs_.find(name) != jobs_.end());
+  }
+
+  void RunTimer() {
+    while (true) {
+      int32 wait_msec = -1;
+      {
+        scoped_lock l(&mutex_);
+        if (quit_) {
+          return;
+        }
+        wait_msec = RunDueJobsLocked(GetCurrentMsec());
+      }
+      // Woken up early by AddJob() and the destructor.
+      wake_event_.Wait(wait_msec);
     }
-    job->set_running(true);
-    Scheduler::JobSetting::CallbackFunc callback = job->setting().callback();
-    DCHECK(callback != NULL);
-    const bool success = callback(job->setting().data());
-    job->set_running(false);
-    if (success) {
-      job->set_backoff_count(0);
-    } else {
-      const uint32 new_backoff_count = (job->backoff_count() == 0) ?
-          1 : job->backoff_count() * 2;
-      if (new_backoff_count * job->setting().default_interval()
-          < job->setting().max_interval()) {
-        job->set_backoff_count(new_backoff_count);
+  }
+
+  // Ticks the jobs which are due at |now_msec| and returns the time until the
+  // next due job in milliseconds, or -1 if there is no job.
+  int32 RunDueJobsLocked(uint64 now_msec) {
+    // The time when the user becomes idle, or 0 if the user is idle.
+    uint64 idle_msec = 0;
+    if (has_activity_ && now_msec < last_activity_msec_ + kUserActiveMsec) {
+      idle_msec = last_activity_msec_ + kUserActiveMsec;
+    }
+
+    uint64 next_msec = 0;
+    for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+      Job *job = it->second.get();
+      uint64 run_msec = GetRunMsec(*job, now_msec, idle_msec);
+      if (run_msec <= now_msec) {
+        job->Tick(now_msec, pool_);
+        run_msec = GetRunMsec(*job, now_msec, idle_msec);
+      }
+      if (next_msec == 0 || run_msec < next_msec) {
+        next_msec = run_msec;
       }
-      job->set_skip_count(job->backoff_count());
     }
+    if (next_msec == 0) {
+      return -1;
+    }
+    // The wait is capped as UnnamedEvent::Wait() takes an int.
+    return static_cast<int32>(
+        std::min<uint64>(next_msec - now_msec, 24 * 60 * 60 * 1000));
+  }
+
+  // Returns the time to tick |job|, which may be earlier than its due time
+  // for coalescing, or later while the user is active until |idle_msec|.
+  static uint64 GetRunMsec(const Job &job, uint64 now_msec,
+                           uint64 idle_msec) {
+    const uint64 run_msec =
+        std::max(job.due_msec(), job.coalesce_msec()) - job.coalesce_msec();
+    if (idle_msec == 0 || run_msec > now_msec) {
+      return run_msec;
+    }
+    // Waits for the user unless the job is overdue for too long.
+    return std::min(idle_msec, job.due_msec() + kMaxIdleWaitMsec);
   }
 
   uint32 CalcDelay(const Scheduler::JobSetting &job_setting) {
@@ -299,8 +332,14 @@ class SchedulerImpl : public Scheduler::SchedulerInterface {
     return delay;
   }
 
-  std::map<string, Job> jobs_;
-  Mutex mutex_;
+  ThreadPool *pool_;
+  std::map<string, std::unique_ptr<Job>> jobs_;
+  uint64 last_activity_msec_;
+  bool has_activity_;
+  bool quit_;
+  mutable Mutex mutex_;
+  UnnamedEvent wake_event_;
+  TimerThread timer_thread_;
 
   DISALLOW_COPY_AND_ASSIGN(SchedulerImpl);
 };
@@ -332,6 +371,10 @@ bool Scheduler::HasJob(const string &name) {
   return GetSchedulerHandler()->HasJob(name);
 }
 
+void Scheduler::NotifyUserActivity() {
+  GetSchedulerHandler()->NotifyUserActivity();
+}
+
 void Scheduler::SetSchedulerHandler(SchedulerInterface *handler) {
   g_scheduler_handler = handler;
 }
@@ -34,6 +34,10 @@
 //    - Interval will be doubled as long as callback returns false, but
 //      will not exceed max_interval.
 //  2. Randomised delayed start to reduce server traffic peak.
+//  3. All the jobs share one timer thread.  A job due soon after another one
+//     runs together with it to save wakeups, and jobs due while the user is
+//     typing wait for a short idle time (see NotifyUserActivity()).
+//     The callbacks run on the shared ThreadPool.
 //
 // usage:
 // // start scheduled job
@@ -109,6 +113,10 @@ class Scheduler {
   // returns true is the job has been registered.
   static bool HasJob(const string &name);
 
+  // Tells that the user is active now.  Jobs due in a few seconds from this
+  // are delayed until the user stops, up to one minute.
+  static void NotifyUserActivity();
+
   // This function is provided for test.
   // The behavior of scheduler can be customized by replacing an underlying
   // helper class inside this.
@@ -124,6 +132,7 @@ class Scheduler {
     virtual bool RemoveJob(const string &name) = 0;
     virtual void RemoveAllJobs() = 0;
     virtual bool HasJob(const string &name) const = 0;
+    virtual void NotifyUserActivity() {}
   };
 
  private:
@@ -256,6 +256,47 @@ TEST_F(SchedulerTest, DontBlockOtherJobs) {
   EXPECT_TRUE(info.quit_event.Notify());
 }
 
+TEST_F(SchedulerTest, CoalesceJobDueSoon) {
+  class TestCallback {
+   public:
+    static bool Do(void *ptr) {
+      UnnamedEvent *event = static_cast<UnnamedEvent *>(ptr);
+      EXPECT_TRUE(event->Notify());
+      return true;
+    }
+  };
+
+  UnnamedEvent event;
+  ASSERT_TRUE(event.IsAvailable());
+  // The job is due in 50 sec, which is within the coalescing window of an
+  // hourly job, so it runs together with the wakeup for adding it.
+  ScopedJob job(Scheduler::JobSetting(
+      "Test", 60 * 60 * 1000, 60 * 60 * 1000, 50 * 1000, kNoRandomDelay,
+      &TestCallback::Do, &event));
+  ASSERT_TRUE(event.Wait(kTimeout));
+}
+
+TEST_F(SchedulerTest, WaitForUserIdle) {
+  class TestCallback {
+   public:
+    static bool Do(void *ptr) {
+      UnnamedEvent *event = static_cast<UnnamedEvent *>(ptr);
+      EXPECT_TRUE(event->Notify());
+      return false;
+    }
+  };
+
+  UnnamedEvent event;
+  ASSERT_TRUE(event.IsAvailable());
+  Scheduler::NotifyUserActivity();
+  ScopedJob job(Scheduler::JobSetting(
+      "Test", kShortPeriod, kShortPeriod, kImmediately, kNoRandomDelay,
+      &TestCallback::Do, &event));
+  // The job waits for the user to be idle for a few seconds.
+  EXPECT_FALSE(event.Wait(kMediumPeriod));
+  ASSERT_TRUE(event.Wait(kTimeout));
+}
+
 class NameCheckScheduler : public Scheduler::SchedulerInterface {
  public:
   explicit NameCheckScheduler(const string &expected_name)
@@ -35,13 +35,18 @@
 #include <cstdlib>
 #endif  // OS_WIN
 
+#include <atomic>
+
 #include "base/mutex.h"
 
 namespace mozc {
 namespace {
 
 const size_t kMaxFinalizersSize = 256;
-size_t g_finalizers_size = 0;
+// Singletons can be constructed on different threads at the same time, e.g.
+// by SingletonInitializer on its background thread and by a key event, so a
+// slot is claimed atomically.
+std::atomic<size_t> g_finalizers_size(0);
 
 SingletonFinalizer::FinalizerFunc g_finalizers[kMaxFinalizersSize];
 
@@ -66,22 +71,17 @@ void ExitWithError() {
 }  // namespace
 
 void SingletonFinalizer::AddFinalizer(FinalizerFunc func) {
-  // When g_finalizers_size is equal to kMaxFinalizersSize,
-  // SingletonFinalizer::Finalize is called already.
-  if (g_finalizers_size >= kMaxFinalizersSize) {
+  const size_t index = g_finalizers_size.fetch_add(1);
+  if (index >= kMaxFinalizersSize) {
     ExitWithError();
   }
-  // This part is not thread safe.
-  // When two different classes are instantiated at the same time,
-  // this code will raise an exception.
-  g_finalizers[g_finalizers_size++] = func;
+  g_finalizers[index] = func;
 }
 
 void SingletonFinalizer::Finalize() {
-  // This part is not thread safe.
-  // When two different classes are instantiated at the same time,
-  // this code will raise an exception.
-  for (int i = static_cast<int>(g_finalizers_size) - 1; i >= 0; --i) {
+  // This part is not thread safe.  No singleton should be instantiated while
+  // finalizing.
+  for (int i = static_cast<int>(g_finalizers_size.load()) - 1; i >= 0; --i) {
     (*g_finalizers[i])();
   }
   g_finalizers_size = 0;
@@ -29,8 +29,11 @@
 
 #include "base/text_normalizer.h"
 
+#include <cstring>
 #include <string>
 
+#include "base/logging.h"
+#include "base/utf8_kernel.h"
 #include "base/util.h"
 
 namespace mozc {
@@ -62,14 +65,61 @@ inline char32 NormalizeCharForWindows(char32 c) {
       break;
   }
 }
+
+// Returns the byte offset of the first character in |input| that
+// NormalizeText() rewrites, or input.size() if there is none.  Besides the
+// characters handled by NormalizeCharForWindows(), the re-encoding loop drops
+// NUL characters, stops at an invalid sequence and rewrites non-canonical
+// encodings, so those positions are reported as well.
+size_t FindFirstChange(StringPiece input) {
+  const char *begin = input.data();
+  const size_t size = input.size();
+  size_t pos = Utf8Kernel::AsciiPrefixLength(begin, size);
+  // Within the ASCII prefix only a NUL byte can be changed.
+  const void *nul = memchr(begin, '\0', pos);
+  if (nul != NULL) {
+    return static_cast<const char *>(nul) - begin;
+  }
+  char encoded[7];
+  while (pos < size) {
+    if (begin[pos] == '\0') {
+      return pos;
+    }
+    if (static_cast<unsigned char>(begin[pos]) < 0x80) {
+      ++pos;
+      continue;
+    }
+    char32 c = 0;
+    StringPiece rest;
+    if (!Util::SplitFirstChar32(StringPiece(begin + pos, size - pos),
+                                &c, &rest)) {
+      return pos;
+    }
+    const size_t mblen = size - pos - rest.size();
+    if (NormalizeCharForWindows(c) != c ||
+        Util::UCS4ToUTF8(c, encoded) != mblen) {
+      return pos;
+    }
+    pos += mblen;
+  }
+  return size;
+}
 #endif  // OS_WIN
 
 }  // namespace
 
+// static
 void TextNormalizer::NormalizeText(StringPiece input, string *output) {
 #ifdef OS_WIN
-  output->clear();
-  for (ConstChar32Iterator iter(input); !iter.Done(); iter.Next()) {
+  // The unchanged prefix is copied as is; only the rest is re-encoded.
+  const size_t prefix_len = FindFirstChange(input);
+  output->assign(input.data(), prefix_len);
+  if (prefix_len == input.size()) {
+    return;
+  }
+  output->reserve(input.size());
+  for (ConstChar32Iterator iter(input.substr(prefix_len));
+       !iter.Done(); iter.Next()) {
     Util::UCS4ToUTF8Append(NormalizeCharForWindows(iter.Get()), output);
   }
 #else
@@ -77,4 +127,55 @@ void TextNormalizer::NormalizeText(StringPiece input, string *output) {
 #endif
 }
 
+// static
+bool TextNormalizer::NeedsNormalization(StringPiece input) {
+#ifdef OS_WIN
+  return FindFirstChange(input) != input.size();
+#else
+  return false;
+#endif
+}
+
+// static
+StringPiece TextNormalizer::NormalizeTextIfNeeded(StringPiece input,
+                                                  string *buffer) {
+  if (!NeedsNormalization(input)) {
+    return input;
+  }
+  NormalizeText(input, buffer);
+  return *buffer;
+}
+
+// static
+bool TextNormalizer::NormalizeTextInPlace(string *text) {
+  DCHECK(text);
+#ifdef OS_WIN
+  size_t pos = FindFirstChange(*text);
+  if (pos == text->size()) {
+    return false;
+  }
+  // Both WAVE DASH (E3 80 9C) and MINUS SIGN (E2 88 92) are replaced by
+  // 3-byte sequences, so they can be overwritten without moving the rest.
+  // Anything else falls back to the copying path.
+  while (pos < text->size()) {
+    char *p = &(*text)[pos];
+    if (text->compare(pos, 3, "\xE3\x80\x9C") == 0) {
+      memcpy(p, "\xEF\xBD\x9E", 3);  // FULLWIDTH TILDE
+    } else if (text->compare(pos, 3, "\xE2\x88\x92") == 0) {
+      memcpy(p, "\xEF\xBC\x8D", 3);  // FULLWIDTH HYPHEN MINUS
+    } else {
+      string normalized;
+      NormalizeText(*text, &normalized);
+      text->swap(normalized);
+      return true;
+    }
+    pos += 3;
+    pos += FindFirstChange(StringPiece(*text).substr(pos));
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
 }  // namespace mozc
@@ -43,6 +43,18 @@ class TextNormalizer {
  public:
   static void NormalizeText(StringPiece input, string *output);
 
+  // Returns true if NormalizeText() would produce a string different from
+  // |input|.  This is a read-only scan and never allocates.
+  static bool NeedsNormalization(StringPiece input);
+
+  // Returns |input| itself when it needs no normalization.  Otherwise
+  // normalizes |input| into |buffer| and returns a piece referring to it.
+  // The returned piece is valid as long as both |input| and |buffer| are.
+  static StringPiece NormalizeTextIfNeeded(StringPiece input, string *buffer);
+
+  // Normalizes |text| in place.  Returns true if |text| was modified.
+  static bool NormalizeTextInPlace(string *text);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(TextNormalizer);
 };
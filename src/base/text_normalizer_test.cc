@@ -84,4 +84,78 @@ TEST(TextNormalizerTest, NormalizeText) {
   EXPECT_EQ("\xC2\xA5\x32\x39\x38", output);
 }
 
+TEST(TextNormalizerTest, NeedsNormalization) {
+  EXPECT_FALSE(TextNormalizer::NeedsNormalization(""));
+  EXPECT_FALSE(TextNormalizer::NeedsNormalization("google"));
+  // "めかぶ"
+  EXPECT_FALSE(TextNormalizer::NeedsNormalization(
+      "\xe3\x82\x81\xe3\x81\x8b\xe3\x81\xb6"));
+  // "¥298"
+  EXPECT_FALSE(TextNormalizer::NeedsNormalization("\xC2\xA5\x32\x39\x38"));
+#ifdef OS_WIN
+  // "ぐ〜ぐる"
+  EXPECT_TRUE(TextNormalizer::NeedsNormalization(
+      "\xe3\x81\x90\xe3\x80\x9c\xe3\x81\x90\xe3\x82\x8b"));
+  // "1−2": "−" is U+2212
+  EXPECT_TRUE(TextNormalizer::NeedsNormalization("1\xE2\x88\x92" "2"));
+  // An invalid sequence is dropped by NormalizeText().
+  EXPECT_TRUE(TextNormalizer::NeedsNormalization("abc\xE3\x81"));
+  EXPECT_TRUE(TextNormalizer::NeedsNormalization(StringPiece("a\0b", 3)));
+#else
+  EXPECT_FALSE(TextNormalizer::NeedsNormalization(
+      "\xe3\x81\x90\xe3\x80\x9c\xe3\x81\x90\xe3\x82\x8b"));
+  EXPECT_FALSE(TextNormalizer::NeedsNormalization("1\xE2\x88\x92" "2"));
+#endif
+}
+
+TEST(TextNormalizerTest, NormalizeTextIfNeeded) {
+  string buffer;
+  // "めかぶ"
+  const StringPiece input = "\xe3\x82\x81\xe3\x81\x8b\xe3\x81\xb6";
+  StringPiece result = TextNormalizer::NormalizeTextIfNeeded(input, &buffer);
+  // The input is returned without copying.
+  EXPECT_EQ(input.data(), result.data());
+  EXPECT_EQ(input.size(), result.size());
+  EXPECT_TRUE(buffer.empty());
+
+  // "ぐ〜ぐる"
+  result = TextNormalizer::NormalizeTextIfNeeded(
+      "\xe3\x81\x90\xe3\x80\x9c\xe3\x81\x90\xe3\x82\x8b", &buffer);
+#ifdef OS_WIN
+  // "ぐ～ぐる"
+  EXPECT_EQ("\xe3\x81\x90\xef\xbd\x9e\xe3\x81\x90\xe3\x82\x8b", result);
+  EXPECT_EQ(buffer.data(), result.data());
+#else
+  // "ぐ〜ぐる"
+  EXPECT_EQ("\xe3\x81\x90\xe3\x80\x9c\xe3\x81\x90\xe3\x82\x8b", result);
+#endif
+}
+
+TEST(TextNormalizerTest, NormalizeTextInPlace) {
+  // "めかぶ"
+  string text = "\xe3\x82\x81\xe3\x81\x8b\xe3\x81\xb6";
+  EXPECT_FALSE(TextNormalizer::NormalizeTextInPlace(&text));
+  EXPECT_EQ("\xe3\x82\x81\xe3\x81\x8b\xe3\x81\xb6", text);
+
+  // "１−２〜３"
+  text = "\xEF\xBC\x91\xE2\x88\x92\xEF\xBC\x92\xE3\x80\x9c\xEF\xBC\x93";
+#ifdef OS_WIN
+  EXPECT_TRUE(TextNormalizer::NormalizeTextInPlace(&text));
+  // "１－２～３"
+  EXPECT_EQ("\xEF\xBC\x91\xEF\xBC\x8D\xEF\xBC\x92\xEF\xBD\x9E\xEF\xBC\x93",
+            text);
+
+  // Falls back to NormalizeText() for changes which alter the length.
+  text = "\xE2\x88\x92" "a\xE3\x81";
+  EXPECT_TRUE(TextNormalizer::NormalizeTextInPlace(&text));
+  string expected;
+  TextNormalizer::NormalizeText("\xE2\x88\x92" "a\xE3\x81", &expected);
+  EXPECT_EQ(expected, text);
+#else
+  EXPECT_FALSE(TextNormalizer::NormalizeTextInPlace(&text));
+  EXPECT_EQ("\xEF\xBC\x91\xE2\x88\x92\xEF\xBC\x92\xE3\x80\x9c\xEF\xBC\x93",
+            text);
+#endif
+}
+
 }  // namespace mozc
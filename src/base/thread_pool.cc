@@ -0,0 +1,307 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/cpu_stats.h"
+#include "base/logging.h"
+#include "base/singleton.h"
+#include "base/thread.h"
+
+namespace mozc {
+namespace {
+
+// Bounds of the number of workers in the shared pool.
+const size_t kMinSharedThreads = 4;
+const size_t kMaxSharedThreads = 16;
+
+// The pool and the index of the worker running on the current thread, which
+// are used to route tasks scheduled from a task to the local queue.
+thread_local const ThreadPool *g_current_pool = nullptr;
+thread_local size_t g_current_worker = 0;
+
+class SharedThreadPool : public ThreadPool {
+ public:
+  SharedThreadPool()
+      : ThreadPool(std::min(
+            kMaxSharedThreads,
+            std::max(kMinSharedThreads,
+                     CPUStats().GetNumberOfProcessors()))) {}
+};
+
+}  // namespace
+
+ThreadPool::Task::Task(std::function<void()> closure)
+    : closure_(std::move(closure)), state_(PENDING) {}
+
+ThreadPool::Task::~Task() {}
+
+bool ThreadPool::Task::Cancel() {
+  {
+    scoped_lock l(&mutex_);
+    if (state_ != PENDING) {
+      return false;
+    }
+    state_ = CANCELLED;
+    closure_ = nullptr;
+  }
+  done_event_.Notify();
+  return true;
+}
+
+bool ThreadPool::Task::Wait() {
+  if (!RunIfPending()) {
+    while (!IsDone()) {
+      done_event_.Wait(-1);
+    }
+    // The event is reset by a waiter, so wake up the next one.
+    done_event_.Notify();
+  }
+  return !IsCancelled();
+}
+
+bool ThreadPool::Task::IsDone() const {
+  const State s = state();
+  return s == FINISHED || s == CANCELLED;
+}
+
+bool ThreadPool::Task::IsCancelled() const {
+  return state() == CANCELLED;
+}
+
+bool ThreadPool::Task::RunIfPending() {
+  {
+    scoped_lock l(&mutex_);
+    if (state_ != PENDING) {
+      return false;
+    }
+    state_ = RUNNING;
+  }
+  closure_();
+  {
+    scoped_lock l(&mutex_);
+    closure_ = nullptr;
+    state_ = FINISHED;
+  }
+  done_event_.Notify();
+  return true;
+}
+
+ThreadPool::Task::State ThreadPool::Task::state() const {
+  scoped_lock l(&mutex_);
+  return state_;
+}
+
+class ThreadPool::Worker : public Thread {
+ public:
+  Worker(ThreadPool *pool, size_t index) : pool_(pool), index_(index) {}
+
+  void Run() override {
+    g_current_pool = pool_;
+    g_current_worker = index_;
+    Priority priority = INTERACTIVE;
+    for (TaskHandle task = pool_->TakeTask(index_, &priority);
+         task != nullptr;
+         task = pool_->TakeTask(index_, &priority)) {
+      task->RunIfPending();
+      pool_->FinishTask(priority);
+    }
+    g_current_pool = nullptr;
+  }
+
+ private:
+  ThreadPool *pool_;
+  const size_t index_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : local_queues_(std::max<size_t>(num_threads, 1)),
+      num_running_background_tasks_(0),
+      max_background_tasks_(std::max<size_t>(num_threads, 2) - 1),
+      quit_(false) {
+  for (size_t i = 0; i < local_queues_.size(); ++i) {
+    workers_.emplace_back(new Worker(this, i));
+    workers_.back()->SetJoinable(true);
+    workers_.back()->Start("ThreadPool");
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  std::vector<TaskHandle> pending;
+  {
+    scoped_lock l(&mutex_);
+    quit_ = true;
+    for (size_t i = 0; i < NUM_PRIORITIES; ++i) {
+      pending.insert(pending.end(), queues_[i].begin(), queues_[i].end());
+      queues_[i].clear();
+    }
+    for (size_t i = 0; i < local_queues_.size(); ++i) {
+      pending.insert(pending.end(), local_queues_[i].begin(),
+                     local_queues_[i].end());
+      local_queues_[i].clear();
+    }
+  }
+  for (size_t i = 0; i < pending.size(); ++i) {
+    pending[i]->Cancel();
+  }
+  task_event_.Notify();
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->Join();
+  }
+}
+
+ThreadPool::TaskHandle ThreadPool::Schedule(Priority priority,
+                                            std::function<void()> closure) {
+  DCHECK_GE(priority, 0);
+  DCHECK_LT(priority, NUM_PRIORITIES);
+  TaskHandle task(new Task(std::move(closure)));
+  {
+    scoped_lock l(&mutex_);
+    if (quit_) {
+      task->Cancel();
+      return task;
+    }
+    if (priority == INTERACTIVE && g_current_pool == this) {
+      local_queues_[g_current_worker].push_back(task);
+    } else {
+      queues_[priority].push_back(task);
+    }
+  }
+  task_event_.Notify();
+  return task;
+}
+
+ThreadPool::TaskHandle ThreadPool::TakeTask(size_t index,
+                                            Priority *priority) {
+  while (true) {
+    bool has_more = false;
+    TaskHandle task;
+    {
+      scoped_lock l(&mutex_);
+      if (quit_) {
+        break;
+      }
+      task = PopTaskLocked(index, priority);
+      if (task != nullptr) {
+        if (*priority == BACKGROUND) {
+          ++num_running_background_tasks_;
+        }
+        has_more = !queues_[INTERACTIVE].empty() ||
+                   !queues_[BACKGROUND].empty();
+        for (size_t i = 0; !has_more && i < local_queues_.size(); ++i) {
+          has_more = !local_queues_[i].empty();
+        }
+      }
+    }
+    if (task != nullptr) {
+      // One notification may have been consumed for several tasks, so pass
+      // it on to another idle worker.
+      if (has_more) {
+        task_event_.Notify();
+      }
+      return task;
+    }
+    task_event_.Wait(-1);
+  }
+  // Let the other workers see |quit_| too.
+  task_event_.Notify();
+  return nullptr;
+}
+
+ThreadPool::TaskHandle ThreadPool::PopTaskLocked(size_t index,
+                                                 Priority *priority) {
+  TaskHandle task;
+  // Tasks cancelled in the queues are dropped here.
+  std::deque<TaskHandle> *local_queue = &local_queues_[index];
+  while (!local_queue->empty()) {
+    task = std::move(local_queue->back());
+    local_queue->pop_back();
+    if (!task->IsDone()) {
+      *priority = INTERACTIVE;
+      return task;
+    }
+  }
+  for (size_t p = 0; p < NUM_PRIORITIES; ++p) {
+    if (p == BACKGROUND &&
+        num_running_background_tasks_ >= max_background_tasks_) {
+      break;
+    }
+    while (!queues_[p].empty()) {
+      task = std::move(queues_[p].front());
+      queues_[p].pop_front();
+      if (!task->IsDone()) {
+        *priority = static_cast<Priority>(p);
+        return task;
+      }
+    }
+  }
+  for (size_t i = 1; i < local_queues_.size(); ++i) {
+    std::deque<TaskHandle> *victim =
+        &local_queues_[(index + i) % local_queues_.size()];
+    while (!victim->empty()) {
+      task = std::move(victim->front());
+      victim->pop_front();
+      if (!task->IsDone()) {
+        *priority = INTERACTIVE;
+        return task;
+      }
+    }
+  }
+  return nullptr;
+}
+
+void ThreadPool::FinishTask(Priority priority) {
+  if (priority != BACKGROUND) {
+    return;
+  }
+  bool has_background_tasks = false;
+  {
+    scoped_lock l(&mutex_);
+    DCHECK_GT(num_running_background_tasks_, 0);
+    --num_running_background_tasks_;
+    has_background_tasks = !queues_[BACKGROUND].empty();
+  }
+  // A worker may be sleeping on a BACKGROUND task held back by the limit.
+  if (has_background_tasks) {
+    task_event_.Notify();
+  }
+}
+
+// static
+ThreadPool *ThreadPool::GetSharedInstance() {
+  return Singleton<SharedThreadPool>::get();
+}
+
+}  // namespace mozc
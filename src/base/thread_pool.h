@@ -0,0 +1,159 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// ThreadPool runs closures on a bounded set of worker threads shared by the
+// components which used to start a dedicated Thread for every asynchronous
+// job.
+//
+// usage:
+// ThreadPool::TaskHandle task = ThreadPool::GetSharedInstance()->Schedule(
+//     ThreadPool::BACKGROUND, [this]() { Save(); });
+// ...
+// task->Wait();  // or task->Cancel() if the result is no longer needed.
+//
+// Tasks are taken in the order of their priority.  INTERACTIVE tasks are the
+// ones the user is waiting for, e.g. lattice lookups, and BACKGROUND tasks
+// are the ones nobody waits for soon, e.g. storage I/O.  BACKGROUND tasks never
+// occupy all the workers so that an INTERACTIVE task always finds a free
+// worker even if the disk is slow.  A task scheduled from a worker goes to the
+// local queue of the worker, and idle workers steal from the other workers'
+// queues.
+
+#ifndef MOZC_BASE_THREAD_POOL_H_
+#define MOZC_BASE_THREAD_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "base/unnamed_event.h"
+
+namespace mozc {
+
+class ThreadPool {
+ public:
+  enum Priority {
+    INTERACTIVE,
+    BACKGROUND,
+    NUM_PRIORITIES,
+  };
+
+  // Completion handle of a scheduled closure.  All the methods are
+  // thread-safe.
+  class Task {
+   public:
+    explicit Task(std::function<void()> closure);
+    ~Task();
+
+    // Prevents the closure from starting.  Returns false if it has already
+    // started or finished.
+    bool Cancel();
+
+    // Blocks until the closure finishes or is cancelled.  If no worker has
+    // taken the closure yet, runs it on the calling thread instead of waiting
+    // for a worker.  Returns false if the task was cancelled.
+    bool Wait();
+
+    // Returns true if the closure has finished or is cancelled.
+    bool IsDone() const;
+    bool IsCancelled() const;
+
+   private:
+    friend class ThreadPool;
+
+    enum State {
+      PENDING,
+      RUNNING,
+      FINISHED,
+      CANCELLED,
+    };
+
+    // Runs the closure if it is still pending.  Returns false otherwise.
+    bool RunIfPending();
+    State state() const;
+
+    std::function<void()> closure_;
+    mutable Mutex mutex_;
+    State state_;
+    UnnamedEvent done_event_;
+
+    DISALLOW_COPY_AND_ASSIGN(Task);
+  };
+
+  typedef std::shared_ptr<Task> TaskHandle;
+
+  // Starts |num_threads| workers.  At least one worker is started.
+  explicit ThreadPool(size_t num_threads);
+
+  // Cancels the pending tasks and joins the workers after their running
+  // tasks finish.
+  ~ThreadPool();
+
+  // Queues |closure| and returns its handle.  Never returns NULL.
+  TaskHandle Schedule(Priority priority, std::function<void()> closure);
+
+  size_t num_threads() const { return workers_.size(); }
+
+  // Returns the pool shared in the process.  It has one worker per processor
+  // with a lower and upper bound.
+  static ThreadPool *GetSharedInstance();
+
+ private:
+  class Worker;
+
+  // Returns the next task for the |index|-th worker, or NULL when the pool is
+  // shutting down.  Blocks while there is no task to run.
+  TaskHandle TakeTask(size_t index, Priority *priority);
+  // Pops a pending task for the |index|-th worker.  Requires |mutex_|.
+  TaskHandle PopTaskLocked(size_t index, Priority *priority);
+  // Called by a worker after the task taken by TakeTask() ends.
+  void FinishTask(Priority priority);
+
+  Mutex mutex_;
+  // The global queues, one per priority.
+  std::deque<TaskHandle> queues_[NUM_PRIORITIES];
+  // The INTERACTIVE tasks scheduled by each worker.  The owner pops from the
+  // back and the others steal from the front.
+  std::vector<std::deque<TaskHandle>> local_queues_;
+  size_t num_running_background_tasks_;
+  size_t max_background_tasks_;
+  bool quit_;
+  UnnamedEvent task_event_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_THREAD_POOL_H_
@@ -0,0 +1,180 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "base/unnamed_event.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+  ThreadPool pool(4);
+  EXPECT_EQ(4, pool.num_threads());
+
+  std::atomic<int> sum(0);
+  std::vector<ThreadPool::TaskHandle> tasks;
+  for (int i = 1; i <= 100; ++i) {
+    tasks.push_back(pool.Schedule(
+        i % 2 == 0 ? ThreadPool::INTERACTIVE : ThreadPool::BACKGROUND,
+        [&sum, i]() { sum += i; }));
+  }
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    EXPECT_TRUE(tasks[i]->Wait());
+    EXPECT_TRUE(tasks[i]->IsDone());
+    EXPECT_FALSE(tasks[i]->IsCancelled());
+  }
+  EXPECT_EQ(5050, sum);
+}
+
+TEST(ThreadPoolTest, CancelPendingTask) {
+  ThreadPool pool(1);
+  UnnamedEvent started, release;
+  ThreadPool::TaskHandle blocker = pool.Schedule(
+      ThreadPool::INTERACTIVE, [&started, &release]() {
+        started.Notify();
+        release.Wait(-1);
+      });
+  ASSERT_TRUE(started.Wait(10000));
+
+  bool invoked = false;
+  ThreadPool::TaskHandle task = pool.Schedule(
+      ThreadPool::INTERACTIVE, [&invoked]() { invoked = true; });
+  EXPECT_TRUE(task->Cancel());
+  EXPECT_TRUE(task->IsDone());
+  EXPECT_TRUE(task->IsCancelled());
+  EXPECT_FALSE(task->Wait());
+
+  // The running task cannot be cancelled.
+  EXPECT_FALSE(blocker->Cancel());
+  release.Notify();
+  EXPECT_TRUE(blocker->Wait());
+  EXPECT_FALSE(blocker->Cancel());
+  EXPECT_FALSE(invoked);
+}
+
+TEST(ThreadPoolTest, WaitRunsPendingTaskOnCaller) {
+  ThreadPool pool(1);
+  UnnamedEvent started, release;
+  ThreadPool::TaskHandle blocker = pool.Schedule(
+      ThreadPool::INTERACTIVE, [&started, &release]() {
+        started.Notify();
+        release.Wait(-1);
+      });
+  ASSERT_TRUE(started.Wait(10000));
+
+  // The only worker is busy, so Wait() doesn't block on it.
+  bool invoked = false;
+  ThreadPool::TaskHandle task = pool.Schedule(
+      ThreadPool::INTERACTIVE, [&invoked]() { invoked = true; });
+  EXPECT_TRUE(task->Wait());
+  EXPECT_TRUE(invoked);
+
+  release.Notify();
+  EXPECT_TRUE(blocker->Wait());
+}
+
+TEST(ThreadPoolTest, BackgroundTasksLeaveWorkerForInteractive) {
+  ThreadPool pool(2);
+  UnnamedEvent started, release;
+  ThreadPool::TaskHandle background = pool.Schedule(
+      ThreadPool::BACKGROUND, [&started, &release]() {
+        started.Notify();
+        release.Wait(-1);
+      });
+  ASSERT_TRUE(started.Wait(10000));
+  // Held back since one of the two workers already runs a BACKGROUND task.
+  ThreadPool::TaskHandle background2 =
+      pool.Schedule(ThreadPool::BACKGROUND, []() {});
+
+  UnnamedEvent interactive_done;
+  ThreadPool::TaskHandle interactive = pool.Schedule(
+      ThreadPool::INTERACTIVE,
+      [&interactive_done]() { interactive_done.Notify(); });
+  EXPECT_TRUE(interactive_done.Wait(10000));
+  EXPECT_FALSE(background2->IsDone());
+
+  release.Notify();
+  EXPECT_TRUE(background->Wait());
+  EXPECT_TRUE(background2->Wait());
+}
+
+TEST(ThreadPoolTest, NestedTasks) {
+  ThreadPool pool(2);
+  std::atomic<int> count(0);
+  ThreadPool::TaskHandle parent = pool.Schedule(
+      ThreadPool::INTERACTIVE, [&pool, &count]() {
+        std::vector<ThreadPool::TaskHandle> children;
+        for (int i = 0; i < 10; ++i) {
+          children.push_back(pool.Schedule(ThreadPool::INTERACTIVE,
+                                           [&count]() { ++count; }));
+        }
+        for (size_t i = 0; i < children.size(); ++i) {
+          children[i]->Wait();
+        }
+      });
+  EXPECT_TRUE(parent->Wait());
+  EXPECT_EQ(10, count);
+}
+
+TEST(ThreadPoolTest, DestructorCancelsPendingTasks) {
+  UnnamedEvent started, release;
+  ThreadPool::TaskHandle blocker, task;
+  {
+    ThreadPool pool(1);
+    blocker = pool.Schedule(ThreadPool::INTERACTIVE, [&started, &release]() {
+      started.Notify();
+      release.Wait(-1);
+    });
+    ASSERT_TRUE(started.Wait(10000));
+    task = pool.Schedule(ThreadPool::INTERACTIVE, []() {});
+    release.Notify();
+  }
+  EXPECT_TRUE(blocker->IsDone());
+  EXPECT_TRUE(task->IsDone());
+}
+
+TEST(ThreadPoolTest, SharedInstance) {
+  ThreadPool *pool = ThreadPool::GetSharedInstance();
+  ASSERT_NE(nullptr, pool);
+  EXPECT_EQ(pool, ThreadPool::GetSharedInstance());
+  EXPECT_LE(4, pool->num_threads());
+  std::atomic<bool> invoked(false);
+  EXPECT_TRUE(pool->Schedule(ThreadPool::BACKGROUND,
+                             [&invoked]() { invoked = true; })->Wait());
+  EXPECT_TRUE(invoked);
+}
+
+}  // namespace
+}  // namespace mozc
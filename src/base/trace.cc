@@ -0,0 +1,254 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/trace.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/perf_counter.h"
+#include "base/singleton.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace {
+
+// The fields are atomic only because ExportChromeTrace() may read a span
+// while its thread overwrites it.  Such spans are dropped after the copy by
+// checking ThreadBuffer::num_reserved.
+struct Span {
+  std::atomic<const char *> name;
+  std::atomic<uint64> begin_ticks;
+  std::atomic<uint64> end_ticks;
+};
+
+struct ThreadBuffer {
+  explicit ThreadBuffer(int index)
+      : num_reserved(0), size(0), begin(0), in_use(true),
+        thread_index(index) {}
+
+  Span spans[Trace::kMaxSpansPerThread];
+  // The number of the spans ever recorded.  |num_reserved| is incremented
+  // before a span is written, and |size| after it.  Only the owner thread
+  // writes them.
+  std::atomic<uint64> num_reserved;
+  std::atomic<uint64> size;
+  // The spans before this are discarded.
+  std::atomic<uint64> begin;
+  // False after the owner thread exits, so another thread can reuse it.
+  std::atomic<bool> in_use;
+  const int thread_index;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+};
+
+// The buffers are never freed, so that the spans of the exited threads can
+// be exported.
+struct Registry {
+  Mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::set<string> interned_names;
+};
+
+// Releases the buffer of the thread when it exits.
+class ThreadBufferHolder {
+ public:
+  ThreadBufferHolder() : buffer_(nullptr) {}
+  ~ThreadBufferHolder() {
+    if (buffer_ != nullptr) {
+      buffer_->in_use.store(false, std::memory_order_release);
+    }
+  }
+
+  ThreadBuffer *Get() {
+    if (buffer_ == nullptr) {
+      buffer_ = Acquire();
+    }
+    return buffer_;
+  }
+
+ private:
+  static ThreadBuffer *Acquire() {
+    Registry *registry = Singleton<Registry>::get();
+    scoped_lock lock(&registry->mutex);
+    for (size_t i = 0; i < registry->buffers.size(); ++i) {
+      ThreadBuffer *buffer = registry->buffers[i].get();
+      if (!buffer->in_use.load(std::memory_order_acquire)) {
+        buffer->in_use.store(true, std::memory_order_relaxed);
+        return buffer;
+      }
+    }
+    registry->buffers.emplace_back(
+        new ThreadBuffer(static_cast<int>(registry->buffers.size())));
+    return registry->buffers.back().get();
+  }
+
+  ThreadBuffer *buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadBufferHolder);
+};
+
+thread_local ThreadBufferHolder g_thread_buffer;
+
+// Appends the spans of |buffer| to |spans|, except the ones which are
+// discarded or may have been overwritten during the copy.
+void CopySpans(const ThreadBuffer &buffer,
+               std::vector<Trace::SpanRecord> *spans) {
+  const uint64 kCapacity = Trace::kMaxSpansPerThread;
+  const uint64 end = buffer.size.load(std::memory_order_acquire);
+  uint64 first = buffer.begin.load(std::memory_order_relaxed);
+  if (end > kCapacity) {
+    first = max(first, end - kCapacity);
+  }
+  const size_t offset = spans->size();
+  for (uint64 i = first; i < end; ++i) {
+    const Span &span = buffer.spans[i % kCapacity];
+    const Trace::SpanRecord record = {
+      span.name.load(std::memory_order_relaxed),
+      buffer.thread_index,
+      span.begin_ticks.load(std::memory_order_relaxed),
+      span.end_ticks.load(std::memory_order_relaxed),
+    };
+    spans->push_back(record);
+  }
+  // Pairs with the release fence in Trace::AddSpan(), so that the spans being
+  // overwritten during the copy are counted in |num_reserved|.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64 end_after_copy =
+      buffer.num_reserved.load(std::memory_order_relaxed);
+  if (end_after_copy > kCapacity && end_after_copy - kCapacity > first) {
+    const size_t num_overwritten = static_cast<size_t>(
+        min(end_after_copy - kCapacity - first, end - first));
+    spans->erase(spans->begin() + offset,
+                 spans->begin() + offset + num_overwritten);
+  }
+}
+
+void AppendJsonString(const char *str, string *json) {
+  json->push_back('"');
+  for (const char *p = str; *p != '\0'; ++p) {
+    if (*p == '"' || *p == '\\') {
+      json->push_back('\\');
+      json->push_back(*p);
+    } else if (static_cast<unsigned char>(*p) < 0x20) {
+      json->append(Util::StringPrintf("\\u%04x", *p));
+    } else {
+      json->push_back(*p);
+    }
+  }
+  json->push_back('"');
+}
+
+}  // namespace
+
+const size_t Trace::kMaxSpansPerThread;
+std::atomic<bool> Trace::enabled_(false);
+
+// static
+void Trace::SetEnabled(bool enabled) {
+  Registry *registry = Singleton<Registry>::get();
+  scoped_lock lock(&registry->mutex);
+  if (enabled && !IsEnabled()) {
+    for (size_t i = 0; i < registry->buffers.size(); ++i) {
+      ThreadBuffer *buffer = registry->buffers[i].get();
+      buffer->begin.store(buffer->size.load(std::memory_order_acquire),
+                          std::memory_order_relaxed);
+    }
+  }
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+// static
+const char *Trace::InternName(const string &name) {
+  Registry *registry = Singleton<Registry>::get();
+  scoped_lock lock(&registry->mutex);
+  return registry->interned_names.insert(name).first->c_str();
+}
+
+// static
+void Trace::GetSpans(std::vector<SpanRecord> *spans) {
+  DCHECK(spans);
+  spans->clear();
+  Registry *registry = Singleton<Registry>::get();
+  scoped_lock lock(&registry->mutex);
+  for (size_t i = 0; i < registry->buffers.size(); ++i) {
+    CopySpans(*registry->buffers[i], spans);
+  }
+}
+
+// static
+void Trace::ExportChromeTrace(string *json) {
+  DCHECK(json);
+  const uint64 frequency = PerfCounter::GetFrequency();
+  const double usec_per_tick =
+      frequency == 0 ? 0.0 : 1000000.0 / static_cast<double>(frequency);
+
+  std::vector<SpanRecord> spans;
+  GetSpans(&spans);
+  json->assign("{\"traceEvents\":[");
+  for (size_t i = 0; i < spans.size(); ++i) {
+    const SpanRecord &span = spans[i];
+    if (i > 0) {
+      json->push_back(',');
+    }
+    json->append("{\"name\":");
+    AppendJsonString(span.name, json);
+    json->append(Util::StringPrintf(
+        ",\"cat\":\"mozc\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+        "\"ts\":%.3f,\"dur\":%.3f}",
+        span.thread_index, span.begin_ticks * usec_per_tick,
+        (span.end_ticks - span.begin_ticks) * usec_per_tick));
+  }
+  json->append("],\"displayTimeUnit\":\"ms\"}");
+}
+
+// static
+void Trace::AddSpan(const char *name, uint64 begin_ticks, uint64 end_ticks) {
+  DCHECK(name);
+  ThreadBuffer *buffer = g_thread_buffer.Get();
+  const uint64 index = buffer->size.load(std::memory_order_relaxed);
+  buffer->num_reserved.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  Span *span = &buffer->spans[index % kMaxSpansPerThread];
+  span->name.store(name, std::memory_order_relaxed);
+  span->begin_ticks.store(begin_ticks, std::memory_order_relaxed);
+  span->end_ticks.store(end_ticks, std::memory_order_relaxed);
+  buffer->size.store(index + 1, std::memory_order_release);
+}
+
+// static
+uint64 Trace::GetTicks() {
+  return PerfCounter::GetTicks();
+}
+
+}  // namespace mozc
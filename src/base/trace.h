@@ -0,0 +1,130 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_TRACE_H_
+#define MOZC_BASE_TRACE_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// Records the spans of the stages of the server, e.g. the IPC, the session
+// and the converter, to see where the time of a slow key event went.  The
+// spans can be exported in the Chrome trace event format, which is shown
+// by chrome://tracing.
+//
+// Each thread appends its spans to its own ring buffer without locks, so
+// a span costs a few clock reads while the tracing is enabled, and only a
+// relaxed atomic load while disabled.  The oldest spans of a thread are
+// overwritten if it records more than kMaxSpansPerThread spans.
+//
+// Usage:
+//   void Foo() {
+//     MOZC_TRACE_SPAN("Foo");
+//     ...
+//   }
+class Trace {
+ public:
+  static const size_t kMaxSpansPerThread = 4096;
+
+  // The tracing is disabled by default.  Enabling it discards the spans
+  // recorded before.
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Returns a copy of |name| which lives until the process exits, for the
+  // names of the spans which are not string literals.  This takes a lock, so
+  // call it at initialization rather than for each span.
+  static const char *InternName(const string &name);
+
+  struct SpanRecord {
+    const char *name;
+    // The index of the thread buffer, which is reused after a thread exits.
+    int thread_index;
+    uint64 begin_ticks;
+    uint64 end_ticks;
+  };
+
+  // Returns the spans recorded since the tracing was enabled, grouped by
+  // thread.
+  static void GetSpans(std::vector<SpanRecord> *spans);
+
+  // Writes the spans recorded since the tracing was enabled as a JSON object
+  // of the Chrome trace event format.
+  static void ExportChromeTrace(string *json);
+
+  // Records a span of the current thread.  |name| must live until the
+  // process exits.  The ticks are the ones of PerfCounter::GetTicks().
+  static void AddSpan(const char *name, uint64 begin_ticks, uint64 end_ticks);
+
+  // Records the span from the construction to the destruction of this object
+  // if the tracing is enabled at the construction.
+  class ScopedSpan {
+   public:
+    explicit ScopedSpan(const char *name)
+        : name_(IsEnabled() ? name : nullptr),
+          begin_ticks_(name_ != nullptr ? GetTicks() : 0) {}
+    ~ScopedSpan() {
+      if (name_ != nullptr) {
+        AddSpan(name_, begin_ticks_, GetTicks());
+      }
+    }
+
+   private:
+    const char *name_;
+    const uint64 begin_ticks_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedSpan);
+  };
+
+ private:
+  static uint64 GetTicks();
+
+  static std::atomic<bool> enabled_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(Trace);
+};
+
+}  // namespace mozc
+
+#define MOZC_TRACE_SPAN_CONCAT_INTERNAL(a, b) a##b
+#define MOZC_TRACE_SPAN_CONCAT(a, b) MOZC_TRACE_SPAN_CONCAT_INTERNAL(a, b)
+
+// Records the span of the current scope as |name|, which must be a string
+// literal or a name returned by Trace::InternName().
+#define MOZC_TRACE_SPAN(name) \
+  ::mozc::Trace::ScopedSpan MOZC_TRACE_SPAN_CONCAT(trace_span_, __LINE__)(name)
+
+#endif  // MOZC_BASE_TRACE_H_
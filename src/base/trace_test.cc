@@ -0,0 +1,181 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/trace.h"
+
+#include <string>
+#include <vector>
+
+#include "base/perf_counter.h"
+#include "base/port.h"
+#include "base/thread.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+// Returns the number of the occurrences of |pattern| in |str|.
+size_t CountOccurrences(const string &str, const string &pattern) {
+  size_t count = 0;
+  for (size_t pos = str.find(pattern); pos != string::npos;
+       pos = str.find(pattern, pos + pattern.size())) {
+    ++count;
+  }
+  return count;
+}
+
+size_t CountEvents(const string &json) {
+  return CountOccurrences(json, "\"ph\":\"X\"");
+}
+
+class SpanThread : public Thread {
+ public:
+  void Run() override {
+    MOZC_TRACE_SPAN("SpanThread::Run");
+  }
+};
+
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Discards the spans of the other tests.
+    Trace::SetEnabled(true);
+    Trace::SetEnabled(false);
+  }
+
+  void TearDown() override {
+    Trace::SetEnabled(false);
+  }
+};
+
+TEST_F(TraceTest, Disabled) {
+  {
+    MOZC_TRACE_SPAN("Disabled");
+  }
+  string json;
+  Trace::ExportChromeTrace(&json);
+  EXPECT_EQ("{\"traceEvents\":[],\"displayTimeUnit\":\"ms\"}", json);
+}
+
+TEST_F(TraceTest, ScopedSpan) {
+  Trace::SetEnabled(true);
+  {
+    MOZC_TRACE_SPAN("Outer");
+    MOZC_TRACE_SPAN("Inner");
+  }
+  Trace::SetEnabled(false);
+  {
+    MOZC_TRACE_SPAN("AfterDisabled");
+  }
+
+  string json;
+  Trace::ExportChromeTrace(&json);
+  EXPECT_EQ(2, CountEvents(json));
+  EXPECT_NE(string::npos, json.find("\"name\":\"Outer\""));
+  EXPECT_NE(string::npos, json.find("\"name\":\"Inner\""));
+  EXPECT_EQ(string::npos, json.find("AfterDisabled"));
+
+  // Enabling the tracing again discards the spans.
+  Trace::SetEnabled(true);
+  Trace::ExportChromeTrace(&json);
+  EXPECT_EQ(0, CountEvents(json));
+}
+
+TEST_F(TraceTest, AddSpan) {
+  Trace::SetEnabled(true);
+  const uint64 frequency = PerfCounter::GetFrequency();
+  ASSERT_LT(0, frequency);
+  Trace::AddSpan(Trace::InternName("Quote\"And\\Backslash"), frequency,
+                 frequency * 3);
+  string json;
+  Trace::ExportChromeTrace(&json);
+  EXPECT_NE(string::npos,
+            json.find("\"name\":\"Quote\\\"And\\\\Backslash\""));
+  EXPECT_NE(string::npos,
+            json.find("\"ts\":1000000.000,\"dur\":2000000.000}"));
+}
+
+TEST_F(TraceTest, GetSpans) {
+  Trace::SetEnabled(true);
+  Trace::AddSpan("First", 10, 20);
+  Trace::AddSpan("Second", 30, 50);
+  std::vector<Trace::SpanRecord> spans;
+  Trace::GetSpans(&spans);
+  ASSERT_EQ(2, spans.size());
+  EXPECT_STREQ("First", spans[0].name);
+  EXPECT_EQ(10, spans[0].begin_ticks);
+  EXPECT_EQ(20, spans[0].end_ticks);
+  EXPECT_STREQ("Second", spans[1].name);
+  EXPECT_EQ(spans[0].thread_index, spans[1].thread_index);
+}
+
+TEST_F(TraceTest, InternName) {
+  const string name = "InternedName";
+  const char *interned = Trace::InternName(name);
+  EXPECT_EQ(name, interned);
+  EXPECT_EQ(interned, Trace::InternName(string(name)));
+}
+
+TEST_F(TraceTest, OverwriteOldestSpans) {
+  Trace::SetEnabled(true);
+  for (size_t i = 0; i < Trace::kMaxSpansPerThread + 10; ++i) {
+    Trace::AddSpan(i < 10 ? "Old" : "New", i, i + 1);
+  }
+  string json;
+  Trace::ExportChromeTrace(&json);
+  EXPECT_EQ(Trace::kMaxSpansPerThread, CountEvents(json));
+  EXPECT_EQ(string::npos, json.find("\"name\":\"Old\""));
+}
+
+TEST_F(TraceTest, Threads) {
+  Trace::SetEnabled(true);
+  {
+    MOZC_TRACE_SPAN("MainThread");
+  }
+  SpanThread thread;
+  thread.SetJoinable(true);
+  thread.Start("TraceTest");
+  thread.Join();
+
+  string json;
+  Trace::ExportChromeTrace(&json);
+  EXPECT_EQ(2, CountEvents(json));
+  const size_t main_pos = json.find("\"name\":\"MainThread\"");
+  const size_t thread_pos = json.find("\"name\":\"SpanThread::Run\"");
+  ASSERT_NE(string::npos, main_pos);
+  ASSERT_NE(string::npos, thread_pos);
+  // The spans of the threads have different tids.
+  const size_t main_tid = json.find("\"tid\":", main_pos);
+  const size_t thread_tid = json.find("\"tid\":", thread_pos);
+  EXPECT_NE(json.substr(main_tid, json.find(',', main_tid) - main_tid),
+            json.substr(thread_tid, json.find(',', thread_tid) - thread_tid));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -34,6 +34,29 @@
 
 #include "base/logging.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MOZC_AES256_AESNI
+#include <wmmintrin.h>
+// The whole tree is built without -maes, so the AES-NI functions are compiled
+// for the instruction set individually and are called only if the CPU
+// supports it.
+#define MOZC_AES256_TARGET_AESNI __attribute__((target("aes,sse2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MOZC_AES256_AESNI
+#include <intrin.h>
+#include <wmmintrin.h>
+#define MOZC_AES256_TARGET_AESNI
+#endif
+
+// Unlike AES-NI, the Crypto Extensions are enabled only when the compiler
+// targets them, e.g. with -march=armv8-a+crypto, because there is no portable
+// way to query them at runtime.
+#if defined(__aarch64__) && \
+    (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define MOZC_AES256_ARMV8_CRYPTO
+#include <arm_neon.h>
+#endif
+
 namespace mozc {
 namespace internal {
 namespace {
@@ -158,15 +181,222 @@ void InvMixColumnsImpl(uint8 column[4]) {
   column[3] = a11[0] ^ a13[1] ^  a9[2] ^ a14[3];
 }
 
+#ifdef MOZC_AES256_AESNI
+MOZC_AES256_TARGET_AESNI
+inline __m128i LoadRoundKeyAESNI(const uint8 *w, size_t round) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+      w + round * UnverifiedAES256::kBlockBytes));
+}
+
+// Both functions take the key schedule made by MakeKeySchedule, whose round
+// keys are laid out in the same byte order as the AES-NI registers.
+MOZC_AES256_TARGET_AESNI
+void TransformCBCAESNI(const uint8 *w, const uint8 *iv, uint8 *block,
+                       size_t block_count) {
+  __m128i round_keys[kNr + 1];
+  for (size_t i = 0; i <= kNr; ++i) {
+    round_keys[i] = LoadRoundKeyAESNI(w, i);
+  }
+  __m128i vec = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iv));
+  for (size_t i = 0; i < block_count; ++i) {
+    __m128i *src = reinterpret_cast<__m128i *>(
+        block + i * UnverifiedAES256::kBlockBytes);
+    vec = _mm_xor_si128(_mm_loadu_si128(src), vec);
+    vec = _mm_xor_si128(vec, round_keys[0]);
+    for (size_t round = 1; round < kNr; ++round) {
+      vec = _mm_aesenc_si128(vec, round_keys[round]);
+    }
+    vec = _mm_aesenclast_si128(vec, round_keys[kNr]);
+    _mm_storeu_si128(src, vec);
+  }
+}
+
+// Unlike the encryption, CBC decryption of each block is independent of the
+// others, so four blocks are interleaved to hide the latency of AESDEC.
+MOZC_AES256_TARGET_AESNI
+void InverseTransformCBCAESNI(const uint8 *w, const uint8 *iv, uint8 *block,
+                              size_t block_count) {
+  // The round keys for the equivalent inverse cipher (FIPS-197 5.3.5).
+  __m128i round_keys[kNr + 1];
+  round_keys[0] = LoadRoundKeyAESNI(w, kNr);
+  for (size_t i = 1; i < kNr; ++i) {
+    round_keys[i] = _mm_aesimc_si128(LoadRoundKeyAESNI(w, kNr - i));
+  }
+  round_keys[kNr] = LoadRoundKeyAESNI(w, 0);
+
+  const size_t kNumLanes = 4;
+  __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iv));
+  size_t i = 0;
+  for (; i + kNumLanes <= block_count; i += kNumLanes) {
+    __m128i *src = reinterpret_cast<__m128i *>(
+        block + i * UnverifiedAES256::kBlockBytes);
+    const __m128i c0 = _mm_loadu_si128(src + 0);
+    const __m128i c1 = _mm_loadu_si128(src + 1);
+    const __m128i c2 = _mm_loadu_si128(src + 2);
+    const __m128i c3 = _mm_loadu_si128(src + 3);
+    __m128i b0 = _mm_xor_si128(c0, round_keys[0]);
+    __m128i b1 = _mm_xor_si128(c1, round_keys[0]);
+    __m128i b2 = _mm_xor_si128(c2, round_keys[0]);
+    __m128i b3 = _mm_xor_si128(c3, round_keys[0]);
+    for (size_t round = 1; round < kNr; ++round) {
+      b0 = _mm_aesdec_si128(b0, round_keys[round]);
+      b1 = _mm_aesdec_si128(b1, round_keys[round]);
+      b2 = _mm_aesdec_si128(b2, round_keys[round]);
+      b3 = _mm_aesdec_si128(b3, round_keys[round]);
+    }
+    b0 = _mm_aesdeclast_si128(b0, round_keys[kNr]);
+    b1 = _mm_aesdeclast_si128(b1, round_keys[kNr]);
+    b2 = _mm_aesdeclast_si128(b2, round_keys[kNr]);
+    b3 = _mm_aesdeclast_si128(b3, round_keys[kNr]);
+    _mm_storeu_si128(src + 0, _mm_xor_si128(b0, prev));
+    _mm_storeu_si128(src + 1, _mm_xor_si128(b1, c0));
+    _mm_storeu_si128(src + 2, _mm_xor_si128(b2, c1));
+    _mm_storeu_si128(src + 3, _mm_xor_si128(b3, c2));
+    prev = c3;
+  }
+  for (; i < block_count; ++i) {
+    __m128i *src = reinterpret_cast<__m128i *>(
+        block + i * UnverifiedAES256::kBlockBytes);
+    const __m128i c = _mm_loadu_si128(src);
+    __m128i b = _mm_xor_si128(c, round_keys[0]);
+    for (size_t round = 1; round < kNr; ++round) {
+      b = _mm_aesdec_si128(b, round_keys[round]);
+    }
+    b = _mm_aesdeclast_si128(b, round_keys[kNr]);
+    _mm_storeu_si128(src, _mm_xor_si128(b, prev));
+    prev = c;
+  }
+}
+
+bool CpuSupportsAESNI() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 25)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes");
+#endif  // _MSC_VER
+}
+#endif  // MOZC_AES256_AESNI
+
+#ifdef MOZC_AES256_ARMV8_CRYPTO
+// AESE does AddRoundKey before SubBytes and ShiftRows, so the round keys are
+// applied one step earlier than in TransformECB and the last one is added
+// separately.
+void TransformCBCARMv8(const uint8 *w, const uint8 *iv, uint8 *block,
+                       size_t block_count) {
+  uint8x16_t round_keys[kNr + 1];
+  for (size_t i = 0; i <= kNr; ++i) {
+    round_keys[i] = vld1q_u8(w + i * UnverifiedAES256::kBlockBytes);
+  }
+  uint8x16_t vec = vld1q_u8(iv);
+  for (size_t i = 0; i < block_count; ++i) {
+    uint8 *src = block + i * UnverifiedAES256::kBlockBytes;
+    vec = veorq_u8(vld1q_u8(src), vec);
+    for (size_t round = 0; round + 1 < kNr; ++round) {
+      vec = vaesmcq_u8(vaeseq_u8(vec, round_keys[round]));
+    }
+    vec = vaeseq_u8(vec, round_keys[kNr - 1]);
+    vec = veorq_u8(vec, round_keys[kNr]);
+    vst1q_u8(src, vec);
+  }
+}
+
+void InverseTransformCBCARMv8(const uint8 *w, const uint8 *iv, uint8 *block,
+                              size_t block_count) {
+  // The round keys for the equivalent inverse cipher (FIPS-197 5.3.5).
+  uint8x16_t round_keys[kNr + 1];
+  round_keys[0] = vld1q_u8(w + kNr * UnverifiedAES256::kBlockBytes);
+  for (size_t i = 1; i < kNr; ++i) {
+    round_keys[i] =
+        vaesimcq_u8(vld1q_u8(w + (kNr - i) * UnverifiedAES256::kBlockBytes));
+  }
+  round_keys[kNr] = vld1q_u8(w);
+
+  uint8x16_t prev = vld1q_u8(iv);
+  for (size_t i = 0; i < block_count; ++i) {
+    uint8 *src = block + i * UnverifiedAES256::kBlockBytes;
+    const uint8x16_t c = vld1q_u8(src);
+    uint8x16_t b = c;
+    for (size_t round = 0; round + 1 < kNr; ++round) {
+      b = vaesimcq_u8(vaesdq_u8(b, round_keys[round]));
+    }
+    b = vaesdq_u8(b, round_keys[kNr - 1]);
+    b = veorq_u8(b, round_keys[kNr]);
+    vst1q_u8(src, veorq_u8(b, prev));
+    prev = c;
+  }
+}
+#endif  // MOZC_AES256_ARMV8_CRYPTO
+
 }  // namespace
 
+UnverifiedAES256::Implementation UnverifiedAES256::GetDefaultImplementation() {
+  static const Implementation kDefault =
+      IsAvailable(AESNI) ? AESNI :
+      IsAvailable(ARMV8_CRYPTO) ? ARMV8_CRYPTO : SCALAR;
+  return kDefault;
+}
+
+bool UnverifiedAES256::IsAvailable(Implementation impl) {
+  switch (impl) {
+    case SCALAR:
+      return true;
+#ifdef MOZC_AES256_AESNI
+    case AESNI:
+      return CpuSupportsAESNI();
+#endif  // MOZC_AES256_AESNI
+#ifdef MOZC_AES256_ARMV8_CRYPTO
+    case ARMV8_CRYPTO:
+      return true;
+#endif  // MOZC_AES256_ARMV8_CRYPTO
+    default:
+      return false;
+  }
+}
+
 void UnverifiedAES256::TransformCBC(const uint8 (&key)[kKeyBytes],
                                     const uint8 (&iv)[kBlockBytes],
                                     uint8 *block,
                                     size_t block_count) {
+  TransformCBCWithImplementation(GetDefaultImplementation(), key, iv, block,
+                                 block_count);
+}
+
+void UnverifiedAES256::InverseTransformCBC(const uint8 (&key)[kKeyBytes],
+                                           const uint8 (&iv)[kBlockBytes],
+                                           uint8 *block,
+                                           size_t block_count) {
+  InverseTransformCBCWithImplementation(GetDefaultImplementation(), key, iv,
+                                        block, block_count);
+}
+
+void UnverifiedAES256::TransformCBCWithImplementation(
+    Implementation impl,
+    const uint8 (&key)[kKeyBytes],
+    const uint8 (&iv)[kBlockBytes],
+    uint8 *block,
+    size_t block_count) {
+  DCHECK(IsAvailable(impl));
   uint8 w[kKeyScheduleBytes];
   MakeKeySchedule(key, w);
 
+  switch (impl) {
+#ifdef MOZC_AES256_AESNI
+    case AESNI:
+      TransformCBCAESNI(w, iv, block, block_count);
+      return;
+#endif  // MOZC_AES256_AESNI
+#ifdef MOZC_AES256_ARMV8_CRYPTO
+    case ARMV8_CRYPTO:
+      TransformCBCARMv8(w, iv, block, block_count);
+      return;
+#endif  // MOZC_AES256_ARMV8_CRYPTO
+    default:
+      break;
+  }
+
   uint8 vec[kBlockBytes];
   memcpy(vec, iv, kBlockBytes);
   for (size_t i = 0; i < block_count; ++i) {
@@ -179,13 +409,31 @@ void UnverifiedAES256::TransformCBC(const uint8 (&key)[kKeyBytes],
   }
 }
 
-void UnverifiedAES256::InverseTransformCBC(const uint8 (&key)[kKeyBytes],
-                                           const uint8 (&iv)[kBlockBytes],
-                                           uint8 *block,
-                                           size_t block_count) {
+void UnverifiedAES256::InverseTransformCBCWithImplementation(
+    Implementation impl,
+    const uint8 (&key)[kKeyBytes],
+    const uint8 (&iv)[kBlockBytes],
+    uint8 *block,
+    size_t block_count) {
+  DCHECK(IsAvailable(impl));
   uint8 w[kKeyScheduleBytes];
   MakeKeySchedule(key, w);
 
+  switch (impl) {
+#ifdef MOZC_AES256_AESNI
+    case AESNI:
+      InverseTransformCBCAESNI(w, iv, block, block_count);
+      return;
+#endif  // MOZC_AES256_AESNI
+#ifdef MOZC_AES256_ARMV8_CRYPTO
+    case ARMV8_CRYPTO:
+      InverseTransformCBCARMv8(w, iv, block, block_count);
+      return;
+#endif  // MOZC_AES256_ARMV8_CRYPTO
+    default:
+      break;
+  }
+
   uint8 prev_block[kBlockBytes];
   memcpy(prev_block, iv, kBlockBytes);
   for (size_t i = 0; i < block_count; ++i) {
@@ -38,8 +38,11 @@ namespace internal {
 // Note that this implemenation is kept just for the backward compatibility
 // so that we can read previously obfuscated data.
 // !!! Not FIPS-certified.
-// !!! Performance optimization is not well considered.
-// !!! Side-channel attack is not well considered.
+// !!! Side-channel attack is not well considered for the scalar
+// !!! implementation.
+// The AES instructions of the CPU (AES-NI or ARMv8 Crypto Extensions) are used
+// when they are available.  All the implementations produce exactly the same
+// output, so the obfuscated data is compatible among them.
 // TODO(team): Consider to remove this class and stop doing obfuscation.
 class UnverifiedAES256 {
  public:
@@ -47,6 +50,18 @@ class UnverifiedAES256 {
   static const size_t kBlockBytes = 16;  // 128 bit
   static const size_t kKeyScheduleBytes = 240;
 
+  enum Implementation {
+    SCALAR,
+    AESNI,
+    ARMV8_CRYPTO,
+  };
+
+  // Returns the fastest implementation available on this machine.
+  static Implementation GetDefaultImplementation();
+
+  // Returns true if |impl| can run on this machine.
+  static bool IsAvailable(Implementation impl);
+
   // Does AES256 CBC transformation.
   // CAVEATS: See the above comment.
   static void TransformCBC(const uint8 (&key)[kKeyBytes],
@@ -61,6 +76,20 @@ class UnverifiedAES256 {
                                   uint8 *buffer,
                                   size_t block_count);
 
+  // Same as above but always use |impl|, which must be available.  Exposed
+  // for testing and benchmarking.
+  static void TransformCBCWithImplementation(Implementation impl,
+                                             const uint8 (&key)[kKeyBytes],
+                                             const uint8 (&iv)[kBlockBytes],
+                                             uint8 *buffer,
+                                             size_t block_count);
+  static void InverseTransformCBCWithImplementation(
+      Implementation impl,
+      const uint8 (&key)[kKeyBytes],
+      const uint8 (&iv)[kBlockBytes],
+      uint8 *buffer,
+      size_t block_count);
+
  protected:
   // Does AES256 ECB transformation.
   // CAVEATS: See the above comment.
@@ -28,6 +28,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "base/unverified_aes256.h"
+
+#include <vector>
+
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -452,6 +455,61 @@ TEST(UnverifiedAES256Test, InverseTransformCBC_NonZero) {
   EXPECT_EQ_ARRAY(kExpected, block);
 }
 
+const UnverifiedAES256::Implementation kImplementations[] = {
+  UnverifiedAES256::SCALAR,
+  UnverifiedAES256::AESNI,
+  UnverifiedAES256::ARMV8_CRYPTO,
+};
+
+TEST(UnverifiedAES256Test, DefaultImplementationIsAvailable) {
+  EXPECT_TRUE(UnverifiedAES256::IsAvailable(UnverifiedAES256::SCALAR));
+  EXPECT_TRUE(UnverifiedAES256::IsAvailable(
+      UnverifiedAES256::GetDefaultImplementation()));
+}
+
+// Every implementation must produce the same bytes as the scalar one so that
+// the data obfuscated on one machine can be read on another.  The block
+// counts cover the tails of the interleaved decryption loop.
+TEST(UnverifiedAES256Test, ImplementationsAreCompatible) {
+  uint8 key[UnverifiedAES256::kKeyBytes];
+  uint8 iv[UnverifiedAES256::kBlockBytes];
+  uint32 seed = 12345;
+  for (size_t i = 0; i < arraysize(key); ++i) {
+    seed = seed * 1103515245 + 12345;
+    key[i] = static_cast<uint8>(seed >> 16);
+  }
+  for (size_t i = 0; i < arraysize(iv); ++i) {
+    seed = seed * 1103515245 + 12345;
+    iv[i] = static_cast<uint8>(seed >> 16);
+  }
+
+  for (size_t num_blocks = 1; num_blocks <= 11; ++num_blocks) {
+    std::vector<uint8> plain(num_blocks * UnverifiedAES256::kBlockBytes);
+    for (size_t i = 0; i < plain.size(); ++i) {
+      seed = seed * 1103515245 + 12345;
+      plain[i] = static_cast<uint8>(seed >> 16);
+    }
+    std::vector<uint8> expected = plain;
+    UnverifiedAES256::TransformCBCWithImplementation(
+        UnverifiedAES256::SCALAR, key, iv, &expected[0], num_blocks);
+
+    for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+      if (!UnverifiedAES256::IsAvailable(kImplementations[i])) {
+        continue;
+      }
+      std::vector<uint8> buffer = plain;
+      UnverifiedAES256::TransformCBCWithImplementation(
+          kImplementations[i], key, iv, &buffer[0], num_blocks);
+      EXPECT_EQ(expected, buffer) << "impl: " << kImplementations[i]
+                                  << ", num_blocks: " << num_blocks;
+      UnverifiedAES256::InverseTransformCBCWithImplementation(
+          kImplementations[i], key, iv, &buffer[0], num_blocks);
+      EXPECT_EQ(plain, buffer) << "impl: " << kImplementations[i]
+                               << ", num_blocks: " << num_blocks;
+    }
+  }
+}
+
 // TODO(yukawa): Add more tests based on well-known test vectors.
 
 }  // namespace
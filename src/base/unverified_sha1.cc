@@ -29,11 +29,8 @@
 
 #include "base/unverified_sha1.h"
 
-#include <algorithm>
 #include <climits>  // for CHAR_BIT
-#include <type_traits>
-
-#include "base/logging.h"
+#include <cstring>
 
 namespace mozc {
 namespace internal {
@@ -41,25 +38,10 @@ namespace {
 
 const size_t kNumDWordsOfDigest = 5;
 
-// See 4.1.1 SHA-1 Functions
-// http://csrc.nist.gov/publications/fips/fips180-4/fips-180-4.pdf
-uint32 f(uint32 t, uint32 x, uint32 y, uint32 z) {
-  if (t < 20) {
-    // Note: The logic here was originally defined as
-    //   return (x & y) | ((~x) & z);
-    // in FIPS 180-1 but revised as follows in FIPS 180-2.
-    return (x & y) ^ ((~x) & z);
-  } else if (t < 40) {
-    return x ^ y ^ z;
-  } else if (t < 60) {
-    // Note: The logic here was originally defined as
-    //   return (x & y) | (x & z) | (y & z);
-    // in FIPS 180-1 but revised as follows in FIPS 180-2.
-    return (x & y) ^ (x & z) ^ (y & z);
-  } else {
-    return x ^ y ^ z;
-  }
-}
+// SHA1 uses 64-byte (512-bit) message block.
+const size_t kMessageBlockBytes = 64;
+// The original data length in bit is stored as 8-byte-length data.
+const size_t kDataBitLengthBytes = sizeof(uint64);
 
 // See 3.2 Operations on Words
 // http://csrc.nist.gov/publications/fips/fips180-4/fips-180-4.pdf
@@ -70,19 +52,42 @@ uint32 ROTL(uint32 x) {
   return (x << N) | (x >> (kUint32Bits - N));
 }
 
-// See 4.2.1 SHA-1 Constants
+// See 4.1.1 SHA-1 Functions and 4.2.1 SHA-1 Constants
 // http://csrc.nist.gov/publications/fips/fips180-4/fips-180-4.pdf
-uint32 K(uint32 t) {
-  if (t < 20) {
-    return 0x5a827999;
-  } else if (t < 40) {
-    return 0x6ed9eba1;
-  } else if (t < 60) {
-    return 0x8f1bbcdc;
-  } else {
-    return 0xca62c1d6;
+// The rounds are split by the function so that each loop has no branch.
+struct Ch {
+  static const uint32 kK = 0x5a827999;
+  // Note: The logic here was originally defined as
+  //   return (x & y) | ((~x) & z);
+  // in FIPS 180-1 but revised as follows in FIPS 180-2.
+  static uint32 f(uint32 x, uint32 y, uint32 z) {
+    return (x & y) ^ ((~x) & z);
   }
-}
+};
+
+struct Parity1 {
+  static const uint32 kK = 0x6ed9eba1;
+  static uint32 f(uint32 x, uint32 y, uint32 z) {
+    return x ^ y ^ z;
+  }
+};
+
+struct Maj {
+  static const uint32 kK = 0x8f1bbcdc;
+  // Note: The logic here was originally defined as
+  //   return (x & y) | (x & z) | (y & z);
+  // in FIPS 180-1 but revised as follows in FIPS 180-2.
+  static uint32 f(uint32 x, uint32 y, uint32 z) {
+    return (x & y) ^ (x & z) ^ (y & z);
+  }
+};
+
+struct Parity2 {
+  static const uint32 kK = 0xca62c1d6;
+  static uint32 f(uint32 x, uint32 y, uint32 z) {
+    return x ^ y ^ z;
+  }
+};
 
 string AsByteStream(const uint32 (&H)[kNumDWordsOfDigest]) {
   string str;
@@ -102,119 +107,64 @@ string AsByteStream(const uint32 (&H)[kNumDWordsOfDigest]) {
   return str;
 }
 
-// Implements 5.1 Padding the Message / 5.1.1 SHA-1, SHA-224 and SHA-256
-class PaddedMessageIterator {
- public:
-  // SHA1 uses 64-byte (512-bit) message block.
-  static const size_t kMessageBlockBytes = 64;
-  // The original data length in bit is stored as 8-byte-length data.
-  static const size_t kDataBitLengthBytes = sizeof(uint64);
-
-  explicit PaddedMessageIterator(StringPiece source)
-      : source_(source),
-        num_total_message_(GetTotalMessageCount(source.size())),
-        message_index_(0) {
-  }
-
-  bool HasMessage() const {
-    return message_index_ < num_total_message_;
-  }
-
-  void FillNextMessage(StringPiece::value_type dest[kMessageBlockBytes]) const {
-    // 5.1.1 SHA-1, SHA-224 and SHA-256
-    static_assert(CHAR_BIT == 8, "Assuming 1 byte == 8 bit");
-
-    const size_t base_index = message_index_ * kMessageBlockBytes;
-    size_t cursor = 0;
-    if (base_index < source_.size()) {
-      const size_t rest = source_.size() - base_index;
-      if (rest >= kMessageBlockBytes) {
-        source_.copy(dest, kMessageBlockBytes, base_index);
-        return;
-      }
-      DCHECK_GT(kMessageBlockBytes, rest);
-      source_.copy(dest, rest, base_index);
-      cursor = rest;
-    }
-
-    // Put the end-of-data marker.
-    if ((base_index + cursor) == source_.size()) {
-      const uint8 kEndOfDataMarker = 0x80;
-      dest[cursor] = kEndOfDataMarker;
-      ++cursor;
-    }
-
-    // Hereafter, we will fill the original data length (excluding the padding
-    // data) in bit as 8-byte block at the end of the last message block.
-    // Until then, all the byte will be filled with 0x00.
-
-    const size_t kMessageBlockZeroFillLimit =
-        kMessageBlockBytes - kDataBitLengthBytes;
-
-    if (cursor > kMessageBlockZeroFillLimit) {
-      // The current message block does not have enough room to store 8-byte
-      // length data. The data length will be stored into the next message.
-      // Until then, fill 0x00.
-      memset(dest + cursor, 0x00, kMessageBlockBytes - cursor);
-      return;
-    }
-
-    // Fill 0x00 for padding.
-    memset(dest + cursor, 0x00, kMessageBlockZeroFillLimit - cursor);
+// Reads a big-endian uint32.  The conversion is arithmetic, so it works on
+// any endianness and alignment.
+uint32 LoadBigEndian32(const uint8 *p) {
+  return (static_cast<uint32>(p[0]) << 24) |
+         (static_cast<uint32>(p[1]) << 16) |
+         (static_cast<uint32>(p[2]) << 8) |
+         (static_cast<uint32>(p[3]) << 0);
+}
 
-    // Store the original data bit-length into the last 8-byte of this message.
-    const uint64 bit_length = source_.size() * 8;
-    for (size_t i = 0; i < 8; ++i) {
-      // Big-endian is required.
-      const size_t shift = (7 - i) * 8;
-      const size_t pos = kMessageBlockZeroFillLimit + i;
-      DCHECK_LT(pos, kMessageBlockBytes);
-      dest[pos] = static_cast<uint8>((bit_length >> shift) & 0xff);
+// Runs the rounds [|begin|, |begin| + 20) with |Function|.  The message
+// schedule W (6.1.2) is kept as a ring of the last 16 words.
+template <typename Function>
+void RunRounds(size_t begin, uint32 (&W)[16], uint32 *a, uint32 *b,
+               uint32 *c, uint32 *d, uint32 *e) {
+  for (size_t t = begin; t < begin + 20; ++t) {
+    if (t >= 16) {
+      W[t & 15] = ROTL<1>(W[(t - 3) & 15] ^ W[(t - 8) & 15] ^
+                          W[(t - 14) & 15] ^ W[t & 15]);
     }
+    const uint32 T =
+        ROTL<5>(*a) + Function::f(*b, *c, *d) + *e + W[t & 15] + Function::kK;
+    *e = *d;
+    *d = *c;
+    *c = ROTL<30>(*b);
+    *b = *a;
+    *a = T;
   }
+}
 
-  void MoveNext() {
-    ++message_index_;
-  }
-
- private:
-  // Returns the total message count.
-  static size_t GetTotalMessageCount(size_t original_message_size) {
-    // In short, the total data size is always larger than the original data
-    // size because of:
-    // - 1 byte marker for end-of-data.
-    // - (if any) 0x00 byte sequence to pad each message as 64-byte.
-    // - 8 byte integer to store the original data size in bit.
-    // At minimum, we need additional 9 bytes.
-    const size_t kEndOfDataMarkerBytes = 1;
-    const size_t minimum_size =
-        original_message_size + kEndOfDataMarkerBytes + kDataBitLengthBytes;
-    // TODO(yukawa): Fix subtle overflow case.
-    return (minimum_size + kMessageBlockBytes - 1) / kMessageBlockBytes;
+// 6.1.2 SHA-1 Hash Computation for one message block.
+void ProcessMessageBlock(const uint8 *message,
+                         uint32 (&H)[kNumDWordsOfDigest]) {
+  uint32 W[16];
+  for (size_t i = 0; i < 16; ++i) {
+    W[i] = LoadBigEndian32(message + i * 4);
   }
 
-  const StringPiece source_;
-  const size_t num_total_message_;
-  size_t message_index_;
-};
-
-// Converts a character to uint32 bit pattern by prepending 0's while keeping
-// the original bit pattern in lowest 8 bits.
-uint32 CharToUint32(char c) {
-  // In case char is signed, we need to first convert c to uint8; see the
-  // following example:
-  //
-  // signed char c = -1;
-  // uint32_t a = static_cast<uint32_t>(c);
-  // uint32_t b = static_cast<uint32_t>(static_cast<uint8_t>(c));
-  //
-  // Result:
-  //   a == 4294967295  (converted through -1 of 32-bit integer)
-  //   b == 255
-  return static_cast<uint32>(static_cast<uint8>(c));
+  uint32 a = H[0];
+  uint32 b = H[1];
+  uint32 c = H[2];
+  uint32 d = H[3];
+  uint32 e = H[4];
+
+  RunRounds<Ch>(0, W, &a, &b, &c, &d, &e);
+  RunRounds<Parity1>(20, W, &a, &b, &c, &d, &e);
+  RunRounds<Maj>(40, W, &a, &b, &c, &d, &e);
+  RunRounds<Parity2>(60, W, &a, &b, &c, &d, &e);
+
+  H[0] += a;
+  H[1] += b;
+  H[2] += c;
+  H[3] += d;
+  H[4] += e;
 }
 
 string MakeDigestImpl(StringPiece source) {
+  static_assert(CHAR_BIT == 8, "Assuming 1 byte == 8 bit");
+
   // 5.3 Setting the Initial Hash Value / 5.3.1 SHA-1
 
   // 6.1.1 SHA-1 Preprocessing
@@ -226,43 +176,34 @@ string MakeDigestImpl(StringPiece source) {
     0xc3d2e1f0,
   };
 
-  // 6.1.2 SHA-1 Hash Computation
-  for (PaddedMessageIterator it(source); it.HasMessage(); it.MoveNext()) {
-    StringPiece::value_type message[64];
-    it.FillNextMessage(message);
-
-    uint32 W[80];  // Message schedule.
-    for (size_t i = 0; i < 16; ++i) {
-      const size_t base_index = i * 4;
-      W[i] = (CharToUint32(message[base_index + 0]) << 24) |
-             (CharToUint32(message[base_index + 1]) << 16) |
-             (CharToUint32(message[base_index + 2]) << 8) |
-             (CharToUint32(message[base_index + 3]) << 0);
-    }
-    for (size_t t = 16; t < 80; ++t) {
-      W[t] = ROTL<1>(W[t - 3] ^ W[t - 8] ^ W[t - 14] ^ W[t - 16]);
-    }
-
-    uint32 a = H[0];
-    uint32 b = H[1];
-    uint32 c = H[2];
-    uint32 d = H[3];
-    uint32 e = H[4];
-
-    for (size_t t = 0; t < 80; ++t) {
-      const uint32 T = ROTL<5>(a) + f(t, b, c, d) + e + W[t] + K(t);
-      e = d;
-      d = c;
-      c = ROTL<30>(b);
-      b = a;
-      a = T;
-    }
+  // The whole message blocks are hashed in place without copying.
+  const uint8 *data = reinterpret_cast<const uint8 *>(source.data());
+  const size_t num_whole_blocks = source.size() / kMessageBlockBytes;
+  for (size_t i = 0; i < num_whole_blocks; ++i) {
+    ProcessMessageBlock(data + i * kMessageBlockBytes, H);
+  }
 
-    H[0] += a;
-    H[1] += b;
-    H[2] += c;
-    H[3] += d;
-    H[4] += e;
+  // 5.1 Padding the Message / 5.1.1 SHA-1, SHA-224 and SHA-256
+  // The rest of the data, the end-of-data marker, the 0x00 padding and the
+  // original data length in bit take one or two more blocks.
+  uint8 tail[kMessageBlockBytes * 2];
+  const size_t rest = source.size() - num_whole_blocks * kMessageBlockBytes;
+  memcpy(tail, data + num_whole_blocks * kMessageBlockBytes, rest);
+  const uint8 kEndOfDataMarker = 0x80;
+  tail[rest] = kEndOfDataMarker;
+  const size_t tail_size =
+      (rest + 1 + kDataBitLengthBytes <= kMessageBlockBytes) ?
+      kMessageBlockBytes : kMessageBlockBytes * 2;
+  memset(tail + rest + 1, 0x00, tail_size - rest - 1);
+  // Store the original data bit-length into the last 8-byte in big-endian.
+  const uint64 bit_length = static_cast<uint64>(source.size()) * 8;
+  for (size_t i = 0; i < kDataBitLengthBytes; ++i) {
+    const size_t shift = (7 - i) * 8;
+    tail[tail_size - kDataBitLengthBytes + i] =
+        static_cast<uint8>((bit_length >> shift) & 0xff);
+  }
+  for (size_t offset = 0; offset < tail_size; offset += kMessageBlockBytes) {
+    ProcessMessageBlock(tail + offset, H);
   }
 
   return AsByteStream(H);
@@ -109,6 +109,39 @@ TEST(UnverifiedSHA1Test, ManyBlockMessage) {
   EXPECT_EQ_HASH(kExpected, UnverifiedSHA1::MakeDigest(input));
 }
 
+TEST(UnverifiedSHA1Test, PaddingBoundary) {
+  // 55 bytes is the longest message whose padding fits in one block.
+  {
+    const string input(55, 'a');
+    const uint8 kExpected[kDigestLength] = {
+      0xc1, 0xc8, 0xbb, 0xdc, 0x22, 0x79, 0x6e, 0x28,
+      0xc0, 0xe1, 0x51, 0x63, 0xd2, 0x08, 0x99, 0xb6,
+      0x56, 0x21, 0xd6, 0x5a,
+    };
+    EXPECT_EQ_HASH(kExpected, UnverifiedSHA1::MakeDigest(input));
+  }
+  // 56 bytes needs an extra block only for the padding.
+  {
+    const string input(56, 'a');
+    const uint8 kExpected[kDigestLength] = {
+      0xc2, 0xdb, 0x33, 0x0f, 0x60, 0x83, 0x85, 0x4c,
+      0x99, 0xd4, 0xb5, 0xbf, 0xb6, 0xe8, 0xf2, 0x9f,
+      0x20, 0x1b, 0xe6, 0x99,
+    };
+    EXPECT_EQ_HASH(kExpected, UnverifiedSHA1::MakeDigest(input));
+  }
+  // 64 bytes is exactly one block of data.
+  {
+    const string input(64, 'a');
+    const uint8 kExpected[kDigestLength] = {
+      0x00, 0x98, 0xba, 0x82, 0x4b, 0x5c, 0x16, 0x42,
+      0x7b, 0xd7, 0xa1, 0x12, 0x2a, 0x5a, 0x44, 0x2a,
+      0x25, 0xec, 0x64, 0x4d,
+    };
+    EXPECT_EQ_HASH(kExpected, UnverifiedSHA1::MakeDigest(input));
+  }
+}
+
 // TODO(yukawa): Add more tests based on well-known test vectors.
 
 }  // namespace
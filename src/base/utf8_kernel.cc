@@ -0,0 +1,468 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/utf8_kernel.h"
+
+#include <cstring>
+
+#include "base/logging.h"
+#include "base/port.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MOZC_UTF8_KERNEL_X86
+#include <immintrin.h>
+// The whole tree is built without -mavx2, so the SIMD functions are compiled
+// for their instruction sets individually and are called only if the CPU
+// supports them.
+#define MOZC_UTF8_KERNEL_TARGET(name) __attribute__((target(name)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MOZC_UTF8_KERNEL_X86
+#include <intrin.h>
+#include <immintrin.h>
+#define MOZC_UTF8_KERNEL_TARGET(name)
+#endif
+
+namespace mozc {
+namespace {
+
+const uint64 kHighBits = 0x8080808080808080ULL;
+
+// Same as Util::OneCharLen.
+inline size_t CharLen(uint8 leading_byte) {
+  if (leading_byte < 0xc0) {
+    return 1;
+  } else if (leading_byte < 0xe0) {
+    return 2;
+  } else if (leading_byte < 0xf0) {
+    return 3;
+  }
+  return 4;
+}
+
+inline size_t PopCount(uint64 x) {
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return static_cast<size_t>((x * 0x0101010101010101ULL) >> 56);
+}
+
+// Returns the index of the lowest set bit.  |x| must not be zero.
+inline size_t LowestBit(uint64 x) {
+  DCHECK_NE(0, x);
+  size_t i = 0;
+  for (; (x & 1) == 0; x >>= 1) {
+    ++i;
+  }
+  return i;
+}
+
+size_t SkipCharsScalar(const char *src, size_t length, size_t max_chars,
+                       size_t *num_chars) {
+  size_t pos = 0;
+  size_t n = 0;
+  for (; n < max_chars && pos < length; ++n) {
+    pos += CharLen(static_cast<uint8>(src[pos]));
+  }
+  *num_chars = n;
+  return pos;
+}
+
+size_t AsciiPrefixLengthScalar(const char *src, size_t length) {
+  size_t pos = 0;
+  for (; pos < length && static_cast<uint8>(src[pos]) < 0x80; ++pos) {}
+  return pos;
+}
+
+// Takes the block of |width| bytes starting at a character boundary, given
+// the bit masks of its continuation bytes and of the leading bytes of two or
+// more, three or more and four bytes, where bit i stands for block[i].
+// Returns false if the continuation bytes are not exactly the ones claimed by
+// the leading bytes in the block, in which case the stepping would not
+// visit all the other bytes.  Otherwise stores the number of the characters
+// starting in the block and the offset where the stepping leaves the block.
+inline bool TakeBlock(const char *block, size_t width, uint64 continuation,
+                      uint64 lead2, uint64 lead3, uint64 lead4,
+                      size_t *num_chars, size_t *advance) {
+  const uint64 full = (width == 64) ? ~0ULL : ((1ULL << width) - 1);
+  const uint64 claimed = ((lead2 << 1) | (lead3 << 2) | (lead4 << 3)) & full;
+  if (claimed != continuation) {
+    return false;
+  }
+  *num_chars = PopCount(~continuation & full);
+  // The last character may run over the block.  Bit 0 is not a continuation
+  // byte here, so the loop stops.
+  size_t last = width - 1;
+  for (; (continuation >> last) & 1; --last) {}
+  const size_t end = last + CharLen(static_cast<uint8>(block[last]));
+  *advance = (end > width) ? end : width;
+  return true;
+}
+
+// Takes blocks from the beginning of |src| while possible, and returns the
+// offset and the number of the characters taken, like SkipChars.
+typedef size_t (*ScanFunc)(const char *, size_t, size_t, size_t *);
+
+// Runs |scan| and, where it stops at a block which cannot be taken, steps
+// over |width| bytes with the scalar loop so that a broken block does not
+// stop the SIMD loop for the rest of the string.
+
+size_t SkipCharsWithScan(ScanFunc scan, size_t width, const char *src,
+                         size_t length, size_t max_chars, size_t *num_chars) {
+  size_t pos = 0;
+  size_t n = 0;
+  while (n < max_chars && pos < length) {
+    size_t scanned = 0;
+    pos += (*scan)(src + pos, length - pos, max_chars - n, &scanned);
+    n += scanned;
+    // The block at |pos| was not taken.  Steps over it one by one.
+    const size_t block_end = pos + width;
+    for (; n < max_chars && pos < length && pos < block_end; ++n) {
+      pos += CharLen(static_cast<uint8>(src[pos]));
+    }
+  }
+  *num_chars = n;
+  return pos;
+}
+
+const size_t kWordWidth = 8;
+
+// Takes only the blocks of ASCII characters as the masks cannot be gathered
+// cheaply from a word.
+size_t ScanWord(const char *src, size_t length, size_t max_chars,
+                size_t *num_chars) {
+  size_t pos = 0;
+  size_t n = 0;
+  for (; pos + kWordWidth <= length && n + kWordWidth <= max_chars;
+       pos += kWordWidth, n += kWordWidth) {
+    uint64 w;
+    memcpy(&w, src + pos, sizeof(w));
+    if (w & kHighBits) {
+      break;
+    }
+  }
+  *num_chars = n;
+  return pos;
+}
+
+size_t SkipCharsWord(const char *src, size_t length, size_t max_chars,
+                     size_t *num_chars) {
+  // Non-ASCII text would call ScanWord for every word in vain, so the scalar
+  // loop takes a few words after a miss.
+  return SkipCharsWithScan(&ScanWord, 4 * kWordWidth, src, length, max_chars,
+                           num_chars);
+}
+
+size_t AsciiPrefixLengthWord(const char *src, size_t length) {
+  size_t pos = 0;
+  for (; pos + kWordWidth <= length; pos += kWordWidth) {
+    uint64 w;
+    memcpy(&w, src + pos, sizeof(w));
+    if (w & kHighBits) {
+      break;
+    }
+  }
+  return pos + AsciiPrefixLengthScalar(src + pos, length - pos);
+}
+
+#ifdef MOZC_UTF8_KERNEL_X86
+const size_t kSSE2Width = 16;
+const size_t kAVX2Width = 32;
+
+// Takes the 16-byte block at |block| if it has at most |max_chars|
+// characters.  This is inlined to the AVX2 functions as well, so their
+// tails are also encoded with VEX and do not switch to the legacy SSE.
+MOZC_UTF8_KERNEL_TARGET("sse2")
+inline bool TakeBlockSSE2(const char *block, size_t max_chars,
+                          size_t *num_chars, size_t *advance) {
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+  if (_mm_movemask_epi8(v) == 0) {
+    if (max_chars < kSSE2Width) {
+      return false;
+    }
+    *num_chars = kSSE2Width;
+    *advance = kSSE2Width;
+    return true;
+  }
+  const __m128i c0 = _mm_set1_epi8(static_cast<char>(0xc0));
+  const __m128i e0 = _mm_set1_epi8(static_cast<char>(0xe0));
+  const __m128i f0 = _mm_set1_epi8(static_cast<char>(0xf0));
+  const __m128i top2 = _mm_and_si128(v, c0);
+  const uint64 continuation = static_cast<uint32>(_mm_movemask_epi8(
+      _mm_cmpeq_epi8(top2, _mm_set1_epi8(static_cast<char>(0x80)))));
+  const uint64 lead2 = static_cast<uint32>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(top2, c0)));
+  const uint64 lead3 = static_cast<uint32>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, e0), e0)));
+  const uint64 lead4 = static_cast<uint32>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, f0), f0)));
+  return TakeBlock(block, kSSE2Width, continuation, lead2, lead3, lead4,
+                   num_chars, advance) &&
+         *num_chars <= max_chars;
+}
+
+// Returns the offset of the first non-ASCII byte in the 16-byte block at
+// |block|, or 16 if there is none.
+MOZC_UTF8_KERNEL_TARGET("sse2")
+inline size_t AsciiPrefixLengthOfBlockSSE2(const char *block) {
+  const int mask = _mm_movemask_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(block)));
+  return (mask == 0) ? kSSE2Width : LowestBit(static_cast<uint32>(mask));
+}
+
+MOZC_UTF8_KERNEL_TARGET("sse2")
+size_t ScanSSE2(const char *src, size_t length, size_t max_chars,
+                size_t *num_chars) {
+  size_t pos = 0;
+  size_t n = 0;
+  size_t chars = 0;
+  size_t advance = 0;
+  while (pos + kSSE2Width <= length &&
+         TakeBlockSSE2(src + pos, max_chars - n, &chars, &advance)) {
+    n += chars;
+    pos += advance;
+  }
+  *num_chars = n;
+  return pos;
+}
+
+size_t SkipCharsSSE2(const char *src, size_t length, size_t max_chars,
+                     size_t *num_chars) {
+  return SkipCharsWithScan(&ScanSSE2, kSSE2Width, src, length, max_chars,
+                           num_chars);
+}
+
+MOZC_UTF8_KERNEL_TARGET("sse2")
+size_t AsciiPrefixLengthSSE2(const char *src, size_t length) {
+  size_t pos = 0;
+  for (; pos + kSSE2Width <= length; pos += kSSE2Width) {
+    const size_t prefix = AsciiPrefixLengthOfBlockSSE2(src + pos);
+    if (prefix < kSSE2Width) {
+      return pos + prefix;
+    }
+  }
+  return pos + AsciiPrefixLengthScalar(src + pos, length - pos);
+}
+
+// Takes 32-byte blocks, and then 16-byte ones for the rest.
+MOZC_UTF8_KERNEL_TARGET("avx2")
+size_t ScanAVX2(const char *src, size_t length, size_t max_chars,
+                size_t *num_chars) {
+  const __m256i c0 = _mm256_set1_epi8(static_cast<char>(0xc0));
+  const __m256i e0 = _mm256_set1_epi8(static_cast<char>(0xe0));
+  const __m256i f0 = _mm256_set1_epi8(static_cast<char>(0xf0));
+  const __m256i x80 = _mm256_set1_epi8(static_cast<char>(0x80));
+  size_t pos = 0;
+  size_t n = 0;
+  size_t chars = 0;
+  size_t advance = 0;
+  while (pos + kAVX2Width <= length) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos));
+    if (_mm256_movemask_epi8(v) == 0) {
+      if (n + kAVX2Width > max_chars) {
+        break;
+      }
+      n += kAVX2Width;
+      pos += kAVX2Width;
+      continue;
+    }
+    const __m256i top2 = _mm256_and_si256(v, c0);
+    const uint64 continuation = static_cast<uint32>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(top2, x80)));
+    const uint64 lead2 = static_cast<uint32>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(top2, c0)));
+    const uint64 lead3 = static_cast<uint32>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_and_si256(v, e0), e0)));
+    const uint64 lead4 = static_cast<uint32>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_and_si256(v, f0), f0)));
+    if (!TakeBlock(src + pos, kAVX2Width, continuation, lead2, lead3, lead4,
+                   &chars, &advance) ||
+        n + chars > max_chars) {
+      break;
+    }
+    n += chars;
+    pos += advance;
+  }
+  while (pos + kSSE2Width <= length &&
+         TakeBlockSSE2(src + pos, max_chars - n, &chars, &advance)) {
+    n += chars;
+    pos += advance;
+  }
+  *num_chars = n;
+  return pos;
+}
+
+size_t SkipCharsAVX2(const char *src, size_t length, size_t max_chars,
+                     size_t *num_chars) {
+  return SkipCharsWithScan(&ScanAVX2, kSSE2Width, src, length, max_chars,
+                           num_chars);
+}
+
+MOZC_UTF8_KERNEL_TARGET("avx2")
+size_t AsciiPrefixLengthAVX2(const char *src, size_t length) {
+  size_t pos = 0;
+  for (; pos + kAVX2Width <= length; pos += kAVX2Width) {
+    const int mask = _mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos)));
+    if (mask != 0) {
+      return pos + LowestBit(static_cast<uint32>(mask));
+    }
+  }
+  if (pos + kSSE2Width <= length) {
+    const size_t prefix = AsciiPrefixLengthOfBlockSSE2(src + pos);
+    if (prefix < kSSE2Width) {
+      return pos + prefix;
+    }
+    pos += kSSE2Width;
+  }
+  return pos + AsciiPrefixLengthScalar(src + pos, length - pos);
+}
+
+bool CpuSupportsSSE2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[3] & (1 << 26)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse2");
+#endif  // _MSC_VER
+}
+
+bool CpuSupportsAVX2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  const bool os_saves_ymm =
+      (info[2] & (1 << 27)) != 0 &&  // OSXSAVE
+      (info[2] & (1 << 28)) != 0 &&  // AVX
+      (_xgetbv(0) & 0x6) == 0x6;
+  if (!os_saves_ymm) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif  // _MSC_VER
+}
+#endif  // MOZC_UTF8_KERNEL_X86
+
+typedef size_t (*SkipCharsFunc)(const char *, size_t, size_t, size_t *);
+typedef size_t (*AsciiPrefixLengthFunc)(const char *, size_t);
+
+SkipCharsFunc GetSkipCharsFunction(Utf8Kernel::Implementation impl) {
+  switch (impl) {
+    case Utf8Kernel::WORD:
+      return &SkipCharsWord;
+#ifdef MOZC_UTF8_KERNEL_X86
+    case Utf8Kernel::SSE2:
+      return &SkipCharsSSE2;
+    case Utf8Kernel::AVX2:
+      return &SkipCharsAVX2;
+#endif  // MOZC_UTF8_KERNEL_X86
+    default:
+      return &SkipCharsScalar;
+  }
+}
+
+AsciiPrefixLengthFunc GetAsciiPrefixLengthFunction(
+    Utf8Kernel::Implementation impl) {
+  switch (impl) {
+    case Utf8Kernel::WORD:
+      return &AsciiPrefixLengthWord;
+#ifdef MOZC_UTF8_KERNEL_X86
+    case Utf8Kernel::SSE2:
+      return &AsciiPrefixLengthSSE2;
+    case Utf8Kernel::AVX2:
+      return &AsciiPrefixLengthAVX2;
+#endif  // MOZC_UTF8_KERNEL_X86
+    default:
+      return &AsciiPrefixLengthScalar;
+  }
+}
+
+}  // namespace
+
+Utf8Kernel::Implementation Utf8Kernel::GetDefaultImplementation() {
+  static const Implementation kDefault =
+      IsAvailable(AVX2) ? AVX2 :
+      IsAvailable(SSE2) ? SSE2 : WORD;
+  return kDefault;
+}
+
+bool Utf8Kernel::IsAvailable(Implementation impl) {
+  switch (impl) {
+    case SCALAR:
+    case WORD:
+      return true;
+#ifdef MOZC_UTF8_KERNEL_X86
+    case SSE2:
+      return CpuSupportsSSE2();
+    case AVX2:
+      // The AVX2 implementation falls back to SSE2 for short strings.
+      return CpuSupportsSSE2() && CpuSupportsAVX2();
+#endif  // MOZC_UTF8_KERNEL_X86
+    default:
+      return false;
+  }
+}
+
+size_t Utf8Kernel::SkipChars(const char *src, size_t length,
+                             size_t max_chars, size_t *num_chars) {
+  static const SkipCharsFunc kFunc =
+      GetSkipCharsFunction(GetDefaultImplementation());
+  return (*kFunc)(src, length, max_chars, num_chars);
+}
+
+size_t Utf8Kernel::AsciiPrefixLength(const char *src, size_t length) {
+  static const AsciiPrefixLengthFunc kFunc =
+      GetAsciiPrefixLengthFunction(GetDefaultImplementation());
+  return (*kFunc)(src, length);
+}
+
+size_t Utf8Kernel::SkipCharsWithImplementation(Implementation impl,
+                                               const char *src,
+                                               size_t length,
+                                               size_t max_chars,
+                                               size_t *num_chars) {
+  DCHECK(IsAvailable(impl));
+  return (*GetSkipCharsFunction(impl))(src, length, max_chars, num_chars);
+}
+
+size_t Utf8Kernel::AsciiPrefixLengthWithImplementation(Implementation impl,
+                                                       const char *src,
+                                                       size_t length) {
+  DCHECK(IsAvailable(impl));
+  return (*GetAsciiPrefixLengthFunction(impl))(src, length);
+}
+
+}  // namespace mozc
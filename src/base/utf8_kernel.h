@@ -0,0 +1,95 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_UTF8_KERNEL_H_
+#define MOZC_BASE_UTF8_KERNEL_H_
+
+#include "base/port.h"
+
+namespace mozc {
+
+// The inner loops of the UTF-8 primitives in Util, which step over a string
+// one character at a time by the length of the leading byte.  The SIMD
+// implementations look at a block of bytes at once and take the block as a
+// whole only if its continuation bytes are exactly the ones its leading bytes
+// claim; otherwise they step the block with the scalar loop.  Thus they
+// return exactly the same result as the scalar loop even for broken UTF-8.
+// They are selected at runtime from the CPU features.
+class Utf8Kernel {
+ public:
+  enum Implementation {
+    SCALAR,
+    WORD,  // 8 bytes at once in a uint64.
+    SSE2,
+    AVX2,
+  };
+
+  // Returns the fastest implementation available on this machine.
+  static Implementation GetDefaultImplementation();
+
+  // Returns true if |impl| can run on this machine.
+  static bool IsAvailable(Implementation impl);
+
+  // Steps over at most |max_chars| characters of |src| by the lengths of
+  // their leading bytes, and returns the byte offset where the stepping
+  // stopped.  The number of the characters stepped over is stored to
+  // |num_chars|.  This is equivalent to the following loop:
+  //   size_t pos = 0;
+  //   for (*num_chars = 0; *num_chars < max_chars && pos < length;
+  //        ++*num_chars) {
+  //     pos += Util::OneCharLen(src + pos);
+  //   }
+  //   return pos;
+  // Note that the result may exceed |length| if the last character is
+  // truncated.
+  static size_t SkipChars(const char *src, size_t length, size_t max_chars,
+                          size_t *num_chars);
+
+  // Returns the length of the longest prefix of |src| consisting of ASCII
+  // characters, i.e., the offset of the first byte not less than 0x80.
+  static size_t AsciiPrefixLength(const char *src, size_t length);
+
+  // Same as above but always use |impl|, which must be available.  Exposed
+  // for testing and benchmarking.
+  static size_t SkipCharsWithImplementation(Implementation impl,
+                                            const char *src, size_t length,
+                                            size_t max_chars,
+                                            size_t *num_chars);
+  static size_t AsciiPrefixLengthWithImplementation(Implementation impl,
+                                                    const char *src,
+                                                    size_t length);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(Utf8Kernel);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_UTF8_KERNEL_H_
@@ -0,0 +1,173 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the UTF-8 primitives in Util and the implementations of
+// Utf8Kernel behind them over the lines of a file, and over the romaji of the
+// lines as an ASCII corpus.
+//
+// Usage:
+//   utf8_kernel_benchmark_main --input=data/test/stress_test/sentences.txt
+
+#include <iostream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/utf8_kernel.h"
+#include "base/util.h"
+
+DEFINE_string(input, "data/test/stress_test/sentences.txt",
+              "file of the UTF-8 lines.  Lines starting with '#' are ignored");
+DEFINE_int32(max_lines, 1000,
+             "maximum number of the lines, which are kept small enough to "
+             "stay in the cache");
+DEFINE_int32(iterations, 1000, "number of passes over the lines");
+
+namespace mozc {
+namespace {
+
+const struct {
+  Utf8Kernel::Implementation impl;
+  const char *name;
+} kImplementations[] = {
+  {Utf8Kernel::SCALAR, "scalar"},
+  {Utf8Kernel::WORD, "word"},
+  {Utf8Kernel::SSE2, "sse2"},
+  {Utf8Kernel::AVX2, "avx2"},
+};
+
+void ReadLines(const string &filename, size_t max_size,
+               std::vector<string> *lines) {
+  InputFileStream ifs(filename.c_str());
+  CHECK(ifs.good()) << "Cannot open " << filename;
+  string line;
+  while (lines->size() < max_size && !getline(ifs, line).fail()) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    lines->push_back(line);
+  }
+}
+
+// Runs |func| over |lines| for --iterations times and prints the time per
+// line.  The sum of the results is printed so that the calls are not
+// optimized away.
+template <typename Func>
+void Measure(const string &name, const std::vector<string> &lines,
+             Func func) {
+  size_t sum = 0;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    for (size_t j = 0; j < lines.size(); ++j) {
+      sum += func(lines[j]);
+    }
+  }
+  stopwatch.Stop();
+  const double ns_per_line =
+      stopwatch.GetElapsedNanoseconds() /
+      static_cast<double>(FLAGS_iterations * lines.size());
+  std::cout << "  " << name << ": " << ns_per_line << " ns/line"
+            << " (sum=" << sum << ")" << std::endl;
+}
+
+void RunBenchmark(const string &corpus_name,
+                  const std::vector<string> &lines) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    bytes += lines[i].size();
+  }
+  std::cout << corpus_name << ": " << lines.size() << " lines, "
+            << bytes << " bytes" << std::endl;
+
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    const Utf8Kernel::Implementation impl = kImplementations[i].impl;
+    if (!Utf8Kernel::IsAvailable(impl)) {
+      continue;
+    }
+    const string name = kImplementations[i].name;
+    Measure("SkipChars/" + name, lines, [impl](const string &line) {
+      size_t num_chars = 0;
+      Utf8Kernel::SkipCharsWithImplementation(
+          impl, line.data(), line.size(), line.size(), &num_chars);
+      return num_chars;
+    });
+    Measure("AsciiPrefixLength/" + name, lines, [impl](const string &line) {
+      return Utf8Kernel::AsciiPrefixLengthWithImplementation(
+          impl, line.data(), line.size());
+    });
+  }
+
+  Measure("Util::CharsLen", lines, [](const string &line) {
+    return Util::CharsLen(line);
+  });
+  Measure("Util::SubStringPiece", lines, [](const string &line) {
+    return Util::SubStringPiece(line, 3, 10).size();
+  });
+  Measure("Util::SplitStringToUtf8Chars", lines, [](const string &line) {
+    std::vector<string> chars;
+    Util::SplitStringToUtf8Chars(line, &chars);
+    return chars.size();
+  });
+  Measure("Util::GetScriptType", lines, [](const string &line) {
+    return static_cast<size_t>(Util::GetScriptType(line));
+  });
+  Measure("ConstChar32Iterator", lines, [](const string &line) {
+    size_t sum = 0;
+    for (ConstChar32Iterator iter(line); !iter.Done(); iter.Next()) {
+      sum += iter.Get();
+    }
+    return sum;
+  });
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  std::vector<string> lines;
+  mozc::ReadLines(FLAGS_input, FLAGS_max_lines, &lines);
+  CHECK(!lines.empty()) << "No line in " << FLAGS_input;
+  mozc::RunBenchmark("input", lines);
+
+  std::vector<string> romaji(lines.size());
+  for (size_t i = 0; i < lines.size(); ++i) {
+    mozc::Util::HiraganaToRomanji(lines[i], &romaji[i]);
+  }
+  mozc::RunBenchmark("romaji", romaji);
+  return 0;
+}
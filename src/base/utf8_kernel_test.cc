@@ -0,0 +1,165 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/utf8_kernel.h"
+
+#include <string>
+
+#include "base/port.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+const Utf8Kernel::Implementation kImplementations[] = {
+  Utf8Kernel::SCALAR,
+  Utf8Kernel::WORD,
+  Utf8Kernel::SSE2,
+  Utf8Kernel::AVX2,
+};
+
+// The loop which the kernel replaces in Util.
+size_t SkipCharsReference(const string &str, size_t max_chars,
+                          size_t *num_chars) {
+  size_t pos = 0;
+  for (*num_chars = 0; *num_chars < max_chars && pos < str.size();
+       ++*num_chars) {
+    pos += Util::OneCharLen(str.data() + pos);
+  }
+  return pos;
+}
+
+size_t AsciiPrefixLengthReference(const string &str) {
+  size_t pos = 0;
+  for (; pos < str.size() && static_cast<uint8>(str[pos]) < 0x80; ++pos) {}
+  return pos;
+}
+
+void ExpectSameAsReference(const string &str) {
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    const Utf8Kernel::Implementation impl = kImplementations[i];
+    if (!Utf8Kernel::IsAvailable(impl)) {
+      continue;
+    }
+    EXPECT_EQ(AsciiPrefixLengthReference(str),
+              Utf8Kernel::AsciiPrefixLengthWithImplementation(
+                  impl, str.data(), str.size()))
+        << "impl: " << impl;
+    const size_t kMaxChars[] = {0, 1, 7, 16, 33, str.size()};
+    for (size_t j = 0; j < arraysize(kMaxChars); ++j) {
+      size_t expected_chars = 0;
+      const size_t expected_pos =
+          SkipCharsReference(str, kMaxChars[j], &expected_chars);
+      size_t actual_chars = 0;
+      EXPECT_EQ(expected_pos, Utf8Kernel::SkipCharsWithImplementation(
+          impl, str.data(), str.size(), kMaxChars[j], &actual_chars))
+          << "impl: " << impl << " max_chars: " << kMaxChars[j];
+      EXPECT_EQ(expected_chars, actual_chars)
+          << "impl: " << impl << " max_chars: " << kMaxChars[j];
+    }
+  }
+}
+
+TEST(Utf8KernelTest, DefaultImplementationIsAvailable) {
+  EXPECT_TRUE(Utf8Kernel::IsAvailable(Utf8Kernel::SCALAR));
+  EXPECT_TRUE(Utf8Kernel::IsAvailable(Utf8Kernel::WORD));
+  EXPECT_TRUE(Utf8Kernel::IsAvailable(
+      Utf8Kernel::GetDefaultImplementation()));
+}
+
+TEST(Utf8KernelTest, ValidStrings) {
+  ExpectSameAsReference("");
+  ExpectSameAsReference("a");
+  ExpectSameAsReference("mozc is a Japanese input method editor.");
+  ExpectSameAsReference("きょうはいいてんきですね。あしたもはれるでしょう。");
+  ExpectSameAsReference("今日はGoogle日本語入力でmozcを使う");
+  // U+00E9, U+20B9F and U+1F600 mixed with ASCII.
+  ExpectSameAsReference(
+      "caf\xC3\xA9 \xF0\xA0\xAE\x9F\xE5\xB1\x8B \xF0\x9F\x98\x80 "
+      "abcdefghijklmnopqrstuvwxyz0123456789 \xF0\x9F\x98\x80");
+}
+
+TEST(Utf8KernelTest, CharactersAcrossBlocks) {
+  // Shifts a multi-byte character over the block boundaries.
+  const char *kChars[] = {"\xC3\xA9", "\xE3\x81\x82", "\xF0\x9F\x98\x80"};
+  for (size_t i = 0; i < arraysize(kChars); ++i) {
+    for (size_t prefix = 0; prefix < 40; ++prefix) {
+      string str(prefix, 'x');
+      str.append(kChars[i]);
+      str.append(40, 'y');
+      ExpectSameAsReference(str);
+      // Truncated at the end.
+      ExpectSameAsReference(str.substr(0, prefix + 1));
+    }
+  }
+}
+
+TEST(Utf8KernelTest, BrokenStrings) {
+  // A leading byte followed by ASCII, stray continuation bytes, and the
+  // bytes out of UTF-8.
+  const char *kBroken[] = {
+    "\xE3" "abc", "\x81\x82\x83", "\xFE\xFF", "\xC0\x80", "\xF8\x88\x80\x80",
+  };
+  for (size_t i = 0; i < arraysize(kBroken); ++i) {
+    for (size_t prefix = 0; prefix < 40; ++prefix) {
+      string str(prefix, 'x');
+      str.append(kBroken[i]);
+      str.append("あいうえおかきくけこ");
+      str.append(kBroken[i]);
+      str.append(20, 'z');
+      ExpectSameAsReference(str);
+    }
+  }
+}
+
+TEST(Utf8KernelTest, RandomBytes) {
+  for (int i = 0; i < 1000; ++i) {
+    string str;
+    const size_t length = Util::Random(100);
+    for (size_t j = 0; j < length; ++j) {
+      // Mixes ASCII, valid Hiragana and broken bytes.
+      const int kind = Util::Random(8);
+      if (kind < 3) {
+        str.push_back(static_cast<char>(Util::Random(0x80)));
+      } else if (kind < 6) {
+        str.append("\xE3\x81\x82");
+      } else if (kind == 6) {
+        str.push_back(static_cast<char>(0x80 + Util::Random(0x40)));
+      } else {
+        str.push_back(static_cast<char>(0xC0 + Util::Random(0x40)));
+      }
+    }
+    ExpectSameAsReference(str);
+  }
+}
+
+}  // namespace
+}  // namespace mozc
@@ -66,6 +66,7 @@
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/string_piece.h"
+#include "base/utf8_kernel.h"
 
 namespace {
 
@@ -134,9 +135,16 @@ char32 ConstChar32Iterator::Get() const {
 }
 
 void ConstChar32Iterator::Next() {
-  if (!done_) {
-    done_ = !Util::SplitFirstChar32(utf8_string_, &current_, &utf8_string_);
+  if (done_) {
+    return;
+  }
+  // Fast path for ASCII, which needs no decoding.
+  if (!utf8_string_.empty() && static_cast<uint8>(utf8_string_[0]) < 0x80) {
+    current_ = static_cast<uint8>(utf8_string_[0]);
+    utf8_string_.remove_prefix(1);
+    return;
   }
+  done_ = !Util::SplitFirstChar32(utf8_string_, &current_, &utf8_string_);
 }
 
 bool ConstChar32Iterator::Done() const {
@@ -281,9 +289,19 @@ void Util::SplitStringAllowEmpty(StringPiece str,
 
 void Util::SplitStringToUtf8Chars(StringPiece str,
                                   std::vector<string> *output) {
+  output->reserve(output->size() + CharsLen(str));
   const char *begin = str.data();
   const char *const end = str.data() + str.size();
   while (begin < end) {
+    // Takes a run of ASCII characters without looking up their lengths.
+    const char *const ascii_end =
+        begin + Utf8Kernel::AsciiPrefixLength(begin, end - begin);
+    for (; begin < ascii_end; ++begin) {
+      output->emplace_back(1, *begin);
+    }
+    if (begin == end) {
+      break;
+    }
     const size_t mblen = OneCharLen(begin);
     output->emplace_back(begin, mblen);
     begin += mblen;
@@ -532,6 +550,43 @@ bool Util::IsUpperOrCapitalizedAscii(StringPiece s) {
   return false;
 }
 
+namespace {
+
+inline bool IsAsciiAlphabetChar(char c) {
+  const char lower = c | 0x20;
+  return 'a' <= lower && lower <= 'z';
+}
+
+}  // namespace
+
+bool Util::IsAsciiAlphabet(StringPiece s) {
+  const uint64 kHighBits = 0x8080808080808080ULL;
+  const uint64 kOnes = 0x0101010101010101ULL;
+  const char *p = s.data();
+  const char *end = p + s.size();
+  for (; end - p >= 8; p += 8) {
+    uint64 w;
+    memcpy(&w, p, sizeof(w));
+    if (w & kHighBits) {
+      return false;
+    }
+    // Every byte is below 0x80 here, so the additions below cannot carry into
+    // the next byte.  Folding to lower case maps only letters into [a-z].
+    const uint64 lower = w | (kOnes * 0x20);
+    const uint64 ge_a = lower + kOnes * (0x80 - 'a');
+    const uint64 gt_z = lower + kOnes * (0x80 - 'z' - 1);
+    if ((ge_a & ~gt_z & kHighBits) != kHighBits) {
+      return false;
+    }
+  }
+  for (; p < end; ++p) {
+    if (!IsAsciiAlphabetChar(*p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void Util::StripWhiteSpaces(const string &input, string *output) {
   DCHECK(output);
   output->clear();
@@ -576,13 +631,9 @@ size_t Util::OneCharLen(const char *src) {
 }
 
 size_t Util::CharsLen(const char *src, size_t length) {
-  const char *begin = src;
-  const char *end = src + length;
-  int result = 0;
-  while (begin < end) {
-    ++result;
-    begin += OneCharLen(begin);
-  }
+  // A string of |length| bytes has at most |length| characters.
+  size_t result = 0;
+  Utf8Kernel::SkipChars(src, length, length, &result);
   return result;
 }
 
@@ -843,26 +894,19 @@ int Util::WideToUTF8(const wstring &input, string *output) {
 #endif  // OS_WIN
 
 StringPiece Util::SubStringPiece(StringPiece src, size_t start) {
-  const char *begin = src.data();
-  const char *end = begin + src.size();
-  for (size_t i = 0; i < start && begin < end; ++i) {
-    begin += OneCharLen(begin);
-  }
-  const size_t prefix_len = begin - src.data();
-  return StringPiece(begin, src.size() - prefix_len);
+  size_t num_chars = 0;
+  const size_t prefix_len =
+      Utf8Kernel::SkipChars(src.data(), src.size(), start, &num_chars);
+  return StringPiece(src.data() + prefix_len, src.size() - prefix_len);
 }
 
 StringPiece Util::SubStringPiece(
     StringPiece src, size_t start, size_t length) {
   src = SubStringPiece(src, start);
-  size_t l = length;
-  const char *substr_end = src.data();
-  const char *const end = src.data() + src.size();
-  while (l > 0 && substr_end < end) {
-    substr_end += OneCharLen(substr_end);
-    --l;
-  }
-  return StringPiece(src.data(), substr_end - src.data());
+  size_t num_chars = 0;
+  const size_t substr_len =
+      Utf8Kernel::SkipChars(src.data(), src.size(), length, &num_chars);
+  return StringPiece(src.data(), substr_len);
 }
 
 void Util::SubString(StringPiece src, size_t start, size_t length,
@@ -1096,6 +1140,274 @@ int LookupDoubleArray(const japanese_util_rule::DoubleArray *array,
   return seekto;
 }
 
+// Converts the longest prefix of [*begin, end) matching a rule, or copies the
+// first character if no rule matches, and advances |*begin|.
+void ConvertFirstUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
+                                  const char *ctable,
+                                  const char **begin, const char *end,
+                                  string *output) {
+  int result = 0;
+  int mblen = LookupDoubleArray(da, *begin, static_cast<int>(end - *begin),
+                                &result);
+  if (mblen > 0) {
+    const char *p = &ctable[result];
+    const size_t len = strlen(p);
+    output->append(p, len);
+    mblen -= static_cast<int32>(p[len + 1]);
+    *begin += mblen;
+  } else {
+    mblen = Util::OneCharLen(*begin);
+    output->append(*begin, mblen);
+    *begin += mblen;
+  }
+}
+
+// A kernel converts a BMP character by one of the rules which have a single
+// character as the key, and stores the result of one or two characters to
+// |output|.  Returns the number of the characters stored.  The characters
+// not in the rule are stored as they are.
+typedef size_t (*CharKernel)(char32 c, char32 output[2]);
+
+size_t HiraganaToKatakanaChar(char32 c, char32 output[2]) {
+  // "ぁ" to "ゔ"
+  output[0] = (0x3041 <= c && c <= 0x3094) ? c + 0x60 : c;
+  return 1;
+}
+
+size_t KatakanaToHiraganaChar(char32 c, char32 output[2]) {
+  // "ァ" to "ヴ"
+  output[0] = (0x30A1 <= c && c <= 0x30F4) ? c - 0x60 : c;
+  return 1;
+}
+
+const char32 kFullWidthAsciiOffset = 0xFF01 - 0x21;
+
+size_t HalfWidthAsciiToFullWidthAsciiChar(char32 c, char32 output[2]) {
+  switch (c) {
+    case 0x20: output[0] = 0x3000; break;  // "　"
+    case 0x22: output[0] = 0x201D; break;  // "”"
+    case 0x27: output[0] = 0x2019; break;  // "’"
+    case 0x2D: output[0] = 0x2212; break;  // "−"
+    case 0x5C: output[0] = 0xFFE5; break;  // "￥"
+    case 0x7E: output[0] = 0x301C; break;  // "〜"
+    default:
+      output[0] = (0x21 <= c && c <= 0x7D) ? c + kFullWidthAsciiOffset : c;
+      break;
+  }
+  return 1;
+}
+
+size_t FullWidthAsciiToHalfWidthAsciiChar(char32 c, char32 output[2]) {
+  switch (c) {
+    case 0x2019: output[0] = 0x27; return 1;  // "’"
+    case 0x201D: output[0] = 0x22; return 1;  // "”"
+    case 0x2212: output[0] = 0x2D; return 1;  // "−"
+    case 0x3000: output[0] = 0x20; return 1;  // "　"
+    case 0x301C: output[0] = 0x7E; return 1;  // "〜"
+    case 0xFFE5: output[0] = 0x5C; return 1;  // "￥"
+    // "＂", "＇", "－", "＼" and "～" have no rule.
+    case 0xFF02:
+    case 0xFF07:
+    case 0xFF0D:
+    case 0xFF3C:
+      output[0] = c;
+      return 1;
+    default:
+      output[0] = (0xFF01 <= c && c <= 0xFF5D) ? c - kFullWidthAsciiOffset : c;
+      return 1;
+  }
+}
+
+// The flags of kFullWidthKatakanaToHalfWidth to append "ﾞ" or "ﾟ".
+const uint32 kVoiced = 1 << 16;
+const uint32 kSemiVoiced = 1 << 17;
+
+// Half width katakana of U+30A0 to U+30FF, 0 for the characters without rule.
+const uint32 kFullWidthKatakanaToHalfWidth[] = {
+  0, 0xFF67, 0xFF71, 0xFF68, 0xFF72, 0xFF69, 0xFF73, 0xFF6A, 0xFF74, 0xFF6B,
+  0xFF75, 0xFF76, 0xFF76 | kVoiced, 0xFF77, 0xFF77 | kVoiced, 0xFF78,
+  0xFF78 | kVoiced, 0xFF79, 0xFF79 | kVoiced, 0xFF7A, 0xFF7A | kVoiced, 0xFF7B,
+  0xFF7B | kVoiced, 0xFF7C, 0xFF7C | kVoiced, 0xFF7D, 0xFF7D | kVoiced, 0xFF7E,
+  0xFF7E | kVoiced, 0xFF7F, 0xFF7F | kVoiced, 0xFF80, 0xFF80 | kVoiced, 0xFF81,
+  0xFF81 | kVoiced, 0xFF6F, 0xFF82, 0xFF82 | kVoiced, 0xFF83, 0xFF83 | kVoiced,
+  0xFF84, 0xFF84 | kVoiced, 0xFF85, 0xFF86, 0xFF87, 0xFF88, 0xFF89, 0xFF8A,
+  0xFF8A | kVoiced, 0xFF8A | kSemiVoiced, 0xFF8B, 0xFF8B | kVoiced,
+  0xFF8B | kSemiVoiced, 0xFF8C, 0xFF8C | kVoiced, 0xFF8C | kSemiVoiced, 0xFF8D,
+  0xFF8D | kVoiced, 0xFF8D | kSemiVoiced, 0xFF8E, 0xFF8E | kVoiced,
+  0xFF8E | kSemiVoiced, 0xFF8F, 0xFF90, 0xFF91, 0xFF92, 0xFF93, 0xFF6C, 0xFF94,
+  0xFF6D, 0xFF95, 0xFF6E, 0xFF96, 0xFF97, 0xFF98, 0xFF99, 0xFF9A, 0xFF9B, 0,
+  0xFF9C, 0, 0, 0xFF66, 0xFF9D, 0xFF73 | kVoiced, 0, 0, 0, 0, 0, 0, 0xFF65,
+  0xFF70, 0, 0, 0,
+};
+
+size_t FullWidthKatakanaToHalfWidthKatakanaChar(char32 c, char32 output[2]) {
+  switch (c) {
+    case 0x3001: output[0] = 0xFF64; return 1;  // "、"
+    case 0x3002: output[0] = 0xFF61; return 1;  // "。"
+    case 0x300C: output[0] = 0xFF62; return 1;  // "「"
+    case 0x300D: output[0] = 0xFF63; return 1;  // "」"
+    case 0x309B: output[0] = 0xFF9E; return 1;  // "゛"
+    case 0x309C: output[0] = 0xFF9F; return 1;  // "゜"
+  }
+  if (c < 0x30A0 || 0x30FF < c) {
+    output[0] = c;
+    return 1;
+  }
+  const uint32 entry = kFullWidthKatakanaToHalfWidth[c - 0x30A0];
+  if (entry == 0) {
+    output[0] = c;
+    return 1;
+  }
+  output[0] = entry & 0xFFFF;
+  if (entry & kVoiced) {
+    output[1] = 0xFF9E;  // "ﾞ"
+    return 2;
+  }
+  if (entry & kSemiVoiced) {
+    output[1] = 0xFF9F;  // "ﾟ"
+    return 2;
+  }
+  return 1;
+}
+
+// Full width katakana of U+FF60 to U+FF9F, 0 for the characters without
+// rule.
+const uint16 kHalfWidthKatakanaToFullWidth[] = {
+  0, 0x3002, 0x300C, 0x300D, 0x3001, 0x30FB, 0x30F2, 0x30A1,
+  0x30A3, 0x30A5, 0x30A7, 0x30A9, 0x30E3, 0x30E5, 0x30E7, 0x30C3,
+  0x30FC, 0x30A2, 0x30A4, 0x30A6, 0x30A8, 0x30AA, 0x30AB, 0x30AD,
+  0x30AF, 0x30B1, 0x30B3, 0x30B5, 0x30B7, 0x30B9, 0x30BB, 0x30BD,
+  0x30BF, 0x30C1, 0x30C4, 0x30C6, 0x30C8, 0x30CA, 0x30CB, 0x30CC,
+  0x30CD, 0x30CE, 0x30CF, 0x30D2, 0x30D5, 0x30D8, 0x30DB, 0x30DE,
+  0x30DF, 0x30E0, 0x30E1, 0x30E2, 0x30E4, 0x30E6, 0x30E8, 0x30E9,
+  0x30EA, 0x30EB, 0x30EC, 0x30ED, 0x30EF, 0x30F3, 0x309B, 0x309C,
+};
+
+size_t HalfWidthKatakanaToFullWidthKatakanaChar(char32 c, char32 output[2]) {
+  output[0] = c;
+  if (0xFF60 <= c && c <= 0xFF9F) {
+    const char32 converted = kHalfWidthKatakanaToFullWidth[c - 0xFF60];
+    if (converted != 0) {
+      output[0] = converted;
+    }
+  }
+  return 1;
+}
+
+// Returns true if |s| starts with one of "゛", "゜", "ﾞ" and "ﾟ", which are
+// the second characters of all the rules having two characters as the key.
+inline bool StartsWithVoicedSoundMark(const char *s, const char *end) {
+  if (end - s < 3) {
+    return false;
+  }
+  const uint8 b0 = static_cast<uint8>(s[0]);
+  const uint8 b1 = static_cast<uint8>(s[1]);
+  const uint8 b2 = static_cast<uint8>(s[2]);
+  return (b0 == 0xE3 && b1 == 0x82 && (b2 == 0x9B || b2 == 0x9C)) ||
+         (b0 == 0xEF && b1 == 0xBE && (b2 == 0x9E || b2 == 0x9F));
+}
+
+// Decodes the character of one to three bytes at |s|.  Returns the length of
+// the character, or 0 if it is longer or broken.
+inline size_t DecodeBmpChar(const char *s, const char *end, char32 *c) {
+  const uint8 b0 = static_cast<uint8>(s[0]);
+  if (b0 < 0x80) {
+    *c = b0;
+    return 1;
+  }
+  if ((b0 & 0xE0) == 0xC0) {
+    if (end - s < 2 || (static_cast<uint8>(s[1]) & 0xC0) != 0x80) {
+      return 0;
+    }
+    *c = ((b0 & 0x1F) << 6) | (static_cast<uint8>(s[1]) & 0x3F);
+    return (*c >= 0x80) ? 2 : 0;
+  }
+  if ((b0 & 0xF0) == 0xE0) {
+    if (end - s < 3 || (static_cast<uint8>(s[1]) & 0xC0) != 0x80 ||
+        (static_cast<uint8>(s[2]) & 0xC0) != 0x80) {
+      return 0;
+    }
+    *c = ((b0 & 0x0F) << 12) | ((static_cast<uint8>(s[1]) & 0x3F) << 6) |
+         (static_cast<uint8>(s[2]) & 0x3F);
+    return (*c >= 0x800) ? 3 : 0;
+  }
+  return 0;
+}
+
+inline size_t EncodeBmpChar(char32 c, char *output) {
+  if (c < 0x80) {
+    output[0] = static_cast<char>(c);
+    return 1;
+  }
+  if (c < 0x800) {
+    output[0] = static_cast<char>(0xC0 | (c >> 6));
+    output[1] = static_cast<char>(0x80 | (c & 0x3F));
+    return 2;
+  }
+  output[0] = static_cast<char>(0xE0 | (c >> 12));
+  output[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+  output[2] = static_cast<char>(0x80 | (c & 0x3F));
+  return 3;
+}
+
+// Two characters of three bytes at most for each input character.
+const size_t kMaxKernelOutputLength = 6;
+
+// Converts [*begin, end) with |kKernel| into |buffer| of |size| bytes until a
+// character needs the rule lookup, i.e., it is not a BMP character or it is
+// followed by a voiced sound mark, or the buffer is full.  Returns the number
+// of the bytes written and advances |*begin|.
+template <CharKernel kKernel>
+size_t ConvertUsingKernel(const char **begin, const char *end, char *buffer,
+                          size_t size) {
+  const char *p = *begin;
+  size_t written = 0;
+  while (p < end && written + kMaxKernelOutputLength <= size) {
+    char32 c = 0;
+    const size_t mblen = DecodeBmpChar(p, end, &c);
+    if (mblen == 0 || StartsWithVoicedSoundMark(p + mblen, end)) {
+      break;
+    }
+    char32 converted[2];
+    const size_t num_chars = kKernel(c, converted);
+    if (num_chars == 1 && converted[0] == c) {
+      memcpy(buffer + written, p, mblen);
+      written += mblen;
+    } else {
+      for (size_t i = 0; i < num_chars; ++i) {
+        written += EncodeBmpChar(converted[i], buffer + written);
+      }
+    }
+    p += mblen;
+  }
+  *begin = p;
+  return written;
+}
+
+// Same as Util::ConvertUsingDoubleArray with the rules of |da| and |ctable|,
+// which |kKernel| implements for the keys of a single character.  The rules
+// are looked up only where the kernel cannot convert.
+template <CharKernel kKernel>
+void ConvertUsingKernelAndDoubleArray(
+    const japanese_util_rule::DoubleArray *da, const char *ctable,
+    StringPiece input, string *output) {
+  output->clear();
+  output->reserve(input.size());
+  char buffer[256];
+  const char *begin = input.data();
+  const char *const end = input.data() + input.size();
+  while (begin < end) {
+    const size_t written =
+        ConvertUsingKernel<kKernel>(&begin, end, buffer, sizeof(buffer));
+    output->append(buffer, written);
+    if (begin < end &&
+        written + kMaxKernelOutputLength <= sizeof(buffer)) {
+      // The kernel stopped at a character which needs the rules.
+      ConvertFirstUsingDoubleArray(da, ctable, &begin, end, output);
+    }
+  }
+}
+
 }  // namespace
 
 void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
@@ -1106,42 +1418,23 @@ void Util::ConvertUsingDoubleArray(const japanese_util_rule::DoubleArray *da,
   const char *begin = input.data();
   const char *const end = input.data() + input.size();
   while (begin < end) {
-    int result = 0;
-    int mblen = LookupDoubleArray(da, begin, static_cast<int>(end - begin),
-                                  &result);
-    if (mblen > 0) {
-      const char *p = &ctable[result];
-      const size_t len = strlen(p);
-      output->append(p, len);
-      mblen -= static_cast<int32>(p[len + 1]);
-      begin += mblen;
-    } else {
-      mblen = OneCharLen(begin);
-      output->append(begin, mblen);
-      begin += mblen;
-    }
+    ConvertFirstUsingDoubleArray(da, ctable, &begin, end, output);
   }
 }
 
 void Util::HiraganaToKatakana(StringPiece input, string *output) {
-  ConvertUsingDoubleArray(japanese_util_rule::hiragana_to_katakana_da,
-                          japanese_util_rule::hiragana_to_katakana_table,
-                          input,
-                          output);
+  ConvertUsingKernelAndDoubleArray<&HiraganaToKatakanaChar>(
+      japanese_util_rule::hiragana_to_katakana_da,
+      japanese_util_rule::hiragana_to_katakana_table,
+      input, output);
 }
 
 void Util::HiraganaToHalfwidthKatakana(StringPiece input,
                                        string *output) {
   // combine two rules
   string tmp;
-  ConvertUsingDoubleArray(
-      japanese_util_rule::hiragana_to_katakana_da,
-      japanese_util_rule::hiragana_to_katakana_table,
-      input, &tmp);
-  ConvertUsingDoubleArray(
-      japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_da,
-      japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_table,
-      tmp, output);
+  HiraganaToKatakana(input, &tmp);
+  FullWidthKatakanaToHalfWidthKatakana(tmp, output);
 }
 
 void Util::HiraganaToRomanji(StringPiece input, string *output) {
@@ -1153,20 +1446,18 @@ void Util::HiraganaToRomanji(StringPiece input, string *output) {
 
 void Util::HalfWidthAsciiToFullWidthAscii(StringPiece input,
                                           string *output) {
-  ConvertUsingDoubleArray(
+  ConvertUsingKernelAndDoubleArray<&HalfWidthAsciiToFullWidthAsciiChar>(
       japanese_util_rule::halfwidthascii_to_fullwidthascii_da,
       japanese_util_rule::halfwidthascii_to_fullwidthascii_table,
-      input,
-      output);
+      input, output);
 }
 
 void Util::FullWidthAsciiToHalfWidthAscii(StringPiece input,
                                           string *output) {
-  ConvertUsingDoubleArray(
+  ConvertUsingKernelAndDoubleArray<&FullWidthAsciiToHalfWidthAsciiChar>(
       japanese_util_rule::fullwidthascii_to_halfwidthascii_da,
       japanese_util_rule::fullwidthascii_to_halfwidthascii_table,
-      input,
-      output);
+      input, output);
 }
 
 void Util::HiraganaToFullwidthRomanji(StringPiece input, string *output) {
@@ -1175,11 +1466,7 @@ void Util::HiraganaToFullwidthRomanji(StringPiece input, string *output) {
                           japanese_util_rule::hiragana_to_romanji_table,
                           input,
                           &tmp);
-  ConvertUsingDoubleArray(
-      japanese_util_rule::halfwidthascii_to_fullwidthascii_da,
-      japanese_util_rule::halfwidthascii_to_fullwidthascii_table,
-      tmp,
-      output);
+  HalfWidthAsciiToFullWidthAscii(tmp, output);
 }
 
 void Util::RomanjiToHiragana(StringPiece input, string *output) {
@@ -1190,28 +1477,26 @@ void Util::RomanjiToHiragana(StringPiece input, string *output) {
 }
 
 void Util::KatakanaToHiragana(StringPiece input, string *output) {
-  ConvertUsingDoubleArray(japanese_util_rule::katakana_to_hiragana_da,
-                          japanese_util_rule::katakana_to_hiragana_table,
-                          input,
-                          output);
+  ConvertUsingKernelAndDoubleArray<&KatakanaToHiraganaChar>(
+      japanese_util_rule::katakana_to_hiragana_da,
+      japanese_util_rule::katakana_to_hiragana_table,
+      input, output);
 }
 
 void Util::HalfWidthKatakanaToFullWidthKatakana(StringPiece input,
                                                 string *output) {
-  ConvertUsingDoubleArray(
+  ConvertUsingKernelAndDoubleArray<&HalfWidthKatakanaToFullWidthKatakanaChar>(
       japanese_util_rule::halfwidthkatakana_to_fullwidthkatakana_da,
       japanese_util_rule::halfwidthkatakana_to_fullwidthkatakana_table,
-      input,
-      output);
+      input, output);
 }
 
 void Util::FullWidthKatakanaToHalfWidthKatakana(StringPiece input,
                                                 string *output) {
-  ConvertUsingDoubleArray(
+  ConvertUsingKernelAndDoubleArray<&FullWidthKatakanaToHalfWidthKatakanaChar>(
       japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_da,
       japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_table,
-      input,
-      output);
+      input, output);
 }
 
 void Util::FullWidthToHalfWidth(StringPiece input, string *output) {
@@ -1369,7 +1654,7 @@ bool Util::IsKanaSymbolContained(const string &input) {
   return false;
 }
 
-bool Util::IsEnglishTransliteration(const string &value) {
+bool Util::IsEnglishTransliteration(StringPiece value) {
   for (size_t i = 0; i < value.size(); ++i) {
     if (value[i] == 0x20 || value[i] == 0x21 ||
         value[i] == 0x27 || value[i] == 0x2D ||
@@ -1515,19 +1800,21 @@ void Util::EscapeCss(const string &plain, string *escaped) {
 
 #define INRANGE(w, a, b) ((w) >= (a) && (w) <= (b))
 
+namespace {
+
 // script type
 // TODO(yukawa, team): Make a mechanism to keep this classifier up-to-date
 //   based on the original data from Unicode.org.
-Util::ScriptType Util::GetScriptType(char32 w) {
+Util::ScriptType GetScriptTypeByRanges(char32 w) {
   if (INRANGE(w, 0x0030, 0x0039) ||    // ascii number
       INRANGE(w, 0xFF10, 0xFF19)) {    // full width number
-    return NUMBER;
+    return Util::NUMBER;
   } else if (
       INRANGE(w, 0x0041, 0x005A) ||    // ascii upper
       INRANGE(w, 0x0061, 0x007A) ||    // ascii lower
       INRANGE(w, 0xFF21, 0xFF3A) ||    // fullwidth ascii upper
       INRANGE(w, 0xFF41, 0xFF5A)) {    // fullwidth ascii lower
-    return ALPHABET;
+    return Util::ALPHABET;
   } else if (
       w == 0x3005 ||                   // IDEOGRAPHIC ITERATION MARK "々"
       INRANGE(w, 0x3400, 0x4DBF) ||    // CJK Unified Ideographs Extension A
@@ -1545,17 +1832,17 @@ Util::ScriptType Util::GetScriptType(char32 w) {
     // [U+2A700, U+2B734]: CJK Unified Ideographs Extension C
     // [U+2B740, U+2B81D]: CJK Unified Ideographs Extension D
     // [U+2F800, U+2FA1D]: CJK Compatibility Ideographs
-    return KANJI;
+    return Util::KANJI;
   } else if (
       INRANGE(w, 0x3041, 0x309F) ||    // hiragana
       w == 0x1B001) {                  // HIRAGANA LETTER ARCHAIC YE
-    return HIRAGANA;
+    return Util::HIRAGANA;
   } else if (
       INRANGE(w, 0x30A1, 0x30FF) ||    // full width katakana
       INRANGE(w, 0x31F0, 0x31FF) ||    // Katakana Phonetic Extensions for Ainu
       INRANGE(w, 0xFF65, 0xFF9F) ||    // half width katakana
       w == 0x1B000) {                  // KATAKANA LETTER ARCHAIC E
-    return KATAKANA;
+    return Util::KATAKANA;
   } else if (
       INRANGE(w, 0x02300, 0x023F3) ||  // Miscellaneous Technical
       INRANGE(w, 0x02700, 0x027BF) ||  // Dingbats
@@ -1570,10 +1857,59 @@ Util::ScriptType Util::GetScriptType(char32 w) {
       INRANGE(w, 0x1F700, 0x1F77F) ||  // Alchemical Symbols
       w == 0x26CE ||                   // Ophiuchus
       INRANGE(w, kUcs4MinGooglePuaEmoji, kUcs4MaxGooglePuaEmoji)) {
-    return EMOJI;
+    return Util::EMOJI;
+  }
+
+  return Util::UNKNOWN_SCRIPT;
+}
+
+// The script types of the BMP characters by blocks of 16 characters, which
+// replaces the chain of the range checks with a lookup for most of the
+// characters.  The blocks having characters of different types, e.g., the one
+// of U+3040 to U+304F, are marked as SCRIPT_TYPE_SIZE and left to the range
+// checks.
+class ScriptTypeBlockTable {
+ public:
+  static const size_t kBlockBits = 4;
+  static const size_t kNumBlocks = 0x10000 >> kBlockBits;
+
+  ScriptTypeBlockTable() {
+    for (size_t block = 0; block < kNumBlocks; ++block) {
+      const char32 begin = static_cast<char32>(block << kBlockBits);
+      const Util::ScriptType type = GetScriptTypeByRanges(begin);
+      types_[block] = static_cast<uint8>(type);
+      for (char32 w = begin + 1; w < begin + (1 << kBlockBits); ++w) {
+        if (GetScriptTypeByRanges(w) != type) {
+          types_[block] = static_cast<uint8>(Util::SCRIPT_TYPE_SIZE);
+          break;
+        }
+      }
+    }
+  }
+
+  // Returns SCRIPT_TYPE_SIZE if |w| needs the range checks.
+  Util::ScriptType Get(char32 w) const {
+    if (w >= 0x10000) {
+      return Util::SCRIPT_TYPE_SIZE;
+    }
+    return static_cast<Util::ScriptType>(types_[w >> kBlockBits]);
   }
 
-  return UNKNOWN_SCRIPT;
+ private:
+  uint8 types_[kNumBlocks];
+
+  DISALLOW_COPY_AND_ASSIGN(ScriptTypeBlockTable);
+};
+
+}  // namespace
+
+Util::ScriptType Util::GetScriptType(char32 w) {
+  static const ScriptTypeBlockTable kTable;
+  const ScriptType type = kTable.Get(w);
+  if (type != SCRIPT_TYPE_SIZE) {
+    return type;
+  }
+  return GetScriptTypeByRanges(w);
 }
 
 Util::FormType Util::GetFormType(char32 w) {
@@ -1675,6 +2011,10 @@ Util::ScriptType GetScriptTypeInternal(StringPiece str, bool ignore_symbols) {
 }  // namespace
 
 Util::ScriptType Util::GetScriptType(StringPiece str) {
+  // Fast path for plain English words, which need no UTF-8 decoding.
+  if (!str.empty() && IsAsciiAlphabet(str)) {
+    return ALPHABET;
+  }
   return GetScriptTypeInternal(str, false);
 }
 
@@ -169,6 +169,10 @@ class Util {
   // ASCII, or 2) capitalized.
   static bool IsUpperOrCapitalizedAscii(StringPiece s);
 
+  // Returns true if |s| consists only of ASCII letters, [A-Za-z].  Returns
+  // true for an empty string.  Checks eight bytes at a time.
+  static bool IsAsciiAlphabet(StringPiece s);
+
   // Strips the leading/trailing white spaces from the input and stores it to
   // the output.  If the input does not have such white spaces, this method just
   // copies the input into the output.  It clears the output always.
@@ -335,7 +339,7 @@ class Util {
   static bool IsKanaSymbolContained(const string &input);
 
   // Returns true if |input| looks like a pure English word.
-  static bool IsEnglishTransliteration(const string &input);
+  static bool IsEnglishTransliteration(StringPiece input);
 
   static void NormalizeVoicedSoundMark(StringPiece input, string *output);
 
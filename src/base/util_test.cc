@@ -39,6 +39,7 @@
 #include "base/compiler_specific.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/japanese_util_rule.h"
 #include "base/logging.h"
 #include "base/number_util.h"
 #include "testing/base/public/gunit.h"
@@ -764,6 +765,30 @@ TEST(UtilTest, IsUpperOrCapitalizedAscii) {
       "\xEF\xBC\xA8\xEF\xBD\x85\xEF\xBD\x8C\xEF\xBD\x8C\xEF\xBD\x8F"));
 }
 
+TEST(UtilTest, IsAsciiAlphabet) {
+  EXPECT_TRUE(Util::IsAsciiAlphabet(""));
+  EXPECT_TRUE(Util::IsAsciiAlphabet("a"));
+  EXPECT_TRUE(Util::IsAsciiAlphabet("AZaz"));
+  EXPECT_TRUE(Util::IsAsciiAlphabet("abcdefghijklmnopqrstuvwxyz"));
+  EXPECT_TRUE(Util::IsAsciiAlphabet("ABCDEFGHIJKLMNOPQRSTUVWXYZ"));
+  EXPECT_FALSE(Util::IsAsciiAlphabet("symbol!"));
+  EXPECT_FALSE(Util::IsAsciiAlphabet("hello world"));
+  EXPECT_FALSE(Util::IsAsciiAlphabet("abc123"));
+  EXPECT_FALSE(Util::IsAsciiAlphabet(  // "Ｈｅｌｌｏ"
+      "\xEF\xBC\xA8\xEF\xBD\x85\xEF\xBD\x8C\xEF\xBD\x8C\xEF\xBD\x8F"));
+
+  // Every non-letter byte must be rejected at every position, both in the
+  // eight-byte blocks and in the tail.
+  for (int c = 1; c < 256; ++c) {
+    const bool is_letter = ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z');
+    for (size_t pos = 0; pos < 11; ++pos) {
+      string s(11, 'x');
+      s[pos] = static_cast<char>(c);
+      EXPECT_EQ(is_letter, Util::IsAsciiAlphabet(s)) << c << " at " << pos;
+    }
+  }
+}
+
 void VerifyUTF8ToUCS4(const string &text, char32 expected_ucs4,
                       size_t expected_len) {
   const char *begin = text.data();
@@ -1298,6 +1323,84 @@ TEST(UtilTest, NormalizeVoicedSoundMark) {
             "\x81\x8a\xe3\x82\x8a\xe3\x82\x93", output);
 }
 
+namespace {
+
+typedef void (*ConvertFunc)(StringPiece, string *);
+
+// Expects that |func| gives the same result as the rules of |da| and
+// |table| for |input|.
+void ExpectSameAsDoubleArray(ConvertFunc func,
+                             const japanese_util_rule::DoubleArray *da,
+                             const char *table, const string &input) {
+  string expected, actual;
+  Util::ConvertUsingDoubleArray(da, table, input, &expected);
+  (*func)(input, &actual);
+  EXPECT_EQ(expected, actual) << "input: " << input;
+}
+
+}  // namespace
+
+TEST(UtilTest, CharacterFormConversionsAreSameAsRules) {
+  const struct {
+    ConvertFunc func;
+    const japanese_util_rule::DoubleArray *da;
+    const char *table;
+  } kConversions[] = {
+    {&Util::HiraganaToKatakana,
+     japanese_util_rule::hiragana_to_katakana_da,
+     japanese_util_rule::hiragana_to_katakana_table},
+    {&Util::KatakanaToHiragana,
+     japanese_util_rule::katakana_to_hiragana_da,
+     japanese_util_rule::katakana_to_hiragana_table},
+    {&Util::HalfWidthAsciiToFullWidthAscii,
+     japanese_util_rule::halfwidthascii_to_fullwidthascii_da,
+     japanese_util_rule::halfwidthascii_to_fullwidthascii_table},
+    {&Util::FullWidthAsciiToHalfWidthAscii,
+     japanese_util_rule::fullwidthascii_to_halfwidthascii_da,
+     japanese_util_rule::fullwidthascii_to_halfwidthascii_table},
+    {&Util::FullWidthKatakanaToHalfWidthKatakana,
+     japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_da,
+     japanese_util_rule::fullwidthkatakana_to_halfwidthkatakana_table},
+    {&Util::HalfWidthKatakanaToFullWidthKatakana,
+     japanese_util_rule::halfwidthkatakana_to_fullwidthkatakana_da,
+     japanese_util_rule::halfwidthkatakana_to_fullwidthkatakana_table},
+  };
+  // "゛", "゜", "ﾞ" and "ﾟ", which follow the first characters of the rules of
+  // two characters.
+  const char *kSuffixes[] = {
+    "", "a", "\xE3\x82\x9B", "\xE3\x82\x9C", "\xEF\xBE\x9E", "\xEF\xBE\x9F",
+  };
+  for (size_t i = 0; i < arraysize(kConversions); ++i) {
+    for (char32 c = 0x01; c < 0x10000; ++c) {
+      string input;
+      Util::UCS4ToUTF8(c, &input);
+      ExpectSameAsDoubleArray(kConversions[i].func, kConversions[i].da,
+                              kConversions[i].table, input);
+      if (!(0x3000 <= c && c <= 0x30FF) && !(0xFF00 <= c && c <= 0xFFEF)) {
+        continue;
+      }
+      for (size_t j = 1; j < arraysize(kSuffixes); ++j) {
+        ExpectSameAsDoubleArray(kConversions[i].func, kConversions[i].da,
+                                kConversions[i].table, input + kSuffixes[j]);
+      }
+    }
+
+    // Broken UTF-8, non-BMP characters and a string longer than the
+    // buffer of the conversion.
+    ExpectSameAsDoubleArray(kConversions[i].func, kConversions[i].da,
+                            kConversions[i].table,
+                            "a\xE3\x81" "b\x81\xFF\xF0\x9F\x98\x80\xE3");
+    string long_input;
+    for (int j = 0; j < 200; ++j) {
+      // "あア ｱａa" and "う゛"
+      long_input.append("\xE3\x81\x82\xE3\x82\xA2 \xEF\xBD\xB1\xEF\xBD\x81"
+                        "a\xE3\x81\x86\xE3\x82\x9B");
+    }
+    ExpectSameAsDoubleArray(kConversions[i].func, kConversions[i].da,
+                            kConversions[i].table, long_input);
+  }
+}
+
 TEST(UtilTest, IsFullWidthSymbolInHalfWidthKatakana) {
   // "グーグル"
   EXPECT_FALSE(Util::IsFullWidthSymbolInHalfWidthKatakana("\xe3\x82\xb0\xe3\x83"
@@ -1892,6 +1995,34 @@ TEST(UtilTest, ScriptType) {
 }
 
 
+TEST(UtilTest, ScriptTypeOfCharacterAtRangeBoundaries) {
+  // The characters around the boundaries of the ranges, which share the
+  // blocks of the lookup table with the characters of the other types.
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x002F));
+  EXPECT_EQ(Util::NUMBER, Util::GetScriptType(0x0030));
+  EXPECT_EQ(Util::NUMBER, Util::GetScriptType(0x0039));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x003A));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x3004));
+  EXPECT_EQ(Util::KANJI, Util::GetScriptType(0x3005));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x3006));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x3040));
+  EXPECT_EQ(Util::HIRAGANA, Util::GetScriptType(0x3041));
+  EXPECT_EQ(Util::HIRAGANA, Util::GetScriptType(0x3060));
+  EXPECT_EQ(Util::HIRAGANA, Util::GetScriptType(0x309F));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x30A0));
+  EXPECT_EQ(Util::KATAKANA, Util::GetScriptType(0x30A1));
+  EXPECT_EQ(Util::KATAKANA, Util::GetScriptType(0x30FF));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x3100));
+  EXPECT_EQ(Util::KANJI, Util::GetScriptType(0x4DBF));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0x4DC0));
+  EXPECT_EQ(Util::KANJI, Util::GetScriptType(0x4E00));
+  EXPECT_EQ(Util::KATAKANA, Util::GetScriptType(0xFF65));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0xFF64));
+  EXPECT_EQ(Util::UNKNOWN_SCRIPT, Util::GetScriptType(0xFFFF));
+  EXPECT_EQ(Util::KANJI, Util::GetScriptType(0x20000));
+  EXPECT_EQ(Util::EMOJI, Util::GetScriptType(0x1F600));
+}
+
 TEST(UtilTest, ScriptTypeWithoutSymbols) {
   // "くど う"
   EXPECT_EQ(Util::HIRAGANA, Util::GetScriptTypeWithoutSymbols(
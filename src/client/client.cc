@@ -37,14 +37,18 @@
 #include <unistd.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstddef>
 #include <memory>
+#include <utility>
 
 #include "base/const.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/process.h"
+#include "base/protobuf/protobuf.h"
+#include "base/protobuf/repeated_field.h"
 #include "base/run_level.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
@@ -104,6 +108,7 @@ Client::~Client() {
 
 void Client::SetIPCClientFactory(IPCClientFactoryInterface *client_factory) {
   client_factory_ = client_factory;
+  ipc_client_.reset();
 }
 
 void Client::SetServerLauncher(
@@ -219,6 +224,7 @@ void Client::PlaybackHistory() {
   VLOG(1) << "Playback history: size=" << history_inputs_.size();
   for (size_t i = 0; i < history_inputs_.size(); ++i) {
     history_inputs_[i].set_id(id_);
+    history_inputs_[i].clear_base_output_id();
     if (!Call(history_inputs_[i], &output)) {
       LOG(ERROR) << "playback history failed: "
                  << history_inputs_[i].DebugString();
@@ -229,6 +235,24 @@ void Client::PlaybackHistory() {
 
 void Client::PushHistory(const commands::Input &input,
                           const commands::Output &output) {
+  if (input.type() == commands::Input::SEND_KEYS) {
+    // Remember the applied keys as SEND_KEY to play them back one by one.
+    // The keys except the last one are consumed without any result.
+    commands::Output consumed_output;
+    consumed_output.set_consumed(true);
+    commands::Input key_input(input);
+    key_input.clear_batched_keys();
+    key_input.set_type(commands::Input::SEND_KEY);
+    const int num_applied_keys =
+        std::min<int>(output.batched_key_count(), input.batched_keys_size());
+    for (int i = 0; i < num_applied_keys; ++i) {
+      key_input.mutable_key()->CopyFrom(input.batched_keys(i));
+      PushHistory(key_input,
+                  i + 1 < num_applied_keys ? consumed_output : output);
+    }
+    return;
+  }
+
   if (!output.has_consumed() || !output.consumed()) {
     // Do not remember unconsumed input.
     return;
@@ -297,6 +321,37 @@ bool Client::SendKeyWithContext(const commands::KeyEvent &key,
   return EnsureCallCommand(&input, output);
 }
 
+bool Client::SendKeysWithContext(const std::vector<commands::KeyEvent> &keys,
+                                 const commands::Context &context,
+                                 std::vector<commands::Output> *outputs) {
+  outputs->clear();
+  size_t num_sent_keys = 0;
+  while (num_sent_keys < keys.size()) {
+    commands::Input input;
+    input.set_type(commands::Input::SEND_KEYS);
+    for (size_t i = num_sent_keys; i < keys.size(); ++i) {
+      input.add_batched_keys()->CopyFrom(keys[i]);
+    }
+    // If the pointer of |context| is not the default_instance, update the data.
+    if (&context != &commands::Context::default_instance()) {
+      input.mutable_context()->CopyFrom(context);
+    }
+    outputs->push_back(commands::Output());
+    if (!EnsureCallCommand(&input, &outputs->back())) {
+      return false;
+    }
+    // The server applies the keys until the one whose output has to be
+    // handled, e.g. a result.  The rest are sent again.
+    const uint32 num_applied_keys = outputs->back().batched_key_count();
+    if (num_applied_keys == 0) {
+      LOG(ERROR) << "No key is applied by SEND_KEYS";
+      return false;
+    }
+    num_sent_keys += num_applied_keys;
+  }
+  return true;
+}
+
 bool Client::TestSendKeyWithContext(const commands::KeyEvent &key,
                                     const commands::Context &context,
                                     commands::Output *output) {
@@ -390,6 +445,12 @@ bool Client::EnsureCallCommand(commands::Input *input,
     }
   }
 
+  if (!ApplyOutputDelta(output)) {
+    LOG(ERROR) << "Output is based on an unknown output: "
+               << output->delta().base_output_id();
+    return false;
+  }
+
   PushHistory(*input, *output);
   return true;
 }
@@ -423,6 +484,7 @@ void Client::set_client_capability(const commands::Capability &capability) {
 
 bool Client::CreateSession() {
   id_ = 0;
+  delta_base_output_.Clear();
   commands::Input input;
   input.set_type(commands::Input::CREATE_SESSION);
 
@@ -629,9 +691,14 @@ bool Client::Call(const commands::Input &input,
   input.SerializeToString(&request);
 
   // Call IPC
-  std::unique_ptr<IPCClientInterface> client(
-      client_factory_->NewClient(kServerAddress,
-                                 server_launcher_->server_program()));
+  // Reuse the connection of the last call if any, which saves connect() and
+  // loading the IPC path for each call.
+  const bool reused = ipc_client_.get() != NULL;
+  std::unique_ptr<IPCClientInterface> client(std::move(ipc_client_));
+  if (!reused) {
+    client.reset(client_factory_->NewClient(
+        kServerAddress, server_launcher_->server_program()));
+  }
 
   // set client protocol version.
   // When an error occurs inside Connected() function,
@@ -677,6 +744,12 @@ bool Client::Call(const commands::Input &input,
                     result_.get(), &size, timeout_)) {
     LOG(ERROR) << "Call failure";
     //               << input.DebugString();
+    if (reused && client->GetLastIPCError() == IPC_NO_CONNECTION) {
+      // The server closed the kept connection, e.g., on restart, before
+      // receiving the request.  Retry once with a new connection, which is
+      // safe as the request has not been processed.
+      return Call(input, output);
+    }
     if (client->GetLastIPCError() == IPC_TIMEOUT_ERROR) {
       server_status_ = SERVER_TIMEOUT;
     } else {
@@ -693,6 +766,10 @@ bool Client::Call(const commands::Input &input,
     return false;
   }
 
+  if (client->IsReusable()) {
+    ipc_client_ = std::move(client);
+  }
+
   DCHECK(server_status_ == SERVER_OK ||
          server_status_ == SERVER_INVALID_SESSION ||
          server_status_ == SERVER_SHUTDOWN ||
@@ -724,6 +801,51 @@ void Client::InitInput(commands::Input *input) const {
   if (preferences_.get() != NULL) {
     input->mutable_config()->CopyFrom(*preferences_);
   }
+  if (delta_base_output_.has_output_id() &&
+      (input->type() == commands::Input::SEND_KEY ||
+       input->type() == commands::Input::SEND_KEYS ||
+       input->type() == commands::Input::SEND_COMMAND)) {
+    input->set_base_output_id(delta_base_output_.output_id());
+  } else {
+    input->clear_base_output_id();
+  }
+}
+
+bool Client::ApplyOutputDelta(commands::Output *output) {
+  if (output->has_delta()) {
+    const commands::Output::Delta &delta = output->delta();
+    const int kept_segments = delta.preedit_kept_segments();
+    if (!delta_base_output_.has_output_id() ||
+        delta.base_output_id() != delta_base_output_.output_id() ||
+        kept_segments > delta_base_output_.preedit().segment_size()) {
+      delta_base_output_.Clear();
+      return false;
+    }
+    if (kept_segments > 0) {
+      mozc::protobuf::RepeatedPtrField<commands::Preedit::Segment> segments;
+      for (int i = 0; i < kept_segments; ++i) {
+        segments.Add()->CopyFrom(delta_base_output_.preedit().segment(i));
+      }
+      segments.MergeFrom(output->preedit().segment());
+      output->mutable_preedit()->mutable_segment()->Swap(&segments);
+    }
+    if (delta.candidates_unchanged()) {
+      output->mutable_candidates()->CopyFrom(delta_base_output_.candidates());
+    }
+    output->clear_delta();
+  }
+
+  if (output->has_output_id()) {
+    delta_base_output_.Clear();
+    delta_base_output_.set_output_id(output->output_id());
+    if (output->has_preedit()) {
+      delta_base_output_.mutable_preedit()->CopyFrom(output->preedit());
+    }
+    if (output->has_candidates()) {
+      delta_base_output_.mutable_candidates()->CopyFrom(output->candidates());
+    }
+  }
+  return true;
 }
 
 bool Client::CheckVersionOrRestartServerInternal(
@@ -807,6 +929,7 @@ bool Client::CheckVersionOrRestartServerInternal(
 
 void Client::Reset() {
   server_status_ = SERVER_UNKNOWN;
+  ipc_client_.reset();
   server_protocol_version_ = 0;
   server_process_id_ = 0;
 }
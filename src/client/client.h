@@ -44,6 +44,7 @@
 
 namespace mozc {
 class IPCClientFactoryInterface;
+class IPCClientInterface;
 
 namespace config {
 class Config;
@@ -118,6 +119,9 @@ class Client : public ClientInterface {
   bool TestSendKeyWithContext(const commands::KeyEvent &key,
                               const commands::Context &context,
                               commands::Output *output);
+  bool SendKeysWithContext(const std::vector<commands::KeyEvent> &keys,
+                           const commands::Context &context,
+                           std::vector<commands::Output> *outputs);
   bool SendCommandWithContext(const commands::SessionCommand &command,
                               const commands::Context &context,
                               commands::Output *output);
@@ -163,6 +167,7 @@ class Client : public ClientInterface {
   FRIEND_TEST(SessionPlaybackTest, PlaybackHistoryTest);
   FRIEND_TEST(SessionPlaybackTest, SetModeInitializerTest);
   FRIEND_TEST(SessionPlaybackTest, ConsumedTest);
+  FRIEND_TEST(SessionPlaybackTest, PushHistoryOfSendKeys);
 
   enum ServerStatus {
     SERVER_UNKNOWN,           // initial status
@@ -237,12 +242,19 @@ class Client : public ClientInterface {
   bool CheckVersionOrRestartServerInternal(const commands::Input &input,
                                            commands::Output *output);
 
+  // Restores the preedit and the candidates omitted from the delta encoded
+  // |output| and keeps them as the base of the next delta.  Returns false if
+  // |output| is based on an unknown output.
+  bool ApplyOutputDelta(commands::Output *output);
+
   // for unittest
   // copy the history inputs to |result|.
   void GetHistoryInputs(std::vector<commands::Input> *result) const;
 
   uint64 id_;
   IPCClientFactoryInterface *client_factory_;
+  // The connection kept from the last call to be reused by the next one.
+  std::unique_ptr<IPCClientInterface> ipc_client_;
   std::unique_ptr<ServerLauncherInterface> server_launcher_;
   std::unique_ptr<char[]> result_;
   std::unique_ptr<config::Config> preferences_;
@@ -255,6 +267,9 @@ class Client : public ClientInterface {
   // Remember the composition mode of input session for playback.
   commands::CompositionMode last_mode_;
   commands::Capability client_capability_;
+  // The last output with output_id, which has only the preedit and the
+  // candidates, used when client_capability_ has delta_output.
+  commands::Output delta_base_output_;
 };
 
 }  // namespace client
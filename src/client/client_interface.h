@@ -33,6 +33,8 @@
 #define MOZC_CLIENT_CLIENT_INTERFACE_H_
 
 #include <string>
+#include <vector>
+
 #include "base/port.h"
 #include "protocol/commands.pb.h"
 
@@ -160,6 +162,23 @@ class ClientInterface {
                                       const commands::Context &context,
                                       commands::Output *output) = 0;
 
+  // Sends a burst of key events.  |outputs| receives the outputs to be
+  // handled in order, and the last one is for the final state.  Intermediate
+  // suggestions can be skipped.  The default implementation sends them one
+  // by one.
+  virtual bool SendKeysWithContext(const std::vector<commands::KeyEvent> &keys,
+                                   const commands::Context &context,
+                                   std::vector<commands::Output> *outputs) {
+    outputs->clear();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      outputs->push_back(commands::Output());
+      if (!SendKeyWithContext(keys[i], context, &outputs->back())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   // The methods below don't call
   // StartServer even if server is not available. This treatment
   // avoids unexceptional and continuous server restart trials.
@@ -0,0 +1,232 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Drives one mozc_server with many concurrent clients, each of which has its
+// own session and types random sentences with a human-like cadence, to see
+// how the server scales with the number of the clients.
+//
+// Example:
+//   client_load_test_main --num_clients=8 --keys_per_client=2000
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/cpu_stats.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/thread.h"
+#include "base/util.h"
+#include "client/client.h"
+#include "protocol/commands.pb.h"
+#include "session/random_keyevents_generator.h"
+
+DEFINE_int32(num_clients, 4, "number of the concurrent clients");
+DEFINE_int32(keys_per_client, 1000, "number of the key events of a client");
+DEFINE_int32(key_interval, 150,
+             "average interval between key events of a client (msec)");
+DEFINE_int32(key_interval_jitter, 100,
+             "the interval varies uniformly within +-|key_interval_jitter|/2 "
+             "msec, as the typing of a person does");
+DEFINE_string(server_path, "", "specify server path");
+
+namespace mozc {
+namespace {
+
+// A key event and the interval before it.
+struct TimedKey {
+  commands::KeyEvent key;
+  uint32 interval_msec;
+};
+
+// The key events are generated in advance in the main thread, since
+// RandomKeyEventsGenerator is not thread-safe.
+void GenerateKeys(size_t size, std::vector<TimedKey> *keys) {
+  keys->clear();
+  std::vector<commands::KeyEvent> sequence;
+  while (keys->size() < size) {
+    session::RandomKeyEventsGenerator::GenerateSequence(&sequence);
+    for (size_t i = 0; i < sequence.size() && keys->size() < size; ++i) {
+      TimedKey timed_key;
+      timed_key.key = sequence[i];
+      const int jitter = FLAGS_key_interval_jitter > 0 ?
+          Util::Random(FLAGS_key_interval_jitter + 1) -
+          FLAGS_key_interval_jitter / 2 : 0;
+      timed_key.interval_msec =
+          static_cast<uint32>(max(0, FLAGS_key_interval + jitter));
+      keys->push_back(timed_key);
+    }
+  }
+}
+
+class ClientThread : public Thread {
+ public:
+  explicit ClientThread(std::vector<TimedKey> *keys)
+      : num_failures_(0) {
+    keys_.swap(*keys);
+    latencies_.reserve(keys_.size());
+  }
+
+  void Run() override {
+    client::Client client;
+    if (!FLAGS_server_path.empty()) {
+      client.set_server_program(FLAGS_server_path);
+    }
+    if (!client.EnsureSession()) {
+      LOG(ERROR) << "EnsureSession failed";
+      num_failures_ = keys_.size();
+      return;
+    }
+    commands::Output output;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      Util::Sleep(keys_[i].interval_msec);
+      Stopwatch stopwatch = Stopwatch::StartNew();
+      const bool succeeded = client.SendKey(keys_[i].key, &output);
+      stopwatch.Stop();
+      if (!succeeded) {
+        ++num_failures_;
+        continue;
+      }
+      latencies_.push_back(
+          static_cast<uint32>(stopwatch.GetElapsedMicroseconds()));
+    }
+  }
+
+  // The latencies of the succeeded SendKey in microseconds.
+  const std::vector<uint32> &latencies() const { return latencies_; }
+  size_t num_failures() const { return num_failures_; }
+
+ private:
+  std::vector<TimedKey> keys_;
+  std::vector<uint32> latencies_;
+  size_t num_failures_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClientThread);
+};
+
+// The nearest-rank percentile of the sorted |latencies|.
+uint32 GetPercentile(const std::vector<uint32> &sorted_latencies,
+                     uint32 percentile) {
+  if (sorted_latencies.empty()) {
+    return 0;
+  }
+  const size_t rank = max<size_t>(
+      1, (sorted_latencies.size() * percentile + 99) / 100);
+  return sorted_latencies[rank - 1];
+}
+
+string GetLatencyStats(std::vector<uint32> latencies) {
+  std::sort(latencies.begin(), latencies.end());
+  return Util::StringPrintf(
+      "size=%d p50=%u p95=%u p99=%u max=%u",
+      static_cast<int>(latencies.size()),
+      GetPercentile(latencies, 50), GetPercentile(latencies, 95),
+      GetPercentile(latencies, 99), GetPercentile(latencies, 100));
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  FLAGS_logtostderr = true;
+  CHECK_GT(FLAGS_num_clients, 0);
+
+  {
+    // Launches the server before the measurement.
+    mozc::client::Client client;
+    if (!FLAGS_server_path.empty()) {
+      client.set_server_program(FLAGS_server_path);
+    }
+    CHECK(client.IsValidRunLevel()) << "IsValidRunLevel failed";
+    CHECK(client.EnsureSession()) << "EnsureSession failed";
+    CHECK(client.NoOperation()) << "Server is not responding";
+  }
+
+  std::vector<std::unique_ptr<mozc::ClientThread>> threads;
+  for (int i = 0; i < FLAGS_num_clients; ++i) {
+    std::vector<mozc::TimedKey> keys;
+    mozc::GenerateKeys(FLAGS_keys_per_client, &keys);
+    threads.emplace_back(new mozc::ClientThread(&keys));
+  }
+
+  // CPUStats measures the load since the previous call.  The server is a
+  // different process, so its load is estimated as the system load minus the
+  // one of this process, which includes any other process on the machine.
+  mozc::CPUStats cpu_stats;
+  cpu_stats.GetSystemCPULoad();
+  cpu_stats.GetCurrentProcessCPULoad();
+  mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->SetJoinable(true);
+    threads[i]->Start("ClientLoadTest");
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+  }
+  stopwatch.Stop();
+  const float num_processors =
+      static_cast<float>(cpu_stats.GetNumberOfProcessors());
+  const float system_load = cpu_stats.GetSystemCPULoad() * num_processors;
+  const float client_load = cpu_stats.GetCurrentProcessCPULoad();
+
+  std::vector<uint32> all_latencies;
+  size_t num_failures = 0;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    const std::vector<uint32> &latencies = threads[i]->latencies();
+    all_latencies.insert(all_latencies.end(), latencies.begin(),
+                         latencies.end());
+    num_failures += threads[i]->num_failures();
+    std::cout << "client " << i << ": "
+              << mozc::GetLatencyStats(latencies) << std::endl;
+  }
+
+  const double elapsed_sec = stopwatch.GetElapsedMilliseconds() / 1000.0;
+  std::cout << "all clients: " << mozc::GetLatencyStats(all_latencies)
+            << std::endl;
+  std::cout << mozc::Util::StringPrintf(
+      "clients=%d elapsed=%.1fs throughput=%.1f keys/s failures=%d",
+      FLAGS_num_clients, elapsed_sec,
+      elapsed_sec > 0.0 ? all_latencies.size() / elapsed_sec : 0.0,
+      static_cast<int>(num_failures)) << std::endl;
+  // The loads are in the number of the processors kept busy.
+  std::cout << mozc::Util::StringPrintf(
+      "cpu: system=%.2f load_test=%.2f server(estimated)=%.2f "
+      "processors=%d",
+      system_load, client_load, max(0.0f, system_load - client_load),
+      static_cast<int>(num_processors)) << std::endl;
+
+  return num_failures == 0 ? 0 : 1;
+}
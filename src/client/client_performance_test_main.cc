@@ -30,7 +30,9 @@
 #include <algorithm>
 #include <cmath>
 #include <iostream>  // NOLINT
+#include <cstring>
 #include <iterator>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -38,6 +40,7 @@
 #include "base/flags.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/number_util.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "base/stopwatch.h"
@@ -49,6 +52,20 @@
 
 DEFINE_string(server_path, "", "specify server path");
 DEFINE_string(log_path, "", "specify log output file path");
+DEFINE_int32(warmup_runs, 1,
+             "number of the runs of each scenario before the measured one, "
+             "which are excluded from the stats");
+DEFINE_string(output_format, "text", "output format: text, json or csv");
+DEFINE_string(baseline_path, "",
+              "if specified, compare the percentiles with the ones of this "
+              "file written with --output_format=csv, and exit with 1 if "
+              "any of them regressed");
+DEFINE_double(max_regression_ratio, 1.2,
+              "a percentile regresses if it exceeds the baseline by "
+              "this ratio");
+DEFINE_int32(min_regression_usec, 200,
+             "a percentile does not regress if it exceeds the baseline by "
+             "less than this, to tolerate the noise of fast operations");
 
 namespace mozc {
 namespace {
@@ -148,48 +165,147 @@ class TestScenarioInterface {
   commands::Output output_;
 };
 
-string GetBasicStats(const std::vector<uint32> times) {
-  uint32 total_time = 0;
-  uint32 avg_time = 0;
-  uint32 max_time = 0;
-  uint32 min_time = 0;
-  uint32 sd_time = 0;  // Standard Deviation
-  uint32 med_time = 0;
+struct Stats {
+  uint64 size;
+  uint64 total;
+  uint64 avg;
+  uint64 min;
+  uint64 max;
+  uint64 sd;  // Standard Deviation
+  uint64 p50;
+  uint64 p90;
+  uint64 p95;
+  uint64 p99;
+};
 
-  min_time = INT_MAX;
-  max_time = 0;
-  for (size_t i = 0; i < times.size(); ++i) {
-    total_time += times[i];
-    min_time = min(times[i], min_time);
-    max_time = max(times[i], max_time);
+// The nearest-rank percentile of the sorted |times|.
+uint64 GetPercentile(const std::vector<uint32> &sorted_times,
+                     uint32 percentile) {
+  DCHECK(!sorted_times.empty());
+  const size_t rank = max<size_t>(
+      1, (sorted_times.size() * percentile + 99) / 100);
+  return sorted_times[rank - 1];
+}
+
+void GetStats(const std::vector<uint32> &times, Stats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->size = times.size();
+  if (times.empty()) {
+    return;
   }
 
-  avg_time = static_cast<uint32>(1.0 * total_time / times.size());
+  stats->min = kuint64max;
+  for (size_t i = 0; i < times.size(); ++i) {
+    stats->total += times[i];
+    stats->min = min<uint64>(times[i], stats->min);
+    stats->max = max<uint64>(times[i], stats->max);
+  }
+  const double avg = 1.0 * stats->total / times.size();
+  stats->avg = static_cast<uint64>(avg);
 
   if (times.size() >= 2) {
     double dsd_time = 0;
     for (size_t i = 0; i < times.size(); ++i) {
-      dsd_time += (avg_time - times[i]) * (avg_time - times[i]);
+      dsd_time += (avg - times[i]) * (avg - times[i]);
     }
-    dsd_time = sqrt(dsd_time / (times.size() - 1));
-    sd_time = static_cast<uint32>(dsd_time);
+    stats->sd = static_cast<uint64>(sqrt(dsd_time / (times.size() - 1)));
   }
 
-  if (!times.empty()) {
-    std::vector<uint32> tmp(times);
-    std::sort(tmp.begin(), tmp.end());
-    med_time = tmp[tmp.size() / 2];
-  }
+  std::vector<uint32> sorted_times(times);
+  std::sort(sorted_times.begin(), sorted_times.end());
+  stats->p50 = GetPercentile(sorted_times, 50);
+  stats->p90 = GetPercentile(sorted_times, 90);
+  stats->p95 = GetPercentile(sorted_times, 95);
+  stats->p99 = GetPercentile(sorted_times, 99);
+}
 
+string GetBasicStats(const Stats &stats) {
   return Util::StringPrintf(
-      "size=%d total=%d avg=%d max=%d min=%d st=%d med=%d",
-      static_cast<int>(times.size()),
-      total_time,
-      avg_time,
-      max_time,
-      min_time,
-      sd_time,
-      med_time);
+      "size=%llu total=%llu avg=%llu max=%llu min=%llu st=%llu med=%llu "
+      "p90=%llu p95=%llu p99=%llu",
+      stats.size, stats.total, stats.avg, stats.max, stats.min, stats.sd,
+      stats.p50, stats.p90, stats.p95, stats.p99);
+}
+
+const char kCsvHeader[] = "name,size,total,avg,min,max,sd,p50,p90,p95,p99";
+
+string GetCsvStats(const string &test_name, const Stats &stats) {
+  return Util::StringPrintf(
+      "%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu",
+      test_name.c_str(), stats.size, stats.total, stats.avg, stats.min,
+      stats.max, stats.sd, stats.p50, stats.p90, stats.p95, stats.p99);
+}
+
+string GetJsonStats(const string &test_name, const Stats &stats) {
+  return Util::StringPrintf(
+      "{\"name\":\"%s\",\"size\":%llu,\"total\":%llu,\"avg\":%llu,"
+      "\"min\":%llu,\"max\":%llu,\"sd\":%llu,\"p50\":%llu,"
+      "\"p90\":%llu,\"p95\":%llu,\"p99\":%llu}",
+      test_name.c_str(), stats.size, stats.total, stats.avg, stats.min,
+      stats.max, stats.sd, stats.p50, stats.p90, stats.p95, stats.p99);
+}
+
+// Loads the stats written with --output_format=csv.
+bool LoadBaseline(const string &path, std::map<string, Stats> *baseline) {
+  InputFileStream ifs(path.c_str());
+  if (!ifs) {
+    LOG(ERROR) << "Cannot open " << path;
+    return false;
+  }
+  string line;
+  while (std::getline(ifs, line)) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line == kCsvHeader) {
+      continue;
+    }
+    std::vector<string> fields;
+    Util::SplitStringUsing(line, ",", &fields);
+    uint64 values[10];
+    bool valid = fields.size() == arraysize(values) + 1;
+    for (size_t i = 0; valid && i < arraysize(values); ++i) {
+      valid = NumberUtil::SafeStrToUInt64(fields[i + 1], &values[i]);
+    }
+    if (!valid) {
+      LOG(ERROR) << "Invalid baseline: " << line;
+      return false;
+    }
+    const Stats stats = {
+      values[0], values[1], values[2], values[3], values[4],
+      values[5], values[6], values[7], values[8], values[9],
+    };
+    (*baseline)[fields[0]] = stats;
+  }
+  return true;
+}
+
+// Returns false and logs the percentiles of |stats| which regressed from
+// |baseline| beyond --max_regression_ratio and --min_regression_usec.
+bool CheckRegression(const string &test_name, const Stats &baseline,
+                     const Stats &stats) {
+  const struct {
+    const char *name;
+    uint64 baseline;
+    uint64 value;
+  } kPercentiles[] = {
+    {"p50", baseline.p50, stats.p50},
+    {"p90", baseline.p90, stats.p90},
+    {"p95", baseline.p95, stats.p95},
+    {"p99", baseline.p99, stats.p99},
+  };
+  bool passed = true;
+  for (size_t i = 0; i < arraysize(kPercentiles); ++i) {
+    const double limit = max(
+        kPercentiles[i].baseline * FLAGS_max_regression_ratio,
+        static_cast<double>(kPercentiles[i].baseline +
+                            FLAGS_min_regression_usec));
+    if (kPercentiles[i].value > limit) {
+      LOG(ERROR) << "Regression: " << test_name << " "
+                 << kPercentiles[i].name << " " << kPercentiles[i].baseline
+                 << " -> " << kPercentiles[i].value << " usec";
+      passed = false;
+    }
+  }
+  return passed;
 }
 
 class PreeditCommon : public TestScenarioInterface {
@@ -378,6 +494,10 @@ int main(int argc, char **argv) {
   tests.push_back(new mozc::PredictionWithTwoChars);
 
   for (size_t i = 0; i < tests.size(); ++i) {
+    for (int j = 0; j < FLAGS_warmup_runs; ++j) {
+      mozc::Result warmup_result;
+      tests[i]->Run(&warmup_result);
+    }
     mozc::Result *result = new mozc::Result;
     tests[i]->Run(result);
     results.push_back(result);
@@ -385,21 +505,51 @@ int main(int argc, char **argv) {
 
   CHECK_EQ(results.size(), tests.size());
 
+  std::map<string, mozc::Stats> baseline;
+  if (!FLAGS_baseline_path.empty() &&
+      !mozc::LoadBaseline(FLAGS_baseline_path, &baseline)) {
+    return 1;
+  }
+
   std::ostream *ofs = &std::cout;
   if (!FLAGS_log_path.empty()) {
     ofs = new mozc::OutputFileStream(FLAGS_log_path.c_str());
   }
 
   // TODO(taku): generate histogram with ChartAPI
+  if (FLAGS_output_format == "json") {
+    (*ofs) << "{\"results\":[";
+  } else if (FLAGS_output_format == "csv") {
+    (*ofs) << mozc::kCsvHeader << std::endl;
+  }
+  bool passed = true;
   for (size_t i = 0; i < tests.size(); ++i) {
-    (*ofs) << results[i]->test_name << ": "
-           << mozc::GetBasicStats(results[i]->operations_times) << std::endl;
+    const string &test_name = results[i]->test_name;
+    mozc::Stats stats;
+    mozc::GetStats(results[i]->operations_times, &stats);
+    if (FLAGS_output_format == "json") {
+      (*ofs) << (i == 0 ? "" : ",") << mozc::GetJsonStats(test_name, stats);
+    } else if (FLAGS_output_format == "csv") {
+      (*ofs) << mozc::GetCsvStats(test_name, stats) << std::endl;
+    } else {
+      (*ofs) << test_name << ": " << mozc::GetBasicStats(stats) << std::endl;
+    }
+
+    const std::map<string, mozc::Stats>::const_iterator it =
+        baseline.find(test_name);
+    if (it != baseline.end() &&
+        !mozc::CheckRegression(test_name, it->second, stats)) {
+      passed = false;
+    }
     delete tests[i];
     delete results[i];
   }
+  if (FLAGS_output_format == "json") {
+    (*ofs) << "]}" << std::endl;
+  }
   if (ofs != &std::cout) {
     delete ofs;
   }
 
-  return 0;
+  return passed ? 0 : 1;
 }
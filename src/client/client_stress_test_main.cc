@@ -43,6 +43,7 @@
 #include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/util.h"
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_client.h"
@@ -99,6 +100,9 @@ int main(int argc, char **argv) {
   std::vector<mozc::commands::KeyEvent> keys;
   mozc::commands::Output output;
   int32 keyevents_size = 0;
+  // The latency of SendKey, which shows the cost of the user data I/O in the
+  // server, e.g., with and without --ephemeral_user_data of the server.
+  double total_latency_usec = 0.0;
 
   // TODO(taku):
   // Stop the test if server is crashed.
@@ -112,7 +116,10 @@ int main(int argc, char **argv) {
       mozc::Util::Sleep(FLAGS_key_duration);
       keyevents_size++;
       if (keyevents_size % 100 == 0) {
-        std::cout << keyevents_size << " key events finished" << std::endl;
+        std::cout << keyevents_size << " key events finished, "
+                  << "average SendKey latency: "
+                  << total_latency_usec / (keyevents_size - 1) << " usec"
+                  << std::endl;
       }
       if (FLAGS_max_keyevents < keyevents_size) {
         std::cout << "key events reached to " << FLAGS_max_keyevents
@@ -127,7 +134,10 @@ int main(int argc, char **argv) {
       }
 
       VLOG(2) << "Sending to Server: " << keys[i].DebugString();
+      mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
       client.SendKey(keys[i], &output);
+      stopwatch.Stop();
+      total_latency_usec += stopwatch.GetElapsedMicroseconds();
       VLOG(2) << "Output of SendKey: " << output.DebugString();
 
       if (renderer_client.get() != NULL) {
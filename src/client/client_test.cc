@@ -270,6 +270,110 @@ TEST_F(ClientTest, SendKey) {
   EXPECT_EQ(commands::Input::SEND_KEY, input.type());
 }
 
+TEST_F(ClientTest, ReuseConnection) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  // A connection is made for each call unless it is reusable.
+  int num_clients = client_factory_->num_clients();
+  EXPECT_TRUE(client_->NoOperation());
+  EXPECT_TRUE(client_->NoOperation());
+  EXPECT_EQ(num_clients + 2, client_factory_->num_clients());
+
+  client_factory_->SetReusable(true);
+  num_clients = client_factory_->num_clients();
+  EXPECT_TRUE(client_->NoOperation());
+  EXPECT_TRUE(client_->NoOperation());
+  EXPECT_TRUE(client_->NoOperation());
+  EXPECT_EQ(num_clients + 1, client_factory_->num_clients());
+
+  // Reset() drops the connection.
+  client_->Reset();
+  EXPECT_TRUE(client_->NoOperation());
+  EXPECT_EQ(num_clients + 2, client_factory_->num_clients());
+}
+
+TEST_F(ClientTest, OutputDelta) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+  commands::Capability capability;
+  capability.set_delta_output(true);
+  client_->set_client_capability(capability);
+
+  commands::KeyEvent key_event;
+  key_event.set_key_code('a');
+
+  commands::Output full_output;
+  full_output.set_id(mock_id);
+  full_output.set_consumed(true);
+  full_output.set_output_id(1);
+  commands::Preedit *preedit = full_output.mutable_preedit();
+  preedit->set_cursor(2);
+  for (const char *value : {"a", "b"}) {
+    commands::Preedit::Segment *segment = preedit->add_segment();
+    segment->set_annotation(commands::Preedit::Segment::UNDERLINE);
+    segment->set_value(value);
+    segment->set_value_length(1);
+  }
+  commands::Candidates *candidates = full_output.mutable_candidates();
+  candidates->set_size(1);
+  candidates->set_position(0);
+  commands::Candidates::Candidate *candidate = candidates->add_candidate();
+  candidate->set_index(0);
+  candidate->set_value("AB");
+  SetMockOutput(full_output);
+
+  commands::Output output;
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  EXPECT_EQ(full_output.DebugString(), output.DebugString());
+  commands::Input input;
+  GetGeneratedInput(&input);
+  EXPECT_FALSE(input.has_base_output_id());
+
+  // The client restores the omitted segments and candidates.
+  commands::Output delta_output;
+  delta_output.set_id(mock_id);
+  delta_output.set_consumed(true);
+  delta_output.set_output_id(2);
+  delta_output.mutable_preedit()->set_cursor(3);
+  commands::Preedit::Segment *segment =
+      delta_output.mutable_preedit()->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::UNDERLINE);
+  segment->set_value("c");
+  segment->set_value_length(1);
+  delta_output.mutable_delta()->set_base_output_id(1);
+  delta_output.mutable_delta()->set_preedit_kept_segments(2);
+  delta_output.mutable_delta()->set_candidates_unchanged(true);
+  SetMockOutput(delta_output);
+
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  GetGeneratedInput(&input);
+  EXPECT_EQ(1, input.base_output_id());
+  EXPECT_FALSE(output.has_delta());
+  EXPECT_EQ(2, output.output_id());
+  EXPECT_EQ(3, output.preedit().cursor());
+  ASSERT_EQ(3, output.preedit().segment_size());
+  EXPECT_EQ("a", output.preedit().segment(0).value());
+  EXPECT_EQ("b", output.preedit().segment(1).value());
+  EXPECT_EQ("c", output.preedit().segment(2).value());
+  EXPECT_EQ(full_output.candidates().DebugString(),
+            output.candidates().DebugString());
+
+  // An output based on an unknown output is rejected.
+  delta_output.set_output_id(3);
+  delta_output.mutable_delta()->set_base_output_id(1);
+  SetMockOutput(delta_output);
+  EXPECT_FALSE(client_->SendKey(key_event, &output));
+  GetGeneratedInput(&input);
+  EXPECT_EQ(2, input.base_output_id());
+
+  // Then the client asks for the complete output.
+  SetMockOutput(full_output);
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  GetGeneratedInput(&input);
+  EXPECT_FALSE(input.has_base_output_id());
+}
+
 TEST_F(ClientTest, SendKeyWithContext) {
   const int mock_id = 123;
   EXPECT_TRUE(SetupConnection(mock_id));
@@ -300,6 +404,49 @@ TEST_F(ClientTest, SendKeyWithContext) {
   EXPECT_EQ(kSuppressSuggestion, input.context().suppress_suggestion());
 }
 
+TEST_F(ClientTest, SendKeys) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  std::vector<commands::KeyEvent> keys(3);
+  keys[0].set_key_code('a');
+  keys[1].set_key_code('b');
+  keys[2].set_key_code('c');
+
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  mock_output.set_consumed(true);
+  mock_output.set_batched_key_count(3);
+  SetMockOutput(mock_output);
+
+  std::vector<commands::Output> outputs;
+  EXPECT_TRUE(client_->SendKeysWithContext(
+      keys, commands::Context::default_instance(), &outputs));
+  EXPECT_EQ(1, outputs.size());
+  commands::Input input;
+  GetGeneratedInput(&input);
+  EXPECT_EQ(commands::Input::SEND_KEYS, input.type());
+  ASSERT_EQ(3, input.batched_keys_size());
+  EXPECT_EQ('a', input.batched_keys(0).key_code());
+  EXPECT_EQ('c', input.batched_keys(2).key_code());
+
+  // The keys not applied by the server are sent again.
+  mock_output.set_batched_key_count(1);
+  SetMockOutput(mock_output);
+  EXPECT_TRUE(client_->SendKeysWithContext(
+      keys, commands::Context::default_instance(), &outputs));
+  EXPECT_EQ(3, outputs.size());
+  GetGeneratedInput(&input);
+  ASSERT_EQ(1, input.batched_keys_size());
+  EXPECT_EQ('c', input.batched_keys(0).key_code());
+
+  // An output applying no keys is an error.
+  mock_output.clear_batched_key_count();
+  SetMockOutput(mock_output);
+  EXPECT_FALSE(client_->SendKeysWithContext(
+      keys, commands::Context::default_instance(), &outputs));
+}
+
 TEST_F(ClientTest, TestSendKey) {
   const int mock_id = 512;
   EXPECT_TRUE(SetupConnection(mock_id));
@@ -817,6 +964,38 @@ TEST_F(SessionPlaybackTest, PushAndResetHistoryWithNoModeTest) {
   EXPECT_EQ(0, history.size());
 }
 
+TEST_F(SessionPlaybackTest, PushHistoryOfSendKeys) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  std::vector<commands::KeyEvent> keys(3);
+  keys[0].set_key_code('a');
+  keys[1].set_key_code('b');
+  keys[2].set_key_code('c');
+
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  mock_output.set_consumed(true);
+  mock_output.set_batched_key_count(2);
+  SetMockOutput(mock_output);
+
+  // The applied keys are remembered one by one.  The last key is sent again
+  // and the count of the mock output is capped by the number of the keys.
+  std::vector<commands::Output> outputs;
+  EXPECT_TRUE(client_->SendKeysWithContext(
+      keys, commands::Context::default_instance(), &outputs));
+  std::vector<commands::Input> history;
+  client_->GetHistoryInputs(&history);
+  ASSERT_EQ(3, history.size());
+  for (size_t i = 0; i < history.size(); ++i) {
+    EXPECT_EQ(commands::Input::SEND_KEY, history[i].type());
+    EXPECT_EQ(0, history[i].batched_keys_size());
+  }
+  EXPECT_EQ('a', history[0].key().key_code());
+  EXPECT_EQ('b', history[1].key().key_code());
+  EXPECT_EQ('c', history[2].key().key_code());
+}
+
 // b/2797557
 TEST_F(SessionPlaybackTest, PushAndResetHistoryWithModeTest) {
   const int mock_id = 123;
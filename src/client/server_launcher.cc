@@ -36,6 +36,7 @@
 #include <unistd.h>
 #endif  // OS_WIN
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
@@ -66,11 +67,28 @@ const char kServerName[] = "session";
 // Wait at most kServerWaitTimeout msec until server gets ready
 const uint32 kServerWaitTimeout = 20000;  // 20 sec
 
-// for every 1000m sec, check server
-const uint32 kRetryIntervalForServer = 1000;
+// Check the server in the exponentially increasing intervals from
+// kMinRetryIntervalForServer to kMaxRetryIntervalForServer msec, until
+// kServerWaitTimeout msec elapse.
+const uint32 kMinRetryIntervalForServer = 10;
+const uint32 kMaxRetryIntervalForServer = 1000;
 
-// Try 20 times to check mozc_server is running
-const uint32 kTrial = 20;
+// Pings the server until it responds or kServerWaitTimeout msec elapse.
+bool WaitForServerWithBackoff(ClientInterface *client) {
+  uint32 interval = kMinRetryIntervalForServer;
+  uint32 elapsed = 0;
+  while (true) {
+    if (client->PingServer()) {
+      return true;
+    }
+    if (elapsed >= kServerWaitTimeout) {
+      return false;
+    }
+    Util::Sleep(interval);
+    elapsed += interval;
+    interval = std::min(interval * 2, kMaxRetryIntervalForServer);
+  }
+}
 
 #ifdef DEBUG
 // Load special flags for server.
@@ -215,15 +233,12 @@ bool ServerLauncher::StartServer(ClientInterface *client) {
   } else {
     // maybe another process is trying to launch mozc_server.
     LOG(ERROR) << "cannot make NamedEventListener ";
-    Util::Sleep(kRetryIntervalForServer);
   }
 
-  // Try to connect mozc_server just in case.
-  for (int trial = 0; trial < kTrial; ++trial) {
-    if (client->PingServer()) {
-      return true;
-    }
-    Util::Sleep(kRetryIntervalForServer);
+  // Try to connect mozc_server just in case.  Usually the first ping
+  // succeeds as the event is signaled after the server starts listening.
+  if (WaitForServerWithBackoff(client)) {
+    return true;
   }
 
   LOG(ERROR) << kProductNameInEnglish << " cannot be launched";
@@ -33,6 +33,7 @@
 
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/internal/composition.h"
 #include "composer/internal/composition_input.h"
@@ -52,6 +53,8 @@ DEFINE_uint64(max_typing_correction_query_candidates, 40,
               "Maximum # of typing correction query temporary candidates.");
 DEFINE_uint64(max_typing_correction_query_results, 8,
               "Maximum # of typing correction query results.");
+DEFINE_uint64(max_typing_correction_expansions_per_key, 320,
+              "Maximum # of typing correction paths expanded per key.");
 DECLARE_bool(enable_typing_correction);
 
 namespace mozc {
@@ -213,11 +216,30 @@ Composer::Composer(const Table *table,
       config_(config) {
   SetInputMode(transliteration::HIRAGANA);
   typing_corrector_.SetConfig(config);
+  typing_corrector_.set_max_expansions_per_key(
+      FLAGS_max_typing_correction_expansions_per_key);
   Reset();
 }
 
 Composer::~Composer() {}
 
+Composer::QueryCache::QueryCache()
+    : valid(false),
+      generation(0),
+      input_mode(transliteration::HIRAGANA) {}
+
+bool Composer::LookUpQueryCache(QueryCache *cache) const {
+  const uint64 generation = composition_->generation();
+  if (cache->valid && cache->generation == generation &&
+      cache->input_mode == input_mode_) {
+    return true;
+  }
+  cache->valid = true;
+  cache->generation = generation;
+  cache->input_mode = input_mode_;
+  return false;
+}
+
 void Composer::Reset() {
   EditErase();
   ResetInputMode();
@@ -483,6 +505,7 @@ void Composer::InsertCharacterKeyAndPreeditForProbableKeyEvents(
 }
 
 bool Composer::InsertCharacterKeyEvent(const commands::KeyEvent &key) {
+  MOZC_TRACE_SPAN("Composer::InsertCharacterKeyEvent");
   if (!EnableInsert()) {
     return false;
   }
@@ -717,10 +740,14 @@ void Composer::GetStringForSubmission(string *output) const {
 }
 
 void Composer::GetQueryForConversion(string *output) const {
-  string base_output;
-  composition_->GetStringWithTrimMode(FIX, &base_output);
-  TransformCharactersForNumbers(&base_output);
-  Util::FullWidthAsciiToHalfWidthAscii(base_output, output);
+  if (!LookUpQueryCache(&conversion_query_cache_)) {
+    string base_output;
+    composition_->GetStringWithTrimMode(FIX, &base_output);
+    TransformCharactersForNumbers(&base_output);
+    Util::FullWidthAsciiToHalfWidthAscii(base_output,
+                                         &conversion_query_cache_.query);
+  }
+  output->assign(conversion_query_cache_.query);
 }
 
 namespace {
@@ -783,6 +810,13 @@ string *GetBaseQueryForPrediction(string *asis_query,
 }  // namespace
 
 void Composer::GetQueryForPrediction(string *output) const {
+  if (!LookUpQueryCache(&prediction_query_cache_)) {
+    GetQueryForPredictionInternal(&prediction_query_cache_.query);
+  }
+  output->assign(prediction_query_cache_.query);
+}
+
+void Composer::GetQueryForPredictionInternal(string *output) const {
   string asis_query;
   composition_->GetStringWithTrimMode(ASIS, &asis_query);
 
@@ -815,20 +849,40 @@ void Composer::GetQueryForPrediction(string *output) const {
 
 void Composer::GetQueriesForPrediction(
     string *base, std::set<string> *expanded) const {
+  DCHECK(expanded);
+  std::vector<string> expanded_vector;
+  GetQueriesForPrediction(base, &expanded_vector);
+  expanded->clear();
+  expanded->insert(expanded_vector.begin(), expanded_vector.end());
+}
+
+void Composer::GetQueriesForPrediction(
+    string *base, std::vector<string> *expanded) const {
   DCHECK(base);
   DCHECK(expanded);
   DCHECK(composition_.get());
-  // In case of the Latin input modes, we don't perform expansion.
-  switch (input_mode_) {
-    case transliteration::HALF_ASCII:
-    case transliteration::FULL_ASCII: {
-      GetQueryForPrediction(base);
-      expanded->clear();
-      return;
+  if (!LookUpQueryCache(&expanded_query_cache_)) {
+    string *cached_base = &expanded_query_cache_.query;
+    std::vector<string> *cached_expanded = &expanded_query_cache_.expanded;
+    cached_expanded->clear();
+    switch (input_mode_) {
+      // In case of the Latin input modes, we don't perform expansion.
+      case transliteration::HALF_ASCII:
+      case transliteration::FULL_ASCII: {
+        GetQueryForPrediction(cached_base);
+        break;
+      }
+      default: {
+        std::set<string> expanded_set;
+        composition_->GetExpandedStrings(cached_base, &expanded_set);
+        cached_expanded->assign(expanded_set.begin(), expanded_set.end());
+        break;
+      }
     }
-    default: {}
   }
-  composition_->GetExpandedStrings(base, expanded);
+  base->assign(expanded_query_cache_.query);
+  expanded->assign(expanded_query_cache_.expanded.begin(),
+                   expanded_query_cache_.expanded.end());
 }
 
 void Composer::GetTypeCorrectedQueriesForPrediction(
@@ -1224,6 +1278,12 @@ void Composer::CopyFrom(const Composer &src) {
   request_ = src.request_;
   config_ = src.config_;
 
+  // The clone of the composition has the same generation as the source, so
+  // the caches have to come from the source too.
+  conversion_query_cache_ = src.conversion_query_cache_;
+  prediction_query_cache_ = src.prediction_query_cache_;
+  expanded_query_cache_ = src.expanded_query_cache_;
+
   typing_corrector_.CopyFrom(src.typing_corrector_);
 }
 
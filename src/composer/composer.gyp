@@ -43,6 +43,7 @@
         'internal/composition.cc',
         'internal/composition_input.cc',
         'internal/converter.cc',
+        'internal/double_array_trie.cc',
         'internal/mode_switching_handler.cc',
         'internal/transliterators.cc',
         'internal/typing_corrector.cc',
@@ -62,6 +63,20 @@
         '../transliteration/transliteration.gyp:transliteration',
       ],
     },
+    {
+      'target_name': 'composer_benchmark_main',
+      'type': 'executable',
+      'sources': [
+        'composer_benchmark_main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../data_manager/oss/oss_data_manager.gyp:oss_data_manager',
+        '../protocol/protocol.gyp:commands_proto',
+        '../protocol/protocol.gyp:config_proto',
+        'composer',
+      ],
+    },
     {
       'target_name': 'key_event_util',
       'type': 'static_library',
@@ -125,6 +125,10 @@ class Composer {
 
   // Returns a expanded prediction query.
   void GetQueriesForPrediction(string *base, std::set<string> *expanded) const;
+  // Same as above, but |expanded| is returned as a sorted vector, which the
+  // caller can reuse across calls to avoid building a set every time.
+  void GetQueriesForPrediction(string *base,
+                               std::vector<string> *expanded) const;
 
   // Returns a type-corrected prediction queries.
   void GetTypeCorrectedQueriesForPrediction(
@@ -231,6 +235,26 @@ class Composer {
  private:
   FRIEND_TEST(ComposerTest, ApplyTemporaryInputMode);
 
+  // Cached result of the query generation.  The predictor and the session
+  // ask for the same queries several times per key event, so the results
+  // are kept while the composition and the input mode are unchanged.
+  struct QueryCache {
+    QueryCache();
+
+    bool valid;
+    uint64 generation;
+    transliteration::TransliterationType input_mode;
+    string query;
+    std::vector<string> expanded;
+  };
+
+  // Returns true if |cache| holds the result for the current composition
+  // and input mode.  Otherwise, marks |cache| as the one for them so that
+  // the caller can fill it, and returns false.
+  bool LookUpQueryCache(QueryCache *cache) const;
+
+  void GetQueryForPredictionInternal(string *output) const;
+
   bool InsertCharacterInternal(const string &input);
   bool InsertCharacterKeyAndPreeditInternal(const string &key,
                                             const string &preedit);
@@ -276,6 +300,10 @@ class Composer {
   const commands::Request *request_;
   const config::Config *config_;
 
+  mutable QueryCache conversion_query_cache_;
+  mutable QueryCache prediction_query_cache_;
+  mutable QueryCache expanded_query_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(Composer);
 };
 
@@ -0,0 +1,459 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Drives Composer with the key streams of the sentences and reports the time
+// and the number of heap allocations per key stroke for each table type.
+// The key streams are derived from the Hiragana sentences: romaji for the
+// romaji and the QWERTY tables, the kana themselves as the preedit for the
+// kana input, and the shortest key sequences found in the table for the
+// 12-key table.
+//
+// Usage:
+//   composer_benchmark_main
+//       --input=data/test/stress_test/sentences.txt
+//       --tables=romaji,kana,12keys,typing_correction
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>  // NOLINT
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/util.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "composer/type_corrected_query.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+
+DEFINE_string(input, "data/test/stress_test/sentences.txt",
+              "file of the sentences in Hiragana, one per line.  Lines "
+              "starting with '#' are ignored");
+DEFINE_int32(max_sentences, 1000, "maximum number of the sentences typed");
+DEFINE_string(tables, "romaji,kana,12keys,typing_correction",
+              "comma separated table types to run: "
+              "(romaji, kana, 12keys, typing_correction)");
+
+namespace {
+
+// The number of the heap allocations made by operator new.
+std::atomic<uint64> g_allocation_count(0);
+
+}  // namespace
+
+// The global allocation functions are replaced to count the allocations.
+void *operator new(size_t size) {
+  g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    std::abort();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+namespace mozc {
+namespace {
+
+using composer::Composer;
+using composer::ProbableKeyEvents;
+using composer::Table;
+
+// Accumulates the time and the allocations of one kind of operation.
+class OperationStats {
+ public:
+  OperationStats() : count_(0), allocations_(0), start_allocations_(0) {}
+
+  void Begin() {
+    start_allocations_ = g_allocation_count;
+    stopwatch_.Start();
+  }
+
+  void End() {
+    stopwatch_.Stop();
+    allocations_ += g_allocation_count - start_allocations_;
+    ++count_;
+  }
+
+  string ToString() {
+    if (count_ == 0) {
+      return "count=0";
+    }
+    return Util::StringPrintf(
+        "count=%d ns/op=%.1f allocs/op=%.2f",
+        static_cast<int>(count_),
+        stopwatch_.GetElapsedNanoseconds() / count_,
+        static_cast<double>(allocations_) / count_);
+  }
+
+ private:
+  Stopwatch stopwatch_;
+  uint64 count_;
+  uint64 allocations_;
+  uint64 start_allocations_;
+
+  DISALLOW_COPY_AND_ASSIGN(OperationStats);
+};
+
+// The keys to type one segment of a sentence.
+typedef std::vector<string> KeySequence;
+
+void ReadSentences(const string &filename, size_t max_size,
+                   std::vector<string> *sentences) {
+  InputFileStream ifs(filename.c_str());
+  CHECK(ifs.good()) << "Cannot open " << filename;
+  string line;
+  while (sentences->size() < max_size && !getline(ifs, line).fail()) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    sentences->push_back(line);
+  }
+}
+
+void SplitIntoChars(const string &str, std::vector<string> *chars) {
+  for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
+    string character;
+    Util::UCS4ToUTF8(iter.Get(), &character);
+    chars->push_back(character);
+  }
+}
+
+// Finds the shortest key sequence which composes each string with |table|.
+// A table entry is reachable when its input is the string composed by a
+// reachable sequence, or a character which has no rule, followed by one key.
+// Returns the map from the composed strings to the key sequences.
+void BuildKeyMap(const Table &table,
+                 std::map<string, std::vector<string>> *key_map) {
+  std::vector<const composer::Entry *> entries;
+  table.LookUpPredictiveAll("", &entries);
+  bool updated = true;
+  while (updated) {
+    updated = false;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      const composer::Entry &entry = *entries[i];
+      // The toggle tables compose the result into the pending string, and
+      // the other tables compose it into the result.
+      string composed;
+      if (entry.pending().empty()) {
+        composed = entry.result();
+      } else if (entry.result().empty()) {
+        composed = entry.pending();
+      } else {
+        continue;
+      }
+      composed = Table::DeleteSpecialKey(composed);
+      std::vector<string> input_chars;
+      SplitIntoChars(entry.input(), &input_chars);
+      if (composed.empty() || input_chars.empty()) {
+        continue;
+      }
+      const string last_key = input_chars.back();
+      input_chars.pop_back();
+      std::vector<string> keys;
+      if (!input_chars.empty()) {
+        string prefix;
+        for (size_t j = 0; j < input_chars.size(); ++j) {
+          prefix.append(input_chars[j]);
+        }
+        const auto prefix_it = key_map->find(prefix);
+        if (prefix_it != key_map->end()) {
+          keys = prefix_it->second;
+        } else if (input_chars.size() == 1) {
+          keys.push_back(prefix);
+        } else {
+          continue;
+        }
+      }
+      keys.push_back(last_key);
+      const auto it = key_map->find(composed);
+      if (it == key_map->end() || it->second.size() > keys.size()) {
+        (*key_map)[composed] = keys;
+        updated = true;
+      }
+    }
+  }
+}
+
+// Splits |sentence| into the key sequences by the longest match with
+// |key_map|.  The characters without sequences are typed as they are.
+void GetKeySequencesFromTable(
+    const std::map<string, std::vector<string>> &key_map,
+    const string &sentence, std::vector<KeySequence> *sequences) {
+  std::vector<string> chars;
+  SplitIntoChars(sentence, &chars);
+  size_t pos = 0;
+  while (pos < chars.size()) {
+    sequences->push_back(KeySequence());
+    string segment;
+    size_t matched = 0;
+    for (size_t len = 1; pos + len <= chars.size() && len <= 3; ++len) {
+      segment.append(chars[pos + len - 1]);
+      const auto it = key_map.find(segment);
+      if (it != key_map.end()) {
+        sequences->back() = it->second;
+        matched = len;
+      }
+    }
+    if (matched == 0) {
+      sequences->back().push_back(chars[pos]);
+      matched = 1;
+    }
+    pos += matched;
+  }
+}
+
+void GetRomajiKeySequences(const string &sentence,
+                           std::vector<KeySequence> *sequences) {
+  string romaji;
+  Util::HiraganaToRomanji(sentence, &romaji);
+  std::vector<string> chars;
+  SplitIntoChars(romaji, &chars);
+  sequences->push_back(KeySequence());
+  sequences->back().swap(chars);
+}
+
+// Makes the probable key events of a QWERTY key, which may be mistyped as
+// its neighbors in the same row.
+void GetProbableKeyEvents(const string &key, ProbableKeyEvents *events) {
+  static const char *kRows[] = { "qwertyuiop", "asdfghjkl", "zxcvbnm" };
+  events->Clear();
+  if (key.size() != 1) {
+    return;
+  }
+  commands::KeyEvent::ProbableKeyEvent *event = events->Add();
+  event->set_key_code(key[0]);
+  event->set_probability(0.9);
+  for (size_t i = 0; i < arraysize(kRows); ++i) {
+    const char *found = strchr(kRows[i], key[0]);
+    if (found == nullptr) {
+      continue;
+    }
+    const size_t col = found - kRows[i];
+    const size_t len = strlen(kRows[i]);
+    if (col > 0) {
+      event = events->Add();
+      event->set_key_code(kRows[i][col - 1]);
+      event->set_probability(0.05);
+    }
+    if (col + 1 < len) {
+      event = events->Add();
+      event->set_key_code(kRows[i][col + 1]);
+      event->set_probability(0.05);
+    }
+  }
+}
+
+class ComposerBenchmark {
+ public:
+  // |romaji_keys| selects the romaji key streams instead of the ones
+  // derived from the table.
+  ComposerBenchmark(const string &name, const commands::Request &request,
+                    const config::Config &config, bool romaji_keys,
+                    const DataManagerInterface &data_manager)
+      : name_(name), request_(request), config_(config),
+        romaji_keys_(romaji_keys) {
+    CHECK(table_.InitializeWithRequestAndConfig(request_, config_,
+                                                data_manager))
+        << "Cannot initialize the table for " << name;
+    BuildKeyMap(table_, &key_map_);
+  }
+
+  void Run(const std::vector<string> &sentences) {
+    Composer composer(&table_, &request_, &config_);
+    const bool use_probable_key_events = config_.use_typing_correction();
+    // Kana input sends the kana itself as the preedit of each key event.
+    const bool use_preedit = (config_.preedit_method() == config::Config::KANA);
+    ProbableKeyEvents events;
+    string query, base;
+    std::vector<string> expanded;
+    std::vector<composer::TypeCorrectedQuery> corrected_queries;
+    for (size_t i = 0; i < sentences.size(); ++i) {
+      std::vector<KeySequence> sequences;
+      if (use_preedit) {
+        std::vector<string> chars;
+        SplitIntoChars(sentences[i], &chars);
+        for (size_t j = 0; j < chars.size(); ++j) {
+          sequences.push_back(KeySequence(1, chars[j]));
+        }
+      } else if (romaji_keys_) {
+        GetRomajiKeySequences(sentences[i], &sequences);
+      } else {
+        GetKeySequencesFromTable(key_map_, sentences[i], &sequences);
+      }
+
+      composer.Reset();
+      for (size_t j = 0; j < sequences.size(); ++j) {
+        // A new chunk starts at each character, like a timeout of the
+        // toggle input does.
+        composer.SetNewInput();
+        const KeySequence &keys = sequences[j];
+        for (size_t k = 0; k < keys.size(); ++k) {
+          if (use_probable_key_events) {
+            GetProbableKeyEvents(keys[k], &events);
+            insert_stats_.Begin();
+            composer.InsertCharacterForProbableKeyEvents(keys[k], events);
+            insert_stats_.End();
+          } else if (use_preedit) {
+            insert_stats_.Begin();
+            composer.InsertCharacterPreedit(keys[k]);
+            insert_stats_.End();
+          } else {
+            insert_stats_.Begin();
+            composer.InsertCharacter(keys[k]);
+            insert_stats_.End();
+          }
+
+          // The session and the predictor ask for the queries on each key.
+          query_stats_.Begin();
+          composer.GetStringForPreedit(&query);
+          composer.GetQueryForConversion(&query);
+          composer.GetQueryForPrediction(&query);
+          composer.GetQueriesForPrediction(&base, &expanded);
+          if (use_probable_key_events) {
+            composer.GetTypeCorrectedQueriesForPrediction(&corrected_queries);
+          }
+          query_stats_.End();
+        }
+      }
+
+      const size_t length = composer.GetLength();
+      for (size_t j = 0; j < length; ++j) {
+        cursor_stats_.Begin();
+        composer.MoveCursorLeft();
+        cursor_stats_.End();
+      }
+      for (size_t j = 0; j < length; ++j) {
+        cursor_stats_.Begin();
+        composer.MoveCursorRight();
+        cursor_stats_.End();
+      }
+      for (size_t j = 0; j < length; ++j) {
+        delete_stats_.Begin();
+        composer.DeleteAt(composer.GetLength() - 1);
+        delete_stats_.End();
+      }
+    }
+  }
+
+  void Report() {
+    std::cout << name_ << std::endl;
+    std::cout << "  insert: " << insert_stats_.ToString() << std::endl;
+    std::cout << "  query:  " << query_stats_.ToString() << std::endl;
+    std::cout << "  cursor: " << cursor_stats_.ToString() << std::endl;
+    std::cout << "  delete: " << delete_stats_.ToString() << std::endl;
+  }
+
+ private:
+  const string name_;
+  const commands::Request request_;
+  const config::Config config_;
+  const bool romaji_keys_;
+  Table table_;
+  std::map<string, std::vector<string>> key_map_;
+  OperationStats insert_stats_;
+  OperationStats query_stats_;
+  OperationStats cursor_stats_;
+  OperationStats delete_stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(ComposerBenchmark);
+};
+
+void RunBenchmark(const string &name,
+                  const DataManagerInterface &data_manager,
+                  const std::vector<string> &sentences) {
+  commands::Request request;
+  config::Config config;
+  config.set_preedit_method(config::Config::ROMAN);
+  bool romaji_keys = true;
+  if (name == "romaji") {
+    // Uses the default request and config.
+  } else if (name == "kana") {
+    config.set_preedit_method(config::Config::KANA);
+    romaji_keys = false;
+  } else if (name == "12keys") {
+    request.set_special_romanji_table(
+        commands::Request::TWELVE_KEYS_TO_HIRAGANA);
+    romaji_keys = false;
+  } else if (name == "typing_correction") {
+    request.set_special_romanji_table(
+        commands::Request::QWERTY_MOBILE_TO_HIRAGANA);
+    config.set_use_typing_correction(true);
+  } else {
+    LOG(FATAL) << "Unknown table type: " << name;
+  }
+
+  ComposerBenchmark benchmark(name, request, config, romaji_keys,
+                              data_manager);
+  benchmark.Run(sentences);
+  benchmark.Report();
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  std::vector<string> sentences;
+  mozc::ReadSentences(FLAGS_input, FLAGS_max_sentences, &sentences);
+  CHECK(!sentences.empty()) << "No sentence in " << FLAGS_input;
+
+  const mozc::oss::OssDataManager data_manager;
+  std::vector<string> tables;
+  mozc::Util::SplitStringUsing(FLAGS_tables, ",", &tables);
+  for (size_t i = 0; i < tables.size(); ++i) {
+    mozc::RunBenchmark(tables[i], data_manager, sentences);
+  }
+  return 0;
+}
@@ -749,6 +749,95 @@ TEST_F(ComposerTest, GetQueriesForPredictionMobile) {
   }
 }
 
+TEST_F(ComposerTest, GetQueriesForPredictionVector) {
+  // "か"
+  table_->AddRule("ka", "\xe3\x81\x8b", "");
+  // "き"
+  table_->AddRule("ki", "\xe3\x81\x8d", "");
+
+  composer_->InsertCharacter("kak");
+  string base;
+  std::vector<string> expanded(1, "garbage");
+  composer_->GetQueriesForPrediction(&base, &expanded);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", base);
+  ASSERT_EQ(3, expanded.size());
+  // The order is the same as std::set.
+  EXPECT_EQ("k", expanded[0]);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", expanded[1]);
+  // "き"
+  EXPECT_EQ("\xe3\x81\x8d", expanded[2]);
+
+  std::set<string> expanded_set;
+  composer_->GetQueriesForPrediction(&base, &expanded_set);
+  EXPECT_EQ(std::set<string>(expanded.begin(), expanded.end()), expanded_set);
+}
+
+TEST_F(ComposerTest, QueryCacheIsInvalidatedByMutation) {
+  // "か"
+  table_->AddRule("ka", "\xe3\x81\x8b", "");
+  // "な"
+  table_->AddRule("na", "\xe3\x81\xaa", "");
+  // "ん"
+  table_->AddRule("nn", "\xe3\x82\x93", "");
+  // "ん"
+  table_->AddRule("n", "\xe3\x82\x93", "");
+
+  string query;
+  std::vector<string> expanded;
+  composer_->InsertCharacter("kan");
+  composer_->GetQueryForConversion(&query);
+  // "かん"
+  EXPECT_EQ("\xe3\x81\x8b\xe3\x82\x93", query);
+  composer_->GetQueryForPrediction(&query);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", query);
+  composer_->GetQueriesForPrediction(&query, &expanded);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", query);
+  EXPECT_FALSE(expanded.empty());
+
+  composer_->Backspace();
+  composer_->GetQueryForConversion(&query);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", query);
+  composer_->GetQueryForPrediction(&query);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", query);
+  composer_->GetQueriesForPrediction(&query, &expanded);
+  // "か"
+  EXPECT_EQ("\xe3\x81\x8b", query);
+  EXPECT_TRUE(expanded.empty());
+
+  // The input mode changes the prediction queries.
+  composer_->SetInputMode(transliteration::HALF_ASCII);
+  composer_->InsertCharacter("n");
+  composer_->GetQueryForPrediction(&query);
+  // "かn"
+  EXPECT_EQ("\xe3\x81\x8bn", query);
+  composer_->GetQueriesForPrediction(&query, &expanded);
+  // "かn"
+  EXPECT_EQ("\xe3\x81\x8bn", query);
+  EXPECT_TRUE(expanded.empty());
+
+  // The cache of the copy is consistent with its composition.
+  Composer copied(table_.get(), request_.get(), config_.get());
+  copied.InsertCharacter("ka");
+  copied.GetQueryForConversion(&query);
+  copied.CopyFrom(*composer_);
+  copied.GetQueryForConversion(&query);
+  // "かn"
+  EXPECT_EQ("\xe3\x81\x8bn", query);
+
+  composer_->EditErase();
+  composer_->GetQueryForConversion(&query);
+  EXPECT_TRUE(query.empty());
+  composer_->GetQueriesForPrediction(&query, &expanded);
+  EXPECT_TRUE(query.empty());
+  EXPECT_TRUE(expanded.empty());
+}
+
 TEST_F(ComposerTest, GetStringFunctions_ForN) {
   table_->AddRule("a", "[A]", "");
   table_->AddRule("n", "[N]", "");
@@ -38,6 +38,7 @@
         'internal/composition_input_test.cc',
         'internal/composition_test.cc',
         'internal/converter_test.cc',
+        'internal/double_array_trie_test.cc',
         'internal/mode_switching_handler_test.cc',
         'internal/transliterators_test.cc',
         'internal/typing_corrector_test.cc',
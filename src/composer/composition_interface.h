@@ -32,6 +32,8 @@
 
 #include <set>
 #include <string>
+
+#include "base/port.h"
 #include "composer/internal/transliterators.h"
 
 namespace mozc {
@@ -128,6 +130,10 @@ class CompositionInterface {
   // Set composition table.
   // This class does NOT take the ownership of the table;
   virtual void SetTable(const Table *table) = 0;
+
+  // Returns a number which is changed by every method that may change the
+  // composed strings.  A clone has the same generation as the original.
+  virtual uint64 generation() const = 0;
 };
 
 }  // namespace composer
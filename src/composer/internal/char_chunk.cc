@@ -29,6 +29,7 @@
 
 #include "composer/internal/char_chunk.h"
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -112,32 +113,61 @@ CharChunk::CharChunk(Transliterators::Transliterator transliterator,
                      const Table *table)
     : transliterator_(transliterator),
       table_(table),
-      attributes_(NO_TABLE_ATTRIBUTE) {
+      attributes_(NO_TABLE_ATTRIBUTE),
+      result_cache_bits_(0) {
   DCHECK_NE(Transliterators::LOCAL, transliterator);
 }
 
 void CharChunk::Clear() {
+  ClearResultCache();
   raw_.clear();
   conversion_.clear();
   pending_.clear();
   ambiguous_.clear();
 }
 
+void CharChunk::Reset(Transliterators::Transliterator transliterator,
+                      const Table *table) {
+  DCHECK_NE(Transliterators::LOCAL, transliterator);
+  transliterator_ = transliterator;
+  table_ = table;
+  attributes_ = NO_TABLE_ATTRIBUTE;
+  Clear();
+}
+
+const string &CharChunk::GetResult(Transliterators::Transliterator t12r,
+                                   size_t *length) const {
+  const Transliterators::Transliterator resolved_t12r = GetTransliterator(t12r);
+  DCHECK_LT(resolved_t12r, Transliterators::NUM_OF_TRANSLITERATOR);
+  const uint32 bit = 1 << resolved_t12r;
+  if (!(result_cache_bits_ & bit)) {
+    result_cache_[resolved_t12r] = Transliterate(
+        resolved_t12r,
+        Table::DeleteSpecialKey(raw_),
+        Table::DeleteSpecialKey(conversion_ + pending_));
+    result_length_cache_[resolved_t12r] =
+        Util::CharsLen(result_cache_[resolved_t12r]);
+    result_cache_bits_ |= bit;
+  }
+  if (length != NULL) {
+    *length = result_length_cache_[resolved_t12r];
+  }
+  return result_cache_[resolved_t12r];
+}
+
+void CharChunk::ClearResultCache() {
+  result_cache_bits_ = 0;
+}
+
 size_t CharChunk::GetLength(Transliterators::Transliterator t12r) const {
-  const string t13n = Transliterate(
-      t12r,
-      Table::DeleteSpecialKey(raw_),
-      Table::DeleteSpecialKey(conversion_ + pending_));
-  return Util::CharsLen(t13n);
+  size_t length = 0;
+  GetResult(t12r, &length);
+  return length;
 }
 
 void CharChunk::AppendResult(Transliterators::Transliterator t12r,
                              string *result) const {
-  const string t13n = Transliterate(
-      t12r,
-      Table::DeleteSpecialKey(raw_),
-      Table::DeleteSpecialKey(conversion_ + pending_));
-  result->append(t13n);
+  result->append(GetResult(t12r, NULL));
 }
 
 void CharChunk::AppendTrimedResult(Transliterators::Transliterator t12r,
@@ -277,6 +307,7 @@ bool CharChunk::IsConvertible(
 }
 
 void CharChunk::Combine(const CharChunk &left_chunk) {
+  ClearResultCache();
   conversion_ = left_chunk.conversion_ + conversion_;
   raw_ = left_chunk.raw_ + raw_;
   // TODO(komatsu): This is a hacky way.  We should look up the
@@ -294,6 +325,7 @@ void CharChunk::Combine(const CharChunk &left_chunk) {
 }
 
 bool CharChunk::AddInputInternal(string *input) {
+  ClearResultCache();
   const bool kNoLoop = false;
 
   size_t key_length = 0;
@@ -391,6 +423,7 @@ void CharChunk::AddInput(string *input) {
 }
 
 void CharChunk::AddConvertedChar(string *input) {
+  ClearResultCache();
   // TODO(komatsu) Nice to make "string Util::PopOneChar(string *str);".
   string first_char = Util::SubString(*input, 0, 1);
   conversion_.append(first_char);
@@ -400,6 +433,7 @@ void CharChunk::AddConvertedChar(string *input) {
 
 void CharChunk::AddInputAndConvertedChar(string *key,
                                          string *converted_char) {
+  ClearResultCache();
   // If this chunk is empty, the key and converted_char are simply
   // copied.
   if (raw_.empty() && pending_.empty() && conversion_.empty()) {
@@ -519,6 +553,7 @@ const string &CharChunk::raw() const {
 }
 
 void CharChunk::set_raw(const string &raw) {
+  ClearResultCache();
   raw_ = raw;
 }
 
@@ -527,6 +562,7 @@ const string &CharChunk::conversion() const {
 }
 
 void CharChunk::set_conversion(const string &conversion) {
+  ClearResultCache();
   conversion_ = conversion;
 }
 
@@ -535,6 +571,7 @@ const string &CharChunk::pending() const {
 }
 
 void CharChunk::set_pending(const string &pending) {
+  ClearResultCache();
   pending_ = pending;
 }
 
@@ -549,6 +586,19 @@ void CharChunk::set_ambiguous(const string &ambiguous) {
 bool CharChunk::SplitChunk(Transliterators::Transliterator t12r,
                            const size_t position,
                            CharChunk **left_new_chunk) {
+  std::unique_ptr<CharChunk> left_chunk(new CharChunk(transliterator_, table_));
+  if (!SplitChunk(t12r, position, left_chunk.get())) {
+    return false;
+  }
+  *left_new_chunk = left_chunk.release();
+  return true;
+}
+
+bool CharChunk::SplitChunk(Transliterators::Transliterator t12r,
+                           const size_t position,
+                           CharChunk *left_new_chunk) {
+  DCHECK(left_new_chunk);
+  DCHECK_NE(this, left_new_chunk);
   if (position <= 0 || position >= GetLength(t12r)) {
     LOG(WARNING) << "Invalid position: " << position;
     return false;
@@ -561,23 +611,24 @@ bool CharChunk::SplitChunk(Transliterators::Transliterator t12r,
       Table::DeleteSpecialKey(conversion_ + pending_),
       &raw_lhs, &raw_rhs, &converted_lhs, &converted_rhs);
 
-  *left_new_chunk = new CharChunk(transliterator_, table_);
-  (*left_new_chunk)->set_raw(raw_lhs);
-  set_raw(raw_rhs);
+  ClearResultCache();
+  left_new_chunk->Reset(transliterator_, table_);
+  left_new_chunk->raw_.swap(raw_lhs);
+  raw_.swap(raw_rhs);
 
   if (converted_lhs.size() > conversion_.size()) {
     // [ conversion | pending ] => [ conv | pend#1 ] [ pend#2 ]
-    const string pending_lhs(converted_lhs, conversion_.size());
-    (*left_new_chunk)->set_conversion(conversion_);
-    (*left_new_chunk)->set_pending(pending_lhs);
+    left_new_chunk->pending_.assign(converted_lhs, conversion_.size(),
+                                    string::npos);
+    left_new_chunk->conversion_.swap(conversion_);
 
     conversion_.clear();
-    pending_ = converted_rhs;
+    pending_.swap(converted_rhs);
     ambiguous_.clear();
   } else {
     // [ conversion | pending ] => [ conv#1 ] [ conv#2 | pending ]
-    (*left_new_chunk)->set_conversion(converted_lhs);
-    // left_new_chunk->set_pending("");
+    left_new_chunk->conversion_.swap(converted_lhs);
+    // left_new_chunk->pending_.clear();
     const size_t pending_pos = converted_rhs.size() - pending_.size();
     conversion_.assign(converted_rhs, 0, pending_pos);
     // pending_ = pending_;
@@ -59,6 +59,12 @@ class CharChunk {
 
   void Clear();
 
+  // Reinitializes this chunk as if it were newly constructed with the
+  // arguments.  The strings keep their capacity so that a recycled chunk
+  // doesn't allocate memory again.
+  void Reset(Transliterators::Transliterator transliterator,
+             const Table *table);
+
   size_t GetLength(Transliterators::Transliterator transliterator) const;
 
   // Append the characters representing this CharChunk accoring to the
@@ -99,6 +105,11 @@ class CharChunk {
   bool SplitChunk(Transliterators::Transliterator transliterator,
                   size_t position,
                   CharChunk **left_new_chunk);
+  // Same as above, but |left_new_chunk| is supplied by the caller.  It is
+  // reset and filled with the left part of the split.
+  bool SplitChunk(Transliterators::Transliterator transliterator,
+                  size_t position,
+                  CharChunk *left_new_chunk);
 
   // Return true if this chunk should be commited immediately.  This
   // function refers DIRECT_INPUT attribute.
@@ -162,6 +173,19 @@ class CharChunk {
  private:
   FRIEND_TEST(CharChunkTest, Clone);
   FRIEND_TEST(CharChunkTest, GetTransliterator);
+  FRIEND_TEST(CharChunkTest, Reset);
+  FRIEND_TEST(CharChunkTest, ResultCache);
+
+  // Returns the string which AppendResult appends, i.e. the transliteration
+  // of |raw_| and |conversion_| + |pending_|.  The results are cached for
+  // each transliterator until the strings are modified, as the composition
+  // asks every chunk for them on each key event.
+  const string &GetResult(Transliterators::Transliterator transliterator,
+                          size_t *length) const;
+
+  // Discards the cached results.  Must be called when |raw_|,
+  // |conversion_| or |pending_| is modified.
+  void ClearResultCache();
 
   Transliterators::Transliterator transliterator_;
   const Table *table_;
@@ -171,6 +195,13 @@ class CharChunk {
   string pending_;
   string ambiguous_;
   TableAttributes attributes_;
+
+  // The caches for GetResult, indexed by the transliterator resolved by
+  // GetTransliterator.  The i-th bit of |result_cache_bits_| is set if
+  // the i-th entry is valid.
+  mutable string result_cache_[Transliterators::NUM_OF_TRANSLITERATOR];
+  mutable size_t result_length_cache_[Transliterators::NUM_OF_TRANSLITERATOR];
+  mutable uint32 result_cache_bits_;
 };
 
 }  // namespace composer
@@ -408,6 +408,96 @@ TEST(CharChunkTest, SplitChunk) {
   EXPECT_EQ("m", output);
 }
 
+TEST(CharChunkTest, SplitChunkIntoGivenChunk) {
+  Table table;
+  // "も"
+  table.AddRule("mo", "\xE3\x82\x82", "");
+
+  CharChunk chunk(Transliterators::HALF_ASCII, &table);
+  string input = "mo";
+  chunk.AddInputInternal(&input);
+
+  // The given chunk is reset before being filled.
+  CharChunk left_chunk(Transliterators::HIRAGANA, NULL);
+  left_chunk.set_raw("xyz");
+  left_chunk.set_pending("xyz");
+  left_chunk.set_ambiguous("xyz");
+
+  EXPECT_FALSE(chunk.SplitChunk(Transliterators::LOCAL, 0, &left_chunk));
+  EXPECT_FALSE(chunk.SplitChunk(Transliterators::LOCAL, 2, &left_chunk));
+  EXPECT_TRUE(chunk.SplitChunk(Transliterators::LOCAL, 1, &left_chunk));
+
+  EXPECT_EQ("m", left_chunk.raw());
+  EXPECT_EQ("", left_chunk.ambiguous());
+  EXPECT_EQ("o", chunk.raw());
+  string output;
+  left_chunk.AppendResult(Transliterators::LOCAL, &output);
+  EXPECT_EQ("m", output);
+  output.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &output);
+  EXPECT_EQ("o", output);
+}
+
+TEST(CharChunkTest, Reset) {
+  Table table;
+  CharChunk chunk(Transliterators::HIRAGANA, NULL);
+  chunk.set_raw("a");
+  chunk.set_conversion("a");
+  chunk.set_pending("a");
+  chunk.set_ambiguous("a");
+
+  chunk.Reset(Transliterators::HALF_ASCII, &table);
+  EXPECT_EQ(Transliterators::HALF_ASCII, chunk.transliterator_);
+  EXPECT_EQ(&table, chunk.table_);
+  EXPECT_EQ(NO_TABLE_ATTRIBUTE, chunk.attributes_);
+  EXPECT_EQ("", chunk.raw());
+  EXPECT_EQ("", chunk.conversion());
+  EXPECT_EQ("", chunk.pending());
+  EXPECT_EQ("", chunk.ambiguous());
+}
+
+TEST(CharChunkTest, ResultCache) {
+  Table table;
+  // "か"
+  table.AddRule("ka", "\xE3\x81\x8B", "");
+
+  CharChunk chunk(Transliterators::HIRAGANA, &table);
+  string input = "k";
+  chunk.AddInputInternal(&input);
+  EXPECT_EQ(0, chunk.result_cache_bits_);
+
+  string output;
+  chunk.AppendResult(Transliterators::LOCAL, &output);
+  // "ｋ"
+  EXPECT_EQ("\xEF\xBD\x8B", output);
+  EXPECT_EQ(1, chunk.GetLength(Transliterators::HALF_ASCII));
+  EXPECT_EQ((1 << Transliterators::HIRAGANA) |
+            (1 << Transliterators::HALF_ASCII),
+            chunk.result_cache_bits_);
+
+  // Modifying the chunk discards the cache.
+  input = "a";
+  chunk.AddInputInternal(&input);
+  EXPECT_EQ(0, chunk.result_cache_bits_);
+  output.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &output);
+  // "か"
+  EXPECT_EQ("\xE3\x81\x8B", output);
+  output.clear();
+  chunk.AppendResult(Transliterators::HALF_ASCII, &output);
+  EXPECT_EQ("ka", output);
+  EXPECT_EQ(2, chunk.GetLength(Transliterators::HALF_ASCII));
+
+  // Changing the local transliterator doesn't need to discard the cache.
+  chunk.SetTransliterator(Transliterators::HALF_ASCII);
+  output.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &output);
+  EXPECT_EQ("ka", output);
+
+  chunk.set_raw("ki");
+  EXPECT_EQ(0, chunk.result_cache_bits_);
+}
+
 TEST(CharChunkTest, IsAppendable) {
   Table table;
   // "も"
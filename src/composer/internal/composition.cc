@@ -29,7 +29,6 @@
 
 #include "composer/internal/composition.h"
 
-#include <memory>
 
 #include "base/logging.h"
 #include "base/util.h"
@@ -42,18 +41,21 @@ namespace mozc {
 namespace composer {
 
 Composition::Composition(const Table *table)
-    : table_(table), input_t12r_(Transliterators::CONVERSION_STRING) {}
+    : table_(table),
+      input_t12r_(Transliterators::CONVERSION_STRING),
+      generation_(0) {}
 
 Composition::~Composition() {
   Erase();
+  for (CharChunkList::iterator it = free_chunks_.begin();
+       it != free_chunks_.end(); ++it) {
+    delete *it;
+  }
 }
 
 void Composition::Erase() {
-  CharChunkList::iterator it;
-  for (it = chunks_.begin(); it != chunks_.end(); ++it) {
-    delete *it;
-  }
-  chunks_.clear();
+  ++generation_;
+  free_chunks_.splice(free_chunks_.begin(), chunks_);
 }
 
 size_t Composition::InsertAt(size_t pos, const string &input) {
@@ -75,6 +77,7 @@ size_t Composition::InsertInput(size_t pos, const CompositionInput &input) {
   if (input.Empty()) {
     return pos;
   }
+  ++generation_;
 
   CharChunkList::iterator right_chunk;
   MaybeSplitChunkAt(pos, &right_chunk);
@@ -98,6 +101,7 @@ size_t Composition::InsertInput(size_t pos, const CompositionInput &input) {
 
 // Deletes a right-hand character of the composition.
 size_t Composition::DeleteAt(const size_t position) {
+  ++generation_;
   CharChunkList::iterator chunk_it;
   const size_t original_size = GetLength();
   size_t new_position = position;
@@ -118,14 +122,13 @@ size_t Composition::DeleteAt(const size_t position) {
     // If a chunk contains only invisible characters,
     // the result of GetLength is 0.
     if ((*chunk_it)->GetLength(Transliterators::LOCAL) <= 1) {
-      delete *chunk_it;
-      chunks_.erase(chunk_it);
+      ReleaseChunk(chunk_it);
       continue;
     }
 
-    CharChunk *left_deleted_chunk_ptr = NULL;
-    (*chunk_it)->SplitChunk(Transliterators::LOCAL, 1, &left_deleted_chunk_ptr);
-    std::unique_ptr<CharChunk> left_deleted_chunk(left_deleted_chunk_ptr);
+    CharChunkList::iterator left_deleted_it = InsertChunk(&chunk_it);
+    (*chunk_it)->SplitChunk(Transliterators::LOCAL, 1, *left_deleted_it);
+    ReleaseChunk(left_deleted_it);
   }
   return new_position;
 }
@@ -200,6 +203,7 @@ void Composition::SetTransliterator(
     LOG(ERROR) << "position_from should not be greater than position_to.";
     return;
   }
+  ++generation_;
 
   if (chunks_.empty()) {
     return;
@@ -388,10 +392,12 @@ CharChunk *Composition::MaybeSplitChunkAt(const size_t pos,
     return chunk;
   }
 
-  CharChunk *left_chunk = NULL;
-  chunk->SplitChunk(Transliterators::LOCAL, inner_position, &left_chunk);
-  chunks_.insert(*it, left_chunk);
-  return left_chunk;
+  CharChunkList::iterator left_it = InsertChunk(it);
+  if (!chunk->SplitChunk(Transliterators::LOCAL, inner_position, *left_it)) {
+    ReleaseChunk(left_it);
+    return NULL;
+  }
+  return *left_it;
 }
 
 void Composition::CombinePendingChunks(
@@ -409,15 +415,25 @@ void Composition::CombinePendingChunks(
     }
 
     (*it)->Combine(**left_it);
-    delete *left_it;
-    chunks_.erase(left_it);
+    ReleaseChunk(left_it);
   }
 }
 
 // Insert a chunk to the prev of it.
 CharChunkList::iterator Composition::InsertChunk(CharChunkList::iterator *it) {
-  CharChunk *new_chunk = new CharChunk(input_t12r_, table_);
-  return chunks_.insert(*it, new_chunk);
+  if (free_chunks_.empty()) {
+    return chunks_.insert(*it, new CharChunk(input_t12r_, table_));
+  }
+  // splice() doesn't invalidate the iterator, which now points to the node
+  // in |chunks_|.
+  CharChunkList::iterator new_chunk_it = free_chunks_.begin();
+  (*new_chunk_it)->Reset(input_t12r_, table_);
+  chunks_.splice(*it, free_chunks_, new_chunk_it);
+  return new_chunk_it;
+}
+
+void Composition::ReleaseChunk(CharChunkList::iterator it) {
+  free_chunks_.splice(free_chunks_.begin(), chunks_, it);
 }
 
 const CharChunkList &Composition::GetCharChunkList() const {
@@ -446,6 +462,7 @@ Composition *Composition::CloneImpl() const {
   // it instead of copying pointers.
   object->input_t12r_ = input_t12r_;
   object->table_ = table_;
+  object->generation_ = generation_;
 
   for (CharChunkList::const_iterator it = chunks_.begin();
        it != chunks_.end(); ++it) {
@@ -475,6 +492,7 @@ void Composition::SetInputMode(Transliterators::Transliterator transliterator) {
 }
 
 void Composition::SetTable(const Table *table) {
+  ++generation_;
   table_ = table;
 }
 
@@ -109,6 +109,10 @@ class Composition : public CompositionInterface {
 
   virtual void SetTable(const Table *table);
 
+  virtual uint64 generation() const {
+    return generation_;
+  }
+
   // Following methods are declared as public for unit test.
   void GetChunkAt(size_t position,
                   Transliterators::Transliterator transliterator,
@@ -146,9 +150,17 @@ class Composition : public CompositionInterface {
                           TrimMode trim_mode,
                           string *output) const;
 
+  // Removes the chunk at |it| from |chunks_| and keeps it for reuse.
+  void ReleaseChunk(CharChunkList::iterator it);
+
   const Table *table_;
   CharChunkList chunks_;
+  // Chunks removed from |chunks_|.  The list nodes are moved back and forth
+  // with splice() and the chunks are recycled by CharChunk::Reset(), so
+  // typing and deletion don't allocate memory once the pool is warmed up.
+  CharChunkList free_chunks_;
   Transliterators::Transliterator input_t12r_;
+  uint64 generation_;
 
   DISALLOW_COPY_AND_ASSIGN(Composition);
 };
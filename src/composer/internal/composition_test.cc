@@ -1342,6 +1342,38 @@ TEST_F(CompositionTest, Issue2819580) {
   }
 }
 
+TEST_F(CompositionTest, ReuseReleasedChunks) {
+  // "あ"
+  table_->AddRule("a", "\xe3\x81\x82", "");
+  // "い"
+  table_->AddRule("i", "\xe3\x81\x84", "");
+
+  composition_->InsertAt(0, "a");
+  ASSERT_EQ(1, composition_->GetCharChunkList().size());
+  const CharChunk *chunk = composition_->GetCharChunkList().front();
+
+  // A deleted chunk is recycled for the next input.
+  composition_->DeleteAt(0);
+  EXPECT_TRUE(composition_->GetCharChunkList().empty());
+  composition_->InsertAt(0, "i");
+  ASSERT_EQ(1, composition_->GetCharChunkList().size());
+  EXPECT_EQ(chunk, composition_->GetCharChunkList().front());
+  string output;
+  composition_->GetString(&output);
+  // "い"
+  EXPECT_EQ("\xe3\x81\x84", output);
+
+  // So are the chunks removed by Erase().
+  composition_->Erase();
+  EXPECT_TRUE(composition_->GetCharChunkList().empty());
+  composition_->InsertAt(0, "a");
+  ASSERT_EQ(1, composition_->GetCharChunkList().size());
+  EXPECT_EQ(chunk, composition_->GetCharChunkList().front());
+  composition_->GetString(&output);
+  // "あ"
+  EXPECT_EQ("\xe3\x81\x82", output);
+}
+
 TEST_F(CompositionTest, Issue2990253) {
   // SplitChunk fails.
   // Ambiguous text is left in rhs CharChunk invalidly.
@@ -0,0 +1,267 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "composer/internal/double_array_trie.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace composer {
+namespace {
+
+const uint16 kNoLabel = 256;
+
+bool KeyLess(const DoubleArrayTrie::KeyValue &lhs,
+             const DoubleArrayTrie::KeyValue &rhs) {
+  return lhs.first < rhs.first;
+}
+
+}  // namespace
+
+DoubleArrayTrie::DoubleArrayTrie() : next_free_(1) {
+  Build(std::vector<KeyValue>());
+}
+
+DoubleArrayTrie::~DoubleArrayTrie() {}
+
+void DoubleArrayTrie::Build(const std::vector<KeyValue> &key_values) {
+  std::vector<KeyValue> sorted(key_values);
+  std::stable_sort(sorted.begin(), sorted.end(), KeyLess);
+  // Keep the last one of the same keys.
+  std::vector<KeyValue> unique_key_values;
+  unique_key_values.reserve(sorted.size());
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    DCHECK_GE(sorted[i].second, 0);
+    if (!unique_key_values.empty() &&
+        unique_key_values.back().first == sorted[i].first) {
+      unique_key_values.back().second = sorted[i].second;
+    } else {
+      unique_key_values.push_back(sorted[i]);
+    }
+  }
+
+  array_.clear();
+  nodes_.clear();
+  next_free_ = 1;
+  Resize(1);
+  // Marks the root as used.
+  array_[0].check = 1;
+  Insert(unique_key_values, 0, unique_key_values.size(), 0, 0);
+  VLOG(2) << "DoubleArrayTrie: " << unique_key_values.size() << " keys in "
+          << array_.size() << " elements";
+}
+
+bool DoubleArrayTrie::LookUp(StringPiece key, int32 *value) const {
+  DCHECK(value);
+  uint32 node = 0;
+  for (size_t pos = 0; pos < key.size();) {
+    if (!MoveByChar(key, &pos, &node)) {
+      return false;
+    }
+  }
+  if (nodes_[node].value < 0) {
+    return false;
+  }
+  *value = nodes_[node].value;
+  return true;
+}
+
+bool DoubleArrayTrie::LookUpPrefix(StringPiece key, int32 *value,
+                                   size_t *key_length, bool *fixed) const {
+  DCHECK(value);
+  DCHECK(key_length);
+  DCHECK(fixed);
+  uint32 node = 0;
+  size_t pos = 0;
+  while (pos < key.size() && MoveByChar(key, &pos, &node)) {
+  }
+  *key_length = pos;
+  if (nodes_[node].value < 0) {
+    *fixed = true;
+    return false;
+  }
+  *value = nodes_[node].value;
+  *fixed = !HasChildren(node);
+  return true;
+}
+
+void DoubleArrayTrie::LookUpPredictiveAll(StringPiece key,
+                                          std::vector<int32> *values) const {
+  DCHECK(values);
+  uint32 node = 0;
+  for (size_t pos = 0; pos < key.size();) {
+    if (!MoveByChar(key, &pos, &node)) {
+      return;
+    }
+  }
+  CollectValues(node, values);
+}
+
+bool DoubleArrayTrie::HasSubTrie(StringPiece key) const {
+  if (key.empty()) {
+    return false;
+  }
+  uint32 node = 0;
+  for (size_t pos = 0; pos < key.size();) {
+    if (!MoveByChar(key, &pos, &node)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DoubleArrayTrie::MoveByChar(StringPiece key, size_t *pos,
+                                 uint32 *node) const {
+  DCHECK_LT(*pos, key.size());
+  const size_t length = Util::OneCharLen(key.data() + *pos);
+  // A truncated character never matches, as in Trie.
+  if (*pos + length > key.size()) {
+    return false;
+  }
+  uint32 next = *node;
+  for (size_t i = *pos; i < *pos + length; ++i) {
+    if (!MoveByByte(static_cast<uint8>(key[i]), &next)) {
+      return false;
+    }
+  }
+  *pos += length;
+  *node = next;
+  return true;
+}
+
+bool DoubleArrayTrie::MoveByByte(uint8 byte, uint32 *node) const {
+  const int32 base = array_[*node].base;
+  if (base < 0) {
+    return false;
+  }
+  const uint32 next = static_cast<uint32>(base) + byte + 1;
+  if (next >= array_.size() || array_[next].check != *node + 1) {
+    return false;
+  }
+  *node = next;
+  return true;
+}
+
+bool DoubleArrayTrie::HasChildren(uint32 node) const {
+  return array_[node].base >= 0;
+}
+
+void DoubleArrayTrie::CollectValues(uint32 node,
+                                    std::vector<int32> *values) const {
+  if (nodes_[node].value >= 0) {
+    values->push_back(nodes_[node].value);
+  }
+  if (!HasChildren(node)) {
+    return;
+  }
+  const uint32 base = static_cast<uint32>(array_[node].base);
+  for (uint16 label = nodes_[node].first_child_label; label != kNoLabel;) {
+    const uint32 child = base + label + 1;
+    CollectValues(child, values);
+    label = nodes_[child].next_sibling_label;
+  }
+}
+
+void DoubleArrayTrie::Insert(const std::vector<KeyValue> &key_values,
+                             size_t begin, size_t end, size_t depth,
+                             uint32 node) {
+  // The keys are sorted, so the key ending at this node comes first.
+  if (begin < end && key_values[begin].first.size() == depth) {
+    nodes_[node].value = key_values[begin].second;
+    ++begin;
+  }
+
+  std::vector<uint8> labels;
+  std::vector<size_t> label_begins;
+  for (size_t i = begin; i < end; ++i) {
+    const uint8 label = static_cast<uint8>(key_values[i].first[depth]);
+    if (labels.empty() || labels.back() != label) {
+      labels.push_back(label);
+      label_begins.push_back(i);
+    }
+  }
+  if (labels.empty()) {
+    array_[node].base = -1;
+    return;
+  }
+  label_begins.push_back(end);
+
+  const uint32 base = FindBase(labels);
+  array_[node].base = static_cast<int32>(base);
+  nodes_[node].first_child_label = labels[0];
+  // Reserves all the children before descending into them.
+  for (size_t i = 0; i < labels.size(); ++i) {
+    const uint32 child = base + labels[i] + 1;
+    array_[child].check = node + 1;
+    nodes_[child].next_sibling_label =
+        (i + 1 < labels.size()) ? labels[i + 1] : kNoLabel;
+  }
+  while (next_free_ < array_.size() && array_[next_free_].check != 0) {
+    ++next_free_;
+  }
+  for (size_t i = 0; i < labels.size(); ++i) {
+    Insert(key_values, label_begins[i], label_begins[i + 1], depth + 1,
+           base + labels[i] + 1);
+  }
+}
+
+uint32 DoubleArrayTrie::FindBase(const std::vector<uint8> &labels) {
+  DCHECK(!labels.empty());
+  const uint32 first_offset = labels[0] + 1;
+  uint32 base = (next_free_ > first_offset) ? next_free_ - first_offset : 0;
+  for (;; ++base) {
+    Resize(base + labels.back() + 2);
+    bool found = true;
+    for (size_t i = 0; i < labels.size(); ++i) {
+      if (array_[base + labels[i] + 1].check != 0) {
+        found = false;
+        break;
+      }
+    }
+    if (found) {
+      return base;
+    }
+  }
+}
+
+void DoubleArrayTrie::Resize(size_t size) {
+  if (size <= array_.size()) {
+    return;
+  }
+  const japanese_util_rule::DoubleArray kUnused = {0, 0};
+  const NodeInfo kEmptyNode = {-1, kNoLabel, kNoLabel};
+  array_.resize(size, kUnused);
+  nodes_.resize(size, kEmptyNode);
+}
+
+}  // namespace composer
+}  // namespace mozc
@@ -0,0 +1,110 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_COMPOSER_INTERNAL_DOUBLE_ARRAY_TRIE_H_
+#define MOZC_COMPOSER_INTERNAL_DOUBLE_ARRAY_TRIE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/double_array.h"
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+namespace composer {
+
+// Read-only trie compiled from a set of keys into a double array.  The
+// lookups return the same results as the ones of base/trie.h, which walks
+// the key one UTF-8 character at a time, but each step is an array access
+// instead of a std::map search over allocated strings.
+class DoubleArrayTrie {
+ public:
+  typedef std::pair<string, int32> KeyValue;
+
+  DoubleArrayTrie();
+  ~DoubleArrayTrie();
+
+  // Builds the trie from the key-value pairs.  The values must be
+  // non-negative.  If the same key appears more than once, the last value
+  // is used.
+  void Build(const std::vector<KeyValue> &key_values);
+
+  bool LookUp(StringPiece key, int32 *value) const;
+
+  // Same as Trie::LookUpPrefix.  Walks the key as long as it matches, and
+  // returns the value of the last matched node if any.
+  bool LookUpPrefix(StringPiece key, int32 *value, size_t *key_length,
+                    bool *fixed) const;
+
+  // Same as Trie::LookUpPredictiveAll.  Appends the values of all the keys
+  // starting with the key in the lexicographical order of the keys.
+  void LookUpPredictiveAll(StringPiece key, std::vector<int32> *values) const;
+
+  bool HasSubTrie(StringPiece key) const;
+
+ private:
+  // Moves the node by the bytes of the character at |pos| of the key, and
+  // advances |pos| to the next character.  Returns false without changing
+  // them if the character is not found.
+  bool MoveByChar(StringPiece key, size_t *pos, uint32 *node) const;
+  bool MoveByByte(uint8 byte, uint32 *node) const;
+  bool HasChildren(uint32 node) const;
+  void CollectValues(uint32 node, std::vector<int32> *values) const;
+
+  // Places the children of the node for the keys in [begin, end), all of
+  // which share the first |depth| bytes.
+  void Insert(const std::vector<KeyValue> &key_values, size_t begin,
+              size_t end, size_t depth, uint32 node);
+  uint32 FindBase(const std::vector<uint8> &bytes);
+  void Resize(size_t size);
+
+  struct NodeInfo {
+    // -1 if the node has no value.
+    int32 value;
+    // Labels to enumerate the children in order.  kNoLabel if none.
+    uint16 first_child_label;
+    uint16 next_sibling_label;
+  };
+
+  // |base| is negative for nodes without any children.  |check| holds the
+  // parent node plus one, so that zero means an unused element.
+  std::vector<japanese_util_rule::DoubleArray> array_;
+  std::vector<NodeInfo> nodes_;
+  // Lower bound of the unused elements, used to speed up FindBase().
+  size_t next_free_;
+
+  DISALLOW_COPY_AND_ASSIGN(DoubleArrayTrie);
+};
+
+}  // namespace composer
+}  // namespace mozc
+
+#endif  // MOZC_COMPOSER_INTERNAL_DOUBLE_ARRAY_TRIE_H_
@@ -0,0 +1,191 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "composer/internal/double_array_trie.h"
+
+#include <string>
+#include <vector>
+
+#include "base/trie.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace composer {
+namespace {
+
+TEST(DoubleArrayTrieTest, LookUp) {
+  std::vector<DoubleArrayTrie::KeyValue> key_values;
+  key_values.push_back(DoubleArrayTrie::KeyValue("abc", 0));
+  key_values.push_back(DoubleArrayTrie::KeyValue("abd", 1));
+  key_values.push_back(DoubleArrayTrie::KeyValue("abcd", 2));
+  key_values.push_back(DoubleArrayTrie::KeyValue("abc", 3));
+  key_values.push_back(DoubleArrayTrie::KeyValue("bcd", 4));
+  DoubleArrayTrie trie;
+  trie.Build(key_values);
+
+  int32 value = -1;
+  EXPECT_TRUE(trie.LookUp("abc", &value));
+  // The last value is used for the duplicated key.
+  EXPECT_EQ(3, value);
+  EXPECT_TRUE(trie.LookUp("abd", &value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(trie.LookUp("abcd", &value));
+  EXPECT_EQ(2, value);
+  EXPECT_TRUE(trie.LookUp("bcd", &value));
+  EXPECT_EQ(4, value);
+  EXPECT_FALSE(trie.LookUp("ab", &value));
+  EXPECT_FALSE(trie.LookUp("xyz", &value));
+  EXPECT_FALSE(trie.LookUp("abcde", &value));
+  EXPECT_FALSE(trie.LookUp("", &value));
+
+  EXPECT_TRUE(trie.HasSubTrie("a"));
+  EXPECT_TRUE(trie.HasSubTrie("abcd"));
+  EXPECT_FALSE(trie.HasSubTrie("abcde"));
+  EXPECT_FALSE(trie.HasSubTrie("c"));
+  EXPECT_FALSE(trie.HasSubTrie(""));
+}
+
+TEST(DoubleArrayTrieTest, Empty) {
+  DoubleArrayTrie trie;
+  int32 value = -1;
+  size_t key_length = 1;
+  bool fixed = false;
+  EXPECT_FALSE(trie.LookUp("a", &value));
+  EXPECT_FALSE(trie.LookUpPrefix("a", &value, &key_length, &fixed));
+  EXPECT_EQ(0, key_length);
+  EXPECT_TRUE(fixed);
+  std::vector<int32> values;
+  trie.LookUpPredictiveAll("", &values);
+  EXPECT_TRUE(values.empty());
+}
+
+// Checks that all the lookups return the same results as the ones of
+// base/trie.h for the given keys and queries.
+void ExpectSameAsTrie(const std::vector<string> &keys,
+                      const std::vector<string> &queries) {
+  Trie<int32> expected;
+  std::vector<DoubleArrayTrie::KeyValue> key_values;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    expected.AddEntry(keys[i], static_cast<int32>(i));
+    key_values.push_back(
+        DoubleArrayTrie::KeyValue(keys[i], static_cast<int32>(i)));
+  }
+  DoubleArrayTrie actual;
+  actual.Build(key_values);
+
+  for (size_t i = 0; i < queries.size(); ++i) {
+    const string &query = queries[i];
+    SCOPED_TRACE(query);
+    int32 expected_value = -1;
+    int32 actual_value = -1;
+    EXPECT_EQ(expected.LookUp(query, &expected_value),
+              actual.LookUp(query, &actual_value));
+    EXPECT_EQ(expected_value, actual_value);
+
+    size_t expected_length = 0;
+    size_t actual_length = 0;
+    bool expected_fixed = false;
+    bool actual_fixed = false;
+    expected_value = -1;
+    actual_value = -1;
+    EXPECT_EQ(expected.LookUpPrefix(query, &expected_value, &expected_length,
+                                    &expected_fixed),
+              actual.LookUpPrefix(query, &actual_value, &actual_length,
+                                  &actual_fixed));
+    EXPECT_EQ(expected_value, actual_value);
+    EXPECT_EQ(expected_length, actual_length);
+    EXPECT_EQ(expected_fixed, actual_fixed);
+
+    std::vector<int32> expected_values;
+    std::vector<int32> actual_values;
+    expected.LookUpPredictiveAll(query, &expected_values);
+    actual.LookUpPredictiveAll(query, &actual_values);
+    EXPECT_EQ(expected_values, actual_values);
+
+    if (!query.empty()) {
+      EXPECT_EQ(expected.HasSubTrie(query), actual.HasSubTrie(query));
+    }
+  }
+}
+
+TEST(DoubleArrayTrieTest, SameAsTrie) {
+  const char *kKeys[] = {
+    "a", "ka", "ki", "kya", "kyu", "n", "nn", "na", "tt", "t",
+    "\xE3\x81\x8B",  // "か"
+    "\xE3\x81\x8B\xE3\x82\x9B",  // "か゛"
+    "\xE3\x81\x8D",  // "き"
+    "\x0F" "a" "\x0E",
+    "\x0F" "a" "\x0E" "b",
+  };
+  const char *kQueries[] = {
+    "", "a", "ab", "k", "ka", "kaa", "ky", "kyo", "kyuu", "n", "nn", "nnn",
+    "nx", "t", "tt", "tta", "x",
+    "\xE3\x81\x8B",  // "か"
+    "\xE3\x81\x8B\xE3\x82\x9B",  // "か゛"
+    "\xE3\x81\x8B\xE3\x81\x8D",  // "かき"
+    "\xE3\x81\x8F",  // "く"
+    // The first byte is shared with "か" but the character is different.
+    "\xE3\x81",
+    "\x0F",
+    "\x0F" "a" "\x0E" "bc",
+  };
+  ExpectSameAsTrie(
+      std::vector<string>(kKeys, kKeys + arraysize(kKeys)),
+      std::vector<string>(kQueries, kQueries + arraysize(kQueries)));
+}
+
+TEST(DoubleArrayTrieTest, SameAsTrieWithManyKeys) {
+  std::vector<string> keys;
+  std::vector<string> queries;
+  const char kChars[] = "abkny";
+  for (size_t i = 0; i < 5; ++i) {
+    for (size_t j = 0; j < 5; ++j) {
+      for (size_t k = 0; k < 5; ++k) {
+        string key;
+        key += kChars[i];
+        key += kChars[j];
+        queries.push_back(key);
+        key += kChars[k];
+        queries.push_back(key);
+        if ((i + j + k) % 3 != 0) {
+          keys.push_back(key);
+        }
+        if ((i * j + k) % 4 == 0) {
+          keys.push_back(key.substr(0, 2));
+        }
+      }
+    }
+  }
+  ExpectSameAsTrie(keys, queries);
+}
+
+}  // namespace
+}  // namespace composer
+}  // namespace mozc
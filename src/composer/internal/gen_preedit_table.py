@@ -0,0 +1,91 @@
+# -*- coding: utf-8 -*-
+# Copyright 2010-2016, Google Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#
+#     * Redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above
+# copyright notice, this list of conditions and the following disclaimer
+# in the documentation and/or other materials provided with the
+# distribution.
+#     * Neither the name of Google Inc. nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Converts preedit table files to binary images for the data set.
+
+Usage:
+  $ gen_preedit_table.py --output_dir=out romanji-hiragana.tsv kana.tsv
+
+It generates out/preedit_romanji-hiragana.data and out/preedit_kana.data.
+
+Output file format:
+  SerializedStringArray (see base/serialized_string_array.h) of four strings
+  per rule: input, output, pending and attributes.  The columns are split in
+  the same way as composer::Table::LoadFromStream, and the escaped special
+  keys and attributes are stored as they are in the table file.
+"""
+
+import optparse
+import os
+
+from build_tools import serialized_string_array_builder
+
+
+def ParseArgs():
+  """Parses command line options and returns them."""
+  parser = optparse.OptionParser()
+  parser.add_option('--output_dir', dest='output_dir', default='.',
+                    help='Output directory.')
+  return parser.parse_args()
+
+
+def ReadRules(path):
+  """Returns the rules in the table file as a flat list of strings."""
+  strings = []
+  with open(path, 'rb') as f:
+    for line in f:
+      line = line.rstrip('\r\n')
+      if not line:
+        continue
+      columns = line.split('\t')
+      if len(columns) == 4:
+        strings.extend(columns)
+      elif len(columns) == 3:
+        strings.extend(columns + [''])
+      elif len(columns) == 2:
+        strings.extend(columns + ['', ''])
+      # Other lines, including comments, are ignored by Table as well.
+  return strings
+
+
+def GetOutputPath(output_dir, input_path):
+  name = os.path.splitext(os.path.basename(input_path))[0]
+  return os.path.join(output_dir, 'preedit_%s.data' % name)
+
+
+def main():
+  options, input_paths = ParseArgs()
+  for input_path in input_paths:
+    serialized_string_array_builder.SerializeToFile(
+        ReadRules(input_path), GetOutputPath(options.output_dir, input_path))
+
+
+if __name__ == '__main__':
+  main()
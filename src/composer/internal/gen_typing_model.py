@@ -37,9 +37,7 @@ Output file format:
   +----------------------------------------------------+
   | unique characters array size (4 bytes, uint32)     |
   +----------------------------------------------------+
-  | unique characters array (variable length, char[])  |
-  +----------------------------------------------------+
-  | padding (0 - 3 bytes)                              |
+  | character to radix table (256 bytes, uint8[])      |
   +----------------------------------------------------+
   | cost array size (4 bytes, uint32)                  |
   +----------------------------------------------------+
@@ -49,6 +47,10 @@ Output file format:
   +----------------------------------------------------+
   | mapping table (variable length, int32[])           |
   +----------------------------------------------------+
+
+The character to radix table maps each byte to its digit in
+GetIndexFromKey (0 for the bytes not in the model), so that the image can be
+used in place without building the table at runtime.
 """
 
 __author__ = "noriyukit"
@@ -97,6 +99,14 @@ def GetIndexFromKey(unique_characters, key):
   return index
 
 
+def GetRadixTable(unique_characters):
+  # The digit of each character in GetIndexFromKey.
+  radix_table = [0] * 256
+  for i, char in enumerate(unique_characters):
+    radix_table[ord(char)] = i + 1
+  return radix_table
+
+
 def GetMappingTable(values, mapping_table_size):
   """Creates mapping table.
 
@@ -167,14 +177,10 @@ def WriteResult(romaji_transition_cost, output_path):
                              romaji_transition_cost)
   with open(output_path, 'wb') as f:
     f.write(struct.pack('<I', len(unique_characters)))
-    f.write(''.join(unique_characters))
-    offset = 4 + len(unique_characters)
-
-    # Add padding to place value list size at 4-byte boundary.
-    if offset % 4:
-      padding_size = 4 - offset % 4
-      f.write('\x00' * padding_size)
-      offset += padding_size
+    for v in GetRadixTable(unique_characters):
+      f.write(struct.pack('<B', v))
+    # The radix table keeps value list size at 4-byte boundary.
+    offset = 4 + 256
 
     f.write(struct.pack('<I', len(value_list)))
     for v in value_list:
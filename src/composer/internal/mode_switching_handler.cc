@@ -35,6 +35,7 @@
 #include <cctype>
 #include <string>
 
+#include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/singleton.h"
 
@@ -99,5 +100,10 @@ ModeSwitchingHandler *ModeSwitchingHandler::GetModeSwitchingHandler() {
   return Singleton<ModeSwitchingHandler>::get();
 }
 
+namespace {
+const bool kModeSwitchingHandlerRegistered = SingletonInitializer::Register(
+    "ModeSwitchingHandler", &InitSingleton<ModeSwitchingHandler>);
+}  // namespace
+
 }  // namespace composer
 }  // namespace mozc
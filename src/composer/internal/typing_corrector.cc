@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -77,6 +78,10 @@ inline int Cost(double prob) {
   return static_cast<int>(-500.0 * log(prob));
 }
 
+bool IsMoreProbable(const ProbableKeyEvent *l, const ProbableKeyEvent *r) {
+  return l->probability() > r->probability();
+}
+
 }  // namespace
 
 
@@ -92,7 +97,9 @@ TypingCorrector::TypingCorrector(const Table *table,
     : table_(table),
       max_correction_query_candidates_(max_correction_query_candidates),
       max_correction_query_results_(max_correction_query_results),
-      config_(&config::ConfigHandler::DefaultConfig()) {
+      max_expansions_per_key_(std::numeric_limits<size_t>::max()),
+      config_(&config::ConfigHandler::DefaultConfig()),
+      queries_cached_(false) {
   Reset();
 }
 
@@ -102,6 +109,7 @@ void TypingCorrector::InsertCharacter(
     const StringPiece key,
     const ProbableKeyEvents &probable_key_events) {
   key.AppendToString(&raw_key_);
+  queries_cached_ = false;
   if (!IsAvailable() || probable_key_events.size() == 0) {
     // If this corrector is not available or no ProbableKeyEvent is available,
     // just append |key| to each corrections.
@@ -114,11 +122,26 @@ void TypingCorrector::InsertCharacter(
   // Approximation of dynamic programming to find N least cost key sequences.
   // At each insertion, generate all the possible paths from previous N least
   // key sequences, and keep only new N least key sequences.
+  // |top_n_| is sorted by the cost, and the events are visited from the most
+  // probable one, so that |max_expansions_per_key_| drops the paths which
+  // are least likely to survive.
+  std::vector<const ProbableKeyEvent *> events;
+  events.reserve(probable_key_events.size());
+  for (size_t j = 0; j < probable_key_events.size(); ++j) {
+    events.push_back(&probable_key_events.Get(j));
+  }
+  std::stable_sort(events.begin(), events.end(), IsMoreProbable);
+
+  const size_t num_expansions =
+      min(max_expansions_per_key_, top_n_.size() * events.size());
   std::vector<KeyAndPenalty> tmp;
-  tmp.reserve(top_n_.size() * probable_key_events.size());
-  for (size_t i = 0; i < top_n_.size(); ++i) {
-    for (size_t j = 0; j < probable_key_events.size(); ++j) {
-      const ProbableKeyEvent& event = probable_key_events.Get(j);
+  tmp.reserve(num_expansions);
+  size_t expansion_count = 0;
+  for (size_t i = 0; i < top_n_.size() && expansion_count < num_expansions;
+       ++i) {
+    for (size_t j = 0; j < events.size() && expansion_count < num_expansions;
+         ++j, ++expansion_count) {
+      const ProbableKeyEvent &event = *events[j];
       const string key_as_string(1, event.key_code());
       const int new_cost = top_n_[i].second + Cost(event.probability())
           + LookupModelCost(top_n_[i].first, key_as_string,
@@ -137,6 +160,7 @@ void TypingCorrector::InsertCharacter(
 }
 
 void TypingCorrector::Reset() {
+  queries_cached_ = false;
   raw_key_.clear();
   top_n_.clear();
   top_n_.push_back(KeyAndPenalty("", 0));
@@ -159,11 +183,14 @@ void TypingCorrector::CopyFrom(const TypingCorrector &src) {
   config_ = src.config_;
   max_correction_query_candidates_ = src.max_correction_query_candidates_;
   max_correction_query_results_ = src.max_correction_query_results_;
+  max_expansions_per_key_ = src.max_expansions_per_key_;
   top_n_ = src.top_n_;
+  queries_cached_ = false;
 }
 
 void TypingCorrector::SetTable(const Table *table) {
   table_ = table;
+  queries_cached_ = false;
 
   if (!raw_key_.empty()) {
     // If table is switched during the type-correcting, quit the typing
@@ -176,12 +203,27 @@ void TypingCorrector::SetConfig(const config::Config *config) {
   config_ = config;
 }
 
+void TypingCorrector::set_max_expansions_per_key(
+    size_t max_expansions_per_key) {
+  max_expansions_per_key_ = max_expansions_per_key;
+}
+
 void TypingCorrector::GetQueriesForPrediction(
     std::vector<TypeCorrectedQuery> *queries) const {
   queries->clear();
   if (!IsAvailable() || table_ == NULL || raw_key_.empty()) {
     return;
   }
+  if (!queries_cached_) {
+    GenerateQueriesForPrediction(&cached_queries_);
+    queries_cached_ = true;
+  }
+  *queries = cached_queries_;
+}
+
+void TypingCorrector::GenerateQueriesForPrediction(
+    std::vector<TypeCorrectedQuery> *queries) const {
+  queries->clear();
   // These objects are for cache. Used and reset repeatedly.
   Composition c(table_);
   CompositionInput input;
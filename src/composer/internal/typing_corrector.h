@@ -37,6 +37,7 @@
 #include "base/port.h"
 #include "base/protobuf/repeated_field.h"
 #include "base/string_piece.h"
+#include "composer/type_corrected_query.h"
 #include "protocol/config.pb.h"
 
 namespace mozc {
@@ -49,7 +50,6 @@ class KeyEvent_ProbableKeyEvent;
 namespace composer {
 
 class Table;
-struct TypeCorrectedQuery;
 
 typedef commands::KeyEvent_ProbableKeyEvent ProbableKeyEvent;
 typedef mozc::protobuf::RepeatedPtrField<ProbableKeyEvent> ProbableKeyEvents;
@@ -70,6 +70,12 @@ class TypingCorrector {
 
   void SetConfig(const config::Config *config);
 
+  // Limits the number of corrections expanded at each insertion, so that the
+  // cost of InsertCharacter doesn't depend on the number of probable key
+  // events.  The most probable expansions of the least cost corrections are
+  // tried first.  No limit by default.
+  void set_max_expansions_per_key(size_t max_expansions_per_key);
+
   // Resets this instance as a copy of |src|.
   void CopyFrom(const TypingCorrector &src);
 
@@ -90,7 +96,8 @@ class TypingCorrector {
   void InsertCharacter(const StringPiece key,
                        const ProbableKeyEvents &probable_key_events);
 
-  // Extracts type-corrected queries for prediction.
+  // Extracts type-corrected queries for prediction.  The queries are cached
+  // until the next insertion.
   void GetQueriesForPrediction(std::vector<TypeCorrectedQuery> *queries) const;
 
  private:
@@ -103,14 +110,22 @@ class TypingCorrector {
   // KeyAndPenalty, we need to define it in private member.
   struct KeyAndPenaltyLess;
 
+  void GenerateQueriesForPrediction(
+      std::vector<TypeCorrectedQuery> *queries) const;
+
   bool available_;
   const Table *table_;
   size_t max_correction_query_candidates_;
   size_t max_correction_query_results_;
+  size_t max_expansions_per_key_;
   const config::Config *config_;
   string raw_key_;
   std::vector<KeyAndPenalty> top_n_;
 
+  // The result of GenerateQueriesForPrediction() for the current |top_n_|.
+  mutable bool queries_cached_;
+  mutable std::vector<TypeCorrectedQuery> cached_queries_;
+
   DISALLOW_COPY_AND_ASSIGN(TypingCorrector);
 };
 
@@ -30,6 +30,7 @@
 #include "composer/internal/typing_corrector.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/singleton.h"
@@ -333,12 +334,18 @@ class TypingCorrectorTest : public ::testing::Test {
               r.max_correction_query_candidates_);
     EXPECT_EQ(l.max_correction_query_results_,
               r.max_correction_query_results_);
+    EXPECT_EQ(l.max_expansions_per_key_, r.max_expansions_per_key_);
     EXPECT_EQ(l.top_n_.size(), r.top_n_.size());
     for (size_t i = 0; i < l.top_n_.size(); ++i) {
       EXPECT_EQ(l.top_n_[i], l.top_n_[i]);
     }
   }
 
+  static const std::vector<std::pair<string, int>> &GetTopN(
+      const TypingCorrector &corrector) {
+    return corrector.top_n_;
+  }
+
   const testing::MockDataManager mock_data_manager_;
   Config config_;
   Table qwerty_table_;
@@ -440,6 +447,53 @@ TEST_F(TypingCorrectorTest, TypingCorrection) {
   }
 }
 
+TEST_F(TypingCorrectorTest, MaxExpansionsPerKey) {
+  TypingCorrector corrector(&qwerty_table_, 1000, 1000);
+  corrector.SetConfig(&config_);
+  corrector.set_max_expansions_per_key(3);
+  InsertOneByOne("phayou", &corrector);
+
+  // Each insertion expands only the three most probable keys of the least
+  // cost correction.
+  const std::vector<std::pair<string, int>> &top_n = GetTopN(corrector);
+  EXPECT_GE(3, top_n.size());
+  ASSERT_FALSE(top_n.empty());
+  for (size_t i = 1; i < top_n.size(); ++i) {
+    EXPECT_LE(top_n[i - 1].second, top_n[i].second);
+  }
+
+  TypingCorrector unlimited(&qwerty_table_, 1000, 1000);
+  unlimited.SetConfig(&config_);
+  InsertOneByOne("phayou", &unlimited);
+  EXPECT_LT(top_n.size(), GetTopN(unlimited).size());
+}
+
+TEST_F(TypingCorrectorTest, QueriesAreCachedUntilInsertion) {
+  TypingCorrector corrector(&qwerty_table_, 30, 30);
+  corrector.SetConfig(&config_);
+  InsertOneByOne("phayo", &corrector);
+
+  std::vector<TypeCorrectedQuery> queries1, queries2;
+  corrector.GetQueriesForPrediction(&queries1);
+  corrector.GetQueriesForPrediction(&queries2);
+  ASSERT_EQ(queries1.size(), queries2.size());
+  for (size_t i = 0; i < queries1.size(); ++i) {
+    EXPECT_EQ(queries1[i].base, queries2[i].base);
+    EXPECT_EQ(queries1[i].expanded, queries2[i].expanded);
+    EXPECT_EQ(queries1[i].cost, queries2[i].cost);
+  }
+
+  InsertOneByOne("u", &corrector);
+  corrector.GetQueriesForPrediction(&queries2);
+  // "おはよう"
+  EXPECT_TRUE(FindKey(queries2,
+                      "\xE3\x81\x8A\xE3\x81\xAF\xE3\x82\x88\xE3\x81\x86"));
+
+  corrector.Reset();
+  corrector.GetQueriesForPrediction(&queries2);
+  EXPECT_TRUE(queries2.empty());
+}
+
 TEST_F(TypingCorrectorTest, Invalidate) {
   const CostTableForTest *table = Singleton<CostTableForTest>::get();
 
@@ -32,30 +32,33 @@
 #include <limits>
 #include <memory>
 
+#include "base/logging.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 
 namespace mozc {
 namespace composer {
 
+namespace {
+
+// The size of the character to radix table in the binary image.
+const size_t kRadixTableSize = 256;
+
+}  // namespace
+
 const uint8 TypingModel::kNoData = std::numeric_limits<uint8>::max();
 const int TypingModel::kInfinity = (2 << 20);  // approximately equals 1e+6
 
-TypingModel::TypingModel(const char *characters,
+TypingModel::TypingModel(const uint8 *character_to_radix_table,
                          size_t characters_size,
                          const uint8 *cost_table,
                          size_t cost_table_size,
                          const int32 *mapping_table) :
-    character_to_radix_table_(
-        new unsigned char[std::numeric_limits<unsigned char>::max()]),
+    character_to_radix_table_(character_to_radix_table),
     characters_size_(characters_size),
     cost_table_(cost_table),
     cost_table_size_(cost_table_size),
-    mapping_table_(mapping_table) {
-  for (size_t i = 0; i < characters_size; ++i) {
-    character_to_radix_table_[characters[i]] = i + 1;
-  }
-}
+    mapping_table_(mapping_table) {}
 
 TypingModel::~TypingModel() = default;
 
@@ -72,7 +75,8 @@ size_t TypingModel::GetIndex(StringPiece key) const {
   const unsigned int radix = characters_size_ + 1;
   size_t index = 0;
   for (size_t i = 0; i < key.length(); ++i) {
-    index = index * radix + character_to_radix_table_[key[i]];
+    index = index * radix +
+        character_to_radix_table_[static_cast<uint8>(key[i])];
   }
   return index;
 }
@@ -107,15 +111,19 @@ std::unique_ptr<const TypingModel> TypingModel::CreateTypingModel(
     return nullptr;
   }
   // Parse the binary image of typing model.  See gen_typing_model.py for file
-  // format.
+  // format.  All the tables are used in place.
+  const size_t kMappingTableSize =
+      (std::numeric_limits<uint8>::max() + 1) * sizeof(int32);
+  size_t offset = 4 + kRadixTableSize;
+  if (data.size() < offset + 4) {
+    LOG(ERROR) << "Broken typing model: " << key;
+    return nullptr;
+  }
   const uint32 characters_size =
       *reinterpret_cast<const uint32*>(data.data());
-  const char *characters = data.data() + 4;
+  const uint8 *character_to_radix_table =
+      reinterpret_cast<const uint8*>(data.data() + 4);
 
-  size_t offset = 4 + characters_size;
-  if (offset % 4 != 0) {
-    offset += 4 - offset % 4;
-  }
   const uint32 cost_table_size =
       *reinterpret_cast<const uint32*>(data.data() + offset);
   const uint8 *cost_table =
@@ -125,12 +133,16 @@ std::unique_ptr<const TypingModel> TypingModel::CreateTypingModel(
   if (offset % 4 != 0) {
     offset += 4 - offset % 4;
   }
+  if (data.size() < offset + kMappingTableSize) {
+    LOG(ERROR) << "Broken typing model: " << key;
+    return nullptr;
+  }
   const int32 *mapping_table =
       reinterpret_cast<const int32*>(data.data() + offset);
 
   return std::unique_ptr<const TypingModel>(
-      new TypingModel(characters, characters_size, cost_table, cost_table_size,
-                      mapping_table));
+      new TypingModel(character_to_radix_table, characters_size, cost_table,
+                      cost_table_size, mapping_table));
 }
 
 }  // namespace composer
@@ -48,9 +48,13 @@ namespace composer {
 // and returns cost value.
 // The key-value data source should be provided via the constructor.
 // Typically the constructor taks data generated by gen_typing_model.py.
+// None of the tables are copied, so the model created from the data set
+// refers to the mapped image in place.
 class TypingModel {
  public:
-  TypingModel(const char *characters, size_t characters_size,
+  // |character_to_radix_table| has 256 entries and maps each byte of a key
+  // to its digit, 1 to |characters_size|, or 0 for the unknown bytes.
+  TypingModel(const uint8 *character_to_radix_table, size_t characters_size,
               const uint8 *cost_table, size_t cost_table_size,
               const int32 *mapping_table);
 
@@ -84,7 +88,7 @@ class TypingModel {
   size_t GetIndex(StringPiece key) const;
 
   // Radix table, needed by GetIndex.
-  std::unique_ptr<unsigned char[]> character_to_radix_table_;
+  const uint8 *character_to_radix_table_;
   const size_t characters_size_;
   const uint8 *cost_table_;
   const size_t cost_table_size_;
@@ -29,12 +29,22 @@
 
 #include "composer/internal/typing_model.h"
 
+#include <cstring>
+
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
 namespace composer {
 
 class TypingModelTest : public ::testing::Test {
+ protected:
+  // Builds the radix table for |characters| as gen_typing_model.py does.
+  static void BuildRadixTable(const char *characters, uint8 *radix_table) {
+    memset(radix_table, 0, 256);
+    for (size_t i = 0; characters[i] != '\0'; ++i) {
+      radix_table[static_cast<uint8>(characters[i])] = i + 1;
+    }
+  }
 };
 
 TEST_F(TypingModelTest, Constructor) {
@@ -42,12 +52,18 @@ TEST_F(TypingModelTest, Constructor) {
   const uint8 costs[] = {
     0, 1, 2, 3, 4, 5, 6,
   };
-  TypingModel model(characters, strlen(characters), costs, arraysize(costs), NULL);
-  model.character_to_radix_table_['a'] = 1;
-  model.character_to_radix_table_['b'] = 2;
-  model.character_to_radix_table_['c'] = 3;
-  model.character_to_radix_table_['d'] = 4;
-  model.character_to_radix_table_['Z'] = 0;
+  uint8 radix_table[256];
+  BuildRadixTable(characters, radix_table);
+  TypingModel model(radix_table, strlen(characters), costs, arraysize(costs),
+                    NULL);
+  // The table is referred in place.
+  EXPECT_EQ(radix_table, model.character_to_radix_table_);
+  EXPECT_EQ(1, model.character_to_radix_table_['a']);
+  EXPECT_EQ(2, model.character_to_radix_table_['b']);
+  EXPECT_EQ(3, model.character_to_radix_table_['c']);
+  EXPECT_EQ(4, model.character_to_radix_table_['d']);
+  EXPECT_EQ(0, model.character_to_radix_table_['Z']);
+  EXPECT_EQ(0, model.character_to_radix_table_[0xFF]);
 }
 
 TEST_F(TypingModelTest, GetIndex) {
@@ -55,7 +71,10 @@ TEST_F(TypingModelTest, GetIndex) {
   const uint8 costs[] = {
     0, 1, 2, 3, 4, 5, 6,
   };
-  TypingModel model(characters, strlen(characters), costs, arraysize(costs), NULL);
+  uint8 radix_table[256];
+  BuildRadixTable(characters, radix_table);
+  TypingModel model(radix_table, strlen(characters), costs, arraysize(costs),
+                    NULL);
   ASSERT_EQ(0, model.GetIndex(""));
   ASSERT_EQ(1, model.GetIndex("a"));
   ASSERT_EQ(4, model.GetIndex("d"));
@@ -43,8 +43,10 @@
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/serialized_string_array.h"
 #include "base/trie.h"
 #include "base/util.h"
+#include "composer/internal/double_array_trie.h"
 #include "composer/internal/typing_model.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -81,6 +83,10 @@ const char kNotouchHiraganaTableFile[] = "system://notouch-hiragana.tsv";
 const char kNotouchHalfwidthasciiTableFile[]
     = "system://qwerty_mobile-halfwidthascii.tsv";
 
+const char kSystemPrefix[] = "system://";
+// Precompiled tables in the data set are named "preedit_<file name>".
+const char kPreeditTablePrefix[] = "preedit_";
+
 const char kNewChunkPrefix[] = "\t";
 const char kSpecialKeyOpen[] = "\x0F";  // Shift-In of ASCII
 const char kSpecialKeyClose[] = "\x0E";  // Shift-Out of ASCII
@@ -174,7 +180,8 @@ bool Table::InitializeWithRequestAndConfig(
       default:
         table_file_name = NULL;
     }
-    if (table_file_name && LoadFromFile(table_file_name)) {
+    if (table_file_name && LoadSystemTable(table_file_name, data_manager)) {
+      CompileEntries();
       return true;
     }
   }
@@ -183,10 +190,10 @@ bool Table::InitializeWithRequestAndConfig(
       result = (config.has_custom_roman_table() &&
                 !config.custom_roman_table().empty()) ?
           LoadFromString(config.custom_roman_table()) :
-          LoadFromFile(kRomajiPreeditTableFile);
+          LoadSystemTable(kRomajiPreeditTableFile, data_manager);
       break;
     case config::Config::KANA:
-      result = LoadFromFile(kRomajiPreeditTableFile);
+      result = LoadSystemTable(kRomajiPreeditTableFile, data_manager);
       break;
     default:
       LOG(ERROR) << "Unkonwn preedit method: " << config.preedit_method();
@@ -194,7 +201,7 @@ bool Table::InitializeWithRequestAndConfig(
   }
 
   if (!result) {
-    result = LoadFromFile(kDefaultPreeditTableFile);
+    result = LoadSystemTable(kDefaultPreeditTableFile, data_manager);
     if (!result) {
       return false;
     }
@@ -272,7 +279,10 @@ bool Table::InitializeWithRequestAndConfig(
   CHECK(result);
 
   // Load Kana combination rules.
-  result = LoadFromFile(kKanaCombinationTableFile);
+  result = LoadSystemTable(kKanaCombinationTableFile, data_manager);
+  if (result) {
+    CompileEntries();
+  }
   return result;
 }
 
@@ -338,6 +348,7 @@ const Entry *Table::AddRuleWithAttributes(const string &escaped_input,
     return NULL;
   }
 
+  compiled_entries_.reset();
   const Entry *old_entry = NULL;
   if (entries_->LookUp(input, &old_entry)) {
     DeleteEntry(old_entry);
@@ -371,6 +382,7 @@ void Table::DeleteRule(const string &input) {
   //     - This method is not used.
   //     - This method has no tests.
   //     - This method is private scope.
+  compiled_entries_.reset();
   const Entry *old_entry;
   if (entries_->LookUp(input, &old_entry)) {
     DeleteEntry(old_entry);
@@ -391,10 +403,6 @@ bool Table::LoadFromFile(const char *filepath) {
   return LoadFromStream(ifs.get());
 }
 
-const TypingModel* Table::typing_model() const {
-  return typing_model_.get();
-}
-
 namespace {
 const char kAttributeDelimiter[] = " ";
 
@@ -419,6 +427,37 @@ TableAttributes ParseAttributes(const string &input) {
 }
 }  // namespace
 
+bool Table::LoadFromSerializedArray(StringPiece data) {
+  SerializedStringArray rules;
+  if (!rules.Init(data) || rules.size() % 4 != 0) {
+    LOG(ERROR) << "Broken preedit table";
+    return false;
+  }
+  for (size_t i = 0; i < rules.size(); i += 4) {
+    AddRuleWithAttributes(rules[i].as_string(), rules[i + 1].as_string(),
+                          rules[i + 2].as_string(),
+                          ParseAttributes(rules[i + 3].as_string()));
+  }
+  return true;
+}
+
+bool Table::LoadSystemTable(const char *filepath,
+                            const DataManagerInterface &data_manager) {
+  DCHECK(Util::StartsWith(filepath, kSystemPrefix));
+  const string name =
+      kPreeditTablePrefix + string(filepath + arraysize(kSystemPrefix) - 1);
+  const StringPiece data = data_manager.GetPreeditTable(name);
+  if (!data.empty()) {
+    return LoadFromSerializedArray(data);
+  }
+  return LoadFromFile(filepath);
+}
+
+const TypingModel* Table::typing_model() const {
+  return typing_model_.get();
+}
+
+
 bool Table::LoadFromStream(std::istream *is) {
   DCHECK(is);
   string line;
@@ -451,13 +490,20 @@ bool Table::LoadFromStream(std::istream *is) {
 }
 
 const Entry *Table::LookUp(const string &input) const {
+  string normalized_input;
+  if (!case_sensitive_) {
+    normalized_input = input;
+    Util::LowerString(&normalized_input);
+  }
+  const string &key = case_sensitive_ ? input : normalized_input;
   const Entry *entry = NULL;
-  if (case_sensitive_) {
-    entries_->LookUp(input, &entry);
+  if (compiled_entries_) {
+    int32 index = 0;
+    if (compiled_entries_->LookUp(key, &index)) {
+      entry = compiled_entry_list_[index];
+    }
   } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUp(normalized_input, &entry);
+    entries_->LookUp(key, &entry);
   }
   return entry;
 }
@@ -465,25 +511,40 @@ const Entry *Table::LookUp(const string &input) const {
 const Entry *Table::LookUpPrefix(const string &input,
                                  size_t *key_length,
                                  bool *fixed) const {
+  string normalized_input;
+  if (!case_sensitive_) {
+    normalized_input = input;
+    Util::LowerString(&normalized_input);
+  }
+  const string &key = case_sensitive_ ? input : normalized_input;
   const Entry *entry = NULL;
-  if (case_sensitive_) {
-    entries_->LookUpPrefix(input, &entry, key_length, fixed);
+  if (compiled_entries_) {
+    int32 index = 0;
+    if (compiled_entries_->LookUpPrefix(key, &index, key_length, fixed)) {
+      entry = compiled_entry_list_[index];
+    }
   } else {
-    string normalized_input = input;
-    Util::LowerString(&normalized_input);
-    entries_->LookUpPrefix(normalized_input, &entry, key_length, fixed);
+    entries_->LookUpPrefix(key, &entry, key_length, fixed);
   }
   return entry;
 }
 
 void Table::LookUpPredictiveAll(const string &input,
                                 std::vector<const Entry *> *results) const {
-  if (case_sensitive_) {
-    entries_->LookUpPredictiveAll(input, results);
-  } else {
-    string normalized_input = input;
+  string normalized_input;
+  if (!case_sensitive_) {
+    normalized_input = input;
     Util::LowerString(&normalized_input);
-    entries_->LookUpPredictiveAll(normalized_input, results);
+  }
+  const string &key = case_sensitive_ ? input : normalized_input;
+  if (compiled_entries_) {
+    std::vector<int32> indices;
+    compiled_entries_->LookUpPredictiveAll(key, &indices);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      results->push_back(compiled_entry_list_[indices[i]]);
+    }
+  } else {
+    entries_->LookUpPredictiveAll(key, results);
   }
 }
 
@@ -504,13 +565,16 @@ bool Table::HasNewChunkEntry(const string &input) const {
 }
 
 bool Table::HasSubRules(const string &input) const {
-  if (case_sensitive_) {
-    return entries_->HasSubTrie(input);
-  } else {
-    string normalized_input = input;
+  string normalized_input;
+  if (!case_sensitive_) {
+    normalized_input = input;
     Util::LowerString(&normalized_input);
-    return entries_->HasSubTrie(normalized_input);
   }
+  const string &key = case_sensitive_ ? input : normalized_input;
+  if (compiled_entries_) {
+    return compiled_entries_->HasSubTrie(key);
+  }
+  return entries_->HasSubTrie(key);
 }
 
 void Table::DeleteEntry(const Entry *entry) {
@@ -526,6 +590,19 @@ void Table::ResetEntrySet() {
   entry_set_.clear();
 }
 
+void Table::CompileEntries() {
+  // |entry_set_| holds exactly the entries registered in |entries_|.
+  compiled_entry_list_.assign(entry_set_.begin(), entry_set_.end());
+  std::vector<DoubleArrayTrie::KeyValue> key_values;
+  key_values.reserve(compiled_entry_list_.size());
+  for (size_t i = 0; i < compiled_entry_list_.size(); ++i) {
+    key_values.push_back(DoubleArrayTrie::KeyValue(
+        compiled_entry_list_[i]->input(), static_cast<int32>(i)));
+  }
+  compiled_entries_.reset(new DoubleArrayTrie);
+  compiled_entries_->Build(key_values);
+}
+
 bool Table::case_sensitive() const {
   return case_sensitive_;
 }
@@ -39,6 +39,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "base/trie.h"
 #include "data_manager/data_manager_interface.h"
 
@@ -56,6 +57,7 @@ class Config;
 }  // namespace config
 namespace composer {
 
+class DoubleArrayTrie;
 class TypingModel;
 
 // This is a bitmap representing Entry's additional attributes.
@@ -121,6 +123,8 @@ class Table {
 
   bool LoadFromString(const string &str);
   bool LoadFromFile(const char *filepath);
+  // Loads a table precompiled by gen_preedit_table.py.
+  bool LoadFromSerializedArray(StringPiece data);
 
   const Entry *LookUp(const string &input) const;
   const Entry *LookUpPrefix(const string &input,
@@ -152,11 +156,23 @@ class Table {
   friend class TypingCorrectionTest;
 
   bool LoadFromStream(std::istream *is);
+  // Loads the system:// table file, using the precompiled one in the data
+  // set if available.
+  bool LoadSystemTable(const char *filepath,
+                       const DataManagerInterface &data_manager);
   void DeleteEntry(const Entry *entry);
   void ResetEntrySet();
+  // Compiles the current rules into |compiled_entries_|.  Called when the
+  // table is initialized, and discarded when the rules are modified.
+  void CompileEntries();
 
   typedef Trie<const Entry*> EntryTrie;
   std::unique_ptr<EntryTrie> entries_;
+  // Read-only copy of |entries_| for fast lookups.  nullptr if not compiled
+  // or the rules are modified after the compilation.  The values are the
+  // indices of |compiled_entry_list_|.
+  std::unique_ptr<DoubleArrayTrie> compiled_entries_;
+  std::vector<const Entry *> compiled_entry_list_;
   typedef std::set<const Entry*> EntrySet;
   EntrySet entry_set_;
 
@@ -29,8 +29,13 @@
 
 #include "composer/table.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "base/file_util.h"
 #include "base/port.h"
+#include "base/serialized_string_array.h"
 #include "base/system_util.h"
 #include "composer/internal/composition_input.h"
 #include "config/config_handler.h"
@@ -276,6 +281,121 @@ TEST_F(TableTest, KanaCombination) {
   EXPECT_TRUE(entry->pending().empty());
 }
 
+TEST_F(TableTest, LoadFromSerializedArray) {
+  std::vector<StringPiece> rules;
+  // "あ"
+  rules.push_back("a");
+  rules.push_back("\xE3\x81\x82");
+  rules.push_back("");
+  rules.push_back("");
+  // "っ"
+  rules.push_back("tt");
+  rules.push_back("\xE3\x81\xA3");
+  rules.push_back("t");
+  rules.push_back("");
+  rules.push_back("{!}x");
+  rules.push_back("");
+  rules.push_back("");
+  rules.push_back("NoTransliteration");
+  std::unique_ptr<uint32[]> buffer;
+  const StringPiece data =
+      SerializedStringArray::SerializeToBuffer(rules, &buffer);
+
+  Table table;
+  ASSERT_TRUE(table.LoadFromSerializedArray(data));
+  const Entry *entry = table.LookUp("a");
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("\xE3\x81\x82", entry->result());
+  EXPECT_EQ(NO_TABLE_ATTRIBUTE, entry->attributes());
+  entry = table.LookUp("tt");
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("t", entry->pending());
+  // The special key is parsed as the rule in the table file.
+  entry = table.LookUp(Table::ParseSpecialKey("{!}x"));
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ(NO_TRANSLITERATION, entry->attributes());
+
+  // The number of the strings must be a multiple of four.
+  rules.pop_back();
+  const StringPiece broken_data =
+      SerializedStringArray::SerializeToBuffer(rules, &buffer);
+  Table broken_table;
+  EXPECT_FALSE(broken_table.LoadFromSerializedArray(broken_data));
+}
+
+TEST_F(TableTest, PrecompiledTablesAreSameAsFiles) {
+  const char *kTables[] = {
+    "romanji-hiragana.tsv",
+    "kana.tsv",
+    "12keys-hiragana.tsv",
+    "flick-hiragana.tsv",
+    "toggle_flick-hiragana.tsv",
+    "qwerty_mobile-hiragana.tsv",
+    "godan-hiragana.tsv",
+    "notouch-hiragana.tsv",
+  };
+  for (size_t i = 0; i < arraysize(kTables); ++i) {
+    SCOPED_TRACE(kTables[i]);
+    const StringPiece data =
+        mock_data_manager_.GetPreeditTable(string("preedit_") + kTables[i]);
+    ASSERT_FALSE(data.empty());
+    Table precompiled;
+    ASSERT_TRUE(precompiled.LoadFromSerializedArray(data));
+    Table expected;
+    ASSERT_TRUE(
+        expected.LoadFromFile((string("system://") + kTables[i]).c_str()));
+
+    std::vector<const Entry *> expected_entries;
+    std::vector<const Entry *> actual_entries;
+    expected.LookUpPredictiveAll("", &expected_entries);
+    precompiled.LookUpPredictiveAll("", &actual_entries);
+    ASSERT_EQ(expected_entries.size(), actual_entries.size());
+    for (size_t j = 0; j < expected_entries.size(); ++j) {
+      EXPECT_EQ(expected_entries[j]->input(), actual_entries[j]->input());
+      EXPECT_EQ(expected_entries[j]->result(), actual_entries[j]->result());
+      EXPECT_EQ(expected_entries[j]->pending(), actual_entries[j]->pending());
+      EXPECT_EQ(expected_entries[j]->attributes(),
+                actual_entries[j]->attributes());
+    }
+  }
+  EXPECT_TRUE(mock_data_manager_.GetPreeditTable("preedit_unknown.tsv")
+              .empty());
+}
+
+TEST_F(TableTest, AddRuleAfterInitialization) {
+  Table table;
+  commands::Request request;
+  ASSERT_TRUE(table.InitializeWithRequestAndConfig(request, config_,
+                                                   mock_data_manager_));
+  size_t key_length = 0;
+  bool fixed = false;
+  const Entry *entry = table.LookUpPrefix("ka", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ(2, key_length);
+  EXPECT_TRUE(fixed);
+
+  // Rules added after the initialization are also looked up.
+  table.AddRule("kaz", "xyz", "");
+  entry = table.LookUpPrefix("kaz", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ("xyz", entry->result());
+  EXPECT_EQ(3, key_length);
+  EXPECT_TRUE(fixed);
+  entry = table.LookUpPrefix("ka", &key_length, &fixed);
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ(2, key_length);
+  EXPECT_FALSE(fixed);
+  EXPECT_TRUE(table.HasSubRules("kaz"));
+
+  // The table can be initialized again.
+  ASSERT_TRUE(table.InitializeWithRequestAndConfig(request, config_,
+                                                   mock_data_manager_));
+  entry = table.LookUp("ka");
+  ASSERT_TRUE(entry != NULL);
+  // "か"
+  EXPECT_EQ("\xE3\x81\x8B", entry->result());
+}
+
 TEST_F(TableTest, InvalidEntryTest) {
   {
     Table table;
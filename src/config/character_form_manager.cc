@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "base/config_file_stream.h"
+#include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
@@ -586,10 +587,15 @@ CharacterFormManager *CharacterFormManager::GetCharacterFormManager() {
   return Singleton<CharacterFormManager>::get();
 }
 
+namespace {
+// Opening the LRU storage is left to the startup rather than the first
+// conversion.
+const bool kCharacterFormManagerRegistered = SingletonInitializer::Register(
+    "CharacterFormManager", &InitSingleton<CharacterFormManager>);
+}  // namespace
+
 CharacterFormManager::CharacterFormManager() : data_(new Data) {
-  Config config;
-  ConfigHandler::GetConfig(&config);
-  ReloadConfig(config);
+  ReloadConfig(*ConfigHandler::GetSharedConfig());
 }
 
 CharacterFormManager::~CharacterFormManager() {
@@ -33,6 +33,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <utility>
 
 #include "base/clock.h"
 #include "base/config_file_stream.h"
@@ -87,6 +88,7 @@ class ConfigHandlerImpl {
   }
   virtual ~ConfigHandlerImpl() {}
   bool GetConfig(Config *config) const;
+  std::shared_ptr<const Config> GetSharedConfig() const;
   const Config &DefaultConfig() const;
   bool GetStoredConfig(Config *config) const;
   bool SetConfig(const Config &config);
@@ -104,10 +106,12 @@ class ConfigHandlerImpl {
   string filename_;
   Config stored_config_;
   Config imposed_config_;
-  // equals to config_.MergeFrom(imposed_config_)
-  Config merged_config_;
   Config default_config_;
   mutable Mutex mutex_;
+  // equals to stored_config_.MergeFrom(imposed_config_).  Guarded by its own
+  // lock so that the readers don't wait for SetConfig() writing the file.
+  std::shared_ptr<const Config> merged_config_;
+  mutable Mutex merged_config_mutex_;
 };
 
 ConfigHandlerImpl *GetConfigHandlerImpl() {
@@ -116,11 +120,15 @@ ConfigHandlerImpl *GetConfigHandlerImpl() {
 
 // return current Config
 bool ConfigHandlerImpl::GetConfig(Config *config) const {
-  scoped_lock lock(&mutex_);
-  config->CopyFrom(merged_config_);
+  config->CopyFrom(*GetSharedConfig());
   return true;
 }
 
+std::shared_ptr<const Config> ConfigHandlerImpl::GetSharedConfig() const {
+  scoped_lock lock(&merged_config_mutex_);
+  return merged_config_;
+}
+
 const Config &ConfigHandlerImpl::DefaultConfig() const {
   return default_config_;
 }
@@ -167,8 +175,16 @@ bool ConfigHandlerImpl::SetConfigInternal(const Config &config) {
 }
 
 void ConfigHandlerImpl::UpdateMergedConfig() {
-  merged_config_.CopyFrom(stored_config_);
-  merged_config_.MergeFrom(imposed_config_);
+  std::shared_ptr<Config> merged_config = std::make_shared<Config>();
+  merged_config->CopyFrom(stored_config_);
+  merged_config->MergeFrom(imposed_config_);
+  // The old snapshot is deleted out of the lock by the last holder.
+  std::shared_ptr<const Config> old_config;
+  {
+    scoped_lock lock(&merged_config_mutex_);
+    old_config.swap(merged_config_);
+    merged_config_ = std::move(merged_config);
+  }
 }
 
 bool ConfigHandlerImpl::SetConfig(const Config &config) {
@@ -248,6 +264,10 @@ bool ConfigHandler::GetConfig(Config *config) {
   return GetConfigHandlerImpl()->GetConfig(config);
 }
 
+std::shared_ptr<const Config> ConfigHandler::GetSharedConfig() {
+  return GetConfigHandlerImpl()->GetSharedConfig();
+}
+
 // Returns Stored Config
 bool ConfigHandler::GetStoredConfig(Config *config) {
   return GetConfigHandlerImpl()->GetStoredConfig(config);
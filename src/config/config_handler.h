@@ -32,6 +32,7 @@
 #ifndef MOZC_CONFIG_CONFIG_HANDLER_H_
 #define MOZC_CONFIG_CONFIG_HANDLER_H_
 
+#include <memory>
 #include <string>
 
 #include "base/port.h"
@@ -50,6 +51,12 @@ class ConfigHandler {
   // Returns current config.
   static bool GetConfig(Config *config);
 
+  // Returns current config without copying it.  The returned snapshot is
+  // never modified; SetConfig(), SetImposedConfig() and Reload() replace it
+  // with a new one, so it can be held and read without a lock.  The same
+  // pointer is returned until the config is replaced.
+  static std::shared_ptr<const Config> GetSharedConfig();
+
   // Returns stored config.
   // If imposed config is not set, the result is the same as GetConfig().
   static bool GetStoredConfig(Config *config);
@@ -34,6 +34,7 @@
 #endif  // OS_WIN
 
 #include <atomic>
+#include <memory>
 #include <string>
 #include <unordered_set>
 
@@ -359,6 +360,38 @@ TEST_F(ConfigHandlerTest, DefaultConfig) {
             ConfigHandler::DefaultConfig().DebugString());
 }
 
+TEST_F(ConfigHandlerTest, GetSharedConfig) {
+  const string config_file = FileUtil::JoinPath(FLAGS_test_tmpdir,
+                                                "mozc_config_test_tmp");
+  FileUtil::Unlink(config_file);
+  ScopedSetConfigFileName scoped_config_file_name(config_file);
+
+  Config input;
+  ConfigHandler::GetDefaultConfig(&input);
+  input.set_incognito_mode(true);
+  ASSERT_TRUE(ConfigHandler::SetConfig(input));
+
+  // The snapshot is shared until the config is replaced.
+  const std::shared_ptr<const Config> config =
+      ConfigHandler::GetSharedConfig();
+  ASSERT_NE(nullptr, config);
+  EXPECT_TRUE(config->incognito_mode());
+  EXPECT_EQ(config, ConfigHandler::GetSharedConfig());
+
+  // The held snapshot is not modified by the update.
+  input.set_incognito_mode(false);
+  ASSERT_TRUE(ConfigHandler::SetConfig(input));
+  EXPECT_TRUE(config->incognito_mode());
+  const std::shared_ptr<const Config> new_config =
+      ConfigHandler::GetSharedConfig();
+  EXPECT_NE(config, new_config);
+  EXPECT_FALSE(new_config->incognito_mode());
+
+  Config output;
+  EXPECT_TRUE(ConfigHandler::GetConfig(&output));
+  EXPECT_EQ(new_config->SerializeAsString(), output.SerializeAsString());
+}
+
 class SetConfigThread final : public Thread {
  public:
   explicit SetConfigThread(const std::vector<Config> &configs)
@@ -414,6 +447,12 @@ class GetConfigThread final : public Thread {
       const auto &rules = ExtractCharacterFormRules(config);
       EXPECT_NE(character_form_rules_set_.end(),
                 character_form_rules_set_.find(rules));
+      // The snapshot is consistent while the config is being replaced.
+      const std::shared_ptr<const Config> shared_config =
+          ConfigHandler::GetSharedConfig();
+      EXPECT_NE(character_form_rules_set_.end(),
+                character_form_rules_set_.find(
+                    ExtractCharacterFormRules(*shared_config)));
     }
   }
 
@@ -0,0 +1,58 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_CONVERTER_BOUNDARY_CONSTRAINT_INTERFACE_H_
+#define MOZC_CONVERTER_BOUNDARY_CONSTRAINT_INTERFACE_H_
+
+namespace mozc {
+
+class ConversionRequest;
+class Segments;
+
+// Constrains the segment boundaries of a conversion before
+// ImmutableConverterImpl makes the candidates, e.g., with the boundaries
+// learned from the user.
+class BoundaryConstraintInterface {
+ public:
+  virtual ~BoundaryConstraintInterface() {}
+
+  // Called with the conversion segments of the best path of the first
+  // Viterbi pass of a conversion which is not resized yet.  The segments have
+  // the keys but no candidates.  Returns true after resizing some of them,
+  // in which case the conversion is done again with the new boundaries.
+  virtual bool ConstrainBoundaries(const ConversionRequest &request,
+                                   Segments *segments) const = 0;
+
+ protected:
+  BoundaryConstraintInterface() {}
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_BOUNDARY_CONSTRAINT_INTERFACE_H_
@@ -37,6 +37,7 @@
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/util.h"
@@ -57,6 +58,18 @@ const size_t kSizeThresholdForWeakCompound = 10;
 
 const size_t kMaxCandidatesSize = 200;   // how many candidates we expand
 
+// The initial size of the fingerprint table of seen values.  It must be a
+// power of 2, and large enough to keep the load factor at most 1/2 up to
+// kMaxCandidatesSize so that the table is never grown in conversion (only
+// reverse conversion has no limit on the number of candidates).
+const size_t kSeenTableSize = 512;
+
+uint64 GetSeenFingerprint(const string &value) {
+  const uint64 fp = Hash::Fingerprint(value);
+  // 0 is reserved for empty slots.
+  return fp == 0 ? 1 : fp;
+}
+
 // Currently, the cost (logprob) is calcurated as cost = -500 * log(prob).
 // Suppose having two candidates A and B and prob(A) = C * prob(B), where
 // C = 1000 (some constant variable). The word "A" appears 1000 times more
@@ -171,6 +184,8 @@ CandidateFilter::CandidateFilter(
     : suppression_dictionary_(suppression_dictionary),
       pos_matcher_(pos_matcher),
       suggestion_filter_(suggestion_filter),
+      seen_(kSeenTableSize, 0),
+      seen_size_(0),
       top_candidate_(nullptr),
       apply_suggestion_filter_for_exact_match_(
           apply_suggestion_filter_for_exact_match) {
@@ -182,10 +197,55 @@ CandidateFilter::CandidateFilter(
 CandidateFilter::~CandidateFilter() {}
 
 void CandidateFilter::Reset() {
-  seen_.clear();
+  if (seen_size_ > 0) {
+    std::fill(seen_.begin(), seen_.end(), 0);
+    seen_size_ = 0;
+  }
   top_candidate_ = nullptr;
 }
 
+bool CandidateFilter::IsSeen(const string &value) const {
+  const uint64 fp = GetSeenFingerprint(value);
+  const size_t mask = seen_.size() - 1;
+  for (size_t i = fp & mask; seen_[i] != 0; i = (i + 1) & mask) {
+    if (seen_[i] == fp) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CandidateFilter::InsertSeen(const string &value) {
+  const uint64 fp = GetSeenFingerprint(value);
+  size_t mask = seen_.size() - 1;
+  size_t i = fp & mask;
+  for (; seen_[i] != 0; i = (i + 1) & mask) {
+    if (seen_[i] == fp) {
+      return false;
+    }
+  }
+  if (2 * (seen_size_ + 1) > seen_.size()) {
+    // Rehash into a table twice as large.
+    std::vector<uint64> table(seen_.size() * 2, 0);
+    mask = table.size() - 1;
+    for (size_t j = 0; j < seen_.size(); ++j) {
+      if (seen_[j] == 0) {
+        continue;
+      }
+      i = seen_[j] & mask;
+      while (table[i] != 0) {
+        i = (i + 1) & mask;
+      }
+      table[i] = seen_[j];
+    }
+    seen_.swap(table);
+    for (i = fp & mask; seen_[i] != 0; i = (i + 1) & mask) {}
+  }
+  seen_[i] = fp;
+  ++seen_size_;
+  return true;
+}
+
 CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
     const string &original_key,
     const Segment::Candidate *candidate,
@@ -248,7 +308,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
     return CandidateFilter::GOOD_CANDIDATE;
   }
 
-  const size_t candidate_size = seen_.size();
+  const size_t candidate_size = seen_size_;
   if (top_candidate_ == nullptr || candidate_size == 0) {
     top_candidate_ = candidate;
   }
@@ -290,7 +350,7 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidateInternal(
   }
 
   // The candidate is already seen.
-  if (seen_.find(candidate->value) != seen_.end()) {
+  if (IsSeen(candidate->value)) {
     return CandidateFilter::BAD_CANDIDATE;
   }
 
@@ -497,15 +557,14 @@ CandidateFilter::ResultType CandidateFilter::FilterCandidate(
     // In reverse conversion, only remove duplicates because the filtering
     // criteria of FilterCandidateInternal() are completely designed for
     // (forward) conversion.
-    const bool inserted = seen_.insert(candidate->value).second;
-    return inserted ? GOOD_CANDIDATE : BAD_CANDIDATE;
+    return InsertSeen(candidate->value) ? GOOD_CANDIDATE : BAD_CANDIDATE;
   } else {
     const ResultType result = FilterCandidateInternal(original_key, candidate,
                                                       nodes, request_type);
     if (result != GOOD_CANDIDATE) {
       return result;
     }
-    seen_.insert(candidate->value);
+    InsertSeen(candidate->value);
     return result;
   }
 }
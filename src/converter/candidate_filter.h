@@ -30,7 +30,6 @@
 #ifndef MOZC_CONVERTER_CANDIDATE_FILTER_H_
 #define MOZC_CONVERTER_CANDIDATE_FILTER_H_
 
-#include <set>
 #include <string>
 #include <vector>
 
@@ -71,6 +70,12 @@ class CandidateFilter {
   void Reset();
 
  private:
+  // Returns true if |value| has been inserted into |seen_| since the last
+  // Reset().
+  bool IsSeen(const string &value) const;
+  // Inserts |value| into |seen_|.  Returns false if it's already there.
+  bool InsertSeen(const string &value);
+
   ResultType FilterCandidateInternal(const string &original_key,
                                      const Segment::Candidate *candidate,
                                      const std::vector<const Node *> &nodes,
@@ -80,7 +85,11 @@ class CandidateFilter {
   const dictionary::POSMatcher *pos_matcher_;
   const SuggestionFilter *suggestion_filter_;
 
-  std::set<string> seen_;
+  // The set of values of the accepted candidates, represented by an open
+  // addressing hash table of their fingerprints (0 for empty slots).  The
+  // table is allocated once and reused across Reset() calls.
+  std::vector<uint64> seen_;
+  size_t seen_size_;
   const Segment::Candidate *top_candidate_;
   bool apply_suggestion_filter_for_exact_match_;
 
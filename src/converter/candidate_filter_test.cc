@@ -999,5 +999,38 @@ TEST_F(CandidateFilterTest, ReverseConversion) {
   }
 }
 
+TEST_F(CandidateFilterTest, RemoveDuplicatesOfManyCandidates) {
+  std::unique_ptr<CandidateFilter> filter(CreateCandidateFilter(true));
+  std::vector<const Node *> nodes;
+  GetDefaultNodes(&nodes);
+
+  // Reverse conversion has no limit on the number of candidates, so more
+  // values than the initial capacity of the filter can be seen.
+  const int kNumValues = 1000;
+  std::vector<Segment::Candidate *> candidates;
+  for (int i = 0; i < kNumValues; ++i) {
+    Segment::Candidate *c = NewCandidate();
+    c->key = "test";
+    c->value = NumberUtil::SimpleItoa(i);
+    c->content_key = c->key;
+    c->content_value = c->value;
+    candidates.push_back(c);
+  }
+  for (int trial = 0; trial < 2; ++trial) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      EXPECT_EQ(CandidateFilter::GOOD_CANDIDATE,
+                filter->FilterCandidate("test", candidates[i], nodes,
+                                        Segments::REVERSE_CONVERSION));
+    }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      EXPECT_EQ(CandidateFilter::BAD_CANDIDATE,
+                filter->FilterCandidate("test", candidates[i], nodes,
+                                        Segments::REVERSE_CONVERSION));
+    }
+    // The seen values are forgotten by Reset().
+    filter->Reset();
+  }
+}
+
 }  // namespace converter
 }  // namespace mozc
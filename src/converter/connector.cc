@@ -29,8 +29,9 @@
 
 #include "converter/connector.h"
 
-#include <algorithm>
+#include <cstring>
 
+#include "base/access_profiler.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/stl_util.h"
@@ -44,6 +45,12 @@ namespace {
 
 const uint32 kInvalidCacheKey = 0xFFFFFFFF;
 const uint16 kConnectorMagicNumber = 0xCDAB;
+const uint16 kDenseConnectorMagicNumber = 0xCDAC;
+// The compressed format whose rows are stored in the order of an access
+// profile, each preceded by its rid.
+const uint16 kReorderedConnectorMagicNumber = 0xCDAD;
+// The name of the connection data in the data set and the access profile.
+const char kAccessProfileName[] = "conn";
 const uint8 kInvalid1ByteCostValue = 255;
 
 inline uint32 GetHashValue(uint16 rid, uint16 lid, uint32 hash_mask) {
@@ -59,6 +66,18 @@ inline uint32 EncodeKey(uint16 rid, uint16 lid) {
   return (static_cast<uint32>(rid) << 16) | lid;
 }
 
+inline uint64 EncodeCacheSlot(uint32 key, int value) {
+  return (static_cast<uint64>(key) << 32) | static_cast<uint32>(value);
+}
+
+inline uint32 GetCacheSlotKey(uint64 slot) {
+  return static_cast<uint32>(slot >> 32);
+}
+
+inline int GetCacheSlotValue(uint64 slot) {
+  return static_cast<int32>(static_cast<uint32>(slot));
+}
+
 }  // namespace
 
 class Connector::Row {
@@ -100,6 +119,11 @@ class Connector::Row {
     return true;
   }
 
+  size_t GetAllocatedBytes() const {
+    return sizeof(*this) + chunk_bits_index_.GetAllocatedBytes() +
+           compact_bits_index_.GetAllocatedBytes();
+  }
+
  private:
   SimpleSuccinctBitVectorIndex chunk_bits_index_;
   SimpleSuccinctBitVectorIndex compact_bits_index_;
@@ -118,20 +142,35 @@ Connector *Connector::CreateFromDataManager(
 #endif  // OS_ANDROID
   const char *connection_data = nullptr;
   size_t connection_data_size = 0;
-  data_manager.GetConnectorData(&connection_data, &connection_data_size);
+  data_manager.GetDenseConnectorData(&connection_data, &connection_data_size);
+  if (connection_data == nullptr || connection_data_size == 0) {
+    data_manager.GetConnectorData(&connection_data, &connection_data_size);
+  }
   return new Connector(connection_data, connection_data_size, kCacheSize);
 }
 
 Connector::Connector(const char *connection_data,
                      size_t connection_size,
                      int cache_size)
-    : default_cost_(nullptr),
+    : dense_matrix_(nullptr),
+      dense_lsize_(0),
+      default_cost_(nullptr),
       cache_size_(cache_size),
       cache_hash_mask_(cache_size - 1),
-      cache_key_(new uint32[cache_size]),
-      cache_value_(new int[cache_size]) {
+      cache_(new std::atomic<uint64>[cache_size]) {
+  // Check if the cache_size is the power of 2 and clear cache.
+  DCHECK_EQ(0, cache_size & (cache_size - 1));
+  ClearCache();
+
   const uint16 *ptr = reinterpret_cast<const uint16 *>(connection_data);
-  CHECK_EQ(kConnectorMagicNumber, ptr[0]);
+  if (ptr[0] == kDenseConnectorMagicNumber) {
+    InitDenseMatrix(connection_data, connection_size);
+    return;
+  }
+  const bool has_row_ids = ptr[0] == kReorderedConnectorMagicNumber;
+  if (!has_row_ids) {
+    CHECK_EQ(kConnectorMagicNumber, ptr[0]);
+  }
   resolution_ = ptr[1];
   const uint16 rsize = ptr[2];
   const uint16 lsize = ptr[3];
@@ -152,8 +191,16 @@ Connector::Connector(const char *connection_data,
 
   const bool use_1byte_value = resolution_ != 1;
 
-  rows_.reserve(rsize);
+  rows_.assign(rsize, nullptr);
   for (size_t i = 0; i < rsize; ++i) {
+    size_t rid = i;
+    if (has_row_ids) {
+      // The rid takes 4 bytes to keep the row aligned to 32-bits boundary.
+      rid = *reinterpret_cast<const uint16 *>(connection_data + offset);
+      CHECK_LT(rid, rsize);
+      CHECK(rows_[rid] == nullptr) << "Duplicate row: " << rid;
+      offset += 4;
+    }
     const uint16 *size_data =
         reinterpret_cast<const uint16 *>(connection_data + offset);
     Row *row = new Row;
@@ -168,14 +215,31 @@ Connector::Connector(const char *connection_data,
     const uint8 *values = compact_bits + compact_bits_size;
     row->Init(chunk_bits, chunk_bits_size, compact_bits, compact_bits_size,
               values, use_1byte_value);
-    rows_.push_back(row);
+    rows_[rid] = row;
 
     offset += 4 + chunk_bits_size + compact_bits_size + values_size;
   }
+}
 
-  // Check if the cache_size is the power of 2 and clear cache.
-  DCHECK_EQ(0, cache_size & (cache_size - 1));
-  ClearCache();
+void Connector::InitDenseMatrix(const char *connection_data,
+                                size_t connection_size) {
+  // The dense format is as follows:
+  // Magic number (0xCDAC): 2bytes
+  // Resolution: 2bytes
+  // Num rids: 2bytes
+  // Num lids: 2bytes
+  // Cost matrix in rid-major order: 2bytes * rids * lids
+  // The costs are stored after multiplying the resolution, so no decoding is
+  // needed at lookup time.
+  const uint16 *ptr = reinterpret_cast<const uint16 *>(connection_data);
+  resolution_ = ptr[1];
+  const uint16 rsize = ptr[2];
+  const uint16 lsize = ptr[3];
+  CHECK_EQ(rsize, lsize) << "The connector matrix should be square.";
+  CHECK_EQ(8 + 2 * static_cast<size_t>(rsize) * lsize, connection_size)
+      << "Dense connection matrix is broken.";
+  dense_matrix_ = reinterpret_cast<const int16 *>(ptr + 4);
+  dense_lsize_ = lsize;
 }
 
 Connector::~Connector() {
@@ -184,26 +248,106 @@ Connector::~Connector() {
 
 
 int Connector::GetTransitionCost(uint16 rid, uint16 lid) const {
+  if (dense_matrix_ != nullptr) {
+    AccessProfiler::Record(kAccessProfileName, rid);
+    return dense_matrix_[rid * dense_lsize_ + lid];
+  }
   const uint32 index = EncodeKey(rid, lid);
   const uint32 bucket = GetHashValue(rid, lid, cache_hash_mask_);
-  if (cache_key_[bucket] == index) {
-    return cache_value_[bucket];
+  // Relaxed ordering is sufficient because the cached value is a pure function
+  // of the key and the immutable connection data.
+  const uint64 slot = cache_[bucket].load(std::memory_order_relaxed);
+  if (GetCacheSlotKey(slot) == index) {
+    return GetCacheSlotValue(slot);
   }
   const int value = LookupCost(rid, lid);
-  cache_key_[bucket] = index;
-  cache_value_[bucket] = value;
+  cache_[bucket].store(EncodeCacheSlot(index, value),
+                       std::memory_order_relaxed);
   return value;
 }
 
+void Connector::GetTransitionCosts(const uint16 *rids, size_t size,
+                                   uint16 lid, int32 *costs) const {
+  if (dense_matrix_ != nullptr) {
+    const int16 *column = dense_matrix_ + lid;
+    if (AccessProfiler::IsEnabled()) {
+      for (size_t i = 0; i < size; ++i) {
+        AccessProfiler::Record(kAccessProfileName, rids[i]);
+      }
+    }
+    for (size_t i = 0; i < size; ++i) {
+      costs[i] = column[rids[i] * dense_lsize_];
+    }
+    return;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    costs[i] = GetTransitionCost(rids[i], lid);
+  }
+}
+
 int Connector::GetResolution() const {
   return resolution_;
 }
 
 void Connector::ClearCache() {
-  std::fill(cache_key_.get(), cache_key_.get() + cache_size_, kInvalidCacheKey);
+  const uint64 invalid_slot = EncodeCacheSlot(kInvalidCacheKey, 0);
+  for (int i = 0; i < cache_size_; ++i) {
+    cache_[i].store(invalid_slot, std::memory_order_relaxed);
+  }
+}
+
+size_t Connector::GetAllocatedBytes() const {
+  size_t bytes = cache_size_ * sizeof(uint64) +
+                 rows_.capacity() * sizeof(Row *);
+  for (size_t i = 0; i < rows_.size(); ++i) {
+    bytes += rows_[i]->GetAllocatedBytes();
+  }
+  return bytes;
+}
+
+bool Connector::SerializeCache(string *output) const {
+  if (dense_matrix_ != nullptr) {
+    return false;
+  }
+  output->resize(cache_size_ * sizeof(uint64));
+  char *dest = &(*output)[0];
+  for (int i = 0; i < cache_size_; ++i) {
+    const uint64 slot = cache_[i].load(std::memory_order_relaxed);
+    memcpy(dest + i * sizeof(slot), &slot, sizeof(slot));
+  }
+  return true;
+}
+
+bool Connector::RestoreCache(StringPiece data) const {
+  if (dense_matrix_ != nullptr ||
+      data.size() != cache_size_ * sizeof(uint64)) {
+    return false;
+  }
+  // Checks all the keys first not to restore a part of broken data.
+  std::vector<uint64> slots(cache_size_);
+  memcpy(slots.data(), data.data(), data.size());
+  const size_t num_rows = rows_.size();
+  for (int i = 0; i < cache_size_; ++i) {
+    const uint32 key = GetCacheSlotKey(slots[i]);
+    if (key == kInvalidCacheKey) {
+      continue;
+    }
+    const uint16 rid = static_cast<uint16>(key >> 16);
+    const uint16 lid = static_cast<uint16>(key & 0xFFFF);
+    if (rid >= num_rows || lid >= num_rows ||
+        GetHashValue(rid, lid, cache_hash_mask_) != static_cast<uint32>(i)) {
+      return false;
+    }
+  }
+  for (int i = 0; i < cache_size_; ++i) {
+    cache_[i].store(slots[i], std::memory_order_relaxed);
+  }
+  return true;
 }
 
 int Connector::LookupCost(uint16 rid, uint16 lid) const {
+  // Only the cache misses touch the connection data.
+  AccessProfiler::Record(kAccessProfileName, rid);
   uint16 value;
   if (!rows_[rid]->GetValue(lid, &value)) {
     return default_cost_[rid];
@@ -30,44 +30,81 @@
 #ifndef MOZC_CONVERTER_CONNECTOR_H_
 #define MOZC_CONVERTER_CONNECTOR_H_
 
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
 
 class DataManagerInterface;
 
+// Provides the transition cost between two POS IDs.  All the methods are
+// thread-safe, so a single instance can be shared by conversions running on
+// multiple threads.
 class Connector {
  public:
   static const int16 kInvalidCost = 30000;
 
+  // Creates a connector from the data manager.  If the data set contains the
+  // uncompressed (dense) connection matrix, it is used in preference to the
+  // compressed one.
   static Connector *CreateFromDataManager(
       const DataManagerInterface &data_manager);
 
+  // |connection_data| is either the compressed connection data or the dense
+  // connection matrix; the format is detected by its magic number.  In the
+  // dense mode, |cache_size| is ignored as every lookup is a single load.
   Connector(const char *connection_data, size_t connection_size,
             int cache_size);
   ~Connector();
 
   int GetTransitionCost(uint16 rid, uint16 lid) const;
+
+  // Sets costs[i] = GetTransitionCost(rids[i], lid) for i in [0, size).
+  void GetTransitionCosts(const uint16 *rids, size_t size, uint16 lid,
+                          int32 *costs) const;
+
   int GetResolution() const;
 
   void ClearCache();
 
+  // Returns the bytes allocated by this instance for the row index and the
+  // cache, excluding the connection data.
+  size_t GetAllocatedBytes() const;
+
+  // Serializes the cache so that a restarted process can start with a warm
+  // cache.  The result is valid only for the same connection data and the
+  // same architecture.  Returns false in the dense mode, which has no cache.
+  bool SerializeCache(string *output) const;
+
+  // Restores the cache from the output of SerializeCache().  Returns false,
+  // leaving the cache unchanged, if |data| is not for this cache.  This is
+  // const as the cache doesn't change the result of the lookups.
+  bool RestoreCache(StringPiece data) const;
+
  private:
   class Row;
 
+  void InitDenseMatrix(const char *connection_data, size_t connection_size);
   int LookupCost(uint16 rid, uint16 lid) const;
 
   std::vector<Row *> rows_;
+  // Points to the rid-major cost matrix in the dense mode; otherwise nullptr.
+  const int16 *dense_matrix_;
+  size_t dense_lsize_;
   const uint16 *default_cost_;
   int resolution_;
 
+  // Each cache slot packs the key, (rid << 16) | lid, into the upper 32 bits
+  // and the cost into the lower 32 bits so that a key and its value are
+  // always read and written together without locking.
   const int cache_size_;
   const uint32 cache_hash_mask_;
-  mutable std::unique_ptr<uint32[]> cache_key_;
-  mutable std::unique_ptr<int[]> cache_value_;
+  mutable std::unique_ptr<std::atomic<uint64>[]> cache_;
 
   DISALLOW_COPY_AND_ASSIGN(Connector);
 };
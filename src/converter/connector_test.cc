@@ -30,11 +30,14 @@
 #include "converter/connector.h"
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "base/access_profiler.h"
 #include "base/mmap.h"
+#include "base/thread.h"
 #include "data_manager/connection_file_reader.h"
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/mozctest.h"
@@ -49,16 +52,7 @@ struct ConnectionDataEntry {
 };
 
 #ifndef OS_NACL
-// Disabled on NaCl since it uses a mock file system.
-TEST(ConnectorTest, CompareWithRawData) {
-  const string path = testing::GetSourceFileOrDie({
-      "data_manager", "testing", "connection.data"});
-  Mmap cmmap;
-  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
-  std::unique_ptr<Connector> connector(
-      new Connector(cmmap.begin(), cmmap.size(), 256));
-  ASSERT_EQ(1, connector->GetResolution());
-
+std::vector<ConnectionDataEntry> ReadConnectionDataEntries() {
   const string connection_text_path = testing::GetSourceFileOrDie({
       "data_manager", "testing", "connection_single_column.txt"});
   std::vector<ConnectionDataEntry> data;
@@ -70,6 +64,50 @@ TEST(ConnectorTest, CompareWithRawData) {
     entry.cost = reader.cost();
     data.push_back(entry);
   }
+  return data;
+}
+
+class LookupThread : public Thread {
+ public:
+  LookupThread(const Connector *connector,
+               const std::vector<ConnectionDataEntry> *data,
+               size_t begin, size_t end)
+      : connector_(connector), data_(data), begin_(begin), end_(end),
+        num_mismatches_(0) {}
+
+  void Run() override {
+    for (int trial = 0; trial < 2; ++trial) {
+      for (size_t i = begin_; i < end_; ++i) {
+        const ConnectionDataEntry &entry = (*data_)[i];
+        if (connector_->GetTransitionCost(entry.rid, entry.lid) !=
+            entry.cost) {
+          ++num_mismatches_;
+        }
+      }
+    }
+  }
+
+  int num_mismatches() const { return num_mismatches_; }
+
+ private:
+  const Connector *connector_;
+  const std::vector<ConnectionDataEntry> *data_;
+  const size_t begin_;
+  const size_t end_;
+  int num_mismatches_;
+};
+
+// Disabled on NaCl since it uses a mock file system.
+TEST(ConnectorTest, CompareWithRawData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+  ASSERT_EQ(1, connector->GetResolution());
+
+  std::vector<ConnectionDataEntry> data = ReadConnectionDataEntries();
 
   for (int trial = 0; trial < 3; ++trial) {
     // Lookup in random order for a few times.
@@ -84,6 +122,196 @@ TEST(ConnectorTest, CompareWithRawData) {
     }
   }
 }
+
+TEST(ConnectorTest, ConcurrentLookup) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+
+  std::vector<ConnectionDataEntry> data = ReadConnectionDataEntries();
+  std::random_shuffle(data.begin(), data.end());
+  // Every thread looks up overlapping ranges so that the threads contend for
+  // the same cache slots.
+  const size_t kNumThreads = 4;
+  const size_t range_size = data.size() / 2;
+  std::vector<std::unique_ptr<LookupThread>> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    const size_t begin = (data.size() - range_size) * i / kNumThreads;
+    threads.emplace_back(new LookupThread(connector.get(), &data, begin,
+                                          begin + range_size));
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->SetJoinable(true);
+    threads[i]->Start("ConnectorTest");
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+    EXPECT_EQ(0, threads[i]->num_mismatches());
+  }
+}
+
+TEST(ConnectorTest, SerializeAndRestoreCache) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> warm(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+  std::vector<ConnectionDataEntry> data = ReadConnectionDataEntries();
+  for (size_t i = 0; i < data.size(); i += 11) {
+    warm->GetTransitionCost(data[i].rid, data[i].lid);
+  }
+  string cache;
+  ASSERT_TRUE(warm->SerializeCache(&cache));
+  EXPECT_EQ(256 * sizeof(uint64), cache.size());
+
+  std::unique_ptr<Connector> restored(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+  ASSERT_TRUE(restored->RestoreCache(cache));
+  string restored_cache;
+  ASSERT_TRUE(restored->SerializeCache(&restored_cache));
+  EXPECT_EQ(cache, restored_cache);
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(data[i].cost,
+              restored->GetTransitionCost(data[i].rid, data[i].lid));
+  }
+
+  // The cache of another size or a slot in a wrong bucket is rejected.
+  std::unique_ptr<Connector> other(
+      new Connector(cmmap.begin(), cmmap.size(), 512));
+  EXPECT_FALSE(other->RestoreCache(cache));
+  const uint16 rid = data[0].rid;
+  const uint16 lid = data[0].lid;
+  const size_t bucket = (3 * rid + lid + 1) % 256;
+  const uint64 slot =
+      (static_cast<uint64>((rid << 16) | lid) << 32) | data[0].cost;
+  string broken(cache);
+  memcpy(&broken[bucket * sizeof(slot)], &slot, sizeof(slot));
+  EXPECT_FALSE(restored->RestoreCache(broken));
+}
+
+TEST(ConnectorTest, DenseMatrixIsEquivalentToCompressedData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> compressed(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+
+  // Build the dense format, whose header is (magic number, resolution,
+  // rsize, lsize), from the compressed one.
+  const uint16 *header = reinterpret_cast<const uint16 *>(cmmap.begin());
+  const uint16 size = header[2];
+  std::vector<uint16> dense_data = {
+      0xCDAC, static_cast<uint16>(compressed->GetResolution()), size, size};
+  for (int rid = 0; rid < size; ++rid) {
+    for (int lid = 0; lid < size; ++lid) {
+      dense_data.push_back(compressed->GetTransitionCost(rid, lid));
+    }
+  }
+  std::unique_ptr<Connector> dense(new Connector(
+      reinterpret_cast<const char *>(dense_data.data()),
+      dense_data.size() * sizeof(uint16), 256));
+  EXPECT_EQ(compressed->GetResolution(), dense->GetResolution());
+
+  for (int rid = 0; rid < size; rid += 7) {
+    for (int lid = 0; lid < size; ++lid) {
+      EXPECT_EQ(compressed->GetTransitionCost(rid, lid),
+                dense->GetTransitionCost(rid, lid));
+    }
+  }
+
+  // The batched lookup agrees with the single lookup in both modes.
+  std::vector<uint16> rids;
+  for (int rid = size - 1; rid >= 0; rid -= 3) {
+    rids.push_back(rid);
+  }
+  std::vector<int32> compressed_costs(rids.size()), dense_costs(rids.size());
+  for (int lid = 0; lid < size; lid += 5) {
+    compressed->GetTransitionCosts(rids.data(), rids.size(), lid,
+                                   compressed_costs.data());
+    dense->GetTransitionCosts(rids.data(), rids.size(), lid,
+                              dense_costs.data());
+    for (size_t i = 0; i < rids.size(); ++i) {
+      EXPECT_EQ(compressed->GetTransitionCost(rids[i], lid),
+                compressed_costs[i]);
+      EXPECT_EQ(compressed_costs[i], dense_costs[i]);
+    }
+  }
+}
+
+TEST(ConnectorTest, ReorderedRowsAreEquivalentToCompressedData) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> compressed(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+
+  // Split the rows of the compressed format; see gen_connection_data.py for
+  // the format.
+  const uint16 *header = reinterpret_cast<const uint16 *>(cmmap.begin());
+  const uint16 size = header[2];
+  const size_t rows_offset = 8 + (size + (size & 1)) * 2;
+  const size_t chunk_bits_size = ((size + 7) / 8 + 31) / 32 * 4;
+  std::vector<string> rows;
+  for (size_t offset = rows_offset; rows.size() < size; ) {
+    const uint16 *size_data =
+        reinterpret_cast<const uint16 *>(cmmap.begin() + offset);
+    const size_t row_size =
+        4 + chunk_bits_size + size_data[0] + size_data[1];
+    rows.push_back(string(cmmap.begin() + offset, row_size));
+    offset += row_size;
+  }
+
+  // Store the rows in the reverse order, each preceded by its rid.
+  string reordered(cmmap.begin(), rows_offset);
+  const uint16 magic = 0xCDAD;
+  memcpy(&reordered[0], &magic, sizeof(magic));
+  for (int rid = size - 1; rid >= 0; --rid) {
+    const uint16 rid_data[2] = {static_cast<uint16>(rid), 0};
+    reordered.append(reinterpret_cast<const char *>(rid_data),
+                     sizeof(rid_data));
+    reordered.append(rows[rid]);
+  }
+  std::unique_ptr<Connector> connector(
+      new Connector(reordered.data(), reordered.size(), 256));
+  for (int rid = 0; rid < size; rid += 3) {
+    for (int lid = 0; lid < size; ++lid) {
+      EXPECT_EQ(compressed->GetTransitionCost(rid, lid),
+                connector->GetTransitionCost(rid, lid));
+    }
+  }
+}
+
+TEST(ConnectorTest, RecordsAccessProfile) {
+  const string path = testing::GetSourceFileOrDie({
+      "data_manager", "testing", "connection.data"});
+  Mmap cmmap;
+  ASSERT_TRUE(cmmap.Open(path.c_str())) << "Failed to open image: " << path;
+  std::unique_ptr<Connector> connector(
+      new Connector(cmmap.begin(), cmmap.size(), 256));
+
+  AccessProfiler::SetEnabled(true);
+  connector->GetTransitionCost(5, 3);
+  // The cache hit doesn't touch the connection data.
+  connector->GetTransitionCost(5, 3);
+  connector->GetTransitionCost(7, 3);
+  AccessProfiler::SetEnabled(false);
+
+  std::vector<AccessProfiler::Entry> entries;
+  AccessProfiler::GetEntries(&entries);
+  ASSERT_EQ(2, entries.size());
+  EXPECT_EQ("conn", entries[0].name);
+  EXPECT_EQ(5, entries[0].index);
+  EXPECT_EQ(1, entries[0].count);
+  EXPECT_EQ("conn", entries[1].name);
+  EXPECT_EQ(7, entries[1].index);
+  EXPECT_EQ(1, entries[1].count);
+}
 #endif  // !OS_NACL
 
 }  // namespace
@@ -31,20 +31,30 @@
 
 #include <algorithm>
 #include <climits>
+#include <deque>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/number_util.h"
 #include "base/port.h"
+#include "base/thread.h"
+#include "base/thread_pool.h"
+#include "base/trace.h"
+#include "base/unnamed_event.h"
 #include "base/util.h"
 #include "composer/composer.h"
+#include "converter/converter_util.h"
 #include "converter/immutable_converter_interface.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 #include "prediction/predictor_interface.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
 #include "transliteration/transliteration.h"
@@ -206,8 +216,225 @@ bool TryNormalizingKeyAsMathExpression(StringPiece s, string *key) {
   return true;
 }
 
+// The ID of the revert entry which FinishConversion() leaves in the segments
+// in place of the revert entries of the background learning.  Its timestamp
+// is the ID of the learning task.
+const uint16 kPendingLearningRevertId = 0xFFFF;
+
+// The number of the recent learning tasks whose revert entries are kept.
+const size_t kMaxRevertEntriesHistory = 16;
+
+// The minimum number of keys converted by a task of StartConversionBatch().
+const size_t kMinBatchKeysPerTask = 16;
+
+// Stores the key and the top candidate of each segment of |segments|.
+void SetBatchConversionResult(const Segments &segments,
+                              BatchConversionResult *result) {
+  result->segments.clear();
+  result->segments.reserve(segments.conversion_segments_size());
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    result->segments.push_back(std::make_pair(
+        segment.key(),
+        segment.candidates_size() > 0 ? segment.candidate(0).value : ""));
+  }
+}
+
 }  // namespace
 
+// Applies the learning of the committed segments on a background thread in
+// the order of the commits.
+class ConverterImpl::Learner : public Thread {
+ public:
+  Learner(RewriterInterface *rewriter, PredictorInterface *predictor)
+      : rewriter_(rewriter), predictor_(predictor), num_pending_tasks_(0),
+        next_task_id_(1), quit_(false) {
+    SetJoinable(true);
+    Start("ConverterLearner");
+  }
+
+  ~Learner() override {
+    {
+      scoped_lock l(&mutex_);
+      quit_ = true;
+    }
+    task_event_.Notify();
+    Join();
+  }
+
+  // Copies |request| and |segments| for the learning and returns the ID of the
+  // learning task.
+  uint32 Enqueue(const ConversionRequest &request, const Segments &segments) {
+    return Push(std::unique_ptr<Task>(new Task(request, segments)));
+  }
+
+  // Enqueues Sync() or Reload() of the rewriter and the predictor, which runs
+  // after the learning enqueued so far.
+  void EnqueueSync() {
+    Push(std::unique_ptr<Task>(new Task(Task::SYNC)));
+  }
+  void EnqueueReload() {
+    Push(std::unique_ptr<Task>(new Task(Task::RELOAD)));
+  }
+
+  void Wait() const {
+    while (true) {
+      {
+        scoped_lock l(&mutex_);
+        if (num_pending_tasks_ == 0) {
+          return;
+        }
+      }
+      // The timeout covers the notification consumed by another waiter.
+      done_event_.Wait(10);
+    }
+  }
+
+  // Appends the revert entries recorded by the learning |task_id| to
+  // |segments|.  Must be called after Wait().
+  void AppendRevertEntries(uint32 task_id, Segments *segments) const {
+    scoped_lock l(&mutex_);
+    for (size_t i = 0; i < revert_entries_.size(); ++i) {
+      if (revert_entries_[i].first != task_id) {
+        continue;
+      }
+      const std::vector<Segments::RevertEntry> &entries =
+          revert_entries_[i].second;
+      for (size_t j = 0; j < entries.size(); ++j) {
+        *segments->push_back_revert_entry() = entries[j];
+      }
+      return;
+    }
+  }
+
+  void Run() override {
+    while (true) {
+      std::unique_ptr<Task> task;
+      {
+        scoped_lock l(&mutex_);
+        if (!tasks_.empty()) {
+          task = std::move(tasks_.front());
+          tasks_.pop_front();
+        } else if (quit_) {
+          return;
+        }
+      }
+      if (!task) {
+        task_event_.Wait(-1);
+        continue;
+      }
+
+      if (task->type == Task::SYNC) {
+        RunAndNotify(rewriter_->Sync() && predictor_->Sync(), "Sync");
+        continue;
+      }
+      if (task->type == Task::RELOAD) {
+        RunAndNotify(rewriter_->Reload() && predictor_->Reload(), "Reload");
+        continue;
+      }
+
+      rewriter_->Finish(task->request, &task->segments);
+      predictor_->Finish(task->request, &task->segments);
+
+      std::vector<Segments::RevertEntry> entries;
+      for (size_t i = 0; i < task->segments.revert_entries_size(); ++i) {
+        entries.push_back(task->segments.revert_entry(i));
+      }
+      {
+        scoped_lock l(&mutex_);
+        revert_entries_.push_back(std::make_pair(task->id, entries));
+        if (revert_entries_.size() > kMaxRevertEntriesHistory) {
+          revert_entries_.pop_front();
+        }
+        --num_pending_tasks_;
+      }
+      done_event_.Notify();
+    }
+  }
+
+ private:
+  // Owns the copies of the request and the segments, since the originals may
+  // be changed or destroyed before the learning.
+  struct Task {
+    enum Type {
+      FINISH,
+      SYNC,
+      RELOAD,
+    };
+
+    // For SYNC and RELOAD, which need neither the request nor the segments.
+    explicit Task(Type task_type)
+        : id(0), type(task_type), composer(NULL, &request_proto, &config) {}
+
+    Task(const ConversionRequest &src_request, const Segments &src_segments)
+        : id(0), type(FINISH), request_proto(src_request.request()),
+          config(src_request.config()),
+          composer(NULL, &request_proto, &config) {
+      request.CopyFrom(src_request);
+      request.set_request(&request_proto);
+      request.set_config(&config);
+      // The learning is not bound by the deadline of the commit.
+      request.set_deadline_ticks(0);
+      if (src_request.has_composer()) {
+        composer.CopyFrom(src_request.composer());
+        composer.SetRequest(&request_proto);
+        composer.SetConfig(&config);
+        request.set_composer(&composer);
+      }
+      segments.CopyFrom(src_segments);
+    }
+
+    uint32 id;
+    const Type type;
+    const commands::Request request_proto;
+    const config::Config config;
+    composer::Composer composer;
+    ConversionRequest request;
+    Segments segments;
+  };
+
+  uint32 Push(std::unique_ptr<Task> task) {
+    uint32 id = 0;
+    {
+      scoped_lock l(&mutex_);
+      id = next_task_id_++;
+      task->id = id;
+      tasks_.push_back(std::move(task));
+      ++num_pending_tasks_;
+    }
+    task_event_.Notify();
+    return id;
+  }
+
+  // Marks the running SYNC or RELOAD task as done.  Nobody waits for its
+  // result, so a failure is only logged.
+  void RunAndNotify(bool result, const char *name) {
+    LOG_IF(WARNING, !result) << name << " of the user data failed";
+    {
+      scoped_lock l(&mutex_);
+      --num_pending_tasks_;
+    }
+    done_event_.Notify();
+  }
+
+  RewriterInterface *rewriter_;
+  PredictorInterface *predictor_;
+
+  mutable Mutex mutex_;
+  std::deque<std::unique_ptr<Task>> tasks_;
+  // The number of the queued and the running tasks.
+  size_t num_pending_tasks_;
+  uint32 next_task_id_;
+  bool quit_;
+  // Pairs of the task ID and its revert entries for the recent tasks.
+  std::deque<std::pair<uint32, std::vector<Segments::RevertEntry>>>
+      revert_entries_;
+  UnnamedEvent task_event_;
+  mutable UnnamedEvent done_event_;
+
+  DISALLOW_COPY_AND_ASSIGN(Learner);
+};
+
 ConverterImpl::ConverterImpl() : pos_matcher_(NULL),
                                  immutable_converter_(NULL),
                                  general_noun_id_(kuint16max) {
@@ -229,8 +456,45 @@ void ConverterImpl::Init(const POSMatcher *pos_matcher,
   general_noun_id_ = pos_matcher_->GetGeneralNounId();
 }
 
+void ConverterImpl::set_background_learning(bool background_learning) {
+  if (!background_learning) {
+    learner_.reset();
+  } else if (!learner_) {
+    DCHECK(predictor_);
+    DCHECK(rewriter_);
+    learner_.reset(new Learner(rewriter_.get(), predictor_.get()));
+  }
+}
+
+void ConverterImpl::WaitForPendingLearning() const {
+  if (learner_) {
+    learner_->Wait();
+  }
+}
+
+bool ConverterImpl::SyncUserData() const {
+  if (learner_) {
+    learner_->EnqueueSync();
+    return true;
+  }
+  // TODO(noriyukit): In the current implementation, if rewriter_->Sync() fails,
+  // predictor_->Sync() is never called. Check if we should call
+  // predictor_->Sync() or not.
+  return rewriter_->Sync() && predictor_->Sync();
+}
+
+bool ConverterImpl::ReloadUserData() const {
+  if (learner_) {
+    learner_->EnqueueReload();
+    return true;
+  }
+  // TODO(noriyukit): The same TODO as SyncUserData().
+  return rewriter_->Reload() && predictor_->Reload();
+}
+
 bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
+  MOZC_TRACE_SPAN("ConverterImpl::StartConversionForRequest");
   if (!request.has_composer()) {
     LOG(ERROR) << "Request doesn't have composer";
     return false;
@@ -253,6 +517,9 @@ bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
 
   SetKey(segments, conversion_key);
   segments->set_request_type(Segments::CONVERSION);
+  // The boundary constraint of the immutable converter reads the learned
+  // segment boundaries.
+  WaitForPendingLearning();
   immutable_converter_->ConvertForRequest(request, segments);
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
@@ -267,12 +534,65 @@ bool ConverterImpl::StartConversion(Segments *segments,
   SetKey(segments, key);
   segments->set_request_type(Segments::CONVERSION);
   const ConversionRequest default_request;
+  WaitForPendingLearning();
   immutable_converter_->ConvertForRequest(default_request, segments);
   RewriteAndSuppressCandidates(default_request, segments);
   TrimCandidates(default_request, segments);
   return IsValidSegments(default_request, *segments);
 }
 
+bool ConverterImpl::StartConversionBatch(
+    const std::vector<string> &keys,
+    std::vector<BatchConversionResult> *results) const {
+  MOZC_TRACE_SPAN("ConverterImpl::StartConversionBatch");
+  DCHECK(results);
+  results->clear();
+  results->resize(keys.size());
+  if (keys.empty()) {
+    return true;
+  }
+
+  // Converts [begin, end) of |keys| with one Segments so that the segments,
+  // the candidates and the lattice are reused.
+  auto convert_range = [this, &keys, results](size_t begin, size_t end) {
+    Segments segments;
+    for (size_t i = begin; i < end; ++i) {
+      BatchConversionResult *result = &(*results)[i];
+      result->success = StartConversion(&segments, keys[i]);
+      if (result->success) {
+        SetBatchConversionResult(segments, result);
+      }
+    }
+  };
+
+  // Applies the pending learning before the pool threads read it.
+  WaitForPendingLearning();
+  ThreadPool *pool = ThreadPool::GetSharedInstance();
+  const size_t num_tasks =
+      std::max<size_t>(1, std::min(pool->num_threads() + 1,
+                                   keys.size() / kMinBatchKeysPerTask));
+  std::vector<ThreadPool::TaskHandle> tasks;
+  for (size_t i = 1; i < num_tasks; ++i) {
+    const size_t begin = keys.size() * i / num_tasks;
+    const size_t end = keys.size() * (i + 1) / num_tasks;
+    tasks.push_back(pool->Schedule(
+        ThreadPool::BACKGROUND,
+        [&convert_range, begin, end]() { convert_range(begin, end); }));
+  }
+  convert_range(0, keys.size() / num_tasks);
+  // A range which no worker has taken yet runs on this thread.
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Wait();
+  }
+
+  for (size_t i = 0; i < results->size(); ++i) {
+    if (!(*results)[i].success) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool ConverterImpl::StartReverseConversion(Segments *segments,
                                            const string &key) const {
   segments->Clear();
@@ -316,6 +636,38 @@ bool ConverterImpl::StartReverseConversion(Segments *segments,
   return true;
 }
 
+bool ConverterImpl::StartReverseConversionBatch(
+    const std::vector<string> &keys,
+    std::vector<BatchConversionResult> *results) const {
+  MOZC_TRACE_SPAN("ConverterImpl::StartReverseConversionBatch");
+  DCHECK(results);
+  results->clear();
+  results->resize(keys.size());
+  if (keys.empty()) {
+    return true;
+  }
+
+  // Prepares the reverse lookups for all the keys at once.  The keys are
+  // converted on this thread as the prepared lookups are not thread-safe.
+  string all_keys;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    all_keys.append(keys[i]);
+  }
+  immutable_converter_->BeginReverseConversionBatch(all_keys);
+  bool success = true;
+  Segments segments;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    BatchConversionResult *result = &(*results)[i];
+    result->success = StartReverseConversion(&segments, keys[i]);
+    success = success && result->success;
+    if (result->success) {
+      SetBatchConversionResult(segments, result);
+    }
+  }
+  immutable_converter_->EndReverseConversionBatch();
+  return success;
+}
+
 // static
 void ConverterImpl::MaybeSetConsumedKeySizeToCandidate(
     size_t consumed_key_size, Segment::Candidate* candidate) {
@@ -346,6 +698,7 @@ bool ConverterImpl::Predict(const ConversionRequest &request,
                             const string &key,
                             const Segments::RequestType request_type,
                             Segments *segments) const {
+  MOZC_TRACE_SPAN("ConverterImpl::Predict");
   const Segments::RequestType original_request_type = segments->request_type();
   if ((original_request_type != Segments::PREDICTION &&
        original_request_type != Segments::PARTIAL_PREDICTION) ||
@@ -376,6 +729,7 @@ bool ConverterImpl::Predict(const ConversionRequest &request,
   DCHECK_EQ(key, segments->conversion_segment(0).key());
 
   segments->set_request_type(request_type);
+  WaitForPendingLearning();
   predictor_->PredictForRequest(request, segments);
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
@@ -494,8 +848,16 @@ bool ConverterImpl::FinishConversion(const ConversionRequest &request,
   }
 
   segments->clear_revert_entries();
-  rewriter_->Finish(request, segments);
-  predictor_->Finish(request, segments);
+  if (learner_) {
+    const uint32 task_id = learner_->Enqueue(request, *segments);
+    // RevertConversion() replaces this entry with the actual revert entries.
+    Segments::RevertEntry *revert_entry = segments->push_back_revert_entry();
+    revert_entry->id = kPendingLearningRevertId;
+    revert_entry->timestamp = task_id;
+  } else {
+    rewriter_->Finish(request, segments);
+    predictor_->Finish(request, segments);
+  }
 
   // Remove the front segments except for some segments which will be
   // used as history segments.
@@ -531,6 +893,22 @@ bool ConverterImpl::RevertConversion(Segments *segments) const {
   if (segments->revert_entries_size() == 0) {
     return true;
   }
+  WaitForPendingLearning();
+  if (learner_) {
+    std::vector<uint32> task_ids;
+    for (size_t i = 0; i < segments->revert_entries_size(); ++i) {
+      const Segments::RevertEntry &entry = segments->revert_entry(i);
+      if (entry.id == kPendingLearningRevertId) {
+        task_ids.push_back(entry.timestamp);
+      }
+    }
+    if (!task_ids.empty()) {
+      segments->clear_revert_entries();
+      for (size_t i = 0; i < task_ids.size(); ++i) {
+        learner_->AppendRevertEntries(task_ids[i], segments);
+      }
+    }
+  }
   predictor_->Revert(segments);
   segments->clear_revert_entries();
   return true;
@@ -649,6 +1027,7 @@ bool ConverterImpl::FreeSegmentValue(Segments *segments,
     return false;
   }
 
+  WaitForPendingLearning();
   return immutable_converter_->Convert(segments);
 }
 
@@ -774,6 +1153,7 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
 
   segments->set_resized(true);
 
+  WaitForPendingLearning();
   immutable_converter_->ConvertForRequest(request, segments);
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
@@ -792,48 +1172,13 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
 
   const size_t kMaxArraySize = 256;
   start_segment_index = GetSegmentIndex(segments, start_segment_index);
-  const size_t end_segment_index = start_segment_index + segments_size;
-  if (start_segment_index == kErrorIndex ||
-      end_segment_index <= start_segment_index ||
-      end_segment_index > segments->segments_size() ||
-      array_size > kMaxArraySize) {
-    return false;
-  }
-
-  string key;
-  for (size_t i = start_segment_index; i < end_segment_index; ++i) {
-    key += segments->segment(i).key();
-  }
-
-  if (key.empty()) {
+  if (start_segment_index == kErrorIndex || array_size > kMaxArraySize ||
+      !ConverterUtil::ResizeSegments(start_segment_index, segments_size,
+                                     new_size_array, array_size, segments)) {
     return false;
   }
 
-  size_t consumed = 0;
-  const size_t key_len = Util::CharsLen(key);
-  std::vector<string> new_keys;
-  new_keys.reserve(array_size + 1);
-
-  for (size_t i = 0; i < array_size; ++i) {
-    if (new_size_array[i] != 0 && consumed < key_len) {
-      new_keys.push_back(Util::SubString(key, consumed, new_size_array[i]));
-      consumed += new_size_array[i];
-    }
-  }
-  if (consumed < key_len) {
-    new_keys.push_back(Util::SubString(key, consumed, key_len - consumed));
-  }
-
-  segments->erase_segments(start_segment_index, segments_size);
-
-  for (size_t i = 0; i < new_keys.size(); ++i) {
-    Segment *seg = segments->insert_segment(start_segment_index + i);
-    seg->set_segment_type(Segment::FIXED_BOUNDARY);
-    seg->set_key(new_keys[i]);
-  }
-
-  segments->set_resized(true);
-
+  WaitForPendingLearning();
   immutable_converter_->ConvertForRequest(request, segments);
   RewriteAndSuppressCandidates(request, segments);
   TrimCandidates(request, segments);
@@ -901,6 +1246,8 @@ void ConverterImpl::CompletePOSIds(Segment::Candidate *candidate) const {
 
 void ConverterImpl::RewriteAndSuppressCandidates(
     const ConversionRequest &request, Segments *segments) const {
+  // The learning rewriters have to see the previous commits.
+  WaitForPendingLearning();
   if (!rewriter_->Rewrite(request, segments)) {
     return;
   }
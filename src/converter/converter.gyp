@@ -49,6 +49,7 @@
         '../request/request.gyp:conversion_request',
         '../rewriter/rewriter.gyp:rewriter',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
+        'converter_base.gyp:converter_util',
         'converter_base.gyp:immutable_converter',
         'converter_base.gyp:immutable_converter_interface',
         'converter_base.gyp:segmenter',
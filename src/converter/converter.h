@@ -59,6 +59,26 @@ class ConverterImpl : public ConverterInterface {
             RewriterInterface *rewriter,
             ImmutableConverterInterface *immutable_converter);
 
+  // If true, FinishConversion() doesn't wait for the learning of the committed
+  // segments, i.e., Finish() of the rewriter and the predictor, but hands it
+  // to a background thread which applies it in the order of the commits.  The
+  // conversion and the prediction wait for the pending learning before they
+  // look up the learned data.  Finish() of the rewriter and the predictor is
+  // called with a copy of the segments then, so it must not modify what the
+  // caller uses except for the revert entries.  The default is false.
+  void set_background_learning(bool background_learning);
+
+  // Waits until the learning handed to the background thread is applied.
+  // Must be called before accessing the rewriter or the predictor directly.
+  void WaitForPendingLearning() const;
+
+  // Calls Sync() or Reload() of the rewriter and the predictor.  With the
+  // background learning, the call is handed to the background thread after
+  // the pending learning and true is returned without waiting for the disk;
+  // the conversion and the prediction wait for it like for the learning.
+  bool SyncUserData() const;
+  bool ReloadUserData() const;
+
   bool Predict(const ConversionRequest &request,
                const string &key,
                const Segments::RequestType request_type,
@@ -68,8 +88,14 @@ class ConverterImpl : public ConverterInterface {
                                          Segments *segments) const;
   virtual bool StartConversion(Segments *segments,
                                const string &key) const;
+  virtual bool StartConversionBatch(
+      const std::vector<string> &keys,
+      std::vector<BatchConversionResult> *results) const;
   virtual bool StartReverseConversion(Segments *segments,
                                       const string &key) const;
+  virtual bool StartReverseConversionBatch(
+      const std::vector<string> &keys,
+      std::vector<BatchConversionResult> *results) const;
   virtual bool StartPredictionForRequest(const ConversionRequest &request,
                                          Segments *segments) const;
   virtual bool StartPrediction(Segments *segments,
@@ -123,6 +149,8 @@ class ConverterImpl : public ConverterInterface {
                              size_t array_size) const;
 
  private:
+  class Learner;
+
   FRIEND_TEST(ConverterTest, CompletePOSIds);
   FRIEND_TEST(ConverterTest, DefaultPredictor);
   FRIEND_TEST(ConverterTest, MaybeSetConsumedKeySizeToSegment);
@@ -179,6 +207,9 @@ class ConverterImpl : public ConverterInterface {
   std::unique_ptr<RewriterInterface> rewriter_;
   const ImmutableConverterInterface *immutable_converter_;
   uint16 general_noun_id_;
+  // Declared after |predictor_| and |rewriter_| so that the pending learning
+  // is applied before they are destroyed.
+  std::unique_ptr<Learner> learner_;
 };
 
 }  // namespace mozc
@@ -70,6 +70,16 @@
         '../base/base.gyp:base',
       ],
     },
+    {
+      'target_name': 'viterbi_kernel',
+      'type': 'static_library',
+      'sources': [
+        'viterbi_kernel.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+      ],
+    },
     {
       'target_name': 'segments',
       'type': 'static_library',
@@ -81,6 +91,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../base/base.gyp:hash',
         '../dictionary/dictionary_base.gyp:pos_matcher',
         '../prediction/prediction_base.gyp:suggestion_filter',
         '../transliteration/transliteration.gyp:transliteration',
@@ -119,16 +130,19 @@
       'dependencies': [
         '../base/base.gyp:base',
         '../config/config.gyp:config_handler',
+        '../dictionary/dictionary.gyp:dictionary_impl',
         '../dictionary/dictionary.gyp:suffix_dictionary',
         '../dictionary/dictionary_base.gyp:pos_matcher',
         '../dictionary/dictionary_base.gyp:suppression_dictionary',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
         '../rewriter/rewriter_base.gyp:gen_rewriter_files#host',
+        '../usage_stats/usage_stats_base.gyp:usage_stats',
         'connector',
         'immutable_converter_interface',
         'segmenter',
         'segments',
+        'viterbi_kernel',
       ],
     },
     {
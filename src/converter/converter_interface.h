@@ -31,6 +31,8 @@
 #define MOZC_CONVERTER_CONVERTER_INTERFACE_H_
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/port.h"
 #include "converter/segments.h"
@@ -42,6 +44,16 @@ namespace composer {
 class Composer;
 }  // namespace composer
 
+// The result of ConverterInterface::StartConversionBatch() for a key.
+struct BatchConversionResult {
+  BatchConversionResult() : success(false) {}
+
+  // True if StartConversion() succeeded for the key.
+  bool success;
+  // The key and the value of the top candidate of each segment.
+  std::vector<std::pair<string, string>> segments;
+};
+
 class ConverterInterface {
  public:
   // Allow deletion through the interface.
@@ -56,10 +68,28 @@ class ConverterInterface {
   virtual bool StartConversion(Segments *segments,
                                const string &key) const = 0;
 
+  // Converts each of |keys| independently as StartConversion() does, and
+  // stores the results in |results| in the order of |keys|.  The keys are
+  // split into ranges converted in parallel on the shared ThreadPool, and each
+  // range reuses one Segments, i.e., its lattice and node allocator, across
+  // the keys.  The history is neither used nor learned.  Returns true if all
+  // the keys are converted.
+  virtual bool StartConversionBatch(
+      const std::vector<string> &keys,
+      std::vector<BatchConversionResult> *results) const = 0;
+
   // Start reverse conversion with key.
   virtual bool StartReverseConversion(Segments *segments,
                                       const string &key) const = 0;
 
+  // Reverse-converts each of |keys| as StartReverseConversion() does, and
+  // stores the results in |results| in the order of |keys|.  The dictionary
+  // lookups are prepared once for the whole batch instead of for each key.
+  // Returns true if all the keys are converted.
+  virtual bool StartReverseConversionBatch(
+      const std::vector<string> &keys,
+      std::vector<BatchConversionResult> *results) const = 0;
+
   // Starts prediction for given request.
   virtual bool StartPredictionForRequest(const ConversionRequest &request,
                                          Segments *segments) const = 0;
@@ -27,6 +27,8 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -38,9 +40,12 @@
 #include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/number_util.h"
+#include "base/perf_counter.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
+#include "base/thread.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
@@ -48,23 +53,42 @@
 #include "converter/lattice.h"
 #include "converter/pos_id_printer.h"
 #include "converter/segments.h"
+#include "engine/engine.h"
 #include "engine/engine_factory.h"
 #include "engine/engine_interface.h"
 #include "engine/mock_data_engine_factory.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
+#include "rewriter/rewriter_profiler.h"
 
 DEFINE_int32(max_conversion_candidates_size, 200, "maximum candidates size");
 DEFINE_string(user_profile_dir, "", "path to user profile directory");
 DEFINE_string(engine, "default", "engine: (default, chromeos)");
 DEFINE_bool(output_debug_string, true, "output debug string for each input");
 DEFINE_bool(show_meta_candidates, false, "if true, show meta candidates");
+DEFINE_bool(output_node_stats, false,
+            "output the node statistics of the lattice for each input");
+DEFINE_bool(profile_rewriters, false,
+            "record the time of each rewriter and print the stats at exit. "
+            "The stats are also printed by the \"rewriterstats\" command");
 DEFINE_string(
     id_def,
     "",
     "id.def file for POS IDs. If provided, show human readable "
     "POS instead of ID number");
+DEFINE_string(batch_input, "",
+              "file of the keys in Hiragana, one per line.  If given, the keys "
+              "are processed in the batch mode instead of the commands from "
+              "stdin, and the throughput and the latency are reported");
+DEFINE_string(batch_request_type, "conversion",
+              "request type of the batch mode: "
+              "(conversion, prediction, suggestion)");
+DEFINE_int32(batch_threads, 1,
+             "number of the threads of the batch mode, each of which has its "
+             "own converter on the shared data");
+DEFINE_bool(batch_output, true,
+            "output the top candidate of each key in the batch mode");
 
 using mozc::composer::Composer;
 using mozc::composer::Table;
@@ -240,6 +264,16 @@ void PrintSegments(const Segments &segments, std::ostream *os) {
   }
 }
 
+void PrintNodeStats(const Lattice &lattice, std::ostream *os) {
+  LatticeNodeStats stats;
+  lattice.GetNodeStats(&stats);
+  (*os) << "---------- Lattice nodes ----------" << std::endl
+        << "count: " << stats.node_count
+        << "  max_count: " << stats.max_node_count
+        << "  truncations: " << stats.num_truncations
+        << "  reserved_bytes: " << stats.reserved_bytes << std::endl;
+}
+
 bool ExecCommand(const ConverterInterface &converter,
                  Segments *segments,
                  const string &line,
@@ -365,6 +399,10 @@ bool ExecCommand(const ConverterInterface &converter,
     segments->set_user_history_enabled(false);
   } else if (func == "enableuserhistory") {
     segments->set_user_history_enabled(true);
+  } else if (func == "rewriterstats") {
+    std::cout << RewriterProfiler::Dump();
+  } else if (func == "clearrewriterstats") {
+    RewriterProfiler::Clear();
   } else {
     LOG(WARNING) << "Unknown command: " <<  func;
     return false;
@@ -374,6 +412,208 @@ bool ExecCommand(const ConverterInterface &converter,
   return true;
 }
 
+class LatencyStats {
+ public:
+  LatencyStats() = default;
+
+  void Add(double usec) { times_.push_back(usec); }
+  void Merge(const LatencyStats &other) {
+    times_.insert(times_.end(), other.times_.begin(), other.times_.end());
+  }
+
+  string ToString() {
+    if (times_.empty()) {
+      return "size=0";
+    }
+    std::sort(times_.begin(), times_.end());
+    double total = 0.0;
+    for (size_t i = 0; i < times_.size(); ++i) {
+      total += times_[i];
+    }
+    return Util::StringPrintf(
+        "size=%d avg=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f (usec)",
+        static_cast<int>(times_.size()), total / times_.size(),
+        GetPercentile(50), GetPercentile(90), GetPercentile(99),
+        times_.back());
+  }
+
+ private:
+  // |times_| needs to be sorted.
+  double GetPercentile(int percent) const {
+    const size_t rank = (times_.size() * percent + 99) / 100;
+    return times_[rank == 0 ? 0 : rank - 1];
+  }
+
+  std::vector<double> times_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyStats);
+};
+
+// Converts the keys of the batch mode, taking the next one from the shared
+// index.  The results are stored by the index of the key so that they are
+// printed in the input order.
+class BatchWorker : public Thread {
+ public:
+  BatchWorker(const ConverterInterface *converter,
+              const std::vector<string> &keys,
+              std::atomic<size_t> *next_index,
+              std::vector<string> *results)
+      : converter_(converter),
+        keys_(keys),
+        next_index_(next_index),
+        results_(results) {}
+
+  void Run() override {
+    const commands::Request request;
+    const Config config;
+    Table table;
+    Segments segments;
+    for (size_t i = next_index_->fetch_add(1); i < keys_.size();
+         i = next_index_->fetch_add(1)) {
+      const uint64 begin_ticks = PerfCounter::GetTicks();
+      Composer composer(&table, &request, &config);
+      composer.InsertCharacterPreedit(keys_[i]);
+      const ConversionRequest conversion_request(&composer, &request, &config);
+      segments.Clear();
+      segments.set_max_conversion_candidates_size(
+          FLAGS_max_conversion_candidates_size);
+      bool result = false;
+      if (FLAGS_batch_request_type == "prediction") {
+        result = converter_->StartPredictionForRequest(conversion_request,
+                                                       &segments);
+      } else if (FLAGS_batch_request_type == "suggestion") {
+        result = converter_->StartSuggestionForRequest(conversion_request,
+                                                       &segments);
+      } else {
+        result = converter_->StartConversionForRequest(conversion_request,
+                                                       &segments);
+      }
+      latency_stats_.Add(PerfCounter::TicksToNanoseconds(
+          PerfCounter::GetTicks() - begin_ticks) / 1000.0);
+
+      if (FLAGS_batch_output) {
+        string &output = (*results_)[i];
+        output = keys_[i];
+        output += '\t';
+        if (result) {
+          for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+            const Segment &segment = segments.conversion_segment(j);
+            if (segment.candidates_size() > 0) {
+              output += segment.candidate(0).value;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  const LatencyStats &latency_stats() const { return latency_stats_; }
+
+ private:
+  const ConverterInterface *converter_;
+  const std::vector<string> &keys_;
+  std::atomic<size_t> *next_index_;
+  std::vector<string> *results_;
+  LatencyStats latency_stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchWorker);
+};
+
+// Prints the total time of each trace span, e.g., Viterbi or each of the
+// predictor aggregations, as the per-stage breakdown.  Each thread keeps only
+// its last Trace::kMaxSpansPerThread spans, so for a large batch this is the
+// breakdown of the last keys.
+void PrintStageBreakdown(std::ostream *os) {
+  std::vector<Trace::SpanRecord> spans;
+  Trace::GetSpans(&spans);
+  std::map<string, std::pair<uint64, uint64>> stages;  // count, ticks
+  for (size_t i = 0; i < spans.size(); ++i) {
+    std::pair<uint64, uint64> &stage = stages[spans[i].name];
+    ++stage.first;
+    stage.second += spans[i].end_ticks - spans[i].begin_ticks;
+  }
+  *os << "stages (" << spans.size() << " spans):" << std::endl;
+  for (const auto &stage : stages) {
+    const uint64 total_usec = PerfCounter::TicksToMicroseconds(
+        stage.second.second);
+    *os << Util::StringPrintf(
+               "  %-48s count=%llu total=%llu avg=%.1f (usec)",
+               stage.first.c_str(),
+               static_cast<unsigned long long>(stage.second.first),
+               static_cast<unsigned long long>(total_usec),
+               static_cast<double>(total_usec) / stage.second.first)
+        << std::endl;
+  }
+}
+
+void RunBatch(Engine *engine) {
+  std::vector<string> keys;
+  {
+    InputFileStream ifs(FLAGS_batch_input.c_str());
+    CHECK(ifs.good()) << "Cannot open " << FLAGS_batch_input;
+    string line;
+    while (!getline(ifs, line).fail()) {
+      Util::ChopReturns(&line);
+      if (!line.empty()) {
+        keys.push_back(line);
+      }
+    }
+  }
+
+  // The engines of the workers share the data with |engine|.
+  const int num_threads = std::max(1, FLAGS_batch_threads);
+  std::vector<std::unique_ptr<Engine>> engines;
+  for (int i = 1; i < num_threads; ++i) {
+    engines.push_back(engine->CreateSibling());
+  }
+  std::atomic<size_t> next_index(0);
+  std::vector<string> results(keys.size());
+  std::vector<std::unique_ptr<BatchWorker>> workers;
+  workers.emplace_back(new BatchWorker(engine->GetConverter(), keys,
+                                       &next_index, &results));
+  for (size_t i = 0; i < engines.size(); ++i) {
+    workers.emplace_back(new BatchWorker(engines[i]->GetConverter(), keys,
+                                         &next_index, &results));
+  }
+
+  Trace::SetEnabled(true);
+  const uint64 begin_ticks = PerfCounter::GetTicks();
+  for (size_t i = 1; i < workers.size(); ++i) {
+    workers[i]->SetJoinable(true);
+    workers[i]->Start("BatchWorker");
+  }
+  workers[0]->Run();
+  for (size_t i = 1; i < workers.size(); ++i) {
+    workers[i]->Join();
+  }
+  const double elapsed_sec =
+      PerfCounter::TicksToMicroseconds(PerfCounter::GetTicks() - begin_ticks) /
+      1e6;
+
+  if (FLAGS_batch_output) {
+    string output;
+    for (size_t i = 0; i < results.size(); ++i) {
+      output += results[i];
+      output += '\n';
+    }
+    std::cout << output;
+  }
+
+  // The stats go to stderr not to be mixed with the results.
+  LatencyStats latency_stats;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    latency_stats.Merge(workers[i]->latency_stats());
+  }
+  std::cerr << Util::StringPrintf(
+                   "%d keys in %.3f sec with %d threads: %.1f keys/sec",
+                   static_cast<int>(keys.size()), elapsed_sec, num_threads,
+                   elapsed_sec > 0 ? keys.size() / elapsed_sec : 0.0)
+            << std::endl;
+  std::cerr << "latency: " << latency_stats.ToString() << std::endl;
+  PrintStageBreakdown(&std::cerr);
+  Trace::SetEnabled(false);
+}
+
 }  // namespace
 }  // namespace mozc
 
@@ -384,7 +624,7 @@ int main(int argc, char **argv) {
     mozc::SystemUtil::SetUserProfileDirectory(FLAGS_user_profile_dir);
   }
 
-  std::unique_ptr<mozc::EngineInterface> engine;
+  std::unique_ptr<mozc::Engine> engine;
   mozc::commands::Request request;
   if (FLAGS_engine == "default") {
     LOG(INFO) << "Using default preference and engine";
@@ -399,6 +639,16 @@ int main(int argc, char **argv) {
   mozc::ConverterInterface *converter = engine->GetConverter();
   CHECK(converter);
 
+  mozc::RewriterProfiler::SetEnabled(FLAGS_profile_rewriters);
+
+  if (!FLAGS_batch_input.empty()) {
+    mozc::RunBatch(engine.get());
+    if (FLAGS_profile_rewriters) {
+      std::cerr << mozc::RewriterProfiler::Dump();
+    }
+    return 0;
+  }
+
   mozc::Segments segments;
   string line;
 
@@ -407,9 +657,16 @@ int main(int argc, char **argv) {
       if (FLAGS_output_debug_string) {
         mozc::PrintSegments(segments, &std::cout);
       }
+      if (FLAGS_output_node_stats) {
+        mozc::PrintNodeStats(*segments.mutable_cached_lattice(), &std::cout);
+      }
     } else {
       std::cout << "ExecCommand() return false" << std::endl;
     }
   }
+
+  if (FLAGS_profile_rewriters) {
+    std::cout << mozc::RewriterProfiler::Dump();
+  }
   return 0;
 }
@@ -30,6 +30,8 @@
 #include "converter/converter_mock.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/port.h"
@@ -349,6 +351,32 @@ bool ConverterMock::StartConversion(Segments *segments,
   }
 }
 
+bool ConverterMock::StartConversionBatch(
+    const std::vector<string> &keys,
+    std::vector<BatchConversionResult> *results) const {
+  VLOG(2) << "mock function: StartConversionBatch";
+  // Converts the keys one by one with the mocked StartConversion().
+  results->clear();
+  results->resize(keys.size());
+  bool success = true;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    Segments segments;
+    BatchConversionResult *result = &(*results)[i];
+    result->success = StartConversion(&segments, keys[i]);
+    success = success && result->success;
+    if (!result->success) {
+      continue;
+    }
+    for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+      const Segment &segment = segments.conversion_segment(j);
+      result->segments.push_back(std::make_pair(
+          segment.key(),
+          segment.candidates_size() > 0 ? segment.candidate(0).value : ""));
+    }
+  }
+  return success;
+}
+
 bool ConverterMock::StartReverseConversion(Segments *segments,
                                            const string &key) const {
   VLOG(2) << "mock function: StartReverseConversion";
@@ -364,6 +392,32 @@ bool ConverterMock::StartReverseConversion(Segments *segments,
   return false;
 }
 
+bool ConverterMock::StartReverseConversionBatch(
+    const std::vector<string> &keys,
+    std::vector<BatchConversionResult> *results) const {
+  VLOG(2) << "mock function: StartReverseConversionBatch";
+  // Converts the keys one by one with the mocked StartReverseConversion().
+  results->clear();
+  results->resize(keys.size());
+  bool success = true;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    Segments segments;
+    BatchConversionResult *result = &(*results)[i];
+    result->success = StartReverseConversion(&segments, keys[i]);
+    success = success && result->success;
+    if (!result->success) {
+      continue;
+    }
+    for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+      const Segment &segment = segments.conversion_segment(j);
+      result->segments.push_back(std::make_pair(
+          segment.key(),
+          segment.candidates_size() > 0 ? segment.candidate(0).value : ""));
+    }
+  }
+  return success;
+}
+
 bool ConverterMock::StartPredictionForRequest(const ConversionRequest &request,
                                               Segments *segments) const {
   VLOG(2) << "mock function: StartPredictionForRequest";
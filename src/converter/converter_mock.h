@@ -113,8 +113,14 @@ class ConverterMock : public ConverterInterface {
                                  Segments *segments) const;
   bool StartConversion(Segments *segments,
                        const string &key) const;
+  bool StartConversionBatch(
+      const std::vector<string> &keys,
+      std::vector<BatchConversionResult> *results) const;
   bool StartReverseConversion(Segments *segments,
                               const string &key) const;
+  bool StartReverseConversionBatch(
+      const std::vector<string> &keys,
+      std::vector<BatchConversionResult> *results) const;
   bool StartPredictionForRequest(const ConversionRequest &request,
                                  Segments *segments) const;
   bool StartPrediction(Segments *segments,
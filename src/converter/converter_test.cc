@@ -34,6 +34,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/port.h"
 #include "base/system_util.h"
 #include "base/util.h"
@@ -154,6 +155,90 @@ class InsertDummyWordsRewriter : public RewriterInterface {
   }
 };
 
+// Log of the learning shared by LearningRewriter and LearningPredictor, which
+// is written by the background learning thread.
+class LearningLog {
+ public:
+  void Add(const string &entry) {
+    scoped_lock l(&mutex_);
+    entries_.push_back(entry);
+  }
+
+  std::vector<string> entries() const {
+    scoped_lock l(&mutex_);
+    return entries_;
+  }
+
+ private:
+  mutable Mutex mutex_;
+  std::vector<string> entries_;
+};
+
+// Learns and syncs slowly and records the number of the learned entries seen
+// by Rewrite().
+class LearningRewriter : public RewriterInterface {
+ public:
+  explicit LearningRewriter(LearningLog *log)
+      : log_(log), num_learned_entries_(0) {}
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    num_learned_entries_ = log_->entries().size();
+    return true;
+  }
+
+  void Finish(const ConversionRequest &request, Segments *segments) override {
+    Util::Sleep(50);
+    log_->Add("rewriter:" + segments->conversion_segment(0).candidate(0).value);
+  }
+
+  bool Sync() override {
+    Util::Sleep(50);
+    log_->Add("rewriter:Sync");
+    return true;
+  }
+
+  bool Reload() override {
+    log_->Add("rewriter:Reload");
+    return true;
+  }
+
+  size_t num_learned_entries() const { return num_learned_entries_; }
+
+ private:
+  LearningLog *log_;
+  mutable size_t num_learned_entries_;
+};
+
+// Learns the committed value with a revert entry and records the reverted
+// keys.
+class LearningPredictor : public StubPredictor {
+ public:
+  explicit LearningPredictor(LearningLog *log) : log_(log) {}
+
+  void Finish(const ConversionRequest &request, Segments *segments) override {
+    const string &value = segments->conversion_segment(0).candidate(0).value;
+    log_->Add("predictor:" + value);
+    Segments::RevertEntry *entry = segments->push_back_revert_entry();
+    entry->id = 1;
+    entry->key = value;
+  }
+
+  void Revert(Segments *segments) override {
+    for (size_t i = 0; i < segments->revert_entries_size(); ++i) {
+      if (segments->revert_entry(i).id == 1) {
+        reverted_keys_.push_back(segments->revert_entry(i).key);
+      }
+    }
+  }
+
+  const std::vector<string> &reverted_keys() const { return reverted_keys_; }
+
+ private:
+  LearningLog *log_;
+  std::vector<string> reverted_keys_;
+};
+
 }  // namespace
 
 class ConverterTest : public ::testing::Test {
@@ -428,6 +513,85 @@ TEST_F(ConverterTest, CanConvertTest) {
   }
 }
 
+TEST_F(ConverterTest, StartConversionBatch) {
+  std::unique_ptr<EngineInterface> engine(MockDataEngineFactory::Create());
+  ConverterInterface *converter = engine->GetConverter();
+  CHECK(converter);
+
+  const char *kKeys[] = {
+    // "おきておきて"
+    "\xe3\x81\x8a\xe3\x81\x8d\xe3\x81\xa6\xe3\x81\x8a\xe3\x81\x8d\xe3\x81\xa6",
+    // "わたしのなまえ"
+    "\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae\xe3\x81\xaa\xe3\x81\xbe"
+    "\xe3\x81\x88",
+    "-",
+  };
+  // More keys than a task converts, so that they are split into ranges.
+  std::vector<string> keys;
+  for (size_t i = 0; i < 50; ++i) {
+    keys.push_back(kKeys[i % arraysize(kKeys)]);
+  }
+  keys.push_back("");
+
+  std::vector<BatchConversionResult> results;
+  // The empty key fails.
+  EXPECT_FALSE(converter->StartConversionBatch(keys, &results));
+  ASSERT_EQ(keys.size(), results.size());
+  EXPECT_FALSE(results.back().success);
+
+  for (size_t i = 0; i + 1 < keys.size(); ++i) {
+    Segments segments;
+    ASSERT_TRUE(converter->StartConversion(&segments, keys[i]));
+    ASSERT_TRUE(results[i].success) << keys[i];
+    ASSERT_EQ(segments.conversion_segments_size(), results[i].segments.size());
+    for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+      const Segment &segment = segments.conversion_segment(j);
+      EXPECT_EQ(segment.key(), results[i].segments[j].first);
+      EXPECT_EQ(segment.candidate(0).value, results[i].segments[j].second);
+    }
+  }
+
+  keys.pop_back();
+  EXPECT_TRUE(converter->StartConversionBatch(keys, &results));
+  EXPECT_EQ(keys.size(), results.size());
+}
+
+TEST_F(ConverterTest, StartReverseConversionBatch) {
+  std::unique_ptr<EngineInterface> engine(MockDataEngineFactory::Create());
+  ConverterInterface *converter = engine->GetConverter();
+  CHECK(converter);
+
+  std::vector<string> keys;
+  // "私の名前"
+  keys.push_back("\xe7\xa7\x81\xe3\x81\xae\xe5\x90\x8d\xe5\x89\x8d");
+  // "記号"
+  keys.push_back("\xe8\xa8\x98\xe5\x8f\xb7");
+  keys.push_back("1+1");
+  keys.push_back("");
+
+  std::vector<BatchConversionResult> results;
+  // The empty key fails.
+  EXPECT_FALSE(converter->StartReverseConversionBatch(keys, &results));
+  ASSERT_EQ(keys.size(), results.size());
+  EXPECT_FALSE(results.back().success);
+
+  for (size_t i = 0; i + 1 < keys.size(); ++i) {
+    Segments segments;
+    ASSERT_TRUE(converter->StartReverseConversion(&segments, keys[i]));
+    ASSERT_TRUE(results[i].success) << keys[i];
+    ASSERT_EQ(segments.conversion_segments_size(), results[i].segments.size());
+    for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+      const Segment &segment = segments.conversion_segment(j);
+      EXPECT_EQ(segment.key(), results[i].segments[j].first);
+      EXPECT_EQ(segment.candidate(0).value, results[i].segments[j].second);
+    }
+  }
+
+  keys.pop_back();
+  EXPECT_TRUE(converter->StartReverseConversionBatch(keys, &results));
+  EXPECT_EQ(keys.size(), results.size());
+}
+
 namespace {
 string ContextAwareConvert(const string &first_key,
                            const string &first_value,
@@ -2100,4 +2264,97 @@ TEST_F(ConverterTest, SuggestionOnlyShouldBeIndependent_Prediction) {
   }
 }
 
+TEST_F(ConverterTest, BackgroundLearning) {
+  std::unique_ptr<ConverterAndData> converter_and_data(
+      CreateStubbedConverterAndData());
+  LearningLog log;
+  LearningRewriter *rewriter = new LearningRewriter(&log);
+  LearningPredictor *predictor = new LearningPredictor(&log);
+  ConverterImpl converter;
+  converter.Init(&converter_and_data->pos_matcher,
+                 converter_and_data->suppression_dictionary.get(),
+                 predictor, rewriter,
+                 converter_and_data->immutable_converter.get());
+  converter.set_background_learning(true);
+
+  const ConversionRequest request;
+  Segments segments;
+  for (const char *value : {"first", "second"}) {
+    segments.clear_conversion_segments();
+    Segment *segment = segments.add_segment();
+    segment->set_key(value);
+    segment->set_segment_type(Segment::FIXED_VALUE);
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->Init();
+    candidate->key = value;
+    candidate->value = value;
+    EXPECT_TRUE(converter.FinishConversion(request, &segments));
+  }
+
+  // The conversion sees all the learning of the previous commits, which is
+  // applied in the order of the commits.
+  EXPECT_TRUE(converter.StartConversion(&segments, "test"));
+  EXPECT_EQ(4, rewriter->num_learned_entries());
+  const std::vector<string> entries = log.entries();
+  ASSERT_EQ(4, entries.size());
+  EXPECT_EQ("rewriter:first", entries[0]);
+  EXPECT_EQ("predictor:first", entries[1]);
+  EXPECT_EQ("rewriter:second", entries[2]);
+  EXPECT_EQ("predictor:second", entries[3]);
+
+  // The revert entries recorded on the background thread are reverted.
+  segments.Clear();
+  Segment *segment = segments.add_segment();
+  segment->set_key("third");
+  segment->set_segment_type(Segment::FIXED_VALUE);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->Init();
+  candidate->key = "third";
+  candidate->value = "third";
+  EXPECT_TRUE(converter.FinishConversion(request, &segments));
+  EXPECT_TRUE(converter.RevertConversion(&segments));
+  ASSERT_EQ(1, predictor->reverted_keys().size());
+  EXPECT_EQ("third", predictor->reverted_keys()[0]);
+  EXPECT_EQ(0, segments.revert_entries_size());
+}
+
+TEST_F(ConverterTest, BackgroundSyncAndReload) {
+  std::unique_ptr<ConverterAndData> converter_and_data(
+      CreateStubbedConverterAndData());
+  LearningLog log;
+  LearningRewriter *rewriter = new LearningRewriter(&log);
+  LearningPredictor *predictor = new LearningPredictor(&log);
+  ConverterImpl converter;
+  converter.Init(&converter_and_data->pos_matcher,
+                 converter_and_data->suppression_dictionary.get(),
+                 predictor, rewriter,
+                 converter_and_data->immutable_converter.get());
+  converter.set_background_learning(true);
+
+  const ConversionRequest request;
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  segment->set_key("first");
+  segment->set_segment_type(Segment::FIXED_VALUE);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->Init();
+  candidate->key = "first";
+  candidate->value = "first";
+  EXPECT_TRUE(converter.FinishConversion(request, &segments));
+
+  // Sync and Reload return without waiting for the slow learning and sync,
+  // and run after the learning in the order of the calls.
+  EXPECT_TRUE(converter.SyncUserData());
+  EXPECT_TRUE(converter.ReloadUserData());
+  EXPECT_GT(4, log.entries().size());
+
+  converter.WaitForPendingLearning();
+  const std::vector<string> entries = log.entries();
+  ASSERT_EQ(4, entries.size());
+  EXPECT_EQ("rewriter:first", entries[0]);
+  EXPECT_EQ("predictor:first", entries[1]);
+  EXPECT_EQ("rewriter:Sync", entries[2]);
+  EXPECT_EQ("rewriter:Reload", entries[3]);
+}
+
 }  // namespace mozc
@@ -45,6 +45,7 @@
         'lattice_test.cc',
         'nbest_generator_test.cc',
         'segments_test.cc',
+        'viterbi_kernel_test.cc',
       ],
       'dependencies': [
         '../composer/composer.gyp:composer',
@@ -69,8 +70,10 @@
         'converter.gyp:converter',
         'converter_base.gyp:connector',
         'converter_base.gyp:converter_mock',
+        'converter_base.gyp:converter_util',
         'converter_base.gyp:segmenter',
         'converter_base.gyp:segments',
+        'converter_base.gyp:viterbi_kernel',
       ],
       'variables': {
         'test_size': 'small',
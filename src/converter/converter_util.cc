@@ -29,6 +29,10 @@
 
 #include "converter/converter_util.h"
 
+#include <string>
+#include <vector>
+
+#include "base/util.h"
 #include "converter/segments.h"
 
 namespace mozc {
@@ -53,4 +57,51 @@ void ConverterUtil::InitSegmentsFromString(const string &key,
   c->content_key = key;
 }
 
+bool ConverterUtil::ResizeSegments(size_t start_segment_index,
+                                   size_t segments_size,
+                                   const uint8 *new_size_array,
+                                   size_t array_size,
+                                   Segments *segments) {
+  const size_t end_segment_index = start_segment_index + segments_size;
+  if (end_segment_index <= start_segment_index ||
+      end_segment_index > segments->segments_size()) {
+    return false;
+  }
+
+  string key;
+  for (size_t i = start_segment_index; i < end_segment_index; ++i) {
+    key += segments->segment(i).key();
+  }
+
+  if (key.empty()) {
+    return false;
+  }
+
+  size_t consumed = 0;
+  const size_t key_len = Util::CharsLen(key);
+  std::vector<string> new_keys;
+  new_keys.reserve(array_size + 1);
+
+  for (size_t i = 0; i < array_size; ++i) {
+    if (new_size_array[i] != 0 && consumed < key_len) {
+      new_keys.push_back(Util::SubString(key, consumed, new_size_array[i]));
+      consumed += new_size_array[i];
+    }
+  }
+  if (consumed < key_len) {
+    new_keys.push_back(Util::SubString(key, consumed, key_len - consumed));
+  }
+
+  segments->erase_segments(start_segment_index, segments_size);
+
+  for (size_t i = 0; i < new_keys.size(); ++i) {
+    Segment *seg = segments->insert_segment(start_segment_index + i);
+    seg->set_segment_type(Segment::FIXED_BOUNDARY);
+    seg->set_key(new_keys[i]);
+  }
+
+  segments->set_resized(true);
+  return true;
+}
+
 }  // namespace mozc
@@ -31,6 +31,7 @@
 #define MOZC_CONVERTER_CONVERTER_UTIL_H_
 
 #include <string>
+
 #include "base/port.h"
 
 namespace mozc {
@@ -48,6 +49,17 @@ class ConverterUtil {
                                      const string &preedit,
                                      Segments *segments);
 
+  // Replaces |segments_size| segments from |start_segment_index| with
+  // FIXED_BOUNDARY segments of the lengths in characters given by
+  // |new_size_array|, and marks |segments| as resized.  The rest of the key
+  // makes the last segment.  The candidates are not made.  Returns false
+  // for an invalid range.
+  static bool ResizeSegments(size_t start_segment_index,
+                             size_t segments_size,
+                             const uint8 *new_size_array,
+                             size_t array_size,
+                             Segments *segments);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(ConverterUtil);
 };
@@ -31,6 +31,7 @@
 // |kCompressedLSize|, |kCompressedRSize|,
 // |kCompressedLIDTable|, |kCompressedRIDTable|,
 // |kSegmenterBitArrayData_size|, |kSegmenterBitArrayData_data|
+// and optionally the packed boundary matrix.
 
 #include "converter/gen_segmenter_bitarray.h"
 
@@ -43,6 +44,7 @@
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/util.h"
+#include "converter/segmenter.h"
 #include "protocol/segmenter_data.pb.h"
 
 namespace mozc {
@@ -111,7 +113,7 @@ class StateTable {
 void SegmenterBitarrayGenerator::GenerateBitarray(
     int lsize, int rsize, IsBoundaryFunc func, const string &output_size_info,
     const string &output_ltable, const string &output_rtable,
-    const string &output_bitarray) {
+    const string &output_bitarray, const string &output_boundary_rows) {
   // Load the original matrix into an array
   std::vector<uint8> array((lsize + 1) * (rsize + 1));
 
@@ -222,6 +224,29 @@ void SegmenterBitarrayGenerator::GenerateBitarray(
     ofs.write(barray.array(), barray.array_size());
     ofs.close();
   }
+  if (!output_boundary_rows.empty()) {
+    // One row per compressed rid, each of which holds the bits for all the
+    // compressed lids.  Rows are zero-padded to the row size.
+    const size_t row_size = Segmenter::GetBoundaryRowSize(kCompressedRSize);
+    string rows(kCompressedLSize * row_size, '\0');
+    for (size_t rid = 0; rid <= lsize; ++rid) {
+      for (size_t lid = 0; lid <= rsize; ++lid) {
+        const int index = rid + lsize * lid;
+        if (array[index] == 0) {
+          continue;
+        }
+        const uint32 bit = rtable.id(lid);
+        uint32 *row = reinterpret_cast<uint32 *>(
+            &rows[ltable.id(rid) * row_size]);
+        row[bit >> 5] |= 0x00000001 << (bit & 0x0000001F);
+      }
+    }
+    mozc::OutputFileStream ofs(output_boundary_rows.c_str(),
+                               ios_base::out | ios_base::binary);
+    CHECK(ofs);
+    ofs.write(rows.data(), rows.size());
+    ofs.close();
+  }
 }
 
 }  // namespace mozc
@@ -39,11 +39,14 @@ namespace mozc {
 class SegmenterBitarrayGenerator {
  public:
   typedef bool (*IsBoundaryFunc)(uint16 rid, uint16 lid);
+  // If |output_boundary_rows| is not empty, the packed boundary matrix (see
+  // Segmenter::GetBoundaryRowSize()) is also written to it.
   static void GenerateBitarray(int lsize, int rsize, IsBoundaryFunc func,
                                const string &output_size_info,
                                const string &output_ltable,
                                const string &output_rtable,
-                               const string &output_bitarray);
+                               const string &output_bitarray,
+                               const string &output_boundary_rows);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(SegmenterBitarrayGenerator);
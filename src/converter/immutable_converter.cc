@@ -41,8 +41,11 @@
 #include "base/port.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/thread_pool.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "config/config_handler.h"
+#include "converter/boundary_constraint_interface.h"
 #include "converter/connector.h"
 #include "converter/key_corrector.h"
 #include "converter/lattice.h"
@@ -52,6 +55,8 @@
 #include "converter/node_list_builder.h"
 #include "converter/segmenter.h"
 #include "converter/segments.h"
+#include "converter/viterbi_kernel.h"
+#include "dictionary/dictionary_impl.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
@@ -60,12 +65,16 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
+#include "usage_stats/usage_stats.h"
 
+using mozc::dictionary::DictionaryImpl;
 using mozc::dictionary::DictionaryInterface;
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::PosGroup;
 using mozc::dictionary::SuppressionDictionary;
 using mozc::dictionary::Token;
+using mozc::dictionary::TokenView;
+using mozc::usage_stats::UsageStats;
 
 namespace mozc {
 namespace {
@@ -89,8 +98,8 @@ class KeyCorrectedNodeListBuilder : public BaseNodeListBuilder {
         key_corrector_(key_corrector),
         tail_(NULL) {}
 
-  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
-                             const Token &token) {
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
     const size_t offset =
         key_corrector_->GetOriginalOffset(pos_, token.key.size());
     if (!KeyCorrector::IsValidPosition(offset) || offset == 0) {
@@ -235,7 +244,32 @@ void NormalizeHistorySegments(Segments *segments) {
   }
 }
 
-Lattice *GetLattice(Segments *segments, bool is_prediction) {
+// Records the size of the lattice for tuning the limit of the nodes.
+void UpdateNodeStats(const Lattice &lattice) {
+  LatticeNodeStats stats;
+  lattice.GetNodeStats(&stats);
+  UsageStats::UpdateTiming("LatticeNodeCount", stats.node_count);
+  UsageStats::UpdateTiming("LatticeNodeReservedKBytes",
+                           stats.reserved_bytes / 1024);
+  if (stats.num_truncations > 0) {
+    UsageStats::IncrementCount("LatticeNodeLookupTruncated");
+  }
+}
+
+bool HasFixedValueSegment(const Segments &segments) {
+  for (size_t i = 0; i < segments.segments_size(); ++i) {
+    if (segments.segment(i).segment_type() == Segment::FIXED_VALUE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the lattice cached in |segments|.  |*is_built| is set to true if the
+// cached lattice can be used as is, i.e., it was built for a resize of the
+// same key and history, and none of the nodes depends on the new boundary.
+Lattice *GetLattice(Segments *segments, bool is_prediction, bool *is_built) {
+  *is_built = false;
   Lattice *lattice = segments->mutable_cached_lattice();
   if (lattice == NULL) {
     return NULL;
@@ -254,6 +288,36 @@ Lattice *GetLattice(Segments *segments, bool is_prediction) {
 
   const size_t lattice_history_end_pos = lattice->history_end_pos();
 
+  // The lattice of a resized conversion has no nodes from KeyCorrector, and
+  // the constrained nodes are made only for FIXED_VALUE segments.  When the
+  // user changes the boundary again, the lookups, the penalties and the
+  // resegmentation would create exactly the same lattice.
+  if (segments->request_type() == Segments::CONVERSION &&
+      segments->resized() &&
+      lattice->reusable_for_resize() &&
+      lattice_history_end_pos == history_key.size() &&
+      lattice->key().size() == history_key.size() + conversion_key.size() &&
+      lattice->key().compare(0, history_key.size(), history_key) == 0 &&
+      lattice->key().compare(history_key.size(), string::npos,
+                             conversion_key) == 0 &&
+      !HasFixedValueSegment(*segments)) {
+    *is_built = true;
+    return lattice;
+  }
+
+  // The conversion of the same key and history, which typically follows the
+  // suggestion when the user presses Space, reuses the dictionary lookups
+  // cached in the lattice.  The other nodes are removed by
+  // Lattice::ResetNodeCost() in MakeLattice().
+  if (segments->request_type() == Segments::CONVERSION &&
+      lattice_history_end_pos == history_key.size() &&
+      lattice->key().size() == history_key.size() + conversion_key.size() &&
+      lattice->key().compare(0, history_key.size(), history_key) == 0 &&
+      lattice->key().compare(history_key.size(), string::npos,
+                             conversion_key) == 0) {
+    return lattice;
+  }
+
   if (!is_prediction ||
       Util::CharsLen(conversion_key) <= 1 ||
       lattice_history_end_pos != history_key.size()) {
@@ -281,6 +345,7 @@ ImmutableConverterImpl::ImmutableConverterImpl(
     const PosGroup *pos_group,
     const SuggestionFilter *suggestion_filter)
     : dictionary_(dictionary),
+      dictionary_impl_(NULL),
       suffix_dictionary_(suffix_dictionary),
       suppression_dictionary_(suppression_dictionary),
       connector_(connector),
@@ -293,7 +358,10 @@ ImmutableConverterImpl::ImmutableConverterImpl(
       number_id_(pos_matcher_->GetNumberId()),
       unknown_id_(pos_matcher_->GetUnknownId()),
       last_to_first_name_transition_cost_(
-          connector_->GetTransitionCost(last_name_id_, first_name_id_)) {
+          connector_->GetTransitionCost(last_name_id_, first_name_id_)),
+      viterbi_beam_width_(0),
+      max_lattice_lookup_threads_(1),
+      boundary_constraint_(NULL) {
   DCHECK(dictionary_);
   DCHECK(suffix_dictionary_);
   DCHECK(suppression_dictionary_);
@@ -640,24 +708,44 @@ bool ImmutableConverterImpl::ResegmentPersonalName(
     const Node *best_last_name_node = NULL;
     const Node *best_first_name_node = NULL;
     int best_cost = 0x7FFFFFFF;
+    std::vector<const Node *> rnodes;
+    std::unique_ptr<bool[]> is_boundary;
+    size_t is_boundary_size = 0;
     for (const Node *lnode = bnode; lnode != NULL; lnode = lnode->bnext) {
       // lnode(last_name) is a prefix of compound, Constraint 1.
       if (compound_node->value.size() > lnode->value.size() &&
           compound_node->key.size() > lnode->key.size() &&
           Util::StartsWith(compound_node->value, lnode->value)) {
         // rnode(first_name) is a suffix of compound, Constraint 1.
+        rnodes.clear();
         for (const Node *rnode = lattice->begin_nodes(pos + lnode->key.size());
              rnode != NULL; rnode = rnode->bnext) {
           if ((lnode->value.size() + rnode->value.size())
               == compound_node->value.size() &&
-              (lnode->value + rnode->value) == compound_node->value &&
-              segmenter_->IsBoundary(*lnode, *rnode, false)) {  // Constraint 3.
-            const int32 cost = lnode->wcost + GetCost(lnode, rnode);
-            if (cost < best_cost) {   // choose the smallest ones
-              best_last_name_node = lnode;
-              best_first_name_node = rnode;
-              best_cost = cost;
-            }
+              (lnode->value + rnode->value) == compound_node->value) {
+            rnodes.push_back(rnode);
+          }
+        }
+        if (rnodes.empty()) {
+          continue;
+        }
+        // Constraint 3, checked for all the candidates of rnode at once.
+        if (is_boundary_size < rnodes.size()) {
+          is_boundary_size = rnodes.size();
+          is_boundary.reset(new bool[is_boundary_size]);
+        }
+        segmenter_->IsBoundary(*lnode, rnodes.data(), rnodes.size(), false,
+                               is_boundary.get());
+        for (size_t i = 0; i < rnodes.size(); ++i) {
+          if (!is_boundary[i]) {
+            continue;
+          }
+          const Node *rnode = rnodes[i];
+          const int32 cost = lnode->wcost + GetCost(lnode, rnode);
+          if (cost < best_cost) {   // choose the smallest ones
+            best_last_name_node = lnode;
+            best_first_name_node = rnode;
+            best_cost = cost;
           }
         }
       }
@@ -744,8 +832,8 @@ class NodeListBuilderWithCacheEnabled : public NodeListBuilderForLookupPrefix {
     DCHECK(allocator);
   }
 
-  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
-                             const Token &token) {
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
     Node *node = NewNodeFromToken(token);
     node->attributes |= Node::ENABLE_CACHE;
     node->raw_wcost = node->wcost;
@@ -756,6 +844,29 @@ class NodeListBuilderWithCacheEnabled : public NodeListBuilderForLookupPrefix {
 
 }  // namespace
 
+template <typename Builder>
+void ImmutableConverterImpl::LookupPrefixWithBuilder(
+    StringPiece key, const ConversionRequest &request, Builder *builder) const {
+  if (dictionary_impl_ != NULL) {
+    dictionary_impl_->LookupPrefixWithFunctor(key, request, builder);
+  } else {
+    dictionary_->LookupPrefix(key, request, builder);
+  }
+}
+
+template <typename Builder>
+void ImmutableConverterImpl::LookupPrefixBatchWithBuilders(
+    StringPiece key, const ConversionRequest &request,
+    const std::vector<Builder *> &builders) const {
+  if (dictionary_impl_ != NULL) {
+    dictionary_impl_->LookupPrefixBatchWithFunctors(key, request, builders);
+  } else {
+    const std::vector<DictionaryInterface::Callback *> callbacks(
+        builders.begin(), builders.end());
+    dictionary_->LookupPrefixBatch(key, request, callbacks);
+  }
+}
+
 Node *ImmutableConverterImpl::Lookup(const int begin_pos,
                                      const int end_pos,
                                      const ConversionRequest &request,
@@ -780,7 +891,7 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos,
       NodeListBuilderWithCacheEnabled builder(
           lattice->node_allocator(),
           lattice->cache_info(begin_pos) + 1);
-      dictionary_->LookupPrefix(StringPiece(begin, len), request, &builder);
+      LookupPrefixWithBuilder(StringPiece(begin, len), request, &builder);
       result_node = builder.result();
       lattice->SetCacheInfo(begin_pos, len);
     } else {
@@ -788,15 +899,132 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos,
       BaseNodeListBuilder builder(
           lattice->node_allocator(),
           lattice->node_allocator()->max_nodes_size());
-      dictionary_->LookupPrefix(StringPiece(begin, len), request, &builder);
+      LookupPrefixWithBuilder(StringPiece(begin, len), request, &builder);
       result_node = builder.result();
     }
   }
-  return AddCharacterTypeBasedNodes(begin, end, lattice, result_node);
+  return AddCharacterTypeBasedNodes(begin, end, lattice->node_allocator(),
+                                    result_node);
+}
+
+namespace {
+
+// The minimum number of characters to look up on a thread in
+// LookupPrefixNodes().
+const size_t kMinLookupCharsPerThread = 16;
+
+}  // namespace
+
+void ImmutableConverterImpl::LookupPrefixNodes(
+    size_t begin_pos,
+    const ConversionRequest &request,
+    bool is_prediction,
+    Lattice *lattice,
+    std::vector<Node *> *nodes) const {
+  const string &key = lattice->key();
+  DCHECK_LE(begin_pos, key.size());
+  nodes->assign(key.size() - begin_pos, NULL);
+
+  std::vector<size_t> char_positions;
+  for (size_t pos = begin_pos; pos < key.size();
+       pos += Util::OneCharLen(key.data() + pos)) {
+    char_positions.push_back(pos);
+  }
+
+  lattice->node_allocator()->set_max_nodes_size(8192);
+  const size_t num_threads =
+      min(max_lattice_lookup_threads_,
+          char_positions.size() / kMinLookupCharsPerThread);
+  if (num_threads <= 1) {
+    LookupPrefixBatch(begin_pos, key.size(), request, is_prediction,
+                      *lattice, lattice->node_allocator(), nodes->data());
+  } else {
+    // Split the positions into ranges of the same number of characters.
+    std::vector<size_t> range_begins(num_threads + 1);
+    for (size_t i = 0; i < num_threads; ++i) {
+      range_begins[i] = char_positions[char_positions.size() * i / num_threads];
+    }
+    range_begins[num_threads] = key.size();
+
+    ThreadPool *pool = ThreadPool::GetSharedInstance();
+    std::vector<ThreadPool::TaskHandle> tasks;
+    for (size_t i = 1; i < num_threads; ++i) {
+      NodeAllocator *allocator = lattice->node_allocator_shard(i - 1);
+      allocator->set_max_nodes_size(8192);
+      const size_t range_begin = range_begins[i];
+      const size_t range_end = range_begins[i + 1];
+      Node **range_nodes = nodes->data() + (range_begin - begin_pos);
+      tasks.push_back(pool->Schedule(
+          ThreadPool::INTERACTIVE,
+          [this, range_begin, range_end, &request, is_prediction, lattice,
+           allocator, range_nodes]() {
+            LookupPrefixBatch(range_begin, range_end, request, is_prediction,
+                              *lattice, allocator, range_nodes);
+          }));
+    }
+    LookupPrefixBatch(range_begins[0], range_begins[1], request, is_prediction,
+                      *lattice, lattice->node_allocator(), nodes->data());
+    // A range which no worker has taken yet runs on this thread.
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      tasks[i]->Wait();
+    }
+  }
+
+  if (is_prediction) {
+    for (size_t i = 0; i < char_positions.size(); ++i) {
+      lattice->SetCacheInfo(char_positions[i],
+                            key.size() - char_positions[i]);
+    }
+  }
+}
+
+void ImmutableConverterImpl::LookupPrefixBatch(
+    size_t begin_pos, size_t end_pos,
+    const ConversionRequest &request,
+    bool is_prediction,
+    const Lattice &lattice,
+    NodeAllocator *allocator,
+    Node **nodes) const {
+  const string &key = lattice.key();
+  DCHECK_LE(begin_pos, end_pos);
+  DCHECK_LE(end_pos, key.size());
+  const StringPiece suffix = StringPiece(key).substr(begin_pos);
+  const size_t size = end_pos - begin_pos;
+
+  // All the builders of a call have the same type so that they are called
+  // through the functor interface of DictionaryImpl.
+  std::vector<std::unique_ptr<BaseNodeListBuilder>> builders(size);
+  if (is_prediction) {
+    std::vector<NodeListBuilderWithCacheEnabled *> callbacks(size, NULL);
+    for (size_t i = 0; i < size; i += Util::OneCharLen(suffix.data() + i)) {
+      callbacks[i] = new NodeListBuilderWithCacheEnabled(
+          allocator, lattice.cache_info(begin_pos + i) + 1);
+      builders[i].reset(callbacks[i]);
+    }
+    LookupPrefixBatchWithBuilders(suffix, request, callbacks);
+  } else {
+    std::vector<BaseNodeListBuilder *> callbacks(size, NULL);
+    for (size_t i = 0; i < size; i += Util::OneCharLen(suffix.data() + i)) {
+      callbacks[i] =
+          new BaseNodeListBuilder(allocator, allocator->max_nodes_size());
+      builders[i].reset(callbacks[i]);
+    }
+    LookupPrefixBatchWithBuilders(suffix, request, callbacks);
+  }
+
+  for (size_t i = 0; i < size; ++i) {
+    if (builders[i] == NULL) {
+      continue;
+    }
+    nodes[i] = AddCharacterTypeBasedNodes(
+        suffix.data() + i, key.data() + key.size(), allocator,
+        builders[i]->result());
+  }
 }
 
 Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(
-    const char *begin, const char *end, Lattice *lattice, Node *nodes) const {
+    const char *begin, const char *end, NodeAllocator *allocator,
+    Node *nodes) const {
 
   size_t mblen = 0;
   const char32 ucs4 = Util::UTF8ToUCS4(begin, end, &mblen);
@@ -806,7 +1034,7 @@ Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(
 
   // Add 1 character node. It can be either UnknownId or NumberId.
   {
-    Node *new_node = lattice->NewNode();
+    Node *new_node = allocator->NewNode();
     CHECK(new_node);
     if (first_script_type == Util::NUMBER) {
       new_node->lid = number_id_;
@@ -849,7 +1077,7 @@ Node *ImmutableConverterImpl::AddCharacterTypeBasedNodes(
 
   if (num_char > 1) {
     mblen = static_cast<uint32>(p - begin);
-    Node *new_node = lattice->NewNode();
+    Node *new_node = allocator->NewNode();
     CHECK(new_node);
     if (first_script_type == Util::NUMBER) {
       new_node->lid = number_id_;
@@ -879,9 +1107,21 @@ const int kVeryBigCost = (INT_MAX >> 2);
 // are the next boundary looked from pos. (If pos is on the boundary,
 // left_boundary should be the previous one, and right_boundary should be
 // the next).
-inline void ViterbiInternal(
+// |transition_costs| is a scratch buffer reused across positions.
+// If |beam_width| is positive, only that many cheapest lnodes are used.
+// Returns the number of lnodes pruned by the beam.
+inline size_t ViterbiInternal(
     const Connector &connector, size_t pos, size_t right_boundary,
-    Lattice *lattice) {
+    size_t beam_width, Lattice *lattice,
+    std::vector<int32> *transition_costs) {
+  // All the nodes ending at |pos| have been relaxed at this point, so their
+  // costs are fixed.  Only valid lnodes (prev != NULL) are in the column.
+  const EndNodeColumn &lnodes = lattice->BuildEndNodeColumn(pos);
+  const size_t num_pruned =
+      (beam_width > 0) ? lattice->PruneEndNodeColumn(pos, beam_width) : 0;
+  if (transition_costs->size() < lnodes.size()) {
+    transition_costs->resize(lnodes.size());
+  }
   for (Node *rnode = lattice->begin_nodes(pos);
        rnode != NULL; rnode = rnode->bnext) {
     if (rnode->end_pos > right_boundary) {
@@ -905,31 +1145,23 @@ inline void ViterbiInternal(
     }
 
     // Find a valid node which connects to the rnode with minimum cost.
-    int best_cost = kVeryBigCost;
-    Node *best_node = NULL;
-    for (Node *lnode = lattice->end_nodes(pos);
-         lnode != NULL; lnode = lnode->enext) {
-      if (lnode->prev == NULL) {
-        // Invalid lnode.
-        continue;
-      }
-
-      int cost =
-          lnode->cost + connector.GetTransitionCost(lnode->rid, rnode->lid);
-      if (cost < best_cost) {
-        best_cost = cost;
-        best_node = lnode;
-      }
-    }
-
-    rnode->prev = best_node;
+    connector.GetTransitionCosts(lnodes.rid.data(), lnodes.size(), rnode->lid,
+                                 transition_costs->data());
+    int32 best_cost = kVeryBigCost;
+    const int best = ViterbiKernel::FindBestLeftNode(
+        lnodes.cost.data(), transition_costs->data(), lnodes.size(),
+        &best_cost);
+
+    rnode->prev = (best < 0) ? NULL : lnodes.node[best];
     rnode->cost = best_cost + rnode->wcost;
   }
+  return num_pruned;
 }
 }  // namespace
 
 bool ImmutableConverterImpl::Viterbi(
     const Segments &segments, Lattice *lattice) const {
+  MOZC_TRACE_SPAN("ImmutableConverter::Viterbi");
   const string &key = lattice->key();
 
   // Process BOS.
@@ -960,6 +1192,8 @@ bool ImmutableConverterImpl::Viterbi(
 
   size_t left_boundary = 0;
   const size_t segments_size = segments.segments_size();
+  std::vector<int32> transition_costs;
+  size_t num_pruned = 0;
 
   // Specialization for the first segment.
   // Don't run on the left boundary (the connection with BOS node),
@@ -968,7 +1202,9 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(0).key().size();
     for (size_t pos = left_boundary + 1; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      num_pruned += ViterbiInternal(*connector_, pos, right_boundary,
+                                    viterbi_beam_width_, lattice,
+                                    &transition_costs);
     }
     left_boundary = right_boundary;
   }
@@ -979,11 +1215,19 @@ bool ImmutableConverterImpl::Viterbi(
     const size_t right_boundary =
         left_boundary + segments.segment(i).key().size();
     for (size_t pos = left_boundary; pos < right_boundary; ++pos) {
-      ViterbiInternal(*connector_, pos, right_boundary, lattice);
+      num_pruned += ViterbiInternal(*connector_, pos, right_boundary,
+                                    viterbi_beam_width_, lattice,
+                                    &transition_costs);
     }
     left_boundary = right_boundary;
   }
 
+  if (num_pruned > 0) {
+    VLOG(2) << num_pruned << " nodes are pruned by the beam of width "
+            << viterbi_beam_width_;
+    UsageStats::IncrementCount("ViterbiBeamPruned");
+  }
+
   // Process EOS.
   {
     Node *eos_node = lattice->eos_nodes();
@@ -998,25 +1242,16 @@ bool ImmutableConverterImpl::Viterbi(
     left_boundary =
         key.size() - segments.segment(segments_size - 1).key().size();
     // Find a valid node which connects to the rnode with minimum cost.
-    int best_cost = kVeryBigCost;
-    Node *best_node = NULL;
-    for (Node *lnode = lattice->end_nodes(key.size());
-         lnode != NULL; lnode = lnode->enext) {
-      if (lnode->prev == NULL) {
-        // Invalid lnode.
-        continue;
-      }
-
-      int cost =
-          lnode->cost +
-          connector_->GetTransitionCost(lnode->rid, eos_node->lid);
-      if (cost < best_cost) {
-        best_cost = cost;
-        best_node = lnode;
-      }
-    }
-
-    eos_node->prev = best_node;
+    const EndNodeColumn &lnodes = lattice->BuildEndNodeColumn(key.size());
+    transition_costs.resize(lnodes.size());
+    connector_->GetTransitionCosts(lnodes.rid.data(), lnodes.size(),
+                                   eos_node->lid, transition_costs.data());
+    int32 best_cost = kVeryBigCost;
+    const int best = ViterbiKernel::FindBestLeftNode(
+        lnodes.cost.data(), transition_costs.data(), lnodes.size(),
+        &best_cost);
+
+    eos_node->prev = (best < 0) ? NULL : lnodes.node[best];
     eos_node->cost = best_cost + eos_node->wcost;
   }
 
@@ -1067,8 +1302,33 @@ bool ImmutableConverterImpl::PredictionViterbi(
   for (size_t i = 0; i < history_segments_size; ++i) {
     history_length += segments.segment(i).key().size();
   }
-  PredictionViterbiInternal(0, history_length, lattice);
-  PredictionViterbiInternal(history_length, key_length, lattice);
+  // When the lattice is reused from the previous keystroke, the forward costs
+  // of the unchanged nodes are restored and only the positions affected by
+  // new or modified nodes are relaxed.  The order of the relaxation is the
+  // same as running the two passes below over all the positions.
+  std::vector<size_t> positions_to_relax;
+  const size_t resume_pos = lattice->RestoreForwardCosts(&positions_to_relax);
+  for (size_t i = 0; i < positions_to_relax.size(); ++i) {
+    if (positions_to_relax[i] <= history_length) {
+      PredictionViterbiInternal(positions_to_relax[i], positions_to_relax[i],
+                                history_length, lattice);
+    }
+  }
+  if (resume_pos <= history_length) {
+    PredictionViterbiInternal(resume_pos, history_length, history_length,
+                              lattice);
+  }
+  for (size_t i = 0; i < positions_to_relax.size(); ++i) {
+    if (positions_to_relax[i] >= history_length) {
+      PredictionViterbiInternal(positions_to_relax[i], positions_to_relax[i],
+                                key_length, lattice);
+    }
+  }
+  if (resume_pos <= key_length) {
+    PredictionViterbiInternal(max(resume_pos, history_length), key_length,
+                              key_length, lattice);
+  }
+  lattice->SaveForwardCosts();
 
   Node *node = lattice->eos_nodes();
   CHECK(node->bnext == NULL);
@@ -1088,8 +1348,10 @@ bool ImmutableConverterImpl::PredictionViterbi(
 }
 
 void ImmutableConverterImpl::PredictionViterbiInternal(
-    int calc_begin_pos, int calc_end_pos, Lattice *lattice) const {
+    int calc_begin_pos, int calc_end_pos, int right_boundary,
+    Lattice *lattice) const {
   CHECK_LE(calc_begin_pos, calc_end_pos);
+  CHECK_LE(calc_end_pos, right_boundary);
 
   // Mapping from lnode's rid to (cost, Node) of best way/cost, and vice versa.
   // Note that, the average number of lid/rid variation is less than 30 in
@@ -1100,6 +1362,8 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
   BestMap lbest, rbest;
   lbest.reserve(128);
   rbest.reserve(128);
+  std::vector<uint16> lrids;
+  std::vector<int32> lcosts, transition_costs;
 
   const std::pair<int, Node*> kInvalidValue(INT_MAX, static_cast<Node*>(NULL));
 
@@ -1127,7 +1391,7 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
     rbest.clear();
     Node *rnode_begin = lattice->begin_nodes(pos);
     for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
-      if (rnode->end_pos > calc_end_pos) {
+      if (rnode->end_pos > right_boundary) {
         continue;
       }
       BestMap::value_type key(rnode->lid, kInvalidValue);
@@ -1142,21 +1406,30 @@ void ImmutableConverterImpl::PredictionViterbiInternal(
       continue;
     }
 
-    for (BestMap::iterator liter = lbest.begin();
-         liter != lbest.end(); ++liter) {
-      for (BestMap::iterator riter = rbest.begin();
-           riter != rbest.end(); ++riter) {
-        const int cost = liter->second.first +
-            connector_->GetTransitionCost(liter->first, riter->first);
-        if (cost < riter->second.first) {
-          riter->second.first = cost;
-          riter->second.second = liter->second.second;
-        }
+    // Lay out lbest as arrays to relax each rid group with the vectorized
+    // kernel.  The result is the same as relaxing in the order of lbest.
+    lrids.resize(lbest.size());
+    lcosts.resize(lbest.size());
+    transition_costs.resize(lbest.size());
+    for (size_t i = 0; i < lbest.size(); ++i) {
+      lrids[i] = lbest[i].first;
+      lcosts[i] = lbest[i].second.first;
+    }
+    for (BestMap::iterator riter = rbest.begin();
+         riter != rbest.end(); ++riter) {
+      connector_->GetTransitionCosts(lrids.data(), lrids.size(), riter->first,
+                                     transition_costs.data());
+      int32 best_cost = riter->second.first;
+      const int best = ViterbiKernel::FindBestLeftNode(
+          lcosts.data(), transition_costs.data(), lcosts.size(), &best_cost);
+      if (best >= 0) {
+        riter->second.first = best_cost;
+        riter->second.second = lbest[best].second.second;
       }
     }
 
     for (Node *rnode = rnode_begin; rnode != NULL; rnode = rnode->bnext) {
-      if (rnode->end_pos > calc_end_pos) {
+      if (rnode->end_pos > right_boundary) {
         continue;
       }
       BestMap::value_type key(rnode->lid, kInvalidValue);
@@ -1184,8 +1457,8 @@ class NodeListBuilderForPredictiveNodes : public BaseNodeListBuilder {
 
   virtual ~NodeListBuilderForPredictiveNodes() {}
 
-  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
-                             const Token &token) {
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
     Node *node = NewNodeFromToken(token);
     const int kPredictiveNodeDefaultPenalty = 900;  // ~= -500 * log(1/6)
     int additional_cost = kPredictiveNodeDefaultPenalty;
@@ -1296,6 +1569,17 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
   }
 }
 
+void ImmutableConverterImpl::BeginReverseConversionBatch(
+    StringPiece values) const {
+  // MakeLattice() populates the cache for each sentence, which is a nested
+  // call covered by this one.
+  dictionary_->PopulateReverseLookupCache(values);
+}
+
+void ImmutableConverterImpl::EndReverseConversionBatch() const {
+  dictionary_->ClearReverseLookupCache();
+}
+
 bool ImmutableConverterImpl::MakeLattice(
     const ConversionRequest &request,
     Segments *segments, Lattice *lattice) const {
@@ -1581,13 +1865,22 @@ void ImmutableConverterImpl::MakeLatticeNodesForConversionSegments(
 
   const bool is_reverse =
       (segments.request_type() == Segments::REVERSE_CONVERSION);
-  const bool is_prediction =
-      (segments.request_type() == Segments::SUGGESTION ||
-       segments.request_type() == Segments::PREDICTION);
+  // The lookups of the conversion are also cached in the lattice so that
+  // they are shared with the suggestion of the same key.  See GetLattice().
+  const bool use_lookup_cache = !is_reverse;
+  std::vector<Node *> prefix_nodes;
+  if (!is_reverse) {
+    LookupPrefixNodes(history_key.size(), request, use_lookup_cache, lattice,
+                      &prefix_nodes);
+  }
   for (size_t pos = history_key.size(); pos < key.size(); ++pos) {
     if (lattice->end_nodes(pos) != NULL) {
       Node *rnode =
-          Lookup(pos, key.size(), request, is_reverse, is_prediction, lattice);
+          is_reverse ? NULL : prefix_nodes[pos - history_key.size()];
+      if (rnode == NULL) {
+        rnode = Lookup(pos, key.size(), request, is_reverse, use_lookup_cache,
+                       lattice);
+      }
       // If history key is NOT empty and user input seems to starts with
       // a particle ("はにで..."), mark the node as STARTS_WITH_PARTICLE.
       // We change the segment boundary if STARTS_WITH_PARTICLE attribute
@@ -1957,17 +2250,83 @@ void ImmutableConverterImpl::MakeGroup(
   group->push_back(static_cast<uint16>(segments.segments_size()));
 }
 
+bool ImmutableConverterImpl::ApplyBoundaryConstraint(
+    const ConversionRequest &request,
+    const Lattice &lattice,
+    const std::vector<uint16> &group,
+    Segments *segments) const {
+  if (boundary_constraint_ == NULL ||
+      segments->request_type() != Segments::CONVERSION ||
+      segments->resized()) {
+    return false;
+  }
+  const size_t history_segments_size = segments->history_segments_size();
+  std::vector<string> original_keys;
+  for (size_t i = history_segments_size; i < segments->segments_size(); ++i) {
+    if (segments->segment(i).segment_type() != Segment::FREE) {
+      return false;
+    }
+    original_keys.push_back(segments->segment(i).key());
+  }
+
+  // Split the key at the segment boundaries in the same way as
+  // InsertCandidates().
+  const Node *prev = lattice.bos_nodes();
+  for (const Node *node = lattice.bos_nodes()->next;
+       node->next != NULL && node->node_type == Node::HIS_NODE;
+       node = node->next) {
+    prev = node;
+  }
+  std::vector<string> keys;
+  size_t begin_pos = string::npos;
+  for (const Node *node = prev->next; node->next != NULL; node = node->next) {
+    if (begin_pos == string::npos) {
+      begin_pos = node->begin_pos;
+    }
+    if (!IsSegmentEndNode(*segments, node, group, false)) {
+      continue;
+    }
+    keys.push_back(lattice.key().substr(begin_pos,
+                                        node->end_pos - begin_pos));
+    begin_pos = string::npos;
+  }
+
+  segments->erase_segments(history_segments_size, original_keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    segments->add_segment()->set_key(keys[i]);
+  }
+  if (boundary_constraint_->ConstrainBoundaries(request, segments)) {
+    return true;
+  }
+
+  segments->erase_segments(history_segments_size,
+                           segments->conversion_segments_size());
+  for (size_t i = 0; i < original_keys.size(); ++i) {
+    segments->add_segment()->set_key(original_keys[i]);
+  }
+  return false;
+}
+
 bool ImmutableConverterImpl::ConvertForRequest(
     const ConversionRequest &request, Segments *segments) const {
   const bool is_prediction =
       (segments->request_type() == Segments::PREDICTION ||
        segments->request_type() == Segments::SUGGESTION);
 
-  Lattice *lattice = GetLattice(segments, is_prediction);
+  bool is_built = false;
+  Lattice *lattice = GetLattice(segments, is_prediction, &is_built);
 
-  if (!MakeLattice(request, segments, lattice)) {
-    LOG(WARNING) << "could not make lattice";
-    return false;
+  if (is_built) {
+    lattice->ResetViterbiState();
+  } else {
+    if (!MakeLattice(request, segments, lattice)) {
+      LOG(WARNING) << "could not make lattice";
+      return false;
+    }
+    lattice->set_reusable_for_resize(
+        segments->request_type() == Segments::CONVERSION &&
+        segments->resized() && !HasFixedValueSegment(*segments));
+    UpdateNodeStats(*lattice);
   }
 
   std::vector<uint16> group;
@@ -1983,6 +2342,11 @@ bool ImmutableConverterImpl::ConvertForRequest(
       LOG(WARNING) << "viterbi failed";
       return false;
     }
+    if (ApplyBoundaryConstraint(request, *lattice, group, segments)) {
+      // |segments| is resized now, so this doesn't recurse again.
+      DCHECK(segments->resized());
+      return ConvertForRequest(request, segments);
+    }
   }
 
   VLOG(2) << lattice->DebugString();
@@ -48,12 +48,18 @@
 namespace mozc {
 
 struct Node;
+class BoundaryConstraintInterface;
 class ImmutableConverterInterface;
 class Lattice;
 class NBestGenerator;
+class NodeAllocator;
 class Segmenter;
 class SuggestionFilter;
 
+namespace dictionary {
+class DictionaryImpl;
+}  // namespace dictionary
+
 class ImmutableConverterImpl : public ImmutableConverterInterface {
  public:
   ImmutableConverterImpl(
@@ -69,6 +75,66 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
 
   virtual bool ConvertForRequest(
       const ConversionRequest &request, Segments *segments) const;
+  virtual void BeginReverseConversionBatch(StringPiece values) const;
+  virtual void EndReverseConversionBatch() const;
+
+  // Beam-pruned Viterbi for very long inputs.  When |width| is positive, the
+  // forward search of conversion considers only the |width| cheapest nodes
+  // ending at each position as left nodes, so the cost of relaxing a
+  // position is bounded by |width| times the number of nodes beginning
+  // there instead of growing with the lattice density.  The trade-off is
+  // that the best path is no longer guaranteed: a path through an expensive
+  // prefix that would become the cheapest by a good connection later is
+  // lost.  Pruned nodes keep their costs, so they can still appear in the
+  // N-best candidates.  Prediction is not affected as it already collapses
+  // the left nodes by rid.  Each conversion in which pruning happens is
+  // counted as "ViterbiBeamPruned" in usage stats.  0 (the default)
+  // disables pruning.
+  void set_viterbi_beam_width(size_t width) { viterbi_beam_width_ = width; }
+  size_t viterbi_beam_width() const { return viterbi_beam_width_; }
+
+  // Parallel lattice construction for long inputs.  When |num_threads| is
+  // more than 1, the dictionary lookups for the conversion key are split into
+  // up to |num_threads| ranges of start positions.  The calling thread takes
+  // the first range and a task on the shared ThreadPool takes each of the
+  // rest, allocating nodes from its own Lattice::node_allocator_shard().  At
+  // most one range is made per 16 characters, as a task costs more than it
+  // saves for shorter ranges.  The node lists are inserted into
+  // the lattice in the order of positions after all the workers finish, so
+  // the lattice is the same as the one built sequentially.
+  //
+  // The dictionaries must be safe for concurrent reads.  This holds for the
+  // dictionaries used by the converter: SystemDictionary and ValueDictionary
+  // only read immutable data for prefix lookups (the mutable reverse lookup
+  // cache isn't used), UserDictionary takes its reader lock for each lookup,
+  // and SuppressionDictionary is only read while not locked for update.
+  // Reverse conversion always runs sequentially.  1 (the default) disables
+  // the parallel mode.
+  void set_max_lattice_lookup_threads(size_t num_threads) {
+    max_lattice_lookup_threads_ = num_threads;
+  }
+  size_t max_lattice_lookup_threads() const {
+    return max_lattice_lookup_threads_;
+  }
+
+  // Lets the lattice lookups call the node list builders through the
+  // functor interface of DictionaryImpl, which avoids the virtual dispatch of
+  // the callback methods for every key and token.  |dictionary_impl| must be
+  // the dictionary passed to the constructor.  NULL (the default) uses the
+  // virtual DictionaryInterface, e.g., for mock dictionaries.
+  void set_dictionary_impl(const dictionary::DictionaryImpl *dictionary_impl) {
+    dictionary_impl_ = dictionary_impl;
+  }
+
+  // Lets |boundary_constraint| adjust the segment boundaries of the best path
+  // of a conversion before the candidates are made.  When it changes them,
+  // the lattice is searched again with the new boundaries, which saves making
+  // the candidates of the discarded segmentation.  NULL (the default)
+  // disables it.
+  void set_boundary_constraint(
+      const BoundaryConstraintInterface *boundary_constraint) {
+    boundary_constraint_ = boundary_constraint;
+  }
 
  private:
   FRIEND_TEST(ImmutableConverterTest, AddPredictiveNodes);
@@ -106,8 +172,40 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
                bool is_reverse,
                bool is_prediction,
                Lattice *lattice) const;
+  // Looks up the prefixes of the lattice key from every character position
+  // in [begin_pos, key size), in parallel if enabled.  (*nodes)[i] is set to
+  // the same node list as Lookup(begin_pos + i, ...) returns, or NULL if the
+  // position is in the middle of a character.
+  void LookupPrefixNodes(size_t begin_pos,
+                         const ConversionRequest &request,
+                         bool is_prediction,
+                         Lattice *lattice,
+                         std::vector<Node *> *nodes) const;
+  // Does the lookups of LookupPrefixNodes() for the start positions in
+  // [begin_pos, end_pos) in one dictionary call, allocating the nodes from
+  // |allocator|.  nodes[i] is for begin_pos + i.  Doesn't modify |lattice|,
+  // so it can run on a worker thread.
+  void LookupPrefixBatch(size_t begin_pos, size_t end_pos,
+                         const ConversionRequest &request,
+                         bool is_prediction,
+                         const Lattice &lattice,
+                         NodeAllocator *allocator,
+                         Node **nodes) const;
+  // Calls LookupPrefix() or LookupPrefixBatch() of dictionary_ through
+  // dictionary_impl_ if available.  Defined in the .cc file as the builders
+  // are local to it.
+  template <typename Builder>
+  void LookupPrefixWithBuilder(StringPiece key,
+                               const ConversionRequest &request,
+                               Builder *builder) const;
+  template <typename Builder>
+  void LookupPrefixBatchWithBuilders(StringPiece key,
+                                     const ConversionRequest &request,
+                                     const std::vector<Builder *> &builders)
+      const;
   Node *AddCharacterTypeBasedNodes(const char *begin, const char *end,
-                                   Lattice *lattice, Node *nodes) const;
+                                   NodeAllocator *allocator,
+                                   Node *nodes) const;
 
   void Resegment(const Segments &segments,
                  const string &history_key, const string &conversion_key,
@@ -140,8 +238,11 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   bool Viterbi(const Segments &segments, Lattice *lattice) const;
 
   bool PredictionViterbi(const Segments &segments, Lattice *lattice) const;
+  // Relaxes the nodes beginning at [calc_begin_pos, calc_end_pos] and ending
+  // at or before |right_boundary|.
   void PredictionViterbiInternal(
-      int calc_begin_pos, int calc_end_pos, Lattice *lattice) const;
+      int calc_begin_pos, int calc_end_pos, int right_boundary,
+      Lattice *lattice) const;
 
   // TODO(toshiyuki): Change parameter order for mutable |segments|.
 
@@ -183,6 +284,14 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
 
   void MakeGroup(const Segments &segments, std::vector<uint16> *group) const;
 
+  // Replaces the conversion segments with the segments of the best path and
+  // calls |boundary_constraint_|.  Returns true if it changes the boundaries.
+  // Otherwise restores the conversion segments and returns false.
+  bool ApplyBoundaryConstraint(const ConversionRequest &request,
+                               const Lattice &lattice,
+                               const std::vector<uint16> &group,
+                               Segments *segments) const;
+
   inline int GetCost(const Node *lnode, const Node *rnode) const {
     const int kInvalidPenaltyCost = 100000;
     if (rnode->constrained_prev != NULL && lnode != rnode->constrained_prev) {
@@ -192,6 +301,7 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   }
 
   const dictionary::DictionaryInterface *dictionary_;
+  const dictionary::DictionaryImpl *dictionary_impl_;
   const dictionary::DictionaryInterface *suffix_dictionary_;
   const dictionary::SuppressionDictionary *suppression_dictionary_;
   const Connector *connector_;
@@ -209,6 +319,14 @@ class ImmutableConverterImpl : public ImmutableConverterInterface {
   // Cache for transition cost.
   const int32 last_to_first_name_transition_cost_;
 
+  // Max number of left nodes per position in Viterbi().  0 means no limit.
+  size_t viterbi_beam_width_;
+
+  // Max number of threads for the dictionary lookups in MakeLattice().
+  size_t max_lattice_lookup_threads_;
+
+  const BoundaryConstraintInterface *boundary_constraint_;
+
   DISALLOW_COPY_AND_ASSIGN(ImmutableConverterImpl);
 };
 
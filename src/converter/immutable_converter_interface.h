@@ -30,6 +30,8 @@
 #ifndef MOZC_CONVERTER_IMMUTABLE_CONVERTER_INTERFACE_H_
 #define MOZC_CONVERTER_IMMUTABLE_CONVERTER_INTERFACE_H_
 
+#include "base/string_piece.h"
+
 namespace mozc {
 
 class ConversionRequest;
@@ -54,6 +56,13 @@ class ImmutableConverterInterface {
   virtual bool ConvertForRequest(
       const ConversionRequest &request, Segments *segments) const;
 
+  // Prepares the dictionary lookups for the reverse conversions of the
+  // substrings of |values| until EndReverseConversionBatch() is called, so
+  // that a batch of reverse conversions doesn't prepare them for each
+  // sentence.  The calls can be nested.
+  virtual void BeginReverseConversionBatch(StringPiece values) const {}
+  virtual void EndReverseConversionBatch() const {}
+
  protected:
   ImmutableConverterInterface() {}
 };
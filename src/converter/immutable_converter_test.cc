@@ -40,7 +40,9 @@
 #include "base/system_util.h"
 #include "base/util.h"
 #include "config/config_handler.h"
+#include "converter/boundary_constraint_interface.h"
 #include "converter/connector.h"
+#include "converter/converter_util.h"
 #include "converter/lattice.h"
 #include "converter/segmenter.h"
 #include "converter/segments.h"
@@ -59,6 +61,8 @@
 #include "request/conversion_request.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
+#include "usage_stats/usage_stats.h"
+#include "usage_stats/usage_stats_testing_util.h"
 
 using mozc::dictionary::DictionaryImpl;
 using mozc::dictionary::DictionaryInterface;
@@ -69,6 +73,7 @@ using mozc::dictionary::SuppressionDictionary;
 using mozc::dictionary::SystemDictionary;
 using mozc::dictionary::UserDictionaryStub;
 using mozc::dictionary::ValueDictionary;
+using mozc::usage_stats::UsageStats;
 
 namespace mozc {
 namespace {
@@ -162,6 +167,10 @@ class MockDataAndImmutableConverter {
     return immutable_converter_.get();
   }
 
+  const DictionaryInterface *GetDictionary() {
+    return dictionary_.get();
+  }
+
  private:
   std::unique_ptr<const DataManagerInterface> data_manager_;
   std::unique_ptr<const SuppressionDictionary> suppression_dictionary_;
@@ -522,6 +531,418 @@ TEST(ImmutableConverterTest, HistoryKeyLengthIsVeryLong) {
   EXPECT_EQ(kRequestKey, segments.segment(0).key());
 }
 
+namespace {
+string GetTopValues(const Segments &segments) {
+  string values;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    if (segment.candidates_size() > 0) {
+      values += segment.candidate(0).value;
+    }
+    values += "|";
+  }
+  return values;
+}
+
+void SetUpConversionSegments(const string &key, Segments *segments) {
+  segments->clear_segments();
+  segments->set_request_type(Segments::CONVERSION);
+  segments->add_segment()->set_key(key);
+}
+}  // namespace
+
+TEST(ImmutableConverterTest, ViterbiBeamPruning) {
+  usage_stats::scoped_usage_stats_enabler usage_stats_enabler;
+  UsageStats::ClearAllStatsForTest();
+
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  EXPECT_EQ(0, converter->viterbi_beam_width());
+
+  // "よろしくおねがいします"
+  const string kKey =
+      "\xe3\x82\x88\xe3\x82\x8d\xe3\x81\x97\xe3\x81\x8f\xe3\x81\x8a"
+      "\xe3\x81\xad\xe3\x81\x8c\xe3\x81\x84\xe3\x81\x97\xe3\x81\xbe"
+      "\xe3\x81\x99";
+  Segments segments;
+  SetUpConversionSegments(kKey, &segments);
+  ASSERT_TRUE(converter->Convert(&segments));
+  const string expected = GetTopValues(segments);
+  EXPECT_STATS_NOT_EXIST("ViterbiBeamPruned");
+
+  // The beam wider than any column doesn't change the result.
+  converter->set_viterbi_beam_width(100000);
+  SetUpConversionSegments(kKey, &segments);
+  ASSERT_TRUE(converter->Convert(&segments));
+  EXPECT_EQ(expected, GetTopValues(segments));
+  EXPECT_STATS_NOT_EXIST("ViterbiBeamPruned");
+
+  // The narrowest beam still finds a path.
+  converter->set_viterbi_beam_width(1);
+  SetUpConversionSegments(kKey, &segments);
+  ASSERT_TRUE(converter->Convert(&segments));
+  ASSERT_LT(0, segments.conversion_segments_size());
+  EXPECT_LT(0, segments.conversion_segment(0).candidates_size());
+  EXPECT_COUNT_STATS("ViterbiBeamPruned", 1);
+
+  UsageStats::ClearAllStatsForTest();
+}
+
+namespace {
+string GetAllValues(const Segments &segments) {
+  string values;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    const Segment &segment = segments.conversion_segment(i);
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      values += segment.candidate(j).value;
+      values += ",";
+    }
+    values += "|";
+  }
+  return values;
+}
+}  // namespace
+
+TEST(ImmutableConverterTest, ParallelLatticeLookup) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  EXPECT_EQ(1, converter->max_lattice_lookup_threads());
+
+  // "きょうはいいてんきですね" * 4, long enough for 3 threads.
+  string key;
+  for (int i = 0; i < 4; ++i) {
+    key +=
+        "\xe3\x81\x8d\xe3\x82\x87\xe3\x81\x86\xe3\x81\xaf\xe3\x81\x84"
+        "\xe3\x81\x84\xe3\x81\xa6\xe3\x82\x93\xe3\x81\x8d\xe3\x81\xa7"
+        "\xe3\x81\x99\xe3\x81\xad";
+  }
+  const Segments::RequestType kRequestTypes[] = {
+      Segments::CONVERSION, Segments::PREDICTION,
+  };
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    // Use new Segments each time not to reuse the cached lattice.
+    converter->set_max_lattice_lookup_threads(1);
+    Segments sequential;
+    sequential.set_request_type(kRequestTypes[i]);
+    sequential.set_max_prediction_candidates_size(10);
+    sequential.add_segment()->set_key(key);
+    ASSERT_TRUE(converter->Convert(&sequential));
+
+    converter->set_max_lattice_lookup_threads(4);
+    Segments parallel;
+    parallel.set_request_type(kRequestTypes[i]);
+    parallel.set_max_prediction_candidates_size(10);
+    parallel.add_segment()->set_key(key);
+    ASSERT_TRUE(converter->Convert(&parallel));
+    EXPECT_EQ(GetAllValues(sequential), GetAllValues(parallel))
+        << "request type: " << kRequestTypes[i];
+  }
+}
+
+TEST(ImmutableConverterTest, LookupThroughDictionaryImplFunctors) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  const DictionaryImpl *dictionary_impl = static_cast<const DictionaryImpl *>(
+      data_and_converter->GetDictionary());
+
+  // "きょうはいいてんきですね" * 2
+  string key;
+  for (int i = 0; i < 2; ++i) {
+    key +=
+        "\xe3\x81\x8d\xe3\x82\x87\xe3\x81\x86\xe3\x81\xaf\xe3\x81\x84"
+        "\xe3\x81\x84\xe3\x81\xa6\xe3\x82\x93\xe3\x81\x8d\xe3\x81\xa7"
+        "\xe3\x81\x99\xe3\x81\xad";
+  }
+  const Segments::RequestType kRequestTypes[] = {
+      Segments::CONVERSION, Segments::PREDICTION,
+  };
+  const size_t kNumThreads[] = {1, 2};
+  for (size_t i = 0; i < arraysize(kRequestTypes); ++i) {
+    for (size_t j = 0; j < arraysize(kNumThreads); ++j) {
+      converter->set_max_lattice_lookup_threads(kNumThreads[j]);
+      converter->set_dictionary_impl(NULL);
+      Segments expected;
+      expected.set_request_type(kRequestTypes[i]);
+      expected.set_max_prediction_candidates_size(10);
+      expected.add_segment()->set_key(key);
+      ASSERT_TRUE(converter->Convert(&expected));
+
+      converter->set_dictionary_impl(dictionary_impl);
+      Segments actual;
+      actual.set_request_type(kRequestTypes[i]);
+      actual.set_max_prediction_candidates_size(10);
+      actual.add_segment()->set_key(key);
+      ASSERT_TRUE(converter->Convert(&actual));
+      EXPECT_EQ(GetAllValues(expected), GetAllValues(actual))
+          << "request type: " << kRequestTypes[i]
+          << ", threads: " << kNumThreads[j];
+    }
+  }
+}
+
+namespace {
+void SetUpSuggestionSegments(bool with_history, const string &key,
+                             Segments *segments) {
+  segments->clear_segments();
+  segments->set_request_type(Segments::SUGGESTION);
+  segments->set_max_prediction_candidates_size(10);
+  if (with_history) {
+    Segment *segment = segments->add_segment();
+    // "きょうは"
+    segment->set_key("\xe3\x81\x8d\xe3\x82\x87\xe3\x81\x86\xe3\x81\xaf");
+    segment->set_segment_type(Segment::HISTORY);
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->Init();
+    candidate->key = segment->key();
+    // "今日は"
+    candidate->value = "\xe4\xbb\x8a\xe6\x97\xa5\xe3\x81\xaf";
+  }
+  segments->add_segment()->set_key(key);
+}
+}  // namespace
+
+// The forward costs reused from the previous keystroke must give the same
+// result as the conversion from scratch.
+TEST(ImmutableConverterTest, IncrementalPredictionViterbi) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  // "わたしのなまえはなかのです"
+  const string kKey =
+      "\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae\xe3\x81\xaa\xe3"
+      "\x81\xbe\xe3\x81\x88\xe3\x81\xaf\xe3\x81\xaa\xe3\x81\x8b\xe3\x81"
+      "\xae\xe3\x81\xa7\xe3\x81\x99";
+  const ConversionRequest request;
+  for (int with_history = 0; with_history < 2; ++with_history) {
+    Segments incremental_segments;
+    // Each hiragana is 3 bytes in UTF-8.
+    for (size_t len = 3; len <= kKey.size(); len += 3) {
+      const string key = kKey.substr(0, len);
+      SetUpSuggestionSegments(with_history, key, &incremental_segments);
+      ASSERT_TRUE(converter->ConvertForRequest(request,
+                                               &incremental_segments));
+
+      Segments segments;
+      SetUpSuggestionSegments(with_history, key, &segments);
+      ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+
+      const Segment &expected = segments.conversion_segment(0);
+      const Segment &actual = incremental_segments.conversion_segment(0);
+      ASSERT_EQ(expected.candidates_size(), actual.candidates_size()) << key;
+      for (size_t i = 0; i < expected.candidates_size(); ++i) {
+        EXPECT_EQ(expected.candidate(i).value, actual.candidate(i).value);
+        EXPECT_EQ(expected.candidate(i).cost, actual.candidate(i).cost);
+        EXPECT_EQ(expected.candidate(i).wcost, actual.candidate(i).wcost);
+      }
+    }
+  }
+}
+
+namespace {
+// Sets up |segments| as if the user changed the boundary so that the
+// conversion segments have |lengths| bytes of |key|.
+void SetUpResizedSegments(const string &key,
+                          const std::vector<size_t> &lengths,
+                          Segments *segments) {
+  segments->clear_segments();
+  segments->set_request_type(Segments::CONVERSION);
+  segments->set_resized(true);
+  size_t pos = 0;
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    Segment *segment = segments->add_segment();
+    segment->set_key(key.substr(pos, lengths[i]));
+    if (i == 0) {
+      segment->set_segment_type(Segment::FIXED_BOUNDARY);
+    }
+    pos += lengths[i];
+  }
+}
+}  // namespace
+
+// The lattice reused by the repeated resizes of the same key must give the
+// same result as the conversion from scratch.
+TEST(ImmutableConverterTest, ReuseLatticeForResize) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  // "わたしのなまえはなかのです"
+  const string kKey =
+      "\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae\xe3\x81\xaa\xe3"
+      "\x81\xbe\xe3\x81\x88\xe3\x81\xaf\xe3\x81\xaa\xe3\x81\x8b\xe3\x81"
+      "\xae\xe3\x81\xa7\xe3\x81\x99";
+  const ConversionRequest request;
+  Segments reused_segments;
+  // Each hiragana is 3 bytes in UTF-8.
+  for (size_t len = 3; len < kKey.size(); len += 3) {
+    std::vector<size_t> lengths;
+    lengths.push_back(len);
+    lengths.push_back(kKey.size() - len);
+    SetUpResizedSegments(kKey, lengths, &reused_segments);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &reused_segments));
+    EXPECT_TRUE(reused_segments.mutable_cached_lattice()->
+                reusable_for_resize());
+
+    Segments segments;
+    SetUpResizedSegments(kKey, lengths, &segments);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+
+    ASSERT_EQ(segments.conversion_segments_size(),
+              reused_segments.conversion_segments_size()) << len;
+    EXPECT_EQ(GetAllValues(segments), GetAllValues(reused_segments)) << len;
+  }
+
+  // A lattice built for a non-resized conversion is not reused.
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+  segments.add_segment()->set_key(kKey);
+  ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+  EXPECT_FALSE(segments.mutable_cached_lattice()->reusable_for_resize());
+}
+
+// The conversion right after the suggestion of the same key reuses the
+// lookups of the suggestion and gives the same result as the conversion from
+// scratch.
+TEST(ImmutableConverterTest, ReuseLatticeOfSuggestionForConversion) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  // "わたしのなまえはなかのです", which is long enough to have predictive nodes
+  // in the lattice of the suggestion.
+  const string kKey =
+      "\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae\xe3\x81\xaa\xe3"
+      "\x81\xbe\xe3\x81\x88\xe3\x81\xaf\xe3\x81\xaa\xe3\x81\x8b\xe3\x81"
+      "\xae\xe3\x81\xa7\xe3\x81\x99";
+  const ConversionRequest request;
+
+  Segments expected;
+  expected.set_request_type(Segments::CONVERSION);
+  expected.add_segment()->set_key(kKey);
+  ASSERT_TRUE(converter->ConvertForRequest(request, &expected));
+  const size_t num_nodes_from_scratch =
+      expected.mutable_cached_lattice()->node_allocator()->node_count();
+
+  Segments segments;
+  segments.set_request_type(Segments::SUGGESTION);
+  segments.set_max_prediction_candidates_size(10);
+  segments.add_segment()->set_key(kKey);
+  ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+  const size_t num_nodes_of_suggestion =
+      segments.mutable_cached_lattice()->node_allocator()->node_count();
+
+  segments.clear_conversion_segments();
+  segments.set_request_type(Segments::CONVERSION);
+  segments.add_segment()->set_key(kKey);
+  ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+  EXPECT_EQ(GetAllValues(expected), GetAllValues(segments));
+  // Only the nodes other than the dictionary lookups are added.
+  EXPECT_LT(segments.mutable_cached_lattice()->node_allocator()->node_count() -
+            num_nodes_of_suggestion, num_nodes_from_scratch / 2);
+}
+
+namespace {
+// Records the conversion segments it gets and makes the first segment
+// |length| characters long, or does nothing if |length| is 0.
+class FirstSegmentConstraint : public BoundaryConstraintInterface {
+ public:
+  explicit FirstSegmentConstraint(uint8 length)
+      : length_(length), num_calls_(0) {}
+
+  bool ConstrainBoundaries(const ConversionRequest &request,
+                           Segments *segments) const override {
+    ++num_calls_;
+    keys_.clear();
+    for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+      keys_.push_back(segments->conversion_segment(i).key());
+    }
+    if (length_ == 0) {
+      return false;
+    }
+    return ConverterUtil::ResizeSegments(
+        segments->history_segments_size(),
+        segments->conversion_segments_size(), &length_, 1, segments);
+  }
+
+  int num_calls() const { return num_calls_; }
+  const std::vector<string> &keys() const { return keys_; }
+
+ private:
+  const uint8 length_;
+  mutable int num_calls_;
+  mutable std::vector<string> keys_;
+};
+
+std::vector<string> GetConversionKeys(const Segments &segments) {
+  std::vector<string> keys;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    keys.push_back(segments.conversion_segment(i).key());
+  }
+  return keys;
+}
+}  // namespace
+
+// The boundary constraint gets the segments of the best path, and the
+// constrained conversion gives the same result as the conversion resized
+// from scratch.
+TEST(ImmutableConverterTest, BoundaryConstraint) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  ImmutableConverterImpl *converter = data_and_converter->GetConverter();
+  // "わたしのなまえはなかのです"
+  const string kKey =
+      "\xe3\x82\x8f\xe3\x81\x9f\xe3\x81\x97\xe3\x81\xae\xe3\x81\xaa\xe3"
+      "\x81\xbe\xe3\x81\x88\xe3\x81\xaf\xe3\x81\xaa\xe3\x81\x8b\xe3\x81"
+      "\xae\xe3\x81\xa7\xe3\x81\x99";
+  const ConversionRequest request;
+
+  Segments plain;
+  plain.set_request_type(Segments::CONVERSION);
+  plain.add_segment()->set_key(kKey);
+  ASSERT_TRUE(converter->ConvertForRequest(request, &plain));
+
+  {
+    const FirstSegmentConstraint constraint(0);
+    converter->set_boundary_constraint(&constraint);
+    Segments segments;
+    segments.set_request_type(Segments::CONVERSION);
+    segments.add_segment()->set_key(kKey);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+    EXPECT_EQ(1, constraint.num_calls());
+    EXPECT_EQ(GetConversionKeys(plain), constraint.keys());
+    EXPECT_FALSE(segments.resized());
+    EXPECT_EQ(GetAllValues(plain), GetAllValues(segments));
+  }
+
+  {
+    // "わたし|のなまえはなかのです"
+    const FirstSegmentConstraint constraint(3);
+    converter->set_boundary_constraint(&constraint);
+    Segments segments;
+    segments.set_request_type(Segments::CONVERSION);
+    segments.add_segment()->set_key(kKey);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+    EXPECT_EQ(1, constraint.num_calls());
+    EXPECT_TRUE(segments.resized());
+
+    Segments expected;
+    expected.set_request_type(Segments::CONVERSION);
+    expected.set_resized(true);
+    Segment *segment = expected.add_segment();
+    segment->set_key(kKey.substr(0, 9));
+    segment->set_segment_type(Segment::FIXED_BOUNDARY);
+    segment = expected.add_segment();
+    segment->set_key(kKey.substr(9));
+    segment->set_segment_type(Segment::FIXED_BOUNDARY);
+    converter->set_boundary_constraint(NULL);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &expected));
+
+    EXPECT_EQ(GetConversionKeys(expected), GetConversionKeys(segments));
+    EXPECT_EQ(GetAllValues(expected), GetAllValues(segments));
+  }
+}
+
 namespace {
 bool AutoPartialSuggestionTestHelper(const ConversionRequest &request) {
   std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
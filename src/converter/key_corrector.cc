@@ -363,6 +363,99 @@ bool RewriteYu(size_t key_pos,
 
   return true;
 }
+// Bits for the rewrite rules above, used to select the rules that can match
+// at a position from the first two characters there.
+enum RewriteRule {
+  REWRITE_DOUBLE_NN = 1 << 0,
+  REWRITE_NN = 1 << 1,
+  REWRITE_YU = 1 << 2,
+  REWRITE_NI = 1 << 3,
+  REWRITE_SMALL_TSU = 1 << 4,
+  REWRITE_M = 1 << 5,
+};
+
+// Returns the rules whose pattern can have |ucs4| as the second character.
+// Every rule needs the second character, so no rule can match where this
+// returns 0, which is the case for most of the characters.
+uint32 GetRulesForSecondChar(char32 ucs4) {
+  switch (ucs4) {
+    case 0x3093:  // "ん"
+      return REWRITE_DOUBLE_NN;
+    case 0x3042:  // "あ"
+    case 0x3044:  // "い"
+    case 0x3046:  // "う"
+    case 0x3048:  // "え"
+    case 0x304A:  // "お"
+      return REWRITE_NN;
+    case 0x3085:  // "ゅ"
+      return REWRITE_YU | REWRITE_NI;
+    case 0x3083:  // "ゃ"
+    case 0x3087:  // "ょ"
+      return REWRITE_NI;
+    case 0x3063:  // "っ"
+      return REWRITE_SMALL_TSU;
+    default:
+      break;
+  }
+  // "[ばぱびぴぶぷべぺぼぽ]", see RewriteM().
+  if (ucs4 % 3 != 0 && ucs4 >= 0x306F && ucs4 <= 0x307D) {
+    return REWRITE_M;
+  }
+  return 0;
+}
+
+// Returns the rules whose pattern can have |ucs4| as the first character.
+uint32 GetRulesForFirstChar(char32 ucs4) {
+  if (ucs4 == 0x006D || ucs4 == 0xFF4D) {  // "m" or "ｍ"
+    return REWRITE_M;
+  }
+  if (Util::GetScriptType(ucs4) != Util::HIRAGANA) {
+    return 0;
+  }
+  uint32 rules = 0;
+  if (ucs4 == 0x3093) {  // "ん"
+    rules |= REWRITE_NN;
+  } else {
+    rules |= REWRITE_DOUBLE_NN;
+  }
+  if (ucs4 != 0x3063) {  // "っ"
+    rules |= REWRITE_SMALL_TSU;
+  }
+  switch (ucs4) {
+    case 0x306B:  // "に"
+      rules |= REWRITE_NI | REWRITE_YU;
+      break;
+    case 0x304D:  // "き"
+    case 0x3057:  // "し"
+    case 0x3061:  // "ち"
+    case 0x3072:  // "ひ"
+    case 0x308A:  // "り"
+      rules |= REWRITE_YU;
+      break;
+    default:
+      break;
+  }
+  return rules;
+}
+
+// Tries the rules in |rules| in the priority order.  Returns true and
+// appends the rewritten string to |output| if one of them matches.
+bool Rewrite(uint32 rules, size_t key_pos,
+             const char *begin, const char *end,
+             size_t *mblen, string *output) {
+  return ((rules & REWRITE_DOUBLE_NN) &&
+          RewriteDoubleNN(key_pos, begin, end, mblen, output)) ||
+         ((rules & REWRITE_NN) &&
+          RewriteNN(key_pos, begin, end, mblen, output)) ||
+         ((rules & REWRITE_YU) &&
+          RewriteYu(key_pos, begin, end, mblen, output)) ||
+         ((rules & REWRITE_NI) &&
+          RewriteNI(key_pos, begin, end, mblen, output)) ||
+         ((rules & REWRITE_SMALL_TSU) &&
+          RewriteSmallTSU(key_pos, begin, end, mblen, output)) ||
+         ((rules & REWRITE_M) &&
+          RewriteM(key_pos, begin, end, mblen, output));
+}
 }  // namespace
 
 KeyCorrector::KeyCorrector(const string &key, InputMode mode,
@@ -430,23 +523,39 @@ bool KeyCorrector::CorrectKey(const string &key, InputMode mode,
   }
 
   original_key_ = key;
+  // Corrections change the key length only by a few bytes.
+  corrected_key_.reserve(key.size() + 8);
+  alignment_.reserve(key.size());
+  rev_alignment_.reserve(key.size() + 8);
 
   const char *begin = key.data();
   const char *end = key.data() + key.size();
   const char *input_begin = key.data() + history_size;
   size_t key_pos = 0;
 
+  // The key is scanned only once.  Each character is decoded once together
+  // with the next one, and only the rules that can start with these two
+  // characters are tried, so most of the positions are just copied.
+  size_t char_len = 0;
+  char32 ucs4 = (begin < end) ? Util::UTF8ToUCS4(begin, end, &char_len) : 0;
   while (begin < end) {
+    size_t next_char_len = 0;
+    const char32 next_ucs4 =
+        (begin + char_len < end)
+            ? Util::UTF8ToUCS4(begin + char_len, end, &next_char_len) : 0;
+    uint32 rules = 0;
+    if (begin >= input_begin && next_char_len > 0) {
+      rules = GetRulesForSecondChar(next_ucs4);
+      if (rules != 0) {
+        rules &= GetRulesForFirstChar(ucs4);
+      }
+    }
+
     size_t mblen = 0;
     const size_t org_len = corrected_key_.size();
-    if (begin < input_begin ||
-        (!RewriteDoubleNN(key_pos, begin, end, &mblen, &corrected_key_) &&
-         !RewriteNN(key_pos, begin, end, &mblen, &corrected_key_) &&
-         !RewriteYu(key_pos,  begin, end, &mblen, &corrected_key_) &&
-         !RewriteNI(key_pos, begin, end, &mblen, &corrected_key_) &&
-         !RewriteSmallTSU(key_pos, begin, end, &mblen, &corrected_key_) &&
-         !RewriteM(key_pos,  begin, end, &mblen, &corrected_key_))) {
-      const char32 ucs4 = Util::UTF8ToUCS4(begin, end, &mblen);
+    if (rules == 0 ||
+        !Rewrite(rules, key_pos, begin, end, &mblen, &corrected_key_)) {
+      mblen = char_len;
       Util::UCS4ToUTF8Append(ucs4, &corrected_key_);
     }
 
@@ -479,6 +588,12 @@ bool KeyCorrector::CorrectKey(const string &key, InputMode mode,
 
     begin += mblen;
     ++key_pos;
+    if (mblen == char_len) {
+      ucs4 = next_ucs4;
+      char_len = next_char_len;
+    } else if (begin < end) {
+      ucs4 = Util::UTF8ToUCS4(begin, end, &char_len);
+    }
   }
 
   DCHECK_EQ(original_key_.size(), alignment_.size());
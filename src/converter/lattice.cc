@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/logging.h"
@@ -76,6 +77,29 @@ Node *InitEOSNode(Lattice *lattice, uint16 length) {
   return eos_node;
 }
 
+// Special values of Lattice::ForwardCost::prev and forward_end_refs_.
+const uint32 kNullNodeIndex = 0xFFFFFFFF;
+const uint32 kBOSNodeIndex = 0xFFFFFFFE;
+// The node is not in the lattice before the referring node.  Such a reference
+// never matches, so the referring node is always relaxed again.
+const uint32 kUnknownNodeIndex = 0xFFFFFFFD;
+
+// forward_end_refs_ with this bit refers to an entry of detached_end_nodes_.
+const uint32 kDetachedNodeBit = 0x80000000;
+
+typedef std::unordered_map<const Node *, uint32> NodeIndexMap;
+
+uint32 GetNodeIndex(const NodeIndexMap &node_index, const Node *node) {
+  if (node == NULL) {
+    return kNullNodeIndex;
+  }
+  if (node->node_type == Node::BOS_NODE) {
+    return kBOSNodeIndex;
+  }
+  NodeIndexMap::const_iterator iter = node_index.find(node);
+  return (iter == node_index.end()) ? kUnknownNodeIndex : iter->second;
+}
+
 bool PathContainsString(const Node *node, size_t begin_pos, size_t end_pos,
                         const string &str) {
   CHECK(node);
@@ -142,7 +166,69 @@ struct LatticeDisplayNodeInfo {
   string display_node_str_;
 };
 
-Lattice::Lattice() : history_end_pos_(0), node_allocator_(new NodeAllocator) {}
+void EndNodeColumn::clear() {
+  rid.clear();
+  cost.clear();
+  node.clear();
+}
+
+void EndNodeColumn::Append(Node *end_node) {
+  rid.push_back(end_node->rid);
+  cost.push_back(end_node->cost);
+  node.push_back(end_node);
+}
+
+size_t EndNodeColumn::Prune(size_t max_size) {
+  if (size() <= max_size) {
+    return 0;
+  }
+  const size_t original_size = size();
+  if (max_size == 0) {
+    clear();
+    return original_size;
+  }
+
+  // Find the cost of the |max_size|-th cheapest node.  Nodes cheaper than it
+  // are always kept and the rest of the slots are filled with the nodes of
+  // that cost in order.
+  std::vector<int32> sorted_cost(cost);
+  std::nth_element(sorted_cost.begin(), sorted_cost.begin() + max_size - 1,
+                   sorted_cost.end());
+  const int32 threshold = sorted_cost[max_size - 1];
+  size_t num_ties = max_size;
+  for (size_t i = 0; i < max_size; ++i) {
+    if (sorted_cost[i] < threshold) {
+      --num_ties;
+    }
+  }
+
+  size_t new_size = 0;
+  for (size_t i = 0; i < original_size; ++i) {
+    if (cost[i] > threshold) {
+      continue;
+    }
+    if (cost[i] == threshold) {
+      if (num_ties == 0) {
+        continue;
+      }
+      --num_ties;
+    }
+    rid[new_size] = rid[i];
+    cost[new_size] = cost[i];
+    node[new_size] = node[i];
+    ++new_size;
+  }
+  DCHECK_EQ(max_size, new_size);
+  rid.resize(new_size);
+  cost.resize(new_size);
+  node.resize(new_size);
+  return original_size - new_size;
+}
+
+Lattice::Lattice()
+    : history_end_pos_(0), reusable_for_resize_(false),
+      node_allocator_(new NodeAllocator),
+      forward_cost_history_end_pos_(0) {}
 
 Lattice::~Lattice() {}
 
@@ -150,6 +236,27 @@ NodeAllocator *Lattice::node_allocator() const {
   return node_allocator_.get();
 }
 
+NodeAllocator *Lattice::node_allocator_shard(size_t index) {
+  while (node_allocator_shards_.size() <= index) {
+    node_allocator_shards_.emplace_back(new NodeAllocator);
+  }
+  return node_allocator_shards_[index].get();
+}
+
+void Lattice::GetNodeStats(LatticeNodeStats *stats) const {
+  stats->node_count = node_allocator_->node_count();
+  stats->max_node_count = node_allocator_->max_node_count();
+  stats->num_truncations = node_allocator_->num_truncations();
+  stats->reserved_bytes = node_allocator_->reserved_bytes();
+  for (size_t i = 0; i < node_allocator_shards_.size(); ++i) {
+    const NodeAllocator &shard = *node_allocator_shards_[i];
+    stats->node_count += shard.node_count();
+    stats->max_node_count += shard.max_node_count();
+    stats->num_truncations += shard.num_truncations();
+    stats->reserved_bytes += shard.reserved_bytes();
+  }
+}
+
 Node *Lattice::NewNode() {
   return node_allocator_->NewNode();
 }
@@ -174,6 +281,9 @@ void Lattice::SetKey(StringPiece key) {
             static_cast<Node *>(NULL));
   std::fill(end_nodes_.begin(), end_nodes_.end(), static_cast<Node *>(NULL));
   std::fill(cache_info_.begin(), cache_info_.end(), 0);
+  if (end_node_columns_.size() < end_nodes_.size()) {
+    end_node_columns_.resize(end_nodes_.size());
+  }
 
   end_nodes_[0] = InitBOSNode(this,
                               static_cast<uint16>(0));
@@ -189,6 +299,23 @@ Node *Lattice::eos_nodes() const {
   return begin_nodes_[key_.size()];
 }
 
+const EndNodeColumn &Lattice::BuildEndNodeColumn(size_t pos) {
+  DCHECK_LT(pos, end_node_columns_.size());
+  EndNodeColumn *column = &end_node_columns_[pos];
+  column->clear();
+  for (Node *node = end_nodes_[pos]; node != NULL; node = node->enext) {
+    if (node->prev != NULL) {
+      column->Append(node);
+    }
+  }
+  return *column;
+}
+
+size_t Lattice::PruneEndNodeColumn(size_t pos, size_t max_size) {
+  DCHECK_LT(pos, end_node_columns_.size());
+  return end_node_columns_[pos].Prune(max_size);
+}
+
 void Lattice::Insert(size_t pos, Node *node) {
   for (Node *rnode = node; rnode != NULL; rnode = rnode->bnext) {
     const size_t end_pos = min(rnode->key.size() + pos, key_.size());
@@ -227,8 +354,166 @@ void Lattice::Clear() {
   begin_nodes_.clear();
   end_nodes_.clear();
   node_allocator_->Free();
+  for (size_t i = 0; i < node_allocator_shards_.size(); ++i) {
+    node_allocator_shards_[i]->Free();
+  }
   cache_info_.clear();
   history_end_pos_ = 0;
+  reusable_for_resize_ = false;
+  ClearForwardCosts();
+}
+
+void Lattice::ClearForwardCosts() {
+  forward_costs_.clear();
+  forward_cost_offsets_.clear();
+  forward_end_refs_.clear();
+  forward_end_ref_offsets_.clear();
+  detached_end_nodes_.clear();
+  forward_cost_history_end_pos_ = 0;
+}
+
+void Lattice::SaveForwardCosts() {
+  ClearForwardCosts();
+  if (!has_lattice()) {
+    return;
+  }
+  forward_cost_history_end_pos_ = history_end_pos_;
+  NodeIndexMap node_index;
+  for (size_t pos = 0; pos <= key_.size(); ++pos) {
+    forward_cost_offsets_.push_back(forward_costs_.size());
+    forward_end_ref_offsets_.push_back(forward_end_refs_.size());
+    for (const Node *node = end_nodes_[pos]; node != NULL;
+         node = node->enext) {
+      uint32 index = GetNodeIndex(node_index, node);
+      if (index == kUnknownNodeIndex && node->begin_pos < pos) {
+        // ResetNodeCost() may leave a node in end_nodes() after removing it
+        // from begin_nodes().  Such a node is never relaxed, so it is
+        // identified by its address.
+        DetachedEndNode detached;
+        detached.node = node;
+        detached.rid = node->rid;
+        detached.cost = node->cost;
+        index = kDetachedNodeBit | detached_end_nodes_.size();
+        detached_end_nodes_.push_back(detached);
+      }
+      forward_end_refs_.push_back(index);
+    }
+    for (const Node *node = begin_nodes_[pos]; node != NULL;
+         node = node->bnext) {
+      ForwardCost forward_cost;
+      forward_cost.lid = node->lid;
+      forward_cost.rid = node->rid;
+      forward_cost.end_pos = node->end_pos;
+      forward_cost.wcost = node->wcost;
+      forward_cost.cost = node->cost;
+      // Constrained nodes are relaxed differently; never reuse them.
+      forward_cost.prev = (node->constrained_prev == NULL) ?
+          GetNodeIndex(node_index, node->prev) : kUnknownNodeIndex;
+      node_index[node] = forward_costs_.size();
+      forward_costs_.push_back(forward_cost);
+    }
+  }
+  forward_cost_offsets_.push_back(forward_costs_.size());
+  forward_end_ref_offsets_.push_back(forward_end_refs_.size());
+}
+
+size_t Lattice::RestoreForwardCosts(std::vector<size_t> *positions_to_relax) {
+  DCHECK(positions_to_relax);
+  positions_to_relax->clear();
+  if (forward_cost_offsets_.empty() || !has_lattice() ||
+      forward_cost_history_end_pos_ != history_end_pos_) {
+    return 0;
+  }
+  const size_t num_positions =
+      min(forward_cost_offsets_.size() - 1, key_.size() + 1);
+  // |nodes|[i] is the node matching forward_costs_[i], or NULL if no node
+  // matches it.  Only the matched nodes have an entry in |node_index|.
+  NodeIndexMap node_index;
+  std::vector<Node *> nodes(forward_costs_.size(), NULL);
+  size_t pos = 0;
+  for (; pos < num_positions; ++pos) {
+    // The nodes beginning at |pos| are relaxed with end_nodes(pos), so they
+    // can be reused only if the end nodes, including their order which
+    // decides the tie-breaking, are the same as before.
+    size_t i = forward_end_ref_offsets_[pos];
+    const size_t end_refs_end = forward_end_ref_offsets_[pos + 1];
+    bool end_nodes_unchanged = true;
+    for (const Node *node = end_nodes_[pos]; node != NULL;
+         node = node->enext, ++i) {
+      if (i == end_refs_end || forward_end_refs_[i] == kUnknownNodeIndex) {
+        end_nodes_unchanged = false;
+        break;
+      }
+      const uint32 ref = forward_end_refs_[i];
+      if (ref != kBOSNodeIndex && (ref & kDetachedNodeBit) != 0) {
+        const DetachedEndNode &detached =
+            detached_end_nodes_[ref & ~kDetachedNodeBit];
+        if (detached.node != node || detached.rid != node->rid ||
+            detached.cost != node->cost) {
+          end_nodes_unchanged = false;
+          break;
+        }
+      } else if (ref != GetNodeIndex(node_index, node)) {
+        end_nodes_unchanged = false;
+        break;
+      }
+    }
+    if (!end_nodes_unchanged || i != end_refs_end) {
+      break;
+    }
+
+    // Match the nodes beginning at |pos| with the snapshots in order.  New
+    // nodes are usually prepended by Insert() and removed nodes can be
+    // anywhere, so look for the next matching snapshot for each node.  A
+    // node without a match is relaxed again.
+    size_t next = forward_cost_offsets_[pos];
+    const size_t costs_end = forward_cost_offsets_[pos + 1];
+    bool has_unmatched_node = false;
+    for (Node *node = begin_nodes_[pos]; node != NULL; node = node->bnext) {
+      size_t j = next;
+      for (; j < costs_end; ++j) {
+        const ForwardCost &forward_cost = forward_costs_[j];
+        if (forward_cost.lid == node->lid && forward_cost.rid == node->rid &&
+            forward_cost.end_pos == node->end_pos &&
+            forward_cost.wcost == node->wcost &&
+            forward_cost.prev != kUnknownNodeIndex &&
+            node->constrained_prev == NULL) {
+          break;
+        }
+      }
+      if (j == costs_end) {
+        has_unmatched_node = true;
+        continue;
+      }
+      node_index[node] = j;
+      nodes[j] = node;
+      next = j + 1;
+    }
+    if (has_unmatched_node) {
+      positions_to_relax->push_back(pos);
+    }
+  }
+
+  // Node::prev always refers to a node in end_nodes(node->begin_pos), which
+  // has been checked above, so the matched prev is also restored.
+  for (size_t i = 0; i < forward_cost_offsets_[pos]; ++i) {
+    Node *node = nodes[i];
+    if (node == NULL) {
+      continue;
+    }
+    const ForwardCost &forward_cost = forward_costs_[i];
+    node->cost = forward_cost.cost;
+    if (forward_cost.prev == kNullNodeIndex) {
+      node->prev = NULL;
+    } else if (forward_cost.prev == kBOSNodeIndex) {
+      node->prev = bos_nodes();
+    } else {
+      DCHECK_LT(forward_cost.prev, i);
+      DCHECK(nodes[forward_cost.prev] != NULL);
+      node->prev = nodes[forward_cost.prev];
+    }
+  }
+  return pos;
 }
 
 void Lattice::SetDebugDisplayNode(size_t begin_pos, size_t end_pos,
@@ -264,7 +549,11 @@ void Lattice::UpdateKey(const string &new_key) {
 
   // if node_allocator has many nodes, then clean up
   const size_t size_threshold = node_allocator_->max_nodes_size();
-  if (node_allocator_->node_count() > size_threshold) {
+  size_t node_count = node_allocator_->node_count();
+  for (size_t i = 0; i < node_allocator_shards_.size(); ++i) {
+    node_count += node_allocator_shards_[i]->node_count();
+  }
+  if (node_count > size_threshold) {
     SetKey(new_key);
     return;
   }
@@ -298,6 +587,9 @@ void Lattice::AddSuffix(const string &suffix_key) {
 
   // update cache_info
   cache_info_.resize(new_size + 4, 0);
+  if (end_node_columns_.size() < end_nodes_.size()) {
+    end_node_columns_.resize(end_nodes_.size());
+  }
 
   // update key
   key_ += suffix_key;
@@ -386,8 +678,10 @@ void Lattice::ResetNodeCost() {
           } else {
             CHECK(prev);
             CHECK_EQ(prev->bnext, node);
-            prev->next = node->bnext;
+            prev->bnext = node->bnext;
           }
+          // |prev| stays at the last remaining node.
+          continue;
         }
         // traverse a next node
         prev = node;
@@ -413,8 +707,9 @@ void Lattice::ResetNodeCost() {
           } else {
             CHECK(prev);
             CHECK_EQ(prev->enext, node);
-            prev->next = node->enext;
+            prev->enext = node->enext;
           }
+          continue;
         }
         prev = node;
       }
@@ -422,6 +717,30 @@ void Lattice::ResetNodeCost() {
   }
 }
 
+void Lattice::set_reusable_for_resize(bool reusable) {
+  reusable_for_resize_ = reusable;
+}
+
+bool Lattice::reusable_for_resize() const {
+  return reusable_for_resize_;
+}
+
+void Lattice::ResetViterbiState() {
+  // Every node is in begin_nodes() except BOS, which is end_nodes(0).
+  for (size_t i = 0; i <= key_.size(); ++i) {
+    for (Node *node = begin_nodes_[i]; node != NULL; node = node->bnext) {
+      node->prev = NULL;
+      node->next = NULL;
+      node->cost = 0;
+    }
+  }
+  for (Node *node = end_nodes_[0]; node != NULL; node = node->enext) {
+    node->prev = NULL;
+    node->next = NULL;
+    node->cost = 0;
+  }
+}
+
 string Lattice::DebugString() const {
   std::stringstream os;
   if (!has_lattice()) {
@@ -41,6 +41,37 @@
 
 namespace mozc {
 
+// Structure-of-arrays copy of the nodes ending at a position.  The Viterbi
+// relaxation reads only rid and cost of the left nodes, so keeping them in
+// contiguous arrays lets the inner loop stream through memory instead of
+// chasing Node::enext for every pair of left and right nodes.  |node| holds
+// the original Node objects, which are still used for back-pointers and
+// candidate materialization.
+struct EndNodeColumn {
+  std::vector<uint16> rid;
+  std::vector<int32> cost;
+  std::vector<Node *> node;
+
+  size_t size() const { return node.size(); }
+  bool empty() const { return node.empty(); }
+  void clear();
+  void Append(Node *end_node);
+
+  // Keeps only the |max_size| cheapest nodes, preserving their order.  Among
+  // nodes of the same cost, earlier ones are kept.  Returns the number of
+  // removed nodes.
+  size_t Prune(size_t max_size);
+};
+
+// Statistics of the nodes allocated for a lattice, summed over
+// Lattice::node_allocator() and its shards.
+struct LatticeNodeStats {
+  size_t node_count;
+  size_t max_node_count;
+  size_t num_truncations;
+  size_t reserved_bytes;
+};
+
 class Lattice {
  public:
   Lattice();
@@ -48,6 +79,17 @@ class Lattice {
 
   NodeAllocator *node_allocator() const;
 
+  // Returns the |index|-th additional node allocator, creating it if needed.
+  // The shards let worker threads allocate the nodes of this lattice without
+  // locking; each thread must use its own shard.  The nodes live as long as
+  // the ones from node_allocator() and are freed by Clear().  This method
+  // itself is not thread-safe.
+  NodeAllocator *node_allocator_shard(size_t index);
+
+  // Fills the statistics of the nodes allocated by node_allocator() and the
+  // shards.  See NodeAllocator for each value.
+  void GetNodeStats(LatticeNodeStats *stats) const;
+
   // set key and initalizes lattice with key.
   void SetKey(StringPiece key);
 
@@ -79,6 +121,19 @@ class Lattice {
   // alias of begin_nodes(key.size()).
   Node *eos_nodes() const;
 
+  // Rebuilds and returns the column of the nodes ending at |pos|.  Only the
+  // nodes reachable from BOS, i.e., whose prev is not NULL, are copied in the
+  // order of end_nodes(pos).  This must be called after the costs of those
+  // nodes are fixed.  The returned reference is valid until the next call
+  // with the same |pos| or SetKey().
+  const EndNodeColumn &BuildEndNodeColumn(size_t pos);
+
+  // Prunes the column built by BuildEndNodeColumn(|pos|) to the |max_size|
+  // cheapest nodes and returns the number of removed nodes.  The removed
+  // nodes keep their cost and prev but are no longer offered as left nodes
+  // by the column.
+  size_t PruneEndNodeColumn(size_t pos, size_t max_size);
+
   // inset nodes (linked list) to the position |pos|.
   void Insert(size_t pos, Node *node);
 
@@ -108,6 +163,30 @@ class Lattice {
   // process for some heuristic methods.
   void ResetNodeCost();
 
+  // Marks that the lattice was built for a conversion whose segment boundary
+  // was changed by the user.  Such a lattice does not depend on the boundary,
+  // so another resize of the same key can run Viterbi again on it without
+  // rebuilding.  Reset by Clear().
+  void set_reusable_for_resize(bool reusable);
+  bool reusable_for_resize() const;
+
+  // Resets Node::prev, Node::next and Node::cost of all the nodes so that
+  // Viterbi can run again on the lattice as if the nodes were new.
+  void ResetViterbiState();
+
+  // Incremental Viterbi support.  SaveForwardCosts() records Node::cost and
+  // Node::prev of all the nodes together with the inputs of the relaxation
+  // (POS IDs, wcost, positions and the order of end nodes).  After the key is
+  // updated, RestoreForwardCosts() returns the first position whose end
+  // nodes differ from the saved ones, and writes the saved values back to the
+  // unchanged nodes beginning before it.  The positions before it having new
+  // or modified nodes are stored in |positions_to_relax|.  Relaxing those
+  // positions and then all the positions from the returned one gives exactly
+  // the same result as relaxing the whole lattice.  Returns 0 if nothing was
+  // saved for the current lattice.
+  void SaveForwardCosts();
+  size_t RestoreForwardCosts(std::vector<size_t> *positions_to_relax);
+
   // Dump the best path and the path that contains the designated string.
   string DebugString() const;
 
@@ -122,9 +201,46 @@ class Lattice {
   // TODO(team): Splitting the cache module may make this module simpler.
   string key_;
   size_t history_end_pos_;
+  bool reusable_for_resize_;
   std::vector<Node *> begin_nodes_;
   std::vector<Node *> end_nodes_;
+  // Not cleared by Clear() so that the capacity of each column is reused
+  // across conversions.
+  std::vector<EndNodeColumn> end_node_columns_;
   std::unique_ptr<NodeAllocator> node_allocator_;
+  std::vector<std::unique_ptr<NodeAllocator>> node_allocator_shards_;
+
+  // Snapshot of a node taken by SaveForwardCosts().
+  struct ForwardCost {
+    uint16 lid;
+    uint16 rid;
+    uint16 end_pos;
+    int32 wcost;
+    int32 cost;
+    // Index of Node::prev in forward_costs_, or one of the special values
+    // defined in lattice.cc.
+    uint32 prev;
+  };
+
+  // A node found only in end_nodes() when SaveForwardCosts() is called.
+  struct DetachedEndNode {
+    const Node *node;
+    uint16 rid;
+    int32 cost;
+  };
+
+  void ClearForwardCosts();
+
+  // forward_costs_ holds the snapshots of begin_nodes(pos) in the order of
+  // the list for pos = 0, 1, ..., and the snapshots of the nodes beginning at
+  // pos are in [forward_cost_offsets_[pos], forward_cost_offsets_[pos + 1]).
+  // forward_end_refs_ similarly holds the indices of end_nodes(pos).
+  std::vector<ForwardCost> forward_costs_;
+  std::vector<uint32> forward_cost_offsets_;
+  std::vector<uint32> forward_end_refs_;
+  std::vector<uint32> forward_end_ref_offsets_;
+  std::vector<DetachedEndNode> detached_end_nodes_;
+  size_t forward_cost_history_end_pos_;
 
   // cache_info_ holds cache information about lookup.
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
@@ -31,9 +31,11 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "converter/node.h"
+#include "converter/node_allocator.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -67,6 +69,52 @@ TEST(LatticeTest, NewNodeTest) {
   EXPECT_EQ(0, node->rid);
 }
 
+TEST(LatticeTest, NodeAllocatorShardTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  NodeAllocator *shard0 = lattice.node_allocator_shard(0);
+  NodeAllocator *shard1 = lattice.node_allocator_shard(1);
+  EXPECT_NE(lattice.node_allocator(), shard0);
+  EXPECT_NE(shard0, shard1);
+  EXPECT_EQ(shard0, lattice.node_allocator_shard(0));
+
+  shard0->NewNode();
+  shard1->NewNode();
+  EXPECT_EQ(1, shard0->node_count());
+  EXPECT_EQ(1, shard1->node_count());
+
+  // The nodes of the shards are freed together with the lattice.
+  lattice.SetKey("test");
+  EXPECT_EQ(0, shard0->node_count());
+  EXPECT_EQ(0, shard1->node_count());
+}
+
+TEST(LatticeTest, NodeStatsTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+  for (int i = 0; i < 3; ++i) {
+    lattice.NewNode();
+  }
+  lattice.node_allocator_shard(0)->NewNode();
+  lattice.node_allocator()->increment_num_truncations();
+
+  // SetKey() allocates BOS and EOS nodes as well.
+  LatticeNodeStats stats;
+  lattice.GetNodeStats(&stats);
+  EXPECT_EQ(6, stats.node_count);
+  EXPECT_EQ(6, stats.max_node_count);
+  EXPECT_EQ(1, stats.num_truncations);
+  EXPECT_EQ(2 * 1024 * sizeof(Node), stats.reserved_bytes);
+
+  // The high-water mark and the first chunk survive Clear().
+  lattice.Clear();
+  lattice.GetNodeStats(&stats);
+  EXPECT_EQ(0, stats.node_count);
+  EXPECT_EQ(6, stats.max_node_count);
+  EXPECT_EQ(0, stats.num_truncations);
+  EXPECT_EQ(2 * 1024 * sizeof(Node), stats.reserved_bytes);
+}
+
 TEST(LatticeTest, InsertTest) {
   Lattice lattice;
 
@@ -103,6 +151,216 @@ TEST(LatticeTest, InsertTest) {
   }
 }
 
+TEST(LatticeTest, ResetNodeCostTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  struct {
+    size_t pos;
+    const char *key;
+    bool enable_cache;
+  } kNodes[] = {
+    {1, "es", false},
+    {0, "t", true},
+    {0, "te", false},
+    {0, "tes", true},
+  };
+  for (size_t i = 0; i < arraysize(kNodes); ++i) {
+    Node *node = lattice.NewNode();
+    node->key = kNodes[i].key;
+    node->value = kNodes[i].key;
+    node->raw_wcost = 100;
+    node->wcost = 200;
+    if (kNodes[i].enable_cache) {
+      node->attributes |= Node::ENABLE_CACHE;
+    }
+    lattice.Insert(kNodes[i].pos, node);
+  }
+  // The nodes without ENABLE_CACHE are in the middle or at the end of the
+  // lists.
+  ASSERT_EQ("tes", lattice.begin_nodes(0)->key);
+  ASSERT_EQ("tes", lattice.end_nodes(3)->key);
+
+  lattice.ResetNodeCost();
+
+  // Only the nodes with ENABLE_CACHE remain, with the raw costs.
+  std::vector<string> begin_keys;
+  for (Node *node = lattice.begin_nodes(0); node != NULL; node = node->bnext) {
+    begin_keys.push_back(node->key);
+    EXPECT_EQ(100, node->wcost);
+  }
+  EXPECT_EQ((std::vector<string>{"tes", "t"}), begin_keys);
+  EXPECT_EQ(NULL, lattice.begin_nodes(1));
+  EXPECT_EQ(NULL, lattice.end_nodes(2));
+  ASSERT_NE(nullptr, lattice.end_nodes(3));
+  EXPECT_EQ("tes", lattice.end_nodes(3)->key);
+  EXPECT_EQ(NULL, lattice.end_nodes(3)->enext);
+}
+
+TEST(LatticeTest, BuildEndNodeColumnTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  Node *node1 = lattice.NewNode();
+  node1->key = "es";
+  node1->rid = 10;
+  lattice.Insert(1, node1);
+
+  Node *node2 = lattice.NewNode();
+  node2->key = "s";
+  node2->rid = 20;
+  lattice.Insert(2, node2);
+
+  Node *node3 = lattice.NewNode();
+  node3->key = "est";
+  node3->rid = 30;
+  lattice.Insert(1, node3);
+
+  // Unreachable nodes are not included in the column.
+  EXPECT_TRUE(lattice.BuildEndNodeColumn(3).empty());
+
+  // Insert() resets prev and cost; emulate the relaxation.
+  node1->prev = lattice.bos_nodes();
+  node1->cost = 100;
+  node2->prev = lattice.bos_nodes();
+  node2->cost = 200;
+  node3->prev = lattice.bos_nodes();
+  node3->cost = 300;
+
+  // The column keeps the order of end_nodes(pos).
+  const EndNodeColumn &column = lattice.BuildEndNodeColumn(3);
+  ASSERT_EQ(2, column.size());
+  EXPECT_EQ(node2, column.node[0]);
+  EXPECT_EQ(20, column.rid[0]);
+  EXPECT_EQ(200, column.cost[0]);
+  EXPECT_EQ(node1, column.node[1]);
+  EXPECT_EQ(10, column.rid[1]);
+  EXPECT_EQ(100, column.cost[1]);
+
+  const EndNodeColumn &column4 = lattice.BuildEndNodeColumn(4);
+  ASSERT_EQ(1, column4.size());
+  EXPECT_EQ(node3, column4.node[0]);
+}
+
+TEST(LatticeTest, PruneEndNodeColumnTest) {
+  Lattice lattice;
+  lattice.SetKey("test");
+
+  const int32 kCosts[] = {300, 200, 300, 300, 100, 500};
+  std::vector<Node *> nodes;
+  for (size_t i = 0; i < arraysize(kCosts); ++i) {
+    Node *node = lattice.NewNode();
+    node->key = "test";
+    node->rid = static_cast<uint16>(i);
+    lattice.Insert(0, node);
+    node->prev = lattice.bos_nodes();
+    node->cost = kCosts[i];
+    nodes.push_back(node);
+  }
+
+  // Insert() prepends the nodes to end_nodes(4), so the column has the costs
+  // of 500, 100, 300, 300, 200 and 300 in this order.
+  const EndNodeColumn &column = lattice.BuildEndNodeColumn(4);
+  ASSERT_EQ(arraysize(kCosts), column.size());
+
+  // Not pruned if the column is small enough.
+  EXPECT_EQ(0, lattice.PruneEndNodeColumn(4, arraysize(kCosts)));
+  EXPECT_EQ(arraysize(kCosts), column.size());
+
+  // The cheapest nodes are kept in order.  Of the three nodes of cost 300,
+  // only the first two fit in the beam.
+  EXPECT_EQ(2, lattice.PruneEndNodeColumn(4, 4));
+  ASSERT_EQ(4, column.size());
+  EXPECT_EQ(nodes[4], column.node[0]);
+  EXPECT_EQ(100, column.cost[0]);
+  EXPECT_EQ(nodes[3], column.node[1]);
+  EXPECT_EQ(3, column.rid[1]);
+  EXPECT_EQ(nodes[2], column.node[2]);
+  EXPECT_EQ(300, column.cost[2]);
+  EXPECT_EQ(nodes[1], column.node[3]);
+  EXPECT_EQ(200, column.cost[3]);
+
+  EXPECT_EQ(3, lattice.PruneEndNodeColumn(4, 1));
+  ASSERT_EQ(1, column.size());
+  EXPECT_EQ(nodes[4], column.node[0]);
+}
+
+TEST(LatticeTest, RestoreForwardCostsTest) {
+  Lattice lattice;
+  lattice.SetKey("abc");
+  std::vector<size_t> positions_to_relax;
+  EXPECT_EQ(0, lattice.RestoreForwardCosts(&positions_to_relax));
+
+  Node *node1 = lattice.NewNode();
+  node1->key = "a";
+  lattice.Insert(0, node1);
+  Node *node2 = lattice.NewNode();
+  node2->key = "b";
+  lattice.Insert(1, node2);
+  Node *node3 = lattice.NewNode();
+  node3->key = "bc";
+  lattice.Insert(1, node3);
+  Node *node4 = lattice.NewNode();
+  node4->key = "c";
+  lattice.Insert(2, node4);
+
+  // Emulate the relaxation.
+  node1->prev = lattice.bos_nodes();
+  node1->cost = 10;
+  node2->prev = node1;
+  node2->cost = 20;
+  node3->prev = node1;
+  node3->cost = 30;
+  node4->prev = node2;
+  node4->cost = 40;
+  lattice.eos_nodes()->prev = node3;
+  lattice.eos_nodes()->cost = 50;
+  lattice.SaveForwardCosts();
+
+  // Nothing has changed.
+  EXPECT_EQ(4, lattice.RestoreForwardCosts(&positions_to_relax));
+  EXPECT_TRUE(positions_to_relax.empty());
+
+  lattice.AddSuffix("d");
+  Node *node5 = lattice.NewNode();
+  node5->key = "d";
+  lattice.Insert(3, node5);
+  node1->prev = node2->prev = node3->prev = node4->prev = NULL;
+  node1->cost = node2->cost = node3->cost = node4->cost = 0;
+
+  // The old EOS at 3 was replaced by |node5|, which needs to be relaxed.  The
+  // new position 4 was not saved.
+  EXPECT_EQ(4, lattice.RestoreForwardCosts(&positions_to_relax));
+  ASSERT_EQ(1, positions_to_relax.size());
+  EXPECT_EQ(3, positions_to_relax[0]);
+  EXPECT_EQ(lattice.bos_nodes(), node1->prev);
+  EXPECT_EQ(10, node1->cost);
+  EXPECT_EQ(node1, node2->prev);
+  EXPECT_EQ(20, node2->cost);
+  EXPECT_EQ(node1, node3->prev);
+  EXPECT_EQ(30, node3->cost);
+  EXPECT_EQ(node2, node4->prev);
+  EXPECT_EQ(40, node4->cost);
+  EXPECT_EQ(NULL, node5->prev);
+
+  // Modifying |node4| requires relaxing it, and everything after its end
+  // position.
+  lattice.SaveForwardCosts();
+  node4->wcost = 100;
+  EXPECT_EQ(3, lattice.RestoreForwardCosts(&positions_to_relax));
+  ASSERT_EQ(1, positions_to_relax.size());
+  EXPECT_EQ(2, positions_to_relax[0]);
+
+  // The history position is an input of the relaxation.
+  lattice.SaveForwardCosts();
+  lattice.set_history_end_pos(1);
+  EXPECT_EQ(0, lattice.RestoreForwardCosts(&positions_to_relax));
+
+  lattice.SaveForwardCosts();
+  lattice.SetKey("abc");
+  EXPECT_EQ(0, lattice.RestoreForwardCosts(&positions_to_relax));
+}
+
 namespace {
 
 // set cache_info[i] to (key.size() - i)
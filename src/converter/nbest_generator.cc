@@ -34,6 +34,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "converter/candidate_filter.h"
 #include "converter/connector.h"
@@ -141,7 +142,9 @@ NBestGenerator::~NBestGenerator() {
 void NBestGenerator::Reset(const Node *begin_node, const Node *end_node,
                            const BoundaryCheckMode mode) {
   agenda_.Clear();
-  freelist_.Free();
+  // Keep the chunks of the freelist to reuse them for the next segment.  The
+  // elements of the previous search are not referenced after Reset().
+  freelist_.Reset();
   filter_->Reset();
   viterbi_result_checked_ = false;
   check_mode_ = mode;
@@ -276,6 +279,7 @@ void NBestGenerator::MakeCandidate(
 bool NBestGenerator::Next(const string &original_key,
                           Segment::Candidate *candidate,
                           Segments::RequestType request_type) {
+  MOZC_TRACE_SPAN("NBestGenerator::Next");
   DCHECK(begin_node_);
   DCHECK(end_node_);
 
@@ -90,7 +90,9 @@ class NBestGenerator {
       bool apply_suggestion_filter_for_exact_match);
   ~NBestGenerator();
 
-  // Reset the iterator status.
+  // Reset the iterator status.  The memory for the search is kept, so
+  // reusing one instance for all the segments of a lattice avoids
+  // reallocation.
   void Reset(const Node *begin_node, const Node *end_node,
              const BoundaryCheckMode mode);
 
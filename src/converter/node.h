@@ -204,6 +204,10 @@ struct Node {
   }
 
   inline void InitFromToken(const dictionary::Token &token) {
+    InitFromToken(dictionary::TokenView(token));
+  }
+
+  inline void InitFromToken(const dictionary::TokenView &token) {
     prev = nullptr;
     next = nullptr;
     bnext = nullptr;
@@ -225,9 +229,9 @@ struct Node {
       attributes |= USER_DICTIONARY;
       attributes |= NO_VARIANTS_EXPANSION;
     }
-    key = token.key;
+    key.assign(token.key.data(), token.key.size());
     actual_key.clear();
-    value = token.value;
+    value.assign(token.value.data(), token.value.size());
   }
 };
 
@@ -40,7 +40,8 @@ namespace mozc {
 class NodeAllocator {
  public:
   NodeAllocator() : node_freelist_(1024), max_nodes_size_(8192),
-                    node_count_(0) {}
+                    node_count_(0), max_node_count_(0),
+                    num_truncations_(0) {}
   ~NodeAllocator() {}
 
   Node *NewNode() {
@@ -48,6 +49,9 @@ class NodeAllocator {
     DCHECK(node);
     node->Init();
     ++node_count_;
+    if (node_count_ > max_node_count_) {
+      max_node_count_ = node_count_;
+    }
     return node;
   }
 
@@ -55,6 +59,7 @@ class NodeAllocator {
   void Free() {
     node_freelist_.Free();
     node_count_ = 0;
+    num_truncations_ = 0;
   }
 
   size_t max_nodes_size() const {
@@ -69,10 +74,37 @@ class NodeAllocator {
     return node_count_;
   }
 
+  // The statistics below are for tuning max_nodes_size() and the chunk size
+  // of the free list.
+
+  // Returns the largest node_count() since the construction.  Unlike
+  // node_count(), this is not reset by Free().
+  size_t max_node_count() const {
+    return max_node_count_;
+  }
+
+  // Returns the number of lookups stopped by max_nodes_size() since the last
+  // Free().
+  size_t num_truncations() const {
+    return num_truncations_;
+  }
+
+  void increment_num_truncations() {
+    ++num_truncations_;
+  }
+
+  // Returns the bytes of the nodes held by the free list.  This does not
+  // include the strings owned by the nodes.
+  size_t reserved_bytes() const {
+    return node_freelist_.capacity() * sizeof(Node);
+  }
+
  private:
   FreeList<Node> node_freelist_;
   size_t max_nodes_size_;
   size_t node_count_;
+  size_t max_node_count_;
+  size_t num_truncations_;
 
   DISALLOW_COPY_AND_ASSIGN(NodeAllocator);
 };
@@ -59,9 +59,15 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
     return TRAVERSE_CONTINUE;
   }
 
-  // Creates a new node and prepends it to the current list.
+  // Forwarded to OnTokenView(), which subclasses override.
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const dictionary::Token &token) {
+    return OnTokenView(key, actual_key, dictionary::TokenView(token));
+  }
+
+  // Creates a new node and prepends it to the current list.
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const dictionary::TokenView &token) {
     Node *new_node = NewNodeFromToken(token);
     PrependNode(new_node);
     return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
@@ -72,7 +78,7 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
   Node *result() const { return result_; }
   NodeAllocator *allocator() { return allocator_; }
 
-  Node *NewNodeFromToken(const dictionary::Token &token) {
+  Node *NewNodeFromToken(const dictionary::TokenView &token) {
     Node *new_node = allocator_->NewNode();
     new_node->InitFromToken(token);
     new_node->wcost += penalty_;
@@ -82,7 +88,9 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
   void PrependNode(Node *node) {
     node->bnext = result_;
     result_ = node;
-    --limit_;
+    if (--limit_ == 0) {
+      allocator_->increment_num_truncations();
+    }
   }
 
  protected:
@@ -27,43 +27,216 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// Runs the quality regression test cases in |--test_file| and prints the
+// result of each case in the order of the file.
+//
+// With --num_threads > 1, the cases are evaluated in parallel by engines
+// sharing the immutable data (see Engine::CreateSibling()), each with its own
+// converter and Segments.  With --result_cache, the results are saved to the
+// file and a later run re-evaluates only the cases whose line or data changed;
+// the data is identified by the data version and the fingerprints of the
+// system dictionary and the connection data.
+
+#include <algorithm>
+#include <atomic>
 #include <iostream>  // NOLINT
+#include <map>
 #include <memory>
+#include <sstream>  // NOLINT
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/file_stream.h"
 #include "base/flags.h"
+#include "base/hash.h"
 #include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/number_util.h"
+#include "base/port.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "converter/quality_regression_util.h"
+#include "data_manager/data_manager_interface.h"
+#include "engine/engine.h"
 #include "engine/engine_factory.h"
-#include "engine/engine_interface.h"
 
 DEFINE_string(test_file, "", "regression test file");
+DEFINE_int32(num_threads, 1, "number of threads to evaluate the test cases");
+DEFINE_string(result_cache, "",
+              "file to save the results to and to reuse them from, so that "
+              "only the changed test cases are evaluated again");
 
+using mozc::Engine;
 using mozc::EngineFactory;
-using mozc::EngineInterface;
+using mozc::Hash;
 using mozc::quality_regression::QualityRegressionUtil;
 
+namespace {
+
+struct Result {
+  Result() : evaluated(false), passed(false) {}
+
+  bool evaluated;
+  bool passed;
+  string actual_value;
+};
+
+// Returns the fingerprint identifying the data of |engine|.
+uint64 GetDataFingerprint(const Engine &engine) {
+  const mozc::DataManagerInterface &data_manager = *engine.GetDataManager();
+  uint64 fingerprint = Hash::Fingerprint(data_manager.GetDataVersion());
+  {
+    const char *data = nullptr;
+    int size = 0;
+    data_manager.GetSystemDictionaryData(&data, &size);
+    fingerprint ^= Hash::FingerprintWithSeed(mozc::StringPiece(data, size), 1);
+  }
+  {
+    const char *data = nullptr;
+    size_t size = 0;
+    data_manager.GetConnectorData(&data, &size);
+    fingerprint ^= Hash::FingerprintWithSeed(mozc::StringPiece(data, size), 2);
+  }
+  return fingerprint;
+}
+
+uint64 GetItemFingerprint(const QualityRegressionUtil::TestItem &item,
+                          uint64 data_fingerprint) {
+  return Hash::Fingerprint(item.OutputAsTSV()) ^ data_fingerprint;
+}
+
+// The result cache is a TSV file of the item fingerprint, 1 or 0 for passed
+// or failed, and the actual value.
+void LoadResultCache(const string &filename, std::map<uint64, Result> *cache) {
+  mozc::InputFileStream ifs(filename.c_str());
+  if (!ifs.good()) {
+    return;
+  }
+  string line;
+  while (!getline(ifs, line).fail()) {
+    std::vector<string> fields;
+    mozc::Util::SplitStringAllowEmpty(line, "\t", &fields);
+    uint64 fingerprint = 0;
+    if (fields.size() != 3 ||
+        !mozc::NumberUtil::SafeStrToUInt64(fields[0], &fingerprint)) {
+      LOG(WARNING) << "Ignored broken line in the result cache: " << line;
+      continue;
+    }
+    Result &result = (*cache)[fingerprint];
+    result.evaluated = true;
+    result.passed = (fields[1] == "1");
+    result.actual_value = fields[2];
+  }
+}
+
+void SaveResultCache(const string &filename,
+                     const std::vector<uint64> &fingerprints,
+                     const std::vector<Result> &results) {
+  mozc::OutputFileStream ofs(filename.c_str());
+  for (size_t i = 0; i < results.size(); ++i) {
+    ofs << fingerprints[i] << '\t' << (results[i].passed ? 1 : 0) << '\t'
+        << results[i].actual_value << '\n';
+  }
+}
+
+// Evaluates the items not yet evaluated, taking the next one from the shared
+// index, so that the slow items don't keep the other threads waiting.
+void Evaluate(mozc::ConverterInterface *converter,
+              const std::vector<QualityRegressionUtil::TestItem> &items,
+              std::atomic<size_t> *next_index, std::vector<Result> *results) {
+  QualityRegressionUtil util(converter);
+  for (size_t i = next_index->fetch_add(1); i < items.size();
+       i = next_index->fetch_add(1)) {
+    Result &result = (*results)[i];
+    if (result.evaluated) {
+      continue;
+    }
+    result.passed = util.ConvertAndTest(items[i], &result.actual_value);
+    result.evaluated = true;
+  }
+}
+
+class EvaluatorThread : public mozc::Thread {
+ public:
+  EvaluatorThread(std::unique_ptr<Engine> engine,
+                  const std::vector<QualityRegressionUtil::TestItem> &items,
+                  std::atomic<size_t> *next_index,
+                  std::vector<Result> *results)
+      : engine_(std::move(engine)),
+        items_(items),
+        next_index_(next_index),
+        results_(results) {}
+
+  void Run() override {
+    Evaluate(engine_->GetConverter(), items_, next_index_, results_);
+  }
+
+ private:
+  std::unique_ptr<Engine> engine_;
+  const std::vector<QualityRegressionUtil::TestItem> &items_;
+  std::atomic<size_t> *next_index_;
+  std::vector<Result> *results_;
+
+  DISALLOW_COPY_AND_ASSIGN(EvaluatorThread);
+};
+
+}  // namespace
+
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, false);
 
-  std::unique_ptr<EngineInterface> engine(EngineFactory::Create());
-  QualityRegressionUtil util(engine->GetConverter());
+  std::unique_ptr<Engine> engine(EngineFactory::Create());
 
   std::vector<QualityRegressionUtil::TestItem> items;
   QualityRegressionUtil::ParseFile(FLAGS_test_file, &items);
 
+  std::vector<Result> results(items.size());
+  std::vector<uint64> fingerprints(items.size());
+  if (!FLAGS_result_cache.empty()) {
+    const uint64 data_fingerprint = GetDataFingerprint(*engine);
+    std::map<uint64, Result> cache;
+    LoadResultCache(FLAGS_result_cache, &cache);
+    size_t num_cached = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+      fingerprints[i] = GetItemFingerprint(items[i], data_fingerprint);
+      const auto it = cache.find(fingerprints[i]);
+      if (it != cache.end()) {
+        results[i] = it->second;
+        ++num_cached;
+      }
+    }
+    LOG(INFO) << num_cached << " of " << items.size()
+              << " results are reused from " << FLAGS_result_cache;
+  }
+
+  const int num_threads = std::max(1, FLAGS_num_threads);
+  std::atomic<size_t> next_index(0);
+  std::vector<std::unique_ptr<EvaluatorThread>> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(new EvaluatorThread(engine->CreateSibling(), items,
+                                             &next_index, &results));
+    threads.back()->SetJoinable(true);
+    threads.back()->Start("QualityRegression");
+  }
+  // The main thread evaluates with the original engine.
+  Evaluate(engine->GetConverter(), items, &next_index, &results);
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+  }
+
   for (size_t i = 0; i < items.size(); ++i) {
-    string actual_value;
-    const  bool result = util.ConvertAndTest(items[i], &actual_value);
-    if (result) {
+    if (results[i].passed) {
       std::cout << "OK:\t" << items[i].OutputAsTSV() << std::endl;
     } else {
-      std::cout << "FAILED:\t" << items[i].OutputAsTSV() << "\t" << actual_value
-                << std::endl;
+      std::cout << "FAILED:\t" << items[i].OutputAsTSV() << "\t"
+                << results[i].actual_value << std::endl;
     }
   }
 
+  if (!FLAGS_result_cache.empty()) {
+    SaveResultCache(FLAGS_result_cache, fingerprints, results);
+  }
+
   return 0;
 }
@@ -29,6 +29,8 @@
 
 #include "converter/segmenter.h"
 
+#include <algorithm>
+
 #include "base/bitarray.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -50,25 +52,39 @@ Segmenter *Segmenter::CreateFromDataManager(
                                 &l_table, &r_table,
                                 &bitarray_num_bytes, &bitarray_data,
                                 &boundary_data);
+  const char *boundary_rows_data = nullptr;
+  size_t boundary_rows_num_bytes = 0;
+  data_manager.GetSegmenterBoundaryRowsData(&boundary_rows_data,
+                                            &boundary_rows_num_bytes);
   return new Segmenter(l_num_elements, r_num_elements,
                        l_table, r_table,
                        bitarray_num_bytes, bitarray_data,
+                       boundary_rows_data, boundary_rows_num_bytes,
                        boundary_data);
 }
 
 Segmenter::Segmenter(
     size_t l_num_elements, size_t r_num_elements, const uint16 *l_table,
     const uint16 *r_table, size_t bitarray_num_bytes,
-    const char *bitarray_data, const uint16 *boundary_data)
+    const char *bitarray_data, const char *boundary_rows_data,
+    size_t boundary_rows_num_bytes, const uint16 *boundary_data)
     : l_num_elements_(l_num_elements), r_num_elements_(r_num_elements),
       l_table_(l_table), r_table_(r_table),
       bitarray_num_bytes_(bitarray_num_bytes),
-      bitarray_data_(bitarray_data), boundary_data_(boundary_data) {
+      bitarray_data_(bitarray_data),
+      boundary_rows_(nullptr),
+      boundary_row_size_(GetBoundaryRowSize(r_num_elements)),
+      boundary_data_(boundary_data) {
   DCHECK(l_table_);
   DCHECK(r_table_);
   DCHECK(bitarray_data_);
   DCHECK(boundary_data_);
   CHECK_LE(l_num_elements_ * r_num_elements_, bitarray_num_bytes_ * 8);
+  if (boundary_rows_data != nullptr && boundary_rows_num_bytes > 0) {
+    CHECK_EQ(l_num_elements_ * boundary_row_size_, boundary_rows_num_bytes)
+        << "Packed segmenter boundary matrix is broken.";
+    boundary_rows_ = boundary_rows_data;
+  }
 }
 
 Segmenter::~Segmenter() {}
@@ -102,9 +118,62 @@ bool Segmenter::IsBoundary(const Node &lnode, const Node &rnode,
 }
 
 bool Segmenter::IsBoundary(uint16 rid, uint16 lid) const {
-  const uint32 bitarray_index = l_table_[rid] + l_num_elements_ * r_table_[lid];
-  return BitArray::GetValue(reinterpret_cast<const char*>(bitarray_data_),
-                            bitarray_index);
+  const char *array = nullptr;
+  uint32 offset = 0, stride = 0;
+  GetBoundaryArray(rid, &array, &offset, &stride);
+  return BitArray::GetValue(array, offset + stride * r_table_[lid]);
+}
+
+void Segmenter::IsBoundary(uint16 rid, const uint16 *lids, size_t size,
+                           bool *results) const {
+  const char *array = nullptr;
+  uint32 offset = 0, stride = 0;
+  GetBoundaryArray(rid, &array, &offset, &stride);
+  for (size_t i = 0; i < size; ++i) {
+    results[i] = BitArray::GetValue(array, offset + stride * r_table_[lids[i]]);
+  }
+}
+
+void Segmenter::IsBoundary(const Node &lnode, const Node *const *rnodes,
+                           size_t size, bool is_single_segment,
+                           bool *results) const {
+  // Same rules as the single version above: only the rid-lid matrix lookup in
+  // the last case depends on each rnode.
+  if (lnode.node_type == Node::BOS_NODE) {
+    std::fill(results, results + size, true);
+    return;
+  }
+  if (is_single_segment || (lnode.attributes & Node::STARTS_WITH_PARTICLE)) {
+    for (size_t i = 0; i < size; ++i) {
+      results[i] = (rnodes[i]->node_type == Node::EOS_NODE);
+    }
+    return;
+  }
+  const char *array = nullptr;
+  uint32 offset = 0, stride = 0;
+  GetBoundaryArray(lnode.rid, &array, &offset, &stride);
+  for (size_t i = 0; i < size; ++i) {
+    const Node &rnode = *rnodes[i];
+    results[i] = (rnode.node_type == Node::EOS_NODE ||
+                  BitArray::GetValue(array,
+                                     offset + stride * r_table_[rnode.lid]));
+  }
+}
+
+void Segmenter::GetBoundaryArray(uint16 rid, const char **array,
+                                 uint32 *offset, uint32 *stride) const {
+  // The boundary bit for (rid, lid) is at |*offset + *stride * r_table_[lid]|
+  // of |*array|.  In the packed layout, |*array| is the row for |rid|, so the
+  // bits for one rid are contiguous.
+  if (boundary_rows_ != nullptr) {
+    *array = boundary_rows_ + boundary_row_size_ * l_table_[rid];
+    *offset = 0;
+    *stride = 1;
+  } else {
+    *array = bitarray_data_;
+    *offset = l_table_[rid];
+    *stride = l_num_elements_;
+  }
 }
 
 int32 Segmenter::GetPrefixPenalty(uint16 lid) const {
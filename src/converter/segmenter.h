@@ -43,25 +43,57 @@ class Segmenter {
       const DataManagerInterface &data_manager);
 
   // This class does not take the ownership of pointer parameters.
+  // |boundary_rows_data| is the optional packed boundary matrix (see
+  // GetBoundaryRowSize() for the layout); pass nullptr and 0 if the data set
+  // doesn't contain it.
   Segmenter(size_t l_num_elements, size_t r_num_elements,
             const uint16 *l_table, const uint16 *r_table,
             size_t bitarray_num_bytes, const char *bitarray_data,
+            const char *boundary_rows_data, size_t boundary_rows_num_bytes,
             const uint16 *boundary_data);
   ~Segmenter();
 
+  // Returns the size in bytes of one row of the packed boundary matrix.  The
+  // packed matrix has one row for each compressed rid class (l_table value),
+  // and bit |r_table[lid]| of a row, in the same bit order as BitArray, is set
+  // if there is a boundary between the rid and lid.  Every row is padded to a
+  // multiple of 64 bytes so that a row never shares a cache line with another
+  // one and a batch of lookups for one rid touches as few lines as possible.
+  static size_t GetBoundaryRowSize(size_t r_num_elements) {
+    return (r_num_elements + 511) / 512 * 64;
+  }
+
   bool IsBoundary(const Node &lnode, const Node &rnode,
                   bool is_single_segment) const;
   bool IsBoundary(uint16 rid, uint16 lid) const;
+
+  // Batch version of IsBoundary(rid, lid) above: sets |results[i]| to
+  // IsBoundary(rid, lids[i]) for i in [0, size).  The table lookup for |rid|
+  // is done only once.
+  void IsBoundary(uint16 rid, const uint16 *lids, size_t size,
+                  bool *results) const;
+
+  // Batch version of IsBoundary(lnode, rnode, is_single_segment) for one left
+  // node and |size| right nodes.
+  void IsBoundary(const Node &lnode, const Node *const *rnodes, size_t size,
+                  bool is_single_segment, bool *results) const;
+
   int32 GetPrefixPenalty(uint16 lid) const;
   int32 GetSuffixPenalty(uint16 rid) const;
 
  private:
+  void GetBoundaryArray(uint16 rid, const char **array, uint32 *offset,
+                        uint32 *stride) const;
+
   const size_t l_num_elements_;
   const size_t r_num_elements_;
   const uint16 *l_table_;
   const uint16 *r_table_;
   const size_t bitarray_num_bytes_;
   const char *bitarray_data_;
+  // Points to the packed boundary matrix if available; otherwise nullptr.
+  const char *boundary_rows_;
+  const size_t boundary_row_size_;
   const uint16 *boundary_data_;
 
   DISALLOW_COPY_AND_ASSIGN(Segmenter);
@@ -32,8 +32,11 @@
 #include <algorithm>
 #include <sstream>  // For DebugString()
 #include <string>
+#include <utility>
 
+#include "base/hash.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/util.h"
 
 namespace mozc {
@@ -69,6 +72,7 @@ void Segment::Candidate::CopyFrom(const Candidate &src) {
   description = src.description;
   usage_title = src.usage_title;
   usage_description = src.usage_description;
+  annotator = src.annotator;
 
   cost = src.cost;
   wcost = src.wcost;
@@ -206,6 +210,7 @@ StringPiece Segment::Candidate::InnerSegmentIterator::GetContentValue() const {
 
 Segment::Segment()
     : segment_type_(FREE),
+      value_index_valid_(false),
       pool_(new ObjectPool<Candidate>(16)) {}
 
 Segment::~Segment() {}
@@ -238,10 +243,13 @@ const Segment::Candidate &Segment::candidate(int i) const {
 Segment::Candidate *Segment::mutable_candidate(int i) {
   if (i < 0) {
     const size_t meta_index = -i-1;
+    MaybeGenerateMetaCandidates();
     DCHECK_LT(meta_index, meta_candidates_.size());
     return &meta_candidates_[meta_index];
   }
   DCHECK_LT(i, candidates_.size());
+  // The value may be changed by the caller.
+  MarkUnindexed(candidates_[i]);
   return candidates_[i];
 }
 
@@ -256,6 +264,7 @@ int Segment::indexOf(const Segment::Candidate *candidate) {
     }
   }
 
+  // A pending generator means no pointer to a meta candidate exists yet.
   for (int i = 0; i < static_cast<int>(meta_candidates_.size()); ++i) {
     if (&(meta_candidates_[i]) == candidate) {
       return -i-1;
@@ -270,14 +279,98 @@ size_t Segment::candidates_size() const {
 }
 
 void Segment::clear_candidates() {
-  pool_->Free();
+  // Candidate objects are recycled rather than freed so that their strings
+  // keep the allocated buffers: Init() and the assignments by converters and
+  // rewriters then reuse them instead of reallocating every field.
+  pool_->Reset();
   candidates_.clear();
+  InvalidateValueIndex();
+}
+
+void Segment::ShrinkCandidatePool() {
+  pool_->Shrink();
+}
+
+namespace {
+
+size_t GetCandidateHeapBytes(const Segment::Candidate &candidate) {
+  return MemoryStats::GetHeapBytes(candidate.key) +
+         MemoryStats::GetHeapBytes(candidate.value) +
+         MemoryStats::GetHeapBytes(candidate.content_key) +
+         MemoryStats::GetHeapBytes(candidate.content_value) +
+         MemoryStats::GetHeapBytes(candidate.prefix) +
+         MemoryStats::GetHeapBytes(candidate.suffix) +
+         MemoryStats::GetHeapBytes(candidate.description) +
+         MemoryStats::GetHeapBytes(candidate.usage_title) +
+         MemoryStats::GetHeapBytes(candidate.usage_description) +
+         MemoryStats::GetHeapBytes(candidate.inner_segment_boundary);
+}
+
+}  // namespace
+
+size_t Segment::GetAllocatedBytes() const {
+  size_t bytes = pool_->capacity() * sizeof(Candidate) +
+                 MemoryStats::GetHeapBytes(key_) +
+                 candidates_.size() * sizeof(Candidate *) +
+                 MemoryStats::GetHeapBytes(meta_candidates_);
+  for (const Candidate *candidate : candidates_) {
+    bytes += GetCandidateHeapBytes(*candidate);
+  }
+  for (const Candidate &candidate : meta_candidates_) {
+    bytes += GetCandidateHeapBytes(candidate);
+  }
+  return bytes;
+}
+
+bool Segment::HasValue(StringPiece value) const {
+  if (!value_index_valid_) {
+    value_index_.clear();
+    unindexed_candidates_.clear();
+    for (const Candidate *candidate : candidates_) {
+      value_index_.emplace(Hash::Fingerprint(candidate->value), candidate);
+    }
+    value_index_valid_ = true;
+  } else {
+    // An indexed candidate may be listed again if its value was changed.  Its
+    // old entry is left, and rejected by the comparison below.
+    for (const Candidate *candidate : unindexed_candidates_) {
+      value_index_.emplace(Hash::Fingerprint(candidate->value), candidate);
+    }
+    unindexed_candidates_.clear();
+  }
+  const auto range = value_index_.equal_range(Hash::Fingerprint(value));
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    if (iter->second->value == value) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Segment::MarkUnindexed(const Candidate *candidate) {
+  if (!value_index_valid_) {
+    return;  // The whole index is rebuilt anyway.
+  }
+  if (unindexed_candidates_.size() >= candidates_.size()) {
+    // Rebuilding is cheaper than indexing the candidates listed repeatedly.
+    InvalidateValueIndex();
+    return;
+  }
+  unindexed_candidates_.push_back(candidate);
+}
+
+void Segment::InvalidateValueIndex() {
+  // Erased candidates may be still in the index, so rebuild it from scratch.
+  value_index_valid_ = false;
+  value_index_.clear();
+  unindexed_candidates_.clear();
 }
 
 Segment::Candidate *Segment::push_back_candidate() {
   Candidate *candidate = pool_->Alloc();
   candidate->Init();
   candidates_.push_back(candidate);
+  MarkUnindexed(candidate);
   return candidate;
 }
 
@@ -285,6 +378,7 @@ Segment::Candidate *Segment::push_front_candidate() {
   Candidate *candidate = pool_->Alloc();
   candidate->Init();
   candidates_.push_front(candidate);
+  MarkUnindexed(candidate);
   return candidate;
 }
 
@@ -292,6 +386,14 @@ Segment::Candidate *Segment::add_candidate() {
   return push_back_candidate();
 }
 
+Segment::Candidate *Segment::push_back_candidate(Candidate &&candidate) {
+  Candidate *new_candidate = pool_->Alloc();
+  *new_candidate = std::move(candidate);
+  candidates_.push_back(new_candidate);
+  MarkUnindexed(new_candidate);
+  return new_candidate;
+}
+
 Segment::Candidate *Segment::insert_candidate(int i) {
   if (i < 0 || i > static_cast<int>(candidates_.size())) {
     LOG(WARNING) << "invalid index";
@@ -300,14 +402,28 @@ Segment::Candidate *Segment::insert_candidate(int i) {
   Candidate *candidate = pool_->Alloc();
   candidate->Init();
   candidates_.insert(candidates_.begin() + i, candidate);
+  MarkUnindexed(candidate);
   return candidate;
 }
 
+Segment::Candidate *Segment::insert_candidate(int i, Candidate &&candidate) {
+  if (i < 0 || i > static_cast<int>(candidates_.size())) {
+    LOG(WARNING) << "invalid index";
+    return NULL;
+  }
+  Candidate *new_candidate = pool_->Alloc();
+  *new_candidate = std::move(candidate);
+  candidates_.insert(candidates_.begin() + i, new_candidate);
+  MarkUnindexed(new_candidate);
+  return new_candidate;
+}
+
 void Segment::pop_front_candidate() {
   if (!candidates_.empty()) {
     Candidate *c = candidates_.front();
     pool_->Release(c);
     candidates_.pop_front();
+    InvalidateValueIndex();
   }
 }
 
@@ -316,6 +432,7 @@ void Segment::pop_back_candidate() {
     Candidate *c = candidates_.back();
     pool_->Release(c);
     candidates_.pop_back();
+    InvalidateValueIndex();
   }
 }
 
@@ -324,8 +441,9 @@ void Segment::erase_candidate(int i) {
     LOG(WARNING) << "invalid index";
     return;
   }
-  pool_->Release(mutable_candidate(i));
+  pool_->Release(candidates_[i]);
   candidates_.erase(candidates_.begin() + i);
+  InvalidateValueIndex();
 }
 
 void Segment::erase_candidates(int i, size_t size) {
@@ -337,29 +455,35 @@ void Segment::erase_candidates(int i, size_t size) {
     return;
   }
   for (int j = i; j < static_cast<int>(end); ++j) {
-    pool_->Release(mutable_candidate(j));
+    pool_->Release(candidates_[j]);
   }
   candidates_.erase(candidates_.begin() + i,
                     candidates_.begin() + end);
+  InvalidateValueIndex();
 }
 
 size_t Segment::meta_candidates_size() const {
+  MaybeGenerateMetaCandidates();
   return meta_candidates_.size();
 }
 
 void Segment::clear_meta_candidates() {
+  meta_candidates_generator_.reset();
   meta_candidates_.clear();
 }
 
 const std::vector<Segment::Candidate> &Segment::meta_candidates() const {
+  MaybeGenerateMetaCandidates();
   return meta_candidates_;
 }
 
 std::vector<Segment::Candidate> *Segment::mutable_meta_candidates() {
+  MaybeGenerateMetaCandidates();
   return &meta_candidates_;
 }
 
 const Segment::Candidate &Segment::meta_candidate(size_t i) const {
+  MaybeGenerateMetaCandidates();
   if (i >= meta_candidates_.size()) {
     LOG(ERROR) << "Invalid index number of meta_candidate: " << i;
     i = 0;
@@ -368,6 +492,7 @@ const Segment::Candidate &Segment::meta_candidate(size_t i) const {
 }
 
 Segment::Candidate *Segment::mutable_meta_candidate(size_t i) {
+  MaybeGenerateMetaCandidates();
   if (i >= meta_candidates_.size()) {
     LOG(ERROR) << "Invalid index number of meta_candidate: " << i;
     i = 0;
@@ -376,17 +501,37 @@ Segment::Candidate *Segment::mutable_meta_candidate(size_t i) {
 }
 
 Segment::Candidate *Segment::add_meta_candidate() {
-  Candidate candidate;
-  candidate.Init();
-  meta_candidates_.push_back(candidate);
-  return &meta_candidates_[meta_candidates_size()-1];
+  MaybeGenerateMetaCandidates();
+  meta_candidates_.emplace_back();
+  Candidate *candidate = &meta_candidates_.back();
+  candidate->Init();
+  return candidate;
+}
+
+void Segment::set_meta_candidates_generator(
+    std::shared_ptr<const MetaCandidatesGeneratorInterface> generator) {
+  meta_candidates_.clear();
+  meta_candidates_generator_ = std::move(generator);
+}
+
+void Segment::MaybeGenerateMetaCandidates() const {
+  if (meta_candidates_generator_ == nullptr) {
+    return;
+  }
+  // Reset first so that the accessors called back from Generate() don't
+  // recurse.
+  std::shared_ptr<const MetaCandidatesGeneratorInterface> generator;
+  generator.swap(meta_candidates_generator_);
+  DCHECK(meta_candidates_.empty());
+  generator->Generate(&meta_candidates_);
 }
 
 void Segment::move_candidate(int old_idx, int new_idx) {
   // meta candidates
   if (old_idx < 0) {
     const int meta_idx = -old_idx-1;
-    DCHECK_LT(meta_idx, meta_candidates_size());
+    MaybeGenerateMetaCandidates();
+    DCHECK_LT(meta_idx, meta_candidates_.size());
     Candidate *c = insert_candidate(new_idx);
     *c = meta_candidates_[meta_idx];
     return;
@@ -413,10 +558,20 @@ void Segment::move_candidate(int old_idx, int new_idx) {
   }
 }
 
+void Segment::AnnotateCandidate(const ConversionRequest &request, int i) {
+  Candidate *candidate = mutable_candidate(i);
+  const CandidateAnnotatorInterface *annotator = candidate->annotator;
+  if (annotator == NULL) {
+    return;
+  }
+  candidate->annotator = NULL;
+  annotator->Annotate(request, i, candidate);
+}
+
 void Segment::Clear() {
   clear_candidates();
   key_.clear();
-  meta_candidates_.clear();
+  clear_meta_candidates();
   segment_type_ = FREE;
 }
 
@@ -431,6 +586,11 @@ void Segment::CopyFrom(const Segment &src) {
     candidate->CopyFrom(src.candidate(i));
   }
 
+  if (src.has_pending_meta_candidates()) {
+    // Share the generator rather than generating the candidates to copy.
+    meta_candidates_generator_ = src.meta_candidates_generator_;
+    return;
+  }
   for (size_t i = 0; i < src.meta_candidates_size(); ++i) {
     Candidate *meta_candidate = add_meta_candidate();
     meta_candidate->CopyFrom(src.meta_candidate(i));
@@ -468,6 +628,7 @@ Segments::Segments()
     max_conversion_candidates_size_(kMaxConversionCandidatesSize),
     resized_(false),
     user_history_enabled_(true),
+    skipped_prediction_stages_(0),
     request_type_(Segments::CONVERSION),
     pool_(new ObjectPool<Segment>(32)),
     cached_lattice_(new Lattice()) {}
@@ -607,6 +768,7 @@ void Segments::CopyFrom(const Segments &src) {
   max_conversion_candidates_size_ = src.max_conversion_candidates_size();
   resized_ = src.resized();
   user_history_enabled_ = src.user_history_enabled();
+  skipped_prediction_stages_ = src.skipped_prediction_stages();
 
   request_type_ = src.request_type();
 
@@ -627,6 +789,23 @@ void Segments::clear_segments() {
   segments_.clear();
 }
 
+void Segments::ShrinkPools() {
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    segments_[i]->ShrinkCandidatePool();
+  }
+  pool_->Shrink();
+}
+
+size_t Segments::GetAllocatedBytes() const {
+  size_t bytes = pool_->capacity() * sizeof(Segment) +
+                 segments_.size() * sizeof(Segment *) +
+                 MemoryStats::GetHeapBytes(revert_entries_);
+  for (const Segment *segment : segments_) {
+    bytes += segment->GetAllocatedBytes();
+  }
+  return bytes;
+}
+
 void Segments::clear_history_segments() {
   while (!segments_.empty()) {
     Segment *seg = segments_.front();
@@ -665,6 +844,18 @@ bool Segments::resized() const {
   return resized_;
 }
 
+uint32 Segments::skipped_prediction_stages() const {
+  return skipped_prediction_stages_;
+}
+
+void Segments::set_skipped_prediction_stages(uint32 stages) {
+  skipped_prediction_stages_ = stages;
+}
+
+void Segments::add_skipped_prediction_stage(PredictionStage stage) {
+  skipped_prediction_stages_ |= stage;
+}
+
 size_t Segments::max_prediction_candidates_size() const {
   return max_prediction_candidates_size_;
 }
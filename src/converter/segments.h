@@ -33,6 +33,7 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/freelist.h"
@@ -43,6 +44,10 @@
 
 namespace mozc {
 
+class CandidateAnnotatorInterface;
+class ConversionRequest;
+class MetaCandidatesGeneratorInterface;
+
 class Segment {
  public:
   enum SegmentType {
@@ -154,6 +159,10 @@ class Segment {
     // Content of the usage.
     string usage_description;
 
+    // If not NULL, fills the annotations of this candidate which are deferred
+    // until the candidate is shown.  See Segment::AnnotateCandidate().
+    const CandidateAnnotatorInterface *annotator;
+
     // Context "sensitive" candidate cost.
     // Taking adjacent words/nodes into consideration.
     // Basically, canidate is sorted by this cost.
@@ -251,6 +260,7 @@ class Segment {
       description.clear();
       usage_title.clear();
       usage_description.clear();
+      annotator = NULL;
       cost = 0;
       structure_cost = 0;
       wcost = 0;
@@ -264,7 +274,7 @@ class Segment {
       inner_segment_boundary.clear();
     }
 
-    Candidate() : cost(0), wcost(0), structure_cost(0),
+    Candidate() : annotator(NULL), cost(0), wcost(0), structure_cost(0),
                   lid(0), rid(0), attributes(0),
                   source_info(SOURCE_INFO_NONE),
                   style(NumberUtil::NumberString::DEFAULT_STYLE),
@@ -306,10 +316,16 @@ class Segment {
   int indexOf(const Candidate *candidate);
 
   // push and insert candidates
+  // The returned candidates are initialized in place, so fill their fields
+  // directly rather than assigning a temporary candidate.
   Candidate *push_front_candidate();
   Candidate *push_back_candidate();
   Candidate *add_candidate();   // alias of push_back_candidate()
   Candidate *insert_candidate(int i);
+  // Same as above, but the new candidates take over the contents of
+  // |candidate| instead of copying them.  |candidate| is left unspecified.
+  Candidate *push_back_candidate(Candidate &&candidate);
+  Candidate *insert_candidate(int i, Candidate &&candidate);
 
   // get size of candidates
   size_t candidates_size() const;
@@ -324,6 +340,23 @@ class Segment {
   // do not erase meta candidates
   void clear_candidates();
 
+  // Releases the memory of the recycled candidates which have not been used
+  // since the last call.  See ObjectPool::Shrink().
+  void ShrinkCandidatePool();
+
+  // Returns an estimate of the bytes allocated by the candidate pool and by
+  // the candidates in use, including the meta candidates.  The candidates
+  // recycled by the pool are counted without the strings they keep.
+  size_t GetAllocatedBytes() const;
+
+  // Returns true if a candidate, not a meta candidate, has |value|.  It takes
+  // amortized constant time with an index of the value fingerprints, which is
+  // updated lazily for the candidates returned by the push, insert and
+  // mutable_candidate() methods since the last call.  Therefore, a value
+  // changed through a pointer kept across calls is not observed unless the
+  // pointer is taken again by mutable_candidate().
+  bool HasValue(StringPiece value) const;
+
   // meta candidates
   // TODO(toshiyuki): Integrate meta candidates to candidate and delete these
   size_t meta_candidates_size() const;
@@ -334,9 +367,21 @@ class Segment {
   Candidate *mutable_meta_candidate(size_t i);
   Candidate *add_meta_candidate();
 
+  // Defers the meta candidates to |generator|, which fills them on the first
+  // access through any of the accessors above.  Replaces the current meta
+  // candidates.  The generator is shared with the copies of this segment.
+  void set_meta_candidates_generator(
+      std::shared_ptr<const MetaCandidatesGeneratorInterface> generator);
+  bool has_pending_meta_candidates() const {
+    return meta_candidates_generator_ != nullptr;
+  }
+
   // move old_idx-th-candidate to new_index
   void move_candidate(int old_idx, int new_idx);
 
+  // Fills the deferred annotations of the i-th candidate, if any.
+  void AnnotateCandidate(const ConversionRequest &request, int i);
+
   void Clear();
   void CopyFrom(const Segment &src);
 
@@ -356,11 +401,53 @@ class Segment {
   // You should detect that by using both Composer and Segments.
   string key_;
   std::deque<Candidate *> candidates_;
-  std::vector<Candidate>  meta_candidates_;
+  // See HasValue().  |value_index_| is rebuilt when |value_index_valid_| is
+  // false, e.g., after candidates are erased.
+  mutable std::unordered_multimap<uint64, const Candidate *> value_index_;
+  mutable std::vector<const Candidate *> unindexed_candidates_;
+  mutable bool value_index_valid_;
+  // Meta candidates are filled by |meta_candidates_generator_| on demand, so
+  // both are mutable for the const accessors.
+  mutable std::vector<Candidate> meta_candidates_;
+  mutable std::shared_ptr<const MetaCandidatesGeneratorInterface>
+      meta_candidates_generator_;
   std::unique_ptr<ObjectPool<Candidate>> pool_;
+
+  void MaybeGenerateMetaCandidates() const;
+  void MarkUnindexed(const Candidate *candidate);
+  void InvalidateValueIndex();
+
   DISALLOW_COPY_AND_ASSIGN(Segment);
 };
 
+// Annotator of the candidates whose annotations are deferred until they are
+// shown, e.g., by SessionOutput.  A candidate window shows only a page of the
+// candidates, so the work for the others can be skipped.  An annotator has to
+// outlive the candidates referring to it.
+class CandidateAnnotatorInterface {
+ public:
+  virtual ~CandidateAnnotatorInterface() {}
+
+  // Fills the annotations of |candidate|, the |candidate_id|-th candidate of
+  // its segment.
+  virtual void Annotate(const ConversionRequest &request, int candidate_id,
+                        Segment::Candidate *candidate) const = 0;
+};
+
+// Generator of the meta candidates deferred until they are accessed, e.g., on
+// transliteration of the segment or when its candidate window is opened.  The
+// other segments of a conversion are often committed without their meta
+// candidates being looked at.  A generator must hold everything it needs since
+// it is shared by the copies of the segment.
+class MetaCandidatesGeneratorInterface {
+ public:
+  virtual ~MetaCandidatesGeneratorInterface() {}
+
+  // Fills |meta_candidates|, which is empty when called.
+  virtual void Generate(
+      std::vector<Segment::Candidate> *meta_candidates) const = 0;
+};
+
 // Segments is basically an array of Segment.
 // Note that there are two types of Segment
 // a) History Segment (SegmentType == HISTORY OR SUBMITTED)
@@ -449,6 +536,18 @@ class Segments {
   void clear_conversion_segments();
   void clear_segments();
 
+  // Releases the memory of the recycled segments and candidates which have
+  // not been used since the last call.  Intended to be called periodically
+  // while idle so that the pools don't stay at the peak size.  The candidates
+  // of the recycled segments which are not in use are released only together
+  // with the segments.
+  void ShrinkPools();
+
+  // Returns an estimate of the bytes allocated by the segment pool and by the
+  // segments in use.  See Segment::GetAllocatedBytes().  The nodes of the
+  // cached lattice are not included; see Lattice::GetNodeStats().
+  size_t GetAllocatedBytes() const;
+
   void set_max_history_segments_size(size_t max_history_segments_size);
   size_t max_history_segments_size() const;
 
@@ -468,6 +567,20 @@ class Segments {
   bool resized() const;
   void set_resized(bool resized);
 
+  // Stages of prediction that predictors skip when the deadline given by
+  // ConversionRequest has passed.
+  enum PredictionStage {
+    DICTIONARY_PREDICTION_STAGE = 1,  // The whole dictionary prediction.
+    REALTIME_CONVERSION_STAGE = 2,
+    BIGRAM_PREDICTION_STAGE = 4,
+    TYPING_CORRECTION_STAGE = 8,
+  };
+  // Bitfield of PredictionStage skipped by the last prediction, which
+  // DefaultPredictor and MobilePredictor reset.
+  uint32 skipped_prediction_stages() const;
+  void set_skipped_prediction_stages(uint32 stages);
+  void add_skipped_prediction_stage(PredictionStage stage);
+
   // clear segments
   void Clear();
 
@@ -496,6 +609,7 @@ class Segments {
   size_t max_conversion_candidates_size_;
   bool resized_;
   bool user_history_enabled_;
+  uint32 skipped_prediction_stages_;
 
   RequestType request_type_;
   std::unique_ptr<ObjectPool<Segment>> pool_;
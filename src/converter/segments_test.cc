@@ -29,7 +29,10 @@
 
 #include "converter/segments.h"
 
+#include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/number_util.h"
@@ -39,6 +42,29 @@
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
+namespace {
+
+class CountingGenerator : public MetaCandidatesGeneratorInterface {
+ public:
+  CountingGenerator() : num_calls_(0) {}
+
+  virtual void Generate(
+      std::vector<Segment::Candidate> *meta_candidates) const {
+    ++num_calls_;
+    meta_candidates->resize(2);
+    meta_candidates->at(0).Init();
+    meta_candidates->at(0).value = "a";
+    meta_candidates->at(1).Init();
+    meta_candidates->at(1).value = "b";
+  }
+
+  int num_calls() const { return num_calls_; }
+
+ private:
+  mutable int num_calls_;
+};
+
+}  // namespace
 
 TEST(SegmentsTest, BasicTest) {
   Segments segments;
@@ -541,6 +567,28 @@ TEST(SegmentTest, CopyFrom) {
   EXPECT_EQ(src.meta_candidate(0).key, dest.meta_candidate(0).key);
 }
 
+TEST(SegmentTest, ReuseCandidatesAfterClear) {
+  Segment segment;
+  const size_t kNumCandidates = 100;
+  std::set<const Segment::Candidate *> allocated;
+  for (size_t i = 0; i < kNumCandidates; ++i) {
+    Segment::Candidate *candidate = segment.add_candidate();
+    candidate->value = "value";
+    candidate->description = "description";
+    allocated.insert(candidate);
+  }
+
+  // The candidates are recycled after clear and are initialized again.
+  segment.clear_candidates();
+  EXPECT_EQ(0, segment.candidates_size());
+  for (size_t i = 0; i < kNumCandidates; ++i) {
+    const Segment::Candidate *candidate = segment.add_candidate();
+    EXPECT_NE(allocated.end(), allocated.find(candidate));
+    EXPECT_TRUE(candidate->value.empty());
+    EXPECT_TRUE(candidate->description.empty());
+  }
+}
+
 TEST(SegmentTest, MetaCandidateTest) {
   Segment segment;
 
@@ -620,4 +668,100 @@ TEST(SegmentTest, MetaCandidateTest) {
   segment.clear_meta_candidates();
   EXPECT_EQ(0, segment.meta_candidates_size());
 }
+TEST(SegmentTest, DeferredMetaCandidates) {
+  std::shared_ptr<CountingGenerator> generator(new CountingGenerator);
+  Segment segment;
+  segment.add_meta_candidate()->value = "old";
+  segment.set_meta_candidates_generator(generator);
+  EXPECT_TRUE(segment.has_pending_meta_candidates());
+  EXPECT_EQ(0, generator->num_calls());
+
+  // Copying shares the generator without generating the candidates.
+  Segment copied;
+  copied.CopyFrom(segment);
+  EXPECT_TRUE(copied.has_pending_meta_candidates());
+  EXPECT_EQ(0, generator->num_calls());
+
+  EXPECT_EQ("b", segment.candidate(-2).value);
+  EXPECT_FALSE(segment.has_pending_meta_candidates());
+  EXPECT_EQ(2, segment.meta_candidates_size());
+  EXPECT_EQ("a", segment.meta_candidate(0).value);
+  EXPECT_EQ(1, generator->num_calls());
+
+  EXPECT_EQ(2, copied.meta_candidates_size());
+  EXPECT_EQ(2, generator->num_calls());
+
+  // Clearing drops the pending generator.
+  segment.set_meta_candidates_generator(generator);
+  segment.clear_meta_candidates();
+  EXPECT_FALSE(segment.has_pending_meta_candidates());
+  EXPECT_EQ(0, segment.meta_candidates_size());
+  EXPECT_EQ(2, generator->num_calls());
+}
+
+TEST(SegmentTest, HasValue) {
+  Segment segment;
+  EXPECT_FALSE(segment.HasValue("a"));
+
+  segment.add_candidate()->value = "a";
+  segment.insert_candidate(0)->value = "b";
+  EXPECT_TRUE(segment.HasValue("a"));
+  EXPECT_TRUE(segment.HasValue("b"));
+  EXPECT_FALSE(segment.HasValue("c"));
+
+  // Values set after the last query are observed.
+  segment.push_front_candidate()->value = "c";
+  segment.mutable_candidate(2)->value = "d";
+  EXPECT_TRUE(segment.HasValue("c"));
+  EXPECT_TRUE(segment.HasValue("d"));
+  EXPECT_FALSE(segment.HasValue("a"));
+
+  // Moving doesn't change the values.
+  segment.move_candidate(2, 0);
+  EXPECT_TRUE(segment.HasValue("d"));
+
+  // Erased candidates are dropped.
+  segment.erase_candidate(0);
+  EXPECT_FALSE(segment.HasValue("d"));
+  EXPECT_TRUE(segment.HasValue("b"));
+  segment.pop_back_candidate();
+  EXPECT_FALSE(segment.HasValue("b"));
+  segment.clear_candidates();
+  EXPECT_FALSE(segment.HasValue("c"));
+
+  // Meta candidates are not looked up.
+  segment.add_meta_candidate()->value = "e";
+  EXPECT_FALSE(segment.HasValue("e"));
+}
+
+TEST(SegmentTest, MoveCandidateIn) {
+  Segment segment;
+  segment.add_candidate()->value = "b";
+
+  Segment::Candidate candidate;
+  candidate.Init();
+  candidate.value = "a";
+  candidate.description = "desc a";
+  candidate.cost = 10;
+  Segment::Candidate *inserted =
+      segment.insert_candidate(0, std::move(candidate));
+  ASSERT_NE(nullptr, inserted);
+  EXPECT_EQ(inserted, &segment.candidate(0));
+  EXPECT_EQ("a", inserted->value);
+  EXPECT_EQ("desc a", inserted->description);
+  EXPECT_EQ(10, inserted->cost);
+
+  candidate.Init();
+  candidate.value = "c";
+  Segment::Candidate *pushed =
+      segment.push_back_candidate(std::move(candidate));
+  EXPECT_EQ(pushed, &segment.candidate(2));
+  EXPECT_EQ("c", pushed->value);
+  EXPECT_TRUE(segment.HasValue("c"));
+
+  candidate.Init();
+  EXPECT_EQ(nullptr, segment.insert_candidate(4, std::move(candidate)));
+  EXPECT_EQ(3, segment.candidates_size());
+}
+
 }  // namespace mozc
@@ -0,0 +1,296 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/viterbi_kernel.h"
+
+#include "base/logging.h"
+#include "base/port.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MOZC_VITERBI_KERNEL_X86
+#include <immintrin.h>
+// The whole tree is built without -msse4.1 or -mavx2, so the SIMD functions
+// are compiled for their instruction sets individually and are called only if
+// the CPU supports them.
+//
+// Note that the lane selection is done with and/andnot/or instead of
+// pblendvb.  GCC folds the blendv intrinsics through a vector of plain char,
+// which is unsigned with -funsigned-char, so the mask would never be taken.
+#define MOZC_VITERBI_KERNEL_TARGET(name) __attribute__((target(name)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MOZC_VITERBI_KERNEL_X86
+#include <intrin.h>
+#include <immintrin.h>
+#define MOZC_VITERBI_KERNEL_TARGET(name)
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MOZC_VITERBI_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+namespace mozc {
+namespace {
+
+// Continues the scalar loop from |begin|.  |best| is the result of the
+// indices before |begin|.
+inline int FindBestLeftNodeFrom(const int32 *lcosts,
+                                const int32 *transition_costs,
+                                size_t begin, size_t size, int best,
+                                int32 *best_cost) {
+  for (size_t i = begin; i < size; ++i) {
+    const int32 cost = lcosts[i] + transition_costs[i];
+    if (cost < *best_cost) {
+      *best_cost = cost;
+      best = static_cast<int>(i);
+    }
+  }
+  return best;
+}
+
+int FindBestLeftNodeScalar(const int32 *lcosts, const int32 *transition_costs,
+                           size_t size, int32 *best_cost) {
+  return FindBestLeftNodeFrom(lcosts, transition_costs, 0, size, -1,
+                              best_cost);
+}
+
+#if defined(MOZC_VITERBI_KERNEL_X86) || defined(MOZC_VITERBI_KERNEL_NEON)
+// Merges the per-lane minimums computed by the SIMD loops.  Each lane keeps
+// the first index attaining its minimum (or -1), so the overall answer is the
+// smallest index among the lanes sharing the overall minimum.
+inline int ReduceLanes(const int32 *lane_costs, const int32 *lane_indices,
+                       size_t num_lanes, int32 *best_cost) {
+  int best = -1;
+  for (size_t i = 0; i < num_lanes; ++i) {
+    if (lane_indices[i] < 0) {
+      continue;
+    }
+    if (lane_costs[i] < *best_cost ||
+        (lane_costs[i] == *best_cost && lane_indices[i] < best)) {
+      *best_cost = lane_costs[i];
+      best = lane_indices[i];
+    }
+  }
+  return best;
+}
+#endif  // MOZC_VITERBI_KERNEL_X86 || MOZC_VITERBI_KERNEL_NEON
+
+#ifdef MOZC_VITERBI_KERNEL_X86
+MOZC_VITERBI_KERNEL_TARGET("sse4.1")
+int FindBestLeftNodeSSE41(const int32 *lcosts, const int32 *transition_costs,
+                          size_t size, int32 *best_cost) {
+  const size_t kNumLanes = 4;
+  if (size < kNumLanes) {
+    return FindBestLeftNodeScalar(lcosts, transition_costs, size, best_cost);
+  }
+  __m128i min_costs = _mm_set1_epi32(*best_cost);
+  __m128i min_indices = _mm_set1_epi32(-1);
+  __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128i step = _mm_set1_epi32(kNumLanes);
+  size_t i = 0;
+  for (; i + kNumLanes <= size; i += kNumLanes) {
+    const __m128i costs = _mm_add_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(lcosts + i)),
+        _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(transition_costs + i)));
+    const __m128i is_less = _mm_cmplt_epi32(costs, min_costs);
+    min_costs = _mm_min_epi32(min_costs, costs);
+    min_indices = _mm_or_si128(_mm_and_si128(is_less, indices),
+                               _mm_andnot_si128(is_less, min_indices));
+    indices = _mm_add_epi32(indices, step);
+  }
+  int32 lane_costs[kNumLanes];
+  int32 lane_indices[kNumLanes];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_costs), min_costs);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_indices), min_indices);
+  const int best = ReduceLanes(lane_costs, lane_indices, kNumLanes, best_cost);
+  return FindBestLeftNodeFrom(lcosts, transition_costs, i, size, best,
+                              best_cost);
+}
+
+MOZC_VITERBI_KERNEL_TARGET("avx2")
+int FindBestLeftNodeAVX2(const int32 *lcosts, const int32 *transition_costs,
+                         size_t size, int32 *best_cost) {
+  const size_t kNumLanes = 8;
+  if (size < kNumLanes) {
+    return FindBestLeftNodeScalar(lcosts, transition_costs, size, best_cost);
+  }
+  __m256i min_costs = _mm256_set1_epi32(*best_cost);
+  __m256i min_indices = _mm256_set1_epi32(-1);
+  __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i step = _mm256_set1_epi32(kNumLanes);
+  size_t i = 0;
+  for (; i + kNumLanes <= size; i += kNumLanes) {
+    const __m256i costs = _mm256_add_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lcosts + i)),
+        _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(transition_costs + i)));
+    const __m256i is_less = _mm256_cmpgt_epi32(min_costs, costs);
+    min_costs = _mm256_min_epi32(min_costs, costs);
+    min_indices = _mm256_or_si256(_mm256_and_si256(is_less, indices),
+                                  _mm256_andnot_si256(is_less, min_indices));
+    indices = _mm256_add_epi32(indices, step);
+  }
+  int32 lane_costs[kNumLanes];
+  int32 lane_indices[kNumLanes];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_costs), min_costs);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_indices), min_indices);
+  const int best = ReduceLanes(lane_costs, lane_indices, kNumLanes, best_cost);
+  return FindBestLeftNodeFrom(lcosts, transition_costs, i, size, best,
+                              best_cost);
+}
+
+bool CpuSupportsSSE41() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 19)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.1");
+#endif  // _MSC_VER
+}
+
+bool CpuSupportsAVX2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  const bool os_saves_ymm =
+      (info[2] & (1 << 27)) != 0 &&  // OSXSAVE
+      (info[2] & (1 << 28)) != 0 &&  // AVX
+      (_xgetbv(0) & 0x6) == 0x6;
+  if (!os_saves_ymm) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif  // _MSC_VER
+}
+#endif  // MOZC_VITERBI_KERNEL_X86
+
+#ifdef MOZC_VITERBI_KERNEL_NEON
+int FindBestLeftNodeNEON(const int32 *lcosts, const int32 *transition_costs,
+                         size_t size, int32 *best_cost) {
+  const size_t kNumLanes = 4;
+  if (size < kNumLanes) {
+    return FindBestLeftNodeScalar(lcosts, transition_costs, size, best_cost);
+  }
+  int32x4_t min_costs = vdupq_n_s32(*best_cost);
+  int32x4_t min_indices = vdupq_n_s32(-1);
+  const int32 kInitialIndices[kNumLanes] = {0, 1, 2, 3};
+  int32x4_t indices = vld1q_s32(kInitialIndices);
+  const int32x4_t step = vdupq_n_s32(kNumLanes);
+  size_t i = 0;
+  for (; i + kNumLanes <= size; i += kNumLanes) {
+    const int32x4_t costs =
+        vaddq_s32(vld1q_s32(lcosts + i), vld1q_s32(transition_costs + i));
+    const uint32x4_t is_less = vcltq_s32(costs, min_costs);
+    min_costs = vbslq_s32(is_less, costs, min_costs);
+    min_indices = vbslq_s32(is_less, indices, min_indices);
+    indices = vaddq_s32(indices, step);
+  }
+  int32 lane_costs[kNumLanes];
+  int32 lane_indices[kNumLanes];
+  vst1q_s32(lane_costs, min_costs);
+  vst1q_s32(lane_indices, min_indices);
+  const int best = ReduceLanes(lane_costs, lane_indices, kNumLanes, best_cost);
+  return FindBestLeftNodeFrom(lcosts, transition_costs, i, size, best,
+                              best_cost);
+}
+#endif  // MOZC_VITERBI_KERNEL_NEON
+
+typedef int (*FindBestLeftNodeFunc)(const int32 *, const int32 *, size_t,
+                                    int32 *);
+
+FindBestLeftNodeFunc GetFunction(ViterbiKernel::Implementation impl) {
+  switch (impl) {
+#ifdef MOZC_VITERBI_KERNEL_X86
+    case ViterbiKernel::SSE41:
+      return &FindBestLeftNodeSSE41;
+    case ViterbiKernel::AVX2:
+      return &FindBestLeftNodeAVX2;
+#endif  // MOZC_VITERBI_KERNEL_X86
+#ifdef MOZC_VITERBI_KERNEL_NEON
+    case ViterbiKernel::NEON:
+      return &FindBestLeftNodeNEON;
+#endif  // MOZC_VITERBI_KERNEL_NEON
+    default:
+      return &FindBestLeftNodeScalar;
+  }
+}
+
+}  // namespace
+
+ViterbiKernel::Implementation ViterbiKernel::GetDefaultImplementation() {
+  static const Implementation kDefault =
+      IsAvailable(AVX2) ? AVX2 :
+      IsAvailable(SSE41) ? SSE41 :
+      IsAvailable(NEON) ? NEON : SCALAR;
+  return kDefault;
+}
+
+bool ViterbiKernel::IsAvailable(Implementation impl) {
+  switch (impl) {
+    case SCALAR:
+      return true;
+#ifdef MOZC_VITERBI_KERNEL_X86
+    case SSE41:
+      return CpuSupportsSSE41();
+    case AVX2:
+      return CpuSupportsAVX2();
+#endif  // MOZC_VITERBI_KERNEL_X86
+#ifdef MOZC_VITERBI_KERNEL_NEON
+    case NEON:
+      return true;
+#endif  // MOZC_VITERBI_KERNEL_NEON
+    default:
+      return false;
+  }
+}
+
+int ViterbiKernel::FindBestLeftNode(const int32 *lcosts,
+                                    const int32 *transition_costs,
+                                    size_t size, int32 *best_cost) {
+  static const FindBestLeftNodeFunc kFunc =
+      GetFunction(GetDefaultImplementation());
+  return (*kFunc)(lcosts, transition_costs, size, best_cost);
+}
+
+int ViterbiKernel::FindBestLeftNodeWithImplementation(
+    Implementation impl, const int32 *lcosts, const int32 *transition_costs,
+    size_t size, int32 *best_cost) {
+  DCHECK(IsAvailable(impl));
+  return (*GetFunction(impl))(lcosts, transition_costs, size, best_cost);
+}
+
+}  // namespace mozc
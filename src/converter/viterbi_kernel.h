@@ -0,0 +1,88 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_CONVERTER_VITERBI_KERNEL_H_
+#define MOZC_CONVERTER_VITERBI_KERNEL_H_
+
+#include "base/port.h"
+
+namespace mozc {
+
+// The inner loop of the Viterbi relaxation: given the costs of the left nodes
+// ending at a position and the transition costs from each of them to a right
+// node, finds the left node minimizing the sum.  The SIMD implementations are
+// selected at runtime from the CPU features and return exactly the same
+// result as the scalar loop, including the tie-breaking rule.
+class ViterbiKernel {
+ public:
+  enum Implementation {
+    SCALAR,
+    SSE41,
+    AVX2,
+    NEON,
+  };
+
+  // Returns the fastest implementation available on this machine.
+  static Implementation GetDefaultImplementation();
+
+  // Returns true if |impl| can run on this machine.
+  static bool IsAvailable(Implementation impl);
+
+  // Returns the smallest index i such that
+  //   lcosts[i] + transition_costs[i] < *best_cost
+  // and the sum is minimal over all the indices, or -1 if no sum is less than
+  // *best_cost.  On success, *best_cost is updated to the minimal sum.  This
+  // is equivalent to the following loop:
+  //   int best = -1;
+  //   for (size_t i = 0; i < size; ++i) {
+  //     const int32 cost = lcosts[i] + transition_costs[i];
+  //     if (cost < *best_cost) {
+  //       *best_cost = cost;
+  //       best = i;
+  //     }
+  //   }
+  static int FindBestLeftNode(const int32 *lcosts,
+                              const int32 *transition_costs,
+                              size_t size, int32 *best_cost);
+
+  // Same as above but always uses |impl|, which must be available.  Exposed
+  // for testing.
+  static int FindBestLeftNodeWithImplementation(Implementation impl,
+                                                const int32 *lcosts,
+                                                const int32 *transition_costs,
+                                                size_t size, int32 *best_cost);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ViterbiKernel);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_VITERBI_KERNEL_H_
@@ -0,0 +1,147 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "converter/viterbi_kernel.h"
+
+#include <climits>
+#include <vector>
+
+#include "base/port.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+const ViterbiKernel::Implementation kImplementations[] = {
+  ViterbiKernel::SCALAR,
+  ViterbiKernel::SSE41,
+  ViterbiKernel::AVX2,
+  ViterbiKernel::NEON,
+};
+
+// The reference loop which the kernel replaces in the Viterbi relaxation.
+int FindBestLeftNodeReference(const std::vector<int32> &lcosts,
+                              const std::vector<int32> &transition_costs,
+                              int32 *best_cost) {
+  int best = -1;
+  for (size_t i = 0; i < lcosts.size(); ++i) {
+    const int32 cost = lcosts[i] + transition_costs[i];
+    if (cost < *best_cost) {
+      *best_cost = cost;
+      best = i;
+    }
+  }
+  return best;
+}
+
+TEST(ViterbiKernelTest, DefaultImplementationIsAvailable) {
+  EXPECT_TRUE(ViterbiKernel::IsAvailable(ViterbiKernel::SCALAR));
+  EXPECT_TRUE(ViterbiKernel::IsAvailable(
+      ViterbiKernel::GetDefaultImplementation()));
+}
+
+TEST(ViterbiKernelTest, EmptyInput) {
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    if (!ViterbiKernel::IsAvailable(kImplementations[i])) {
+      continue;
+    }
+    int32 best_cost = 100;
+    EXPECT_EQ(-1, ViterbiKernel::FindBestLeftNodeWithImplementation(
+        kImplementations[i], NULL, NULL, 0, &best_cost));
+    EXPECT_EQ(100, best_cost);
+  }
+}
+
+TEST(ViterbiKernelTest, NoCostBelowBound) {
+  const std::vector<int32> lcosts(20, 50);
+  const std::vector<int32> transition_costs(20, 50);
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    if (!ViterbiKernel::IsAvailable(kImplementations[i])) {
+      continue;
+    }
+    // The bound is exclusive.
+    int32 best_cost = 100;
+    EXPECT_EQ(-1, ViterbiKernel::FindBestLeftNodeWithImplementation(
+        kImplementations[i], lcosts.data(), transition_costs.data(),
+        lcosts.size(), &best_cost));
+    EXPECT_EQ(100, best_cost);
+  }
+}
+
+TEST(ViterbiKernelTest, FirstMinimumWins) {
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    if (!ViterbiKernel::IsAvailable(kImplementations[i])) {
+      continue;
+    }
+    // The minimum 3 appears at 5, 6 and 12, which fall in different lanes
+    // and different iterations of the SIMD loops.
+    const int32 kLCosts[] = {9, 8, 7, 6, 5, 1, 2, 9, 9, 9, 9, 9, 2, 4, 3};
+    const int32 kTCosts[] = {0, 0, 0, 0, 0, 2, 1, 0, 0, 0, 0, 0, 1, 0, 1};
+    int32 best_cost = INT_MAX;
+    EXPECT_EQ(5, ViterbiKernel::FindBestLeftNodeWithImplementation(
+        kImplementations[i], kLCosts, kTCosts, arraysize(kLCosts),
+        &best_cost));
+    EXPECT_EQ(3, best_cost);
+  }
+}
+
+TEST(ViterbiKernelTest, MatchesReferenceLoop) {
+  Util::SetRandomSeed(0);
+  for (size_t size = 0; size < 70; ++size) {
+    for (int trial = 0; trial < 20; ++trial) {
+      // A small cost range produces many ties.
+      const int range = (trial % 2 == 0) ? 8 : 30000;
+      std::vector<int32> lcosts(size), transition_costs(size);
+      for (size_t i = 0; i < size; ++i) {
+        lcosts[i] = Util::Random(range);
+        transition_costs[i] = Util::Random(range);
+      }
+      const int32 bound = (trial % 4 < 2) ? INT_MAX >> 2 : range;
+      int32 expected_cost = bound;
+      const int expected = FindBestLeftNodeReference(
+          lcosts, transition_costs, &expected_cost);
+      for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+        if (!ViterbiKernel::IsAvailable(kImplementations[i])) {
+          continue;
+        }
+        int32 actual_cost = bound;
+        EXPECT_EQ(expected, ViterbiKernel::FindBestLeftNodeWithImplementation(
+            kImplementations[i], lcosts.data(), transition_costs.data(),
+            size, &actual_cost))
+            << "impl=" << kImplementations[i] << ", size=" << size;
+        EXPECT_EQ(expected_cost, actual_cost);
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mozc
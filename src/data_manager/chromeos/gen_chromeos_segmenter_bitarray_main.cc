@@ -39,11 +39,14 @@ DEFINE_string(output_size_info, "", "Serialized SegmenterDataSizeInfo");
 DEFINE_string(output_ltable, "", "LTable array");
 DEFINE_string(output_rtable, "", "RTable array");
 DEFINE_string(output_bitarray, "", "Segmenter bitarray");
+DEFINE_string(output_boundary_rows, "",
+              "Packed segmenter boundary matrix (optional)");
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, true);
   mozc::SegmenterBitarrayGenerator::GenerateBitarray(
       kLSize, kRSize, &IsBoundaryInternal, FLAGS_output_size_info,
-      FLAGS_output_ltable, FLAGS_output_rtable, FLAGS_output_bitarray);
+      FLAGS_output_ltable, FLAGS_output_rtable, FLAGS_output_bitarray,
+      FLAGS_output_boundary_rows);
   return 0;
 }
@@ -130,6 +130,10 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
     LOG(ERROR) << "Cannot find a connection data";
     return Status::DATA_MISSING;
   }
+  if (!reader.Get("conn_dense", &dense_connection_data_)) {
+    VLOG(2) << "Dense connection matrix is not provided";
+    // Dense connection matrix is optional, so don't return false here.
+  }
   if (!reader.Get("dict", &dictionary_data_)) {
     LOG(ERROR) << "Cannot find a dictionary data";
     return Status::DATA_MISSING;
@@ -180,6 +184,10 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
     LOG(ERROR) << "Cannot find a segmenter bit-array";
     return Status::DATA_MISSING;
   }
+  if (!reader.Get("segmenter_rows", &segmenter_boundary_rows_)) {
+    VLOG(2) << "Packed segmenter boundary matrix is not provided";
+    // Packed boundary matrix is optional, so don't return false here.
+  }
   if (!reader.Get("counter_suffix", &counter_suffix_data_)) {
     LOG(ERROR) << "Cannot find a counter suffix data";
     return Status::DATA_MISSING;
@@ -213,6 +221,19 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       return Status::DATA_BROKEN;
     }
   }
+  if (!reader.Get("suffix_index", &suffix_index_array_data_)) {
+    VLOG(2) << "Suffix dictionary index is not provided";
+    // Suffix dictionary index is optional, so don't return false here.
+  } else {
+    // The index is {bits, (code, begin, end) * 2^bits} of uint32.
+    const uint32 *index =
+        reinterpret_cast<const uint32 *>(suffix_index_array_data_.data());
+    if (suffix_index_array_data_.size() < 4 || index[0] >= 32 ||
+        suffix_index_array_data_.size() != 4 * (1 + 3 * (1 << index[0]))) {
+      LOG(ERROR) << "Suffix dictionary index is broken";
+      return Status::DATA_BROKEN;
+    }
+  }
   if (!reader.Get("reading_correction_value",
                   &reading_correction_value_array_data_)) {
     LOG(ERROR) << "Cannot find reading correction value array";
@@ -239,6 +260,12 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       return Status::DATA_BROKEN;
     }
   }
+  if (!reader.Get("reading_correction_hash_index",
+                  &reading_correction_hash_index_data_)) {
+    VLOG(2) << "Reading correction hash index is not provided";
+    // The hash index is optional, so don't return false here.
+    reading_correction_hash_index_data_.clear();
+  }
   if (!reader.Get("symbol_token", &symbol_token_array_data_)) {
     LOG(ERROR) << "Cannot find a symbol token array";
     return Status::DATA_MISSING;
@@ -277,6 +304,15 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
     LOG(ERROR) << "Emoji rewriter string array data is broken";
     return Status::DATA_BROKEN;
   }
+  if (!reader.Get("symbol_hash_index", &symbol_hash_index_data_) ||
+      !reader.Get("emoticon_hash_index", &emoticon_hash_index_data_) ||
+      !reader.Get("emoji_hash_index", &emoji_hash_index_data_)) {
+    VLOG(2) << "Rewriter hash indices are not provided";
+    // The hash indices are optional, so don't return false here.
+    symbol_hash_index_data_.clear();
+    emoticon_hash_index_data_.clear();
+    emoji_hash_index_data_.clear();
+  }
   if (!reader.Get("single_kanji_token",
                   &single_kanji_token_array_data_) ||
       !reader.Get("single_kanji_string",
@@ -304,6 +340,18 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
     LOG(ERROR) << "Single Kanji data is broken";
     return Status::DATA_BROKEN;
   }
+  if (!reader.Get("single_kanji_hash_index",
+                  &single_kanji_hash_index_data_) ||
+      !reader.Get("single_kanji_variant_hash_index",
+                  &single_kanji_variant_hash_index_data_) ||
+      !reader.Get("single_kanji_noun_prefix_hash_index",
+                  &single_kanji_noun_prefix_hash_index_data_)) {
+    VLOG(2) << "Single Kanji hash indices are not provided";
+    // The hash indices are optional, so don't return false here.
+    single_kanji_hash_index_data_.clear();
+    single_kanji_variant_hash_index_data_.clear();
+    single_kanji_noun_prefix_hash_index_data_.clear();
+  }
   if (!reader.Get("zero_query_token_array",
                   &zero_query_token_array_data_) ||
       !reader.Get("zero_query_string_array",
@@ -321,6 +369,14 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
     LOG(ERROR) << "Zero query data is broken";
     return Status::DATA_BROKEN;
   }
+  if (!reader.Get("zero_query_hash_table", &zero_query_hash_data_) ||
+      !reader.Get("zero_query_number_hash_table",
+                  &zero_query_number_hash_data_)) {
+    VLOG(2) << "Zero query hash tables are not provided";
+    // The hash tables are optional, so don't return false here.
+    zero_query_hash_data_.clear();
+    zero_query_number_hash_data_.clear();
+  }
 
   if (!reader.Get("usage_item_array", &usage_items_data_)) {
     VLOG(2) << "Usage dictionary is not provided";
@@ -332,6 +388,8 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
                     &usage_conjugation_suffix_data_) ||
         !reader.Get("usage_conjugation_index",
                     &usage_conjugation_index_data_) ||
+        !reader.Get("usage_fingerprint_table",
+                    &usage_fingerprint_table_data_) ||
         !reader.Get("usage_string_array",
                     &usage_string_array_data_)) {
       LOG(ERROR) << "Cannot find some usage dictionary data components";
@@ -341,8 +399,17 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       LOG(ERROR) << "Usage dictionary's string array is broken";
       return Status::DATA_BROKEN;
     }
+    // The fingerprint table consists of 16-byte entries; see
+    // gen_usage_rewriter_dictionary_main.cc.
+    if (usage_fingerprint_table_data_.size() % 16 != 0) {
+      LOG(ERROR) << "Usage dictionary's fingerprint table is broken";
+      return Status::DATA_BROKEN;
+    }
   }
 
+  sections_.assign(reader.name_to_data_map().begin(),
+                   reader.name_to_data_map().end());
+
   for (const auto &kv : reader.name_to_data_map()) {
     if (!Util::StartsWith(kv.first, "typing_model")) {
       continue;
@@ -352,6 +419,19 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
   std::sort(typing_model_data_.begin(), typing_model_data_.end(),
             OrderBy<FirstKey, Less>());
 
+  for (const auto &kv : reader.name_to_data_map()) {
+    if (!Util::StartsWith(kv.first, "preedit_")) {
+      continue;
+    }
+    if (!SerializedStringArray::VerifyData(kv.second)) {
+      LOG(ERROR) << "Preedit table " << kv.first << " is broken";
+      return Status::DATA_BROKEN;
+    }
+    preedit_table_data_.push_back(kv);
+  }
+  std::sort(preedit_table_data_.begin(), preedit_table_data_.end(),
+            OrderBy<FirstKey, Less>());
+
   if (!reader.Get("version", &data_version_)) {
     LOG(ERROR) << "Cannot find data version";
     return Status::DATA_MISSING;
@@ -380,7 +460,9 @@ DataManager::Status DataManager::InitFromFile(const string &path) {
 
 DataManager::Status DataManager::InitFromFile(const string &path,
                                               StringPiece magic) {
-  if (!mmap_.Open(path.c_str(), "r")) {
+  // Most of the data, e.g., the dictionaries and the connection matrix, are
+  // looked up at random, where the readahead only wastes the pages.
+  if (!mmap_.Open(path.c_str(), "r", Mmap::RANDOM_ACCESS)) {
     LOG(ERROR) << "Failed to mmap " << path;
     return Status::MMAP_FAILURE;
   }
@@ -404,7 +486,7 @@ DataManager::Status DataManager::InitUserPosManagerDataFromArray(
 
 DataManager::Status DataManager::InitUserPosManagerDataFromFile(
     const string &path, StringPiece magic) {
-  if (!mmap_.Open(path.c_str(), "r")) {
+  if (!mmap_.Open(path.c_str(), "r", Mmap::RANDOM_ACCESS)) {
     LOG(ERROR) << "Failed to mmap " << path;
     return Status::MMAP_FAILURE;
   }
@@ -412,11 +494,50 @@ DataManager::Status DataManager::InitUserPosManagerDataFromFile(
   return InitUserPosManagerDataFromArray(data, magic);
 }
 
+bool DataManager::GetMappedMemoryUsage(Mmap::MemoryUsage *usage) const {
+  return mmap_.GetMemoryUsage(usage);
+}
+
+void DataManager::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  DCHECK(usages);
+  Mmap::MemoryUsage mapped;
+  if (GetMappedMemoryUsage(&mapped)) {
+    // The resident pages not in |shared_bytes| are private to this process,
+    // e.g. the ones no other process has touched.
+    MemoryStats::Usage usage;
+    usage.component = "dataset";
+    usage.virtual_bytes = mmap_.size();
+    usage.resident_bytes = mapped.resident_bytes;
+    usage.shared_bytes = mapped.shared_bytes;
+    usage.count = sections_.size();
+    usages->push_back(usage);
+  }
+  for (const auto &section : sections_) {
+    usages->push_back(MemoryStats::MappedUsage(
+        "dataset:" + section.first, section.second.data(),
+        section.second.size()));
+  }
+}
+
+bool DataManager::ReleaseMappedData() const {
+  if (mmap_.size() == 0) {
+    return false;
+  }
+  return Mmap::MaybeRelease(mmap_.begin(), mmap_.size());
+}
+
 void DataManager::GetConnectorData(const char **data, size_t *size) const {
   *data = connection_data_.data();
   *size = connection_data_.size();
 }
 
+void DataManager::GetDenseConnectorData(const char **data,
+                                        size_t *size) const {
+  *data = dense_connection_data_.data();
+  *size = dense_connection_data_.size();
+}
+
 void DataManager::GetSystemDictionaryData(const char **data, int *size) const {
   *data = dictionary_data_.data();
   *size = dictionary_data_.size();
@@ -466,6 +587,12 @@ void DataManager::GetSegmenterData(
   *boundary_data = reinterpret_cast<const uint16 *>(boundary_data_.data());
 }
 
+void DataManager::GetSegmenterBoundaryRowsData(const char **data,
+                                               size_t *size) const {
+  *data = segmenter_boundary_rows_.data();
+  *size = segmenter_boundary_rows_.size();
+}
+
 void DataManager::GetSuffixDictionaryData(StringPiece *key_array_data,
                                           StringPiece *value_array_data,
                                           const uint32 **token_array) const {
@@ -475,6 +602,11 @@ void DataManager::GetSuffixDictionaryData(StringPiece *key_array_data,
       reinterpret_cast<const uint32 *>(suffix_token_array_data_.data());
 }
 
+void DataManager::GetSuffixDictionaryIndexData(
+    StringPiece *index_array) const {
+  *index_array = suffix_index_array_data_;
+}
+
 void DataManager::GetReadingCorrectionData(
     StringPiece *value_array_data, StringPiece *error_array_data,
     StringPiece *correction_array_data) const {
@@ -483,6 +615,11 @@ void DataManager::GetReadingCorrectionData(
   *correction_array_data = reading_correction_correction_array_data_;
 }
 
+void DataManager::GetReadingCorrectionHashIndexData(
+    StringPiece *hash_index_data) const {
+  *hash_index_data = reading_correction_hash_index_data_;
+}
+
 void DataManager::GetSymbolRewriterData(StringPiece *token_array_data,
                                         StringPiece *string_array_data) const {
   *token_array_data = symbol_token_array_data_;
@@ -501,6 +638,15 @@ void DataManager::GetEmojiRewriterData(
   *string_array_data = emoji_string_array_data_;
 }
 
+void DataManager::GetRewriterHashIndexData(
+    StringPiece *symbol_hash_index_data,
+    StringPiece *emoticon_hash_index_data,
+    StringPiece *emoji_hash_index_data) const {
+  *symbol_hash_index_data = symbol_hash_index_data_;
+  *emoticon_hash_index_data = emoticon_hash_index_data_;
+  *emoji_hash_index_data = emoji_hash_index_data_;
+}
+
 void DataManager::GetSingleKanjiRewriterData(
     StringPiece *token_array_data,
     StringPiece *string_array_data,
@@ -518,6 +664,15 @@ void DataManager::GetSingleKanjiRewriterData(
   *noun_prefix_string_array_data = single_kanji_noun_prefix_string_array_data_;
 }
 
+void DataManager::GetSingleKanjiRewriterHashIndexData(
+    StringPiece *single_kanji_hash_index_data,
+    StringPiece *variant_hash_index_data,
+    StringPiece *noun_prefix_hash_index_data) const {
+  *single_kanji_hash_index_data = single_kanji_hash_index_data_;
+  *variant_hash_index_data = single_kanji_variant_hash_index_data_;
+  *noun_prefix_hash_index_data = single_kanji_noun_prefix_hash_index_data_;
+}
+
 void DataManager::GetCounterSuffixSortedArray(const char **array,
                                               size_t *size) const {
   *array = counter_suffix_data_.data();
@@ -535,17 +690,26 @@ void DataManager::GetZeroQueryData(
   *zero_query_number_string_array_data = zero_query_number_string_array_data_;
 }
 
+void DataManager::GetZeroQueryHashData(
+    StringPiece *zero_query_hash_data,
+    StringPiece *zero_query_number_hash_data) const {
+  *zero_query_hash_data = zero_query_hash_data_;
+  *zero_query_number_hash_data = zero_query_number_hash_data_;
+}
+
 #ifndef NO_USAGE_REWRITER
 void DataManager::GetUsageRewriterData(
     StringPiece *base_conjugation_suffix_data,
     StringPiece *conjugation_suffix_data,
     StringPiece *conjugation_index_data,
     StringPiece *usage_items_data,
+    StringPiece *fingerprint_table_data,
     StringPiece *string_array_data) const {
   *base_conjugation_suffix_data = usage_base_conjugation_suffix_data_;
   *conjugation_suffix_data = usage_conjugation_suffix_data_;
   *conjugation_index_data = usage_conjugation_index_data_;
   *usage_items_data = usage_items_data_;
+  *fingerprint_table_data = usage_fingerprint_table_data_;
   *string_array_data = usage_string_array_data_;
 }
 #endif  // NO_USAGE_REWRITER
@@ -562,6 +726,18 @@ StringPiece DataManager::GetTypingModel(const string &name) const {
   return iter->second;
 }
 
+StringPiece DataManager::GetPreeditTable(const string &name) const {
+  const auto iter = std::lower_bound(
+      preedit_table_data_.begin(), preedit_table_data_.end(), name,
+      [](const std::pair<string, StringPiece> &elem, const string &key) {
+        return elem.first < key;
+      });
+  if (iter == preedit_table_data_.end() || iter->first != name) {
+    return StringPiece();
+  }
+  return iter->second;
+}
+
 StringPiece DataManager::GetDataVersion() const {
   return data_version_;
 }
@@ -84,11 +84,26 @@ class DataManager : public DataManagerInterface {
   Status InitUserPosManagerDataFromArray(StringPiece array, StringPiece magic);
   Status InitUserPosManagerDataFromFile(const string &path, StringPiece magic);
 
+  // Reports the memory usage of the data set file mapped by InitFromFile().
+  // The file is mapped read only and shared, so every process loading the same
+  // file shares its pages; see Mmap::MemoryUsage.  Returns false if the data
+  // set was given by InitFromArray() or the platform doesn't support it.
+  bool GetMappedMemoryUsage(Mmap::MemoryUsage *usage) const;
+
+  // Reports the mapped file as "dataset" if any, and each data in the data
+  // set as "dataset:<name>", e.g. "dataset:conn".
+  void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const override;
+
+  // Releases the pages of the mapped file by Mmap::MaybeRelease().
+  bool ReleaseMappedData() const override;
+
   // Implementation of DataManagerInterface.
   const uint16 *GetPOSMatcherData() const override;
   void GetUserPOSData(StringPiece *token_array_data,
                       StringPiece *string_array_data) const override;
   void GetConnectorData(const char **data, size_t *size) const override;
+  void GetDenseConnectorData(const char **data, size_t *size) const override;
   void GetSystemDictionaryData(const char **data, int *size) const override;
   void GetCollocationData(const char **array, size_t *size) const override;
   void GetCollocationSuppressionData(const char **array,
@@ -99,20 +114,29 @@ class DataManager : public DataManagerInterface {
                         const uint16 **l_table, const uint16 **r_table,
                         size_t *bitarray_num_bytes, const char **bitarray_data,
                         const uint16 **boundary_data) const override;
+  void GetSegmenterBoundaryRowsData(const char **data,
+                                    size_t *size) const override;
   void GetCounterSuffixSortedArray(const char **array,
                                    size_t *size) const override;
   void GetSuffixDictionaryData(StringPiece *key_array_data,
                                StringPiece *value_array_data,
                                const uint32 **token_array) const override;
+  void GetSuffixDictionaryIndexData(StringPiece *index_array) const override;
   void GetReadingCorrectionData(
       StringPiece *value_array_data, StringPiece *error_array_data,
       StringPiece *correction_array_data) const override;
+  void GetReadingCorrectionHashIndexData(
+      StringPiece *hash_index_data) const override;
   void GetSymbolRewriterData(StringPiece *token_array_data,
                              StringPiece *string_array_data) const override;
   void GetEmoticonRewriterData(StringPiece *token_array_data,
                                StringPiece *string_array_data) const override;
   void GetEmojiRewriterData(StringPiece *token_array_data,
                             StringPiece *string_array_data) const override;
+  void GetRewriterHashIndexData(
+      StringPiece *symbol_hash_index_data,
+      StringPiece *emoticon_hash_index_data,
+      StringPiece *emoji_hash_index_data) const override;
   void GetSingleKanjiRewriterData(
       StringPiece *token_array_data,
       StringPiece *string_array_data,
@@ -121,11 +145,18 @@ class DataManager : public DataManagerInterface {
       StringPiece *variant_string_array_data,
       StringPiece *noun_prefix_token_array_data,
       StringPiece *noun_prefix_string_array_data) const override;
+  void GetSingleKanjiRewriterHashIndexData(
+      StringPiece *single_kanji_hash_index_data,
+      StringPiece *variant_hash_index_data,
+      StringPiece *noun_prefix_hash_index_data) const override;
   void GetZeroQueryData(
       StringPiece *zero_query_token_array_data,
       StringPiece *zero_query_string_array_data,
       StringPiece *zero_query_number_token_array_data,
       StringPiece *zero_query_number_string_array_data) const override;
+  void GetZeroQueryHashData(
+      StringPiece *zero_query_hash_data,
+      StringPiece *zero_query_number_hash_data) const override;
 
 #ifndef NO_USAGE_REWRITER
   void GetUsageRewriterData(
@@ -133,10 +164,12 @@ class DataManager : public DataManagerInterface {
       StringPiece *conjugation_suffix_data,
       StringPiece *conjugation_index_data,
       StringPiece *usage_items_data,
+      StringPiece *fingerprint_table_data,
       StringPiece *string_array_data) const override;
 #endif  // NO_USAGE_REWRITER
 
   StringPiece GetTypingModel(const string &name) const override;
+  StringPiece GetPreeditTable(const string &name) const override;
   StringPiece GetDataVersion() const override;
 
  private:
@@ -147,6 +180,7 @@ class DataManager : public DataManagerInterface {
   StringPiece user_pos_token_array_data_;
   StringPiece user_pos_string_array_data_;
   StringPiece connection_data_;
+  StringPiece dense_connection_data_;
   StringPiece dictionary_data_;
   StringPiece suggestion_filter_data_;
   StringPiece collocation_data_;
@@ -158,19 +192,25 @@ class DataManager : public DataManagerInterface {
   StringPiece segmenter_ltable_;
   StringPiece segmenter_rtable_;
   StringPiece segmenter_bitarray_;
+  StringPiece segmenter_boundary_rows_;
   StringPiece counter_suffix_data_;
   StringPiece suffix_key_array_data_;
   StringPiece suffix_value_array_data_;
   StringPiece suffix_token_array_data_;
+  StringPiece suffix_index_array_data_;
   StringPiece reading_correction_value_array_data_;
   StringPiece reading_correction_error_array_data_;
   StringPiece reading_correction_correction_array_data_;
+  StringPiece reading_correction_hash_index_data_;
   StringPiece symbol_token_array_data_;
   StringPiece symbol_string_array_data_;
   StringPiece emoticon_token_array_data_;
   StringPiece emoticon_string_array_data_;
   StringPiece emoji_token_array_data_;
   StringPiece emoji_string_array_data_;
+  StringPiece symbol_hash_index_data_;
+  StringPiece emoticon_hash_index_data_;
+  StringPiece emoji_hash_index_data_;
   StringPiece single_kanji_token_array_data_;
   StringPiece single_kanji_string_array_data_;
   StringPiece single_kanji_variant_type_data_;
@@ -178,17 +218,26 @@ class DataManager : public DataManagerInterface {
   StringPiece single_kanji_variant_string_array_data_;
   StringPiece single_kanji_noun_prefix_token_array_data_;
   StringPiece single_kanji_noun_prefix_string_array_data_;
+  StringPiece single_kanji_hash_index_data_;
+  StringPiece single_kanji_variant_hash_index_data_;
+  StringPiece single_kanji_noun_prefix_hash_index_data_;
   StringPiece zero_query_token_array_data_;
   StringPiece zero_query_string_array_data_;
   StringPiece zero_query_number_token_array_data_;
   StringPiece zero_query_number_string_array_data_;
+  StringPiece zero_query_hash_data_;
+  StringPiece zero_query_number_hash_data_;
   StringPiece usage_base_conjugation_suffix_data_;
   StringPiece usage_conjugation_suffix_data_;
   StringPiece usage_conjugation_index_data_;
   StringPiece usage_items_data_;
+  StringPiece usage_fingerprint_table_data_;
   StringPiece usage_string_array_data_;
   std::vector<std::pair<string, StringPiece>> typing_model_data_;
+  std::vector<std::pair<string, StringPiece>> preedit_table_data_;
   StringPiece data_version_;
+  // All the data in the data set by name, for the memory usage.
+  std::vector<std::pair<string, StringPiece>> sections_;
 
   DISALLOW_COPY_AND_ASSIGN(DataManager);
 };
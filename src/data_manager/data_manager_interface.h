@@ -31,7 +31,9 @@
 #define MOZC_DATA_MANAGER_DATA_MANAGER_INTERFACE_H_
 
 #include <string>
+#include <vector>
 
+#include "base/memory_stats.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 
@@ -57,6 +59,12 @@ class DataManagerInterface {
   // Returns the address of connection data and its size.
   virtual void GetConnectorData(const char **data, size_t *size) const = 0;
 
+  // Returns the address of uncompressed (dense) connection matrix and its
+  // size.  Since this data is optional, |*data| is set to nullptr and |*size|
+  // to 0 if the data set doesn't contain it.
+  virtual void GetDenseConnectorData(const char **data,
+                                     size_t *size) const = 0;
+
   // Returns the addresses and their sizes necessary to create a segmenter.
   virtual void GetSegmenterData(
       size_t *l_num_elements, size_t *r_num_elements,
@@ -64,6 +72,12 @@ class DataManagerInterface {
       size_t *bitarray_num_bytes, const char **bitarray_data,
       const uint16 **boundary_data) const = 0;
 
+  // Returns the address of the packed segmenter boundary matrix and its size.
+  // Since this data is optional, |*data| is set to nullptr and |*size| to 0 if
+  // the data set doesn't contain it.
+  virtual void GetSegmenterBoundaryRowsData(const char **data,
+                                            size_t *size) const = 0;
+
   // Returns the address of system dictionary data and its size.
   virtual void GetSystemDictionaryData(const char **data, int *size) const = 0;
 
@@ -72,11 +86,23 @@ class DataManagerInterface {
                                        StringPiece *value_array,
                                        const uint32 **token_array) const = 0;
 
+  // Returns the first character index of the suffix dictionary keys.  Since
+  // this data is optional, |*index_array| is set to empty if the data set
+  // doesn't contain it.
+  virtual void GetSuffixDictionaryIndexData(
+      StringPiece *index_array) const = 0;
+
   // Gets a reference to reading correction data array and its size.
   virtual void GetReadingCorrectionData(
       StringPiece *value_array_data, StringPiece *error_array_data,
       StringPiece *correction_array_data) const = 0;
 
+  // Gets the optional hash index of reading correction data keyed by
+  // "error\tvalue".  Empty data is returned if the data set doesn't contain
+  // it.  See SerializedDictionary::HashIndex for the format.
+  virtual void GetReadingCorrectionHashIndexData(
+      StringPiece *hash_index_data) const = 0;
+
   // Gets the address of collocation data array and its size.
   virtual void GetCollocationData(const char **array, size_t *size) const = 0;
 
@@ -100,6 +126,14 @@ class DataManagerInterface {
   virtual void GetEmojiRewriterData(
       StringPiece *token_array_data, StringPiece *string_array_data) const = 0;
 
+  // Gets the hash indices of symbol, emoticon and emoji rewriter data.  Since
+  // they are optional, empty data are returned if the data set doesn't contain
+  // them.  See SerializedDictionary::HashIndex for the format.
+  virtual void GetRewriterHashIndexData(
+      StringPiece *symbol_hash_index_data,
+      StringPiece *emoticon_hash_index_data,
+      StringPiece *emoji_hash_index_data) const = 0;
+
   // Gets SingleKanjiRewriter data.
   virtual void GetSingleKanjiRewriterData(
       StringPiece *token_array_data,
@@ -110,6 +144,15 @@ class DataManagerInterface {
       StringPiece *noun_prefix_token_array_data,
       StringPiece *noun_prefix_string_array_data) const = 0;
 
+  // Gets the optional hash indices of SingleKanjiRewriter data from a reading
+  // to its kanji list, from a kanji to its variant and from a reading to its
+  // noun prefixes.  Empty data are returned if the data set doesn't contain
+  // them.  See SerializedDictionary::HashIndex for the format.
+  virtual void GetSingleKanjiRewriterHashIndexData(
+      StringPiece *single_kanji_hash_index_data,
+      StringPiece *variant_hash_index_data,
+      StringPiece *noun_prefix_hash_index_data) const = 0;
+
 #ifndef NO_USAGE_REWRITER
   // Gets the usage rewriter data.
   virtual void GetUsageRewriterData(
@@ -117,6 +160,7 @@ class DataManagerInterface {
       StringPiece *conjugation_suffix_data,
       StringPiece *conjugation_suffix_index_data,
       StringPiece *usage_items_data,
+      StringPiece *fingerprint_table_data,
       StringPiece *string_array_data) const = 0;
 #endif  // NO_USAGE_REWRITER
 
@@ -131,12 +175,35 @@ class DataManagerInterface {
       StringPiece *zero_query_number_token_array_data,
       StringPiece *zero_query_number_string_array_data) const = 0;
 
+  // Gets the perfect hash indices of the zero query prediction data.  Since
+  // they are optional, empty data are returned if the data set doesn't contain
+  // them.  See prediction/zero_query_dict.h for the format.
+  virtual void GetZeroQueryHashData(
+      StringPiece *zero_query_hash_data,
+      StringPiece *zero_query_number_hash_data) const = 0;
+
   // Gets the typing model binary data for the specified name.
   virtual StringPiece GetTypingModel(const string &name) const = 0;
 
+  // Gets the precompiled preedit table for the specified name, e.g.,
+  // "preedit_romanji-hiragana.tsv".  Since the tables are optional, empty
+  // data is returned if the data set doesn't contain it.  See
+  // composer/internal/gen_preedit_table.py for the format.
+  virtual StringPiece GetPreeditTable(const string &name) const = 0;
+
   // Gets the data version string.
   virtual StringPiece GetDataVersion() const = 0;
 
+  // Appends the memory used by the data set to |usages|.  See MemoryStats.
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const {}
+
+  // Drops the pages of the data set mapped from a file out of this process,
+  // e.g., on memory pressure.  They are read again from the file when they
+  // are accessed next.  Returns false if nothing was released, e.g., the
+  // data set is not mapped from a file.
+  virtual bool ReleaseMappedData() const { return false; }
+
  protected:
   DataManagerInterface() = default;
 
@@ -162,6 +162,81 @@ void DataManagerTestBase::SegmenterTest_ParticleTest() {
   EXPECT_FALSE(segmenter->IsBoundary(lnode, rnode, false));
 }
 
+void DataManagerTestBase::SegmenterTest_PackedBoundaryRows() {
+  size_t l_num_elements = 0, r_num_elements = 0, bitarray_num_bytes = 0;
+  const uint16 *l_table = nullptr, *r_table = nullptr, *boundary_data = nullptr;
+  const char *bitarray_data = nullptr;
+  data_manager_->GetSegmenterData(&l_num_elements, &r_num_elements,
+                                  &l_table, &r_table,
+                                  &bitarray_num_bytes, &bitarray_data,
+                                  &boundary_data);
+
+  // Build the packed boundary matrix in the same way as
+  // gen_segmenter_bitarray.
+  const size_t row_size = Segmenter::GetBoundaryRowSize(r_num_elements);
+  EXPECT_EQ(0, row_size % 64);
+  std::vector<uint32> rows(l_num_elements * row_size / 4, 0);
+  for (size_t rid = 0; rid < lsize_; ++rid) {
+    for (size_t lid = 0; lid < rsize_; ++lid) {
+      if (is_boundary_(rid, lid)) {
+        const uint32 bit = r_table[lid];
+        rows[l_table[rid] * row_size / 4 + (bit >> 5)] |= 1u << (bit & 0x1F);
+      }
+    }
+  }
+  std::unique_ptr<Segmenter> packed(new Segmenter(
+      l_num_elements, r_num_elements, l_table, r_table,
+      bitarray_num_bytes, bitarray_data,
+      reinterpret_cast<const char *>(rows.data()), rows.size() * 4,
+      boundary_data));
+  std::unique_ptr<Segmenter> compressed(
+      Segmenter::CreateFromDataManager(*data_manager_));
+
+  std::vector<uint16> lids(rsize_);
+  std::vector<Node> rnodes(rsize_);
+  std::vector<const Node *> rnode_ptrs(rsize_);
+  for (size_t lid = 0; lid < rsize_; ++lid) {
+    lids[lid] = lid;
+    rnodes[lid].Init();
+    rnodes[lid].node_type = Node::NOR_NODE;
+    rnodes[lid].lid = lid;
+    rnode_ptrs[lid] = &rnodes[lid];
+  }
+  // The last rnode is EOS, which is always a boundary.
+  rnodes[rsize_ - 1].node_type = Node::EOS_NODE;
+
+  std::unique_ptr<bool[]> packed_results(new bool[rsize_]);
+  std::unique_ptr<bool[]> compressed_results(new bool[rsize_]);
+  Node lnode;
+  lnode.Init();
+  lnode.node_type = Node::NOR_NODE;
+  for (size_t rid = 0; rid < lsize_; ++rid) {
+    packed->IsBoundary(rid, lids.data(), lids.size(), packed_results.get());
+    compressed->IsBoundary(rid, lids.data(), lids.size(),
+                           compressed_results.get());
+    for (size_t lid = 0; lid < rsize_; ++lid) {
+      EXPECT_EQ(is_boundary_(rid, lid), packed->IsBoundary(rid, lid))
+          << rid << " " << lid;
+      EXPECT_EQ(is_boundary_(rid, lid), packed_results[lid])
+          << rid << " " << lid;
+      EXPECT_EQ(is_boundary_(rid, lid), compressed_results[lid])
+          << rid << " " << lid;
+    }
+
+    lnode.rid = rid;
+    for (int single = 0; single < 2; ++single) {
+      const bool is_single_segment = (single == 1);
+      packed->IsBoundary(lnode, rnode_ptrs.data(), rnode_ptrs.size(),
+                         is_single_segment, packed_results.get());
+      for (size_t lid = 0; lid < rsize_; ++lid) {
+        EXPECT_EQ(compressed->IsBoundary(lnode, rnodes[lid],
+                                         is_single_segment),
+                  packed_results[lid]) << rid << " " << lid;
+      }
+    }
+  }
+}
+
 void DataManagerTestBase::ConnectorTest_RandomValueCheck() {
   std::unique_ptr<const Connector> connector(
       Connector::CreateFromDataManager(*data_manager_));
@@ -289,6 +364,7 @@ void DataManagerTestBase::RunAllTests() {
   ConnectorTest_RandomValueCheck();
   SegmenterTest_LNodeTest();
   SegmenterTest_NodeTest();
+  SegmenterTest_PackedBoundaryRows();
   SegmenterTest_ParticleTest();
   SegmenterTest_RNodeTest();
   SegmenterTest_SameAsInternal();
@@ -66,6 +66,7 @@ class DataManagerTestBase : public ::testing::Test {
   void ConnectorTest_RandomValueCheck();
   void SegmenterTest_LNodeTest();
   void SegmenterTest_NodeTest();
+  void SegmenterTest_PackedBoundaryRows();
   void SegmenterTest_ParticleTest();
   void SegmenterTest_RNodeTest();
   void SegmenterTest_SameAsInternal();
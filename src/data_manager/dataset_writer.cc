@@ -68,6 +68,12 @@ void DataSetWriter::AddFile(const string &name, int alignment,
   Add(name, alignment, ifs.Read());
 }
 
+void DataSetWriter::AlignToPage(int page_size) {
+  CHECK(page_size > 0 && (page_size & (page_size - 1)) == 0)
+      << "Invalid page size: " << page_size;
+  AppendPaddingBytes(page_size);
+}
+
 void DataSetWriter::Finish(std::ostream *output) {
   const string s = metadata_.SerializeAsString();
   image_.append(s);  // Metadata
@@ -87,9 +93,12 @@ void DataSetWriter::Finish(std::ostream *output) {
 
 void DataSetWriter::AppendPadding(int alignment) {
   CHECK(IsValidAlignment(alignment)) << "Invalid alignment: " << alignment;
-  alignment /= 8;  // To byte
-  if (image_.size() % alignment > 0) {
-    image_.append(alignment - image_.size() % alignment, '\0');
+  AppendPaddingBytes(alignment / 8);  // To byte
+}
+
+void DataSetWriter::AppendPaddingBytes(size_t alignment_bytes) {
+  if (image_.size() % alignment_bytes > 0) {
+    image_.append(alignment_bytes - image_.size() % alignment_bytes, '\0');
   }
 }
 
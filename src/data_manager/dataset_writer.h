@@ -54,6 +54,11 @@ class DataSetWriter {
   // Similar to Add() for StringPiece but data is read from file.
   void AddFile(const string &name, int alignment, const string &filepath);
 
+  // Pads the image so that the next data starts at a multiple of |page_size|
+  // bytes, which must be a power of two.  Used to keep frequently accessed
+  // data on its own pages, separated from rarely accessed data.
+  void AlignToPage(int page_size);
+
   // Writes the image to output.  If |output| is a file, it should be opened in
   // binary mode.
   void Finish(std::ostream *output);
@@ -62,6 +67,7 @@ class DataSetWriter {
 
  private:
   void AppendPadding(int alignment);
+  void AppendPaddingBytes(size_t alignment_bytes);
 
   string image_;
   DataSetMetadata metadata_;
@@ -41,7 +41,19 @@
 //
 // where alignment must be one of {8, 16, 32, 64}.  Each packed file can be
 // retrieved by DataSetReader through its name.
+//
+// Files are reordered by access temperature so that cold start touches as few
+// pages as possible: hot files first, then files in the given order, then
+// rarely used rewriter data.  Each group starts at a page boundary.  The hot
+// files are given by --access_profile, a text file listing names from the
+// hottest one per line; without it, a built-in list is used.  The profile
+// written by AccessProfiler (base/access_profiler.h) can be given as is, as
+// its data are ordered from the hottest one and only the first field, the
+// name, of each line is used.
 
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -56,6 +68,80 @@
 
 DEFINE_string(magic, "", "Hex-encoded magic number to be embedded");
 DEFINE_string(output, "", "Output file");
+DEFINE_string(access_profile, "",
+              "File listing hot data names in access order, one per line, "
+              "or the profile written by AccessProfiler");
+DEFINE_int32(page_size, 4096, "Byte boundary between hot and cold data");
+
+namespace {
+
+// Data read on every conversion, from the first key event.
+const char *kDefaultHotNames[] = {
+  "conn",
+  "segmenter_sizeinfo",
+  "segmenter_ltable",
+  "segmenter_rtable",
+  "segmenter_bitarray",
+  "dict",
+  "pos_matcher",
+  "bdry",
+  "posg",
+};
+
+// Rewriter data read only for particular inputs.
+const char *kColdNamePrefixes[] = {
+  "reading_correction_",
+  "symbol_",
+  "emoticon_",
+  "emoji_",
+  "single_kanji_",
+  "zero_query_",
+};
+
+enum Temperature {
+  HOT,
+  WARM,
+  COLD,
+};
+
+Temperature GetTemperature(const string &name,
+                           const std::map<string, int> &hot_rank) {
+  if (hot_rank.find(name) != hot_rank.end()) {
+    return HOT;
+  }
+  for (const char *prefix : kColdNamePrefixes) {
+    if (mozc::Util::StartsWith(name, prefix)) {
+      return COLD;
+    }
+  }
+  return WARM;
+}
+
+void LoadHotRank(std::map<string, int> *hot_rank) {
+  std::vector<string> names;
+  if (FLAGS_access_profile.empty()) {
+    names.assign(std::begin(kDefaultHotNames), std::end(kDefaultHotNames));
+  } else {
+    mozc::InputFileStream ifs(FLAGS_access_profile.c_str());
+    CHECK(ifs.good()) << "Failed to open " << FLAGS_access_profile;
+    string line;
+    while (!getline(ifs, line).fail()) {
+      mozc::Util::ChopReturns(&line);
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      names.push_back(line.substr(0, line.find('\t')));
+    }
+  }
+  for (const string &name : names) {
+    if (hot_rank->find(name) == hot_rank->end()) {
+      hot_rank->insert(
+          std::make_pair(name, static_cast<int>(hot_rank->size())));
+    }
+  }
+}
+
+}  // namespace
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, true);
@@ -88,15 +174,35 @@ int main(int argc, char **argv) {
 
   CHECK(!FLAGS_output.empty()) << "--output is required";
 
+  std::map<string, int> hot_rank;
+  LoadHotRank(&hot_rank);
+  std::vector<std::pair<Temperature, int>> keys;
+  for (const auto &input : inputs) {
+    const Temperature t = GetTemperature(input.name, hot_rank);
+    keys.emplace_back(t, t == HOT ? hot_rank[input.name] : 0);
+  }
+  std::vector<size_t> order(inputs.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  // Warm and cold data keep the given order.
+  std::stable_sort(order.begin(), order.end(),
+                   [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
   // DataSetWriter directly writes to the specified stream, so if it fails for
   // an input, the output contains a partial result.  To avoid such partial file
   // creation, write to a temporary file then rename it.
   const string tmpfile = FLAGS_output + ".tmp";
   {
     mozc::DataSetWriter writer(magic);
-    for (const auto &input : inputs) {
+    for (size_t i = 0; i < order.size(); ++i) {
+      const Input &input = inputs[order[i]];
+      const Temperature t = keys[order[i]].first;
+      if (i == 0 || t != keys[order[i - 1]].first) {
+        writer.AlignToPage(FLAGS_page_size);
+      }
       VLOG(1) << "Writing " << input.name << ", alignment = " << input.alignment
-              << ", file = " << input.filename;
+              << ", file = " << input.filename << ", temperature = " << t;
       writer.AddFile(input.name, input.alignment, input.filename);
     }
     mozc::OutputFileStream output(tmpfile.c_str(),
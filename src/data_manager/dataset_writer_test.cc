@@ -116,5 +116,28 @@ TEST(DatasetWriterTest, Write) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST(DatasetWriterTest, AlignToPage) {
+  DataSetWriter w("magic");
+  w.AlignToPage(4096);
+  w.Add("hot", 32, "hot data");
+  w.AlignToPage(4096);
+  w.Add("cold", 8, "cold data");
+  // Already at a page boundary, so no padding is added.
+  w.AlignToPage(1);
+  w.Add("colder", 8, "colder data");
+
+  ASSERT_EQ(3, w.metadata().entries_size());
+  EXPECT_EQ(4096, w.metadata().entries(0).offset());
+  EXPECT_EQ(8192, w.metadata().entries(1).offset());
+  EXPECT_EQ(8192 + 9, w.metadata().entries(2).offset());
+
+  std::stringstream out;
+  w.Finish(&out);
+  const string image = out.str();
+  EXPECT_EQ("hot data", image.substr(4096, 8));
+  EXPECT_EQ(string(4096 - 8, '\0'), image.substr(4096 + 8, 4096 - 8));
+  EXPECT_EQ("cold data", image.substr(8192, 9));
+}
+
 }  // namespace
 }  // namespace mozc
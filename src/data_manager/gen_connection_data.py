@@ -46,6 +46,10 @@ INVALID_COST = 30000
 INVALID_1BYTE_COST = 255
 RESOLUTION_FOR_1BYTE = 64
 FILE_MAGIC = '\xAB\xCD'
+DENSE_FILE_MAGIC = '\xAC\xCD'
+REORDERED_FILE_MAGIC = '\xAD\xCD'
+# The name of the connection data in the data set and the access profile.
+ACCESS_PROFILE_NAME = 'conn'
 
 FALSE_VALUES = ['f', 'false', '0']
 TRUE_VALUES = ['t', 'true', '1']
@@ -144,7 +148,31 @@ def OutputBitList(bit_list, stream):
     stream.write(struct.pack('B', byte))
 
 
-def BuildBinaryData(matrix, mode_value_list, use_1byte_cost):
+def ReadRowOrder(access_profile_file, matrix_size):
+  """Returns the rids in the order of the access profile.
+
+  The access profile is written by base/access_profiler.h, and lists the
+  accessed rows from the hottest one.  The rows not in the profile follow in
+  the order of rid.
+  """
+  order = []
+  seen = set()
+  with open(access_profile_file) as stream:
+    for line in stream:
+      line = line.rstrip('\r\n')
+      if not line or line.startswith('#'):
+        continue
+      name, index, _ = line.split('\t')
+      rid = int(index)
+      if name != ACCESS_PROFILE_NAME or rid >= matrix_size or rid in seen:
+        continue
+      order.append(rid)
+      seen.add(rid)
+  order.extend(rid for rid in xrange(matrix_size) if rid not in seen)
+  return order
+
+
+def BuildBinaryData(matrix, mode_value_list, use_1byte_cost, row_order=None):
   # To compress the connection data, we use two-level succinct bit vector.
   #
   # The basic idea to compress the rid-lid matrix is compressing each row as
@@ -170,6 +198,11 @@ def BuildBinaryData(matrix, mode_value_list, use_1byte_cost):
   # A list of mode values: 2bytes * rids (aligned to 32bits)
   # A list of row data.
   #
+  # If |row_order| is given, the rows are stored in that order so that the hot
+  # rows share pages, and the file starts with REORDERED_FILE_MAGIC
+  # (\xAD\xCD) instead.  Each row data is then preceded by its rid and 2
+  # bytes of padding.
+  #
   # The row data format is as follows:
   # The size of compact bits in bytes: 2bytes
   # The size of values in bytes: 2bytes
@@ -182,7 +215,10 @@ def BuildBinaryData(matrix, mode_value_list, use_1byte_cost):
   stream = StringIO.StringIO()
 
   # Output header.
-  stream.write(FILE_MAGIC)
+  if row_order is None:
+    stream.write(FILE_MAGIC)
+  else:
+    stream.write(REORDERED_FILE_MAGIC)
   matrix_size = len(matrix)
   assert 0 <= matrix_size <= 65535
   stream.write(struct.pack('<HHH', resolution, matrix_size, matrix_size))
@@ -197,7 +233,9 @@ def BuildBinaryData(matrix, mode_value_list, use_1byte_cost):
     stream.write('\x00\x00')
 
   # Process each row:
+  row_images = []
   for row in matrix:
+    row_stream = StringIO.StringIO()
     chunk_bits = []
     compact_bits = []
     values = []
@@ -237,17 +275,61 @@ def BuildBinaryData(matrix, mode_value_list, use_1byte_cost):
       values_size = len(values) * 2
 
     # Output the bits for a row.
-    stream.write(struct.pack('<HH', len(compact_bits) / 8, values_size))
-    OutputBitList(chunk_bits, stream)
-    OutputBitList(compact_bits, stream)
+    row_stream.write(struct.pack('<HH', len(compact_bits) / 8, values_size))
+    OutputBitList(chunk_bits, row_stream)
+    OutputBitList(compact_bits, row_stream)
     if use_1byte_cost:
       for value in values:
         assert 0 <= value <= 255
-        stream.write(struct.pack('<B', value))
+        row_stream.write(struct.pack('<B', value))
     else:
       for value in values:
         assert 0 <= value <= 65535
-        stream.write(struct.pack('<H', value))
+        row_stream.write(struct.pack('<H', value))
+    row_images.append(row_stream.getvalue())
+
+  if row_order is None:
+    for row_image in row_images:
+      stream.write(row_image)
+  else:
+    assert sorted(row_order) == range(matrix_size)
+    for rid in row_order:
+      stream.write(struct.pack('<HH', rid, 0))
+      stream.write(row_images[rid])
+
+  return stream.getvalue()
+
+
+def BuildDenseBinaryData(matrix, mode_value_list, use_1byte_cost):
+  # Uncompressed rid-lid matrix so that the converter can look up a cost by a
+  # single array access. Each cost is exactly the value the compressed format
+  # decodes to, i.e., the mode values are kept as is, and the other values are
+  # rounded by the resolution if use_1byte_cost is set.
+  #
+  # The file format is as follows:
+  # DENSE_FILE_MAGIC (\xAC\xCD): 2bytes
+  # Resolution: 2bytes
+  # Num rids: 2bytes
+  # Num lids: 2bytes
+  # Costs in rid-major order: 2bytes * rids * lids
+  if use_1byte_cost:
+    resolution = RESOLUTION_FOR_1BYTE
+  else:
+    resolution = 1
+  stream = StringIO.StringIO()
+
+  stream.write(DENSE_FILE_MAGIC)
+  matrix_size = len(matrix)
+  assert 0 <= matrix_size <= 65535
+  stream.write(struct.pack('<HHH', resolution, matrix_size, matrix_size))
+
+  assert len(matrix) == len(mode_value_list)
+  for row, mode_value in itertools.izip(matrix, mode_value_list):
+    for cost in row:
+      if cost != mode_value and cost != INVALID_COST:
+        cost = cost / resolution * resolution
+      assert 0 <= cost <= 32767
+      stream.write(struct.pack('<h', cost))
 
   return stream.getvalue()
 
@@ -260,7 +342,10 @@ def ParseOptions():
   parser.add_option('--target_compiler', dest='target_compiler')
   parser.add_option('--use_1byte_cost', dest='use_1byte_cost')
   parser.add_option('--binary_output_file', dest='binary_output_file')
+  parser.add_option('--dense_binary_output_file',
+                    dest='dense_binary_output_file')
   parser.add_option('--header_output_file', dest='header_output_file')
+  parser.add_option('--access_profile', dest='access_profile')
   return parser.parse_args()[0]
 
 
@@ -272,9 +357,24 @@ def main():
   matrix = ParseConnectionFile(
       options.text_connection_file, pos_size, special_pos_size)
   mode_value_list = CreateModeValueList(matrix)
+  use_1byte_cost = ParseBoolFlag(options.use_1byte_cost)
+
+  # The dense matrix needs to be built before the compression, which
+  # overwrites the mode values in |matrix|.
+  if options.dense_binary_output_file:
+    dense_binary = BuildDenseBinaryData(
+        matrix, mode_value_list, use_1byte_cost)
+    dirpath = os.path.dirname(options.dense_binary_output_file)
+    if not os.path.exists(dirpath):
+      os.makedirs(dirpath)
+    with open(options.dense_binary_output_file, 'wb') as stream:
+      stream.write(dense_binary)
+
   CompressMatrixByModeValue(matrix, mode_value_list)
-  binary = BuildBinaryData(
-      matrix, mode_value_list, ParseBoolFlag(options.use_1byte_cost))
+  row_order = None
+  if options.access_profile:
+    row_order = ReadRowOrder(options.access_profile, len(matrix))
+  binary = BuildBinaryData(matrix, mode_value_list, use_1byte_cost, row_order)
 
   if options.binary_output_file:
     dirpath = os.path.dirname(options.binary_output_file)
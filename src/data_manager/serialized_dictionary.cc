@@ -84,6 +84,110 @@ void LoadTokens(std::istream *ifs, std::map<string, TokenList> *dic) {
 
 }  // namespace
 
+SerializedDictionary::HashIndex::HashIndex()
+    : num_buckets_(0), num_keys_(0), seeds_(nullptr),
+      token_indices_(nullptr) {}
+
+bool SerializedDictionary::HashIndex::Init(StringPiece data,
+                                           size_t num_tokens) {
+  num_buckets_ = 0;
+  num_keys_ = 0;
+  seeds_ = nullptr;
+  token_indices_ = nullptr;
+  if (data.size() < 8) {
+    return false;
+  }
+  const uint32 *u32_data = reinterpret_cast<const uint32 *>(data.data());
+  const uint32 num_buckets = u32_data[0];
+  const uint32 num_keys = u32_data[1];
+  if (num_buckets == 0 || num_keys == 0 || num_keys > num_tokens ||
+      data.size() != 4 * (2 + static_cast<size_t>(num_buckets) + num_keys)) {
+    return false;
+  }
+  const uint32 *token_indices = u32_data + 2 + num_buckets;
+  for (uint32 i = 0; i < num_keys; ++i) {
+    if (token_indices[i] >= num_tokens) {
+      return false;
+    }
+  }
+  num_buckets_ = num_buckets;
+  num_keys_ = num_keys;
+  seeds_ = u32_data + 2;
+  token_indices_ = token_indices;
+  return true;
+}
+
+void SerializedDictionary::HashIndex::Build(
+    const std::vector<StringPiece> &token_keys, std::vector<uint32> *output) {
+  // The distinct keys and the indices of their first tokens.
+  std::vector<StringPiece> keys;
+  std::vector<uint32> first_token_indices;
+  for (size_t i = 0; i < token_keys.size(); ++i) {
+    if (i == 0 || token_keys[i] != token_keys[i - 1]) {
+      keys.push_back(token_keys[i]);
+      first_token_indices.push_back(static_cast<uint32>(i));
+    }
+  }
+
+  // Keys are distributed to buckets of about four keys, and then a seed is
+  // searched for each bucket, larger buckets first, so that its keys are
+  // hashed to free slots.  This is the same as BuildPerfectHash() of
+  // prediction/gen_zero_query_util.py.
+  const uint32 num_keys = static_cast<uint32>(keys.size());
+  if (num_keys == 0) {
+    output->clear();
+    return;
+  }
+  const uint32 num_buckets = max<uint32>(1, (num_keys + 3) / 4);
+  std::vector<std::vector<uint32>> buckets(num_buckets);
+  for (uint32 i = 0; i < num_keys; ++i) {
+    buckets[Hash(0, keys[i]) % num_buckets].push_back(i);
+  }
+  std::vector<uint32> order(num_buckets);
+  for (uint32 i = 0; i < num_buckets; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&buckets](uint32 lhs, uint32 rhs) {
+                     return buckets[lhs].size() > buckets[rhs].size();
+                   });
+
+  output->assign(2 + num_buckets + num_keys, 0);
+  (*output)[0] = num_buckets;
+  (*output)[1] = num_keys;
+  uint32 *seeds = output->data() + 2;
+  uint32 *slots = seeds + num_buckets;
+  std::vector<bool> used(num_keys, false);
+  std::vector<uint32> positions;
+  for (const uint32 bucket : order) {
+    if (buckets[bucket].empty()) {
+      break;
+    }
+    for (uint32 seed = 1; ; ++seed) {
+      positions.clear();
+      bool ok = true;
+      for (const uint32 i : buckets[bucket]) {
+        const uint32 pos = Hash(seed, keys[i]) % num_keys;
+        if (used[pos] ||
+            std::find(positions.begin(), positions.end(), pos) !=
+                positions.end()) {
+          ok = false;
+          break;
+        }
+        positions.push_back(pos);
+      }
+      if (ok) {
+        seeds[bucket] = seed;
+        break;
+      }
+    }
+    for (size_t j = 0; j < positions.size(); ++j) {
+      used[positions[j]] = true;
+      slots[positions[j]] = first_token_indices[buckets[bucket][j]];
+    }
+  }
+}
+
 SerializedDictionary::SerializedDictionary(StringPiece token_array,
                                            StringPiece string_array_data)
     : token_array_(token_array) {
@@ -91,10 +195,33 @@ SerializedDictionary::SerializedDictionary(StringPiece token_array,
   string_array_.Set(string_array_data);
 }
 
+SerializedDictionary::SerializedDictionary(StringPiece token_array,
+                                           StringPiece string_array_data,
+                                           StringPiece hash_index_data)
+    : token_array_(token_array) {
+  DCHECK(VerifyData(token_array, string_array_data));
+  string_array_.Set(string_array_data);
+  if (!hash_index_data.empty() &&
+      !hash_index_.Init(hash_index_data, size())) {
+    LOG(ERROR) << "Hash index is broken; falling back to binary search";
+  }
+}
+
 SerializedDictionary::~SerializedDictionary() {}
 
 SerializedDictionary::IterRange SerializedDictionary::equal_range(
     StringPiece key) const {
+  if (has_hash_index()) {
+    const iterator first = begin() + hash_index_.Lookup(key);
+    if (first.key() != key) {
+      return IterRange(end(), end());
+    }
+    // The tokens of the same key are contiguous.
+    iterator last = first;
+    for (++last; last != end() && last.key_index() == first.key_index();
+         ++last) {}
+    return IterRange(first, last);
+  }
   // TODO(noriyukit): Instead of comparing key as string, we can do binary
   // search using key index to minimize string comparison cost.
   return std::equal_range(begin(), end(), key);
@@ -183,23 +310,64 @@ std::pair<StringPiece, StringPiece> SerializedDictionary::Compile(
   return std::pair<StringPiece, StringPiece>(token_array, string_array);
 }
 
+StringPiece SerializedDictionary::CompileHashIndex(
+    StringPiece token_array_data, StringPiece string_array_data,
+    std::unique_ptr<uint32[]> *output_buf) {
+  const SerializedDictionary dic(token_array_data, string_array_data);
+  std::vector<StringPiece> token_keys;
+  token_keys.reserve(dic.size());
+  for (const_iterator iter = dic.begin(); iter != dic.end(); ++iter) {
+    token_keys.push_back(iter.key());
+  }
+  std::vector<uint32> index;
+  HashIndex::Build(token_keys, &index);
+  output_buf->reset(new uint32[index.size()]);
+  std::copy(index.begin(), index.end(), output_buf->get());
+  return StringPiece(reinterpret_cast<const char *>(output_buf->get()),
+                     index.size() * 4);
+}
+
 void SerializedDictionary::CompileToFiles(const string &input,
                                           const string &output_token_array,
                                           const string &output_string_array) {
+  CompileToFiles(input, output_token_array, output_string_array, "");
+}
+
+void SerializedDictionary::CompileToFiles(const string &input,
+                                          const string &output_token_array,
+                                          const string &output_string_array,
+                                          const string &output_hash_index) {
   InputFileStream ifs(input.c_str());
   CHECK(ifs.good());
   std::map<string, TokenList> dic;
   LoadTokens(&ifs, &dic);
-  CompileToFiles(dic, output_token_array, output_string_array);
+  CompileToFiles(dic, output_token_array, output_string_array,
+                 output_hash_index);
 }
 
 void SerializedDictionary::CompileToFiles(
     const std::map<string, TokenList> &dic, const string &output_token_array,
     const string &output_string_array) {
+  CompileToFiles(dic, output_token_array, output_string_array, "");
+}
+
+void SerializedDictionary::CompileToFiles(
+    const std::map<string, TokenList> &dic, const string &output_token_array,
+    const string &output_string_array, const string &output_hash_index) {
   std::unique_ptr<uint32[]> buf1, buf2;
   const std::pair<StringPiece, StringPiece> data = Compile(dic, &buf1, &buf2);
   CHECK(VerifyData(data.first, data.second));
 
+  if (!output_hash_index.empty()) {
+    std::unique_ptr<uint32[]> buf3;
+    const StringPiece hash_index =
+        CompileHashIndex(data.first, data.second, &buf3);
+    OutputFileStream hash_ofs(output_hash_index.c_str(),
+                              ios_base::out | ios_base::binary);
+    CHECK(hash_ofs.good());
+    CHECK(hash_ofs.write(hash_index.data(), hash_index.size()));
+  }
+
   OutputFileStream token_ofs(output_token_array.c_str(),
                              ios_base::out | ios_base::binary);
   CHECK(token_ofs.good());
@@ -35,6 +35,7 @@
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/port.h"
 #include "base/serialized_string_array.h"
@@ -105,6 +106,11 @@ namespace mozc {
 // byte boundary by the insertion of padding.  String values of a token (key,
 // value, description, additional_description) can be retrieved from the string
 // array by index.
+//
+// ** Hash index (optional)
+// A minimal perfect hash over the keys can be given as the third binary data,
+// with which equal_range() finds the tokens by two hash probes and one key
+// comparison instead of binary search.  See HashIndex below for the format.
 class SerializedDictionary {
  public:
   struct CompilerToken {
@@ -285,6 +291,67 @@ class SerializedDictionary {
 
   using IterRange = std::pair<const_iterator, const_iterator>;
 
+  // Minimal perfect hash over the keys of a token array sorted by key.  The
+  // data is an array of uint32 in the same format as the hash of
+  // ZeroQueryDict:
+  //
+  // HashIndex {
+  //   uint32 num_buckets:               4 bytes
+  //   uint32 num_keys:                  4 bytes
+  //   uint32 seeds[num_buckets]:        4 * num_buckets bytes
+  //   uint32 token_indices[num_keys]:   4 * num_keys bytes
+  // }
+  //
+  // A key is first assigned to bucket Hash(0, key) % num_buckets, and then to
+  // slot Hash(seeds[bucket], key) % num_keys, which is distinct for every key.
+  // The slot holds the index of the first token of the key.  Since any string
+  // is mapped to some slot, the caller has to compare the key of the token
+  // with the query.
+  class HashIndex {
+   public:
+    HashIndex();
+
+    // Returns false and leaves the index empty if |data| is malformed for a
+    // token array of |num_tokens| tokens.
+    bool Init(StringPiece data, size_t num_tokens);
+
+    bool empty() const { return seeds_ == nullptr; }
+
+    // Returns the token index in the slot of |key|.  Must not be empty.
+    uint32 Lookup(StringPiece key) const {
+      const uint32 seed = seeds_[Hash(0, key) % num_buckets_];
+      return token_indices_[Hash(seed, key) % num_keys_];
+    }
+
+    // The hash function: 32-bit FNV-1a whose offset basis is xor-ed with
+    // |seed|, followed by the finalizer of MurmurHash3.  This must be kept in
+    // sync with prediction/gen_zero_query_util.py, which builds the index
+    // for the data generated by Python scripts.
+    static uint32 Hash(uint32 seed, StringPiece key) {
+      uint32 h = 2166136261u ^ seed;
+      for (size_t i = 0; i < key.size(); ++i) {
+        h = (h ^ static_cast<uint8>(key[i])) * 16777619u;
+      }
+      h ^= h >> 16;
+      h *= 0x85ebca6bu;
+      h ^= h >> 13;
+      h *= 0xc2b2ae35u;
+      h ^= h >> 16;
+      return h;
+    }
+
+    // Builds the index for the tokens whose keys are |token_keys|, in which
+    // the same keys are contiguous.
+    static void Build(const std::vector<StringPiece> &token_keys,
+                      std::vector<uint32> *output);
+
+   private:
+    uint32 num_buckets_;
+    uint32 num_keys_;
+    const uint32 *seeds_;
+    const uint32 *token_indices_;
+  };
+
   // Creates serialized data into buffers.  The first and second StringPieces of
   // returned value points to memory block for token array and string array,
   // respectively.  The input stream should supply TSV file of Mozc's dctionary
@@ -298,13 +365,27 @@ class SerializedDictionary {
       std::unique_ptr<uint32[]> *output_token_array_buf,
       std::unique_ptr<uint32[]> *output_string_array_buf);
 
-  // Creates serialized data and writes them to files.
+  // Creates the hash index of serialized data into a buffer.
+  static StringPiece CompileHashIndex(StringPiece token_array_data,
+                                      StringPiece string_array_data,
+                                      std::unique_ptr<uint32[]> *output_buf);
+
+  // Creates serialized data and writes them to files.  The hash index is also
+  // written if |output_hash_index| is given.
   static void CompileToFiles(const string &input,
                              const string &output_token_array,
                              const string &output_string_array);
+  static void CompileToFiles(const string &input,
+                             const string &output_token_array,
+                             const string &output_string_array,
+                             const string &output_hash_index);
   static void CompileToFiles(const std::map<string, TokenList> &dic,
                              const string &output_token_array,
                              const string &output_string_array);
+  static void CompileToFiles(const std::map<string, TokenList> &dic,
+                             const string &output_token_array,
+                             const string &output_string_array,
+                             const string &output_hash_index);
 
   // Validates the serialized data.
   static bool VerifyData(StringPiece token_array_data,
@@ -313,8 +394,15 @@ class SerializedDictionary {
   // Both |token_array| and |string_array_data| must be aligned at 4-byte
   // boundary.
   SerializedDictionary(StringPiece token_array, StringPiece string_array_data);
+  // With the optional hash index.  If |hash_index_data| is empty or malformed,
+  // equal_range() falls back to binary search.
+  SerializedDictionary(StringPiece token_array, StringPiece string_array_data,
+                       StringPiece hash_index_data);
   ~SerializedDictionary();
 
+  // Returns true if equal_range() uses the hash index.
+  bool has_hash_index() const { return !hash_index_.empty(); }
+
   std::size_t size() const {
     return token_array_.size() / kTokenByteLength;
   }
@@ -338,6 +426,7 @@ class SerializedDictionary {
  private:
   StringPiece token_array_;
   SerializedStringArray string_array_;
+  HashIndex hash_index_;
 };
 
 }  // namespace mozc
@@ -180,5 +180,54 @@ TEST_F(SerializedDictionaryTest, EqualRange) {
   }
 }
 
+TEST_F(SerializedDictionaryTest, EqualRangeWithHashIndex) {
+  std::unique_ptr<uint32[]> buf;
+  const StringPiece hash_index_data = SerializedDictionary::CompileHashIndex(
+      token_array_data_, string_array_data_, &buf);
+  ASSERT_FALSE(hash_index_data.empty());
+
+  const SerializedDictionary expected(token_array_data_, string_array_data_);
+  const SerializedDictionary dic(token_array_data_, string_array_data_,
+                                 hash_index_data);
+  ASSERT_TRUE(dic.has_hash_index());
+  for (const char *key : {"key1", "key2", "key", "key3", "mozc", ""}) {
+    SCOPED_TRACE(key);
+    const auto expected_range = expected.equal_range(key);
+    const auto range = dic.equal_range(key);
+    ASSERT_EQ(expected_range.second - expected_range.first,
+              range.second - range.first);
+    for (auto iter1 = expected_range.first, iter2 = range.first;
+         iter1 != expected_range.second; ++iter1, ++iter2) {
+      EXPECT_EQ(iter1.key(), iter2.key());
+      EXPECT_EQ(iter1.value(), iter2.value());
+    }
+  }
+}
+
+TEST_F(SerializedDictionaryTest, BrokenHashIndexFallsBack) {
+  const uint32 kBroken[] = {1, 2, 0, 0, 100};  // Token index out of range.
+  const StringPiece broken(reinterpret_cast<const char *>(kBroken),
+                           sizeof(kBroken));
+  const SerializedDictionary dic(token_array_data_, string_array_data_,
+                                 broken);
+  EXPECT_FALSE(dic.has_hash_index());
+  const auto range = dic.equal_range("key2");
+  ASSERT_NE(range.first, range.second);
+  EXPECT_EQ("value3", range.first.value());
+}
+
+TEST(SerializedDictionaryHashIndexTest, Hash) {
+  // These values must match those of prediction/gen_zero_query_util.py.
+  EXPECT_EQ(2872998923u, SerializedDictionary::HashIndex::Hash(0, ""));
+  EXPECT_EQ(4195733450u, SerializedDictionary::HashIndex::Hash(7, ""));
+  EXPECT_EQ(444641715u, SerializedDictionary::HashIndex::Hash(0, "a"));
+  EXPECT_EQ(3736780160u, SerializedDictionary::HashIndex::Hash(7, "a"));
+  // "あい"
+  EXPECT_EQ(3630774404u, SerializedDictionary::HashIndex::Hash(
+      0, "\xe3\x81\x82\xe3\x81\x84"));
+  EXPECT_EQ(2390944020u, SerializedDictionary::HashIndex::Hash(
+      7, "\xe3\x81\x82\xe3\x81\x84"));
+}
+
 }  // namespace
 }  // namespace mozc
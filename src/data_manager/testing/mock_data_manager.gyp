@@ -41,6 +41,9 @@
     'boundary_def': '<(mozc_dir)/data/rules/boundary.def',
     'dataset_tag': 'mock',
     'use_1byte_cost_for_connection_data': 'false',
+    'use_dense_connection_data': 'false',
+    'access_profile': '',
+    'use_packed_segmenter_boundary': 'false',
     'dictionary_files': [
       '<(platform_data_dir)/dictionary.txt',
     ],
@@ -155,6 +155,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../storage/storage.gyp:storage',
       ],
     },
     {
@@ -175,6 +176,9 @@
         '../config/config.gyp:config_handler',
         '../protocol/protocol.gyp:config_proto',
         '../protocol/protocol.gyp:user_dictionary_storage_proto',
+        '../storage/louds/louds.gyp:louds_trie',
+        '../storage/louds/louds.gyp:louds_trie_builder',
+        '../storage/storage.gyp:storage',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'gen_pos_map#host',
         'pos_matcher',
@@ -29,7 +29,9 @@
 
 #include "dictionary/dictionary_impl.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/string_piece.h"
@@ -86,22 +88,24 @@ bool DictionaryImpl::HasValue(StringPiece value) const {
   return false;
 }
 
-namespace {
+DictionaryImpl::TokenFilter::TokenFilter(
+    const ConversionRequest &conversion_request,
+    const POSMatcher *pos_matcher,
+    const SuppressionDictionary *suppression_dictionary)
+    : use_spelling_correction_(
+          conversion_request.config().use_spelling_correction()),
+      use_zip_code_conversion_(
+          conversion_request.config().use_zip_code_conversion()),
+      use_t13n_conversion_(conversion_request.config().use_t13n_conversion()),
+      pos_matcher_(pos_matcher),
+      suppression_dictionary_(suppression_dictionary) {}
 
-class CallbackWithFilter : public DictionaryInterface::Callback {
+class DictionaryImpl::CallbackWithFilter
+    : public DictionaryInterface::Callback {
  public:
-  CallbackWithFilter(const bool use_spelling_correction,
-                     const bool use_zip_code_conversion,
-                     const bool use_t13n_conversion,
-                     const POSMatcher *pos_matcher,
-                     const SuppressionDictionary *suppression_dictionary,
+  CallbackWithFilter(const TokenFilter &filter,
                      DictionaryInterface::Callback *callback)
-      : use_spelling_correction_(use_spelling_correction),
-        use_zip_code_conversion_(use_zip_code_conversion),
-        use_t13n_conversion_(use_t13n_conversion),
-        pos_matcher_(pos_matcher),
-        suppression_dictionary_(suppression_dictionary),
-        callback_(callback) {}
+      : filter_(filter), callback_(callback) {}
 
   virtual ResultType OnKey(StringPiece key) {
     return callback_->OnKey(key);
@@ -114,46 +118,35 @@ class CallbackWithFilter : public DictionaryInterface::Callback {
 
   virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
-    if (!(token.attributes & Token::USER_DICTIONARY)) {
-      if (!use_spelling_correction_ &&
-          (token.attributes & Token::SPELLING_CORRECTION)) {
-        return TRAVERSE_CONTINUE;
-      }
-      if (!use_zip_code_conversion_ && pos_matcher_->IsZipcode(token.lid)) {
-        return TRAVERSE_CONTINUE;
-      }
-      if (!use_t13n_conversion_ &&
-          Util::IsEnglishTransliteration(token.value)) {
-        return TRAVERSE_CONTINUE;
-      }
-    }
-    if (suppression_dictionary_->SuppressEntry(token.key, token.value)) {
+    if (filter_.IsFiltered(token)) {
       return TRAVERSE_CONTINUE;
     }
     return callback_->OnToken(key, actual_key, token);
   }
 
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
+    if (filter_.IsFiltered(token)) {
+      return TRAVERSE_CONTINUE;
+    }
+    return callback_->OnTokenView(key, actual_key, token);
+  }
+
+  virtual size_t GetPredictiveLookupKeyLimit() const {
+    return callback_->GetPredictiveLookupKeyLimit();
+  }
+
  private:
-  const bool use_spelling_correction_;
-  const bool use_zip_code_conversion_;
-  const bool use_t13n_conversion_;
-  const POSMatcher *pos_matcher_;
-  const SuppressionDictionary *suppression_dictionary_;
+  const TokenFilter filter_;
   DictionaryInterface::Callback *callback_;
 };
 
-}  // namespace
-
 void DictionaryImpl::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
   CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(),
-      pos_matcher_,
-      suppression_dictionary_,
+      TokenFilter(conversion_request, pos_matcher_, suppression_dictionary_),
       callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupPredictive(
@@ -168,11 +161,7 @@ void DictionaryImpl::LookupPrefix(
     const ConversionRequest &conversion_request,
     Callback *callback) const {
   CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(),
-      pos_matcher_,
-      suppression_dictionary_,
+      TokenFilter(conversion_request, pos_matcher_, suppression_dictionary_),
       callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupPrefix(
@@ -182,16 +171,34 @@ void DictionaryImpl::LookupPrefix(
   }
 }
 
+void DictionaryImpl::LookupPrefixBatch(
+    StringPiece key,
+    const ConversionRequest &conversion_request,
+    const std::vector<Callback *> &callbacks) const {
+  const TokenFilter filter(conversion_request, pos_matcher_,
+                           suppression_dictionary_);
+  std::vector<std::unique_ptr<CallbackWithFilter>> callbacks_with_filter(
+      callbacks.size());
+  std::vector<Callback *> filtered_callbacks(callbacks.size(), NULL);
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    if (callbacks[i] == NULL) {
+      continue;
+    }
+    callbacks_with_filter[i].reset(new CallbackWithFilter(filter,
+                                                          callbacks[i]));
+    filtered_callbacks[i] = callbacks_with_filter[i].get();
+  }
+  for (size_t i = 0; i < dics_.size(); ++i) {
+    dics_[i]->LookupPrefixBatch(key, conversion_request, filtered_callbacks);
+  }
+}
+
 void DictionaryImpl::LookupExact(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
   CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(),
-      pos_matcher_,
-      suppression_dictionary_,
+      TokenFilter(conversion_request, pos_matcher_, suppression_dictionary_),
       callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupExact(key, conversion_request, &callback_with_filter);
@@ -203,11 +210,7 @@ void DictionaryImpl::LookupReverse(
     const ConversionRequest &conversion_request,
     Callback *callback) const {
   CallbackWithFilter callback_with_filter(
-      conversion_request.config().use_spelling_correction(),
-      conversion_request.config().use_zip_code_conversion(),
-      conversion_request.config().use_t13n_conversion(),
-      pos_matcher_,
-      suppression_dictionary_,
+      TokenFilter(conversion_request, pos_matcher_, suppression_dictionary_),
       callback);
   for (size_t i = 0; i < dics_.size(); ++i) {
     dics_[i]->LookupReverse(str, conversion_request, &callback_with_filter);
@@ -244,5 +247,12 @@ void DictionaryImpl::ClearReverseLookupCache() const {
   }
 }
 
+void DictionaryImpl::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  for (size_t i = 0; i < dics_.size(); ++i) {
+    dics_[i]->CollectMemoryUsage(usages);
+  }
+}
+
 }  // namespace dictionary
 }  // namespace mozc
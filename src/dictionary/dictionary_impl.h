@@ -35,7 +35,9 @@
 
 #include "base/port.h"
 #include "base/string_piece.h"
+#include "base/util.h"
 #include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
 
@@ -69,6 +71,10 @@ class DictionaryImpl : public DictionaryInterface {
   virtual void LookupPrefix(StringPiece key,
                             const ConversionRequest &conversion_request,
                             Callback *callback) const;
+  virtual void LookupPrefixBatch(StringPiece key,
+                                 const ConversionRequest &conversion_request,
+                                 const std::vector<Callback *> &callbacks)
+      const;
 
   virtual void LookupExact(StringPiece key,
                            const ConversionRequest &conversion_request,
@@ -84,8 +90,143 @@ class DictionaryImpl : public DictionaryInterface {
   virtual bool Reload();
   virtual void PopulateReverseLookupCache(StringPiece str) const;
   virtual void ClearReverseLookupCache() const;
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const;
+
+  // The following methods are the same as LookupPrefix(), LookupPrefixBatch()
+  // and LookupPredictive() but take the callbacks as compile-time functors.
+  // The methods of CallbackType (OnKey(), OnActualKey(), OnToken(),
+  // OnTokenView() and GetPredictiveLookupKeyLimit() with the same signatures
+  // as DictionaryInterface::Callback) are called without virtual dispatch, so
+  // CallbackType needs to be the dynamic type of the callbacks; overrides in
+  // its subclasses are not called.  CallbackType doesn't need to derive from
+  // DictionaryInterface::Callback.
+  template <typename CallbackType>
+  void LookupPrefixWithFunctor(StringPiece key,
+                               const ConversionRequest &conversion_request,
+                               CallbackType *callback) const {
+    FunctorCallback<CallbackType> functor_callback(
+        TokenFilter(conversion_request, pos_matcher_, suppression_dictionary_),
+        callback);
+    for (size_t i = 0; i < dics_.size(); ++i) {
+      dics_[i]->LookupPrefix(key, conversion_request, &functor_callback);
+    }
+  }
+
+  template <typename CallbackType>
+  void LookupPrefixBatchWithFunctors(
+      StringPiece key, const ConversionRequest &conversion_request,
+      const std::vector<CallbackType *> &callbacks) const {
+    const TokenFilter filter(conversion_request, pos_matcher_,
+                             suppression_dictionary_);
+    std::vector<std::unique_ptr<FunctorCallback<CallbackType>>>
+        functor_callbacks(callbacks.size());
+    std::vector<Callback *> wrapped_callbacks(callbacks.size(), NULL);
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      if (callbacks[i] != NULL) {
+        functor_callbacks[i].reset(
+            new FunctorCallback<CallbackType>(filter, callbacks[i]));
+        wrapped_callbacks[i] = functor_callbacks[i].get();
+      }
+    }
+    for (size_t i = 0; i < dics_.size(); ++i) {
+      dics_[i]->LookupPrefixBatch(key, conversion_request, wrapped_callbacks);
+    }
+  }
+
+  template <typename CallbackType>
+  void LookupPredictiveWithFunctor(StringPiece key,
+                                   const ConversionRequest &conversion_request,
+                                   CallbackType *callback) const {
+    FunctorCallback<CallbackType> functor_callback(
+        TokenFilter(conversion_request, pos_matcher_, suppression_dictionary_),
+        callback);
+    for (size_t i = 0; i < dics_.size(); ++i) {
+      dics_[i]->LookupPredictive(key, conversion_request, &functor_callback);
+    }
+  }
 
  private:
+  // Filters out the tokens disabled by the request and the suppressed ones.
+  // Defined inline as it's called for every token.
+  class TokenFilter {
+   public:
+    TokenFilter(const ConversionRequest &conversion_request,
+                const POSMatcher *pos_matcher,
+                const SuppressionDictionary *suppression_dictionary);
+
+    // TokenType is either Token or TokenView.
+    template <typename TokenType>
+    bool IsFiltered(const TokenType &token) const {
+      if (!(token.attributes & Token::USER_DICTIONARY)) {
+        if (!use_spelling_correction_ &&
+            (token.attributes & Token::SPELLING_CORRECTION)) {
+          return true;
+        }
+        if (!use_zip_code_conversion_ && pos_matcher_->IsZipcode(token.lid)) {
+          return true;
+        }
+        if (!use_t13n_conversion_ &&
+            Util::IsEnglishTransliteration(token.value)) {
+          return true;
+        }
+      }
+      return suppression_dictionary_->SuppressEntry(token.key, token.value);
+    }
+
+   private:
+    bool use_spelling_correction_;
+    bool use_zip_code_conversion_;
+    bool use_t13n_conversion_;
+    const POSMatcher *pos_matcher_;
+    const SuppressionDictionary *suppression_dictionary_;
+  };
+
+  // Applies TokenFilter to the virtual interface of callbacks.
+  class CallbackWithFilter;
+
+  // Applies TokenFilter and calls the methods of CallbackType non-virtually.
+  template <typename CallbackType>
+  class FunctorCallback final : public Callback {
+   public:
+    FunctorCallback(const TokenFilter &filter, CallbackType *callback)
+        : filter_(filter), callback_(callback) {}
+
+    ResultType OnKey(StringPiece key) override {
+      return callback_->CallbackType::OnKey(key);
+    }
+
+    ResultType OnActualKey(StringPiece key, StringPiece actual_key,
+                           bool is_expanded) override {
+      return callback_->CallbackType::OnActualKey(key, actual_key,
+                                                  is_expanded);
+    }
+
+    ResultType OnToken(StringPiece key, StringPiece actual_key,
+                       const Token &token) override {
+      if (filter_.IsFiltered(token)) {
+        return TRAVERSE_CONTINUE;
+      }
+      return callback_->CallbackType::OnToken(key, actual_key, token);
+    }
+
+    ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                           const TokenView &token) override {
+      if (filter_.IsFiltered(token)) {
+        return TRAVERSE_CONTINUE;
+      }
+      return callback_->CallbackType::OnTokenView(key, actual_key, token);
+    }
+
+    size_t GetPredictiveLookupKeyLimit() const override {
+      return callback_->CallbackType::GetPredictiveLookupKeyLimit();
+    }
+
+   private:
+    const TokenFilter filter_;
+    CallbackType *callback_;
+  };
+
   enum LookupType {
     PREDICTIVE,
     PREFIX,
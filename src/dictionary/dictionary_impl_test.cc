@@ -32,6 +32,7 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "base/system_util.h"
@@ -83,6 +84,51 @@ DictionaryData *CreateDictionaryData() {
   return ret;
 }
 
+// Collects the tokens as "key\tvalue" through the virtual interface.
+class TokenCollector : public DictionaryInterface::Callback {
+ public:
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    tokens_.push_back(token.key + "\t" + token.value);
+    return TRAVERSE_CONTINUE;
+  }
+
+  const std::vector<string> &tokens() const { return tokens_; }
+
+ private:
+  std::vector<string> tokens_;
+};
+
+// The same as TokenCollector but is a functor not deriving from Callback.
+class TokenCollectorFunctor {
+ public:
+  typedef DictionaryInterface::Callback::ResultType ResultType;
+
+  ResultType OnKey(StringPiece key) {
+    return DictionaryInterface::Callback::TRAVERSE_CONTINUE;
+  }
+  ResultType OnActualKey(StringPiece key, StringPiece actual_key,
+                         bool is_expanded) {
+    return DictionaryInterface::Callback::TRAVERSE_CONTINUE;
+  }
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) {
+    tokens_.push_back(token.key + "\t" + token.value);
+    return DictionaryInterface::Callback::TRAVERSE_CONTINUE;
+  }
+  ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                         const TokenView &token) {
+    tokens_.push_back(token.key.as_string() + "\t" + token.value.as_string());
+    return DictionaryInterface::Callback::TRAVERSE_CONTINUE;
+  }
+  size_t GetPredictiveLookupKeyLimit() const { return 64; }
+
+  const std::vector<string> &tokens() const { return tokens_; }
+
+ private:
+  std::vector<string> tokens_;
+};
+
 }  // namespace
 
 class DictionaryImplTest : public ::testing::Test {
@@ -239,6 +285,101 @@ TEST_F(DictionaryImplTest, WordSuppressionTest) {
   }
 }
 
+TEST_F(DictionaryImplTest, WordSuppressionForLookupPrefixBatch) {
+  std::unique_ptr<DictionaryData> data(CreateDictionaryData());
+  DictionaryInterface *d = data->dictionary.get();
+  SuppressionDictionary *s = data->suppression_dictionary.get();
+
+  const char kKey[] =
+      "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B";  // "ぐーぐる"
+  const char kValue[] =
+      "\xE3\x82\xB0\xE3\x83\xBC\xE3\x82\xB0\xE3\x83\xAB";  // "グーグル"
+  // "はぐーぐる"
+  const string kQuery = "\xE3\x81\xAF" + string(kKey);
+
+  // Only the lookup from "ぐーぐる" finds the entry.
+  std::vector<std::unique_ptr<CheckKeyValueExistenceCallback>> callbacks(2);
+  std::vector<DictionaryInterface::Callback *> callback_ptrs(kQuery.size());
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    callbacks[i].reset(new CheckKeyValueExistenceCallback(kKey, kValue));
+    callback_ptrs[i * 3] = callbacks[i].get();
+  }
+  d->LookupPrefixBatch(kQuery, convreq_, callback_ptrs);
+  EXPECT_FALSE(callbacks[0]->found());
+  EXPECT_TRUE(callbacks[1]->found());
+
+  // The suppression dictionary is applied to every lookup of the batch.
+  s->Lock();
+  s->Clear();
+  s->AddEntry(kKey, kValue);
+  s->UnLock();
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    callbacks[i].reset(new CheckKeyValueExistenceCallback(kKey, kValue));
+    callback_ptrs[i * 3] = callbacks[i].get();
+  }
+  d->LookupPrefixBatch(kQuery, convreq_, callback_ptrs);
+  EXPECT_FALSE(callbacks[0]->found());
+  EXPECT_FALSE(callbacks[1]->found());
+
+  s->Lock();
+  s->Clear();
+  s->UnLock();
+}
+
+TEST_F(DictionaryImplTest, FunctorLookupIsEquivalentToVirtualLookup) {
+  std::unique_ptr<DictionaryData> data(CreateDictionaryData());
+  const DictionaryImpl *d =
+      static_cast<const DictionaryImpl *>(data->dictionary.get());
+  SuppressionDictionary *s = data->suppression_dictionary.get();
+
+  // "ぐーぐる" -> "グーグル" is suppressed in both the paths.
+  s->Lock();
+  s->Clear();
+  s->AddEntry("\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B",
+              "\xE3\x82\xB0\xE3\x83\xBC\xE3\x82\xB0\xE3\x83\xAB");
+  s->UnLock();
+
+  // "はぐーぐる"
+  const string kQuery =
+      "\xE3\x81\xAF\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B";
+  {
+    TokenCollector expected;
+    d->LookupPrefix(kQuery, convreq_, &expected);
+    TokenCollectorFunctor actual;
+    d->LookupPrefixWithFunctor(kQuery, convreq_, &actual);
+    EXPECT_FALSE(expected.tokens().empty());
+    EXPECT_EQ(expected.tokens(), actual.tokens());
+  }
+  {
+    TokenCollector expected;
+    d->LookupPredictive(kQuery.substr(3, 6), convreq_, &expected);
+    TokenCollectorFunctor actual;
+    d->LookupPredictiveWithFunctor(kQuery.substr(3, 6), convreq_, &actual);
+    EXPECT_FALSE(expected.tokens().empty());
+    EXPECT_EQ(expected.tokens(), actual.tokens());
+  }
+  {
+    std::vector<TokenCollector> expected(2);
+    std::vector<DictionaryInterface::Callback *> expected_ptrs(kQuery.size());
+    std::vector<TokenCollectorFunctor> actual(2);
+    std::vector<TokenCollectorFunctor *> actual_ptrs(kQuery.size());
+    for (size_t i = 0; i < 2; ++i) {
+      expected_ptrs[i * 3] = &expected[i];
+      actual_ptrs[i * 3] = &actual[i];
+    }
+    d->LookupPrefixBatch(kQuery, convreq_, expected_ptrs);
+    d->LookupPrefixBatchWithFunctors(kQuery, convreq_, actual_ptrs);
+    for (size_t i = 0; i < 2; ++i) {
+      EXPECT_FALSE(expected[i].tokens().empty());
+      EXPECT_EQ(expected[i].tokens(), actual[i].tokens());
+    }
+  }
+
+  s->Lock();
+  s->Clear();
+  s->UnLock();
+}
+
 TEST_F(DictionaryImplTest, DisableSpellingCorrectionTest) {
   std::unique_ptr<DictionaryData> data(CreateDictionaryData());
   DictionaryInterface *d = data->dictionary.get();
@@ -33,6 +33,8 @@
 #include <string>
 #include <vector>
 
+#include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "dictionary/dictionary_token.h"
@@ -50,7 +52,7 @@ class DictionaryInterface {
   //   OnKey(key);
   //   OnActualKey(key, actual_key, key != actual_key);
   //   for (each token in the token array for the key) {
-  //     OnToken(key, actual_key, token);
+  //     OnToken(key, actual_key, token);  // or OnTokenView()
   //   }
   // }
   //
@@ -104,8 +106,35 @@ class DictionaryInterface {
       return TRAVERSE_CONTINUE;
     }
 
+    // Called back instead of OnToken() by dictionaries that decode tokens into
+    // their own buffers, currently SystemDictionary.  |token| refers to those
+    // buffers and is valid only during the call.  The default implementation
+    // copies |token| into a Token owned by this callback and calls OnToken(),
+    // so callbacks on hot paths should override this method as well to skip
+    // the copy.  Other dictionaries keep calling OnToken(); such callbacks can
+    // forward it here with OnTokenView(key, actual_key, TokenView(token)).
+    virtual ResultType OnTokenView(StringPiece key,
+                                   StringPiece actual_key,
+                                   const TokenView &token) {
+      token.CopyToToken(&token_buffer_);
+      return OnToken(key, actual_key, token_buffer_);
+    }
+
+    // Returns the number of keys after which LookupPredictive() stops
+    // descending the trie; the remaining keys of the same length as the last
+    // one are still reported.  Callbacks that end the traversal by themselves
+    // with TRAVERSE_DONE can return a larger value.  Currently used only by
+    // SystemDictionary.
+    virtual size_t GetPredictiveLookupKeyLimit() const {
+      return 64;
+    }
+
    protected:
     Callback() {}
+
+   private:
+    // Reused by the default OnTokenView().
+    Token token_buffer_;
   };
 
   virtual ~DictionaryInterface() {}
@@ -128,6 +157,26 @@ class DictionaryInterface {
                            const ConversionRequest &conversion_request,
                            Callback *callback) const = 0;
 
+  // Looks up the prefixes of the suffixes of |key| in one call.  For each i
+  // such that callbacks[i] is not NULL, this is equivalent to
+  // LookupPrefix(key.substr(i), conversion_request, callbacks[i]).  The size
+  // of |callbacks| must not exceed key.size().  Implementations can override
+  // this to share the work, e.g., key encoding, among the lookups.
+  // ImmutableConverterImpl may call this from several threads at the same
+  // time with distinct callbacks, so the lookup must be safe for concurrent
+  // reads; see ImmutableConverterImpl::set_max_lattice_lookup_threads().
+  virtual void LookupPrefixBatch(StringPiece key,
+                                 const ConversionRequest &conversion_request,
+                                 const std::vector<Callback *> &callbacks)
+      const {
+    DCHECK_LE(callbacks.size(), key.size());
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      if (callbacks[i] != NULL) {
+        LookupPrefix(key.substr(i), conversion_request, callbacks[i]);
+      }
+    }
+  }
+
   // For reverse lookup, the reading is stored in Token::value and the word
   // is stored in Token::key.
   virtual void LookupReverse(StringPiece str,
@@ -141,7 +190,10 @@ class DictionaryInterface {
                              const ConversionRequest &conversion_request,
                              string *comment) const { return false; }
 
-  // Populates cache for LookupReverse().
+  // Populates cache for LookupReverse().  The calls can be nested; the cache
+  // is kept until every PopulateReverseLookupCache() is paired with
+  // ClearReverseLookupCache(), so that a batch of reverse conversions can
+  // populate it once for all of their inputs.
   // TODO(noriyukit): These cache initialize/finalize mechanism shouldn't be a
   // part of the interface.
   virtual void PopulateReverseLookupCache(StringPiece str) const {}
@@ -153,6 +205,12 @@ class DictionaryInterface {
   // Reload dictionary data from local disk.
   virtual bool Reload() { return true; }
 
+  // Appends the memory used by this dictionary, e.g. the indices built in
+  // heap, to |usages|.  The data mapped from the data set are reported by
+  // DataManagerInterface.
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const {}
+
  protected:
   // Do not allow instantiation
   DictionaryInterface() {}
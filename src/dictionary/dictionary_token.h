@@ -33,6 +33,7 @@
 #include <string>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
 namespace dictionary {
@@ -67,6 +68,33 @@ struct Token {
   AttributesBitfield attributes;
 };
 
+// A token whose key and value refer to strings owned by someone else, e.g.,
+// the decode buffers of a dictionary.  It's passed to
+// DictionaryInterface::Callback::OnTokenView() so that the dictionary doesn't
+// need to materialize a Token for every entry it visits.
+struct TokenView {
+  TokenView() : cost(0), lid(0), rid(0), attributes(Token::NONE) {}
+  explicit TokenView(const Token &token)
+      : key(token.key), value(token.value), cost(token.cost), lid(token.lid),
+        rid(token.rid), attributes(token.attributes) {}
+
+  void CopyToToken(Token *token) const {
+    token->key.assign(key.data(), key.size());
+    token->value.assign(value.data(), value.size());
+    token->cost = cost;
+    token->lid = lid;
+    token->rid = rid;
+    token->attributes = attributes;
+  }
+
+  StringPiece key;
+  StringPiece value;
+  int cost;
+  int lid;
+  int rid;
+  Token::AttributesBitfield attributes;
+};
+
 }  // namespace dictionary
 }  // namespace mozc
 
@@ -50,7 +50,9 @@ DictionaryFile::~DictionaryFile() {}
 
 bool DictionaryFile::OpenFromFile(const string &file) {
   mapping_.reset(new Mmap());
-  CHECK(mapping_->Open(file.c_str()));
+  // The sections, e.g., the tries of the system dictionary, are looked up at
+  // random.
+  CHECK(mapping_->Open(file.c_str(), "r", Mmap::RANDOM_ACCESS));
   return OpenFromImage(mapping_->begin(), mapping_->size());
 }
 
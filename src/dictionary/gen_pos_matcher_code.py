@@ -45,10 +45,12 @@ The binary format is as follows.
 
 * Binary format
 
-Support there are N matching rules.  Then, the first 2*N bytes is the array of
-uint16 that contains the results for GetXXXId() methods.  The latter part
-contains the ranges of POS IDs for each IsXXX(uint16 id) methods (IsXXX should
-return true if id is in one of the ranges).  See the following figure:
+Support there are N matching rules and P POS IDs.  Then, the first 2*N bytes is
+the array of uint16 that contains the results for GetXXXId() methods.  It is
+followed by P and a dense bitset of all the rules for each POS ID, so that
+IsXXX(uint16 id) is a single bit test.  Each bitset consists of W = ceil(N / 16)
+uint16 words, and bit (i % 16) of word (i / 16) is set if the POS ID matches
+rule i.  See the following figure:
 
 +===========================================+=============================
 | POS ID for rule 0 (2 bytes)               |   For GetXXXID() methods
@@ -59,32 +61,16 @@ return true if id is in one of the ranges).  See the following figure:
 +-------------------------------------------+
 | POS ID for rule N - 1 (2 bytes)           |
 +===========================================+=============================
-| POS range for rule 0: start 0 (2 bytes)   |   For IsXXX() for rule 0
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end 0 (2 bytes)     |
+| The number of POS IDs P (2 bytes)         |   For IsXXX() methods
 +-------------------------------------------+
-| POS range for rule 0: start 1 (2 bytes)   |
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end 1 (2 bytes)     |
-|-------------------------------------------+
-| ....                                      |
-|-------------------------------------------+
-| POS range for rule 0: start M (2 bytes)   |
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 0: end M (2 bytes)     |
-|-------------------------------------------+
-| Sentinel element 0xFFFF (2 bytes)         |
-+===========================================+=============================
-| POS range for rule 1: start 0 (2 bytes)   |   For IsXXX() for rule 1
-+ - - - - - - - - - - - - - - - - - - - - - +
-| POS range for rule 1: end 0 (2 bytes)     |
+| Bitset for POS ID 0 (2*W bytes)           |
 +-------------------------------------------+
-| ....                                      |
+| Bitset for POS ID 1 (2*W bytes)           |
 +-------------------------------------------+
-| Sentinel element 0xFFFF (2 bytes)         |
-+===========================================+
 | ....                                      |
-|                                           |
++-------------------------------------------+
+| Bitset for POS ID P - 1 (2*W bytes)       |
++===========================================+=============================
 """
 
 __author__ = "taku"
@@ -97,21 +83,25 @@ import sys
 from dictionary import pos_util
 
 
+def _GetRuleBitsSize(pos_matcher):
+  return (len(pos_matcher.GetRuleNameList()) + 15) // 16
+
+
 def OutputPosMatcherData(pos_matcher, output):
   data = []
   for rule_name in pos_matcher.GetRuleNameList():
     data.append(pos_matcher.GetId(rule_name))
 
-  offset = 2 * len(pos_matcher.GetRuleNameList())
-  for rule_name in pos_matcher.GetRuleNameList():
-    data.append(offset)
-    offset += 2 * len(pos_matcher.GetRange(rule_name)) + 1
-
-  for rule_name in pos_matcher.GetRuleNameList():
+  num_pos_ids = max(pos_id for _, pos_id in pos_matcher.pos_database.id_list) + 1
+  assert num_pos_ids < 0xFFFF
+  rule_bits_size = _GetRuleBitsSize(pos_matcher)
+  rule_bits = [0] * (num_pos_ids * rule_bits_size)
+  for index, rule_name in enumerate(pos_matcher.GetRuleNameList()):
     for id_range in pos_matcher.GetRange(rule_name):
-      data.append(id_range[0])
-      data.append(id_range[1])
-    data.append(0xFFFF)
+      for pos_id in range(id_range[0], id_range[1] + 1):
+        rule_bits[pos_id * rule_bits_size + index // 16] |= 1 << (index % 16)
+  data.append(num_pos_ids)
+  data.extend(rule_bits)
 
   for u16 in data:
     output.write(struct.pack('<H', u16))
@@ -147,24 +137,47 @@ def OutputPosMatcherHeader(pos_matcher, output):
             })
 
   # Helper function to generate Is<RuleName>(uint16 id) method from rule name
-  # and its corresponding index. The generated function checks if the given id
-  # belongs to some range in kRangeTable[index] = kRangeTable_RuleName[].
+  # and its corresponding index. The generated function tests the bit of the
+  # rule in the bitset of the given id.
   def _GenerateIsMethod(rule_name, index):
     return ('  inline bool Is%(rule_name)s(uint16 id) const {\n'
-            '    const uint16 offset = data_[%(lid_table_size)d + %(index)d];\n'
-            '    for (const uint16 *ptr = data_ + offset;\n'
-            '         *ptr != static_cast<uint16>(0xFFFF); ptr += 2) {\n'
-            '      if (id >= *ptr && id <= *(ptr + 1)) {\n'
-            '        return true;\n'
-            '      }\n'
-            '    }\n'
-            '    return false;\n'
+            '    return Matches(id, k%(rule_name)sRule);\n'
             '  }' % {
                 'rule_name': rule_name,
-                'index': index,
-                'lid_table_size': lid_table_size,
             })
 
+  # Rule indices, which are the bit positions in the bitsets.
+  output.write('  enum Rule {\n')
+  for i, rule_name in enumerate(pos_matcher.GetRuleNameList()):
+    output.write('    k%sRule = %d,\n' % (rule_name, i))
+  output.write(
+      '  };\n'
+      '  static const int kNumRules = %(lid_table_size)d;\n'
+      '  // The number of uint16 words in the bitset of each POS ID.\n'
+      '  static const int kRuleBitsSize = %(rule_bits_size)d;\n'
+      '\n'
+      '  // Returns the bitset of the rules that the given id matches, or\n'
+      '  // nullptr if the id is out of range.  Bit (i %% 16) of word (i / 16)\n'
+      '  // is set if the id matches rule i.  Useful to classify an id against\n'
+      '  // several rules at once.\n'
+      '  inline const uint16 *GetRuleBits(uint16 id) const {\n'
+      '    if (id >= data_[%(lid_table_size)d]) {\n'
+      '      return nullptr;\n'
+      '    }\n'
+      '    return data_ + %(lid_table_size)d + 1 + id * kRuleBitsSize;\n'
+      '  }\n'
+      '  static inline bool HasRule(const uint16 *bits, Rule rule) {\n'
+      '    return (bits[rule >> 4] >> (rule & 15)) & 1;\n'
+      '  }\n'
+      '  inline bool Matches(uint16 id, Rule rule) const {\n'
+      '    const uint16 *bits = GetRuleBits(id);\n'
+      '    return bits != nullptr && HasRule(bits, rule);\n'
+      '  }\n'
+      '\n' % {
+          'lid_table_size': lid_table_size,
+          'rule_bits_size': _GetRuleBitsSize(pos_matcher),
+      })
+
   # Generate Get<RuleName>Id() and Is<RuleName>(uint16 id) for each rule.
   for i, rule_name in enumerate(pos_matcher.GetRuleNameList()):
     output.write(
@@ -45,9 +45,69 @@ def _ParseOptions():
                     help='Output serialized string array for values')
   parser.add_option('--output_token_array', dest='output_token_array',
                     help='Output uint32 array for lid, rid and cost.')
+  parser.add_option('--output_index_array', dest='output_index_array',
+                    help='Output uint32 array of key ranges for each first '
+                    'character.')
   return parser.parse_args()[0]
 
 
+def _FirstCharCode(key):
+  """Returns the UTF-8 bytes of the first character packed in big endian."""
+  lead = ord(key[0])
+  if lead < 0x80:
+    length = 1
+  elif lead < 0xE0:
+    length = 2
+  elif lead < 0xF0:
+    length = 3
+  else:
+    length = 4
+  code = 0
+  for c in key[:length]:
+    code = (code << 8) | ord(c)
+  return code
+
+
+def _HashSlot(code, bits):
+  """Must be kept in sync with SuffixDictionary::FindFirstCharRange()."""
+  return ((code * 0x9E3779B1) & 0xFFFFFFFF) >> (32 - bits)
+
+
+def _WriteIndex(keys, path):
+  """Writes the range [begin, end) of keys for each first character.
+
+  The output is an open addressing hash table of uint32:
+    {bits, code[0], begin[0], end[0], code[1], begin[1], end[1], ...}
+  which has 2^bits slots.  The slot of a character is given by _HashSlot()
+  followed by linear probing, and empty slots have code 0.
+  """
+  ranges = []
+  for i, key in enumerate(keys):
+    if not key:
+      continue
+    code = _FirstCharCode(key)
+    if ranges and ranges[-1][0] == code:
+      ranges[-1][2] = i + 1
+    else:
+      ranges.append([code, i, i + 1])
+
+  bits = 1
+  while (1 << bits) < 2 * len(ranges):
+    bits += 1
+  mask = (1 << bits) - 1
+  table = [(0, 0, 0)] * (1 << bits)
+  for code, begin, end in ranges:
+    slot = _HashSlot(code, bits)
+    while table[slot][0] != 0:
+      slot = (slot + 1) & mask
+    table[slot] = (code, begin, end)
+
+  with open(path, 'wb') as f:
+    f.write(struct.pack('<I', bits))
+    for code, begin, end in table:
+      f.write(struct.pack('<III', code, begin, end))
+
+
 def main():
   opts = _ParseOptions()
 
@@ -87,6 +147,9 @@ def main():
       f.write(struct.pack('<I', lid))
       f.write(struct.pack('<I', cost))
 
+  if opts.output_index_array:
+    _WriteIndex(list(entry[0] for entry in result), opts.output_index_array)
+
 
 if __name__ == '__main__':
   main()
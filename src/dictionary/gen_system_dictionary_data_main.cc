@@ -38,6 +38,7 @@
 #include <string>
 #include <vector>
 
+#include "base/cpu_stats.h"
 #include "base/file_stream.h"
 #include "base/flags.h"
 #include "base/init_mozc.h"
@@ -52,6 +53,15 @@
 DEFINE_string(input, "", "space separated input text files");
 DEFINE_string(user_pos_manager_data, "", "user pos manager data");
 DEFINE_string(output, "", "output binary file");
+DEFINE_int32(num_threads, 0,
+             "number of threads used to parse the input and build the "
+             "dictionary.  0 means the number of processors.  The output is "
+             "the same regardless of this number.");
+DEFINE_int32(max_tokens_in_memory, 0,
+             "if positive, the tokens are streamed to the builder in the "
+             "order of key instead of being loaded at once, and unsorted "
+             "input is sorted in runs of at most this number of tokens in "
+             "temporary files next to --output.");
 
 namespace mozc {
 namespace {
@@ -87,6 +97,24 @@ void GetInputFileName(const string &input_file,
   }
 }
 
+// Passes the tokens streamed from TextDictionaryLoader to the builder.
+class KeyGroupAdder
+    : public dictionary::TextDictionaryLoader::KeyGroupCallback {
+ public:
+  explicit KeyGroupAdder(dictionary::SystemDictionaryBuilder *builder)
+      : builder_(builder) {}
+
+  void OnKeyGroup(
+      std::vector<std::unique_ptr<dictionary::Token>> *tokens) override {
+    builder_->AddKeyGroup(tokens);
+  }
+
+ private:
+  dictionary::SystemDictionaryBuilder *builder_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyGroupAdder);
+};
+
 }  // namespace
 }  // namespace mozc
 
@@ -110,11 +138,26 @@ int main(int argc, char **argv) {
   const mozc::dictionary::POSMatcher pos_matcher(
       data_manager.GetPOSMatcherData());
 
-  mozc::dictionary::TextDictionaryLoader loader(pos_matcher);
-  loader.Load(system_dictionary_input, reading_correction_input);
+  int num_threads = FLAGS_num_threads;
+  if (num_threads <= 0) {
+    num_threads = static_cast<int>(mozc::CPUStats().GetNumberOfProcessors());
+  }
 
+  mozc::dictionary::TextDictionaryLoader loader(pos_matcher);
+  loader.set_num_threads(num_threads);
   mozc::dictionary::SystemDictionaryBuilder builder;
-  builder.BuildFromTokens(loader.tokens());
+  builder.set_num_threads(num_threads);
+  if (FLAGS_max_tokens_in_memory > 0) {
+    mozc::KeyGroupAdder adder(&builder);
+    CHECK(loader.LoadSortedByKey(system_dictionary_input,
+                                 reading_correction_input,
+                                 FLAGS_max_tokens_in_memory,
+                                 FLAGS_output + ".run", &adder));
+    builder.BuildFromKeyGroups();
+  } else {
+    loader.Load(system_dictionary_input, reading_correction_input);
+    builder.BuildFromTokens(loader.tokens());
+  }
 
   std::unique_ptr<std::ostream> output_stream(new mozc::OutputFileStream(
       FLAGS_output.c_str(), std::ios::out | std::ios::binary));
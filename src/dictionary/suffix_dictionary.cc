@@ -41,6 +41,20 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
+const uint32 kHashMultiplier = 0x9E3779B1;
+
+// Packs the UTF-8 bytes of the first character of |key| into uint32 in big
+// endian, which is the key of the index.
+uint32 FirstCharCode(StringPiece key) {
+  const size_t len = Util::OneCharLen(key.data());
+  DCHECK_LE(len, key.size());
+  uint32 code = 0;
+  for (size_t i = 0; i < len; ++i) {
+    code = (code << 8) | static_cast<uint8>(key[i]);
+  }
+  return code;
+}
+
 class ComparePrefix {
  public:
   explicit ComparePrefix(size_t max_len) : max_len_(max_len) {}
@@ -58,12 +72,26 @@ class ComparePrefix {
 SuffixDictionary::SuffixDictionary(StringPiece key_array_data,
                                    StringPiece value_array_data,
                                    const uint32 *token_array)
-    : token_array_(token_array) {
+    : SuffixDictionary(key_array_data, value_array_data, token_array,
+                       StringPiece()) {}
+
+SuffixDictionary::SuffixDictionary(StringPiece key_array_data,
+                                   StringPiece value_array_data,
+                                   const uint32 *token_array,
+                                   StringPiece index_data)
+    : token_array_(token_array), index_(nullptr), index_bits_(0) {
   DCHECK(SerializedStringArray::VerifyData(key_array_data));
   DCHECK(SerializedStringArray::VerifyData(value_array_data));
   DCHECK(token_array_);
   key_array_.Set(key_array_data);
   value_array_.Set(value_array_data);
+  if (!index_data.empty()) {
+    const uint32 *data = reinterpret_cast<const uint32 *>(index_data.data());
+    DCHECK_LT(data[0], 32);
+    DCHECK_EQ(sizeof(uint32) * (1 + 3 * (1 << data[0])), index_data.size());
+    index_bits_ = data[0];
+    index_ = data + 1;
+  }
 }
 
 SuffixDictionary::~SuffixDictionary() {}
@@ -86,14 +114,51 @@ bool SuffixDictionary::HasValue(StringPiece value) const {
   return false;
 }
 
+// The hash must be kept in sync with _HashSlot() in gen_suffix_data.py.
+bool SuffixDictionary::FindFirstCharRange(StringPiece key, size_t *begin,
+                                          size_t *end) const {
+  if (index_ == nullptr) {
+    return false;
+  }
+  const uint32 code = FirstCharCode(key);
+  const uint32 mask = (1 << index_bits_) - 1;
+  for (uint32 slot = (code * kHashMultiplier) >> (32 - index_bits_);;
+       slot = (slot + 1) & mask) {
+    const uint32 *entry = index_ + 3 * slot;
+    if (entry[0] == code) {
+      *begin = entry[1];
+      *end = entry[2];
+      return true;
+    }
+    if (entry[0] == 0) {
+      // No key starts with this character.
+      *begin = *end = 0;
+      return true;
+    }
+  }
+}
+
 void SuffixDictionary::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
   using Iter = SerializedStringArray::const_iterator;
-  std::pair<Iter, Iter> range = std::equal_range(key_array_.begin(),
-                                            key_array_.end(),
-                                            key, ComparePrefix(key.size()));
+  std::pair<Iter, Iter> range(key_array_.begin(), key_array_.end());
+  size_t begin = 0, end = 0;
+  if (key.empty()) {
+    // All the keys match.
+  } else if (Util::OneCharLen(key.data()) <= key.size() &&
+             FindFirstCharRange(key, &begin, &end)) {
+    range.first = key_array_.begin() + begin;
+    range.second = key_array_.begin() + end;
+    if (Util::OneCharLen(key.data()) < key.size()) {
+      range = std::equal_range(range.first, range.second, key,
+                               ComparePrefix(key.size()));
+    }
+  } else {
+    range = std::equal_range(key_array_.begin(), key_array_.end(), key,
+                             ComparePrefix(key.size()));
+  }
   Token token;
   token.attributes = Token::NONE;  // Common for all suffix tokens.
   for (; range.first != range.second; ++range.first) {
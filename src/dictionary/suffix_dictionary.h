@@ -53,6 +53,12 @@ class SuffixDictionary : public DictionaryInterface {
  public:
   SuffixDictionary(StringPiece key_array_data, StringPiece value_array_data,
                    const uint32 *token_array);
+
+  // |index_data| is the optional first character index generated by
+  // gen_suffix_data.py.  When it's empty, LookupPredictive() finds the key
+  // range by binary search over all the keys.
+  SuffixDictionary(StringPiece key_array_data, StringPiece value_array_data,
+                   const uint32 *token_array, StringPiece index_data);
   ~SuffixDictionary() override;
 
   bool HasKey(StringPiece key) const override;
@@ -76,10 +82,19 @@ class SuffixDictionary : public DictionaryInterface {
                      Callback *callback) const override;
 
  private:
+  // Finds the range of keys starting with the first character of |key| from
+  // the index.  Returns false if the index is not available.
+  bool FindFirstCharRange(StringPiece key, size_t *begin, size_t *end) const;
+
   SerializedStringArray key_array_;
   SerializedStringArray value_array_;
   const uint32 *token_array_;
 
+  // Open addressing hash table of (first character, begin, end) with
+  // 2^|index_bits_| slots.  See gen_suffix_data.py for the format.
+  const uint32 *index_;
+  uint32 index_bits_;
+
   DISALLOW_COPY_AND_ASSIGN(SuffixDictionary);
 };
 
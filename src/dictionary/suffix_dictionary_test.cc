@@ -30,7 +30,10 @@
 #include "dictionary/suffix_dictionary.h"
 
 #include <memory>
+#include <set>
+#include <string>
 
+#include "base/serialized_string_array.h"
 #include "base/util.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_interface.h"
@@ -88,5 +91,51 @@ TEST(SuffixDictionaryTest, LookupPredictive) {
   }
 }
 
+TEST(SuffixDictionaryTest, LookupPredictiveWithIndex) {
+  const testing::MockDataManager manager;
+  StringPiece key_array_data, value_array_data, index_array_data;
+  const uint32 *token_array = nullptr;
+  manager.GetSuffixDictionaryData(&key_array_data, &value_array_data,
+                                  &token_array);
+  manager.GetSuffixDictionaryIndexData(&index_array_data);
+  ASSERT_FALSE(index_array_data.empty());
+  const SuffixDictionary indexed(key_array_data, value_array_data,
+                                 token_array, index_array_data);
+  const SuffixDictionary unindexed(key_array_data, value_array_data,
+                                   token_array);
+  ConversionRequest convreq;
+
+  // Check every first character and two character prefix appearing in the
+  // keys, as well as prefixes that don't appear.
+  std::set<string> prefixes = {
+      "\xE3\x82\x94",  // "ゔ"
+      "\xE3\x81",  // Incomplete UTF-8 sequence.
+      "z",
+  };
+  SerializedStringArray keys;
+  ASSERT_TRUE(keys.Init(key_array_data));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const StringPiece key = keys[i];
+    const size_t len1 = Util::OneCharLen(key.data());
+    prefixes.insert(key.substr(0, len1).as_string());
+    if (len1 < key.size()) {
+      const size_t len2 = Util::OneCharLen(key.data() + len1);
+      prefixes.insert(key.substr(0, len1 + len2).as_string());
+      prefixes.insert(key.substr(0, len1).as_string() + "z");
+    }
+  }
+  for (const string &prefix : prefixes) {
+    CollectTokenCallback expected, actual;
+    unindexed.LookupPredictive(prefix, convreq, &expected);
+    indexed.LookupPredictive(prefix, convreq, &actual);
+    ASSERT_EQ(expected.tokens().size(), actual.tokens().size()) << prefix;
+    for (size_t i = 0; i < expected.tokens().size(); ++i) {
+      EXPECT_EQ(expected.tokens()[i].key, actual.tokens()[i].key);
+      EXPECT_EQ(expected.tokens()[i].value, actual.tokens()[i].value);
+      EXPECT_EQ(expected.tokens()[i].cost, actual.tokens()[i].cost);
+    }
+  }
+}
+
 }  // namespace dictionary
 }  // namespace mozc
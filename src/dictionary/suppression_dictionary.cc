@@ -29,20 +29,32 @@
 
 #include "dictionary/suppression_dictionary.h"
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/mutex.h"
+#include "storage/existence_filter.h"
 
 namespace mozc {
 namespace dictionary {
 namespace {
-const char kDelimiter = '\t';
+const float kFilterErrorRate = 0.01f;
 }  // namespace
 
 SuppressionDictionary::SuppressionDictionary()
-    : locked_(false), has_key_empty_(false), has_value_empty_(false) {}
+    : table_mask_(0), num_entries_(0),
+      locked_(false), has_key_empty_(false), has_value_empty_(false) {}
 
 SuppressionDictionary::~SuppressionDictionary() {}
 
+// static
+uint64 SuppressionDictionary::EntryFingerprint(StringPiece key,
+                                               StringPiece value) {
+  // Hashing the value with a seed derived from the key distinguishes
+  // ("ab", "c") from ("a", "bc") without building "key\tvalue".
+  const uint64 fp = Hash::FingerprintWithSeed(value, Hash::Fingerprint32(key));
+  return fp == 0 ? 1 : fp;
+}
+
 bool SuppressionDictionary::AddEntry(
     const string &key, const string &value) {
   if (!locked_) {
@@ -63,7 +75,7 @@ bool SuppressionDictionary::AddEntry(
     has_value_empty_ = true;
   }
 
-  dic_.insert(key + kDelimiter + value);
+  entries_.push_back(EntryFingerprint(key, value));
 
   return true;
 }
@@ -75,7 +87,59 @@ void SuppressionDictionary::Clear() {
   }
   has_key_empty_ = false;
   has_value_empty_ = false;
-  dic_.clear();
+  entries_.clear();
+  BuildTable();
+}
+
+void SuppressionDictionary::BuildTable() {
+  table_.clear();
+  table_mask_ = 0;
+  num_entries_ = 0;
+  filter_.reset();
+  if (entries_.empty()) {
+    return;
+  }
+
+  size_t table_size = 2;
+  while (table_size < entries_.size() * 2) {
+    table_size *= 2;
+  }
+  table_.assign(table_size, 0);
+  table_mask_ = table_size - 1;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const uint64 fp = entries_[i];
+    uint64 index = fp & table_mask_;
+    while (table_[index] != 0 && table_[index] != fp) {
+      index = (index + 1) & table_mask_;
+    }
+    if (table_[index] == 0) {
+      table_[index] = fp;
+      ++num_entries_;
+    }
+  }
+
+  const size_t filter_size = storage::ExistenceFilter::
+      MinFilterSizeInBytesForErrorRate(kFilterErrorRate, num_entries_);
+  filter_.reset(storage::ExistenceFilter::CreateOptimal(
+      filter_size, static_cast<uint32>(num_entries_)));
+  for (size_t i = 0; i < table_.size(); ++i) {
+    if (table_[i] != 0) {
+      filter_->Insert(table_[i]);
+    }
+  }
+}
+
+bool SuppressionDictionary::Contains(uint64 fp) const {
+  if (!filter_->Exists(fp)) {
+    return false;
+  }
+  for (uint64 index = fp & table_mask_; table_[index] != 0;
+       index = (index + 1) & table_mask_) {
+    if (table_[index] == fp) {
+      return true;
+    }
+  }
+  return false;
 }
 
 void SuppressionDictionary::Lock() {
@@ -85,6 +149,7 @@ void SuppressionDictionary::Lock() {
 
 void SuppressionDictionary::UnLock() {
   scoped_lock l(&mutex_);
+  BuildTable();
   locked_ = false;
 }
 
@@ -92,12 +157,12 @@ bool SuppressionDictionary::IsEmpty() const {
   if (locked_) {
     return true;
   }
-  return dic_.empty();
+  return num_entries_ == 0;
 }
 
 bool SuppressionDictionary::SuppressEntry(
-    const string &key, const string &value) const {
-  if (dic_.empty()) {
+    StringPiece key, StringPiece value) const {
+  if (num_entries_ == 0) {
     // Almost all users don't use word supresssion function.
     // We can return false as early as possible
     return false;
@@ -108,24 +173,16 @@ bool SuppressionDictionary::SuppressEntry(
     return false;
   }
 
-  string lookup_key = key;
-  lookup_key.append(1, kDelimiter).append(value);
-  if (dic_.find(lookup_key) != dic_.end()) {
+  if (Contains(EntryFingerprint(key, value))) {
     return true;
   }
 
-  if (has_key_empty_) {
-    lookup_key.assign(1, kDelimiter).append(value);
-    if (dic_.find(lookup_key) != dic_.end()) {
-      return true;
-    }
+  if (has_key_empty_ && Contains(EntryFingerprint("", value))) {
+    return true;
   }
 
-  if (has_value_empty_) {
-    lookup_key.assign(key).append(1, kDelimiter);
-    if (dic_.find(lookup_key) != dic_.end()) {
-      return true;
-    }
+  if (has_value_empty_ && Contains(EntryFingerprint(key, ""))) {
+    return true;
   }
 
   return false;
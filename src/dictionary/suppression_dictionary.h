@@ -30,13 +30,19 @@
 #ifndef MOZC_DICTIONARY_SUPPRESSION_DICTIONARY_H_
 #define MOZC_DICTIONARY_SUPPRESSION_DICTIONARY_H_
 
-#include <set>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/mutex.h"
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
+namespace storage {
+class ExistenceFilter;
+}  // namespace storage
+
 namespace dictionary {
 
 class SuppressionDictionary {
@@ -52,7 +58,8 @@ class SuppressionDictionary {
   // Lock() and SupressWord() must be called synchronously.
   void Lock();
 
-  // Unlocks dictionary.
+  // Unlocks dictionary.  The lookup table is rebuilt from the entries added
+  // while the dictionary was locked.
   void UnLock();
 
   // Returns true if the dictionary is locked.
@@ -72,10 +79,29 @@ class SuppressionDictionary {
   // Returns true if |word| should be suppressed.  If the current dictionay is
   // "locked" via Lock() method, this function always return false.  Lock() and
   // SuppressWord() must be called synchronously.
-  bool SuppressEntry(const string &key, const string &value) const;
+  bool SuppressEntry(StringPiece key, StringPiece value) const;
 
  private:
-  std::set<string> dic_;
+  // Returns the 64-bit fingerprint of (key, value).  Zero is reserved for
+  // the empty slot of |table_| and never returned.
+  static uint64 EntryFingerprint(StringPiece key, StringPiece value);
+
+  void BuildTable();
+  bool Contains(uint64 fp) const;
+
+  // Fingerprints added by AddEntry() while locked.
+  std::vector<uint64> entries_;
+
+  // Open addressing hash set of fingerprints built from |entries_| on
+  // UnLock().  The size is a power of two and at most half of the slots are
+  // used, so that a miss usually ends at the first probe.
+  std::vector<uint64> table_;
+  uint64 table_mask_;
+  size_t num_entries_;
+
+  // Checked before |table_| since almost all lookups are misses.
+  std::unique_ptr<storage::ExistenceFilter> filter_;
+
   bool locked_;
   bool has_key_empty_;
   bool has_value_empty_;
@@ -101,6 +101,41 @@ TEST(SupressionDictionary, BasicTest) {
   }
 }
 
+TEST(SupressionDictionary, ManyEntries) {
+  SuppressionDictionary dic;
+  dic.Lock();
+  for (int i = 0; i < 1000; ++i) {
+    const string n = NumberUtil::SimpleItoa(i);
+    EXPECT_TRUE(dic.AddEntry("key" + n, "value" + n));
+  }
+  // Duplicated entries are accepted.
+  EXPECT_TRUE(dic.AddEntry("key0", "value0"));
+  dic.UnLock();
+
+  EXPECT_FALSE(dic.IsEmpty());
+  for (int i = 0; i < 1000; ++i) {
+    const string n = NumberUtil::SimpleItoa(i);
+    EXPECT_TRUE(dic.SuppressEntry("key" + n, "value" + n));
+    EXPECT_FALSE(dic.SuppressEntry("key" + n, "value" + n + "x"));
+    EXPECT_FALSE(dic.SuppressEntry("key", n + "value" + n));
+    EXPECT_FALSE(dic.SuppressEntry("key" + n, ""));
+    EXPECT_FALSE(dic.SuppressEntry("", "value" + n));
+  }
+
+  // Entries added across Lock()/UnLock() are kept until Clear().
+  dic.Lock();
+  EXPECT_TRUE(dic.AddEntry("key1000", "value1000"));
+  dic.UnLock();
+  EXPECT_TRUE(dic.SuppressEntry("key0", "value0"));
+  EXPECT_TRUE(dic.SuppressEntry("key1000", "value1000"));
+
+  dic.Lock();
+  dic.Clear();
+  dic.UnLock();
+  EXPECT_TRUE(dic.IsEmpty());
+  EXPECT_FALSE(dic.SuppressEntry("key0", "value0"));
+}
+
 class DictionaryLoaderThread : public Thread {
  public:
   virtual void Run() {
@@ -31,6 +31,7 @@
 
 #include <sstream>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
@@ -76,6 +77,12 @@ const char kKeySectionName[] = "k";
 const char kValueSectionName[] = "v";
 const char kTokensSectionName[] = "t";
 const char kPosSectionName[] = "p";
+const char kReverseLookupIndexSectionName[] = "r";
+const char kExistenceFilterSectionName[] = "e";
+
+//// Constants for existence filter ////
+const uint32 kKeyFingerprintSeed = 0x6b657973;    // "keys"
+const uint32 kValueFingerprintSeed = 0x76616c73;  // "vals"
 
 //// Constants for validation ////
 // 12 bits
@@ -193,7 +200,53 @@ const uint8 kUpperCrammedIDMask = 0x3f;
 const uint8 kLastTokenFlag = 0x80;
 }  // namespace
 
-SystemDictionaryCodec::SystemDictionaryCodec() {}
+SystemDictionaryCodec::SystemDictionaryCodec() {
+  for (size_t i = 0; i < arraysize(token_flag_table_); ++i) {
+    const uint8 flags = ReadFlags(static_cast<uint8>(i));
+    TokenFlagInfo *info = &token_flag_table_[i];
+    info->pos_flag = flags & kPosTypeFlagMask;
+    switch (info->pos_flag) {
+      case kFrequentPosFlag:
+        info->pos_type = TokenInfo::FREQUENT_POS;
+        info->pos_bytes = 1;
+        break;
+      case kSameAsPrevPosFlag:
+        info->pos_type = TokenInfo::SAME_AS_PREV_POS;
+        info->pos_bytes = 0;
+        break;
+      case kMonoPosFlag:
+        info->pos_type = TokenInfo::DEFAULT_POS;
+        info->pos_bytes = 2;
+        break;
+      default:
+        DCHECK_EQ(kFullPosFlag, info->pos_flag);
+        info->pos_type = TokenInfo::DEFAULT_POS;
+        info->pos_bytes = 3;
+        break;
+    }
+    info->is_crammed_id = (flags & kCrammedIDFlag) != 0;
+    switch (flags & kValueTypeFlagMask) {
+      case kAsIsHiraganaValueFlag:
+        info->value_type = TokenInfo::AS_IS_HIRAGANA;
+        info->value_bytes = 0;
+        break;
+      case kAsIsKatakanaValueFlag:
+        info->value_type = TokenInfo::AS_IS_KATAKANA;
+        info->value_bytes = 0;
+        break;
+      case kSameAsPrevValueFlag:
+        info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
+        info->value_bytes = 0;
+        break;
+      default:
+        info->value_type = TokenInfo::DEFAULT_VALUE;
+        info->value_bytes = info->is_crammed_id ? 2 : 3;
+        break;
+    }
+    info->is_spelling_correction = (flags & kSpellingCorrectionFlag) != 0;
+    info->is_last = (flags & kLastTokenFlag) != 0;
+  }
+}
 
 SystemDictionaryCodec::~SystemDictionaryCodec() {}
 
@@ -213,6 +266,24 @@ const string SystemDictionaryCodec::GetSectionNameForPos() const {
   return kPosSectionName;
 }
 
+const string SystemDictionaryCodec::GetSectionNameForReverseLookupIndex()
+    const {
+  return kReverseLookupIndexSectionName;
+}
+
+const string SystemDictionaryCodec::GetSectionNameForExistenceFilter() const {
+  return kExistenceFilterSectionName;
+}
+
+uint64 SystemDictionaryCodec::GetKeyFingerprint(const StringPiece key) const {
+  return Hash::FingerprintWithSeed(key, kKeyFingerprintSeed);
+}
+
+uint64 SystemDictionaryCodec::GetValueFingerprint(
+    const StringPiece value) const {
+  return Hash::FingerprintWithSeed(value, kValueFingerprintSeed);
+}
+
 void SystemDictionaryCodec::EncodeKey(
     const StringPiece src, string *dst) const {
   EncodeDecodeKeyImpl(src, dst);
@@ -444,6 +515,69 @@ bool SystemDictionaryCodec::DecodeToken(
   }
 }
 
+int SystemDictionaryCodec::DecodeTokenBlock(
+    const uint8 *ptr, int max_tokens, DecodedTokenFields *fields,
+    int *read_bytes, bool *is_last) const {
+  DCHECK(ptr);
+  DCHECK(fields);
+  DCHECK(read_bytes);
+  DCHECK(is_last);
+
+  const uint8 *p = ptr;
+  int num_tokens = 0;
+  *is_last = false;
+  while (num_tokens < max_tokens) {
+    const TokenFlagInfo &info = token_flag_table_[p[0]];
+    DecodedTokenFields *f = &fields[num_tokens++];
+    f->pos_type = info.pos_type;
+    f->value_type = info.value_type;
+    f->is_spelling_correction = info.is_spelling_correction;
+    f->id_in_frequent_pos_map = -1;
+    f->id_in_value_trie = -1;
+
+    const uint8 *q = p + 1;
+    switch (info.pos_flag) {
+      case kFrequentPosFlag:
+        f->id_in_frequent_pos_map = q[0];
+        break;
+      case kMonoPosFlag:
+        f->lid = f->rid = ((q[1] << 8) | q[0]);
+        break;
+      case kFullPosFlag:
+        f->lid = q[0] + ((q[1] & 0x0f) << 8);
+        f->rid = (q[1] >> 4) + (q[2] << 4);
+        break;
+      default:
+        break;
+    }
+    q += info.pos_bytes;
+
+    if (q[0] & kSmallCostFlag) {
+      f->cost = ((q[0] & kSmallCostMask) << 8);
+      q += 1;
+    } else {
+      f->cost = (q[0] << 8) + q[1];
+      q += 2;
+    }
+
+    if (info.value_type == TokenInfo::DEFAULT_VALUE) {
+      uint32 id = ((q[1] << 8) | q[0]);
+      id |= info.is_crammed_id ? ((p[0] & kUpperCrammedIDMask) << 16)
+                               : (q[2] << 16);
+      f->id_in_value_trie = id;
+    }
+    q += info.value_bytes;
+
+    p = q;
+    if (info.is_last) {
+      *is_last = true;
+      break;
+    }
+  }
+  *read_bytes = p - ptr;
+  return num_tokens;
+}
+
 bool SystemDictionaryCodec::ReadTokenForReverseLookup(
     const uint8 *ptr, int *value_id, int *read_bytes) const {
   DCHECK(ptr);
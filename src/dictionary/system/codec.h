@@ -36,6 +36,7 @@
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "dictionary/system/codec_interface.h"
+#include "dictionary/system/words_info.h"
 
 namespace mozc {
 namespace dictionary {
@@ -58,6 +59,16 @@ class SystemDictionaryCodec : public SystemDictionaryCodecInterface {
   // Return section name for frequent pos map
   virtual const string GetSectionNameForPos() const;
 
+  // Return section name for reverse lookup index
+  virtual const string GetSectionNameForReverseLookupIndex() const;
+
+  // Return section name for existence filter
+  virtual const string GetSectionNameForExistenceFilter() const;
+
+  // Return hash values for existence filter
+  virtual uint64 GetKeyFingerprint(const StringPiece key) const;
+  virtual uint64 GetValueFingerprint(const StringPiece value) const;
+
   // Compresses key string into small bytes.
   virtual void EncodeKey(const StringPiece src, string *dst) const;
 
@@ -88,6 +99,12 @@ class SystemDictionaryCodec : public SystemDictionaryCodecInterface {
   virtual bool DecodeToken(
       const uint8 *ptr, TokenInfo *token_info, int *read_bytes) const;
 
+  // Decompress tokens in a batch.  The flags byte of each token is
+  // interpreted by a precomputed table.
+  virtual int DecodeTokenBlock(const uint8 *ptr, int max_tokens,
+                               DecodedTokenFields *fields,
+                               int *read_bytes, bool *is_last) const;
+
   // Read a token for reverse lookup
   // If the token have value id, assign it to |id_in_value_trie|
   // otherwise assign -1
@@ -98,9 +115,24 @@ class SystemDictionaryCodec : public SystemDictionaryCodecInterface {
   virtual uint8 GetTokensTerminationFlag() const;
 
  private:
+  // Layout of a token derived from its flags byte.
+  struct TokenFlagInfo {
+    TokenInfo::PosType pos_type;
+    TokenInfo::ValueType value_type;
+    uint8 pos_flag;
+    uint8 pos_bytes;
+    uint8 value_bytes;
+    bool is_crammed_id;
+    bool is_spelling_correction;
+    bool is_last;
+  };
+
   void EncodeToken(
       const std::vector<TokenInfo> &tokens, int index, string *output) const;
 
+  // Indexed by the flags byte.
+  TokenFlagInfo token_flag_table_[256];
+
   DISALLOW_COPY_AND_ASSIGN(SystemDictionaryCodec);
 };
 }  // namespace dictionary
@@ -35,11 +35,25 @@
 
 #include "base/port.h"
 #include "base/string_piece.h"
+#include "dictionary/system/words_info.h"
 
 namespace mozc {
 namespace dictionary {
 
-struct TokenInfo;
+// Fields of a token decoded by DecodeTokenBlock().  Only the fields encoded
+// in the token are set, e.g., |lid| and |rid| are set iff |pos_type| is
+// DEFAULT_POS and |id_in_value_trie| is set iff |value_type| is
+// DEFAULT_VALUE.
+struct DecodedTokenFields {
+  TokenInfo::PosType pos_type;
+  TokenInfo::ValueType value_type;
+  int id_in_value_trie;
+  int id_in_frequent_pos_map;
+  int cost;
+  uint16 lid;
+  uint16 rid;
+  bool is_spelling_correction;
+};
 
 // TODO(hidehiko): Use StringPiece.
 class SystemDictionaryCodecInterface {
@@ -60,6 +74,19 @@ class SystemDictionaryCodecInterface {
   // Return section name for frequent pos map
   virtual const string GetSectionNameForPos() const = 0;
 
+  // Return section name for reverse lookup index.  This section is optional.
+  virtual const string GetSectionNameForReverseLookupIndex() const = 0;
+
+  // Return section name for the existence filter of keys and values.  This
+  // section is optional.
+  virtual const string GetSectionNameForExistenceFilter() const = 0;
+
+  // Return the hash values of key and value(word) strings inserted into the
+  // existence filter.  Keys and values share one filter, so the two hashes
+  // differ for the same string.
+  virtual uint64 GetKeyFingerprint(const StringPiece key) const = 0;
+  virtual uint64 GetValueFingerprint(const StringPiece value) const = 0;
+
   // Encode value(word) string
   virtual void EncodeValue(const StringPiece src, string *dst) const = 0;
 
@@ -91,6 +118,14 @@ class SystemDictionaryCodecInterface {
   virtual bool DecodeToken(
       const uint8 *ptr, TokenInfo *token_info, int *read_bytes) const = 0;
 
+  // Decodes up to |max_tokens| tokens for a certain key at once into
+  // |fields|, and returns the number of the decoded tokens.  The total size
+  // of the decoded tokens is assigned to |read_bytes|, and |is_last| is set
+  // to true if the last token for the key is decoded.
+  virtual int DecodeTokenBlock(const uint8 *ptr, int max_tokens,
+                               DecodedTokenFields *fields,
+                               int *read_bytes, bool *is_last) const = 0;
+
   // Read a token for reverse lookup
   // If the token have value id, assign it to |value_id|
   // otherwise assign -1
@@ -319,6 +319,10 @@ class SystemDictionaryCodecMock : public SystemDictionaryCodecInterface {
   const string GetSectionNameForValue() const { return "Mock"; }
   const string GetSectionNameForTokens() const { return "Mock"; }
   const string GetSectionNameForPos() const { return "Mock"; }
+  const string GetSectionNameForReverseLookupIndex() const { return "Mock"; }
+  const string GetSectionNameForExistenceFilter() const { return "Mock"; }
+  uint64 GetKeyFingerprint(const StringPiece key) const { return 0; }
+  uint64 GetValueFingerprint(const StringPiece value) const { return 0; }
   virtual void EncodeKey(const StringPiece src, string *dst) const {}
   virtual void DecodeKey(const StringPiece src, string *dst) const {}
   virtual size_t GetEncodedKeyLength(const StringPiece src) const { return 0; }
@@ -334,6 +338,13 @@ class SystemDictionaryCodecMock : public SystemDictionaryCodecInterface {
     *read_bytes = 0;
     return false;
   }
+  virtual int DecodeTokenBlock(const uint8 *ptr, int max_tokens,
+                               DecodedTokenFields *fields,
+                               int *read_bytes, bool *is_last) const {
+    *read_bytes = 0;
+    *is_last = true;
+    return 0;
+  }
   virtual bool ReadTokenForReverseLookup(
       const uint8 *ptr, int *value_id, int *read_bytes) const { return false; }
   virtual uint8 GetTokensTerminationFlag() const { return 0xff; }
@@ -704,6 +715,56 @@ TEST_F(SystemDictionaryCodecTest, TokenRandomTest) {
   CheckDecoded();
 }
 
+TEST_F(SystemDictionaryCodecTest, DecodeTokenBlockRandomTest) {
+  SystemDictionaryCodecInterface *codec =
+      SystemDictionaryCodecFactory::GetCodec();
+  InitTokens(50);
+  Util::SetRandomSeed(0);
+  SetRandPos();
+  SetRandCost();
+  SetRandValue();
+  SetRandLabel();
+  string encoded;
+  codec->EncodeTokens(source_tokens_, &encoded);
+  EXPECT_GT(encoded.size(), 0);
+  codec->DecodeTokens(reinterpret_cast<const unsigned char *>(encoded.data()),
+                      &decoded_tokens_);
+  ASSERT_EQ(source_tokens_.size(), decoded_tokens_.size());
+
+  // Decodes by blocks of 7 tokens, which doesn't divide the number of tokens.
+  const uint8 *ptr = reinterpret_cast<const uint8 *>(encoded.data());
+  std::vector<DecodedTokenFields> fields;
+  bool is_last = false;
+  while (!is_last) {
+    DecodedTokenFields block[7];
+    int read_bytes = 0;
+    const int num_tokens = codec->DecodeTokenBlock(ptr, arraysize(block), block,
+                                                   &read_bytes, &is_last);
+    ASSERT_GT(num_tokens, 0);
+    ASSERT_GT(read_bytes, 0);
+    fields.insert(fields.end(), block, block + num_tokens);
+    ptr += read_bytes;
+  }
+  EXPECT_EQ(encoded.data() + encoded.size(),
+            reinterpret_cast<const char *>(ptr));
+  ASSERT_EQ(decoded_tokens_.size(), fields.size());
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const TokenInfo &expected = decoded_tokens_[i];
+    EXPECT_EQ(expected.pos_type, fields[i].pos_type);
+    EXPECT_EQ(expected.value_type, fields[i].value_type);
+    EXPECT_EQ(expected.token->cost, fields[i].cost);
+    EXPECT_EQ(expected.token->attributes == Token::SPELLING_CORRECTION,
+              fields[i].is_spelling_correction);
+    EXPECT_EQ(expected.id_in_value_trie, fields[i].id_in_value_trie);
+    EXPECT_EQ(expected.id_in_frequent_pos_map,
+              fields[i].id_in_frequent_pos_map);
+    if (expected.pos_type == TokenInfo::DEFAULT_POS) {
+      EXPECT_EQ(expected.token->lid, fields[i].lid);
+      EXPECT_EQ(expected.token->rid, fields[i].rid);
+    }
+  }
+}
+
 TEST_F(SystemDictionaryCodecTest, ReadTokenRandomTest) {
   SystemDictionaryCodecInterface *codec =
       SystemDictionaryCodecFactory::GetCodec();
@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_SYSTEM_KEY_EXPANSION_TABLE_H_
 #define MOZC_DICTIONARY_SYSTEM_KEY_EXPANSION_TABLE_H_
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
@@ -43,15 +44,26 @@ namespace dictionary {
 // Note that this class is very small so it's ok to be copied.
 class ExpandedKey {
  public:
-  explicit ExpandedKey(const uint32 *data) : data_(data) {
+  ExpandedKey(const uint32 *data, bool is_identity, uint8 max_value)
+      : data_(data), is_identity_(is_identity), max_value_(max_value) {
   }
 
   bool IsHit(char value) const {
     return (data_[value / 32] >> (value % 32)) & 1;
   }
 
+  // Returns true if the key is expanded only to itself, in which case the
+  // caller can move to the child by the key without scanning the siblings.
+  bool IsIdentity() const { return is_identity_; }
+
+  // Returns the largest hit value.  As the edges of a trie node are sorted,
+  // edges after this value can be skipped.
+  uint8 max_value() const { return max_value_; }
+
  private:
   const uint32 *data_;
+  bool is_identity_;
+  uint8 max_value_;
 };
 
 // Table to keep the key expanding information.
@@ -69,18 +81,27 @@ class KeyExpansionTable {
     memset(table_, 0, sizeof(table_));
     for (size_t i = 0; i < 256; ++i) {
       SetBit(i, i);
+      is_identity_[i] = true;
+      max_value_[i] = i;
     }
   }
 
   // Add expanding data of the given key.
   void Add(char key, const string &data) {
+    const uint8 k = static_cast<uint8>(key);
     for (size_t i = 0; i < data.length(); ++i) {
+      const uint8 value = static_cast<uint8>(data[i]);
       SetBit(key, data[i]);
+      if (value != k) {
+        is_identity_[k] = false;
+      }
+      max_value_[k] = max(max_value_[k], value);
     }
   }
 
   const ExpandedKey ExpandKey(char key) const {
-    return ExpandedKey(table_[key]);
+    const uint8 k = static_cast<uint8>(key);
+    return ExpandedKey(table_[k], is_identity_[k], max_value_[k]);
   }
 
   // Returns the default (no-effective) KeyExpansionTable instance.
@@ -99,6 +120,10 @@ class KeyExpansionTable {
   // 256x256 (key -> value) bit map matrix.
   uint32 table_[256][256 / 32];
 
+  // Summary of each row of |table_|.
+  bool is_identity_[256];
+  uint8 max_value_[256];
+
   DISALLOW_COPY_AND_ASSIGN(KeyExpansionTable);
 };
 
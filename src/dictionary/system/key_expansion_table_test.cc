@@ -58,6 +58,21 @@ TEST(KeyExpansionTableTest, Test) {
   EXPECT_FALSE(table.ExpandKey('d').IsHit('b'));
   EXPECT_FALSE(table.ExpandKey('d').IsHit('c'));
   EXPECT_TRUE(table.ExpandKey('d').IsHit('d'));
+
+  EXPECT_TRUE(table.ExpandKey('a').IsIdentity());
+  EXPECT_EQ('a', table.ExpandKey('a').max_value());
+  EXPECT_FALSE(table.ExpandKey('b').IsIdentity());
+  EXPECT_EQ('d', table.ExpandKey('b').max_value());
+
+  // Adding the key itself keeps it identity.
+  table.Add('c', "c");
+  EXPECT_TRUE(table.ExpandKey('c').IsIdentity());
+  EXPECT_EQ('c', table.ExpandKey('c').max_value());
+
+  // The values are compared as unsigned bytes.
+  table.Add('e', "\xE3");
+  EXPECT_FALSE(table.ExpandKey('e').IsIdentity());
+  EXPECT_EQ(0xE3, table.ExpandKey('e').max_value());
 }
 
 }  // namespace
@@ -43,6 +43,9 @@
 //       Frequenty appearing POSs are stored as POS ids in token info for
 //       reducing binary size. This table is the map from the id to the
 //       actual ids.
+//  (5) Existence filter (optional)
+//       Bloom filter of the keys and the values.  HasKey() and HasValue()
+//       return false without searching the tries if it rejects a string.
 
 #include "dictionary/system/system_dictionary.h"
 
@@ -56,6 +59,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/access_profiler.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
@@ -67,6 +71,7 @@
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/token_decode_iterator.h"
 #include "dictionary/system/words_info.h"
+#include "storage/existence_filter.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
 
@@ -88,6 +93,9 @@ const size_t kKeyTrieLb1CacheSize = 1 * 1024;
 const size_t kKeyTrieSelect0CacheSize = 4 * 1024;
 const size_t kKeyTrieSelect1CacheSize = 4 * 1024;
 const size_t kKeyTrieTermvecCacheSize = 1 * 1024;
+// Almost every lookup walks the first two bytes of an encoded key from the
+// root, so map them directly to the nodes.
+const int kKeyTrieFanOutDepth = 2;
 
 const size_t kValueTrieLb0CacheSize = 1 * 1024;
 const size_t kValueTrieLb1CacheSize = 1 * 1024;
@@ -172,12 +180,24 @@ void BuildHiraganaExpansionTable(
   }
 }
 
+// The name of the system dictionary in the data set and the access profile.
+const char kAccessProfileName[] = "dict";
+
 inline const uint8 *GetTokenArrayPtr(const BitVectorBasedArray &token_array,
                                      int key_id) {
+  AccessProfiler::Record(kAccessProfileName, key_id);
   size_t length = 0;
   return reinterpret_cast<const uint8*>(token_array.Get(key_id, &length));
 }
 
+// Returns the beginning of the token array without recording an access, for
+// the reverse lookup which scans the tokens from there.
+inline const uint8 *GetTokenArrayBeginPtr(
+    const BitVectorBasedArray &token_array) {
+  size_t length = 0;
+  return reinterpret_cast<const uint8*>(token_array.Get(0, &length));
+}
+
 // Iterator for scanning token array.
 // This iterator does not return actual token info but returns
 // id data and the position only.
@@ -213,7 +233,7 @@ class TokenScanIterator {
         offset_(0),
         tokens_offset_(0),
         index_(0) {
-    encoded_tokens_ptr_ = GetTokenArrayPtr(token_array, 0);
+    encoded_tokens_ptr_ = GetTokenArrayBeginPtr(token_array);
     NextInternal();
   }
 
@@ -282,6 +302,10 @@ struct ReverseLookupResult {
   int id_in_key_trie;
 };
 
+// ReverseLookupResult is read from the reverse lookup index section as is.
+static_assert(sizeof(ReverseLookupResult) == 2 * sizeof(uint32),
+              "ReverseLookupResult must consist of two 32-bit integers");
+
 }  // namespace
 
 class SystemDictionary::ReverseLookupCache {
@@ -292,107 +316,152 @@ class SystemDictionary::ReverseLookupCache {
     for (std::set<int>::const_iterator itr = id_set.begin();
          itr != id_set.end();
          ++itr) {
-      if (results.find(*itr) == results.end()) {
+      if (scanned_ids.find(*itr) == scanned_ids.end()) {
         return false;
       }
     }
     return true;
   }
 
+  // Returns the bytes of |results|, assuming a tree node of three pointers
+  // and a color for each result.
+  size_t GetAllocatedBytes() const {
+    return results.size() *
+           (sizeof(std::multimap<int, ReverseLookupResult>::value_type) +
+            4 * sizeof(void *));
+  }
+
   std::multimap<int, ReverseLookupResult> results;
+  // The IDs whose tokens are in |results|, including the ones which have no
+  // token.
+  std::set<int> scanned_ids;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ReverseLookupCache);
 };
 
+// Maps the id in value trie to the reverse lookup results.  The index is
+// either read from the reverse lookup index section of the dictionary file or
+// built in heap from the token array.  In both cases the data is laid out as
+// described in SystemDictionaryBuilder::BuildReverseLookupIndex().
 class SystemDictionary::ReverseLookupIndex {
  public:
+  // Builds the index in heap by scanning |token_array|.
   ReverseLookupIndex(
       const SystemDictionaryCodecInterface *codec,
       const BitVectorBasedArray &token_array) {
-    // Gets id size.
-    int value_id_max = -1;
+    // Gets id size and result size for each ids.
+    std::vector<uint32> counts;
+    size_t num_results = 0;
     for (TokenScanIterator iter(codec, token_array);
          !iter.Done(); iter.Next()) {
       const TokenScanIterator::Result &result = iter.Get();
-      value_id_max = max(value_id_max, result.value_id);
-    }
-
-    CHECK_GE(value_id_max, 0);
-    index_size_ = value_id_max + 1;
-    index_.reset(new ReverseLookupResultArray[index_size_]);
-
-    // Gets result size for each ids.
-    for (TokenScanIterator iter(codec, token_array);
-         !iter.Done(); iter.Next()) {
-      const TokenScanIterator::Result &result = iter.Get();
-      if (result.value_id != -1) {
-        DCHECK_LT(result.value_id, index_size_);
-        ++(index_[result.value_id].size);
+      if (result.value_id == -1) {
+        continue;
+      }
+      if (static_cast<size_t>(result.value_id) >= counts.size()) {
+        counts.resize(result.value_id + 1, 0);
       }
+      ++counts[result.value_id];
+      ++num_results;
     }
-
-    for (size_t i = 0; i < index_size_; ++i) {
-      index_[i].results.reset(new ReverseLookupResult[index_[i].size]);
+    CHECK(!counts.empty());
+
+    const size_t index_size = counts.size();
+    buffer_.resize(index_size + 2 + num_results * 2);
+    buffer_[0] = index_size;
+    uint32 *offsets = buffer_.data() + 1;
+    offsets[0] = 0;
+    for (size_t i = 0; i < index_size; ++i) {
+      offsets[i + 1] = offsets[i] + counts[i];
     }
 
-    // Builds index.
+    // Builds index.  |counts| is reused as the number of the results filled
+    // so far.
+    ReverseLookupResult *results = reinterpret_cast<ReverseLookupResult *>(
+        buffer_.data() + index_size + 2);
+    std::fill(counts.begin(), counts.end(), 0);
     for (TokenScanIterator iter(codec, token_array);
          !iter.Done(); iter.Next()) {
       const TokenScanIterator::Result &result = iter.Get();
       if (result.value_id == -1) {
         continue;
       }
-
-      DCHECK_LT(result.value_id, index_size_);
-      ReverseLookupResultArray *result_array = &index_[result.value_id];
-
-      // Finds uninitialized result.
-      size_t result_index = 0;
-      for (result_index = 0;
-           result_index < result_array->size;
-           ++result_index) {
-        const ReverseLookupResult &lookup_result =
-            result_array->results[result_index];
-        if (lookup_result.tokens_offset == -1 &&
-            lookup_result.id_in_key_trie == -1) {
-          result_array->results[result_index].tokens_offset =
-              result.tokens_offset;
-          result_array->results[result_index].id_in_key_trie = result.index;
-          break;
-        }
-      }
+      ReverseLookupResult *lookup_result =
+          &results[offsets[result.value_id] + counts[result.value_id]++];
+      lookup_result->tokens_offset = result.tokens_offset;
+      lookup_result->id_in_key_trie = result.index;
     }
 
-    CHECK(index_ != nullptr);
+    Init(buffer_.data());
+  }
+
+  // Uses the index image of the dictionary file.  The image must be validated
+  // by IsValidImage().
+  explicit ReverseLookupIndex(const uint32 *image) {
+    Init(image);
   }
 
   ~ReverseLookupIndex() {}
 
+  static bool IsValidImage(const char *image, int len) {
+    const size_t size = len;
+    if (image == nullptr || len < 0 || size < 2 * sizeof(uint32) ||
+        size % sizeof(uint32) != 0) {
+      return false;
+    }
+    const uint32 *ptr = reinterpret_cast<const uint32 *>(image);
+    const size_t index_size = ptr[0];
+    if (size < (index_size + 2) * sizeof(uint32)) {
+      return false;
+    }
+    const size_t num_results = ptr[index_size + 1];
+    return size == (index_size + 2) * sizeof(uint32) +
+                   num_results * sizeof(ReverseLookupResult);
+  }
+
+  MemoryStats::Usage GetMemoryUsage(StringPiece component) const {
+    const size_t num_results = offsets_[index_size_];
+    if (!buffer_.empty()) {
+      return MemoryStats::HeapUsage(
+          component, buffer_.capacity() * sizeof(uint32), num_results);
+    }
+    MemoryStats::Usage usage = MemoryStats::MappedUsage(
+        component, offsets_ - 1,
+        (index_size_ + 2) * sizeof(uint32) +
+        num_results * sizeof(ReverseLookupResult));
+    usage.count = num_results;
+    return usage;
+  }
+
   void FillResultMap(const std::set<int> &id_set,
                      std::multimap<int, ReverseLookupResult> *result_map) {
     for (std::set<int>::const_iterator id_itr  = id_set.begin();
          id_itr != id_set.end(); ++id_itr) {
-      const ReverseLookupResultArray &result_array = index_[*id_itr];
-      for (size_t i = 0; i < result_array.size; ++i) {
-        result_map->insert(std::make_pair(*id_itr, result_array.results[i]));
+      if (*id_itr < 0 || *id_itr >= index_size_) {
+        continue;
+      }
+      for (uint32 i = offsets_[*id_itr]; i < offsets_[*id_itr + 1]; ++i) {
+        result_map->insert(std::make_pair(*id_itr, results_[i]));
       }
     }
   }
 
  private:
-  struct ReverseLookupResultArray {
-    ReverseLookupResultArray() : size(0) {}
-    // Use std::unique_ptr for reducing memory consumption as possible.
-    // Using vector requires 90 MB even when we call resize explicitly.
-    // On the other hand, std::unique_ptr requires 57 MB.
-    std::unique_ptr<ReverseLookupResult[]> results;
-    size_t size;
-  };
+  void Init(const uint32 *image) {
+    index_size_ = image[0];
+    offsets_ = image + 1;
+    results_ = reinterpret_cast<const ReverseLookupResult *>(
+        image + index_size_ + 2);
+  }
 
-  // Use scoped array for reducing memory consumption as possible.
-  std::unique_ptr<ReverseLookupResultArray[]> index_;
-  size_t index_size_;
+  // Owns the index when it's built in heap.  A flat array is used for
+  // reducing memory consumption as possible; allocating an array for each id
+  // requires much more memory.
+  std::vector<uint32> buffer_;
+  int index_size_;
+  const uint32 *offsets_;
+  const ReverseLookupResult *results_;
 
   DISALLOW_COPY_AND_ASSIGN(ReverseLookupIndex);
 };
@@ -482,6 +551,8 @@ SystemDictionary *SystemDictionary::Builder::Build() {
       // Note that we don't munlock the space because it's always better to keep
       // the singleton system dictionary paged in as long as the process runs.
       Mmap::MaybeMLock(spec_->ptr, spec_->len);
+      // Where mlock isn't available, only the touched pages are read.
+      Mmap::MaybeAdvise(spec_->ptr, spec_->len, Mmap::RANDOM_ACCESS);
       if (!instance->dictionary_file_->OpenFromImage(spec_->ptr, spec_->len)) {
         LOG(ERROR) << "Failed to open system dictionary image";
         return nullptr;
@@ -506,7 +577,10 @@ SystemDictionary::SystemDictionary(
     const DictionaryFileCodecInterface *file_codec)
     : frequent_pos_(nullptr),
       codec_(codec),
-      dictionary_file_(new DictionaryFile(file_codec)) {}
+      dictionary_file_(new DictionaryFile(file_codec)),
+      reverse_lookup_cache_depth_(0),
+      num_existence_filter_queries_(0),
+      num_existence_filter_rejections_(0) {}
 
 SystemDictionary::~SystemDictionary() {}
 
@@ -520,7 +594,8 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
                       kKeyTrieLb1CacheSize,
                       kKeyTrieSelect0CacheSize,
                       kKeyTrieSelect1CacheSize,
-                      kKeyTrieTermvecCacheSize)) {
+                      kKeyTrieTermvecCacheSize,
+                      kKeyTrieFanOutDepth)) {
     LOG(ERROR) << "cannot open key trie";
     return false;
   }
@@ -550,10 +625,32 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
     return false;
   }
 
-  if (enable_reverse_lookup_index) {
+  // The reverse lookup index in the dictionary file is mmapped and costs
+  // nothing to open, so it's used regardless of |enable_reverse_lookup_index|.
+  const char *reverse_lookup_index_image = dictionary_file_->GetSection(
+      codec_->GetSectionNameForReverseLookupIndex(), &len);
+  if (reverse_lookup_index_image != nullptr) {
+    if (!ReverseLookupIndex::IsValidImage(reverse_lookup_index_image, len)) {
+      LOG(ERROR) << "broken reverse lookup index section";
+      return false;
+    }
+    reverse_lookup_index_.reset(new ReverseLookupIndex(
+        reinterpret_cast<const uint32 *>(reverse_lookup_index_image)));
+  } else if (enable_reverse_lookup_index) {
     InitReverseLookupIndex();
   }
 
+  const char *existence_filter_image = dictionary_file_->GetSection(
+      codec_->GetSectionNameForExistenceFilter(), &len);
+  if (existence_filter_image != nullptr) {
+    existence_filter_.reset(
+        storage::ExistenceFilter::Read(existence_filter_image, len));
+    if (existence_filter_ == nullptr) {
+      LOG(ERROR) << "broken existence filter section";
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -564,13 +661,42 @@ void SystemDictionary::InitReverseLookupIndex() {
   reverse_lookup_index_.reset(new ReverseLookupIndex(codec_, token_array_));
 }
 
+bool SystemDictionary::GetExistenceFilterStats(
+    uint64 *num_queries, uint64 *num_rejections) const {
+  if (existence_filter_ == nullptr) {
+    return false;
+  }
+  *num_queries = num_existence_filter_queries_.load(std::memory_order_relaxed);
+  *num_rejections =
+      num_existence_filter_rejections_.load(std::memory_order_relaxed);
+  return true;
+}
+
+bool SystemDictionary::MayExistInFilter(uint64 fingerprint) const {
+  if (existence_filter_ == nullptr) {
+    return true;
+  }
+  num_existence_filter_queries_.fetch_add(1, std::memory_order_relaxed);
+  if (existence_filter_->Exists(fingerprint)) {
+    return true;
+  }
+  num_existence_filter_rejections_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
 bool SystemDictionary::HasKey(StringPiece key) const {
+  if (!MayExistInFilter(codec_->GetKeyFingerprint(key))) {
+    return false;
+  }
   string encoded_key;
   codec_->EncodeKey(key, &encoded_key);
   return key_trie_.HasKey(encoded_key);
 }
 
 bool SystemDictionary::HasValue(StringPiece value) const {
+  if (!MayExistInFilter(codec_->GetValueFingerprint(value))) {
+    return false;
+  }
   string encoded_value;
   codec_->EncodeValue(value, &encoded_value);
   if (value_trie_.HasKey(encoded_value)) {
@@ -613,19 +739,104 @@ bool SystemDictionary::HasValue(StringPiece value) const {
   for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
                                 encoded_tokens_ptr);
        !iter.Done(); iter.Next()) {
-    const Token *token = iter.Get().token;
-    if (value == token->value) {
+    if (value == iter.GetView().value) {
       return true;
     }
   }
   return false;
 }
 
-void SystemDictionary::CollectPredictiveNodesInBfsOrder(
+DictionaryInterface::Callback::ResultType
+SystemDictionary::RunCallbackOnPredictiveKey(
+    StringPiece key,
     StringPiece encoded_key,
-    const KeyExpansionTable &table,
-    size_t limit,
-    std::vector<PredictiveLookupSearchState> *result) const {
+    const PredictiveLookupSearchState &state,
+    Callback *callback,
+    string *decoded_key,
+    string *actual_key_str) const {
+  // Computes the actual key.  For example:
+  // key = "くー"
+  // encoded_actual_key = encode("ぐーぐる")  [expanded]
+  // encoded_actual_key_prediction_suffix = encode("ぐる")
+  char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
+  const StringPiece encoded_actual_key =
+      key_trie_.RestoreKeyString(state.node, encoded_actual_key_buffer);
+  const StringPiece encoded_actual_key_prediction_suffix =
+      encoded_actual_key.substr(
+          encoded_key.size(), encoded_actual_key.size() - encoded_key.size());
+
+  // decoded_key = "くーぐる" (= key + prediction suffix)
+  decoded_key->clear();
+  key.CopyToString(decoded_key);
+  codec_->DecodeKey(encoded_actual_key_prediction_suffix, decoded_key);
+  Callback::ResultType result = callback->OnKey(*decoded_key);
+  if (result != Callback::TRAVERSE_CONTINUE) {
+    return result;
+  }
+
+  StringPiece actual_key;
+  if (state.is_expanded) {
+    actual_key_str->clear();
+    codec_->DecodeKey(encoded_actual_key, actual_key_str);
+    actual_key = *actual_key_str;
+  } else {
+    actual_key = *decoded_key;
+  }
+  result = callback->OnActualKey(*decoded_key, actual_key, state.is_expanded);
+  if (result != Callback::TRAVERSE_CONTINUE) {
+    return result;
+  }
+
+  const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
+  for (TokenDecodeIterator iter(codec_, value_trie_,
+                                frequent_pos_, actual_key,
+                                GetTokenArrayPtr(token_array_, key_id));
+       !iter.Done(); iter.Next()) {
+    result = callback->OnTokenView(*decoded_key, actual_key, iter.GetView());
+    if (result == Callback::TRAVERSE_DONE) {
+      return result;
+    }
+    if (result == Callback::TRAVERSE_NEXT_KEY) {
+      break;
+    }
+    DCHECK_NE(Callback::TRAVERSE_CULL, result) << "Not implemented";
+  }
+  return Callback::TRAVERSE_CONTINUE;
+}
+
+void SystemDictionary::LookupPredictive(
+    StringPiece key,
+    const ConversionRequest &conversion_request,
+    Callback *callback) const {
+  // Do nothing for empty key, although looking up all the entries with empty
+  // string seems natural.
+  if (key.empty()) {
+    return;
+  }
+
+  string encoded_key;
+  codec_->EncodeKey(key, &encoded_key);
+  if (encoded_key.size() > LoudsTrie::kMaxDepth) {
+    return;
+  }
+
+  const KeyExpansionTable &table =
+      conversion_request.IsKanaModifierInsensitiveConversion() ?
+      hiragana_expansion_table_ : KeyExpansionTable::GetDefaultInstance();
+
+  // The keys are passed to |callback| in BFS order as soon as they are found,
+  // so the traversal ends as soon as |callback| returns TRAVERSE_DONE.  After
+  // the number of the keys exceeds the limit given by |callback|, only the
+  // remaining keys of the same length as the last one are visited.
+  const size_t key_limit = callback->GetPredictiveLookupKeyLimit();
+  size_t num_keys = 0;
+  size_t max_key_len = std::numeric_limits<size_t>::max();
+
+  // Reused buffers inside the following loop.
+  string decoded_key, actual_key_str;
+  decoded_key.reserve(key.size() * 2);
+  actual_key_str.reserve(key.size() * 2);
+
   std::queue<PredictiveLookupSearchState> queue;
   queue.push(PredictiveLookupSearchState(LoudsTrie::Node(), 0, false));
   do {
@@ -636,11 +847,24 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
     if (state.key_pos < encoded_key.size()) {
       const char target_char = encoded_key[state.key_pos];
       const ExpandedKey &chars = table.ExpandKey(target_char);
+      if (chars.IsIdentity()) {
+        if (key_trie_.MoveToChildByLabel(target_char, &state.node)) {
+          queue.push(PredictiveLookupSearchState(state.node,
+                                                 state.key_pos + 1,
+                                                 state.is_expanded));
+        }
+        continue;
+      }
 
+      // The edges are sorted by label, so all the expanded children are
+      // visited in one scan up to the largest expanded label.
       for (key_trie_.MoveToFirstChild(&state.node);
            key_trie_.IsValidNode(state.node);
            key_trie_.MoveToNextSibling(&state.node)) {
         const char c = key_trie_.GetEdgeLabelToParentNode(state.node);
+        if (static_cast<uint8>(c) > chars.max_value()) {
+          break;
+        }
         if (!chars.IsHit(c)) {
           continue;
         }
@@ -652,30 +876,34 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
       continue;
     }
 
-    // Collect prediction keys (state.key_pos >= encoded_key.size()).
-    if (key_trie_.IsTerminalNode(state.node)) {
-      result->push_back(state);
+    // Key length in the queue is monotonically increasing because of BFS
+    // property.  So we don't need to check all the elements in the queue.
+    if (state.key_pos > max_key_len) {
+      break;
     }
 
-    // Collected enough entries.  Collect all the remaining keys that have the
-    // same length as the longest key.
-    if (result->size() > limit) {
-      // The current key is the longest because of BFS property.
-      const size_t max_key_len = state.key_pos;
-      while (!queue.empty()) {
-        state = queue.front();
-        queue.pop();
-        if (state.key_pos > max_key_len) {
-          // Key length in the queue is monotonically increasing because of BFS
-          // property.  So we don't need to check all the elements in the queue.
+    // Report prediction keys (state.key_pos >= encoded_key.size()).
+    bool cull = false;
+    if (key_trie_.IsTerminalNode(state.node)) {
+      switch (RunCallbackOnPredictiveKey(key, encoded_key, state, callback,
+                                         &decoded_key, &actual_key_str)) {
+        case Callback::TRAVERSE_DONE:
+          return;
+        case Callback::TRAVERSE_CULL:
+          cull = true;
+          break;
+        default:
           break;
-        }
-        DCHECK_EQ(state.key_pos, max_key_len);
-        if (key_trie_.IsTerminalNode(state.node)) {
-          result->push_back(state);
-        }
       }
-      break;
+      // Reported enough keys.  The current key is the longest because of BFS
+      // property, so stop descending and report the remaining keys of the
+      // same length.
+      if (++num_keys > key_limit && max_key_len > state.key_pos) {
+        max_key_len = state.key_pos;
+      }
+    }
+    if (cull || state.key_pos >= max_key_len) {
+      continue;
     }
 
     // Update traversal state for children.
@@ -689,108 +917,6 @@ void SystemDictionary::CollectPredictiveNodesInBfsOrder(
   } while (!queue.empty());
 }
 
-void SystemDictionary::LookupPredictive(
-    StringPiece key,
-    const ConversionRequest &conversion_request,
-    Callback *callback) const {
-  // Do nothing for empty key, although looking up all the entries with empty
-  // string seems natural.
-  if (key.empty()) {
-    return;
-  }
-
-  string encoded_key;
-  codec_->EncodeKey(key, &encoded_key);
-  if (encoded_key.size() > LoudsTrie::kMaxDepth) {
-    return;
-  }
-
-  const KeyExpansionTable &table =
-      conversion_request.IsKanaModifierInsensitiveConversion() ?
-      hiragana_expansion_table_ : KeyExpansionTable::GetDefaultInstance();
-
-  // TODO(noriyukit): Lookup limit should be implemented at caller side by using
-  // callback mechanism.  This hard-coding limits the capability and generality
-  // of dictionary module.  CollectPredictiveNodesInBfsOrder() and the following
-  // loop for callback should be integrated for this purpose.
-  const size_t kLookupLimit = 64;
-  std::vector<PredictiveLookupSearchState> result;
-  result.reserve(kLookupLimit);
-  CollectPredictiveNodesInBfsOrder(encoded_key, table, kLookupLimit, &result);
-
-  // Reused buffer and instances inside the following loop.
-  char encoded_actual_key_buffer[LoudsTrie::kMaxDepth + 1];
-  string decoded_key, actual_key_str;
-  decoded_key.reserve(key.size() * 2);
-  actual_key_str.reserve(key.size() * 2);
-  for (size_t i = 0; i < result.size(); ++i) {
-    const PredictiveLookupSearchState &state = result[i];
-
-    // Computes the actual key.  For example:
-    // key = "くー"
-    // encoded_actual_key = encode("ぐーぐる")  [expanded]
-    // encoded_actual_key_prediction_suffix = encode("ぐる")
-    const StringPiece encoded_actual_key =
-        key_trie_.RestoreKeyString(state.node, encoded_actual_key_buffer);
-    const StringPiece encoded_actual_key_prediction_suffix =
-        encoded_actual_key.substr(
-            encoded_key.size(), encoded_actual_key.size() - encoded_key.size());
-
-    // decoded_key = "くーぐる" (= key + prediction suffix)
-    decoded_key.clear();
-    key.CopyToString(&decoded_key);
-    codec_->DecodeKey(encoded_actual_key_prediction_suffix, &decoded_key);
-    switch (callback->OnKey(decoded_key)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_NEXT_KEY:
-        continue;
-      case DictionaryInterface::Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "Culling is not implemented.";
-        continue;
-      default:
-        break;
-    }
-
-    StringPiece actual_key;
-    if (state.is_expanded) {
-      actual_key_str.clear();
-      codec_->DecodeKey(encoded_actual_key, &actual_key_str);
-      actual_key = actual_key_str;
-    } else {
-      actual_key = decoded_key;
-    }
-    switch (callback->OnActualKey(decoded_key, actual_key, state.is_expanded)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_NEXT_KEY:
-        continue;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "Culling is not implemented.";
-        continue;
-      default:
-        break;
-    }
-
-    const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
-    for (TokenDecodeIterator iter(codec_, value_trie_,
-                                  frequent_pos_, actual_key,
-                                  GetTokenArrayPtr(token_array_, key_id));
-         !iter.Done(); iter.Next()) {
-      const TokenInfo &token_info = iter.Get();
-      const Callback::ResultType result =
-          callback->OnToken(decoded_key, actual_key, *token_info.token);
-      if (result == Callback::TRAVERSE_DONE) {
-        return;
-      }
-      if (result == Callback::TRAVERSE_NEXT_KEY) {
-        break;
-      }
-      DCHECK_NE(Callback::TRAVERSE_CULL, result) << "Not implemented";
-    }
-  }
-}
-
 namespace {
 
 // An implementation of prefix search without key expansion.  Runs |callback|
@@ -805,8 +931,9 @@ namespace {
 //   callback:
 //     A callback function to be called.
 //   token_filter:
-//     A functor of signature bool(const TokenInfo &).  Only tokens for which
-//     this functor returns true are passed to callback function.
+//     A functor of signature bool(const TokenInfo &, const TokenView &).
+//     Only tokens for which this functor returns true are passed to callback
+//     function.
 template <typename Func>
 void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
                              const LoudsTrie &value_trie,
@@ -854,12 +981,11 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
     for (TokenDecodeIterator iter(codec, value_trie, frequent_pos, prefix,
                                   GetTokenArrayPtr(token_array, key_id));
          !iter.Done(); iter.Next()) {
-      const TokenInfo &token_info = iter.Get();
-      if (!token_filter(token_info)) {
+      if (!token_filter(iter.GetInfo(), iter.GetView())) {
         continue;
       }
       const Callback::ResultType res =
-          callback->OnToken(prefix, prefix, *token_info.token);
+          callback->OnTokenView(prefix, prefix, iter.GetView());
       if (res == Callback::TRAVERSE_DONE || res == Callback::TRAVERSE_CULL) {
         return;
       }
@@ -871,7 +997,9 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
 }
 
 struct SelectAllTokens {
-  bool operator()(const TokenInfo &token_info) const { return true; }
+  bool operator()(const TokenInfo &token_info, const TokenView &token) const {
+    return true;
+  }
 };
 
 class ReverseLookupCallbackWrapper : public DictionaryInterface::Callback {
@@ -885,6 +1013,12 @@ class ReverseLookupCallbackWrapper : public DictionaryInterface::Callback {
     modified_token.key.swap(modified_token.value);
     return callback_->OnToken(key, actual_key, modified_token);
   }
+  virtual SystemDictionary::Callback::ResultType OnTokenView(
+      StringPiece key, StringPiece actual_key, const TokenView &token) {
+    TokenView modified_token = token;
+    std::swap(modified_token.key, modified_token.value);
+    return callback_->OnTokenView(key, actual_key, modified_token);
+  }
 
   DictionaryInterface::Callback *callback_;
 };
@@ -962,8 +1096,7 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
                                   *actual_prefix,
                                   GetTokenArrayPtr(token_array_, key_id));
          !iter.Done(); iter.Next()) {
-      const TokenInfo &token_info = iter.Get();
-      result = callback->OnToken(prefix, *actual_prefix, *token_info.token);
+      result = callback->OnTokenView(prefix, *actual_prefix, iter.GetView());
       if (result == Callback::TRAVERSE_DONE ||
           result == Callback::TRAVERSE_CULL) {
         return result;
@@ -980,9 +1113,28 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
   }
   const char current_char = encoded_key[key_pos];
   const ExpandedKey &chars = table.ExpandKey(current_char);
+  if (chars.IsIdentity()) {
+    // Most characters have no expansion.  Move to the child directly, which
+    // uses the fan-out table of the trie if available.
+    if (!key_trie_.MoveToChildByLabel(current_char, &node)) {
+      return Callback::TRAVERSE_CONTINUE;
+    }
+    actual_key_buffer[key_pos] = current_char;
+    const Callback::ResultType result = LookupPrefixWithKeyExpansionImpl(
+        key, encoded_key, table, callback, node, key_pos + 1, is_expanded,
+        actual_key_buffer, actual_prefix);
+    return result == Callback::TRAVERSE_DONE ? Callback::TRAVERSE_DONE
+                                             : Callback::TRAVERSE_CONTINUE;
+  }
+
+  // The edges are sorted by label, so all the expanded children are visited
+  // in one scan up to the largest expanded label.
   for (key_trie_.MoveToFirstChild(&node); key_trie_.IsValidNode(node);
        key_trie_.MoveToNextSibling(&node)) {
     const char c = key_trie_.GetEdgeLabelToParentNode(node);
+    if (static_cast<uint8>(c) > chars.max_value()) {
+      break;
+    }
     if (!chars.IsHit(c)) {
       continue;
     }
@@ -1022,6 +1174,55 @@ void SystemDictionary::LookupPrefix(
                                    actual_key_buffer, &actual_prefix);
 }
 
+void SystemDictionary::LookupPrefixBatch(
+    StringPiece key,
+    const ConversionRequest &conversion_request,
+    const std::vector<Callback *> &callbacks) const {
+  DCHECK_LE(callbacks.size(), key.size());
+  // The codec encodes each character independently, so the encoded suffix
+  // of the whole key is the encoded key of the suffix.
+  string encoded_key;
+  codec_->EncodeKey(key, &encoded_key);
+
+  const bool use_key_expansion =
+      conversion_request.IsKanaModifierInsensitiveConversion();
+  char actual_key_buffer[LoudsTrie::kMaxDepth + 1];
+  string actual_prefix;
+  if (use_key_expansion) {
+    actual_prefix.reserve(key.size() * 3);
+  }
+
+  size_t encoded_pos = 0;
+  for (size_t pos = 0; pos < callbacks.size(); ) {
+    const size_t char_len =
+        min(Util::OneCharLen(key.data() + pos), key.size() - pos);
+    if (callbacks[pos] != NULL) {
+      const StringPiece encoded_suffix =
+          StringPiece(encoded_key).substr(encoded_pos);
+      if (use_key_expansion) {
+        LookupPrefixWithKeyExpansionImpl(key.data() + pos, encoded_suffix,
+                                         hiragana_expansion_table_,
+                                         callbacks[pos], LoudsTrie::Node(), 0,
+                                         false, actual_key_buffer,
+                                         &actual_prefix);
+      } else {
+        RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
+                                frequent_pos_, key.data() + pos,
+                                encoded_suffix, callbacks[pos],
+                                SelectAllTokens());
+      }
+    }
+    // Lookups from the middle of a character have no shared encoding.
+    for (size_t i = pos + 1; i < pos + char_len && i < callbacks.size(); ++i) {
+      if (callbacks[i] != NULL) {
+        LookupPrefix(key.substr(i), conversion_request, callbacks[i]);
+      }
+    }
+    encoded_pos += codec_->GetEncodedKeyLength(key.substr(pos, char_len));
+    pos += char_len;
+  }
+}
+
 void SystemDictionary::LookupExact(
     StringPiece key,
     const ConversionRequest &conversion_request,
@@ -1041,7 +1242,7 @@ void SystemDictionary::LookupExact(
   for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
                                 GetTokenArrayPtr(token_array_, key_id));
        !iter.Done(); iter.Next()) {
-    if (callback->OnToken(key, key, *iter.Get().token) !=
+    if (callback->OnTokenView(key, key, iter.GetView()) !=
         Callback::TRAVERSE_CONTINUE) {
       break;
     }
@@ -1087,7 +1288,10 @@ void SystemDictionary::PopulateReverseLookupCache(StringPiece str) const {
     // as we have already built the index for reverse lookup.
     return;
   }
-  reverse_lookup_cache_.reset(new ReverseLookupCache);
+  ++reverse_lookup_cache_depth_;
+  if (reverse_lookup_cache_ == nullptr) {
+    reverse_lookup_cache_.reset(new ReverseLookupCache);
+  }
   DCHECK(reverse_lookup_cache_.get());
 
   // Iterate each suffix and collect IDs of all substrings.
@@ -1102,14 +1306,48 @@ void SystemDictionary::PopulateReverseLookupCache(StringPiece str) const {
     AddKeyIdsOfAllPrefixes(value_trie_, lookup_key, &id_set);
     pos += Util::OneCharLen(suffix.data());
   }
+
+  // A nested call, e.g., for a sentence of a batch populated at once, only
+  // scans the tokens for the IDs not in the cache yet, which are usually
+  // none.  Scanning the tokens is as slow as reading the whole token array.
+  std::set<int> &scanned_ids = reverse_lookup_cache_->scanned_ids;
+  for (std::set<int>::iterator itr = id_set.begin(); itr != id_set.end();) {
+    if (scanned_ids.find(*itr) != scanned_ids.end()) {
+      id_set.erase(itr++);
+    } else {
+      ++itr;
+    }
+  }
+  if (id_set.empty()) {
+    return;
+  }
   // Collect tokens for all IDs.
   ScanTokens(id_set, reverse_lookup_cache_.get());
+  scanned_ids.insert(id_set.begin(), id_set.end());
 }
 
 void SystemDictionary::ClearReverseLookupCache() const {
+  if (reverse_lookup_cache_depth_ > 0 && --reverse_lookup_cache_depth_ > 0) {
+    // Kept for the outer PopulateReverseLookupCache().
+    return;
+  }
   reverse_lookup_cache_.reset();
 }
 
+void SystemDictionary::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  DCHECK(usages);
+  if (reverse_lookup_index_ != nullptr) {
+    usages->push_back(
+        reverse_lookup_index_->GetMemoryUsage("reverse_lookup_index"));
+  }
+  if (reverse_lookup_cache_ != nullptr) {
+    usages->push_back(MemoryStats::HeapUsage(
+        "reverse_lookup_cache", reverse_lookup_cache_->GetAllocatedBytes(),
+        reverse_lookup_cache_->results.size()));
+  }
+}
+
 namespace {
 
 class FilterTokenForRegisterReverseLookupTokensForT13N {
@@ -1118,17 +1356,17 @@ class FilterTokenForRegisterReverseLookupTokensForT13N {
     tmp_str_.reserve(LoudsTrie::kMaxDepth * 3);
   }
 
-  bool operator()(const TokenInfo &token_info) {
+  bool operator()(const TokenInfo &token_info, const TokenView &token) {
     // Skip spelling corrections.
-    if (token_info.token->attributes & Token::SPELLING_CORRECTION) {
+    if (token.attributes & Token::SPELLING_CORRECTION) {
       return false;
     }
     if (token_info.value_type != TokenInfo::AS_IS_HIRAGANA &&
         token_info.value_type != TokenInfo::AS_IS_KATAKANA) {
       // SAME_AS_PREV_VALUE may be t13n token.
       tmp_str_.clear();
-      Util::KatakanaToHiragana(token_info.token->value, &tmp_str_);
-      if (token_info.token->key != tmp_str_) {
+      Util::KatakanaToHiragana(token.value, &tmp_str_);
+      if (token.key != tmp_str_) {
         return false;
       }
     }
@@ -1197,7 +1435,7 @@ void SystemDictionary::RegisterReverseLookupResults(
     const std::set<int> &id_set,
     const ReverseLookupCache &cache,
     Callback *callback) const {
-  const uint8 *encoded_tokens_ptr = GetTokenArrayPtr(token_array_, 0);
+  const uint8 *encoded_tokens_ptr = GetTokenArrayBeginPtr(token_array_);
   char buffer[LoudsTrie::kMaxDepth + 1];
   for (std::set<int>::const_iterator set_itr = id_set.begin();
        set_itr != id_set.end();
@@ -1221,12 +1459,12 @@ void SystemDictionary::RegisterReverseLookupResults(
                codec_, value_trie_, frequent_pos_, tokens_key,
                encoded_tokens_ptr  + reverse_result.tokens_offset);
            !iter.Done(); iter.Next()) {
-        const TokenInfo &token_info = iter.Get();
-        if (token_info.token->attributes & Token::SPELLING_CORRECTION ||
+        const TokenInfo &token_info = iter.GetInfo();
+        if (iter.GetView().attributes & Token::SPELLING_CORRECTION ||
             token_info.id_in_value_trie != value_id) {
           continue;
         }
-        callback->OnToken(tokens_key, tokens_key, *token_info.token);
+        callback->OnTokenView(tokens_key, tokens_key, iter.GetView());
       }
     }
   }
@@ -38,6 +38,7 @@
       ],
       'dependencies': [
         '../../base/base.gyp:base_core',
+        '../../base/base.gyp:hash',
       ],
     },
     {
@@ -58,6 +59,7 @@
         '../../base/base.gyp:base_core',
         '../../request/request.gyp:conversion_request',
         '../../storage/louds/louds.gyp:bit_vector_based_array',
+        '../../storage/storage.gyp:storage',
         '../../storage/louds/louds.gyp:louds_trie',
         '../dictionary_base.gyp:text_dictionary_loader',
         '../file/dictionary_file.gyp:codec_factory',
@@ -90,6 +92,7 @@
       'dependencies': [
         '../../base/base.gyp:base_core',
         '../../storage/louds/louds.gyp:bit_vector_based_array_builder',
+        '../../storage/storage.gyp:storage',
         '../../storage/louds/louds.gyp:louds_trie_builder',
         '../dictionary_base.gyp:pos_matcher',
         '../dictionary_base.gyp:text_dictionary_loader',
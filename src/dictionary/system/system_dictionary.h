@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_SYSTEM_SYSTEM_DICTIONARY_H_
 #define MOZC_DICTIONARY_SYSTEM_SYSTEM_DICTIONARY_H_
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -42,6 +43,7 @@
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/key_expansion_table.h"
 #include "dictionary/system/words_info.h"
+#include "storage/existence_filter.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
 
@@ -60,6 +62,9 @@ class SystemDictionary : public DictionaryInterface {
     // If ENABLE_REVERSE_LOOKUP_INDEX is set, we will have the index in heap
     // from the id in value trie to the id in key trie.
     // That consumes more memory but we can perform reverse lookup more quickly.
+    // If the dictionary file has the prebuilt index (see
+    // --build_reverse_lookup_index of SystemDictionaryBuilder), it's used
+    // instead regardless of this option.
     ENABLE_REVERSE_LOOKUP_INDEX = 1,
   };
 
@@ -112,6 +117,13 @@ class SystemDictionary : public DictionaryInterface {
                             const ConversionRequest &converter_request,
                             Callback *callback) const;
 
+  // Encodes |key| only once and reuses the buffers for the key expansion
+  // among the lookups.
+  virtual void LookupPrefixBatch(StringPiece key,
+                                 const ConversionRequest &converter_request,
+                                 const std::vector<Callback *> &callbacks)
+      const;
+
   virtual void LookupExact(StringPiece key,
                            const ConversionRequest &converter_request,
                            Callback *callback) const;
@@ -123,6 +135,20 @@ class SystemDictionary : public DictionaryInterface {
   virtual void PopulateReverseLookupCache(StringPiece str) const;
   virtual void ClearReverseLookupCache() const;
 
+  // Reports the reverse lookup index as "reverse_lookup_index", which is
+  // either built in heap or mapped from the dictionary file, and the cache
+  // as "reverse_lookup_cache".
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const;
+
+  // Returns true if the dictionary file has the existence filter section.
+  // In that case, the number of HasKey() and HasValue() calls checked by the
+  // filter and the number of those rejected by it without searching the
+  // tries are assigned to |num_queries| and |num_rejections|.  The hit rate
+  // of the filter is |num_rejections| / |num_queries|.
+  bool GetExistenceFilterStats(uint64 *num_queries,
+                               uint64 *num_rejections) const;
+
  private:
   class ReverseLookupCache;
   class ReverseLookupIndex;
@@ -142,6 +168,10 @@ class SystemDictionary : public DictionaryInterface {
                                     Callback *callback) const;
   void InitReverseLookupIndex();
 
+  // Returns false if |fingerprint| is surely absent from the existence
+  // filter.  Always returns true when the dictionary has no filter.
+  bool MayExistInFilter(uint64 fingerprint) const;
+
   Callback::ResultType LookupPrefixWithKeyExpansionImpl(
       const char *key,
       StringPiece encoded_key,
@@ -153,11 +183,16 @@ class SystemDictionary : public DictionaryInterface {
       char *actual_key_buffer,
       string *actual_prefix) const;
 
-  void CollectPredictiveNodesInBfsOrder(
+  // Runs |callback| for a key found by LookupPredictive() and its tokens.
+  // Returns TRAVERSE_DONE if the traversal should end, and TRAVERSE_CULL if
+  // the keys below this one should be skipped.
+  Callback::ResultType RunCallbackOnPredictiveKey(
+      StringPiece key,
       StringPiece encoded_key,
-      const KeyExpansionTable &table,
-      size_t limit,
-      std::vector<PredictiveLookupSearchState> *result) const;
+      const PredictiveLookupSearchState &state,
+      Callback *callback,
+      string *decoded_key,
+      string *actual_key_str) const;
 
   storage::louds::LoudsTrie key_trie_;
   storage::louds::LoudsTrie value_trie_;
@@ -167,7 +202,13 @@ class SystemDictionary : public DictionaryInterface {
   KeyExpansionTable hiragana_expansion_table_;
   std::unique_ptr<DictionaryFile> dictionary_file_;
   mutable std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
+  // The number of PopulateReverseLookupCache() calls not cleared yet.
+  mutable int reverse_lookup_cache_depth_;
   std::unique_ptr<ReverseLookupIndex> reverse_lookup_index_;
+  // Points to the mmapped section; null if the dictionary doesn't have one.
+  std::unique_ptr<storage::ExistenceFilter> existence_filter_;
+  mutable std::atomic<uint64> num_existence_filter_queries_;
+  mutable std::atomic<uint64> num_existence_filter_rejections_;
 
   DISALLOW_COPY_AND_ASSIGN(SystemDictionary);
 };
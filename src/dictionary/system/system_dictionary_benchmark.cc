@@ -27,3 +27,390 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// Benchmark of the lookup methods of SystemDictionary.  The keys are sampled
+// from the sentences of data/test/stress_test so that the distribution of
+// the key lengths and the characters is close to real inputs.
+//
+// Usage:
+//   system_dictionary_benchmark --sentences=data/test/stress_test/sentences.txt
+//       [--dictionary=<system dictionary file>] [--output_format=json]
+//
+// Each benchmark reports ns/op, tokens/s and the number of heap allocations
+// per op.  With --output_format=json, one JSON object is emitted per line so
+// that the results can be compared across revisions of the data set.
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/string_piece.h"
+#include "base/util.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "dictionary/dictionary_interface.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/system/system_dictionary.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+DEFINE_string(sentences, "data/test/stress_test/sentences.txt",
+              "file of the sentences in Hiragana from which keys are sampled.");
+DEFINE_string(dictionary, "",
+              "system dictionary file.  The one of the OSS data set is used "
+              "if empty.");
+DEFINE_int32(num_keys, 10000, "maximum number of keys for each benchmark.");
+DEFINE_int32(iterations, 5, "number of passes over the keys.");
+DEFINE_int32(max_prefix_key_length, 15,
+             "maximum number of characters of the keys for LookupPrefix.");
+DEFINE_int32(max_predictive_key_length, 3,
+             "maximum number of characters of the keys for LookupPredictive.");
+DEFINE_int32(max_exact_key_length, 5,
+             "maximum number of characters of the keys for LookupExact.");
+DEFINE_string(output_format, "text", "output format: (text, json)");
+
+namespace {
+
+// The number of heap allocations made so far, counted by the replaced global
+// operator new below.  The benchmark is single threaded.
+int64 g_num_allocations = 0;
+
+}  // namespace
+
+void *operator new(size_t size) {
+  ++g_num_allocations;
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+enum LookupType {
+  LOOKUP_PREFIX,
+  LOOKUP_PREFIX_WITH_KEY_EXPANSION,
+  LOOKUP_PREDICTIVE,
+  LOOKUP_EXACT,
+  LOOKUP_REVERSE,
+  HAS_KEY,
+  HAS_VALUE,
+};
+
+// Counts the tokens without copying them.
+class CountTokenCallback : public DictionaryInterface::Callback {
+ public:
+  CountTokenCallback() : num_tokens_(0) {}
+
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    ++num_tokens_;
+    return TRAVERSE_CONTINUE;
+  }
+
+  int64 num_tokens() const { return num_tokens_; }
+  void add_num_tokens(int64 n) { num_tokens_ += n; }
+
+ private:
+  int64 num_tokens_;
+};
+
+// Collects the values of the tokens, which are used as the inputs of
+// LookupReverse() and HasValue().
+class CollectValueCallback : public DictionaryInterface::Callback {
+ public:
+  explicit CollectValueCallback(std::vector<string> *values)
+      : values_(values) {}
+
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
+                     const Token &token) override {
+    values_->push_back(token.value);
+    return TRAVERSE_CONTINUE;
+  }
+
+ private:
+  std::vector<string> *values_;
+};
+
+struct BenchmarkResult {
+  const char *name;
+  int64 num_ops;
+  double elapsed_nsec;
+  int64 num_tokens;
+  int64 num_allocations;
+};
+
+// Splits the sentences into phrases at punctuation marks and returns the
+// phrases in Hiragana.
+std::vector<string> ReadPhrases(const string &filename) {
+  InputFileStream ifs(filename.c_str());
+  CHECK(ifs) << "Cannot open " << filename;
+  std::vector<string> phrases;
+  string line;
+  while (!getline(ifs, line).fail()) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    // Replaces "、" with "。" and splits the line at "。".  Note that
+    // Util::SplitStringUsing() splits a string at any byte of the delimiters.
+    string normalized;
+    Util::StringReplace(line, "\xE3\x80\x81", "\xE3\x80\x82", true,
+                        &normalized);
+    const StringPiece kDelimiter = "\xE3\x80\x82";
+    StringPiece rest = normalized;
+    while (!rest.empty()) {
+      const StringPiece::size_type pos = rest.find(kDelimiter);
+      const StringPiece phrase = rest.substr(0, pos);
+      if (!phrase.empty()) {
+        phrases.push_back(phrase.as_string());
+      }
+      if (pos == StringPiece::npos) {
+        break;
+      }
+      rest = rest.substr(pos + kDelimiter.size());
+    }
+  }
+  return phrases;
+}
+
+// Samples up to FLAGS_num_keys keys from every position of |phrases|.  Each
+// key starts at a random position and its length is in [1, max_length],
+// clipped at the end of the phrase.
+std::vector<string> SampleKeys(const std::vector<string> &phrases,
+                               int max_length) {
+  std::vector<string> keys;
+  for (size_t i = 0; keys.size() < static_cast<size_t>(FLAGS_num_keys) && i < phrases.size(); ++i) {
+    const size_t len = Util::CharsLen(phrases[i]);
+    for (size_t pos = 0; keys.size() < static_cast<size_t>(FLAGS_num_keys) && pos < len;
+         pos += 1 + Util::Random(3)) {
+      keys.push_back(Util::SubString(phrases[i], pos,
+                                     1 + Util::Random(max_length)));
+    }
+  }
+  return keys;
+}
+
+// Prefix keys are the rest of the phrase from each position, as the
+// converter looks up them when building a lattice.
+std::vector<string> SamplePrefixKeys(const std::vector<string> &phrases) {
+  std::vector<string> keys;
+  for (size_t i = 0; keys.size() < static_cast<size_t>(FLAGS_num_keys) && i < phrases.size(); ++i) {
+    const size_t len = Util::CharsLen(phrases[i]);
+    for (size_t pos = 0; keys.size() < static_cast<size_t>(FLAGS_num_keys) && pos < len; ++pos) {
+      keys.push_back(Util::SubString(phrases[i], pos,
+                                     FLAGS_max_prefix_key_length));
+    }
+  }
+  return keys;
+}
+
+void RunLookup(LookupType type, const SystemDictionary &dictionary,
+               const string &key, const ConversionRequest &request,
+               CountTokenCallback *callback) {
+  switch (type) {
+    case LOOKUP_PREFIX:
+    case LOOKUP_PREFIX_WITH_KEY_EXPANSION:
+      dictionary.LookupPrefix(key, request, callback);
+      break;
+    case LOOKUP_PREDICTIVE:
+      dictionary.LookupPredictive(key, request, callback);
+      break;
+    case LOOKUP_EXACT:
+      dictionary.LookupExact(key, request, callback);
+      break;
+    case LOOKUP_REVERSE:
+      dictionary.LookupReverse(key, request, callback);
+      break;
+    case HAS_KEY:
+      // Counts the keys found as tokens.
+      callback->add_num_tokens(dictionary.HasKey(key) ? 1 : 0);
+      break;
+    case HAS_VALUE:
+      callback->add_num_tokens(dictionary.HasValue(key) ? 1 : 0);
+      break;
+  }
+}
+
+BenchmarkResult RunBenchmark(const char *name, LookupType type,
+                             const SystemDictionary &dictionary,
+                             const std::vector<string> &keys,
+                             const ConversionRequest &request) {
+  // Warms up the caches and the pages of the dictionary.
+  {
+    CountTokenCallback callback;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      RunLookup(type, dictionary, keys[i], request, &callback);
+    }
+  }
+
+  CountTokenCallback callback;
+  const int64 num_allocations_before = g_num_allocations;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int iteration = 0; iteration < FLAGS_iterations; ++iteration) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      RunLookup(type, dictionary, keys[i], request, &callback);
+    }
+  }
+  stopwatch.Stop();
+
+  BenchmarkResult result;
+  result.name = name;
+  result.num_ops = static_cast<int64>(keys.size()) * FLAGS_iterations;
+  result.elapsed_nsec = stopwatch.GetElapsedNanoseconds();
+  result.num_tokens = callback.num_tokens();
+  result.num_allocations = g_num_allocations - num_allocations_before;
+  return result;
+}
+
+void PrintResult(const BenchmarkResult &result, const string &dictionary_name,
+                 std::ostream *os) {
+  const double num_ops = max(result.num_ops, static_cast<int64>(1));
+  const double ns_per_op = result.elapsed_nsec / num_ops;
+  const double tokens_per_sec =
+      result.elapsed_nsec > 0 ?
+      result.num_tokens * 1e9 / result.elapsed_nsec : 0;
+  const double allocations_per_op = result.num_allocations / num_ops;
+  if (FLAGS_output_format == "json") {
+    *os << Util::StringPrintf(
+        "{\"benchmark\": \"%s\", \"dictionary\": \"%s\", \"ops\": %lld, "
+        "\"ns_per_op\": %.1f, \"tokens\": %lld, \"tokens_per_sec\": %.0f, "
+        "\"allocations_per_op\": %.3f}",
+        result.name, dictionary_name.c_str(),
+        static_cast<long long>(result.num_ops), ns_per_op,
+        static_cast<long long>(result.num_tokens), tokens_per_sec,
+        allocations_per_op) << std::endl;
+  } else {
+    *os << Util::StringPrintf(
+        "%-28s %10.1f ns/op %14.0f tokens/s %10.3f allocs/op",
+        result.name, ns_per_op, tokens_per_sec, allocations_per_op)
+        << std::endl;
+  }
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  using mozc::dictionary::SystemDictionary;
+
+  // Holds the data of the OSS data set when --dictionary is not given.
+  std::unique_ptr<mozc::oss::OssDataManager> data_manager;
+  std::unique_ptr<SystemDictionary> dictionary;
+  string dictionary_name = FLAGS_dictionary;
+  if (FLAGS_dictionary.empty()) {
+    data_manager.reset(new mozc::oss::OssDataManager());
+    const char *data = nullptr;
+    int size = 0;
+    data_manager->GetSystemDictionaryData(&data, &size);
+    dictionary.reset(SystemDictionary::Builder(data, size)
+                     .SetOptions(SystemDictionary::ENABLE_REVERSE_LOOKUP_INDEX)
+                     .Build());
+    dictionary_name = "oss";
+  } else {
+    dictionary.reset(SystemDictionary::Builder(FLAGS_dictionary)
+                     .SetOptions(SystemDictionary::ENABLE_REVERSE_LOOKUP_INDEX)
+                     .Build());
+  }
+  CHECK(dictionary.get()) << "Failed to open the system dictionary";
+
+  mozc::commands::Request request;
+  mozc::config::Config config;
+  mozc::ConversionRequest conversion_request;
+  conversion_request.set_request(&request);
+  conversion_request.set_config(&config);
+
+  mozc::commands::Request expansion_request;
+  expansion_request.set_kana_modifier_insensitive_conversion(true);
+  mozc::config::Config expansion_config;
+  expansion_config.set_use_kana_modifier_insensitive_conversion(true);
+  mozc::ConversionRequest expansion_conversion_request;
+  expansion_conversion_request.set_request(&expansion_request);
+  expansion_conversion_request.set_config(&expansion_config);
+
+  // Fixes the seed so that every run uses the same keys.
+  mozc::Util::SetRandomSeed(0);
+  const std::vector<string> phrases =
+      mozc::dictionary::ReadPhrases(FLAGS_sentences);
+  const std::vector<string> prefix_keys =
+      mozc::dictionary::SamplePrefixKeys(phrases);
+  const std::vector<string> predictive_keys =
+      mozc::dictionary::SampleKeys(phrases, FLAGS_max_predictive_key_length);
+  const std::vector<string> exact_keys =
+      mozc::dictionary::SampleKeys(phrases, FLAGS_max_exact_key_length);
+
+  // The values found by the exact lookups are realistic inputs for the
+  // reverse lookup.
+  std::vector<string> values;
+  {
+    mozc::dictionary::CollectValueCallback callback(&values);
+    for (size_t i = 0;
+         i < exact_keys.size() && values.size() < static_cast<size_t>(FLAGS_num_keys); ++i) {
+      dictionary->LookupExact(exact_keys[i], conversion_request, &callback);
+    }
+    if (values.size() > static_cast<size_t>(FLAGS_num_keys)) {
+      values.resize(FLAGS_num_keys);
+    }
+  }
+  // Half of the inputs for HasValue() are the keys in Hiragana, many of
+  // which are not values.
+  std::vector<string> has_value_inputs(values);
+  has_value_inputs.insert(has_value_inputs.end(), exact_keys.begin(),
+                          exact_keys.begin() + min(exact_keys.size(),
+                                                   values.size()));
+
+  using mozc::dictionary::BenchmarkResult;
+  using mozc::dictionary::RunBenchmark;
+  std::vector<BenchmarkResult> results;
+  results.push_back(RunBenchmark(
+      "LookupPrefix", mozc::dictionary::LOOKUP_PREFIX, *dictionary,
+      prefix_keys, conversion_request));
+  results.push_back(RunBenchmark(
+      "LookupPrefixWithKeyExpansion",
+      mozc::dictionary::LOOKUP_PREFIX_WITH_KEY_EXPANSION, *dictionary,
+      prefix_keys, expansion_conversion_request));
+  results.push_back(RunBenchmark(
+      "LookupPredictive", mozc::dictionary::LOOKUP_PREDICTIVE, *dictionary,
+      predictive_keys, conversion_request));
+  results.push_back(RunBenchmark(
+      "LookupExact", mozc::dictionary::LOOKUP_EXACT, *dictionary,
+      exact_keys, conversion_request));
+  results.push_back(RunBenchmark(
+      "LookupReverse", mozc::dictionary::LOOKUP_REVERSE, *dictionary,
+      values, conversion_request));
+  results.push_back(RunBenchmark(
+      "HasKey", mozc::dictionary::HAS_KEY, *dictionary,
+      exact_keys, conversion_request));
+  results.push_back(RunBenchmark(
+      "HasValue", mozc::dictionary::HAS_VALUE, *dictionary,
+      has_value_inputs, conversion_request));
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    mozc::dictionary::PrintResult(results[i], dictionary_name, &std::cout);
+  }
+  return 0;
+}
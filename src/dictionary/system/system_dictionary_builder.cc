@@ -38,6 +38,7 @@
 #include "base/file_stream.h"
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/file/codec_factory.h"
@@ -48,12 +49,22 @@
 #include "dictionary/system/words_info.h"
 #include "dictionary/text_dictionary_loader.h"
 #include "storage/louds/bit_vector_based_array_builder.h"
+#include "storage/existence_filter.h"
 #include "storage/louds/louds_trie_builder.h"
 
 DEFINE_bool(preserve_intermediate_dictionary, false,
             "preserve inetemediate dictionary file.");
 DEFINE_int32(min_key_length_to_use_small_cost_encoding, 6,
              "minimum key length to use 1 byte cost encoding.");
+DEFINE_bool(build_reverse_lookup_index, false,
+            "build the reverse lookup index into the dictionary file so that "
+            "it doesn't need to be built at runtime.");
+DEFINE_bool(build_existence_filter, false,
+            "build the existence filter of keys and values into the "
+            "dictionary file so that HasKey() and HasValue() can reject "
+            "absent strings without searching the tries.");
+DEFINE_double(existence_filter_error_rate, 0.01,
+              "false positive rate of the existence filter.");
 
 namespace mozc {
 namespace dictionary {
@@ -79,6 +90,9 @@ struct TokenGreaterThan {
   }
 };
 
+// The minimum number of keys processed on a thread.
+const size_t kMinKeysPerThread = 4096;
+
 void WriteSectionToFile(const DictionaryFileSection &section,
                         const string &filename) {
   OutputFileStream ofs(filename.c_str(), std::ios::binary | std::ios::out);
@@ -87,12 +101,72 @@ void WriteSectionToFile(const DictionaryFileSection &section,
 
 }  // namespace
 
+class SystemDictionaryBuilder::ValueTrieBuildThread : public Thread {
+ public:
+  ValueTrieBuildThread(SystemDictionaryBuilder *builder,
+                       const KeyInfoList *key_info_list)
+      : builder_(builder), key_info_list_(key_info_list) {}
+
+  void Run() override {
+    builder_->BuildValueTrie(*key_info_list_);
+  }
+
+ private:
+  SystemDictionaryBuilder *builder_;
+  const KeyInfoList *key_info_list_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValueTrieBuildThread);
+};
+
+class SystemDictionaryBuilder::KeyInfoRangeThread : public Thread {
+ public:
+  KeyInfoRangeThread(const SystemDictionaryBuilder *builder,
+                     KeyInfoList::iterator begin, KeyInfoList::iterator end)
+      : builder_(builder), begin_(begin), end_(end) {}
+
+  void Run() override {
+    builder_->ProcessKeyInfo(begin_, end_);
+  }
+
+ private:
+  const SystemDictionaryBuilder *builder_;
+  const KeyInfoList::iterator begin_;
+  const KeyInfoList::iterator end_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyInfoRangeThread);
+};
+
+class SystemDictionaryBuilder::TokenEncodeThread : public Thread {
+ public:
+  TokenEncodeThread(const SystemDictionaryBuilder *builder,
+                    const std::vector<const KeyInfo *> *id_to_keyinfo_table,
+                    size_t begin, size_t end,
+                    std::vector<string> *encoded_tokens)
+      : builder_(builder), id_to_keyinfo_table_(id_to_keyinfo_table),
+        begin_(begin), end_(end), encoded_tokens_(encoded_tokens) {}
+
+  void Run() override {
+    builder_->EncodeTokens(*id_to_keyinfo_table_, begin_, end_,
+                           encoded_tokens_);
+  }
+
+ private:
+  const SystemDictionaryBuilder *builder_;
+  const std::vector<const KeyInfo *> *id_to_keyinfo_table_;
+  const size_t begin_;
+  const size_t end_;
+  std::vector<string> *encoded_tokens_;
+
+  DISALLOW_COPY_AND_ASSIGN(TokenEncodeThread);
+};
+
 SystemDictionaryBuilder::SystemDictionaryBuilder()
     : value_trie_builder_(new LoudsTrieBuilder),
       key_trie_builder_(new LoudsTrieBuilder),
       token_array_builder_(new BitVectorBasedArrayBuilder),
       codec_(SystemDictionaryCodecFactory::GetCodec()),
-      file_codec_(DictionaryFileCodecFactory::GetCodec()) {}
+      file_codec_(DictionaryFileCodecFactory::GetCodec()),
+      num_threads_(1) {}
 
 // This class does not have the ownership of |codec|.
 SystemDictionaryBuilder::SystemDictionaryBuilder(
@@ -102,7 +176,8 @@ SystemDictionaryBuilder::SystemDictionaryBuilder(
       key_trie_builder_(new LoudsTrieBuilder),
       token_array_builder_(new BitVectorBasedArrayBuilder),
       codec_(codec),
-      file_codec_(file_codec) {}
+      file_codec_(file_codec),
+      num_threads_(1) {}
 
 SystemDictionaryBuilder::~SystemDictionaryBuilder() {}
 
@@ -110,19 +185,66 @@ void SystemDictionaryBuilder::BuildFromTokens(
     const std::vector<Token *> &tokens) {
   KeyInfoList key_info_list;
   ReadTokens(tokens, &key_info_list);
+  BuildFromKeyInfoList(&key_info_list);
+}
 
-  BuildFrequentPos(key_info_list);
-  BuildValueTrie(key_info_list);
-  BuildKeyTrie(key_info_list);
+void SystemDictionaryBuilder::BuildFromKeyGroups() {
+  BuildFromKeyInfoList(&added_key_info_list_);
+}
+
+void SystemDictionaryBuilder::BuildFromKeyInfoList(
+    KeyInfoList *key_info_list) {
+  if (num_threads_ > 1) {
+    // The value trie, the key trie and the frequent POS are independent of
+    // each other.
+    ValueTrieBuildThread value_trie_thread(this, key_info_list);
+    value_trie_thread.SetJoinable(true);
+    value_trie_thread.Start("ValueTrieBuilder");
+    BuildFrequentPos(*key_info_list);
+    BuildKeyTrie(*key_info_list);
+    value_trie_thread.Join();
+  } else {
+    BuildFrequentPos(*key_info_list);
+    BuildValueTrie(*key_info_list);
+    BuildKeyTrie(*key_info_list);
+  }
 
-  SetIdForValue(&key_info_list);
-  SetIdForKey(&key_info_list);
-  SortTokenInfo(&key_info_list);
-  SetCostType(&key_info_list);
-  SetPosType(&key_info_list);
-  SetValueType(&key_info_list);
+  const size_t num_threads =
+      min(static_cast<size_t>(max(num_threads_, 1)),
+          max(key_info_list->size() / kMinKeysPerThread,
+              static_cast<size_t>(1)));
+  std::vector<std::unique_ptr<KeyInfoRangeThread>> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(new KeyInfoRangeThread(
+        this, key_info_list->begin() + key_info_list->size() * i / num_threads,
+        key_info_list->begin() +
+            key_info_list->size() * (i + 1) / num_threads));
+    threads.back()->SetJoinable(true);
+    threads.back()->Start("KeyInfoProcessor");
+  }
+  ProcessKeyInfo(key_info_list->begin(),
+                 key_info_list->begin() + key_info_list->size() / num_threads);
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+  }
 
-  BuildTokenArray(key_info_list);
+  BuildTokenArray(*key_info_list);
+  if (FLAGS_build_existence_filter) {
+    BuildExistenceFilter(*key_info_list);
+  }
+}
+
+void SystemDictionaryBuilder::ProcessKeyInfo(
+    KeyInfoList::iterator begin, KeyInfoList::iterator end) const {
+  for (KeyInfoList::iterator itr = begin; itr != end; ++itr) {
+    KeyInfo *key_info = &(*itr);
+    SetIdForValue(key_info);
+    SetIdForKey(key_info);
+    SortTokenInfo(key_info);
+    SetCostType(key_info);
+    SetPosType(key_info);
+    SetValueType(key_info);
+  }
 }
 
 void SystemDictionaryBuilder::WriteToFile(const string &output_file) const {
@@ -164,6 +286,22 @@ void SystemDictionaryBuilder::WriteToStream(
     file_codec_->GetSectionName(codec_->GetSectionNameForPos()));
   sections.push_back(frequent_pos_section);
 
+  if (!reverse_lookup_index_image_.empty()) {
+    sections.push_back(DictionaryFileSection(
+        reverse_lookup_index_image_.data(),
+        reverse_lookup_index_image_.size(),
+        file_codec_->GetSectionName(
+            codec_->GetSectionNameForReverseLookupIndex())));
+  }
+
+  if (!existence_filter_image_.empty()) {
+    sections.push_back(DictionaryFileSection(
+        existence_filter_image_.data(),
+        existence_filter_image_.size(),
+        file_codec_->GetSectionName(
+            codec_->GetSectionNameForExistenceFilter())));
+  }
+
   if (FLAGS_preserve_intermediate_dictionary &&
       !intermediate_output_file_base_path.empty()) {
     // Write out intermediate results to files.
@@ -267,6 +405,36 @@ void SystemDictionaryBuilder::ReadTokens(const std::vector<Token *> &tokens,
   key_info_list->push_back(last_key_info);
 }
 
+void SystemDictionaryBuilder::AddKeyGroup(
+    std::vector<std::unique_ptr<Token>> *tokens) {
+  CHECK(!tokens->empty());
+  const string &key = tokens->front()->key;
+  CHECK(!key.empty()) << "empty key string in input";
+  DCHECK(added_key_info_list_.empty() || added_key_info_list_.back().key < key)
+      << "keys must be added in ascending order";
+  added_key_info_list_.push_back(KeyInfo());
+  KeyInfo *key_info = &added_key_info_list_.back();
+  key_info->key = key;
+  for (size_t i = 0; i < tokens->size(); ++i) {
+    Token *token = (*tokens)[i].get();
+    DCHECK_EQ(key_info->key, token->key);
+    CHECK(!token->value.empty()) << "empty value string in input";
+    // The value type is determined by the key, so compute it before the key
+    // is dropped.
+    const TokenInfo::ValueType value_type = GetValueType(token);
+    owned_tokens_.push_back(Token());
+    Token *owned_token = &owned_tokens_.back();
+    owned_token->value.swap(token->value);
+    owned_token->cost = token->cost;
+    owned_token->lid = token->lid;
+    owned_token->rid = token->rid;
+    owned_token->attributes = token->attributes;
+    key_info->tokens.push_back(TokenInfo(owned_token));
+    key_info->tokens.back().value_type = value_type;
+  }
+  tokens->clear();
+}
+
 void SystemDictionaryBuilder::BuildFrequentPos(
     const KeyInfoList &key_info_list) {
   // Calculate frequency of each pos
@@ -339,83 +507,100 @@ void SystemDictionaryBuilder::BuildValueTrie(const KeyInfoList &key_info_list) {
   value_trie_builder_->Build();
 }
 
-void SystemDictionaryBuilder::SetIdForValue(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
+void SystemDictionaryBuilder::BuildExistenceFilter(
+    const KeyInfoList &key_info_list) {
+  std::vector<uint64> fingerprints;
+  for (KeyInfoList::const_iterator itr = key_info_list.begin();
+       itr != key_info_list.end(); ++itr) {
+    fingerprints.push_back(codec_->GetKeyFingerprint(itr->key));
     for (size_t i = 0; i < itr->tokens.size(); ++i) {
-      TokenInfo *token_info = &(itr->tokens[i]);
-      string value_str;
-      codec_->EncodeValue(token_info->token->value, &value_str);
-      token_info->id_in_value_trie =
-          value_trie_builder_->GetId(value_str);
+      fingerprints.push_back(
+          codec_->GetValueFingerprint(itr->tokens[i].token->value));
     }
   }
+  std::sort(fingerprints.begin(), fingerprints.end());
+  fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()),
+                     fingerprints.end());
+
+  const size_t size_in_bytes =
+      storage::ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+          static_cast<float>(FLAGS_existence_filter_error_rate),
+          max(fingerprints.size(), static_cast<size_t>(1)));
+  std::unique_ptr<storage::ExistenceFilter> filter(
+      storage::ExistenceFilter::CreateOptimal(
+          size_in_bytes,
+          max(static_cast<uint32>(fingerprints.size()), 1u)));
+  for (size_t i = 0; i < fingerprints.size(); ++i) {
+    filter->Insert(fingerprints[i]);
+  }
+
+  char *buf = nullptr;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  existence_filter_image_.assign(buf, size);
+  delete [] buf;
+  LOG(INFO) << "Existence filter: " << fingerprints.size() << " entries in "
+            << size << " bytes";
 }
 
-void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    std::sort(key_info->tokens.begin(), key_info->tokens.end(),
-              TokenGreaterThan());
+void SystemDictionaryBuilder::SetIdForValue(KeyInfo *key_info) const {
+  for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+    TokenInfo *token_info = &(key_info->tokens[i]);
+    string value_str;
+    codec_->EncodeValue(token_info->token->value, &value_str);
+    token_info->id_in_value_trie =
+        value_trie_builder_->GetId(value_str);
   }
 }
 
-void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    if (HasHomonymsInSamePos(*key_info)) {
-      continue;
-    }
-    for (size_t i = 0; i < key_info->tokens.size(); ++i) {
-      TokenInfo *token_info = &key_info->tokens[i];
-      const int key_len = Util::CharsLen(token_info->token->key);
-      if (key_len >= FLAGS_min_key_length_to_use_small_cost_encoding) {
-        token_info->cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
-      }
-    }
+void SystemDictionaryBuilder::SortTokenInfo(KeyInfo *key_info) const {
+  std::sort(key_info->tokens.begin(), key_info->tokens.end(),
+            TokenGreaterThan());
+}
+
+void SystemDictionaryBuilder::SetCostType(KeyInfo *key_info) const {
+  if (HasHomonymsInSamePos(*key_info)) {
+    return;
+  }
+  const int key_len = Util::CharsLen(key_info->key);
+  if (key_len < FLAGS_min_key_length_to_use_small_cost_encoding) {
+    return;
+  }
+  for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+    key_info->tokens[i].cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
   }
 }
 
-void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    for (size_t i = 0; i < key_info->tokens.size(); ++i) {
-      TokenInfo *token_info = &(key_info->tokens[i]);
-      const uint32 pos = GetCombinedPos(token_info->token->lid,
-                                        token_info->token->rid);
-      std::map<uint32, int>::const_iterator itr = frequent_pos_.find(pos);
-      if (itr != frequent_pos_.end()) {
-        token_info->pos_type = TokenInfo::FREQUENT_POS;
-        token_info->id_in_frequent_pos_map = itr->second;
-      }
-      if (i >= 1) {
-        const TokenInfo &prev_token_info = key_info->tokens[i - 1];
-        const uint32 prev_pos = GetCombinedPos(prev_token_info.token->lid,
-                                               prev_token_info.token->rid);
-        if (prev_pos == pos) {
-          // we can overwrite FREQUENT_POS
-          token_info->pos_type = TokenInfo::SAME_AS_PREV_POS;
-        }
+void SystemDictionaryBuilder::SetPosType(KeyInfo *key_info) const {
+  for (size_t i = 0; i < key_info->tokens.size(); ++i) {
+    TokenInfo *token_info = &(key_info->tokens[i]);
+    const uint32 pos = GetCombinedPos(token_info->token->lid,
+                                      token_info->token->rid);
+    std::map<uint32, int>::const_iterator itr = frequent_pos_.find(pos);
+    if (itr != frequent_pos_.end()) {
+      token_info->pos_type = TokenInfo::FREQUENT_POS;
+      token_info->id_in_frequent_pos_map = itr->second;
+    }
+    if (i >= 1) {
+      const TokenInfo &prev_token_info = key_info->tokens[i - 1];
+      const uint32 prev_pos = GetCombinedPos(prev_token_info.token->lid,
+                                             prev_token_info.token->rid);
+      if (prev_pos == pos) {
+        // we can overwrite FREQUENT_POS
+        token_info->pos_type = TokenInfo::SAME_AS_PREV_POS;
       }
     }
   }
 }
 
-void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    for (size_t i = 1; i < key_info->tokens.size(); ++i) {
-      const TokenInfo *prev_token_info = &(key_info->tokens[i - 1]);
-      TokenInfo *token_info = &(key_info->tokens[i]);
-      if (token_info->value_type != TokenInfo::AS_IS_HIRAGANA &&
-          token_info->value_type != TokenInfo::AS_IS_KATAKANA &&
-          (token_info->token->value == prev_token_info->token->value)) {
-        token_info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
-      }
+void SystemDictionaryBuilder::SetValueType(KeyInfo *key_info) const {
+  for (size_t i = 1; i < key_info->tokens.size(); ++i) {
+    const TokenInfo *prev_token_info = &(key_info->tokens[i - 1]);
+    TokenInfo *token_info = &(key_info->tokens[i]);
+    if (token_info->value_type != TokenInfo::AS_IS_HIRAGANA &&
+        token_info->value_type != TokenInfo::AS_IS_KATAKANA &&
+        (token_info->token->value == prev_token_info->token->value)) {
+      token_info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
     }
   }
 }
@@ -430,14 +615,19 @@ void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
   key_trie_builder_->Build();
 }
 
-void SystemDictionaryBuilder::SetIdForKey(KeyInfoList *key_info_list) const {
-  for (KeyInfoList::iterator itr = key_info_list->begin();
-       itr != key_info_list->end(); ++itr) {
-    KeyInfo *key_info = &(*itr);
-    string key_str;
-    codec_->EncodeKey(key_info->key, &key_str);
-    key_info->id_in_key_trie =
-        key_trie_builder_->GetId(key_str);
+void SystemDictionaryBuilder::SetIdForKey(KeyInfo *key_info) const {
+  string key_str;
+  codec_->EncodeKey(key_info->key, &key_str);
+  key_info->id_in_key_trie =
+      key_trie_builder_->GetId(key_str);
+}
+
+void SystemDictionaryBuilder::EncodeTokens(
+    const std::vector<const KeyInfo *> &id_to_keyinfo_table,
+    size_t begin, size_t end, std::vector<string> *encoded_tokens) const {
+  for (size_t i = begin; i < end; ++i) {
+    codec_->EncodeTokens(id_to_keyinfo_table[i]->tokens,
+                         &(*encoded_tokens)[i]);
   }
 }
 
@@ -456,11 +646,29 @@ void SystemDictionaryBuilder::BuildTokenArray(
       id_to_keyinfo_table[id] = &key_info;
     }
 
-    for (size_t i = 0; i < id_to_keyinfo_table.size(); ++i) {
-      const KeyInfo &key_info = *id_to_keyinfo_table[i];
-      string tokens_str;
-      codec_->EncodeTokens(key_info.tokens, &tokens_str);
-      token_array_builder_->Add(tokens_str);
+    const size_t num_keys = id_to_keyinfo_table.size();
+    std::vector<string> encoded_tokens(num_keys);
+    const size_t num_threads =
+        min(static_cast<size_t>(max(num_threads_, 1)),
+            max(num_keys / kMinKeysPerThread, static_cast<size_t>(1)));
+    std::vector<std::unique_ptr<TokenEncodeThread>> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+      threads.emplace_back(new TokenEncodeThread(
+          this, &id_to_keyinfo_table, num_keys * i / num_threads,
+          num_keys * (i + 1) / num_threads, &encoded_tokens));
+      threads.back()->SetJoinable(true);
+      threads.back()->Start("TokenEncoder");
+    }
+    EncodeTokens(id_to_keyinfo_table, 0, num_keys / num_threads,
+                 &encoded_tokens);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      threads[i]->Join();
+    }
+    for (size_t i = 0; i < num_keys; ++i) {
+      token_array_builder_->Add(encoded_tokens[i]);
+    }
+    if (FLAGS_build_reverse_lookup_index) {
+      BuildReverseLookupIndex(encoded_tokens);
     }
   }
 
@@ -468,5 +676,70 @@ void SystemDictionaryBuilder::BuildTokenArray(
   token_array_builder_->Build();
 }
 
+void SystemDictionaryBuilder::BuildReverseLookupIndex(
+    const std::vector<string> &encoded_tokens) {
+  // The size of each element of the token array is rounded up to this
+  // length by BitVectorBasedArrayBuilder.
+  const size_t kMinTokenArrayBlobSize = 4;
+
+  // Collects (value id, tokens offset, key id) in the order of the tokens
+  // in the token array, which is the order that the reverse lookup results
+  // are returned.
+  struct Entry {
+    int value_id;
+    uint32 tokens_offset;
+    uint32 id_in_key_trie;
+  };
+  std::vector<Entry> entries;
+  int value_id_max = -1;
+  uint32 tokens_offset = 0;
+  for (size_t key_id = 0; key_id < encoded_tokens.size(); ++key_id) {
+    const uint8 *ptr =
+        reinterpret_cast<const uint8 *>(encoded_tokens[key_id].data());
+    int offset = 0;
+    bool has_next = true;
+    while (has_next) {
+      Entry entry = {-1, tokens_offset, static_cast<uint32>(key_id)};
+      int read_bytes = 0;
+      has_next = codec_->ReadTokenForReverseLookup(ptr + offset,
+                                                   &entry.value_id,
+                                                   &read_bytes);
+      offset += read_bytes;
+      if (entry.value_id != -1) {
+        value_id_max = max(value_id_max, entry.value_id);
+        entries.push_back(entry);
+      }
+    }
+    DCHECK_EQ(encoded_tokens[key_id].size(), static_cast<size_t>(offset));
+    tokens_offset += max(encoded_tokens[key_id].size(),
+                         kMinTokenArrayBlobSize);
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry &lhs, const Entry &rhs) {
+                     return lhs.value_id < rhs.value_id;
+                   });
+
+  const uint32 num_value_ids = value_id_max + 1;
+  std::vector<uint32> image;
+  image.reserve(num_value_ids + 2 + entries.size() * 2);
+  image.push_back(num_value_ids);
+  size_t pos = 0;
+  for (uint32 value_id = 0; value_id <= num_value_ids; ++value_id) {
+    image.push_back(pos);
+    while (pos < entries.size() &&
+           static_cast<uint32>(entries[pos].value_id) == value_id) {
+      ++pos;
+    }
+  }
+  DCHECK_EQ(entries.size(), pos);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    image.push_back(entries[i].tokens_offset);
+    image.push_back(entries[i].id_in_key_trie);
+  }
+  reverse_lookup_index_image_.assign(
+      reinterpret_cast<const char *>(image.data()),
+      image.size() * sizeof(uint32));
+}
+
 }  // namespace dictionary
 }  // namespace mozc
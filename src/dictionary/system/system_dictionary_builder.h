@@ -38,6 +38,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "dictionary/dictionary_token.h"
 #include "dictionary/system/words_info.h"
 
 namespace mozc {
@@ -52,7 +53,6 @@ namespace dictionary {
 
 class SystemDictionaryCodecInterface;
 class DictionaryFileCodecInterface;
-struct Token;
 
 class SystemDictionaryBuilder {
  public:
@@ -71,6 +71,21 @@ class SystemDictionaryBuilder {
   virtual ~SystemDictionaryBuilder();
   void BuildFromTokens(const std::vector<Token *> &tokens);
 
+  // Another way to build: call AddKeyGroup() for each key in ascending order
+  // of key, e.g., from TextDictionaryLoader::LoadSortedByKey(), and then call
+  // BuildFromKeyGroups().  The builder takes the ownership of the tokens and
+  // drops their key strings, which are kept once per key.
+  void AddKeyGroup(std::vector<std::unique_ptr<Token>> *tokens);
+  void BuildFromKeyGroups();
+
+  // Sets the number of threads used by BuildFromTokens().  The value trie is
+  // built concurrently with the key trie, and the per-key steps and the token
+  // encoding are split into ranges of keys.  The output doesn't depend on
+  // this number.
+  void set_num_threads(int num_threads) {
+    num_threads_ = num_threads;
+  }
+
   void WriteToFile(const string &output_file) const;
   void WriteToStream(const string &intermediate_output_file_base_path,
                      std::ostream *output_stream) const;
@@ -78,9 +93,15 @@ class SystemDictionaryBuilder {
  private:
   typedef std::deque<KeyInfo> KeyInfoList;
 
+  class ValueTrieBuildThread;
+  class KeyInfoRangeThread;
+  class TokenEncodeThread;
+
   void ReadTokens(const std::vector<Token *>& tokens,
                   KeyInfoList *key_info_list) const;
 
+  void BuildFromKeyInfoList(KeyInfoList *key_info_list);
+
   void BuildFrequentPos(const KeyInfoList &key_info_list);
 
   void BuildValueTrie(const KeyInfoList &key_info_list);
@@ -89,24 +110,59 @@ class SystemDictionaryBuilder {
 
   void BuildTokenArray(const KeyInfoList &key_info_list);
 
-  void SetIdForValue(KeyInfoList *key_info_list) const;
-  void SetIdForKey(KeyInfoList *key_info_list) const;
-  void SortTokenInfo(KeyInfoList *key_info_list) const;
-
-  void SetCostType(KeyInfoList *key_info_list) const;
-  void SetPosType(KeyInfoList *keyinfomap) const;
-  void SetValueType(KeyInfoList *key_info_list) const;
+  // Builds the image of the reverse lookup index section, which maps the id
+  // in value trie to the tokens having the value.  The image is an array of
+  // uint32 as follows:
+  //   [N][offsets[0]] ... [offsets[N]]
+  //   [tokens_offset of entry 0][id_in_key_trie of entry 0] ...
+  // where N is the number of value ids and the entries for value id i are
+  // [offsets[i], offsets[i + 1]).  |tokens_offset| is the offset of the
+  // tokens of the key from the beginning of the token array.
+  // |encoded_tokens| is the encoded tokens indexed by the id in key trie.
+  void BuildReverseLookupIndex(const std::vector<string> &encoded_tokens);
+
+  // Builds the image of the existence filter section, which holds the
+  // fingerprints of all the keys and the values in the dictionary.
+  void BuildExistenceFilter(const KeyInfoList &key_info_list);
+
+  // Runs the following steps, which don't depend on other keys, on the keys
+  // in [begin, end).
+  void ProcessKeyInfo(KeyInfoList::iterator begin,
+                      KeyInfoList::iterator end) const;
+
+  void SetIdForValue(KeyInfo *key_info) const;
+  void SetIdForKey(KeyInfo *key_info) const;
+  void SortTokenInfo(KeyInfo *key_info) const;
+
+  void SetCostType(KeyInfo *key_info) const;
+  void SetPosType(KeyInfo *key_info) const;
+  void SetValueType(KeyInfo *key_info) const;
+
+  // Encodes the tokens of |id_to_keyinfo_table[i]| into |encoded_tokens[i]|
+  // for i in [begin, end).
+  void EncodeTokens(const std::vector<const KeyInfo *> &id_to_keyinfo_table,
+                    size_t begin, size_t end,
+                    std::vector<string> *encoded_tokens) const;
 
   std::unique_ptr<mozc::storage::louds::LoudsTrieBuilder> value_trie_builder_;
   std::unique_ptr<mozc::storage::louds::LoudsTrieBuilder> key_trie_builder_;
   std::unique_ptr<mozc::storage::louds::BitVectorBasedArrayBuilder>
       token_array_builder_;
+  // Empty unless --build_reverse_lookup_index is set.
+  string reverse_lookup_index_image_;
+  // Empty unless --build_existence_filter is set.
+  string existence_filter_image_;
+
+  // Tokens added by AddKeyGroup().
+  std::deque<Token> owned_tokens_;
+  KeyInfoList added_key_info_list_;
 
   // mapping from {left_id, right_id} to POS index (0--255)
   std::map<uint32, int> frequent_pos_;
 
   const SystemDictionaryCodecInterface *codec_;
   const DictionaryFileCodecInterface *file_codec_;
+  int num_threads_;
 
   DISALLOW_COPY_AND_ASSIGN(SystemDictionaryBuilder);
 };
@@ -31,11 +31,14 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <limits>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/access_profiler.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -46,6 +49,9 @@
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_test_util.h"
 #include "dictionary/dictionary_token.h"
+#include "dictionary/file/codec_factory.h"
+#include "dictionary/file/codec_interface.h"
+#include "dictionary/file/section.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/system_dictionary_builder.h"
@@ -66,6 +72,8 @@ DEFINE_int32(dictionary_test_size, 100000,
 DEFINE_int32(dictionary_reverse_lookup_test_size, 1000,
              "Number of tokens to run reverse lookup test.");
 DECLARE_int32(min_key_length_to_use_small_cost_encoding);
+DECLARE_bool(build_reverse_lookup_index);
+DECLARE_bool(build_existence_filter);
 
 namespace mozc {
 namespace dictionary {
@@ -612,6 +620,48 @@ TEST_F(SystemDictionaryTest, LookupPrefix) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupPrefixBatch) {
+  BuildSystemDictionary(text_dict_->tokens(), FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  // "きょうはいいてんきですねABCアイウ"
+  const string kKey =
+      "\xE3\x81\x8D\xE3\x82\x87\xE3\x81\x86\xE3\x81\xAF\xE3\x81\x84"
+      "\xE3\x81\x84\xE3\x81\xA6\xE3\x82\x93\xE3\x81\x8D\xE3\x81\xA7"
+      "\xE3\x81\x99\xE3\x81\xAD" "ABC\xE3\x82\xA2\xE3\x82\xA4\xE3\x82\xA6";
+  for (int expansion = 0; expansion < 2; ++expansion) {
+    request_.set_kana_modifier_insensitive_conversion(expansion == 1);
+    config_.set_use_kana_modifier_insensitive_conversion(expansion == 1);
+
+    // Request the lookups from every byte, including the middle of
+    // characters, except for the first one.
+    std::vector<CollectTokenCallback> batch_callbacks(kKey.size());
+    std::vector<DictionaryInterface::Callback *> callbacks(kKey.size());
+    for (size_t i = 1; i < kKey.size(); ++i) {
+      callbacks[i] = &batch_callbacks[i];
+    }
+    system_dic->LookupPrefixBatch(kKey, convreq_, callbacks);
+
+    EXPECT_TRUE(batch_callbacks[0].tokens().empty());
+    for (size_t i = 1; i < kKey.size(); ++i) {
+      CollectTokenCallback callback;
+      system_dic->LookupPrefix(StringPiece(kKey).substr(i), convreq_,
+                               &callback);
+      const std::vector<Token> &expected = callback.tokens();
+      const std::vector<Token> &actual = batch_callbacks[i].tokens();
+      ASSERT_EQ(expected.size(), actual.size()) << "pos: " << i;
+      for (size_t j = 0; j < expected.size(); ++j) {
+        EXPECT_TRUE(CompareTokensForLookup(expected[j], actual[j], false))
+            << "pos: " << i << "\nExpected: " << PrintToken(expected[j])
+            << "\nActual: " << PrintToken(actual[j]);
+      }
+    }
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupPredictive) {
   std::vector<Token *> tokens;
   ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
@@ -712,6 +762,66 @@ TEST_F(SystemDictionaryTest, LookupPredictive_CutOffEmulatingBFS) {
   EXPECT_FALSE(callback.IsFound(tokens[1]));
 }
 
+namespace {
+
+// Lifts the key limit of LookupPredictive() and culls the subtree of
+// |cull_key|.
+class UnlimitedPredictiveLookupCallback
+    : public CheckMultiTokensExistenceCallback {
+ public:
+  UnlimitedPredictiveLookupCallback(const std::vector<Token *> &tokens,
+                                    const string &cull_key)
+      : CheckMultiTokensExistenceCallback(tokens), cull_key_(cull_key) {}
+
+  ResultType OnKey(StringPiece key) override {
+    return key == cull_key_ ? TRAVERSE_CULL : TRAVERSE_CONTINUE;
+  }
+
+  size_t GetPredictiveLookupKeyLimit() const override {
+    return std::numeric_limits<size_t>::max();
+  }
+
+ private:
+  const string cull_key_;
+};
+
+}  // namespace
+
+TEST_F(SystemDictionaryTest, LookupPredictive_KeyLimitAndCull) {
+  std::vector<Token *> tokens;
+  ScopedElementsDeleter<std::vector<Token *>> deleter(&tokens);
+
+  // "あい" -> "ai"
+  tokens.push_back(CreateToken("\xe3\x81\x82\xe3\x81\x84", "ai"));
+  // "あいうえお" -> "aiueo"
+  tokens.push_back(CreateToken(
+      "\xe3\x81\x82\xe3\x81\x84\xe3\x81\x86\xe3\x81\x88\xe3\x81\x8a",
+      "aiueo"));
+  // "あかさたな" -> "akasatana"
+  tokens.push_back(CreateToken(
+      "\xe3\x81\x82\xe3\x81\x8b\xe3\x81\x95\xe3\x81\x9f\xe3\x81\xaa",
+      "akasatana"));
+  {
+    std::vector<Token *> source_tokens = tokens;
+    text_dict_->CollectTokens(&source_tokens);  // Load test data.
+    BuildSystemDictionary(source_tokens, 10000);
+  }
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source: " << dic_fn_;
+
+  // Without the key limit, the long keys are looked up too.  Culling "あい"
+  // skips "あいうえお" but not the other keys.
+  UnlimitedPredictiveLookupCallback callback(
+      tokens, "\xe3\x81\x82\xe3\x81\x84");  // "あい"
+  system_dic->LookupPredictive("\xe3\x81\x82",  // "あ"
+                               convreq_, &callback);
+  EXPECT_FALSE(callback.IsFound(tokens[0]));
+  EXPECT_FALSE(callback.IsFound(tokens[1]));
+  EXPECT_TRUE(callback.IsFound(tokens[2]));
+}
+
 TEST_F(SystemDictionaryTest, LookupExact) {
   std::vector<Token *> source_tokens;
 
@@ -748,6 +858,75 @@ TEST_F(SystemDictionaryTest, LookupExact) {
   EXPECT_TRUE(callback_hoge.tokens().empty());
 }
 
+TEST_F(SystemDictionaryTest, RecordsAccessProfile) {
+  // "は"
+  const string k0 = "\xe3\x81\xaf";
+  unique_ptr<Token> t0(CreateToken(k0, "aa"));
+  std::vector<Token *> source_tokens;
+  source_tokens.push_back(t0.get());
+  BuildSystemDictionary(source_tokens, 100);
+
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  AccessProfiler::SetEnabled(true);
+  CollectTokenCallback callback;
+  system_dic->LookupExact(k0, convreq_, &callback);
+  system_dic->LookupExact(k0, convreq_, &callback);
+  // Missing keys don't touch the token array.
+  system_dic->LookupExact("hoge", convreq_, &callback);
+  AccessProfiler::SetEnabled(false);
+  EXPECT_EQ(2, callback.tokens().size());
+
+  std::vector<AccessProfiler::Entry> entries;
+  AccessProfiler::GetEntries(&entries);
+  ASSERT_EQ(1, entries.size());
+  EXPECT_EQ("dict", entries[0].name);
+  EXPECT_EQ(0, entries[0].index);
+  EXPECT_EQ(2, entries[0].count);
+}
+
+// Collects the tokens passed to OnTokenView() only.  OnToken() isn't
+// overridden, so no Token is materialized for the tokens of SystemDictionary.
+class CollectTokenViewCallback : public SystemDictionary::Callback {
+ public:
+  virtual ResultType OnTokenView(StringPiece key, StringPiece actual_key,
+                                 const TokenView &token) {
+    tokens_.push_back(Token());
+    token.CopyToToken(&tokens_.back());
+    return TRAVERSE_CONTINUE;
+  }
+
+  const std::vector<Token> &tokens() const { return tokens_; }
+
+ private:
+  std::vector<Token> tokens_;
+};
+
+TEST_F(SystemDictionaryTest, CallbackOverridingOnlyOnTokenView) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  for (size_t i = 0; i < source_tokens.size() && i < 1000; ++i) {
+    const string &key = source_tokens[i]->key;
+    CollectTokenCallback expected;
+    CollectTokenViewCallback actual;
+    system_dic->LookupExact(key, convreq_, &expected);
+    system_dic->LookupExact(key, convreq_, &actual);
+    EXPECT_FALSE(actual.tokens().empty()) << key;
+    ASSERT_EQ(expected.tokens().size(), actual.tokens().size()) << key;
+    for (size_t j = 0; j < expected.tokens().size(); ++j) {
+      EXPECT_TOKEN_EQ(expected.tokens()[j], actual.tokens()[j]);
+    }
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupReverse) {
   unique_ptr<Token> t0(new Token);
   // "ど"
@@ -936,6 +1115,205 @@ TEST_F(SystemDictionaryTest, LookupReverseIndex) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupReversePrebuiltIndex) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> system_dic_with_index(
+      SystemDictionary::Builder(dic_fn_)
+      .SetOptions(SystemDictionary::ENABLE_REVERSE_LOOKUP_INDEX)
+      .Build());
+  ASSERT_TRUE(system_dic_with_index.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+
+  // Rebuilds the dictionary with the index in the file.
+  const bool original_flag = FLAGS_build_reverse_lookup_index;
+  FLAGS_build_reverse_lookup_index = true;
+  const string prebuilt_dic_fn = dic_fn_ + ".prebuilt";
+  {
+    SystemDictionaryBuilder builder;
+    std::vector<Token *> tokens(
+        source_tokens.begin(),
+        source_tokens.begin() + min(source_tokens.size(), static_cast<size_t>(
+            FLAGS_dictionary_test_size)));
+    builder.BuildFromTokens(tokens);
+    builder.WriteToFile(prebuilt_dic_fn);
+  }
+  FLAGS_build_reverse_lookup_index = original_flag;
+  unique_ptr<SystemDictionary> system_dic_with_prebuilt_index(
+      SystemDictionary::Builder(prebuilt_dic_fn)
+      .SetOptions(SystemDictionary::NONE)
+      .Build());
+  ASSERT_TRUE(system_dic_with_prebuilt_index.get() != NULL)
+      << "Failed to open dictionary source:" << prebuilt_dic_fn;
+
+  std::vector<Token *>::const_iterator it;
+  int size = FLAGS_dictionary_reverse_lookup_test_size;
+  for (it = source_tokens.begin();
+       size > 0 && it != source_tokens.end(); ++it, --size) {
+    const Token &t = **it;
+    CollectTokenCallback callback1, callback2;
+    system_dic_with_index->LookupReverse(t.value, convreq_, &callback1);
+    system_dic_with_prebuilt_index->LookupReverse(t.value, convreq_,
+                                                  &callback2);
+
+    const std::vector<Token> &tokens1 = callback1.tokens();
+    const std::vector<Token> &tokens2 = callback2.tokens();
+    ASSERT_EQ(tokens1.size(), tokens2.size());
+    for (size_t i = 0; i < tokens1.size(); ++i) {
+      EXPECT_TOKEN_EQ(tokens1[i], tokens2[i]);
+    }
+  }
+}
+
+TEST_F(SystemDictionaryTest, ExistenceFilter) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  BuildSystemDictionary(source_tokens, FLAGS_dictionary_test_size);
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+  uint64 num_queries = 0, num_rejections = 0;
+  EXPECT_FALSE(system_dic->GetExistenceFilterStats(&num_queries,
+                                                   &num_rejections));
+
+  // Rebuilds the dictionary with the existence filter in the file.
+  const bool original_flag = FLAGS_build_existence_filter;
+  FLAGS_build_existence_filter = true;
+  const string filtered_dic_fn = dic_fn_ + ".filtered";
+  {
+    SystemDictionaryBuilder builder;
+    std::vector<Token *> tokens(
+        source_tokens.begin(),
+        source_tokens.begin() + min(source_tokens.size(), static_cast<size_t>(
+            FLAGS_dictionary_test_size)));
+    builder.BuildFromTokens(tokens);
+    builder.WriteToFile(filtered_dic_fn);
+  }
+  FLAGS_build_existence_filter = original_flag;
+  unique_ptr<SystemDictionary> filtered_dic(
+      SystemDictionary::Builder(filtered_dic_fn).Build());
+  ASSERT_TRUE(filtered_dic.get() != NULL)
+      << "Failed to open dictionary source:" << filtered_dic_fn;
+  ASSERT_TRUE(filtered_dic->GetExistenceFilterStats(&num_queries,
+                                                    &num_rejections));
+  EXPECT_EQ(0, num_queries);
+  EXPECT_EQ(0, num_rejections);
+
+  // Both the present strings and the absent ones made from them are checked.
+  const size_t num_tokens = min(source_tokens.size(), static_cast<size_t>(
+      FLAGS_dictionary_test_size));
+  for (size_t i = 0; i < num_tokens; ++i) {
+    const Token &t = *source_tokens[i];
+    EXPECT_TRUE(filtered_dic->HasKey(t.key)) << t.key;
+    EXPECT_TRUE(filtered_dic->HasValue(t.value)) << t.value;
+    const string absent_key = t.key + "\xE3\x82\x90";  // "ゐ"
+    EXPECT_EQ(system_dic->HasKey(absent_key), filtered_dic->HasKey(absent_key))
+        << absent_key;
+    const string absent_value = t.value + "\xE3\x83\xB1";  // "ヱ"
+    EXPECT_EQ(system_dic->HasValue(absent_value),
+              filtered_dic->HasValue(absent_value)) << absent_value;
+  }
+
+  ASSERT_TRUE(filtered_dic->GetExistenceFilterStats(&num_queries,
+                                                    &num_rejections));
+  EXPECT_EQ(num_tokens * 4, num_queries);
+  // Most of the absent strings are rejected by the filter.
+  EXPECT_LT(num_queries / 4, num_rejections);
+  EXPECT_GE(num_queries / 2, num_rejections);
+}
+
+TEST_F(SystemDictionaryTest, BuildWithMultipleThreads) {
+  const std::vector<Token *> &source_tokens = text_dict_->tokens();
+  const DictionaryFileCodecInterface *file_codec =
+      DictionaryFileCodecFactory::GetCodec();
+  std::ostringstream expected_stream;
+  {
+    SystemDictionaryBuilder builder;
+    builder.BuildFromTokens(source_tokens);
+    builder.WriteToStream("", &expected_stream);
+  }
+  const string expected_image = expected_stream.str();
+  std::vector<DictionaryFileSection> expected;
+  ASSERT_TRUE(file_codec->ReadSections(expected_image.data(),
+                                       expected_image.size(), &expected));
+
+  for (int num_threads = 2; num_threads <= 4; ++num_threads) {
+    SystemDictionaryBuilder builder;
+    builder.set_num_threads(num_threads);
+    builder.BuildFromTokens(source_tokens);
+    std::ostringstream actual_stream;
+    builder.WriteToStream("", &actual_stream);
+    const string actual_image = actual_stream.str();
+    std::vector<DictionaryFileSection> actual;
+    ASSERT_TRUE(file_codec->ReadSections(actual_image.data(),
+                                         actual_image.size(), &actual));
+
+    // The file codec pads the sections with random bytes, so compare the
+    // sections instead of the whole images.
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].name, actual[i].name);
+      EXPECT_TRUE(StringPiece(expected[i].ptr, expected[i].len) ==
+                  StringPiece(actual[i].ptr, actual[i].len))
+          << "num_threads: " << num_threads << ", section: " << i;
+    }
+  }
+}
+
+namespace {
+
+bool TokenKeyLess(const Token *l, const Token *r) {
+  return l->key < r->key;
+}
+
+}  // namespace
+
+TEST_F(SystemDictionaryTest, BuildFromKeyGroups) {
+  std::vector<Token *> source_tokens = text_dict_->tokens();
+  const DictionaryFileCodecInterface *file_codec =
+      DictionaryFileCodecFactory::GetCodec();
+  std::ostringstream expected_stream;
+  {
+    SystemDictionaryBuilder builder;
+    builder.BuildFromTokens(source_tokens);
+    builder.WriteToStream("", &expected_stream);
+  }
+  const string expected_image = expected_stream.str();
+  std::vector<DictionaryFileSection> expected;
+  ASSERT_TRUE(file_codec->ReadSections(expected_image.data(),
+                                       expected_image.size(), &expected));
+
+  // Feed the same tokens grouped by key, as TextDictionaryLoader::
+  // LoadSortedByKey() does.
+  std::stable_sort(source_tokens.begin(), source_tokens.end(), TokenKeyLess);
+  SystemDictionaryBuilder builder;
+  for (size_t begin = 0; begin < source_tokens.size();) {
+    std::vector<unique_ptr<Token>> group;
+    size_t end = begin;
+    for (; end < source_tokens.size() &&
+               source_tokens[end]->key == source_tokens[begin]->key; ++end) {
+      group.emplace_back(new Token(*source_tokens[end]));
+    }
+    builder.AddKeyGroup(&group);
+    begin = end;
+  }
+  builder.BuildFromKeyGroups();
+  std::ostringstream actual_stream;
+  builder.WriteToStream("", &actual_stream);
+  const string actual_image = actual_stream.str();
+  std::vector<DictionaryFileSection> actual;
+  ASSERT_TRUE(file_codec->ReadSections(actual_image.data(),
+                                       actual_image.size(), &actual));
+
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].name, actual[i].name);
+    EXPECT_TRUE(StringPiece(expected[i].ptr, expected[i].len) ==
+                StringPiece(actual[i].ptr, actual[i].len))
+        << "section: " << i;
+  }
+}
+
 TEST_F(SystemDictionaryTest, LookupReverseWithCache) {
   const string kDoraemon =
       "\xe3\x83\x89\xe3\x83\xa9\xe3\x81\x88\xe3\x82\x82\xe3\x82\x93";
@@ -969,6 +1347,52 @@ TEST_F(SystemDictionaryTest, LookupReverseWithCache) {
   system_dic->ClearReverseLookupCache();
 }
 
+TEST_F(SystemDictionaryTest, LookupReverseWithNestedCache) {
+  // "ドラえもん"
+  const string kDoraemon =
+      "\xe3\x83\x89\xe3\x83\xa9\xe3\x81\x88\xe3\x82\x82\xe3\x82\x93";
+
+  Token source_token;
+  // "どらえもん"
+  source_token.key =
+      "\xe3\x81\xa9\xe3\x82\x89\xe3\x81\x88\xe3\x82\x82\xe3\x82\x93";
+  source_token.value = kDoraemon;
+  source_token.cost = 1;
+  source_token.lid = 2;
+  source_token.rid = 3;
+  std::vector<Token *> source_tokens;
+  source_tokens.push_back(&source_token);
+  text_dict_->CollectTokens(&source_tokens);
+  BuildSystemDictionary(source_tokens, source_tokens.size());
+
+  Token target_token = source_token;
+  target_token.key.swap(target_token.value);
+
+  unique_ptr<SystemDictionary> system_dic(
+      SystemDictionary::Builder(dic_fn_).Build());
+  ASSERT_TRUE(system_dic.get() != NULL)
+      << "Failed to open dictionary source:" << dic_fn_;
+  // The outer call covers the whole batch, and the inner one covers a part
+  // of it as done for each sentence.
+  system_dic->PopulateReverseLookupCache("abc" + kDoraemon);
+  system_dic->PopulateReverseLookupCache(kDoraemon);
+  system_dic->ClearReverseLookupCache();
+  {
+    // The cache is kept until the outer call is cleared.
+    CheckTokenExistenceCallback callback(&target_token);
+    system_dic->LookupReverse(kDoraemon, convreq_, &callback);
+    EXPECT_TRUE(callback.found())
+        << "Could not find " << PrintToken(source_token);
+  }
+  system_dic->ClearReverseLookupCache();
+  {
+    CheckTokenExistenceCallback callback(&target_token);
+    system_dic->LookupReverse(kDoraemon, convreq_, &callback);
+    EXPECT_TRUE(callback.found())
+        << "Could not find " << PrintToken(source_token);
+  }
+}
+
 TEST_F(SystemDictionaryTest, SpellingCorrectionTokens) {
   std::vector<Token> tokens(3);
 
@@ -99,6 +99,22 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'system_dictionary_benchmark',
+      'type': 'executable',
+      'sources': [
+        'system_dictionary_benchmark.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../base/base.gyp:base_core',
+        '../../data_manager/oss/oss_data_manager.gyp:oss_data_manager',
+        '../../protocol/protocol.gyp:commands_proto',
+        '../../protocol/protocol.gyp:config_proto',
+        '../../request/request.gyp:conversion_request',
+        'system_dictionary.gyp:system_dictionary',
+      ],
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'system_dictionary_all_test',
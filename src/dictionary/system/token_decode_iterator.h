@@ -53,7 +53,20 @@ class TokenDecodeIterator {
                       const uint8 *ptr);
   ~TokenDecodeIterator() {}
 
-  const TokenInfo& Get() const { return token_info_; }
+  // Returns the current token with TokenInfo::token materialized.  The
+  // token's strings are copied from the decode buffers on the first call for
+  // each token, so prefer GetView() when the strings are only read.
+  const TokenInfo &Get();
+
+  // Returns the current token as a view into the decode buffers of this
+  // iterator, which is valid until Next() is called.  The other fields of
+  // TokenInfo are available from GetInfo().
+  const TokenView &GetView() const { return token_view_; }
+
+  // Returns the current TokenInfo.  Unlike Get(), TokenInfo::token may hold
+  // the strings of a previous token; use GetView() for the key and value.
+  const TokenInfo &GetInfo() const { return token_info_; }
+
   bool Done() const { return state_ == DONE; }
   void Next();
 
@@ -64,6 +77,10 @@ class TokenDecodeIterator {
     DONE,
   };
 
+  // The number of tokens decoded at once by the codec.  Most of the keys
+  // have fewer tokens.
+  static const int kBlockSize = 16;
+
   void NextInternal();
 
   void LookupValue(int id, string *value) const {
@@ -79,12 +96,24 @@ class TokenDecodeIterator {
   const StringPiece key_;
   // Katakana key will be lazily initialized.
   string key_katakana_;
+  // Holds the value looked up from |value_trie_|.
+  string value_buffer_;
 
   State state_;
   const uint8 *ptr_;
 
+  // Tokens decoded by the last DecodeTokenBlock() call.
+  DecodedTokenFields fields_[kBlockSize];
+  int num_fields_;
+  int field_index_;
+  bool is_last_block_;
+
   TokenInfo token_info_;
+  TokenView token_view_;
+  // Materialized lazily by Get().
   Token token_;
+  bool is_token_key_filled_;
+  bool is_token_filled_;
 
   DISALLOW_COPY_AND_ASSIGN(TokenDecodeIterator);
 };
@@ -103,11 +132,33 @@ inline TokenDecodeIterator::TokenDecodeIterator(
       key_(key),
       state_(HAS_NEXT),
       ptr_(ptr),
-      token_info_(nullptr) {
-  key.CopyToString(&token_.key);
+      num_fields_(0),
+      field_index_(0),
+      is_last_block_(false),
+      token_info_(nullptr),
+      is_token_key_filled_(false),
+      is_token_filled_(false) {
+  token_view_.key = key_;
   NextInternal();
 }
 
+inline const TokenInfo &TokenDecodeIterator::Get() {
+  if (!is_token_filled_) {
+    // The key is the same for all the tokens.
+    if (!is_token_key_filled_) {
+      key_.CopyToString(&token_.key);
+      is_token_key_filled_ = true;
+    }
+    token_.value.assign(token_view_.value.data(), token_view_.value.size());
+    token_.cost = token_view_.cost;
+    token_.lid = token_view_.lid;
+    token_.rid = token_view_.rid;
+    token_.attributes = token_view_.attributes;
+    is_token_filled_ = true;
+  }
+  return token_info_;
+}
+
 inline void TokenDecodeIterator::Next() {
   DCHECK_NE(state_, DONE);
   if (state_ == LAST_TOKEN) {
@@ -122,36 +173,53 @@ inline void TokenDecodeIterator::NextInternal() {
   int prev_id_in_value_trie = token_info_.id_in_value_trie;
   token_info_.Clear();
   token_info_.token = &token_;
+  is_token_filled_ = false;
 
-  // Do not clear key in token.
-  token_info_.token->attributes = Token::NONE;
+  token_view_.attributes = Token::NONE;
 
-  // This implementation is depending on the internal behavior of DecodeToken
-  // especially which fields are updated or not. Important fields are:
-  // Token::key, Token::value : key and value are never updated.
-  // Token::cost : always updated.
-  // Token::lid, Token::rid : updated iff the pos_type is neither
+  // Tokens are decoded by blocks so that the codec is called once per
+  // block rather than once per token.  The fields which are not encoded in
+  // the token are inherited from the previous token by not resetting
+  // |token_view_|:
+  // TokenView::key : the key is never updated.
+  // TokenView::value : updated unless the value_type is SAME_AS_PREV_VALUE.
+  // TokenView::cost : always updated.
+  // TokenView::lid, TokenView::rid : updated iff the pos_type is neither
   //   FREQUENT_POS nor SAME_AS_PREV_POS.
-  // Token::attributes : updated iff the value is SPELLING_COLLECTION.
   // TokenInfo::id_in_value_trie : updated iff the value_type is
   //   DEFAULT_VALUE.
-  // Thus, by not-reseting Token instance intentionally, we can skip most
-  //   SAME_AS_PREV operations.
-  // The exception is Token::attributes. It is not-always set, so we need
-  // reset it everytime.
-  // This kind of structure should be packed in the codec or some
-  // related but new class.
-  int read_bytes;
-  if (!codec_->DecodeToken(ptr_, &token_info_, &read_bytes)) {
+  if (field_index_ == num_fields_) {
+    int read_bytes;
+    num_fields_ = codec_->DecodeTokenBlock(ptr_, kBlockSize, fields_,
+                                           &read_bytes, &is_last_block_);
+    DCHECK_GT(num_fields_, 0);
+    ptr_ += read_bytes;
+    field_index_ = 0;
+  }
+  const DecodedTokenFields &fields = fields_[field_index_++];
+  if (is_last_block_ && field_index_ == num_fields_) {
     state_ = LAST_TOKEN;
   }
-  ptr_ += read_bytes;
+
+  if (fields.is_spelling_correction) {
+    token_view_.attributes = Token::SPELLING_CORRECTION;
+  }
+  token_view_.cost = fields.cost;
+  token_info_.pos_type = fields.pos_type;
+  token_info_.value_type = fields.value_type;
+  token_info_.id_in_value_trie = fields.id_in_value_trie;
+  token_info_.id_in_frequent_pos_map = fields.id_in_frequent_pos_map;
+  if (fields.pos_type == TokenInfo::DEFAULT_POS) {
+    token_view_.lid = fields.lid;
+    token_view_.rid = fields.rid;
+  }
 
   // Fill remaining values.
   switch (token_info_.value_type) {
     case TokenInfo::DEFAULT_VALUE: {
-      token_.value.clear();
-      LookupValue(token_info_.id_in_value_trie, &token_.value);
+      value_buffer_.clear();
+      LookupValue(token_info_.id_in_value_trie, &value_buffer_);
+      token_view_.value = value_buffer_;
       break;
     }
     case TokenInfo::SAME_AS_PREV_VALUE: {
@@ -161,14 +229,14 @@ inline void TokenDecodeIterator::NextInternal() {
       break;
     }
     case TokenInfo::AS_IS_HIRAGANA: {
-      token_.value = token_.key;
+      token_view_.value = key_;
       break;
     }
     case TokenInfo::AS_IS_KATAKANA: {
       if (!key_.empty() && key_katakana_.empty()) {
         Util::HiraganaToKatakana(key_, &key_katakana_);
       }
-      token_.value = key_katakana_;
+      token_view_.value = key_katakana_;
       break;
     }
     default: {
@@ -178,14 +246,18 @@ inline void TokenDecodeIterator::NextInternal() {
   }
 
   if (token_info_.accent_encoding_type == TokenInfo::EMBEDDED_IN_TOKEN) {
-    token_.value.append(1, '_')
-                .append(Util::StringPrintf("%d", token_info_.accent_type));
+    if (token_view_.value.data() != value_buffer_.data()) {
+      token_view_.value.CopyToString(&value_buffer_);
+    }
+    value_buffer_.append(1, '_')
+                 .append(Util::StringPrintf("%d", token_info_.accent_type));
+    token_view_.value = value_buffer_;
   }
 
   if (token_info_.pos_type == TokenInfo::FREQUENT_POS) {
     const uint32 pos = frequent_pos_[token_info_.id_in_frequent_pos_map];
-    token_.lid = pos >> 16;
-    token_.rid = pos & 0xffff;
+    token_view_.lid = pos >> 16;
+    token_view_.rid = pos & 0xffff;
   }
 }
 
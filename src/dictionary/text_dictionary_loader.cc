@@ -35,11 +35,15 @@
 
 #include <algorithm>
 #include <limits>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/file_stream.h"
+#include "base/file_util.h"
 #include "base/flags.h"
 #include "base/iterator_adapter.h"
 #include "base/logging.h"
@@ -47,6 +51,7 @@
 #include "base/number_util.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
@@ -58,6 +63,15 @@ namespace mozc {
 namespace dictionary {
 namespace {
 
+// The number of lines read at once when the dictionary files are parsed in
+// parallel.
+const size_t kParseBatchLines = 1 << 18;
+
+// The cost is calculated as -log(prob) * 500.
+// We here assume that the wrong reading appear with 1/100 probability
+// of the original (correct) reading.
+const int kReadingCorrectionCostPenalty = 2302;  // -log(1/100) * 500;
+
 // Functor to sort a sequence of Tokens first by value and then by key.
 struct OrderByValueThenByKey {
   bool operator()(const Token *l, const Token *r) const {
@@ -105,6 +119,50 @@ inline bool SafeStrToInt(StringPiece s, int *n) {
   return ret;
 }
 
+// Orders tokens by key.  Used with stable sort so that the tokens with the
+// same key keep their order.
+struct OrderByKey {
+  bool operator()(const std::unique_ptr<Token> &l,
+                  const std::unique_ptr<Token> &r) const {
+    return l->key < r->key;
+  }
+};
+
+// Writes |token| to a temporary run file.  The format is only read by
+// ReadTokenRecord() in the same process.
+void WriteTokenRecord(const Token &token, std::ostream *os) {
+  const uint32 key_size = token.key.size();
+  const uint32 value_size = token.value.size();
+  const int32 fields[3] = {token.cost, token.lid, token.rid};
+  os->write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+  os->write(token.key.data(), key_size);
+  os->write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+  os->write(token.value.data(), value_size);
+  os->write(reinterpret_cast<const char *>(fields), sizeof(fields));
+  os->write(reinterpret_cast<const char *>(&token.attributes),
+            sizeof(token.attributes));
+}
+
+bool ReadTokenRecord(std::istream *is, Token *token) {
+  uint32 key_size = 0, value_size = 0;
+  int32 fields[3];
+  if (!is->read(reinterpret_cast<char *>(&key_size), sizeof(key_size))) {
+    return false;
+  }
+  token->key.resize(key_size);
+  is->read(&token->key[0], key_size);
+  is->read(reinterpret_cast<char *>(&value_size), sizeof(value_size));
+  token->value.resize(value_size);
+  is->read(&token->value[0], value_size);
+  is->read(reinterpret_cast<char *>(fields), sizeof(fields));
+  is->read(reinterpret_cast<char *>(&token->attributes),
+           sizeof(token->attributes));
+  token->cost = fields[0];
+  token->lid = fields[1];
+  token->rid = fields[2];
+  return !is->fail();
+}
+
 // Helper functions to get const iterators.
 inline std::vector<Token *>::const_iterator CBegin(
     const std::vector<Token *> &tokens) {
@@ -118,13 +176,42 @@ inline std::vector<Token *>::const_iterator CEnd(
 
 }  // namespace
 
+class TextDictionaryLoader::ParseThread : public Thread {
+ public:
+  ParseThread(const TextDictionaryLoader *loader,
+              const std::vector<string> *lines, size_t begin, size_t end,
+              std::vector<Token *> *tokens)
+      : loader_(loader), lines_(lines), begin_(begin), end_(end),
+        tokens_(tokens) {}
+
+  void Run() override {
+    for (size_t i = begin_; i < end_; ++i) {
+      Token *token = loader_->ParseTSVLine((*lines_)[i]);
+      if (token) {
+        tokens_->push_back(token);
+      }
+    }
+  }
+
+ private:
+  const TextDictionaryLoader *loader_;
+  const std::vector<string> *lines_;
+  const size_t begin_;
+  const size_t end_;
+  std::vector<Token *> *tokens_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParseThread);
+};
+
 TextDictionaryLoader::TextDictionaryLoader(const POSMatcher &pos_matcher)
     : zipcode_id_(pos_matcher.GetZipcodeId()),
-      isolated_word_id_(pos_matcher.GetIsolatedWordId()) {}
+      isolated_word_id_(pos_matcher.GetIsolatedWordId()),
+      num_threads_(1) {}
 
 TextDictionaryLoader::TextDictionaryLoader(uint16 zipcode_id,
                                            uint16 isolated_word_id)
-    : zipcode_id_(zipcode_id), isolated_word_id_(isolated_word_id) {}
+    : zipcode_id_(zipcode_id), isolated_word_id_(isolated_word_id),
+      num_threads_(1) {}
 
 TextDictionaryLoader::~TextDictionaryLoader() {
   Clear();
@@ -175,7 +262,22 @@ void TextDictionaryLoader::LoadWithLineLimit(
   }
 
   // Read system dictionary.
-  {
+  if (num_threads_ > 1 && limit == std::numeric_limits<int>::max()) {
+    InputMultiFile file(dictionary_filename);
+    std::vector<string> lines;
+    lines.reserve(kParseBatchLines);
+    string line;
+    while (file.ReadLine(&line)) {
+      Util::ChopReturns(&line);
+      lines.push_back(line);
+      if (lines.size() == kParseBatchLines) {
+        ParseLinesInParallel(lines);
+        lines.clear();
+      }
+    }
+    ParseLinesInParallel(lines);
+    LOG(INFO) << tokens_.size() << " tokens from " << dictionary_filename;
+  } else {
     InputMultiFile file(dictionary_filename);
     string line;
     while (limit > 0 && file.ReadLine(&line)) {
@@ -214,6 +316,29 @@ void TextDictionaryLoader::LoadWithLineLimit(
   }
 }
 
+void TextDictionaryLoader::ParseLinesInParallel(
+    const std::vector<string> &lines) {
+  const size_t num_threads = num_threads_;
+  std::vector<std::vector<Token *>> shard_tokens(num_threads);
+  std::vector<std::unique_ptr<ParseThread>> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(new ParseThread(
+        this, &lines, lines.size() * i / num_threads,
+        lines.size() * (i + 1) / num_threads, &shard_tokens[i]));
+    threads.back()->SetJoinable(true);
+    threads.back()->Start("TextDictionaryLoader");
+  }
+  ParseThread(this, &lines, 0, lines.size() / num_threads,
+              &shard_tokens[0]).Run();
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    tokens_.insert(tokens_.end(), shard_tokens[i].begin(),
+                   shard_tokens[i].end());
+  }
+}
+
 // Loads reading correction data into |tokens|.  The second argument is used to
 // determine costs of reading correction tokens and must be sorted by
 // OrderByValueThenByKey().  The output tokens are newly allocated and the
@@ -277,16 +402,12 @@ void TextDictionaryLoader::LoadReadingCorrectionTokens(
       }
     }
 
-    // The cost is calculated as -log(prob) * 500.
-    // We here assume that the wrong reading appear with 1/100 probability
-    // of the original (correct) reading.
-    const int kCostPenalty = 2302;      // -log(1/100) * 500;
     std::unique_ptr<Token> token(new Token);
     value_key.second.CopyToString(&token->key);
     token->value = max_cost_token->value;
     token->lid = max_cost_token->lid;
     token->rid = max_cost_token->rid;
-    token->cost = max_cost_token->cost + kCostPenalty;
+    token->cost = max_cost_token->cost + kReadingCorrectionCostPenalty;
     // We don't set SPELLING_CORRECTION. The entries in reading_correction
     // data are also stored in rewriter/correction_rewriter.cc.
     // reading_correction_rewriter annotates the spelling correction
@@ -302,6 +423,318 @@ void TextDictionaryLoader::LoadReadingCorrectionTokens(
             << reading_correction_filename;
 }
 
+// A sequence of tokens sorted by key.
+class TextDictionaryLoader::TokenSource {
+ public:
+  virtual ~TokenSource() {}
+
+  // Returns the current token, or nullptr if the source is exhausted.
+  const Token *Peek() const {
+    return current_.get();
+  }
+
+  // Returns the current token and moves to the next one.
+  std::unique_ptr<Token> Pop() {
+    std::unique_ptr<Token> token(std::move(current_));
+    Advance();
+    return token;
+  }
+
+ protected:
+  // Sets |current_| to the next token, or nullptr at the end.
+  virtual void Advance() = 0;
+
+  std::unique_ptr<Token> current_;
+};
+
+// Parses a dictionary file which is already sorted by key.
+class TextDictionaryLoader::SortedFileTokenSource : public TokenSource {
+ public:
+  SortedFileTokenSource(const TextDictionaryLoader *loader,
+                        const string &filename)
+      : loader_(loader), file_(filename) {
+    Advance();
+  }
+
+ protected:
+  void Advance() override {
+    current_.reset();
+    string line;
+    while (file_.ReadLine(&line)) {
+      Util::ChopReturns(&line);
+      current_.reset(loader_->ParseTSVLine(line));
+      if (current_) {
+        return;
+      }
+    }
+  }
+
+ private:
+  const TextDictionaryLoader *loader_;
+  InputMultiFile file_;
+
+  DISALLOW_COPY_AND_ASSIGN(SortedFileTokenSource);
+};
+
+// Reads a sorted run written by WriteTokenRecord().  The file is removed on
+// destruction.
+class TextDictionaryLoader::RunFileTokenSource : public TokenSource {
+ public:
+  explicit RunFileTokenSource(const string &filename)
+      : filename_(filename),
+        stream_(filename.c_str(), std::ios::in | std::ios::binary) {
+    Advance();
+  }
+
+  ~RunFileTokenSource() override {
+    stream_.close();
+    FileUtil::Unlink(filename_);
+  }
+
+ protected:
+  void Advance() override {
+    current_.reset(new Token);
+    if (!ReadTokenRecord(&stream_, current_.get())) {
+      current_.reset();
+    }
+  }
+
+ private:
+  const string filename_;
+  InputFileStream stream_;
+
+  DISALLOW_COPY_AND_ASSIGN(RunFileTokenSource);
+};
+
+// Takes the ownership of tokens sorted by key.
+class TextDictionaryLoader::VectorTokenSource : public TokenSource {
+ public:
+  explicit VectorTokenSource(std::vector<std::unique_ptr<Token>> *tokens)
+      : index_(0) {
+    tokens_.swap(*tokens);
+    Advance();
+  }
+
+ protected:
+  void Advance() override {
+    if (index_ < tokens_.size()) {
+      current_ = std::move(tokens_[index_++]);
+    } else {
+      current_.reset();
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<Token>> tokens_;
+  size_t index_;
+
+  DISALLOW_COPY_AND_ASSIGN(VectorTokenSource);
+};
+
+bool TextDictionaryLoader::LoadSortedByKey(
+    const string &dictionary_filename,
+    const string &reading_correction_filename,
+    size_t max_tokens_in_memory,
+    const string &temp_file_prefix,
+    KeyGroupCallback *callback) const {
+  CHECK_GT(max_tokens_in_memory, 0);
+  DCHECK(callback);
+
+  bool is_sorted = false;
+  std::vector<std::unique_ptr<Token>> corrections;
+  ScanDictionary(dictionary_filename, reading_correction_filename,
+                 &is_sorted, &corrections);
+
+  std::vector<std::unique_ptr<TokenSource>> sources;
+  if (is_sorted) {
+    sources.emplace_back(new SortedFileTokenSource(this, dictionary_filename));
+  } else {
+    // External merge sort: sort runs of tokens in memory and spill them to
+    // files unless all the tokens fit in one run.
+    InputMultiFile file(dictionary_filename);
+    std::vector<std::unique_ptr<Token>> run;
+    std::vector<string> run_files;
+    string line;
+    while (true) {
+      const bool has_line = file.ReadLine(&line);
+      if (has_line) {
+        Util::ChopReturns(&line);
+        Token *token = ParseTSVLine(line);
+        if (token) {
+          run.emplace_back(token);
+        }
+        if (run.size() < max_tokens_in_memory) {
+          continue;
+        }
+      }
+      std::stable_sort(run.begin(), run.end(), OrderByKey());
+      if (!has_line && run_files.empty()) {
+        sources.emplace_back(new VectorTokenSource(&run));
+        break;
+      }
+      if (!run.empty()) {
+        const string filename =
+            temp_file_prefix + NumberUtil::SimpleItoa(
+                static_cast<uint32>(run_files.size()));
+        OutputFileStream ofs(filename.c_str(),
+                             std::ios::out | std::ios::binary);
+        for (size_t i = 0; i < run.size(); ++i) {
+          WriteTokenRecord(*run[i], &ofs);
+        }
+        ofs.close();
+        run_files.push_back(filename);
+        if (ofs.fail()) {
+          LOG(ERROR) << "Cannot write a temporary file: " << filename;
+          for (size_t i = 0; i < run_files.size(); ++i) {
+            FileUtil::Unlink(run_files[i]);
+          }
+          return false;
+        }
+        run.clear();
+      }
+      if (!has_line) {
+        break;
+      }
+    }
+    VLOG(1) << run_files.size() << " runs are spilled for "
+            << dictionary_filename;
+    for (size_t i = 0; i < run_files.size(); ++i) {
+      sources.emplace_back(new RunFileTokenSource(run_files[i]));
+    }
+  }
+  if (!corrections.empty()) {
+    sources.emplace_back(new VectorTokenSource(&corrections));
+  }
+  MergeTokenSources(sources, callback);
+  return true;
+}
+
+void TextDictionaryLoader::ScanDictionary(
+    const string &dictionary_filename,
+    const string &reading_correction_filename,
+    bool *is_sorted,
+    std::vector<std::unique_ptr<Token>> *corrections) const {
+  // Reading correction entries as pairs of value and key.
+  std::vector<std::pair<string, string>> correction_entries;
+  if (!reading_correction_filename.empty()) {
+    InputMultiFile file(reading_correction_filename);
+    string line;
+    while (file.ReadLine(&line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      Util::ChopReturns(&line);
+      std::pair<StringPiece, StringPiece> value_key;
+      ParseReadingCorrectionTSV(line, &value_key);
+      correction_entries.push_back(std::make_pair(
+          value_key.first.as_string(), value_key.second.as_string()));
+    }
+  }
+
+  // For each value of the reading corrections, the token having the maximum
+  // cost is kept.  The ties are broken by key as LoadReadingCorrectionTokens()
+  // does.  Also the value-key pairs found in the system dictionary are
+  // collected to filter the reading corrections.
+  std::map<string, std::unique_ptr<Token>> max_cost_tokens;
+  const std::set<std::pair<string, string>> correction_pairs(
+      correction_entries.begin(), correction_entries.end());
+  std::set<std::pair<string, string>> existing_pairs;
+  for (size_t i = 0; i < correction_entries.size(); ++i) {
+    max_cost_tokens[correction_entries[i].first];
+  }
+
+  *is_sorted = true;
+  InputMultiFile file(dictionary_filename);
+  string line, prev_key;
+  size_t num_tokens = 0;
+  while (file.ReadLine(&line)) {
+    Util::ChopReturns(&line);
+    std::unique_ptr<Token> token(ParseTSVLine(line));
+    if (!token) {
+      continue;
+    }
+    if (num_tokens++ > 0 && token->key < prev_key) {
+      *is_sorted = false;
+    }
+    prev_key = token->key;
+    if (max_cost_tokens.empty()) {
+      continue;
+    }
+    auto iter = max_cost_tokens.find(token->value);
+    if (iter == max_cost_tokens.end()) {
+      continue;
+    }
+    const std::pair<string, string> value_key(token->value, token->key);
+    if (correction_pairs.count(value_key) > 0) {
+      existing_pairs.insert(value_key);
+    }
+    const Token *max_cost_token = iter->second.get();
+    if (max_cost_token == nullptr || token->cost > max_cost_token->cost ||
+        (token->cost == max_cost_token->cost &&
+         token->key < max_cost_token->key)) {
+      iter->second = std::move(token);
+    }
+  }
+  LOG(INFO) << num_tokens << " tokens from " << dictionary_filename;
+
+  corrections->clear();
+  for (size_t i = 0; i < correction_entries.size(); ++i) {
+    const std::pair<string, string> &value_key = correction_entries[i];
+    if (existing_pairs.count(value_key) > 0) {
+      VLOG(1) << "System dictionary has the same key-value: "
+              << value_key.second << "\t" << value_key.first;
+      continue;
+    }
+    const Token *max_cost_token = max_cost_tokens[value_key.first].get();
+    if (max_cost_token == nullptr) {
+      VLOG(1) << "Cannot find the value in system dicitonary - ignored:"
+              << value_key.first;
+      continue;
+    }
+    std::unique_ptr<Token> token(new Token);
+    token->key = value_key.second;
+    token->value = max_cost_token->value;
+    token->lid = max_cost_token->lid;
+    token->rid = max_cost_token->rid;
+    token->cost = max_cost_token->cost + kReadingCorrectionCostPenalty;
+    token->attributes = Token::NONE;
+    corrections->push_back(std::move(token));
+  }
+  std::stable_sort(corrections->begin(), corrections->end(), OrderByKey());
+  LOG(INFO) << corrections->size() << " tokens from "
+            << reading_correction_filename;
+}
+
+// static
+void TextDictionaryLoader::MergeTokenSources(
+    const std::vector<std::unique_ptr<TokenSource>> &sources,
+    KeyGroupCallback *callback) {
+  std::vector<std::unique_ptr<Token>> group;
+  while (true) {
+    size_t min_index = sources.size();
+    for (size_t i = 0; i < sources.size(); ++i) {
+      const Token *token = sources[i]->Peek();
+      if (token != nullptr &&
+          (min_index == sources.size() ||
+           token->key < sources[min_index]->Peek()->key)) {
+        min_index = i;
+      }
+    }
+    if (min_index == sources.size()) {
+      break;
+    }
+    if (!group.empty() &&
+        group.front()->key != sources[min_index]->Peek()->key) {
+      callback->OnKeyGroup(&group);
+      group.clear();
+    }
+    group.push_back(sources[min_index]->Pop());
+  }
+  if (!group.empty()) {
+    callback->OnKeyGroup(&group);
+  }
+}
+
 void TextDictionaryLoader::Clear() {
   STLDeleteElements(&tokens_);
 }
@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_TEXT_DICTIONARY_LOADER_H_
 #define MOZC_DICTIONARY_TEXT_DICTIONARY_LOADER_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -46,6 +47,17 @@ class POSMatcher;
 
 class TextDictionaryLoader {
  public:
+  // Receives the tokens streamed by LoadSortedByKey().
+  class KeyGroupCallback {
+   public:
+    virtual ~KeyGroupCallback() {}
+
+    // Called for each key in ascending order.  |tokens| is the nonempty list
+    // of the tokens with the key.  The callee may take the ownership of the
+    // tokens; the remaining ones are deleted after the call.
+    virtual void OnKeyGroup(std::vector<std::unique_ptr<Token>> *tokens) = 0;
+  };
+
   // TODO(noriyukit): Better to pass the pointer of pos_matcher.
   explicit TextDictionaryLoader(const POSMatcher& pos_matcher);
   TextDictionaryLoader(uint16 zipcode_id, uint16 isolated_word_id);
@@ -66,9 +78,32 @@ class TextDictionaryLoader {
                          const string &reading_correction_filename,
                          int limit);
 
+  // Streams the tokens in system dictionary files and reading correction
+  // files to |callback| grouped by key, without holding all the tokens in
+  // memory.  The file names are the same as Load().  For each key, the tokens
+  // from the system dictionary come first in the input order, followed by
+  // the reading correction tokens.  If the dictionary isn't sorted by key,
+  // runs of at most |max_tokens_in_memory| tokens are sorted and spilled to
+  // the files named |temp_file_prefix| followed by the run number, and then
+  // merged.  The tokens loaded by Load() are not touched.  Returns false if a
+  // temporary file cannot be written.
+  bool LoadSortedByKey(const string &dictionary_filename,
+                       const string &reading_correction_filename,
+                       size_t max_tokens_in_memory,
+                       const string &temp_file_prefix,
+                       KeyGroupCallback *callback) const;
+
   // Clears the loaded tokens.
   void Clear();
 
+  // Sets the number of threads used to parse the system dictionary files in
+  // Load().  The loaded tokens and their order don't depend on this number.
+  // LoadWithLineLimit() with a non-negative |limit| always parses on the
+  // calling thread.
+  void set_num_threads(int num_threads) {
+    num_threads_ = num_threads;
+  }
+
   // Adds a token.  The ownership is taken by the loader.
   void AddToken(Token *token) {
     tokens_.push_back(token);
@@ -88,6 +123,29 @@ class TextDictionaryLoader {
   virtual Token *ParseTSV(const std::vector<StringPiece> &columns) const;
 
  private:
+  class ParseThread;
+  class TokenSource;
+  class SortedFileTokenSource;
+  class RunFileTokenSource;
+  class VectorTokenSource;
+
+  // Reads |dictionary_filename| once to check if the tokens are sorted by key
+  // and to create the reading correction tokens, which are sorted by key.
+  void ScanDictionary(const string &dictionary_filename,
+                      const string &reading_correction_filename,
+                      bool *is_sorted,
+                      std::vector<std::unique_ptr<Token>> *corrections) const;
+
+  // Merges |sources| ordered by key and passes the groups to |callback|.
+  // Ties are broken by the index of the source.
+  static void MergeTokenSources(
+      const std::vector<std::unique_ptr<TokenSource>> &sources,
+      KeyGroupCallback *callback);
+
+  // Parses |lines| in parallel and appends the tokens to |tokens_| in the
+  // order of the lines.
+  void ParseLinesInParallel(const std::vector<string> &lines);
+
   static void LoadReadingCorrectionTokens(
       const string &reading_correction_filename,
       const std::vector<Token *> &ref_sorted_tokens,
@@ -106,6 +164,7 @@ class TextDictionaryLoader {
 
   const uint16 zipcode_id_;
   const uint16 isolated_word_id_;
+  int num_threads_;
   std::vector<Token *> tokens_;
 
   FRIEND_TEST(TextDictionaryLoaderTest, RewriteSpecialTokenTest);
@@ -27,12 +27,14 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/number_util.h"
 #include "base/util.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_token.h"
@@ -56,6 +58,30 @@ const char kReadingCorrectionLines[] =
     "bar\tfoo\tfoo_correct\n"
     "foobar\tfoobar_error\tfoobar_correct\n";
 
+bool KeyLess(const Token *l, const Token *r) {
+  return l->key < r->key;
+}
+
+// Collects the tokens streamed by LoadSortedByKey().
+class CollectKeyGroupCallback : public TextDictionaryLoader::KeyGroupCallback {
+ public:
+  void OnKeyGroup(std::vector<std::unique_ptr<Token>> *tokens) override {
+    ASSERT_FALSE(tokens->empty());
+    if (!tokens_.empty()) {
+      EXPECT_LT(tokens_.back().key, tokens->front()->key);
+    }
+    for (size_t i = 0; i < tokens->size(); ++i) {
+      EXPECT_EQ(tokens->front()->key, (*tokens)[i]->key);
+      tokens_.push_back(*(*tokens)[i]);
+    }
+  }
+
+  const std::vector<Token> &tokens() const { return tokens_; }
+
+ private:
+  std::vector<Token> tokens_;
+};
+
 }  // namespace
 
 class TextDictionaryLoaderTest : public ::testing::Test {
@@ -233,6 +259,108 @@ TEST_F(TextDictionaryLoaderTest, LoadMultipleFilesTest) {
   FileUtil::Unlink(filename2);
 }
 
+TEST_F(TextDictionaryLoaderTest, LoadInParallelTest) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.tsv");
+  {
+    OutputFileStream ofs(filename.c_str());
+    for (int i = 0; i < 1000; ++i) {
+      ofs << "key" << i << "\t0\t0\t" << i << "\tvalue" << i << "\n";
+    }
+  }
+
+  unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
+  loader->Load(filename, "");
+  ASSERT_EQ(1000, loader->tokens().size());
+
+  for (int num_threads = 2; num_threads <= 7; ++num_threads) {
+    unique_ptr<TextDictionaryLoader> parallel_loader(
+        CreateTextDictionaryLoader());
+    parallel_loader->set_num_threads(num_threads);
+    parallel_loader->Load(filename, "");
+    ASSERT_EQ(loader->tokens().size(), parallel_loader->tokens().size());
+    for (size_t i = 0; i < loader->tokens().size(); ++i) {
+      EXPECT_EQ(loader->tokens()[i]->key, parallel_loader->tokens()[i]->key);
+      EXPECT_EQ(loader->tokens()[i]->value,
+                parallel_loader->tokens()[i]->value);
+      EXPECT_EQ(loader->tokens()[i]->cost,
+                parallel_loader->tokens()[i]->cost);
+    }
+  }
+
+  FileUtil::Unlink(filename);
+}
+
+TEST_F(TextDictionaryLoaderTest, LoadSortedByKeyTest) {
+  const string filename = FileUtil::JoinPath(FLAGS_test_tmpdir, "test.tsv");
+  const string reading_correction_filename =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "reading_correction.tsv");
+  const string temp_file_prefix =
+      FileUtil::JoinPath(FLAGS_test_tmpdir, "test.run");
+  {
+    // Three tokens for each of 100 keys in an unsorted order.
+    OutputFileStream ofs(filename.c_str());
+    for (int i = 0; i < 300; ++i) {
+      ofs << "key" << (i * 37 % 100) << "\t1\t2\t" << i
+          << "\tvalue" << i << "\n";
+    }
+  }
+  {
+    OutputFileStream ofs(reading_correction_filename.c_str());
+    ofs << "value5\tkey5_error\tkey5\n"
+        << "value0\tkey0\tkey0\n"  // Already in the dictionary.
+        << "unknown\tunknown_error\tunknown\n";  // Value not found.
+  }
+
+  unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
+  loader->Load(filename, "");
+  std::vector<Token *> expected = loader->tokens();
+  std::stable_sort(expected.begin(), expected.end(), KeyLess);
+
+  // The first one spills runs to files and the second one sorts in memory.
+  const size_t kMaxTokensInMemory[] = {7, 1000};
+  for (size_t i = 0; i < arraysize(kMaxTokensInMemory); ++i) {
+    CollectKeyGroupCallback callback;
+    ASSERT_TRUE(loader->LoadSortedByKey(filename, reading_correction_filename,
+                                        kMaxTokensInMemory[i],
+                                        temp_file_prefix, &callback));
+    const std::vector<Token> &actual = callback.tokens();
+    ASSERT_EQ(expected.size() + 1, actual.size());
+    size_t expected_index = 0;
+    for (size_t j = 0; j < actual.size(); ++j) {
+      if (actual[j].key == "key5_error") {
+        EXPECT_EQ("value5", actual[j].value);
+        EXPECT_EQ(1, actual[j].lid);
+        EXPECT_EQ(2, actual[j].rid);
+        EXPECT_EQ(5 + 2302, actual[j].cost);
+        continue;
+      }
+      const Token &token = *expected[expected_index++];
+      EXPECT_EQ(token.key, actual[j].key);
+      EXPECT_EQ(token.value, actual[j].value);
+      EXPECT_EQ(token.cost, actual[j].cost);
+    }
+    EXPECT_FALSE(FileUtil::FileExists(temp_file_prefix + "0"));
+  }
+
+  // Sorted input is streamed without runs.
+  {
+    OutputFileStream ofs(filename.c_str());
+    ofs << "a\t1\t2\t3\tA\n"
+        << "a\t1\t2\t4\tB\n"
+        << "b\t1\t2\t5\tC\n";
+  }
+  CollectKeyGroupCallback callback;
+  ASSERT_TRUE(loader->LoadSortedByKey(filename, "", 1, temp_file_prefix,
+                                      &callback));
+  ASSERT_EQ(3, callback.tokens().size());
+  EXPECT_EQ("A", callback.tokens()[0].value);
+  EXPECT_EQ("B", callback.tokens()[1].value);
+  EXPECT_EQ("C", callback.tokens()[2].value);
+
+  FileUtil::Unlink(filename);
+  FileUtil::Unlink(reading_correction_filename);
+}
+
 TEST_F(TextDictionaryLoaderTest, ReadingCorrectionTest) {
   unique_ptr<TextDictionaryLoader> loader(CreateTextDictionaryLoader());
 
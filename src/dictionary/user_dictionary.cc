@@ -34,6 +34,8 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/compiler_specific.h"
 #include "base/file_util.h"
@@ -52,31 +54,17 @@
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
 #include "protocol/config.pb.h"
+#include "storage/louds/louds_trie.h"
+#include "storage/louds/louds_trie_builder.h"
 #include "usage_stats/usage_stats.h"
 
 namespace mozc {
 namespace dictionary {
-namespace {
-
-struct OrderByKey {
-  bool operator()(const UserPOS::Token *token, StringPiece key) const {
-    return token->key < key;
-  }
 
-  bool operator()(StringPiece key, const UserPOS::Token *token) const {
-    return key < token->key;
-  }
-};
+using ::mozc::storage::louds::LoudsTrie;
+using ::mozc::storage::louds::LoudsTrieBuilder;
 
-struct OrderByKeyPrefix {
-  bool operator()(const UserPOS::Token *token, StringPiece prefix) const {
-    return StringPiece(token->key).substr(0, prefix.size()) < prefix;
-  }
-
-  bool operator()(StringPiece prefix, const UserPOS::Token *token) const {
-    return prefix < StringPiece(token->key).substr(0, prefix.size());
-  }
-};
+namespace {
 
 struct OrderByKeyThenById {
   bool operator()(const UserPOS::Token *lhs, const UserPOS::Token *rhs) const {
@@ -135,12 +123,49 @@ class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
   void Clear() {
     STLDeleteElements(this);
     clear();
+    key_trie_.Close();
+    key_trie_image_.clear();
+    token_ranges_.clear();
+    entry_tokens_.clear();
+  }
+
+  // Returns the bytes of the tokens and the indices.
+  size_t GetAllocatedBytes() const {
+    size_t bytes = capacity() * sizeof(UserPOS::Token *) +
+                   size() * sizeof(UserPOS::Token) +
+                   MemoryStats::GetHeapBytes(key_trie_image_) +
+                   token_ranges_.capacity() * sizeof(token_ranges_[0]) +
+                   entry_tokens_.capacity() * sizeof(EntryToken);
+    for (const UserPOS::Token *token : *this) {
+      bytes += MemoryStats::GetHeapBytes(token->key) +
+               MemoryStats::GetHeapBytes(token->value) +
+               MemoryStats::GetHeapBytes(token->comment);
+    }
+    return bytes;
+  }
+
+  // Trie of the keys of the tokens.  Since the tokens are sorted by key, the
+  // tokens for a key are in the range returned by GetTokenRange() for the key
+  // id in this trie.
+  const LoudsTrie &key_trie() const { return key_trie_; }
+
+  std::pair<const_iterator, const_iterator> GetTokenRange(int key_id) const {
+    DCHECK_GE(key_id, 0);
+    DCHECK_LT(static_cast<size_t>(key_id), token_ranges_.size());
+    return std::make_pair(begin() + token_ranges_[key_id].first,
+                          begin() + token_ranges_[key_id].second);
   }
 
-  void Load(const user_dictionary::UserDictionaryStorage &storage) {
+  // Loads the tokens from |storage|.  If |reusable_tokens| is not null, the
+  // tokens of the entries which haven't changed since |reusable_tokens| was
+  // loaded are copied from it instead of being expanded again, so that only
+  // the added and edited entries are processed.
+  void Load(const user_dictionary::UserDictionaryStorage &storage,
+            const TokensIndex *reusable_tokens) {
     Clear();
     std::set<uint64> seen;
     std::vector<UserPOS::Token> tokens;
+    size_t num_reused_entries = 0;
 
     if (!suppression_dictionary_->IsLocked()) {
       LOG(ERROR) << "SuppressionDictionary must be locked first";
@@ -158,18 +183,6 @@ class UserDictionary::TokensIndex : public std::vector<UserPOS::Token *> {
         const UserDictionaryStorage::UserDictionaryEntry &entry =
             dic.entries(j);
 
-        if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
-          continue;
-        }
-
-        string tmp, reading;
-        UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
-
-        // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
-        // because the normalization is user-visible.
-        // http://b/2480844
-        Util::NormalizeVoicedSoundMark(tmp, &reading);
-
         DCHECK_LE(0, entry.pos());
 MOZC_CLANG_PUSH_WARNING();
 #if MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
@@ -177,11 +190,38 @@ MOZC_CLANG_DISABLE_WARNING(tautological-constant-out-of-range-compare);
 #endif  // MOZC_CLANG_HAS_WARNING(tautological-constant-out-of-range-compare)
         DCHECK_LE(entry.pos(), 255);
 MOZC_CLANG_POP_WARNING();
-        const uint64 fp = Hash::Fingerprint(reading +
-                                            "\t" +
-                                            entry.value() +
-                                            "\t" +
-                                            static_cast<char>(entry.pos()));
+        const uint64 entry_fp =
+            Hash::Fingerprint(entry.key() + "\t" + entry.value() + "\t" +
+                              static_cast<char>(entry.pos()) + "\t" +
+                              entry.comment());
+        EntryTokenRange reused_range;
+        const bool is_reused =
+            reusable_tokens != nullptr &&
+            reusable_tokens->FindEntryTokens(entry_fp, &reused_range);
+
+        uint64 fp = 0;
+        string reading;
+        if (is_reused) {
+          // The entry was valid when it was loaded.
+          fp = reused_range.first->dedup_fp;
+        } else {
+          if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
+            continue;
+          }
+
+          string tmp;
+          UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
+
+          // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
+          // because the normalization is user-visible.
+          // http://b/2480844
+          Util::NormalizeVoicedSoundMark(tmp, &reading);
+          fp = Hash::Fingerprint(reading +
+                                 "\t" +
+                                 entry.value() +
+                                 "\t" +
+                                 static_cast<char>(entry.pos()));
+        }
         if (!seen.insert(fp).second) {
           VLOG(1) << "Found dup item";
           continue;
@@ -190,6 +230,13 @@ MOZC_CLANG_POP_WARNING();
         // "抑制単語"
         if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
           suppression_dictionary_->AddEntry(reading, entry.value());
+        } else if (is_reused) {
+          for (auto it = reused_range.first; it != reused_range.second; ++it) {
+            this->push_back(new UserPOS::Token(*it->token));
+            const EntryToken entry_token = {entry_fp, fp, this->back()};
+            entry_tokens_.push_back(entry_token);
+          }
+          ++num_reused_entries;
         } else {
           tokens.clear();
           user_pos_->GetTokens(
@@ -198,6 +245,8 @@ MOZC_CLANG_POP_WARNING();
           for (size_t k = 0; k < tokens.size(); ++k) {
             this->push_back(new UserPOS::Token(tokens[k]));
             Util::StripWhiteSpaces(entry.comment(), &this->back()->comment);
+            const EntryToken entry_token = {entry_fp, fp, this->back()};
+            entry_tokens_.push_back(entry_token);
           }
         }
       }
@@ -205,18 +254,80 @@ MOZC_CLANG_POP_WARNING();
 
     // Sort first by key and then by POS ID.
     std::sort(this->begin(), this->end(), OrderByKeyThenById());
+    BuildKeyTrie();
+    std::stable_sort(entry_tokens_.begin(), entry_tokens_.end(),
+                     OrderByEntryFingerprint());
 
     suppression_dictionary_->UnLock();
 
     VLOG(1) << this->size() << " user dic entries loaded";
+    VLOG(1) << num_reused_entries << " entries reused";
 
     usage_stats::UsageStats::SetInteger("UserRegisteredWord",
                                         static_cast<int>(this->size()));
   }
 
  private:
+  // A token expanded from a storage entry.
+  struct EntryToken {
+    // Fingerprint of the entry as stored.
+    uint64 entry_fp;
+    // Fingerprint of the normalized entry used to remove duplicates.
+    uint64 dedup_fp;
+    const UserPOS::Token *token;
+  };
+  typedef std::vector<EntryToken> EntryTokens;
+  typedef std::pair<EntryTokens::const_iterator, EntryTokens::const_iterator>
+      EntryTokenRange;
+
+  struct OrderByEntryFingerprint {
+    bool operator()(const EntryToken &lhs, const EntryToken &rhs) const {
+      return lhs.entry_fp < rhs.entry_fp;
+    }
+  };
+
+  bool FindEntryTokens(uint64 entry_fp, EntryTokenRange *range) const {
+    const EntryToken target = {entry_fp, 0, nullptr};
+    *range = std::equal_range(entry_tokens_.begin(), entry_tokens_.end(),
+                              target, OrderByEntryFingerprint());
+    return range->first != range->second;
+  }
+
+  void BuildKeyTrie() {
+    if (this->empty()) {
+      return;
+    }
+    LoudsTrieBuilder builder;
+    std::vector<std::pair<uint32, uint32>> ranges;
+    for (size_t begin = 0, end = 0; begin < this->size(); begin = end) {
+      const string &key = (*this)[begin]->key;
+      for (end = begin + 1; end < this->size() && (*this)[end]->key == key;
+           ++end) {}
+      builder.Add(key);
+      ranges.push_back(std::make_pair(begin, end));
+    }
+    builder.Build();
+
+    token_ranges_.resize(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      const int key_id = builder.GetId((*this)[ranges[i].first]->key);
+      DCHECK_GE(key_id, 0);
+      token_ranges_[key_id] = ranges[i];
+    }
+    key_trie_image_ = builder.image();
+    CHECK(key_trie_.Open(
+        reinterpret_cast<const uint8 *>(key_trie_image_.data())));
+  }
+
   const UserPOSInterface *user_pos_;
   SuppressionDictionary *suppression_dictionary_;
+
+  string key_trie_image_;
+  LoudsTrie key_trie_;
+  // Ranges of the tokens indexed by the key id in |key_trie_|.
+  std::vector<std::pair<uint32, uint32>> token_ranges_;
+  // Sorted by the fingerprint of the entry.
+  EntryTokens entry_tokens_;
 };
 
 class UserDictionary::UserDictionaryReloader : public Thread {
@@ -312,8 +423,7 @@ UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
       user_pos_(user_pos),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
-      tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)),
-      mutex_(new ReaderWriterMutex) {
+      tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)) {
   DCHECK(user_pos_.get());
   DCHECK(suppression_dictionary_);
   Reload();
@@ -321,7 +431,6 @@ UserDictionary::UserDictionary(const UserPOSInterface *user_pos,
 
 UserDictionary::~UserDictionary() {
   reloader_->Join();
-  delete tokens_;
 }
 
 bool UserDictionary::HasKey(StringPiece key) const {
@@ -343,42 +452,74 @@ void UserDictionary::LookupPredictive(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
+  scoped_rcu_read_lock l;
+  const TokensIndex *tokens = tokens_.get();
 
   if (key.empty()) {
     VLOG(2) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
     return;
   }
 
-  // Find the starting point of iteration over dictionary contents.
+  const LoudsTrie &trie = tokens->key_trie();
+  LoudsTrie::Node node;
+  if (!trie.Traverse(key, &node)) {
+    return;
+  }
+
+  // Visits |node| and its descendants in depth first order, which is the
+  // lexicographical order of the keys as the edges from a node are sorted by
+  // label.  |stack| holds the nodes to visit next; the siblings of |node|
+  // itself are out of the range.
+  std::vector<LoudsTrie::Node> stack;
+  LoudsTrie::Node child = trie.MoveToFirstChild(node);
+  if (trie.IsValidNode(child)) {
+    stack.push_back(child);
+  }
   Token token;
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKeyPrefix());
-       range.first != range.second; ++range.first) {
-    const UserPOS::Token &user_pos_token = **range.first;
-    switch (callback->OnKey(user_pos_token.key)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_NEXT_KEY:
-      case Callback::TRAVERSE_CULL:
-        continue;
-      default:
-        break;
+  while (true) {
+    if (trie.IsTerminalNode(node)) {
+      const auto range =
+          tokens->GetTokenRange(trie.GetKeyIdOfTerminalNode(node));
+      for (auto it = range.first; it != range.second; ++it) {
+        const UserPOS::Token &user_pos_token = **it;
+        switch (callback->OnKey(user_pos_token.key)) {
+          case Callback::TRAVERSE_DONE:
+            return;
+          case Callback::TRAVERSE_NEXT_KEY:
+          case Callback::TRAVERSE_CULL:
+            continue;
+          default:
+            break;
+        }
+        FillTokenFromUserPOSToken(user_pos_token, &token);
+        // Override POS IDs for suggest only words.
+        if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
+          token.lid = token.rid = pos_matcher_.GetUnknownId();
+        }
+        if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
+            Callback::TRAVERSE_DONE) {
+          return;
+        }
+      }
     }
-    FillTokenFromUserPOSToken(user_pos_token, &token);
-    // Override POS IDs for suggest only words.
-    if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
-      token.lid = token.rid = pos_matcher_.GetUnknownId();
+    if (stack.empty()) {
+      break;
     }
-    if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
-        Callback::TRAVERSE_DONE) {
-      return;
+    node = stack.back();
+    stack.pop_back();
+    const LoudsTrie::Node sibling = LoudsTrie::MoveToNextSibling(node);
+    if (trie.IsValidNode(sibling)) {
+      stack.push_back(sibling);
+    }
+    child = trie.MoveToFirstChild(node);
+    if (trie.IsValidNode(child)) {
+      stack.push_back(child);
     }
   }
 }
@@ -388,55 +529,61 @@ void UserDictionary::LookupPrefix(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
+  scoped_rcu_read_lock l;
+  const TokensIndex *tokens = tokens_.get();
 
   if (key.empty()) {
     LOG(WARNING) << "string of length zero is passed.";
     return;
   }
-  if (tokens_->empty()) {
+  if (tokens->empty()) {
     return;
   }
   if (conversion_request.config().incognito_mode()) {
     return;
   }
 
-  // Find the starting point for iteration over dictionary contents.
-  const StringPiece first_char = key.substr(0, Util::OneCharLen(key.data()));
+  // Walk the trie along |key| and look up the tokens of each prefix.
+  const LoudsTrie &trie = tokens->key_trie();
+  LoudsTrie::Node node;
   Token token;
-  for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
-                                  OrderByKey());
-       it != tokens_->end(); ++it) {
-    const UserPOS::Token &user_pos_token = **it;
-    if (user_pos_token.key > key) {
-      break;
-    }
-    if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
-      continue;
+  for (size_t i = 0; i < key.size(); ) {
+    if (!trie.MoveToChildByLabel(key[i], &node)) {
+      return;
     }
-    if (!Util::StartsWith(key, user_pos_token.key)) {
+    ++i;
+    if (!trie.IsTerminalNode(node)) {
       continue;
     }
-    switch (callback->OnKey(user_pos_token.key)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_NEXT_KEY:
+    const auto range =
+        tokens->GetTokenRange(trie.GetKeyIdOfTerminalNode(node));
+    for (auto it = range.first; it != range.second; ++it) {
+      const UserPOS::Token &user_pos_token = **it;
+      if (pos_matcher_.IsSuggestOnlyWord(user_pos_token.id)) {
         continue;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "UserDictionary doesn't support culling.";
-        break;
-      default:
-        break;
-    }
-    FillTokenFromUserPOSToken(user_pos_token, &token);
-    switch (callback->OnToken(user_pos_token.key, user_pos_token.key, token)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_CULL:
-        LOG(FATAL) << "UserDictionary doesn't support culling.";
-        break;
-      default:
-        break;
+      }
+      switch (callback->OnKey(user_pos_token.key)) {
+        case Callback::TRAVERSE_DONE:
+          return;
+        case Callback::TRAVERSE_NEXT_KEY:
+          continue;
+        case Callback::TRAVERSE_CULL:
+          LOG(FATAL) << "UserDictionary doesn't support culling.";
+          break;
+        default:
+          break;
+      }
+      FillTokenFromUserPOSToken(user_pos_token, &token);
+      switch (callback->OnToken(user_pos_token.key, user_pos_token.key,
+                                token)) {
+        case Callback::TRAVERSE_DONE:
+          return;
+        case Callback::TRAVERSE_CULL:
+          LOG(FATAL) << "UserDictionary doesn't support culling.";
+          break;
+        default:
+          break;
+      }
     }
   }
 }
@@ -445,16 +592,17 @@ void UserDictionary::LookupExact(
     StringPiece key,
     const ConversionRequest &conversion_request,
     Callback *callback) const {
-  scoped_reader_lock l(mutex_.get());
-  if (key.empty() || tokens_->empty() ||
+  scoped_rcu_read_lock l;
+  const TokensIndex *tokens = tokens_.get();
+  if (key.empty() || tokens->empty() ||
       conversion_request.config().incognito_mode()) {
     return;
   }
-  auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                OrderByKey());
-  if (range.first == range.second) {
+  const int key_id = tokens->key_trie().ExactSearch(key);
+  if (key_id < 0) {
     return;
   }
+  auto range = tokens->GetTokenRange(key_id);
   if (callback->OnKey(key) != Callback::TRAVERSE_CONTINUE) {
     return;
   }
@@ -485,14 +633,19 @@ bool UserDictionary::LookupComment(StringPiece key, StringPiece value,
     return false;
   }
 
-  scoped_reader_lock l(mutex_.get());
-  if (tokens_->empty()) {
+  scoped_rcu_read_lock l;
+  const TokensIndex *tokens = tokens_.get();
+  if (tokens->empty()) {
+    return false;
+  }
+
+  const int key_id = tokens->key_trie().ExactSearch(key);
+  if (key_id < 0) {
     return false;
   }
 
   // Set the comment that was found first.
-  for (auto range = std::equal_range(tokens_->begin(), tokens_->end(), key,
-                                     OrderByKey());
+  for (auto range = tokens->GetTokenRange(key_id);
        range.first != range.second; ++range.first) {
     const UserPOS::Token &token = **range.first;
     if (token.value == value && !token.comment.empty()) {
@@ -571,20 +724,16 @@ void UserDictionary::WaitForReloader() {
 
 void UserDictionary::Swap(TokensIndex *new_tokens) {
   DCHECK(new_tokens);
-  TokensIndex *old_tokens = tokens_;
-  {
-    scoped_writer_lock l(mutex_.get());
-    tokens_ = new_tokens;
-  }
-  delete old_tokens;
+  // The lookups in progress keep using the old index until they finish.
+  tokens_.Reset(new_tokens);
 }
 
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
   size_t size = 0;
   {
-    scoped_reader_lock l(mutex_.get());
-    size = tokens_->size();
+    scoped_rcu_read_lock l;
+    size = tokens_.get()->size();
   }
 
   // If UserDictionary is pretty big, we first remove the
@@ -595,7 +744,9 @@ bool UserDictionary::Load(
   const size_t kVeryBigUserDictionarySize = 100000;
 #endif
 
-  if (size >= kVeryBigUserDictionarySize) {
+  // Otherwise, the unchanged entries are reused from the current dictionary.
+  const bool reuse_current_tokens = size < kVeryBigUserDictionarySize;
+  if (!reuse_current_tokens) {
     TokensIndex *dummy_empty_tokens = new TokensIndex(user_pos_.get(),
                                                       suppression_dictionary_);
     Swap(dummy_empty_tokens);
@@ -604,12 +755,25 @@ bool UserDictionary::Load(
   suppression_dictionary_->Lock();
   TokensIndex *tokens = new TokensIndex(user_pos_.get(),
                                         suppression_dictionary_);
-  tokens->Load(storage);  // |suppression_dictionary_| is unlocked in Load().
+  {
+    scoped_rcu_read_lock l;
+    // |suppression_dictionary_| is unlocked in Load().
+    tokens->Load(storage, reuse_current_tokens ? tokens_.get() : nullptr);
+  }
   DCHECK(!suppression_dictionary_->IsLocked());
   Swap(tokens);
   return true;
 }
 
+void UserDictionary::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  DCHECK(usages);
+  scoped_rcu_read_lock l;
+  const TokensIndex *tokens = tokens_.get();
+  usages->push_back(MemoryStats::HeapUsage(
+      "user_dictionary", tokens->GetAllocatedBytes(), tokens->size()));
+}
+
 void UserDictionary::SetUserDictionaryName(const string &filename) {
   Singleton<UserDictionaryFileManager>::get()->SetFileName(filename);
 }
@@ -34,6 +34,7 @@
 #include <string>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "dictionary/dictionary_interface.h"
@@ -43,9 +44,6 @@
 #include "protocol/user_dictionary_storage.pb.h"
 
 namespace mozc {
-
-class ReaderWriterMutex;
-
 namespace dictionary {
 
 class UserDictionary : public DictionaryInterface {
@@ -80,6 +78,10 @@ class UserDictionary : public DictionaryInterface {
                      const ConversionRequest &conversion_request,
                      string *comment) const override;
 
+  // Reports the tokens and the key trie as "user_dictionary".
+  void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const override;
+
   // Loads dictionary from UserDictionaryStorage.
   // mainly for unittesting
   bool Load(const user_dictionary::UserDictionaryStorage &storage);
@@ -115,8 +117,8 @@ class UserDictionary : public DictionaryInterface {
   std::unique_ptr<const UserPOSInterface> user_pos_;
   const POSMatcher pos_matcher_;
   SuppressionDictionary *suppression_dictionary_;
-  TokensIndex *tokens_;
-  mutable std::unique_ptr<ReaderWriterMutex> mutex_;
+  // Read under scoped_rcu_read_lock and replaced by Swap().
+  RcuPtr<TokensIndex> tokens_;
 
   friend class UserDictionaryTest;
   DISALLOW_COPY_AND_ASSIGN(UserDictionary);
@@ -35,8 +35,8 @@
 
 #include <algorithm>
 #include <map>
-#include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "base/compiler_specific.h"
@@ -46,6 +46,7 @@
 #include "base/number_util.h"
 #include "base/port.h"
 #include "base/system_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "base/win_util.h"
 #include "dictionary/user_dictionary_util.h"
@@ -167,6 +168,77 @@ bool ConvertEntryInternal(
   return true;
 }
 
+// The number of raw entries read from the iterator at once.  A batch is
+// converted in parallel and then appended to the dictionary in order.
+const size_t kImportBatchSize = 4096;
+
+// The minimum number of entries converted by a task.  Fewer entries don't
+// pay for the scheduling.
+const size_t kMinEntriesPerTask = 512;
+
+// The result of the conversion of a raw entry.
+struct ConvertedEntry {
+  enum State {
+    EMPTY,
+    INVALID,
+    VALID,
+  };
+
+  State state;
+  uint64 fingerprint;  // Valid only when the state is VALID.
+  UserDictionary::Entry entry;
+};
+
+void ConvertEntries(
+    const std::vector<UserDictionaryImporter::RawEntry> &raw_entries,
+    size_t begin, size_t end,
+    std::vector<ConvertedEntry> *converted_entries) {
+  for (size_t i = begin; i < end; ++i) {
+    const UserDictionaryImporter::RawEntry &raw_entry = raw_entries[i];
+    ConvertedEntry *converted = &(*converted_entries)[i];
+    if (raw_entry.key.empty() &&
+        raw_entry.value.empty() &&
+        raw_entry.comment.empty()) {
+      converted->state = ConvertedEntry::EMPTY;
+      continue;
+    }
+    if (!UserDictionaryImporter::ConvertEntry(raw_entry,
+                                              &converted->entry)) {
+      converted->state = ConvertedEntry::INVALID;
+      continue;
+    }
+    converted->state = ConvertedEntry::VALID;
+    converted->fingerprint = EntryFingerprint(converted->entry);
+  }
+}
+
+// Converts |raw_entries| on the shared ThreadPool and this thread.
+void ConvertEntriesInParallel(
+    const std::vector<UserDictionaryImporter::RawEntry> &raw_entries,
+    std::vector<ConvertedEntry> *converted_entries) {
+  const size_t size = raw_entries.size();
+  converted_entries->resize(size);
+  ThreadPool *pool = ThreadPool::GetSharedInstance();
+  const size_t num_tasks =
+      std::max<size_t>(1, std::min(pool->num_threads() + 1,
+                                   size / kMinEntriesPerTask));
+  std::vector<ThreadPool::TaskHandle> tasks;
+  for (size_t i = 1; i < num_tasks; ++i) {
+    const size_t begin = size * i / num_tasks;
+    const size_t end = size * (i + 1) / num_tasks;
+    tasks.push_back(pool->Schedule(
+        ThreadPool::BACKGROUND,
+        [&raw_entries, begin, end, converted_entries]() {
+          ConvertEntries(raw_entries, begin, end, converted_entries);
+        }));
+  }
+  ConvertEntries(raw_entries, 0, size / num_tasks, converted_entries);
+  // A range which no worker has taken yet runs on this thread.
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Wait();
+  }
+}
+
 }  // namespace
 
 UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
@@ -180,41 +252,61 @@ UserDictionaryImporter::ErrorType UserDictionaryImporter::ImportFromIterator(
 
   ErrorType ret = IMPORT_NO_ERROR;
 
-  std::set<uint64> existent_entries;
+  std::unordered_set<uint64> existent_entries;
+  existent_entries.reserve(user_dic->entries_size() + kImportBatchSize);
   for (size_t i = 0; i < user_dic->entries_size(); ++i) {
     existent_entries.insert(EntryFingerprint(user_dic->entries(i)));
   }
 
-  UserDictionary::Entry entry;
-  RawEntry raw_entry;
-  while (iter->Next(&raw_entry)) {
-    if (user_dic->entries_size() >= max_size) {
-      LOG(WARNING) << "Too many words in one dictionary";
-      return IMPORT_TOO_MANY_WORDS;
+  // Reads the entries in batches.  The conversion of the entries, which is
+  // the most of the cost, runs in parallel, while the deduplication and the
+  // insertion keep the order of the input.
+  std::vector<RawEntry> raw_entries(kImportBatchSize);
+  std::vector<ConvertedEntry> converted_entries;
+  bool has_next = true;
+  while (has_next) {
+    size_t size = 0;
+    while (size < kImportBatchSize && iter->Next(&raw_entries[size])) {
+      ++size;
     }
-
-    if (raw_entry.key.empty() &&
-        raw_entry.value.empty() &&
-        raw_entry.comment.empty()) {
-      // Empty entry is just skipped. It could be annoying if we show a
-      // warning dialog when these empty candidates exist.
-      continue;
+    has_next = (size == kImportBatchSize);
+    if (size == 0) {
+      break;
     }
+    raw_entries.resize(size);
+    ConvertEntriesInParallel(raw_entries, &converted_entries);
+    raw_entries.resize(kImportBatchSize);
+
+    user_dic->mutable_entries()->Reserve(
+        std::min(user_dic->entries_size() + size, max_size));
+    for (size_t i = 0; i < size; ++i) {
+      if (user_dic->entries_size() >= max_size) {
+        LOG(WARNING) << "Too many words in one dictionary";
+        return IMPORT_TOO_MANY_WORDS;
+      }
 
-    if (!ConvertEntry(raw_entry, &entry)) {
-      LOG(WARNING) << "Entry is not valid";
-      ret = IMPORT_INVALID_ENTRIES;
-      continue;
-    }
+      ConvertedEntry *converted = &converted_entries[i];
+      if (converted->state == ConvertedEntry::EMPTY) {
+        // Empty entry is just skipped. It could be annoying if we show a
+        // warning dialog when these empty candidates exist.
+        continue;
+      }
 
-    // Don't register words if it is aleady in the current dictionary.
-    if (!existent_entries.insert(EntryFingerprint(entry)).second) {
-      continue;
-    }
+      if (converted->state == ConvertedEntry::INVALID) {
+        LOG(WARNING) << "Entry is not valid";
+        ret = IMPORT_INVALID_ENTRIES;
+        continue;
+      }
+
+      // Don't register words if it is aleady in the current dictionary.
+      if (!existent_entries.insert(converted->fingerprint).second) {
+        continue;
+      }
 
-    UserDictionary::Entry *new_entry = user_dic->add_entries();
-    DCHECK(new_entry);
-    new_entry->CopyFrom(entry);
+      UserDictionary::Entry *new_entry = user_dic->add_entries();
+      DCHECK(new_entry);
+      new_entry->Swap(&converted->entry);
+    }
   }
 
   return ret;
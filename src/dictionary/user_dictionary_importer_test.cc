@@ -28,6 +28,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <algorithm>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -514,6 +515,45 @@ TEST(UserDictionaryImporter, ImportFromIteratorDupTest) {
   EXPECT_EQ(2, user_dic.entries_size());
 }
 
+TEST(UserDictionaryImporter, ImportFromIteratorLargeMixedTest) {
+  // Duplicates, invalid entries and empty entries spread over several
+  // batches of the import.
+  std::vector<UserDictionaryImporter::RawEntry> entries;
+  std::vector<string> expected_keys;
+  std::set<string> seen_keys;
+  for (size_t j = 0; j < 20000; ++j) {
+    UserDictionaryImporter::RawEntry entry;
+    if (j % 11 == 0) {
+      entries.push_back(entry);
+      continue;
+    }
+    const string key("key" + NumberUtil::SimpleItoa(
+        static_cast<uint32>(j % 6000)));
+    entry.key = key;
+    entry.value = "value";
+    if (j % 7 != 0) {
+      // entry.pos = "名詞";
+      entry.pos = "\xE5\x90\x8D\xE8\xA9\x9E";
+      if (seen_keys.insert(key).second) {
+        expected_keys.push_back(key);
+      }
+    }
+    entries.push_back(entry);
+  }
+
+  TestInputIterator iter;
+  iter.set_available(true);
+  iter.set_entries(&entries);
+  UserDictionaryStorage::UserDictionary user_dic;
+  EXPECT_EQ(UserDictionaryImporter::IMPORT_INVALID_ENTRIES,
+            UserDictionaryImporter::ImportFromIterator(&iter, &user_dic));
+
+  ASSERT_EQ(expected_keys.size(), user_dic.entries_size());
+  for (size_t j = 0; j < expected_keys.size(); ++j) {
+    EXPECT_EQ(expected_keys[j], user_dic.entries(j).key());
+  }
+}
+
 TEST(UserDictionaryImporter, GuessIMETypeTest) {
   EXPECT_EQ(UserDictionaryImporter::NUM_IMES,
             UserDictionaryImporter::GuessIMEType(""));
@@ -35,6 +35,7 @@
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/port.h"
@@ -47,6 +48,7 @@
 #include "base/protobuf/zero_copy_stream_impl.h"
 #include "base/util.h"
 #include "dictionary/user_dictionary_util.h"
+#include "storage/ephemeral_mode.h"
 
 namespace mozc {
 namespace {
@@ -89,10 +91,30 @@ const string &UserDictionaryStorage::filename() const {
 }
 
 bool UserDictionaryStorage::Exists() const {
+  if (storage::EphemeralMode::IsEnabled()) {
+    return storage::EphemeralMode::FileExists(file_name_);
+  }
   return FileUtil::FileExists(file_name_);
 }
 
 bool UserDictionaryStorage::LoadInternal() {
+  if (storage::EphemeralMode::IsEnabled()) {
+    string content;
+    if (!storage::EphemeralMode::ReadFile(file_name_, &content)) {
+      LOG(ERROR) << file_name_ << " does not exist.";
+      last_error_type_ = FILE_NOT_EXISTS;
+      return false;
+    }
+    if (!ParseFromString(content)) {
+      LOG(ERROR) << "ParseFromString failed: data seems broken";
+      last_error_type_ = BROKEN_FILE;
+      return false;
+    }
+    return true;
+  }
+
+  IOStats::ScopedOperation operation(IOStats::USER_DICTIONARY_STORAGE,
+                                     IOStats::READ);
   InputFileStream ifs(file_name_.c_str(), std::ios::binary);
   if (!ifs) {
     if (Exists()) {
@@ -114,7 +136,9 @@ bool UserDictionaryStorage::LoadInternal() {
   mozc::protobuf::io::IstreamInputStream zero_copy_input(&ifs);
   mozc::protobuf::io::CodedInputStream decoder(&zero_copy_input);
   decoder.SetTotalBytesLimit(kDefaultTotalBytesLimit, -1);
-  if (!ParseFromCodedStream(&decoder)) {
+  const bool parsed = ParseFromCodedStream(&decoder);
+  operation.set_bytes(static_cast<size_t>(zero_copy_input.ByteCount()));
+  if (!parsed) {
     LOG(ERROR) << "Failed to parse";
     if (!decoder.ConsumedEntireMessage() || !ifs.eof()) {
       LOG(ERROR) << "ParseFromStream failed: file seems broken";
@@ -166,6 +190,19 @@ bool UserDictionaryStorage::Save() {
     }
   }
 
+  if (storage::EphemeralMode::IsEnabled()) {
+    string content;
+    if (!SerializeToString(&content)) {
+      LOG(ERROR) << "SerializeToString failed";
+      last_error_type_ = SYNC_FAILURE;
+      return false;
+    }
+    storage::EphemeralMode::WriteFile(file_name_, content);
+    return true;
+  }
+
+  IOStats::ScopedOperation operation(IOStats::USER_DICTIONARY_STORAGE,
+                                     IOStats::WRITE);
   const string tmp_file_name = file_name_ + ".tmp";
   {
     OutputFileStream ofs(tmp_file_name.c_str(),
@@ -182,6 +219,7 @@ bool UserDictionaryStorage::Save() {
       return false;
     }
 
+    operation.set_bytes(static_cast<size_t>(ofs.tellp()));
     if (static_cast<size_t>(ofs.tellp()) >= kDefaultWarningTotalBytesLimit) {
       LOG(ERROR) << "The file size exceeds " << kDefaultWarningTotalBytesLimit;
       // continue "AtomicRename"
@@ -204,14 +242,18 @@ bool UserDictionaryStorage::Save() {
 
 bool UserDictionaryStorage::Lock() {
   scoped_lock l(local_mutex_.get());
-  locked_ = process_mutex_->Lock();
+  // The data in memory is not shared with other processes, and the process
+  // mutex would create a lock file.
+  locked_ = storage::EphemeralMode::IsEnabled() || process_mutex_->Lock();
   LOG_IF(ERROR, !locked_) << "Lock() failed";
   return locked_;
 }
 
 bool UserDictionaryStorage::UnLock() {
   scoped_lock l(local_mutex_.get());
-  process_mutex_->UnLock();
+  if (!storage::EphemeralMode::IsEnabled()) {
+    process_mutex_->UnLock();
+  }
   locked_ = false;
   return true;
 }
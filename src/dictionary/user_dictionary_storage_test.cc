@@ -41,6 +41,7 @@
 #include "base/util.h"
 #include "dictionary/user_dictionary_importer.h"
 #include "dictionary/user_dictionary_util.h"
+#include "storage/ephemeral_mode.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -113,6 +114,28 @@ TEST_F(UserDictionaryStorageTest, LockTest) {
   EXPECT_TRUE(storage2.Save());
 }
 
+TEST_F(UserDictionaryStorageTest, EphemeralModeTest) {
+  storage::EphemeralMode::SetEnabled(true);
+  {
+    UserDictionaryStorage storage(GetUserDictionaryFile());
+    EXPECT_FALSE(storage.Load());
+    uint64 id = 0;
+    EXPECT_TRUE(storage.CreateDictionary("test", &id));
+    EXPECT_TRUE(storage.Lock());
+    EXPECT_TRUE(storage.Save());
+    EXPECT_TRUE(storage.UnLock());
+    EXPECT_TRUE(storage.Exists());
+  }
+  {
+    UserDictionaryStorage storage(GetUserDictionaryFile());
+    EXPECT_TRUE(storage.Load());
+    ASSERT_EQ(1, storage.dictionaries_size());
+    EXPECT_EQ("test", storage.dictionaries(0).name());
+  }
+  EXPECT_FALSE(FileUtil::FileExists(GetUserDictionaryFile()));
+  storage::EphemeralMode::SetEnabled(false);
+}
+
 TEST_F(UserDictionaryStorageTest, BasicOperationsTest) {
   UserDictionaryStorage storage(GetUserDictionaryFile());
   EXPECT_FALSE(storage.Load());
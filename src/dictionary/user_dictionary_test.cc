@@ -876,6 +876,51 @@ TEST_F(UserDictionaryTest, TestSuggestionOnlyWord) {
   FileUtil::Unlink(filename);
 }
 
+TEST_F(UserDictionaryTest, ReloadAfterEdits) {
+  unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  UserDictionaryStorage storage("");
+  UserDictionaryStorage::UserDictionary *user_dic = storage.add_dictionaries();
+  for (int i = 0; i < 3; ++i) {
+    UserDictionaryStorage::UserDictionaryEntry *entry =
+        user_dic->add_entries();
+    entry->set_key(Util::StringPrintf("key%d", i));
+    entry->set_value(Util::StringPrintf("value%d", i));
+    entry->set_pos(user_dictionary::UserDictionary::NOUN);
+    entry->set_comment(Util::StringPrintf("comment%d", i));
+  }
+  dic->Load(storage);
+  EXPECT_EQ("comment0", LookupComment(*dic, "key0", "value0"));
+  EXPECT_EQ("comment1", LookupComment(*dic, "key1", "value1"));
+  EXPECT_EQ("comment2", LookupComment(*dic, "key2", "value2"));
+
+  // Edit, remove and add entries.  The unchanged entry is reused from the
+  // current index and the others are reflected.
+  user_dic->mutable_entries(0)->set_comment("edited");
+  user_dic->mutable_entries()->SwapElements(1, 2);
+  user_dic->mutable_entries()->RemoveLast();
+  UserDictionaryStorage::UserDictionaryEntry *entry = user_dic->add_entries();
+  entry->set_key("key3");
+  entry->set_value("value3");
+  entry->set_pos(user_dictionary::UserDictionary::NOUN);
+  entry->set_comment("comment3");
+  dic->Load(storage);
+  EXPECT_EQ("edited", LookupComment(*dic, "key0", "value0"));
+  EXPECT_EQ("", LookupComment(*dic, "key1", "value1"));
+  EXPECT_EQ("comment2", LookupComment(*dic, "key2", "value2"));
+  EXPECT_EQ("comment3", LookupComment(*dic, "key3", "value3"));
+  EXPECT_INTEGER_STATS("UserRegisteredWord", 3);
+
+  // Loading the same storage again gives the same result.
+  dic->Load(storage);
+  EXPECT_EQ("edited", LookupComment(*dic, "key0", "value0"));
+  EXPECT_EQ("comment2", LookupComment(*dic, "key2", "value2"));
+  EXPECT_EQ("comment3", LookupComment(*dic, "key3", "value3"));
+  EXPECT_INTEGER_STATS("UserRegisteredWord", 3);
+}
+
 TEST_F(UserDictionaryTest, TestUsageStats) {
   unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
   // Wait for async reload called from the constructor.
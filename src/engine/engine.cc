@@ -29,54 +29,82 @@
 
 #include "engine/engine.h"
 
+#include <map>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "base/file_util.h"
+#include "base/flags.h"
 #include "base/logging.h"
+#include "base/mmap.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/thread.h"
 #include "converter/connector.h"
 #include "converter/converter.h"
 #include "converter/converter_interface.h"
 #include "converter/immutable_converter.h"
 #include "converter/immutable_converter_interface.h"
-#include "converter/segmenter.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/dictionary_impl.h"
 #include "dictionary/dictionary_interface.h"
-#include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
-#include "dictionary/suffix_dictionary.h"
 #include "dictionary/suppression_dictionary.h"
 #include "dictionary/system/system_dictionary.h"
 #include "dictionary/system/value_dictionary.h"
 #include "dictionary/user_dictionary.h"
 #include "dictionary/user_pos.h"
+#include "engine/engine_data.h"
 #include "engine/engine_interface.h"
+#include "engine/warm_state_snapshot.h"
 #include "engine/user_data_manager_interface.h"
 #include "prediction/dictionary_predictor.h"
 #include "prediction/predictor.h"
 #include "prediction/predictor_interface.h"
-#include "prediction/suggestion_filter.h"
 #include "prediction/user_history_predictor.h"
 #include "rewriter/rewriter.h"
 #include "rewriter/rewriter_interface.h"
+#include "rewriter/user_boundary_history_rewriter.h"
+#include "storage/ephemeral_mode.h"
 
 using mozc::dictionary::DictionaryImpl;
-using mozc::dictionary::PosGroup;
-using mozc::dictionary::SuffixDictionary;
 using mozc::dictionary::SuppressionDictionary;
 using mozc::dictionary::SystemDictionary;
 using mozc::dictionary::UserDictionary;
 using mozc::dictionary::UserPOS;
 using mozc::dictionary::ValueDictionary;
 
+DEFINE_bool(warmup_data, false,
+            "Read the dictionary and the connection data in the background "
+            "at startup so that the first conversions don't wait for page "
+            "faults.");
+DEFINE_bool(ephemeral_user_data, false,
+            "Keep the user history, the user dictionary and the registry in "
+            "memory and never write them to the disk, e.g., on shared kiosk "
+            "machines and in stress tests.");
+DEFINE_bool(warm_state_snapshot, false,
+            "Save the warmed caches of the engine to the user profile on exit "
+            "and restore them at startup, so that a restarted server doesn't "
+            "start with the cold caches.");
+DEFINE_bool(background_learning, false,
+            "Apply the learning of the committed segments on a background "
+            "thread so that the commit returns without waiting for it.  The "
+            "next conversion and prediction wait for the pending learning.");
+
 namespace mozc {
 namespace {
 
+// The maximum number of the user history entries of the low memory engine.
+const uint32 kLowMemoryUserHistorySize = 1000;
+
 class UserDataManagerImpl final : public UserDataManagerInterface {
  public:
-  explicit UserDataManagerImpl(PredictorInterface *predictor,
-                               RewriterInterface *rewriter)
-      : predictor_(predictor), rewriter_(rewriter) {}
+  UserDataManagerImpl(const ConverterImpl *converter,
+                      PredictorInterface *predictor,
+                      RewriterInterface *rewriter)
+      : converter_(converter), predictor_(predictor), rewriter_(rewriter) {}
   ~UserDataManagerImpl() override;
 
   bool Sync() override;
@@ -89,6 +117,9 @@ class UserDataManagerImpl final : public UserDataManagerInterface {
   bool Wait() override;
 
  private:
+  // The learning handed to the background thread of |converter_| is applied
+  // before the user data is accessed.
+  const ConverterImpl *converter_;
   PredictorInterface *predictor_;
   RewriterInterface *rewriter_;
 
@@ -98,83 +129,178 @@ class UserDataManagerImpl final : public UserDataManagerInterface {
 UserDataManagerImpl::~UserDataManagerImpl() {}
 
 bool UserDataManagerImpl::Sync() {
-  // TODO(noriyukit): In the current implementation, if rewriter_->Sync() fails,
-  // predictor_->Sync() is never called. Check if we should call
-  // predictor_->Sync() or not.
-  return rewriter_->Sync() && predictor_->Sync();
+  return converter_->SyncUserData();
 }
 
 bool UserDataManagerImpl::Reload() {
-  // TODO(noriyukit): The same TODO as Sync().
-  return rewriter_->Reload() && predictor_->Reload();
+  return converter_->ReloadUserData();
 }
 
 bool UserDataManagerImpl::ClearUserHistory() {
+  converter_->WaitForPendingLearning();
   rewriter_->Clear();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUserPrediction() {
+  converter_->WaitForPendingLearning();
   predictor_->ClearAllHistory();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUnusedUserPrediction() {
+  converter_->WaitForPendingLearning();
   predictor_->ClearUnusedHistory();
   return true;
 }
 
 bool UserDataManagerImpl::ClearUserPredictionEntry(const string &key,
                                                    const string &value) {
+  converter_->WaitForPendingLearning();
   return predictor_->ClearHistoryEntry(key, value);
 }
 
 bool UserDataManagerImpl::Wait() {
+  converter_->WaitForPendingLearning();
   return predictor_->Wait();
 }
 
 }  // namespace
 
+// Touches every page of the given data regions so that the later lookups don't
+// wait for the pages to be read from disk.
+class Engine::WarmupThread : public Thread {
+ public:
+  WarmupThread() : checksum_(0) {}
+
+  void AddRegion(const char *data, size_t size) {
+    if (data != nullptr && size > 0) {
+      regions_.push_back(StringPiece(data, size));
+    }
+  }
+
+  void Run() override {
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    // The prefetch hint lets the kernel read all the regions ahead in
+    // parallel, while touching the pages guarantees they are mapped.
+    for (size_t i = 0; i < regions_.size(); ++i) {
+      Mmap::MaybePrefetch(regions_[i].data(), regions_[i].size());
+    }
+    const size_t kPageSize = 4096;
+    uint8 checksum = 0;
+    for (size_t i = 0; i < regions_.size(); ++i) {
+      for (size_t offset = 0; offset < regions_[i].size();
+           offset += kPageSize) {
+        checksum += regions_[i][offset];
+      }
+    }
+    // Store the result so that the reads are not optimized out.
+    checksum_ = checksum;
+    VLOG(1) << "Data warmup finished in "
+            << stopwatch.GetElapsedMilliseconds() << " msec";
+  }
+
+ private:
+  std::vector<StringPiece> regions_;
+  uint8 checksum_;
+
+  DISALLOW_COPY_AND_ASSIGN(WarmupThread);
+};
+
 std::unique_ptr<Engine> Engine::CreateDesktopEngine(
     std::unique_ptr<const DataManagerInterface> data_manager) {
+  return CreateDesktopEngine(EngineData::Create(std::move(data_manager)));
+}
+
+std::unique_ptr<Engine> Engine::CreateDesktopEngine(
+    std::shared_ptr<const EngineData> data) {
   std::unique_ptr<Engine> engine(new Engine());
-  engine->Init(data_manager.release(),
+  engine->Init(std::move(data),
                &DefaultPredictor::CreateDefaultPredictor,
+               false,
                false);
   return engine;
 }
 
 std::unique_ptr<Engine> Engine::CreateMobileEngine(
     std::unique_ptr<const DataManagerInterface> data_manager) {
+  return CreateMobileEngine(EngineData::Create(std::move(data_manager)));
+}
+
+std::unique_ptr<Engine> Engine::CreateMobileEngine(
+    std::shared_ptr<const EngineData> data) {
   std::unique_ptr<Engine> engine(new Engine());
-  engine->Init(data_manager.release(),
+  engine->Init(std::move(data),
                &MobilePredictor::CreateMobilePredictor,
+               true,
+               false);
+  return engine;
+}
+
+std::unique_ptr<Engine> Engine::CreateLowMemoryEngine(
+    std::unique_ptr<const DataManagerInterface> data_manager) {
+  return CreateLowMemoryEngine(EngineData::Create(std::move(data_manager)));
+}
+
+std::unique_ptr<Engine> Engine::CreateLowMemoryEngine(
+    std::shared_ptr<const EngineData> data) {
+  std::unique_ptr<Engine> engine(new Engine());
+  engine->Init(std::move(data),
+               &MobilePredictor::CreateMobilePredictor,
+               true,
                true);
   return engine;
 }
 
 Engine::Engine() = default;
-Engine::~Engine() = default;
+
+std::unique_ptr<Engine> Engine::CreateSibling() const {
+  std::unique_ptr<Engine> engine(new Engine());
+  engine->Init(data_, predictor_factory_, enable_content_word_learning_,
+               low_memory_);
+  return engine;
+}
+
+Engine::~Engine() {
+  SaveWarmState();
+  // The warmup thread reads the data owned by |data_|.
+  if (warmup_thread_) {
+    warmup_thread_->Join();
+  }
+  // |data_| is declared first, so the modules referring to it are destroyed
+  // before it.
+  if (data_) {
+    data_->RemoveEngine();
+  }
+}
 
 // Since the composite predictor class differs on desktop and mobile, Init()
 // takes a function pointer to create an instance of predictor class.
-void Engine::Init(
-    const DataManagerInterface *data_manager,
-    PredictorInterface *(*predictor_factory)(PredictorInterface *,
-                                             PredictorInterface *),
-    bool enable_content_word_learning) {
-  CHECK(data_manager);
+void Engine::Init(std::shared_ptr<const EngineData> data,
+                  PredictorFactory predictor_factory,
+                  bool enable_content_word_learning,
+                  bool low_memory) {
+  CHECK(data);
   CHECK(predictor_factory);
+  data_ = std::move(data);
+  predictor_factory_ = predictor_factory;
+  enable_content_word_learning_ = enable_content_word_learning;
+  low_memory_ = low_memory;
+  data_->AddEngine();
+  const DataManagerInterface *data_manager = &data_->data_manager();
+  const dictionary::POSMatcher *pos_matcher = data_->pos_matcher();
+
+  // The storages of the user data check the mode when they are opened below.
+  if (FLAGS_ephemeral_user_data) {
+    storage::EphemeralMode::SetEnabled(true);
+  }
 
   suppression_dictionary_.reset(new SuppressionDictionary);
   CHECK(suppression_dictionary_.get());
 
-  pos_matcher_.reset(
-      new dictionary::POSMatcher(data_manager->GetPOSMatcherData()));
-
   user_dictionary_.reset(
       new UserDictionary(UserPOS::CreateFromDataManager(*data_manager),
-                         *pos_matcher_,
+                         *pos_matcher,
                          suppression_dictionary_.get()));
   CHECK(user_dictionary_.get());
 
@@ -184,50 +310,26 @@ void Engine::Init(
 
   SystemDictionary *sysdic =
       SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
-  dictionary_.reset(new DictionaryImpl(
+  DictionaryImpl *dictionary_impl = new DictionaryImpl(
       sysdic,  // DictionaryImpl takes the ownership
-      new ValueDictionary(*pos_matcher_, &sysdic->value_trie()),
+      new ValueDictionary(*pos_matcher, &sysdic->value_trie()),
       user_dictionary_.get(),
       suppression_dictionary_.get(),
-      pos_matcher_.get()));
+      pos_matcher);
+  dictionary_.reset(dictionary_impl);
   CHECK(dictionary_.get());
 
-  StringPiece suffix_key_array_data, suffix_value_array_data;
-  const uint32 *token_array;
-  data_manager->GetSuffixDictionaryData(&suffix_key_array_data,
-                                        &suffix_value_array_data,
-                                        &token_array);
-  suffix_dictionary_.reset(new SuffixDictionary(suffix_key_array_data,
-                                                suffix_value_array_data,
-                                                token_array));
-  CHECK(suffix_dictionary_.get());
-
-  connector_.reset(Connector::CreateFromDataManager(*data_manager));
-  CHECK(connector_.get());
-
-  segmenter_.reset(Segmenter::CreateFromDataManager(*data_manager));
-  CHECK(segmenter_.get());
-
-  pos_group_.reset(new PosGroup(data_manager->GetPosGroupData()));
-  CHECK(pos_group_.get());
-
-  {
-    const char *data = NULL;
-    size_t size = 0;
-    data_manager->GetSuggestionFilterData(&data, &size);
-    CHECK(data);
-    suggestion_filter_.reset(new SuggestionFilter(data, size));
-  }
-
-  immutable_converter_.reset(new ImmutableConverterImpl(
+  ImmutableConverterImpl *immutable_converter = new ImmutableConverterImpl(
       dictionary_.get(),
-      suffix_dictionary_.get(),
+      data_->suffix_dictionary(),
       suppression_dictionary_.get(),
-      connector_.get(),
-      segmenter_.get(),
-      pos_matcher_.get(),
-      pos_group_.get(),
-      suggestion_filter_.get()));
+      data_->connector(),
+      data_->segmenter(),
+      pos_matcher,
+      data_->pos_group(),
+      data_->suggestion_filter());
+  immutable_converter->set_dictionary_impl(dictionary_impl);
+  immutable_converter_.reset(immutable_converter);
   CHECK(immutable_converter_.get());
 
   // Since predictor and rewriter require a pointer to a converter instace,
@@ -238,6 +340,7 @@ void Engine::Init(
   // and fix it!
   ConverterImpl *converter_impl = new ConverterImpl;
   converter_.reset(converter_impl);  // Involves cast to ConverterInterface*.
+  converter_impl_ = converter_impl;
   CHECK(converter_.get());
 
   {
@@ -248,18 +351,21 @@ void Engine::Init(
                                 converter_.get(),
                                 immutable_converter_.get(),
                                 dictionary_.get(),
-                                suffix_dictionary_.get(),
-                                connector_.get(),
-                                segmenter_.get(),
-                                pos_matcher_.get(),
-                                suggestion_filter_.get());
+                                data_->suffix_dictionary(),
+                                data_->connector(),
+                                data_->segmenter(),
+                                pos_matcher,
+                                data_->suggestion_filter());
     CHECK(dictionary_predictor);
 
     PredictorInterface *user_history_predictor =
         new UserHistoryPredictor(dictionary_.get(),
-                                 pos_matcher_.get(),
+                                 pos_matcher,
                                  suppression_dictionary_.get(),
-                                 enable_content_word_learning);
+                                 enable_content_word_learning,
+                                 low_memory ?
+                                 kLowMemoryUserHistorySize :
+                                 UserHistoryPredictor::cache_size());
     CHECK(user_history_predictor);
 
     predictor_ = (*predictor_factory)(dictionary_predictor,
@@ -267,21 +373,147 @@ void Engine::Init(
     CHECK(predictor_);
   }
 
-  rewriter_ = new RewriterImpl(converter_impl,
-                               data_manager,
-                               pos_group_.get(),
-                               dictionary_.get());
+  RewriterImpl *rewriter = new RewriterImpl(
+      converter_impl, data_manager, data_->pos_group(), dictionary_.get(),
+      low_memory ? RewriterImpl::LOW_MEMORY : RewriterImpl::NONE);
+  rewriter_ = rewriter;
   CHECK(rewriter_);
 
-  converter_impl->Init(pos_matcher_.get(),
+  // Apply the learned segment boundaries in the immutable converter, so that
+  // a wrong first segmentation doesn't cost another conversion and rewrite.
+  UserBoundaryHistoryRewriter *user_boundary_history_rewriter =
+      rewriter->user_boundary_history_rewriter();
+  if (user_boundary_history_rewriter != NULL) {
+    user_boundary_history_rewriter->set_resize_on_rewrite(false);
+    immutable_converter->set_boundary_constraint(
+        user_boundary_history_rewriter);
+  }
+
+  converter_impl->Init(pos_matcher,
                        suppression_dictionary_.get(),
                        predictor_,
                        rewriter_,
                        immutable_converter_.get());
+  converter_impl->set_background_learning(FLAGS_background_learning);
 
-  user_data_manager_.reset(new UserDataManagerImpl(predictor_, rewriter_));
+  user_data_manager_.reset(
+      new UserDataManagerImpl(converter_impl, predictor_, rewriter_));
+
+  RestoreWarmState();
+  StartWarmup();
+}
+
+void Engine::StartWarmup() {
+  if (!FLAGS_warmup_data) {
+    return;
+  }
+  const DataManagerInterface &data_manager = data_->data_manager();
+  // Connector uses the dense matrix if the data set has it.
+  const char *connection_data = nullptr;
+  size_t connection_size = 0;
+  data_manager.GetDenseConnectorData(&connection_data, &connection_size);
+  if (connection_data == nullptr || connection_size == 0) {
+    data_manager.GetConnectorData(&connection_data, &connection_size);
+  }
 
-  data_manager_.reset(data_manager);
+  warmup_thread_.reset(new WarmupThread);
+  warmup_thread_->AddRegion(connection_data, connection_size);
+  {
+    const char *data = nullptr;
+    int size = 0;
+    data_manager.GetSystemDictionaryData(&data, &size);
+    warmup_thread_->AddRegion(data, size);
+  }
+  {
+    size_t l_num_elements = 0, r_num_elements = 0, bitarray_num_bytes = 0;
+    const uint16 *l_table = nullptr, *r_table = nullptr;
+    const uint16 *boundary_data = nullptr;
+    const char *bitarray_data = nullptr;
+    data_manager.GetSegmenterData(&l_num_elements, &r_num_elements,
+                                    &l_table, &r_table, &bitarray_num_bytes,
+                                    &bitarray_data, &boundary_data);
+    warmup_thread_->AddRegion(bitarray_data, bitarray_num_bytes);
+  }
+  {
+    const char *data = nullptr;
+    size_t size = 0;
+    data_manager.GetSuggestionFilterData(&data, &size);
+    warmup_thread_->AddRegion(data, size);
+  }
+  warmup_thread_->SetJoinable(true);
+  warmup_thread_->Start("EngineWarmup");
+}
+
+namespace {
+
+const char kWarmStateSnapshotFile[] = "warm_state.snapshot";
+const char kConnectorCacheSection[] = "connector_cache";
+
+string GetWarmStateSnapshotPath() {
+  return FileUtil::JoinPath(SystemUtil::GetUserProfileDirectory(),
+                            kWarmStateSnapshotFile);
+}
+
+}  // namespace
+
+void Engine::RestoreWarmState() {
+  if (!FLAGS_warm_state_snapshot) {
+    return;
+  }
+  WarmStateSnapshot snapshot;
+  if (!snapshot.Open(GetWarmStateSnapshotPath(),
+                     data_->data_manager().GetDataVersion())) {
+    return;
+  }
+  StringPiece connector_cache;
+  if (snapshot.GetSection(kConnectorCacheSection, &connector_cache) &&
+      data_->connector()->RestoreCache(connector_cache)) {
+    VLOG(1) << "Restored the connector cache from the snapshot";
+  }
+}
+
+void Engine::SaveWarmState() const {
+  if (!FLAGS_warm_state_snapshot || !data_ ||
+      storage::EphemeralMode::IsEnabled()) {
+    return;
+  }
+  std::map<string, string> sections;
+  if (!data_->connector()->SerializeCache(
+          &sections[kConnectorCacheSection])) {
+    // Nothing to save in the dense mode.
+    return;
+  }
+  WarmStateSnapshot::Write(GetWarmStateSnapshotPath(),
+                           data_->data_manager().GetDataVersion(), sections);
+}
+
+void Engine::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  DCHECK(usages);
+  data_->data_manager().CollectMemoryUsage(usages);
+  EngineData::MemoryReport report;
+  data_->GetMemoryReport(&report);
+  usages->push_back(MemoryStats::HeapUsage("engine_data", report.table_bytes,
+                                           report.num_engines));
+  dictionary_->CollectMemoryUsage(usages);
+  // The background learning may be modifying the learned data.
+  converter_impl_->WaitForPendingLearning();
+  predictor_->CollectMemoryUsage(usages);
+  rewriter_->CollectMemoryUsage(usages);
+}
+
+void Engine::ReleaseUnusedMemory() {
+  if (!low_memory_) {
+    return;
+  }
+  // The warmup thread would read the released pages again.
+  if (warmup_thread_) {
+    warmup_thread_->Join();
+    warmup_thread_.reset();
+  }
+  if (data_->data_manager().ReleaseMappedData()) {
+    VLOG(1) << "Released the pages of the data set";
+  }
 }
 
 bool Engine::Reload() {
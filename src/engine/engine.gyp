@@ -52,6 +52,8 @@
       'sources': [
         '<(gen_out_dir)/../dictionary/pos_matcher.h',
         'engine.cc',
+        'engine_data.cc',
+        'warm_state_snapshot.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
@@ -71,6 +73,7 @@
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:user_dictionary_storage_proto',
         '../rewriter/rewriter.gyp:rewriter',
+        '../storage/storage.gyp:storage',
       ],
     },
     {
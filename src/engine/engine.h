@@ -33,33 +33,34 @@
 #include <memory>
 
 #include "base/port.h"
+#include "base/string_piece.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_group.h"
+#include "engine/engine_data.h"
 #include "engine/engine_interface.h"
 
 namespace mozc {
 
-class Connector;
+class ConverterImpl;
 class ConverterInterface;
 class ImmutableConverterInterface;
 class PredictorInterface;
 class RewriterInterface;
-class Segmenter;
-class SuggestionFilter;
 class UserDataManagerInterface;
 
 namespace dictionary {
-class POSMatcher;
 class UserDictionary;
 }  // namespace dictionary
 
 // Builds and manages a set of modules that are necessary for conversion engine.
 class Engine : public EngineInterface {
  public:
-  // There are two types of engine: desktop and mobile.  The differences are the
-  // underlying prediction engine (DesktopPredictor or MobilePredictor) and
-  // learning preference (to learn content word or not).  See Init() for the
+  // There are three types of engine: desktop, mobile and low memory.  The
+  // differences between desktop and mobile are the underlying prediction
+  // engine (DesktopPredictor or MobilePredictor) and learning preference (to
+  // learn content word or not).  The low memory engine is the mobile engine
+  // with a smaller footprint; see CreateLowMemoryEngine().  See Init() for the
   // details of implementation.
 
   // Creates an instance with desktop configuration from a data manager.  The
@@ -67,6 +68,11 @@ class Engine : public EngineInterface {
   static std::unique_ptr<Engine> CreateDesktopEngine(
       std::unique_ptr<const DataManagerInterface> data_manager);
 
+  // Creates an instance with desktop configuration on the shared data, which
+  // can also be passed to other engines.
+  static std::unique_ptr<Engine> CreateDesktopEngine(
+      std::shared_ptr<const EngineData> data);
+
   // Helper function for the above factory, where data manager is instantiated
   // by a default constructor.  Intended to be used for OssDataManager etc.
   template <typename DataManagerType>
@@ -80,6 +86,11 @@ class Engine : public EngineInterface {
   static std::unique_ptr<Engine> CreateMobileEngine(
       std::unique_ptr<const DataManagerInterface> data_manager);
 
+  // Creates an instance with mobile configuration on the shared data, which
+  // can also be passed to other engines.
+  static std::unique_ptr<Engine> CreateMobileEngine(
+      std::shared_ptr<const EngineData> data);
+
   // Helper function for the above factory, where data manager is instantiated
   // by a default constructor.  Intended to be used for OssDataManager etc.
   template <typename DataManagerType>
@@ -88,9 +99,41 @@ class Engine : public EngineInterface {
         std::unique_ptr<const DataManagerType>(new DataManagerType()));
   }
 
+  // Creates an instance with low memory configuration from a data manager,
+  // for the devices with little memory.  The ownership of data manager is
+  // passed to the engine instance.  Compared to the mobile engine:
+  //   - The user history keeps at most 1000 entries (about 70KB on the heap
+  //     and in the file) instead of 2000 on Android and 10000 elsewhere.
+  //   - The optional rewriters are dropped, and the rewriters with tables on
+  //     the heap are built on their first use.  See RewriterImpl::LOW_MEMORY.
+  //   - ReleaseUnusedMemory() drops the pages of the data set mapped from a
+  //     file, which are read again on the next access.
+  // The reverse lookup index is never built on the heap, as for the other
+  // engines.  The footprint is reported by CollectMemoryUsage().
+  static std::unique_ptr<Engine> CreateLowMemoryEngine(
+      std::unique_ptr<const DataManagerInterface> data_manager);
+
+  // Creates an instance with low memory configuration on the shared data,
+  // which can also be passed to other engines.
+  static std::unique_ptr<Engine> CreateLowMemoryEngine(
+      std::shared_ptr<const EngineData> data);
+
+  // Helper function for the above factory, where data manager is instantiated
+  // by a default constructor.  Intended to be used for OssDataManager etc.
+  template <typename DataManagerType>
+  static std::unique_ptr<Engine> CreateLowMemoryEngineHelper() {
+    return CreateLowMemoryEngine(
+        std::unique_ptr<const DataManagerType>(new DataManagerType()));
+  }
+
   Engine();
   ~Engine() override;
 
+  // Creates another engine of the same configuration on the data shared with
+  // this engine.  The new engine has its own converter and user data modules,
+  // so it can be used on another thread, e.g., for evaluation in parallel.
+  std::unique_ptr<Engine> CreateSibling() const;
+
   ConverterInterface *GetConverter() const override { return converter_.get(); }
   PredictorInterface *GetPredictor() const override { return predictor_; }
   dictionary::SuppressionDictionary *GetSuppressionDictionary() override {
@@ -104,33 +147,61 @@ class Engine : public EngineInterface {
   }
 
   StringPiece GetDataVersion() const override {
-    return data_manager_->GetDataVersion();
+    return data_->data_manager().GetDataVersion();
   }
 
   const DataManagerInterface *GetDataManager() const override {
-    return data_manager_.get();
+    return data_ ? &data_->data_manager() : nullptr;
+  }
+
+  // Reports the data set, the tables shared as EngineData as "engine_data",
+  // and the dictionaries, the predictors and the rewriters.
+  void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const override;
+
+  // Releases the mapped data set in the low memory configuration.  Does
+  // nothing in the other configurations, which keep the data warm.
+  void ReleaseUnusedMemory() override;
+
+  // Returns true if this engine is created by CreateLowMemoryEngine().
+  bool IsLowMemory() const { return low_memory_; }
+
+  // Returns the immutable data this engine is built on, which can be passed
+  // to other engines to share it.
+  const std::shared_ptr<const EngineData> &GetEngineData() const {
+    return data_;
   }
 
  private:
-  // Initializes the object by the given data manager and predictor factory
-  // function.  Predictor factory is used to select DefaultPredictor and
-  // MobilePredictor.
-  void Init(const DataManagerInterface *data_manager,
-            PredictorInterface *(*predictor_factory)(PredictorInterface *,
-                                                     PredictorInterface *),
-            bool enable_content_word_learning);
-
-  std::unique_ptr<const DataManagerInterface> data_manager_;
-  std::unique_ptr<const dictionary::POSMatcher> pos_matcher_;
+  // Initializes the object by the given data and predictor factory function.
+  // Predictor factory is used to select DefaultPredictor and MobilePredictor.
+  typedef PredictorInterface *(*PredictorFactory)(PredictorInterface *,
+                                                   PredictorInterface *);
+  void Init(std::shared_ptr<const EngineData> data,
+            PredictorFactory predictor_factory,
+            bool enable_content_word_learning,
+            bool low_memory);
+
+  // Starts reading the hot data regions in the background, depending on the
+  // flag.  See engine.cc.
+  void StartWarmup();
+
+  // Restores and saves the caches with WarmStateSnapshot, if
+  // --warm_state_snapshot is enabled.
+  void RestoreWarmState();
+  void SaveWarmState() const;
+
+  class WarmupThread;
+
+  std::shared_ptr<const EngineData> data_;
+  // The arguments of Init() for CreateSibling().
+  PredictorFactory predictor_factory_ = nullptr;
+  bool enable_content_word_learning_ = false;
+  bool low_memory_ = false;
   std::unique_ptr<dictionary::SuppressionDictionary> suppression_dictionary_;
-  std::unique_ptr<const Connector> connector_;
-  std::unique_ptr<const Segmenter> segmenter_;
   std::unique_ptr<dictionary::UserDictionary> user_dictionary_;
-  std::unique_ptr<dictionary::DictionaryInterface> suffix_dictionary_;
   std::unique_ptr<dictionary::DictionaryInterface> dictionary_;
-  std::unique_ptr<const dictionary::PosGroup> pos_group_;
   std::unique_ptr<ImmutableConverterInterface> immutable_converter_;
-  std::unique_ptr<const SuggestionFilter> suggestion_filter_;
 
   // TODO(noriyukit): Currently predictor and rewriter are created by this class
   // but owned by converter_. Since this class creates these two, it'd be better
@@ -139,8 +210,12 @@ class Engine : public EngineInterface {
   RewriterInterface *rewriter_;
 
   std::unique_ptr<ConverterInterface> converter_;
+  // The same object as |converter_|.
+  ConverterImpl *converter_impl_ = nullptr;
   std::unique_ptr<UserDataManagerInterface> user_data_manager_;
 
+  std::unique_ptr<WarmupThread> warmup_thread_;
+
   DISALLOW_COPY_AND_ASSIGN(Engine);
 };
 
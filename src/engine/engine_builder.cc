@@ -91,8 +91,14 @@ class EngineBuilder::Preparator : public Thread {
       return;
     }
 
+    // The engine is also built here, as building the tables and loading the
+    // user data take a while.  The session handler only swaps it in.
+    engine_ = BuildEngine(request.engine_type(), std::move(tmp_data_manager));
+    if (!engine_) {
+      response_.set_status(EngineReloadResponse::UNKNOWN_ERROR);
+      return;
+    }
     response_.set_status(EngineReloadResponse::RELOAD_READY);
-    data_manager_ = std::move(tmp_data_manager);
   }
 
  private:
@@ -105,9 +111,25 @@ class EngineBuilder::Preparator : public Thread {
     return data_manager->InitFromFile(request.file_path());
   }
 
+  static std::unique_ptr<EngineInterface> BuildEngine(
+      EngineReloadRequest::EngineType engine_type,
+      std::unique_ptr<const DataManager> data_manager) {
+    switch (engine_type) {
+      case EngineReloadRequest::DESKTOP:
+        return Engine::CreateDesktopEngine(std::move(data_manager));
+      case EngineReloadRequest::MOBILE:
+        return Engine::CreateMobileEngine(std::move(data_manager));
+      case EngineReloadRequest::LOW_MEMORY:
+        return Engine::CreateLowMemoryEngine(std::move(data_manager));
+      default:
+        LOG(DFATAL) << "Should not reach here";
+        return nullptr;
+    }
+  }
+
   friend class EngineBuilder;
   EngineReloadResponse response_;
-  std::unique_ptr<DataManager> data_manager_;
+  std::unique_ptr<EngineInterface> engine_;
 };
 
 EngineBuilder::EngineBuilder() = default;
@@ -148,30 +170,13 @@ void EngineBuilder::GetResponse(EngineReloadResponse *response) const {
 }
 
 std::unique_ptr<EngineInterface> EngineBuilder::BuildFromPreparedData() {
-  std::unique_ptr<EngineInterface> engine;
-
   if (!HasResponse() ||
-      !preparator_->data_manager_ ||
+      !preparator_->engine_ ||
       preparator_->response_.status() != EngineReloadResponse::RELOAD_READY) {
     LOG(ERROR) << "Build() is called in invalid state";
-    return engine;
+    return nullptr;
   }
-
-  switch (preparator_->response_.request().engine_type()) {
-    case EngineReloadRequest::DESKTOP:
-      engine =
-          Engine::CreateDesktopEngine(std::move(preparator_->data_manager_));
-      break;
-    case EngineReloadRequest::MOBILE:
-      engine =
-          Engine::CreateMobileEngine(std::move(preparator_->data_manager_));
-      break;
-    default:
-      LOG(DFATAL) << "Should not reach here";
-      break;
-  }
-
-  return engine;
+  return std::move(preparator_->engine_);
 }
 
 void EngineBuilder::Clear() {
@@ -43,7 +43,8 @@ class EngineBuilder : public EngineBuilderInterface {
   ~EngineBuilder() override;
 
   // Implementation of EngineBuilderInterface.  PrepareAsync() is implemented
-  // using Thread.
+  // using Thread, which loads the data and builds the whole engine, so
+  // BuildFromPreparedData() just returns the prepared one.
   void PrepareAsync(const EngineReloadRequest &request,
                     EngineReloadResponse *response) override;
   bool HasResponse() const override;
@@ -59,7 +59,9 @@ class EngineBuilderInterface {
   virtual void GetResponse(EngineReloadResponse *response) const = 0;
 
   // Builds an engine using the data requested by PrepareAsync().
-  // May return nullptr if bad data was requested in PrepareAsync().
+  // May return nullptr if bad data was requested in PrepareAsync().  As this is
+  // called on the thread serving the requests, implementations should build
+  // the engine in PrepareAsync() if possible.
   virtual std::unique_ptr<EngineInterface> BuildFromPreparedData() = 0;
 
   // Clears internal states to accept next request.
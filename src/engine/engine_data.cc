@@ -0,0 +1,145 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/engine_data.h"
+
+#include <memory>
+#include <utility>
+
+#include "base/flags.h"
+#include "base/logging.h"
+#include "base/mmap.h"
+#include "converter/connector.h"
+#include "converter/segmenter.h"
+#include "dictionary/pos_group.h"
+#include "dictionary/pos_matcher.h"
+#include "dictionary/suffix_dictionary.h"
+#include "prediction/suggestion_filter.h"
+
+DEFINE_bool(lock_connection_data, false,
+            "Lock the connection matrix in physical memory with mlock().");
+
+namespace mozc {
+
+using dictionary::PosGroup;
+using dictionary::POSMatcher;
+using dictionary::SuffixDictionary;
+
+std::shared_ptr<const EngineData> EngineData::Create(
+    std::unique_ptr<const DataManagerInterface> data_manager) {
+  return std::shared_ptr<const EngineData>(
+      new EngineData(std::move(data_manager)));
+}
+
+EngineData::EngineData(
+    std::unique_ptr<const DataManagerInterface> data_manager)
+    : data_manager_(std::move(data_manager)), num_engines_(0) {
+  CHECK(data_manager_);
+
+  pos_matcher_.reset(new POSMatcher(data_manager_->GetPOSMatcherData()));
+
+  StringPiece suffix_key_array_data, suffix_value_array_data;
+  const uint32 *token_array;
+  data_manager_->GetSuffixDictionaryData(&suffix_key_array_data,
+                                         &suffix_value_array_data,
+                                         &token_array);
+  StringPiece suffix_index_array_data;
+  data_manager_->GetSuffixDictionaryIndexData(&suffix_index_array_data);
+  suffix_dictionary_.reset(new SuffixDictionary(suffix_key_array_data,
+                                                suffix_value_array_data,
+                                                token_array,
+                                                suffix_index_array_data));
+  CHECK(suffix_dictionary_.get());
+
+  connector_.reset(Connector::CreateFromDataManager(*data_manager_));
+  CHECK(connector_.get());
+
+  segmenter_.reset(Segmenter::CreateFromDataManager(*data_manager_));
+  CHECK(segmenter_.get());
+
+  pos_group_.reset(new PosGroup(data_manager_->GetPosGroupData()));
+  CHECK(pos_group_.get());
+
+  {
+    const char *data = NULL;
+    size_t size = 0;
+    data_manager_->GetSuggestionFilterData(&data, &size);
+    CHECK(data);
+    suggestion_filter_.reset(new SuggestionFilter(data, size));
+  }
+
+  // Connector uses the dense matrix if the data set has it.
+  const char *connection_data = nullptr;
+  size_t connection_size = 0;
+  data_manager_->GetDenseConnectorData(&connection_data, &connection_size);
+  if (connection_data == nullptr || connection_size == 0) {
+    data_manager_->GetConnectorData(&connection_data, &connection_size);
+  }
+
+  // The matrix is looked up at random for every pair of the nodes, so the
+  // huge pages save the TLB misses where they are available.
+  Mmap::MaybeUseHugePages(connection_data, connection_size);
+
+  if (FLAGS_lock_connection_data) {
+    if (Mmap::MaybeMLock(connection_data, connection_size) == 0) {
+      locked_connection_data_.set(connection_data, connection_size);
+    } else {
+      LOG(WARNING) << "Failed to lock the connection data of "
+                   << connection_size << " bytes";
+    }
+  }
+}
+
+EngineData::~EngineData() {
+  DCHECK_EQ(0, num_engines_.load());
+  if (!locked_connection_data_.empty()) {
+    Mmap::MaybeMUnlock(locked_connection_data_.data(),
+                       locked_connection_data_.size());
+  }
+}
+
+void EngineData::GetMemoryReport(MemoryReport *report) const {
+  DCHECK(report);
+  report->num_engines = num_engines_.load();
+  report->table_bytes =
+      connector_->GetAllocatedBytes() + suggestion_filter_->GetAllocatedBytes();
+  report->saved_table_bytes =
+      report->num_engines > 1 ?
+      (report->num_engines - 1) * report->table_bytes : 0;
+}
+
+void EngineData::AddEngine() const {
+  ++num_engines_;
+}
+
+void EngineData::RemoveEngine() const {
+  --num_engines_;
+}
+
+}  // namespace mozc
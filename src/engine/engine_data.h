@@ -0,0 +1,126 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_ENGINE_ENGINE_DATA_H_
+#define MOZC_ENGINE_ENGINE_DATA_H_
+
+#include <atomic>
+#include <memory>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+#include "data_manager/data_manager_interface.h"
+
+namespace mozc {
+
+class Connector;
+class Segmenter;
+class SuggestionFilter;
+
+namespace dictionary {
+class DictionaryInterface;
+class POSMatcher;
+class PosGroup;
+}  // namespace dictionary
+
+// The immutable layer of the conversion engine: the data manager and the
+// tables built from it, which are never modified after construction and are
+// thread-safe to read.  Several Engine instances, e.g., a desktop and a mobile
+// engine in one process, can share one instance instead of each building its
+// own copy.  The instance is reference counted with std::shared_ptr and lives
+// while any engine built on it lives.
+//
+// The system dictionary is not included since its reverse lookup cache is
+// modified by conversions, and the rewriters are built by each engine.
+class EngineData {
+ public:
+  // Memory shared by the engines built on this instance.
+  struct MemoryReport {
+    // Number of engines currently built on this instance.
+    int num_engines;
+    // Bytes of the heap allocated by the tables.
+    size_t table_bytes;
+    // Bytes of the tables that separate engines would have allocated in
+    // addition, i.e., (num_engines - 1) * table_bytes.
+    size_t saved_table_bytes;
+  };
+
+  // Builds the tables from |data_manager|, whose ownership is passed to the
+  // returned instance.
+  static std::shared_ptr<const EngineData> Create(
+      std::unique_ptr<const DataManagerInterface> data_manager);
+
+  ~EngineData();
+
+  const DataManagerInterface &data_manager() const { return *data_manager_; }
+  const dictionary::POSMatcher *pos_matcher() const {
+    return pos_matcher_.get();
+  }
+  const dictionary::DictionaryInterface *suffix_dictionary() const {
+    return suffix_dictionary_.get();
+  }
+  const Connector *connector() const { return connector_.get(); }
+  const Segmenter *segmenter() const { return segmenter_.get(); }
+  const dictionary::PosGroup *pos_group() const { return pos_group_.get(); }
+  const SuggestionFilter *suggestion_filter() const {
+    return suggestion_filter_.get();
+  }
+
+  void GetMemoryReport(MemoryReport *report) const;
+
+ private:
+  friend class Engine;
+
+  explicit EngineData(
+      std::unique_ptr<const DataManagerInterface> data_manager);
+
+  // Called by Engine on construction and destruction for the memory report.
+  void AddEngine() const;
+  void RemoveEngine() const;
+
+  std::unique_ptr<const DataManagerInterface> data_manager_;
+  std::unique_ptr<const dictionary::POSMatcher> pos_matcher_;
+  std::unique_ptr<const dictionary::DictionaryInterface> suffix_dictionary_;
+  std::unique_ptr<const Connector> connector_;
+  std::unique_ptr<const Segmenter> segmenter_;
+  std::unique_ptr<const dictionary::PosGroup> pos_group_;
+  std::unique_ptr<const SuggestionFilter> suggestion_filter_;
+
+  // The connection data locked by mlock(), which is unlocked on destruction.
+  // Locked here rather than by each engine, as the lock is not counted.
+  StringPiece locked_connection_data_;
+
+  mutable std::atomic<int> num_engines_;
+
+  DISALLOW_COPY_AND_ASSIGN(EngineData);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_ENGINE_ENGINE_DATA_H_
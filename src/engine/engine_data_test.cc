@@ -0,0 +1,148 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/engine_data.h"
+
+#include <memory>
+#include <vector>
+
+#include "base/memory_stats.h"
+#include "base/system_util.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "engine/engine.h"
+#include "prediction/predictor_interface.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class EngineDataTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  }
+};
+
+TEST_F(EngineDataTest, SharedByEngines) {
+  std::shared_ptr<const EngineData> data = EngineData::Create(
+      std::unique_ptr<const DataManagerInterface>(
+          new testing::MockDataManager()));
+  ASSERT_TRUE(data);
+
+  EngineData::MemoryReport report;
+  data->GetMemoryReport(&report);
+  EXPECT_EQ(0, report.num_engines);
+  EXPECT_LT(0, report.table_bytes);
+  EXPECT_EQ(0, report.saved_table_bytes);
+
+  std::unique_ptr<Engine> desktop = Engine::CreateDesktopEngine(data);
+  std::unique_ptr<Engine> mobile = Engine::CreateMobileEngine(data);
+  EXPECT_EQ(data, desktop->GetEngineData());
+  EXPECT_EQ(data, mobile->GetEngineData());
+  EXPECT_EQ(&data->data_manager(), desktop->GetDataManager());
+  EXPECT_EQ(&data->data_manager(), mobile->GetDataManager());
+
+  data->GetMemoryReport(&report);
+  EXPECT_EQ(2, report.num_engines);
+  EXPECT_EQ(report.table_bytes, report.saved_table_bytes);
+
+  // The data outlives the engine which doesn't share it anymore.
+  desktop.reset();
+  data->GetMemoryReport(&report);
+  EXPECT_EQ(1, report.num_engines);
+  EXPECT_EQ(0, report.saved_table_bytes);
+
+  // The last reference keeps the data alive after the caller releases it.
+  const EngineData *raw_data = data.get();
+  data.reset();
+  EXPECT_EQ(raw_data, mobile->GetEngineData().get());
+  EXPECT_FALSE(mobile->GetDataVersion().empty());
+}
+
+TEST_F(EngineDataTest, EngineOwnsItsDataByDefault) {
+  std::unique_ptr<Engine> engine =
+      Engine::CreateDesktopEngineHelper<testing::MockDataManager>();
+  ASSERT_TRUE(engine->GetEngineData());
+  EngineData::MemoryReport report;
+  engine->GetEngineData()->GetMemoryReport(&report);
+  EXPECT_EQ(1, report.num_engines);
+}
+
+TEST_F(EngineDataTest, CreateSibling) {
+  std::unique_ptr<Engine> engine =
+      Engine::CreateMobileEngineHelper<testing::MockDataManager>();
+  std::unique_ptr<Engine> sibling = engine->CreateSibling();
+  ASSERT_TRUE(sibling);
+  EXPECT_EQ(engine->GetEngineData(), sibling->GetEngineData());
+  EXPECT_NE(engine->GetConverter(), sibling->GetConverter());
+  EXPECT_EQ(engine->GetPredictor()->GetPredictorName(),
+            sibling->GetPredictor()->GetPredictorName());
+}
+
+uint64 GetUnsharedHeapBytes(const Engine &engine) {
+  std::vector<MemoryStats::Usage> usages;
+  engine.CollectMemoryUsage(&usages);
+  uint64 bytes = 0;
+  for (const MemoryStats::Usage &usage : usages) {
+    // The data set and the tables are shared by the engines.
+    if (usage.component.compare(0, 7, "dataset") != 0 &&
+        usage.component != "engine_data") {
+      bytes += usage.resident_bytes;
+    }
+  }
+  return bytes;
+}
+
+TEST_F(EngineDataTest, LowMemoryEngine) {
+  std::shared_ptr<const EngineData> data = EngineData::Create(
+      std::unique_ptr<const DataManagerInterface>(
+          new testing::MockDataManager()));
+  std::unique_ptr<Engine> desktop = Engine::CreateDesktopEngine(data);
+  std::unique_ptr<Engine> mobile = Engine::CreateMobileEngine(data);
+  std::unique_ptr<Engine> low_memory = Engine::CreateLowMemoryEngine(data);
+  EXPECT_FALSE(desktop->IsLowMemory());
+  EXPECT_FALSE(mobile->IsLowMemory());
+  EXPECT_TRUE(low_memory->IsLowMemory());
+  EXPECT_TRUE(low_memory->CreateSibling()->IsLowMemory());
+  EXPECT_EQ(mobile->GetPredictor()->GetPredictorName(),
+            low_memory->GetPredictor()->GetPredictorName());
+
+  EXPECT_GE(GetUnsharedHeapBytes(*mobile), GetUnsharedHeapBytes(*low_memory));
+  EXPECT_GE(GetUnsharedHeapBytes(*desktop),
+            GetUnsharedHeapBytes(*low_memory));
+
+  // The data set embedded in the binary is not released, but the engine
+  // keeps working.
+  low_memory->ReleaseUnusedMemory();
+  EXPECT_FALSE(low_memory->GetDataVersion().empty());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -30,6 +30,9 @@
 #ifndef MOZC_ENGINE_ENGINE_INTERFACE_H_
 #define MOZC_ENGINE_ENGINE_INTERFACE_H_
 
+#include <vector>
+
+#include "base/memory_stats.h"
 #include "base/port.h"
 #include "base/string_piece.h"
 #include "data_manager/data_manager_interface.h"
@@ -73,6 +76,14 @@ class EngineInterface {
   // Gets the data manager.
   virtual const DataManagerInterface *GetDataManager() const = 0;
 
+  // Appends the memory used by the modules of this engine to |usages|.
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const {}
+
+  // Releases the memory which can be restored later, e.g., on memory
+  // pressure.
+  virtual void ReleaseUnusedMemory() {}
+
  protected:
   EngineInterface() {}
 
@@ -56,12 +56,33 @@
         }
       ],
     },
+    {
+      'target_name': 'engine_data_test',
+      'type': 'executable',
+      'sources': ['engine_data_test.cc'],
+      'dependencies': [
+        'engine.gyp:engine',
+        '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
+        '../testing/testing.gyp:gtest_main',
+      ],
+    },
+    {
+      'target_name': 'warm_state_snapshot_test',
+      'type': 'executable',
+      'sources': ['warm_state_snapshot_test.cc'],
+      'dependencies': [
+        'engine.gyp:engine',
+        '../testing/testing.gyp:gtest_main',
+      ],
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'engine_all_test',
       'type': 'none',
       'dependencies': [
         'engine_builder_test',
+        'engine_data_test',
+        'warm_state_snapshot_test',
       ],
     },
   ],
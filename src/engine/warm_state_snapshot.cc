@@ -0,0 +1,171 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/warm_state_snapshot.h"
+
+#include <cstring>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/mmap.h"
+
+namespace mozc {
+namespace {
+
+// The format is:
+//   magic number (8 bytes)
+//   data version (block)
+//   number of the sections (4 bytes)
+//   name and value of the sections (2 blocks each)
+// where a block is the size (4 bytes) followed by the bytes.
+const char kMagicNumber[] = "MOZCWSS1";
+const size_t kMagicNumberSize = 8;
+
+void AppendBlock(StringPiece data, string *output) {
+  const uint32 size = static_cast<uint32>(data.size());
+  output->append(reinterpret_cast<const char *>(&size), sizeof(size));
+  output->append(data.data(), data.size());
+}
+
+bool ReadUint32(StringPiece *input, uint32 *value) {
+  if (input->size() < sizeof(*value)) {
+    return false;
+  }
+  memcpy(value, input->data(), sizeof(*value));
+  input->remove_prefix(sizeof(*value));
+  return true;
+}
+
+bool ReadBlock(StringPiece *input, StringPiece *block) {
+  uint32 size = 0;
+  if (!ReadUint32(input, &size) || input->size() < size) {
+    return false;
+  }
+  *block = StringPiece(input->data(), size);
+  input->remove_prefix(size);
+  return true;
+}
+
+}  // namespace
+
+WarmStateSnapshot::WarmStateSnapshot() = default;
+WarmStateSnapshot::~WarmStateSnapshot() = default;
+
+bool WarmStateSnapshot::Open(const string &filename,
+                             StringPiece data_version) {
+  mmap_.reset();
+  sections_.clear();
+  if (!FileUtil::FileExists(filename)) {
+    return false;
+  }
+  std::unique_ptr<Mmap> mmap(new Mmap);
+  if (!mmap->Open(filename.c_str(), "r")) {
+    LOG(WARNING) << "Cannot open the snapshot: " << filename;
+    return false;
+  }
+
+  StringPiece input(mmap->begin(), mmap->size());
+  if (!input.starts_with(StringPiece(kMagicNumber, kMagicNumberSize))) {
+    LOG(WARNING) << "Broken snapshot: " << filename;
+    return false;
+  }
+  input.remove_prefix(kMagicNumberSize);
+  StringPiece version;
+  uint32 num_sections = 0;
+  if (!ReadBlock(&input, &version) || !ReadUint32(&input, &num_sections)) {
+    LOG(WARNING) << "Broken snapshot: " << filename;
+    return false;
+  }
+  if (version != data_version) {
+    VLOG(1) << "The snapshot is for another data version: " << version;
+    return false;
+  }
+  std::vector<std::pair<StringPiece, StringPiece>> sections(num_sections);
+  for (uint32 i = 0; i < num_sections; ++i) {
+    if (!ReadBlock(&input, &sections[i].first) ||
+        !ReadBlock(&input, &sections[i].second)) {
+      LOG(WARNING) << "Broken snapshot: " << filename;
+      return false;
+    }
+  }
+
+  mmap_ = std::move(mmap);
+  sections_.swap(sections);
+  return true;
+}
+
+bool WarmStateSnapshot::GetSection(StringPiece name,
+                                   StringPiece *value) const {
+  for (size_t i = 0; i < sections_.size(); ++i) {
+    if (sections_[i].first == name) {
+      *value = sections_[i].second;
+      return true;
+    }
+  }
+  return false;
+}
+
+// static
+bool WarmStateSnapshot::Write(const string &filename,
+                              StringPiece data_version,
+                              const std::map<string, string> &sections) {
+  string output(kMagicNumber, kMagicNumberSize);
+  AppendBlock(data_version, &output);
+  const uint32 num_sections = static_cast<uint32>(sections.size());
+  output.append(reinterpret_cast<const char *>(&num_sections),
+                sizeof(num_sections));
+  for (const auto &section : sections) {
+    AppendBlock(section.first, &output);
+    AppendBlock(section.second, &output);
+  }
+
+  const string tmp_filename = filename + ".tmp";
+  {
+    OutputFileStream ofs(tmp_filename.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      LOG(WARNING) << "Cannot write the snapshot: " << tmp_filename;
+      return false;
+    }
+    ofs.write(output.data(), output.size());
+    if (!ofs) {
+      LOG(WARNING) << "Cannot write the snapshot: " << tmp_filename;
+      return false;
+    }
+  }
+  if (!FileUtil::AtomicRename(tmp_filename, filename)) {
+    LOG(WARNING) << "Cannot rename the snapshot to " << filename;
+    FileUtil::Unlink(tmp_filename);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace mozc
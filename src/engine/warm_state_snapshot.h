@@ -0,0 +1,79 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_ENGINE_WARM_STATE_SNAPSHOT_H_
+#define MOZC_ENGINE_WARM_STATE_SNAPSHOT_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/port.h"
+#include "base/string_piece.h"
+
+namespace mozc {
+
+class Mmap;
+
+// A file of the state derived from the data set, e.g., the cache of the
+// connector, which can be rebuilt at any time but takes a while to warm up.
+// The engine writes it on destruction and maps it at the next startup so that
+// a restarted server is as fast on the first key events as a warmed one.  The
+// snapshot is tied to the data version; the one for another data set is
+// ignored.  The integers are stored in the native byte order, since the
+// snapshot is read only by the machine which wrote it.
+class WarmStateSnapshot {
+ public:
+  WarmStateSnapshot();
+  ~WarmStateSnapshot();
+
+  // Maps |filename|.  Returns false if the file is missing, broken or for
+  // another data version.
+  bool Open(const string &filename, StringPiece data_version);
+
+  // Sets |value| to the section of |name| in the opened snapshot.  |value|
+  // points to the mapped file, so it is valid until this object is destroyed.
+  bool GetSection(StringPiece name, StringPiece *value) const;
+
+  // Writes the snapshot of |sections| to |filename| atomically.
+  static bool Write(const string &filename, StringPiece data_version,
+                    const std::map<string, string> &sections);
+
+ private:
+  std::unique_ptr<Mmap> mmap_;
+  std::vector<std::pair<StringPiece, StringPiece>> sections_;
+
+  DISALLOW_COPY_AND_ASSIGN(WarmStateSnapshot);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_ENGINE_WARM_STATE_SNAPSHOT_H_
@@ -0,0 +1,106 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "engine/warm_state_snapshot.h"
+
+#include <map>
+#include <string>
+
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class WarmStateSnapshotTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    filename_ = FileUtil::JoinPath(FLAGS_test_tmpdir, "warm_state.snapshot");
+    FileUtil::Unlink(filename_);
+  }
+
+  void TearDown() override {
+    FileUtil::Unlink(filename_);
+  }
+
+  string filename_;
+};
+
+TEST_F(WarmStateSnapshotTest, WriteAndOpen) {
+  std::map<string, string> sections;
+  sections["cache"] = string("\x00\x01\x02", 3);
+  sections["empty"] = "";
+  ASSERT_TRUE(WarmStateSnapshot::Write(filename_, "1.2.3", sections));
+
+  WarmStateSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(filename_, "1.2.3"));
+  StringPiece value;
+  ASSERT_TRUE(snapshot.GetSection("cache", &value));
+  EXPECT_EQ(string("\x00\x01\x02", 3), value);
+  ASSERT_TRUE(snapshot.GetSection("empty", &value));
+  EXPECT_TRUE(value.empty());
+  EXPECT_FALSE(snapshot.GetSection("unknown", &value));
+}
+
+TEST_F(WarmStateSnapshotTest, RejectOtherDataVersion) {
+  std::map<string, string> sections;
+  sections["cache"] = "value";
+  ASSERT_TRUE(WarmStateSnapshot::Write(filename_, "1.2.3", sections));
+
+  WarmStateSnapshot snapshot;
+  EXPECT_FALSE(snapshot.Open(filename_, "1.2.4"));
+  StringPiece value;
+  EXPECT_FALSE(snapshot.GetSection("cache", &value));
+}
+
+TEST_F(WarmStateSnapshotTest, RejectBrokenFile) {
+  WarmStateSnapshot snapshot;
+  EXPECT_FALSE(snapshot.Open(filename_, "1.2.3"));
+
+  std::map<string, string> sections;
+  sections["cache"] = "value";
+  ASSERT_TRUE(WarmStateSnapshot::Write(filename_, "1.2.3", sections));
+  string content;
+  {
+    InputFileStream ifs(filename_.c_str(), std::ios::in | std::ios::binary);
+    content = ifs.Read();
+  }
+  // Truncates the value of the section.
+  {
+    OutputFileStream ofs(filename_.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    ofs.write(content.data(), content.size() - 1);
+  }
+  EXPECT_FALSE(snapshot.Open(filename_, "1.2.3"));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -132,6 +132,7 @@
         'process_watch_dog_test.cc',
       ],
       'dependencies': [
+        '../base/base_test.gyp:clock_mock',
         '../testing/testing.gyp:gtest_main',
         'ipc',
         'ipc_test_util',
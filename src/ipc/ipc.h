@@ -43,6 +43,7 @@
 namespace mozc {
 
 class IPCPathManager;
+class SharedMemoryChannel;
 class Thread;
 
 enum {
@@ -52,7 +53,7 @@ enum {
 
 // increment this value if protocol has changed.
 enum {
-  IPC_PROTOCOL_VERSION = 3,
+  IPC_PROTOCOL_VERSION = 4,
 };
 
 enum IPCErrorType {
@@ -84,6 +85,11 @@ class IPCClientInterface {
 
   // return last error
   virtual IPCErrorType GetLastIPCError() const = 0;
+
+  // Returns true if Call() can be called again on this connection.
+  virtual bool IsReusable() const {
+    return false;
+  }
 };
 
 #ifdef OS_MACOSX
@@ -146,8 +152,14 @@ class IPCClient : public IPCClientInterface {
   // Return true when IPC finishes successfully.
   // When Server doesn't send response within timeout, 'Call' returns false.
   // When timeout (in msec) is set -1, 'Call' waits forever.
-  // Note that on Linux and Windows, Call() closes the socket_. This means you
-  // cannot call the Call() function more than once.
+  // Note that on Windows, Call() closes the pipe. This means you cannot call
+  // the Call() function more than once.  On Linux, the connection is kept
+  // until an error occurs, and IsReusable() tells if Call() can be called
+  // again.  When the server has closed the connection before receiving the
+  // request, e.g., on restart, Call() fails with IPC_NO_CONNECTION.
+  // With --use_shared_memory_ipc, the first call on Linux asks the server
+  // for a shared memory channel, which carries the requests and the
+  // responses in place of the socket from then on.
   bool Call(const char *request,
             size_t request_size,
             char *response,
@@ -158,6 +170,8 @@ class IPCClient : public IPCClientInterface {
     return last_ipc_error_;
   }
 
+  bool IsReusable() const;
+
   // terminate the server process named |name|
   // Do not use it unless version mismatch happens
   static bool TerminateServer(const string &name);
@@ -180,6 +194,10 @@ class IPCClient : public IPCClientInterface {
   MachPortManagerInterface *mach_port_manager_;
 #else
   int socket_;
+  // The shared memory transport, which is negotiated on the first call if
+  // --use_shared_memory_ipc is set.
+  std::unique_ptr<SharedMemoryChannel> shared_memory_;
+  bool shared_memory_negotiated_;
 #endif
   bool connected_;
   IPCPathManager *ipc_path_manager_;
@@ -252,6 +270,12 @@ class IPCServer {
                        char *response,
                        size_t *response_size) = 0;
 
+  // Called in the server thread when no request has come for a while after
+  // the last one.  Returns true if more work remains.  Since requests are
+  // not handled during the call, each call should do a short piece of work.
+  // Currently only the Linux server calls this.
+  virtual bool DoIdleWork() { return false; }
+
   // Start select loop. It goes into infinite loop.
   void Loop();
 
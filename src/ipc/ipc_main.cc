@@ -29,6 +29,7 @@
 
 #include <cstring>
 #include <iostream>  // NOLINT
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,7 @@
 #include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/stopwatch.h"
 #include "base/thread.h"
 #include "ipc/ipc.h"
 
@@ -46,6 +48,11 @@ DEFINE_bool(client, false, "invoke as client mode");
 DEFINE_string(server_path, "", "server path");
 DEFINE_int32(num_threads, 10, "number of threads");
 DEFINE_int32(num_requests, 100, "number of requests");
+DEFINE_bool(benchmark, false, "compare the latency of the transports");
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+DECLARE_bool(use_shared_memory_ipc);
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
 
 namespace mozc {
 
@@ -93,6 +100,28 @@ class EchoServerThread: public Thread {
   EchoServer *con_;
 };
 
+// Calls the echo server with the requests of some sizes on a connection and
+// prints the average latency.
+void RunBenchmark(const char *transport) {
+  IPCClient con(FLAGS_server_address, FLAGS_server_path);
+  CHECK(con.Connected());
+  std::unique_ptr<char[]> buf(new char[IPC_RESPONSESIZE]);
+  const size_t kSizes[] = {16, 1024, 16 * 1024, 64 * 1024};
+  for (size_t i = 0; i < arraysize(kSizes); ++i) {
+    const string input(kSizes[i], 'a');
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    for (int j = 0; j < FLAGS_num_requests; ++j) {
+      size_t length = IPC_RESPONSESIZE;
+      CHECK(con.Call(input.data(), input.size(), buf.get(), &length, 1000));
+      CHECK_EQ(input.size(), length);
+    }
+    stopwatch.Stop();
+    cout << transport << "\t" << kSizes[i] << " bytes\t"
+         << stopwatch.GetElapsedMicroseconds() / FLAGS_num_requests
+         << " usec/call" << endl;
+  }
+}
+
 }  // namespace mozc
 
 int main(int argc, char **argv) {
@@ -123,6 +152,24 @@ int main(int argc, char **argv) {
 
     LOG(INFO) << "Done";
 
+  } else if (FLAGS_benchmark) {
+    mozc::EchoServer con(FLAGS_server_address, 10, 1000);
+    mozc::EchoServerThread server_thread_main(&con);
+    server_thread_main.SetJoinable(true);
+    server_thread_main.Start("IpcMain");
+
+    mozc::RunBenchmark("socket");
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+    FLAGS_use_shared_memory_ipc = true;
+    mozc::RunBenchmark("shared memory");
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
+
+    mozc::IPCClient kill(FLAGS_server_address, FLAGS_server_path);
+    const char kill_cmd[32] = "kill";
+    char output[32];
+    size_t output_size = sizeof(output);
+    kill.Call(kill_cmd, strlen(kill_cmd), output, &output_size, 1000);
+    server_thread_main.Join();
   } else if (FLAGS_server) {
     mozc::EchoServer con(FLAGS_server_address,
                          10, -1);
@@ -142,7 +189,8 @@ int main(int argc, char **argv) {
       cout << "Response: " << string(response, response_size) << endl;
     }
   } else {
-    LOG(INFO) << "either --server or --client or --test must be set true";
+    LOG(INFO) << "either --server or --client or --test or --benchmark "
+              << "must be set true";
   }
 
   return 0;
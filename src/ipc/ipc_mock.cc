@@ -44,7 +44,8 @@ IPCClientMock::IPCClientMock(IPCClientFactoryMock *caller)
         server_protocol_version_(0),
         server_product_version_(Version::GetMozcVersion()),
         server_process_id_(0),
-        result_(false) {
+        result_(false),
+        reusable_(false) {
 }
 
 bool IPCClientMock::Connected() const {
@@ -80,7 +81,9 @@ bool IPCClientMock::Call(const char *request,
 
 IPCClientFactoryMock::IPCClientFactoryMock()
     : connection_(false), result_(false),
-      server_protocol_version_(IPC_PROTOCOL_VERSION) {
+      server_protocol_version_(IPC_PROTOCOL_VERSION),
+      reusable_(false),
+      num_clients_(0) {
 }
 
 IPCClientInterface *IPCClientFactoryMock::NewClient(const string &unused_name,
@@ -128,13 +131,19 @@ void IPCClientFactoryMock::SetServerProcessId(const uint32
   server_process_id_ = server_process_id;
 }
 
+void IPCClientFactoryMock::SetReusable(const bool reusable) {
+  reusable_ = reusable;
+}
+
 IPCClientMock *IPCClientFactoryMock::NewClientMock() {
+  ++num_clients_;
   IPCClientMock *client = new IPCClientMock(this);
   client->set_connection(connection_);
   client->set_result(result_);
   client->set_response(response_);
   client->set_server_protocol_version(server_protocol_version_);
   client->set_server_product_version(server_product_version_);
+  client->set_reusable(reusable_);
   return client;
 }
 
@@ -54,6 +54,10 @@ class IPCClientMock : public IPCClientInterface {
     return IPC_NO_ERROR;
   }
 
+  virtual bool IsReusable() const {
+    return reusable_;
+  }
+
   void set_connection(const bool connection) {
     connected_ = connection;
   }
@@ -72,6 +76,9 @@ class IPCClientMock : public IPCClientInterface {
   void set_response(const string &response) {
     response_ = response;
   }
+  void set_reusable(const bool reusable) {
+    reusable_ = reusable;
+  }
 
  private:
   IPCClientFactoryMock* caller_;
@@ -81,6 +88,7 @@ class IPCClientMock : public IPCClientInterface {
   uint32 server_process_id_;
   bool result_;
   string response_;
+  bool reusable_;
 
   DISALLOW_COPY_AND_ASSIGN(IPCClientMock);
 };
@@ -118,6 +126,14 @@ class IPCClientFactoryMock : public IPCClientFactoryInterface {
   // This function is supporsed to be used by unittests.
   void SetServerProcessId(const uint32 server_process_id);
 
+  // This function is supporsed to be used by unittests.
+  void SetReusable(const bool reusable);
+
+  // Returns the number of the clients made by NewClient().
+  int num_clients() const {
+    return num_clients_;
+  }
+
  private:
   IPCClientMock *NewClientMock();
 
@@ -128,6 +144,8 @@ class IPCClientFactoryMock : public IPCClientFactoryInterface {
   uint32 server_process_id_;
   string request_;
   string response_;
+  bool reusable_;
+  int num_clients_;
 
   DISALLOW_COPY_AND_ASSIGN(IPCClientFactoryMock);
 };
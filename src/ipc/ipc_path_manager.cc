@@ -54,6 +54,7 @@
 #include <memory>  // for std::unique_ptr
 #endif
 
+#include "base/clock.h"
 #include "base/const.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
@@ -175,14 +176,28 @@ class IPCPathManagerMap {
   Mutex mutex_;
 };
 
+uint64 GetCurrentMsec() {
+  return Clock::GetTicks() / (Clock::GetFrequency() / 1000);
+}
+
 }  // namespace
 
+const uint64 IPCPathManager::kReloadCheckIntervalMsec = 1000;
+
+IPCPathManager::FileStamp::FileStamp()
+    : inode(0), size(0), mtime_sec(-1), mtime_nsec(0) {}
+
+bool IPCPathManager::FileStamp::operator==(const FileStamp &other) const {
+  return inode == other.inode && size == other.size &&
+         mtime_sec == other.mtime_sec && mtime_nsec == other.mtime_nsec;
+}
+
 IPCPathManager::IPCPathManager(const string &name)
     : mutex_(new Mutex),
       ipc_path_info_(new ipc::IPCPathInfo),
       name_(name),
       server_pid_(0),
-      last_modified_(-1) {}
+      last_check_msec_(0) {}
 
 IPCPathManager::~IPCPathManager() {}
 
@@ -227,6 +242,11 @@ bool IPCPathManager::SavePathName() {
   ipc_path_info_->set_thread_id(0);
 #endif
 
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+  // IPCServer of unix_ipc.cc accepts the shared memory transport.
+  ipc_path_info_->set_shared_memory(true);
+#endif
+
   string buf;
   if (!ipc_path_info_->SerializeToString(&buf)) {
     LOG(ERROR) << "SerializeToString failed";
@@ -240,15 +260,32 @@ bool IPCPathManager::SavePathName() {
 
   VLOG(1) << "ServerIPCKey: " << ipc_path_info_->key();
 
-  last_modified_ = GetIPCFileTimeStamp();
+  last_stamp_ = GetIPCFileStamp();
   return true;
 }
 
 bool IPCPathManager::LoadPathName() {
+  // Clients call this method for every connection.  While the cached key is
+  // fresh, trust it without touching the file; a stale key makes the
+  // connection fail and the caller calls Clear(), which empties the key.
+  bool has_key = false;
+  {
+    scoped_lock l(mutex_.get());
+    has_key = !ipc_path_info_->key().empty();
+    if (has_key) {
+      const uint64 now = GetCurrentMsec();
+      if (now >= last_check_msec_ &&
+          now - last_check_msec_ < kReloadCheckIntervalMsec) {
+        return true;
+      }
+      last_check_msec_ = now;
+    }
+  }
+
   // On Windows, ShouldReload() always returns false.
-  // On other platform, it returns true when timestamp of the file is different
-  // from that of previous one.
-  if (ShouldReload() || ipc_path_info_->key().empty()) {
+  // On other platform, it returns true when the key file is different from
+  // the one previously loaded.
+  if (!has_key || ShouldReload()) {
     if (!LoadPathNameInternal()) {
       LOG(ERROR) << "LoadPathName failed";
       return false;
@@ -294,6 +331,10 @@ uint32 IPCPathManager::GetServerProtocolVersion() const {
   return ipc_path_info_->protocol_version();
 }
 
+bool IPCPathManager::IsSharedMemorySupported() const {
+  return ipc_path_info_->shared_memory();
+}
+
 const string &IPCPathManager::GetServerProductVersion() const {
   return ipc_path_info_->product_version();
 }
@@ -431,29 +472,31 @@ bool IPCPathManager::ShouldReload() const {
 #else
   scoped_lock l(mutex_.get());
 
-  time_t last_modified = GetIPCFileTimeStamp();
-  if (last_modified == last_modified_) {
-    return false;
-  }
-
-  return true;
+  return !(GetIPCFileStamp() == last_stamp_);
 #endif  // OS_WIN
 }
 
-time_t IPCPathManager::GetIPCFileTimeStamp() const {
-#ifdef OS_WIN
-  // In windows, we don't need to get the exact file timestamp, so
-  // just returns -1 at this time.
-  return static_cast<time_t>(-1);
-#else
+IPCPathManager::FileStamp IPCPathManager::GetIPCFileStamp() const {
+  FileStamp stamp;
+#ifndef OS_WIN
+  // In windows, we don't need to get the exact file stamp, so just returns
+  // the default one.
   const string filename = GetIPCKeyFileName(name_);
   struct stat filestat;
   if (::stat(filename.c_str(), &filestat) == -1) {
     VLOG(2) << "stat(2) failed.  Skipping reload";
-    return static_cast<time_t>(-1);
+    return stamp;
   }
-  return filestat.st_mtime;
+  stamp.inode = static_cast<uint64>(filestat.st_ino);
+  stamp.size = static_cast<uint64>(filestat.st_size);
+  stamp.mtime_sec = static_cast<int64>(filestat.st_mtime);
+#if defined(OS_MACOSX)
+  stamp.mtime_nsec = static_cast<int64>(filestat.st_mtimespec.tv_nsec);
+#elif defined(OS_LINUX)
+  stamp.mtime_nsec = static_cast<int64>(filestat.st_mtim.tv_nsec);
+#endif  // OS_MACOSX, OS_LINUX
 #endif  // OS_WIN
+  return stamp;
 }
 
 bool IPCPathManager::LoadPathNameInternal() {
@@ -536,7 +579,8 @@ bool IPCPathManager::LoadPathNameInternal() {
   VLOG(1) << "ClientIPCKey: " << ipc_path_info_->key();
   VLOG(1) << "ProtocolVersion: " << ipc_path_info_->protocol_version();
 
-  last_modified_ = GetIPCFileTimeStamp();
+  last_stamp_ = GetIPCFileStamp();
+  last_check_msec_ = GetCurrentMsec();
   return true;
 }
 }  // namespace mozc
@@ -73,6 +73,10 @@ class IPCPathManager {
 
   // Load a pathname from a disk and updates |ipc_path_info_| if pathname is
   // empty or ipc key file is updated. Returns false if it cannot load.
+  // While a pathname is cached, the key file is checked at most once per
+  // kReloadCheckIntervalMsec, so that the request path usually does no file
+  // I/O.  Callers must call Clear() when the connection with the cached
+  // pathname fails, which forces the next call to reload the file.
   bool LoadPathName();
 
   // Get a pathanem from the heap. If pathanme is empty, returns false.
@@ -89,6 +93,9 @@ class IPCPathManager {
   // return process id of the server
   uint32 GetServerProcessId() const;
 
+  // Returns true if the server accepts the shared memory transport.
+  bool IsSharedMemorySupported() const;
+
   // Checks the server pid is the valid server specified with server_path.
   // server pid can be obtained by OS dependent method.
   // This API is only available on Windows Vista or Linux.
@@ -117,14 +124,33 @@ class IPCPathManager {
  private:
   FRIEND_TEST(IPCPathManagerTest, ReloadTest);
   FRIEND_TEST(IPCPathManagerTest, PathNameTest);
+  FRIEND_TEST(IPCPathManagerTest, CachedPathNameTest);
+
+  // Identifies a version of the IPC key file.  The modification time alone
+  // misses a server restarted within the timestamp resolution, so the inode
+  // and the size are compared too.
+  struct FileStamp {
+    FileStamp();
+    bool operator==(const FileStamp &other) const;
+
+    uint64 inode;
+    uint64 size;
+    int64 mtime_sec;
+    int64 mtime_nsec;
+  };
+
+  // Minimum interval between two checks of the key file while a pathname is
+  // cached.
+  static const uint64 kReloadCheckIntervalMsec;
 
   bool LoadPathNameInternal();
 
   // Returns true if the ipc file is updated after it load.
   bool ShouldReload() const;
 
-  // Returns the last modified timestamp of the IPC file.
-  time_t GetIPCFileTimeStamp() const;
+  // Returns the stamp of the IPC file.  Returns the default stamp if the file
+  // cannot be stat'ed.
+  FileStamp GetIPCFileStamp() const;
 
   std::unique_ptr<ProcessMutex> path_mutex_;   // lock ipc path file
   std::unique_ptr<Mutex> mutex_;   // mutex for methods
@@ -132,7 +158,8 @@ class IPCPathManager {
   string name_;
   string server_path_;   // cache for server_path
   uint32 server_pid_;    // cache for pid of server_path
-  time_t last_modified_;
+  FileStamp last_stamp_;
+  uint64 last_check_msec_;   // time of the last check of the key file
 #ifdef OS_WIN
   map<string, wstring> expected_server_ntpath_cache_;
 #endif  // OS_WIN
@@ -37,6 +37,8 @@
 #include <vector>
 
 #include "base/port.h"
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/process_mutex.h"
@@ -114,6 +116,11 @@ TEST_F(IPCPathManagerTest, IPCPathManagerTest) {
   ASSERT_FALSE(path.empty());
   EXPECT_EQ('\0', path[0]);
 #endif
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+  EXPECT_TRUE(manager->IsSharedMemorySupported());
+#else
+  EXPECT_FALSE(manager->IsSharedMemorySupported());
+#endif
 }
 
 // Test the thread-safeness of GetPathName() and
@@ -158,6 +165,59 @@ TEST_F(IPCPathManagerTest, ReloadTest) {
 #endif  // OS_WIN
 }
 
+TEST_F(IPCPathManagerTest, CachedPathNameTest) {
+  // We have only mock implementations for Windows, so no test should be run.
+#ifndef OS_WIN
+  ClockMock clock(1000, 0);
+  clock.SetFrequency(1000);  // 1 tick = 1 msec.
+  clock.SetTicks(1000000);
+  Clock::SetClockForUnitTest(&clock);
+
+  IPCPathManager *manager =
+      IPCPathManager::GetIPCPathManager("cached_path_name_test");
+  EXPECT_TRUE(manager->CreateNewPathName());
+  EXPECT_TRUE(manager->SavePathName());
+  const string original_key = manager->ipc_path_info_->key();
+
+  manager->Clear();
+  EXPECT_TRUE(manager->LoadPathName());
+  EXPECT_EQ(original_key, manager->ipc_path_info_->key());
+
+  // Replace the key file as if another server had started.
+  EXPECT_TRUE(manager->path_mutex_->UnLock());
+  ipc::IPCPathInfo new_info = *(manager->ipc_path_info_);
+  const string new_key(original_key.size(), '0');
+  new_info.set_key(new_key);
+  const string filename = FileUtil::JoinPath(
+      SystemUtil::GetUserProfileDirectory(), ".cached_path_name_test.ipc");
+  {
+    OutputFileStream outf(filename.c_str(), ios::out | ios::binary);
+    outf << new_info.SerializeAsString();
+  }
+
+  // The cached key is used without checking the file.
+  EXPECT_TRUE(manager->LoadPathName());
+  EXPECT_EQ(original_key, manager->ipc_path_info_->key());
+
+  // The file is checked again after the interval.
+  clock.PutClockForwardByTicks(IPCPathManager::kReloadCheckIntervalMsec);
+  EXPECT_TRUE(manager->LoadPathName());
+  EXPECT_EQ(new_key, manager->ipc_path_info_->key());
+
+  // Clear() forces reloading regardless of the interval.
+  new_info.set_key(original_key);
+  {
+    OutputFileStream outf(filename.c_str(), ios::out | ios::binary);
+    outf << new_info.SerializeAsString();
+  }
+  manager->Clear();
+  EXPECT_TRUE(manager->LoadPathName());
+  EXPECT_EQ(original_key, manager->ipc_path_info_->key());
+
+  Clock::SetClockForUnitTest(NULL);
+#endif  // OS_WIN
+}
+
 TEST_F(IPCPathManagerTest, PathNameTest) {
   IPCPathManager *manager =
       IPCPathManager::GetIPCPathManager("path_name_test");
@@ -29,6 +29,11 @@
 
 #include "ipc/ipc.h"
 
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+#include <dirent.h>
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
+
 #include <algorithm>
 #include <vector>
 
@@ -42,6 +47,9 @@
 #include "testing/base/public/gunit.h"
 
 DECLARE_string(test_tmpdir);
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+DECLARE_bool(use_shared_memory_ipc);
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
 
 namespace {
 
@@ -168,3 +176,151 @@ TEST(IPCTest, IPCTest) {
 
   con.Wait();
 }
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+// The server handles the connections at once, so a client which doesn't send
+// its request doesn't block the others until the timeout.
+TEST(IPCTest, StalledClient) {
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  EchoServer con(kServerAddress, 10, 10000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(500);
+
+  mozc::IPCClient stalled(kServerAddress, "");
+  ASSERT_TRUE(stalled.Connected());
+
+  for (int i = 0; i < 10; ++i) {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    const string input = "test" + GenRandomString(100);
+    char buf[8192];
+    size_t length = sizeof(buf);
+    ASSERT_TRUE(client.Call(input.data(), input.size(), buf, &length, 1000));
+    EXPECT_EQ(input, string(buf, length));
+  }
+
+  mozc::IPCClient kill(kServerAddress, "");
+  const char kill_cmd[32] = "kill";
+  char output[32];
+  size_t output_size = sizeof(output);
+  kill.Call(kill_cmd, strlen(kill_cmd), output, &output_size, 1000);
+  con.Wait();
+}
+
+TEST(IPCTest, ReuseConnection) {
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  EchoServer con(kServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(500);
+
+  mozc::IPCClient client(kServerAddress, "");
+  ASSERT_TRUE(client.Connected());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(client.IsReusable());
+    // Includes an empty request.
+    const string input = i == 0 ? "" : "test" + GenRandomString(i * 100);
+    char buf[16384];
+    size_t length = sizeof(buf);
+    ASSERT_TRUE(client.Call(input.data(), input.size(), buf, &length, 1000));
+    EXPECT_EQ(input, string(buf, length));
+  }
+
+  // Too small buffer for the response.
+  const string input = "test" + GenRandomString(100);
+  char buf[32];
+  size_t length = sizeof(buf);
+  EXPECT_FALSE(client.Call(input.data(), input.size(), buf, &length, 1000));
+  EXPECT_FALSE(client.IsReusable());
+
+  // The server closes the connection on termination.
+  mozc::IPCClient kill(kServerAddress, "");
+  mozc::IPCClient reused(kServerAddress, "");
+  ASSERT_TRUE(reused.Connected());
+  length = sizeof(buf);
+  ASSERT_TRUE(reused.Call("test", 4, buf, &length, 1000));
+  const char kill_cmd[32] = "kill";
+  char output[32];
+  size_t output_size = sizeof(output);
+  kill.Call(kill_cmd, strlen(kill_cmd), output, &output_size, 1000);
+  con.Wait();
+
+  EXPECT_TRUE(reused.IsReusable());
+  length = sizeof(buf);
+  EXPECT_FALSE(reused.Call("test", 4, buf, &length, 1000));
+  EXPECT_EQ(mozc::IPC_NO_CONNECTION, reused.GetLastIPCError());
+  EXPECT_FALSE(reused.IsReusable());
+}
+
+// Returns the number of the shared memory files opened by this process.
+int GetNumSharedMemoryFiles() {
+  DIR *dir = ::opendir("/proc/self/fd");
+  if (dir == NULL) {
+    return 0;
+  }
+  int num_files = 0;
+  while (const dirent *entry = ::readdir(dir)) {
+    const string path = string("/proc/self/fd/") + entry->d_name;
+    char target[256];
+    const ssize_t size = ::readlink(path.c_str(), target, sizeof(target));
+    if (size > 0 && string(target, size).find("mozc_ipc") != string::npos) {
+      ++num_files;
+    }
+  }
+  ::closedir(dir);
+  return num_files;
+}
+
+TEST(IPCTest, SharedMemory) {
+  mozc::SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  EchoServer con(kServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(500);
+
+  FLAGS_use_shared_memory_ipc = true;
+  mozc::IPCClient client(kServerAddress, "");
+  ASSERT_TRUE(client.Connected());
+  std::unique_ptr<char[]> buf(new char[mozc::IPC_RESPONSESIZE]);
+  for (int i = 0; i < 100; ++i) {
+    // Includes an empty request and the ones wrapping around the buffer.
+    const string input = i == 0 ? "" : "test" + GenRandomString(i * 1000);
+    size_t length = mozc::IPC_RESPONSESIZE;
+    ASSERT_TRUE(client.Call(input.data(), input.size(), buf.get(), &length,
+                            1000));
+    EXPECT_EQ(input, string(buf.get(), length));
+  }
+  // One for the server and one for the client, if memfd is available.
+  const int num_files = GetNumSharedMemoryFiles();
+  EXPECT_TRUE(num_files == 0 || num_files == 2) << num_files;
+
+  // A client on the socket works together.
+  FLAGS_use_shared_memory_ipc = false;
+  mozc::IPCClient socket_client(kServerAddress, "");
+  size_t length = mozc::IPC_RESPONSESIZE;
+  ASSERT_TRUE(socket_client.Call("test", 4, buf.get(), &length, 1000));
+  EXPECT_EQ("test", string(buf.get(), length));
+  EXPECT_EQ(num_files, GetNumSharedMemoryFiles());
+
+  // Too small buffer for the response.
+  {
+    FLAGS_use_shared_memory_ipc = true;
+    mozc::IPCClient small(kServerAddress, "");
+    char small_buf[32];
+    const string input = "test" + GenRandomString(100);
+    length = sizeof(small_buf);
+    EXPECT_FALSE(small.Call(input.data(), input.size(), small_buf, &length,
+                            1000));
+    EXPECT_FALSE(small.IsReusable());
+  }
+
+  // The client notices the termination of the server.
+  const char kill_cmd[32] = "kill";
+  length = mozc::IPC_RESPONSESIZE;
+  socket_client.Call(kill_cmd, strlen(kill_cmd), buf.get(), &length, 1000);
+  con.Wait();
+  length = mozc::IPC_RESPONSESIZE;
+  EXPECT_FALSE(client.Call("test", 4, buf.get(), &length, 1000));
+  EXPECT_EQ(mozc::IPC_NO_CONNECTION, client.GetLastIPCError());
+  EXPECT_EQ(0, GetNumSharedMemoryFiles());
+  FLAGS_use_shared_memory_ipc = false;
+}
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
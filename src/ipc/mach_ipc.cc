@@ -348,6 +348,10 @@ bool IPCClient::Connected() const {
   return manager->IsServerRunning(name_);
 }
 
+bool IPCClient::IsReusable() const {
+  return false;
+}
+
 // Server implementation
 IPCServer::IPCServer(const string &name,
                      int32 num_connections,
@@ -39,6 +39,7 @@
 #include <semaphore.h>
 #include <string.h>
 #include <sys/types.h>
+#include <time.h>
 #endif
 
 #include <algorithm>
@@ -71,6 +72,51 @@ bool IsProcessAlive(pid_t pid) {
   // still performed.
   return ::kill(pid, kSig) == 0;
 }
+
+// Waits at most |msec| until |sem| is signaled.  Returns true if it is
+// signaled or the wait fails unexpectedly.
+bool WaitSemaphore(sem_t *sem, int msec) {
+#ifdef OS_MACOSX
+  // sem_timedwait() is not available on Mac, so polls the semaphore in
+  // short intervals.
+  const int kPollMsec = 10;
+  while (true) {
+    if (0 == ::sem_trywait(sem)) {
+      return true;
+    }
+    if (errno != EAGAIN) {
+      LOG(ERROR) << "sem_trywait failed: " << ::strerror(errno);
+      return true;
+    }
+    if (msec <= 0) {
+      return false;
+    }
+    const int sleep_msec = std::min(msec, kPollMsec);
+    Util::Sleep(sleep_msec);
+    msec -= sleep_msec;
+  }
+#else
+  struct timespec deadline;
+  ::clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += msec / 1000;
+  deadline.tv_nsec += (msec % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    ++deadline.tv_sec;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  while (-1 == ::sem_timedwait(sem, &deadline)) {
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != ETIMEDOUT) {
+      LOG(ERROR) << "sem_timedwait failed: " << ::strerror(errno);
+      return true;
+    }
+    return false;
+  }
+  return true;
+#endif  // OS_MACOSX
+}
 #endif  // !OS_WIN
 }  // namespace
 
@@ -304,21 +350,13 @@ int NamedEventListener::WaitEventOrProcess(int msec, size_t pid) {
   }
 
   const bool inifinite = msec < 0 ? true : false;
+  // The process is checked in this interval while waiting for the event.
   const int kWaitMsec = 200;
 
   while (inifinite || msec > 0) {
-    Util::Sleep(kWaitMsec);
-
-    if (!IsProcessAlive(pid)) {
-      return NamedEventListener::PROCESS_SIGNALED;
-    }
-
-    if (-1 == ::sem_trywait(sem_)) {
-      if (errno != EAGAIN) {
-        LOG(ERROR) << "sem_trywait failed: " << ::strerror(errno);
-        return EVENT_SIGNALED;
-      }
-    } else {
+    const int wait_msec = inifinite ? kWaitMsec : std::min(msec, kWaitMsec);
+    // Returns as soon as the event is signaled.
+    if (WaitSemaphore(sem_, wait_msec)) {
       // raise other events recursively.
       if (-1 == ::sem_post(sem_)) {
         LOG(ERROR) << "sem_post failed: " << ::strerror(errno);
@@ -326,7 +364,11 @@ int NamedEventListener::WaitEventOrProcess(int msec, size_t pid) {
       return EVENT_SIGNALED;
     }
 
-    msec -= kWaitMsec;
+    if (!IsProcessAlive(pid)) {
+      return NamedEventListener::PROCESS_SIGNALED;
+    }
+
+    msec -= wait_msec;
   }
 
   // timeout.
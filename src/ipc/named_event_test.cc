@@ -119,6 +119,25 @@ TEST_F(NamedEventTest, NamedEventBasicTest) {
   }
 }
 
+TEST_F(NamedEventTest, WaitReturnsSoonAfterNotify) {
+  // The listener waits in one long call, which should return as soon as the
+  // event is signaled rather than at the next polling interval.
+  NamedEventListenerThread listner(kName, 0, 10000, 1);
+  listner.Start("WaitReturnsSoonAfterNotify");
+  Util::Sleep(100);
+  NamedEventNotifier notifier(kName);
+  ASSERT_TRUE(notifier.IsAvailable());
+  const uint64 notify_ticks = Clock::GetTicks();
+  notifier.Notify();
+  listner.Join();
+
+  ASSERT_TRUE(listner.IsTriggered());
+  const uint64 latency_msec =
+      (listner.first_triggered_ticks() - notify_ticks) * 1000 /
+      Clock::GetFrequency();
+  EXPECT_GT(100, latency_msec);
+}
+
 TEST_F(NamedEventTest, IsAvailableTest) {
   {
     NamedEventListener l(kName);
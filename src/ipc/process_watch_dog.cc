@@ -32,15 +32,26 @@
 #ifdef OS_WIN
 #include <windows.h>
 #else
-#include <signal.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#ifdef OS_MACOSX
+#include <sys/event.h>
+#endif  // OS_MACOSX
+#ifdef OS_LINUX
+#include <sys/syscall.h>
+#endif  // OS_LINUX
 #endif
 
+#include <algorithm>
+
+#include "base/clock.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/port.h"
 #include "base/scoped_handle.h"
-#include "base/util.h"
 
 namespace mozc {
 
@@ -51,7 +62,9 @@ ProcessWatchDog::ProcessWatchDog()
       thread_id_(UnknownThreadID),
       timeout_(-1),
       is_finished_(false),
-      mutex_(new Mutex) {
+      mutex_(new Mutex),
+      start_time_(Clock::GetTime()),
+      wakeup_count_(0) {
   if (event_.get() == NULL) {
     LOG(ERROR) << "::CreateEvent() failed.";
     return;
@@ -180,6 +193,10 @@ void ProcessWatchDog::Run() {
 
     const DWORD result = ::WaitForMultipleObjects(
         size, handles, FALSE, timeout);
+    {
+      scoped_lock l(mutex_.get());
+      ++wakeup_count_;
+    }
     SignalType result_type = ProcessWatchDog::UNKNOWN_SIGNALED;
     switch (result) {
       case WAIT_OBJECT_0:
@@ -215,22 +232,148 @@ void ProcessWatchDog::Run() {
 
 #else  // OS_WIN
 
+namespace {
+
+// The interval to check the process where its exit can't be waited for.
+const int kPollingIntervalMsec = 250;
+
+enum WaitResult {
+  WAIT_WAKEUP,   // |wakeup_fd| got readable.
+  WAIT_EXITED,   // The process exited.
+  WAIT_TIMEOUT,  // The polling interval passed.
+  WAIT_ERROR,
+};
+
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+int OpenProcessFd(pid_t pid) {
+#ifdef __NR_pidfd_open
+  return static_cast<int>(::syscall(__NR_pidfd_open, pid, 0));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif  // __NR_pidfd_open
+}
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
+
+// Waits for |wakeup_fd| and, if |process_fd| is valid, the process.
+WaitResult PollFds(int wakeup_fd, int process_fd, int timeout_msec) {
+  struct pollfd fds[2] = {};
+  fds[0].fd = wakeup_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = process_fd;
+  fds[1].events = POLLIN;
+  const nfds_t size = process_fd >= 0 ? 2 : 1;
+  int result = 0;
+  do {
+    result = ::poll(fds, size, timeout_msec);
+  } while (result < 0 && errno == EINTR);
+  if (result < 0) {
+    LOG(ERROR) << "poll() failed: " << errno;
+    return WAIT_ERROR;
+  }
+  if (result == 0) {
+    return WAIT_TIMEOUT;
+  }
+  if (size > 1 && fds[1].revents != 0) {
+    return WAIT_EXITED;
+  }
+  return WAIT_WAKEUP;
+}
+
+// Waits until the process of |process_id| exits or |wakeup_fd| gets
+// readable.  Where the exit can't be waited for, returns WAIT_TIMEOUT after
+// the polling interval so that the caller checks the process.
+WaitResult WaitForProcess(int wakeup_fd, ProcessWatchDog::ProcessID process_id) {
+  if (process_id == ProcessWatchDog::UnknownProcessID) {
+    return PollFds(wakeup_fd, -1, -1);
+  }
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+  // A pidfd gets readable when the process exits.
+  const int process_fd = OpenProcessFd(process_id);
+  if (process_fd < 0) {
+    if (errno == ESRCH) {
+      return WAIT_EXITED;
+    }
+    return PollFds(wakeup_fd, -1, kPollingIntervalMsec);
+  }
+  const WaitResult result = PollFds(wakeup_fd, process_fd, -1);
+  ::close(process_fd);
+  return result;
+#elif defined(OS_MACOSX)
+  const int queue = ::kqueue();
+  if (queue < 0) {
+    return PollFds(wakeup_fd, -1, kPollingIntervalMsec);
+  }
+  struct kevent changes[2];
+  EV_SET(&changes[0], wakeup_fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+  EV_SET(&changes[1], process_id, EVFILT_PROC, EV_ADD | EV_ONESHOT,
+         NOTE_EXIT, 0, NULL);
+  if (::kevent(queue, changes, arraysize(changes), NULL, 0, NULL) < 0) {
+    const int error = errno;
+    ::close(queue);
+    if (error == ESRCH) {
+      return WAIT_EXITED;
+    }
+    return PollFds(wakeup_fd, -1, kPollingIntervalMsec);
+  }
+  struct kevent event;
+  int result = 0;
+  do {
+    result = ::kevent(queue, NULL, 0, &event, 1, NULL);
+  } while (result < 0 && errno == EINTR);
+  ::close(queue);
+  if (result <= 0) {
+    LOG(ERROR) << "kevent() failed: " << errno;
+    return WAIT_ERROR;
+  }
+  return event.filter == EVFILT_PROC ? WAIT_EXITED : WAIT_WAKEUP;
+#else
+  return PollFds(wakeup_fd, -1, kPollingIntervalMsec);
+#endif  // OS_LINUX && !OS_ANDROID && !OS_NACL
+}
+
+}  // namespace
+
 ProcessWatchDog::ProcessWatchDog()
     : process_id_(UnknownProcessID),
       thread_id_(UnknownProcessID),
       is_finished_(false),
-      mutex_(new Mutex) {
+      mutex_(new Mutex),
+      start_time_(Clock::GetTime()),
+      wakeup_count_(0) {
+  if (::pipe(wakeup_pipe_) != 0) {
+    LOG(ERROR) << "pipe() failed: " << errno;
+    wakeup_pipe_[0] = wakeup_pipe_[1] = -1;
+    return;
+  }
+  ::fcntl(wakeup_pipe_[0], F_SETFL, O_NONBLOCK);
+  ::fcntl(wakeup_pipe_[1], F_SETFL, O_NONBLOCK);
   Thread::Start("WatchDog");
 }
 
 ProcessWatchDog::~ProcessWatchDog() {
   is_finished_ = true;
-  Join();
+  if (wakeup_pipe_[1] >= 0) {
+    WakeUp();
+    Join();
+    ::close(wakeup_pipe_[0]);
+    ::close(wakeup_pipe_[1]);
+  }
+}
+
+void ProcessWatchDog::WakeUp() {
+  const char c = 0;
+  while (::write(wakeup_pipe_[1], &c, 1) < 0 && errno == EINTR) {}
 }
 
 bool ProcessWatchDog::SetID(ProcessWatchDog::ProcessID process_id,
                             ProcessWatchDog::ThreadID thread_id,
                             int timeout) {
+  if (wakeup_pipe_[1] < 0) {
+    LOG(ERROR) << "wakeup pipe is not available";
+    return false;
+  }
+
   if (process_id_ == process_id && thread_id_ == thread_id &&
       timeout_ == timeout) {
     // don't repeat if we are checking the same thread/process
@@ -257,38 +400,70 @@ bool ProcessWatchDog::SetID(ProcessWatchDog::ProcessID process_id,
     timeout_ = -1;
   }
 
+  // wake up the thread to wait for the new process
+  WakeUp();
+
   return true;
 }
 
 void ProcessWatchDog::Run() {
-  // Polling-based watch-dog.
-  // Unlike WaitForMultipleObjects on Windows, no event-driven API seems to be
-  // available on Linux.
-  // NOTE In theory, there may possibility that some other process
-  // reuse same process id in 250ms or write to is_finished_ stays
-  // forever in another CPU's local cache.
-  // TODO(team): use kqueue with EVFILT_PROC/NOTE_EXIT for Mac.
+  // The thread sleeps until the process exits or SetID() wakes it up.  Only
+  // where the exit can't be waited for, the process is polled by the NULL
+  // signal.
   while (!is_finished_) {
-    Util::Sleep(250);
-    if (process_id_ == UnknownProcessID) {
-      continue;
+    ProcessID process_id = UnknownProcessID;
+    {
+      scoped_lock l(mutex_.get());
+      process_id = process_id_;
     }
-    if (::kill(process_id_, 0) != 0) {
-      if (errno == EPERM) {
-        Signaled(ProcessWatchDog::PROCESS_ACCESS_DENIED_SIGNALED);
-      } else if (errno == ESRCH) {
-        // Since we are polling the process by NULL signal,
-        // it is essentially impossible to tell the process is not found
-        // or terminated.
+    const WaitResult result = WaitForProcess(wakeup_pipe_[0], process_id);
+    {
+      scoped_lock l(mutex_.get());
+      ++wakeup_count_;
+    }
+    switch (result) {
+      case WAIT_WAKEUP: {
+        char buf[16];
+        while (::read(wakeup_pipe_[0], buf, sizeof(buf)) > 0) {}
+        continue;
+      }
+      case WAIT_EXITED:
         Signaled(ProcessWatchDog::PROCESS_SIGNALED);
-      } else {
+        break;
+      case WAIT_TIMEOUT:
+        if (::kill(process_id, 0) == 0) {
+          continue;
+        }
+        if (errno == EPERM) {
+          Signaled(ProcessWatchDog::PROCESS_ACCESS_DENIED_SIGNALED);
+        } else if (errno == ESRCH) {
+          // Since we are polling the process by NULL signal,
+          // it is essentially impossible to tell the process is not found
+          // or terminated.
+          Signaled(ProcessWatchDog::PROCESS_SIGNALED);
+        } else {
+          Signaled(ProcessWatchDog::PROCESS_ERROR_SIGNALED);
+        }
+        break;
+      case WAIT_ERROR:
+        if (process_id == UnknownProcessID) {
+          continue;
+        }
         Signaled(ProcessWatchDog::PROCESS_ERROR_SIGNALED);
-      }
-      scoped_lock l(mutex_.get());
+        break;
+    }
+    scoped_lock l(mutex_.get());
+    if (process_id_ == process_id) {
       process_id_ = UnknownProcessID;
     }
   }
 }
 #endif  // OS_WIN
 
+uint64 ProcessWatchDog::GetWakeupsPerHour() const {
+  scoped_lock l(mutex_.get());
+  const uint64 elapsed_sec = Clock::GetTime() - start_time_;
+  return wakeup_count_ * 3600 / std::max<uint64>(1, elapsed_sec);
+}
+
 }  // namespace mozc
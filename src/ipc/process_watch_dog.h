@@ -101,18 +101,31 @@ class ProcessWatchDog : public Thread {
   // internally used by thread
   void Run();
 
+  // Returns how many times the thread woke up per hour since this instance
+  // was created.  The thread wakes up only when the process or the thread
+  // is signaled or the ids are set, except on the platforms where the exit
+  // of a process can't be waited for.
+  uint64 GetWakeupsPerHour() const;
+
   ProcessWatchDog();
   virtual ~ProcessWatchDog();
 
  private:
 #ifdef OS_WIN
   ScopedHandle event_;
+#else
+  // Wakes up the thread by |wakeup_pipe_|.
+  void WakeUp();
+
+  int wakeup_pipe_[2];
 #endif
   ProcessID process_id_;
   ThreadID thread_id_;
   int timeout_;
   volatile bool is_finished_;
   std::unique_ptr<Mutex> mutex_;
+  const uint64 start_time_;
+  uint64 wakeup_count_;
 };
 
 }  // namespace mozc
@@ -70,4 +70,27 @@ TEST(ProcessWatchDog, ProcessWatchDogTest) {
   }
 #endif
 }
+
+TEST(ProcessWatchDog, WaitsWithoutPolling) {
+#if defined(OS_LINUX) && !defined(OS_ANDROID) && !defined(OS_NACL)
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Child;
+    Util::Sleep(3000);
+    exit(0);
+  } else if (pid > 0) {
+    ProcessWatchDog dog;
+    dog.SetID(static_cast<ProcessWatchDog::ProcessID>(pid),
+              ProcessWatchDog::UnknownThreadID,
+              -1);
+    Util::Sleep(2000);
+    // The thread wakes up only for SetID() while the process is alive.
+    // Polling every 250 msec would wake it up 8 times.
+    EXPECT_GT(4 * 3600 / 2, dog.GetWakeupsPerHour());
+    ::kill(pid, SIGKILL);
+  } else {
+    LOG(ERROR) << "cannot execute fork";
+  }
+#endif
+}
 }  // namespace mozc
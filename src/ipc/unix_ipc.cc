@@ -36,33 +36,59 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
 
+#include "base/clock.h"
 #include "base/file_util.h"
+#include "base/flags.h"
 #include "base/logging.h"
 #include "base/thread.h"
+#include "base/trace.h"
 #include "ipc/ipc_path_manager.h"
 
 #ifndef UNIX_PATH_MAX
 #define UNIX_PATH_MAX 108
 #endif  // UNIX_PATH_MAX
 
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif  // MFD_CLOEXEC
+
+DEFINE_bool(use_shared_memory_ipc, false,
+            "Pass the requests and the responses through shared memory "
+            "instead of the socket if the server supports it.");
+
 namespace mozc {
 
 namespace {
 
 const int kInvalidSocket = -1;
 
+// The maximum number of the client connections kept by IPCServer::Loop().
+const size_t kMaxConnections = 64;
+
+// The time in msec without requests before IPCServer::DoIdleWork() is called.
+const uint64 kIdleWorkDelayMsec = 50;
+
 void mkdir_p(const string &dirname) {
   const string parent_dir = FileUtil::Dirname(dirname);
   struct stat st;
@@ -164,7 +190,10 @@ bool SendMessage(int socket,
       // An error occurs.
       LOG(ERROR) << "an error occurred during sending \""
                  << string(buf, buf_length_left) << "\": " << strerror(errno);
-      *last_ipc_error = IPC_WRITE_ERROR;
+      // The peer has closed the connection.  Since the server processes only
+      // the complete requests, the request has not been processed.
+      *last_ipc_error = (errno == EPIPE || errno == ECONNRESET) ?
+          IPC_NO_CONNECTION : IPC_WRITE_ERROR;
       return false;
     }
     buf += l;
@@ -174,40 +203,107 @@ bool SendMessage(int socket,
   return true;
 }
 
+// Receives exactly |buf_length| bytes.
 bool RecvMessage(int socket,
                  char *buf,
-                 size_t *buf_length,
+                 size_t buf_length,
                  int timeout,
                  IPCErrorType *last_ipc_error) {
-  if (*buf_length == 0) {
-    LOG(WARNING) << "buf_length is 0";
-    *last_ipc_error = IPC_UNKNOWN_ERROR;
-    return false;
-  }
-  ssize_t buf_left = *buf_length;
-  ssize_t read_length = 0;
-  *buf_length = 0;
-  do {
+  size_t buf_length_left = buf_length;
+  while (buf_length_left > 0) {
     if (IsReadTimeout(socket, timeout)) {
       LOG(WARNING) << "Read timeout " << timeout;
       *last_ipc_error = IPC_TIMEOUT_ERROR;
       return false;
     }
-    read_length = ::recv(socket, buf, buf_left, 0);
+    const ssize_t read_length = ::recv(socket, buf, buf_length_left, 0);
     if (read_length < 0) {
       LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
-      *buf_length = 0;
       *last_ipc_error = IPC_READ_ERROR;
       return false;
     }
-    *buf_length += read_length;
+    if (read_length == 0) {
+      LOG(ERROR) << "connection closed by peer";
+      *last_ipc_error = IPC_READ_ERROR;
+      return false;
+    }
     buf += read_length;
-    buf_left -= read_length;
-  } while (read_length != 0 && buf_left > 0);
-  VLOG(1) << *buf_length << " bytes received";
+    buf_length_left -= read_length;
+  }
+  VLOG(1) << buf_length << " bytes received";
+  return true;
+}
+
+// A message is framed by its length in a uint32 of host byte order, so that
+// a connection can carry many requests and responses.
+const size_t kHeaderSize = sizeof(uint32);
+
+void EncodeHeader(size_t message_size, char *header) {
+  const uint32 size = static_cast<uint32>(message_size);
+  ::memcpy(header, &size, kHeaderSize);
+}
+
+uint32 DecodeHeader(const char *header) {
+  uint32 size = 0;
+  ::memcpy(&size, header, kHeaderSize);
+  return size;
+}
+
+bool SendFramedMessage(int socket,
+                       const char *buf,
+                       size_t buf_length,
+                       int timeout,
+                       IPCErrorType *last_ipc_error) {
+  char header[kHeaderSize];
+  EncodeHeader(buf_length, header);
+  return SendMessage(socket, header, kHeaderSize, timeout, last_ipc_error) &&
+      SendMessage(socket, buf, buf_length, timeout, last_ipc_error);
+}
+
+bool RecvFramedMessage(int socket,
+                       char *buf,
+                       size_t *buf_length,
+                       int timeout,
+                       IPCErrorType *last_ipc_error) {
+  char header[kHeaderSize];
+  if (!RecvMessage(socket, header, kHeaderSize, timeout, last_ipc_error)) {
+    return false;
+  }
+  const uint32 message_size = DecodeHeader(header);
+  if (message_size > *buf_length) {
+    LOG(ERROR) << "message is too large: " << message_size;
+    *last_ipc_error = IPC_READ_ERROR;
+    return false;
+  }
+  if (!RecvMessage(socket, buf, message_size, timeout, last_ipc_error)) {
+    return false;
+  }
+  *buf_length = message_size;
   return true;
 }
 
+// Returns true if the peer has closed the connection, or has sent data
+// which nobody asked for.  Either way the connection is no longer usable.
+bool IsPeerClosed(int socket) {
+  fd_set fds;
+  struct timeval tv;
+  FD_ZERO(&fds);
+  FD_SET(socket, &fds);
+  tv.tv_sec = 0;
+  tv.tv_usec = 0;
+  return select(socket + 1, &fds, NULL, NULL, &tv) != 0;
+}
+
+void CloseSocket(int *socket) {
+  if (*socket == kInvalidSocket) {
+    return;
+  }
+  if (::close(*socket) < 0) {
+    LOG(WARNING) << "close failed: " << strerror(errno);
+  }
+  *socket = kInvalidSocket;
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -227,18 +323,558 @@ void SetCloseOnExecFlag(int fd) {
 bool IsAbstractSocket(const string& address) {
   return (!address.empty()) && (address[0] == '\0');
 }
+
+uint64 GetCurrentMsec() {
+  return Clock::GetTicks() / (Clock::GetFrequency() / 1000);
+}
+
+}  // namespace
+
+// Shared memory transport.
+//
+// A channel is a pair of single producer single consumer ring buffers on a
+// memfd, one for the requests and one for the responses, and an eventfd for
+// each direction to wake up the other side.  The server makes a channel on
+// the request of a client and passes the file descriptors over the
+// connection, which is kept to detect the termination of the peer.  Since a
+// client has at most one call in flight, a ring buffer always has room for a
+// message.
+namespace {
+
+// The header value which asks the server for a channel instead of a request.
+const uint32 kSharedMemoryRequest = 0xFFFFFFFF;
+
+// Must be a power of two, so that the positions can wrap around in uint32.
+const size_t kRingBufferSize = 256 * 1024;
+static_assert(kRingBufferSize >= kHeaderSize + IPC_REQUESTSIZE &&
+              kRingBufferSize >= kHeaderSize + IPC_RESPONSESIZE,
+              "kRingBufferSize must hold a message");
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "std::atomic<uint32> must be lock free to be shared");
+
+struct RingBuffer {
+  // The read position, which is updated by the consumer.
+  std::atomic<uint32> head;
+  // The write position, which is updated by the producer.
+  std::atomic<uint32> tail;
+  char data[kRingBufferSize];
+};
+
+// Everything is zero at first, as a memfd is zero filled.
+struct SharedMemoryLayout {
+  RingBuffer request;
+  RingBuffer response;
+};
+
+enum RingResult {
+  RING_OK,
+  RING_EMPTY,
+  RING_BROKEN,
+};
+
+void CopyToRing(RingBuffer *ring, uint32 pos, const char *buf, size_t size) {
+  const size_t offset = pos % kRingBufferSize;
+  const size_t first = min(size, kRingBufferSize - offset);
+  ::memcpy(ring->data + offset, buf, first);
+  ::memcpy(ring->data, buf + first, size - first);
+}
+
+void CopyFromRing(const RingBuffer &ring, uint32 pos, char *buf, size_t size) {
+  const size_t offset = pos % kRingBufferSize;
+  const size_t first = min(size, kRingBufferSize - offset);
+  ::memcpy(buf, ring.data + offset, first);
+  ::memcpy(buf + first, ring.data, size - first);
+}
+
+// Writes a message to |ring|.  Returns false if there is no room.
+bool WriteRing(RingBuffer *ring, const char *buf, size_t size) {
+  MOZC_TRACE_SPAN("IPC::WriteRing");
+  const uint32 head = ring->head.load(std::memory_order_acquire);
+  const uint32 tail = ring->tail.load(std::memory_order_relaxed);
+  const uint32 used = tail - head;
+  if (used > kRingBufferSize ||
+      kRingBufferSize - used < kHeaderSize + size) {
+    LOG(ERROR) << "No room in the ring buffer: " << used;
+    return false;
+  }
+  char header[kHeaderSize];
+  EncodeHeader(size, header);
+  CopyToRing(ring, tail, header, kHeaderSize);
+  CopyToRing(ring, tail + kHeaderSize, buf, size);
+  ring->tail.store(tail + kHeaderSize + size, std::memory_order_release);
+  return true;
+}
+
+// Reads a message from |ring| into |buf| of |*size| bytes.  The positions
+// and the header are validated as the peer can write anything there.
+RingResult ReadRing(RingBuffer *ring, char *buf, size_t *size) {
+  MOZC_TRACE_SPAN("IPC::ReadRing");
+  const uint32 tail = ring->tail.load(std::memory_order_acquire);
+  const uint32 head = ring->head.load(std::memory_order_relaxed);
+  const uint32 available = tail - head;
+  if (available == 0) {
+    return RING_EMPTY;
+  }
+  if (available < kHeaderSize || available > kRingBufferSize) {
+    LOG(ERROR) << "Broken ring buffer: " << available;
+    return RING_BROKEN;
+  }
+  char header[kHeaderSize];
+  CopyFromRing(*ring, head, header, kHeaderSize);
+  const uint32 message_size = DecodeHeader(header);
+  if (message_size > available - kHeaderSize || message_size > *size) {
+    LOG(ERROR) << "Broken message in the ring buffer: " << message_size;
+    return RING_BROKEN;
+  }
+  CopyFromRing(*ring, head + kHeaderSize, buf, message_size);
+  ring->head.store(head + kHeaderSize + message_size,
+                   std::memory_order_release);
+  *size = message_size;
+  return RING_OK;
+}
+
+bool SignalEvent(int event) {
+  const uint64 value = 1;
+  while (::write(event, &value, sizeof(value)) != sizeof(value)) {
+    if (errno != EINTR) {
+      LOG(ERROR) << "write() to eventfd failed: " << strerror(errno);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Drops the pending signals of the non-blocking |event|.
+void ClearEvent(int event) {
+  uint64 value = 0;
+  while (::read(event, &value, sizeof(value)) < 0 && errno == EINTR) {}
+}
+
+int MakeMemoryFile(const char *name) {
+#ifdef __NR_memfd_create
+  return static_cast<int>(::syscall(__NR_memfd_create, name, MFD_CLOEXEC));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif  // __NR_memfd_create
+}
+
+}  // namespace
+
+class SharedMemoryChannel {
+ public:
+  // Makes a new channel, or returns NULL if the system doesn't support it.
+  static SharedMemoryChannel *Create() {
+    std::unique_ptr<SharedMemoryChannel> channel(new SharedMemoryChannel);
+    channel->memory_fd_ = MakeMemoryFile("mozc_ipc");
+    if (channel->memory_fd_ < 0) {
+      LOG(WARNING) << "memfd_create() failed: " << strerror(errno);
+      return NULL;
+    }
+    if (::ftruncate(channel->memory_fd_, sizeof(SharedMemoryLayout)) != 0) {
+      LOG(ERROR) << "ftruncate() failed: " << strerror(errno);
+      return NULL;
+    }
+    channel->request_event_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    channel->response_event_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (channel->request_event_ < 0 || channel->response_event_ < 0) {
+      LOG(ERROR) << "eventfd() failed: " << strerror(errno);
+      return NULL;
+    }
+    if (!channel->Map()) {
+      return NULL;
+    }
+    return channel.release();
+  }
+
+  // Maps the channel passed by the server.  The file descriptors are owned
+  // by the channel even on failure.
+  static SharedMemoryChannel *Attach(int memory_fd,
+                                     int request_event,
+                                     int response_event) {
+    std::unique_ptr<SharedMemoryChannel> channel(new SharedMemoryChannel);
+    channel->memory_fd_ = memory_fd;
+    channel->request_event_ = request_event;
+    channel->response_event_ = response_event;
+    struct stat st;
+    if (::fstat(memory_fd, &st) != 0 ||
+        st.st_size != static_cast<off_t>(sizeof(SharedMemoryLayout))) {
+      LOG(ERROR) << "Invalid shared memory";
+      return NULL;
+    }
+    if (!channel->Map()) {
+      return NULL;
+    }
+    return channel.release();
+  }
+
+  ~SharedMemoryChannel() {
+    if (layout_ != NULL) {
+      ::munmap(layout_, sizeof(SharedMemoryLayout));
+    }
+    CloseSocket(&memory_fd_);
+    CloseSocket(&request_event_);
+    CloseSocket(&response_event_);
+  }
+
+  SharedMemoryLayout *layout() const { return layout_; }
+  int memory_fd() const { return memory_fd_; }
+  // Signaled by the client when a request is written.
+  int request_event() const { return request_event_; }
+  // Signaled by the server when a response is written.
+  int response_event() const { return response_event_; }
+
+ private:
+  SharedMemoryChannel()
+      : layout_(NULL), memory_fd_(kInvalidSocket),
+        request_event_(kInvalidSocket), response_event_(kInvalidSocket) {}
+
+  bool Map() {
+    void *address = ::mmap(NULL, sizeof(SharedMemoryLayout),
+                           PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd_, 0);
+    if (address == MAP_FAILED) {
+      LOG(ERROR) << "mmap() failed: " << strerror(errno);
+      return false;
+    }
+    layout_ = reinterpret_cast<SharedMemoryLayout *>(address);
+    return true;
+  }
+
+  SharedMemoryLayout *layout_;
+  int memory_fd_;
+  int request_event_;
+  int response_event_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryChannel);
+};
+
+namespace {
+
+const int kNumChannelFds = 3;
+
+// Sends |status| with the file descriptors of |channel| if not NULL.
+bool SendChannel(int socket, uint32 status,
+                 const SharedMemoryChannel *channel) {
+  char buf[kHeaderSize];
+  EncodeHeader(status, buf);
+  iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = sizeof(buf);
+  msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int) * kNumChannelFds)];
+  if (channel != NULL) {
+    ::memset(control, 0, sizeof(control));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * kNumChannelFds);
+    const int fds[kNumChannelFds] = {
+      channel->memory_fd(), channel->request_event(),
+      channel->response_event(),
+    };
+    ::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  }
+  // The socket is idle as the client is waiting for the reply, so the small
+  // reply is sent at once.
+  ssize_t l = 0;
+  do {
+    l = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+  } while (l < 0 && errno == EINTR);
+  if (l != static_cast<ssize_t>(sizeof(buf))) {
+    LOG(ERROR) << "sendmsg() failed: " << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+// Asks the server for a channel.  Returns true and sets |channel| to NULL if
+// the server declines it.
+bool NegotiateChannel(int socket, int timeout,
+                      std::unique_ptr<SharedMemoryChannel> *channel,
+                      IPCErrorType *last_ipc_error) {
+  channel->reset();
+  char buf[kHeaderSize];
+  EncodeHeader(kSharedMemoryRequest, buf);
+  if (!SendMessage(socket, buf, kHeaderSize, timeout, last_ipc_error)) {
+    return false;
+  }
+  if (IsReadTimeout(socket, timeout)) {
+    LOG(WARNING) << "Read timeout " << timeout;
+    *last_ipc_error = IPC_TIMEOUT_ERROR;
+    return false;
+  }
+  iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = sizeof(buf);
+  msghdr msg;
+  ::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int) * kNumChannelFds)];
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t l = 0;
+  do {
+    l = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+  } while (l < 0 && errno == EINTR);
+  if (l <= 0) {
+    LOG(ERROR) << "recvmsg() failed: " << strerror(errno);
+    *last_ipc_error = IPC_READ_ERROR;
+    return false;
+  }
+  int fds[kNumChannelFds];
+  int num_fds = 0;
+  const cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS) {
+    num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    num_fds = min(num_fds, kNumChannelFds);
+    ::memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * num_fds);
+  }
+  // The rest of the status, which is not likely to be split.
+  if (l < static_cast<ssize_t>(sizeof(buf)) &&
+      !RecvMessage(socket, buf + l, sizeof(buf) - l, timeout,
+                   last_ipc_error)) {
+    for (int i = 0; i < num_fds; ++i) {
+      ::close(fds[i]);
+    }
+    return false;
+  }
+  if (DecodeHeader(buf) == 0) {
+    VLOG(1) << "Shared memory is declined";
+    for (int i = 0; i < num_fds; ++i) {
+      ::close(fds[i]);
+    }
+    return true;
+  }
+  if (num_fds != kNumChannelFds) {
+    LOG(ERROR) << "File descriptors are not passed";
+    for (int i = 0; i < num_fds; ++i) {
+      ::close(fds[i]);
+    }
+    *last_ipc_error = IPC_READ_ERROR;
+    return false;
+  }
+  channel->reset(SharedMemoryChannel::Attach(fds[0], fds[1], fds[2]));
+  if (channel->get() == NULL) {
+    *last_ipc_error = IPC_UNKNOWN_ERROR;
+    return false;
+  }
+  VLOG(1) << "Shared memory is enabled";
+  return true;
+}
+
+// Calls the server through |channel|.  |socket| is watched to detect the
+// termination of the server.
+bool CallChannel(int socket, SharedMemoryChannel *channel,
+                 const char *request, size_t request_size,
+                 char *response, size_t *response_size,
+                 int timeout, IPCErrorType *last_ipc_error) {
+  // Drop the signal left by the previous call, if any.
+  ClearEvent(channel->response_event());
+  if (!WriteRing(&channel->layout()->request, request, request_size) ||
+      !SignalEvent(channel->request_event())) {
+    *last_ipc_error = IPC_WRITE_ERROR;
+    return false;
+  }
+  const uint64 deadline = timeout < 0 ? 0 : GetCurrentMsec() + timeout;
+  while (true) {
+    size_t size = *response_size;
+    switch (ReadRing(&channel->layout()->response, response, &size)) {
+      case RING_OK:
+        *response_size = size;
+        return true;
+      case RING_BROKEN:
+        *last_ipc_error = IPC_READ_ERROR;
+        return false;
+      case RING_EMPTY:
+        break;
+    }
+    int wait_msec = -1;
+    if (timeout >= 0) {
+      const uint64 now = GetCurrentMsec();
+      if (now >= deadline) {
+        LOG(WARNING) << "Read timeout " << timeout;
+        *last_ipc_error = IPC_TIMEOUT_ERROR;
+        return false;
+      }
+      wait_msec = static_cast<int>(deadline - now);
+    }
+    pollfd fds[2];
+    ::memset(fds, 0, sizeof(fds));
+    fds[0].fd = channel->response_event();
+    fds[0].events = POLLIN;
+    fds[1].fd = socket;
+    fds[1].events = POLLIN;
+    const int result = ::poll(fds, 2, wait_msec);
+    if (result < 0 && errno != EINTR) {
+      LOG(ERROR) << "poll() failed: " << strerror(errno);
+      *last_ipc_error = IPC_READ_ERROR;
+      return false;
+    }
+    if (result > 0 && fds[1].revents != 0) {
+      LOG(ERROR) << "connection closed by peer";
+      *last_ipc_error = IPC_READ_ERROR;
+      return false;
+    }
+    if (result > 0) {
+      ClearEvent(channel->response_event());
+    }
+  }
+}
+
+// A client connection of IPCServer::Loop(), which is closed on destruction.
+// A connection carries one request after another, and waits for the next
+// request without timeout once the response has been sent.
+struct Connection {
+  explicit Connection(int fd)
+      : socket(fd), request_completed(false), sent_size(0), deadline(0),
+        last_active(0), watching_output(false) {}
+  ~Connection() {
+    ::close(socket);
+  }
+
+  // Returns true if the connection is waiting for a new request.
+  bool IsIdle() const {
+    return input.empty() && !request_completed;
+  }
+
+  // Gets ready for the next request.
+  void Reset() {
+    input.clear();
+    request_completed = false;
+    response.clear();
+    sent_size = 0;
+  }
+
+  const int socket;
+  // The header and the request received so far.
+  string input;
+  // True if the whole request described by the header has been received.
+  bool request_completed;
+  // The header and the response.
+  string response;
+  size_t sent_size;
+  // The time in msec when the connection times out, or 0 for no timeout.
+  uint64 deadline;
+  // The time in msec of the last progress.
+  uint64 last_active;
+  // True if the socket is watched for EPOLLOUT instead of EPOLLIN.
+  bool watching_output;
+  // The shared memory transport negotiated by the client, if any.  Then the
+  // socket is watched only to detect the termination of the client.
+  std::unique_ptr<SharedMemoryChannel> channel;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+// Receives the available data of the request.  Returns false on error or
+// when the client has closed the connection.
+bool ReadRequest(Connection *connection) {
+  MOZC_TRACE_SPAN("IPCServer::ReadRequest");
+  char buf[8192];
+  while (!connection->request_completed) {
+    // Read no more than the current request, as the next one is read after
+    // the response has been sent.
+    size_t message_size = kHeaderSize;
+    if (connection->input.size() >= kHeaderSize) {
+      const uint32 request_size = DecodeHeader(connection->input.data());
+      if (request_size == kSharedMemoryRequest) {
+        // Has no payload.
+        connection->request_completed = true;
+        break;
+      }
+      if (request_size > IPC_REQUESTSIZE) {
+        LOG(ERROR) << "request is too large: " << request_size;
+        return false;
+      }
+      message_size += request_size;
+      if (connection->input.size() == message_size) {
+        connection->request_completed = true;
+        break;
+      }
+    }
+    const size_t buf_size =
+        min(sizeof(buf), message_size - connection->input.size());
+    const ssize_t read_length = ::recv(connection->socket, buf, buf_size, 0);
+    if (read_length < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return true;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
+      return false;
+    }
+    if (read_length == 0) {
+      if (connection->IsIdle()) {
+        VLOG(1) << "connection closed by client";
+      } else {
+        LOG(ERROR) << "connection closed in the middle of the request";
+      }
+      return false;
+    }
+    connection->input.append(buf, read_length);
+  }
+  VLOG(1) << connection->input.size() - kHeaderSize << " bytes received";
+  return true;
+}
+
+// Sends the rest of the response as long as the socket accepts.  Returns
+// false on error.
+bool WriteResponse(Connection *connection) {
+  MOZC_TRACE_SPAN("IPCServer::WriteResponse");
+  while (connection->sent_size < connection->response.size()) {
+    const ssize_t l = ::send(
+        connection->socket, connection->response.data() + connection->sent_size,
+        connection->response.size() - connection->sent_size, MSG_NOSIGNAL);
+    if (l < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return true;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "an error occurred during send(): " << strerror(errno);
+      return false;
+    }
+    connection->sent_size += l;
+  }
+  VLOG(1) << connection->sent_size - kHeaderSize << " bytes sent";
+  return true;
+}
+
+void WatchConnection(int epoll_fd, int op, Connection *connection) {
+  connection->watching_output = connection->request_completed;
+  epoll_event event;
+  ::memset(&event, 0, sizeof(event));
+  event.events = connection->watching_output ? EPOLLOUT : EPOLLIN;
+  event.data.fd = connection->socket;
+  if (::epoll_ctl(epoll_fd, op, connection->socket, &event) != 0) {
+    LOG(WARNING) << "epoll_ctl() failed: " << strerror(errno);
+  }
+}
 }  // namespace
 
 // Client
 IPCClient::IPCClient(const string &name)
-    : socket_(kInvalidSocket), connected_(false),
+    : socket_(kInvalidSocket), shared_memory_negotiated_(false),
+      connected_(false),
       ipc_path_manager_(NULL),
       last_ipc_error_(IPC_NO_ERROR) {
   Init(name, "");
 }
 
 IPCClient::IPCClient(const string &name, const string &server_path)
-    : socket_(kInvalidSocket), connected_(false),
+    : socket_(kInvalidSocket), shared_memory_negotiated_(false),
+      connected_(false),
       ipc_path_manager_(NULL),
       last_ipc_error_(IPC_NO_ERROR) {
   Init(name, server_path);
@@ -308,12 +944,8 @@ void IPCClient::Init(const string &name, const string &server_path) {
 }
 
 IPCClient::~IPCClient() {
-  if (socket_ != kInvalidSocket) {
-    if (::close(socket_) < 0) {
-      LOG(WARNING) << "close failed: " << strerror(errno);
-    }
-    socket_ = kInvalidSocket;
-  }
+  shared_memory_.reset();
+  CloseSocket(&socket_);
   connected_ = false;
   VLOG(1) << "connection closed (IPCClient destructed)";
 }
@@ -325,29 +957,74 @@ bool IPCClient::Call(const char *request_,
                      size_t *response_size,
                      int32 timeout) {
   last_ipc_error_ = IPC_NO_ERROR;
-  if (!SendMessage(socket_, request_, input_length, timeout,
-                   &last_ipc_error_)) {
-    LOG(ERROR) << "SendMessage failed";
+  if (!connected_) {
+    LOG(ERROR) << "Not connected";
+    last_ipc_error_ = IPC_NO_CONNECTION;
+    return false;
+  }
+
+  // The server may have closed the connection since the last call, e.g., on
+  // restart.
+  if (IsPeerClosed(socket_)) {
+    LOG(WARNING) << "Connection closed by server";
+    shared_memory_.reset();
+    CloseSocket(&socket_);
+    connected_ = false;
+    last_ipc_error_ = IPC_NO_CONNECTION;
     return false;
   }
 
-  // Half-close the socket so that mozc_server could know the length of the
-  // request data. Without this, RecvMessage() in mozc_server would fail with
-  // timeout.
-  // TODO(yusukes): It would be also possible to modify Send and RecvMessage()
-  // so that they send/recv the payload size explicitly together with the actual
-  // data. Will revisit later.
-  ::shutdown(socket_, SHUT_WR);
+  if (!shared_memory_negotiated_) {
+    shared_memory_negotiated_ = true;
+    if (FLAGS_use_shared_memory_ipc &&
+        ipc_path_manager_->IsSharedMemorySupported() &&
+        !NegotiateChannel(socket_, timeout, &shared_memory_,
+                          &last_ipc_error_)) {
+      LOG(ERROR) << "NegotiateChannel failed";
+      CloseSocket(&socket_);
+      connected_ = false;
+      return false;
+    }
+  }
 
-  if (!RecvMessage(socket_, response_, response_size, timeout,
-                   &last_ipc_error_)) {
+  if (shared_memory_.get() != NULL) {
+    if (!CallChannel(socket_, shared_memory_.get(), request_, input_length,
+                     response_, response_size, timeout, &last_ipc_error_)) {
+      LOG(ERROR) << "CallChannel failed";
+      shared_memory_.reset();
+      CloseSocket(&socket_);
+      connected_ = false;
+      return false;
+    }
+    VLOG(1) << "Call succeeded";
+    return true;
+  }
+
+  if (!SendFramedMessage(socket_, request_, input_length, timeout,
+                         &last_ipc_error_)) {
+    LOG(ERROR) << "SendMessage failed";
+    CloseSocket(&socket_);
+    connected_ = false;
+    return false;
+  }
+
+  if (!RecvFramedMessage(socket_, response_, response_size, timeout,
+                         &last_ipc_error_)) {
     LOG(ERROR) << "RecvMessage failed";
+    // The response may arrive later, which breaks the framing of the next
+    // call.
+    CloseSocket(&socket_);
+    connected_ = false;
     return false;
   }
   VLOG(1) << "Call succeeded";
   return true;
 }
 
+bool IPCClient::IsReusable() const {
+  return connected_;
+}
+
 bool IPCClient::Connected() const {
   return connected_;
 }
@@ -443,39 +1120,251 @@ bool IPCServer::Connected() const {
 }
 
 void IPCServer::Loop() {
-  // The most portable and straightforward single-thread server
+  // An event driven server, which receives the requests and sends the
+  // responses of many connections at once with epoll, so that a client
+  // blocking in the middle doesn't keep the others waiting.  Process() is
+  // still called in this thread one by one in the order the requests
+  // complete, since the implementations, e.g., SessionServer, are not thread
+  // safe.  A connection handles the requests one after another, so the
+  // requests of a client are processed in order.  The requests through the
+  // shared memory channels are processed in the same way, being woken up by
+  // their request events.
+  const int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    LOG(FATAL) << "epoll_create1() failed: " << strerror(errno);
+    return;
+  }
+  {
+    epoll_event event;
+    ::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = socket_;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_, &event) != 0) {
+      LOG(FATAL) << "epoll_ctl() failed: " << strerror(errno);
+      ::close(epoll_fd);
+      return;
+    }
+  }
+
+  typedef std::map<int, std::unique_ptr<Connection>> ConnectionMap;
+  ConnectionMap connections;
+  // The request event of a shared memory channel to the socket of its
+  // connection.
+  std::map<int, int> channel_sockets;
+  auto close_connection =
+      [&connections, &channel_sockets](ConnectionMap::iterator it)
+      -> ConnectionMap::iterator {
+    if (it->second->channel.get() != NULL) {
+      channel_sockets.erase(it->second->channel->request_event());
+    }
+    return connections.erase(it);
+  };
+  const int kMaxEvents = 16;
+  epoll_event events[kMaxEvents];
+  // DoIdleWork() is called when no request comes for kIdleWorkDelayMsec
+  // after the last one, and repeated while it returns true.
+  bool idle_work_pending = false;
+  uint64 last_request_msec = 0;
   bool error = false;
-  IPCErrorType last_ipc_error = IPC_NO_ERROR;
-  pid_t pid = 0;
   while (!error) {
-    const int new_sock = ::accept(socket_, NULL, NULL);
-    if (new_sock < 0) {
-      LOG(FATAL) << "accept() failed: " << strerror(errno);
-      return;
+    // Wake up for the earliest deadline.
+    int wait_msec = -1;
+    const uint64 current_msec = GetCurrentMsec();
+    for (const auto &it : connections) {
+      const uint64 deadline = it.second->deadline;
+      if (deadline == 0) {
+        continue;
+      }
+      const int msec = deadline > current_msec ?
+          static_cast<int>(deadline - current_msec) : 0;
+      wait_msec = wait_msec < 0 ? msec : min(wait_msec, msec);
     }
-    if (!IsPeerValid(new_sock, &pid)) {
-      continue;
+    if (idle_work_pending) {
+      const uint64 idle_msec = last_request_msec + kIdleWorkDelayMsec;
+      const int msec = idle_msec > current_msec ?
+          static_cast<int>(idle_msec - current_msec) : 0;
+      wait_msec = wait_msec < 0 ? msec : min(wait_msec, msec);
     }
-    size_t request_size = sizeof(request_);
-    size_t response_size = sizeof(response_);
-    if (RecvMessage(new_sock,
-                    &request_[0],
-                    &request_size, timeout_, &last_ipc_error)) {
-      if (!Process(&request_[0], request_size,
-                   &response_[0], &response_size)) {
-        LOG(WARNING) << "Process() failed";
-        error = true;
+
+    const int num_events =
+        ::epoll_wait(epoll_fd, events, kMaxEvents, wait_msec);
+    if (num_events < 0) {
+      if (errno == EINTR) {
+        continue;
       }
-      if (response_size > 0) {
-        SendMessage(new_sock,
-                    &response_[0],
-                    response_size, timeout_, &last_ipc_error);
+      LOG(FATAL) << "epoll_wait() failed: " << strerror(errno);
+      break;
+    }
+    if (num_events == 0 && idle_work_pending &&
+        GetCurrentMsec() >= last_request_msec + kIdleWorkDelayMsec) {
+      // A piece of the idle work runs only when no request is waiting, so a
+      // new request waits for one piece at most.
+      idle_work_pending = DoIdleWork();
+    }
+
+    for (int i = 0; i < num_events && !error; ++i) {
+      if (events[i].data.fd == socket_) {
+        const int new_sock =
+            ::accept4(socket_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (new_sock < 0) {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG(ERROR) << "accept() failed: " << strerror(errno);
+          }
+          continue;
+        }
+        std::unique_ptr<Connection> connection(new Connection(new_sock));
+        pid_t pid = 0;
+        if (!IsPeerValid(new_sock, &pid)) {
+          continue;
+        }
+        if (connections.size() >= kMaxConnections) {
+          // Close the least recently used idle connection.  The client
+          // reconnects on the next call.
+          auto lru = connections.end();
+          for (auto it = connections.begin(); it != connections.end(); ++it) {
+            if (it->second->IsIdle() &&
+                (lru == connections.end() ||
+                 it->second->last_active < lru->second->last_active)) {
+              lru = it;
+            }
+          }
+          if (lru == connections.end()) {
+            LOG(WARNING) << "Too many connections";
+            continue;
+          }
+          close_connection(lru);
+        }
+        connection->last_active = GetCurrentMsec();
+        WatchConnection(epoll_fd, EPOLL_CTL_ADD, connection.get());
+        connections[new_sock] = std::move(connection);
+      }
+    }
+
+    for (int i = 0; i < num_events && !error; ++i) {
+      const auto channel_it = channel_sockets.find(events[i].data.fd);
+      if (channel_it != channel_sockets.end()) {
+        // A request through the shared memory, which is processed at once.
+        const auto it = connections.find(channel_it->second);
+        DCHECK(it != connections.end());
+        Connection *connection = it->second.get();
+        SharedMemoryChannel *channel = connection->channel.get();
+        ClearEvent(channel->request_event());
+        size_t request_size = sizeof(request_);
+        const RingResult result =
+            ReadRing(&channel->layout()->request, request_, &request_size);
+        if (result == RING_EMPTY) {
+          continue;
+        }
+        bool succeeded = result == RING_OK;
+        if (succeeded) {
+          size_t response_size = sizeof(response_);
+          if (!Process(request_, request_size, response_, &response_size)) {
+            LOG(WARNING) << "Process() failed";
+            error = true;
+          }
+          idle_work_pending = true;
+          last_request_msec = GetCurrentMsec();
+          succeeded = WriteRing(&channel->layout()->response, response_,
+                                response_size) &&
+              SignalEvent(channel->response_event());
+        }
+        if (succeeded) {
+          connection->last_active = GetCurrentMsec();
+        } else {
+          close_connection(it);
+        }
+        continue;
       }
+
+      const auto it = connections.find(events[i].data.fd);
+      if (it == connections.end()) {
+        continue;
+      }
+      Connection *connection = it->second.get();
+      if (!connection->request_completed) {
+        if (!ReadRequest(connection)) {
+          close_connection(it);
+          continue;
+        }
+        if (connection->request_completed &&
+            DecodeHeader(connection->input.data()) == kSharedMemoryRequest) {
+          // Negotiates the shared memory transport in place of a request.
+          connection->Reset();
+          if (connection->channel.get() != NULL) {
+            LOG(ERROR) << "Shared memory is already enabled";
+            close_connection(it);
+            continue;
+          }
+          connection->channel.reset(SharedMemoryChannel::Create());
+          const SharedMemoryChannel *channel = connection->channel.get();
+          if (!SendChannel(connection->socket, channel != NULL ? 1 : 0,
+                           channel)) {
+            close_connection(it);
+            continue;
+          }
+          if (channel != NULL) {
+            epoll_event event;
+            ::memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.fd = channel->request_event();
+            if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, channel->request_event(),
+                            &event) != 0) {
+              LOG(ERROR) << "epoll_ctl() failed: " << strerror(errno);
+              close_connection(it);
+              continue;
+            }
+            channel_sockets[channel->request_event()] = connection->socket;
+          }
+        } else if (connection->request_completed) {
+          size_t response_size = sizeof(response_);
+          if (!Process(connection->input.data() + kHeaderSize,
+                       connection->input.size() - kHeaderSize,
+                       &response_[0], &response_size)) {
+            LOG(WARNING) << "Process() failed";
+            error = true;
+          }
+          idle_work_pending = true;
+          last_request_msec = GetCurrentMsec();
+          char header[kHeaderSize];
+          EncodeHeader(response_size, header);
+          connection->response.assign(header, kHeaderSize);
+          connection->response.append(response_, response_size);
+          connection->sent_size = 0;
+        }
+      }
+      if (connection->request_completed) {
+        if (!WriteResponse(connection)) {
+          close_connection(it);
+          continue;
+        }
+        if (connection->sent_size == connection->response.size()) {
+          // Keep the connection for the next request of the client.
+          connection->Reset();
+        }
+      }
+      if (connection->watching_output != connection->request_completed) {
+        WatchConnection(epoll_fd, EPOLL_CTL_MOD, connection);
+      }
+      connection->last_active = GetCurrentMsec();
+      connection->deadline = (timeout_ < 0 || connection->IsIdle()) ?
+          0 : connection->last_active + timeout_;
     }
 
-    ::close(new_sock);
+    // Close the connections which have made no progress within timeout_ in
+    // the middle of a request or a response.
+    const uint64 now = GetCurrentMsec();
+    for (auto it = connections.begin(); it != connections.end();) {
+      if (it->second->deadline != 0 && it->second->deadline <= now) {
+        LOG(WARNING) << "Connection timeout " << timeout_;
+        it = close_connection(it);
+      } else {
+        ++it;
+      }
+    }
   }
 
+  connections.clear();
+  ::close(epoll_fd);
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
   if (!IsAbstractSocket(server_address_)) {
@@ -789,6 +789,11 @@ bool IPCClient::Connected() const {
   return connected_;
 }
 
+bool IPCClient::IsReusable() const {
+  // Call() closes the pipe.
+  return false;
+}
+
 bool IPCClient::Call(const char *request, size_t request_size,
                      char *response, size_t *response_size,
                      int32 timeout) {
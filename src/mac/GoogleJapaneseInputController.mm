@@ -198,6 +198,9 @@ bool IsBannedApplication(const set<string>* bundleIdSet,
   suppressSuggestion_ = NO;
   yenSignCharacter_ = mozc::config::Config::YEN_SIGN;
   candidateController_ = new(nothrow) mozc::renderer::RendererClient;
+  if (candidateController_) {
+    candidateController_->EnableAsyncMode();
+  }
   rendererCommand_ = new(nothrow)RendererCommand;
   mozcClient_ = mozc::client::ClientFactory::NewClient();
   imkServer_ = reinterpret_cast<id<ServerCallback> >(server);
@@ -34,15 +34,21 @@
 #include <climits>   // INT_MAX
 #include <cmath>
 #include <list>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
 #include "base/flags.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/number_util.h"
+#include "base/thread.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/connector.h"
@@ -72,6 +78,7 @@ DECLARE_bool(enable_typing_correction);
 using mozc::dictionary::DictionaryInterface;
 using mozc::dictionary::POSMatcher;
 using mozc::dictionary::Token;
+using mozc::dictionary::TokenView;
 using mozc::usage_stats::UsageStats;
 
 namespace mozc {
@@ -146,16 +153,17 @@ class DictionaryPredictor::PredictiveLookupCallback
  public:
   PredictiveLookupCallback(DictionaryPredictor::PredictionTypes types,
                            size_t limit, size_t original_key_len,
-                           const std::set<string> *subsequent_chars,
+                           const std::vector<string> *subsequent_chars,
                            bool is_zero_query,
                            std::vector<DictionaryPredictor::Result> *results)
       : penalty_(0), types_(types), limit_(limit),
         original_key_len_(original_key_len),
         subsequent_chars_(subsequent_chars),
         is_zero_query_(is_zero_query),
-        results_(results) {}
+        results_(results), num_keys_(0) {}
 
   ResultType OnKey(StringPiece key) override {
+    ++num_keys_;
     if (subsequent_chars_ == nullptr) {
       return TRAVERSE_CONTINUE;
     }
@@ -169,8 +177,6 @@ class DictionaryPredictor::PredictiveLookupCallback
     // than 10.  Thus, this linear order algorithm is fast enough.
     // Theoretically, we can construct a trie of strings in |subsequent_chars_|
     // to get more performance but it's overkill here.
-    // TODO(noriyukit): vector<string> would be better than set<string>.  To
-    // this end, we need to fix Comopser as well.
     const StringPiece rest = key.substr(original_key_len_);
     for (const string &chr : *subsequent_chars_) {
       if (Util::StartsWith(rest, chr)) {
@@ -186,9 +192,14 @@ class DictionaryPredictor::PredictiveLookupCallback
     return TRAVERSE_CONTINUE;
   }
 
-  ResultType OnToken(StringPiece,  // key
-                     StringPiece,  // actual_key
+  ResultType OnToken(StringPiece key, StringPiece actual_key,
                      const Token &token) override {
+    return OnTokenView(key, actual_key, TokenView(token));
+  }
+
+  ResultType OnTokenView(StringPiece,  // key
+                         StringPiece,  // actual_key
+                         const TokenView &token) override {
     results_->push_back(Result());
     results_->back().InitializeByTokenAndTypes(token, types_);
     results_->back().wcost += penalty_;
@@ -198,16 +209,25 @@ class DictionaryPredictor::PredictiveLookupCallback
     return (results_->size() < limit_) ? TRAVERSE_CONTINUE : TRAVERSE_DONE;
   }
 
+  // Returns true if the lookup may have stopped before finding all the
+  // results, either by |limit_| or by the key limit of predictive lookup.
+  bool IsTruncated() const {
+    return results_->size() >= limit_ ||
+           num_keys_ > GetPredictiveLookupKeyLimit();
+  }
+
  protected:
   int32 penalty_;
   const DictionaryPredictor::PredictionTypes types_;
   const size_t limit_;
   const size_t original_key_len_;
-  const std::set<string> *subsequent_chars_;
+  const std::vector<string> *subsequent_chars_;
   const bool is_zero_query_;
   std::vector<DictionaryPredictor::Result> *results_;
 
  private:
+  size_t num_keys_;
+
   DISALLOW_COPY_AND_ASSIGN(PredictiveLookupCallback);
 };
 
@@ -216,15 +236,15 @@ class DictionaryPredictor::PredictiveBigramLookupCallback :
  public:
   PredictiveBigramLookupCallback(
       DictionaryPredictor::PredictionTypes types, size_t limit,
-      size_t original_key_len, const std::set<string> *subsequent_chars,
+      size_t original_key_len, const std::vector<string> *subsequent_chars,
       StringPiece history_value, bool is_zero_query,
       std::vector<DictionaryPredictor::Result> *results)
       : PredictiveLookupCallback(types, limit, original_key_len,
                                  subsequent_chars, is_zero_query, results),
         history_value_(history_value) {}
 
-  virtual ResultType OnToken(StringPiece key, StringPiece expanded_key,
-                             const Token &token) {
+  ResultType OnTokenView(StringPiece key, StringPiece expanded_key,
+                         const TokenView &token) override {
     // Skip the token if its value doesn't start with the previous user input,
     // |history_value_|.
     if (!Util::StartsWith(token.value, history_value_) ||
@@ -232,7 +252,7 @@ class DictionaryPredictor::PredictiveBigramLookupCallback :
       return TRAVERSE_CONTINUE;
     }
     ResultType result_type =
-        PredictiveLookupCallback::OnToken(key, expanded_key, token);
+        PredictiveLookupCallback::OnTokenView(key, expanded_key, token);
     if (is_zero_query_) {
       results_->back().SetSourceInfoForZeroQuery(
           ZERO_QUERY_BIGRAM);
@@ -285,25 +305,38 @@ DictionaryPredictor::DictionaryPredictor(
       segmenter_(segmenter),
       suggestion_filter_(suggestion_filter),
       counter_suffix_word_id_(pos_matcher->GetCounterSuffixWordId()),
-      predictor_name_("DictionaryPredictor") {
+      predictor_name_("DictionaryPredictor"),
+      max_aggregation_threads_(1),
+      use_unigram_result_cache_(false),
+      typing_correction_time_budget_msec_(0),
+      typing_correction_budget_exceeded_count_(0),
+      record_aggregation_stats_(false) {
   StringPiece zero_query_token_array_data;
   StringPiece zero_query_string_array_data;
   StringPiece zero_query_number_token_array_data;
   StringPiece zero_query_number_string_array_data;
+  StringPiece zero_query_hash_data;
+  StringPiece zero_query_number_hash_data;
   data_manager.GetZeroQueryData(&zero_query_token_array_data,
                                 &zero_query_string_array_data,
                                 &zero_query_number_token_array_data,
                                 &zero_query_number_string_array_data);
+  data_manager.GetZeroQueryHashData(&zero_query_hash_data,
+                                    &zero_query_number_hash_data);
   zero_query_dict_.Init(zero_query_token_array_data,
-                        zero_query_string_array_data);
+                        zero_query_string_array_data,
+                        zero_query_hash_data);
   zero_query_number_dict_.Init(zero_query_number_token_array_data,
-                               zero_query_number_string_array_data);
+                               zero_query_number_string_array_data,
+                               zero_query_number_hash_data);
 }
 
 DictionaryPredictor::~DictionaryPredictor() {}
 
 void DictionaryPredictor::Finish(
     const ConversionRequest &request, Segments *segments) {
+  ClearUnigramCache();
+
   if (segments->request_type() == Segments::REVERSE_CONVERSION) {
     // Do nothing for REVERSE_CONVERSION.
     return;
@@ -365,6 +398,7 @@ void DictionaryPredictor::MaybeRecordUsageStats(
 
 bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
                                             Segments *segments) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::PredictForRequest");
   if (segments == NULL) {
     return false;
   }
@@ -380,6 +414,38 @@ bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
   return AddPredictionToCandidates(request, segments, &results);
 }
 
+// The time and the number of results of the aggregation stages for a
+// request.  Each stage only updates its own slot, so the stages running on
+// the worker threads don't conflict.
+struct DictionaryPredictor::AggregationStats {
+  AggregationStats() : ran(), ticks(), num_results() {}
+
+  bool ran[NUM_AGGREGATION_STAGES];
+  uint64 ticks[NUM_AGGREGATION_STAGES];
+  size_t num_results[NUM_AGGREGATION_STAGES];
+};
+
+// static
+template <typename Func>
+void DictionaryPredictor::RunAggregationStage(
+    AggregationStage stage, PredictionTypes types,
+    const std::vector<Result> &results, AggregationStats *stats, Func func) {
+  static const PredictionTypes kStageTypes[NUM_AGGREGATION_STAGES] = {
+    REALTIME | REALTIME_TOP, UNIGRAM, BIGRAM, SUFFIX, ENGLISH,
+    TYPING_CORRECTION,
+  };
+  if (stats == nullptr || !(types & kStageTypes[stage])) {
+    func();
+    return;
+  }
+  const size_t prev_size = results.size();
+  const uint64 begin_ticks = Clock::GetTicks();
+  func();
+  stats->ran[stage] = true;
+  stats->ticks[stage] += Clock::GetTicks() - begin_ticks;
+  stats->num_results[stage] += results.size() - prev_size;
+}
+
 bool DictionaryPredictor::AggregatePrediction(
     const ConversionRequest &request,
     Segments *segments,
@@ -393,21 +459,59 @@ bool DictionaryPredictor::AggregatePrediction(
     return false;
   }
 
+  AggregationStats stats;
+  AggregationStats *stats_ptr = record_aggregation_stats_ ? &stats : nullptr;
   if (segments->request_type() == Segments::PARTIAL_SUGGESTION ||
       segments->request_type() == Segments::PARTIAL_PREDICTION) {
     // This request type is used to get conversion before cursor during
     // composition mode. Thus it should return only the candidates whose key
     // exactly matches the query.
     // Therefore, we use only the realtime conversion result.
-    AggregateRealtimeConversion(prediction_types, request, segments, results);
-  } else {
-    AggregateRealtimeConversion(prediction_types, request, segments, results);
-    AggregateUnigramPrediction(prediction_types, request, *segments, results);
-    AggregateBigramPrediction(prediction_types, request, *segments, results);
-    AggregateSuffixPrediction(prediction_types, request, *segments, results);
-    AggregateEnglishPrediction(prediction_types, request, *segments, results);
-    AggregateTypeCorrectingPrediction(prediction_types, request, *segments,
+    RunAggregationStage(
+        REALTIME_STAGE, prediction_types, *results, stats_ptr, [&]() {
+          AggregateRealtimeConversion(prediction_types, request, segments,
                                       results);
+        });
+  } else if (max_aggregation_threads_ > 1) {
+    AggregatePredictionInParallel(prediction_types, request, segments,
+                                  results, stats_ptr);
+  } else {
+    // The expensive stages are skipped once the deadline of the request has
+    // passed.  The unigram prediction, which gives the most of the
+    // candidates, always runs.
+    PredictionTypes types = prediction_types;
+    DropStageIfDeadlinePassed(request, REALTIME | REALTIME_TOP,
+                              Segments::REALTIME_CONVERSION_STAGE, &types,
+                              segments);
+    RunAggregationStage(REALTIME_STAGE, types, *results, stats_ptr, [&]() {
+      AggregateRealtimeConversion(types, request, segments, results);
+    });
+    RunAggregationStage(UNIGRAM_STAGE, types, *results, stats_ptr, [&]() {
+      AggregateUnigramPrediction(types, request, *segments, results);
+    });
+    DropStageIfDeadlinePassed(request, BIGRAM,
+                              Segments::BIGRAM_PREDICTION_STAGE, &types,
+                              segments);
+    RunAggregationStage(BIGRAM_STAGE, types, *results, stats_ptr, [&]() {
+      AggregateBigramPrediction(types, request, *segments, results);
+    });
+    RunAggregationStage(SUFFIX_STAGE, types, *results, stats_ptr, [&]() {
+      AggregateSuffixPrediction(types, request, *segments, results);
+    });
+    RunAggregationStage(ENGLISH_STAGE, types, *results, stats_ptr, [&]() {
+      AggregateEnglishPrediction(types, request, *segments, results);
+    });
+    DropStageIfDeadlinePassed(request, TYPING_CORRECTION,
+                              Segments::TYPING_CORRECTION_STAGE, &types,
+                              segments);
+    RunAggregationStage(
+        TYPING_CORRECTION_STAGE, types, *results, stats_ptr, [&]() {
+          AggregateTypeCorrectingPrediction(types, request, *segments,
+                                            results);
+        });
+  }
+  if (stats_ptr != nullptr) {
+    RecordAggregationStats(stats, *results);
   }
 
   if (results->empty()) {
@@ -418,6 +522,208 @@ bool DictionaryPredictor::AggregatePrediction(
   }
 }
 
+// static
+void DictionaryPredictor::DropStageIfDeadlinePassed(
+    const ConversionRequest &request,
+    PredictionTypes stage_types,
+    Segments::PredictionStage stage,
+    PredictionTypes *types,
+    Segments *segments) {
+  if (!(*types & stage_types) || !request.IsDeadlinePassed()) {
+    return;
+  }
+  VLOG(1) << "Deadline passed. Skipping prediction stage " << stage;
+  *types &= ~stage_types;
+  segments->add_skipped_prediction_stage(stage);
+}
+
+namespace {
+
+// The number of stages run on the worker threads in
+// AggregatePredictionInParallel().
+const size_t kNumParallelAggregationStages = 4;
+
+}  // namespace
+
+// Runs some of the aggregation stages that only read |segments|, each of
+// which appends to its own results.
+class DictionaryPredictor::AggregationThread : public Thread {
+ public:
+  typedef void (DictionaryPredictor::*AggregateFunc)(
+      PredictionTypes types, const ConversionRequest &request,
+      const Segments &segments, std::vector<Result> *results) const;
+
+  AggregationThread(const DictionaryPredictor *predictor,
+                    PredictionTypes types,
+                    const ConversionRequest *request,
+                    const Segments *segments,
+                    AggregationStats *stats)
+      : predictor_(predictor), types_(types), request_(request),
+        segments_(segments), stats_(stats) {}
+
+  void AddStage(AggregateFunc func, AggregationStage stage,
+                std::vector<Result> *results) {
+    Stage s = {func, stage, results};
+    stages_.push_back(s);
+  }
+
+  void Run() override {
+    for (size_t i = 0; i < stages_.size(); ++i) {
+      const Stage &s = stages_[i];
+      RunAggregationStage(s.stage, types_, *s.results, stats_, [this, &s]() {
+        (predictor_->*s.func)(types_, *request_, *segments_, s.results);
+      });
+    }
+  }
+
+ private:
+  struct Stage {
+    AggregateFunc func;
+    AggregationStage stage;
+    std::vector<Result> *results;
+  };
+
+  const DictionaryPredictor *predictor_;
+  const PredictionTypes types_;
+  const ConversionRequest *request_;
+  const Segments *segments_;
+  AggregationStats *stats_;
+  std::vector<Stage> stages_;
+
+  DISALLOW_COPY_AND_ASSIGN(AggregationThread);
+};
+
+void DictionaryPredictor::AggregatePredictionInParallel(
+    PredictionTypes types,
+    const ConversionRequest &request,
+    Segments *segments,
+    std::vector<Result> *results,
+    AggregationStats *stats) const {
+  DropStageIfDeadlinePassed(request, REALTIME | REALTIME_TOP,
+                            Segments::REALTIME_CONVERSION_STAGE, &types,
+                            segments);
+  DropStageIfDeadlinePassed(request, BIGRAM,
+                            Segments::BIGRAM_PREDICTION_STAGE, &types,
+                            segments);
+  const struct {
+    AggregationThread::AggregateFunc func;
+    PredictionTypes type;
+    AggregationStage stage;
+  } kStages[kNumParallelAggregationStages] = {
+    {&DictionaryPredictor::AggregateUnigramPrediction, UNIGRAM,
+     UNIGRAM_STAGE},
+    {&DictionaryPredictor::AggregateBigramPrediction, BIGRAM, BIGRAM_STAGE},
+    {&DictionaryPredictor::AggregateSuffixPrediction, SUFFIX, SUFFIX_STAGE},
+    {&DictionaryPredictor::AggregateEnglishPrediction, ENGLISH,
+     ENGLISH_STAGE},
+  };
+
+  std::vector<size_t> stages;
+  for (size_t i = 0; i < kNumParallelAggregationStages; ++i) {
+    if (types & kStages[i].type) {
+      stages.push_back(i);
+    }
+  }
+
+  // The worker threads don't touch the candidates of the conversion segment,
+  // which the realtime conversion uses as its temporary output.
+  std::vector<Result> stage_results[kNumParallelAggregationStages];
+  const size_t num_threads =
+      std::min(max_aggregation_threads_ - 1, stages.size());
+  std::vector<std::unique_ptr<AggregationThread>> threads;
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(
+        new AggregationThread(this, types, &request, segments, stats));
+  }
+  for (size_t i = 0; i < stages.size(); ++i) {
+    threads[i % num_threads]->AddStage(kStages[stages[i]].func,
+                                       kStages[stages[i]].stage,
+                                       &stage_results[stages[i]]);
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->SetJoinable(true);
+    threads[i]->Start("DictionaryPredictor");
+  }
+
+  RunAggregationStage(REALTIME_STAGE, types, *results, stats, [&]() {
+    AggregateRealtimeConversion(types, request, segments, results);
+  });
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+  }
+  for (size_t i = 0; i < kNumParallelAggregationStages; ++i) {
+    results->insert(results->end(),
+                    std::make_move_iterator(stage_results[i].begin()),
+                    std::make_move_iterator(stage_results[i].end()));
+  }
+
+  // Typing correction depends on the number of the preceding results.
+  DropStageIfDeadlinePassed(request, TYPING_CORRECTION,
+                            Segments::TYPING_CORRECTION_STAGE, &types,
+                            segments);
+  RunAggregationStage(TYPING_CORRECTION_STAGE, types, *results, stats, [&]() {
+    AggregateTypeCorrectingPrediction(types, request, *segments, results);
+  });
+}
+
+// static
+void DictionaryPredictor::RecordAggregationStats(
+    const AggregationStats &stats, const std::vector<Result> &results) {
+  // The time in microseconds and the number of results of each stage.
+  static const usage_stats::StatsId
+      kStageStatsIds[NUM_AGGREGATION_STAGES][2] = {
+    {usage_stats::kDictionaryPredictorRealtimeUSecId,
+     usage_stats::kDictionaryPredictorRealtimeResultsId},
+    {usage_stats::kDictionaryPredictorUnigramUSecId,
+     usage_stats::kDictionaryPredictorUnigramResultsId},
+    {usage_stats::kDictionaryPredictorBigramUSecId,
+     usage_stats::kDictionaryPredictorBigramResultsId},
+    {usage_stats::kDictionaryPredictorSuffixUSecId,
+     usage_stats::kDictionaryPredictorSuffixResultsId},
+    {usage_stats::kDictionaryPredictorEnglishUSecId,
+     usage_stats::kDictionaryPredictorEnglishResultsId},
+    {usage_stats::kDictionaryPredictorTypingCorrectionUSecId,
+     usage_stats::kDictionaryPredictorTypingCorrectionResultsId},
+  };
+  const uint64 frequency = Clock::GetFrequency();
+  for (size_t i = 0; i < NUM_AGGREGATION_STAGES; ++i) {
+    if (!stats.ran[i]) {
+      continue;
+    }
+    UsageStats::UpdateTiming(
+        kStageStatsIds[i][0],
+        static_cast<uint32>(stats.ticks[i] * 1000000 / frequency));
+    UsageStats::UpdateTiming(kStageStatsIds[i][1],
+                             static_cast<uint32>(stats.num_results[i]));
+  }
+
+  static const struct {
+    PredictionTypes type;
+    usage_stats::StatsId id;
+  } kTypeStatsIds[] = {
+    {UNIGRAM, usage_stats::kDictionaryPredictorResultTypeUnigramId},
+    {BIGRAM, usage_stats::kDictionaryPredictorResultTypeBigramId},
+    {REALTIME, usage_stats::kDictionaryPredictorResultTypeRealtimeId},
+    {REALTIME_TOP, usage_stats::kDictionaryPredictorResultTypeRealtimeTopId},
+    {SUFFIX, usage_stats::kDictionaryPredictorResultTypeSuffixId},
+    {ENGLISH, usage_stats::kDictionaryPredictorResultTypeEnglishId},
+    {TYPING_CORRECTION,
+     usage_stats::kDictionaryPredictorResultTypeTypingCorrectionId},
+  };
+  for (size_t i = 0; i < arraysize(kTypeStatsIds); ++i) {
+    uint32 count = 0;
+    for (size_t j = 0; j < results.size(); ++j) {
+      if (results[j].types & kTypeStatsIds[i].type) {
+        ++count;
+      }
+    }
+    if (count > 0) {
+      UsageStats::IncrementCountBy(kTypeStatsIds[i].id, count);
+    }
+  }
+}
+
 void DictionaryPredictor::SetCost(const ConversionRequest &request,
                                   const Segments &segments,
                                   std::vector<Result> *results) const {
@@ -465,34 +771,45 @@ bool DictionaryPredictor::AddPredictionToCandidates(
   Segment *segment = segments->mutable_conversion_segment(0);
   DCHECK(segment);
 
+  // Only the results which can be candidates take part in the selection.
+  // The others, most of which are removed by RemovePrediction(), are moved
+  // out of the range to keep the heap below small.
+  const std::vector<Result>::iterator selection_end = std::partition(
+      results->begin(), results->end(),
+      [](const Result &result) {
+        return result.types != NO_PREDICTION && result.cost < kInfinity;
+      });
+  const size_t selection_size = selection_end - results->begin();
+
   // Instead of sorting all the results, we construct a heap.
   // This is done in linear time and
   // we can pop as many results as we need efficiently.
-  std::make_heap(results->begin(), results->end(), ResultCostLess());
+  std::make_heap(results->begin(), selection_end, ResultCostLess());
 
   const size_t size = min(segments->max_prediction_candidates_size(),
-                          results->size());
+                          selection_size);
 
   int added = 0;
-  std::set<string> seen;
+  // Popped results stay behind the heap and are not modified any more, so the
+  // dedupe set and the key/value below refer to them without copying.  Only
+  // the strings of the added candidates are copied.
+  std::set<StringPiece> seen;
+  // The candidates added by the preceding predictors, e.g., the user history
+  // predictor, are not added again, so that their duplicates don't take the
+  // slots of the candidates.
+  for (size_t i = 0; i < segment->candidates_size(); ++i) {
+    seen.insert(segment->candidate(i).value);
+  }
 
   int added_suffix = 0;
   bool cursor_at_tail =
       request.has_composer() &&
       request.composer().GetCursor() == request.composer().GetLength();
 
-  for (size_t i = 0; i < results->size(); ++i) {
+  for (size_t i = 0; i < selection_size && added < size; ++i) {
     // Pop a result from a heap. Please pay attention not to use results->at(i).
-    std::pop_heap(results->begin(), results->end() - i, ResultCostLess());
-    const Result &result = results->at(results->size() - i - 1);
-
-    if (added >= size || result.cost >= kInfinity) {
-      break;
-    }
-
-    if (result.types == NO_PREDICTION) {
-      continue;
-    }
+    std::pop_heap(results->begin(), selection_end - i, ResultCostLess());
+    const Result &result = results->at(selection_size - i - 1);
 
     // If mixed_conversion is true, we don't filter the results which have
     // the exact same key as the input.
@@ -512,16 +829,11 @@ bool DictionaryPredictor::AddPredictionToCandidates(
       continue;
     }
 
-    string key, value;
+    StringPiece key(result.key), value(result.value);
     if (result.types & BIGRAM) {
       // remove the prefix of history key and history value.
-      key = result.key.substr(history_key.size(),
-                              result.key.size() - history_key.size());
-      value = result.value.substr(history_value.size(),
-                                  result.value.size() - history_value.size());
-    } else {
-      key = result.key;
-      value = result.value;
+      key.remove_prefix(history_key.size());
+      value.remove_prefix(history_value.size());
     }
 
     if (!seen.insert(value).second) {
@@ -547,10 +859,10 @@ bool DictionaryPredictor::AddPredictionToCandidates(
     DCHECK(candidate);
 
     candidate->Init();
-    candidate->content_key = key;
-    candidate->content_value = value;
-    candidate->key = key;
-    candidate->value = value;
+    key.CopyToString(&candidate->key);
+    value.CopyToString(&candidate->value);
+    candidate->content_key = candidate->key;
+    candidate->content_value = candidate->value;
     candidate->lid = result.lid;
     candidate->rid = result.rid;
     candidate->wcost = result.wcost;
@@ -669,14 +981,19 @@ class FindValueCallback : public DictionaryInterface::Callback {
   explicit FindValueCallback(StringPiece target_value)
       : target_value_(target_value), found_(false) {}
 
-  virtual ResultType OnToken(StringPiece,  // key
-                             StringPiece,  // actual_key
+  virtual ResultType OnToken(StringPiece key, StringPiece actual_key,
                              const Token &token) {
+    return OnTokenView(key, actual_key, TokenView(token));
+  }
+
+  virtual ResultType OnTokenView(StringPiece,  // key
+                                 StringPiece,  // actual_key
+                                 const TokenView &token) {
     if (token.value != target_value_) {
       return TRAVERSE_CONTINUE;
     }
     found_ = true;
-    token_ = token;
+    token.CopyToToken(&token_);
     return TRAVERSE_DONE;
   }
 
@@ -699,10 +1016,10 @@ class FindValueCallback : public DictionaryInterface::Callback {
 }  // namespace
 
 void DictionaryPredictor::Result::InitializeByTokenAndTypes(
-    const Token &token, PredictionTypes types) {
+    const TokenView &token, PredictionTypes types) {
   SetTypesAndTokenAttributes(types, token.attributes);
-  key = token.key;
-  value = token.value;
+  token.key.CopyToString(&key);
+  token.value.CopyToString(&value);
   wcost = token.cost;
   lid = token.lid;
   rid = token.rid;
@@ -996,7 +1313,7 @@ void DictionaryPredictor::ApplyPenaltyForKeyExpansion(
 }
 
 size_t DictionaryPredictor::GetMissSpelledPosition(
-    const string &key, const string &value) const {
+    StringPiece key, StringPiece value) const {
   string hiragana_value;
   Util::KatakanaToHiragana(value, &hiragana_value);
   // value is mixed type. return true if key == request_key.
@@ -1214,6 +1531,7 @@ void DictionaryPredictor::AggregateRealtimeConversion(
     const ConversionRequest &request,
     Segments *segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::AggregateRealtimeConversion");
   if (!(types & REALTIME)) {
     return;
   }
@@ -1312,6 +1630,7 @@ void DictionaryPredictor::AggregateUnigramPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::AggregateUnigramPrediction");
   if (!(types & UNIGRAM)) {
     return;
   }
@@ -1337,8 +1656,12 @@ void DictionaryPredictor::AggregateUnigramCandidate(
 
   const size_t cutoff_threshold = GetCandidateCutoffThreshold(segments);
   const size_t prev_results_size = results->size();
-  GetPredictiveResults(*dictionary_, "", request, segments, UNIGRAM,
-                       cutoff_threshold, results);
+  if (use_unigram_result_cache_) {
+    GetUnigramResultsWithCache(request, segments, cutoff_threshold, results);
+  } else {
+    GetPredictiveResults(*dictionary_, "", request, segments, UNIGRAM,
+                         cutoff_threshold, results);
+  }
   const size_t unigram_results_size = results->size() - prev_results_size;
 
   // If size reaches max_results_size (== cutoff_threshold).
@@ -1350,6 +1673,76 @@ void DictionaryPredictor::AggregateUnigramCandidate(
   }
 }
 
+void DictionaryPredictor::GetUnigramResultsWithCache(
+    const ConversionRequest &request,
+    const Segments &segments,
+    size_t lookup_limit,
+    std::vector<Result> *results) const {
+  // Only the lookup for a single key without expansion is cached, which is the
+  // first case of GetPredictiveResults().
+  string key;
+  if (request.has_composer() &&
+      FLAGS_enable_expansion_for_dictionary_predictor) {
+    std::vector<string> expanded;
+    request.composer().GetQueriesForPrediction(&key, &expanded);
+    if (!expanded.empty()) {
+      key.clear();
+    }
+  } else {
+    key = segments.conversion_segment(0).key();
+  }
+  if (key.empty() || request.IsKanaModifierInsensitiveConversion()) {
+    GetPredictiveResults(*dictionary_, "", request, segments, UNIGRAM,
+                         lookup_limit, results);
+    return;
+  }
+
+  const size_t prev_results_size = results->size();
+  const string config = request.config().SerializeAsString();
+  {
+    scoped_lock l(&unigram_cache_mutex_);
+    if (!unigram_cache_.key.empty() && unigram_cache_.config == config &&
+        Util::StartsWith(key, unigram_cache_.key)) {
+      // The results for |key| are complete, too, so narrow the cache down to
+      // them for the next key.
+      std::vector<Result> &cached = unigram_cache_.results;
+      cached.erase(std::remove_if(cached.begin(), cached.end(),
+                                  [&key](const Result &result) {
+                                    return !Util::StartsWith(result.key, key);
+                                  }),
+                   cached.end());
+      unigram_cache_.key = key;
+      // The lookup would have reached the limit with these results, in which
+      // case the truncated results depend on the dictionary.
+      if (prev_results_size + cached.size() < lookup_limit) {
+        results->insert(results->end(), cached.begin(), cached.end());
+        return;
+      }
+    }
+  }
+
+  PredictiveLookupCallback callback(UNIGRAM, lookup_limit, key.size(),
+                                    nullptr, false, results);
+  dictionary_->LookupPredictive(key, request, &callback);
+
+  scoped_lock l(&unigram_cache_mutex_);
+  if (callback.IsTruncated()) {
+    unigram_cache_.key.clear();
+    unigram_cache_.results.clear();
+    return;
+  }
+  unigram_cache_.key = key;
+  unigram_cache_.config = config;
+  unigram_cache_.results.assign(results->begin() + prev_results_size,
+                                results->end());
+}
+
+void DictionaryPredictor::ClearUnigramCache() {
+  scoped_lock l(&unigram_cache_mutex_);
+  unigram_cache_.key.clear();
+  unigram_cache_.results.clear();
+}
+
 void DictionaryPredictor::AggregateUnigramCandidateForMixedConversion(
     const ConversionRequest &request,
     const Segments &segments,
@@ -1427,7 +1820,8 @@ void DictionaryPredictor::AggregateUnigramCandidateForMixedConversion(
   }
 
   // Finally output the result.
-  results->insert(results->end(), raw_result.begin(), max_iter);
+  results->insert(results->end(), std::make_move_iterator(raw_result.begin()),
+                  std::make_move_iterator(max_iter));
 }
 
 void DictionaryPredictor::AggregateBigramPrediction(
@@ -1435,6 +1829,7 @@ void DictionaryPredictor::AggregateBigramPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::AggregateBigramPrediction");
   if (!(types & BIGRAM)) {
     return;
   }
@@ -1602,7 +1997,7 @@ void DictionaryPredictor::GetPredictiveResults(
   // Example2 kana input: for "あか", we will get |base|, "あ" and |expanded|,
   // "か", and "が".
   string base;
-  std::set<string> expanded;
+  std::vector<string> expanded;
   request.composer().GetQueriesForPrediction(&base, &expanded);
   const bool is_zero_query = base.empty() && expanded.empty();
   string input_key;
@@ -1652,7 +2047,7 @@ void DictionaryPredictor::GetPredictiveResultsForBigram(
   // Example2 kana input: for "あか", we will get |base|, "あ" and |expanded|,
   // "か", and "が".
   string base;
-  std::set<string> expanded;
+  std::vector<string> expanded;
   request.composer().GetQueriesForPrediction(&base, &expanded);
   string input_key = history_key;
   input_key.append(base);
@@ -1737,13 +2132,38 @@ void DictionaryPredictor::GetPredictiveResultsUsingTypingCorrection(
 
   std::vector<composer::TypeCorrectedQuery> queries;
   request.composer().GetTypeCorrectedQueriesForPrediction(&queries);
+  // The most probable corrections are looked up first so that they are done
+  // within the time budget.
+  std::stable_sort(queries.begin(), queries.end(),
+                   [](const composer::TypeCorrectedQuery &lhs,
+                      const composer::TypeCorrectedQuery &rhs) {
+                     return lhs.cost < rhs.cost;
+                   });
+  // The lookups stop at the earlier of the time budget and the deadline of
+  // the request.
+  uint64 deadline_ticks = request.deadline_ticks();
+  if (typing_correction_time_budget_msec_ > 0) {
+    const uint64 budget_deadline_ticks = Clock::GetTicks() +
+        Clock::GetFrequency() * typing_correction_time_budget_msec_ / 1000;
+    if (deadline_ticks == 0 || budget_deadline_ticks < deadline_ticks) {
+      deadline_ticks = budget_deadline_ticks;
+    }
+  }
   for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
+    if (deadline_ticks > 0 && Clock::GetTicks() >= deadline_ticks) {
+      VLOG(1) << "Typing correction ran out of the time budget after "
+              << query_index << " of " << queries.size() << " queries";
+      ++typing_correction_budget_exceeded_count_;
+      break;
+    }
     const composer::TypeCorrectedQuery &query = queries[query_index];
     const string input_key = history_key + query.base;
+    const std::vector<string> expanded(query.expanded.begin(),
+                                       query.expanded.end());
     const size_t previous_results_size = results->size();
     PredictiveLookupCallback callback(
         types, lookup_limit, input_key.size(),
-        query.expanded.empty() ? NULL : &query.expanded, false, results);
+        expanded.empty() ? NULL : &expanded, false, results);
     dictionary.LookupPredictive(input_key, request, &callback);
 
     for (size_t i = previous_results_size; i < results->size(); ++i) {
@@ -1886,6 +2306,7 @@ void DictionaryPredictor::AggregateSuffixPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::AggregateSuffixPrediction");
   if (!(types & SUFFIX)) {
     return;
   }
@@ -1916,6 +2337,7 @@ void DictionaryPredictor::AggregateEnglishPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::AggregateEnglishPrediction");
   if (!(types & ENGLISH)) {
     return;
   }
@@ -1943,6 +2365,7 @@ void DictionaryPredictor::AggregateTypeCorrectingPrediction(
     const ConversionRequest &request,
     const Segments &segments,
     std::vector<Result> *results) const {
+  MOZC_TRACE_SPAN("DictionaryPredictor::AggregateTypeCorrectingPrediction");
   if (!(types & TYPING_CORRECTION)) {
     return;
   }
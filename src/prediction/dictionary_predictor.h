@@ -30,10 +30,13 @@
 #ifndef MOZC_PREDICTION_DICTIONARY_PREDICTOR_H_
 #define MOZC_PREDICTION_DICTIONARY_PREDICTOR_H_
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <vector>
 
+#include "base/mutex.h"
+#include "base/string_piece.h"
 #include "base/util.h"
 #include "converter/connector.h"
 #include "converter/converter_interface.h"
@@ -76,6 +79,55 @@ class DictionaryPredictor : public PredictorInterface {
 
   const string &GetPredictorName() const override { return predictor_name_; }
 
+  // Enables the parallel mode of aggregating the prediction results with at
+  // most |num_threads| threads including the calling one, which runs the
+  // realtime conversion while worker threads do the dictionary lookups of the
+  // unigram, bigram, suffix and English predictions.  The results are merged
+  // in the same order as the sequential mode.  The dictionaries must allow
+  // concurrent reads; see ImmutableConverterImpl::
+  // set_max_lattice_lookup_threads().  1 (the default) disables the parallel
+  // mode.
+  void set_max_aggregation_threads(size_t num_threads) {
+    max_aggregation_threads_ = num_threads;
+  }
+  size_t max_aggregation_threads() const {
+    return max_aggregation_threads_;
+  }
+
+  // Enables the cache of the last unigram lookup for non mixed conversion.
+  // When the next key extends the cached one, e.g., "とうき" after "とう",
+  // the unigram results are obtained by filtering the cached results instead
+  // of looking up |dictionary| again, provided that the cached lookup was not
+  // truncated by its limits.  The cache assumes that the predictive lookup of
+  // |dictionary| for a key returns exactly the subsequence of the results for
+  // any of its prefixes, which holds for DictionaryImpl.  The cache is cleared
+  // by Finish().  Disabled by default.
+  void set_use_unigram_result_cache(bool use) {
+    use_unigram_result_cache_ = use;
+  }
+
+  // Sets the time budget of the typing correction prediction in milliseconds.
+  // Typing corrected queries are looked up in ascending order of correction
+  // cost, and the rest of the queries are skipped once the budget runs out, so
+  // the prediction returns the results found by then.  0 (the default) means
+  // no limit.
+  void set_typing_correction_time_budget_msec(uint32 msec) {
+    typing_correction_time_budget_msec_ = msec;
+  }
+  // Returns how many times the typing correction prediction ran out of the
+  // time budget before looking up all the queries.
+  uint64 typing_correction_budget_exceeded_count() const {
+    return typing_correction_budget_exceeded_count_;
+  }
+
+  // Enables recording the time and the number of results of each aggregation
+  // stage, e.g., the unigram prediction, and the number of the results for
+  // each prediction type to the usage stats for every prediction.  Disabled by
+  // default, in which case the stages are run without any measurement.
+  void set_record_aggregation_stats(bool record) {
+    record_aggregation_stats_ = record;
+  }
+
  protected:
   // Protected members for unittesting
   // For use util method accessing private members, made them protected.
@@ -110,7 +162,7 @@ class DictionaryPredictor : public PredictorInterface {
                candidate_attributes(0), source_info(0),
                consumed_key_size(0) {}
 
-    void InitializeByTokenAndTypes(const dictionary::Token &token,
+    void InitializeByTokenAndTypes(const dictionary::TokenView &token,
                                    PredictionTypes types);
     void SetTypesAndTokenAttributes(
         PredictionTypes prediction_types,
@@ -154,6 +206,20 @@ class DictionaryPredictor : public PredictorInterface {
     return Result();
   }
 
+  class AggregationThread;
+
+  // Stages of the aggregation whose time and results are recorded.  See
+  // set_record_aggregation_stats().
+  enum AggregationStage {
+    REALTIME_STAGE,
+    UNIGRAM_STAGE,
+    BIGRAM_STAGE,
+    SUFFIX_STAGE,
+    ENGLISH_STAGE,
+    TYPING_CORRECTION_STAGE,
+    NUM_AGGREGATION_STAGES,
+  };
+  struct AggregationStats;
   class PredictiveLookupCallback;
   class PredictiveBigramLookupCallback;
   class ResultWCostLess;
@@ -252,6 +318,35 @@ class DictionaryPredictor : public PredictorInterface {
                            Segments *segments,
                            std::vector<Result> *results) const;
 
+  // Parallel version of the aggregation for non-partial requests.  See
+  // set_max_aggregation_threads().
+  void AggregatePredictionInParallel(PredictionTypes types,
+                                     const ConversionRequest &request,
+                                     Segments *segments,
+                                     std::vector<Result> *results,
+                                     AggregationStats *stats) const;
+
+  // Runs |func|, which appends to |results|, and adds its time and number of
+  // results to |stats| as |stage| if |types| enables the stage.  |stats| can
+  // be nullptr, in which case |func| is just run.
+  template <typename Func>
+  static void RunAggregationStage(AggregationStage stage, PredictionTypes types,
+                                  const std::vector<Result> &results,
+                                  AggregationStats *stats, Func func);
+
+  // Records |stats| and the number of |results| for each prediction type to
+  // the usage stats.  See set_record_aggregation_stats().
+  static void RecordAggregationStats(const AggregationStats &stats,
+                                     const std::vector<Result> &results);
+
+  // Removes |stage_types| from |types| and reports |stage| as skipped in
+  // |segments| if |types| has them and the deadline of |request| has passed.
+  static void DropStageIfDeadlinePassed(const ConversionRequest &request,
+                                        PredictionTypes stage_types,
+                                        Segments::PredictionStage stage,
+                                        PredictionTypes *types,
+                                        Segments *segments);
+
   bool AggregateNumberZeroQueryPrediction(const ConversionRequest &request,
                                           const Segments &segments,
                                           std::vector<Result> *results) const;
@@ -334,8 +429,7 @@ class DictionaryPredictor : public PredictorInterface {
   // key: "ろっぽんぎ"5
   // value: "六本木"
   // returns 5 (charslen("六本木"))
-  size_t GetMissSpelledPosition(const string &key,
-                                const string &value) const;
+  size_t GetMissSpelledPosition(StringPiece key, StringPiece value) const;
 
   // Returns language model cost of |token| given prediciton type |type|.
   // |rid| is the right id of previous word (token).
@@ -431,6 +525,14 @@ class DictionaryPredictor : public PredictorInterface {
                                  const Segments &segments,
                                  std::vector<Result> *results) const;
 
+  // Looks up |dictionary_| for the unigram results of the current key, reusing
+  // |unigram_cache_| if possible.  See set_use_unigram_result_cache().
+  void GetUnigramResultsWithCache(const ConversionRequest &request,
+                                  const Segments &segments,
+                                  size_t lookup_limit,
+                                  std::vector<Result> *results) const;
+  void ClearUnigramCache();
+
   // Aggregates unigram candidate for mixed conversion.
   // This reduces redundant candidates.
   static void AggregateUnigramCandidateForMixedConversion(
@@ -479,6 +581,22 @@ class DictionaryPredictor : public PredictorInterface {
   const string predictor_name_;
   ZeroQueryDict zero_query_dict_;
   ZeroQueryDict zero_query_number_dict_;
+  size_t max_aggregation_threads_;
+  bool use_unigram_result_cache_;
+  uint32 typing_correction_time_budget_msec_;
+  mutable std::atomic<uint64> typing_correction_budget_exceeded_count_;
+  bool record_aggregation_stats_;
+
+  // The last complete unigram lookup, i.e., |results| are all the unigram
+  // results for |key| under the config serialized to |config|.  |key| is empty
+  // when there is no cache.
+  struct UnigramCache {
+    string key;
+    string config;
+    std::vector<Result> results;
+  };
+  mutable Mutex unigram_cache_mutex_;
+  mutable UnigramCache unigram_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(DictionaryPredictor);
 };
@@ -36,6 +36,8 @@
 #include <utility>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
@@ -807,6 +809,16 @@ class DictionaryPredictorTest : public ::testing::Test {
     }
   }
 
+  // Inserts |key| to |composer_| with the typing model for QWERTY mobile
+  // keyboard, where |corrected_key_codes| are the probable keys.
+  void InsertInputSequenceForTypeCorrection(const char *key,
+                                            const uint32 *corrected_key_codes) {
+    table_->LoadFromFile("system://qwerty_mobile-hiragana.tsv");
+    table_->typing_model_.reset(new MockTypingModel());
+    InsertInputSequenceForProbableKeyEvent(
+        key, corrected_key_codes, composer_.get());
+  }
+
   void AggregateTypeCorrectingTestHelper(
       const char *key,
       const uint32 *corrected_key_codes,
@@ -820,10 +832,7 @@ class DictionaryPredictorTest : public ::testing::Test {
     const TestableDictionaryPredictor *predictor =
         data_and_predictor->dictionary_predictor();
 
-    table_->LoadFromFile("system://qwerty_mobile-hiragana.tsv");
-    table_->typing_model_.reset(new MockTypingModel());
-    InsertInputSequenceForProbableKeyEvent(
-        key, corrected_key_codes, composer_.get());
+    InsertInputSequenceForTypeCorrection(key, corrected_key_codes);
 
     Segments segments;
     MakeSegmentsForPrediction(key, &segments);
@@ -938,6 +947,123 @@ TEST_F(DictionaryPredictorTest, BigramTest) {
   EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
 }
 
+TEST_F(DictionaryPredictorTest, ParallelAggregation) {
+  config_->set_use_dictionary_suggest(true);
+  config_->set_use_realtime_conversion(true);
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+
+  // The results are the same as the sequential mode regardless of the
+  // number of threads.
+  for (size_t num_threads = 1; num_threads <= 6; ++num_threads) {
+    Segments expected, segments;
+    Segments *inputs[] = {&expected, &segments};
+    for (size_t i = 0; i < arraysize(inputs); ++i) {
+      // "あ"
+      MakeSegmentsForPrediction("\xE3\x81\x82", inputs[i]);
+      // history is "グーグル"
+      PrependHistorySegments(
+          "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B",
+          "\xE3\x82\xB0\xE3\x83\xBC\xE3\x82\xB0\xE3\x83\xAB",
+          inputs[i]);
+    }
+
+    predictor->set_max_aggregation_threads(1);
+    ASSERT_TRUE(predictor->PredictForRequest(*convreq_, &expected));
+    predictor->set_max_aggregation_threads(num_threads);
+    ASSERT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+
+    const Segment &expected_segment = expected.conversion_segment(0);
+    const Segment &segment = segments.conversion_segment(0);
+    ASSERT_EQ(expected_segment.candidates_size(), segment.candidates_size());
+    for (size_t i = 0; i < segment.candidates_size(); ++i) {
+      EXPECT_EQ(expected_segment.candidate(i).value,
+                segment.candidate(i).value) << num_threads << " " << i;
+      EXPECT_EQ(expected_segment.candidate(i).cost,
+                segment.candidate(i).cost) << num_threads << " " << i;
+    }
+  }
+}
+
+TEST_F(DictionaryPredictorTest, SkipExpensiveStagesAfterDeadline) {
+  config_->set_use_dictionary_suggest(true);
+  config_->set_use_realtime_conversion(true);
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+
+  // The deadline has already passed.
+  convreq_->set_deadline_ticks(1);
+  for (size_t num_threads = 1; num_threads <= 3; num_threads += 2) {
+    predictor->set_max_aggregation_threads(num_threads);
+    Segments segments;
+    // "ぐーぐるあ"
+    MakeSegmentsForPrediction(
+        "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B"
+        "\xE3\x81\x82", &segments);
+    // history is "グーグル"
+    PrependHistorySegments(
+        "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B",
+        "\xE3\x82\xB0\xE3\x83\xBC\xE3\x82\xB0\xE3\x83\xAB",
+        &segments);
+
+    // The unigram prediction still runs.
+    EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+    EXPECT_EQ(Segments::REALTIME_CONVERSION_STAGE |
+              Segments::BIGRAM_PREDICTION_STAGE,
+              segments.skipped_prediction_stages()) << num_threads;
+  }
+
+  // Without deadline, no stage is skipped.
+  convreq_->set_deadline_ticks(0);
+  Segments segments;
+  MakeSegmentsForPrediction("\xE3\x81\x82", &segments);
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_EQ(0, segments.skipped_prediction_stages());
+}
+
+TEST_F(DictionaryPredictorTest, RecordAggregationStats) {
+  config_->set_use_dictionary_suggest(true);
+  config_->set_use_realtime_conversion(true);
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+
+  // Nothing is recorded by default.
+  Segments segments;
+  // "ぐーぐるあ"
+  MakeSegmentsForPrediction(
+      "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B"
+      "\xE3\x81\x82", &segments);
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_STATS_NOT_EXIST("DictionaryPredictorUnigramUSec");
+  EXPECT_STATS_NOT_EXIST("DictionaryPredictorResultTypeUnigram");
+
+  // Both modes of the aggregation record the same stages.
+  predictor->set_record_aggregation_stats(true);
+  for (size_t num_threads = 1; num_threads <= 3; num_threads += 2) {
+    mozc::usage_stats::UsageStats::ClearAllStatsForTest();
+    predictor->set_max_aggregation_threads(num_threads);
+    segments.Clear();
+    MakeSegmentsForPrediction(
+        "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B"
+        "\xE3\x81\x82", &segments);
+    EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+    EXPECT_STATS_EXIST("DictionaryPredictorRealtimeUSec") << num_threads;
+    EXPECT_STATS_EXIST("DictionaryPredictorRealtimeResults") << num_threads;
+    EXPECT_STATS_EXIST("DictionaryPredictorUnigramUSec") << num_threads;
+    EXPECT_STATS_EXIST("DictionaryPredictorUnigramResults") << num_threads;
+    EXPECT_STATS_EXIST("DictionaryPredictorResultTypeUnigram") << num_threads;
+    EXPECT_STATS_EXIST("DictionaryPredictorResultTypeRealtime") << num_threads;
+    // The bigram prediction doesn't run without history.
+    EXPECT_STATS_NOT_EXIST("DictionaryPredictorBigramUSec") << num_threads;
+  }
+}
+
 TEST_F(DictionaryPredictorTest, BigramTestWithZeroQuery) {
   Segments segments;
   config_->set_use_dictionary_suggest(true);
@@ -2032,6 +2158,90 @@ TEST_F(DictionaryPredictorTest, AggregateTypeCorrectingPrediction) {
                                     arraysize(kExpectedValues));
 }
 
+// DictionaryMock which puts |clock| forward by one tick in every predictive
+// lookup.
+class ClockAdvancingDictionaryMock : public DictionaryMock {
+ public:
+  explicit ClockAdvancingDictionaryMock(ClockMock *clock)
+      : clock_(clock), num_lookups_(0) {}
+
+  void LookupPredictive(StringPiece key,
+                        const ConversionRequest &conversion_request,
+                        Callback *callback) const override {
+    ++num_lookups_;
+    clock_->PutClockForwardByTicks(1);
+    DictionaryMock::LookupPredictive(key, conversion_request, callback);
+  }
+
+  int num_lookups() const { return num_lookups_; }
+  void reset_num_lookups() { num_lookups_ = 0; }
+
+ private:
+  ClockMock *clock_;
+  mutable int num_lookups_;
+};
+
+TEST_F(DictionaryPredictorTest, TypeCorrectingPredictionWithTimeBudget) {
+  config_->set_use_typing_correction(true);
+  request_->set_special_romanji_table(
+      commands::Request::QWERTY_MOBILE_TO_HIRAGANA);
+
+  // One tick is one millisecond.
+  ClockMock clock(0, 0);
+  clock.SetFrequency(1000);
+  Clock::SetClockForUnitTest(&clock);
+
+  ClockAdvancingDictionaryMock *dictionary =
+      new ClockAdvancingDictionaryMock(&clock);
+  AddWordsToMockDic(dictionary);
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      new MockDataAndPredictor);
+  data_and_predictor->Init(dictionary);
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+
+  // Both "h" and "r" may be mistyped.
+  const char kInputText[] = "gu-huru";
+  const uint32 kCorrectedKeyCodes[] = {'g', 'u', '-', 'g', 'u', 't', 'u'};
+  InsertInputSequenceForTypeCorrection(kInputText, kCorrectedKeyCodes);
+  std::vector<composer::TypeCorrectedQuery> queries;
+  composer_->GetTypeCorrectedQueriesForPrediction(&queries);
+  ASSERT_LT(1, queries.size());
+
+  Segments segments;
+  MakeSegmentsForPrediction(kInputText, &segments);
+
+  // Without budget, all the queries are looked up.
+  std::vector<TestableDictionaryPredictor::Result> results;
+  predictor->AggregateTypeCorrectingPrediction(
+      TestableDictionaryPredictor::TYPING_CORRECTION,
+      *convreq_, segments, &results);
+  EXPECT_EQ(queries.size(), dictionary->num_lookups());
+  EXPECT_EQ(0, predictor->typing_correction_budget_exceeded_count());
+
+  // With 1 msec budget, only the query of the lowest cost is looked up.
+  predictor->set_typing_correction_time_budget_msec(1);
+  dictionary->reset_num_lookups();
+  results.clear();
+  predictor->AggregateTypeCorrectingPrediction(
+      TestableDictionaryPredictor::TYPING_CORRECTION,
+      *convreq_, segments, &results);
+  EXPECT_EQ(1, dictionary->num_lookups());
+  EXPECT_EQ(1, predictor->typing_correction_budget_exceeded_count());
+
+  // Enough budget for all the queries.
+  predictor->set_typing_correction_time_budget_msec(queries.size() + 1);
+  dictionary->reset_num_lookups();
+  results.clear();
+  predictor->AggregateTypeCorrectingPrediction(
+      TestableDictionaryPredictor::TYPING_CORRECTION,
+      *convreq_, segments, &results);
+  EXPECT_EQ(queries.size(), dictionary->num_lookups());
+  EXPECT_EQ(1, predictor->typing_correction_budget_exceeded_count());
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
 TEST_F(DictionaryPredictorTest, ZeroQuerySuggestionAfterNumbers) {
   unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
@@ -3056,6 +3266,59 @@ TEST_F(DictionaryPredictorTest, MobileUnigramSuggestion) {
   EXPECT_LE(prefix_count, 6);
 }
 
+TEST_F(DictionaryPredictorTest, UnigramResultCache) {
+  testing::MockDataManager data_manager;
+
+  unique_ptr<MockDataAndPredictor> expected_data_and_predictor(
+      new MockDataAndPredictor());
+  expected_data_and_predictor->Init(
+      CreateSystemDictionaryFromDataManager(data_manager),
+      CreateSuffixDictionaryFromDataManager(data_manager));
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      new MockDataAndPredictor());
+  data_and_predictor->Init(CreateSystemDictionaryFromDataManager(data_manager),
+                           CreateSuffixDictionaryFromDataManager(data_manager));
+
+  const TestableDictionaryPredictor *expected_predictor =
+      expected_data_and_predictor->dictionary_predictor();
+  TestableDictionaryPredictor *predictor =
+      data_and_predictor->mutable_dictionary_predictor();
+  predictor->set_use_unigram_result_cache(true);
+
+  // The results are the same as the uncached lookup while the key grows,
+  // whether the cached lookup was truncated ("と") or not, and after the key
+  // is shortened or replaced.
+  const char *kKeys[] = {
+      "\xe3\x81\xa8",  // "と"
+      "\xe3\x81\xa8\xe3\x81\x86",  // "とう"
+      "\xe3\x81\xa8\xe3\x81\x86\xe3\x81\x8d",  // "とうき"
+      // "とうきょ"
+      "\xe3\x81\xa8\xe3\x81\x86\xe3\x81\x8d\xe3\x82\x87",
+      // "とうきょう"
+      "\xe3\x81\xa8\xe3\x81\x86\xe3\x81\x8d\xe3\x82\x87\xe3\x81\x86",
+      "\xe3\x81\xa8\xe3\x81\x86\xe3\x81\x8d",  // "とうき"
+      "\xe3\x81\x82\xe3\x81\xbc",  // "あぼ"
+      "\xe3\x81\x82\xe3\x81\xbc\xe3\x81\x8b",  // "あぼか"
+      // "あぼかど"
+      "\xe3\x81\x82\xe3\x81\xbc\xe3\x81\x8b\xe3\x81\xa9",
+  };
+  for (size_t i = 0; i < arraysize(kKeys); ++i) {
+    Segments segments;
+    MakeSegmentsForSuggestion(kKeys[i], &segments);
+    std::vector<TestableDictionaryPredictor::Result> expected, results;
+    expected_predictor->AggregateUnigramPrediction(
+        TestableDictionaryPredictor::UNIGRAM, *convreq_, segments, &expected);
+    predictor->AggregateUnigramPrediction(
+        TestableDictionaryPredictor::UNIGRAM, *convreq_, segments, &results);
+    ASSERT_EQ(expected.size(), results.size()) << kKeys[i];
+    for (size_t j = 0; j < results.size(); ++j) {
+      EXPECT_EQ(expected[j].key, results[j].key) << kKeys[i];
+      EXPECT_EQ(expected[j].value, results[j].value) << kKeys[i];
+      EXPECT_EQ(expected[j].wcost, results[j].wcost) << kKeys[i];
+    }
+  }
+}
+
 TEST_F(DictionaryPredictorTest, MobileZeroQuerySuggestion) {
   testing::MockDataManager data_manager;
 
@@ -3413,6 +3676,92 @@ TEST_F(DictionaryPredictorTest, PredictNCandidates) {
   }
 }
 
+TEST_F(DictionaryPredictorTest, PredictNCandidatesSkipsRemovedAndDuplicates) {
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  const TestableDictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+
+  // Every third result is removed and every value appears twice, where the
+  // second one costs more.
+  std::vector<TestableDictionaryPredictor::Result> results;
+  const int kTotalCandidateSize = 60;
+  for (size_t i = 0; i < kTotalCandidateSize; ++i) {
+    results.push_back(TestableDictionaryPredictor::MakeEmptyResult());
+    TestableDictionaryPredictor::Result *result = &results.back();
+    result->key = string(1, 'a' + i / 2);
+    result->value = string(1, 'A' + i / 2);
+    result->wcost = i;
+    result->cost = i + 1000;
+    result->SetTypesAndTokenAttributes(
+        (i % 3 == 0) ? TestableDictionaryPredictor::NO_PREDICTION
+                     : TestableDictionaryPredictor::REALTIME,
+        Token::NONE);
+  }
+  std::random_shuffle(results.begin(), results.end());
+
+  Segments segments;
+  MakeSegmentsForSuggestion("test", &segments);
+  const size_t kCandidateSize = 10;
+  segments.set_max_prediction_candidates_size(kCandidateSize);
+
+  predictor->AddPredictionToCandidates(*convreq_, &segments, &results);
+
+  std::vector<int> expected_costs;
+  std::set<size_t> seen;
+  for (size_t i = 0; expected_costs.size() < kCandidateSize; ++i) {
+    if (i % 3 != 0 && seen.insert(i / 2).second) {
+      expected_costs.push_back(i + 1000);
+    }
+  }
+  ASSERT_EQ(1, segments.conversion_segments_size());
+  const Segment &segment = segments.conversion_segment(0);
+  ASSERT_EQ(kCandidateSize, segment.candidates_size());
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    EXPECT_EQ(expected_costs[i], segment.candidate(i).cost);
+  }
+}
+
+TEST_F(DictionaryPredictorTest, PredictNCandidatesSkipsExistingCandidates) {
+  unique_ptr<MockDataAndPredictor> data_and_predictor(
+      CreateDictionaryPredictorWithMockData());
+  const TestableDictionaryPredictor *predictor =
+      data_and_predictor->dictionary_predictor();
+
+  std::vector<TestableDictionaryPredictor::Result> results;
+  const int kTotalCandidateSize = 10;
+  for (size_t i = 0; i < kTotalCandidateSize; ++i) {
+    results.push_back(TestableDictionaryPredictor::MakeEmptyResult());
+    TestableDictionaryPredictor::Result *result = &results.back();
+    result->key = string(1, 'a' + i);
+    result->value = string(1, 'A' + i);
+    result->wcost = i;
+    result->cost = i + 1000;
+    result->SetTypesAndTokenAttributes(TestableDictionaryPredictor::REALTIME,
+                                       Token::NONE);
+  }
+
+  // "A" and "C" are already suggested by the user history.
+  Segments segments;
+  MakeSegmentsForSuggestion("test", &segments);
+  Segment *segment = segments.mutable_conversion_segment(0);
+  for (const char *value : {"A", "C"}) {
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->Init();
+    candidate->key = candidate->value = value;
+  }
+  segments.set_max_prediction_candidates_size(3);
+
+  EXPECT_TRUE(
+      predictor->AddPredictionToCandidates(*convreq_, &segments, &results));
+  ASSERT_EQ(5, segment->candidates_size());
+  EXPECT_EQ("A", segment->candidate(0).value);
+  EXPECT_EQ("C", segment->candidate(1).value);
+  EXPECT_EQ("B", segment->candidate(2).value);
+  EXPECT_EQ("D", segment->candidate(3).value);
+  EXPECT_EQ("E", segment->candidate(4).value);
+}
+
 TEST_F(DictionaryPredictorTest, SuggestFilteredwordForExactMatchOnMobile) {
   unique_ptr<MockDataAndPredictor> data_and_predictor(
       CreateDictionaryPredictorWithMockData());
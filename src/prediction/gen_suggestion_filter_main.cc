@@ -30,6 +30,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/codegen_bytearray_stream.h"
 #include "base/file_stream.h"
@@ -37,6 +38,7 @@
 #include "base/hash.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "storage/existence_filter.h"
 
@@ -48,16 +50,49 @@ DEFINE_string(name, "SuggestionFilterData",
               "name for variable name in the header file");
 
 namespace {
+
+// The minimum number of words hashed by each thread.
+const size_t kMinWordsPerThread = 1 << 14;
+
+void HashRange(std::vector<string> *lines, size_t begin, size_t end,
+               uint64 *words) {
+  for (size_t i = begin; i < end; ++i) {
+    mozc::Util::LowerString(&(*lines)[i]);
+    words[i] = mozc::Hash::Fingerprint((*lines)[i]);
+  }
+}
+
+// Reads the words in one pass and hashes them on the threads of the shared
+// ThreadPool.
 void ReadWords(const string &name, std::vector<uint64> *words) {
+  std::vector<string> lines;
   string line;
   mozc::InputFileStream input(name.c_str());
   while (getline(input, line)) {
     if (line.empty() || line[0] == '#') {
       continue;
     }
-    string lower_value = line;
-    mozc::Util::LowerString(&lower_value);
-    words->push_back(mozc::Hash::Fingerprint(lower_value));
+    lines.push_back(line);
+  }
+
+  words->resize(lines.size());
+  mozc::ThreadPool *pool = mozc::ThreadPool::GetSharedInstance();
+  const size_t num_threads =
+      min(pool->num_threads(),
+          max(lines.size() / kMinWordsPerThread, static_cast<size_t>(1)));
+  std::vector<mozc::ThreadPool::TaskHandle> tasks;
+  for (size_t i = 1; i < num_threads; ++i) {
+    const size_t begin = lines.size() * i / num_threads;
+    const size_t end = lines.size() * (i + 1) / num_threads;
+    uint64 *data = words->data();
+    tasks.push_back(pool->Schedule(
+        mozc::ThreadPool::BACKGROUND, [&lines, begin, end, data]() {
+          HashRange(&lines, begin, end, data);
+        }));
+  }
+  HashRange(&lines, 0, lines.size() / num_threads, words->data());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Wait();
   }
 }
 
@@ -86,16 +121,15 @@ int main(int argc, char **argv) {
   static const float kErrorRate = 0.00001;
   const size_t num_bytes = max(
       ExistenceFilter::MinFilterSizeInBytesForErrorRate(
-          kErrorRate, words.size()),
+          kErrorRate, words.size(), ExistenceFilter::BLOCKED),
       kMinimumFilterBytes);
 
   LOG(INFO) << "num_bytes: " << num_bytes;
 
   std::unique_ptr<ExistenceFilter> filter(
-      ExistenceFilter::CreateOptimal(num_bytes, words.size()));
-  for (size_t i = 0; i < words.size(); ++i) {
-    filter->Insert(words[i]);
-  }
+      ExistenceFilter::CreateOptimal(num_bytes, words.size(),
+                                     ExistenceFilter::BLOCKED));
+  filter->InsertMany(words.data(), words.size());
 
   char *buf = NULL;
   size_t size = 0;
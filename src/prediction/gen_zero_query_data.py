@@ -296,6 +296,8 @@ def ParseOptions():
                     help='output token array file')
   parser.add_option('--output_string_array', dest='output_string_array',
                     help='output string array file')
+  parser.add_option('--output_hash_table', dest='output_hash_table',
+                    help='output perfect hash table file')
   return parser.parse_args()[0]
 
 
@@ -316,7 +318,8 @@ def main():
 
   util.WriteZeroQueryData(merged_zero_query_dict,
                           options.output_token_array,
-                          options.output_string_array)
+                          options.output_string_array,
+                          options.output_hash_table)
 
 
 if __name__ == '__main__':
@@ -66,6 +66,8 @@ def ParseOption():
                     help='Output token array file path')
   parser.add_option('--output_string_array', dest='output_string_array',
                     help='Output string array file path')
+  parser.add_option('--output_hash_table', dest='output_hash_table',
+                    help='Output perfect hash table file path')
   return parser.parse_args()[0]
 
 
@@ -75,7 +77,8 @@ def main():
     zero_query_dict = ReadZeroQueryNumberData(input_stream)
   util.WriteZeroQueryData(zero_query_dict,
                           options.output_token_array,
-                          options.output_string_array)
+                          options.output_string_array,
+                          options.output_hash_table)
 
 
 if __name__ == '__main__':
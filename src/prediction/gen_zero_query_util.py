@@ -65,8 +65,56 @@ class ZeroQueryEntry(object):
     self.emoji_android_pua = emoji_android_pua
 
 
+def _Hash(seed, key):
+  """Returns the hash value of |key|, the same as ZeroQueryDict::Hash()."""
+  h = 0x811c9dc5 ^ seed
+  for c in bytearray(key):
+    h = ((h ^ c) * 0x01000193) & 0xffffffff
+  h ^= h >> 16
+  h = (h * 0x85ebca6b) & 0xffffffff
+  h ^= h >> 13
+  h = (h * 0xc2b2ae35) & 0xffffffff
+  h ^= h >> 16
+  return h
+
+
+def BuildPerfectHash(keys):
+  """Builds a minimal perfect hash over distinct |keys|.
+
+  Keys are distributed to buckets of about four keys, and then a seed is
+  searched for each bucket, larger buckets first, so that its keys are hashed
+  to free slots.
+
+  Returns:
+    A tuple of the list of seeds for buckets and the list of key indices for
+    slots.
+  """
+  num_keys = len(keys)
+  num_buckets = max(1, (num_keys + 3) // 4)
+  buckets = [[] for _ in range(num_buckets)]
+  for i, key in enumerate(keys):
+    buckets[_Hash(0, key) % num_buckets].append(i)
+
+  seeds = [0] * num_buckets
+  slots = [None] * num_keys
+  for bucket in sorted(range(num_buckets), key=lambda b: -len(buckets[b])):
+    if not buckets[bucket]:
+      break
+    seed = 1
+    while True:
+      positions = [_Hash(seed, keys[i]) % num_keys for i in buckets[bucket]]
+      if (len(set(positions)) == len(positions) and
+          all(slots[p] is None for p in positions)):
+        break
+      seed += 1
+    seeds[bucket] = seed
+    for i, p in zip(buckets[bucket], positions):
+      slots[p] = i
+  return seeds, slots
+
+
 def WriteZeroQueryData(zero_query_dict, output_token_array,
-                       output_string_array):
+                       output_string_array, output_hash_table=None):
   # Collect all the strings and assing index in ascending order
   string_index = {}
   for key, entry_list in zero_query_dict.iteritems():
@@ -77,14 +125,52 @@ def WriteZeroQueryData(zero_query_dict, output_token_array,
   for i, s in enumerate(sorted_strings):
     string_index[s] = i
 
+  sorted_keys = sorted(zero_query_dict)
+  # The index of the first token for each key in |sorted_keys|.
+  first_token_indices = []
+  num_tokens = 0
   with open(output_token_array, 'wb') as f:
-    for key in sorted(zero_query_dict):
+    for key in sorted_keys:
+      first_token_indices.append(num_tokens)
       for entry in zero_query_dict[key]:
         f.write(struct.pack('<I', string_index[key]))
         f.write(struct.pack('<I', string_index[entry.value]))
         f.write(struct.pack('<H', entry.entry_type))
         f.write(struct.pack('<H', entry.emoji_type))
         f.write(struct.pack('<I', entry.emoji_android_pua))
+        num_tokens += 1
 
   serialized_string_array_builder.SerializeToFile(sorted_strings,
                                                   output_string_array)
+
+  if output_hash_table:
+    seeds, slots = BuildPerfectHash(sorted_keys)
+    with open(output_hash_table, 'wb') as f:
+      f.write(struct.pack('<I', len(seeds)))
+      f.write(struct.pack('<I', len(slots)))
+      for seed in seeds:
+        f.write(struct.pack('<I', seed))
+      for i in slots:
+        f.write(struct.pack('<I', first_token_indices[i]))
+
+
+def WriteHashIndex(row_keys, output_hash_index):
+  """Writes the hash index from each key to the first row of the key.
+
+  |row_keys| are the keys of the rows, in which the same keys are contiguous.
+  The output is in the format of SerializedDictionary::HashIndex.
+  """
+  distinct_keys = []
+  first_rows = []
+  for row, key in enumerate(row_keys):
+    if not distinct_keys or distinct_keys[-1] != key:
+      distinct_keys.append(key)
+      first_rows.append(row)
+  seeds, slots = BuildPerfectHash(distinct_keys)
+  with open(output_hash_index, 'wb') as f:
+    f.write(struct.pack('<I', len(seeds)))
+    f.write(struct.pack('<I', len(slots)))
+    for seed in seeds:
+      f.write(struct.pack('<I', seed))
+    for i in slots:
+      f.write(struct.pack('<I', first_rows[i]))
@@ -0,0 +1,264 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Replays the prefixes of sentences against the predictor of the engine and
+// reports the latency of the predictions.  The user history is warmed up by
+// committing some sentences beforehand.
+//
+// Usage:
+//   prediction_benchmark_main --input=data/test/stress_test/sentences.txt
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/file_stream.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/util.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "config/config_handler.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "engine/engine_factory.h"
+#include "engine/engine_interface.h"
+#include "engine/mock_data_engine_factory.h"
+#include "prediction/predictor_interface.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "session/request_test_util.h"
+
+DEFINE_string(input, "",
+              "file of the sentences in Hiragana, one per line.  Lines "
+              "starting with '#' are ignored");
+DEFINE_int32(warmup_size, 100,
+             "number of the sentences committed to warm up the user history");
+DEFINE_int32(max_sentences, 1000,
+             "maximum number of the sentences whose prefixes are replayed");
+DEFINE_string(request_type, "suggestion",
+              "request type: (suggestion, prediction)");
+DEFINE_bool(mobile, false, "use the request for mobile");
+DEFINE_string(user_profile_dir, "", "path to user profile directory");
+DEFINE_string(engine, "default", "engine: (default, test)");
+
+namespace mozc {
+namespace {
+
+// Records the time when the user history candidates are reported, from
+// which the time of the user history and the dictionary are separated.
+class TimingSink : public PredictionSinkInterface {
+ public:
+  explicit TimingSink(Stopwatch *stopwatch)
+      : stopwatch_(stopwatch), partial_usec_(-1.0) {}
+
+  void OnPartialPrediction(const Segments &segments) override {
+    partial_usec_ = stopwatch_->GetElapsedMicroseconds();
+  }
+
+  void Reset() { partial_usec_ = -1.0; }
+
+  // Returns a negative value if no partial prediction was reported.
+  double partial_usec() const { return partial_usec_; }
+
+ private:
+  Stopwatch *stopwatch_;
+  double partial_usec_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimingSink);
+};
+
+class LatencyStats {
+ public:
+  LatencyStats() = default;
+
+  void Add(double usec) { times_.push_back(usec); }
+
+  string ToString() {
+    if (times_.empty()) {
+      return "size=0";
+    }
+    std::sort(times_.begin(), times_.end());
+    double total = 0.0;
+    for (size_t i = 0; i < times_.size(); ++i) {
+      total += times_[i];
+    }
+    return Util::StringPrintf(
+        "size=%d avg=%.1f p50=%.1f p95=%.1f p99=%.1f max=%.1f (usec)",
+        static_cast<int>(times_.size()), total / times_.size(),
+        GetPercentile(50), GetPercentile(95), GetPercentile(99),
+        times_.back());
+  }
+
+ private:
+  // |times_| needs to be sorted.
+  double GetPercentile(int percent) const {
+    const size_t rank = (times_.size() * percent + 99) / 100;
+    return times_[rank == 0 ? 0 : rank - 1];
+  }
+
+  std::vector<double> times_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyStats);
+};
+
+void ReadSentences(const string &filename, size_t max_size,
+                   std::vector<string> *sentences) {
+  InputFileStream ifs(filename.c_str());
+  CHECK(ifs.good()) << "Cannot open " << filename;
+  string line;
+  while (sentences->size() < max_size && !getline(ifs, line).fail()) {
+    Util::ChopReturns(&line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    sentences->push_back(line);
+  }
+}
+
+// Converts and commits |sentences| so that the user history learns them.
+void WarmUpUserHistory(const ConverterInterface &converter,
+                       const commands::Request &request,
+                       const config::Config &config,
+                       const std::vector<string> &sentences) {
+  for (size_t i = 0; i < sentences.size(); ++i) {
+    composer::Table table;
+    composer::Composer composer(&table, &request, &config);
+    composer.InsertCharacterPreedit(sentences[i]);
+    const ConversionRequest conversion_request(&composer, &request, &config);
+    Segments segments;
+    if (!converter.StartConversionForRequest(conversion_request, &segments)) {
+      continue;
+    }
+    for (size_t j = 0; j < segments.conversion_segments_size(); ++j) {
+      converter.CommitSegmentValue(&segments, j, 0);
+    }
+    converter.FinishConversion(conversion_request, &segments);
+  }
+}
+
+void RunBenchmark(const PredictorInterface &predictor,
+                  const commands::Request &request,
+                  const config::Config &config,
+                  Segments::RequestType request_type,
+                  const std::vector<string> &sentences) {
+  LatencyStats total_stats, user_history_stats, dictionary_stats;
+  Stopwatch stopwatch;
+  TimingSink sink(&stopwatch);
+  for (size_t i = 0; i < sentences.size(); ++i) {
+    const size_t length = Util::CharsLen(sentences[i]);
+    for (size_t len = 1; len <= length; ++len) {
+      composer::Table table;
+      composer::Composer composer(&table, &request, &config);
+      composer.InsertCharacterPreedit(Util::SubString(sentences[i], 0, len));
+      string key;
+      composer.GetQueryForPrediction(&key);
+      const ConversionRequest conversion_request(&composer, &request, &config);
+      Segments segments;
+      segments.set_request_type(request_type);
+      segments.add_segment()->set_key(key);
+
+      sink.Reset();
+      stopwatch.Reset();
+      stopwatch.Start();
+      predictor.PredictForRequestWithSink(conversion_request, &segments,
+                                          &sink);
+      stopwatch.Stop();
+      const double total_usec = stopwatch.GetElapsedMicroseconds();
+      total_stats.Add(total_usec);
+      if (sink.partial_usec() >= 0.0) {
+        user_history_stats.Add(sink.partial_usec());
+        dictionary_stats.Add(total_usec - sink.partial_usec());
+      }
+    }
+  }
+
+  std::cout << "total: " << total_stats.ToString() << std::endl;
+  // The split is available only when the user history gave candidates.
+  std::cout << "user_history: " << user_history_stats.ToString() << std::endl;
+  std::cout << "dictionary: " << dictionary_stats.ToString() << std::endl;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  if (!FLAGS_user_profile_dir.empty()) {
+    mozc::SystemUtil::SetUserProfileDirectory(FLAGS_user_profile_dir);
+  }
+  CHECK(!FLAGS_input.empty()) << "--input is required";
+
+  std::unique_ptr<mozc::EngineInterface> engine;
+  if (FLAGS_engine == "default") {
+    engine.reset(mozc::EngineFactory::Create());
+  } else if (FLAGS_engine == "test") {
+    engine.reset(mozc::MockDataEngineFactory::Create());
+  }
+  CHECK(engine.get()) << "Invalid engine: " << FLAGS_engine;
+
+  mozc::Segments::RequestType request_type = mozc::Segments::SUGGESTION;
+  if (FLAGS_request_type == "prediction") {
+    request_type = mozc::Segments::PREDICTION;
+  } else {
+    CHECK_EQ("suggestion", FLAGS_request_type)
+        << "Invalid request type: " << FLAGS_request_type;
+  }
+
+  mozc::commands::Request request;
+  if (FLAGS_mobile) {
+    mozc::commands::RequestForUnitTest::FillMobileRequest(&request);
+  }
+  mozc::config::Config config;
+  mozc::config::ConfigHandler::GetDefaultConfig(&config);
+
+  std::vector<string> sentences;
+  mozc::ReadSentences(FLAGS_input, FLAGS_warmup_size + FLAGS_max_sentences,
+                      &sentences);
+  const size_t warmup_size =
+      std::min(sentences.size(), static_cast<size_t>(FLAGS_warmup_size));
+  const std::vector<string> warmup_sentences(sentences.begin(),
+                                             sentences.begin() + warmup_size);
+  const std::vector<string> test_sentences(sentences.begin() + warmup_size,
+                                           sentences.end());
+
+  mozc::WarmUpUserHistory(*engine->GetConverter(), request, config,
+                          warmup_sentences);
+  mozc::RunBenchmark(*engine->GetPredictor(), request, config, request_type,
+                     test_sentences);
+  return 0;
+}
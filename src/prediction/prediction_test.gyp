@@ -40,8 +40,10 @@
         'dictionary_predictor_test.cc',
         'user_history_predictor_test.cc',
         'predictor_test.cc',
+        'zero_query_dict_test.cc',
       ],
       'dependencies': [
+        '../base/base_test.gyp:clock_mock',
         '../composer/composer.gyp:composer',
         '../config/config.gyp:config_handler',
         '../converter/converter_base.gyp:connector',
@@ -118,10 +118,35 @@ bool BasePredictor::ClearHistoryEntry(const string &key, const string &value) {
   return user_history_predictor_->ClearHistoryEntry(key, value);
 }
 
+bool BasePredictor::PredictWithDictionaryPredictor(
+    const ConversionRequest &request, Segments *segments) const {
+  if (request.IsDeadlinePassed() && GetCandidatesSize(*segments) > 0) {
+    VLOG(1) << "Deadline passed. Skipping dictionary prediction";
+    segments->add_skipped_prediction_stage(
+        Segments::DICTIONARY_PREDICTION_STAGE);
+    return false;
+  }
+  return dictionary_predictor_->PredictForRequest(request, segments);
+}
+
+// static
+void BasePredictor::NotifyPartialPrediction(const Segments &segments,
+                                            PredictionSinkInterface *sink) {
+  if (sink != nullptr && GetCandidatesSize(segments) > 0) {
+    sink->OnPartialPrediction(segments);
+  }
+}
+
 bool BasePredictor::Wait() {
   return user_history_predictor_->Wait();
 }
 
+void BasePredictor::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  dictionary_predictor_->CollectMemoryUsage(usages);
+  user_history_predictor_->CollectMemoryUsage(usages);
+}
+
 bool BasePredictor::Sync() {
   return user_history_predictor_->Sync();
 }
@@ -147,6 +172,12 @@ DefaultPredictor::~DefaultPredictor() {}
 
 bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
                                          Segments *segments) const {
+  return PredictForRequestWithSink(request, segments, nullptr);
+}
+
+bool DefaultPredictor::PredictForRequestWithSink(
+    const ConversionRequest &request, Segments *segments,
+    PredictionSinkInterface *sink) const {
   DCHECK(segments->request_type() == Segments::PREDICTION ||
          segments->request_type() == Segments::SUGGESTION ||
          segments->request_type() == Segments::PARTIAL_PREDICTION ||
@@ -164,6 +195,7 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
 
   bool result = false;
   int remained_size = size;
+  segments->set_skipped_prediction_stages(0);
   segments->set_max_prediction_candidates_size(static_cast<size_t>(size));
   result |= user_history_predictor_->PredictForRequest(request, segments);
   remained_size = size - static_cast<size_t>(GetCandidatesSize(*segments));
@@ -173,9 +205,10 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
   if (remained_size <= 0) {
     return result;
   }
+  NotifyPartialPrediction(*segments, sink);
 
   segments->set_max_prediction_candidates_size(remained_size);
-  result |= dictionary_predictor_->PredictForRequest(request, segments);
+  result |= PredictWithDictionaryPredictor(request, segments);
   remained_size = size - static_cast<size_t>(GetCandidatesSize(*segments));
 
   // Do not call extra_predictor if the size of candidates get
@@ -204,6 +237,12 @@ MobilePredictor::~MobilePredictor() {}
 
 bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
                                         Segments *segments) const {
+  return PredictForRequestWithSink(request, segments, nullptr);
+}
+
+bool MobilePredictor::PredictForRequestWithSink(
+    const ConversionRequest &request, Segments *segments,
+    PredictionSinkInterface *sink) const {
   DCHECK(segments->request_type() == Segments::PREDICTION ||
          segments->request_type() == Segments::SUGGESTION ||
          segments->request_type() == Segments::PARTIAL_PREDICTION ||
@@ -218,6 +257,7 @@ bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
   bool result = false;
   size_t size = 0;
   size_t history_suggestion_size = IsZeroQuery(request) ? 3 : 2;
+  segments->set_skipped_prediction_stages(0);
 
   // TODO(taku,toshiyuki): Must rewrite the logic.
   switch (segments->request_type()) {
@@ -227,10 +267,11 @@ bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
       size = GetCandidatesSize(*segments) + history_suggestion_size;
       segments->set_max_prediction_candidates_size(size);
       result |= user_history_predictor_->PredictForRequest(request, segments);
+      NotifyPartialPrediction(*segments, sink);
 
       size = GetCandidatesSize(*segments) + 20;
       segments->set_max_prediction_candidates_size(size);
-      result |= dictionary_predictor_->PredictForRequest(request, segments);
+      result |= PredictWithDictionaryPredictor(request, segments);
 
       break;
     }
@@ -252,9 +293,10 @@ bool MobilePredictor::PredictForRequest(const ConversionRequest &request,
       size = GetCandidatesSize(*segments) + history_suggestion_size;
       segments->set_max_prediction_candidates_size(size);
       result |= user_history_predictor_->PredictForRequest(request, segments);
+      NotifyPartialPrediction(*segments, sink);
 
       segments->set_max_prediction_candidates_size(kMobilePredictionSize);
-      result |= dictionary_predictor_->PredictForRequest(request, segments);
+      result |= PredictWithDictionaryPredictor(request, segments);
       break;
     }
     default: {
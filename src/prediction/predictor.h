@@ -71,12 +71,25 @@ class BasePredictor : public PredictorInterface {
   // Waits for syncer to complete.
   bool Wait() override;
 
+  void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const override;
+
   // The following interfaces are implemented in derived classes.
   // const string &GetPredictorName() const = 0;
   // bool PredictForRequest(const ConversionRequest &request,
   //                        Segments *segments) const = 0;
 
  protected:
+  // Runs |dictionary_predictor_| unless the deadline of |request| has passed
+  // and the preceding predictors already gave some candidates, in which case
+  // DICTIONARY_PREDICTION_STAGE is reported as skipped in |segments|.
+  bool PredictWithDictionaryPredictor(const ConversionRequest &request,
+                                      Segments *segments) const;
+
+  // Reports the candidates in |segments| to |sink| if any.
+  static void NotifyPartialPrediction(const Segments &segments,
+                                      PredictionSinkInterface *sink);
+
   std::unique_ptr<PredictorInterface> dictionary_predictor_;
   std::unique_ptr<PredictorInterface> user_history_predictor_;
 };
@@ -95,6 +108,12 @@ class DefaultPredictor : public BasePredictor {
   bool PredictForRequest(const ConversionRequest &request,
                          Segments *segments) const override;
 
+  // Reports the candidates of the user history before running the dictionary
+  // predictor.
+  bool PredictForRequestWithSink(const ConversionRequest &request,
+                                 Segments *segments,
+                                 PredictionSinkInterface *sink) const override;
+
   const string &GetPredictorName() const override { return predictor_name_; }
 
  private:
@@ -115,6 +134,12 @@ class MobilePredictor : public BasePredictor {
   bool PredictForRequest(const ConversionRequest &request,
                          Segments *segments) const override;
 
+  // Reports the candidates of the user history before running the dictionary
+  // predictor.
+  bool PredictForRequestWithSink(const ConversionRequest &request,
+                                 Segments *segments,
+                                 PredictionSinkInterface *sink) const override;
+
   const string &GetPredictorName() const override { return predictor_name_; }
 
  private:
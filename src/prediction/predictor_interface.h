@@ -31,12 +31,30 @@
 #define MOZC_PREDICTION_PREDICTOR_INTERFACE_H_
 
 #include <string>
+#include <vector>
+
+#include "base/memory_stats.h"
 
 namespace mozc {
 
 class ConversionRequest;
 class Segments;
 
+// Receives the candidates of a prediction before the prediction finishes, so
+// that the first candidates can be shown while the slower predictors run.
+class PredictionSinkInterface {
+ public:
+  virtual ~PredictionSinkInterface() = default;
+
+  // Called each time a sub-predictor has added candidates to |segments|.  The
+  // candidates are partial and may be followed by more ones in the final
+  // result.
+  virtual void OnPartialPrediction(const Segments &segments) = 0;
+
+ protected:
+  PredictionSinkInterface() = default;
+};
+
 class PredictorInterface {
  public:
   virtual ~PredictorInterface() = default;
@@ -50,6 +68,15 @@ class PredictorInterface {
   virtual bool PredictForRequest(const ConversionRequest &request,
                                  Segments *segments) const = 0;
 
+  // Same as PredictForRequest() but also reports the candidates to |sink| as
+  // soon as each stage of the prediction gives them.  |sink| can be nullptr.
+  // The default implementation doesn't report partial predictions.
+  virtual bool PredictForRequestWithSink(const ConversionRequest &request,
+                                         Segments *segments,
+                                         PredictionSinkInterface *sink) const {
+    return PredictForRequest(request, segments);
+  }
+
   // Hook(s) for all mutable operations.
   virtual void Finish(const ConversionRequest &request, Segments *segments) {}
 
@@ -75,6 +102,10 @@ class PredictorInterface {
   // Waits for syncer thread to complete.
   virtual bool Wait() { return true; }
 
+  // Appends the memory used by the user history, etc. to |usages|.
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const {}
+
   virtual const string &GetPredictorName() const = 0;
 
  protected:
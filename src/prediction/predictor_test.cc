@@ -32,6 +32,7 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/singleton.h"
@@ -115,6 +116,44 @@ class NullPredictor : public PredictorInterface {
   const string predictor_name_;
 };
 
+// Adds one candidate to the conversion segment.
+class CandidateAddingPredictor : public PredictorInterface {
+ public:
+  CandidateAddingPredictor() : predictor_name_("CandidateAddingPredictor") {}
+
+  bool PredictForRequest(const ConversionRequest &request,
+                         Segments *segments) const override {
+    Segment::Candidate *candidate =
+        segments->mutable_conversion_segment(0)->add_candidate();
+    candidate->Init();
+    candidate->key = "key";
+    candidate->value = "value";
+    return true;
+  }
+
+  const string &GetPredictorName() const override {
+    return predictor_name_;
+  }
+
+ private:
+  const string predictor_name_;
+};
+
+// Records the number of candidates of each partial prediction.
+class RecordingSink : public PredictionSinkInterface {
+ public:
+  RecordingSink() = default;
+
+  void OnPartialPrediction(const Segments &segments) override {
+    sizes_.push_back(segments.conversion_segment(0).candidates_size());
+  }
+
+  const std::vector<size_t> &sizes() const { return sizes_; }
+
+ private:
+  std::vector<size_t> sizes_;
+};
+
 class MockPredictor : public PredictorInterface {
  public:
   MockPredictor() = default;
@@ -348,6 +387,58 @@ TEST_F(PredictorTest, CallPredictForRequet) {
   EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
 }
 
+TEST_F(PredictorTest, SkipDictionaryPredictorAfterDeadline) {
+  NullPredictor *dictionary_predictor = new NullPredictor(true);
+  unique_ptr<DefaultPredictor> predictor(new DefaultPredictor(
+      dictionary_predictor, new CandidateAddingPredictor));
+  Segments segments;
+  segments.set_request_type(Segments::SUGGESTION);
+  segments.add_segment();
+
+  // No deadline.
+  EXPECT_TRUE(predictor->PredictForRequest(*convreq_, &segments));
+  EXPECT_TRUE(dictionary_predictor->predict_called());
+  EXPECT_EQ(0, segments.skipped_prediction_stages());
+
+  // The deadline has already passed, and the user history predictor gave a
+  // candidate.
+  dictionary_predictor->Clear();
+  segments.mutable_conversion_segment(0)->clear_candidates();
+  ConversionRequest convreq;
+  convreq.CopyFrom(*convreq_);
+  convreq.set_deadline_ticks(1);
+  EXPECT_TRUE(predictor->PredictForRequest(convreq, &segments));
+  EXPECT_FALSE(dictionary_predictor->predict_called());
+  EXPECT_EQ(Segments::DICTIONARY_PREDICTION_STAGE,
+            segments.skipped_prediction_stages());
+}
+
+TEST_F(PredictorTest, ReportUserHistoryCandidatesToSink) {
+  NullPredictor *dictionary_predictor = new NullPredictor(true);
+  unique_ptr<DefaultPredictor> predictor(new DefaultPredictor(
+      dictionary_predictor, new CandidateAddingPredictor));
+  Segments segments;
+  segments.set_request_type(Segments::SUGGESTION);
+  segments.add_segment();
+
+  // The candidate of the user history is reported before the dictionary
+  // predictor runs.
+  RecordingSink sink;
+  EXPECT_TRUE(
+      predictor->PredictForRequestWithSink(*convreq_, &segments, &sink));
+  EXPECT_TRUE(dictionary_predictor->predict_called());
+  ASSERT_EQ(1, sink.sizes().size());
+  EXPECT_EQ(1, sink.sizes()[0]);
+
+  // Nothing is reported without candidates.
+  unique_ptr<MobilePredictor> mobile_predictor(new MobilePredictor(
+      new NullPredictor(true), new NullPredictor(true)));
+  segments.mutable_conversion_segment(0)->clear_candidates();
+  RecordingSink empty_sink;
+  EXPECT_TRUE(mobile_predictor->PredictForRequestWithSink(*convreq_, &segments,
+                                                          &empty_sink));
+  EXPECT_TRUE(empty_sink.sizes().empty());
+}
 
 TEST_F(PredictorTest, DisableAllSuggestion) {
   NullPredictor *predictor1 = new NullPredictor(true);
@@ -44,6 +44,10 @@ SuggestionFilter::SuggestionFilter(const char *data, size_t size) {
 
 SuggestionFilter::~SuggestionFilter() {}
 
+size_t SuggestionFilter::GetAllocatedBytes() const {
+  return filter_ ? filter_->Size() : 0;
+}
+
 bool SuggestionFilter::IsBadSuggestion(const string &text) const {
   if (filter_.get() == nullptr) {
     return false;
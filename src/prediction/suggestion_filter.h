@@ -48,6 +48,9 @@ class SuggestionFilter {
 
   bool IsBadSuggestion(const string &text) const;
 
+  // Returns the bytes of the filter, which is copied from the data.
+  size_t GetAllocatedBytes() const;
+
  private:
   std::unique_ptr<mozc::storage::ExistenceFilter> filter_;
 
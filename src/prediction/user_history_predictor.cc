@@ -32,16 +32,25 @@
 #include <algorithm>
 #include <cctype>
 #include <climits>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "base/clock.h"
 #include "base/config_file_stream.h"
+#include "base/file_util.h"
 #include "base/flags.h"
 #include "base/hash.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
-#include "base/thread.h"
+#include "base/memory_stats.h"
+#include "base/thread_pool.h"
+#include "base/trace.h"
 #include "base/trie.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -56,6 +65,7 @@
 #include "request/conversion_request.h"
 #include "rewriter/variants_rewriter.h"
 #include "storage/encrypted_string_storage.h"
+#include "storage/ephemeral_mode.h"
 #include "storage/lru_cache.h"
 #include "usage_stats/usage_stats.h"
 
@@ -80,10 +90,6 @@ namespace {
 // We don't check all history, since suggestion is called every key event
 const size_t kMaxSuggestionTrial = 3000;
 
-// Finds suffix matches of history_segments from the most recent 500 histories
-// in LRU.
-const size_t kMaxPrevValueTrial = 500;
-
 // Cache size
 // Typically memory/storage footprint becomes kLRUCacheSize * 70 bytes.
 #ifdef OS_ANDROID
@@ -105,6 +111,17 @@ const uint16 kRevertId = 1;
 // Default object pool size for EntryPriorityQueue
 const size_t kEntryPoolSize = 16;
 
+// Maximum number of journal records appended to the history file.  The whole
+// history is rewritten when the journal grows longer.
+const size_t kMaxJournalRecords = 100;
+
+// Maximum number of loaded entries moved to the cache per request.  The
+// history becomes available from the most recent entries while it's loaded.
+const size_t kMaxLoadedEntriesPerRequest = 1000;
+
+// Suffix of the journal file name
+const char kJournalFileSuffix[] = ".journal";
+
 // File name for the history
 #ifdef OS_WIN
 const char kFileName[] = "user://history.db";
@@ -183,6 +200,344 @@ string GetDescription(const Segment::Candidate &candidate) {
 
 }  // namespace
 
+// Maps strings to the fingerprints of the entries in |dic_|.  Since every
+// insertion to |dic_| moves the entry to the head of the LRU list, the
+// entries are ordered by the sequence number of their last insertion, so
+// that the lookup results are returned in the same order as the LRU list.
+class UserHistoryPredictor::PrefixIndex {
+ public:
+  // Sequence numbers start from the middle so that entries can be added as
+  // both the most and the least recently used ones.
+  PrefixIndex() : next_seq_(kFirstSeq), lowest_seq_(kFirstSeq) {}
+
+  // Registers |fp| with |str| as the most recently used entry.
+  void Add(uint32 fp, const string &str) {
+    AddWithSeq(fp, str, next_seq_++);
+  }
+
+  // Registers |fp| with |str| as the least recently used entry.
+  void AddAsLeastRecent(uint32 fp, const string &str) {
+    AddWithSeq(fp, str, --lowest_seq_);
+  }
+
+  void Remove(uint32 fp) {
+    const FpMap::iterator it = fp_to_item_.find(fp);
+    if (it == fp_to_item_.end()) {
+      return;
+    }
+    const StrMap::iterator str_it = str_to_fps_.find(it->second.first);
+    DCHECK(str_it != str_to_fps_.end());
+    str_it->second.erase(it->second.second);
+    if (str_it->second.empty()) {
+      str_to_fps_.erase(str_it);
+    }
+    fp_to_item_.erase(it);
+  }
+
+  void Clear() {
+    fp_to_item_.clear();
+    str_to_fps_.clear();
+  }
+
+  // Returns an estimate of the bytes of the maps, assuming a node of three
+  // pointers and a color for each item of the trees, and of one pointer for
+  // the hash table.
+  size_t GetAllocatedBytes() const {
+    const size_t kTreeNodeBytes = 4 * sizeof(void *);
+    size_t bytes = fp_to_item_.bucket_count() * sizeof(void *) +
+                   fp_to_item_.size() *
+                       (sizeof(FpMap::value_type) + sizeof(void *));
+    for (const auto &item : fp_to_item_) {
+      bytes += MemoryStats::GetHeapBytes(item.second.first);
+    }
+    for (const auto &str : str_to_fps_) {
+      bytes += sizeof(StrMap::value_type) + kTreeNodeBytes +
+               MemoryStats::GetHeapBytes(str.first) +
+               str.second.size() *
+                   (sizeof(SeqMap::value_type) + kTreeNodeBytes);
+    }
+    return bytes;
+  }
+
+  // Returns the fingerprints of the entries whose strings are non-empty
+  // prefixes of |str| or start with |str|, in the LRU order.
+  void LookupPrefixesAndPredictive(const string &str,
+                                   std::vector<uint32> *fps) const {
+    std::vector<std::pair<uint64, uint32>> found;
+    AppendPrefixes(str, false, &found);
+    for (StrMap::const_iterator it = str_to_fps_.lower_bound(str);
+         it != str_to_fps_.end() && Util::StartsWith(it->first, str); ++it) {
+      AppendItems(it->second, &found);
+    }
+    SortToFingerprints(&found, fps);
+  }
+
+  // Returns the fingerprints of the entries whose strings are non-empty
+  // prefixes of |str|, including |str| itself, in the LRU order.
+  void LookupPrefixes(const string &str, std::vector<uint32> *fps) const {
+    std::vector<std::pair<uint64, uint32>> found;
+    AppendPrefixes(str, true, &found);
+    SortToFingerprints(&found, fps);
+  }
+
+ private:
+  static const uint64 kFirstSeq = static_cast<uint64>(1) << 63;
+
+  // Sequence number -> fingerprint.
+  typedef std::map<uint64, uint32> SeqMap;
+  typedef std::map<string, SeqMap> StrMap;
+  // Fingerprint -> (string, sequence number).
+  typedef std::unordered_map<uint32, std::pair<string, uint64>> FpMap;
+
+  void AddWithSeq(uint32 fp, const string &str, uint64 seq) {
+    Remove(fp);
+    if (str.empty()) {
+      return;
+    }
+    fp_to_item_[fp] = std::make_pair(str, seq);
+    str_to_fps_[str][seq] = fp;
+  }
+
+  // Prefixes are compared by bytes as GetMatchType() does.
+  void AppendPrefixes(const string &str, bool include_str,
+                      std::vector<std::pair<uint64, uint32>> *found) const {
+    const size_t end = include_str ? str.size() + 1 : str.size();
+    for (size_t len = 1; len < end; ++len) {
+      const StrMap::const_iterator it = str_to_fps_.find(str.substr(0, len));
+      if (it != str_to_fps_.end()) {
+        AppendItems(it->second, found);
+      }
+    }
+  }
+
+  // The most recently used one comes first.
+  static void SortToFingerprints(std::vector<std::pair<uint64, uint32>> *found,
+                                 std::vector<uint32> *fps) {
+    std::sort(found->begin(), found->end(),
+              std::greater<std::pair<uint64, uint32>>());
+    fps->clear();
+    fps->reserve(found->size());
+    for (size_t i = 0; i < found->size(); ++i) {
+      fps->push_back((*found)[i].second);
+    }
+  }
+
+  static void AppendItems(const SeqMap &items,
+                          std::vector<std::pair<uint64, uint32>> *found) {
+    for (SeqMap::const_iterator it = items.begin(); it != items.end(); ++it) {
+      found->push_back(*it);
+    }
+  }
+
+  uint64 next_seq_;
+  uint64 lowest_seq_;
+  FpMap fp_to_item_;
+  StrMap str_to_fps_;
+
+  DISALLOW_COPY_AND_ASSIGN(PrefixIndex);
+};
+
+// Holds the entries in the order of addition.  Entry objects are made only
+// when the entries are moved to |dic_|, so that the history waiting to be
+// applied doesn't keep the per-object and per-string overhead of protobuf.
+// The presence of each optional field is also kept so that the entries are
+// restored as they were loaded.
+class UserHistoryPredictor::CompactEntryStore {
+ public:
+  CompactEntryStore() {}
+
+  void Reserve(size_t size) {
+    fps_.reserve(size);
+    string_ends_.reserve(size * kNumStrings);
+    suggestion_freqs_.reserve(size);
+    conversion_freqs_.reserve(size);
+    last_access_times_.reserve(size);
+    next_entry_ends_.reserve(size);
+    fields_.reserve(size);
+    entry_types_.reserve(size);
+  }
+
+  // Releases the capacity reserved for the further additions.
+  void ShrinkToFit() {
+    arena_.shrink_to_fit();
+    next_entry_fps_.shrink_to_fit();
+  }
+
+  void Add(uint32 fp, const Entry &entry) {
+    fps_.push_back(fp);
+    arena_.append(entry.key());
+    string_ends_.push_back(arena_.size());
+    arena_.append(entry.value());
+    string_ends_.push_back(arena_.size());
+    arena_.append(entry.description());
+    string_ends_.push_back(arena_.size());
+    suggestion_freqs_.push_back(entry.suggestion_freq());
+    conversion_freqs_.push_back(entry.conversion_freq());
+    last_access_times_.push_back(entry.last_access_time());
+    for (size_t i = 0; i < entry.next_entries_size(); ++i) {
+      next_entry_fps_.push_back(entry.next_entries(i).entry_fp());
+    }
+    next_entry_ends_.push_back(next_entry_fps_.size());
+    uint16 fields = 0;
+    SetField(entry.has_key(), HAS_KEY, &fields);
+    SetField(entry.has_value(), HAS_VALUE, &fields);
+    SetField(entry.has_description(), HAS_DESCRIPTION, &fields);
+    SetField(entry.has_suggestion_freq(), HAS_SUGGESTION_FREQ, &fields);
+    SetField(entry.has_conversion_freq(), HAS_CONVERSION_FREQ, &fields);
+    SetField(entry.has_last_access_time(), HAS_LAST_ACCESS_TIME, &fields);
+    SetField(entry.has_bigram_boost(), HAS_BIGRAM_BOOST, &fields);
+    SetField(entry.bigram_boost(), BIGRAM_BOOST, &fields);
+    SetField(entry.has_spelling_correction(), HAS_SPELLING_CORRECTION,
+             &fields);
+    SetField(entry.spelling_correction(), SPELLING_CORRECTION, &fields);
+    SetField(entry.has_removed(), HAS_REMOVED, &fields);
+    SetField(entry.removed(), REMOVED, &fields);
+    SetField(entry.has_entry_type(), HAS_ENTRY_TYPE, &fields);
+    fields_.push_back(fields);
+    entry_types_.push_back(static_cast<uint8>(entry.entry_type()));
+  }
+
+  size_t size() const { return fps_.size(); }
+
+  uint32 fp(size_t i) const { return fps_[i]; }
+
+  size_t GetAllocatedBytes() const {
+    return MemoryStats::GetHeapBytes(arena_) +
+           MemoryStats::GetHeapBytes(string_ends_) +
+           MemoryStats::GetHeapBytes(fps_) +
+           MemoryStats::GetHeapBytes(suggestion_freqs_) +
+           MemoryStats::GetHeapBytes(conversion_freqs_) +
+           MemoryStats::GetHeapBytes(last_access_times_) +
+           MemoryStats::GetHeapBytes(next_entry_ends_) +
+           MemoryStats::GetHeapBytes(next_entry_fps_) +
+           MemoryStats::GetHeapBytes(fields_) +
+           MemoryStats::GetHeapBytes(entry_types_);
+  }
+
+  // Restores the |i|-th entry to |entry|, which needs to be empty.
+  void GetEntry(size_t i, Entry *entry) const {
+    DCHECK_LT(i, size());
+    const uint16 fields = fields_[i];
+    if (fields & HAS_KEY) {
+      entry->set_key(GetString(i, 0));
+    }
+    if (fields & HAS_VALUE) {
+      entry->set_value(GetString(i, 1));
+    }
+    if (fields & HAS_DESCRIPTION) {
+      entry->set_description(GetString(i, 2));
+    }
+    if (fields & HAS_SUGGESTION_FREQ) {
+      entry->set_suggestion_freq(suggestion_freqs_[i]);
+    }
+    if (fields & HAS_CONVERSION_FREQ) {
+      entry->set_conversion_freq(conversion_freqs_[i]);
+    }
+    if (fields & HAS_LAST_ACCESS_TIME) {
+      entry->set_last_access_time(last_access_times_[i]);
+    }
+    const size_t next_begin = i == 0 ? 0 : next_entry_ends_[i - 1];
+    for (size_t j = next_begin; j < next_entry_ends_[i]; ++j) {
+      entry->add_next_entries()->set_entry_fp(next_entry_fps_[j]);
+    }
+    if (fields & HAS_BIGRAM_BOOST) {
+      entry->set_bigram_boost((fields & BIGRAM_BOOST) != 0);
+    }
+    if (fields & HAS_SPELLING_CORRECTION) {
+      entry->set_spelling_correction((fields & SPELLING_CORRECTION) != 0);
+    }
+    if (fields & HAS_REMOVED) {
+      entry->set_removed((fields & REMOVED) != 0);
+    }
+    if (fields & HAS_ENTRY_TYPE) {
+      entry->set_entry_type(static_cast<Entry::EntryType>(entry_types_[i]));
+    }
+  }
+
+ private:
+  // Key, value and description.
+  static const size_t kNumStrings = 3;
+
+  enum Field {
+    HAS_KEY = 1 << 0,
+    HAS_VALUE = 1 << 1,
+    HAS_DESCRIPTION = 1 << 2,
+    HAS_SUGGESTION_FREQ = 1 << 3,
+    HAS_CONVERSION_FREQ = 1 << 4,
+    HAS_LAST_ACCESS_TIME = 1 << 5,
+    HAS_BIGRAM_BOOST = 1 << 6,
+    BIGRAM_BOOST = 1 << 7,
+    HAS_SPELLING_CORRECTION = 1 << 8,
+    SPELLING_CORRECTION = 1 << 9,
+    HAS_REMOVED = 1 << 10,
+    REMOVED = 1 << 11,
+    HAS_ENTRY_TYPE = 1 << 12,
+  };
+
+  static void SetField(bool value, Field field, uint16 *fields) {
+    if (value) {
+      *fields |= field;
+    }
+  }
+
+  string GetString(size_t i, size_t n) const {
+    const size_t pos = i * kNumStrings + n;
+    const size_t begin = pos == 0 ? 0 : string_ends_[pos - 1];
+    return arena_.substr(begin, string_ends_[pos] - begin);
+  }
+
+  // Strings of all the entries.  |string_ends_| holds the end offsets of the
+  // strings of each entry, and the next string begins there.
+  string arena_;
+  std::vector<uint32> string_ends_;
+  std::vector<uint32> fps_;
+  std::vector<uint32> suggestion_freqs_;
+  std::vector<uint32> conversion_freqs_;
+  std::vector<uint64> last_access_times_;
+  // |next_entry_ends_| holds the end offsets in |next_entry_fps_| in the same
+  // way as |string_ends_|.
+  std::vector<uint32> next_entry_ends_;
+  std::vector<uint32> next_entry_fps_;
+  // Bits of Field.
+  std::vector<uint16> fields_;
+  std::vector<uint8> entry_types_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactEntryStore);
+};
+
+UserHistoryPredictor::DicElement *UserHistoryPredictor::InsertToDic(
+    uint32 fp, const string &key, const string &value) {
+  // LRUCache::Insert() silently evicts the tail when the cache is full.
+  const DicElement *tail = dic_->Tail();
+  const uint32 tail_fp = tail == nullptr ? 0 : tail->key;
+  DicElement *e = dic_->Insert(fp);
+  if (tail != nullptr && tail_fp != fp && !dic_->HasKey(tail_fp)) {
+    key_index_->Remove(tail_fp);
+    value_index_->Remove(tail_fp);
+  }
+  if (e != nullptr) {
+    key_index_->Add(fp, key);
+    value_index_->Add(fp, string(value.rbegin(), value.rend()));
+  }
+  return e;
+}
+
+bool UserHistoryPredictor::EraseFromDic(uint32 fp) {
+  key_index_->Remove(fp);
+  value_index_->Remove(fp);
+  return dic_->Erase(fp);
+}
+
+void UserHistoryPredictor::ResetDic() {
+  // Renews DicCache as LRUCache tries to reuse the internal value by
+  // using FreeList
+  dic_.reset(new DicCache(max_cache_size_));
+  key_index_->Clear();
+  value_index_->Clear();
+  next_loaded_index_ = 0;
+  loaded_entries_.reset();
+}
+
 // Returns true if the input first candidate seems to be a privacy sensitive
 // such like password.
 bool UserHistoryPredictor::IsPrivacySensitive(const Segments *segments) const {
@@ -286,17 +641,24 @@ bool UserHistoryPredictor::IsPrivacySensitive(const Segments *segments) const {
 }
 
 UserHistoryStorage::UserHistoryStorage(const string &filename)
-    : storage_(new storage::EncryptedStringStorage(filename)) {
+    : journal_filename_(filename + kJournalFileSuffix),
+      storage_(new storage::EncryptedStringStorage(filename)),
+      journal_storage_(
+          new storage::EncryptedStringStorage(journal_filename_)) {
 }
 
 UserHistoryStorage::~UserHistoryStorage() {}
 
 bool UserHistoryStorage::Load() {
+  IOStats::ScopedOperation operation(IOStats::USER_HISTORY_STORAGE,
+                                     IOStats::READ);
   string input;
   if (!storage_->Load(&input)) {
     LOG(ERROR) << "Can't load user history data.";
     return false;
   }
+  size_t num_bytes = input.size();
+  operation.set_bytes(num_bytes);
 
   if (!ParseFromString(input)) {
     LOG(ERROR) << "ParseFromString failed. message looks broken";
@@ -304,6 +666,30 @@ bool UserHistoryStorage::Load() {
   }
 
   VLOG(1) << "Loaded user histroy, size=" << entries_size();
+
+  journal_records_.clear();
+  std::vector<string> records;
+  if (!JournalExists() || !journal_storage_->LoadRecords(&records)) {
+    return true;
+  }
+  for (size_t i = 0; i < records.size(); ++i) {
+    num_bytes += records[i].size();
+  }
+  operation.set_bytes(num_bytes);
+  for (size_t i = 0; i < records.size(); ++i) {
+    user_history_predictor::UserHistoryJournalRecord record;
+    if (!record.ParseFromString(records[i])) {
+      LOG(WARNING) << "Journal record looks broken. Ignored the rest";
+      break;
+    }
+    // Records for another snapshot are left by a crash between writing the
+    // snapshot and removing the old journal.
+    if (record.snapshot_id() != snapshot_id()) {
+      continue;
+    }
+    journal_records_.push_back(record);
+  }
+  VLOG(1) << "Loaded user history journal, size=" << journal_records_.size();
   return true;
 }
 
@@ -313,17 +699,56 @@ bool UserHistoryStorage::Save() const {
     return false;
   }
 
+  IOStats::ScopedOperation operation(IOStats::USER_HISTORY_STORAGE,
+                                     IOStats::WRITE);
   string output;
   if (!AppendToString(&output)) {
     LOG(ERROR) << "AppendToString failed";
     return false;
   }
+  operation.set_bytes(output.size());
 
   if (!storage_->Save(output)) {
     LOG(ERROR) << "Can't save user history data.";
     return false;
   }
 
+  if (!JournalExists()) {
+    return true;
+  }
+  if (storage::EphemeralMode::IsEnabled()) {
+    storage::EphemeralMode::RemoveFile(journal_filename_);
+  } else if (!FileUtil::Unlink(journal_filename_)) {
+    // The records left in the journal are ignored by Load() as they have a
+    // different snapshot id.
+    LOG(WARNING) << "Can't remove the journal: " << journal_filename_;
+  }
+
+  return true;
+}
+
+bool UserHistoryStorage::JournalExists() const {
+  return storage::EphemeralMode::IsEnabled() ?
+      storage::EphemeralMode::FileExists(journal_filename_) :
+      FileUtil::FileExists(journal_filename_);
+}
+
+bool UserHistoryStorage::AppendToJournal(
+    const user_history_predictor::UserHistoryJournalRecord &record) const {
+  IOStats::ScopedOperation operation(IOStats::USER_HISTORY_STORAGE,
+                                     IOStats::WRITE);
+  string output;
+  if (!record.AppendToString(&output)) {
+    LOG(ERROR) << "AppendToString failed";
+    return false;
+  }
+  operation.set_bytes(output.size());
+
+  if (!journal_storage_->Append(output)) {
+    LOG(ERROR) << "Can't append to user history journal.";
+    return false;
+  }
+
   return true;
 }
 
@@ -360,54 +785,35 @@ UserHistoryPredictor::EntryPriorityQueue::NewEntry() {
   return pool_.Alloc();
 }
 
-class UserHistoryPredictorSyncer : public Thread {
- public:
-  enum RequestType {
-    LOAD,
-    SAVE
-  };
-
-  UserHistoryPredictorSyncer(UserHistoryPredictor *predictor,
-                             RequestType type)
-      : predictor_(predictor), type_(type) {
-    DCHECK(predictor_);
-  }
-
-  virtual void Run() {
-    switch (type_) {
-      case LOAD:
-        VLOG(1) << "Executing Reload method";
-        predictor_->Load();
-        break;
-      case SAVE:
-        VLOG(1) << "Executing Sync method";
-        predictor_->Save();
-        break;
-      default:
-        LOG(ERROR) << "Unknown request: " << static_cast<int>(type_);
-    }
-  }
-
-  virtual ~UserHistoryPredictorSyncer() {
-    Join();
-  }
-
-  UserHistoryPredictor *predictor_;
-  RequestType type_;
-};
-
 UserHistoryPredictor::UserHistoryPredictor(
     const DictionaryInterface *dictionary,
     const POSMatcher *pos_matcher,
     const SuppressionDictionary *suppression_dictionary,
     bool enable_content_word_learning)
+    : UserHistoryPredictor(dictionary, pos_matcher, suppression_dictionary,
+                           enable_content_word_learning,
+                           UserHistoryPredictor::cache_size()) {}
+
+UserHistoryPredictor::UserHistoryPredictor(
+    const DictionaryInterface *dictionary,
+    const POSMatcher *pos_matcher,
+    const SuppressionDictionary *suppression_dictionary,
+    bool enable_content_word_learning,
+    uint32 cache_size)
     : dictionary_(dictionary),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
       predictor_name_("UserHistoryPredictor"),
       content_word_learning_enabled_(enable_content_word_learning),
+      max_cache_size_(cache_size),
       updated_(false),
-      dic_(new DicCache(UserHistoryPredictor::cache_size())) {
+      dic_(new DicCache(max_cache_size_)),
+      full_save_required_(true),
+      saved_snapshot_id_(0),
+      num_journal_records_(0),
+      key_index_(new PrefixIndex),
+      value_index_(new PrefixIndex),
+      next_loaded_index_(0) {
   AsyncLoad();  // non-blocking
   // Load()  blocking version can be used if any
 }
@@ -429,8 +835,8 @@ uint16 UserHistoryPredictor::revert_id() {
 }
 
 void UserHistoryPredictor::WaitForSyncer() {
-  if (syncer_.get() != nullptr) {
-    syncer_->Join();
+  if (syncer_ != nullptr) {
+    syncer_->Wait();
     syncer_.reset();
   }
 }
@@ -440,9 +846,36 @@ bool UserHistoryPredictor::Wait() {
   return true;
 }
 
+void UserHistoryPredictor::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  DCHECK(usages);
+  // The entries are modified by the running Load().
+  if (!CheckSyncerAndDelete()) {
+    return;
+  }
+  // The Entry objects are in the elements of |dic_|, so only the memory owned
+  // by them is added.
+  size_t bytes = dic_->GetAllocatedBytes() +
+                 key_index_->GetAllocatedBytes() +
+                 value_index_->GetAllocatedBytes() +
+                 MemoryStats::GetHeapBytes(saved_order_) +
+                 saved_entry_hashes_.bucket_count() * sizeof(void *) +
+                 saved_entry_hashes_.size() *
+                     (sizeof(std::pair<uint32, uint64>) + sizeof(void *));
+  for (const DicElement *elm = dic_->Head(); elm != nullptr;
+       elm = elm->next) {
+    bytes += elm->value.SpaceUsed() - sizeof(Entry);
+  }
+  if (loaded_entries_ != nullptr) {
+    bytes += loaded_entries_->GetAllocatedBytes();
+  }
+  usages->push_back(
+      MemoryStats::HeapUsage("user_history", bytes, dic_->Size()));
+}
+
 bool UserHistoryPredictor::CheckSyncerAndDelete() const {
-  if (syncer_.get() != nullptr) {
-    if (syncer_->IsRunning()) {
+  if (syncer_ != nullptr) {
+    if (!syncer_->IsDone()) {
       return false;
     } else {
       syncer_.reset();
@@ -467,10 +900,11 @@ bool UserHistoryPredictor::AsyncLoad() {
     return true;
   }
 
-  syncer_.reset(new UserHistoryPredictorSyncer(
-      this,
-      UserHistoryPredictorSyncer::LOAD));
-  syncer_->Start("UserHistoryPredictor:Load");
+  syncer_ = ThreadPool::GetSharedInstance()->Schedule(
+      ThreadPool::BACKGROUND, [this]() {
+        VLOG(1) << "Executing Reload method";
+        Load();
+      });
 
   return true;
 }
@@ -484,10 +918,11 @@ bool UserHistoryPredictor::AsyncSave() {
     return true;
   }
 
-  syncer_.reset(new UserHistoryPredictorSyncer(
-      this,
-      UserHistoryPredictorSyncer::SAVE));
-  syncer_->Start("UserHistoryPredictor:Save");
+  syncer_ = ThreadPool::GetSharedInstance()->Schedule(
+      ThreadPool::BACKGROUND, [this]() {
+        VLOG(1) << "Executing Sync method";
+        Save();
+      });
 
   return true;
 }
@@ -501,16 +936,134 @@ bool UserHistoryPredictor::Load() {
     return false;
   }
 
+  // Replays the snapshot and the journal off |dic_| so that predictions don't
+  // wait for the whole history.  The entries are moved to |dic_| later by
+  // ApplyLoadedEntries(), from the most recently used one.
+  std::unique_ptr<DicCache> loaded_dic(
+      new DicCache(max_cache_size_));
   for (size_t i = 0; i < history.entries_size(); ++i) {
-    dic_->Insert(EntryFingerprint(history.entries(i)),
-                 history.entries(i));
+    const Entry &entry = history.entries(i);
+    loaded_dic->Insert(EntryFingerprint(entry), entry);
   }
+  for (size_t i = 0; i < history.journal_records().size(); ++i) {
+    ApplyJournalRecord(history.journal_records()[i], loaded_dic.get());
+  }
+
+  VLOG(1) << "Loaded user histroy, size=" << history.entries_size()
+          << ", journal size=" << history.journal_records().size();
 
-  VLOG(1) << "Loaded user histroy, size=" << history.entries_size();
+  saved_snapshot_id_ = history.snapshot_id();
+  num_journal_records_ = history.journal_records().size();
+  UpdateSavedState(*loaded_dic);
+  full_save_required_ = false;
+
+  std::unique_ptr<CompactEntryStore> loaded_entries(new CompactEntryStore);
+  loaded_entries->Reserve(loaded_dic->Size());
+  for (const DicElement *elm = loaded_dic->Head(); elm != nullptr;
+       elm = elm->next) {
+    loaded_entries->Add(elm->key, elm->value);
+  }
+  loaded_entries->ShrinkToFit();
+  loaded_entries_ = std::move(loaded_entries);
+  next_loaded_index_ = 0;
 
   return true;
 }
 
+// static
+void UserHistoryPredictor::ApplyJournalRecord(
+    const user_history_predictor::UserHistoryJournalRecord &record,
+    DicCache *dic) {
+  for (size_t i = 0; i < record.erased_entry_fps_size(); ++i) {
+    dic->Erase(record.erased_entry_fps(i));
+  }
+  for (size_t i = 0; i < record.updated_entries_size(); ++i) {
+    const Entry &entry = record.updated_entries(i);
+    Entry *e = dic->MutableLookupWithoutInsert(EntryFingerprint(entry));
+    if (e != nullptr) {
+      e->CopyFrom(entry);
+    } else {
+      dic->Insert(EntryFingerprint(entry), entry);
+    }
+  }
+  for (size_t i = 0; i < record.inserted_entries_size(); ++i) {
+    const Entry &entry = record.inserted_entries(i);
+    dic->Insert(EntryFingerprint(entry), entry);
+  }
+}
+
+void UserHistoryPredictor::ApplyLoadedEntries(size_t max_size) const {
+  if (loaded_entries_ == nullptr) {
+    return;
+  }
+  // The loaded entries are older than the ones learned after loading, so
+  // they are added to the tail in the order of the LRU.  Entries already in
+  // |dic_| have been updated since then.
+  size_t size = 0;
+  for (; next_loaded_index_ < loaded_entries_->size() && size < max_size;
+       ++next_loaded_index_, ++size) {
+    DicElement *e = dic_->InsertAtTail(
+        loaded_entries_->fp(next_loaded_index_));
+    if (e == nullptr) {
+      continue;
+    }
+    Entry *entry = &e->value;
+    entry->Clear();
+    loaded_entries_->GetEntry(next_loaded_index_, entry);
+    key_index_->AddAsLeastRecent(e->key, entry->key());
+    value_index_->AddAsLeastRecent(
+        e->key, string(entry->value().rbegin(), entry->value().rend()));
+  }
+  if (next_loaded_index_ == loaded_entries_->size()) {
+    loaded_entries_.reset();
+  }
+}
+
+void UserHistoryPredictor::UpdateSavedState(const DicCache &dic) {
+  saved_order_.clear();
+  saved_entry_hashes_.clear();
+  for (const DicElement *elm = dic.Tail(); elm != nullptr; elm = elm->prev) {
+    saved_order_.push_back(elm->key);
+    saved_entry_hashes_[elm->key] =
+        Hash::Fingerprint(elm->value.SerializeAsString());
+  }
+}
+
+void UserHistoryPredictor::MakeJournalRecord(
+    user_history_predictor::UserHistoryJournalRecord *record) const {
+  // Entries saved before but not in |dic_| anymore are erased.
+  std::unordered_map<uint32, size_t> saved_positions;
+  for (size_t i = 0; i < saved_order_.size(); ++i) {
+    if (dic_->LookupWithoutInsert(saved_order_[i]) == nullptr) {
+      record->add_erased_entry_fps(saved_order_[i]);
+    } else {
+      saved_positions[saved_order_[i]] = i;
+    }
+  }
+
+  // The longest run of the entries from the tail that keep the saved order
+  // stays where they are.  The rest is moved to the head in order.
+  const DicElement *elm = dic_->Tail();
+  size_t last_position = 0;
+  for (; elm != nullptr; elm = elm->prev) {
+    const auto it = saved_positions.find(elm->key);
+    if (it == saved_positions.end() || it->second < last_position) {
+      break;
+    }
+    last_position = it->second;
+    const auto hash_it = saved_entry_hashes_.find(elm->key);
+    DCHECK(hash_it != saved_entry_hashes_.end());
+    if (hash_it->second != Hash::Fingerprint(elm->value.SerializeAsString())) {
+      record->add_updated_entries()->CopyFrom(elm->value);
+    }
+  }
+  for (; elm != nullptr; elm = elm->prev) {
+    record->add_inserted_entries()->CopyFrom(elm->value);
+  }
+
+  record->set_snapshot_id(saved_snapshot_id_);
+}
+
 bool UserHistoryPredictor::Save() {
   if (!updated_) {
     return true;
@@ -519,6 +1072,8 @@ bool UserHistoryPredictor::Save() {
   // Do not check incognito_mode or use_history_suggest in Config here.
   // The input data should not have been inserted when those flags are on.
 
+  ApplyLoadedEntries(max_cache_size_);
+
   const DicElement *tail = dic_->Tail();
   if (tail == nullptr) {
     return true;
@@ -527,20 +1082,41 @@ bool UserHistoryPredictor::Save() {
   const string filename = GetUserHistoryFileName();
 
   UserHistoryStorage history(filename);
-  for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
-    history.add_entries()->CopyFrom(elm->value);
-  }
 
   // Updates usage stats here.
   UsageStats::SetInteger(
       "UserHistoryPredictorEntrySize",
-      static_cast<int>(history.entries_size()));
+      static_cast<int>(dic_->Size()));
+
+  if (!full_save_required_ && num_journal_records_ < kMaxJournalRecords) {
+    user_history_predictor::UserHistoryJournalRecord record;
+    MakeJournalRecord(&record);
+    if (history.AppendToJournal(record)) {
+      ++num_journal_records_;
+      UpdateSavedState(*dic_);
+      updated_ = false;
+      return true;
+    }
+    LOG(WARNING) << "Can't append to the journal. Rewriting the history";
+  }
+
+  for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
+    history.add_entries()->CopyFrom(elm->value);
+  }
+  uint64 snapshot_id = 0;
+  Util::GetRandomSequence(reinterpret_cast<char *>(&snapshot_id),
+                          sizeof(snapshot_id));
+  history.set_snapshot_id(snapshot_id);
 
   if (!history.Save()) {
     LOG(ERROR) << "UserHistoryStorage::Save() failed";
     return false;
   }
 
+  saved_snapshot_id_ = snapshot_id;
+  num_journal_records_ = 0;
+  UpdateSavedState(*dic_);
+  full_save_required_ = false;
   updated_ = false;
 
   return true;
@@ -551,9 +1127,10 @@ bool UserHistoryPredictor::ClearAllHistory() {
   WaitForSyncer();
 
   VLOG(1) << "Clearing user prediction";
-  // Renews DicCache as LRUCache tries to reuse the internal value by
-  // using FreeList
-  dic_.reset(new DicCache(UserHistoryPredictor::cache_size()));
+  ResetDic();
+  // Rewrites the whole history so that the cleared entries don't remain in
+  // the journal.
+  full_save_required_ = true;
 
   // insert a dummy event entry.
   InsertEvent(Entry::CLEAN_ALL_EVENT);
@@ -570,6 +1147,7 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
   WaitForSyncer();
 
   VLOG(1) << "Clearing unused prediction";
+  ApplyLoadedEntries(max_cache_size_);
   const DicElement *head = dic_->Head();
   if (head == nullptr) {
     VLOG(2) << "dic head is nullptr";
@@ -586,13 +1164,14 @@ bool UserHistoryPredictor::ClearUnusedHistory() {
 
   for (size_t i = 0; i < keys.size(); ++i) {
     VLOG(2) << "Removing: " << keys[i];
-    if (!dic_->Erase(keys[i])) {
+    if (!EraseFromDic(keys[i])) {
       LOG(ERROR) << "cannot erase " << keys[i];
     }
   }
 
   // Inserts a dummy event entry.
   InsertEvent(Entry::CLEAN_UNUSED_EVENT);
+  full_save_required_ = true;
 
   updated_ = true;
 
@@ -707,6 +1286,7 @@ UserHistoryPredictor::RemoveNgramChain(const string &target_key,
 
 bool UserHistoryPredictor::ClearHistoryEntry(const string &key,
                                              const string &value) {
+  ApplyLoadedEntries(max_cache_size_);
   bool deleted = false;
   {
     // Finds the history entry that has the exactly same key and value and has
@@ -741,6 +1321,9 @@ bool UserHistoryPredictor::ClearHistoryEntry(const string &key,
   }
   if (deleted) {
     updated_ = true;
+    // Rewrites the whole history so that the removed entry doesn't remain in
+    // the journal.
+    full_save_required_ = true;
   }
   return deleted;
 }
@@ -1187,10 +1770,12 @@ bool UserHistoryPredictor::Predict(Segments *segments) const {
 
 bool UserHistoryPredictor::PredictForRequest(const ConversionRequest &request,
                                              Segments *segments) const {
+  MOZC_TRACE_SPAN("UserHistoryPredictor::PredictForRequest");
   if (!CheckSyncerAndDelete()) {
     LOG(WARNING) << "Syncer is running";
     return false;
   }
+  ApplyLoadedEntries(kMaxLoadedEntriesPerRequest);
 
   if (request.config().incognito_mode()) {
     VLOG(2) << "incognito mode";
@@ -1268,15 +1853,21 @@ const UserHistoryPredictor::Entry *UserHistoryPredictor::LookupPrevEntry(
   prev_entry = dic_->LookupWithoutInsert(SegmentFingerprint(history_segment));
 
   // When |prev_entry| is nullptr or |prev_entry| has no valid next_entries,
-  // do linear-search over the LRU.
+  // search the entries whose values are suffixes of the previous value in
+  // the LRU order.
   if ((prev_entry == nullptr && history_segment.candidates_size() > 0) ||
       (prev_entry != nullptr && prev_entry->next_entries_size() == 0)) {
     const string &prev_value = prev_entry == nullptr ?
         history_segment.candidate(0).value : prev_entry->value();
-    int trial = 0;
-    for (const DicElement *elm = dic_->Head();
-         trial++ < kMaxPrevValueTrial && elm != nullptr; elm = elm->next) {
-      const Entry *entry = &(elm->value);
+    const string reversed_prev_value(prev_value.rbegin(), prev_value.rend());
+    std::vector<uint32> fps;
+    value_index_->LookupPrefixes(reversed_prev_value, &fps);
+    for (size_t i = 0; i < fps.size(); ++i) {
+      const Entry *entry = dic_->LookupWithoutInsert(fps[i]);
+      DCHECK(entry);
+      if (entry == nullptr) {
+        continue;
+      }
       // entry->value() equals to the prev_value or
       // entry->value() is a SUFFIX of prev_value.
       // length of entry->value() must be >= 2, as single-length
@@ -1331,6 +1922,33 @@ void UserHistoryPredictor::GetResultsFromHistoryDictionary(
   unique_ptr<Trie<string>> expanded;
   GetInputKeyFromSegments(request, segments, &input_key, &base_key, &expanded);
 
+  // Only the entries whose keys are prefixes of |base_key| or start with it
+  // can match, so they are taken from the key index in the LRU order.  The
+  // zero query suggestion and the fuzzy matching of romanized keys need to
+  // check all the entries.
+  if (!base_key.empty() && roman_input_key.empty()) {
+    std::vector<uint32> fps;
+    key_index_->LookupPrefixesAndPredictive(base_key, &fps);
+    for (size_t i = 0; i < fps.size(); ++i) {
+      const Entry *entry = dic_->LookupWithoutInsert(fps[i]);
+      DCHECK(entry);
+      if (entry == nullptr ||
+          !IsValidEntryIgnoringRemovedField(
+              *entry, request.request().available_emoji_carrier())) {
+        continue;
+      }
+      if (!LookupEntry(request_type, input_key, base_key, expanded.get(),
+                       entry, prev_entry, results)) {
+        continue;
+      }
+      // already found enough results.
+      if (results->size() >= max_results_size) {
+        break;
+      }
+    }
+    return;
+  }
+
   int trial = 0;
   for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
     if (!IsValidEntryIgnoringRemovedField(
@@ -1375,12 +1993,12 @@ void UserHistoryPredictor::GetInputKeyFromSegments(
   }
 
   request.composer().GetStringForPreedit(input_key);
-  std::set<string> expanded_set;
-  request.composer().GetQueriesForPrediction(base, &expanded_set);
-  if (expanded_set.size() > 0) {
+  std::vector<string> expanded_chars;
+  request.composer().GetQueriesForPrediction(base, &expanded_chars);
+  if (expanded_chars.size() > 0) {
     expanded->reset(new Trie<string>);
-    for (std::set<string>::const_iterator itr = expanded_set.begin();
-         itr != expanded_set.end(); ++itr) {
+    for (std::vector<string>::const_iterator itr = expanded_chars.begin();
+         itr != expanded_chars.end(); ++itr) {
       // For getting matched key, insert values
       (*expanded)->AddEntry(*itr, *itr);
     }
@@ -1565,7 +2183,7 @@ void UserHistoryPredictor::InsertEvent(EntryType type) {
   const uint32 dic_key = Fingerprint("", "", type);
 
   CHECK(dic_.get());
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key, "", "");
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
@@ -1628,7 +2246,7 @@ void UserHistoryPredictor::Insert(const string &key,
     // add a treatment for UPDATE_ENTRY mode
   }
 
-  DicElement *e = dic_->Insert(dic_key);
+  DicElement *e = InsertToDic(dic_key, key, value);
   if (e == nullptr) {
     VLOG(2) << "insert failed";
     return;
@@ -1714,6 +2332,7 @@ void UserHistoryPredictor::Finish(const ConversionRequest &request,
     LOG(WARNING) << "Syncer is running";
     return;
   }
+  ApplyLoadedEntries(kMaxLoadedEntriesPerRequest);
 
   MaybeRecordUsageStats(*segments);
 
@@ -1956,6 +2575,7 @@ void UserHistoryPredictor::Revert(Segments *segments) {
     LOG(WARNING) << "Syncer is running";
     return;
   }
+  ApplyLoadedEntries(kMaxLoadedEntriesPerRequest);
 
   for (size_t i = 0; i < segments->revert_entries_size(); ++i) {
     const Segments::RevertEntry &revert_entry =
@@ -1963,7 +2583,7 @@ void UserHistoryPredictor::Revert(Segments *segments) {
     if (revert_entry.id == UserHistoryPredictor::revert_id() &&
         revert_entry.revert_entry_type == Segments::RevertEntry::CREATE_ENTRY) {
       VLOG(2) << "Erasing the key: " << StringToUint32(revert_entry.key);
-      dic_->Erase(StringToUint32(revert_entry.key));
+      EraseFromDic(StringToUint32(revert_entry.key));
     }
   }
 }
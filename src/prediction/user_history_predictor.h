@@ -34,11 +34,13 @@
 #include <queue>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "base/freelist.h"
 #include "base/string_piece.h"
+#include "base/thread_pool.h"
 #include "base/trie.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
@@ -52,13 +54,13 @@
 namespace mozc {
 
 namespace storage {
+class EncryptedStringStorage;
 class StringStorageInterface;
 }  // namespace storage
 
 class ConversionRequest;
 class Segment;
 class Segments;
-class UserHistoryPredictorSyncer;
 
 // Added serialization method for UserHistory.
 class UserHistoryStorage : public mozc::user_history_predictor::UserHistory {
@@ -69,11 +71,29 @@ class UserHistoryStorage : public mozc::user_history_predictor::UserHistory {
   // Loads from encrypted file.
   bool Load();
 
-  // Saves history into encrypted file.
+  // Saves history into encrypted file.  The journal of the previous snapshot
+  // is removed.
   bool Save() const;
 
+  // Appends |record| to the journal of the snapshot in the file.
+  bool AppendToJournal(
+      const user_history_predictor::UserHistoryJournalRecord &record) const;
+
+  // Journal records of the loaded snapshot, which should be applied to the
+  // entries in order.
+  const std::vector<user_history_predictor::UserHistoryJournalRecord> &
+  journal_records() const {
+    return journal_records_;
+  }
+
  private:
+  bool JournalExists() const;
+
+  const string journal_filename_;
   std::unique_ptr<storage::StringStorageInterface> storage_;
+  std::unique_ptr<storage::EncryptedStringStorage> journal_storage_;
+  std::vector<user_history_predictor::UserHistoryJournalRecord>
+      journal_records_;
 };
 
 // UserHistoryPredictor is NOT thread safe.
@@ -88,6 +108,14 @@ class UserHistoryPredictor : public PredictorInterface {
       const dictionary::POSMatcher *pos_matcher,
       const dictionary::SuppressionDictionary *suppression_dictionary,
       bool enable_content_word_learning);
+  // Same as above, but keeps at most |cache_size| entries instead of
+  // cache_size(), e.g., for the low memory engine.
+  UserHistoryPredictor(
+      const dictionary::DictionaryInterface *dictionary,
+      const dictionary::POSMatcher *pos_matcher,
+      const dictionary::SuppressionDictionary *suppression_dictionary,
+      bool enable_content_word_learning,
+      uint32 cache_size);
   ~UserHistoryPredictor() override;
 
   void set_content_word_learning_enabled(bool value) {
@@ -124,6 +152,10 @@ class UserHistoryPredictor : public PredictorInterface {
   // Implements PredictorInterface.
   bool Wait() override;
 
+  // Reports the entries and their indices as "user_history".
+  void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const override;
+
   // Gets user history filename.
   static string GetUserHistoryFileName();
 
@@ -141,7 +173,7 @@ class UserHistoryPredictor : public PredictorInterface {
   static uint32 EntryFingerprint(const Entry &entry);
   static uint32 SegmentFingerprint(const Segment &segment);
 
-  // Returns the size of cache.
+  // Returns the default size of cache.
   static uint32 cache_size();
 
   // Returns the size of next entries.
@@ -204,7 +236,6 @@ class UserHistoryPredictor : public PredictorInterface {
     std::vector<SegmentForLearning> conversion_segments_;
   };
 
-  friend class UserHistoryPredictorSyncer;
   friend class UserHistoryPredictorTest;
 
   FRIEND_TEST(UserHistoryPredictorTest, UserHistoryPredictorTest);
@@ -307,12 +338,12 @@ class UserHistoryPredictor : public PredictorInterface {
   // Saves user history data in LRU to local file
   bool Save();
 
-  // non-blocking version of Load
-  // This makes a new thread and call Load()
+  // non-blocking version of Sync
+  // This calls Save() on a BACKGROUND task of the shared ThreadPool.
   bool AsyncSave();
 
-  // non-blocking version of Sync
-  // This makes a new thread and call Save()
+  // non-blocking version of Load
+  // This calls Load() on a BACKGROUND task of the shared ThreadPool.
   bool AsyncLoad();
 
   // Waits until syncer finishes.
@@ -384,6 +415,45 @@ class UserHistoryPredictor : public PredictorInterface {
   typedef mozc::storage::LRUCache<uint32, Entry> DicCache;
   typedef DicCache::Element DicElement;
 
+  // Secondary index of |dic_| from strings to the fingerprints of entries,
+  // which remembers the LRU order of the entries.
+  class PrefixIndex;
+
+  // Compact storage of the entries loaded from the file, which keeps their
+  // fields in flat arrays and their strings in one buffer instead of holding
+  // an Entry object for each.
+  class CompactEntryStore;
+
+  // Inserts |fp| into |dic_| at the head of the LRU list, and registers it
+  // to |key_index_| and |value_index_| with |key| and |value|.  The entry
+  // evicted from |dic_|, if any, is also removed from the indices.  The
+  // caller needs to set the entry, whose key and value must be |key| and
+  // |value|.
+  DicElement *InsertToDic(uint32 fp, const string &key, const string &value);
+
+  // Erases |fp| from |dic_| and the indices.
+  bool EraseFromDic(uint32 fp);
+
+  // Resets |dic_| and the indices to empty.
+  void ResetDic();
+
+  // Applies a journal record loaded from the file to |dic|.
+  static void ApplyJournalRecord(
+      const user_history_predictor::UserHistoryJournalRecord &record,
+      DicCache *dic);
+
+  // Moves at most |max_size| entries loaded by Load() to |dic_|, from the most
+  // recently used one.  This is a deferred part of Load() and doesn't change
+  // the logical state of the predictor.
+  void ApplyLoadedEntries(size_t max_size) const;
+
+  // Makes the journal record of the changes in |dic_| since the last sync.
+  void MakeJournalRecord(
+      user_history_predictor::UserHistoryJournalRecord *record) const;
+
+  // Remembers the entries in |dic| as the ones in the file.
+  void UpdateSavedState(const DicCache &dic);
+
   bool CheckSyncerAndDelete() const;
 
   // If |entry| is the target of prediction,
@@ -532,9 +602,30 @@ class UserHistoryPredictor : public PredictorInterface {
   const string predictor_name_;
 
   bool content_word_learning_enabled_;
+  // The maximum number of the entries in |dic_|.
+  const uint32 max_cache_size_;
   bool updated_;
   std::unique_ptr<DicCache> dic_;
-  mutable std::unique_ptr<UserHistoryPredictorSyncer> syncer_;
+  // State of the entries in the file, from which Save() computes the journal
+  // record to append instead of rewriting the whole history.
+  // |saved_order_| holds the fingerprints of the entries from the LRU tail to
+  // the head, and |saved_entry_hashes_| the hashes of their contents.
+  bool full_save_required_;
+  uint64 saved_snapshot_id_;
+  size_t num_journal_records_;
+  std::vector<uint32> saved_order_;
+  std::unordered_map<uint32, uint64> saved_entry_hashes_;
+  // Index of the entries in |dic_| by their keys.
+  std::unique_ptr<PrefixIndex> key_index_;
+  // Index of the entries in |dic_| by their reversed values, with which the
+  // entries whose values are suffixes of a string are found as prefixes.
+  std::unique_ptr<PrefixIndex> value_index_;
+  // Entries loaded from the file which are not in |dic_| yet, from the most
+  // recently used one.  They are moved to |dic_| from |next_loaded_index_|.
+  mutable std::unique_ptr<CompactEntryStore> loaded_entries_;
+  mutable size_t next_loaded_index_;
+  // The running or queued Load() or Save() on the shared ThreadPool.
+  mutable ThreadPool::TaskHandle syncer_;
 };
 
 }  // namespace mozc
@@ -233,8 +233,8 @@ class UserHistoryPredictorTest : public ::testing::Test {
   static UserHistoryPredictor::Entry *InsertEntry(
       UserHistoryPredictor *predictor,
       const string &key, const string &value) {
-    UserHistoryPredictor::Entry *e =
-        &predictor->dic_->Insert(predictor->Fingerprint(key, value))->value;
+    UserHistoryPredictor::Entry *e = &predictor->InsertToDic(
+        predictor->Fingerprint(key, value), key, value)->value;
     e->set_key(key);
     e->set_value(value);
     e->set_removed(false);
@@ -251,6 +251,52 @@ class UserHistoryPredictorTest : public ::testing::Test {
     return e;
   }
 
+  static const UserHistoryPredictor::Entry *LookupPrevEntry(
+      const UserHistoryPredictor &predictor, const Segments &segments) {
+    return predictor.LookupPrevEntry(segments, 0);
+  }
+
+  static bool EraseEntry(UserHistoryPredictor *predictor,
+                         const string &key, const string &value) {
+    return predictor->EraseFromDic(predictor->Fingerprint(key, value));
+  }
+
+  static bool SaveHistory(UserHistoryPredictor *predictor) {
+    predictor->updated_ = true;
+    return predictor->Save();
+  }
+
+  // Reloads the history from the file.  The loaded entries are moved to the
+  // cache by ApplyLoadedEntries().
+  static bool ReloadHistory(UserHistoryPredictor *predictor) {
+    predictor->ResetDic();
+    return predictor->Load();
+  }
+
+  static void ApplyLoadedEntries(UserHistoryPredictor *predictor) {
+    predictor->ApplyLoadedEntries(UserHistoryPredictor::cache_size());
+  }
+
+  static void MakeJournalRecord(
+      const UserHistoryPredictor &predictor,
+      user_history_predictor::UserHistoryJournalRecord *record) {
+    predictor.MakeJournalRecord(record);
+  }
+
+  static bool HasLoadedEntries(const UserHistoryPredictor &predictor) {
+    return predictor.loaded_entries_ != nullptr;
+  }
+
+  // Returns the entries from the LRU tail to the head.
+  static string DumpHistory(const UserHistoryPredictor &predictor) {
+    string output;
+    for (const UserHistoryPredictor::DicElement *elm = predictor.dic_->Tail();
+         elm != nullptr; elm = elm->prev) {
+      output += elm->value.DebugString();
+    }
+    return output;
+  }
+
   static bool IsConnected(const UserHistoryPredictor::Entry &prev,
                           const UserHistoryPredictor::Entry &next) {
     const uint32 fp =
@@ -3866,6 +3912,189 @@ TEST_F(UserHistoryPredictorTest, RemoveNgramChain) {
   }
 }
 
+TEST_F(UserHistoryPredictorTest, KeyIndexFollowsEviction) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+
+  // Fills the cache so that the oldest entries are evicted.
+  const int kNumEvicted = 10;
+  const int num_entries =
+      static_cast<int>(UserHistoryPredictor::cache_size()) + kNumEvicted;
+  for (int i = 0; i < num_entries; ++i) {
+    InsertEntry(predictor, Util::StringPrintf("k%05d", i),
+                Util::StringPrintf("v%05d", i));
+  }
+
+  for (int i = 0; i < kNumEvicted; ++i) {
+    EXPECT_FALSE(IsPredicted(predictor, Util::StringPrintf("k%05d", i),
+                             Util::StringPrintf("v%05d", i))) << i;
+  }
+  // Entries are found regardless of their positions in the LRU list.
+  EXPECT_TRUE(IsSuggestedAndPredicted(predictor,
+                                      Util::StringPrintf("k%05d", kNumEvicted),
+                                      Util::StringPrintf("v%05d",
+                                                         kNumEvicted)));
+  EXPECT_TRUE(IsSuggestedAndPredicted(
+      predictor, Util::StringPrintf("k%05d", num_entries - 1),
+      Util::StringPrintf("v%05d", num_entries - 1)));
+
+  // Reinserting an evicted key makes it available again.
+  InsertEntry(predictor, "k00000", "v00000");
+  EXPECT_TRUE(IsPredicted(predictor, "k00000", "v00000"));
+  // while the oldest one is evicted instead.
+  EXPECT_FALSE(IsPredicted(predictor, Util::StringPrintf("k%05d", kNumEvicted),
+                           Util::StringPrintf("v%05d", kNumEvicted)));
+}
+
+TEST_F(UserHistoryPredictorTest, SmallerCacheSize) {
+  const uint32 kCacheSize = 10;
+  testing::MockDataManager data_manager;
+  dictionary::POSMatcher pos_matcher;
+  pos_matcher.Set(data_manager.GetPOSMatcherData());
+  UserHistoryPredictor predictor(GetDictionaryMock(), &pos_matcher,
+                                 GetSuppressionDictionary(), false,
+                                 kCacheSize);
+  predictor.Wait();
+  predictor.ClearAllHistory();
+  predictor.Wait();
+
+  // Only the last |kCacheSize| entries are kept.
+  for (uint32 i = 0; i < kCacheSize * 2; ++i) {
+    InsertEntry(&predictor, Util::StringPrintf("k%05d", i),
+                Util::StringPrintf("v%05d", i));
+  }
+  for (uint32 i = 0; i < kCacheSize; ++i) {
+    EXPECT_FALSE(IsPredicted(&predictor, Util::StringPrintf("k%05d", i),
+                             Util::StringPrintf("v%05d", i))) << i;
+  }
+  for (uint32 i = kCacheSize; i < kCacheSize * 2; ++i) {
+    EXPECT_TRUE(IsPredicted(&predictor, Util::StringPrintf("k%05d", i),
+                            Util::StringPrintf("v%05d", i))) << i;
+  }
+}
+
+TEST_F(UserHistoryPredictorTest, LookupPrevEntryBySuffix) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+
+  // Bigram "ABC" -> "DEF", which is followed by many other entries.
+  UserHistoryPredictor::Entry *abc = InsertEntry(predictor, "abc", "ABC");
+  AppendEntry(predictor, "def", "DEF", abc);
+  for (int i = 0; i < 1000; ++i) {
+    InsertEntry(predictor, Util::StringPrintf("k%04d", i),
+                Util::StringPrintf("v%04d", i));
+  }
+
+  Segments segments;
+  MakeSegmentsForPrediction("xabc", &segments);
+  AddCandidate(0, "xABC", &segments);
+  segments.mutable_segment(0)->set_segment_type(Segment::HISTORY);
+  AddSegmentForPrediction("de", &segments);
+  const UserHistoryPredictor::Entry *prev_entry =
+      LookupPrevEntry(*predictor, segments);
+  ASSERT_TRUE(prev_entry != nullptr);
+  EXPECT_EQ("ABC", prev_entry->value());
+
+  // "ABC" is not a suffix of "ABCx".
+  segments.mutable_segment(0)->mutable_candidate(0)->value = "ABCx";
+  EXPECT_TRUE(LookupPrevEntry(*predictor, segments) == nullptr);
+}
+
+TEST_F(UserHistoryPredictorTest, SaveAppendsJournal) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  const string journal_filename =
+      UserHistoryPredictor::GetUserHistoryFileName() + ".journal";
+
+  // The history is rewritten when it's cleared.
+  EXPECT_FALSE(FileUtil::FileExists(journal_filename));
+
+  // Then the changes are appended to the journal.
+  InsertEntry(predictor, "a", "A");
+  InsertEntry(predictor, "b", "B");
+  InsertEntry(predictor, "c", "C");
+  ASSERT_TRUE(SaveHistory(predictor));
+  EXPECT_TRUE(FileUtil::FileExists(journal_filename));
+  InsertEntry(predictor, "d", "D");
+  InsertEntry(predictor, "a", "A");
+  EXPECT_TRUE(EraseEntry(predictor, "c", "C"));
+  ASSERT_TRUE(SaveHistory(predictor));
+  InsertEntry(predictor, "b", "B")->set_suggestion_freq(10);
+  ASSERT_TRUE(SaveHistory(predictor));
+
+  // The reloaded history has the same entries in the same order.
+  const string history = DumpHistory(*predictor);
+  ASSERT_TRUE(ReloadHistory(predictor));
+  ApplyLoadedEntries(predictor);
+  EXPECT_EQ(history, DumpHistory(*predictor));
+  EXPECT_TRUE(IsPredicted(predictor, "b", "B"));
+  EXPECT_FALSE(IsPredicted(predictor, "c", "C"));
+
+  // Clearing the history removes the journal.
+  GetUserHistoryPredictorWithClearedHistory();
+  EXPECT_FALSE(FileUtil::FileExists(journal_filename));
+}
+
+TEST_F(UserHistoryPredictorTest, LoadMakesRecentEntriesAvailableFirst) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+
+  const int kNumEntries = 3000;
+  for (int i = 0; i < kNumEntries; ++i) {
+    InsertEntry(predictor, Util::StringPrintf("k%04d", i),
+                Util::StringPrintf("v%04d", i));
+  }
+  ASSERT_TRUE(SaveHistory(predictor));
+  const string history = DumpHistory(*predictor);
+
+  // The most recent entries are available from the first prediction after
+  // loading, while the older ones are not yet.
+  ASSERT_TRUE(ReloadHistory(predictor));
+  EXPECT_TRUE(IsPredicted(predictor, Util::StringPrintf("k%04d",
+                                                        kNumEntries - 1),
+                          Util::StringPrintf("v%04d", kNumEntries - 1)));
+  EXPECT_TRUE(HasLoadedEntries(*predictor));
+
+  // A newly learned entry stays the most recent one.
+  InsertEntry(predictor, "new", "NEW");
+  for (int i = 0; i < kNumEntries && HasLoadedEntries(*predictor); ++i) {
+    IsPredicted(predictor, "k", "v");
+  }
+  EXPECT_FALSE(HasLoadedEntries(*predictor));
+  EXPECT_TRUE(IsPredicted(predictor, "k0000", "v0000"));
+  ASSERT_TRUE(EraseEntry(predictor, "new", "NEW"));
+  EXPECT_EQ(history, DumpHistory(*predictor));
+}
+
+TEST_F(UserHistoryPredictorTest, LoadRestoresAllFieldsOfEntries) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+
+  UserHistoryPredictor::Entry *entry = InsertEntry(predictor, "a", "A");
+  entry->set_description("desc");
+  entry->set_suggestion_freq(3);
+  entry->set_conversion_freq(5);
+  entry->set_last_access_time(12345);
+  entry->set_bigram_boost(true);
+  entry->set_spelling_correction(false);
+  entry->add_next_entries()->set_entry_fp(10);
+  entry->add_next_entries()->set_entry_fp(20);
+  entry = InsertEntry(predictor, "", "empty");
+  entry->set_entry_type(UserHistoryPredictor::Entry::CLEAN_UNUSED_EVENT);
+  entry = InsertEntry(predictor, "b", "B");
+  entry->set_removed(true);
+  entry->add_next_entries()->set_entry_fp(30);
+  ASSERT_TRUE(SaveHistory(predictor));
+  const string history = DumpHistory(*predictor);
+
+  ASSERT_TRUE(ReloadHistory(predictor));
+  ApplyLoadedEntries(predictor);
+  EXPECT_EQ(history, DumpHistory(*predictor));
+
+  // The reloaded entries are the same as the saved ones, so that no change is
+  // recorded to the journal.
+  user_history_predictor::UserHistoryJournalRecord record;
+  MakeJournalRecord(*predictor, &record);
+  EXPECT_EQ(0, record.erased_entry_fps_size());
+  EXPECT_EQ(0, record.updated_entries_size());
+  EXPECT_EQ(0, record.inserted_entries_size());
+}
+
 TEST_F(UserHistoryPredictorTest, ClearHistoryEntry_Unigram) {
   // Tests ClearHistoryEntry() for unigram history.
   UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
@@ -83,6 +83,23 @@ enum ZeroQueryEmojiType {
 // which can be extracted by using |key_index| and |value_index|.  The string
 // array is also sorted in ascending order of strings.  For the serialization
 // format of string array, see base/serialized_string_array.h".
+//
+// Optionally, a minimal perfect hash over the keys can be given as the third
+// binary data, with which equal_range() finds the entries by a constant number
+// of probes instead of binary searches.  It is an array of uint32 as follows:
+//
+// ZeroQueryHash {
+//   uint32 num_buckets:               4 bytes
+//   uint32 num_keys:                  4 bytes
+//   uint32 seeds[num_buckets]:        4 * num_buckets bytes
+//   uint32 token_indices[num_keys]:   4 * num_keys bytes
+// }
+//
+// A key is first assigned to bucket Hash(0, key) % num_buckets, and then to
+// slot Hash(seeds[bucket], key) % num_keys, which is distinct for every key.
+// The slot holds the index of the first entry of the key in the token array.
+// Since any string is mapped to some slot, the key of the entry is compared
+// with the query.  The data is generated by prediction/gen_zero_query_util.py.
 class ZeroQueryDict {
  public:
   static const size_t kTokenByteSize = 16;
@@ -132,6 +149,17 @@ class ZeroQueryDict {
       return tmp;
     }
 
+    iterator &operator--() {
+      ptr_ -= kTokenByteSize;
+      return *this;
+    }
+
+    iterator operator--(int) {
+      const iterator tmp(ptr_, string_array_);
+      ptr_ -= kTokenByteSize;
+      return tmp;
+    }
+
     iterator &operator+=(ptrdiff_t n) {
       ptr_ += n * kTokenByteSize;
       return *this;
@@ -190,11 +218,44 @@ class ZeroQueryDict {
     const SerializedStringArray * string_array_;
   };
 
+  ZeroQueryDict()
+      : num_buckets_(0), num_hash_keys_(0), hash_seeds_(nullptr),
+        hash_token_indices_(nullptr) {}
+
   void Init(StringPiece token_array_data, StringPiece string_array_data) {
+    Init(token_array_data, string_array_data, StringPiece());
+  }
+
+  // Initializes with the optional hash index.  If |hash_data| is empty or
+  // malformed, equal_range() falls back to binary search.
+  void Init(StringPiece token_array_data, StringPiece string_array_data,
+            StringPiece hash_data) {
     token_array_ = token_array_data;
     string_array_.Set(string_array_data);
+    num_buckets_ = 0;
+    num_hash_keys_ = 0;
+    hash_seeds_ = nullptr;
+    hash_token_indices_ = nullptr;
+    if (hash_data.size() < 8) {
+      return;
+    }
+    const uint32 *data = reinterpret_cast<const uint32 *>(hash_data.data());
+    const uint32 num_buckets = data[0];
+    const uint32 num_keys = data[1];
+    if (num_buckets == 0 || num_keys == 0 ||
+        hash_data.size() !=
+            4 * (2 + static_cast<size_t>(num_buckets) + num_keys)) {
+      return;
+    }
+    num_buckets_ = num_buckets;
+    num_hash_keys_ = num_keys;
+    hash_seeds_ = data + 2;
+    hash_token_indices_ = hash_seeds_ + num_buckets;
   }
 
+  // Returns true if equal_range() uses the hash index.
+  bool has_hash_index() const { return hash_seeds_ != nullptr; }
+
   iterator begin() const {
     return iterator(token_array_.data(), &string_array_);
   }
@@ -205,6 +266,9 @@ class ZeroQueryDict {
   }
 
   std::pair<iterator, iterator> equal_range(StringPiece key) const {
+    if (has_hash_index()) {
+      return HashEqualRange(key);
+    }
     const auto iter = std::lower_bound(string_array_.begin(),
                                        string_array_.end(), key);
     if (iter == string_array_.end() || *iter != key) {
@@ -213,9 +277,46 @@ class ZeroQueryDict {
     return std::equal_range(begin(), end(), iter.index());
   }
 
+  // The hash function of the hash index: 32-bit FNV-1a whose offset basis is
+  // xor-ed with |seed|, followed by the finalizer of MurmurHash3.  This must
+  // be kept in sync with gen_zero_query_util.py.
+  static uint32 Hash(uint32 seed, StringPiece key) {
+    uint32 h = 2166136261u ^ seed;
+    for (size_t i = 0; i < key.size(); ++i) {
+      h = (h ^ static_cast<uint8>(key[i])) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+
  private:
+  std::pair<iterator, iterator> HashEqualRange(StringPiece key) const {
+    const uint32 seed = hash_seeds_[Hash(0, key) % num_buckets_];
+    const uint32 token_index =
+        hash_token_indices_[Hash(seed, key) % num_hash_keys_];
+    if (token_index >= token_array_.size() / kTokenByteSize) {
+      return std::pair<iterator, iterator>(end(), end());
+    }
+    iterator first = begin() + token_index;
+    if (first.key() != key) {
+      return std::pair<iterator, iterator>(end(), end());
+    }
+    // The entries of the same key are contiguous.
+    iterator last = first;
+    for (++last; last != end() && *last == *first; ++last) {}
+    return std::pair<iterator, iterator>(first, last);
+  }
+
   StringPiece token_array_;
   SerializedStringArray string_array_;
+  uint32 num_buckets_;
+  uint32 num_hash_keys_;
+  const uint32 *hash_seeds_;
+  const uint32 *hash_token_indices_;
 };
 
 }  // namespace mozc
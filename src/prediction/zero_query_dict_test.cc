@@ -0,0 +1,157 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/zero_query_dict.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+#include "base/serialized_string_array.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class ZeroQueryDictTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Strings are sorted; "a", "b" and "c" are keys.
+    const std::vector<StringPiece> strs = {"a", "b", "c", "x", "y", "z"};
+    string_array_data_ =
+        SerializedStringArray::SerializeToBuffer(strs, &string_array_buf_);
+    // a -> x, y; b -> z; c -> x
+    AddToken(0, 3);
+    AddToken(0, 4);
+    AddToken(1, 5);
+    AddToken(2, 3);
+    token_array_data_ = StringPiece(
+        reinterpret_cast<const char *>(tokens_.data()), tokens_.size() * 4);
+
+    // Builds a perfect hash with only one bucket; find a seed with which the
+    // keys are mapped to distinct slots.
+    const char *kKeys[] = {"a", "b", "c"};
+    const uint32 kFirstTokenIndices[] = {0, 2, 3};
+    const uint32 kNumKeys = arraysize(kKeys);
+    for (uint32 seed = 1; ; ++seed) {
+      std::set<uint32> slots;
+      for (uint32 i = 0; i < kNumKeys; ++i) {
+        slots.insert(ZeroQueryDict::Hash(seed, kKeys[i]) % kNumKeys);
+      }
+      if (slots.size() == kNumKeys) {
+        hash_.assign(2 + 1 + kNumKeys, 0);
+        hash_[0] = 1;
+        hash_[1] = kNumKeys;
+        hash_[2] = seed;
+        for (uint32 i = 0; i < kNumKeys; ++i) {
+          hash_[3 + ZeroQueryDict::Hash(seed, kKeys[i]) % kNumKeys] =
+              kFirstTokenIndices[i];
+        }
+        break;
+      }
+    }
+    hash_data_ = StringPiece(reinterpret_cast<const char *>(hash_.data()),
+                             hash_.size() * 4);
+  }
+
+  void AddToken(uint32 key_index, uint32 value_index) {
+    tokens_.push_back(key_index);
+    tokens_.push_back(value_index);
+    tokens_.push_back(ZERO_QUERY_EMOJI | (EMOJI_UNICODE << 16));
+    tokens_.push_back(0);
+  }
+
+  // Returns the values for |key| joined by ",".
+  static string Lookup(const ZeroQueryDict &dict, StringPiece key) {
+    string values;
+    const auto range = dict.equal_range(key);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      EXPECT_EQ(key, iter.key());
+      EXPECT_EQ(ZERO_QUERY_EMOJI, iter.type());
+      EXPECT_EQ(EMOJI_UNICODE, iter.emoji_type());
+      if (!values.empty()) {
+        values.append(",");
+      }
+      iter.value().AppendToString(&values);
+    }
+    return values;
+  }
+
+  std::unique_ptr<uint32[]> string_array_buf_;
+  StringPiece string_array_data_;
+  std::vector<uint32> tokens_;
+  StringPiece token_array_data_;
+  std::vector<uint32> hash_;
+  StringPiece hash_data_;
+};
+
+TEST_F(ZeroQueryDictTest, HashIsCompatibleWithGenerator) {
+  // Values computed by _Hash() in gen_zero_query_util.py.
+  EXPECT_EQ(2872998923u, ZeroQueryDict::Hash(0, ""));
+  EXPECT_EQ(4195733450u, ZeroQueryDict::Hash(7, ""));
+  EXPECT_EQ(444641715u, ZeroQueryDict::Hash(0, "a"));
+  EXPECT_EQ(3736780160u, ZeroQueryDict::Hash(7, "a"));
+  // "あい"
+  EXPECT_EQ(3630774404u, ZeroQueryDict::Hash(0, "\xE3\x81\x82\xE3\x81\x84"));
+  EXPECT_EQ(2390944020u, ZeroQueryDict::Hash(7, "\xE3\x81\x82\xE3\x81\x84"));
+}
+
+TEST_F(ZeroQueryDictTest, EqualRange) {
+  ZeroQueryDict binary_search_dict;
+  binary_search_dict.Init(token_array_data_, string_array_data_);
+  EXPECT_FALSE(binary_search_dict.has_hash_index());
+  ZeroQueryDict hash_dict;
+  hash_dict.Init(token_array_data_, string_array_data_, hash_data_);
+  EXPECT_TRUE(hash_dict.has_hash_index());
+
+  const ZeroQueryDict *dicts[] = {&binary_search_dict, &hash_dict};
+  for (size_t i = 0; i < arraysize(dicts); ++i) {
+    EXPECT_EQ("x,y", Lookup(*dicts[i], "a"));
+    EXPECT_EQ("z", Lookup(*dicts[i], "b"));
+    EXPECT_EQ("x", Lookup(*dicts[i], "c"));
+    // Values and unknown strings are not keys.
+    EXPECT_EQ("", Lookup(*dicts[i], "x"));
+    EXPECT_EQ("", Lookup(*dicts[i], "d"));
+    EXPECT_EQ("", Lookup(*dicts[i], ""));
+  }
+}
+
+TEST_F(ZeroQueryDictTest, MalformedHashFallsBackToBinarySearch) {
+  ZeroQueryDict dict;
+  dict.Init(token_array_data_, string_array_data_,
+            StringPiece(hash_data_.data(), hash_data_.size() - 4));
+  EXPECT_FALSE(dict.has_hash_index());
+  EXPECT_EQ("x,y", Lookup(dict, "a"));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -38,6 +38,7 @@ class SendCommandInterface;
 
 namespace renderer {
 class TableLayout;
+class TableLayoutCache;
 class RendererStyle;
 }  // namespace mozc::renderer
 }  // namespace mozc
@@ -57,6 +58,7 @@ enum COLUMN_TYPE {
  @private
   mozc::commands::Candidates candidates_;
   mozc::renderer::TableLayout *tableLayout_;
+  mozc::renderer::TableLayoutCache *tableLayoutCache_;
   const mozc::renderer::RendererStyle *style_;
 
   // The row which has focused background.
@@ -38,6 +38,7 @@
 #include "protocol/renderer_style.pb.h"
 #include "renderer/mac/mac_view_util.h"
 #include "renderer/table_layout.h"
+#include "renderer/table_layout_cache.h"
 #include "renderer/renderer_style_handler.h"
 
 
@@ -46,6 +47,7 @@ using mozc::commands::Candidates;
 using mozc::commands::Output;
 using mozc::commands::SessionCommand;
 using mozc::renderer::TableLayout;
+using mozc::renderer::TableLayoutCache;
 using mozc::renderer::RendererStyle;
 using mozc::renderer::RendererStyleHandler;
 using mozc::renderer::mac::MacViewUtil;
@@ -124,6 +126,7 @@ void InitializeDefaultStyle() {
   self = [super initWithFrame:frame];
   if (self) {
     tableLayout_ = new(nothrow)TableLayout;
+    tableLayoutCache_ = new(nothrow)TableLayoutCache;
     RendererStyle *style = new(nothrow)RendererStyle;
     if (style) {
       RendererStyleHandler::GetRendererStyle(style);
@@ -131,7 +134,7 @@ void InitializeDefaultStyle() {
     style_ = style;
     focusedRow_ = -1;
   }
-  if (!tableLayout_ || !style_) {
+  if (!tableLayout_ || !tableLayoutCache_ || !style_) {
     [self release];
     self = nil;
   }
@@ -153,6 +156,7 @@ void InitializeDefaultStyle() {
 - (void)dealloc {
   [candidateStringsCache_ release];
   delete tableLayout_;
+  delete tableLayoutCache_;
   delete style_;
   [super dealloc];
 }
@@ -167,8 +171,6 @@ void InitializeDefaultStyle() {
 - (NSSize)updateLayout {
   NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
   [candidateStringsCache_ release];
-  tableLayout_->Initialize(candidates_.candidate_size(), NUMBER_OF_COLUMNS);
-  tableLayout_->SetWindowBorder(style_->window_border());
 
   // calculating focusedRow_
   if (candidates_.has_focused_index() && candidates_.candidate_size() > 0) {
@@ -178,8 +180,17 @@ void InitializeDefaultStyle() {
     focusedRow_ = -1;
   }
 
+  // Moving the focus does not change the layout in most cases.  Then only
+  // the strings for drawing are made without measuring them.
+  const uint64 layoutKey = TableLayoutCache::GetKey(candidates_);
+  const bool layoutCached = tableLayoutCache_->Lookup(layoutKey, tableLayout_);
+  if (!layoutCached) {
+    tableLayout_->Initialize(candidates_.candidate_size(), NUMBER_OF_COLUMNS);
+    tableLayout_->SetWindowBorder(style_->window_border());
+  }
+
   // Reserve footer space.
-  if (candidates_.has_footer()) {
+  if (!layoutCached && candidates_.has_footer()) {
     NSSize footerSize = NSZeroSize;
 
     const mozc::commands::Footer &footer = candidates_.footer();
@@ -227,14 +238,16 @@ void InitializeDefaultStyle() {
     tableLayout_->EnsureFooterSize(MacViewUtil::ToSize(footerSize));
   }
 
-  tableLayout_->SetRowRectPadding(style_->row_rect_padding());
-  if (candidates_.candidate_size() < candidates_.size()) {
-    tableLayout_->SetVScrollBar(style_->scrollbar_width());
-  }
-
   NSAttributedString *gap1 = MacViewUtil::ToNSAttributedString(
       " ", style_->text_styles(COLUMN_GAP1));
-  tableLayout_->EnsureCellSize(COLUMN_GAP1, MacViewUtil::ToSize([gap1 size]));
+  if (!layoutCached) {
+    tableLayout_->SetRowRectPadding(style_->row_rect_padding());
+    if (candidates_.candidate_size() < candidates_.size()) {
+      tableLayout_->SetVScrollBar(style_->scrollbar_width());
+    }
+    tableLayout_->EnsureCellSize(COLUMN_GAP1,
+                                 MacViewUtil::ToSize([gap1 size]));
+  }
 
   NSMutableArray *newCache = [[NSMutableArray array] retain];
   for (size_t i = 0; i < candidates_.candidate_size(); ++i) {
@@ -258,6 +271,11 @@ void InitializeDefaultStyle() {
     NSAttributedString *description = MacViewUtil::ToNSAttributedString(
        candidate.annotation().description(),
        style_->text_styles(COLUMN_DESCRIPTION));
+    if (layoutCached) {
+      [newCache addObject:[NSArray arrayWithObjects:shortcut, gap1,
+                                   candidateValue, description, nil]];
+      continue;
+    }
     if ([shortcut length] > 0) {
       NSSize shortcutSize = MacViewUtil::applyTheme(
           [shortcut size], style_->text_styles(COLUMN_SHORTCUT));
@@ -281,11 +299,13 @@ void InitializeDefaultStyle() {
                                  candidateValue, description, nil]];
   }
 
-  tableLayout_->EnsureColumnsWidth(COLUMN_CANDIDATE, COLUMN_DESCRIPTION,
-                                   g_column_minimum_width);
-
   candidateStringsCache_ = newCache;
-  tableLayout_->FreezeLayout();
+  if (!layoutCached) {
+    tableLayout_->EnsureColumnsWidth(COLUMN_CANDIDATE, COLUMN_DESCRIPTION,
+                                     g_column_minimum_width);
+    tableLayout_->FreezeLayout();
+    tableLayoutCache_->Insert(layoutKey, *tableLayout_);
+  }
   [pool drain];
   return MacViewUtil::ToNSSize(tableLayout_->GetTotalSize());
 }
@@ -45,9 +45,11 @@
       'type': 'static_library',
       'sources': [
         'table_layout.cc',
+        'table_layout_cache.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../protocol/protocol.gyp:commands_proto',
       ],
     },
     {
@@ -123,6 +125,7 @@
       'target_name': 'table_layout_test',
       'type': 'executable',
       'sources': [
+        'table_layout_cache_test.cc',
         'table_layout_test.cc',
       ],
       'dependencies': [
@@ -41,6 +41,7 @@
 #include "base/run_level.h"
 #include "base/system_util.h"
 #include "base/thread.h"
+#include "base/unnamed_event.h"
 #include "base/util.h"
 #include "base/version.h"
 #include "ipc/ipc.h"
@@ -66,11 +67,8 @@ const size_t kMaxErrorTimes         = 5;
 const uint64 kRetryIntervalTime     = 30;  // 30 sec
 const char   kServiceName[]         = "renderer";
 
-inline void CallCommand(IPCClientInterface *client,
-                        const commands::RendererCommand &command) {
-  string buf;
-  command.SerializeToString(&buf);
-
+inline bool CallSerializedCommand(IPCClientInterface *client,
+                                  const string &buf) {
   // basically, we don't need to get the result
   char result[32];
   size_t result_size = sizeof(result);
@@ -79,10 +77,76 @@ inline void CallCommand(IPCClientInterface *client,
                     result, &result_size,
                     kIPCTimeout)) {
     LOG(ERROR) << "Cannot send the request: ";
+    return false;
   }
+  return true;
+}
+
+inline void CallCommand(IPCClientInterface *client,
+                        const commands::RendererCommand &command) {
+  string buf;
+  command.SerializeToString(&buf);
+  CallSerializedCommand(client, buf);
 }
 }  // namespace
 
+// Sends the commands of RendererClient from its own thread.  Only the latest
+// command is kept until the thread picks it up.
+class RendererCommandSender : public Thread {
+ public:
+  explicit RendererCommandSender(RendererClient *client)
+      : client_(client), has_command_(false), quit_(false) {}
+
+  virtual ~RendererCommandSender() {
+    {
+      scoped_lock l(&mutex_);
+      quit_ = true;
+    }
+    event_.Notify();
+    Join();
+  }
+
+  void UpdateCommand(const commands::RendererCommand &command) {
+    {
+      scoped_lock l(&mutex_);
+      command_.CopyFrom(command);
+      has_command_ = true;
+    }
+    event_.Notify();
+  }
+
+  virtual void Run() {
+    commands::RendererCommand command;
+    while (true) {
+      event_.Wait(-1);
+      {
+        scoped_lock l(&mutex_);
+        if (quit_) {
+          return;
+        }
+        if (!has_command_) {
+          continue;
+        }
+        command.Swap(&command_);
+        has_command_ = false;
+      }
+      if (!client_->ExecCommandInternal(command)) {
+        VLOG(1) << "RendererClient::ExecCommandInternal failed.";
+      }
+    }
+  }
+
+ private:
+  RendererClient *client_;
+  UnnamedEvent event_;
+  Mutex mutex_;
+  commands::RendererCommand command_;
+  bool has_command_;
+  bool quit_;
+
+  DISALLOW_COPY_AND_ASSIGN(RendererCommandSender);
+};
+
 class RendererLauncher : public RendererLauncherInterface,
                          public Thread {
  public:
@@ -336,6 +400,9 @@ RendererClient::RendererClient()
 }
 
 RendererClient::~RendererClient() {
+  // Stops the sender thread first so that the following command is sent
+  // synchronously.
+  command_sender_.reset();
   if (!IsAvailable() || !is_window_visible_) {
     return;
   }
@@ -411,6 +478,14 @@ void RendererClient::set_suppress_error_dialog(bool suppress) {
   renderer_launcher_interface_->set_suppress_error_dialog(suppress);
 }
 
+void RendererClient::EnableAsyncMode() {
+  if (command_sender_.get() != NULL) {
+    return;
+  }
+  command_sender_.reset(new RendererCommandSender(this));
+  command_sender_->Start("RendererCommandSender");
+}
+
 bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
   if (renderer_launcher_interface_ == NULL) {
     LOG(ERROR) << "RendererLauncher is NULL";
@@ -422,7 +497,18 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return false;
   }
 
+  if (command_sender_.get() != NULL) {
+    command_sender_->UpdateCommand(command);
+    return true;
+  }
+
+  return ExecCommandInternal(command);
+}
+
+bool RendererClient::ExecCommandInternal(
+    const commands::RendererCommand &command) {
   if (!renderer_launcher_interface_->CanConnect()) {
+    last_sent_command_.clear();
     renderer_launcher_interface_->SetPendingCommand(command);
     // Check CanConnect() again, as the status might be changed
     // after SetPendingCommand().
@@ -452,6 +538,7 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
   is_window_visible_ = command.visible();
 
   if (!client->Connected()) {
+    last_sent_command_.clear();
     // We don't need to send HIDE if the renderer is not running
     if (command.type() == commands::RendererCommand::UPDATE &&
         (!is_window_visible_ || !command.has_output())) {
@@ -475,6 +562,7 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
       LOG(ERROR) << "ForceTerminateServer failed";
     }
     ++version_mismatch_nums_;
+    last_sent_command_.clear();
     renderer_launcher_interface_->SetPendingCommand(command);
     return true;
   } else if (IPC_PROTOCOL_VERSION < client->GetServerProtocolVersion()) {
@@ -496,10 +584,25 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     shutdown_command.set_type(commands::RendererCommand::SHUTDOWN);
     CallCommand(client.get(), shutdown_command);
     ++version_mismatch_nums_;
+    last_sent_command_.clear();
+    return true;
+  }
+
+  string buf;
+  command.SerializeToString(&buf);
+  if (command.type() != commands::RendererCommand::UPDATE) {
+    last_sent_command_.clear();
+  } else if (buf == last_sent_command_) {
+    VLOG(2) << "Skips the same command as the last one";
     return true;
   }
 
-  CallCommand(client.get(), command);
+  if (CallSerializedCommand(client.get(), buf) &&
+      command.type() == commands::RendererCommand::UPDATE) {
+    last_sent_command_.swap(buf);
+  } else {
+    last_sent_command_.clear();
+  }
 
   return true;
 }
@@ -43,6 +43,8 @@ class IPCClientInterface;
 
 namespace renderer {
 
+class RendererCommandSender;
+
 class RendererLauncherInterface {
  public:
   enum RendererErrorType {
@@ -124,7 +126,17 @@ class RendererClient : public RendererInterface {
   // Sets the flag of error dialog suppression.
   void set_suppress_error_dialog(bool suppress);
 
+  // Sends the commands from a background thread after this call, so that
+  // ExecCommand never waits for the renderer.  When the commands come faster
+  // than the renderer accepts them, only the latest one is sent.
+  void EnableAsyncMode();
+
  private:
+  friend class RendererCommandSender;
+
+  // Sends |command| to the renderer synchronously.
+  bool ExecCommandInternal(const commands::RendererCommand &command);
+
   IPCClientInterface *CreateIPCClient() const;
 
   bool is_window_visible_;
@@ -133,10 +145,16 @@ class RendererClient : public RendererInterface {
   string name_;
   string renderer_path_;
 
+  // The serialized UPDATE command sent last.  An identical command is not
+  // sent again.
+  string last_sent_command_;
+
   IPCClientFactoryInterface *ipc_client_factory_interface_;
 
   std::unique_ptr<RendererLauncherInterface> renderer_launcher_;
   RendererLauncherInterface *renderer_launcher_interface_;
+
+  std::unique_ptr<RendererCommandSender> command_sender_;
 };
 
 }  // namespace renderer
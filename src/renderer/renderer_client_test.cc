@@ -588,5 +588,71 @@ TEST(RendererClient, SetPendingCommandTest) {
     EXPECT_FALSE(launcher.is_set_pending_command_called());
   }
 }
+
+TEST(RendererClient, SkipSameUpdateCommand) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+
+  launcher.Reset();
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(true);
+  TestIPCClient::Reset();
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(1, TestIPCClient::counter());
+
+  command.set_visible(false);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(2, TestIPCClient::counter());
+
+  // The command is sent again after the connection is lost.
+  TestIPCClient::set_connected(false);
+  EXPECT_TRUE(client.ExecCommand(command));
+  TestIPCClient::set_connected(true);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(3, TestIPCClient::counter());
+
+  // NOOP is not skipped.
+  command.set_type(commands::RendererCommand::NOOP);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(5, TestIPCClient::counter());
+}
+
+TEST(RendererClient, AsyncModeTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  launcher.Reset();
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(true);
+  TestIPCClient::Reset();
+
+  {
+    RendererClient client;
+    client.SetIPCClientFactory(&factory);
+    client.SetRendererLauncherInterface(&launcher);
+    client.EnableAsyncMode();
+
+    commands::RendererCommand command;
+    command.set_type(commands::RendererCommand::UPDATE);
+    command.set_visible(true);
+    EXPECT_TRUE(client.ExecCommand(command));
+
+    for (int i = 0; i < 100 && TestIPCClient::counter() == 0; ++i) {
+      Util::Sleep(10);
+    }
+    EXPECT_EQ(1, TestIPCClient::counter());
+  }
+}
 }  // namespace renderer
 }  // namespace mozc
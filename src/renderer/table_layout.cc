@@ -78,6 +78,24 @@ void TableLayout::Initialize(int num_rows,
   total_size_ = Size();
 }
 
+void TableLayout::CopyFrom(const TableLayout &layout) {
+  column_width_list_ = layout.column_width_list_;
+  padding_pixels_ = layout.padding_pixels_;
+  total_size_ = layout.total_size_;
+  minimum_footer_size_ = layout.minimum_footer_size_;
+  minimum_header_size_ = layout.minimum_header_size_;
+  ensure_width_from_column_ = layout.ensure_width_from_column_;
+  ensure_width_to_column_ = layout.ensure_width_to_column_;
+  ensure_width_ = layout.ensure_width_;
+  number_of_rows_ = layout.number_of_rows_;
+  number_of_columns_ = layout.number_of_columns_;
+  window_border_pixels_ = layout.window_border_pixels_;
+  row_rect_padding_pixels_ = layout.row_rect_padding_pixels_;
+  row_height_ = layout.row_height_;
+  vscroll_width_pixels_ = layout.vscroll_width_pixels_;
+  layout_frozen_ = layout.layout_frozen_;
+}
+
 // ------------------------------------------------------------------------
 // Add layout element
 // ------------------------------------------------------------------------
@@ -116,6 +116,9 @@ class TableLayout : public TableLayoutInterface {
   // Reset layout freeze and initialize the number of rows and columns.
   void Initialize(int num_rows, int num_columns);
 
+  // Copy all the parameters and the frozen state from |layout|.
+  void CopyFrom(const TableLayout &layout);
+
   // Set layout element.
   void SetVScrollBar(int width_in_pixels);
   void SetWindowBorder(int width_in_pixels);
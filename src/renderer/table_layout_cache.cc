@@ -0,0 +1,122 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "renderer/table_layout_cache.h"
+
+#include <string>
+
+#include "base/hash.h"
+#include "base/logging.h"
+#include "protocol/candidates.pb.h"
+#include "renderer/table_layout.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+// A few windows (e.g. the suggestion and the conversion) alternate while
+// typing, so a small number of entries is enough.
+const size_t kMaxEntries = 8;
+
+int GetNumberOfDigits(int value) {
+  int digits = 1;
+  for (; value >= 10; value /= 10) {
+    ++digits;
+  }
+  return digits;
+}
+}  // namespace
+
+struct TableLayoutCache::Entry {
+  uint64 key;
+  TableLayout layout;
+};
+
+TableLayoutCache::TableLayoutCache() {}
+
+TableLayoutCache::~TableLayoutCache() {
+  Clear();
+}
+
+// static
+uint64 TableLayoutCache::GetKey(const commands::Candidates &candidates) {
+  commands::Candidates copied(candidates);
+  copied.clear_focused_index();
+  const uint32 focused_digits = candidates.has_focused_index() ?
+      GetNumberOfDigits(candidates.focused_index() + 1) : 0;
+  return Hash::FingerprintV2WithSeed(copied.SerializePartialAsString(),
+                                     focused_digits);
+}
+
+bool TableLayoutCache::Lookup(uint64 key, TableLayout *layout) {
+  DCHECK(layout);
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i]->key != key) {
+      continue;
+    }
+    Entry *entry = entries_[i];
+    entries_.erase(entries_.begin() + i);
+    entries_.insert(entries_.begin(), entry);
+    layout->CopyFrom(entry->layout);
+    return true;
+  }
+  return false;
+}
+
+void TableLayoutCache::Insert(uint64 key, const TableLayout &layout) {
+  DCHECK(layout.IsLayoutFrozen());
+  Entry *entry = NULL;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i]->key == key) {
+      entry = entries_[i];
+      entries_.erase(entries_.begin() + i);
+      break;
+    }
+  }
+  if (entry == NULL) {
+    if (entries_.size() >= kMaxEntries) {
+      entry = entries_.back();
+      entries_.pop_back();
+    } else {
+      entry = new Entry;
+    }
+  }
+  entry->key = key;
+  entry->layout.CopyFrom(layout);
+  entries_.insert(entries_.begin(), entry);
+}
+
+void TableLayoutCache::Clear() {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    delete entries_[i];
+  }
+  entries_.clear();
+}
+
+}  // namespace renderer
+}  // namespace mozc
@@ -0,0 +1,82 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_RENDERER_TABLE_LAYOUT_CACHE_H_
+#define MOZC_RENDERER_TABLE_LAYOUT_CACHE_H_
+
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+namespace commands {
+class Candidates;
+}  // namespace commands
+
+namespace renderer {
+
+class TableLayout;
+
+// Keeps the frozen layouts of the recently shown candidate windows, so that
+// the renderers do not measure the same candidates again when only the
+// focus moves.  The layouts depend on the fonts and the DPI as well, so the
+// owner has to call Clear() when they change.
+class TableLayoutCache {
+ public:
+  TableLayoutCache();
+  ~TableLayoutCache();
+
+  // Returns the key of the layout of |candidates|.  The focused index only
+  // changes the index shown in the footer, so only its number of digits is
+  // taken into the key.
+  static uint64 GetKey(const commands::Candidates &candidates);
+
+  // Copies the layout cached for |key| to |layout| and returns true if it
+  // exists.
+  bool Lookup(uint64 key, TableLayout *layout);
+
+  // Caches the frozen |layout| for |key|.  The least recently used one is
+  // dropped when the cache is full.
+  void Insert(uint64 key, const TableLayout &layout);
+
+  void Clear();
+
+ private:
+  struct Entry;
+
+  // Ordered from the most recently used one.
+  std::vector<Entry *> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(TableLayoutCache);
+};
+
+}  // namespace renderer
+}  // namespace mozc
+
+#endif  // MOZC_RENDERER_TABLE_LAYOUT_CACHE_H_
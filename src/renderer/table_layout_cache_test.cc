@@ -0,0 +1,119 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "renderer/table_layout_cache.h"
+
+#include "protocol/candidates.pb.h"
+#include "renderer/table_layout.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+void SetUpCandidates(const char *value, commands::Candidates *candidates) {
+  candidates->Clear();
+  candidates->set_size(20);
+  for (int i = 0; i < 9; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value(value);
+  }
+  candidates->mutable_footer()->set_index_visible(true);
+}
+
+void SetUpLayout(int width, TableLayout *layout) {
+  layout->Initialize(9, 2);
+  layout->EnsureCellSize(0, Size(width, 10));
+  layout->FreezeLayout();
+}
+
+}  // namespace
+
+TEST(TableLayoutCacheTest, GetKey) {
+  commands::Candidates candidates;
+  SetUpCandidates("a", &candidates);
+  candidates.set_focused_index(0);
+  const uint64 key = TableLayoutCache::GetKey(candidates);
+
+  // Moving the focus does not change the key...
+  candidates.set_focused_index(8);
+  EXPECT_EQ(key, TableLayoutCache::GetKey(candidates));
+
+  // ...unless the number of digits of the index changes.
+  candidates.set_focused_index(9);
+  EXPECT_NE(key, TableLayoutCache::GetKey(candidates));
+  candidates.clear_focused_index();
+  EXPECT_NE(key, TableLayoutCache::GetKey(candidates));
+
+  SetUpCandidates("b", &candidates);
+  candidates.set_focused_index(0);
+  EXPECT_NE(key, TableLayoutCache::GetKey(candidates));
+}
+
+TEST(TableLayoutCacheTest, LookupAndInsert) {
+  TableLayoutCache cache;
+  TableLayout layout;
+  EXPECT_FALSE(cache.Lookup(1, &layout));
+
+  SetUpLayout(30, &layout);
+  cache.Insert(1, layout);
+  SetUpLayout(50, &layout);
+  cache.Insert(2, layout);
+
+  TableLayout restored;
+  ASSERT_TRUE(cache.Lookup(1, &restored));
+  EXPECT_TRUE(restored.IsLayoutFrozen());
+  EXPECT_EQ(30, restored.GetColumnRect(0).Width());
+  ASSERT_TRUE(cache.Lookup(2, &restored));
+  EXPECT_EQ(50, restored.GetColumnRect(0).Width());
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Lookup(1, &restored));
+  EXPECT_FALSE(cache.Lookup(2, &restored));
+}
+
+TEST(TableLayoutCacheTest, DropLeastRecentlyUsed) {
+  TableLayoutCache cache;
+  TableLayout layout;
+  SetUpLayout(30, &layout);
+  for (uint64 key = 0; key < 8; ++key) {
+    cache.Insert(key, layout);
+  }
+  // Key 0 becomes the most recently used, so key 1 is dropped.
+  EXPECT_TRUE(cache.Lookup(0, &layout));
+  cache.Insert(8, layout);
+  EXPECT_TRUE(cache.Lookup(0, &layout));
+  EXPECT_FALSE(cache.Lookup(1, &layout));
+  EXPECT_TRUE(cache.Lookup(2, &layout));
+  EXPECT_TRUE(cache.Lookup(8, &layout));
+}
+
+}  // namespace renderer
+}  // namespace mozc
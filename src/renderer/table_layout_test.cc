@@ -238,5 +238,33 @@ TEST(TableLayoutTest, LayoutFreeze) {
   EXPECT_FALSE(layout.IsLayoutFrozen());
 }
 
+TEST(TableLayoutTest, CopyFrom) {
+  TableLayout layout;
+  layout.Initialize(3, NUMBER_OF_COLUMNS);
+  layout.SetWindowBorder(1);
+  layout.SetRowRectPadding(2);
+  layout.SetVScrollBar(4);
+  layout.EnsureCellSize(COLUMN_CANDIDATE, Size(50, 20));
+  layout.EnsureFooterSize(Size(10, 8));
+  layout.FreezeLayout();
+
+  TableLayout copied;
+  copied.CopyFrom(layout);
+  EXPECT_TRUE(copied.IsLayoutFrozen());
+  EXPECT_EQ(layout.number_of_rows(), copied.number_of_rows());
+  EXPECT_EQ(layout.number_of_columns(), copied.number_of_columns());
+  EXPECT_SIZE_EQ(layout.GetTotalSize().width, layout.GetTotalSize().height,
+                 copied.GetTotalSize());
+  for (int i = 0; i < layout.number_of_rows(); ++i) {
+    const Rect row_rect = layout.GetRowRect(i);
+    EXPECT_RECT_EQ(row_rect.origin.x, row_rect.origin.y, row_rect.Width(),
+                   row_rect.Height(), copied.GetRowRect(i));
+  }
+  const Rect footer_rect = layout.GetFooterRect();
+  EXPECT_RECT_EQ(footer_rect.origin.x, footer_rect.origin.y,
+                 footer_rect.Width(), footer_rect.Height(),
+                 copied.GetFooterRect());
+}
+
 }  // namespace renderer
 }  // namespace mozc
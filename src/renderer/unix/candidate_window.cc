@@ -71,6 +71,20 @@ int GetCandidateArrayIndexByCandidateIndex(
   }
   return candidates.candidate_size();
 }
+
+bool IsIntersected(const Rect &rect1, const Rect &rect2) {
+  return rect1.Left() < rect2.Right() && rect2.Left() < rect1.Right() &&
+      rect1.Top() < rect2.Bottom() && rect2.Top() < rect1.Bottom();
+}
+
+// Inflates |rect| so that it covers the frame drawn on its edges.
+Rect InflateForFrame(const Rect &rect) {
+  if (rect.IsRectEmpty()) {
+    return rect;
+  }
+  return Rect(rect.Left() - 1, rect.Top() - 1,
+              rect.Width() + 2, rect.Height() + 2);
+}
 }  // namespace
 
 CandidateWindow::CandidateWindow(
@@ -90,6 +104,13 @@ bool CandidateWindow::OnPaint(GtkWidget *widget, GdkEventExpose* event) {
   draw_tool_->Reset(cairo_factory_->CreateCairoInstance(
       GetCanvasWidget()->window));
 
+  // GTK discards the drawing out of the exposed area, so the cells out of it
+  // are not rendered at all.
+  if (event != NULL) {
+    paint_area_ = Rect(event->area.x, event->area.y,
+                       event->area.width, event->area.height);
+  }
+
   DrawBackground();
   DrawShortcutBackground();
   DrawSelectedRect();
@@ -98,6 +119,7 @@ bool CandidateWindow::OnPaint(GtkWidget *widget, GdkEventExpose* event) {
   DrawVScrollBar();
   DrawFooter();
   DrawFrame();
+  paint_area_ = Rect();
   return true;
 }
 
@@ -144,6 +166,11 @@ void CandidateWindow::DrawSelectedRect() {
 
 void CandidateWindow::DrawCells() {
   for (size_t i = 0; i < candidates_.candidate_size(); ++i) {
+    // Skips the rows out of the exposed area.
+    if (!paint_area_.IsRectEmpty() &&
+        !IsInPaintArea(table_layout_->GetRowRect(i))) {
+      continue;
+    }
     const commands::Candidates::Candidate &candidate
         = candidates_.candidate(i);
     string shortcut, value, description;
@@ -378,6 +405,35 @@ void CandidateWindow::UpdateGap2Size(bool has_description) {
   table_layout_->EnsureCellSize(COLUMN_GAP2, gap2_size);
 }
 
+Rect CandidateWindow::GetFocusedRowRect() const {
+  if (!candidates_.has_focused_index()) {
+    return Rect();
+  }
+  const int row_index = GetCandidateArrayIndexByCandidateIndex(
+      candidates_, candidates_.focused_index());
+  if (row_index >= candidates_.candidate_size()) {
+    return Rect();
+  }
+  return table_layout_->GetRowRect(row_index);
+}
+
+bool CandidateWindow::IsOnlyFocusChanged(
+    const commands::Candidates &candidates) const {
+  if (candidates_.candidate_size() != candidates.candidate_size()) {
+    return false;
+  }
+  commands::Candidates old_candidates(candidates_);
+  commands::Candidates new_candidates(candidates);
+  old_candidates.clear_focused_index();
+  new_candidates.clear_focused_index();
+  return old_candidates.SerializePartialAsString() ==
+      new_candidates.SerializePartialAsString();
+}
+
+bool CandidateWindow::IsInPaintArea(const Rect &rect) const {
+  return paint_area_.IsRectEmpty() || IsIntersected(paint_area_, rect);
+}
+
 Size CandidateWindow::Update(const commands::Candidates &candidates) {
   DCHECK(
       (candidates_.category()  == commands::CONVERSION) ||
@@ -387,6 +443,14 @@ Size CandidateWindow::Update(const commands::Candidates &candidates) {
       (candidates_.category()  == commands::USAGE))
       << "Unknown candidate category" << candidates_.category();
 
+  // When only the focus moves, the layout stays the same unless the index in
+  // the footer changes its width.  Then only the rows losing and gaining the
+  // focus and the footer are repainted.
+  const bool only_focus_changed =
+      table_layout_->IsLayoutFrozen() && IsOnlyFocusChanged(candidates);
+  const Size previous_size = table_layout_->GetTotalSize();
+  const Rect previous_focused_rect = GetFocusedRowRect();
+
   candidates_.CopyFrom(candidates);
 
   table_layout_->Initialize(candidates_.candidate_size(), NUMBER_OF_COLUMNS);
@@ -401,9 +465,20 @@ Size CandidateWindow::Update(const commands::Candidates &candidates) {
   UpdateGap2Size(has_description);
 
   table_layout_->FreezeLayout();
-  Resize(table_layout_->GetTotalSize());
+  const Size total_size = table_layout_->GetTotalSize();
+  if (only_focus_changed &&
+      total_size.width == previous_size.width &&
+      total_size.height == previous_size.height) {
+    RedrawRect(InflateForFrame(previous_focused_rect));
+    RedrawRect(InflateForFrame(GetFocusedRowRect()));
+    if (candidates_.has_footer()) {
+      RedrawRect(table_layout_->GetFooterRect());
+    }
+    return total_size;
+  }
+  Resize(total_size);
   Redraw();
-  return table_layout_->GetTotalSize();
+  return total_size;
 }
 
 void CandidateWindow::GetDisplayString(
@@ -123,6 +123,17 @@ class CandidateWindow : public GtkWindowBase {
   void UpdateCandidatesSize(bool *has_description);
   void UpdateGap2Size(bool has_description);
 
+  // Returns the rect of the focused row, or an empty rect if no row is
+  // focused.
+  Rect GetFocusedRowRect() const;
+
+  // Returns true if |candidates| differs from |candidates_| only in the
+  // focused index.
+  bool IsOnlyFocusChanged(const commands::Candidates &candidates) const;
+
+  // Returns true if |rect| should be painted in the current OnPaint.
+  bool IsInPaintArea(const Rect &rect) const;
+
   // TODO(nona): Remove FRIEND_TEST
   FRIEND_TEST(CandidateWindowTest, DrawBackgroundTest);
   FRIEND_TEST(CandidateWindowTest, DrawShortcutBackgroundTest);
@@ -151,6 +162,8 @@ class CandidateWindow : public GtkWindowBase {
   std::unique_ptr<DrawToolInterface> draw_tool_;
   std::unique_ptr<CairoFactoryInterface> cairo_factory_;
   client::SendCommandInterface *send_command_interface_;
+  // The area to be painted in OnPaint.  An empty rect means the whole window.
+  Rect paint_area_;
   DISALLOW_COPY_AND_ASSIGN(CandidateWindow);
 };
 
@@ -1156,6 +1156,43 @@ TEST_F(CandidateWindowTest, UpdateTest) {
   // TODO(nona): Implement this test.
 }
 
+TEST_F(CandidateWindowTest, UpdateFocusOnlyTest) {
+  CandidateWindowTestKit testkit = SetUpCandidateWindow();
+  const Size total_size(100, 50);
+  const Rect row0_rect(10, 5, 80, 15);
+  const Rect row1_rect(10, 20, 80, 15);
+  EXPECT_CALL(*testkit.table_layout_mock, IsLayoutFrozen())
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(*testkit.table_layout_mock, GetTotalSize())
+      .WillRepeatedly(Return(total_size));
+  EXPECT_CALL(*testkit.table_layout_mock, GetRowRect(0))
+      .WillRepeatedly(Return(row0_rect));
+  EXPECT_CALL(*testkit.table_layout_mock, GetRowRect(1))
+      .WillRepeatedly(Return(row1_rect));
+
+  // The first update resizes and redraws the whole window.
+  EXPECT_CALL(*testkit.gtk_mock, GtkWindowResize(
+      kDummyWindow, total_size.width, total_size.height)).Times(1);
+  EXPECT_CALL(*testkit.gtk_mock,
+              GtkWidgetQueueDrawArea(kDummyWindow, 0, 0, _, _)).Times(1);
+  // Moving the focus redraws only the rows losing and gaining it.
+  EXPECT_CALL(*testkit.gtk_mock, GtkWidgetQueueDrawArea(
+      kDummyWindow, row0_rect.Left() - 1, row0_rect.Top() - 1,
+      row0_rect.Width() + 2, row0_rect.Height() + 2)).Times(1);
+  EXPECT_CALL(*testkit.gtk_mock, GtkWidgetQueueDrawArea(
+      kDummyWindow, row1_rect.Left() - 1, row1_rect.Top() - 1,
+      row1_rect.Width() + 2, row1_rect.Height() + 2)).Times(1);
+
+  commands::Candidates candidates;
+  SetTestCandidates(3, true, false, false, false, false, &candidates);
+  candidates.set_focused_index(0);
+  testkit.window->Update(candidates);
+  candidates.set_focused_index(1);
+  testkit.window->Update(candidates);
+
+  FinalizeTestKit(&testkit);
+}
+
 TEST_F(CandidateWindowTest, UpdateGap1SizeTest) {
   CandidateWindowTestKit testkit = SetUpCandidateWindow();
 
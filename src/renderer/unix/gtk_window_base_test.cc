@@ -220,6 +220,23 @@ TEST_F(GtkWindowBaseTest, RedrawTest) {
   window.Redraw();
 }
 
+TEST_F(GtkWindowBaseTest, RedrawRectTest) {
+  GtkWrapperMock *mock = GetGtkMock();
+
+  const Rect rect(10, 20, 30, 40);
+
+  EXPECT_CALL(*mock, GtkWidgetQueueDrawArea(kDummyWindow,
+                                            rect.Left(),
+                                            rect.Top(),
+                                            rect.Width(),
+                                            rect.Height()));
+
+  GtkWindowBase window(mock);
+  window.RedrawRect(rect);
+  // An empty rect is not queued.
+  window.RedrawRect(Rect(10, 20, 0, 0));
+}
+
 class OverriddenCallTestableGtkWindowBase : public GtkWindowBase {
  public:
   explicit OverriddenCallTestableGtkWindowBase(GtkWrapperInterface *gtk)
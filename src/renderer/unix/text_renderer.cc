@@ -36,6 +36,10 @@
 namespace mozc {
 namespace renderer {
 namespace gtk {
+namespace {
+// The cache is cleared when it grows beyond this size.
+const size_t kMaxPixelSizeCacheSize = 1024;
+}  // namespace
 
 TextRenderer::TextRenderer(FontSpecInterface *font_spec)
   : font_spec_(font_spec),
@@ -44,6 +48,7 @@ TextRenderer::TextRenderer(FontSpecInterface *font_spec)
 
 void TextRenderer::Initialize(GdkDrawable *drawable) {
   pango_.reset(new PangoWrapper(drawable));
+  pixel_size_cache_.clear();
 }
 
 void TextRenderer::SetUpPangoLayout(const string &str,
@@ -67,8 +72,19 @@ Size TextRenderer::GetPixelSize(FontSpecInterface::FONT_TYPE font_type,
 Size TextRenderer::GetPixelSizeInternal(FontSpecInterface::FONT_TYPE font_type,
                                         const string &str,
                                         PangoLayoutWrapperInterface *layout) {
+  const std::pair<FontSpecInterface::FONT_TYPE, string> key(font_type, str);
+  std::map<std::pair<FontSpecInterface::FONT_TYPE, string>, Size>::
+      const_iterator it = pixel_size_cache_.find(key);
+  if (it != pixel_size_cache_.end()) {
+    return it->second;
+  }
   SetUpPangoLayout(str, font_type, layout);
-  return layout->GetPixelSize();
+  const Size size = layout->GetPixelSize();
+  if (pixel_size_cache_.size() >= kMaxPixelSizeCacheSize) {
+    pixel_size_cache_.clear();
+  }
+  pixel_size_cache_.insert(std::make_pair(key, size));
+  return size;
 }
 
 Size TextRenderer::GetMultiLinePixelSize(FontSpecInterface::FONT_TYPE font_type,
@@ -113,6 +129,7 @@ void TextRenderer::RenderTextInternal(const string& text,
 
 void TextRenderer::ReloadFontConfig(const string &font_description) {
   font_spec_->Reload(font_description);
+  pixel_size_cache_.clear();
 }
 }  // namespace gtk
 }  // namespace renderer
@@ -32,7 +32,10 @@
 
 #include <gtk/gtk.h>
 
+#include <map>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include "base/port.h"
 #include "renderer/unix/font_spec_interface.h"
@@ -67,6 +70,7 @@ class TextRenderer : public TextRendererInterface {
   FRIEND_TEST(TextRendererTest, GetPixelSizeTest);
   FRIEND_TEST(TextRendererTest, GetMultilinePixelSizeTest);
   FRIEND_TEST(TextRendererTest, RenderTextTest);
+  FRIEND_TEST(TextRendererTest, GetPixelSizeCacheTest);
 
   void SetUpPangoLayout(const string &str,
                         FontSpecInterface::FONT_TYPE font_type,
@@ -85,6 +89,11 @@ class TextRenderer : public TextRendererInterface {
   std::unique_ptr<FontSpecInterface> font_spec_;
   std::unique_ptr<PangoWrapperInterface> pango_;
 
+  // The pixel sizes of the strings measured with the current fonts.  Most
+  // of the candidates do not change between the updates of the window.
+  std::map<std::pair<FontSpecInterface::FONT_TYPE, string>, Size>
+      pixel_size_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(TextRenderer);
 };
 
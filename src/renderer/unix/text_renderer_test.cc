@@ -134,6 +134,36 @@ TEST_F(TextRendererTest, GetPixelSizeTest) {
   EXPECT_EQ(actual_size.height, size.height);
 }
 
+TEST_F(TextRendererTest, GetPixelSizeCacheTest) {
+  FontSpecMock *font_spec_mock = new FontSpecMock();
+  TextRenderer text_renderer(font_spec_mock);
+  SetUpPangoMock(&text_renderer);
+
+  const string text = "hogehoge";
+  PangoLayoutWrapperMock layout_mock;
+  const Size size(12, 34);
+
+  // The second measurement of the same string in the same font is cached.
+  EXPECT_CALL(layout_mock, GetPixelSize())
+      .Times(3)
+      .WillRepeatedly(Return(size));
+  EXPECT_CALL(*font_spec_mock, Reload("Foo"));
+
+  for (int i = 0; i < 2; ++i) {
+    const Size actual_size = text_renderer.GetPixelSizeInternal(
+        FontSpecInterface::FONTSET_FOOTER_LABEL, text, &layout_mock);
+    EXPECT_EQ(size.width, actual_size.width);
+    EXPECT_EQ(size.height, actual_size.height);
+  }
+  text_renderer.GetPixelSizeInternal(
+      FontSpecInterface::FONTSET_CANDIDATE, text, &layout_mock);
+
+  // Reloading the fonts clears the cache.
+  text_renderer.ReloadFontConfig("Foo");
+  text_renderer.GetPixelSizeInternal(
+      FontSpecInterface::FONTSET_FOOTER_LABEL, text, &layout_mock);
+}
+
 TEST_F(TextRendererTest, GetMultilinePixelSizeTest) {
   FontSpecMock *font_spec_mock = new FontSpecMock();
   TextRenderer text_renderer(font_spec_mock);
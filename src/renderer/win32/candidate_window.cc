@@ -40,6 +40,7 @@
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_style_handler.h"
 #include "renderer/table_layout.h"
+#include "renderer/table_layout_cache.h"
 #include "renderer/win32/text_renderer.h"
 #include "renderer/win_resource.h"
 
@@ -238,6 +239,7 @@ CandidateWindow::CandidateWindow()
       mouse_moving_(true),
       text_renderer_(TextRenderer::Create()),
       table_layout_(new TableLayout),
+      table_layout_cache_(new TableLayoutCache),
       send_command_interface_(nullptr) {
   double scale_factor_x = 1.0;
   double scale_factor_y = 1.0;
@@ -449,6 +451,7 @@ void CandidateWindow::UpdateLayout(const commands::Candidates &candidates) {
   // If we detect any change of font parameters, update text renderer
   if (metrics_changed_) {
     text_renderer_->OnThemeChanged();
+    table_layout_cache_->Clear();
     metrics_changed_ = false;
   }
 
@@ -464,6 +467,12 @@ void CandidateWindow::UpdateLayout(const commands::Candidates &candidates) {
       return;
   }
 
+  // Moving the focus does not change the layout in most cases.
+  const uint64 layout_key = TableLayoutCache::GetKey(*candidates_);
+  if (table_layout_cache_->Lookup(layout_key, table_layout_.get())) {
+    return;
+  }
+
   table_layout_->Initialize(candidates_->candidate_size(), NUMBER_OF_COLUMNS);
 
   table_layout_->SetWindowBorder(kWindowBorder);
@@ -607,6 +616,7 @@ void CandidateWindow::UpdateLayout(const commands::Candidates &candidates) {
   table_layout_->EnsureCellSize(COLUMN_GAP2, gap2_size);
 
   table_layout_->FreezeLayout();
+  table_layout_cache_->Insert(layout_key, *table_layout_);
 }
 
 void CandidateWindow::SetSendCommandInterface(
@@ -60,6 +60,7 @@ class Candidates;
 namespace renderer {
 
 class TableLayout;
+class TableLayoutCache;
 
 namespace win32 {
 
@@ -150,6 +151,7 @@ class CandidateWindow : public ATL::CWindowImpl<CandidateWindow,
   Size footer_logo_display_size_;
   client::SendCommandInterface *send_command_interface_;
   std::unique_ptr<TableLayout> table_layout_;
+  std::unique_ptr<TableLayoutCache> table_layout_cache_;
   std::unique_ptr<TextRenderer> text_renderer_;
   int indicator_width_;
   bool metrics_changed_;
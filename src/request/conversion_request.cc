@@ -29,6 +29,7 @@
 
 #include "request/conversion_request.h"
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
@@ -42,7 +43,8 @@ ConversionRequest::ConversionRequest()
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
-      create_partial_candidates_(false) {}
+      create_partial_candidates_(false),
+      deadline_ticks_(0) {}
 
 ConversionRequest::ConversionRequest(const composer::Composer *c,
                                      const commands::Request *request,
@@ -53,7 +55,8 @@ ConversionRequest::ConversionRequest(const composer::Composer *c,
       use_actual_converter_for_realtime_conversion_(false),
       composer_key_selection_(CONVERSION_KEY),
       skip_slow_rewriters_(false),
-      create_partial_candidates_(false) {}
+      create_partial_candidates_(false),
+      deadline_ticks_(0) {}
 
 ConversionRequest::~ConversionRequest() {}
 
@@ -128,6 +131,22 @@ bool ConversionRequest::IsKanaModifierInsensitiveConversion() const {
          config_->use_kana_modifier_insensitive_conversion();
 }
 
+uint64 ConversionRequest::deadline_ticks() const {
+  return deadline_ticks_;
+}
+
+void ConversionRequest::set_deadline_ticks(uint64 ticks) {
+  deadline_ticks_ = ticks;
+}
+
+void ConversionRequest::SetLatencyBudget(uint32 msec) {
+  deadline_ticks_ = Clock::GetTicks() + Clock::GetFrequency() * msec / 1000;
+}
+
+bool ConversionRequest::IsDeadlinePassed() const {
+  return deadline_ticks_ > 0 && Clock::GetTicks() >= deadline_ticks_;
+}
+
 void ConversionRequest::CopyFrom(const ConversionRequest &request) {
   composer_ = request.composer_;
   request_ = request.request_;
@@ -137,6 +156,7 @@ void ConversionRequest::CopyFrom(const ConversionRequest &request) {
   composer_key_selection_ = request.composer_key_selection_;
   skip_slow_rewriters_ = request.skip_slow_rewriters_;
   create_partial_candidates_ = request.create_partial_candidates_;
+  deadline_ticks_ = request.deadline_ticks_;
 }
 
 }  // namespace mozc
@@ -107,6 +107,18 @@ class ConversionRequest {
 
   bool IsKanaModifierInsensitiveConversion() const;
 
+  // Deadline of the request in Clock ticks; 0 (the default) means no deadline.
+  // After the deadline, predictors skip or cut short their expensive stages;
+  // see Segments::skipped_prediction_stages().
+  uint64 deadline_ticks() const;
+  void set_deadline_ticks(uint64 ticks);
+
+  // Sets the deadline |msec| milliseconds after now.
+  void SetLatencyBudget(uint32 msec);
+
+  // Returns true if the deadline is set and has passed.
+  bool IsDeadlinePassed() const;
+
  private:
   // Required fields
   // Input composer to generate a key for conversion, suggestion, etc.
@@ -137,6 +149,9 @@ class ConversionRequest {
   // For example, "私の" is created from composition "わたしのなまえ".
   bool create_partial_candidates_;
 
+  // See deadline_ticks().
+  uint64 deadline_ticks_;
+
   // TODO(noriyukit): Moves all the members of Segments that are irrelevant to
   // this structure, e.g., Segments::user_history_enabled_ and
   // Segments::request_type_. Also, a key for conversion is eligible to live in
@@ -41,12 +41,14 @@
 #include <string.h>
 
 #include <cmath>
-#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/number_util.h"
 #include "base/singleton.h"
 #include "base/string_piece.h"
@@ -68,6 +70,54 @@ bool IsFinite(double x) {
 namespace mozc {
 namespace {
 
+// "＝"
+const char kFullWidthEqual[] = "\xEF\xBC\x9D";
+
+// Returns true if |key| starts or ends with '=' or "＝", which every
+// expression does.  This rejects most keys, e.g., those of plain text typed
+// for suggestion, without normalizing them.
+bool MayBeExpression(const string &key) {
+  return key.front() == '=' || key.back() == '=' ||
+         Util::StartsWith(key, kFullWidthEqual) ||
+         Util::EndsWith(key, kFullWidthEqual);
+}
+
+// Gets the operator token at |current| into |token_type| and its byte length
+// into |length|.  Returns false if there is no operator at |current|.
+bool GetOperator(const char *current, const char *end,
+                 int *token_type, size_t *length) {
+  switch (*current) {
+    case '+': *token_type = PLUS; break;
+    case '-': *token_type = MINUS; break;
+    case '*': *token_type = TIMES; break;
+    case '/': *token_type = DIVIDE; break;
+    case '%': *token_type = MOD; break;
+    case '^': *token_type = POW; break;
+    case '(': *token_type = LP; break;
+    case ')': *token_type = RP; break;
+    default: {
+      if (end - current < 3) {
+        return false;
+      }
+      const StringPiece window(current, 3);
+      // "ー". It is called cho-ompu, onbiki, bobiki, or "nobashi-bou"
+      // casually.  It is not a full-width hyphen, and may appear in
+      // conversion segments by typing '-' more than one time continuouslly.
+      if (window == "\xE3\x83\xBC") {
+        *token_type = MINUS;
+      } else if (window == "\xE3\x83\xBB") {  // "・". Consider it as "/".
+        *token_type = DIVIDE;
+      } else {
+        return false;
+      }
+      *length = 3;
+      return true;
+    }
+  }
+  *length = 1;
+  return true;
+}
+
 class CalculatorImpl : public CalculatorInterface {
  public:
   CalculatorImpl();
@@ -77,9 +127,15 @@ class CalculatorImpl : public CalculatorInterface {
  private:
   typedef std::vector<std::pair<int, double> > TokenSequence;
 
-  // Max byte length of operator character
-  static const size_t kMaxLengthOfOperator = 3;
   static const size_t kBufferSizeOfOutputNumber = 32;
+  static const size_t kCacheSize = 8;
+
+  // Calculation result of an expression body.  |result| is empty if the
+  // calculation failed.
+  struct CacheEntry {
+    string expression_body;
+    string result;
+  };
 
   // Tokenizes |expression_body| and sets the tokens into |tokens|.
   // It returns false if |expression_body| includes an invalid token or
@@ -91,26 +147,22 @@ class CalculatorImpl : public CalculatorInterface {
   bool CalculateTokens(const TokenSequence &tokens,
                        double *result_value) const;
 
-  // Mapping from operator character such as '+' to the corresponding
-  // token type such as PLUS.
-  std::map<string, int> operator_map_;
+  // Calculates |expression_body| into |result|.
+  bool CalculateExpression(StringPiece expression_body, string *result) const;
+
+  bool LookupCache(StringPiece expression_body, string *result,
+                   bool *success) const;
+  void InsertCache(StringPiece expression_body, const string &result) const;
+
+  // The results of the last few expressions.  The same expression is
+  // calculated again and again, e.g., for suggestion and then conversion, or
+  // while the segments are merged.
+  mutable Mutex cache_mutex_;
+  mutable std::vector<CacheEntry> cache_;
+  mutable size_t next_cache_index_;
 };
 
-CalculatorImpl::CalculatorImpl() {
-  operator_map_["+"] = PLUS;
-  operator_map_["-"] = MINUS;
-  // "ー". It is called cho-ompu, onbiki, bobiki, or "nobashi-bou" casually.
-  // It is not a full-width hyphen, and may appear in conversion segments by
-  // typing '-' more than one time continuouslly.
-  operator_map_["\xE3\x83\xBC"] = MINUS;
-  operator_map_["*"] = TIMES;
-  operator_map_["/"] = DIVIDE;
-  operator_map_["\xE3\x83\xBB"] = DIVIDE;  // "･". Consider it as "/".
-  operator_map_["%"] = MOD;
-  operator_map_["^"] = POW;
-  operator_map_["("] = LP;
-  operator_map_[")"] = RP;
-}
+CalculatorImpl::CalculatorImpl() : next_cache_index_(0) {}
 
 // Basic arithmetic operations are available.
 // TODO(tok): Add more number of operators.
@@ -120,6 +172,10 @@ bool CalculatorImpl::CalculateString(const string &key, string *result) const {
     LOG(ERROR) << "Key is empty.";
     return false;
   }
+  if (!MayBeExpression(key)) {
+    result->clear();
+    return false;
+  }
   string normalized_key;
   Util::FullWidthAsciiToHalfWidthAscii(key, &normalized_key);
 
@@ -136,6 +192,17 @@ bool CalculatorImpl::CalculateString(const string &key, string *result) const {
     return false;
   }
 
+  bool success = false;
+  if (LookupCache(expression_body, result, &success)) {
+    return success;
+  }
+  success = CalculateExpression(expression_body, result);
+  InsertCache(expression_body, *result);
+  return success;
+}
+
+bool CalculatorImpl::CalculateExpression(StringPiece expression_body,
+                                         string *result) const {
   TokenSequence tokens;
   if (!Tokenize(expression_body, &tokens)) {
     // normalized_key is not valid sequence of tokens
@@ -156,6 +223,31 @@ bool CalculatorImpl::CalculateString(const string &key, string *result) const {
   return true;
 }
 
+bool CalculatorImpl::LookupCache(StringPiece expression_body, string *result,
+                                 bool *success) const {
+  scoped_lock l(&cache_mutex_);
+  for (const CacheEntry &entry : cache_) {
+    if (entry.expression_body == expression_body) {
+      *result = entry.result;
+      *success = !result->empty();
+      return true;
+    }
+  }
+  return false;
+}
+
+void CalculatorImpl::InsertCache(StringPiece expression_body,
+                                 const string &result) const {
+  scoped_lock l(&cache_mutex_);
+  if (cache_.size() < kCacheSize) {
+    cache_.emplace_back();
+  }
+  CacheEntry &entry = cache_[next_cache_index_];
+  next_cache_index_ = (next_cache_index_ + 1) % kCacheSize;
+  expression_body.CopyToString(&entry.expression_body);
+  entry.result = result;
+}
+
 bool CalculatorImpl::Tokenize(StringPiece expression_body,
                               TokenSequence *tokens) const {
   const char *current = expression_body.data();
@@ -178,7 +270,7 @@ bool CalculatorImpl::Tokenize(StringPiece expression_body,
       ++current;
     }
     if (token_begin < current) {
-      string number_token(token_begin, current - token_begin);
+      const StringPiece number_token(token_begin, current - token_begin);
       double value = 0.0;
       if (!NumberUtil::SafeStrToDouble(number_token, &value)) {
         return false;
@@ -189,30 +281,19 @@ bool CalculatorImpl::Tokenize(StringPiece expression_body,
     }
 
     // Read operator token
-    for (size_t length = 1; length <= kMaxLengthOfOperator; ++length) {
-      if (current + length > end) {
-        // Invalid token
-        return false;
-      }
-      string window(current, length);
-      std::map<string, int>::const_iterator op_it = operator_map_.find(window);
-      if (op_it == operator_map_.end()) {
-        continue;
-      }
-      tokens->push_back(std::make_pair(op_it->second, 0.0));
-      current += length;
-      // Does not count parenthesis as an operator.
-      if ((op_it->second != LP) && (op_it->second != RP)) {
-        ++num_operator;
-      }
-      break;
+    int token_type = 0;
+    size_t length = 0;
+    if (current >= end ||
+        !GetOperator(current, end, &token_type, &length)) {
+      // Invalid token
+      return false;
     }
-    if (token_begin < current) {
-      continue;
+    tokens->push_back(std::make_pair(token_type, 0.0));
+    current += length;
+    // Does not count parenthesis as an operator.
+    if ((token_type != LP) && (token_type != RP)) {
+      ++num_operator;
     }
-
-    // Invalid token
-    return false;
   }
 
   if (num_operator == 0 || num_value == 0) {
@@ -241,6 +322,9 @@ bool CalculatorImpl::CalculateTokens(const TokenSequence &tokens,
 }
 
 CalculatorInterface *g_calculator = NULL;
+
+const bool kCalculatorRegistered = SingletonInitializer::Register(
+    "Calculator", &InitSingleton<CalculatorImpl>);
 }  // namespace
 
 CalculatorInterface *CalculatorFactory::GetCalculator() {
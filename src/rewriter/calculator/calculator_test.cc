@@ -35,6 +35,7 @@
 #include "base/compiler_specific.h"
 #include "base/file_util.h"
 #include "base/logging.h"
+#include "base/number_util.h"
 #include "rewriter/calculator/calculator_interface.h"
 #include "testing/base/public/gunit.h"
 #include "testing/base/public/mozctest.h"
@@ -80,6 +81,24 @@ void VerifyRejection(const CalculatorInterface *calculator,
 
 }  // namespace
 
+TEST(CalculatorTest, RepeatedCalculation) {
+  CalculatorInterface *calculator = CalculatorFactory::GetCalculator();
+
+  // The same expressions calculated again, also after more expressions than
+  // the calculator caches, give the same results, including failures.
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 1; i <= 20; ++i) {
+      const string number = NumberUtil::SimpleItoa(i);
+      VerifyCalculationInString(calculator, number + "*2=",
+                                NumberUtil::SimpleItoa(i * 2));
+      VerifyRejection(calculator, number + "/0=");
+    }
+    VerifyCalculationInString(calculator, "1+1=", "2");
+    VerifyCalculationInString(calculator, "=1+1", "2");
+    VerifyRejection(calculator, "1+1");
+  }
+}
+
 TEST(CalculatorTest, BasicTest) {
   CalculatorInterface *calculator = CalculatorFactory::GetCalculator();
 
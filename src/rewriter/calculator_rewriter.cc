@@ -63,8 +63,8 @@ int CalculatorRewriter::capability(const ConversionRequest &request) const {
 // expression that can be calculated. In such case, if |segments| consists
 // of multiple segments, it merges them by calling ConverterInterface::
 // ResizeSegment(), otherwise do calculation and insertion.
-// TODO(tok): It currently calculates same expression twice, if |segments| is
-//            a valid expression.
+// If |segments| is a valid expression, the same expression is calculated
+// twice, the second time from the cache of the calculator.
 bool CalculatorRewriter::Rewrite(const ConversionRequest &request,
                                  Segments *segments) const {
   if (!request.config().use_calculator()) {
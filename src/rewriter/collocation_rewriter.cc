@@ -541,15 +541,30 @@ class CollocationRewriter::CollocationFilter {
   ~CollocationFilter() {
   }
 
-  bool Exists(const string &left, const string &right) const {
-    if (left.empty() || right.empty()) {
-      return false;
-    }
+  // Returns the smallest i such that the collocation |left| + |rights[i]|
+  // exists, or -1 if there is none.  The filter is looked up at once for all
+  // the pairs, whose keys are built in a single buffer.
+  int FindFirst(const string &left, const std::vector<string> &rights) const {
+    if (left.empty() || rights.empty()) {
+      return -1;
+    }
+    const size_t size = rights.size();
+    std::vector<uint64> ids(size);
     string key;
-    key.reserve(left.size() + right.size());
-    key.assign(left).append(right);
-    const uint64 id = Hash::Fingerprint(key);
-    return filter_->Exists(id);
+    key.assign(left);
+    for (size_t i = 0; i < size; ++i) {
+      key.resize(left.size());
+      key.append(rights[i]);
+      ids[i] = Hash::Fingerprint(key);
+    }
+    std::unique_ptr<bool[]> exists(new bool[size]);
+    filter_->ExistsMany(ids.data(), size, exists.get());
+    for (size_t i = 0; i < size; ++i) {
+      if (exists[i] && !rights[i].empty()) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
   }
 
  private:
@@ -567,16 +582,31 @@ class CollocationRewriter::SuppressionFilter {
   }
 
   bool Exists(const Segment::Candidate &cand) const {
-    // TODO(noriyukit): We should share key generation rule with
-    // gen_collocation_suppression_data_main.cc.
     string key;
-    key.reserve(cand.content_value.size() + 1 + cand.content_key.size());
-    key.assign(cand.content_value).append("\t").append(cand.content_key);
-    const uint64 id = Hash::Fingerprint(key);
-    return filter_->Exists(id);
+    return filter_->Exists(GetId(cand, &key));
+  }
+
+  // Sets exists[i] to Exists(seg.candidate(i)) for i < size, looking up the
+  // filter at once.
+  void ExistsMany(const Segment &seg, size_t size, bool *exists) const {
+    DCHECK_LE(size, kCandidateSize);
+    uint64 ids[kCandidateSize];
+    string key;
+    for (size_t i = 0; i < size; ++i) {
+      ids[i] = GetId(seg.candidate(i), &key);
+    }
+    filter_->ExistsMany(ids, size, exists);
   }
 
  private:
+  // |key| is a buffer reused across calls.
+  static uint64 GetId(const Segment::Candidate &cand, string *key) {
+    // TODO(noriyukit): We should share key generation rule with
+    // gen_collocation_suppression_data_main.cc.
+    key->assign(cand.content_value).append("\t").append(cand.content_key);
+    return Hash::Fingerprint(*key);
+  }
+
   std::unique_ptr<ExistenceFilter> filter_;
 
   DISALLOW_COPY_AND_ASSIGN(SuppressionFilter);
@@ -621,9 +651,12 @@ bool CollocationRewriter::RewriteFromPrevSegment(
 
   const size_t i_max = min(seg->candidates_size(), kCandidateSize);
 
-  // Reuse |curs| and |cur| in the loop as this method is performance critical.
-  std::vector<string> curs;
-  string cur;
+  bool suppressed[kCandidateSize];
+  suppression_filter_->ExistsMany(*seg, i_max, suppressed);
+
+  // Reuse |curs| and |normalized_curs| in the loop as this method is
+  // performance critical.
+  std::vector<string> curs, normalized_curs;
   for (size_t i = 0; i < i_max; ++i) {
     if (seg->candidate(i).cost > seg->candidate(0).cost + kMaxCostDiff) {
       continue;
@@ -631,7 +664,7 @@ bool CollocationRewriter::RewriteFromPrevSegment(
     if (IsName(seg->candidate(i))) {
       continue;
     }
-    if (suppression_filter_->Exists(seg->candidate(i))) {
+    if (suppressed[i]) {
       continue;
     }
     curs.clear();
@@ -639,18 +672,20 @@ bool CollocationRewriter::RewriteFromPrevSegment(
       continue;
     }
 
-    for (int j = 0; j < curs.size(); ++j) {
-      cur.clear();
-      CollocationUtil::GetNormalizedScript(curs[j], false, &cur);
-      if (collocation_filter_->Exists(prev, cur)) {
-        VLOG_IF(3, i != 0) << prev << cur << " "
-                           << seg->candidate(0).value << "->"
-                           << seg->candidate(i).value;
-        seg->move_candidate(i, 0);
-        seg->mutable_candidate(0)->attributes
-            |= Segment::Candidate::CONTEXT_SENSITIVE;
-        return true;
-      }
+    normalized_curs.resize(curs.size());
+    for (size_t j = 0; j < curs.size(); ++j) {
+      normalized_curs[j].clear();
+      CollocationUtil::GetNormalizedScript(curs[j], false, &normalized_curs[j]);
+    }
+    const int found = collocation_filter_->FindFirst(prev, normalized_curs);
+    if (found >= 0) {
+      VLOG_IF(3, i != 0) << prev << normalized_curs[found] << " "
+                         << seg->candidate(0).value << "->"
+                         << seg->candidate(i).value;
+      seg->move_candidate(i, 0);
+      seg->mutable_candidate(0)->attributes
+          |= Segment::Candidate::CONTEXT_SENSITIVE;
+      return true;
     }
   }
   return false;
@@ -661,19 +696,26 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
   const size_t i_max = min(seg->candidates_size(), kCandidateSize);
   const size_t j_max = min(next_seg->candidates_size(), kCandidateSize);
 
-  // Cache the results for the next segment
-  std::vector<int> next_seg_ok(j_max);  // Avoiding vector<bool>
-  std::vector<std::vector<string> > normalized_string(j_max);
+  // Cache the normalized contents of the next segment which can make a
+  // collocation, in the order of candidates.  |next_index[n]| is the index of
+  // the candidate from which |normalized_nexts[n]| comes.
+  std::vector<string> normalized_nexts;
+  std::vector<size_t> next_index;
+
+  bool suppressed_next[kCandidateSize];
+  suppression_filter_->ExistsMany(*next_seg, j_max, suppressed_next);
 
   // Reuse |nexts| in the loop as this method is performance critical.
   std::vector<string> nexts;
   for (size_t j = 0; j < j_max; ++j) {
-    next_seg_ok[j] = 0;
-
+    if (next_seg->candidate(j).cost >
+        next_seg->candidate(0).cost + kMaxCostDiff) {
+      continue;
+    }
     if (IsName(next_seg->candidate(j))) {
       continue;
     }
-    if (suppression_filter_->Exists(next_seg->candidate(j))) {
+    if (suppressed_next[j]) {
       continue;
     }
     nexts.clear();
@@ -682,14 +724,20 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
       continue;
     }
 
-    next_seg_ok[j] = 1;
     for (std::vector<string>::const_iterator it = nexts.begin();
          it != nexts.end(); ++it) {
-      normalized_string[j].push_back(string());
+      normalized_nexts.push_back(string());
       CollocationUtil::GetNormalizedScript(
-          *it, false, &normalized_string[j].back());
+          *it, false, &normalized_nexts.back());
+      next_index.push_back(j);
     }
   }
+  if (normalized_nexts.empty()) {
+    return false;
+  }
+
+  bool suppressed_cur[kCandidateSize];
+  suppression_filter_->ExistsMany(*seg, i_max, suppressed_cur);
 
   // Reuse |curs| and |cur| in the loop as this method is performance critical.
   std::vector<string> curs;
@@ -701,7 +749,7 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
     if (IsName(seg->candidate(i))) {
       continue;
     }
-    if (suppression_filter_->Exists(seg->candidate(i))) {
+    if (suppressed_cur[i]) {
       continue;
     }
     curs.clear();
@@ -712,31 +760,21 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
     for (int k = 0; k < curs.size(); ++k) {
       cur.clear();
       CollocationUtil::GetNormalizedScript(curs[k], true, &cur);
-      for (size_t j = 0; j < j_max; ++j) {
-        if (next_seg->candidate(j).cost >
-            next_seg->candidate(0).cost + kMaxCostDiff) {
-          continue;
-        }
-        if (!next_seg_ok[j]) {
-          continue;
-        }
-
-        for (int l = 0; l < normalized_string[j].size(); ++l) {
-          const string &next = normalized_string[j][l];
-          if (collocation_filter_->Exists(cur, next)) {
-            DCHECK(VerifyNaturalContent(
-                next_seg->candidate(j), next_seg->candidate(0), RIGHT))
-                << "IsNaturalContent() should not fail here.";
-            seg->move_candidate(i, 0);
-            seg->mutable_candidate(0)->attributes
-                |= Segment::Candidate::CONTEXT_SENSITIVE;
-            next_seg->move_candidate(j, 0);
-            next_seg->mutable_candidate(0)->attributes
-                |= Segment::Candidate::CONTEXT_SENSITIVE;
-            return true;
-          }
-        }
+      const int found = collocation_filter_->FindFirst(cur, normalized_nexts);
+      if (found < 0) {
+        continue;
       }
+      const size_t j = next_index[found];
+      DCHECK(VerifyNaturalContent(
+          next_seg->candidate(j), next_seg->candidate(0), RIGHT))
+          << "IsNaturalContent() should not fail here.";
+      seg->move_candidate(i, 0);
+      seg->mutable_candidate(0)->attributes
+          |= Segment::Candidate::CONTEXT_SENSITIVE;
+      next_seg->move_candidate(j, 0);
+      next_seg->mutable_candidate(0)->attributes
+          |= Segment::Candidate::CONTEXT_SENSITIVE;
+      return true;
     }
   }
   return false;
@@ -64,6 +64,21 @@ bool CorrectionRewriter::LookupCorrection(
   CHECK(results);
   results->clear();
 
+  if (!value.empty() && !hash_index_.empty()) {
+    // The slot of "key\tvalue" gives the first entry of the pair if any.
+    string hash_key;
+    hash_key.reserve(key.size() + 1 + value.size());
+    hash_key.append(key).append(1, '\t').append(value);
+    for (size_t i = hash_index_.Lookup(hash_key);
+         i < error_array_.size() && error_array_[i] == key &&
+         value_array_[i] == value;
+         ++i) {
+      results->emplace_back(value_array_[i], error_array_[i],
+                            correction_array_[i]);
+    }
+    return !results->empty();
+  }
+
   using Iter = SerializedStringArray::const_iterator;
   std::pair<Iter, Iter> range = std::equal_range(error_array_.begin(),
                                             error_array_.end(),
@@ -80,7 +95,14 @@ bool CorrectionRewriter::LookupCorrection(
 
 CorrectionRewriter::CorrectionRewriter(StringPiece value_array_data,
                                        StringPiece error_array_data,
-                                       StringPiece correction_array_data) {
+                                       StringPiece correction_array_data)
+    : CorrectionRewriter(value_array_data, error_array_data,
+                         correction_array_data, StringPiece()) {}
+
+CorrectionRewriter::CorrectionRewriter(StringPiece value_array_data,
+                                       StringPiece error_array_data,
+                                       StringPiece correction_array_data,
+                                       StringPiece hash_index_data) {
   DCHECK(SerializedStringArray::VerifyData(value_array_data));
   DCHECK(SerializedStringArray::VerifyData(error_array_data));
   DCHECK(SerializedStringArray::VerifyData(correction_array_data));
@@ -89,6 +111,11 @@ CorrectionRewriter::CorrectionRewriter(StringPiece value_array_data,
   correction_array_.Set(correction_array_data);
   DCHECK_EQ(value_array_.size(), error_array_.size());
   DCHECK_EQ(value_array_.size(), correction_array_.size());
+  if (!hash_index_data.empty() &&
+      !hash_index_.Init(hash_index_data, value_array_.size())) {
+    LOG(ERROR) << "Broken reading correction hash index; "
+               << "falling back to binary search";
+  }
 }
 
 // static
@@ -98,8 +125,10 @@ CorrectionRewriter *CorrectionRewriter::CreateCorrectionRewriter(
   data_manager->GetReadingCorrectionData(&value_array_data,
                                          &error_array_data,
                                          &correction_array_data);
+  StringPiece hash_index_data;
+  data_manager->GetReadingCorrectionHashIndexData(&hash_index_data);
   return new CorrectionRewriter(value_array_data, error_array_data,
-                                correction_array_data);
+                                correction_array_data, hash_index_data);
 }
 
 CorrectionRewriter::~CorrectionRewriter() {}
@@ -36,6 +36,7 @@
 
 #include "base/serialized_string_array.h"
 #include "base/string_piece.h"
+#include "data_manager/serialized_dictionary.h"
 #include "rewriter/rewriter_interface.h"
 
 namespace mozc {
@@ -54,6 +55,11 @@ class CorrectionRewriter : public RewriterInterface  {
 
   CorrectionRewriter(StringPiece value_array_data, StringPiece error_array_data,
                      StringPiece correction_array_data);
+  // With the optional hash index keyed by "error\tvalue".  If
+  // |hash_index_data| is empty or malformed, binary search is used instead.
+  CorrectionRewriter(StringPiece value_array_data, StringPiece error_array_data,
+                     StringPiece correction_array_data,
+                     StringPiece hash_index_data);
   ~CorrectionRewriter() override;
 
   bool Rewrite(const ConversionRequest &request,
@@ -91,6 +97,8 @@ class CorrectionRewriter : public RewriterInterface  {
   SerializedStringArray value_array_;
   SerializedStringArray error_array_;
   SerializedStringArray correction_array_;
+  // Optional; empty if not provided.
+  SerializedDictionary::HashIndex hash_index_;
 };
 
 }  // namespace mozc
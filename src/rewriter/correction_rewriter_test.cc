@@ -31,11 +31,13 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "base/serialized_string_array.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
+#include "data_manager/serialized_dictionary.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
@@ -135,4 +137,36 @@ TEST_F(CorrectionRewriterTest, RewriteTest) {
 
 }
 
+TEST_F(CorrectionRewriterTest, RewriteWithHashIndexTest) {
+  // Two values share the error "gekkyoku"; rows are sorted by (error, value).
+  const std::vector<StringPiece> values = {"GEKKYOKU2", "TSUKIGIME"};
+  const std::vector<StringPiece> errors = {"gekkyoku", "gekkyoku"};
+  const std::vector<StringPiece> corrections = {"gekkyoku2", "tsukigime"};
+  const std::vector<StringPiece> hash_keys = {"gekkyoku\tGEKKYOKU2",
+                                              "gekkyoku\tTSUKIGIME"};
+  std::unique_ptr<uint32[]> values_buf, errors_buf, corrections_buf;
+  std::vector<uint32> hash_index;
+  SerializedDictionary::HashIndex::Build(hash_keys, &hash_index);
+  CorrectionRewriter rewriter(
+      SerializedStringArray::SerializeToBuffer(values, &values_buf),
+      SerializedStringArray::SerializeToBuffer(errors, &errors_buf),
+      SerializedStringArray::SerializeToBuffer(corrections, &corrections_buf),
+      StringPiece(reinterpret_cast<const char *>(hash_index.data()),
+                  hash_index.size() * sizeof(uint32)));
+
+  Segments segments;
+  Segment *segment = AddSegment("gekkyokuwo", &segments);
+  AddCandidate("gekkyokuwo", "TSUKIGIMEwo", "gekkyoku", "TSUKIGIME", segment);
+  AddCandidate("gekkyokuwo", "GEKKYOKUwo", "gekkyoku", "GEKKYOKU", segment);
+  EXPECT_TRUE(rewriter.Rewrite(convreq_, &segments));
+
+  // "もしかして"
+  EXPECT_EQ(
+      "<\xE3\x82\x82\xE3\x81\x97\xE3\x81\x8B\xE3\x81\x97\xE3\x81\xA6: "
+      "tsukigime>",
+      segments.conversion_segment(0).candidate(0).description);
+  // "GEKKYOKU" is not in the data even though its error is.
+  EXPECT_TRUE(segments.conversion_segment(0).candidate(1).description.empty());
+}
+
 }  // namespace mozc
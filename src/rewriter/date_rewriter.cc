@@ -1614,6 +1614,34 @@ const char *kWeekDayString[] = {
   "\xE5\x9C\x9F",   // "土"
 };
 
+// Digits for kanji numerals under 100.  The empty string for zero is never
+// appended by AppendKanjiNumberUnder100().
+const char *const kKanjiDigits[] = {
+  // "", "一", "二", "三", "四", "五", "六", "七", "八", "九"
+  "", "\xe4\xb8\x80", "\xe4\xba\x8c", "\xe4\xb8\x89", "\xe5\x9b\x9b",
+  "\xe4\xba\x94", "\xe5\x85\xad", "\xe4\xb8\x83", "\xe5\x85\xab",
+  "\xe4\xb9\x9d",
+};
+
+// Appends the kanji numeral of |number| in [1, 99] to |output|, e.g., 23 ->
+// "二十三".  This is the NUMBER_KANJI style of NumberUtil::ArabicToKanji()
+// without building all the other styles.
+void AppendKanjiNumberUnder100(int number, string *output) {
+  DCHECK_GT(number, 0);
+  DCHECK_LT(number, 100);
+  const int tens = number / 10;
+  const int ones = number % 10;
+  if (tens > 0) {
+    if (tens > 1) {
+      output->append(kKanjiDigits[tens]);
+    }
+    output->append("\xe5\x8d\x81");  // "十"
+  }
+  if (ones > 0) {
+    output->append(kKanjiDigits[ones]);
+  }
+}
+
 // Converts a prefix and year number to Japanese Kanji Representation
 // arguments :
 //      - input "prefix" : a japanese style year counter prefix.
@@ -1635,19 +1663,8 @@ bool ExpandYear(const string &prefix, int year, std::vector<string> *result) {
   }
 
   result->push_back(prefix + NumberUtil::SimpleItoa(year));
-
-  string arabic = NumberUtil::SimpleItoa(year);
-
-  std::vector<NumberUtil::NumberString> output;
-
-  NumberUtil::ArabicToKanji(arabic, &output);
-
-  for (int i = 0; i < output.size(); i++) {
-    if (output[i].style == NumberUtil::NumberString::NUMBER_KANJI) {
-      result->push_back(prefix + output[i].value);
-    }
-  }
-
+  result->push_back(prefix);
+  AppendKanjiNumberUnder100(year, &result->back());
   return true;
 }
 
@@ -1680,31 +1697,28 @@ enum {
   REWRITE_DATE_AND_CURRENT_TIME
 };
 
+// |data| must be sorted by AD year.
 bool AdToEraForCourt(const YearData *data, int size,
                      int year, std::vector<string> *results) {
-  for (int i = size - 1; i >= 0; --i) {
-    if (i == size - 1 && year > data[i].ad) {
-      ExpandYear(data[i].era, year - data[i].ad + 1, results);
-      return true;
-    } else if (i > 0 && data[i-1].ad < year && year <= data[i].ad) {
-      // have two representations:
-      // 1989 -> "昭和64" and "平成元"
-      if (year == data[i].ad) {
-        ExpandYear(data[i].era, 1, results);
-      }
+  // The first era which starts in or after |year|.
+  const YearData *it = std::lower_bound(
+      data, data + size, year,
+      [](const YearData &year_data, int y) { return year_data.ad < y; });
+  const int i = static_cast<int>(it - data);
+  if (i < size && data[i].ad == year) {
+    // have two representations:
+    // 1989 -> "昭和64" and "平成元"
+    ExpandYear(data[i].era, 1, results);
+    if (i > 0) {
       ExpandYear(data[i - 1].era, year - data[i - 1].ad + 1, results);
-      return true;
-    } else if (i == 0 && data[i].ad <= year) {
-      if (year == data[i].ad) {
-        ExpandYear(data[i].era, 1, results);
-      } else {
-        ExpandYear(data[i - 1].era, year - data[i - 1].ad + 1, results);
-      }
-      return true;
     }
+    return true;
   }
-
-  return false;
+  if (i == 0) {
+    return false;
+  }
+  ExpandYear(data[i - 1].era, year - data[i - 1].ad + 1, results);
+  return true;
 }
 
 // "ねん"
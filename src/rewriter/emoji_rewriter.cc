@@ -208,6 +208,15 @@ EmojiRewriter::EmojiRewriter(const DataManagerInterface &data_manager) {
   data_manager.GetEmojiRewriterData(&token_array_data_, &string_array_data);
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
+  StringPiece unused_symbol_data, unused_emoticon_data, hash_index_data;
+  data_manager.GetRewriterHashIndexData(&unused_symbol_data,
+                                        &unused_emoticon_data,
+                                        &hash_index_data);
+  if (!hash_index_data.empty() &&
+      !hash_index_.Init(hash_index_data,
+                        token_array_data_.size() / kEmojiDataByteLength)) {
+    LOG(ERROR) << "Broken emoji hash index; falling back to binary search";
+  }
 }
 
 EmojiRewriter::~EmojiRewriter() = default;
@@ -266,6 +275,23 @@ bool EmojiRewriter::IsEmojiCandidate(const Segment::Candidate &candidate) {
 
 std::pair<EmojiRewriter::EmojiDataIterator, EmojiRewriter::EmojiDataIterator>
 EmojiRewriter::LookUpToken(StringPiece key) const {
+  if (!hash_index_.empty()) {
+    // The slot gives the first token of |key| if |key| is in the dictionary.
+    const EmojiDataIterator first(
+        token_array_data_.data() +
+        hash_index_.Lookup(key) * kEmojiDataByteLength);
+    const uint32 key_index = first.key_index();
+    if (key_index >= string_array_.size() || string_array_[key_index] != key) {
+      return std::pair<EmojiDataIterator, EmojiDataIterator>(end(), end());
+    }
+    EmojiDataIterator last = first;
+    const EmojiDataIterator end_iter = end();
+    while (last != end_iter && last.key_index() == key_index) {
+      ++last;
+    }
+    return std::pair<EmojiDataIterator, EmojiDataIterator>(first, last);
+  }
+
   // Search string array for key.
   auto iter = std::lower_bound(string_array_.begin(), string_array_.end(), key);
   if (iter == string_array_.end() || *iter != key) {
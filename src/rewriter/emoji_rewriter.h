@@ -38,6 +38,7 @@
 #include "base/string_piece.h"
 #include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
+#include "data_manager/serialized_dictionary.h"
 #include "rewriter/rewriter_interface.h"
 
 namespace mozc {
@@ -261,6 +262,9 @@ class EmojiRewriter : public RewriterInterface {
 
   StringPiece token_array_data_;
   SerializedStringArray string_array_;
+  // Optional index from a reading to its first token.  Empty if the data set
+  // doesn't have it, in which case LookUpToken() falls back to binary search.
+  SerializedDictionary::HashIndex hash_index_;
 
   DISALLOW_COPY_AND_ASSIGN(EmojiRewriter);
 };
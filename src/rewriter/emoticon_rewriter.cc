@@ -226,14 +226,22 @@ std::unique_ptr<EmoticonRewriter> EmoticonRewriter::CreateFromDataManager(
     const DataManagerInterface &data_manager) {
   StringPiece token_array_data, string_array_data;
   data_manager.GetEmoticonRewriterData(&token_array_data, &string_array_data);
-  return std::unique_ptr<EmoticonRewriter>(
-      new EmoticonRewriter(token_array_data, string_array_data));
+  StringPiece unused_symbol_data, hash_index_data, unused_emoji_data;
+  data_manager.GetRewriterHashIndexData(&unused_symbol_data, &hash_index_data,
+                                        &unused_emoji_data);
+  return std::unique_ptr<EmoticonRewriter>(new EmoticonRewriter(
+      token_array_data, string_array_data, hash_index_data));
 }
 
 EmoticonRewriter::EmoticonRewriter(StringPiece token_array_data,
                                    StringPiece string_array_data)
     : dic_(token_array_data, string_array_data) {}
 
+EmoticonRewriter::EmoticonRewriter(StringPiece token_array_data,
+                                   StringPiece string_array_data,
+                                   StringPiece hash_index_data)
+    : dic_(token_array_data, string_array_data, hash_index_data) {}
+
 EmoticonRewriter::~EmoticonRewriter() = default;
 
 int EmoticonRewriter::capability(const ConversionRequest &request) const {
@@ -47,6 +47,9 @@ class EmoticonRewriter : public RewriterInterface  {
       const DataManagerInterface &data_manager);
 
   EmoticonRewriter(StringPiece token_array_data, StringPiece string_array_data);
+  // |hash_index_data| may be empty; see SerializedDictionary::HashIndex.
+  EmoticonRewriter(StringPiece token_array_data, StringPiece string_array_data,
+                   StringPiece hash_index_data);
   ~EmoticonRewriter() override;
 
   int capability(const ConversionRequest &request) const override;
@@ -91,18 +91,6 @@ bool EnglishVariantsRewriter::ExpandEnglishVariants(
   return true;
 }
 
-bool EnglishVariantsRewriter::IsT13NCandidate(
-    Segment::Candidate *candidate) const {
-  return (Util::IsEnglishTransliteration(candidate->content_value) &&
-          Util::GetScriptType(candidate->content_key) == Util::HIRAGANA);
-}
-
-bool EnglishVariantsRewriter::IsEnglishCandidate(
-    Segment::Candidate *candidate) const {
-  return (Util::IsEnglishTransliteration(candidate->content_value) &&
-          Util::GetScriptType(candidate->content_key) == Util::ALPHABET);
-}
-
 bool EnglishVariantsRewriter::ExpandEnglishVariantsWithSegment(
     Segment *seg) const {
   CHECK(seg);
@@ -123,7 +111,14 @@ bool EnglishVariantsRewriter::ExpandEnglishVariantsWithSegment(
       continue;
     }
 
-    if (IsT13NCandidate(original_candidate)) {
+    // Classify the candidate once: the value has to be an English word, and
+    // the reading tells if it is a transliteration or typed in English.
+    if (!Util::IsEnglishTransliteration(original_candidate->content_value)) {
+      continue;
+    }
+    const Util::ScriptType key_type =
+        Util::GetScriptType(original_candidate->content_key);
+    if (key_type == Util::HIRAGANA) {
       // Expand T13N candiadte variants
       modified = true;
       original_candidate->attributes |=
@@ -154,7 +149,7 @@ bool EnglishVariantsRewriter::ExpandEnglishVariantsWithSegment(
 
         i += variants.size();
       }
-    } else if (IsEnglishCandidate(original_candidate)) {
+    } else if (key_type == Util::ALPHABET) {
       // Fix variants for English candidate
       modified = true;
       original_candidate->attributes |=
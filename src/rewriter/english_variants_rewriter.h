@@ -52,8 +52,6 @@ class EnglishVariantsRewriter : public RewriterInterface  {
 
  private:
   FRIEND_TEST(EnglishVariantsRewriterTest, ExpandEnglishVariants);
-  bool IsT13NCandidate(Segment::Candidate *candidate) const;
-  bool IsEnglishCandidate(Segment::Candidate *candidate) const;
   bool ExpandEnglishVariants(const string &input,
                              std::vector<string> *variants) const;
   bool ExpandEnglishVariantsWithSegment(Segment *seg) const;
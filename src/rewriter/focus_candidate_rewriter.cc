@@ -90,26 +90,40 @@ bool IsNumberSegment(const Segment &segment) {
           IsNumberCandidate(segment.candidate(0)));
 }
 
-// Returns true if two candidates have the same number form.
-bool IsSameNumberType(const Segment::Candidate &candidate1,
-                      const Segment::Candidate &candidate2) {
-  if (candidate1.style == candidate2.style) {
-    if (candidate1.style == NumberUtil::NumberString::DEFAULT_STYLE) {
-      if (IsNumberCandidate(candidate1) && IsNumberCandidate(candidate2) &&
-          Util::GetFormType(candidate1.value) ==
-          Util::GetFormType(candidate2.value)) {
-        return true;
-      }
-    } else {
+// Number form of the focused candidate.  It is computed once per Focus() call
+// so that aligning the neighboring segments doesn't re-scan the focused value
+// for every candidate it is compared with.
+class NumberType {
+ public:
+  explicit NumberType(const Segment::Candidate &candidate)
+      : style_(candidate.style),
+        is_number_(IsNumberCandidate(candidate)),
+        form_type_(
+            (is_number_ &&
+             style_ == NumberUtil::NumberString::DEFAULT_STYLE) ?
+            Util::GetFormType(candidate.value) : Util::UNKNOWN_FORM) {}
+
+  // Returns true if |candidate| has the same number form.
+  bool Matches(const Segment::Candidate &candidate) const {
+    if (candidate.style != style_) {
+      return false;
+    }
+    if (style_ != NumberUtil::NumberString::DEFAULT_STYLE) {
       return true;
     }
+    return (is_number_ && IsNumberCandidate(candidate) &&
+            Util::GetFormType(candidate.value) == form_type_);
   }
-  return false;
-}
 
-bool RewriteNumber(Segment *segment, const Segment::Candidate &candidate) {
+ private:
+  const NumberUtil::NumberString::Style style_;
+  const bool is_number_;
+  const Util::FormType form_type_;
+};
+
+bool RewriteNumber(Segment *segment, const NumberType &number_type) {
   for (int i = 0; i < segment->candidates_size(); ++i) {
-    if (IsSameNumberType(candidate, segment->candidate(i))) {
+    if (number_type.Matches(segment->candidate(i))) {
       segment->move_candidate(i, 0);   // move to top
       return true;
     }
@@ -117,7 +131,7 @@ bool RewriteNumber(Segment *segment, const Segment::Candidate &candidate) {
 
   // Find value from meta candidates.
   for (int i = 0; i < segment->meta_candidates_size(); ++i) {
-    if (IsSameNumberType(candidate, segment->meta_candidate(i))) {
+    if (number_type.Matches(segment->meta_candidate(i))) {
       segment->move_candidate(-i - 1, 0);   // copy to top
       return true;
     }
@@ -180,6 +194,7 @@ bool FocusCandidateRewriter::Focus(Segments *segments,
 
     if (Util::IsOpenBracket(left_value, &right_value)) {
       int num_nest = 1;
+      string tmp;
       for (size_t i = segment_index + 1; i < segments->segments_size(); ++i) {
         Segment *target_right_seg = segments->mutable_segment(i);
         if (target_right_seg == NULL ||
@@ -192,7 +207,6 @@ bool FocusCandidateRewriter::Focus(Segments *segments,
         }
         const string &target_right_value =
             target_right_seg->candidate(0).content_value;
-        string tmp;
         if (Util::IsOpenBracket(target_right_value, &tmp)) {
           ++num_nest;
         } else if (Util::IsCloseBracket(target_right_value, &tmp)) {
@@ -215,6 +229,7 @@ bool FocusCandidateRewriter::Focus(Segments *segments,
 
     if (Util::IsCloseBracket(right_value, &left_value)) {
       int num_nest = 1;
+      string tmp;
       for (int i = segment_index - 1; i >= 0; --i) {
         Segment *target_left_seg = segments->mutable_segment(i);
         if (target_left_seg == NULL ||
@@ -227,7 +242,6 @@ bool FocusCandidateRewriter::Focus(Segments *segments,
         }
         const string &target_left_value =
             target_left_seg->candidate(0).content_value;
-        string tmp;
         if (Util::IsCloseBracket(target_left_value, &tmp)) {
           ++num_nest;
         } else if (Util::IsOpenBracket(target_left_value, &tmp)) {
@@ -244,6 +258,7 @@ bool FocusCandidateRewriter::Focus(Segments *segments,
 
   {
     if (IsNumberCandidate(seg.candidate(candidate_index))) {
+      const NumberType number_type(seg.candidate(candidate_index));
       bool modified = 0;
       int distance = 0;
       for (size_t i = segment_index + 1; i < segments->segments_size(); ++i) {
@@ -259,8 +274,7 @@ bool FocusCandidateRewriter::Focus(Segments *segments,
 
         // Make sure the first candidate of the segment is number.
         if (IsNumberSegment(*target_right_seg) &&
-            RewriteNumber(target_right_seg,
-                          seg.candidate(candidate_index))) {
+            RewriteNumber(target_right_seg, number_type)) {
           modified = true;
           distance = 0;
         } else {
@@ -58,6 +58,7 @@ import sys
 
 from build_tools import code_generator_util
 from build_tools import serialized_string_array_builder
+from prediction import gen_zero_query_util
 
 
 def ParseCodePoint(s):
@@ -157,8 +158,11 @@ def ReadEmojiTsv(stream):
 
 
 def OutputData(emoji_data_list, token_dict,
-               token_array_file, string_array_file):
-  """Output token and string arrays to files."""
+               token_array_file, string_array_file, hash_index_file=None):
+  """Output token and string arrays, and optionally the hash index, to files.
+
+  The hash index is in the format of SerializedDictionary::HashIndex.
+  """
   sorted_token_dict = sorted(token_dict.iteritems())
 
   strings = {}
@@ -175,8 +179,13 @@ def OutputData(emoji_data_list, token_dict,
   for index, s in enumerate(sorted_strings):
     strings[s] = index
 
+  # The index of the first token for each reading.
+  first_token_indices = []
+  num_tokens = 0
   with open(token_array_file, 'wb') as f:
     for reading, value_list in sorted_token_dict:
+      first_token_indices.append(num_tokens)
+      num_tokens += len(value_list)
       reading_index = strings[reading]
       for value_index in value_list:
         (emoji, android_pua, utf8_description, docomo_description,
@@ -192,6 +201,17 @@ def OutputData(emoji_data_list, token_dict,
   serialized_string_array_builder.SerializeToFile(sorted_strings,
                                                   string_array_file)
 
+  if hash_index_file:
+    seeds, slots = gen_zero_query_util.BuildPerfectHash(
+        [reading for reading, _ in sorted_token_dict])
+    with open(hash_index_file, 'wb') as f:
+      f.write(struct.pack('<I', len(seeds)))
+      f.write(struct.pack('<I', len(slots)))
+      for seed in seeds:
+        f.write(struct.pack('<I', seed))
+      for i in slots:
+        f.write(struct.pack('<I', first_token_indices[i]))
+
 
 def ParseOptions():
   parser = optparse.OptionParser()
@@ -200,6 +220,8 @@ def ParseOptions():
                     help='output token array file')
   parser.add_option('--output_string_array', dest='output_string_array',
                     help='output string array file')
+  parser.add_option('--output_hash_index', dest='output_hash_index',
+                    help='output hash index file')
   return parser.parse_args()[0]
 
 
@@ -209,7 +231,8 @@ def main():
     (emoji_data_list, token_dict) = ReadEmojiTsv(input_stream)
 
   OutputData(emoji_data_list, token_dict,
-             options.output_token_array, options.output_string_array)
+             options.output_token_array, options.output_string_array,
+             options.output_hash_index)
 
 
 if __name__ == '__main__':
@@ -44,6 +44,7 @@
 DEFINE_string(input, "", "Emoticon dictionary file");
 DEFINE_string(output_token_array, "", "Output token array");
 DEFINE_string(output_string_array, "", "Output string array");
+DEFINE_string(output_hash_index, "", "Output hash index");
 
 namespace mozc {
 namespace {
@@ -130,6 +131,7 @@ int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, true);
   const auto &input_data = mozc::ReadEmoticonTsv(FLAGS_input);
   mozc::SerializedDictionary::CompileToFiles(
-      input_data, FLAGS_output_token_array, FLAGS_output_string_array);
+      input_data, FLAGS_output_token_array, FLAGS_output_string_array,
+      FLAGS_output_hash_index);
   return 0;
 }
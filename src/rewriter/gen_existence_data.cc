@@ -40,6 +40,7 @@
 #include "base/codegen_bytearray_stream.h"
 #include "base/hash.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "storage/existence_filter.h"
 
 using mozc::storage::ExistenceFilter;
@@ -47,22 +48,57 @@ using mozc::storage::ExistenceFilter;
 namespace mozc {
 namespace {
 
+// The minimum number of entries fingerprinted by each thread.
+const size_t kMinEntriesPerThread = 1 << 14;
+
+void FingerprintRange(const std::vector<string> &entries, size_t begin,
+                      size_t end, uint64 *hashes) {
+  for (size_t i = begin; i < end; ++i) {
+    hashes[i] = Hash::Fingerprint(entries[i]);
+  }
+}
+
+// Fingerprints the entries on the threads of the shared ThreadPool.
+void FingerprintEntries(const std::vector<string> &entries,
+                        std::vector<uint64> *hashes) {
+  hashes->resize(entries.size());
+  ThreadPool *pool = ThreadPool::GetSharedInstance();
+  const size_t num_threads =
+      std::min(pool->num_threads(),
+               std::max(entries.size() / kMinEntriesPerThread,
+                        static_cast<size_t>(1)));
+  std::vector<ThreadPool::TaskHandle> tasks;
+  for (size_t i = 1; i < num_threads; ++i) {
+    const size_t begin = entries.size() * i / num_threads;
+    const size_t end = entries.size() * (i + 1) / num_threads;
+    uint64 *data = hashes->data();
+    tasks.push_back(pool->Schedule(
+        ThreadPool::BACKGROUND, [&entries, begin, end, data]() {
+          FingerprintRange(entries, begin, end, data);
+        }));
+  }
+  FingerprintRange(entries, 0, entries.size() / num_threads, hashes->data());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Wait();
+  }
+}
+
 void GenExistenceData(const std::vector<string> &entries,
                       double error_rate,
                       char **existence_data,
                       size_t *existence_data_size) {
   const int n = entries.size();
   const int m =  ExistenceFilter::MinFilterSizeInBytesForErrorRate(
-      error_rate, n);
+      error_rate, n, ExistenceFilter::BLOCKED);
   LOG(INFO) << "entry: " << n << " err: " << error_rate << " bytes: " << m;
 
-  std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(m, n));
+  std::unique_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(m, n, ExistenceFilter::BLOCKED));
   DCHECK(filter.get());
 
-  for (size_t i = 0; i < entries.size(); ++i) {
-    const uint64 id = Hash::Fingerprint(entries[i]);
-    filter->Insert(id);
-  }
+  std::vector<uint64> hashes;
+  FingerprintEntries(entries, &hashes);
+  filter->InsertMany(hashes.data(), hashes.size());
   filter->Write(existence_data, existence_data_size);
 }
 
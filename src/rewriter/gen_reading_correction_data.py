@@ -36,6 +36,7 @@ Usage:
     --output_value_array=value_array.data
     --output_error_array=error_array.data
     --output_correction_array=correction_array.data
+    --output_hash_index=hash_index.data
 """
 
 __author__ = "komatsu"
@@ -45,6 +46,7 @@ import optparse
 
 from build_tools import code_generator_util
 from build_tools import serialized_string_array_builder
+from prediction import gen_zero_query_util
 
 
 def ParseOptions():
@@ -57,11 +59,13 @@ def ParseOptions():
                     help='Output serialized string array for errors.')
   parser.add_option('--output_correction_array', dest='output_correction_array',
                     help='Output serialized string array for corrections.')
+  parser.add_option('--output_hash_index', dest='output_hash_index',
+                    help='Output hash index keyed by error and value.')
   return parser.parse_args()[0]
 
 
 def WriteData(input_path, output_value_array_path, output_error_array_path,
-              output_correction_array_path):
+              output_correction_array_path, output_hash_index_path=None):
   outputs = []
   with open(input_path) as input_stream:
     input_stream = code_generator_util.SkipLineComment(input_stream)
@@ -82,12 +86,18 @@ def WriteData(input_path, output_value_array_path, output_error_array_path,
   serialized_string_array_builder.SerializeToFile(
       [correction for (_, _, correction) in outputs],
       output_correction_array_path)
+  if output_hash_index_path:
+    # The key is "error\tvalue"; see CorrectionRewriter::LookupCorrection().
+    gen_zero_query_util.WriteHashIndex(
+        ['%s\t%s' % (error, value) for (value, error, _) in outputs],
+        output_hash_index_path)
 
 
 def main():
   options = ParseOptions()
   WriteData(options.input, options.output_value_array,
-            options.output_error_array, options.output_correction_array)
+            options.output_error_array, options.output_correction_array,
+            options.output_hash_index)
 
 
 if __name__ == "__main__":
@@ -39,6 +39,8 @@ DEFINE_string(output_token_array, "",
               "Output token array of noun prefix dictionary");
 DEFINE_string(output_string_array, "",
               "Output string array of noun prefix dictionary");
+DEFINE_string(output_hash_index, "",
+              "Output hash index of noun prefix dictionary");
 
 namespace {
 
@@ -100,6 +102,7 @@ int main(int argc, char **argv) {
   }
   mozc::SerializedDictionary::CompileToFiles(tokens,
                                              FLAGS_output_token_array,
-                                             FLAGS_output_string_array);
+                                             FLAGS_output_string_array,
+                                             FLAGS_output_hash_index);
   return 0;
 }
@@ -44,6 +44,7 @@ import struct
 
 from build_tools import code_generator_util
 from build_tools import serialized_string_array_builder
+from prediction import gen_zero_query_util
 
 
 def ReadSingleKanji(stream):
@@ -144,6 +145,12 @@ def _ParseOptions():
   parser.add_option('--output_variant_strings',
                     dest='output_variant_strings',
                     help='Output variant strings.')
+  parser.add_option('--output_single_kanji_hash_index',
+                    dest='output_single_kanji_hash_index',
+                    help='Output hash index of Single Kanji readings.')
+  parser.add_option('--output_variant_hash_index',
+                    dest='output_variant_hash_index',
+                    help='Output hash index of variant targets.')
 
   return parser.parse_args()[0]
 
@@ -164,6 +171,14 @@ def main():
                    options.output_variant_types,
                    options.output_variant_tokens,
                    options.output_variant_strings)
+  if options.output_single_kanji_hash_index:
+    gen_zero_query_util.WriteHashIndex(
+        [key for key, _ in single_kanji],
+        options.output_single_kanji_hash_index)
+  if options.output_variant_hash_index:
+    gen_zero_query_util.WriteHashIndex(
+        [item[0] for item in variant_info[1]],
+        options.output_variant_hash_index)
 
 
 if __name__ == '__main__':
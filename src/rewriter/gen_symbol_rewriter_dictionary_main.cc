@@ -59,6 +59,7 @@ DEFINE_string(input, "", "symbol dictionary file");
 DEFINE_string(user_pos_manager_data, "", "user pos manager data file");
 DEFINE_string(output_token_array, "", "output token array binary file");
 DEFINE_string(output_string_array, "", "output string array binary file");
+DEFINE_string(output_hash_index, "", "output hash index binary file");
 
 namespace mozc {
 namespace {
@@ -232,7 +233,8 @@ int main(int argc, char **argv) {
   dictionary.Output(tmp_text_file);
   mozc::SerializedDictionary::CompileToFiles(tmp_text_file,
                                              FLAGS_output_token_array,
-                                             FLAGS_output_string_array);
+                                             FLAGS_output_string_array,
+                                             FLAGS_output_hash_index);
   mozc::FileUtil::Unlink(tmp_text_file);
 
   return 0;
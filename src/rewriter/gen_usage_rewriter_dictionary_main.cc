@@ -35,13 +35,14 @@
 //    --output_conjugation_suffix=conj_suffix.data
 //    --output_conjugation_index=conj_index.data
 //    --output_usage_item_array=usage_item_array.data
+//    --output_fingerprint_table=fingerprint_table.data
 //    --output_string_array=string_array.data
 //
 // * Prerequisite
 // Little endian is assumed.
 //
 // * Output file format
-// The output data consists of five files:
+// The output data consists of six files:
 //
 // ** String array
 // All the strings (e.g., usage of word) are stored in this array and are
@@ -91,6 +92,25 @@
 // index is the conjugation type of this key value pair, and its conjugation
 // suffix types are retrieved using conjugation suffix index and conjugation
 // suffix array.
+//
+// ** Fingerprint table
+//
+// Array of 16-byte entries sorted by fingerprint:
+//
+// +=============================+
+// | Fingerprint (8 byte)        |
+// +-----------------------------+
+// | Usage item index (4 byte)   |
+// +-----------------------------+
+// | Padding (4 byte)            |
+// +=============================+
+//
+// For every usage item and every conjugation suffix of its conjugation type,
+// the table has two entries: one for the pair of conjugated key and value, and
+// one for the pair of the empty key and conjugated value, which is used for
+// the heuristic lookup by value.  The fingerprint of a pair is
+// Hash::FingerprintWithSeed(value, Hash::Fingerprint32(key)).  If two items
+// yield the same pair, the latter one wins.
 
 #include <algorithm>
 #include <iostream>
@@ -101,6 +121,7 @@
 
 #include "base/file_stream.h"
 #include "base/flags.h"
+#include "base/hash.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
 #include "base/serialized_string_array.h"
@@ -113,6 +134,8 @@ DEFINE_string(output_base_conjugation_suffix, "",
 DEFINE_string(output_conjugation_suffix, "", "output conjugation suffix array");
 DEFINE_string(output_conjugation_index, "", "output conjugation index array");
 DEFINE_string(output_usage_item_array, "", "output array of usage items");
+DEFINE_string(output_fingerprint_table, "",
+              "output table from fingerprint of key and value to usage item");
 DEFINE_string(output_string_array, "", "output string array");
 
 namespace mozc {
@@ -247,6 +270,29 @@ uint32 Lookup(const std::map<string, uint32> &m, const string &key) {
   return iter->second;
 }
 
+using StrPair = std::pair<string, string>;
+
+// Maps the fingerprint of (key, value) to the pair itself, to detect
+// collisions, and the index of usage item.
+using FingerprintTable = std::map<uint64, std::pair<StrPair, uint32>>;
+
+void AddToFingerprintTable(const string &key, const string &value,
+                           uint32 item_index, FingerprintTable *table) {
+  // Must be kept in sync with UsageRewriter::LookupItem().
+  const uint64 fp =
+      Hash::FingerprintWithSeed(value, Hash::Fingerprint32(key));
+  const auto iter = table->find(fp);
+  if (iter != table->end()) {
+    CHECK(iter->second.first.first == key && iter->second.first.second == value)
+        << "Fingerprint collision: (" << key << ", " << value << ") and ("
+        << iter->second.first.first << ", " << iter->second.first.second
+        << ")";
+    iter->second.second = item_index;
+    return;
+  }
+  table->emplace(fp, std::make_pair(StrPair(key, value), item_index));
+}
+
 void Convert() {
   CHECK(Util::IsLittleEndian());
 
@@ -304,8 +350,11 @@ void Convert() {
     }
   }
 
-  // Output conjugation suffix data.
+  // Output conjugation suffix data.  The (value suffix, key suffix) pairs of
+  // each conjugation type are also kept for the fingerprint table.
   std::vector<int> conjugation_index(conjugation_list.size() + 1);
+  std::vector<std::vector<StrPair>> conjugation_suffixes(
+      conjugation_list.size());
   {
     OutputFileStream ostream(FLAGS_output_conjugation_suffix.c_str(),
                              ios_base::out | ios_base::binary);
@@ -318,9 +367,9 @@ void Convert() {
         const uint32 index = Lookup(string_index, "");
         ostream.write(reinterpret_cast<const char *>(&index), 4);
         ostream.write(reinterpret_cast<const char *>(&index), 4);
+        conjugation_suffixes[i].emplace_back("", "");
         ++out_count;
       } else {
-        using StrPair = std::pair<string, string>;
         std::set<StrPair> key_and_value_suffix_set;
         for (const ConjugationType &ctype : conjugations) {
           key_and_value_suffix_set.emplace(ctype.value_suffix,
@@ -331,6 +380,7 @@ void Convert() {
           const uint32 key_suffix_index = Lookup(string_index, kv.second);
           ostream.write(reinterpret_cast<const char *>(&value_suffix_index), 4);
           ostream.write(reinterpret_cast<const char *>(&key_suffix_index), 4);
+          conjugation_suffixes[i].push_back(kv);
           ++out_count;
         }
       }
@@ -364,6 +414,28 @@ void Convert() {
     }
   }
 
+  // Output fingerprint table.
+  {
+    FingerprintTable table;
+    for (uint32 i = 0; i < usage_entries.size(); ++i) {
+      const UsageItem &item = usage_entries[i];
+      for (const StrPair &suffix : conjugation_suffixes[item.conjugation_id]) {
+        const string key = item.key + suffix.second;
+        const string value = item.value + suffix.first;
+        AddToFingerprintTable(key, value, i, &table);
+        AddToFingerprintTable("", value, i, &table);
+      }
+    }
+    OutputFileStream ostream(FLAGS_output_fingerprint_table.c_str(),
+                             ios_base::out | ios_base::binary);
+    const uint32 kPadding = 0;
+    for (const auto &kv : table) {
+      ostream.write(reinterpret_cast<const char *>(&kv.first), 8);
+      ostream.write(reinterpret_cast<const char *>(&kv.second.second), 4);
+      ostream.write(reinterpret_cast<const char *>(&kPadding), 4);
+    }
+  }
+
   // Output string array.
   {
     std::vector<StringPiece> strs;
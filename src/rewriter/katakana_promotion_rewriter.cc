@@ -61,7 +61,6 @@ bool MaybePromoteKatakana(Segment *segment) {
     }
   }
 
-  Segment::Candidate insert_candidate = katakana_candidate;
   size_t index = kMaxRankForKatakana;
   for (; index < segment->candidates_size(); ++index) {
     if (segment->candidate(index).value == katakana_value) {
@@ -72,7 +71,9 @@ bool MaybePromoteKatakana(Segment *segment) {
   const size_t insert_pos =
       std::min(kMaxRankForKatakana, segment->candidates_size());
   if (index < segment->candidates_size()) {
-    const Segment::Candidate insert_candidate = segment->candidate(index);
+    // Candidates are not relocated by the insertion, so no copy is needed
+    // to keep the source.
+    const Segment::Candidate &insert_candidate = segment->candidate(index);
     *(segment->insert_candidate(insert_pos)) = insert_candidate;
   } else {
     *(segment->insert_candidate(insert_pos)) = katakana_candidate;
@@ -0,0 +1,124 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/lazy_rewriter.h"
+
+#include <utility>
+
+#include "base/logging.h"
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "rewriter/merger_rewriter.h"
+
+namespace mozc {
+
+LazyRewriter::LazyRewriter(Factory factory, int max_capability)
+    : factory_(std::move(factory)), max_capability_(max_capability) {
+  DCHECK(factory_);
+}
+
+LazyRewriter::~LazyRewriter() {}
+
+int LazyRewriter::capability(const ConversionRequest &request) const {
+  const RewriterInterface *rewriter = Get();
+  return rewriter == nullptr ? max_capability_ : rewriter->capability(request);
+}
+
+bool LazyRewriter::Rewrite(const ConversionRequest &request,
+                           Segments *segments) const {
+  RewriterInterface *rewriter = GetOrBuild();
+  // capability() returned |max_capability_| before the rewriter was built,
+  // so the actual capability is checked here.
+  if ((rewriter->capability(request) &
+       MergerRewriter::GetRequiredCapability(*segments)) == 0) {
+    return false;
+  }
+  return rewriter->Rewrite(request, segments);
+}
+
+bool LazyRewriter::Focus(Segments *segments, size_t segment_index,
+                         int candidate_index) const {
+  RewriterInterface *rewriter = Get();
+  return rewriter == nullptr ||
+         rewriter->Focus(segments, segment_index, candidate_index);
+}
+
+void LazyRewriter::Finish(const ConversionRequest &request,
+                          Segments *segments) {
+  RewriterInterface *rewriter = Get();
+  if (rewriter != nullptr) {
+    rewriter->Finish(request, segments);
+  }
+}
+
+bool LazyRewriter::Sync() {
+  RewriterInterface *rewriter = Get();
+  return rewriter == nullptr || rewriter->Sync();
+}
+
+bool LazyRewriter::Reload() {
+  RewriterInterface *rewriter = Get();
+  return rewriter == nullptr || rewriter->Reload();
+}
+
+void LazyRewriter::Clear() {
+  RewriterInterface *rewriter = Get();
+  if (rewriter != nullptr) {
+    rewriter->Clear();
+  }
+}
+
+void LazyRewriter::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  const RewriterInterface *rewriter = Get();
+  if (rewriter != nullptr) {
+    rewriter->CollectMemoryUsage(usages);
+  }
+}
+
+bool LazyRewriter::IsBuilt() const {
+  return Get() != nullptr;
+}
+
+RewriterInterface *LazyRewriter::GetOrBuild() const {
+  scoped_lock lock(&mutex_);
+  if (!rewriter_) {
+    rewriter_.reset(factory_());
+    CHECK(rewriter_);
+  }
+  return rewriter_.get();
+}
+
+RewriterInterface *LazyRewriter::Get() const {
+  scoped_lock lock(&mutex_);
+  return rewriter_.get();
+}
+
+}  // namespace mozc
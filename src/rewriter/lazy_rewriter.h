@@ -0,0 +1,91 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_REWRITER_LAZY_REWRITER_H_
+#define MOZC_REWRITER_LAZY_REWRITER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "rewriter/rewriter_interface.h"
+
+namespace mozc {
+
+class ConversionRequest;
+class Segments;
+
+// Defers the construction of a rewriter with tables on the heap until it's
+// needed, so that an engine which never converts, e.g., the one used only
+// for suggestions, doesn't pay for them.  The rewriter is built by |factory|
+// on the first Rewrite() for a request type in |max_capability|, which must
+// include every capability the rewriter can return.  Until then, the other
+// methods don't build it.
+class LazyRewriter : public RewriterInterface {
+ public:
+  typedef std::function<RewriterInterface *()> Factory;
+
+  LazyRewriter(Factory factory, int max_capability);
+  ~LazyRewriter() override;
+
+  int capability(const ConversionRequest &request) const override;
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override;
+  bool Focus(Segments *segments, size_t segment_index,
+             int candidate_index) const override;
+  void Finish(const ConversionRequest &request, Segments *segments) override;
+  bool Sync() override;
+  bool Reload() override;
+  void Clear() override;
+  void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const override;
+
+  // Returns true if the rewriter has been built.
+  bool IsBuilt() const;
+
+ private:
+  // Returns the rewriter, building it if necessary.
+  RewriterInterface *GetOrBuild() const;
+  // Returns the rewriter or nullptr if it's not built yet.
+  RewriterInterface *Get() const;
+
+  const Factory factory_;
+  const int max_capability_;
+  mutable Mutex mutex_;
+  mutable std::unique_ptr<RewriterInterface> rewriter_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazyRewriter);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_LAZY_REWRITER_H_
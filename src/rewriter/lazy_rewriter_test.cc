@@ -0,0 +1,115 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/lazy_rewriter.h"
+
+#include "converter/segments.h"
+#include "request/conversion_request.h"
+#include "rewriter/rewriter_interface.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+// Counts the calls of Rewrite().
+class CountingRewriter : public RewriterInterface {
+ public:
+  CountingRewriter(int capability, int *num_rewrites)
+      : capability_(capability), num_rewrites_(num_rewrites) {}
+
+  int capability(const ConversionRequest &request) const override {
+    return capability_;
+  }
+
+  bool Rewrite(const ConversionRequest &request,
+               Segments *segments) const override {
+    ++*num_rewrites_;
+    return true;
+  }
+
+ private:
+  const int capability_;
+  int *num_rewrites_;
+};
+
+class LazyRewriterTest : public ::testing::Test {
+ protected:
+  LazyRewriter::Factory MakeFactory(int capability) {
+    return [this, capability]() -> RewriterInterface * {
+      ++num_builds_;
+      return new CountingRewriter(capability, &num_rewrites_);
+    };
+  }
+
+  int num_builds_ = 0;
+  int num_rewrites_ = 0;
+};
+
+TEST_F(LazyRewriterTest, BuiltOnFirstRewrite) {
+  LazyRewriter rewriter(MakeFactory(RewriterInterface::CONVERSION),
+                        RewriterInterface::CONVERSION);
+  const ConversionRequest request;
+  Segments segments;
+  segments.set_request_type(Segments::CONVERSION);
+
+  // None of these builds the rewriter.
+  EXPECT_EQ(RewriterInterface::CONVERSION, rewriter.capability(request));
+  EXPECT_TRUE(rewriter.Focus(&segments, 0, 0));
+  rewriter.Finish(request, &segments);
+  EXPECT_TRUE(rewriter.Sync());
+  EXPECT_TRUE(rewriter.Reload());
+  rewriter.Clear();
+  EXPECT_FALSE(rewriter.IsBuilt());
+  EXPECT_EQ(0, num_builds_);
+
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_TRUE(rewriter.Rewrite(request, &segments));
+  EXPECT_TRUE(rewriter.IsBuilt());
+  EXPECT_EQ(1, num_builds_);
+  EXPECT_EQ(2, num_rewrites_);
+}
+
+TEST_F(LazyRewriterTest, ChecksActualCapability) {
+  // The rewriter may return a narrower capability than |max_capability|.
+  LazyRewriter rewriter(MakeFactory(RewriterInterface::CONVERSION),
+                        RewriterInterface::ALL);
+  const ConversionRequest request;
+  EXPECT_EQ(RewriterInterface::ALL, rewriter.capability(request));
+
+  Segments segments;
+  segments.set_request_type(Segments::SUGGESTION);
+  EXPECT_FALSE(rewriter.Rewrite(request, &segments));
+  EXPECT_EQ(1, num_builds_);
+  EXPECT_EQ(0, num_rewrites_);
+  EXPECT_EQ(RewriterInterface::CONVERSION, rewriter.capability(request));
+}
+
+}  // namespace
+}  // namespace mozc
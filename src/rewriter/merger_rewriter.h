@@ -30,15 +30,20 @@
 #ifndef MOZC_REWRITER_MERGER_REWRITER_H_
 #define MOZC_REWRITER_MERGER_REWRITER_H_
 
+#include <string>
 #include <vector>
 
+#include "base/number_util.h"
 #include "base/stl_util.h"
+#include "base/stopwatch.h"
+#include "base/trace.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
+#include "rewriter/rewriter_profiler.h"
 
 namespace mozc {
 
@@ -49,44 +54,70 @@ class MergerRewriter : public RewriterInterface {
     STLDeleteElements(&rewriters_);
   }
 
-  // return true if rewriter can be called with the segments.
-  bool CheckCapablity(const ConversionRequest &request, Segments *segments,
-                      RewriterInterface *rewriter) const {
-    if (segments == NULL) {
-      return false;
-    }
-    switch (segments->request_type()) {
+  // Returns the capability required for the request type of |segments|, or
+  // NOT_AVAILABLE if no rewriter is called for it.
+  static int GetRequiredCapability(const Segments &segments) {
+    switch (segments.request_type()) {
       case Segments::CONVERSION:
-        return ((rewriter->capability(request) & RewriterInterface::CONVERSION)
-                != 0);
+        return RewriterInterface::CONVERSION;
 
       case Segments::PREDICTION:
       case Segments::PARTIAL_PREDICTION:
-        return ((rewriter->capability(request) & RewriterInterface::PREDICTION)
-                != 0);
+        return RewriterInterface::PREDICTION;
 
       case Segments::SUGGESTION:
       case Segments::PARTIAL_SUGGESTION:
-        return ((rewriter->capability(request) & RewriterInterface::SUGGESTION)
-                != 0);
+        return RewriterInterface::SUGGESTION;
 
       case Segments::REVERSE_CONVERSION:
       default:
-        return false;
+        return RewriterInterface::NOT_AVAILABLE;
+    }
+  }
+
+  // return true if rewriter can be called with the segments.
+  bool CheckCapablity(const ConversionRequest &request, Segments *segments,
+                      RewriterInterface *rewriter) const {
+    if (segments == NULL) {
+      return false;
     }
+    return (rewriter->capability(request) &
+            GetRequiredCapability(*segments)) != 0;
   }
 
   // This instance owns the rewriter.
   void AddRewriter(RewriterInterface *rewriter) {
+    AddRewriter(rewriter, "");
+  }
+
+  // Same as above, but |name| identifies the rewriter in RewriterProfiler.
+  void AddRewriter(RewriterInterface *rewriter, const string &name) {
+    rewriter_names_.push_back(
+        name.empty() ?
+        "Rewriter" + NumberUtil::SimpleItoa(
+            static_cast<uint32>(rewriters_.size())) :
+        name);
+    rewriter_trace_names_.push_back(
+        Trace::InternName(rewriter_names_.back()));
     rewriters_.push_back(rewriter);
   }
 
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const {
     bool result = false;
-    for (size_t i = 0; i < rewriters_.size(); ++i) {
-      if (CheckCapablity(request, segments, rewriters_[i])) {
-        result |= rewriters_[i]->Rewrite(request, segments);
+    // The required capability is resolved once for all the rewriters, and
+    // none of them is asked for the request types without rewriters.
+    const int required_capability = GetRequiredCapability(*segments);
+    if (required_capability != RewriterInterface::NOT_AVAILABLE) {
+      for (size_t i = 0; i < rewriters_.size(); ++i) {
+        if (rewriters_[i]->capability(request) & required_capability) {
+          MOZC_TRACE_SPAN(rewriter_trace_names_[i]);
+          if (RewriterProfiler::IsEnabled()) {
+            result |= ProfileRewrite(i, request, segments);
+          } else {
+            result |= rewriters_[i]->Rewrite(request, segments);
+          }
+        }
       }
     }
 
@@ -153,8 +184,41 @@ class MergerRewriter : public RewriterInterface {
     }
   }
 
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const {
+    for (size_t i = 0; i < rewriters_.size(); ++i) {
+      rewriters_[i]->CollectMemoryUsage(usages);
+    }
+  }
+
  private:
+  static size_t GetConversionCandidatesSize(const Segments &segments) {
+    size_t size = 0;
+    for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+      size += segments.conversion_segment(i).candidates_size();
+    }
+    return size;
+  }
+
+  // Calls the |index|-th rewriter and records its time and the change of the
+  // number of the candidates.
+  bool ProfileRewrite(size_t index, const ConversionRequest &request,
+                      Segments *segments) const {
+    const size_t prev_size = GetConversionCandidatesSize(*segments);
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    const bool modified = rewriters_[index]->Rewrite(request, segments);
+    stopwatch.Stop();
+    RewriterProfiler::Record(
+        rewriter_names_[index],
+        static_cast<uint64>(stopwatch.GetElapsedMicroseconds()), modified,
+        prev_size, GetConversionCandidatesSize(*segments));
+    return modified;
+  }
+
   std::vector<RewriterInterface *> rewriters_;
+  // The names of |rewriters_| for RewriterProfiler, and the ones for Trace.
+  std::vector<string> rewriter_names_;
+  std::vector<const char *> rewriter_trace_names_;
 
   DISALLOW_COPY_AND_ASSIGN(MergerRewriter);
 };
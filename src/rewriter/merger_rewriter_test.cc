@@ -30,12 +30,14 @@
 #include "rewriter/merger_rewriter.h"
 
 #include <string>
+#include <vector>
 
 #include "base/system_util.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
+#include "rewriter/rewriter_profiler.h"
 #include "testing/base/public/gunit.h"
 
 DECLARE_string(test_tmpdir);
@@ -101,6 +103,25 @@ class TestRewriter : public RewriterInterface {
   int capability_;
 };
 
+// Appends |num_candidates| candidates to the first conversion segment.
+class AppendCandidatesRewriter : public RewriterInterface {
+ public:
+  explicit AppendCandidatesRewriter(size_t num_candidates)
+      : num_candidates_(num_candidates) {}
+
+  virtual bool Rewrite(const ConversionRequest &request,
+                       Segments *segments) const {
+    Segment *segment = segments->mutable_conversion_segment(0);
+    for (size_t i = 0; i < num_candidates_; ++i) {
+      segment->add_candidate()->Init();
+    }
+    return num_candidates_ > 0;
+  }
+
+ private:
+  const size_t num_candidates_;
+};
+
 class MergerRewriterTest : public testing::Test {
  protected:
   virtual void SetUp() {
@@ -256,6 +277,57 @@ TEST_F(MergerRewriterTest, RewriteCheckTest) {
             "e.Rewrite();",
             call_result);
   call_result.clear();
+
+  // No rewriter is called for reverse conversion.
+  segments.set_request_type(Segments::REVERSE_CONVERSION);
+  EXPECT_FALSE(merger.Rewrite(request, &segments));
+  EXPECT_EQ("", call_result);
+}
+
+TEST_F(MergerRewriterTest, ProfileRewriters) {
+  MergerRewriter merger;
+  Segments segments;
+  const ConversionRequest request;
+
+  segments.set_request_type(Segments::CONVERSION);
+  segments.add_segment();
+  merger.AddRewriter(new AppendCandidatesRewriter(2), "Append");
+  merger.AddRewriter(new AppendCandidatesRewriter(0));
+
+  // Nothing is recorded while the profiler is disabled.
+  RewriterProfiler::Clear();
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  std::vector<RewriterProfiler::Stats> stats;
+  RewriterProfiler::GetStats(&stats);
+  EXPECT_TRUE(stats.empty());
+
+  RewriterProfiler::SetEnabled(true);
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  EXPECT_TRUE(merger.Rewrite(request, &segments));
+  RewriterProfiler::SetEnabled(false);
+  EXPECT_EQ(6, segments.conversion_segment(0).candidates_size());
+
+  RewriterProfiler::GetStats(&stats);
+  ASSERT_EQ(2, stats.size());
+  EXPECT_EQ("Append", stats[0].name);
+  EXPECT_EQ(2, stats[0].num_calls);
+  EXPECT_EQ(2, stats[0].num_modified);
+  EXPECT_EQ(4, stats[0].num_added_candidates);
+  EXPECT_EQ(0, stats[0].num_removed_candidates);
+  EXPECT_LE(stats[0].max_usec, stats[0].total_usec);
+  // The unnamed rewriter is named after its position.
+  EXPECT_EQ("Rewriter1", stats[1].name);
+  EXPECT_EQ(2, stats[1].num_calls);
+  EXPECT_EQ(0, stats[1].num_modified);
+  EXPECT_EQ(0, stats[1].num_added_candidates);
+
+  const string dump = RewriterProfiler::Dump();
+  EXPECT_NE(string::npos, dump.find("Append\t2\t2\t"));
+  EXPECT_NE(string::npos, dump.find("Rewriter1\t2\t0\t"));
+
+  RewriterProfiler::Clear();
+  RewriterProfiler::GetStats(&stats);
+  EXPECT_TRUE(stats.empty());
 }
 
 TEST_F(MergerRewriterTest, Focus) {
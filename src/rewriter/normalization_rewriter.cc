@@ -53,23 +53,21 @@ bool NormalizeCandidate(Segment::Candidate *candidate,
     return false;
   }
 
-  string value, content_value;
+  bool modified = false;
   switch (type) {
     case CANDIDATE:  // Go through to TRANSLITERATION
     case TRANSLITERATION:
-      TextNormalizer::NormalizeText(candidate->value, &value);
-      TextNormalizer::NormalizeText(candidate->content_value, &content_value);
+      // Most candidates need no normalization at all, so they are scanned
+      // and rewritten in place instead of being copied.
+      modified |= TextNormalizer::NormalizeTextInPlace(&candidate->value);
+      modified |=
+          TextNormalizer::NormalizeTextInPlace(&candidate->content_value);
       break;
     default:
       LOG(ERROR) << "unkown type";
       return false;
   }
 
-  const bool modified = (content_value != candidate->content_value ||
-                         value != candidate->value);
-  candidate->value = value;
-  candidate->content_value = content_value;
-
   return modified;
 }
 }  // namespace
@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/number_util.h"
 #include "base/serialized_string_array.h"
 #include "base/util.h"
@@ -60,6 +61,65 @@ enum RewriteType {
   KANJI_FIRST,  // kanji candidates first ordering
 };
 
+}  // namespace
+
+// Keeps the number styles of the last few numbers.  A number is usually
+// expanded for several candidates of a segment, e.g., "1", "１" and "一", and
+// again for every key event while the user types the rest of the key.
+class NumberExpansionCache {
+ public:
+  NumberExpansionCache() : next_index_(0) {}
+
+  bool Lookup(RewriteType type, bool exec_radix_conversion,
+              const string &arabic_number,
+              std::vector<NumberUtil::NumberString> *output) {
+    scoped_lock l(&mutex_);
+    for (const Entry &entry : entries_) {
+      if (entry.type == type &&
+          entry.exec_radix_conversion == exec_radix_conversion &&
+          entry.arabic_number == arabic_number) {
+        output->insert(output->end(), entry.numbers.begin(),
+                       entry.numbers.end());
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Insert(RewriteType type, bool exec_radix_conversion,
+              const string &arabic_number,
+              const std::vector<NumberUtil::NumberString> &numbers) {
+    scoped_lock l(&mutex_);
+    if (entries_.size() < kCacheSize) {
+      entries_.emplace_back();
+    }
+    Entry &entry = entries_[next_index_];
+    next_index_ = (next_index_ + 1) % kCacheSize;
+    entry.type = type;
+    entry.exec_radix_conversion = exec_radix_conversion;
+    entry.arabic_number = arabic_number;
+    entry.numbers = numbers;
+  }
+
+ private:
+  static const size_t kCacheSize = 8;
+
+  struct Entry {
+    RewriteType type;
+    bool exec_radix_conversion;
+    string arabic_number;
+    std::vector<NumberUtil::NumberString> numbers;
+  };
+
+  Mutex mutex_;
+  std::vector<Entry> entries_;
+  size_t next_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(NumberExpansionCache);
+};
+
+namespace {
+
 struct RewriteCandidateInfo {
   RewriteType type;
   int position;
@@ -142,7 +202,8 @@ void GetRewriteCandidateInfos(
     }
     info.type = type;
     info.position = i;
-    rewrite_candidate_info->push_back(info);
+    // |info.candidate| is fully reset by GetRewriteTypeAndBase() above.
+    rewrite_candidate_info->push_back(std::move(info));
   }
 }
 
@@ -167,7 +228,7 @@ void PushBackCandidate(const string &value, const string &desc,
     cand.value = value;
     cand.description = desc;
     cand.style = style;
-    results->push_back(cand);
+    results->push_back(std::move(cand));
   }
 }
 
@@ -267,7 +328,6 @@ void InsertCandidate(Segment *segment,
                      const Segment::Candidate &result_cand) {
   DCHECK(segment);
   Segment::Candidate *c = segment->insert_candidate(insert_position);
-  c->Init();
   MergeCandidateInfoInternal(base_cand, result_cand, c);
 }
 
@@ -339,39 +399,38 @@ int GetInsertPos(int base_pos, const Segment &segment, RewriteType type) {
   }
 }
 
-void InsertHalfArabic(const string &half_arabic,
-                      std::vector<NumberUtil::NumberString> *output) {
-  output->push_back(
-      NumberUtil::NumberString(half_arabic, "",
-                               NumberUtil::NumberString::DEFAULT_STYLE));
-}
-
 void GetNumbers(RewriteType type, bool exec_radix_conversion,
                 const string &arabic_content_value,
+                NumberExpansionCache *cache,
                 std::vector<NumberUtil::NumberString> *output) {
   DCHECK(output);
-  if (type == ARABIC_FIRST) {
-    InsertHalfArabic(arabic_content_value, output);
-    NumberUtil::ArabicToWideArabic(arabic_content_value, output);
-    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, output);
-    NumberUtil::ArabicToKanji(arabic_content_value, output);
-    NumberUtil::ArabicToOtherForms(arabic_content_value, output);
-  } else if (type == KANJI_FIRST) {
-    NumberUtil::ArabicToKanji(arabic_content_value, output);
-    InsertHalfArabic(arabic_content_value, output);
-    NumberUtil::ArabicToWideArabic(arabic_content_value, output);
-    NumberUtil::ArabicToSeparatedArabic(arabic_content_value, output);
-    NumberUtil::ArabicToOtherForms(arabic_content_value, output);
+  if (cache->Lookup(type, exec_radix_conversion, arabic_content_value,
+                    output)) {
+    return;
+  }
+  const size_t output_begin = output->size();
+  uint32 conversions = 0;
+  if (type == ARABIC_FIRST || type == KANJI_FIRST) {
+    conversions = NumberUtil::HALF_ARABIC | NumberUtil::WIDE_ARABIC |
+                  NumberUtil::SEPARATED_ARABIC | NumberUtil::KANJI |
+                  NumberUtil::OTHER_FORMS;
+    if (type == KANJI_FIRST) {
+      conversions |= NumberUtil::KANJI_FIRST;
+    }
   }
-
   if (exec_radix_conversion) {
-    NumberUtil::ArabicToOtherRadixes(arabic_content_value, output);
+    conversions |= NumberUtil::OTHER_RADIXES;
   }
+  NumberUtil::ArabicToNumberStrings(arabic_content_value, conversions, output);
+  cache->Insert(type, exec_radix_conversion, arabic_content_value,
+                std::vector<NumberUtil::NumberString>(
+                    output->begin() + output_begin, output->end()));
 }
 
 bool RewriteOneSegment(
     const SerializedStringArray &suffix_array,
-    const POSMatcher &pos_matcher, bool exec_radix_conversion, Segment *seg) {
+    const POSMatcher &pos_matcher, bool exec_radix_conversion,
+    NumberExpansionCache *cache, Segment *seg) {
   DCHECK(seg);
   bool modified = false;
   std::vector<RewriteCandidateInfo> rewrite_candidate_infos;
@@ -402,7 +461,8 @@ bool RewriteOneSegment(
       break;
     }
     std::vector<NumberUtil::NumberString> output;
-    GetNumbers(info.type, exec_radix_conversion, arabic_content_value, &output);
+    GetNumbers(info.type, exec_radix_conversion, arabic_content_value, cache,
+               &output);
     std::vector<Segment::Candidate> converted_numbers;
     for (int j = 0; j < output.size(); ++j) {
       PushBackCandidate(output[j].value, output[j].description,
@@ -426,7 +486,8 @@ bool RewriteOneSegment(
 }  // namespace
 
 NumberRewriter::NumberRewriter(const DataManagerInterface *data_manager)
-    : pos_matcher_(data_manager->GetPOSMatcherData()) {
+    : pos_matcher_(data_manager->GetPOSMatcherData()),
+      cache_(new NumberExpansionCache) {
   const char *array = nullptr;
   size_t size = 0;
   data_manager->GetCounterSuffixSortedArray(&array, &size);
@@ -464,7 +525,7 @@ bool NumberRewriter::Rewrite(const ConversionRequest &request,
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     Segment *seg = segments->mutable_conversion_segment(i);
     modified |= RewriteOneSegment(suffix_array_, pos_matcher_,
-                                  exec_radix_conversion, seg);
+                                  exec_radix_conversion, cache_.get(), seg);
   }
 
   return modified;
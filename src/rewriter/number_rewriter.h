@@ -30,6 +30,8 @@
 #ifndef MOZC_REWRITER_NUMBER_REWRITER_H_
 #define MOZC_REWRITER_NUMBER_REWRITER_H_
 
+#include <memory>
+
 #include "base/port.h"
 #include "base/serialized_string_array.h"
 #include "dictionary/pos_matcher.h"
@@ -38,6 +40,7 @@
 namespace mozc {
 
 class DataManagerInterface;
+class NumberExpansionCache;
 
 class NumberRewriter : public RewriterInterface  {
  public:
@@ -52,6 +55,8 @@ class NumberRewriter : public RewriterInterface  {
  private:
   SerializedStringArray suffix_array_;
   const dictionary::POSMatcher pos_matcher_;
+  // Number styles of recently rewritten numbers.  See number_rewriter.cc.
+  std::unique_ptr<NumberExpansionCache> cache_;
 
   DISALLOW_COPY_AND_ASSIGN(NumberRewriter);
 };
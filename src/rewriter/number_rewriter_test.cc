@@ -32,8 +32,10 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
+#include "base/number_util.h"
 #include "base/port.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -240,6 +242,40 @@ TEST_F(NumberRewriterTest, RequestType) {
   }
 }
 
+TEST_F(NumberRewriterTest, RepeatedRewrite) {
+  std::unique_ptr<NumberRewriter> number_rewriter(CreateNumberRewriter());
+
+  // Rewrites the same numbers again after more numbers than the rewriter
+  // keeps in its cache, which must not change the results.
+  std::vector<std::vector<string>> first_values;
+  for (int round = 0; round < 2; ++round) {
+    for (int number = 1; number <= 20; ++number) {
+      SCOPED_TRACE(Util::StringPrintf("round = %d, number = %d", round,
+                                      number));
+      Segments segments;
+      Segment *seg = segments.push_back_segment();
+      Segment::Candidate *candidate = seg->add_candidate();
+      candidate->Init();
+      candidate->lid = pos_matcher_.GetNumberId();
+      candidate->rid = pos_matcher_.GetNumberId();
+      candidate->value = NumberUtil::SimpleItoa(number);
+      candidate->content_value = candidate->value;
+      EXPECT_TRUE(number_rewriter->Rewrite(default_request_, &segments));
+
+      std::vector<string> values;
+      for (size_t i = 0; i < seg->candidates_size(); ++i) {
+        values.push_back(seg->candidate(i).value + "/" +
+                         seg->candidate(i).description);
+      }
+      if (round == 0) {
+        first_values.push_back(values);
+      } else {
+        EXPECT_EQ(first_values[number - 1], values);
+      }
+    }
+  }
+}
+
 TEST_F(NumberRewriterTest, BasicTestWithSuffix) {
   std::unique_ptr<NumberRewriter> number_rewriter(CreateNumberRewriter());
 
@@ -48,6 +48,7 @@
 #include "rewriter/fortune_rewriter.h"
 #include "rewriter/katakana_promotion_rewriter.h"
 #include "rewriter/language_aware_rewriter.h"
+#include "rewriter/lazy_rewriter.h"
 #include "rewriter/merger_rewriter.h"
 #include "rewriter/normalization_rewriter.h"
 #include "rewriter/number_rewriter.h"
@@ -79,50 +80,107 @@ RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
                            const DataManagerInterface *data_manager,
                            const PosGroup *pos_group,
                            const DictionaryInterface *dictionary)
-    : pos_matcher_(data_manager->GetPOSMatcherData()) {
+    : RewriterImpl(parent_converter, data_manager, pos_group, dictionary,
+                   NONE) {}
+
+RewriterImpl::RewriterImpl(const ConverterInterface *parent_converter,
+                           const DataManagerInterface *data_manager,
+                           const PosGroup *pos_group,
+                           const DictionaryInterface *dictionary,
+                           Options options)
+    : pos_matcher_(data_manager->GetPOSMatcherData()),
+      user_boundary_history_rewriter_(NULL) {
   DCHECK(parent_converter);
   DCHECK(data_manager);
   DCHECK(pos_group);
   // |dictionary| can be NULL
+  const bool low_memory = (options & LOW_MEMORY) != 0;
 
-  AddRewriter(new UserDictionaryRewriter);
-  AddRewriter(new FocusCandidateRewriter(data_manager));
-  AddRewriter(new LanguageAwareRewriter(pos_matcher_, dictionary));
-  AddRewriter(new TransliterationRewriter(pos_matcher_));
-  AddRewriter(new EnglishVariantsRewriter);
-  AddRewriter(new NumberRewriter(data_manager));
-  AddRewriter(new CollocationRewriter(data_manager));
-  AddRewriter(new SingleKanjiRewriter(*data_manager));
-  AddRewriter(new EmojiRewriter(*data_manager));
-  AddRewriter(EmoticonRewriter::CreateFromDataManager(*data_manager).release());
-  AddRewriter(new CalculatorRewriter(parent_converter));
-  AddRewriter(new SymbolRewriter(parent_converter, data_manager));
-  AddRewriter(new UnicodeRewriter(parent_converter));
-  AddRewriter(new VariantsRewriter(pos_matcher_));
-  AddRewriter(new ZipcodeRewriter(&pos_matcher_));
-  AddRewriter(new DiceRewriter);
+  AddRewriter(new UserDictionaryRewriter, "UserDictionaryRewriter");
+  AddRewriter(new FocusCandidateRewriter(data_manager),
+              "FocusCandidateRewriter");
+  AddRewriter(new LanguageAwareRewriter(pos_matcher_, dictionary),
+              "LanguageAwareRewriter");
+  AddRewriter(new TransliterationRewriter(pos_matcher_),
+              "TransliterationRewriter");
+  AddRewriter(new EnglishVariantsRewriter, "EnglishVariantsRewriter");
+  AddRewriter(new NumberRewriter(data_manager), "NumberRewriter");
+  if (low_memory) {
+    // LazyRewriter is given the widest capability each rewriter returns.
+    AddRewriter(new LazyRewriter(
+                    [data_manager]() -> RewriterInterface * {
+                      return new CollocationRewriter(data_manager);
+                    },
+                    RewriterInterface::CONVERSION),
+                "CollocationRewriter");
+    AddRewriter(new LazyRewriter(
+                    [data_manager]() -> RewriterInterface * {
+                      return new SingleKanjiRewriter(*data_manager);
+                    },
+                    RewriterInterface::ALL),
+                "SingleKanjiRewriter");
+  } else {
+    AddRewriter(new CollocationRewriter(data_manager), "CollocationRewriter");
+    AddRewriter(new SingleKanjiRewriter(*data_manager),
+                "SingleKanjiRewriter");
+    AddRewriter(new EmojiRewriter(*data_manager), "EmojiRewriter");
+    AddRewriter(
+        EmoticonRewriter::CreateFromDataManager(*data_manager).release(),
+        "EmoticonRewriter");
+  }
+  AddRewriter(new CalculatorRewriter(parent_converter), "CalculatorRewriter");
+  if (low_memory) {
+    AddRewriter(new LazyRewriter(
+                    [parent_converter, data_manager]() -> RewriterInterface * {
+                      return new SymbolRewriter(parent_converter,
+                                                data_manager);
+                    },
+                    RewriterInterface::ALL),
+                "SymbolRewriter");
+  } else {
+    AddRewriter(new SymbolRewriter(parent_converter, data_manager),
+                "SymbolRewriter");
+  }
+  AddRewriter(new UnicodeRewriter(parent_converter), "UnicodeRewriter");
+  AddRewriter(new VariantsRewriter(pos_matcher_), "VariantsRewriter");
+  AddRewriter(new ZipcodeRewriter(&pos_matcher_), "ZipcodeRewriter");
+  if (!low_memory) {
+    AddRewriter(new DiceRewriter, "DiceRewriter");
+  }
 
   if (FLAGS_use_history_rewriter) {
-    AddRewriter(new UserBoundaryHistoryRewriter(parent_converter));
-    AddRewriter(new UserSegmentHistoryRewriter(&pos_matcher_, pos_group));
+    user_boundary_history_rewriter_ =
+        new UserBoundaryHistoryRewriter(parent_converter);
+    AddRewriter(user_boundary_history_rewriter_,
+                "UserBoundaryHistoryRewriter");
+    AddRewriter(new UserSegmentHistoryRewriter(&pos_matcher_, pos_group),
+                "UserSegmentHistoryRewriter");
   }
 
-  AddRewriter(new DateRewriter);
-  AddRewriter(new FortuneRewriter);
+  AddRewriter(new DateRewriter, "DateRewriter");
+  if (!low_memory) {
+    AddRewriter(new FortuneRewriter, "FortuneRewriter");
 #ifndef OS_ANDROID
-  // CommandRewriter is not tested well on Android.
-  // So we temporarily disable it.
-  // TODO(yukawa, team): Enable CommandRewriter on Android if necessary.
-  AddRewriter(new CommandRewriter);
+    // CommandRewriter is not tested well on Android.
+    // So we temporarily disable it.
+    // TODO(yukawa, team): Enable CommandRewriter on Android if necessary.
+    AddRewriter(new CommandRewriter, "CommandRewriter");
 #endif  // OS_ANDROID
 #ifndef NO_USAGE_REWRITER
-  AddRewriter(new UsageRewriter(data_manager, dictionary));
+    // SessionOutput fills the usages of the candidates when they are shown.
+    UsageRewriter *usage_rewriter = new UsageRewriter(data_manager, dictionary);
+    usage_rewriter->set_lazy_annotation(true);
+    AddRewriter(usage_rewriter, "UsageRewriter");
 #endif  // NO_USAGE_REWRITER
-  AddRewriter(new VersionRewriter(data_manager->GetDataVersion()));
-  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager));
-  AddRewriter(new KatakanaPromotionRewriter);
-  AddRewriter(new NormalizationRewriter);
-  AddRewriter(new RemoveRedundantCandidateRewriter);
+  }
+  AddRewriter(new VersionRewriter(data_manager->GetDataVersion()),
+              "VersionRewriter");
+  AddRewriter(CorrectionRewriter::CreateCorrectionRewriter(data_manager),
+              "CorrectionRewriter");
+  AddRewriter(new KatakanaPromotionRewriter, "KatakanaPromotionRewriter");
+  AddRewriter(new NormalizationRewriter, "NormalizationRewriter");
+  AddRewriter(new RemoveRedundantCandidateRewriter,
+              "RemoveRedundantCandidateRewriter");
 }
 
 }  // namespace mozc
@@ -58,11 +58,13 @@
         'fortune_rewriter.cc',
         'katakana_promotion_rewriter.cc',
         'language_aware_rewriter.cc',
+        'lazy_rewriter.cc',
         'normalization_rewriter.cc',
         'number_compound_util.cc',
         'number_rewriter.cc',
         'remove_redundant_candidate_rewriter.cc',
         'rewriter.cc',
+        'rewriter_profiler.cc',
         'single_kanji_rewriter.cc',
         'symbol_rewriter.cc',
         'transliteration_rewriter.cc',
@@ -82,6 +84,7 @@
         '../composer/composer.gyp:composer',
         '../config/config.gyp:character_form_manager',
         '../config/config.gyp:config_handler',
+        '../converter/converter_base.gyp:converter_util',
         '../converter/converter_base.gyp:immutable_converter',
         '../data_manager/data_manager_base.gyp:serialized_dictionary',
         '../dictionary/dictionary.gyp:dictionary',
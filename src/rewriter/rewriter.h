@@ -40,16 +40,37 @@ namespace mozc {
 
 class ConverterInterface;
 class DataManagerInterface;
+class UserBoundaryHistoryRewriter;
 
 class RewriterImpl : public MergerRewriter {
  public:
+  enum Options {
+    NONE = 0,
+    // For the devices with little memory.  The optional rewriters (emoji,
+    // emoticon, usage, fortune, dice and command) are not added, and the
+    // rewriters with tables on the heap are built on their first use by
+    // LazyRewriter.
+    LOW_MEMORY = 1,
+  };
+
   RewriterImpl(const ConverterInterface *parent_converter,
                const DataManagerInterface *data_manager,
                const dictionary::PosGroup *pos_group,
                const dictionary::DictionaryInterface *dictionary);
+  RewriterImpl(const ConverterInterface *parent_converter,
+               const DataManagerInterface *data_manager,
+               const dictionary::PosGroup *pos_group,
+               const dictionary::DictionaryInterface *dictionary,
+               Options options);
+
+  // Returns NULL if the history rewriters are disabled.
+  UserBoundaryHistoryRewriter *user_boundary_history_rewriter() const {
+    return user_boundary_history_rewriter_;
+  }
 
  private:
   const dictionary::POSMatcher pos_matcher_;
+  UserBoundaryHistoryRewriter *user_boundary_history_rewriter_;
   DISALLOW_COPY_AND_ASSIGN(RewriterImpl);
 };
 
@@ -71,6 +71,7 @@
                 '<(gen_out_dir)/usage_conj_index.data',
                 '<(gen_out_dir)/usage_conj_suffix.data',
                 '<(gen_out_dir)/usage_item_array.data',
+                '<(gen_out_dir)/usage_fingerprint_table.data',
                 '<(gen_out_dir)/usage_string_array.data',
               ],
               'action': [
@@ -81,6 +82,7 @@
                 '--output_conjugation_suffix=<(gen_out_dir)/usage_conj_suffix.data',
                 '--output_conjugation_index=<(gen_out_dir)/usage_conj_index.data',
                 '--output_usage_item_array=<(gen_out_dir)/usage_item_array.data',
+                '--output_fingerprint_table=<(gen_out_dir)/usage_fingerprint_table.data',
                 '--output_string_array=<(gen_out_dir)/usage_string_array.data',
               ],
             },
@@ -96,8 +98,9 @@
         'gen_existence_data.cc'
       ],
       'dependencies': [
-        '../storage/storage.gyp:storage#host',
+        '../base/base.gyp:base#host',
         '../base/base.gyp:codegen_bytearray_stream#host',
+        '../storage/storage.gyp:storage#host',
       ],
     },
     {
@@ -148,6 +151,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../base/base.gyp:hash',
         '../base/base.gyp:serialized_string_array',
       ],
     },
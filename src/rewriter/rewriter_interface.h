@@ -31,7 +31,9 @@
 #define MOZC_REWRITER_REWRITER_INTERFACE_H_
 
 #include <cstddef>  // for size_t
+#include <vector>
 
+#include "base/memory_stats.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 
@@ -82,6 +84,11 @@ class RewriterInterface {
   // clear internal data
   virtual void Clear() {}
 
+  // Appends the memory used by this rewriter to |usages|.  The tables mapped
+  // from the data set are reported by DataManagerInterface.
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const {}
+
  protected:
   RewriterInterface() {}
 };
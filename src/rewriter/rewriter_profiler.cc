@@ -0,0 +1,148 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/rewriter_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/singleton.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace {
+
+std::atomic<bool> g_profiler_enabled(false);
+
+class StatsTable {
+ public:
+  StatsTable() = default;
+
+  void Record(const string &name, uint64 usec, bool modified,
+              size_t prev_size, size_t size) {
+    scoped_lock l(&mutex_);
+    std::map<string, size_t>::const_iterator it = index_.find(name);
+    if (it == index_.end()) {
+      it = index_.insert(std::make_pair(name, stats_.size())).first;
+      stats_.push_back(RewriterProfiler::Stats());
+      stats_.back().name = name;
+    }
+    RewriterProfiler::Stats *stats = &stats_[it->second];
+    ++stats->num_calls;
+    if (modified) {
+      ++stats->num_modified;
+    }
+    stats->total_usec += usec;
+    stats->max_usec = std::max(stats->max_usec, usec);
+    if (size > prev_size) {
+      stats->num_added_candidates += size - prev_size;
+    } else {
+      stats->num_removed_candidates += prev_size - size;
+    }
+  }
+
+  void GetStats(std::vector<RewriterProfiler::Stats> *stats) {
+    scoped_lock l(&mutex_);
+    *stats = stats_;
+  }
+
+  void Clear() {
+    scoped_lock l(&mutex_);
+    index_.clear();
+    stats_.clear();
+  }
+
+ private:
+  Mutex mutex_;
+  // Name -> index in |stats_|.
+  std::map<string, size_t> index_;
+  std::vector<RewriterProfiler::Stats> stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(StatsTable);
+};
+
+}  // namespace
+
+// static
+void RewriterProfiler::SetEnabled(bool enabled) {
+  g_profiler_enabled = enabled;
+}
+
+// static
+bool RewriterProfiler::IsEnabled() {
+  return g_profiler_enabled;
+}
+
+// static
+void RewriterProfiler::Record(const string &name, uint64 usec, bool modified,
+                              size_t prev_size, size_t size) {
+  Singleton<StatsTable>::get()->Record(name, usec, modified, prev_size, size);
+}
+
+// static
+void RewriterProfiler::GetStats(std::vector<Stats> *stats) {
+  Singleton<StatsTable>::get()->GetStats(stats);
+}
+
+// static
+string RewriterProfiler::Dump() {
+  std::vector<Stats> stats;
+  GetStats(&stats);
+  std::stable_sort(stats.begin(), stats.end(),
+                   [](const Stats &lhs, const Stats &rhs) {
+                     return lhs.total_usec > rhs.total_usec;
+                   });
+  string output = "name\tcalls\tmodified\ttotal_usec\tavg_usec\tmax_usec\t"
+                  "added\tremoved\n";
+  for (size_t i = 0; i < stats.size(); ++i) {
+    const Stats &s = stats[i];
+    output += Util::StringPrintf(
+        "%s\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n", s.name.c_str(),
+        static_cast<unsigned long long>(s.num_calls),
+        static_cast<unsigned long long>(s.num_modified),
+        static_cast<unsigned long long>(s.total_usec),
+        static_cast<unsigned long long>(
+            s.num_calls == 0 ? 0 : s.total_usec / s.num_calls),
+        static_cast<unsigned long long>(s.max_usec),
+        static_cast<unsigned long long>(s.num_added_candidates),
+        static_cast<unsigned long long>(s.num_removed_candidates));
+  }
+  return output;
+}
+
+// static
+void RewriterProfiler::Clear() {
+  Singleton<StatsTable>::get()->Clear();
+}
+
+}  // namespace mozc
@@ -0,0 +1,86 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_REWRITER_REWRITER_PROFILER_H_
+#define MOZC_REWRITER_REWRITER_PROFILER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+// Process-wide table of the time and the candidate changes of each rewriter,
+// which MergerRewriter records while the profiling is enabled.  It's for
+// finding slow rewriters, e.g., with converter_main --profile_rewriters.
+class RewriterProfiler {
+ public:
+  struct Stats {
+    Stats()
+        : num_calls(0), num_modified(0), total_usec(0), max_usec(0),
+          num_added_candidates(0), num_removed_candidates(0) {}
+
+    string name;
+    uint64 num_calls;
+    // The number of the calls which returned true.
+    uint64 num_modified;
+    uint64 total_usec;
+    uint64 max_usec;
+    // The total increase and decrease of the number of the candidates in the
+    // conversion segments.
+    uint64 num_added_candidates;
+    uint64 num_removed_candidates;
+  };
+
+  // The profiling is disabled by default.
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled();
+
+  // Adds a call of the rewriter |name| which took |usec| and changed the
+  // number of the candidates from |prev_size| to |size|.
+  static void Record(const string &name, uint64 usec, bool modified,
+                     size_t prev_size, size_t size);
+
+  // Returns the stats of the rewriters in the order of their first records.
+  static void GetStats(std::vector<Stats> *stats);
+
+  // Returns a table of the stats, one rewriter per line, sorted by the total
+  // time in descending order.
+  static string Dump();
+
+  static void Clear();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(RewriterProfiler);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_REWRITER_PROFILER_H_
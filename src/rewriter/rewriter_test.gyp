@@ -51,6 +51,7 @@
         'focus_candidate_rewriter_test.cc',
         'fortune_rewriter_test.cc',
         'katakana_promotion_rewriter_test.cc',
+        'lazy_rewriter_test.cc',
         'merger_rewriter_test.cc',
         'normalization_rewriter_test.cc',
         'number_compound_util_test.cc',
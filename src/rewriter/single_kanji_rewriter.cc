@@ -170,9 +170,11 @@ class Uint32ArrayIterator
 // | ...              |
 //
 // Here, each element is of uint32 type.  Each of actual string values are
-// stored in |single_kanji_string_array| at its index.
+// stored in |single_kanji_string_array| at its index.  If |hash_index| is not
+// empty, it gives the row of |key| directly.
 bool LookupKanjiList(StringPiece single_kanji_token_array,
                      const SerializedStringArray &single_kanji_string_array,
+                     const SerializedDictionary::HashIndex &hash_index,
                      const string &key, std::vector<string> *kanji_list) {
   DCHECK(kanji_list);
   const uint32* token_array =
@@ -181,11 +183,16 @@ bool LookupKanjiList(StringPiece single_kanji_token_array,
       single_kanji_token_array.size() / sizeof(uint32);
 
   const Uint32ArrayIterator<2> end(token_array + token_array_size);
-  const auto iter = std::lower_bound(
-      Uint32ArrayIterator<2>(token_array), end, key,
-      [&single_kanji_string_array](uint32 index, const string &target_key) {
-        return single_kanji_string_array[index] < target_key;
-      });
+  Uint32ArrayIterator<2> iter(token_array);
+  if (!hash_index.empty()) {
+    iter += hash_index.Lookup(key);
+  } else {
+    iter = std::lower_bound(
+        iter, end, key,
+        [&single_kanji_string_array](uint32 index, const string &target_key) {
+          return single_kanji_string_array[index] < target_key;
+        });
+  }
   if (iter == end || single_kanji_string_array[iter[0]] != key) {
     return false;
   }
@@ -215,10 +222,12 @@ bool LookupKanjiList(StringPiece single_kanji_token_array,
 //
 // Here, each element is of uint32 type.  Actual strings of target and original
 // are stored in |variant_string_array|, while strings of variant type are
-// stored in |variant_type|.
+// stored in |variant_type|.  If |hash_index| is not empty, it gives the first
+// row of |key| directly.
 void GenerateDescription(StringPiece variant_token_array,
                          const SerializedStringArray &variant_string_array,
                          const SerializedStringArray &variant_type,
+                         const SerializedDictionary::HashIndex &hash_index,
                          const string &key, string *desc) {
   DCHECK(desc);
   const uint32 *token_array =
@@ -227,11 +236,16 @@ void GenerateDescription(StringPiece variant_token_array,
       variant_token_array.size() / sizeof(uint32);
 
   const Uint32ArrayIterator<3> end(token_array + token_array_size);
-  const auto iter = std::lower_bound(
-      Uint32ArrayIterator<3>(token_array), end, key,
-      [&variant_string_array](uint32 index, const string &target_key) {
-        return variant_string_array[index] < target_key;
-      });
+  Uint32ArrayIterator<3> iter(token_array);
+  if (!hash_index.empty()) {
+    iter += hash_index.Lookup(key);
+  } else {
+    iter = std::lower_bound(
+        iter, end, key,
+        [&variant_string_array](uint32 index, const string &target_key) {
+          return variant_string_array[index] < target_key;
+        });
+  }
   if (iter == end || variant_string_array[iter[0]] != key) {
     return;
   }
@@ -251,6 +265,7 @@ void AddDescriptionForExsistingCandidates(
     StringPiece variant_token_array,
     const SerializedStringArray &variant_string_array,
     const SerializedStringArray &variant_type,
+    const SerializedDictionary::HashIndex &variant_hash_index,
     Segment *segment) {
   DCHECK(segment);
   for (size_t i = 0; i < segment->candidates_size(); ++i) {
@@ -259,13 +274,15 @@ void AddDescriptionForExsistingCandidates(
       continue;
     }
     GenerateDescription(variant_token_array, variant_string_array,
-                        variant_type, cand->value, &cand->description);
+                        variant_type, variant_hash_index, cand->value,
+                        &cand->description);
   }
 }
 
 void FillCandidate(StringPiece variant_token_array,
                    const SerializedStringArray &variant_string_array,
                    const SerializedStringArray &variant_type,
+                   const SerializedDictionary::HashIndex &variant_hash_index,
                    const string &key, const string &value,
                    int cost, uint16 single_kanji_id,
                    Segment::Candidate *cand) {
@@ -279,13 +296,15 @@ void FillCandidate(StringPiece variant_token_array,
   cand->attributes |= Segment::Candidate::CONTEXT_SENSITIVE;
   cand->attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
   GenerateDescription(variant_token_array, variant_string_array,
-                      variant_type, value, &cand->description);
+                      variant_type, variant_hash_index, value,
+                      &cand->description);
 }
 
 // Insert SingleKanji into segment.
 void InsertCandidate(StringPiece variant_token_array,
                      const SerializedStringArray &variant_string_array,
                      const SerializedStringArray &variant_type,
+                     const SerializedDictionary::HashIndex &variant_hash_index,
                      bool is_single_segment,
                      uint16 single_kanji_id,
                      const std::vector<string> &kanji_list,
@@ -309,7 +328,8 @@ void InsertCandidate(StringPiece variant_token_array,
   for (size_t i = 0; i < kanji_list.size(); ++i) {
     Segment::Candidate *c = segment->push_back_candidate();
     FillCandidate(variant_token_array, variant_string_array,
-                  variant_type, candidate_key, kanji_list[i],
+                  variant_type, variant_hash_index, candidate_key,
+                  kanji_list[i],
                   kOffsetCost + i, single_kanji_id, c);
   }
 }
@@ -384,11 +404,33 @@ SingleKanjiRewriter::SingleKanjiRewriter(
   DCHECK(SerializedStringArray::VerifyData(variant_string_array_data));
   variant_string_array_.Set(variant_string_array_data);
 
+  StringPiece single_kanji_hash_index_data;
+  StringPiece variant_hash_index_data;
+  StringPiece noun_prefix_hash_index_data;
+  data_manager.GetSingleKanjiRewriterHashIndexData(
+      &single_kanji_hash_index_data,
+      &variant_hash_index_data,
+      &noun_prefix_hash_index_data);
+  if (!single_kanji_hash_index_data.empty() &&
+      !single_kanji_hash_index_.Init(
+          single_kanji_hash_index_data,
+          single_kanji_token_array_.size() / (2 * sizeof(uint32)))) {
+    LOG(ERROR) << "Broken single kanji hash index; "
+               << "falling back to binary search";
+  }
+  if (!variant_hash_index_data.empty() &&
+      !variant_hash_index_.Init(
+          variant_hash_index_data,
+          variant_token_array_.size() / (3 * sizeof(uint32)))) {
+    LOG(ERROR) << "Broken variant hash index; falling back to binary search";
+  }
+
   DCHECK(SerializedDictionary::VerifyData(noun_prefix_token_array_data,
                                           noun_prefix_string_array_data));
   noun_prefix_dictionary_.reset(new SerializedDictionary(
       noun_prefix_token_array_data,
-      noun_prefix_string_array_data));
+      noun_prefix_string_array_data,
+      noun_prefix_hash_index_data));
 }
 
 SingleKanjiRewriter::~SingleKanjiRewriter() {}
@@ -415,17 +457,19 @@ bool SingleKanjiRewriter::Rewrite(const ConversionRequest &request,
         variant_token_array_,
         variant_string_array_,
         variant_type_array_,
+        variant_hash_index_,
         segments->mutable_conversion_segment(i));
 
     const string &key = segments->conversion_segment(i).key();
     std::vector<string> kanji_list;
     if (!LookupKanjiList(single_kanji_token_array_, single_kanji_string_array_,
-                         key, &kanji_list)) {
+                         single_kanji_hash_index_, key, &kanji_list)) {
       continue;
     }
     InsertCandidate(variant_token_array_,
                     variant_string_array_,
                     variant_type_array_,
+                    variant_hash_index_,
                     is_single_segment,
                     pos_matcher_.GetGeneralSymbolId(),
                     kanji_list,
@@ -56,11 +56,15 @@ class SingleKanjiRewriter : public RewriterInterface  {
 
   StringPiece single_kanji_token_array_;
   SerializedStringArray single_kanji_string_array_;
+  // Optional; empty if the data set doesn't have it.
+  SerializedDictionary::HashIndex single_kanji_hash_index_;
 
   SerializedStringArray variant_type_array_;
 
   StringPiece variant_token_array_;
   SerializedStringArray variant_string_array_;
+  // Optional; empty if the data set doesn't have it.
+  SerializedDictionary::HashIndex variant_hash_index_;
 
   // Since noun_prefix_dictionary_ is just a tentative workaround,
   // we copy the SingleKanji structure so that we can remove this workaround
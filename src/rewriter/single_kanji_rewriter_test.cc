@@ -249,4 +249,32 @@ TEST_F(SingleKanjiRewriterTest, AddDescriptionTest) {
   EXPECT_EQ("\xe4\xba\x9c\xe3\x81\xae\xe6\x97\xa7\xe5\xad\x97\xe4\xbd\x93",
             segment->candidate(0).description);
 }
+
+TEST_F(SingleKanjiRewriterTest, LookupMissWithHashIndex) {
+  StringPiece single_kanji_hash_index, variant_hash_index,
+      noun_prefix_hash_index;
+  data_manager_->GetSingleKanjiRewriterHashIndexData(
+      &single_kanji_hash_index, &variant_hash_index, &noun_prefix_hash_index);
+  EXPECT_FALSE(single_kanji_hash_index.empty());
+  EXPECT_FALSE(variant_hash_index.empty());
+  EXPECT_FALSE(noun_prefix_hash_index.empty());
+
+  // Keys missing in the data are still hashed to some rows, which must not
+  // be taken as hits.
+  SingleKanjiRewriter rewriter(*data_manager_);
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  segment->set_key("not a reading");
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->Init();
+  candidate->key = segment->key();
+  candidate->content_key = segment->key();
+  candidate->value = "not a kanji";
+  candidate->content_value = candidate->value;
+
+  EXPECT_FALSE(rewriter.Rewrite(default_request_, &segments));
+  EXPECT_EQ(1, segment->candidates_size());
+  EXPECT_TRUE(segment->candidate(0).description.empty());
+}
+
 }  // namespace mozc
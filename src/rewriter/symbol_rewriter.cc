@@ -337,8 +337,13 @@ SymbolRewriter::SymbolRewriter(const ConverterInterface *parent_converter,
   StringPiece token_array_data, string_array_data;
   data_manager->GetSymbolRewriterData(&token_array_data, &string_array_data);
   DCHECK(SerializedDictionary::VerifyData(token_array_data, string_array_data));
+  StringPiece hash_index_data, unused_emoticon_data, unused_emoji_data;
+  data_manager->GetRewriterHashIndexData(&hash_index_data,
+                                         &unused_emoticon_data,
+                                         &unused_emoji_data);
   dictionary_.reset(new SerializedDictionary(token_array_data,
-                                             string_array_data));
+                                             string_array_data,
+                                             hash_index_data));
 }
 
 SymbolRewriter::~SymbolRewriter() {}
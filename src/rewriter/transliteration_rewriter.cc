@@ -29,6 +29,7 @@
 
 #include "rewriter/transliteration_rewriter.h"
 
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -83,11 +84,8 @@ bool IsComposerApplicable(const ConversionRequest &request,
 
 void NormalizeT13ns(std::vector<string> *t13ns) {
   DCHECK(t13ns);
-  string normalized;
   for (size_t i = 0; i < t13ns->size(); ++i) {
-    normalized.clear();
-    TextNormalizer::NormalizeText(t13ns->at(i), &normalized);
-    t13ns->at(i) = normalized;
+    TextNormalizer::NormalizeTextInPlace(&t13ns->at(i));
   }
 }
 
@@ -227,6 +225,62 @@ void ModifyT13ns(const ConversionRequest &request,
 
   NormalizeT13ns(t13ns);
 }
+
+void InitCandidate(const string &key, const string &value,
+                   uint16 lid, uint16 rid, uint16 unknown_id,
+                   Segment::Candidate *cand) {
+  DCHECK(cand);
+  cand->Init();
+  cand->value = value;
+  cand->key = key;
+  cand->content_value = value;
+  cand->content_key = key;
+  cand->lid = (lid != 0) ? lid : unknown_id;
+  cand->rid = (rid != 0) ? rid : unknown_id;
+}
+
+// Builds the meta candidates of a segment from its transliterations when they
+// are accessed first.  Only the focused segment usually needs them.
+class T13nCandidatesGenerator : public MetaCandidatesGeneratorInterface {
+ public:
+  T13nCandidatesGenerator(const string &key, const std::vector<string> &t13ns,
+                          const T13nIds &ids, uint16 unknown_id)
+      : key_(key), t13ns_(t13ns), ids_(ids), unknown_id_(unknown_id) {
+    DCHECK_EQ(transliteration::NUM_T13N_TYPES, t13ns_.size());
+  }
+
+  virtual void Generate(
+      std::vector<Segment::Candidate> *meta_candidates) const {
+    meta_candidates->resize(transliteration::NUM_T13N_TYPES);
+    for (size_t i = 0; i < transliteration::NUM_T13N_TYPES; ++i) {
+      uint16 lid = ids_.ascii_lid;
+      uint16 rid = ids_.ascii_rid;
+      switch (i) {
+        case transliteration::HIRAGANA:
+          lid = ids_.hiragana_lid;
+          rid = ids_.hiragana_rid;
+          break;
+        case transliteration::FULL_KATAKANA:
+        case transliteration::HALF_KATAKANA:
+          lid = ids_.katakana_lid;
+          rid = ids_.katakana_rid;
+          break;
+        default:
+          break;
+      }
+      InitCandidate(key_, t13ns_[i], lid, rid, unknown_id_,
+                    &meta_candidates->at(i));
+    }
+  }
+
+ private:
+  const string key_;
+  const std::vector<string> t13ns_;
+  const T13nIds ids_;
+  const uint16 unknown_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(T13nCandidatesGenerator);
+};
 }  // namespace
 
 
@@ -427,14 +481,7 @@ void TransliterationRewriter::InitT13nCandidate(
     uint16 lid,
     uint16 rid,
     Segment::Candidate *cand) const {
-  DCHECK(cand);
-  cand->Init();
-  cand->value = value;
-  cand->key = key;
-  cand->content_value = value;
-  cand->content_key = key;
-  cand->lid = (lid != 0) ? lid : unknown_id_;
-  cand->rid = (rid != 0) ? rid : unknown_id_;
+  InitCandidate(key, value, lid, rid, unknown_id_, cand);
 }
 
 bool TransliterationRewriter::SetTransliterations(
@@ -445,60 +492,12 @@ bool TransliterationRewriter::SetTransliterations(
     return false;
   }
 
-  segment->clear_meta_candidates();
-
+  // The ids are taken now since the later rewriters may change the
+  // candidates.
   T13nIds ids;
   GetIds(*segment, &ids);
-
-  std::vector<Segment::Candidate> *meta_candidates =
-      segment->mutable_meta_candidates();
-  meta_candidates->resize(transliteration::NUM_T13N_TYPES);
-
-  InitT13nCandidate(key, t13ns[transliteration::HIRAGANA],
-                    ids.hiragana_lid, ids.hiragana_rid,
-                    &meta_candidates->at(transliteration::HIRAGANA));
-
-  InitT13nCandidate(key, t13ns[transliteration::FULL_KATAKANA],
-                    ids.katakana_lid, ids.katakana_rid,
-                    &meta_candidates->at(transliteration::FULL_KATAKANA));
-
-  InitT13nCandidate(key, t13ns[transliteration::HALF_ASCII],
-                    ids.ascii_lid, ids.ascii_rid,
-                    &meta_candidates->at(transliteration::HALF_ASCII));
-
-  InitT13nCandidate(key, t13ns[transliteration::HALF_ASCII_UPPER],
-                    ids.ascii_lid, ids.ascii_rid,
-                    &meta_candidates->at(transliteration::HALF_ASCII_UPPER));
-
-  InitT13nCandidate(key, t13ns[transliteration::HALF_ASCII_LOWER],
-                    ids.ascii_lid, ids.ascii_rid,
-                    &meta_candidates->at(transliteration::HALF_ASCII_LOWER));
-
-  InitT13nCandidate(
-      key, t13ns[transliteration::HALF_ASCII_CAPITALIZED],
-      ids.ascii_lid, ids.ascii_rid,
-      &meta_candidates->at(transliteration::HALF_ASCII_CAPITALIZED));
-
-  InitT13nCandidate(key, t13ns[transliteration::FULL_ASCII],
-                    ids.ascii_lid, ids.ascii_rid,
-                    &meta_candidates->at(transliteration::FULL_ASCII));
-
-  InitT13nCandidate(key, t13ns[transliteration::FULL_ASCII_UPPER],
-                    ids.ascii_lid, ids.ascii_rid,
-                    &meta_candidates->at(transliteration::FULL_ASCII_UPPER));
-
-  InitT13nCandidate(key, t13ns[transliteration::FULL_ASCII_LOWER],
-                    ids.ascii_lid, ids.ascii_rid,
-                    &meta_candidates->at(transliteration::FULL_ASCII_LOWER));
-
-  InitT13nCandidate(
-      key, t13ns[transliteration::FULL_ASCII_CAPITALIZED],
-      ids.ascii_lid, ids.ascii_rid,
-      &meta_candidates->at(transliteration::FULL_ASCII_CAPITALIZED));
-
-  InitT13nCandidate(key, t13ns[transliteration::HALF_KATAKANA],
-                    ids.katakana_lid, ids.katakana_rid,
-                    &meta_candidates->at(transliteration::HALF_KATAKANA));
+  segment->set_meta_candidates_generator(
+      std::make_shared<T13nCandidatesGenerator>(key, t13ns, ids, unknown_id_));
   return true;
 }
 
@@ -302,6 +302,9 @@ TEST_F(TransliterationRewriterTest, T13nWithMultiSegmentsTest) {
 
   EXPECT_TRUE(t13n_rewriter->Rewrite(request, &segments));
   EXPECT_EQ(2, segments.conversion_segments_size());
+  // The meta candidates are built when they are accessed.
+  EXPECT_TRUE(segments.conversion_segment(0).has_pending_meta_candidates());
+  EXPECT_TRUE(segments.conversion_segment(1).has_pending_meta_candidates());
   {
     const Segment &seg = segments.conversion_segment(0);
     // "かまぼこの"
@@ -31,8 +31,10 @@
 
 #include "rewriter/usage_rewriter.h"
 
+#include <algorithm>
 #include <string>
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/serialized_string_array.h"
 #include "base/util.h"
@@ -53,51 +55,40 @@ UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                              const DictionaryInterface *dictionary)
     : pos_matcher_(data_manager->GetPOSMatcherData()),
       dictionary_(dictionary),
-      base_conjugation_suffix_(nullptr) {
+      base_conjugation_suffix_(nullptr),
+      usage_items_(nullptr),
+      num_usage_items_(0),
+      fingerprint_table_begin_(nullptr),
+      fingerprint_table_end_(nullptr),
+      lazy_annotation_(false) {
   StringPiece base_conjugation_suffix_data;
   StringPiece conjugation_suffix_data;
   StringPiece conjugation_suffix_index_data;
   StringPiece usage_items_data;
+  StringPiece fingerprint_table_data;
   StringPiece string_array_data;
   data_manager->GetUsageRewriterData(&base_conjugation_suffix_data,
                                      &conjugation_suffix_data,
                                      &conjugation_suffix_index_data,
                                      &usage_items_data,
+                                     &fingerprint_table_data,
                                      &string_array_data);
   base_conjugation_suffix_ =
       reinterpret_cast<const uint32 *>(base_conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix =
-      reinterpret_cast<const uint32 *>(conjugation_suffix_data.data());
-  const uint32 *conjugation_suffix_data_index =
-      reinterpret_cast<const uint32 *>(conjugation_suffix_index_data.data());
 
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   string_array_.Set(string_array_data);
 
-  UsageDictItemIterator begin(usage_items_data.data());
-  UsageDictItemIterator end(usage_items_data.data() + usage_items_data.size());
+  usage_items_ = usage_items_data.data();
+  num_usage_items_ = usage_items_data.size() / kUsageItemByteLength;
 
-  // TODO(taku): To reduce memory footprint, better to replace it with
-  // binary search over the conjugation_suffix_data diretly.
-  for (; begin != end; ++begin) {
-    for (size_t i = conjugation_suffix_data_index[begin.conjugation_id()];
-         i < conjugation_suffix_data_index[begin.conjugation_id() + 1];
-         ++i) {
-      const StringPiece key = string_array_[begin.key_index()];
-      const StringPiece value = string_array_[begin.value_index()];
-      const StringPiece key_suffix =
-          string_array_[conjugation_suffix[2 * i + 1]];
-      const StringPiece value_suffix =
-          string_array_[conjugation_suffix[2 * i]];
-      StrPair key_value1;
-      Util::ConcatStrings(key, key_suffix, &key_value1.first);
-      Util::ConcatStrings(value, value_suffix, &key_value1.second);
-      key_value_usageitem_map_[key_value1] = begin;
-
-      StrPair key_value2("", key_value1.second);
-      key_value_usageitem_map_[key_value2] = begin;
-    }
-  }
+  // The conjugated forms of all the items are enumerated in advance by the
+  // generator, so the table is used in place.
+  DCHECK_EQ(0, fingerprint_table_data.size() % sizeof(FingerprintEntry));
+  fingerprint_table_begin_ =
+      reinterpret_cast<const FingerprintEntry *>(fingerprint_table_data.data());
+  fingerprint_table_end_ = fingerprint_table_begin_ +
+      fingerprint_table_data.size() / sizeof(FingerprintEntry);
 }
 
 UsageRewriter::~UsageRewriter() {
@@ -138,6 +129,30 @@ string UsageRewriter::GetKanjiPrefixAndOneHiragana(const string &word) {
   return "";
 }
 
+UsageRewriter::UsageDictItemIterator UsageRewriter::LookupItem(
+    StringPiece key, StringPiece value) const {
+  // Must be kept in sync with gen_usage_rewriter_dictionary_main.cc.
+  const uint64 fp =
+      Hash::FingerprintWithSeed(value, Hash::Fingerprint32(key));
+  const FingerprintEntry *entry = std::lower_bound(
+      fingerprint_table_begin_, fingerprint_table_end_, fp,
+      [](const FingerprintEntry &e, uint64 target) {
+        return e.fingerprint < target;
+      });
+  if (entry == fingerprint_table_end_ || entry->fingerprint != fp ||
+      entry->item_index >= num_usage_items_) {
+    return UsageDictItemIterator();
+  }
+  const UsageDictItemIterator item(
+      usage_items_ + entry->item_index * kUsageItemByteLength);
+  // The table stores no strings, so at least check that the value begins with
+  // the base form of the item to guard against fingerprint collisions.
+  if (!Util::StartsWith(value, string_array_[item.value_index()])) {
+    return UsageDictItemIterator();
+  }
+  return item;
+}
+
 UsageRewriter::UsageDictItemIterator
 UsageRewriter::LookupUnmatchedUsageHeuristically(
     const Segment::Candidate &candidate) const {
@@ -154,15 +169,14 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
   }
 
   // key is empty;
-  StrPair key_value("", value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr == key_value_usageitem_map_.end()) {
+  const UsageDictItemIterator item = LookupItem("", value);
+  if (!item.IsValid()) {
     return UsageDictItemIterator();
   }
   // Check result key part is a prefix of the content_key.
-  const StringPiece key = string_array_[itr->second.key_index()];
+  const StringPiece key = string_array_[item.key_index()];
   if (Util::StartsWith(candidate.content_key, key)) {
-    return itr->second;
+    return item;
   }
 
   return UsageDictItemIterator();
@@ -170,12 +184,10 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
 
 UsageRewriter::UsageDictItemIterator UsageRewriter::LookupUsage(
     const Segment::Candidate &candidate) const {
-  const string &key = candidate.content_key;
-  const string &value = candidate.content_value;
-  StrPair key_value(key, value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr != key_value_usageitem_map_.end()) {
-    return itr->second;
+  const UsageDictItemIterator item =
+      LookupItem(candidate.content_key, candidate.content_value);
+  if (item.IsValid()) {
+    return item;
   }
 
   return LookupUnmatchedUsageHeuristically(candidate);
@@ -202,53 +214,21 @@ bool UsageRewriter::Rewrite(const ConversionRequest &request,
   // dictionary.  Since just the uniqueness in one Segments is sufficient, for
   // usage from the user dictionary, we simply assign sequential numbers larger
   // than the maximum ID of the embedded usage dictionary.
-  int32 usage_id_for_user_comment = key_value_usageitem_map_.size();
-  string comment;
+  int32 usage_id_for_user_comment = num_usage_items_;
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     Segment *segment = segments->mutable_conversion_segment(i);
     DCHECK(segment);
     for (size_t j = 0; j < segment->candidates_size(); ++j) {
       ++usage_id_for_user_comment;
-
-      // First, search the user dictionary for comment.
-      if (dictionary_ != NULL) {
-        if (dictionary_->LookupComment(segment->candidate(j).content_key,
-                                       segment->candidate(j).content_value,
-                                       request,
-                                       &comment)) {
-          Segment::Candidate *candidate = segment->mutable_candidate(j);
-          candidate->usage_id = usage_id_for_user_comment;
-          candidate->usage_title = segment->candidate(j).content_value;
-          candidate->usage_description = comment;
-          comment.clear();
-          modified = true;
-          continue;
-        }
+      Segment::Candidate *candidate = segment->mutable_candidate(j);
+      if (lazy_annotation_) {
+        candidate->annotator = this;
+        modified = true;
+        continue;
       }
-
-      // If comment isn't in the user dictionary, search the system usage
-      // dictionary.
-      const UsageDictItemIterator iter = LookupUsage(segment->candidate(j));
-      if (iter.IsValid()) {
-        Segment::Candidate *candidate = segment->mutable_candidate(j);
-        DCHECK(candidate);
-        candidate->usage_id = iter.usage_id();
-
-        const StringPiece value_suffix = string_array_[
-            base_conjugation_suffix_[2 * iter.conjugation_id()]];
-        string_array_[iter.value_index()].CopyToString(&candidate->usage_title);
-        value_suffix.AppendToString(&candidate->usage_title);
-
-        string_array_[iter.meaning_index()].CopyToString(
-            &candidate->usage_description);
-
-        VLOG(2) << i << ":" << j
-                << ":" << candidate->content_key
-                << ":" << candidate->content_value
-                << ":" << string_array_[iter.key_index()]
-                << ":" << string_array_[iter.value_index()]
-                << ":" << iter.conjugation_id()
-                << ":" << string_array_[iter.meaning_index()];
+      if (FillUsage(request, usage_id_for_user_comment, candidate)) {
+        VLOG(2) << i << ":" << j << ":" << candidate->content_key << ":"
+                << candidate->content_value << ":" << candidate->usage_id;
         modified = true;
       }
     }
@@ -256,6 +236,50 @@ bool UsageRewriter::Rewrite(const ConversionRequest &request,
   return modified;
 }
 
+void UsageRewriter::Annotate(const ConversionRequest &request,
+                             int candidate_id,
+                             Segment::Candidate *candidate) const {
+  // The candidates are annotated one by one, so the usage IDs for the user
+  // comments are unique only in a segment, which is enough for SessionOutput.
+  FillUsage(request, num_usage_items_ + 1 + candidate_id,
+            candidate);
+}
+
+bool UsageRewriter::FillUsage(const ConversionRequest &request,
+                              int32 usage_id_for_user_comment,
+                              Segment::Candidate *candidate) const {
+  // First, search the user dictionary for comment.
+  if (dictionary_ != NULL) {
+    string comment;
+    if (dictionary_->LookupComment(candidate->content_key,
+                                   candidate->content_value,
+                                   request,
+                                   &comment)) {
+      candidate->usage_id = usage_id_for_user_comment;
+      candidate->usage_title = candidate->content_value;
+      candidate->usage_description.swap(comment);
+      return true;
+    }
+  }
+
+  // If comment isn't in the user dictionary, search the system usage
+  // dictionary.
+  const UsageDictItemIterator iter = LookupUsage(*candidate);
+  if (!iter.IsValid()) {
+    return false;
+  }
+  candidate->usage_id = iter.usage_id();
+
+  const StringPiece value_suffix = string_array_[
+      base_conjugation_suffix_[2 * iter.conjugation_id()]];
+  string_array_[iter.value_index()].CopyToString(&candidate->usage_title);
+  value_suffix.AppendToString(&candidate->usage_title);
+
+  string_array_[iter.meaning_index()].CopyToString(
+      &candidate->usage_description);
+  return true;
+}
+
 }  // namespace mozc
 
 #endif  // NO_USAGE_REWRITER
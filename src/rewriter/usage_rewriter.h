@@ -32,9 +32,7 @@
 
 #ifndef NO_USAGE_REWRITER
 
-#include <map>
 #include <string>
-#include <utility>
 
 #include "base/port.h"
 #include "base/serialized_string_array.h"
@@ -48,7 +46,8 @@ namespace mozc {
 
 class DataManagerInterface;
 
-class UsageRewriter : public RewriterInterface  {
+class UsageRewriter : public RewriterInterface,
+                      public CandidateAnnotatorInterface {
  public:
   UsageRewriter(const DataManagerInterface *data_manager,
                 const dictionary::DictionaryInterface *dictionary);
@@ -56,6 +55,17 @@ class UsageRewriter : public RewriterInterface  {
   virtual bool Rewrite(const ConversionRequest &request,
                        Segments *segments) const;
 
+  // If true, Rewrite() only makes the candidates refer to this rewriter, and
+  // their usages are filled by Segment::AnnotateCandidate() when they are
+  // shown.  The default is false.
+  void set_lazy_annotation(bool lazy_annotation) {
+    lazy_annotation_ = lazy_annotation;
+  }
+
+  // CandidateAnnotatorInterface
+  virtual void Annotate(const ConversionRequest &request, int candidate_id,
+                        Segment::Candidate *candidate) const;
+
   // better to show usage when user type "tab" key.
   virtual int capability(const ConversionRequest &request) const {
     return CONVERSION | PREDICTION;
@@ -104,19 +114,40 @@ class UsageRewriter : public RewriterInterface  {
     const char *ptr_;
   };
 
-  using StrPair = std::pair<string, string>;
+  // Entry of the fingerprint table generated by
+  // gen_usage_rewriter_dictionary_main.cc.
+  struct FingerprintEntry {
+    uint64 fingerprint;
+    uint32 item_index;
+    uint32 padding;
+  };
+
   static string GetKanjiPrefixAndOneHiragana(const string &word);
 
+  // Looks up the usage item of the conjugated |key| and |value| from the
+  // fingerprint table.  |key| is empty for the heuristic lookup.
+  UsageDictItemIterator LookupItem(StringPiece key, StringPiece value) const;
+
   UsageDictItemIterator LookupUnmatchedUsageHeuristically(
       const Segment::Candidate &candidate) const;
   UsageDictItemIterator LookupUsage(
       const Segment::Candidate &candidate) const;
+  // Fills the usage of |candidate|.  |usage_id_for_user_comment| is used as
+  // the usage ID of the comment in the user dictionary.  Returns true if a
+  // usage is found.
+  bool FillUsage(const ConversionRequest &request,
+                 int32 usage_id_for_user_comment,
+                 Segment::Candidate *candidate) const;
 
-  std::map<StrPair, UsageDictItemIterator> key_value_usageitem_map_;
   const dictionary::POSMatcher pos_matcher_;
   const dictionary::DictionaryInterface *dictionary_;
   const uint32 *base_conjugation_suffix_;
+  const char *usage_items_;
+  size_t num_usage_items_;
+  const FingerprintEntry *fingerprint_table_begin_;
+  const FingerprintEntry *fingerprint_table_end_;
   SerializedStringArray string_array_;
+  bool lazy_annotation_;
 };
 
 }  // namespace mozc
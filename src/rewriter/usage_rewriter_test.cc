@@ -182,6 +182,44 @@ TEST_F(UsageRewriterTest, SingleSegmentSingleCandidateTest) {
   EXPECT_EQ("", segments.conversion_segment(0).candidate(0).usage_description);
 }
 
+TEST_F(UsageRewriterTest, LazyAnnotationTest) {
+  Segments segments;
+  std::unique_ptr<UsageRewriter> rewriter(CreateUsageRewriter());
+  rewriter->set_lazy_annotation(true);
+
+  Segment *seg = segments.push_back_segment();
+  // "あおい"
+  seg->set_key("\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x84");
+  // "あおい", "青い", "あおい", "青い"
+  AddCandidate("\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x84",
+               "\xE9\x9D\x92\xE3\x81\x84",
+               "\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x84",
+               "\xE9\x9D\x92\xE3\x81\x84", seg);
+  // "あおい", "あああ", "あおい", "あああ"
+  AddCandidate("\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x84",
+               "\xE3\x81\x82\xE3\x81\x82\xE3\x81\x82",
+               "\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x84",
+               "\xE3\x81\x82\xE3\x81\x82\xE3\x81\x82", seg);
+  EXPECT_TRUE(rewriter->Rewrite(convreq_, &segments));
+  for (size_t i = 0; i < seg->candidates_size(); ++i) {
+    EXPECT_EQ(rewriter.get(), seg->candidate(i).annotator);
+    EXPECT_EQ("", seg->candidate(i).usage_title);
+  }
+
+  // Only the annotated candidate gets the usage.
+  seg->AnnotateCandidate(convreq_, 0);
+  EXPECT_TRUE(seg->candidate(0).annotator == NULL);
+  // "青い"
+  EXPECT_EQ("\xE9\x9D\x92\xE3\x81\x84", seg->candidate(0).usage_title);
+  EXPECT_NE("", seg->candidate(0).usage_description);
+  EXPECT_EQ(rewriter.get(), seg->candidate(1).annotator);
+
+  seg->AnnotateCandidate(convreq_, 1);
+  EXPECT_TRUE(seg->candidate(1).annotator == NULL);
+  EXPECT_EQ("", seg->candidate(1).usage_title);
+  EXPECT_EQ("", seg->candidate(1).usage_description);
+}
+
 TEST_F(UsageRewriterTest, ConfigTest) {
   Segments segments;
   std::unique_ptr<UsageRewriter> rewriter(CreateUsageRewriter());
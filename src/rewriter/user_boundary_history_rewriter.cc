@@ -41,6 +41,7 @@
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/converter_interface.h"
+#include "converter/converter_util.h"
 #include "converter/segments.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
@@ -59,7 +60,8 @@ const uint32 kSeedValue = 0x761fea81;
 
 const char kFileName[] = "user://boundary.db";
 
-enum { INSERT, RESIZE };
+// CONSTRAIN resizes the segments without converting them.
+enum { INSERT, RESIZE, CONSTRAIN };
 
 class LengthArray {
  public:
@@ -111,6 +113,7 @@ class LengthArray {
 UserBoundaryHistoryRewriter::UserBoundaryHistoryRewriter(
     const ConverterInterface *parent_converter)
     : parent_converter_(parent_converter),
+      resize_on_rewrite_(true),
       storage_(new LRUStorage) {
   DCHECK(parent_converter_);
   Reload();
@@ -165,6 +168,22 @@ void UserBoundaryHistoryRewriter::Finish(const ConversionRequest &request,
 
 bool UserBoundaryHistoryRewriter::Rewrite(
     const ConversionRequest &request, Segments *segments) const {
+  if (!resize_on_rewrite_ || !CanResize(request, *segments)) {
+    return false;
+  }
+  return ResizeOrInsert(segments, request, RESIZE);
+}
+
+bool UserBoundaryHistoryRewriter::ConstrainBoundaries(
+    const ConversionRequest &request, Segments *segments) const {
+  if (!CanResize(request, *segments)) {
+    return false;
+  }
+  return ResizeOrInsert(segments, request, CONSTRAIN);
+}
+
+bool UserBoundaryHistoryRewriter::CanResize(
+    const ConversionRequest &request, const Segments &segments) const {
   if (request.config().incognito_mode()) {
     VLOG(2) << "incognito mode";
     return false;
@@ -175,7 +194,7 @@ bool UserBoundaryHistoryRewriter::Rewrite(
     return false;
   }
 
-  if (!segments->user_history_enabled()) {
+  if (!segments.user_history_enabled()) {
     VLOG(2) << "!user_history_enabled";
     return false;
   }
@@ -189,11 +208,15 @@ bool UserBoundaryHistoryRewriter::Rewrite(
     return false;
   }
 
-  if (!segments->resized()) {
-    return ResizeOrInsert(segments, request, RESIZE);
-  }
+  return !segments.resized();
+}
 
-  return false;
+bool UserBoundaryHistoryRewriter::Sync() {
+  if (storage_.get() == NULL) {
+    return true;
+  }
+  VLOG(1) << "Flushing " << storage_->dirty_pages() << " dirty pages";
+  return storage_->Flush();
 }
 
 bool UserBoundaryHistoryRewriter::Reload() {
@@ -268,7 +291,7 @@ bool UserBoundaryHistoryRewriter::ResizeOrInsert(
       length_array[k] = static_cast<uint8>(keys[k].second);
     }
     for (int j = static_cast<int>(keys_size) - 1; j >= 0; --j) {
-      if (type == RESIZE) {
+      if (type == RESIZE || type == CONSTRAIN) {
         const LengthArray *value =
             reinterpret_cast<const LengthArray *>(storage_->Lookup(key));
         if (value != NULL) {
@@ -288,11 +311,16 @@ bool UserBoundaryHistoryRewriter::ResizeOrInsert(
                     << " " << static_cast<int>(length_array[5])
                     << " " << static_cast<int>(length_array[6])
                     << " " << static_cast<int>(length_array[7]);
-            parent_converter_->ResizeSegment(segments,
-                                             request,
-                                             i - history_segments_size,
-                                             j + 1,
-                                             length_array, 8);
+            if (type == RESIZE) {
+              parent_converter_->ResizeSegment(segments,
+                                               request,
+                                               i - history_segments_size,
+                                               j + 1,
+                                               length_array, 8);
+            } else {
+              ConverterUtil::ResizeSegments(i, j + 1, length_array, 8,
+                                            segments);
+            }
             i += (j + target_segments_size - old_segments_size);
             result = true;
             break;
@@ -331,4 +359,11 @@ void UserBoundaryHistoryRewriter::Clear() {
   }
 }
 
+void UserBoundaryHistoryRewriter::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  if (storage_.get() != NULL) {
+    usages->push_back(storage_->GetMemoryUsage("lru_storage:user_boundary_history"));
+  }
+}
+
 }  // namespace mozc
@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "converter/boundary_constraint_interface.h"
 #include "rewriter/rewriter_interface.h"
 
 namespace mozc {
@@ -48,7 +49,8 @@ namespace storage {
 class LRUStorage;
 }  // namespace storage
 
-class UserBoundaryHistoryRewriter : public RewriterInterface {
+class UserBoundaryHistoryRewriter : public RewriterInterface,
+                                    public BoundaryConstraintInterface {
  public:
   explicit UserBoundaryHistoryRewriter(
       const ConverterInterface *parent_converter);
@@ -59,15 +61,37 @@ class UserBoundaryHistoryRewriter : public RewriterInterface {
 
   virtual void Finish(const ConversionRequest &request, Segments *segments);
 
+  // Writes the learning modified since the last call back to the disk.
+  virtual bool Sync();
+
   virtual bool Reload();
 
   virtual void Clear();
 
+  // Reports the storage as "lru_storage:user_boundary_history".
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const;
+
+  // Resizes the segments of the best path with the learned boundaries before
+  // the candidates are made.  See ImmutableConverterImpl.
+  virtual bool ConstrainBoundaries(const ConversionRequest &request,
+                                   Segments *segments) const;
+
+  // When false, Rewrite() doesn't resize the converted segments, which is
+  // for the case that the immutable converter calls ConstrainBoundaries()
+  // instead.  True by default.
+  void set_resize_on_rewrite(bool resize_on_rewrite) {
+    resize_on_rewrite_ = resize_on_rewrite;
+  }
+
  private:
+  bool CanResize(const ConversionRequest &request,
+                 const Segments &segments) const;
   bool ResizeOrInsert(Segments *segments, const ConversionRequest &request,
                       int type) const;
 
   const ConverterInterface *parent_converter_;
+  bool resize_on_rewrite_;
   std::unique_ptr<mozc::storage::LRUStorage> storage_;
 };
 
@@ -223,6 +223,43 @@ TEST_F(UserBoundaryHistoryRewriterTest, Rewrite2) {
   }
 }
 
+// "たんぽぽ" -> "たん|ぽぽ" without the parent converter.
+TEST_F(UserBoundaryHistoryRewriterTest, ConstrainBoundaries) {
+  SetIncognito(false);
+  SetLearningLevel(config::Config::DEFAULT_HISTORY);
+  UserBoundaryHistoryRewriter rewriter(&mock());
+  rewriter.set_resize_on_rewrite(false);
+  Segments bounded_segments;
+  SetBoundedSegments(&bounded_segments, true);
+  bounded_segments.set_resized(true);
+  bounded_segments.set_user_history_enabled(true);
+
+  rewriter.Finish(request_, &bounded_segments);
+
+  Segments segments;
+  segments.set_user_history_enabled(true);
+  // "たんぽぽ"
+  segments.add_segment()->set_key(
+      "\xe3\x81\x9f\xe3\x82\x93\xe3\x81\xbd\xe3\x81\xbd");
+
+  // Rewrite() leaves the segments to ConstrainBoundaries().
+  EXPECT_FALSE(rewriter.Rewrite(request_, &segments));
+  EXPECT_EQ(1, segments.segments_size());
+
+  EXPECT_TRUE(rewriter.ConstrainBoundaries(request_, &segments));
+  EXPECT_TRUE(segments.resized());
+  ASSERT_EQ(2, segments.segments_size());
+  // "たん"
+  EXPECT_EQ("\xe3\x81\x9f\xe3\x82\x93", segments.segment(0).key());
+  EXPECT_EQ(Segment::FIXED_BOUNDARY, segments.segment(0).segment_type());
+  // "ぽぽ"
+  EXPECT_EQ("\xe3\x81\xbd\xe3\x81\xbd", segments.segment(1).key());
+  EXPECT_EQ(Segment::FIXED_BOUNDARY, segments.segment(1).segment_type());
+
+  // The segments are resized now.
+  EXPECT_FALSE(rewriter.ConstrainBoundaries(request_, &segments));
+}
+
 TEST_F(UserBoundaryHistoryRewriterTest, NoInsertWhenIncognito) {
   SetIncognito(true);
   SetLearningLevel(config::Config::DEFAULT_HISTORY);
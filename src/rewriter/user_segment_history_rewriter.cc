@@ -470,10 +470,14 @@ bool UserSegmentHistoryRewriter::SortCandidates(
 
     if (normalized_value != candidate->value) {
       const Segment::Candidate *normalized_cand = NULL;
-      for (size_t l = 0; l < segment->candidates_size(); ++l) {
-        if (segment->candidate(l).value == normalized_value) {
-          normalized_cand = &segment->candidate(l);
-          break;
+      // The normalized value is usually missing, in which case the index of
+      // the segment saves the scan.
+      if (segment->HasValue(normalized_value)) {
+        for (size_t l = 0; l < segment->candidates_size(); ++l) {
+          if (segment->candidate(l).value == normalized_value) {
+            normalized_cand = &segment->candidate(l);
+            break;
+          }
         }
       }
 
@@ -545,24 +549,21 @@ do { \
   } \
 } while (0)
 
-#define FETCH_FEATURE(func, base_key, base_value, weight)        \
+#define ADD_FEATURE_QUERY(func, base_key, base_value, feature_weight)  \
 do { \
-  if (func(segments, segment_index, base_key, base_value, &feature_key)) { \
-    const FeatureValue *v = \
-      reinterpret_cast<const FeatureValue *> \
-       (storage_->Lookup(feature_key, &last_access_time_result)); \
-    if (v != NULL && v->IsValid()) { \
-       *score = max(*score, weight);                                     \
-       *last_access_time = max(*last_access_time, last_access_time_result); \
-    } \
+  if (func(segments, segment_index, base_key, base_value, feature_key)) { \
+    queries->push_back(FeatureQuery()); \
+    queries->back().fp = storage_->Fingerprint(*feature_key); \
+    queries->back().weight = feature_weight; \
   } \
 } while (0)
 
-bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
-                                          size_t segment_index,
-                                          int candidate_index,
-                                          uint32 *score,
-                                          uint32 *last_access_time) const {
+void UserSegmentHistoryRewriter::GetFeatureQueries(
+    const Segments &segments,
+    size_t segment_index,
+    int candidate_index,
+    string *feature_key,
+    std::vector<FeatureQuery> *queries) const {
   const size_t segments_size = segments.conversion_segments_size();
   const Segment::Candidate &top_candidate =
       segments.segment(segment_index).candidate(0);
@@ -580,15 +581,8 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
       (candidate.attributes & Segment::Candidate::CONTEXT_SENSITIVE) ||
       (segments.segment(segment_index).candidate(0).attributes &
        Segment::Candidate::CONTEXT_SENSITIVE);
-  DCHECK(score);
-  DCHECK(last_access_time);
-
-  *score = 0;
-  *last_access_time = 0;
-
-  // They are used inside FETCH_FEATURE
-  uint32 last_access_time_result = 0;
-  string feature_key;
+  DCHECK(feature_key);
+  DCHECK(queries);
 
   const uint32 trigram_score       = (segments_size == 3) ? 180 : 30;
   const uint32 bigram_score        = (segments_size == 2) ? 60  : 10;
@@ -596,43 +590,52 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
   const uint32 unigram_score       = (segments_size == 1) ? 36  : 6;
   const uint32 single_score        = (segments_size == 1) ? 90  : 15;
 
-  FETCH_FEATURE(GetFeatureLR, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureLL, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureRR, all_key, all_value, trigram_score);
-  FETCH_FEATURE(GetFeatureL,  all_key, all_value, bigram_score);
-  FETCH_FEATURE(GetFeatureR,  all_key, all_value, bigram_score);
-  FETCH_FEATURE(GetFeatureS,  all_key, all_value, single_score);
-  FETCH_FEATURE(GetFeatureLN, content_key, content_value, bigram_number_score);
-  FETCH_FEATURE(GetFeatureRN, content_key, content_value, bigram_number_score);
+  ADD_FEATURE_QUERY(GetFeatureLR, all_key, all_value, trigram_score);
+  ADD_FEATURE_QUERY(GetFeatureLL, all_key, all_value, trigram_score);
+  ADD_FEATURE_QUERY(GetFeatureRR, all_key, all_value, trigram_score);
+  ADD_FEATURE_QUERY(GetFeatureL,  all_key, all_value, bigram_score);
+  ADD_FEATURE_QUERY(GetFeatureR,  all_key, all_value, bigram_score);
+  ADD_FEATURE_QUERY(GetFeatureS,  all_key, all_value, single_score);
+  ADD_FEATURE_QUERY(GetFeatureLN, content_key, content_value,
+                    bigram_number_score);
+  ADD_FEATURE_QUERY(GetFeatureRN, content_key, content_value,
+                    bigram_number_score);
 
   const bool is_replaceable = Replaceable(top_candidate, candidate);
 
   if (!context_sensitive && is_replaceable) {
-    FETCH_FEATURE(GetFeatureC,  all_key, all_value, unigram_score);
+    ADD_FEATURE_QUERY(GetFeatureC,  all_key, all_value, unigram_score);
   }
 
   if (!is_replaceable) {
-    return (*score > 0);
+    return;
   }
 
-  FETCH_FEATURE(GetFeatureLR, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureLL, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureRR, content_key, content_value, trigram_score / 2);
-  FETCH_FEATURE(GetFeatureL,  content_key, content_value, bigram_score / 2);
-  FETCH_FEATURE(GetFeatureR,  content_key, content_value, bigram_score / 2);
-  FETCH_FEATURE(GetFeatureS,  content_key, content_value, single_score / 2);
-  FETCH_FEATURE(GetFeatureLN, content_key,
-                content_value, bigram_number_score / 2);
-  FETCH_FEATURE(GetFeatureRN, content_key,
-                content_value, bigram_number_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureLR, content_key, content_value,
+                    trigram_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureLL, content_key, content_value,
+                    trigram_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureRR, content_key, content_value,
+                    trigram_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureL,  content_key, content_value,
+                    bigram_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureR,  content_key, content_value,
+                    bigram_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureS,  content_key, content_value,
+                    single_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureLN, content_key, content_value,
+                    bigram_number_score / 2);
+  ADD_FEATURE_QUERY(GetFeatureRN, content_key, content_value,
+                    bigram_number_score / 2);
 
   if (!context_sensitive) {
-    FETCH_FEATURE(GetFeatureC,  content_key, content_value, unigram_score / 2);
+    ADD_FEATURE_QUERY(GetFeatureC,  content_key, content_value,
+                      unigram_score / 2);
   }
-
-  return (*score > 0);
 }
 
+#undef ADD_FEATURE_QUERY
+
 // Returns true if |lhs| candidate can be replaceable with |rhs|.
 bool UserSegmentHistoryRewriter::Replaceable(
     const Segment::Candidate &lhs, const Segment::Candidate &rhs) const {
@@ -824,6 +827,14 @@ void UserSegmentHistoryRewriter::Finish(const ConversionRequest &request,
                                       static_cast<int>(storage_->used_size()));
 }
 
+bool UserSegmentHistoryRewriter::Sync() {
+  if (storage_.get() == NULL) {
+    return true;
+  }
+  VLOG(1) << "Flushing " << storage_->dirty_pages() << " dirty pages";
+  return storage_->Flush();
+}
+
 bool UserSegmentHistoryRewriter::Reload() {
   const string filename = ConfigFileStream::GetFileName(kFileName);
   if (!storage_->OpenOrCreate(filename.c_str(),
@@ -967,6 +978,17 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
         Segment::Candidate::BEST_CANDIDATE;
   }
 
+  // Buffers reused for the segments.
+  string feature_key;
+  std::vector<FeatureQuery> queries;
+  std::vector<int> candidate_indices;
+  // queries[query_ends[k - 1]] to queries[query_ends[k] - 1] are the features
+  // of the candidate_indices[k]-th candidate.
+  std::vector<size_t> query_ends;
+  std::vector<uint64> fps;
+  std::vector<const char *> values;
+  std::vector<uint32> last_access_times;
+
   bool modified = false;
   for (size_t i = segments->history_segments_size();
        i < segments->segments_size(); ++i) {
@@ -995,8 +1017,11 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
     DVLOG_IF(2, (segment->candidates_size() < max_candidates_size))
         << "Cannot expand candidates. ignored. Rewrite may be failed";
 
-    // for each all candidates expanded
-    std::vector<ScoreType> scores;
+    // Collects the features of all the candidates expanded, and looks them up
+    // at once.
+    queries.clear();
+    candidate_indices.clear();
+    query_ends.clear();
     for (size_t l = 0;
          l < segment->candidates_size() + segment->meta_candidates_size();
          ++l) {
@@ -1005,14 +1030,39 @@ bool UserSegmentHistoryRewriter::Rewrite(const ConversionRequest &request,
         j -= static_cast<int>(segment->candidates_size() +
                               transliteration::NUM_T13N_TYPES);
       }
+      GetFeatureQueries(*segments, i, j, &feature_key, &queries);
+      candidate_indices.push_back(j);
+      query_ends.push_back(queries.size());
+    }
+    fps.resize(queries.size());
+    for (size_t k = 0; k < queries.size(); ++k) {
+      fps[k] = queries[k].fp;
+    }
+    values.resize(queries.size());
+    last_access_times.resize(queries.size());
+    storage_->LookupFingerprints(fps.data(), fps.size(), values.data(),
+                                 last_access_times.data());
 
+    std::vector<ScoreType> scores;
+    size_t query_begin = 0;
+    for (size_t k = 0; k < candidate_indices.size(); ++k) {
       uint32 score = 0;
       uint32 last_access_time = 0;
-      if (GetScore(*segments, i, j, &score, &last_access_time)) {
+      for (size_t q = query_begin; q < query_ends[k]; ++q) {
+        const FeatureValue *v =
+            reinterpret_cast<const FeatureValue *>(values[q]);
+        if (v != NULL && v->IsValid()) {
+          score = max(score, queries[q].weight);
+          last_access_time = max(last_access_time, last_access_times[q]);
+        }
+      }
+      query_begin = query_ends[k];
+      if (score > 0) {
         scores.push_back(ScoreType());
         scores.back().score = score;
         scores.back().last_access_time = last_access_time;
-        scores.back().candidate = segment->mutable_candidate(j);
+        scores.back().candidate = segment->mutable_candidate(
+            candidate_indices[k]);
       }
     }
 
@@ -1033,6 +1083,13 @@ void UserSegmentHistoryRewriter::Clear() {
   }
 }
 
+void UserSegmentHistoryRewriter::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  if (storage_.get() != NULL) {
+    usages->push_back(storage_->GetMemoryUsage("lru_storage:user_segment_history"));
+  }
+}
+
 bool UserSegmentHistoryRewriter::IsPunctuation(
     const Segment &seg,
     const Segment::Candidate &candidate) const {
@@ -61,18 +61,35 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
 
   virtual void Finish(const ConversionRequest &request, Segments *segments);
 
+  // Writes the learning modified since the last call back to the disk.
+  virtual bool Sync();
+
   virtual bool Reload();
 
   virtual void Clear();
 
+  // Reports the storage as "lru_storage:user_segment_history".
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const;
+
  private:
   bool IsAvailable(const ConversionRequest &request,
                    const Segments &segments) const;
-  bool GetScore(const Segments &segments,
-                size_t segment_index,
-                int candidate_index,
-                uint32 *score,
-                uint32 *last_access_time) const;
+  // A feature to look up in the storage with the score for a candidate
+  // having it.
+  struct FeatureQuery {
+    uint64 fp;
+    uint32 weight;
+  };
+
+  // Appends the features of the |candidate_index|-th candidate of the
+  // |segment_index|-th segment to |queries|.  |feature_key| is a buffer to
+  // build the feature keys in.
+  void GetFeatureQueries(const Segments &segments,
+                         size_t segment_index,
+                         int candidate_index,
+                         string *feature_key,
+                         std::vector<FeatureQuery> *queries) const;
   bool Replaceable(const Segment::Candidate &lhs,
                    const Segment::Candidate &rhs) const;
   void RememberFirstCandidate(const Segments &segments,
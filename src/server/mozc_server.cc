@@ -106,6 +106,11 @@ int MozcServer::Run() {
     return -1;
   }
 
+  // Constructs the heavyweight singletons before the first key event.  This
+  // is done after taking the mutex so that a duplicated server, which exits
+  // here, doesn't build them, e.g., by opening the storages in the profile.
+  mozc::SingletonInitializer::StartInBackground();
+
   {
     std::unique_ptr<mozc::SessionServer> session_server(
         new mozc::SessionServer);
@@ -136,6 +141,7 @@ int MozcServer::Run() {
 }
 
 int MozcServer::Finalize() {
+  mozc::SingletonInitializer::Wait();
   mozc::SingletonFinalizer::Finalize();
   return 0;
 }
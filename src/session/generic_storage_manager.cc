@@ -34,11 +34,13 @@
 #include <string>
 #include <vector>
 
+#include "base/clock.h"
 #include "base/config_file_stream.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "storage/ephemeral_mode.h"
 #include "storage/lru_storage.h"
 
 namespace {
@@ -72,6 +74,7 @@ const uint32 kEmojiSeed = 136843897;
 
 namespace mozc {
 
+using mozc::storage::EphemeralMode;
 using mozc::storage::LRUStorage;
 
 class GenericStorageManagerImpl
@@ -93,6 +96,7 @@ class GenericStorageManagerImpl
   virtual ~GenericStorageManagerImpl() {}
   virtual GenericStorageInterface *GetStorage(
      commands::GenericStorageEntry::StorageType storage_type);
+  virtual void ReleaseIdleStorages(uint64 idle_seconds);
  private:
   GenericLruStorage symbol_history_storage_;
   GenericLruStorage emoticon_history_storage_;
@@ -114,6 +118,12 @@ GenericStorageInterface *GenericStorageManagerImpl::GetStorage(
   return NULL;
 }
 
+void GenericStorageManagerImpl::ReleaseIdleStorages(uint64 idle_seconds) {
+  symbol_history_storage_.ReleaseIfIdle(idle_seconds);
+  emoticon_history_storage_.ReleaseIfIdle(idle_seconds);
+  emoji_history_storage_.ReleaseIfIdle(idle_seconds);
+}
+
 // static
 void GenericStorageManagerFactory::SetGenericStorageManager(
     GenericStorageManagerInterface *manager) {
@@ -128,11 +138,19 @@ GenericStorageInterface *GenericStorageManagerFactory::GetStorage(
   return manager->GetStorage(storage_type);
 }
 
+// static
+void GenericStorageManagerFactory::ReleaseIdleStorages(uint64 idle_seconds) {
+  GenericStorageManagerInterface *manager = g_storage_manager ?
+      g_storage_manager : Singleton<GenericStorageManagerImpl>::get();
+  manager->ReleaseIdleStorages(idle_seconds);
+}
+
 
 GenericLruStorage::GenericLruStorage(
     const char *file_name, size_t value_size, size_t size, uint32 seed)
     : file_name_(file_name), value_size_(value_size),
-      size_(size), seed_(seed), value_buffer_(new char[value_size + 1]) {
+      size_(size), seed_(seed), last_access_time_(0),
+      value_buffer_(new char[value_size + 1]) {
 }
 
 GenericLruStorage::~GenericLruStorage() {
@@ -140,6 +158,7 @@ GenericLruStorage::~GenericLruStorage() {
 
 bool GenericLruStorage::EnsureStorage() {
   scoped_lock lock(&g_storage_ensure_mutex);
+  last_access_time_ = Clock::GetTime();
   if (lru_storage_.get()) {
     // We already have prepared storage.
     return true;
@@ -191,4 +210,23 @@ bool GenericLruStorage::Clear() {
   return lru_storage_->Clear();
 }
 
+void GenericLruStorage::ReleaseIfIdle(uint64 idle_seconds) {
+  scoped_lock lock(&g_storage_ensure_mutex);
+  // In EphemeralMode, the data exist only in the opened storage.
+  if (!lru_storage_.get() || EphemeralMode::IsEnabled()) {
+    return;
+  }
+  if (idle_seconds > 0 &&
+      Clock::GetTime() < last_access_time_ + idle_seconds) {
+    return;
+  }
+  VLOG(1) << "Releasing " << file_name_;
+  lru_storage_.reset();
+}
+
+bool GenericLruStorage::IsOpened() const {
+  scoped_lock lock(&g_storage_ensure_mutex);
+  return lru_storage_.get() != NULL;
+}
+
 }  // namespace mozc
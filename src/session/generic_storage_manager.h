@@ -54,6 +54,10 @@ class GenericStorageManagerInterface {
   virtual ~GenericStorageManagerInterface() {}
   virtual GenericStorageInterface *GetStorage(
      commands::GenericStorageEntry::StorageType storage_type) = 0;
+  // Releases the storages which have not been used for |idle_seconds|, or
+  // all of them if |idle_seconds| is 0.  The released storages are opened
+  // again when they are used.
+  virtual void ReleaseIdleStorages(uint64 idle_seconds) {}
 };
 
 // Manages generic storages.
@@ -63,6 +67,10 @@ class GenericStorageManagerFactory {
   // If no instance is available, NULL is returned.
   static GenericStorageInterface *GetStorage(
      commands::GenericStorageEntry::StorageType storage_type);
+  // Releases the storages which have not been used for |idle_seconds|, or
+  // all of them if |idle_seconds| is 0.  The values returned by the storages
+  // are invalidated.
+  static void ReleaseIdleStorages(uint64 idle_seconds);
   // For unit test.
   static void SetGenericStorageManager(GenericStorageManagerInterface *manager);
 
@@ -113,6 +121,15 @@ class GenericLruStorage : public GenericStorageInterface {
 
   virtual bool Clear();
 
+  // Closes the storage to unmap its pages if it has not been used for
+  // |idle_seconds|, or unconditionally if |idle_seconds| is 0.  The storage
+  // is opened again on demand.  The values returned by Lookup() are
+  // invalidated.
+  void ReleaseIfIdle(uint64 idle_seconds);
+
+  // Returns true if the storage is opened.
+  bool IsOpened() const;
+
  protected:
   // Opens the storage if not opened yet.
   // If something goes wrong, returns false.
@@ -125,6 +142,8 @@ class GenericLruStorage : public GenericStorageInterface {
   const size_t value_size_;
   const size_t size_;
   const uint32 seed_;
+  // The time when the storage was used last time.
+  uint64 last_access_time_;
   // Temporary buffer to insert a value into this storage.
   std::unique_ptr<char[]> value_buffer_;
 
@@ -29,6 +29,8 @@
 
 #include "session/generic_storage_manager.h"
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/file_util.h"
 #include "base/util.h"
 #include "testing/base/public/gunit.h"
@@ -104,4 +106,35 @@ TEST(GenericLruStorageTest, BasicOperations) {
   EXPECT_TRUE(values.empty());
 }
 
+TEST(GenericLruStorageTest, ReleaseIfIdle) {
+  ClockMock clock(1000, 0);
+  Clock::SetClockForUnitTest(&clock);
+
+  GenericLruStorage storage(GetTemporaryFilePath().data(), 12, 10, 123);
+  EXPECT_FALSE(storage.IsOpened());
+  EXPECT_TRUE(storage.Clear());
+  EXPECT_TRUE(storage.Insert("key", "value"));
+  EXPECT_TRUE(storage.IsOpened());
+
+  clock.PutClockForward(59, 0);
+  storage.ReleaseIfIdle(60);
+  EXPECT_TRUE(storage.IsOpened());
+
+  clock.PutClockForward(1, 0);
+  storage.ReleaseIfIdle(60);
+  EXPECT_FALSE(storage.IsOpened());
+
+  // The storage is opened again with the data kept in the file.
+  const char *value = storage.Lookup("key");
+  EXPECT_TRUE(storage.IsOpened());
+  ASSERT_NE(nullptr, value);
+  EXPECT_STREQ("value", value);
+
+  // 0 releases the storage regardless of the last access.
+  storage.ReleaseIfIdle(0);
+  EXPECT_FALSE(storage.IsOpened());
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
 }  // namespace mozc
@@ -34,6 +34,7 @@
 #include <string>
 #include <vector>
 
+#include "base/init_mozc.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "config/config_handler.h"
@@ -47,9 +48,7 @@ namespace {
 class ImeSwitchUtilImpl {
  public:
   ImeSwitchUtilImpl() {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    ReloadConfig(config);
+    ReloadConfig(*config::ConfigHandler::GetSharedConfig());
   }
 
   bool IsDirectModeCommand(const commands::KeyEvent &key) const {
@@ -66,6 +65,9 @@ class ImeSwitchUtilImpl {
   DISALLOW_COPY_AND_ASSIGN(ImeSwitchUtilImpl);
 };
 
+const bool kImeSwitchUtilRegistered = SingletonInitializer::Register(
+    "ImeSwitchUtil", &InitSingleton<ImeSwitchUtilImpl>);
+
 }  // namespace
 
 bool ImeSwitchUtil::IsDirectModeCommand(const commands::KeyEvent &key) {
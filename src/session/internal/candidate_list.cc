@@ -32,13 +32,14 @@
 #include "session/internal/candidate_list.h"
 
 #include <algorithm>
-#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/freelist.h"
 #include "base/hash.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/port.h"
 
 namespace mozc {
@@ -110,6 +111,7 @@ void Candidate::set_subcandidate_list(CandidateList *subcandidate_list) {
 
 
 static const size_t kDefaultPageSize = 9;
+static const size_t kDefaultCandidateTableSize = 64;
 
 CandidateList::CandidateList(const bool rotate)
     : rotate_(rotate),
@@ -119,8 +121,11 @@ CandidateList::CandidateList(const bool rotate)
       candidate_pool_(new ObjectPool<Candidate>(kDefaultPageSize)),
       candidates_(new std::vector<Candidate *>),
       next_available_id_(0),
-      added_candidates_(new std::map<uint64, int>),
-      alternative_ids_(new std::map<int, int>) {
+      added_candidates_(new std::unordered_map<uint64, int>),
+      alternative_ids_(new std::unordered_map<int, int>) {
+  // Both tables are looked up for every added candidate, so they are sized
+  // for a typical candidate list up front.  Clear() keeps the buckets.
+  added_candidates_->reserve(kDefaultCandidateTableSize);
 }
 
 CandidateList::~CandidateList() {
@@ -141,6 +146,27 @@ void CandidateList::Clear() {
   alternative_ids_->clear();
 }
 
+size_t CandidateList::GetAllocatedBytes() const {
+  // Each node of the hash tables holds the pair and the pointer to the next
+  // node.
+  size_t bytes =
+      candidate_pool_->capacity() * sizeof(Candidate) +
+      MemoryStats::GetHeapBytes(*candidates_) +
+      MemoryStats::GetHeapBytes(name_) +
+      added_candidates_->bucket_count() * sizeof(void *) +
+      added_candidates_->size() *
+          (sizeof(std::pair<uint64, int>) + sizeof(void *)) +
+      alternative_ids_->bucket_count() * sizeof(void *) +
+      alternative_ids_->size() * (sizeof(std::pair<int, int>) + sizeof(void *));
+  for (const Candidate *candidate : *candidates_) {
+    if (candidate->IsSubcandidateList()) {
+      bytes += sizeof(CandidateList) +
+               candidate->subcandidate_list().GetAllocatedBytes();
+    }
+  }
+  return bytes;
+}
+
 const Candidate &CandidateList::GetDeepestFocusedCandidate() const {
   if (focused_candidate().IsSubcandidateList()) {
     return focused_candidate().subcandidate_list().GetDeepestFocusedCandidate();
@@ -165,7 +191,7 @@ void CandidateList::AddCandidateWithAttributes(const int id,
   // update the alternative_ids_.
   const uint64 fp = Hash::Fingerprint(value);
 
-  const std::pair<std::map<uint64, int>::iterator, bool> result =
+  const std::pair<std::unordered_map<uint64, int>::iterator, bool> result =
       added_candidates_->insert(std::make_pair(fp, id));
   if (!result.second) {  // insertion was failed.
     const int alt_id = result.first->second;
@@ -436,8 +462,10 @@ bool CandidateList::MoveToId(const int base_id) {
 
   // If an alternative id for the base_id found, use it to avoid
   // duplicated candidates.
-  if (alternative_ids_->find(id) != alternative_ids_->end()) {
-    id = (*alternative_ids_)[id];
+  const std::unordered_map<int, int>::const_iterator alt_it =
+      alternative_ids_->find(id);
+  if (alt_it != alternative_ids_->end()) {
+    id = alt_it->second;
   }
 
   // NOTE(komatsu): Although this function's order is O(N), The size
@@ -32,9 +32,9 @@
 #ifndef MOZC_SESSION_INTERNAL_CANDIDATE_LIST_H_
 #define MOZC_SESSION_INTERNAL_CANDIDATE_LIST_H_
 
-#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/port.h"
@@ -129,6 +129,10 @@ class CandidateList {
   bool focused() const;
   void set_focused(bool focused);
 
+  // Returns an estimate of the bytes allocated by this list and its
+  // subcandidate lists, including the pooled candidates.
+  size_t GetAllocatedBytes() const;
+
   // Operations
   void MoveFirst();
   void MoveLast();
@@ -162,13 +166,13 @@ class CandidateList {
 
   // Map marking added candidate values.  The keys are fingerprints of
   // the candidate values, the values of the map are candidate ids.
-  std::unique_ptr<std::map<uint64, int>> added_candidates_;
+  std::unique_ptr<std::unordered_map<uint64, int>> added_candidates_;
 
   // Id-to-id map.  The key and value ids have the same candidate
   // value.  (ex. {id:0, value:"kanji"} and {id:-5, value:"kanji"}).
   // The key ids are not directly stored in candidates, so accessing
   // these ids, they should be converted with this map.
-  std::unique_ptr<std::map<int, int>> alternative_ids_;
+  std::unique_ptr<std::unordered_map<int, int>> alternative_ids_;
 
   DISALLOW_COPY_AND_ASSIGN(CandidateList);
 };
@@ -449,6 +449,23 @@ TEST_F(CandidateListTest, AttributesWithSubList) {
             sub_list->focused_candidate().attributes());
 }
 
+TEST_F(CandidateListTest, DuplicatedCandidatesAfterClear) {
+  CandidateList main_list(true);
+  main_list.AddCandidate(0, "kanji");
+  main_list.AddCandidate(1, "kanji");
+  EXPECT_EQ(1, main_list.size());
+  EXPECT_TRUE(main_list.MoveToId(1));
+  EXPECT_EQ(0, main_list.focused_id());
+
+  // Clear() should forget both the added values and the alternative ids.
+  main_list.Clear();
+  main_list.AddCandidate(0, "hiragana");
+  main_list.AddCandidate(1, "kanji");
+  EXPECT_EQ(2, main_list.size());
+  EXPECT_TRUE(main_list.MoveToId(1));
+  EXPECT_EQ(1, main_list.focused_id());
+}
+
 TEST_F(CandidateListTest, GetDeepestFocusedCandidate) {
   EXPECT_TRUE(main_list_->MoveToPageIndex(2));
   EXPECT_EQ(0, main_list_->focused_candidate().id());
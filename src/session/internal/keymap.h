@@ -36,6 +36,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 #include "composer/key_event_util.h"
 #include "protocol/config.pb.h"
@@ -60,7 +61,9 @@ class KeyMap : public KeyMapInterface<typename T::Commands> {
   void Clear();
 
  private:
-  typedef std::map<KeyInformation, CommandsType> KeyToCommandMap;
+  // Probed for every key event, so the rules are kept in a hash table keyed
+  // by the packed key information rather than in an ordered map.
+  typedef std::unordered_map<KeyInformation, CommandsType> KeyToCommandMap;
   KeyToCommandMap keymap_;
 };
 
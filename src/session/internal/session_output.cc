@@ -32,6 +32,7 @@
 #include "session/internal/session_output.h"
 
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <string>
 #include <vector>
@@ -49,6 +50,14 @@ namespace mozc {
 namespace session {
 namespace {
 
+bool IsSameSegment(const commands::Preedit::Segment &lhs,
+                   const commands::Preedit::Segment &rhs) {
+  return lhs.annotation() == rhs.annotation() &&
+         lhs.value() == rhs.value() &&
+         lhs.value_length() == rhs.value_length() &&
+         lhs.key() == rhs.key();
+}
+
 bool FillAnnotation(const Segment::Candidate &candidate_value,
                     commands::Annotation *annotation) {
   bool is_modified = false;
@@ -72,17 +81,45 @@ bool FillAnnotation(const Segment::Candidate &candidate_value,
   return is_modified;
 }
 
+// Counts the candidate words in the flattened |candidate_list|, and sets
+// |focused_index| to the index of the focused word if any.
+void CountCandidateWords(const CandidateList &candidate_list,
+                         const int focused_id,
+                         size_t *size,
+                         int *focused_index) {
+  for (size_t i = 0; i < candidate_list.size(); ++i) {
+    const Candidate &candidate = candidate_list.candidate(i);
+    if (candidate.IsSubcandidateList()) {
+      CountCandidateWords(candidate.subcandidate_list(), focused_id, size,
+                          focused_index);
+      continue;
+    }
+    if (candidate.id() == focused_id && candidate_list.focused()) {
+      *focused_index = static_cast<int>(*size);
+    }
+    ++(*size);
+  }
+}
+
+// Fills the candidate words whose indices in the flattened |candidate_list|
+// are in [begin, end).  |index| is the index of the next word.
 void FillAllCandidateWordsInternal(
     const Segment &segment,
     const CandidateList &candidate_list,
     const int focused_id,
+    const size_t begin,
+    const size_t end,
+    size_t *index,
     commands::CandidateList *candidate_list_proto) {
-  for (size_t i = 0; i < candidate_list.size(); ++i) {
+  for (size_t i = 0; i < candidate_list.size() && *index < end; ++i) {
     const Candidate &candidate = candidate_list.candidate(i);
     if (candidate.IsSubcandidateList()) {
       FillAllCandidateWordsInternal(
-          segment, candidate.subcandidate_list(), focused_id,
-          candidate_list_proto);
+          segment, candidate.subcandidate_list(), focused_id, begin, end,
+          index, candidate_list_proto);
+      continue;
+    }
+    if ((*index)++ < begin) {
       continue;
     }
 
@@ -93,12 +130,13 @@ void FillAllCandidateWordsInternal(
     candidate_word_proto->set_id(id);
 
     // index
-    const int index = candidate_list_proto->candidates_size() - 1;
-    candidate_word_proto->set_index(index);
+    candidate_word_proto->set_index(*index - 1);
 
-    // check focused id
+    // check focused id.  The focused index is from the beginning of the
+    // filled words.
     if (id == focused_id && candidate_list.focused()) {
-      candidate_list_proto->set_focused_index(index);
+      candidate_list_proto->set_focused_index(
+          candidate_list_proto->candidates_size() - 1);
     }
 
     const Segment::Candidate &segment_candidate = segment.candidate(id);
@@ -145,6 +183,27 @@ void SessionOutput::FillCandidate(
   }
 }
 
+// static
+void SessionOutput::AnnotateCandidates(const ConversionRequest &request,
+                                       const CandidateList &candidate_list,
+                                       Segment *segment) {
+  size_t c_begin = 0;
+  size_t c_end = 0;
+  candidate_list.GetPageRange(candidate_list.focused_index(),
+                              &c_begin, &c_end);
+  for (size_t i = c_begin; i <= c_end; ++i) {
+    if (!candidate_list.candidate(i).IsSubcandidateList()) {
+      segment->AnnotateCandidate(request, candidate_list.candidate(i).id());
+    }
+  }
+
+  if (candidate_list.focused_candidate().IsSubcandidateList()) {
+    AnnotateCandidates(request,
+                       candidate_list.focused_candidate().subcandidate_list(),
+                       segment);
+  }
+}
+
 // static
 void SessionOutput::FillCandidates(const Segment &segment,
                                    const CandidateList &candidate_list,
@@ -189,8 +248,40 @@ void SessionOutput::FillAllCandidateWords(
     const commands::Category category,
     commands::CandidateList *candidate_list_proto) {
   candidate_list_proto->set_category(category);
+  size_t index = 0;
   FillAllCandidateWordsInternal(
       segment, candidate_list, candidate_list.focused_id(),
+      0, std::numeric_limits<size_t>::max(), &index, candidate_list_proto);
+}
+
+// static
+void SessionOutput::FillCandidateWordsPage(
+    const Segment &segment,
+    const CandidateList &candidate_list,
+    const commands::Category category,
+    const int page,
+    commands::CandidateList *candidate_list_proto) {
+  candidate_list_proto->set_category(category);
+  const int focused_id = candidate_list.focused_id();
+  size_t size = 0;
+  int focused_index = -1;
+  CountCandidateWords(candidate_list, focused_id, &size, &focused_index);
+  candidate_list_proto->set_size(size);
+  if (size == 0) {
+    return;
+  }
+
+  const size_t page_size = max<size_t>(1, candidate_list.page_size());
+  size_t page_index = 0;
+  if (page >= 0) {
+    page_index = min<size_t>(page, (size - 1) / page_size);
+  } else if (focused_index >= 0) {
+    page_index = focused_index / page_size;
+  }
+  const size_t begin = page_index * page_size;
+  size_t index = 0;
+  FillAllCandidateWordsInternal(
+      segment, candidate_list, focused_id, begin, begin + page_size, &index,
       candidate_list_proto);
 }
 
@@ -379,12 +470,15 @@ bool SessionOutput::AddSegment(const string &key,
                                const uint32 segment_type_mask,
                                commands::Preedit *preedit) {
   // Key is always normalized as a preedit text.
-  string normalized_key;
-  TextNormalizer::NormalizeText(key, &normalized_key);
+  string key_buffer;
+  const StringPiece normalized_key =
+      TextNormalizer::NormalizeTextIfNeeded(key, &key_buffer);
 
-  string normalized_value;
+  string value_buffer;
+  StringPiece normalized_value;
   if (segment_type_mask & PREEDIT) {
-    TextNormalizer::NormalizeText(value, &normalized_value);
+    normalized_value =
+        TextNormalizer::NormalizeTextIfNeeded(value, &value_buffer);
   } else if (segment_type_mask & CONVERSION) {
     normalized_value = value;
   } else {
@@ -397,8 +491,8 @@ bool SessionOutput::AddSegment(const string &key,
   }
 
   commands::Preedit::Segment *segment = preedit->add_segment();
-  segment->set_key(normalized_key);
-  segment->set_value(normalized_value);
+  segment->set_key(normalized_key.data(), normalized_key.size());
+  segment->set_value(normalized_value.data(), normalized_value.size());
   segment->set_value_length(Util::CharsLen(normalized_value));
   segment->set_annotation(commands::Preedit::Segment::UNDERLINE);
   if ((segment_type_mask & CONVERSION) && (segment_type_mask & FOCUSED)) {
@@ -479,5 +573,46 @@ void SessionOutput::FillPreeditResult(const string &preedit,
       normalized_preedit, normalized_preedit, result_proto);
 }
 
+// static
+void SessionOutput::EncodeDelta(const commands::Output &base,
+                                commands::Output *output) {
+  DCHECK(base.has_output_id());
+  int kept_segments = 0;
+  if (base.has_preedit() && output->has_preedit()) {
+    const commands::Preedit &base_preedit = base.preedit();
+    const commands::Preedit &preedit = output->preedit();
+    while (kept_segments < base_preedit.segment_size() &&
+           kept_segments < preedit.segment_size() &&
+           IsSameSegment(base_preedit.segment(kept_segments),
+                         preedit.segment(kept_segments))) {
+      ++kept_segments;
+    }
+  }
+
+  // ByteSize() is compared first to skip the serialization in most cases
+  // where the candidates are changed.
+  const bool candidates_unchanged =
+      base.has_candidates() && output->has_candidates() &&
+      base.candidates().ByteSize() == output->candidates().ByteSize() &&
+      base.candidates().SerializeAsString() ==
+          output->candidates().SerializeAsString();
+
+  if (kept_segments == 0 && !candidates_unchanged) {
+    return;
+  }
+
+  commands::Output::Delta *delta = output->mutable_delta();
+  delta->set_base_output_id(base.output_id());
+  if (kept_segments > 0) {
+    output->mutable_preedit()->mutable_segment()->DeleteSubrange(
+        0, kept_segments);
+    delta->set_preedit_kept_segments(kept_segments);
+  }
+  if (candidates_unchanged) {
+    output->clear_candidates();
+    delta->set_candidates_unchanged(true);
+  }
+}
+
 }  // namespace session
 }  // namespace mozc
@@ -39,6 +39,7 @@
 
 namespace mozc {
 
+class ConversionRequest;
 class Segment;
 class Segments;
 
@@ -58,6 +59,12 @@ class SessionOutput {
                             const Candidate &candidate,
                             commands::Candidates_Candidate *candidate_proto);
 
+  // Fill the deferred annotations of the candidates in the focused page of
+  // candidate_list.  This should be called before FillCandidates().
+  static void AnnotateCandidates(const ConversionRequest &request,
+                                 const CandidateList &candidate_list,
+                                 Segment *segment);
+
   // Fill the Candidates protobuf with the contents of candidate_list.
   static void FillCandidates(const Segment &segment,
                              const CandidateList &candidate_list,
@@ -73,6 +80,17 @@ class SessionOutput {
       const commands::Category category,
       commands::CandidateList *candidate_list_proto);
 
+  // Same as FillAllCandidateWords(), but fills only the page |page| of the
+  // flattened candidate words, whose size is the page size of
+  // candidate_list.  The page of the focused candidate is filled if |page|
+  // is negative, and the last page if |page| is beyond it.
+  static void FillCandidateWordsPage(
+      const Segment &segment,
+      const CandidateList &candidate_list,
+      const commands::Category category,
+      int page,
+      commands::CandidateList *candidate_list_proto);
+
   // Check if the usages should be rendered on the current CandidateList status.
   static bool ShouldShowUsages(const Segment &segment,
                                const CandidateList &cand_list);
@@ -135,6 +153,12 @@ class SessionOutput {
   static void FillPreeditResult(const string &preedit,
                                 commands::Result *result_proto);
 
+  // Omits the leading preedit segments and the candidates of output which
+  // are the same as the ones of base, and records them in output->delta().
+  // base is the last complete output sent to the client and must have
+  // output_id.  output->delta() is not set if nothing is omitted.
+  static void EncodeDelta(const commands::Output &base,
+                          commands::Output *output);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(SessionOutput);
@@ -30,12 +30,14 @@
 #include "session/internal/session_output.h"
 
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "base/text_normalizer.h"
 #include "base/util.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
+#include "request/conversion_request.h"
 #include "session/internal/candidate_list.h"
 #include "testing/base/public/gunit.h"
 
@@ -322,6 +324,65 @@ TEST(SessionOutputTest, FillAllCandidateWords) {
   EXPECT_TRUE(candidates_proto.candidates(6).has_annotation());
 }
 
+TEST(SessionOutputTest, FillCandidateWordsPage) {
+  //  ID|Idx| Candidate list tree
+  //   1| 0 | [1:[sub1_1,
+  //   2| 1 |     sub1_2],
+  //   0| 2 |  0,
+  //   3| 3 |  3,
+  //   4| 4 |  4]
+  Segment segment;
+  segment.set_key("key");
+  const char *kValues[5] = {"0", "sub1_1", "sub1_2", "3", "4"};
+  for (size_t i = 0; i < arraysize(kValues); ++i) {
+    Segment::Candidate *candidate = segment.push_back_candidate();
+    candidate->content_key = "key";
+    candidate->value = kValues[i];
+  }
+  CandidateList main_list(true);
+  CandidateList sub1(true);
+  main_list.set_page_size(2);
+  main_list.AddSubCandidateList(&sub1);
+  main_list.AddCandidate(0, kValues[0]);
+  main_list.AddCandidate(3, kValues[3]);
+  main_list.AddCandidate(4, kValues[4]);
+  sub1.AddCandidate(1, kValues[1]);
+  sub1.AddCandidate(2, kValues[2]);
+  main_list.set_focused(true);
+  main_list.MoveToId(3);
+
+  // The page of the focused candidate.
+  commands::CandidateList candidates_proto;
+  SessionOutput::FillCandidateWordsPage(
+      segment, main_list, commands::CONVERSION, -1, &candidates_proto);
+  EXPECT_EQ(5, candidates_proto.size());
+  ASSERT_EQ(2, candidates_proto.candidates_size());
+  EXPECT_EQ(0, candidates_proto.candidates(0).id());
+  EXPECT_EQ(2, candidates_proto.candidates(0).index());
+  EXPECT_EQ(3, candidates_proto.candidates(1).id());
+  EXPECT_EQ(3, candidates_proto.candidates(1).index());
+  EXPECT_EQ(1, candidates_proto.focused_index());
+
+  // A page without the focused candidate.
+  candidates_proto.Clear();
+  SessionOutput::FillCandidateWordsPage(
+      segment, main_list, commands::CONVERSION, 0, &candidates_proto);
+  ASSERT_EQ(2, candidates_proto.candidates_size());
+  EXPECT_EQ(1, candidates_proto.candidates(0).id());
+  EXPECT_EQ(2, candidates_proto.candidates(1).id());
+  EXPECT_EQ(1, candidates_proto.candidates(1).index());
+  EXPECT_FALSE(candidates_proto.has_focused_index());
+
+  // The page beyond the last one is the last page.
+  candidates_proto.Clear();
+  SessionOutput::FillCandidateWordsPage(
+      segment, main_list, commands::CONVERSION, 10, &candidates_proto);
+  ASSERT_EQ(1, candidates_proto.candidates_size());
+  EXPECT_EQ(4, candidates_proto.candidates(0).id());
+  EXPECT_EQ(4, candidates_proto.candidates(0).index());
+  EXPECT_EQ(commands::CONVERSION, candidates_proto.category());
+}
+
 TEST(SessionOutputTest, ShouldShowUsages) {
   {
     Segment segment;
@@ -555,6 +616,69 @@ TEST(SessionOutputTest, FillUsages) {
   ASSERT_FALSE(candidates_proto.has_usages());
 }
 
+// Records the IDs of the annotated candidates and sets their usage titles.
+class RecordingAnnotator : public CandidateAnnotatorInterface {
+ public:
+  virtual void Annotate(const ConversionRequest &request, int candidate_id,
+                        Segment::Candidate *candidate) const {
+    annotated_ids_.push_back(candidate_id);
+    candidate->usage_id = candidate_id;
+    candidate->usage_title = candidate->value;
+  }
+
+  const std::vector<int> &annotated_ids() const { return annotated_ids_; }
+
+ private:
+  mutable std::vector<int> annotated_ids_;
+};
+
+TEST(SessionOutputTest, AnnotateCandidates) {
+  Segment segment;
+  CandidateList candidate_list(true);
+  static const DummySegment dummy_segments[] = {
+    { "val00", 0, "", "" },
+    { "val01", 0, "", "" },
+    { "val02", 0, "", "" },
+    { "val03", 0, "", "" },
+    { "val04", 0, "", "" },
+    { "val05", 0, "", "" },
+    { "val06", 0, "", "" },
+    { "val07", 0, "", "" },
+    { "val08", 0, "", "" },
+    { "val09", 0, "", "" },
+    { "val10", 0, "", "" },
+  };
+  FillDummySegment(dummy_segments, arraysize(dummy_segments), &segment,
+                   &candidate_list);
+  RecordingAnnotator annotator;
+  for (size_t i = 0; i < segment.candidates_size(); ++i) {
+    segment.mutable_candidate(i)->annotator = &annotator;
+  }
+  const ConversionRequest request;
+
+  // pages of candidate_list: [00-08],[09-10]
+  candidate_list.set_focused(true);
+  candidate_list.MoveToId(2);
+  SessionOutput::AnnotateCandidates(request, candidate_list, &segment);
+  ASSERT_EQ(9, annotator.annotated_ids().size());
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(i, annotator.annotated_ids()[i]);
+    EXPECT_TRUE(segment.candidate(i).annotator == NULL);
+    EXPECT_EQ(dummy_segments[i].value, segment.candidate(i).usage_title);
+  }
+  EXPECT_EQ(&annotator, segment.candidate(9).annotator);
+  EXPECT_EQ("", segment.candidate(9).usage_title);
+
+  // The annotated candidates are not annotated again.
+  candidate_list.MoveToId(10);
+  SessionOutput::AnnotateCandidates(request, candidate_list, &segment);
+  ASSERT_EQ(11, annotator.annotated_ids().size());
+  EXPECT_EQ(9, annotator.annotated_ids()[9]);
+  EXPECT_EQ(10, annotator.annotated_ids()[10]);
+  candidate_list.MoveToId(0);
+  SessionOutput::AnnotateCandidates(request, candidate_list, &segment);
+  EXPECT_EQ(11, annotator.annotated_ids().size());
+}
 
 TEST(SessionOutputTest, FillShortcuts) {
   const string kDigits = "123456789";
@@ -840,5 +964,57 @@ TEST(SessionOutputTest, FillAllCandidateWords_NonForcused) {
   }
 }
 
+TEST(SessionOutputTest, EncodeDelta) {
+  commands::Output base;
+  base.set_output_id(1);
+  SessionOutput::AddSegment("a", "A", SessionOutput::CONVERSION,
+                            base.mutable_preedit());
+  SessionOutput::AddSegment(
+      "b", "B", SessionOutput::CONVERSION | SessionOutput::FOCUSED,
+      base.mutable_preedit());
+  base.mutable_preedit()->set_cursor(2);
+  commands::Candidates *candidates = base.mutable_candidates();
+  candidates->set_size(1);
+  candidates->set_position(0);
+  candidates->add_candidate()->set_value("B");
+  candidates->mutable_candidate(0)->set_index(0);
+
+  {
+    // Nothing is omitted from a different output.
+    commands::Output output;
+    SessionOutput::AddSegment("c", "C", SessionOutput::CONVERSION,
+                              output.mutable_preedit());
+    output.mutable_preedit()->set_cursor(1);
+    output.mutable_candidates()->CopyFrom(base.candidates());
+    output.mutable_candidates()->set_position(1);
+    const string expected = output.DebugString();
+    SessionOutput::EncodeDelta(base, &output);
+    EXPECT_FALSE(output.has_delta());
+    EXPECT_EQ(expected, output.DebugString());
+  }
+  {
+    // The same segments from the beginning and the same candidates are
+    // omitted.
+    commands::Output output;
+    SessionOutput::AddSegment("a", "A", SessionOutput::CONVERSION,
+                              output.mutable_preedit());
+    SessionOutput::AddSegment("b", "B", SessionOutput::CONVERSION,
+                              output.mutable_preedit());
+    output.mutable_preedit()->set_cursor(2);
+    output.mutable_candidates()->CopyFrom(base.candidates());
+    SessionOutput::EncodeDelta(base, &output);
+    ASSERT_TRUE(output.has_delta());
+    EXPECT_EQ(1, output.delta().base_output_id());
+    EXPECT_EQ(1, output.delta().preedit_kept_segments());
+    EXPECT_TRUE(output.delta().candidates_unchanged());
+    EXPECT_FALSE(output.has_candidates());
+    ASSERT_EQ(1, output.preedit().segment_size());
+    EXPECT_EQ("B", output.preedit().segment(0).value());
+    EXPECT_EQ(commands::Preedit::Segment::UNDERLINE,
+              output.preedit().segment(0).annotation());
+    EXPECT_EQ(2, output.preedit().cursor());
+  }
+}
+
 }  // namespace session
 }  // namespace mozc
@@ -33,12 +33,14 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/clock.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/singleton.h"
+#include "base/trace.h"
 #include "base/url.h"
 #include "base/util.h"
 #include "base/version.h"
@@ -205,10 +207,20 @@ ImeContext::State GetEffectiveStateForTestSendKey(
 
 // TODO(komatsu): Remove these argument by using/making singletons.
 Session::Session(EngineInterface *engine)
-    : engine_(engine), context_(new ImeContext) {
+    : engine_(engine), context_(new ImeContext), last_output_id_(0) {
   InitContext(context_.get());
 }
 
+// Clients such as TSF test each key before sending it, so the key command
+// looked up by TestSendKey() is kept for the SendKey() of the same key.
+struct Session::TestSendKeyCache {
+  string key;  // The serialized key event.
+  ImeContext::State state;
+  config::Config::SessionKeymap keymap;
+  bool is_suggestion;
+  int key_command;
+};
+
 Session::~Session() {}
 
 void Session::InitContext(ImeContext *context) const {
@@ -235,6 +247,8 @@ void Session::InitContext(ImeContext *context) const {
 #if defined(OS_LINUX) || defined(OS_ANDROID) || defined(OS_NACL)
   context->mutable_converter()->set_use_cascading_window(false);
 #endif  // OS_LINUX || OS_ANDROID || OS_NACL
+  context->mutable_converter()->set_page_only_candidate_words(
+      context->client_capability().page_only_candidate_words());
 }
 
 
@@ -258,6 +272,33 @@ void Session::ClearUndoContext() {
   prev_context_.reset();
 }
 
+void Session::CacheTestSendKeyCommand(const commands::KeyEvent &key,
+                                      bool is_suggestion, int key_command) {
+  if (!test_send_key_cache_) {
+    test_send_key_cache_.reset(new TestSendKeyCache);
+  }
+  key.SerializeToString(&test_send_key_cache_->key);
+  test_send_key_cache_->state =
+      GetEffectiveStateForTestSendKey(key, context_->state());
+  test_send_key_cache_->keymap = context_->keymap();
+  test_send_key_cache_->is_suggestion = is_suggestion;
+  test_send_key_cache_->key_command = key_command;
+}
+
+bool Session::LookupTestSendKeyCommand(const commands::KeyEvent &key,
+                                       bool is_suggestion,
+                                       int *key_command) const {
+  if (!test_send_key_cache_ ||
+      test_send_key_cache_->state != context_->state() ||
+      test_send_key_cache_->keymap != context_->keymap() ||
+      test_send_key_cache_->is_suggestion != is_suggestion ||
+      test_send_key_cache_->key != key.SerializeAsString()) {
+    return false;
+  }
+  *key_command = test_send_key_cache_->key_command;
+  return true;
+}
+
 void Session::EnsureIMEIsOn() {
   if (context_->state() == ImeContext::DIRECT) {
     SetSessionState(ImeContext::PRECOMPOSITION, context_.get());
@@ -265,6 +306,8 @@ void Session::EnsureIMEIsOn() {
 }
 
 bool Session::SendCommand(commands::Command *command) {
+  MOZC_TRACE_SPAN("Session::SendCommand");
+  test_send_key_cache_.reset();
   UpdateTime();
   UpdatePreferences(command);
   if (!command->input().has_command()) {
@@ -368,6 +411,9 @@ bool Session::SendCommand(commands::Command *command) {
     case commands::SessionCommand::TURN_OFF_IME:
       result = MakeSureIMEOff(command);
       break;
+    case commands::SessionCommand::GET_CANDIDATE_WORDS_PAGE:
+      result = GetCandidateWordsPage(command);
+      break;
     default:
       LOG(WARNING) << "Unknown command" << command->DebugString();
       result = DoNothing(command);
@@ -378,6 +424,7 @@ bool Session::SendCommand(commands::Command *command) {
 }
 
 bool Session::TestSendKey(commands::Command *command) {
+  test_send_key_cache_.reset();
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
@@ -401,8 +448,11 @@ bool Session::TestSendKey(commands::Command *command) {
   // Direct input
   if (state == ImeContext::DIRECT) {
     keymap::DirectInputState::Commands key_command;
-    if (!keymap->GetCommandDirect(key, &key_command) ||
-        key_command == keymap::DirectInputState::NONE) {
+    if (!keymap->GetCommandDirect(key, &key_command)) {
+      return EchoBack(command);
+    }
+    CacheTestSendKeyCommand(key, false, key_command);
+    if (key_command == keymap::DirectInputState::NONE) {
       return EchoBack(command);
     }
     return DoNothing(command);
@@ -416,6 +466,9 @@ bool Session::TestSendKey(commands::Command *command) {
     const bool result = is_suggestion
         ? keymap->GetCommandZeroQuerySuggestion(key, &key_command)
         : keymap->GetCommandPrecomposition(key, &key_command);
+    if (result) {
+      CacheTestSendKeyCommand(key, is_suggestion, key_command);
+    }
     if (!result || key_command == keymap::PrecompositionState::NONE) {
       // Clear undo context just in case. b/5529702.
       // Note that the undo context will not be cleared in
@@ -476,6 +529,7 @@ bool Session::TestSendKey(commands::Command *command) {
 }
 
 bool Session::SendKey(commands::Command *command) {
+  MOZC_TRACE_SPAN("Session::SendKey");
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
@@ -507,6 +561,7 @@ bool Session::SendKey(commands::Command *command) {
       result = false;
       break;
   }
+  test_send_key_cache_.reset();
 
   SessionUsageStatsUtil::AddSendKeyOutputStats(command->output());
 
@@ -517,7 +572,12 @@ bool Session::SendKeyDirectInputState(commands::Command *command) {
   keymap::DirectInputState::Commands key_command;
   const keymap::KeyMapManager *keymap =
       keymap::KeyMapFactory::GetKeyMapManager(context_->keymap());
-  if (!keymap->GetCommandDirect(command->input().key(), &key_command)) {
+  int cached_command = 0;
+  if (LookupTestSendKeyCommand(command->input().key(), false,
+                               &cached_command)) {
+    key_command =
+        static_cast<keymap::DirectInputState::Commands>(cached_command);
+  } else if (!keymap->GetCommandDirect(command->input().key(), &key_command)) {
     return EchoBackAndClearUndoContext(command);
   }
   string command_name;
@@ -549,11 +609,20 @@ bool Session::SendKeyPrecompositionState(commands::Command *command) {
   keymap::PrecompositionState::Commands key_command;
   const keymap::KeyMapManager *keymap =
       keymap::KeyMapFactory::GetKeyMapManager(context_->keymap());
-  const bool result =
-      context_->converter().CheckState(SessionConverterInterface::SUGGESTION) ?
-      keymap->GetCommandZeroQuerySuggestion(command->input().key(),
-                                            &key_command) :
-      keymap->GetCommandPrecomposition(command->input().key(), &key_command);
+  const bool is_suggestion =
+      context_->converter().CheckState(SessionConverterInterface::SUGGESTION);
+  int cached_command = 0;
+  bool result = true;
+  if (LookupTestSendKeyCommand(command->input().key(), is_suggestion,
+                               &cached_command)) {
+    key_command =
+        static_cast<keymap::PrecompositionState::Commands>(cached_command);
+  } else {
+    result = is_suggestion ?
+        keymap->GetCommandZeroQuerySuggestion(command->input().key(),
+                                              &key_command) :
+        keymap->GetCommandPrecomposition(command->input().key(), &key_command);
+  }
 
   if (!result) {
     return EchoBackAndClearUndoContext(command);
@@ -952,6 +1021,8 @@ void Session::UpdatePreferences(commands::Command *command) {
   if (command->input().has_capability()) {
     context_->mutable_client_capability()->CopyFrom(
         command->input().capability());
+    context_->mutable_converter()->set_page_only_candidate_words(
+        context_->client_capability().page_only_candidate_words());
   }
 
   // Update config values modified temporarily.
@@ -1129,7 +1200,7 @@ void Session::SetTable(const composer::Table *table) {
   context_->mutable_composer()->SetTable(table);
 }
 
-void Session::SetConfig(config::Config *config) {
+void Session::SetConfig(const config::Config *config) {
   context_->SetConfig(config);
 }
 
@@ -1380,6 +1451,8 @@ bool Session::MaybeSelectCandidate(commands::Command *command) {
 
 void Session::set_client_capability(const commands::Capability &capability) {
   context_->mutable_client_capability()->CopyFrom(capability);
+  context_->mutable_converter()->set_page_only_candidate_words(
+      capability.page_only_candidate_words());
 }
 
 void Session::set_application_info(const commands::ApplicationInfo
@@ -1399,6 +1472,62 @@ uint64 Session::last_command_time() const {
   return context_->last_command_time();
 }
 
+bool Session::PrecomputeConversion() {
+  if (context_->state() != ImeContext::COMPOSITION) {
+    return false;
+  }
+  return context_->mutable_converter()->PrecomputeConversion(
+      context_->composer());
+}
+
+void Session::ClearPrecomputedConversion() {
+  context_->mutable_converter()->ClearPrecomputedConversion();
+  // The undo context may have it if it is swapped during the command.
+  if (prev_context_.get() != nullptr) {
+    prev_context_->mutable_converter()->ClearPrecomputedConversion();
+  }
+}
+
+void Session::ReleaseUnusedMemory() {
+  context_->mutable_converter()->ReleaseUnusedMemory();
+  if (prev_context_.get() != nullptr) {
+    prev_context_->mutable_converter()->ReleaseUnusedMemory();
+  }
+}
+
+void Session::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  context_->converter().CollectMemoryUsage(usages);
+  if (prev_context_.get() != nullptr) {
+    prev_context_->converter().CollectMemoryUsage(usages);
+  }
+}
+
+void Session::EncodeOutputDelta(commands::Command *command) {
+  if (!context_->client_capability().delta_output()) {
+    return;
+  }
+
+  commands::Output *output = command->mutable_output();
+  std::unique_ptr<commands::Output> full_output(new commands::Output);
+  full_output->set_output_id(++last_output_id_);
+  if (output->has_preedit()) {
+    full_output->mutable_preedit()->CopyFrom(output->preedit());
+  }
+  if (output->has_candidates()) {
+    full_output->mutable_candidates()->CopyFrom(output->candidates());
+  }
+
+  output->set_output_id(last_output_id_);
+  // The delta is encoded only when the client has the same base.  Otherwise,
+  // e.g. the previous response is lost, the complete output is sent.
+  if (last_output_ != nullptr && command->input().has_base_output_id() &&
+      command->input().base_output_id() == last_output_->output_id()) {
+    SessionOutput::EncodeDelta(*last_output_, output);
+  }
+  last_output_ = std::move(full_output);
+}
+
 bool Session::InsertCharacter(commands::Command *command) {
   if (!command->input().has_key()) {
     LOG(ERROR) << "No key event: " << command->input().DebugString();
@@ -2564,6 +2693,17 @@ bool Session::ConvertNextPage(commands::Command *command) {
   return true;
 }
 
+bool Session::GetCandidateWordsPage(commands::Command *command) {
+  if (!context_->converter().IsActive()) {
+    return DoNothing(command);
+  }
+  command->mutable_output()->set_consumed(true);
+  context_->mutable_converter()->SetCandidateWordsPage(
+      command->input().command().candidate_words_page());
+  Output(command);
+  return true;
+}
+
 bool Session::ConvertPrev(commands::Command *command) {
   command->mutable_output()->set_consumed(true);
   context_->mutable_converter()->CandidatePrev();
@@ -91,12 +91,16 @@
       'type': 'static_library',
       'sources': [
         'session_handler.cc',
+        'session_latency_stats.cc',
+        'session_map.cc',
         'session_observer_handler.cc',
       ],
       'dependencies': [
+        '../base/base.gyp:base',
         '../composer/composer.gyp:composer',
         '../config/config.gyp:character_form_manager',
         '../config/config.gyp:config_handler',
+        '../data_manager/data_manager_base.gyp:data_manager',
         '../dictionary/dictionary_base.gyp:user_dictionary',
         '../engine/engine.gyp:engine_factory',
         '../protocol/protocol.gyp:commands_proto',
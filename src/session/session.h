@@ -49,6 +49,7 @@ class Capability;
 class Command;
 class Input;
 class KeyEvent;
+class Output;
 }  // namespace commands
 
 namespace composer {
@@ -156,6 +157,9 @@ class Session : public SessionInterface {
   bool ConvertNextPage(mozc::commands::Command *command);
   // Shows the previous page of candidates.
   bool ConvertPrevPage(mozc::commands::Command *command);
+  // Fills a page of the candidate words for the clients which get only a page
+  // of them.  See Capability.page_only_candidate_words.
+  bool GetCandidateWordsPage(mozc::commands::Command *command);
   bool ConvertCancel(mozc::commands::Command *command);
   bool PredictAndConvert(mozc::commands::Command *command);
   // Note: Commit() also triggers zero query suggestion.
@@ -237,7 +241,7 @@ class Session : public SessionInterface {
 
   bool ReportBug(mozc::commands::Command *command);
 
-  virtual void SetConfig(mozc::config::Config *config);
+  virtual void SetConfig(const mozc::config::Config *config);
 
   virtual void SetRequest(const mozc::commands::Request *request);
 
@@ -260,6 +264,14 @@ class Session : public SessionInterface {
   // return 0 (default value) if no command is executed in this session.
   virtual uint64 last_command_time() const;
 
+  virtual void EncodeOutputDelta(mozc::commands::Command *command);
+
+  virtual bool PrecomputeConversion();
+  virtual void ClearPrecomputedConversion();
+  virtual void ReleaseUnusedMemory();
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const;
+
   // TODO(komatsu): delete this funciton.
   // For unittest only
   mozc::composer::Composer *get_internal_composer_only_for_unittest();
@@ -280,12 +292,30 @@ class Session : public SessionInterface {
   std::unique_ptr<ImeContext> context_;
   std::unique_ptr<ImeContext> prev_context_;
 
+  // The preedit and the candidates of the last output sent to the client
+  // with output_id.  Used as the base of the delta encoded output.
+  std::unique_ptr<mozc::commands::Output> last_output_;
+  uint64 last_output_id_;
+
+  // The key command which TestSendKey() looked up, reused by the following
+  // SendKey() for the same key.
+  struct TestSendKeyCache;
+  std::unique_ptr<TestSendKeyCache> test_send_key_cache_;
+
   void InitContext(ImeContext *context) const;
 
   void PushUndoContext();
   void PopUndoContext();
   void ClearUndoContext();
 
+  // Stores |key_command| looked up by TestSendKey() for |key|.
+  void CacheTestSendKeyCommand(const mozc::commands::KeyEvent &key,
+                               bool is_suggestion, int key_command);
+  // Returns true and the key command stored by TestSendKey() if it was looked
+  // up for |key| in the current state.
+  bool LookupTestSendKeyCommand(const mozc::commands::KeyEvent &key,
+                                bool is_suggestion, int *key_command) const;
+
   // Return true if full width space is preferred in the given new input
   // state than half width space. When |input| does not have new input mode,
   // the current mode will be considered.
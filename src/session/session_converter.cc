@@ -33,12 +33,15 @@
 
 #include <algorithm>
 #include <limits>
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "base/flags.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/text_normalizer.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "config/config_handler.h"
@@ -119,6 +122,8 @@ SessionConverter::SessionConverter(const ConverterInterface *converter,
       candidate_list_(new CandidateList(true)),
       candidate_list_visible_(false),
       request_(request),
+      page_only_candidate_words_(false),
+      candidate_words_page_(-1),
       client_revision_(0) {
   conversion_preferences_.use_history = true;
   conversion_preferences_.max_history_size = kDefaultMaxHistorySize;
@@ -151,15 +156,32 @@ bool SessionConverter::ConvertWithPreferences(
     const ConversionPreferences &preferences) {
   DCHECK(CheckState(COMPOSITION | SUGGESTION | CONVERSION));
 
-  segments_->set_request_type(Segments::CONVERSION);
-  SetConversionPreferences(preferences, segments_.get());
-
-  const ConversionRequest conversion_request(&composer, request_, config_);
-  if (!converter_->StartConversionForRequest(conversion_request,
-                                             segments_.get())) {
-    LOG(WARNING) << "StartConversionForRequest() failed";
-    ResetState();
-    return false;
+  string key;
+  if (precomputed_segments_ != nullptr) {
+    composer.GetQueryForConversion(&key);
+  }
+  if (precomputed_segments_ != nullptr && key == precomputed_key_ &&
+      preferences.use_history == conversion_preferences_.use_history &&
+      preferences.max_history_size ==
+          conversion_preferences_.max_history_size) {
+    // The current segments are kept for the next precomputation.
+    if (segments_.use_count() == 1) {
+      spare_segments_ = std::move(segments_);
+    }
+    segments_ = std::move(precomputed_segments_);
+    precomputed_key_.clear();
+  } else {
+    ClearPrecomputedConversion();
+    mutable_segments()->set_request_type(Segments::CONVERSION);
+    SetConversionPreferences(preferences, mutable_segments());
+
+    const ConversionRequest conversion_request(&composer, request_, config_);
+    if (!converter_->StartConversionForRequest(conversion_request,
+                                               mutable_segments())) {
+      LOG(WARNING) << "StartConversionForRequest() failed";
+      ResetState();
+      return false;
+    }
   }
 
   segment_index_ = 0;
@@ -170,6 +192,91 @@ bool SessionConverter::ConvertWithPreferences(
   return true;
 }
 
+bool SessionConverter::PrecomputeConversion(
+    const composer::Composer &composer) {
+  if (!CheckState(COMPOSITION | SUGGESTION)) {
+    return false;
+  }
+  string key;
+  composer.GetQueryForConversion(&key);
+  if (key.empty() ||
+      (precomputed_segments_ != nullptr && key == precomputed_key_)) {
+    return false;
+  }
+
+  // The conversion runs on a copy to keep the current suggestion.  The copy
+  // reuses the stale precomputed segments or the ones left by the last
+  // conversion so that their segment and candidate pools are recycled.
+  std::shared_ptr<Segments> segments = std::move(precomputed_segments_);
+  precomputed_key_.clear();
+  if (segments == nullptr) {
+    segments = std::move(spare_segments_);
+  }
+  if (segments == nullptr) {
+    segments.reset(new Segments);
+  }
+  segments->CopyFrom(*segments_);
+  segments->set_request_type(Segments::CONVERSION);
+  SetConversionPreferences(conversion_preferences_, segments.get());
+  const ConversionRequest conversion_request(&composer, request_, config_);
+  if (!converter_->StartConversionForRequest(conversion_request,
+                                             segments.get())) {
+    if (spare_segments_ == nullptr) {
+      spare_segments_ = std::move(segments);
+    }
+    return false;
+  }
+  precomputed_segments_ = std::move(segments);
+  precomputed_key_ = key;
+  return true;
+}
+
+void SessionConverter::ClearPrecomputedConversion() {
+  if (spare_segments_ == nullptr) {
+    spare_segments_ = std::move(precomputed_segments_);
+  }
+  precomputed_segments_.reset();
+  precomputed_key_.clear();
+}
+
+void SessionConverter::ReleaseUnusedMemory() {
+  segments_->ShrinkPools();
+  if (precomputed_segments_.get() != nullptr) {
+    precomputed_segments_->ShrinkPools();
+  }
+  spare_segments_.reset();
+}
+
+void SessionConverter::CollectMemoryUsage(
+    std::vector<MemoryStats::Usage> *usages) const {
+  size_t segments_bytes =
+      segments_->GetAllocatedBytes() +
+      previous_suggestions_.GetAllocatedBytes();
+  size_t num_segments = segments_->segments_size();
+  LatticeNodeStats node_stats;
+  segments_->mutable_cached_lattice()->GetNodeStats(&node_stats);
+  if (precomputed_segments_.get() != nullptr) {
+    segments_bytes += precomputed_segments_->GetAllocatedBytes();
+    num_segments += precomputed_segments_->segments_size();
+    LatticeNodeStats precomputed_node_stats;
+    precomputed_segments_->mutable_cached_lattice()->GetNodeStats(
+        &precomputed_node_stats);
+    node_stats.node_count += precomputed_node_stats.node_count;
+    node_stats.reserved_bytes += precomputed_node_stats.reserved_bytes;
+  }
+  if (spare_segments_.get() != nullptr) {
+    segments_bytes += spare_segments_->GetAllocatedBytes();
+  }
+  usages->push_back(MemoryStats::HeapUsage("session:segments",
+                                           segments_bytes, num_segments));
+  usages->push_back(MemoryStats::HeapUsage("session:lattice_nodes",
+                                           node_stats.reserved_bytes,
+                                           node_stats.node_count));
+  usages->push_back(MemoryStats::HeapUsage(
+      "session:candidate_list", candidate_list_->GetAllocatedBytes(),
+      candidate_list_->size()));
+}
+
 bool SessionConverter::GetReadingText(const string &source_text,
                                       string *reading) {
   DCHECK(reading);
@@ -270,7 +377,7 @@ bool SessionConverter::ConvertToTransliteration(
     }
 
     DCHECK(CheckState(CONVERSION));
-    candidate_list_->MoveToAttributes(query_attr);
+    mutable_candidate_list()->MoveToAttributes(query_attr);
   } else {
     DCHECK(CheckState(CONVERSION));
     const Attributes current_attr =
@@ -282,7 +389,7 @@ bool SessionConverter::ConvertToTransliteration(
       query_attr |= (current_attr & (UPPER | LOWER | CAPITALIZED));
     }
 
-    candidate_list_->MoveNextAttributes(query_attr);
+    mutable_candidate_list()->MoveNextAttributes(query_attr);
   }
   candidate_list_visible_ = false;
   // Treat as top conversion candidate on usage stats.
@@ -343,7 +450,7 @@ bool SessionConverter::SwitchKanaType(const composer::Composer &composer) {
       string composition;
       GetPreedit(0, segments_->conversion_segments_size(), &composition);
       const ConversionRequest conversion_request(&composer, request_, config_);
-      converter_->ResizeSegment(segments_.get(),
+      converter_->ResizeSegment(mutable_segments(),
                                 conversion_request,
                                 0, Util::CharsLen(composition));
       UpdateCandidateList();
@@ -365,7 +472,7 @@ bool SessionConverter::SwitchKanaType(const composer::Composer &composer) {
   }
 
   DCHECK(CheckState(CONVERSION));
-  candidate_list_->MoveNextAttributes(attributes);
+  mutable_candidate_list()->MoveNextAttributes(attributes);
   candidate_list_visible_ = false;
   // Treat as top conversion candidate on usage stats.
   selected_candidate_indices_[segment_index_] = 0;
@@ -423,7 +530,7 @@ bool SessionConverter::SuggestWithPreferences(
   }
 
   // Initialize the segments for suggestion.
-  SetConversionPreferences(preferences, segments_.get());
+  SetConversionPreferences(preferences, mutable_segments());
 
   ConversionRequest conversion_request(&composer, request_, config_);
   const size_t cursor = composer.GetCursor();
@@ -434,13 +541,13 @@ bool SessionConverter::SuggestWithPreferences(
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         FLAGS_use_actual_converter_for_realtime_conversion);
     if (!converter_->StartSuggestionForRequest(conversion_request,
-                                               segments_.get())) {
+                                               mutable_segments())) {
       // TODO(komatsu): Because suggestion is a prefix search, once
       // StartSuggestion returns false, this GetSuggestion always
       // returns false.  Refactor it.
       VLOG(1) << "StartSuggestionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter_->CancelConversion(mutable_segments());
       return false;
     }
   } else {
@@ -452,10 +559,10 @@ bool SessionConverter::SuggestWithPreferences(
     // characters will be used in the below process, which conflicts
     // with *partial* prediction.
     if (!converter_->StartPartialSuggestionForRequest(conversion_request,
-                                                      segments_.get())) {
+                                                      mutable_segments())) {
       VLOG(1) << "StartPartialSuggestionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter_->CancelConversion(mutable_segments());
       return false;
     }
   }
@@ -493,8 +600,8 @@ bool SessionConverter::PredictWithPreferences(
   ResetResult();
 
   // Initialize the segments for prediction
-  segments_->set_request_type(Segments::PREDICTION);
-  SetConversionPreferences(preferences, segments_.get());
+  mutable_segments()->set_request_type(Segments::PREDICTION);
+  SetConversionPreferences(preferences, mutable_segments());
 
   const bool predict_first =
       !CheckState(PREDICTION) && IsEmptySegment(previous_suggestions_);
@@ -506,14 +613,14 @@ bool SessionConverter::PredictWithPreferences(
        candidate_list_->focused() &&
        candidate_list_->focused_index() == candidate_list_->last_index());
 
-  segments_->clear_conversion_segments();
+  mutable_segments()->clear_conversion_segments();
 
   if (predict_expand || predict_first) {
     ConversionRequest conversion_request(&composer, request_, config_);
     conversion_request.set_use_actual_converter_for_realtime_conversion(
         FLAGS_use_actual_converter_for_realtime_conversion);
     if (!converter_->StartPredictionForRequest(conversion_request,
-                                               segments_.get())) {
+                                               mutable_segments())) {
       LOG(WARNING) << "StartPredictionForRequest() failed";
 
       // TODO(komatsu): Perform refactoring after checking the stability test.
@@ -530,7 +637,7 @@ bool SessionConverter::PredictWithPreferences(
   // Merge suggestions and prediction
   string preedit;
   composer.GetQueryForPrediction(&preedit);
-  PrependCandidates(previous_suggestions_, preedit, segments_.get());
+  PrependCandidates(previous_suggestions_, preedit, mutable_segments());
 
   segment_index_ = 0;
   state_ = PREDICTION;
@@ -566,7 +673,7 @@ bool SessionConverter::ExpandSuggestionWithPreferences(
   //     after implemention of partial conversion.
 
   // Initialize the segments for prediction.
-  SetConversionPreferences(preferences, segments_.get());
+  SetConversionPreferences(preferences, mutable_segments());
 
   string preedit;
   composer.GetQueryForPrediction(&preedit);
@@ -588,25 +695,25 @@ bool SessionConverter::ExpandSuggestionWithPreferences(
     // TODO(matsuzakit or yamaguchi): Add ExpandSuggestion method
     //    to Converter class.
     if (!converter_->StartPredictionForRequest(conversion_request,
-                                               segments_.get())) {
+                                               mutable_segments())) {
       LOG(WARNING) << "StartPredictionForRequest() failed";
     }
   } else {
     // c.f. SuggestWithPreferences for ConversionRequest flags.
     if (!converter_->StartPartialPredictionForRequest(conversion_request,
-                                                      segments_.get())) {
+                                                      mutable_segments())) {
       VLOG(1) << "StartPartialPredictionForRequest() returns no suggestions.";
       // Clear segments and keep the context
-      converter_->CancelConversion(segments_.get());
+      converter_->CancelConversion(mutable_segments());
       return false;
     }
   }
   // Overwrite the request type to SUGGESTION.
   // Without this logic, a candidate gets focused that is unexpected behavior.
-  segments_->set_request_type(Segments::SUGGESTION);
+  mutable_segments()->set_request_type(Segments::SUGGESTION);
 
   // Merge suggestions and predictions.
-  PrependCandidates(previous_suggestions_, preedit, segments_.get());
+  PrependCandidates(previous_suggestions_, preedit, mutable_segments());
 
   segment_index_ = 0;
   // Call AppendCandidateList instead of UpdateCandidateList because
@@ -639,7 +746,8 @@ void SessionConverter::MaybeExpandPrediction(
   }
 
   DCHECK_LT(previous_index, candidate_list_->size());
-  candidate_list_->MoveToId(candidate_list_->candidate(previous_index).id());
+  const int previous_id = candidate_list_->candidate(previous_index).id();
+  mutable_candidate_list()->MoveToId(previous_id);
   UpdateSelectedCandidateIndex();
 }
 
@@ -648,7 +756,7 @@ void SessionConverter::Cancel() {
   ResetResult();
 
   // Clear segments and keep the context
-  converter_->CancelConversion(segments_.get());
+  converter_->CancelConversion(mutable_segments());
   ResetState();
 }
 
@@ -657,7 +765,7 @@ void SessionConverter::Reset() {
 
   // Even if composition mode, call ResetConversion
   // in order to clear history segments.
-  converter_->ResetConversion(segments_.get());
+  converter_->ResetConversion(mutable_segments());
 
   if (CheckState(COMPOSITION)) {
     return;
@@ -680,13 +788,13 @@ void SessionConverter::Commit(const composer::Composer &composer,
   }
 
   for (size_t i = 0; i < segments_->conversion_segments_size(); ++i) {
-    converter_->CommitSegmentValue(segments_.get(),
+    converter_->CommitSegmentValue(mutable_segments(),
                                    i,
                                    GetCandidateIndexForConverter(i));
   }
   CommitUsageStats(state_, context);
   ConversionRequest conversion_request(&composer, request_, config_);
-  converter_->FinishConversion(conversion_request, segments_.get());
+  converter_->FinishConversion(conversion_request, mutable_segments());
   ResetState();
 }
 
@@ -716,7 +824,7 @@ bool SessionConverter::CommitSuggestionInternal(
       *consumed_key_size < composer.GetLength()) {
     // A candidate was chosen from partial suggestion.
     converter_->CommitPartialSuggestionSegmentValue(
-        segments_.get(),
+        mutable_segments(),
         0,
         GetCandidateIndexForConverter(0),
         Util::SubString(preedit, 0, *consumed_key_size),
@@ -730,12 +838,12 @@ bool SessionConverter::CommitSuggestionInternal(
     DCHECK_GT(segments_->conversion_segments_size(), 0);
   } else {
     // Not partial suggestion so let's reset the state.
-    converter_->CommitSegmentValue(segments_.get(),
+    converter_->CommitSegmentValue(mutable_segments(),
                                    0,
                                    GetCandidateIndexForConverter(0));
     CommitUsageStats(SessionConverterInterface::SUGGESTION, context);
     ConversionRequest conversion_request(&composer, request_, config_);
-    converter_->FinishConversion(conversion_request, segments_.get());
+    converter_->FinishConversion(conversion_request, mutable_segments());
     DCHECK_EQ(0, segments_->conversion_segments_size());
     ResetState();
   }
@@ -752,7 +860,7 @@ bool SessionConverter::CommitSuggestionByIndex(
     LOG(ERROR) << "index is out of the range: " << index;
     return false;
   }
-  candidate_list_->MoveToPageIndex(index);
+  mutable_candidate_list()->MoveToPageIndex(index);
   UpdateSelectedCandidateIndex();
   return CommitSuggestionInternal(composer, context, consumed_key_size);
 }
@@ -763,7 +871,7 @@ bool SessionConverter::CommitSuggestionById(
     const commands::Context &context,
     size_t *consumed_key_size) {
   DCHECK(CheckState(SUGGESTION));
-  if (!candidate_list_->MoveToId(id)) {
+  if (!mutable_candidate_list()->MoveToId(id)) {
     // Don't use CandidateMoveToId() method, which overwrites candidates.
     // This is harmful for EXPAND_SUGGESTION session command.
     LOG(ERROR) << "No id found";
@@ -817,7 +925,7 @@ void SessionConverter::CommitSegmentsInternal(
   std::vector<size_t> candidate_ids;
   for (size_t i = 0; i < segments_to_commit; ++i) {
     // Get the i-th (0 origin) conversion segment and the selected candidate.
-    Segment *segment = segments_->mutable_conversion_segment(i);
+    Segment *segment = mutable_segments()->mutable_conversion_segment(i);
     if (segment == NULL) {
       LOG(ERROR) << "There is no segment on position " << i;
       return;
@@ -830,7 +938,7 @@ void SessionConverter::CommitSegmentsInternal(
     // Collect candidate's id for each segment.
     candidate_ids.push_back(GetCandidateIndexForConverter(i));
   }
-  converter_->CommitSegments(segments_.get(), candidate_ids);
+  converter_->CommitSegments(mutable_segments(), candidate_ids);
 
   // Commit the [0, segments_to_commit - 1] conversion segment.
   CommitUsageStatsWithSegmentsSize(state_, context, segments_to_commit);
@@ -852,11 +960,11 @@ void SessionConverter::CommitPreedit(const composer::Composer &composer,
   SessionOutput::FillPreeditResult(preedit, result_.get());
 
   ConverterUtil::InitSegmentsFromString(key, normalized_preedit,
-                                        segments_.get());
+                                        mutable_segments());
 
   CommitUsageStats(SessionConverterInterface::COMPOSITION, context);
   ConversionRequest conversion_request(&composer, request_, config_);
-  converter_->FinishConversion(conversion_request, segments_.get());
+  converter_->FinishConversion(conversion_request, mutable_segments());
   ResetState();
 }
 
@@ -871,13 +979,12 @@ void SessionConverter::CommitHead(
     *consumed_key_size = count;
   }
   preedit = Util::SubString(preedit, 0, *consumed_key_size);
-  string composition;
-  TextNormalizer::NormalizeText(preedit, &composition);
-  SessionOutput::FillPreeditResult(composition, result_.get());
+  TextNormalizer::NormalizeTextInPlace(&preedit);
+  SessionOutput::FillPreeditResult(preedit, result_.get());
 }
 
 void SessionConverter::Revert() {
-  converter_->RevertConversion(segments_.get());
+  converter_->RevertConversion(mutable_segments());
 }
 
 void SessionConverter::SegmentFocusInternal(size_t index) {
@@ -936,7 +1043,7 @@ void SessionConverter::ResizeSegmentWidth(const composer::Composer &composer,
   ResetResult();
 
   const ConversionRequest conversion_request(&composer, request_, config_);
-  if (!converter_->ResizeSegment(segments_.get(),
+  if (!converter_->ResizeSegment(mutable_segments(),
                                  conversion_request,
                                  segment_index_, delta)) {
     return;
@@ -974,7 +1081,7 @@ void SessionConverter::CandidateNext(const composer::Composer &composer) {
   ResetResult();
 
   MaybeExpandPrediction(composer);
-  candidate_list_->MoveNext();
+  mutable_candidate_list()->MoveNext();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -984,7 +1091,7 @@ void SessionConverter::CandidateNextPage() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
-  candidate_list_->MoveNextPage();
+  mutable_candidate_list()->MoveNextPage();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -994,7 +1101,7 @@ void SessionConverter::CandidatePrev() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
-  candidate_list_->MovePrev();
+  mutable_candidate_list()->MovePrev();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -1004,7 +1111,7 @@ void SessionConverter::CandidatePrevPage() {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
-  candidate_list_->MovePrevPage();
+  mutable_candidate_list()->MovePrevPage();
   candidate_list_visible_ = true;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -1024,7 +1131,7 @@ void SessionConverter::CandidateMoveToId(
   }
   DCHECK(CheckState(PREDICTION | CONVERSION));
 
-  candidate_list_->MoveToId(id);
+  mutable_candidate_list()->MoveToId(id);
   candidate_list_visible_ = false;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -1034,7 +1141,7 @@ void SessionConverter::CandidateMoveToPageIndex(const size_t index) {
   DCHECK(CheckState(PREDICTION | CONVERSION));
   ResetResult();
 
-  candidate_list_->MoveToPageIndex(index);
+  mutable_candidate_list()->MoveToPageIndex(index);
   candidate_list_visible_ = false;
   UpdateSelectedCandidateIndex();
   SegmentFocus();
@@ -1063,7 +1170,7 @@ bool SessionConverter::CandidateMoveToShortcut(const char shortcut) {
     return false;
   }
 
-  if (!candidate_list_->MoveToPageIndex(index)) {
+  if (!mutable_candidate_list()->MoveToPageIndex(index)) {
     VLOG(1) << "shortcut is out of the range.";
     return false;
   }
@@ -1079,8 +1186,10 @@ void SessionConverter::SetCandidateListVisible(bool visible) {
 
 void SessionConverter::PopOutput(
     const composer::Composer &composer, commands::Output *output) {
+  MOZC_TRACE_SPAN("SessionConverter::PopOutput");
   FillOutput(composer, output);
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
+  candidate_words_page_ = -1;
   ResetResult();
 }
 
@@ -1179,24 +1288,64 @@ SessionConverter* SessionConverter::Clone() const {
   // moment it's ok because the current design guarantees that the converter is
   // singleton. However, we should refactor such bad design; see also the
   // comment right above.
-  session_converter->segments_->CopyFrom(*segments_);
+  // The segments and the candidate list are shared until either converter
+  // modifies them, so that cloning for the undo context doesn't copy all the
+  // candidates.
+  session_converter->segments_ = segments_;
   session_converter->segment_index_ = segment_index_;
   session_converter->previous_suggestions_.CopyFrom(previous_suggestions_);
   session_converter->conversion_preferences_ = conversion_preferences();
   session_converter->result_->CopyFrom(*result_);
+  session_converter->candidate_list_ = candidate_list_;
+  session_converter->candidate_list_visible_ = candidate_list_visible_;
   session_converter->request_ = request_;
   session_converter->config_ = config_;
   session_converter->use_cascading_window_ = use_cascading_window_;
+  session_converter->page_only_candidate_words_ = page_only_candidate_words_;
   session_converter->selected_candidate_indices_ = selected_candidate_indices_;
 
-  if (session_converter->CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
-    // UpdateCandidateList() is not simple setter and it uses some members.
-    session_converter->UpdateCandidateList();
-    session_converter->candidate_list_->MoveToId(candidate_list_->focused_id());
-    session_converter->SetCandidateListVisible(candidate_list_visible_);
+  return session_converter;
+}
+
+Segments *SessionConverter::mutable_segments() {
+  MakeSharedStateUnique();
+  return segments_.get();
+}
+
+CandidateList *SessionConverter::mutable_candidate_list() {
+  MakeSharedStateUnique();
+  return candidate_list_.get();
+}
+
+void SessionConverter::MakeSharedStateUnique() {
+  // The candidate list is rebuilt from the segments, so both of them are
+  // copied at once while they still match each other.
+  if (segments_.use_count() > 1) {
+    std::shared_ptr<Segments> segments(new Segments);
+    segments->CopyFrom(*segments_);
+    segments_ = segments;
   }
+  if (candidate_list_.use_count() > 1) {
+    const int focused_id = candidate_list_->focused_id();
+    const bool visible = candidate_list_visible_;
+    ResetCandidateList();
+    if (CheckState(SUGGESTION | PREDICTION | CONVERSION)) {
+      // AppendCandidateList() is not simple setter and it uses some members.
+      AppendCandidateList();
+      candidate_list_->MoveToId(focused_id);
+    }
+    candidate_list_visible_ = visible;
+  }
+}
 
-  return session_converter;
+void SessionConverter::ResetCandidateList() {
+  if (candidate_list_.use_count() > 1) {
+    // Leaves the shared list to the other converter instead of clearing it.
+    candidate_list_.reset(new CandidateList(true));
+    candidate_list_->set_page_size(request_->candidate_page_size());
+  } else {
+    candidate_list_->Clear();
+  }
 }
 
 void SessionConverter::ResetResult() {
@@ -1208,20 +1357,20 @@ void SessionConverter::ResetState() {
   segment_index_ = 0;
   previous_suggestions_.clear();
   candidate_list_visible_ = false;
-  candidate_list_->Clear();
+  ResetCandidateList();
   selected_candidate_indices_.clear();
 }
 
 void SessionConverter::SegmentFocus() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  converter_->FocusSegmentValue(segments_.get(),
+  converter_->FocusSegmentValue(mutable_segments(),
                                 segment_index_,
                                 GetCandidateIndexForConverter(segment_index_));
 }
 
 void SessionConverter::SegmentFix() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  converter_->CommitSegmentValue(segments_.get(),
+  converter_->CommitSegmentValue(mutable_segments(),
                                  segment_index_,
                                  GetCandidateIndexForConverter(segment_index_));
 }
@@ -1364,7 +1513,7 @@ void SessionConverter::AppendCandidateList() {
   for (size_t i = candidate_list_->next_available_id();
        i < segment.candidates_size();
        ++i) {
-    candidate_list_->AddCandidate(i, segment.candidate(i).value);
+    mutable_candidate_list()->AddCandidate(i, segment.candidate(i).value);
     // if candidate has spelling correction attribute,
     // always display the candidate to let user know the
     // miss spelled candidate.
@@ -1379,7 +1528,7 @@ void SessionConverter::AppendCandidateList() {
       segments_->request_type() != Segments::SUGGESTION &&
       segments_->request_type() != Segments::PARTIAL_SUGGESTION &&
       segments_->request_type() != Segments::PARTIAL_PREDICTION);
-  candidate_list_->set_focused(focused);
+  mutable_candidate_list()->set_focused(focused);
 
   if (segment.meta_candidates_size() == 0) {
     // For suggestion mode, it is natural that T13N is not initialized.
@@ -1399,7 +1548,8 @@ void SessionConverter::AppendCandidateList() {
   CandidateList *transliterations;
   if (use_cascading_window_) {
     const bool kNoRotate = false;
-    transliterations = candidate_list_->AllocateSubCandidateList(kNoRotate);
+    transliterations =
+        mutable_candidate_list()->AllocateSubCandidateList(kNoRotate);
     transliterations->set_focused(true);
 
     const char kT13nLabel[] =
@@ -1408,7 +1558,7 @@ void SessionConverter::AppendCandidateList() {
       "\xe6\x96\x87\xe5\xad\x97\xe7\xa8\xae";
     transliterations->set_name(kT13nLabel);
   } else {
-    transliterations = candidate_list_.get();
+    transliterations = mutable_candidate_list();
   }
 
   // Add transliterations.
@@ -1424,7 +1574,7 @@ void SessionConverter::AppendCandidateList() {
 
 void SessionConverter::UpdateCandidateList() {
   DCHECK(CheckState(SUGGESTION | PREDICTION | CONVERSION));
-  candidate_list_->Clear();
+  ResetCandidateList();
   AppendCandidateList();
 }
 
@@ -1489,9 +1639,14 @@ void SessionConverter::FillCandidates(commands::Candidates *candidates) const {
 #ifdef CHANNEL_DEV
   CHECK_LT(0, segments_->conversion_segments_size());
 #endif  // CHANNEL_DEV
-  const Segment &segment = segments_->conversion_segment(segment_index_);
+  // Only the candidates in the page are annotated, and the others are left
+  // until they are shown.
+  Segment *segment = segments_->mutable_conversion_segment(segment_index_);
+  const ConversionRequest conversion_request(NULL, request_, config_);
+  SessionOutput::AnnotateCandidates(conversion_request, *candidate_list_,
+                                    segment);
   SessionOutput::FillCandidates(
-      segment, *candidate_list_, position, candidates);
+      *segment, *candidate_list_, position, candidates);
 
   // Shortcut keys
   if (CheckState(PREDICTION | CONVERSION)) {
@@ -1577,13 +1732,25 @@ void SessionConverter::FillAllCandidateWords(
   }
 
   const Segment &segment = segments_->conversion_segment(segment_index_);
+  if (page_only_candidate_words_) {
+    SessionOutput::FillCandidateWordsPage(
+        segment, *candidate_list_, category, candidate_words_page_,
+        candidates);
+    return;
+  }
   SessionOutput::FillAllCandidateWords(
       segment, *candidate_list_, category, candidates);
 }
 
+void SessionConverter::SetCandidateWordsPage(size_t page) {
+  candidate_words_page_ = static_cast<int>(
+      min<size_t>(page, std::numeric_limits<int>::max()));
+}
+
 void SessionConverter::SetRequest(const commands::Request *request) {
   request_ = request;
-  candidate_list_->set_page_size(request->candidate_page_size());
+  mutable_candidate_list()->set_page_size(request->candidate_page_size());
+  ClearPrecomputedConversion();
 }
 
 void SessionConverter::SetConfig(const config::Config *config) {
@@ -1591,6 +1758,7 @@ void SessionConverter::SetConfig(const config::Config *config) {
   updated_command_ = Segment::Candidate::DEFAULT_COMMAND;
   selection_shortcut_ =  config->selection_shortcut();
   use_cascading_window_ = config->use_cascading_window();
+  ClearPrecomputedConversion();
 }
 
 void SessionConverter::OnStartComposition(const commands::Context &context) {
@@ -1602,7 +1770,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
   if (!context.has_preceding_text()) {
     // In this case, reset history segments when the revision is mismatched.
     if (revision_changed) {
-      converter_->ResetConversion(segments_.get());
+      converter_->ResetConversion(mutable_segments());
     }
     return;
   }
@@ -1611,7 +1779,7 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
   // If preceding text is empty, it is OK to reset the history segments by
   // calling ResetConversion.
   if (preceding_text.empty()) {
-    converter_->ResetConversion(segments_.get());
+    converter_->ResetConversion(mutable_segments());
     return;
   }
 
@@ -1649,7 +1817,15 @@ void SessionConverter::OnStartComposition(const commands::Context &context) {
 
   // Here we reconstruct history segments from |preceding_text| regardless
   // of revision mismatch. If it fails the history segments is cleared anyway.
-  converter_->ReconstructHistory(segments_.get(), preceding_text);
+  if (preceding_text == preceding_text_without_history_) {
+    // The same text has already failed to give history segments, so only
+    // clear them instead of parsing the text again.
+    converter_->ResetConversion(mutable_segments());
+    return;
+  }
+  if (!converter_->ReconstructHistory(mutable_segments(), preceding_text)) {
+    preceding_text_without_history_ = preceding_text;
+  }
 }
 
 void SessionConverter::UpdateSelectedCandidateIndex() {
@@ -87,6 +87,15 @@ class SessionConverter : public SessionConverterInterface {
   virtual bool ConvertWithPreferences(const composer::Composer &composer,
                                       const ConversionPreferences &preferences);
 
+  // Converts the composition in advance for the next Convert().
+  virtual bool PrecomputeConversion(const composer::Composer &composer);
+  virtual void ClearPrecomputedConversion();
+
+  // Shrinks the pools of the segments.
+  virtual void ReleaseUnusedMemory();
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const;
+
   // Gets reading text (e.g. from "猫" to "ねこ").
   virtual bool GetReadingText(const string &source_text, string *reading);
 
@@ -270,6 +279,12 @@ class SessionConverter : public SessionConverterInterface {
     use_cascading_window_ = use_cascading_window;
   }
 
+  virtual void set_page_only_candidate_words(bool page_only) {
+    page_only_candidate_words_ = page_only;
+  }
+
+  virtual void SetCandidateWordsPage(size_t page);
+
   // Meaning that all the composition characters are consumed.
   // c.f. CommitSuggestionInternal
   static const size_t kConsumedAllCharacters;
@@ -283,6 +298,16 @@ class SessionConverter : public SessionConverterInterface {
   // Resets the session state variables.
   void ResetState();
 
+  // Returns |segments_| or |candidate_list_| to be modified.  They are copied
+  // first if they are shared with a clone.
+  Segments *mutable_segments();
+  CandidateList *mutable_candidate_list();
+  void MakeSharedStateUnique();
+
+  // Clears the candidate list, or replaces it with an empty one if it is
+  // shared with a clone.
+  void ResetCandidateList();
+
   // Notifies the converter that the current segment is focused.
   void SegmentFocus();
 
@@ -365,7 +390,8 @@ class SessionConverter : public SessionConverterInterface {
   SessionConverterInterface::State state_;
 
   const ConverterInterface *converter_;
-  std::unique_ptr<Segments> segments_;
+  // Shared with the clones until either side modifies it.
+  std::shared_ptr<Segments> segments_;
   size_t segment_index_;
 
   // Previous suggestions to be merged with the current predictions.
@@ -374,9 +400,17 @@ class SessionConverter : public SessionConverterInterface {
   // Default conversion preferences.
   ConversionPreferences conversion_preferences_;
 
+  // Result of PrecomputeConversion() and its conversion key.
+  std::shared_ptr<Segments> precomputed_segments_;
+  string precomputed_key_;
+
+  // Segments no longer used, kept to be reused by the next precomputation.
+  std::shared_ptr<Segments> spare_segments_;
+
   std::unique_ptr<commands::Result> result_;
 
-  std::unique_ptr<CandidateList> candidate_list_;
+  // Shared with the clones as |segments_| is.
+  std::shared_ptr<CandidateList> candidate_list_;
   bool candidate_list_visible_;
 
   const commands::Request *request_;
@@ -387,6 +421,11 @@ class SessionConverter : public SessionConverterInterface {
   bool use_cascading_window_;
   config::Config::SelectionShortcut selection_shortcut_;
 
+  // See set_page_only_candidate_words() and SetCandidateWordsPage().  The
+  // page is -1 for the page of the focused candidate.
+  bool page_only_candidate_words_;
+  int candidate_words_page_;
+
   // Indicates whether config_ will be updated by the command candidate.
   Segment::Candidate::Command updated_command_;
 
@@ -398,6 +437,10 @@ class SessionConverter : public SessionConverterInterface {
   // OnStartComposition for details.
   int32 client_revision_;
 
+  // The last preceding text from which ReconstructHistory() failed to make
+  // history segments.
+  string preceding_text_without_history_;
+
   DISALLOW_COPY_AND_ASSIGN(SessionConverter);
 };
 
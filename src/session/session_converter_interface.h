@@ -33,7 +33,9 @@
 #define MOZC_SESSION_SESSION_CONVERTER_INTERFACE_H_
 
 #include <string>
+#include <vector>
 
+#include "base/memory_stats.h"
 #include "base/port.h"
 #include "converter/segments.h"
 #include "protocol/config.pb.h"
@@ -110,6 +112,25 @@ class SessionConverterInterface {
       const composer::Composer &composer,
       const ConversionPreferences &preferences) = 0;
 
+  // Converts the composition in advance, e.g. while the server is idle.  The
+  // next Convert() returns the result without the converter if the
+  // composition is unchanged.  Returns true if the conversion is prepared.
+  virtual bool PrecomputeConversion(const composer::Composer &composer) = 0;
+
+  // Discards the result of PrecomputeConversion().
+  virtual void ClearPrecomputedConversion() = 0;
+
+  // Releases the pooled memory which has not been used recently.  Called
+  // periodically while the server is idle.
+  virtual void ReleaseUnusedMemory() = 0;
+
+  // Reports the segments as "session:segments", the nodes of the lattice as
+  // "session:lattice_nodes" and the candidate list as
+  // "session:candidate_list".  The counts are the numbers of the segments,
+  // the nodes and the candidates in use.
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const = 0;
+
   // Get reading text (e.g. from "猫" to "ねこ").
   virtual bool GetReadingText(const string &str, string *reading) = 0;
 
@@ -257,6 +278,15 @@ class SessionConverterInterface {
 
   virtual void set_use_cascading_window(bool use_cascading_window) = 0;
 
+  // If true, only a page of Output.all_candidate_words is filled.  See
+  // Capability.page_only_candidate_words.
+  virtual void set_page_only_candidate_words(bool page_only) = 0;
+
+  // Selects the page of Output.all_candidate_words filled by the next
+  // PopOutput() in the page only mode.  Otherwise the page of the focused
+  // candidate is filled.
+  virtual void SetCandidateWordsPage(size_t page) = 0;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(SessionConverterInterface);
 };
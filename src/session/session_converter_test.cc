@@ -121,7 +121,17 @@ class SessionConverterTest : public ::testing::Test {
 
   static void SetSegments(const Segments &src, SessionConverter *converter) {
     CHECK(converter);
-    converter->segments_->CopyFrom(src);
+    converter->mutable_segments()->CopyFrom(src);
+  }
+
+  static const Segments *GetSegmentsPointer(
+      const SessionConverter &converter) {
+    return converter.segments_.get();
+  }
+
+  static const Segments *GetPrecomputedSegmentsPointer(
+      const SessionConverter &converter) {
+    return converter.precomputed_segments_.get();
   }
 
   static const commands::Result &GetResult(const SessionConverter &converter) {
@@ -466,6 +476,86 @@ TEST_F(SessionConverterTest, Convert) {
   EXPECT_COUNT_STATS("ConversionCandidates0", 1);
 }
 
+TEST_F(SessionConverterTest, PrecomputeConversion) {
+  // "アイウエオ"
+  const char kKatakanaAiueo[] =
+      "\xe3\x82\xa2\xe3\x82\xa4\xe3\x82\xa6\xe3\x82\xa8\xe3\x82\xaa";
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  Segments segments;
+  SetAiueo(&segments);
+  FillT13Ns(&segments, composer_.get());
+  Segments katakana_segments;
+  katakana_segments.CopyFrom(segments);
+  katakana_segments.mutable_conversion_segment(0)->move_candidate(1, 0);
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  // Nothing to convert.
+  EXPECT_FALSE(converter.PrecomputeConversion(*composer_));
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  EXPECT_TRUE(converter.PrecomputeConversion(*composer_));
+  // The composition is unchanged.
+  EXPECT_FALSE(converter.PrecomputeConversion(*composer_));
+  EXPECT_FALSE(converter.IsActive());
+
+  // Convert() returns the precomputed result instead of the converter.
+  convertermock_->SetStartConversionForRequest(&katakana_segments, true);
+  EXPECT_TRUE(converter.Convert(*composer_));
+  commands::Output output;
+  converter.FillOutput(*composer_, &output);
+  ASSERT_EQ(1, output.preedit().segment_size());
+  EXPECT_EQ(kChars_Aiueo, output.preedit().segment(0).value());
+
+  // The precomputed result is used only once.
+  converter.Cancel();
+  EXPECT_TRUE(converter.Convert(*composer_));
+  output.Clear();
+  converter.FillOutput(*composer_, &output);
+  ASSERT_EQ(1, output.preedit().segment_size());
+  EXPECT_EQ(kKatakanaAiueo, output.preedit().segment(0).value());
+
+  // The precomputed result of a different composition is not used.
+  converter.Cancel();
+  convertermock_->SetStartConversionForRequest(&segments, true);
+  EXPECT_TRUE(converter.PrecomputeConversion(*composer_));
+  composer_->InsertCharacterPreedit("a");
+  convertermock_->SetStartConversionForRequest(&katakana_segments, true);
+  EXPECT_TRUE(converter.Convert(*composer_));
+  output.Clear();
+  converter.FillOutput(*composer_, &output);
+  ASSERT_EQ(1, output.preedit().segment_size());
+  EXPECT_EQ(kKatakanaAiueo, output.preedit().segment(0).value());
+}
+
+TEST_F(SessionConverterTest, PrecomputeConversionReusesSegments) {
+  SessionConverter converter(
+      convertermock_.get(), request_.get(), config_.get());
+  Segments segments;
+  SetAiueo(&segments);
+  FillT13Ns(&segments, composer_.get());
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  composer_->InsertCharacterPreedit(kChars_Aiueo);
+  const Segments *initial_segments = GetSegmentsPointer(converter);
+  EXPECT_TRUE(converter.PrecomputeConversion(*composer_));
+  const Segments *precomputed_segments =
+      GetPrecomputedSegmentsPointer(converter);
+  EXPECT_TRUE(converter.Convert(*composer_));
+  EXPECT_EQ(precomputed_segments, GetSegmentsPointer(converter));
+
+  // The next precomputation runs on the segments left by the conversion.
+  converter.Cancel();
+  composer_->InsertCharacterPreedit("a");
+  EXPECT_TRUE(converter.PrecomputeConversion(*composer_));
+  EXPECT_EQ(initial_segments, GetPrecomputedSegmentsPointer(converter));
+
+  // A stale precomputation is overwritten in place.
+  composer_->InsertCharacterPreedit("i");
+  EXPECT_TRUE(converter.PrecomputeConversion(*composer_));
+  EXPECT_EQ(initial_segments, GetPrecomputedSegmentsPointer(converter));
+}
+
 TEST_F(SessionConverterTest, ConvertWithSpellingCorrection) {
   SessionConverter converter(
       convertermock_.get(), request_.get(), config_.get());
@@ -2884,6 +2974,41 @@ TEST_F(SessionConverterTest, Clone) {
   }
 }
 
+TEST_F(SessionConverterTest, CloneSharesStateUntilModified) {
+  SessionConverter src(
+      convertermock_.get(), request_.get(), config_.get());
+  Segments segments;
+  SetKamaboko(&segments);
+  convertermock_->SetStartConversionForRequest(&segments, true);
+  EXPECT_TRUE(src.Convert(*composer_));
+
+  std::unique_ptr<SessionConverter> dest(src.Clone());
+  ASSERT_TRUE(dest.get() != NULL);
+  EXPECT_EQ(&GetCandidateList(src), &GetCandidateList(*dest));
+  ExpectSameSessionConverter(src, *dest);
+
+  // Moving the focus of the clone doesn't affect the source.
+  dest->CandidateNext(*composer_);
+  EXPECT_NE(&GetCandidateList(src), &GetCandidateList(*dest));
+  EXPECT_EQ(0, GetCandidateList(src).focused_index());
+  EXPECT_EQ(1, GetCandidateList(*dest).focused_index());
+  EXPECT_EQ(GetCandidateList(src).size(), GetCandidateList(*dest).size());
+
+  src.CandidateNext(*composer_);
+  ExpectSameSessionConverter(src, *dest);
+
+  // Committing the source leaves the clone as it was.
+  dest.reset(src.Clone());
+  src.Commit(*composer_, Context::default_instance());
+  EXPECT_FALSE(src.IsActive());
+  EXPECT_TRUE(dest->IsActive());
+  EXPECT_EQ(1, GetCandidateList(*dest).focused_index());
+  Segments dest_segments;
+  GetSegments(*dest, &dest_segments);
+  EXPECT_EQ(segments.conversion_segments_size(),
+            dest_segments.conversion_segments_size());
+}
+
 // Suggest() in the suggestion state was not accepted.  (http://b/1948334)
 TEST_F(SessionConverterTest, Issue1948334) {
   SessionConverter converter(
@@ -3356,8 +3481,7 @@ class ConverterMockForReconstructHistory : public ConverterMock {
                                   const string &preceding_text) const {
     reconstruct_history_called_ = true;
     preceding_text_ = preceding_text;
-    ConverterMock::ReconstructHistory(segments, preceding_text);
-    return true;
+    return ConverterMock::ReconstructHistory(segments, preceding_text);
   }
 
   bool reconstruct_history_called() const {
@@ -3979,6 +4103,34 @@ TEST_F(SessionConverterTest, ReconstructHistoryByPrecedingText) {
   }
 }
 
+TEST_F(SessionConverterTest, DontReparsePrecedingTextWithoutHistory) {
+  ConverterMockForReconstructHistory convertermock;
+  Segments mock_result;
+  convertermock.SetReconstructHistory(&mock_result, false);
+
+  SessionConverter converter(&convertermock, request_.get(), config_.get());
+  Context context;
+  // "あ"
+  context.set_preceding_text("\xE3\x81\x82");
+  converter.OnStartComposition(context);
+  EXPECT_TRUE(convertermock.reconstruct_history_called());
+
+  // The same preceding text doesn't give history segments either.
+  convertermock.Reset();
+  convertermock.SetReconstructHistory(&mock_result, false);
+  converter.OnStartComposition(context);
+  EXPECT_FALSE(convertermock.reconstruct_history_called());
+  Segments segments;
+  GetSegments(converter, &segments);
+  EXPECT_EQ(0, segments.segments_size());
+
+  // A different preceding text is parsed.
+  context.set_preceding_text("1");
+  converter.OnStartComposition(context);
+  EXPECT_TRUE(convertermock.reconstruct_history_called());
+  EXPECT_EQ("1", convertermock.preceding_text());
+}
+
 // Test whether Request::candidate_page_size is correctly propagated to
 // CandidateList.page_size in SessionConverter.  The tests for the behavior
 // of CandidateList.page_size is in session/internal/candidate_list_test.cc
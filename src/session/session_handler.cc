@@ -33,23 +33,30 @@
 #include "session/session_handler.h"
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/clock.h"
 #include "base/flags.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/port.h"
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
 #include "base/process.h"
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
+#include "base/scheduler.h"
 #include "base/singleton.h"
 #include "base/stopwatch.h"
+#include "base/thread.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/table.h"
 #include "config/character_form_manager.h"
 #include "config/config_handler.h"
+#include "data_manager/data_manager.h"
 #include "dictionary/user_dictionary_session_handler.h"
 #include "engine/engine_interface.h"
 #include "engine/user_data_manager_interface.h"
@@ -58,6 +65,8 @@
 #include "protocol/user_dictionary_storage.pb.h"
 #include "session/generic_storage_manager.h"
 #include "session/session.h"
+#include "session/session_latency_stats.h"
+#include "session/session_map.h"
 #include "session/session_observer_handler.h"
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
 #include "session/session_watch_dog.h"
@@ -80,6 +89,9 @@ DEFINE_int32(max_session_size, 64,
              "if size of sessions reaches to \"max_session_size\", "
              "oldest session is removed");
 
+DEFINE_int32(session_map_shards, 8,
+             "number of the shards of the session map");
+
 DEFINE_int32(create_session_min_interval, 0,
              "minimum interval (sec) for create session");
 
@@ -95,12 +107,36 @@ DEFINE_int32(last_create_session_timeout, 300,
              "\"last_create_session_timeout\" sec "
              "after create session command");
 
+DEFINE_int32(generic_storage_idle_timeout, 600,
+             "release the generic storages if they are not accessed for "
+             "\"generic_storage_idle_timeout\" sec");
+
+DEFINE_int32(slow_command_threshold_msec, 100,
+             "log the commands which take longer than "
+             "\"slow_command_threshold_msec\" msec. 0 disables it");
+
+DEFINE_bool(trace, false,
+            "record the trace spans from the start of the server. "
+            "STOP_TRACE command returns them");
+
 DEFINE_bool(restricted, false,
             "Launch server with restricted setting");
 
 namespace mozc {
 
 namespace {
+// Returns the data manager of |engine|, or an empty one if the engine has no
+// data, e.g., EngineStub.  The preedit tables are then loaded from the files.
+const DataManagerInterface &GetDataManagerOrEmpty(
+    const EngineInterface &engine) {
+  const DataManagerInterface *data_manager = engine.GetDataManager();
+  if (data_manager != nullptr) {
+    return *data_manager;
+  }
+  static const DataManager *empty_data_manager = new DataManager();
+  return *empty_data_manager;
+}
+
 bool IsApplicationAlive(const session::SessionInterface *session) {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   const commands::ApplicationInfo &info = session->application_info();
@@ -129,6 +165,37 @@ bool IsApplicationAlive(const session::SessionInterface *session) {
   return true;
 }
 
+// Returns true if |output| of a key in SEND_KEYS has to be handled by the
+// client before the following keys are applied.
+bool ShouldStopBatchedKeys(const commands::Output &output) {
+  return !output.consumed() || output.has_result() ||
+         output.has_deletion_range() || output.has_callback() ||
+         output.has_url() ||
+         output.launch_tool_mode() != commands::Output::NO_TOOL;
+}
+
+// Returns true if |type| is a command sent while the user is typing.  The
+// scheduled jobs wait until such commands stop.
+bool IsUserInputCommand(commands::Input::CommandType type) {
+  return type == commands::Input::SEND_KEY ||
+         type == commands::Input::SEND_KEYS ||
+         type == commands::Input::SEND_COMMAND;
+}
+
+// Returns true if |input| is a key event of the deactivated IME which is
+// passed through to the application.  The keys with modifiers or special keys
+// are excluded since they may activate the IME.
+bool IsDirectInputKey(const commands::Input &input) {
+  if (input.type() != commands::Input::SEND_KEY &&
+      input.type() != commands::Input::TEST_SEND_KEY) {
+    return false;
+  }
+  const commands::KeyEvent &key = input.key();
+  return key.has_activated() && !key.activated() && key.has_key_code() &&
+         !key.has_special_key() && key.modifier_keys_size() == 0 &&
+         key.modifiers() == 0;
+}
+
 bool IsCarrierEmoji(const string &utf8_str) {
   if (Util::CharsLen(utf8_str) != 1) {
     return false;
@@ -143,10 +210,44 @@ bool IsCarrierEmoji(const string &utf8_str) {
 }
 }  // namespace
 
+class SessionHandler::EngineLoader : public Thread {
+ public:
+  explicit EngineLoader(
+      std::function<std::unique_ptr<EngineInterface>()> engine_factory)
+      : engine_factory_(std::move(engine_factory)) {}
+
+  ~EngineLoader() override = default;
+
+  void Run() override {
+    engine_ = engine_factory_();
+  }
+
+  // Must be called after Join().
+  std::unique_ptr<EngineInterface> ReleaseEngine() {
+    return std::move(engine_);
+  }
+
+ private:
+  std::function<std::unique_ptr<EngineInterface>()> engine_factory_;
+  std::unique_ptr<EngineInterface> engine_;
+
+  DISALLOW_COPY_AND_ASSIGN(EngineLoader);
+};
+
 SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine) {
   Init(std::move(engine), std::unique_ptr<EngineBuilderInterface>());
 }
 
+SessionHandler::SessionHandler(
+    std::function<std::unique_ptr<EngineInterface>()> engine_factory) {
+  Init(std::unique_ptr<EngineInterface>(),
+       std::unique_ptr<EngineBuilderInterface>());
+  engine_loader_.reset(new EngineLoader(std::move(engine_factory)));
+  engine_loader_->SetJoinable(true);
+  engine_loader_->Start("EngineLoader");
+  is_available_ = true;
+}
+
 SessionHandler::SessionHandler(
     std::unique_ptr<EngineInterface> engine,
     std::unique_ptr<EngineBuilderInterface> engine_builder) {
@@ -156,20 +257,24 @@ SessionHandler::SessionHandler(
 void SessionHandler::Init(
     std::unique_ptr<EngineInterface> engine,
     std::unique_ptr<EngineBuilderInterface> engine_builder) {
+  if (FLAGS_trace) {
+    Trace::SetEnabled(true);
+  }
   is_available_ = false;
   max_session_size_ = 0;
   last_session_empty_time_ = Clock::GetTime();
   last_cleanup_time_ = 0;
   last_create_session_time_ = 0;
+  first_send_key_recorded_ = false;
   engine_ = std::move(engine);
   engine_builder_ = std::move(engine_builder);
   observer_handler_.reset(new session::SessionObserverHandler());
   stopwatch_.reset(new Stopwatch);
+  latency_stats_.reset(new session::SessionLatencyStats);
   user_dictionary_session_handler_.reset(
       new user_dictionary::UserDictionarySessionHandler);
   table_manager_.reset(new composer::TableManager);
   request_.reset(new commands::Request);
-  config_.reset(new config::Config);
 
   if (FLAGS_restricted) {
     VLOG(1) << "Server starts with restricted mode";
@@ -193,11 +298,12 @@ void SessionHandler::Init(
   // enabling session watch dog for android.
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 
-  config::ConfigHandler::GetConfig(config_.get());
+  config_ = config::ConfigHandler::GetSharedConfig();
 
   // allow [2..128] sessions
   max_session_size_ = max(2, min(FLAGS_max_session_size, 128));
-  session_map_.reset(new SessionMap(max_session_size_));
+  session_map_.reset(new session::SessionMap(
+      max_session_size_, max(1, min(FLAGS_session_map_shards, 64))));
 
   if (!engine_) {
     return;
@@ -208,11 +314,8 @@ void SessionHandler::Init(
 }
 
 SessionHandler::~SessionHandler() {
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != nullptr; element = element->next) {
-    delete element->value;
-    element->value = nullptr;
+  if (engine_loader_) {
+    engine_loader_->Join();
   }
   session_map_->Clear();
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
@@ -245,19 +348,26 @@ bool SessionHandler::StartWatchDog() {
 }
 
 void SessionHandler::SetConfig(const config::Config &config) {
-  *config_ = config;
-  const composer::Table *table = table_manager_->GetTable(
-      *request_, *config_, *engine_->GetDataManager());
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != NULL; element = element->next) {
-    if (element->value != NULL) {
-      element->value->SetConfig(config_.get());
-      element->value->SetRequest(request_.get());
-      element->value->SetTable(table);
-    }
+  SetConfig(std::make_shared<config::Config>(config));
+}
+
+void SessionHandler::SetConfig(std::shared_ptr<const config::Config> config) {
+  if (config == config_) {
+    return;
   }
-  config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(config);
+  // The sessions refer to the old config until they are updated below.
+  const std::shared_ptr<const config::Config> old_config = std::move(config_);
+  config_ = std::move(config);
+  const composer::Table *table = table_manager_->GetTable(
+      *request_, *config_, GetDataManagerOrEmpty(*engine_));
+  session_map_->ForEach(
+      [this, table](SessionID id, session::SessionInterface *session) {
+        session->SetConfig(config_.get());
+        session->SetRequest(request_.get());
+        session->SetTable(table);
+      });
+  config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(
+      *config_);
 }
 
 bool SessionHandler::SyncData(commands::Command *command) {
@@ -276,11 +386,7 @@ bool SessionHandler::Shutdown(commands::Command *command) {
 
 bool SessionHandler::Reload(commands::Command *command) {
   VLOG(1) << "Reloading server";
-  {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    SetConfig(config);
-  }
+  SetConfig(config::ConfigHandler::GetSharedConfig());
   engine_->Reload();
   return true;
 }
@@ -461,16 +567,41 @@ bool SessionHandler::ClearStorage(commands::Command *command) {
   return storage->Clear();
 }
 
+bool SessionHandler::ReleaseStorages(commands::Command *command) {
+  VLOG(1) << "Release storages";
+  GenericStorageManagerFactory::ReleaseIdleStorages(0);
+  // Also releases the memory of the sessions and the engine which is
+  // restored on demand, as this is sent on memory pressure.
+  session_map_->ForEach(
+      [](SessionID id, session::SessionInterface *session) {
+        session->ReleaseUnusedMemory();
+      });
+  if (engine_) {
+    engine_->ReleaseUnusedMemory();
+  }
+  return true;
+}
+
 bool SessionHandler::EvalCommand(commands::Command *command) {
+  MOZC_TRACE_SPAN("SessionHandler::EvalCommand");
   if (!is_available_) {
     LOG(ERROR) << "SessionHandler is not available.";
     return false;
   }
 
+  if (!engine_ && !CanEvalWithoutEngine(command->input()) &&
+      !WaitForEngine()) {
+    return false;
+  }
+
   bool eval_succeeded = false;
   stopwatch_->Reset();
   stopwatch_->Start();
 
+  if (IsUserInputCommand(command->input().type())) {
+    Scheduler::NotifyUserActivity();
+  }
+
   switch (command->input().type()) {
     case commands::Input::CREATE_SESSION:
       eval_succeeded = CreateSession(command);
@@ -481,6 +612,9 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::SEND_KEY:
       eval_succeeded = SendKey(command);
       break;
+    case commands::Input::SEND_KEYS:
+      eval_succeeded = SendKeys(command);
+      break;
     case commands::Input::TEST_SEND_KEY:
       eval_succeeded = TestSendKey(command);
       break;
@@ -535,6 +669,27 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::SEND_ENGINE_RELOAD_REQUEST:
       eval_succeeded = SendEngineReloadRequest(command);
       break;
+    case commands::Input::GET_STORAGE_IO_STATS:
+      eval_succeeded = GetStorageIOStats(command);
+      break;
+    case commands::Input::RELEASE_STORAGES:
+      eval_succeeded = ReleaseStorages(command);
+      break;
+    case commands::Input::GET_LATENCY_STATS:
+      eval_succeeded = GetLatencyStats(command);
+      break;
+    case commands::Input::RESET_LATENCY_STATS:
+      eval_succeeded = ResetLatencyStats(command);
+      break;
+    case commands::Input::START_TRACE:
+      eval_succeeded = StartTrace(command);
+      break;
+    case commands::Input::STOP_TRACE:
+      eval_succeeded = StopTrace(command);
+      break;
+    case commands::Input::GET_MEMORY_STATS:
+      eval_succeeded = GetMemoryStats(command);
+      break;
     case commands::Input::NO_OPERATION:
       eval_succeeded = NoOperation(command);
       break;
@@ -558,11 +713,36 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   if (eval_succeeded) {
     // TODO(komatsu): Make sre if checking eval_succeeded is necessary or not.
     observer_handler_->EvalCommandHandler(*command);
+    MaybeEncodeOutputDelta(command);
+  }
+
+  // The precomputed conversion is used only by the command right after it.
+  ClearPrecomputedConversion();
+  if (eval_succeeded &&
+      (command->input().type() == commands::Input::SEND_KEY ||
+       command->input().type() == commands::Input::SEND_KEYS ||
+       command->input().type() == commands::Input::SEND_COMMAND)) {
+    idle_work_session_id_ = command->input().id();
   }
 
   stopwatch_->Stop();
-  UsageStats::UpdateTiming("ElapsedTimeUSec",
-                           stopwatch_->GetElapsedMicroseconds());
+  const uint64 elapsed_usec = stopwatch_->GetElapsedMicroseconds();
+  UsageStats::UpdateTiming("ElapsedTimeUSec", elapsed_usec);
+  latency_stats_->Record(*command, elapsed_usec);
+  if (FLAGS_slow_command_threshold_msec > 0 &&
+      elapsed_usec >=
+          static_cast<uint64>(FLAGS_slow_command_threshold_msec) * 1000) {
+    LOG(WARNING) << "Slow command: "
+                 << session::SessionLatencyStats::GetCommandKind(*command)
+                 << " took " << elapsed_usec << " usec";
+  }
+  if (!first_send_key_recorded_ &&
+      command->input().type() == commands::Input::SEND_KEY) {
+    // The first key event after startup includes the page faults of the data
+    // set unless it is warmed up (see --warmup_data in engine.cc).
+    first_send_key_recorded_ = true;
+    UsageStats::UpdateTiming("FirstSendKeyElapsedTimeUSec", elapsed_usec);
+  }
 
   return is_available_;
 }
@@ -581,43 +761,102 @@ void SessionHandler::MaybeUpdateStoredConfig(commands::Command *command) {
     return;
   }
 
-  *config_ = command->output().config();
-  config::ConfigHandler::SetConfig(*config_);
+  config::ConfigHandler::SetConfig(command->output().config());
   Reload(command);
 }
 
 bool SessionHandler::SendKey(commands::Command *command) {
+  if (!engine_) {
+    // A direct input key while the engine is loading.
+    command->mutable_output()->set_consumed(false);
+    return true;
+  }
   const SessionID id = command->input().id();
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == NULL || *session == NULL) {
+  std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendKey(command);
+  session->SendKey(command);
+  MaybeUpdateStoredConfig(command);
+  return true;
+}
+
+bool SessionHandler::SendKeys(commands::Command *command) {
+  const SessionID id = command->input().id();
+  std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(id);
+  if (session == nullptr) {
+    LOG(WARNING) << "SessionID " << id << " is not available";
+    return false;
+  }
+  const int num_keys = command->input().batched_keys_size();
+  if (num_keys == 0) {
+    LOG(WARNING) << "No key events for SEND_KEYS";
+    return false;
+  }
+
+  commands::Command key_command;
+  commands::Input *key_input = key_command.mutable_input();
+  key_input->CopyFrom(command->input());
+  key_input->clear_batched_keys();
+  key_input->set_type(commands::Input::SEND_KEY);
+  int applied_keys = 0;
+  while (applied_keys < num_keys) {
+    const bool is_last = (applied_keys + 1 == num_keys);
+    key_input->mutable_key()->CopyFrom(
+        command->input().batched_keys(applied_keys));
+    // Intermediate suggestions are skipped since they are overwritten by the
+    // following keys.
+    if (!is_last) {
+      key_input->set_request_suggestion(false);
+    } else if (command->input().has_request_suggestion()) {
+      key_input->set_request_suggestion(
+          command->input().request_suggestion());
+    } else {
+      key_input->clear_request_suggestion();
+    }
+    key_command.clear_output();
+    session->SendKey(&key_command);
+    ++applied_keys;
+    if (ShouldStopBatchedKeys(key_command.output())) {
+      break;
+    }
+  }
+
+  command->mutable_output()->Swap(key_command.mutable_output());
+  command->mutable_output()->set_batched_key_count(applied_keys);
   MaybeUpdateStoredConfig(command);
   return true;
 }
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
+  if (!engine_) {
+    // A direct input key while the engine is loading.
+    command->mutable_output()->set_consumed(false);
+    return true;
+  }
   const SessionID id = command->input().id();
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == NULL || *session == NULL) {
+  std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->TestSendKey(command);
+  session->TestSendKey(command);
   return true;
 }
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
-  session::SessionInterface **session =
-    const_cast<session::SessionInterface **>(session_map_->Lookup(id));
-  if (session == NULL || *session == NULL) {
+  std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendCommand(command);
+  session->SendCommand(command);
   MaybeUpdateStoredConfig(command);
   return true;
 }
@@ -637,21 +876,6 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
   last_create_session_time_ = current_time;
 
-  // if session map is FULL, remove the oldest item from the LRU
-  SessionElement *oldest_element = NULL;
-  if (session_map_->Size() >= max_session_size_) {
-    oldest_element = const_cast<SessionElement *>(session_map_->Tail());
-    if (oldest_element == NULL) {
-      LOG(ERROR) << "oldest SessionElement is NULL";
-      return false;
-    }
-    delete oldest_element->value;
-    oldest_element->value = NULL;
-    session_map_->Erase(oldest_element->key);
-    VLOG(1) << "Session is FULL, oldest SessionID "
-            << oldest_element->key << " is removed";
-  }
-
   if (engine_builder_ &&
       session_map_->Size() == 0 &&
       engine_builder_->HasResponse()) {
@@ -659,53 +883,36 @@ bool SessionHandler::CreateSession(commands::Command *command) {
         command->mutable_output()->mutable_engine_reload_response();
     engine_builder_->GetResponse(response);
     if (response->status() == EngineReloadResponse::RELOAD_READY) {
-      if (engine_->GetUserDataManager()) {
-        engine_->GetUserDataManager()->Wait();
-      }
-      engine_.reset();
-      engine_ = engine_builder_->BuildFromPreparedData();
-      LOG_IF(FATAL, !engine_) << "Critical failure in engine replace";
+      // The new engine has been built off this thread, and no session refers
+      // to the current one here, so they are simply swapped.
+      std::unique_ptr<EngineInterface> new_engine =
+          engine_builder_->BuildFromPreparedData();
+      LOG_IF(FATAL, !new_engine) << "Critical failure in engine replace";
+      ReplaceEngine(std::move(new_engine));
       table_manager_->ClearCaches();
       response->set_status(EngineReloadResponse::RELOADED);
     }
     engine_builder_->Clear();
   }
 
-  session::SessionInterface *session = NewSession();
-  if (session == NULL) {
-    LOG(ERROR) << "Cannot allocate new Session";
-    return false;
-  }
-
   const SessionID new_id = CreateNewSessionID();
-  SessionElement *element = session_map_->Insert(new_id);
-  element->value = session;
-  command->mutable_output()->set_id(new_id);
-
-  // The oldes item should be reused
-  DCHECK(oldest_element == NULL || oldest_element == element);
-
-  if (command->input().has_capability()) {
-    session->set_client_capability(command->input().capability());
+  if (!engine_) {
+    // The session is created when the engine is loaded.  See WaitForEngine().
+    pending_sessions_[new_id].reset(new commands::Input(command->input()));
+    command->mutable_output()->set_id(new_id);
+    last_session_empty_time_ = 0;
+    UsageStats::IncrementCount("SessionCreated");
+    return true;
   }
 
-  if (command->input().has_application_info()) {
-    session->set_application_info(command->input().application_info());
-#ifdef OS_NACL
-    if (command->input().application_info().has_timezone_offset()) {
-      Clock::SetTimezoneOffset(
-          command->input().application_info().timezone_offset());
-    }
-#endif  // OS_NACL
+  if (!AddSession(new_id, command->input())) {
+    return false;
   }
+  command->mutable_output()->set_id(new_id);
 
   // Ensure the onmemory config is same as the locally stored one
   // because the local data could be changed by sync.
-  {
-    config::Config config;
-    config::ConfigHandler::GetConfig(&config);
-    SetConfig(config);
-  }
+  SetConfig(config::ConfigHandler::GetSharedConfig());
 
   // session is not empty.
   last_session_empty_time_ = 0;
@@ -715,6 +922,41 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::AddSession(SessionID id, const commands::Input &input) {
+  std::shared_ptr<session::SessionInterface> session(NewSession());
+  if (session == nullptr) {
+    LOG(ERROR) << "Cannot allocate new Session";
+    return false;
+  }
+
+  // If session map is FULL, the oldest session is removed.
+  SessionID evicted_id = 0;
+  session_map_->Insert(id, session, &evicted_id);
+  VLOG_IF(1, evicted_id != 0) << "Session is FULL, oldest SessionID "
+                              << evicted_id << " is removed";
+
+  // SetConfig() skips the sessions when the config is not changed, so the new
+  // one is set up here.
+  session->SetConfig(config_.get());
+  session->SetRequest(request_.get());
+  session->SetTable(table_manager_->GetTable(
+      *request_, *config_, GetDataManagerOrEmpty(*engine_)));
+
+  if (input.has_capability()) {
+    session->set_client_capability(input.capability());
+  }
+
+  if (input.has_application_info()) {
+    session->set_application_info(input.application_info());
+#ifdef OS_NACL
+    if (input.application_info().has_timezone_offset()) {
+      Clock::SetTimezoneOffset(input.application_info().timezone_offset());
+    }
+#endif  // OS_NACL
+  }
+  return true;
+}
+
 bool SessionHandler::DeleteSession(commands::Command *command) {
   DeleteSessionID(command->input().id());
   if (engine_->GetUserDataManager()) {
@@ -762,35 +1004,45 @@ bool SessionHandler::Cleanup(commands::Command *command) {
       max(10, min(FLAGS_last_command_timeout, 7200));
 
   std::vector<SessionID> remove_ids;
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != NULL; element = element->next) {
-    session::SessionInterface *session = element->value;
-    if (!IsApplicationAlive(session)) {
-      VLOG(2) << "Application is not alive. Removing: " << element->key;
-      remove_ids.push_back(element->key);
-    } else if (session->last_command_time() == 0) {
-      // no command is exectuted
-      if ((current_time - session->create_session_time()) >=
-          create_session_timeout) {
-        remove_ids.push_back(element->key);
-      }
-    } else {  // some commands are executed already
-      if ((current_time - session->last_command_time()) >=
-          last_command_timeout) {
-        remove_ids.push_back(element->key);
-      }
-    }
-  }
+  session_map_->ForEach(
+      [&](SessionID id, session::SessionInterface *session) {
+        if (!IsApplicationAlive(session)) {
+          VLOG(2) << "Application is not alive. Removing: " << id;
+          remove_ids.push_back(id);
+        } else if (session->last_command_time() == 0) {
+          // no command is exectuted
+          if ((current_time - session->create_session_time()) >=
+              create_session_timeout) {
+            remove_ids.push_back(id);
+          }
+        } else {  // some commands are executed already
+          if ((current_time - session->last_command_time()) >=
+              last_command_timeout) {
+            remove_ids.push_back(id);
+          }
+        }
+      });
 
   for (size_t i = 0; i < remove_ids.size(); ++i) {
     DeleteSessionID(remove_ids[i]);
     VLOG(1) << "Session ID " << remove_ids[i] << " is removed by server";
   }
 
+  // The pools of the remaining sessions are shrunk to the usage since the
+  // last cleanup.
+  session_map_->ForEach(
+      [](SessionID id, session::SessionInterface *session) {
+        session->ReleaseUnusedMemory();
+      });
+
   // Sync all data. This is a regression bug fix http://b/3033708
   engine_->GetUserDataManager()->Sync();
 
+  // The generic storages are rarely used, so they don't keep their pages
+  // while they are not used.
+  GenericStorageManagerFactory::ReleaseIdleStorages(
+      max(1, FLAGS_generic_storage_idle_timeout));
+
   // timeout is enabled.
   if (FLAGS_timeout > 0 &&
       last_session_empty_time_ != 0 &&
@@ -818,6 +1070,24 @@ bool SessionHandler::SendUserDictionaryCommand(commands::Command *command) {
   return result;
 }
 
+void SessionHandler::ReplaceEngine(std::unique_ptr<EngineInterface> engine) {
+  // The new engine loaded the user data while it was being built, so the
+  // learning since then is written by the old engine and read again by the
+  // new one.  The old engine is destroyed before the reload, as its
+  // destructor also writes the user data, which must not overwrite the
+  // learning of the new engine.
+  if (engine_->GetUserDataManager()) {
+    engine_->GetUserDataManager()->Sync();
+    engine_->GetUserDataManager()->Wait();
+  }
+  engine_.reset();
+  engine_ = std::move(engine);
+  if (engine_->GetUserDataManager()) {
+    engine_->GetUserDataManager()->Reload();
+  }
+  engine_->Reload();
+}
+
 bool SessionHandler::SendEngineReloadRequest(commands::Command *command) {
   if (!engine_builder_ || !command->input().has_engine_reload_request()) {
     return false;
@@ -828,10 +1098,176 @@ bool SessionHandler::SendEngineReloadRequest(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::GetStorageIOStats(commands::Command *command) {
+  commands::Output *output = command->mutable_output();
+  for (int i = 0; i < IOStats::NUM_COMPONENTS; ++i) {
+    const IOStats::Component component = static_cast<IOStats::Component>(i);
+    IOStats::Stats stats;
+    IOStats::GetStats(component, &stats);
+    commands::StorageIOStats *output_stats = output->add_storage_io_stats();
+    output_stats->set_component(IOStats::GetComponentName(component));
+    output_stats->set_read_bytes(stats.read_bytes);
+    output_stats->set_read_count(stats.read_count);
+    output_stats->set_write_bytes(stats.write_bytes);
+    output_stats->set_write_count(stats.write_count);
+    output_stats->set_sync_count(stats.sync_count);
+    output_stats->set_time_microseconds(stats.time_microseconds);
+  }
+  return true;
+}
+
+bool SessionHandler::GetLatencyStats(commands::Command *command) {
+  latency_stats_->FillStats(command->mutable_output());
+  return true;
+}
+
+bool SessionHandler::ResetLatencyStats(commands::Command *command) {
+  latency_stats_->Reset();
+  return true;
+}
+
+bool SessionHandler::StartTrace(commands::Command *command) {
+  Trace::SetEnabled(true);
+  return true;
+}
+
+bool SessionHandler::StopTrace(commands::Command *command) {
+  Trace::SetEnabled(false);
+  Trace::ExportChromeTrace(command->mutable_output()->mutable_chrome_trace());
+  return true;
+}
+
+bool SessionHandler::GetMemoryStats(commands::Command *command) {
+  std::vector<MemoryStats::Usage> usages;
+  MemoryStats::Usage process_usage;
+  if (MemoryStats::GetProcessUsage(&process_usage)) {
+    usages.push_back(process_usage);
+  }
+  usages.push_back(MemoryStats::HeapUsage(
+      "session_map", session_map_->GetAllocatedBytes(), session_map_->Size()));
+  if (engine_) {
+    engine_->CollectMemoryUsage(&usages);
+  }
+
+  // The sessions are summed up by component.
+  std::vector<MemoryStats::Usage> session_usages;
+  session_map_->ForEach(
+      [&session_usages](SessionID id, session::SessionInterface *session) {
+        session->CollectMemoryUsage(&session_usages);
+      });
+  MemoryStats::Merge(&session_usages);
+  usages.insert(usages.end(), session_usages.begin(), session_usages.end());
+
+  commands::Output *output = command->mutable_output();
+  for (size_t i = 0; i < usages.size(); ++i) {
+    commands::ComponentMemoryStats *stats = output->add_memory_stats();
+    stats->set_component(usages[i].component);
+    stats->set_virtual_bytes(usages[i].virtual_bytes);
+    stats->set_resident_bytes(usages[i].resident_bytes);
+    stats->set_shared_bytes(usages[i].shared_bytes);
+    stats->set_count(usages[i].count);
+  }
+  return true;
+}
+
 bool SessionHandler::NoOperation(commands::Command *command) {
+  command->mutable_output()->set_engine_ready(IsEngineReady());
+  return true;
+}
+
+bool SessionHandler::IsEngineReady() {
+  if (engine_loader_ && !engine_loader_->IsRunning()) {
+    WaitForEngine();
+  }
+  return engine_ != nullptr;
+}
+
+bool SessionHandler::WaitForEngine() {
+  if (!engine_loader_) {
+    return engine_ != nullptr;
+  }
+  engine_loader_->Join();
+  engine_ = engine_loader_->ReleaseEngine();
+  engine_loader_.reset();
+  if (!engine_) {
+    LOG(ERROR) << "Failed to load the engine";
+    pending_sessions_.clear();
+    is_available_ = false;
+    return false;
+  }
+
+  VLOG(1) << "Creating " << pending_sessions_.size()
+          << " sessions requested while loading the engine";
+  for (const auto &pending : pending_sessions_) {
+    AddSession(pending.first, *pending.second);
+  }
+  pending_sessions_.clear();
+  SetConfig(config::ConfigHandler::GetSharedConfig());
   return true;
 }
 
+bool SessionHandler::CanEvalWithoutEngine(
+    const commands::Input &input) const {
+  switch (input.type()) {
+    case commands::Input::NO_OPERATION:
+    case commands::Input::CREATE_SESSION:
+    case commands::Input::GET_LATENCY_STATS:
+    case commands::Input::RESET_LATENCY_STATS:
+    case commands::Input::START_TRACE:
+    case commands::Input::STOP_TRACE:
+    case commands::Input::GET_MEMORY_STATS:
+      return true;
+    case commands::Input::SEND_KEY:
+    case commands::Input::TEST_SEND_KEY:
+      return pending_sessions_.count(input.id()) > 0 &&
+             IsDirectInputKey(input);
+    default:
+      return false;
+  }
+}
+
+void SessionHandler::MaybeEncodeOutputDelta(commands::Command *command) {
+  if (command->input().type() != commands::Input::SEND_KEY &&
+      command->input().type() != commands::Input::SEND_KEYS &&
+      command->input().type() != commands::Input::SEND_COMMAND) {
+    return;
+  }
+  std::shared_ptr<session::SessionInterface> session =
+      session_map_->Lookup(command->input().id());
+  if (session == nullptr) {
+    return;
+  }
+  session->EncodeOutputDelta(command);
+}
+
+bool SessionHandler::DoIdleWork() {
+  if (idle_work_session_id_ == 0) {
+    return false;
+  }
+  // Only the session used last is likely to be converted next.
+  const SessionID id = idle_work_session_id_;
+  idle_work_session_id_ = 0;
+  std::shared_ptr<session::SessionInterface> session =
+      session_map_->LookupWithoutUpdate(id);
+  if (session != nullptr && session->PrecomputeConversion()) {
+    VLOG(2) << "Precomputed the conversion of SessionID " << id;
+    precomputed_session_id_ = id;
+  }
+  return false;
+}
+
+void SessionHandler::ClearPrecomputedConversion() {
+  if (precomputed_session_id_ == 0) {
+    return;
+  }
+  std::shared_ptr<session::SessionInterface> session =
+      session_map_->LookupWithoutUpdate(precomputed_session_id_);
+  if (session != nullptr) {
+    session->ClearPrecomputedConversion();
+  }
+  precomputed_session_id_ = 0;
+}
+
 // Create Random Session ID in order to make the session id unpredicable
 SessionID SessionHandler::CreateNewSessionID() {
   SessionID id = 0;
@@ -850,14 +1286,10 @@ SessionID SessionHandler::CreateNewSessionID() {
 }
 
 bool SessionHandler::DeleteSessionID(SessionID id) {
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == NULL || *session == NULL) {
+  if (!session_map_->Erase(id)) {
     LOG_IF(WARNING, id != 0) << "cannot find SessionID " << id;
     return false;
   }
-  delete *session;
-
-  session_map_->Erase(id);   // remove from LRU
 
   // if session gets empty, save the timestamp
   if (last_session_empty_time_ == 0 &&
@@ -32,6 +32,7 @@
 #ifndef MOZC_SESSION_SESSION_HANDLER_H_
 #define MOZC_SESSION_SESSION_HANDLER_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -42,7 +43,6 @@
 #include "engine/engine_interface.h"
 #include "session/common.h"
 #include "session/session_handler_interface.h"
-#include "storage/lru_cache.h"
 // for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
 
@@ -65,11 +65,14 @@ class Stopwatch;
 
 namespace commands {
 class Command;
+class Input;
 class Request;
 }  // namespace commands
 
 namespace session {
 class SessionInterface;
+class SessionLatencyStats;
+class SessionMap;
 class SessionObserverHandler;
 class SessionObserverInterface;
 }  // namespace session
@@ -83,6 +86,12 @@ class SessionHandler : public SessionHandlerInterface {
   explicit SessionHandler(std::unique_ptr<EngineInterface> engine);
   SessionHandler(std::unique_ptr<EngineInterface> engine,
                  std::unique_ptr<EngineBuilderInterface> engine_builder);
+  // Creates the engine by |engine_factory| on a background thread so that the
+  // server can accept connections while the engine is loading.  Until the
+  // engine is ready, NO_OPERATION and the key events of the deactivated IME
+  // are answered immediately, and the other commands wait for the engine.
+  explicit SessionHandler(
+      std::function<std::unique_ptr<EngineInterface>()> engine_factory);
   ~SessionHandler() override;
 
   // Returns true if SessionHandle is available.
@@ -93,23 +102,27 @@ class SessionHandler : public SessionHandlerInterface {
   // Starts watch dog timer to cleanup sessions.
   bool StartWatchDog() override;
 
+  // Precomputes the conversion of the session used by the last command.
+  bool DoIdleWork() override;
+
   // NewSession returns new Sessoin.
   // Client needs to delete it properly
   session::SessionInterface *NewSession();
 
   void AddObserver(session::SessionObserverInterface *observer) override;
   StringPiece GetDataVersion() const override {
-    return engine_->GetDataVersion();
+    return engine_ ? engine_->GetDataVersion() : StringPiece();
   }
 
+  // Returns true if the engine has been loaded.  This doesn't block.
+  bool IsEngineReady();
+
   const EngineInterface &engine() const { return *engine_; }
 
  private:
   FRIEND_TEST(SessionHandlerTest, StorageTest);
 
-  using SessionMap =
-      mozc::storage::LRUCache<SessionID, session::SessionInterface *>;
-  using SessionElement = SessionMap::Element;
+  class EngineLoader;
 
   void Init(std::unique_ptr<EngineInterface> engine,
             std::unique_ptr<EngineBuilderInterface> engine_builder);
@@ -117,13 +130,20 @@ class SessionHandler : public SessionHandlerInterface {
   // Sets config to all the modules managed by this handler.  This does not
   // affect the stored config in the local storage.
   void SetConfig(const config::Config &config);
+  // Same as above, but shares the |config| snapshot.  Does nothing if it's
+  // the one already set, e.g., ConfigHandler::GetSharedConfig() has not been
+  // replaced since the last call.
+  void SetConfig(std::shared_ptr<const config::Config> config);
   // Updates the stored config, if the |command| contains the config.
   void MaybeUpdateStoredConfig(commands::Command *command);
 
   bool CreateSession(commands::Command *command);
+  // Creates the session of |id| for CREATE_SESSION |input|.
+  bool AddSession(SessionID id, const commands::Input &input);
   bool DeleteSession(commands::Command *command);
   bool TestSendKey(commands::Command *command);
   bool SendKey(commands::Command *command);
+  bool SendKeys(commands::Command *command);
   bool SendCommand(commands::Command *command);
   bool SyncData(commands::Command *command);
   bool ClearUserHistory(commands::Command *command);
@@ -139,15 +159,39 @@ class SessionHandler : public SessionHandlerInterface {
   bool InsertToStorage(commands::Command *command);
   bool ReadAllFromStorage(commands::Command *command);
   bool ClearStorage(commands::Command *command);
+  bool ReleaseStorages(commands::Command *command);
   bool Cleanup(commands::Command *command);
   bool SendUserDictionaryCommand(commands::Command *command);
   bool SendEngineReloadRequest(commands::Command *command);
+  // Destroys the current engine and swaps |engine| in.
+  void ReplaceEngine(std::unique_ptr<EngineInterface> engine);
+  bool GetStorageIOStats(commands::Command *command);
+  bool GetLatencyStats(commands::Command *command);
+  bool ResetLatencyStats(commands::Command *command);
+  bool StartTrace(commands::Command *command);
+  bool StopTrace(commands::Command *command);
+  bool GetMemoryStats(commands::Command *command);
   bool NoOperation(commands::Command *command);
 
+  // Encodes the output of SEND_KEY, SEND_KEYS and SEND_COMMAND as a delta.
+  // This must be called after the observers since they need the complete
+  // output.
+  void MaybeEncodeOutputDelta(commands::Command *command);
+
+  // Waits for the engine loaded by the background thread, if any, and creates
+  // the sessions requested while loading.  Returns false if the engine is not
+  // available.
+  bool WaitForEngine();
+  // Returns true if |input| can be evaluated while the engine is loading.
+  bool CanEvalWithoutEngine(const commands::Input &input) const;
+
+  // Discards the conversion precomputed by DoIdleWork().
+  void ClearPrecomputedConversion();
+
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
-  std::unique_ptr<SessionMap> session_map_;
+  std::unique_ptr<session::SessionMap> session_map_;
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
   std::unique_ptr<SessionWatchDog> session_watch_dog_;
 #else  // MOZC_DISABLE_SESSION_WATCHDOG
@@ -160,16 +204,26 @@ class SessionHandler : public SessionHandlerInterface {
   uint64 last_session_empty_time_ = 0;
   uint64 last_cleanup_time_ = 0;
   uint64 last_create_session_time_ = 0;
+  bool first_send_key_recorded_ = false;
+  // The session for DoIdleWork() and the one having the precomputed
+  // conversion.
+  SessionID idle_work_session_id_ = 0;
+  SessionID precomputed_session_id_ = 0;
 
   std::unique_ptr<EngineInterface> engine_;
   std::unique_ptr<EngineBuilderInterface> engine_builder_;
+  std::unique_ptr<EngineLoader> engine_loader_;
+  // CREATE_SESSION inputs received while the engine is loading.
+  std::map<SessionID, std::unique_ptr<commands::Input>> pending_sessions_;
   std::unique_ptr<session::SessionObserverHandler> observer_handler_;
   std::unique_ptr<Stopwatch> stopwatch_;
+  std::unique_ptr<session::SessionLatencyStats> latency_stats_;
   std::unique_ptr<user_dictionary::UserDictionarySessionHandler>
       user_dictionary_session_handler_;
   std::unique_ptr<composer::TableManager> table_manager_;
   std::unique_ptr<commands::Request> request_;
-  std::unique_ptr<config::Config> config_;
+  // Shared by the sessions, which refer to it until the next SetConfig().
+  std::shared_ptr<const config::Config> config_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionHandler);
 };
@@ -58,6 +58,10 @@ class SessionHandlerInterface {
   // Starts watch dog timer to cleanup sessions.
   virtual bool StartWatchDog() = 0;
 
+  // Does a piece of speculative work for the sessions while no command
+  // comes.  Returns true if more work remains.
+  virtual bool DoIdleWork() { return false; }
+
   virtual void AddObserver(
       session::SessionObserverInterface *observer) = 0;
 
@@ -35,7 +35,10 @@
 #include <vector>
 
 #include "base/clock_mock.h"
+#include "base/io_stats.h"
+#include "base/mutex.h"
 #include "base/port.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "converter/converter_mock.h"
@@ -471,11 +474,22 @@ class MockStorage : public GenericStorageInterface {
 
 class MockStorageManager : public GenericStorageManagerInterface {
  public:
+  MockStorageManager()
+      : release_count(0), release_idle_seconds(0), storage(NULL) {}
+
   virtual GenericStorageInterface *GetStorage(
      commands::GenericStorageEntry::StorageType storage_type) {
     return storage;
   }
 
+  virtual void ReleaseIdleStorages(uint64 idle_seconds) {
+    ++release_count;
+    release_idle_seconds = idle_seconds;
+  }
+
+  int release_count;
+  uint64 release_idle_seconds;
+
   void SetStorage(MockStorage *newStorage) {
     storage = newStorage;
   }
@@ -539,6 +553,22 @@ TEST_F(SessionHandlerTest, StorageTest) {
         command.output().storage_entry().type());
     EXPECT_EQ(1, mock_storage.clear_count);
   }
+  {
+    // Release
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::RELEASE_STORAGES);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    EXPECT_EQ(1, storageManager.release_count);
+    EXPECT_EQ(0, storageManager.release_idle_seconds);
+  }
+  {
+    // Cleanup releases the idle storages.
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::CLEANUP);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    EXPECT_EQ(2, storageManager.release_count);
+    EXPECT_LT(0, storageManager.release_idle_seconds);
+  }
 }
 
 TEST_F(SessionHandlerTest, EmojiUsageStatsTest) {
@@ -572,6 +602,185 @@ TEST_F(SessionHandlerTest, EmojiUsageStatsTest) {
   EXPECT_COUNT_STATS("CommitUnicodeEmoji", 2);
 }
 
+TEST_F(SessionHandlerTest, SendKeys) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64 id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SEND_KEYS);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->add_batched_keys()->set_key_code('a');
+  command.mutable_input()->add_batched_keys()->set_key_code('b');
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(2, command.output().batched_key_count());
+  EXPECT_TRUE(command.output().consumed());
+  EXPECT_TRUE(command.output().has_preedit());
+
+  // The keys after the commit are not applied.
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_KEYS);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->add_batched_keys()->set_special_key(
+      commands::KeyEvent::ENTER);
+  command.mutable_input()->add_batched_keys()->set_key_code('c');
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(1, command.output().batched_key_count());
+  EXPECT_TRUE(command.output().has_result());
+  EXPECT_FALSE(command.output().has_preedit());
+
+  // SEND_KEYS without keys fails.
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_KEYS);
+  command.mutable_input()->set_id(id);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(commands::Output::SESSION_FAILURE, command.output().error_code());
+}
+
+TEST_F(SessionHandlerTest, LoadEngineAsync) {
+  // The engine is not created until |mutex| is unlocked.
+  Mutex mutex;
+  mutex.Lock();
+  SessionHandler handler([&mutex]() {
+    scoped_lock lock(&mutex);
+    return std::unique_ptr<EngineInterface>(CreateMockDataEngine());
+  });
+  EXPECT_TRUE(handler.IsAvailable());
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::NO_OPERATION);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_FALSE(command.output().engine_ready());
+
+  // A session and the direct input are available while loading.
+  uint64 id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &id));
+  EXPECT_NE(0, id);
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_KEY);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->mutable_key()->set_key_code('a');
+  command.mutable_input()->mutable_key()->set_activated(false);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_FALSE(command.output().consumed());
+  EXPECT_EQ(id, command.output().id());
+  EXPECT_FALSE(handler.IsEngineReady());
+
+  // The other commands wait for the engine.
+  mutex.Unlock();
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_KEY);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->mutable_key()->set_special_key(
+      commands::KeyEvent::ON);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(commands::Output::SESSION_SUCCESS, command.output().error_code());
+  EXPECT_TRUE(command.output().consumed());
+  EXPECT_TRUE(handler.IsEngineReady());
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::NO_OPERATION);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_TRUE(command.output().engine_ready());
+}
+
+TEST_F(SessionHandlerTest, GetStorageIOStats) {
+  SessionHandler handler(CreateMockDataEngine());
+  IOStats::Stats base_stats;
+  IOStats::GetStats(IOStats::TINY_STORAGE, &base_stats);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::WRITE, 100, 20);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::SYNC, 0, 10);
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_STORAGE_IO_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  ASSERT_EQ(IOStats::NUM_COMPONENTS, command.output().storage_io_stats_size());
+  const commands::StorageIOStats &stats =
+      command.output().storage_io_stats(IOStats::TINY_STORAGE);
+  EXPECT_EQ("TinyStorage", stats.component());
+  EXPECT_EQ(base_stats.write_bytes + 100, stats.write_bytes());
+  EXPECT_EQ(base_stats.write_count + 1, stats.write_count());
+  EXPECT_EQ(base_stats.sync_count + 1, stats.sync_count());
+  EXPECT_EQ(base_stats.time_microseconds + 30, stats.time_microseconds());
+}
+
+TEST_F(SessionHandlerTest, GetAndResetLatencyStats) {
+  SessionHandler handler(CreateMockDataEngine());
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_CONFIG);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_TRUE(handler.EvalCommand(&command));
+
+  // The latency of a command is recorded after it is evaluated.
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::GET_LATENCY_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  ASSERT_EQ(1, command.output().command_latency_stats_size());
+  EXPECT_EQ("GET_CONFIG", command.output().command_latency_stats(0).command());
+  EXPECT_EQ(2, command.output().command_latency_stats(0).count());
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::RESET_LATENCY_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::GET_LATENCY_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  ASSERT_EQ(1, command.output().command_latency_stats_size());
+  EXPECT_EQ("RESET_LATENCY_STATS",
+            command.output().command_latency_stats(0).command());
+}
+
+TEST_F(SessionHandlerTest, StartAndStopTrace) {
+  SessionHandler handler(CreateMockDataEngine());
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::START_TRACE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_TRUE(Trace::IsEnabled());
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::GET_CONFIG);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::STOP_TRACE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_FALSE(Trace::IsEnabled());
+  // Only the span of GET_CONFIG is in the trace.  START_TRACE started
+  // before the tracing was enabled, and STOP_TRACE ends after the export.
+  const string &trace = command.output().chrome_trace();
+  const string kSpan = "\"name\":\"SessionHandler::EvalCommand\"";
+  const size_t pos = trace.find(kSpan);
+  EXPECT_NE(string::npos, pos);
+  EXPECT_EQ(string::npos, trace.find(kSpan, pos + 1));
+}
+
+TEST_F(SessionHandlerTest, GetMemoryStats) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_MEMORY_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  bool found_session_map = false;
+  int num_segments_entries = 0;
+  for (const commands::ComponentMemoryStats &stats :
+       command.output().memory_stats()) {
+    EXPECT_LE(stats.shared_bytes(), stats.resident_bytes());
+    if (stats.component() == "session_map") {
+      found_session_map = true;
+      EXPECT_EQ(2, stats.count());
+    } else if (stats.component() == "session:segments") {
+      ++num_segments_entries;
+    }
+  }
+  EXPECT_TRUE(found_session_map);
+  // The sessions are merged into one entry per component.
+  EXPECT_EQ(1, num_segments_entries);
+}
+
 // Tests the interaction with EngineBuilderInterface for successful Engine
 // reload event.
 TEST_F(SessionHandlerTest, EngineReload_SuccessfulScenario) {
@@ -46,6 +46,7 @@
 #include "session/session_handler_interface.h"
 #include "session/session_usage_observer.h"
 #include "storage/registry.h"
+#include "usage_stats/usage_stats.h"
 
 DECLARE_string(test_tmpdir);
 
@@ -151,6 +152,7 @@ void SessionHandlerTestBase::ClearState() {
   // Some destructors may save the state on storages. To clear the state, we
   // explicitly call destructors before clearing storages.
   storage::Registry::Clear();
+  usage_stats::UsageStats::ClearAllStatsForTest();
   FileUtil::Unlink(ConfigFileStream::GetFileName("user://boundary.db"));
   FileUtil::Unlink(ConfigFileStream::GetFileName("user://segment.db"));
   FileUtil::Unlink(UserHistoryPredictor::GetUserHistoryFileName());
@@ -32,6 +32,9 @@
 #ifndef MOZC_SESSION_SESSION_INTERFACE_H_
 #define MOZC_SESSION_SESSION_INTERFACE_H_
 
+#include <vector>
+
+#include "base/memory_stats.h"
 #include "base/port.h"
 
 namespace mozc {
@@ -47,6 +50,10 @@ namespace composer {
 class Table;
 }  // namespace composer
 
+namespace config {
+class Config;
+}  // namespace config
+
 namespace session {
 class SessionInterface {
  public:
@@ -60,7 +67,7 @@ class SessionInterface {
   // Perform the SEND_COMMAND command defined commands.proto.
   virtual bool SendCommand(commands::Command *command) = 0;
 
-  virtual void SetConfig(config::Config *config) = 0;
+  virtual void SetConfig(const config::Config *config) = 0;
 
   // Set Request. Currently, this is especial for session::Session.
   virtual void SetRequest(const commands::Request *request) {}
@@ -84,6 +91,25 @@ class SessionInterface {
 
   // return 0 (default value) if no command is executed in this session.
   virtual uint64 last_command_time() const = 0;
+
+  // Encode command->output() as a delta against the last output if the
+  // client supports it.  Called after the observers see the complete output.
+  virtual void EncodeOutputDelta(commands::Command *command) {}
+
+  // Converts the composition in advance while the server is idle so that the
+  // next conversion returns at once.  Returns true if it is prepared.
+  virtual bool PrecomputeConversion() { return false; }
+
+  // Discards the result of PrecomputeConversion().
+  virtual void ClearPrecomputedConversion() {}
+
+  // Releases the pooled memory which has not been used recently.  Called
+  // periodically by SessionHandler::Cleanup().
+  virtual void ReleaseUnusedMemory() {}
+
+  // Appends the memory used by this session, e.g. the segments, to |usages|.
+  virtual void CollectMemoryUsage(
+      std::vector<MemoryStats::Usage> *usages) const {}
 };
 
 }  // namespace session
@@ -0,0 +1,207 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_latency_stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "base/logging.h"
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+// The histograms are laid out as follows:
+//   the input types, except the ones broken down below,
+//   SEND_COMMAND for each session command type,
+//   SEND_KEY for each candidate category and for no candidates,
+//   SEND_KEYS for each candidate category and for no candidates.
+const size_t kNumInputTypes = commands::Input::CommandType_MAX + 1;
+const size_t kNumSessionCommandTypes =
+    commands::SessionCommand::CommandType_MAX + 1;
+const size_t kNumKeyKinds = commands::Category_MAX + 2;
+const size_t kSendCommandOffset = kNumInputTypes;
+const size_t kSendKeyOffset = kSendCommandOffset + kNumSessionCommandTypes;
+const size_t kSendKeysOffset = kSendKeyOffset + kNumKeyKinds;
+const size_t kNumHistograms = kSendKeysOffset + kNumKeyKinds;
+
+const char kNoCandidates[] = "NO_CANDIDATES";
+
+// Returns the index of the kind of the key command among kNumKeyKinds.
+size_t GetKeyKindIndex(const commands::Output &output) {
+  if (!output.has_candidates()) {
+    return kNumKeyKinds - 1;
+  }
+  return output.candidates().category();
+}
+
+string GetKeyKindName(size_t index) {
+  if (index == kNumKeyKinds - 1) {
+    return kNoCandidates;
+  }
+  return commands::Category_Name(static_cast<commands::Category>(index));
+}
+
+string GetHistogramName(size_t index) {
+  if (index < kSendCommandOffset) {
+    return commands::Input::CommandType_Name(
+        static_cast<commands::Input::CommandType>(index));
+  }
+  if (index < kSendKeyOffset) {
+    return "SEND_COMMAND:" +
+        commands::SessionCommand::CommandType_Name(
+            static_cast<commands::SessionCommand::CommandType>(
+                index - kSendCommandOffset));
+  }
+  if (index < kSendKeysOffset) {
+    return "SEND_KEY:" + GetKeyKindName(index - kSendKeyOffset);
+  }
+  return "SEND_KEYS:" + GetKeyKindName(index - kSendKeysOffset);
+}
+
+}  // namespace
+
+SessionLatencyStats::SessionLatencyStats() : histograms_(kNumHistograms) {
+  Reset();
+}
+
+SessionLatencyStats::~SessionLatencyStats() {}
+
+void SessionLatencyStats::Record(const commands::Command &command,
+                                 uint64 microseconds) {
+  Histogram *histogram = &histograms_[GetHistogramIndex(command)];
+  ++histogram->count;
+  histogram->total_microseconds += microseconds;
+  histogram->max_microseconds =
+      max(histogram->max_microseconds, microseconds);
+  ++histogram->buckets[GetBucketIndex(microseconds)];
+}
+
+void SessionLatencyStats::FillStats(commands::Output *output) const {
+  const uint32 kPercentiles[] = {50, 95, 99};
+  for (size_t i = 0; i < histograms_.size(); ++i) {
+    const Histogram &histogram = histograms_[i];
+    if (histogram.count == 0) {
+      continue;
+    }
+    uint64 percentile_values[arraysize(kPercentiles)];
+    size_t bucket = 0;
+    uint64 accumulated = 0;
+    for (size_t j = 0; j < arraysize(kPercentiles); ++j) {
+      // The smallest value of which the rank is at least the percentile.
+      const uint64 rank = max<uint64>(
+          1, (histogram.count * kPercentiles[j] + 99) / 100);
+      while (accumulated + histogram.buckets[bucket] < rank) {
+        accumulated += histogram.buckets[bucket];
+        ++bucket;
+      }
+      DCHECK_LT(bucket, kNumBuckets);
+      percentile_values[j] = min(GetBucketUpperBound(bucket),
+                                 histogram.max_microseconds);
+    }
+
+    commands::CommandLatencyStats *stats =
+        output->add_command_latency_stats();
+    stats->set_command(GetHistogramName(i));
+    stats->set_count(histogram.count);
+    stats->set_total_microseconds(histogram.total_microseconds);
+    stats->set_max_microseconds(histogram.max_microseconds);
+    stats->set_p50_microseconds(percentile_values[0]);
+    stats->set_p95_microseconds(percentile_values[1]);
+    stats->set_p99_microseconds(percentile_values[2]);
+  }
+}
+
+void SessionLatencyStats::Reset() {
+  for (size_t i = 0; i < histograms_.size(); ++i) {
+    memset(&histograms_[i], 0, sizeof(histograms_[i]));
+  }
+}
+
+// static
+string SessionLatencyStats::GetCommandKind(const commands::Command &command) {
+  return GetHistogramName(GetHistogramIndex(command));
+}
+
+// static
+size_t SessionLatencyStats::GetHistogramIndex(
+    const commands::Command &command) {
+  const commands::Input &input = command.input();
+  switch (input.type()) {
+    case commands::Input::SEND_COMMAND:
+      if (input.has_command()) {
+        return kSendCommandOffset + input.command().type();
+      }
+      break;
+    case commands::Input::SEND_KEY:
+      return kSendKeyOffset + GetKeyKindIndex(command.output());
+    case commands::Input::SEND_KEYS:
+      return kSendKeysOffset + GetKeyKindIndex(command.output());
+    default:
+      break;
+  }
+  return input.type();
+}
+
+// static
+size_t SessionLatencyStats::GetBucketIndex(uint64 microseconds) {
+  // The values less than 4 have their own buckets.  The others are in the
+  // bucket of the highest bit and the two bits below it.
+  if (microseconds < 4) {
+    return static_cast<size_t>(microseconds);
+  }
+  size_t highest_bit = 2;
+  while (highest_bit < 63 && (microseconds >> (highest_bit + 1)) != 0) {
+    ++highest_bit;
+  }
+  const size_t index = 4 * (highest_bit - 1) +
+      static_cast<size_t>((microseconds >> (highest_bit - 2)) & 3);
+  return min(index, kNumBuckets - 1);
+}
+
+// static
+uint64 SessionLatencyStats::GetBucketUpperBound(size_t index) {
+  if (index + 1 >= kNumBuckets) {
+    return kuint64max;
+  }
+  // The smallest value of the next bucket minus one.
+  const size_t next = index + 1;
+  if (next < 4) {
+    return next - 1;
+  }
+  const size_t highest_bit = next / 4 + 1;
+  return (static_cast<uint64>(4 + next % 4) << (highest_bit - 2)) - 1;
+}
+
+}  // namespace session
+}  // namespace mozc
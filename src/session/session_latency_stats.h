@@ -0,0 +1,98 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Fixed-size latency histograms of the commands evaluated by SessionHandler,
+// broken down by the kind of the command.  Each histogram has four buckets
+// for each power of two of microseconds, so that the percentiles are
+// estimated within 25% while the memory does not grow with the number of
+// the commands.  Not thread-safe; SessionHandler evaluates the commands one
+// by one.
+
+#ifndef MOZC_SESSION_SESSION_LATENCY_STATS_H_
+#define MOZC_SESSION_SESSION_LATENCY_STATS_H_
+
+#include <string>
+#include <vector>
+
+#include "base/port.h"
+
+namespace mozc {
+
+namespace commands {
+class Command;
+class Output;
+}  // namespace commands
+
+namespace session {
+
+class SessionLatencyStats {
+ public:
+  SessionLatencyStats();
+  ~SessionLatencyStats();
+
+  // Records the latency of |command|, which has been evaluated.  The output
+  // is used to break down SEND_KEY and SEND_KEYS.
+  void Record(const commands::Command &command, uint64 microseconds);
+
+  // Appends the stats of the kinds of the commands recorded at least once to
+  // |output|.
+  void FillStats(commands::Output *output) const;
+
+  void Reset();
+
+  // Returns the kind of |command| as listed in CommandLatencyStats.command.
+  static string GetCommandKind(const commands::Command &command);
+
+  // Returns the index of the bucket for |microseconds|, and the largest value
+  // of the bucket of |index|.
+  static size_t GetBucketIndex(uint64 microseconds);
+  static uint64 GetBucketUpperBound(size_t index);
+
+ private:
+  static const size_t kNumBuckets = 124;
+
+  struct Histogram {
+    uint64 count;
+    uint64 total_microseconds;
+    uint64 max_microseconds;
+    uint32 buckets[kNumBuckets];
+  };
+
+  // Returns the index of the histogram for |command|.
+  static size_t GetHistogramIndex(const commands::Command &command);
+
+  std::vector<Histogram> histograms_;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionLatencyStats);
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_SESSION_LATENCY_STATS_H_
@@ -0,0 +1,125 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_latency_stats.h"
+
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+commands::Command MakeSendCommand(commands::SessionCommand::CommandType type) {
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  command.mutable_input()->mutable_command()->set_type(type);
+  return command;
+}
+
+TEST(SessionLatencyStatsTest, Buckets) {
+  for (uint64 value = 0; value < 100000; ++value) {
+    const size_t index = SessionLatencyStats::GetBucketIndex(value);
+    EXPECT_LE(value, SessionLatencyStats::GetBucketUpperBound(index));
+    if (index > 0) {
+      EXPECT_GT(value, SessionLatencyStats::GetBucketUpperBound(index - 1));
+    }
+    // The buckets are at most 25% wider than their smallest value.
+    EXPECT_LE(SessionLatencyStats::GetBucketUpperBound(index),
+              value + value / 4 + 1);
+  }
+  EXPECT_EQ(kuint64max, SessionLatencyStats::GetBucketUpperBound(
+      SessionLatencyStats::GetBucketIndex(kuint64max)));
+}
+
+TEST(SessionLatencyStatsTest, GetCommandKind) {
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_CONFIG);
+  EXPECT_EQ("GET_CONFIG", SessionLatencyStats::GetCommandKind(command));
+
+  EXPECT_EQ("SEND_COMMAND:SUBMIT", SessionLatencyStats::GetCommandKind(
+      MakeSendCommand(commands::SessionCommand::SUBMIT)));
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_KEY);
+  EXPECT_EQ("SEND_KEY:NO_CANDIDATES",
+            SessionLatencyStats::GetCommandKind(command));
+  command.mutable_output()->mutable_candidates()->set_category(
+      commands::SUGGESTION);
+  EXPECT_EQ("SEND_KEY:SUGGESTION",
+            SessionLatencyStats::GetCommandKind(command));
+  command.mutable_input()->set_type(commands::Input::SEND_KEYS);
+  EXPECT_EQ("SEND_KEYS:SUGGESTION",
+            SessionLatencyStats::GetCommandKind(command));
+}
+
+TEST(SessionLatencyStatsTest, FillStats) {
+  SessionLatencyStats stats;
+  const commands::Command submit =
+      MakeSendCommand(commands::SessionCommand::SUBMIT);
+  for (uint64 i = 1; i <= 100; ++i) {
+    stats.Record(submit, i * 100);
+  }
+  const commands::Command revert =
+      MakeSendCommand(commands::SessionCommand::REVERT);
+  stats.Record(revert, 10);
+
+  commands::Output output;
+  stats.FillStats(&output);
+  ASSERT_EQ(2, output.command_latency_stats_size());
+
+  // The stats are in the order of the session command types.
+  EXPECT_EQ("SEND_COMMAND:REVERT", output.command_latency_stats(0).command());
+  EXPECT_EQ(1, output.command_latency_stats(0).count());
+  EXPECT_EQ(10, output.command_latency_stats(0).p50_microseconds());
+  EXPECT_EQ(10, output.command_latency_stats(0).p99_microseconds());
+
+  const commands::CommandLatencyStats &submit_stats =
+      output.command_latency_stats(1);
+  EXPECT_EQ("SEND_COMMAND:SUBMIT", submit_stats.command());
+  EXPECT_EQ(100, submit_stats.count());
+  EXPECT_EQ(505000, submit_stats.total_microseconds());
+  EXPECT_EQ(10000, submit_stats.max_microseconds());
+  EXPECT_LE(5000, submit_stats.p50_microseconds());
+  EXPECT_GE(5000 * 5 / 4, submit_stats.p50_microseconds());
+  EXPECT_LE(9500, submit_stats.p95_microseconds());
+  EXPECT_GE(10000, submit_stats.p95_microseconds());
+  EXPECT_LE(9900, submit_stats.p99_microseconds());
+  EXPECT_GE(10000, submit_stats.p99_microseconds());
+
+  stats.Reset();
+  output.Clear();
+  stats.FillStats(&output);
+  EXPECT_EQ(0, output.command_latency_stats_size());
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,196 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_map.h"
+
+#include <limits>
+#include <utility>
+
+#include "base/logging.h"
+#include "session/session_interface.h"
+
+namespace mozc {
+namespace session {
+
+SessionMap::SessionMap(size_t max_size, size_t num_shards)
+    : max_size_(max_size), access_count_(0), size_(0) {
+  DCHECK_GT(max_size_, 0);
+  DCHECK_GT(num_shards, 0);
+  for (size_t i = 0; i < num_shards; ++i) {
+    shards_.emplace_back(new Shard);
+  }
+}
+
+SessionMap::~SessionMap() {
+  Clear();
+}
+
+SessionMap::Shard *SessionMap::GetShard(SessionID id) const {
+  return shards_[id % shards_.size()].get();
+}
+
+std::shared_ptr<SessionInterface> SessionMap::Lookup(SessionID id) {
+  Shard *shard = GetShard(id);
+  scoped_lock lock(&shard->mutex);
+  auto iter = shard->entries.find(id);
+  if (iter == shard->entries.end()) {
+    return nullptr;
+  }
+  iter->second.last_access = ++access_count_;
+  return iter->second.session;
+}
+
+std::shared_ptr<SessionInterface> SessionMap::LookupWithoutUpdate(
+    SessionID id) const {
+  const Shard *shard = GetShard(id);
+  scoped_lock lock(&shard->mutex);
+  auto iter = shard->entries.find(id);
+  if (iter == shard->entries.end()) {
+    return nullptr;
+  }
+  return iter->second.session;
+}
+
+bool SessionMap::HasKey(SessionID id) const {
+  const Shard *shard = GetShard(id);
+  scoped_lock lock(&shard->mutex);
+  return shard->entries.count(id) > 0;
+}
+
+void SessionMap::Insert(SessionID id,
+                        std::shared_ptr<SessionInterface> session,
+                        SessionID *evicted_id) {
+  DCHECK(evicted_id);
+  scoped_lock insert_lock(&insert_mutex_);
+  *evicted_id = 0;
+  if (size_ >= max_size_) {
+    *evicted_id = EraseOldest();
+  }
+
+  Shard *shard = GetShard(id);
+  scoped_lock lock(&shard->mutex);
+  Entry &entry = shard->entries[id];
+  if (entry.session == nullptr) {
+    ++size_;
+  }
+  entry.session = std::move(session);
+  entry.last_access = ++access_count_;
+}
+
+bool SessionMap::Erase(SessionID id) {
+  std::shared_ptr<SessionInterface> session;
+  {
+    Shard *shard = GetShard(id);
+    scoped_lock lock(&shard->mutex);
+    auto iter = shard->entries.find(id);
+    if (iter == shard->entries.end()) {
+      return false;
+    }
+    // The session is deleted after the lock is released.
+    session = std::move(iter->second.session);
+    shard->entries.erase(iter);
+    --size_;
+  }
+  return true;
+}
+
+SessionID SessionMap::EraseOldest() {
+  while (true) {
+    Shard *oldest_shard = nullptr;
+    SessionID oldest_id = 0;
+    uint64 oldest_access = std::numeric_limits<uint64>::max();
+    for (const auto &shard : shards_) {
+      scoped_lock lock(&shard->mutex);
+      for (const auto &id_and_entry : shard->entries) {
+        if (id_and_entry.second.last_access < oldest_access) {
+          oldest_shard = shard.get();
+          oldest_id = id_and_entry.first;
+          oldest_access = id_and_entry.second.last_access;
+        }
+      }
+    }
+    if (oldest_shard == nullptr) {
+      return 0;
+    }
+
+    std::shared_ptr<SessionInterface> session;
+    {
+      scoped_lock lock(&oldest_shard->mutex);
+      auto iter = oldest_shard->entries.find(oldest_id);
+      // Retry if the session is used or erased by the other thread after the
+      // scan.
+      if (iter == oldest_shard->entries.end() ||
+          iter->second.last_access != oldest_access) {
+        continue;
+      }
+      session = std::move(iter->second.session);
+      oldest_shard->entries.erase(iter);
+      --size_;
+    }
+    return oldest_id;
+  }
+}
+
+void SessionMap::Clear() {
+  for (const auto &shard : shards_) {
+    std::unordered_map<SessionID, Entry> entries;
+    {
+      scoped_lock lock(&shard->mutex);
+      entries.swap(shard->entries);
+      size_ -= entries.size();
+    }
+  }
+}
+
+void SessionMap::ForEach(
+    const std::function<void(SessionID, SessionInterface *)> &callback)
+    const {
+  for (const auto &shard : shards_) {
+    scoped_lock lock(&shard->mutex);
+    for (const auto &id_and_entry : shard->entries) {
+      callback(id_and_entry.first, id_and_entry.second.session.get());
+    }
+  }
+}
+
+size_t SessionMap::GetAllocatedBytes() const {
+  // Each node of the hash tables holds the pair and the pointer to the next
+  // node.
+  size_t bytes = 0;
+  for (const auto &shard : shards_) {
+    scoped_lock lock(&shard->mutex);
+    bytes += sizeof(Shard) + shard->entries.bucket_count() * sizeof(void *) +
+             shard->entries.size() *
+                 (sizeof(std::pair<const SessionID, Entry>) + sizeof(void *));
+  }
+  return bytes;
+}
+
+}  // namespace session
+}  // namespace mozc
@@ -0,0 +1,126 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// A map from SessionID to sessions for SessionHandler.  The sessions are
+// distributed to shards by the ID, which is random, and each shard has its
+// own lock so that the commands of different sessions can look up their
+// sessions concurrently.  The LRU order is kept over all the shards with a
+// global access counter, so that the least recently used session is evicted
+// deterministically when the map is full.
+
+#ifndef MOZC_SESSION_SESSION_MAP_H_
+#define MOZC_SESSION_SESSION_MAP_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/port.h"
+#include "session/common.h"
+
+namespace mozc {
+namespace session {
+
+class SessionInterface;
+
+class SessionMap {
+ public:
+  // |max_size| is the maximum number of sessions and |num_shards| is the
+  // number of the shards.
+  SessionMap(size_t max_size, size_t num_shards);
+  ~SessionMap();
+
+  // Returns the session of |id| and marks it as the most recently used one.
+  // Returns nullptr if not found.  The returned session stays alive even if
+  // it is erased from the map by the other thread.
+  std::shared_ptr<SessionInterface> Lookup(SessionID id);
+
+  // Same as Lookup() but doesn't change the LRU order.
+  std::shared_ptr<SessionInterface> LookupWithoutUpdate(SessionID id) const;
+
+  bool HasKey(SessionID id) const;
+
+  // Inserts |session| as the most recently used one.  If the map is full, the
+  // least recently used session is erased and its ID is stored to
+  // |evicted_id|.  Otherwise |evicted_id| is set to 0.
+  void Insert(SessionID id, std::shared_ptr<SessionInterface> session,
+              SessionID *evicted_id);
+
+  // Returns true if the session of |id| is erased.
+  bool Erase(SessionID id);
+
+  void Clear();
+
+  size_t Size() const { return size_.load(); }
+
+  // Returns the bytes of the hash tables of the shards, not including the
+  // sessions.
+  size_t GetAllocatedBytes() const;
+
+  // Calls |callback| for each session.  The shard of the session is locked
+  // during the callback, so the callback must not access this map.
+  void ForEach(
+      const std::function<void(SessionID, SessionInterface *)> &callback)
+      const;
+
+ private:
+  struct Entry {
+    std::shared_ptr<SessionInterface> session;
+    // The value of access_count_ when the session is used last time.
+    uint64 last_access;
+  };
+
+  struct Shard {
+    mutable Mutex mutex;
+    std::unordered_map<SessionID, Entry> entries;
+  };
+
+  Shard *GetShard(SessionID id) const;
+
+  // Erases the least recently used session and returns its ID.  Returns 0 if
+  // the map is empty.
+  SessionID EraseOldest();
+
+  const size_t max_size_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64> access_count_;
+  std::atomic<size_t> size_;
+  // Serializes Insert() so that the size doesn't exceed max_size_.
+  Mutex insert_mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionMap);
+};
+
+}  // namespace session
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_SESSION_MAP_H_
@@ -0,0 +1,185 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_map.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "base/thread.h"
+#include "protocol/commands.pb.h"
+#include "session/session_interface.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+class SessionStub : public SessionInterface {
+ public:
+  explicit SessionStub(int *num_deleted) : num_deleted_(num_deleted) {}
+  ~SessionStub() override { ++*num_deleted_; }
+
+  bool SendKey(commands::Command *command) override { return true; }
+  bool TestSendKey(commands::Command *command) override { return true; }
+  bool SendCommand(commands::Command *command) override { return true; }
+  void SetConfig(const config::Config *config) override {}
+  void set_client_capability(
+      const commands::Capability &capability) override {}
+  void set_application_info(
+      const commands::ApplicationInfo &application_info) override {}
+  const commands::ApplicationInfo &application_info() const override {
+    return commands::ApplicationInfo::default_instance();
+  }
+  uint64 create_session_time() const override { return 0; }
+  uint64 last_command_time() const override { return 0; }
+
+ private:
+  int *num_deleted_;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionStub);
+};
+
+TEST(SessionMapTest, InsertLookupAndErase) {
+  int num_deleted = 0;
+  SessionMap session_map(4, 3);
+  SessionID evicted_id = 0;
+  for (SessionID id = 1; id <= 3; ++id) {
+    session_map.Insert(
+        id, std::make_shared<SessionStub>(&num_deleted), &evicted_id);
+    EXPECT_EQ(0, evicted_id);
+  }
+  EXPECT_EQ(3, session_map.Size());
+  EXPECT_TRUE(session_map.HasKey(2));
+  EXPECT_FALSE(session_map.HasKey(4));
+  EXPECT_NE(nullptr, session_map.Lookup(3));
+  EXPECT_EQ(nullptr, session_map.Lookup(4));
+
+  std::vector<SessionID> ids;
+  session_map.ForEach([&ids](SessionID id, SessionInterface *session) {
+    ids.push_back(id);
+  });
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ((std::vector<SessionID>{1, 2, 3}), ids);
+
+  // A session is deleted when it is erased and no one uses it.
+  std::shared_ptr<SessionInterface> session = session_map.Lookup(1);
+  EXPECT_TRUE(session_map.Erase(1));
+  EXPECT_FALSE(session_map.Erase(1));
+  EXPECT_EQ(2, session_map.Size());
+  EXPECT_EQ(0, num_deleted);
+  session.reset();
+  EXPECT_EQ(1, num_deleted);
+
+  session_map.Clear();
+  EXPECT_EQ(0, session_map.Size());
+  EXPECT_EQ(3, num_deleted);
+}
+
+TEST(SessionMapTest, EvictLeastRecentlyUsed) {
+  int num_deleted = 0;
+  // The sessions of the same shard and the different shards are evicted in
+  // the LRU order.
+  SessionMap session_map(3, 2);
+  SessionID evicted_id = 0;
+  session_map.Insert(10, std::make_shared<SessionStub>(&num_deleted),
+                     &evicted_id);
+  session_map.Insert(11, std::make_shared<SessionStub>(&num_deleted),
+                     &evicted_id);
+  session_map.Insert(12, std::make_shared<SessionStub>(&num_deleted),
+                     &evicted_id);
+  EXPECT_EQ(0, evicted_id);
+
+  session_map.Lookup(10);
+  session_map.Insert(13, std::make_shared<SessionStub>(&num_deleted),
+                     &evicted_id);
+  EXPECT_EQ(11, evicted_id);
+  EXPECT_EQ(1, num_deleted);
+
+  session_map.Insert(14, std::make_shared<SessionStub>(&num_deleted),
+                     &evicted_id);
+  EXPECT_EQ(12, evicted_id);
+
+  session_map.Lookup(10);
+  session_map.Insert(15, std::make_shared<SessionStub>(&num_deleted),
+                     &evicted_id);
+  EXPECT_EQ(13, evicted_id);
+  EXPECT_EQ(3, session_map.Size());
+  EXPECT_TRUE(session_map.HasKey(10));
+  EXPECT_TRUE(session_map.HasKey(14));
+  EXPECT_TRUE(session_map.HasKey(15));
+}
+
+class LookupThread : public Thread {
+ public:
+  LookupThread(SessionMap *session_map, SessionID first_id)
+      : session_map_(session_map), first_id_(first_id), num_found_(0) {}
+
+  void Run() override {
+    for (int i = 0; i < 10000; ++i) {
+      if (session_map_->Lookup(first_id_ + i % 4) != nullptr) {
+        ++num_found_;
+      }
+    }
+  }
+
+  int num_found() const { return num_found_; }
+
+ private:
+  SessionMap *session_map_;
+  const SessionID first_id_;
+  int num_found_;
+};
+
+TEST(SessionMapTest, ConcurrentLookup) {
+  int num_deleted = 0;
+  SessionMap session_map(8, 4);
+  SessionID evicted_id = 0;
+  for (SessionID id = 1; id <= 8; ++id) {
+    session_map.Insert(id, std::make_shared<SessionStub>(&num_deleted),
+                       &evicted_id);
+  }
+
+  LookupThread thread1(&session_map, 1);
+  LookupThread thread2(&session_map, 5);
+  thread1.SetJoinable(true);
+  thread2.SetJoinable(true);
+  thread1.Start("LookupThread1");
+  thread2.Start("LookupThread2");
+  thread1.Join();
+  thread2.Join();
+  EXPECT_EQ(10000, thread1.num_found());
+  EXPECT_EQ(10000, thread2.num_found());
+  EXPECT_EQ(8, session_map.Size());
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
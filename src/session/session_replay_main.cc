@@ -0,0 +1,308 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Replays recorded inputs against SessionHandler::EvalCommand in-process,
+// to profile the engine without the noise of the IPC.  The time of each
+// stage comes from the spans of base/trace.h.
+//
+// The input is either of:
+//   --input_format=keys: the key per line format of session/testdata, as
+//     session_client_main reads.
+//   --input_format=inputs: a commands::Input in the protobuf text format per
+//     line, e.g. "type: SEND_KEY key { key_code: 97 }".
+// A blank line starts a new session.  The session ID of the inputs is
+// replaced with the one of the replayed session.
+//
+// Example:
+//   session_replay_main --input=session/testdata/input.txt --repeat=10 --cpu=2
+//       --profile_dir=/tmp/mozc_replay
+//
+// With --access_profile_output, the entries of the data set touched by the
+// measured replays are written in the format of base/access_profiler.h, which
+// the data generators read to place the hot entries together.
+
+#ifdef OS_LINUX
+#include <sched.h>
+#endif  // OS_LINUX
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/access_profiler.h"
+#include "base/file_stream.h"
+#include "base/file_util.h"
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/perf_counter.h"
+#include "base/port.h"
+#include "base/protobuf/text_format.h"
+#include "base/stopwatch.h"
+#include "base/system_util.h"
+#include "base/trace.h"
+#include "base/util.h"
+#include "composer/key_parser.h"
+#include "engine/engine_factory.h"
+#include "engine/engine_interface.h"
+#include "protocol/commands.pb.h"
+#include "session/session_handler.h"
+
+DEFINE_string(input, "", "Input file");
+DEFINE_string(input_format, "keys", "Input format: keys or inputs");
+DEFINE_string(profile_dir, "", "Profile dir");
+DEFINE_int32(repeat, 1, "Number of the replays of the input");
+DEFINE_int32(warmup_repeat, 1,
+             "Number of the replays before the measured ones");
+DEFINE_int32(cpu, -1, "Pin the thread to this CPU if non-negative (Linux)");
+DEFINE_bool(quiet, true, "Disable the logging during the replay");
+DEFINE_bool(trace_phases, true, "Report the time of each traced stage");
+DEFINE_string(access_profile_output, "",
+              "Write the access profile of the data set to this file");
+
+namespace mozc {
+namespace {
+
+typedef std::vector<commands::Input> Session;
+
+bool LoadSessions(std::istream *input, std::vector<Session> *sessions) {
+  sessions->assign(1, Session());
+  string line;
+  while (std::getline(*input, line)) {
+    Util::ChopReturns(&line);
+    if (line.size() > 1 && line[0] == '#' && line[1] == '#') {
+      continue;
+    }
+    if (line.empty()) {
+      if (!sessions->back().empty()) {
+        sessions->push_back(Session());
+      }
+      continue;
+    }
+    commands::Input command_input;
+    if (FLAGS_input_format == "inputs") {
+      if (!protobuf::TextFormat::ParseFromString(line, &command_input)) {
+        LOG(ERROR) << "cannot parse: " << line;
+        return false;
+      }
+    } else {
+      command_input.set_type(commands::Input::SEND_KEY);
+      if (!KeyParser::ParseKey(line, command_input.mutable_key())) {
+        LOG(ERROR) << "cannot parse: " << line;
+        return false;
+      }
+    }
+    sessions->back().push_back(command_input);
+  }
+  if (sessions->back().empty()) {
+    sessions->pop_back();
+  }
+  return true;
+}
+
+struct PhaseStats {
+  PhaseStats() : count(0), total_usec(0.0), max_usec(0.0) {}
+  uint64 count;
+  double total_usec;
+  double max_usec;
+};
+
+// Adds the spans recorded since the last call to |phases|, and discards them
+// so that the buffers of the trace do not overflow.
+void CollectPhases(std::map<string, PhaseStats> *phases) {
+  std::vector<Trace::SpanRecord> spans;
+  Trace::GetSpans(&spans);
+  Trace::SetEnabled(false);
+  Trace::SetEnabled(true);
+  const double usec_per_tick = 1000000.0 / PerfCounter::GetFrequency();
+  for (size_t i = 0; i < spans.size(); ++i) {
+    const double usec =
+        (spans[i].end_ticks - spans[i].begin_ticks) * usec_per_tick;
+    PhaseStats *stats = &(*phases)[spans[i].name];
+    ++stats->count;
+    stats->total_usec += usec;
+    stats->max_usec = max(stats->max_usec, usec);
+  }
+}
+
+class Replayer {
+ public:
+  explicit Replayer(const std::vector<Session> &sessions)
+      : sessions_(sessions),
+        handler_(std::unique_ptr<EngineInterface>(EngineFactory::Create())) {}
+
+  // Replays all the sessions and returns the total time of EvalCommand in
+  // microseconds.
+  double Replay(std::map<string, PhaseStats> *phases) {
+    double total_usec = 0.0;
+    commands::Command command;
+    for (size_t i = 0; i < sessions_.size(); ++i) {
+      command.Clear();
+      command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+      CHECK(handler_.EvalCommand(&command));
+      const uint64 id = command.output().id();
+      for (size_t j = 0; j < sessions_[i].size(); ++j) {
+        command.Clear();
+        *command.mutable_input() = sessions_[i][j];
+        command.mutable_input()->set_id(id);
+        Stopwatch stopwatch = Stopwatch::StartNew();
+        handler_.EvalCommand(&command);
+        stopwatch.Stop();
+        total_usec += stopwatch.GetElapsedMicroseconds();
+        if (phases != nullptr) {
+          CollectPhases(phases);
+        }
+      }
+      command.Clear();
+      command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+      command.mutable_input()->set_id(id);
+      handler_.EvalCommand(&command);
+    }
+    return total_usec;
+  }
+
+  // Returns the latency stats of the commands, and clears them.
+  void GetLatencyStats(commands::Output *output) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::GET_LATENCY_STATS);
+    handler_.EvalCommand(&command);
+    output->Swap(command.mutable_output());
+    command.Clear();
+    command.mutable_input()->set_type(commands::Input::RESET_LATENCY_STATS);
+    handler_.EvalCommand(&command);
+  }
+
+ private:
+  const std::vector<Session> &sessions_;
+  SessionHandler handler_;
+
+  DISALLOW_COPY_AND_ASSIGN(Replayer);
+};
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+
+  if (!FLAGS_profile_dir.empty()) {
+    mozc::FileUtil::CreateDirectory(FLAGS_profile_dir);
+    mozc::SystemUtil::SetUserProfileDirectory(FLAGS_profile_dir);
+  }
+
+  mozc::InputFileStream input(FLAGS_input.c_str());
+  if (FLAGS_input.empty() || input.fail()) {
+    std::cerr << "File not opend: " << FLAGS_input << std::endl;
+    return 1;
+  }
+  std::vector<mozc::Session> sessions;
+  if (!mozc::LoadSessions(&input, &sessions)) {
+    return 1;
+  }
+
+#ifdef OS_LINUX
+  if (FLAGS_cpu >= 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(FLAGS_cpu, &cpu_set);
+    if (::sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+      std::cerr << "sched_setaffinity() failed" << std::endl;
+      return 1;
+    }
+  }
+#endif  // OS_LINUX
+
+  if (FLAGS_quiet) {
+    FLAGS_logtostderr = false;
+    mozc::Logging::CloseLogStream();
+    mozc::Logging::SetVerboseLevel(0);
+  }
+
+  mozc::Replayer replayer(sessions);
+  for (int i = 0; i < FLAGS_warmup_repeat; ++i) {
+    replayer.Replay(nullptr);
+  }
+  mozc::commands::Output output;
+  replayer.GetLatencyStats(&output);
+
+  std::map<string, mozc::PhaseStats> phases;
+  if (FLAGS_trace_phases) {
+    mozc::Trace::SetEnabled(true);
+  }
+  if (!FLAGS_access_profile_output.empty()) {
+    mozc::AccessProfiler::SetEnabled(true);
+  }
+  double total_usec = 0.0;
+  for (int i = 0; i < FLAGS_repeat; ++i) {
+    total_usec += replayer.Replay(FLAGS_trace_phases ? &phases : nullptr);
+  }
+  mozc::Trace::SetEnabled(false);
+  mozc::AccessProfiler::SetEnabled(false);
+  if (!FLAGS_access_profile_output.empty()) {
+    mozc::OutputFileStream profile(FLAGS_access_profile_output.c_str());
+    if (!profile) {
+      std::cerr << "File not opend: " << FLAGS_access_profile_output
+                << std::endl;
+      return 1;
+    }
+    mozc::AccessProfiler::Write(&profile);
+  }
+  replayer.GetLatencyStats(&output);
+
+  std::cout << mozc::Util::StringPrintf(
+      "sessions=%d repeat=%d total=%.0fus", static_cast<int>(sessions.size()),
+      FLAGS_repeat, total_usec) << std::endl;
+  std::cout << "## Commands (usec)" << std::endl;
+  for (int i = 0; i < output.command_latency_stats_size(); ++i) {
+    const mozc::commands::CommandLatencyStats &stats =
+        output.command_latency_stats(i);
+    std::cout << stats.command() << ": count=" << stats.count()
+              << " total=" << stats.total_microseconds()
+              << " p50=" << stats.p50_microseconds()
+              << " p95=" << stats.p95_microseconds()
+              << " p99=" << stats.p99_microseconds()
+              << " max=" << stats.max_microseconds() << std::endl;
+  }
+  if (FLAGS_trace_phases) {
+    // The phases are nested, e.g. Session::SendKey includes the converter.
+    std::cout << "## Phases (usec)" << std::endl;
+    for (std::map<string, mozc::PhaseStats>::const_iterator it =
+             phases.begin(); it != phases.end(); ++it) {
+      std::cout << mozc::Util::StringPrintf(
+          "%s: count=%d total=%.0f avg=%.1f max=%.0f", it->first.c_str(),
+          static_cast<int>(it->second.count), it->second.total_usec,
+          it->second.total_usec / it->second.count, it->second.max_usec)
+                << std::endl;
+    }
+  }
+  return 0;
+}
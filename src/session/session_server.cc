@@ -37,6 +37,7 @@
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/scheduler.h"
+#include "base/trace.h"
 #include "engine/engine_factory.h"
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
@@ -57,18 +58,40 @@ const int kNumConnections   = 10;
 #endif  // OS_WIN
 
 const int kTimeOut = 5000;  // 5000msec
+
+// The initial block of the arena, which holds the command of a usual
+// request including the candidate window.
+const size_t kArenaBlockSize = 256 * 1024;
+
 const char kSessionName[] = "session";
 const char kEventName[] = "session";
 
 }  // namespace
 
 namespace mozc {
+namespace {
+
+protobuf::ArenaOptions GetArenaOptions(char *initial_block) {
+  protobuf::ArenaOptions options;
+  options.initial_block = initial_block;
+  options.initial_block_size = kArenaBlockSize;
+  options.start_block_size = kArenaBlockSize;
+  options.max_block_size = kArenaBlockSize;
+  return options;
+}
+
+}  // namespace
 
 SessionServer::SessionServer()
     : IPCServer(kSessionName, kNumConnections, kTimeOut),
+      arena_block_(new char[kArenaBlockSize]),
+      arena_(new protobuf::Arena(GetArenaOptions(arena_block_.get()))),
       usage_observer_(new session::SessionUsageObserver()),
-      session_handler_(new SessionHandler(
-      std::unique_ptr<Engine>(EngineFactory::Create()))) {
+      // The engine is loaded in the background so that the clients don't
+      // wait for the connection.  See SessionHandler.
+      session_handler_(new SessionHandler([]() {
+        return std::unique_ptr<EngineInterface>(EngineFactory::Create());
+      })) {
   using usage_stats::UsageStatsUploader;
   // start session watch dog timer
   session_handler_->StartWatchDog();
@@ -85,7 +108,13 @@ SessionServer::SessionServer()
       &UsageStatsUploader::Send,
       nullptr));
 
-  // Send a notification event to the UI.
+  // Send a notification event to the UI.  The listener is already up here,
+  // so the waiting client can connect immediately.  The engine is still
+  // being loaded in the background.
+  if (!IPCServer::Connected()) {
+    LOG(ERROR) << "IPCServer is not available";
+    return;
+  }
   NamedEventNotifier notifier(kEventName);
   if (!notifier.Notify()) {
     LOG(WARNING) << "NamedEvent " << kEventName << " is not found";
@@ -109,40 +138,56 @@ bool SessionServer::Process(const char *request,
     return false;   // shutdown the server if handler doesn't exist
   }
 
-  commands::Command command;   // can define as a private member?
-  if (!command.mutable_input()->ParseFromArray(request, request_size)) {
+  // Free the command of the previous request, keeping the blocks of the
+  // arena for this one.
+  const uint64 arena_size = arena_->Reset();
+  VLOG(2) << "Arena: " << arena_size << " bytes allocated";
+
+  commands::Command *command =
+      protobuf::Arena::CreateMessage<commands::Command>(arena_.get());
+  bool parsed = false;
+  {
+    MOZC_TRACE_SPAN("SessionServer::ParseInput");
+    parsed = command->mutable_input()->ParseFromArray(request, request_size);
+  }
+  if (!parsed) {
     LOG(WARNING) << "Invalid request";
     *response_size = 0;
     return true;
   }
 
-  if (!session_handler_->EvalCommand(&command)) {
+  if (!session_handler_->EvalCommand(command)) {
     LOG(WARNING) << "EvalCommand() returned false. Exiting the loop.";
     *response_size = 0;
     return false;
   }
 
-  string output;
-  if (!command.output().SerializeToString(&output)) {
-    LOG(WARNING) << "SerializeToString() failed";
-    *response_size = 0;
-    return true;
-  }
+  // Serialize into |response| directly instead of a temporary string.
+  MOZC_TRACE_SPAN("SessionServer::SerializeOutput");
+  const size_t output_size = command->output().ByteSize();
 
   // TODO(taku) automatically increase the buffer.
   // Needs to fix IPCServer as well
-  if (*response_size < output.size()) {
+  if (*response_size < output_size) {
     LOG(WARNING) << "response size < output.size";
     *response_size = 0;
     return true;
   }
 
-  ::memcpy(response, output.data(), output.size());
-  *response_size = output.size();
+  if (!command->output().SerializeToArray(response, output_size)) {
+    LOG(WARNING) << "SerializeToArray() failed";
+    *response_size = 0;
+    return true;
+  }
+  *response_size = output_size;
 
   // debug message
-  VLOG(2) << command.DebugString();
+  VLOG(2) << command->DebugString();
 
   return true;
 }
+
+bool SessionServer::DoIdleWork() {
+  return session_handler_ && session_handler_->DoIdleWork();
+}
 }  // namespace mozc
@@ -35,6 +35,7 @@
 #include <memory>
 
 #include "base/port.h"
+#include "base/protobuf/arena.h"
 #include "ipc/ipc.h"
 
 namespace mozc {
@@ -67,7 +68,15 @@ class SessionServer: public IPCServer {
                char *response,
                size_t *response_size) override;
 
+  // Precomputes the conversion for the next command.
+  bool DoIdleWork() override;
+
  private:
+  // The command of a request is allocated on |arena_|, which is reset after
+  // each request.  The arena starts with |arena_block_| so that a usual
+  // request allocates nothing from the heap.
+  std::unique_ptr<char[]> arena_block_;
+  std::unique_ptr<protobuf::Arena> arena_;
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
   std::unique_ptr<SessionHandlerInterface> session_handler_;
 
@@ -35,6 +35,8 @@
 
 #include "base/scheduler.h"
 #include "base/system_util.h"
+#include "ipc/ipc.h"
+#include "protocol/commands.pb.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -80,4 +82,52 @@ TEST_F(SessionServerTest, SetSchedulerJobTest) {
   EXPECT_TRUE(job_recorder->HasJob("SaveCachedStats"));
   Scheduler::SetSchedulerHandler(NULL);
 }
+
+TEST_F(SessionServerTest, Process) {
+  std::unique_ptr<JobRecorder> job_recorder(new JobRecorder);
+  Scheduler::SetSchedulerHandler(job_recorder.get());
+  std::unique_ptr<SessionServer> session_server(new SessionServer);
+  std::unique_ptr<char[]> response(new char[IPC_RESPONSESIZE]);
+
+  commands::Input input;
+  input.set_type(commands::Input::CREATE_SESSION);
+  string request;
+  input.SerializeToString(&request);
+  size_t response_size = IPC_RESPONSESIZE;
+  ASSERT_TRUE(session_server->Process(request.data(), request.size(),
+                                      response.get(), &response_size));
+  commands::Output output;
+  ASSERT_TRUE(output.ParseFromArray(response.get(), response_size));
+  EXPECT_EQ(commands::Output::SESSION_SUCCESS, output.error_code());
+  const uint64 id = output.id();
+
+  // The arena is reused by the following requests.
+  for (int i = 0; i < 3; ++i) {
+    input.Clear();
+    input.set_type(commands::Input::SEND_KEY);
+    input.set_id(id);
+    input.mutable_key()->set_key_code('a');
+    input.SerializeToString(&request);
+    response_size = IPC_RESPONSESIZE;
+    ASSERT_TRUE(session_server->Process(request.data(), request.size(),
+                                        response.get(), &response_size));
+    output.Clear();
+    ASSERT_TRUE(output.ParseFromArray(response.get(), response_size));
+    EXPECT_EQ(id, output.id());
+    EXPECT_TRUE(output.consumed());
+  }
+
+  // Too small buffer for the response.
+  response_size = 1;
+  EXPECT_TRUE(session_server->Process(request.data(), request.size(),
+                                      response.get(), &response_size));
+  EXPECT_EQ(0, response_size);
+
+  // Invalid request.
+  response_size = IPC_RESPONSESIZE;
+  EXPECT_TRUE(session_server->Process("\xFF", 1, response.get(),
+                                      &response_size));
+  EXPECT_EQ(0, response_size);
+  Scheduler::SetSchedulerHandler(NULL);
+}
 }  // namespace mozc
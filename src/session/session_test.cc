@@ -52,6 +52,7 @@
 #include "rewriter/transliteration_rewriter.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/keymap.h"
+#include "session/internal/session_output.h"
 #include "session/request_test_util.h"
 #include "session/session_converter_interface.h"
 #include "testing/base/public/gunit.h"
@@ -911,6 +912,28 @@ TEST_F(SessionTest, TestSendKey) {
   EXPECT_TRUE(command.output().consumed());
 }
 
+TEST_F(SessionTest, TestSendKeyFollowedByAnotherKey) {
+  std::unique_ptr<Session> session(new Session(engine_.get()));
+  InitSessionToPrecomposition(session.get());
+
+  commands::Command command;
+  // The key command looked up for "Up" is not used for "a".
+  TestSendKey("Up", session.get(), &command);
+  EXPECT_FALSE(command.output().consumed());
+  SendKey("a", session.get(), &command);
+  EXPECT_TRUE(command.output().consumed());
+  EXPECT_EQ(kHiraganaA, GetComposition(command));
+
+  // Nor is the one looked up before an intervening command.
+  session.reset(new Session(engine_.get()));
+  InitSessionToPrecomposition(session.get());
+  TestSendKey("a", session.get(), &command);
+  EXPECT_TRUE(command.output().consumed());
+  SendCommand(commands::SessionCommand::TURN_OFF_IME, session.get(), &command);
+  SendKey("a", session.get(), &command);
+  EXPECT_FALSE(command.output().consumed());
+}
+
 TEST_F(SessionTest, SendCommand) {
   std::unique_ptr<Session> session(new Session(engine_.get()));
   InitSessionToPrecomposition(session.get());
@@ -2390,6 +2413,65 @@ TEST_F(SessionTest, OutputAllCandidateWords) {
   }
 }
 
+TEST_F(SessionTest, OutputPageOfCandidateWords) {
+  std::unique_ptr<Session> session(new Session(engine_.get()));
+  InitSessionToPrecomposition(session.get());
+  commands::Request request;
+  request.set_candidate_page_size(4);
+  session->SetRequest(&request);
+  commands::Capability capability;
+  capability.set_page_only_candidate_words(true);
+  session->set_client_capability(capability);
+
+  commands::Command command;
+  Segments segments;
+  SetAiueo(&segments);
+  InsertCharacterChars("aiueo", session.get(), &command);
+
+  ConversionRequest conversion_request;
+  SetComposer(session.get(), &conversion_request);
+  FillT13Ns(conversion_request, &segments);
+  GetConverterMock()->SetStartConversionForRequest(&segments, true);
+
+  command.Clear();
+  session->Convert(&command);
+  {
+    const commands::CandidateList &words =
+        command.output().all_candidate_words();
+    EXPECT_LT(4, words.size());
+    ASSERT_EQ(4, words.candidates_size());
+    EXPECT_EQ(0, words.candidates(0).index());
+    EXPECT_EQ(0, words.focused_index());
+    EXPECT_EQ(commands::CONVERSION, words.category());
+  }
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  command.mutable_input()->mutable_command()->set_type(
+      commands::SessionCommand::GET_CANDIDATE_WORDS_PAGE);
+  command.mutable_input()->mutable_command()->set_candidate_words_page(1);
+  EXPECT_TRUE(session->SendCommand(&command));
+  EXPECT_TRUE(command.output().consumed());
+  {
+    const commands::CandidateList &words =
+        command.output().all_candidate_words();
+    ASSERT_LT(0, words.candidates_size());
+    EXPECT_EQ(4, words.candidates(0).index());
+    EXPECT_FALSE(words.has_focused_index());
+  }
+
+  // The next output has the page of the focused candidate again.
+  command.Clear();
+  session->ConvertNext(&command);
+  {
+    const commands::CandidateList &words =
+        command.output().all_candidate_words();
+    ASSERT_EQ(4, words.candidates_size());
+    EXPECT_EQ(0, words.candidates(0).index());
+    EXPECT_EQ(1, words.focused_index());
+  }
+}
+
 TEST_F(SessionTest, UndoForComposition) {
   Session session(engine_.get());
   InitSessionToPrecomposition(&session);
@@ -2437,6 +2519,40 @@ TEST_F(SessionTest, UndoForComposition) {
   }
 }
 
+TEST_F(SessionTest, EncodeOutputDelta) {
+  Session session(engine_.get());
+  commands::Command command;
+  SessionOutput::AddSegment("a", "A", SessionOutput::PREEDIT,
+                            command.mutable_output()->mutable_preedit());
+  command.mutable_output()->mutable_preedit()->set_cursor(1);
+  const commands::Output output = command.output();
+
+  // The output is left as is unless the client supports it.
+  session.EncodeOutputDelta(&command);
+  EXPECT_FALSE(command.output().has_output_id());
+
+  commands::Capability capability;
+  capability.set_delta_output(true);
+  session.set_client_capability(capability);
+  session.EncodeOutputDelta(&command);
+  EXPECT_EQ(1, command.output().output_id());
+  EXPECT_FALSE(command.output().has_delta());
+
+  command.mutable_input()->set_base_output_id(1);
+  command.mutable_output()->CopyFrom(output);
+  session.EncodeOutputDelta(&command);
+  EXPECT_EQ(2, command.output().output_id());
+  EXPECT_EQ(1, command.output().delta().preedit_kept_segments());
+  EXPECT_EQ(0, command.output().preedit().segment_size());
+
+  // The complete output is sent if the base is not the last one.
+  command.mutable_output()->CopyFrom(output);
+  session.EncodeOutputDelta(&command);
+  EXPECT_EQ(3, command.output().output_id());
+  EXPECT_FALSE(command.output().has_delta());
+  EXPECT_EQ(1, command.output().preedit().segment_size());
+}
+
 TEST_F(SessionTest, RequestUndo) {
   std::unique_ptr<Session> session(new Session(engine_.get()));
 
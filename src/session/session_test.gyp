@@ -155,6 +155,8 @@
       'type': 'executable',
       'sources': [
         'output_util_test.cc',
+        'session_latency_stats_test.cc',
+        'session_map_test.cc',
         'session_observer_handler_test.cc',
         'session_usage_observer_test.cc',
         'session_usage_stats_util_test.cc',
@@ -297,6 +299,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../base/base_test.gyp:clock_mock',
         '../testing/testing.gyp:gtest_main',
         'session_base.gyp:generic_storage_manager',
       ],
@@ -103,6 +103,13 @@ bool IsSessionIndependentCommand(commands::Input::CommandType type) {
     case commands::Input::READ_ALL_FROM_STORAGE:
     case commands::Input::RELOAD:
     case commands::Input::SEND_USER_DICTIONARY_COMMAND:
+    case commands::Input::GET_STORAGE_IO_STATS:
+    case commands::Input::RELEASE_STORAGES:
+    case commands::Input::GET_LATENCY_STATS:
+    case commands::Input::RESET_LATENCY_STATS:
+    case commands::Input::START_TRACE:
+    case commands::Input::STOP_TRACE:
+    case commands::Input::GET_MEMORY_STATS:
       return true;
     default:
       return false;
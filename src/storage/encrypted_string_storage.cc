@@ -39,10 +39,12 @@
 #include "base/encryptor.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/password_manager.h"
 #include "base/util.h"
+#include "storage/ephemeral_mode.h"
 
 namespace mozc {
 namespace storage {
@@ -53,6 +55,45 @@ const size_t kSaltSize = 32;
 
 // Maximum file size (64Mbyte)
 const size_t kMaxFileSize = 64 * 1024 * 1024;
+
+// Size of the header of a record written by Append(), which stores the
+// length of the salt and the encrypted message in little endian.
+const size_t kRecordHeaderSize = 4;
+
+void AppendRecordHeader(uint32 length, string *output) {
+  for (size_t i = 0; i < kRecordHeaderSize; ++i) {
+    output->push_back(static_cast<char>((length >> (8 * i)) & 0xff));
+  }
+}
+
+uint32 ReadRecordHeader(const uint8 *ptr) {
+  uint32 length = 0;
+  for (size_t i = 0; i < kRecordHeaderSize; ++i) {
+    length |= static_cast<uint32>(ptr[i]) << (8 * i);
+  }
+  return length;
+}
+
+// In the ephemeral mode, the data is kept in memory without encryption and
+// the records are stored without salt.
+bool LoadEphemeralRecords(const string &filename,
+                          std::vector<string> *outputs) {
+  string content;
+  if (!EphemeralMode::ReadFile(filename, &content)) {
+    LOG(ERROR) << "cannot open " << filename;
+    return false;
+  }
+  const uint8 *ptr = reinterpret_cast<const uint8 *>(content.data());
+  size_t pos = 0;
+  while (pos + kRecordHeaderSize <= content.size()) {
+    const uint32 length = ReadRecordHeader(ptr + pos);
+    pos += kRecordHeaderSize;
+    DCHECK_LE(length, content.size() - pos);
+    outputs->push_back(content.substr(pos, length));
+    pos += length;
+  }
+  return true;
+}
 }  // namespace
 
 EncryptedStringStorage::EncryptedStringStorage(const string &filename)
@@ -63,15 +104,22 @@ EncryptedStringStorage::~EncryptedStringStorage() {}
 bool EncryptedStringStorage::Load(string *output) const {
   DCHECK(output);
 
+  if (EphemeralMode::IsEnabled()) {
+    return EphemeralMode::ReadFile(filename_, output);
+  }
+
   string salt;
 
   // Reads encrypted message and salt from local file
   {
+    IOStats::ScopedOperation operation(IOStats::ENCRYPTED_STRING_STORAGE,
+                                       IOStats::READ);
     Mmap mmap;
     if (!mmap.Open(filename_.c_str(), "r")) {
       LOG(ERROR) << "cannot open user history file";
       return false;
     }
+    operation.set_bytes(mmap.size());
 
     if (mmap.size() < kSaltSize) {
       LOG(ERROR) << "file size is too small";
@@ -123,6 +171,11 @@ bool EncryptedStringStorage::Decrypt(const string &salt, string *data) const {
 }
 
 bool EncryptedStringStorage::Save(const string &input) const {
+  if (EphemeralMode::IsEnabled()) {
+    EphemeralMode::WriteFile(filename_, input);
+    return true;
+  }
+
   string output, salt;
   // Generate salt.
   salt.resize(kSaltSize);
@@ -135,6 +188,9 @@ bool EncryptedStringStorage::Save(const string &input) const {
 
   // Even if histoy is empty, save to them into a file to
   // make the file empty
+  IOStats::ScopedOperation operation(IOStats::ENCRYPTED_STRING_STORAGE,
+                                     IOStats::WRITE);
+  operation.set_bytes(salt.size() + output.size());
   const string tmp_filename = filename_ + ".tmp";
   {
     OutputFileStream ofs(tmp_filename.c_str(),
@@ -164,6 +220,101 @@ bool EncryptedStringStorage::Save(const string &input) const {
   return true;
 }
 
+bool EncryptedStringStorage::Append(const string &input) const {
+  if (EphemeralMode::IsEnabled()) {
+    string record;
+    AppendRecordHeader(static_cast<uint32>(input.size()), &record);
+    record.append(input);
+    EphemeralMode::AppendToFile(filename_, record);
+    return true;
+  }
+
+  string output, salt;
+  salt.resize(kSaltSize);
+  Util::GetRandomSequence(&salt[0], kSaltSize);
+
+  output.assign(input);
+  if (!Encrypt(salt, &output)) {
+    return false;
+  }
+
+  string header;
+  AppendRecordHeader(static_cast<uint32>(salt.size() + output.size()),
+                     &header);
+
+  IOStats::ScopedOperation operation(IOStats::ENCRYPTED_STRING_STORAGE,
+                                     IOStats::WRITE);
+  operation.set_bytes(header.size() + salt.size() + output.size());
+  {
+    OutputFileStream ofs(filename_.c_str(),
+                         std::ios::out | std::ios::app | std::ios::binary);
+    if (!ofs) {
+      LOG(ERROR) << "failed to write: " << filename_;
+      return false;
+    }
+    ofs.write(header.data(), header.size());
+    ofs.write(salt.data(), salt.size());
+    ofs.write(output.data(), output.size());
+    if (!ofs) {
+      LOG(ERROR) << "failed to append a record to: " << filename_;
+      return false;
+    }
+  }
+
+#ifdef OS_WIN
+  if (!FileUtil::HideFile(filename_)) {
+    LOG(ERROR) << "Cannot make hidden: " << filename_
+               << " " << ::GetLastError();
+  }
+#endif
+
+  return true;
+}
+
+bool EncryptedStringStorage::LoadRecords(std::vector<string> *outputs) const {
+  DCHECK(outputs);
+  outputs->clear();
+
+  if (EphemeralMode::IsEnabled()) {
+    return LoadEphemeralRecords(filename_, outputs);
+  }
+
+  IOStats::ScopedOperation operation(IOStats::ENCRYPTED_STRING_STORAGE,
+                                     IOStats::READ);
+  Mmap mmap;
+  if (!mmap.Open(filename_.c_str(), "r")) {
+    LOG(ERROR) << "cannot open " << filename_;
+    return false;
+  }
+  operation.set_bytes(mmap.size());
+
+  if (mmap.size() > kMaxFileSize) {
+    LOG(ERROR) << "file size is too big.";
+    return false;
+  }
+
+  const uint8 *ptr = reinterpret_cast<const uint8 *>(mmap.begin());
+  size_t pos = 0;
+  while (pos + kRecordHeaderSize <= mmap.size()) {
+    const uint32 length = ReadRecordHeader(ptr + pos);
+    pos += kRecordHeaderSize;
+    if (length < kSaltSize || length > mmap.size() - pos) {
+      LOG(WARNING) << "truncated record in " << filename_;
+      break;
+    }
+    const string salt(mmap.begin() + pos, kSaltSize);
+    string data(mmap.begin() + pos + kSaltSize, length - kSaltSize);
+    pos += length;
+    if (!Decrypt(salt, &data)) {
+      LOG(WARNING) << "broken record in " << filename_;
+      break;
+    }
+    outputs->push_back(data);
+  }
+
+  return true;
+}
+
 bool EncryptedStringStorage::Encrypt(const string &salt, string *data) const {
   DCHECK(data);
 
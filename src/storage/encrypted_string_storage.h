@@ -31,6 +31,7 @@
 #define MOZC_STORAGE_ENCRYPTED_STRING_STORAGE_H_
 
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 
@@ -45,6 +46,8 @@ class StringStorageInterface {
   virtual bool Save(const string &input) const = 0;
 };
 
+// Keeps the string encrypted in a file.  While EphemeralMode is enabled, the
+// string is kept in memory as is instead.
 class EncryptedStringStorage : public StringStorageInterface {
  public:
   explicit EncryptedStringStorage(const string &filename);
@@ -53,6 +56,16 @@ class EncryptedStringStorage : public StringStorageInterface {
   virtual bool Load(string *output) const;
   virtual bool Save(const string &input) const;
 
+  // Encrypts |input| with a new salt and appends it to the file as a record.
+  // The file written by Append() is a sequence of records, which is read by
+  // LoadRecords() instead of Load().
+  virtual bool Append(const string &input) const;
+
+  // Loads the records appended by Append() in order.  A broken record at the
+  // end of the file, e.g., the one partially written before a crash, and the
+  // bytes after it are ignored.
+  virtual bool LoadRecords(std::vector<string> *outputs) const;
+
  protected:
   virtual bool Encrypt(const string &salt, string *data) const;
   virtual bool Decrypt(const string &salt, string *data) const;
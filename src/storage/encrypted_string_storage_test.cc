@@ -31,11 +31,14 @@
 
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/system_util.h"
+#include "storage/ephemeral_mode.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -125,7 +128,64 @@ TEST_F(EncryptedStringStorageTest, Encrypt) {
   EXPECT_LT(original_data.size(), result.size());
   EXPECT_TRUE(result.find(original_data) == string::npos);
 }
+
+TEST_F(EncryptedStringStorageTest, AppendAndLoadRecords) {
+  FileUtil::Unlink(filename_);
+  const char *kRecords[] = {"first record", "second", "third record"};
+  for (size_t i = 0; i < arraysize(kRecords); ++i) {
+    ASSERT_TRUE(storage_->Append(kRecords[i]));
+  }
+
+  std::vector<string> outputs;
+  ASSERT_TRUE(storage_->LoadRecords(&outputs));
+  ASSERT_EQ(arraysize(kRecords), outputs.size());
+  for (size_t i = 0; i < arraysize(kRecords); ++i) {
+    EXPECT_EQ(kRecords[i], outputs[i]);
+  }
+
+  // A record partially written is ignored.
+  {
+    OutputFileStream ofs(filename_.c_str(),
+                         std::ios::out | std::ios::app | std::ios::binary);
+    ofs.write("\xff\x00\x00\x00partial", 11);
+  }
+  ASSERT_TRUE(storage_->LoadRecords(&outputs));
+  EXPECT_EQ(arraysize(kRecords), outputs.size());
+}
 #endif  // OS_ANDROID
 
+TEST_F(EncryptedStringStorageTest, EphemeralMode) {
+  FileUtil::Unlink(filename_);
+  EphemeralMode::SetEnabled(true);
+
+  const char *kData = "abcdefghijklmnopqrstuvwxyz";
+  ASSERT_TRUE(storage_->Save(kData));
+  string output;
+  ASSERT_TRUE(storage_->Load(&output));
+  EXPECT_EQ(kData, output);
+
+  const char *kRecords[] = {"first record", "", "third record"};
+  const string journal_filename = filename_ + ".journal";
+  EncryptedStringStorage journal(journal_filename);
+  for (size_t i = 0; i < arraysize(kRecords); ++i) {
+    ASSERT_TRUE(journal.Append(kRecords[i]));
+  }
+  std::vector<string> outputs;
+  ASSERT_TRUE(journal.LoadRecords(&outputs));
+  ASSERT_EQ(arraysize(kRecords), outputs.size());
+  for (size_t i = 0; i < arraysize(kRecords); ++i) {
+    EXPECT_EQ(kRecords[i], outputs[i]);
+  }
+
+  EXPECT_FALSE(FileUtil::FileExists(filename_));
+  EXPECT_FALSE(FileUtil::FileExists(journal_filename));
+
+  // The data in memory is discarded.
+  EphemeralMode::SetEnabled(false);
+  EphemeralMode::SetEnabled(true);
+  EXPECT_FALSE(storage_->Load(&output));
+  EphemeralMode::SetEnabled(false);
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -0,0 +1,137 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/ephemeral_mode.h"
+
+#include <map>
+#include <string>
+
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+class EphemeralFiles {
+ public:
+  EphemeralFiles() : enabled_(false) {}
+
+  bool enabled() {
+    scoped_lock l(&mutex_);
+    return enabled_;
+  }
+
+  void set_enabled(bool enabled) {
+    scoped_lock l(&mutex_);
+    enabled_ = enabled;
+    if (!enabled_) {
+      files_.clear();
+    }
+  }
+
+  bool Exists(const string &filename) {
+    scoped_lock l(&mutex_);
+    return files_.find(filename) != files_.end();
+  }
+
+  bool Read(const string &filename, string *content) {
+    scoped_lock l(&mutex_);
+    std::map<string, string>::const_iterator it = files_.find(filename);
+    if (it == files_.end()) {
+      return false;
+    }
+    *content = it->second;
+    return true;
+  }
+
+  void Write(const string &filename, const string &content) {
+    scoped_lock l(&mutex_);
+    files_[filename] = content;
+  }
+
+  void Append(const string &filename, const string &content) {
+    scoped_lock l(&mutex_);
+    files_[filename].append(content);
+  }
+
+  void Remove(const string &filename) {
+    scoped_lock l(&mutex_);
+    files_.erase(filename);
+  }
+
+ private:
+  Mutex mutex_;
+  bool enabled_;
+  std::map<string, string> files_;
+
+  DISALLOW_COPY_AND_ASSIGN(EphemeralFiles);
+};
+
+}  // namespace
+
+bool EphemeralMode::IsEnabled() {
+  return Singleton<EphemeralFiles>::get()->enabled();
+}
+
+void EphemeralMode::SetEnabled(bool enabled) {
+  VLOG(1) << "Ephemeral mode: " << enabled;
+  Singleton<EphemeralFiles>::get()->set_enabled(enabled);
+}
+
+bool EphemeralMode::FileExists(const string &filename) {
+  DCHECK(IsEnabled());
+  return Singleton<EphemeralFiles>::get()->Exists(filename);
+}
+
+bool EphemeralMode::ReadFile(const string &filename, string *content) {
+  DCHECK(IsEnabled());
+  DCHECK(content);
+  return Singleton<EphemeralFiles>::get()->Read(filename, content);
+}
+
+void EphemeralMode::WriteFile(const string &filename, const string &content) {
+  DCHECK(IsEnabled());
+  Singleton<EphemeralFiles>::get()->Write(filename, content);
+}
+
+void EphemeralMode::AppendToFile(const string &filename,
+                                 const string &content) {
+  DCHECK(IsEnabled());
+  Singleton<EphemeralFiles>::get()->Append(filename, content);
+}
+
+void EphemeralMode::RemoveFile(const string &filename) {
+  DCHECK(IsEnabled());
+  Singleton<EphemeralFiles>::get()->Remove(filename);
+}
+
+}  // namespace storage
+}  // namespace mozc
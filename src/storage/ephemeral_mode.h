@@ -0,0 +1,70 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_STORAGE_EPHEMERAL_MODE_H_
+#define MOZC_STORAGE_EPHEMERAL_MODE_H_
+
+#include <string>
+
+#include "base/port.h"
+
+namespace mozc {
+namespace storage {
+
+// Process-wide switch to keep all the user data in memory, e.g., on shared
+// kiosk machines and in stress tests, where nothing should be written to the
+// disk.  When it is enabled, LRUStorage, EncryptedStringStorage, Registry and
+// UserDictionaryStorage never touch their files; the "files" written by them
+// are kept by this class instead and are lost when the process exits.
+//
+// The mode should be selected before the engine is created, as the storages
+// check it when they are opened.
+class EphemeralMode {
+ public:
+  static bool IsEnabled();
+
+  // Disabling the mode discards the files kept in memory.
+  static void SetEnabled(bool enabled);
+
+  // Accessors of the files kept in memory.  These are thread safe and can be
+  // used only when the mode is enabled.
+  static bool FileExists(const string &filename);
+  static bool ReadFile(const string &filename, string *content);
+  static void WriteFile(const string &filename, const string &content);
+  static void AppendToFile(const string &filename, const string &content);
+  static void RemoveFile(const string &filename);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(EphemeralMode);
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_EPHEMERAL_MODE_H_
@@ -29,11 +29,14 @@
 
 #include "storage/existence_filter.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cmath>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/port.h"
+#include "base/thread_pool.h"
 
 namespace mozc {
 namespace storage {
@@ -54,6 +57,68 @@ inline uint32 BitsToWords(uint32 bits) {
   return words;
 }
 
+// The size of a block of BLOCKED, which is a cache line on most processors.
+const uint32 kBlockedBitsShift = 9;
+const uint32 kBlockedBits = 1 << kBlockedBitsShift;  // 64 bytes
+const uint32 kBlockedBitsMask = kBlockedBits - 1;
+
+// The number of hashes processed at once by ExistsMany().
+const size_t kExistsManyBatchSize = 16;
+
+// The minimum number of hashes given to each thread by InsertMany().
+const size_t kMinInsertionsPerThread = 1 << 14;
+
+uint32 GetVectorSize(uint32 m, ExistenceFilter::Version version) {
+  if (m == 0) {
+    m = 1;
+  }
+  if (version == ExistenceFilter::BLOCKED) {
+    m = (m + kBlockedBitsMask) & ~kBlockedBitsMask;
+  }
+  return m;
+}
+
+// The finalizer of MurmurHash3, from which the bit positions in a block are
+// taken.  The block itself is chosen by the original hash.
+inline uint64 MixBits(uint64 hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+int GetOptimalNumHashes(uint32 m, uint32 n) {
+  int optimal_k = static_cast<int>((static_cast<float>(m) / n * log(2.0))
+                                   + 0.5);
+  if (optimal_k < 1) {
+    optimal_k = 1;
+  }
+  if (optimal_k > 7) {
+    optimal_k = 7;
+  }
+  return optimal_k;
+}
+
+// Returns the false positive rate of BLOCKED with |m| bits and |n| elements,
+// where the number of elements in a block follows the Poisson distribution.
+double GetBlockedFalsePositiveRate(double m, size_t n, int k) {
+  const double lambda = n * kBlockedBits / m;
+  const double bit_unset_rate = 1.0 - 1.0 / kBlockedBits;
+  const size_t max_elements =
+      static_cast<size_t>(lambda + 10 * sqrt(lambda) + 10);
+  double probability = exp(-lambda);  // Poisson probability of 0 elements.
+  double rate = 0.0;
+  for (size_t i = 0; i <= max_elements; ++i) {
+    if (i > 0) {
+      probability *= lambda / i;
+    }
+    rate += probability * pow(1.0 - pow(bit_unset_rate, k * i), k);
+  }
+  return rate;
+}
+
 }  // namespace
 
 class ExistenceFilter::BlockBitmap {
@@ -63,6 +128,7 @@ class ExistenceFilter::BlockBitmap {
   void Clear();
   bool Get(uint32 index) const;
   void Set(uint32 index);
+  void Prefetch(uint32 index) const;
 
   // REQUIRES: "iter" is zero, or was set by a preceding call
   // to GetMutableFragment().
@@ -149,22 +215,34 @@ void ExistenceFilter::BlockBitmap::Clear() {
 }
 
 ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k)
-    : vec_size_(m ? m : 1),
+    : vec_size_(GetVectorSize(m, CLASSIC)),
+      expected_nelts_(n),
+      num_hashes_(k),
+      version_(CLASSIC) {
+  CHECK_LT(num_hashes_, 8);
+  rep_.reset(new BlockBitmap(vec_size_, true));
+  rep_->Clear();
+}
+
+ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k, Version version)
+    : vec_size_(GetVectorSize(m, version)),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      version_(version) {
   CHECK_LT(num_hashes_, 8);
-  rep_.reset(new BlockBitmap(m ? m : 1, true));
+  rep_.reset(new BlockBitmap(vec_size_, true));
   rep_->Clear();
 }
 
 // this is private constructor
-ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
+ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k, Version version,
                                  bool is_mutable)
-    : vec_size_(m ? m : 1),
+    : vec_size_(GetVectorSize(m, version)),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      version_(version) {
   CHECK_LT(num_hashes_, 8);
-  rep_.reset(new BlockBitmap(m ? m : 1, is_mutable));
+  rep_.reset(new BlockBitmap(vec_size_, is_mutable));
   rep_->Clear();
 }
 
@@ -172,30 +250,29 @@ ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
 ExistenceFilter *
 ExistenceFilter::CreateImmutableExietenceFilter(uint32 m,
                                                 uint32 n,
-                                                int k) {
-  return new ExistenceFilter(m, n, k, false);
+                                                int k,
+                                                Version version) {
+  return new ExistenceFilter(m, n, k, version, false);
 }
 
 ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
                                                 uint32 estimated_insertions) {
+  return CreateOptimal(size_in_bytes, estimated_insertions, CLASSIC);
+}
+
+ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
+                                                uint32 estimated_insertions,
+                                                Version version) {
   CHECK_LT(size_in_bytes, (1 << 29))
                              << "Requested size is too big";
   CHECK_GT(estimated_insertions, 0);
-  const uint32 m = size_in_bytes * 8;
+  const uint32 m = GetVectorSize(size_in_bytes * 8, version);
   const uint32 n = estimated_insertions;
-
-  int optimal_k = static_cast<int>((static_cast<float>(m) / n * log(2.0))
-                                   + 0.5);
-  if (optimal_k < 1) {
-    optimal_k = 1;
-  }
-  if (optimal_k > 7) {
-    optimal_k = 7;
-  }
+  const int optimal_k = GetOptimalNumHashes(m, n);
 
   VLOG(1) << "optimal_k: " << optimal_k;
 
-  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k);
+  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k, version);
   CHECK(filter);
   return filter;
 }
@@ -221,6 +298,14 @@ inline void ExistenceFilter::BlockBitmap::Set(uint32 index) {
   block_[bindex][windex] |= (static_cast<uint32>(1) << bitpos);
 }
 
+inline void ExistenceFilter::BlockBitmap::Prefetch(uint32 index) const {
+#if defined(__GNUC__) || defined(__clang__)
+  const uint32 bindex = index >> kBlockShift;
+  const uint32 windex = (index & kBlockMask) >> 5;
+  __builtin_prefetch(&block_[bindex][windex]);
+#endif  // __GNUC__ || __clang__
+}
+
 bool ExistenceFilter::BlockBitmap::GetMutableFragment(uint32 *iter,
                                                       char ***ptr,
                                                       size_t *size) {
@@ -236,7 +321,29 @@ bool ExistenceFilter::BlockBitmap::GetMutableFragment(uint32 *iter,
   return true;
 }
 
+inline uint32 ExistenceFilter::GetBlockBitIndex(uint64 hash) const {
+  DCHECK_EQ(BLOCKED, version_);
+  return static_cast<uint32>(hash % (vec_size_ >> kBlockedBitsShift))
+      << kBlockedBitsShift;
+}
+
+inline bool ExistenceFilter::ExistsInBlock(uint32 block_bit_index,
+                                           uint64 hash) const {
+  // Each of the k (< 8) bit positions takes 9 bits of the mixed hash.
+  uint64 positions = MixBits(hash);
+  for (size_t i = 0; i < num_hashes_; ++i) {
+    if (!rep_->Get(block_bit_index + (positions & kBlockedBitsMask))) {
+      return false;
+    }
+    positions >>= kBlockedBitsShift;
+  }
+  return true;
+}
+
 bool ExistenceFilter::Exists(uint64 hash) const {
+  if (version_ == BLOCKED) {
+    return ExistsInBlock(GetBlockBitIndex(hash), hash);
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -247,7 +354,38 @@ bool ExistenceFilter::Exists(uint64 hash) const {
   return true;
 }
 
+void ExistenceFilter::ExistsMany(const uint64 *hashes, size_t size,
+                                 bool *results) const {
+  if (version_ != BLOCKED) {
+    for (size_t i = 0; i < size; ++i) {
+      results[i] = Exists(hashes[i]);
+    }
+    return;
+  }
+  uint32 block_bit_indices[kExistsManyBatchSize];
+  for (size_t begin = 0; begin < size; begin += kExistsManyBatchSize) {
+    const size_t batch_size = std::min(kExistsManyBatchSize, size - begin);
+    for (size_t i = 0; i < batch_size; ++i) {
+      block_bit_indices[i] = GetBlockBitIndex(hashes[begin + i]);
+      rep_->Prefetch(block_bit_indices[i]);
+    }
+    for (size_t i = 0; i < batch_size; ++i) {
+      results[begin + i] =
+          ExistsInBlock(block_bit_indices[i], hashes[begin + i]);
+    }
+  }
+}
+
 void ExistenceFilter::Insert(uint64 hash) {
+  if (version_ == BLOCKED) {
+    const uint32 block_bit_index = GetBlockBitIndex(hash);
+    uint64 positions = MixBits(hash);
+    for (size_t i = 0; i < num_hashes_; ++i) {
+      rep_->Set(block_bit_index + (positions & kBlockedBitsMask));
+      positions >>= kBlockedBitsShift;
+    }
+    return;
+  }
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -255,6 +393,70 @@ void ExistenceFilter::Insert(uint64 hash) {
   }
 }
 
+void ExistenceFilter::InsertMany(const uint64 *hashes, size_t size) {
+  // The bit vector is split into ranges of whole blocks (BLOCKED) or whole
+  // words (CLASSIC), so that no word is written by two threads.  As setting
+  // bits commutes, the result doesn't depend on the split.
+  const uint64 unit_bits = (version_ == BLOCKED) ? kBlockedBits : 32;
+  const uint64 num_units = (vec_size_ + unit_bits - 1) / unit_bits;
+  ThreadPool *pool = ThreadPool::GetSharedInstance();
+  const size_t num_threads = static_cast<size_t>(std::min<uint64>(
+      std::min(pool->num_threads(),
+               std::max(size / kMinInsertionsPerThread,
+                        static_cast<size_t>(1))),
+      num_units));
+  if (num_threads <= 1) {
+    InsertInRange(hashes, size, 0, vec_size_);
+    return;
+  }
+
+  std::vector<uint64> range_begins(num_threads + 1);
+  for (size_t i = 0; i < num_threads; ++i) {
+    range_begins[i] = num_units * i / num_threads * unit_bits;
+  }
+  range_begins[num_threads] = vec_size_;
+
+  std::vector<ThreadPool::TaskHandle> tasks;
+  for (size_t i = 1; i < num_threads; ++i) {
+    const uint32 bit_begin = static_cast<uint32>(range_begins[i]);
+    const uint64 bit_end = range_begins[i + 1];
+    tasks.push_back(pool->Schedule(
+        ThreadPool::BACKGROUND, [this, hashes, size, bit_begin, bit_end]() {
+          InsertInRange(hashes, size, bit_begin, bit_end);
+        }));
+  }
+  InsertInRange(hashes, size, 0, range_begins[1]);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i]->Wait();
+  }
+}
+
+void ExistenceFilter::InsertInRange(const uint64 *hashes, size_t size,
+                                    uint32 bit_begin, uint64 bit_end) {
+  for (size_t i = 0; i < size; ++i) {
+    if (version_ == BLOCKED) {
+      const uint32 block_bit_index = GetBlockBitIndex(hashes[i]);
+      if (block_bit_index < bit_begin || block_bit_index >= bit_end) {
+        continue;
+      }
+      uint64 positions = MixBits(hashes[i]);
+      for (size_t j = 0; j < num_hashes_; ++j) {
+        rep_->Set(block_bit_index + (positions & kBlockedBitsMask));
+        positions >>= kBlockedBitsShift;
+      }
+      continue;
+    }
+    uint64 hash = hashes[i];
+    for (size_t j = 0; j < num_hashes_; ++j) {
+      hash = RotateLeft64(hash, 8);
+      const uint32 index = hash % vec_size_;
+      if (index >= bit_begin && index < bit_end) {
+        rep_->Set(index);
+      }
+    }
+  }
+}
+
 size_t ExistenceFilter::Size() const {
   return (BitsToWords(vec_size_) * sizeof(uint32));
 }
@@ -273,10 +475,35 @@ size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
   return static_cast<size_t>(ceil(min_bits / 8));
 }
 
+size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
+                                                         size_t num_elements,
+                                                         Version version) {
+  const size_t classic_bytes =
+      MinFilterSizeInBytesForErrorRate(error_rate, num_elements);
+  if (version != BLOCKED || num_elements == 0) {
+    return classic_bytes;
+  }
+  // BLOCKED needs more bits than CLASSIC for the same error rate because the
+  // blocks are unevenly loaded.  Grow the size by 1/16 until the estimated
+  // rate is achieved.
+  size_t bytes = classic_bytes;
+  for (;;) {
+    const uint32 m = GetVectorSize(bytes * 8, BLOCKED);
+    const int k = GetOptimalNumHashes(m, num_elements);
+    if (GetBlockedFalsePositiveRate(m, num_elements, k) <= error_rate) {
+      return m / 8;
+    }
+    bytes += bytes / 16 + 1;
+  }
+}
+
 // allocate 'buf' and write filter to the buf.
 // 'size' will hold the size of buf
 void ExistenceFilter::Write(char **buf, size_t *size) {
-  const int require_bytes = sizeof(Header) + Size();
+  // The serialized header has m, n and k, where k also holds the version.
+  // It is smaller than sizeof(Header).
+  const int require_bytes = sizeof(vec_size_) + sizeof(expected_nelts_) +
+                            sizeof(int32) + Size();
 
   *buf = new char[require_bytes];
   CHECK(*buf);
@@ -289,10 +516,14 @@ void ExistenceFilter::Write(char **buf, size_t *size) {
   buf_ptr += sizeof(vec_size_);
   memcpy(buf_ptr, &expected_nelts_, sizeof(expected_nelts_));
   buf_ptr += sizeof(expected_nelts_);
-  memcpy(buf_ptr, &num_hashes_, sizeof(num_hashes_));
-  buf_ptr += sizeof(num_hashes_);
+  // The version is stored in the upper bits of the number of hashes, which
+  // makes the readers of the CLASSIC layout reject the other layouts.
+  const int32 hashes_and_version = num_hashes_ | (version_ << 8);
+  memcpy(buf_ptr, &hashes_and_version, sizeof(hashes_and_version));
+  buf_ptr += sizeof(hashes_and_version);
   LOG(INFO) << "Write header : vec_size" << vec_size_ << " expected_nelts "
-            << expected_nelts_ << " num_hashes " << num_hashes_;
+            << expected_nelts_ << " num_hashes " << num_hashes_
+            << " version " << version_;
 
   // write bitmap
   char **fragment_ptr = NULL;
@@ -314,12 +545,25 @@ bool ExistenceFilter::ReadHeader(const char *buf, Header* header) {
   buf += sizeof(header->m);
   memcpy(&(header->n), buf, sizeof(header->n));
   buf += sizeof(header->n);
-  memcpy(&(header->k), buf, sizeof(header->k));
-  buf += sizeof(header->k);
+  int hashes_and_version = 0;
+  memcpy(&hashes_and_version, buf, sizeof(hashes_and_version));
+  buf += sizeof(hashes_and_version);
+  header->k = hashes_and_version & 0xff;
+  const int version = hashes_and_version >> 8;
   if (header->k >= 8 || header->k <= 0) {
     LOG(ERROR) << "Bad number of hashes (header->k)";
     return false;
   }
+  if (version != CLASSIC && version != BLOCKED) {
+    LOG(ERROR) << "Unknown version: " << version;
+    return false;
+  }
+  header->version = static_cast<Version>(version);
+  if (header->version == BLOCKED &&
+      (header->m == 0 || (header->m & kBlockedBitsMask) != 0)) {
+    LOG(ERROR) << "Bad size of the blocked filter: " << header->m;
+    return false;
+  }
   return true;
 }
 
@@ -353,7 +597,8 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   ExistenceFilter* filter =
       ExistenceFilter::CreateImmutableExietenceFilter(header.m,
                                                       header.n,
-                                                      header.k);
+                                                      header.k,
+                                                      header.version);
   char **ptr = NULL;
   size_t n = 0;
   size_t read = 0;
@@ -40,10 +40,22 @@ namespace storage {
 // Bloom filter
 class ExistenceFilter {
  public:
+  // Layouts of the bit vector.  The version is recorded in the header, so the
+  // data of both layouts can be read.
+  enum Version {
+    // The k bits of a hash value are spread over the whole bit vector.
+    CLASSIC = 0,
+    // The k bits of a hash value fall in one 64-byte block, so that a lookup
+    // touches one cache line.  The false positive rate is a little higher
+    // than CLASSIC for the same size.
+    BLOCKED = 1,
+  };
+
   struct Header {
     uint32 m;
     uint32 n;
     int k;
+    Version version;
   };
 
   // 'm' is the number of bits in the bit vector
@@ -51,10 +63,15 @@ class ExistenceFilter {
   // 'k' is the number of hash values to use per insert/lookup
   // k must be less than 8
   ExistenceFilter(uint32 m, uint32 n, int k);
+  // For BLOCKED, 'm' is rounded up to a multiple of the block size.
+  ExistenceFilter(uint32 m, uint32 n, int k, Version version);
   ~ExistenceFilter();
 
   static ExistenceFilter* CreateOptimal(size_t size_in_bytes,
                                         uint32 estimated_insertions);
+  static ExistenceFilter* CreateOptimal(size_t size_in_bytes,
+                                        uint32 estimated_insertions,
+                                        Version version);
 
   void Clear();
 
@@ -62,10 +79,22 @@ class ExistenceFilter {
   // We generate 'k' separate internal hash values
   void Insert(uint64 hash);
 
+  // Inserts hashes[i] for i < size.  The result is the same as calling
+  // Insert() for each of them, but large inputs are inserted on the threads
+  // of the shared ThreadPool, each of which sets the bits of its own range of
+  // the bit vector.
+  void InsertMany(const uint64 *hashes, size_t size);
+
   // Checks if the given 'hash' was previously inserted int the filter
   // It may return some false positives
   bool Exists(uint64 hash) const;
 
+  // Sets results[i] to Exists(hashes[i]) for i < size.  For BLOCKED, the
+  // blocks are fetched ahead so that the cache misses overlap.
+  void ExistsMany(const uint64 *hashes, size_t size, bool *results) const;
+
+  Version version() const { return version_; }
+
   // Returns the size (in bytes) of the bloom filter
   size_t Size() const;
 
@@ -73,6 +102,9 @@ class ExistenceFilter {
   // under the given error rate and number of elements
   static size_t MinFilterSizeInBytesForErrorRate(float error_rate,
                                                  size_t num_elements);
+  static size_t MinFilterSizeInBytesForErrorRate(float error_rate,
+                                                 size_t num_elements,
+                                                 Version version);
 
   void Write(char **buf, size_t *size);
 
@@ -87,16 +119,28 @@ class ExistenceFilter {
   class BlockBitmap;
 
   // private constructor for ExistenceFilter::Read();
-  ExistenceFilter(uint32 m, uint32 n, int k, bool is_mutable);
+  ExistenceFilter(uint32 m, uint32 n, int k, Version version,
+                  bool is_mutable);
 
   static ExistenceFilter *CreateImmutableExietenceFilter(uint32 m,
                                                          uint32 n,
-                                                         int k);
+                                                         int k,
+                                                         Version version);
+
+  // Returns the index of the first bit of the block for |hash| in BLOCKED.
+  uint32 GetBlockBitIndex(uint64 hash) const;
+  // Returns true if all the bits for |hash| are set in the block beginning
+  // at |block_bit_index| in BLOCKED.
+  bool ExistsInBlock(uint32 block_bit_index, uint64 hash) const;
+  // Sets the bits for hashes[i] (i < size) which lie in [bit_begin, bit_end).
+  void InsertInRange(const uint64 *hashes, size_t size, uint32 bit_begin,
+                     uint64 bit_end);
 
   std::unique_ptr<BlockBitmap> rep_;  // points to bitmap
   const uint32 vec_size_;  // size of bitmap (in bits)
   const uint32 expected_nelts_;  // expected number of inserts
   const int32 num_hashes_;  // number of hashes per lookup
+  const Version version_;
 
   DISALLOW_COPY_AND_ASSIGN(ExistenceFilter);
 };
@@ -28,6 +28,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string>
+#include <vector>
 
 #include "base/flags.h"
 #include "base/init_mozc.h"
@@ -44,10 +45,11 @@ int main(int argc, char **argv) {
   int n = 500;
   int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, n);
   ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n);
+  std::vector<uint64> vals;
   for (int i = 0; i < n; ++i) {
-    uint64 val = i * 2;
-    filter->Insert(val);
+    vals.push_back(i * 2);
   }
+  filter->InsertMany(vals.data(), vals.size());
 
   for (int i = 0; i < 2 * n; ++i) {
     uint64 val = i;
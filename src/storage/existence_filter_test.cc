@@ -85,6 +85,13 @@ void RunTest(int m, int n) {
   delete filter;
 }
 
+// Inserts the even numbers below 2 * |n| to |filter|.
+void InsertEvenNumbers(int n, ExistenceFilter *filter) {
+  for (int i = 0; i < n; ++i) {
+    filter->Insert(Hash::Fingerprint(i * 2));
+  }
+}
+
 }  // namespace
 
 TEST(ExistenceFilterTest, RunTest) {
@@ -104,6 +111,74 @@ TEST(ExistenceFilterTest, MinFilterSizeEstimateTest) {
             ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.05, 1000));
 }
 
+TEST(ExistenceFilterTest, BlockedFilterTest) {
+  const int n = 50000;
+  const float kErrorRate = 0.01;
+  const size_t num_bytes = ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+      kErrorRate, n, ExistenceFilter::BLOCKED);
+  // A blocked filter needs more bits for the same error rate.
+  EXPECT_LT(ExistenceFilter::MinFilterSizeInBytesForErrorRate(kErrorRate, n),
+            num_bytes);
+  EXPECT_EQ(0, num_bytes % 64);
+
+  std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(
+      num_bytes, n, ExistenceFilter::BLOCKED));
+  EXPECT_EQ(ExistenceFilter::BLOCKED, filter->version());
+  EXPECT_EQ(num_bytes, filter->Size());
+  InsertEvenNumbers(n, filter.get());
+
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  ExistenceFilter::Header header;
+  ASSERT_TRUE(ExistenceFilter::ReadHeader(buf, &header));
+  EXPECT_EQ(ExistenceFilter::BLOCKED, header.version);
+  std::unique_ptr<ExistenceFilter> filter_read(
+      ExistenceFilter::Read(buf, size));
+  ASSERT_NE(nullptr, filter_read.get());
+  EXPECT_EQ(ExistenceFilter::BLOCKED, filter_read->version());
+
+  const ExistenceFilter *filters[] = {filter.get(), filter_read.get()};
+  for (size_t f = 0; f < arraysize(filters); ++f) {
+    int false_positives = 0;
+    for (int i = 0; i < 2 * n; ++i) {
+      const bool actual = filters[f]->Exists(Hash::Fingerprint(i));
+      if (i % 2 == 0) {
+        EXPECT_TRUE(actual) << i;
+      } else if (actual) {
+        ++false_positives;
+      }
+    }
+    // Allow some margin over the estimated error rate.
+    EXPECT_GT(n * kErrorRate * 1.5, false_positives);
+  }
+  delete [] buf;
+}
+
+TEST(ExistenceFilterTest, ExistsManyTest) {
+  const int n = 1000;
+  const ExistenceFilter::Version kVersions[] = {
+    ExistenceFilter::CLASSIC, ExistenceFilter::BLOCKED,
+  };
+  std::vector<uint64> hashes;
+  for (int i = 0; i < 2 * n; ++i) {
+    hashes.push_back(Hash::Fingerprint(i));
+  }
+  for (size_t v = 0; v < arraysize(kVersions); ++v) {
+    std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(
+        ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.05, n,
+                                                          kVersions[v]),
+        n, kVersions[v]));
+    InsertEvenNumbers(n, filter.get());
+
+    std::unique_ptr<bool[]> results(new bool[hashes.size()]);
+    filter->ExistsMany(hashes.data(), hashes.size(), results.get());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      EXPECT_EQ(filter->Exists(hashes[i]), results[i]) << v << " " << i;
+    }
+  }
+}
+
 TEST(ExistenceFilterTest, ReadWriteTest) {
   std::vector<string> words;
   words.push_back("a");
@@ -135,6 +210,28 @@ TEST(ExistenceFilterTest, ReadWriteTest) {
   delete [] buf;
 }
 
+TEST(ExistenceFilterTest, WriteSizeTest) {
+  const ExistenceFilter::Version kVersions[] = {
+    ExistenceFilter::CLASSIC, ExistenceFilter::BLOCKED,
+  };
+  for (size_t v = 0; v < arraysize(kVersions); ++v) {
+    std::unique_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(
+        ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 100,
+                                                          kVersions[v]),
+        100, kVersions[v]));
+    InsertEvenNumbers(100, filter.get());
+
+    // The serialized header has m, n and k, where k also holds the version,
+    // so no byte of the output is left uninitialized.
+    char *buf = NULL;
+    size_t size = 0;
+    filter->Write(&buf, &size);
+    EXPECT_EQ(sizeof(uint32) + sizeof(uint32) + sizeof(int32) + filter->Size(),
+              size) << v;
+    delete [] buf;
+  }
+}
+
 TEST(ExistenceFilterTest, InsertAndExistsTest) {
   std::vector<string> words;
   words.push_back("a");
@@ -164,5 +261,41 @@ TEST(ExistenceFilterTest, InsertAndExistsTest) {
   }
 }
 
+TEST(ExistenceFilterTest, InsertManyTest) {
+  const ExistenceFilter::Version kVersions[] = {
+    ExistenceFilter::CLASSIC, ExistenceFilter::BLOCKED,
+  };
+  // Large enough to be split between threads.
+  const size_t kNumHashes = 100000;
+  std::vector<uint64> hashes;
+  for (size_t i = 0; i < kNumHashes; ++i) {
+    hashes.push_back(Hash::Fingerprint(i));
+  }
+
+  for (size_t i = 0; i < arraysize(kVersions); ++i) {
+    const size_t num_bytes = ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+        0.001, kNumHashes, kVersions[i]);
+    std::unique_ptr<ExistenceFilter> expected_filter(
+        ExistenceFilter::CreateOptimal(num_bytes, kNumHashes, kVersions[i]));
+    for (size_t j = 0; j < hashes.size(); ++j) {
+      expected_filter->Insert(hashes[j]);
+    }
+    std::unique_ptr<ExistenceFilter> actual_filter(
+        ExistenceFilter::CreateOptimal(num_bytes, kNumHashes, kVersions[i]));
+    actual_filter->InsertMany(hashes.data(), hashes.size());
+
+    char *expected_buf = NULL;
+    size_t expected_size = 0;
+    expected_filter->Write(&expected_buf, &expected_size);
+    char *actual_buf = NULL;
+    size_t actual_size = 0;
+    actual_filter->Write(&actual_buf, &actual_size);
+    EXPECT_EQ(string(expected_buf, expected_size),
+              string(actual_buf, actual_size));
+    delete [] expected_buf;
+    delete [] actual_buf;
+  }
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -49,6 +49,20 @@ void BitStream::PushBit(int bit) {
   ++num_bits_;
 }
 
+void BitStream::PushBits(int bit, size_t count) {
+  DCHECK(bit == 0 || bit == 1);
+
+  for (; count > 0 && num_bits_ % 8 != 0; --count) {
+    PushBit(bit);
+  }
+  const size_t num_bytes = count / 8;
+  image_.append(num_bytes, bit ? '\xFF' : '\0');
+  num_bits_ += num_bytes * 8;
+  for (count %= 8; count > 0; --count) {
+    PushBit(bit);
+  }
+}
+
 void BitStream::FillPadding32() {
   const size_t remaining = image_.length() % 4;
   if (remaining != 0) {
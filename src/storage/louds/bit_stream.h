@@ -49,6 +49,9 @@ class BitStream {
 
   void PushBit(int bit);
 
+  // Pushes |count| copies of |bit|.  Whole bytes are appended at once.
+  void PushBits(int bit, size_t count);
+
   // Fills the padding (0-bit) until the size is aligned to 32bit boundary.
   void FillPadding32();
 
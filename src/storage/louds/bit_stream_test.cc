@@ -75,4 +75,27 @@ TEST_F(BitStreamTest, FillPadding32) {
   EXPECT_EQ(string("\x01\x00\x00\x00", 4), bit_stream.image());
 }
 
+TEST_F(BitStreamTest, PushBits) {
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t count = 0; count < 40; ++count) {
+      BitStream expected;
+      BitStream actual;
+      for (size_t i = 0; i < offset; ++i) {
+        expected.PushBit(i % 2);
+        actual.PushBit(i % 2);
+      }
+      for (size_t i = 0; i < count; ++i) {
+        expected.PushBit(1);
+      }
+      actual.PushBits(1, count);
+      expected.PushBit(0);
+      expected.PushBit(1);
+      actual.PushBits(0, 1);
+      actual.PushBits(1, 1);
+      EXPECT_EQ(expected.num_bits(), actual.num_bits());
+      EXPECT_EQ(expected.image(), actual.image());
+    }
+  }
+}
+
 }  // namespace
@@ -40,6 +40,9 @@ namespace {
 const size_t kLb0CacheSize = 1024;
 const size_t kLb1CacheSize = 0;
 
+// The interval of the elements whose positions in the index are sampled.
+const size_t kSampleInterval = 64;
+
 inline int ReadInt32(const uint8 *data) {
   return *reinterpret_cast<const int32*>(data);
 }
@@ -54,6 +57,14 @@ void BitVectorBasedArray::Open(const uint8 *image) {
   CHECK_EQ(ReadInt32(image + 12), 0);
 
   index_.Init(image + 16, index_length, kLb0CacheSize, kLb1CacheSize);
+  // Each element begins with a 0-bit.  Note that the 0-bits include the
+  // sentinel and the padding, which are fine to be sampled.
+  const size_t num_0bits = index_.GetNum0Bits();
+  sampled_bit_positions_.clear();
+  sampled_bit_positions_.reserve(num_0bits / kSampleInterval + 1);
+  for (size_t i = 0; i < num_0bits; i += kSampleInterval) {
+    sampled_bit_positions_.push_back(index_.Select0(i + 1));
+  }
   base_length_ = base_length;
   step_length_ = step_length;
   data_ = reinterpret_cast<const char*>(image + 16 + index_length);
@@ -61,6 +72,7 @@ void BitVectorBasedArray::Open(const uint8 *image) {
 
 void BitVectorBasedArray::Close() {
   index_.Reset();
+  sampled_bit_positions_.clear();
   base_length_ = 0;
   step_length_ = 0;
   data_ = 0;
@@ -68,9 +80,18 @@ void BitVectorBasedArray::Close() {
 
 const char *BitVectorBasedArray::Get(size_t index, size_t *length) const {
   DCHECK(length);
-  const int bit_index = index_.Select0(index + 1);
+  DCHECK_LT(index / kSampleInterval, sampled_bit_positions_.size());
+  // Find the leading 0-bit of the element from the nearest sample.
+  const int sampled_bit_index =
+      sampled_bit_positions_[index / kSampleInterval];
+  const size_t num_skipped_elements = index % kSampleInterval;
+  const int bit_index = num_skipped_elements == 0 ?
+      sampled_bit_index :
+      index_.Select0From(sampled_bit_index + 1, num_skipped_elements);
+  // There are |index| 0-bits before the bit_index, so the rest are the
+  // 1-bits for the steps.
   const int data_index =
-      base_length_ * index + step_length_ * index_.Rank1(bit_index);
+      base_length_ * index + step_length_ * (bit_index - index);
   // Linear search.
   int i = bit_index + 1;
   while (index_.Get(i)) {
@@ -30,6 +30,8 @@
 #ifndef MOZC_STORAGE_LOUDS_BIT_VECTOR_BASED_ARRAY_H_
 #define MOZC_STORAGE_LOUDS_BIT_VECTOR_BASED_ARRAY_H_
 
+#include <vector>
+
 #include "base/port.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
@@ -53,6 +55,10 @@ class BitVectorBasedArray {
 
  private:
   SimpleSuccinctBitVectorIndex index_;
+  // The positions of the leading 0-bits of every kSampleInterval-th element
+  // in the index, with which Get finds the element by scanning a few words
+  // from the nearest sample instead of Select0.
+  std::vector<int> sampled_bit_positions_;
   size_t base_length_;
   size_t step_length_;
   const char *data_;
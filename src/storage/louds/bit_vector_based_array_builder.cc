@@ -73,25 +73,21 @@ void BitVectorBasedArrayBuilder::Build() {
 
   BitStream bit_stream;
   string data;
+  size_t data_size = 0;
+  for (size_t i = 0; i < elements_.size(); ++i) {
+    data_size += GetOutputLength(elements_[i].length());
+  }
+  data.reserve(data_size);
 
   // Output to the bit_stream and the data.
   for (size_t i = 0; i < elements_.size(); ++i) {
     const string &element = elements_[i];
 
-    // Counts how many steps is needed.
-    int num_steps = 0;
-    for (size_t length = element.length(); length > base_length_;
-         length -= step_length_) {
-      ++num_steps;
-    }
-
     // Output '0' as a beginning bit, followed by the num_steps of '1'-bits.
-    size_t output_length = base_length_ + num_steps * step_length_;
+    const size_t output_length = GetOutputLength(element.length());
     DCHECK_GE(output_length, element.length());
     bit_stream.PushBit(0);
-    for (int j = 0; j < num_steps; ++j) {
-      bit_stream.PushBit(1);
-    }
+    bit_stream.PushBits(1, (output_length - base_length_) / step_length_);
 
     // Output word data (excluding '\0' termination) and then padding by '\0'
     // to align to the output length.
@@ -115,6 +111,13 @@ void BitVectorBasedArrayBuilder::Build() {
   built_ = true;
 }
 
+size_t BitVectorBasedArrayBuilder::GetOutputLength(size_t length) const {
+  // The number of the steps needed to store |length| bytes.
+  const size_t num_steps = length > base_length_ ?
+      (length - base_length_ + step_length_ - 1) / step_length_ : 0;
+  return base_length_ + num_steps * step_length_;
+}
+
 const string &BitVectorBasedArrayBuilder::image() const {
   CHECK(built_);
   return image_;
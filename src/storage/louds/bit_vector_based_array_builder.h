@@ -67,6 +67,9 @@ class BitVectorBasedArrayBuilder {
 
   const string &image() const;
  private:
+  // Returns the length of an element of |length| bytes in the image.
+  size_t GetOutputLength(size_t length) const;
+
   bool built_;
   std::vector<string> elements_;
   size_t base_length_;
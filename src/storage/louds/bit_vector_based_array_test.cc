@@ -30,6 +30,7 @@
 #include "storage/louds/bit_vector_based_array.h"
 
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "storage/louds/bit_vector_based_array_builder.h"
@@ -82,4 +83,34 @@ TEST_F(BitVectorBasedArrayTest, Get) {
 
   array.Close();
 }
+
+TEST_F(BitVectorBasedArrayTest, GetManyElements) {
+  // Spans over several samples of the positions in the index.
+  const size_t kNumElements = 1000;
+  std::vector<string> elements;
+  BitVectorBasedArrayBuilder builder;
+  for (size_t i = 0; i < kNumElements; ++i) {
+    elements.push_back(string(i % 13, 'a' + i % 26));
+    builder.Add(elements.back());
+  }
+  builder.SetSize(2, 3);
+  builder.Build();
+
+  BitVectorBasedArray array;
+  array.Open(reinterpret_cast<const uint8*>(builder.image().data()));
+  for (size_t i = 0; i < kNumElements; ++i) {
+    size_t length;
+    const char *result = array.Get(i, &length);
+    ASSERT_GE(length, elements[i].length()) << i;
+    EXPECT_EQ(0, (length - 2) % 3) << i;
+    EXPECT_LT(length - elements[i].length(), 3) << i;
+    EXPECT_EQ(elements[i], string(result, elements[i].length())) << i;
+    EXPECT_EQ(string(length - elements[i].length(), '\0'),
+              string(result + elements[i].length(),
+                     length - elements[i].length())) << i;
+  }
+
+  array.Close();
+}
+
 }  // namespace
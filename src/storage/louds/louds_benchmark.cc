@@ -0,0 +1,529 @@
+// Copyright 2010-2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Benchmark of the LOUDS trie and the succinct structures under it over the
+// tries of the system dictionary.  The inputs are the keys and the positions
+// sampled uniformly from the tries themselves, so that every operation works
+// on the real shape of the data rather than on a synthetic one.
+//
+// Usage:
+//   louds_benchmark [--dictionary=<system dictionary file>]
+//       [--output_format=json]
+//
+// Each benchmark reports ns/op and, on Linux where perf_event_open() is
+// permitted, the CPU cycles, the instructions, the branch misses and the
+// cache misses per op.
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(OS_LINUX) && !defined(OS_NACL)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // OS_LINUX && !OS_NACL
+
+#include "base/flags.h"
+#include "base/init_mozc.h"
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/stopwatch.h"
+#include "base/string_piece.h"
+#include "base/util.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "dictionary/file/codec_factory.h"
+#include "dictionary/file/dictionary_file.h"
+#include "dictionary/system/codec_interface.h"
+#include "storage/louds/bit_vector_based_array.h"
+#include "storage/louds/louds.h"
+#include "storage/louds/louds_trie.h"
+#include "storage/louds/simple_succinct_bit_vector_index.h"
+
+DEFINE_string(dictionary, "",
+              "system dictionary file.  The one of the OSS data set is used "
+              "if empty.");
+DEFINE_int32(num_keys, 100000, "number of keys and positions sampled.");
+DEFINE_int32(iterations, 10, "number of passes over the samples.");
+DEFINE_bool(hardware_counters, true,
+            "report the hardware counters if available.");
+DEFINE_string(output_format, "text", "output format: (text, json)");
+
+namespace mozc {
+namespace storage {
+namespace louds {
+namespace {
+
+const struct {
+  SimpleSuccinctBitVectorIndex::Implementation impl;
+  const char *name;
+} kImplementations[] = {
+  {SimpleSuccinctBitVectorIndex::PORTABLE, "portable"},
+  {SimpleSuccinctBitVectorIndex::POPCNT, "popcnt"},
+  {SimpleSuccinctBitVectorIndex::BMI2, "bmi2"},
+};
+
+// The hardware events read by HardwareCounters.
+enum HardwareEvent {
+  CYCLES,
+  INSTRUCTIONS,
+  BRANCH_MISSES,
+  CACHE_MISSES,
+  NUM_HARDWARE_EVENTS,
+};
+
+// Counts the hardware events of the current thread with perf_event_open().
+// The counters are unavailable on the other platforms, or when the kernel
+// doesn't permit them, e.g. in containers.
+class HardwareCounters {
+ public:
+  HardwareCounters() {
+    for (int i = 0; i < NUM_HARDWARE_EVENTS; ++i) {
+      fds_[i] = -1;
+    }
+#if defined(OS_LINUX) && !defined(OS_NACL)
+    if (!FLAGS_hardware_counters) {
+      return;
+    }
+    const uint64 kConfigs[NUM_HARDWARE_EVENTS] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_MISSES,
+    };
+    for (int i = 0; i < NUM_HARDWARE_EVENTS; ++i) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = kConfigs[i];
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+      if (fds_[i] < 0) {
+        LOG(WARNING) << "Hardware counters are unavailable";
+        Close();
+        return;
+      }
+    }
+#endif  // OS_LINUX && !OS_NACL
+  }
+
+  ~HardwareCounters() {
+    Close();
+  }
+
+  bool available() const { return fds_[0] >= 0; }
+
+  void Start() {
+#if defined(OS_LINUX) && !defined(OS_NACL)
+    for (int i = 0; available() && i < NUM_HARDWARE_EVENTS; ++i) {
+      ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif  // OS_LINUX && !OS_NACL
+  }
+
+  // Stops the counters and stores the counts to |counts|, which are 0 if the
+  // counters are unavailable.
+  void Stop(uint64 counts[NUM_HARDWARE_EVENTS]) {
+    for (int i = 0; i < NUM_HARDWARE_EVENTS; ++i) {
+      counts[i] = 0;
+    }
+#if defined(OS_LINUX) && !defined(OS_NACL)
+    for (int i = 0; available() && i < NUM_HARDWARE_EVENTS; ++i) {
+      ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fds_[i], &counts[i], sizeof(counts[i])) != sizeof(counts[i])) {
+        counts[i] = 0;
+      }
+    }
+#endif  // OS_LINUX && !OS_NACL
+  }
+
+ private:
+  void Close() {
+    for (int i = 0; i < NUM_HARDWARE_EVENTS; ++i) {
+#if defined(OS_LINUX) && !defined(OS_NACL)
+      if (fds_[i] >= 0) {
+        close(fds_[i]);
+      }
+#endif  // OS_LINUX && !OS_NACL
+      fds_[i] = -1;
+    }
+  }
+
+  int fds_[NUM_HARDWARE_EVENTS];
+
+  DISALLOW_COPY_AND_ASSIGN(HardwareCounters);
+};
+
+// The sections of a trie image; see LoudsTrie::Open() for the format.
+struct TrieImage {
+  const uint8 *louds;
+  int louds_size;
+  const uint8 *terminal;
+  int terminal_size;
+};
+
+TrieImage ParseTrieImage(const uint8 *image) {
+  TrieImage result;
+  result.louds_size = *reinterpret_cast<const int32 *>(image);
+  result.terminal_size = *reinterpret_cast<const int32 *>(image + 4);
+  result.louds = image + 16;
+  result.terminal = result.louds + result.louds_size;
+  return result;
+}
+
+class Benchmark {
+ public:
+  explicit Benchmark(std::ostream *os) : os_(os) {}
+
+  // Runs |func| for --iterations times after a warm-up run, and prints the
+  // time and the hardware counts per op, where |func| performs |num_ops|
+  // operations.  |func| returns a checksum of the results so that the
+  // operations are not optimized away.
+  template <typename Func>
+  void Run(const string &name, const string &trie_name, size_t num_ops,
+           Func func) {
+    uint64 checksum = func();
+    uint64 counts[NUM_HARDWARE_EVENTS];
+    counters_.Start();
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    for (int i = 0; i < FLAGS_iterations; ++i) {
+      checksum += func();
+    }
+    stopwatch.Stop();
+    counters_.Stop(counts);
+
+    const double total_ops =
+        max(static_cast<double>(num_ops) * FLAGS_iterations, 1.0);
+    const double ns_per_op = stopwatch.GetElapsedNanoseconds() / total_ops;
+    double per_op[NUM_HARDWARE_EVENTS];
+    for (int i = 0; i < NUM_HARDWARE_EVENTS; ++i) {
+      per_op[i] = counts[i] / total_ops;
+    }
+    const double ipc =
+        counts[CYCLES] > 0 ?
+        static_cast<double>(counts[INSTRUCTIONS]) / counts[CYCLES] : 0;
+
+    if (FLAGS_output_format == "json") {
+      *os_ << Util::StringPrintf(
+          "{\"benchmark\": \"%s\", \"trie\": \"%s\", \"ops\": %.0f, "
+          "\"ns_per_op\": %.2f", name.c_str(), trie_name.c_str(), total_ops,
+          ns_per_op);
+      if (counters_.available()) {
+        *os_ << Util::StringPrintf(
+            ", \"cycles_per_op\": %.2f, \"instructions_per_op\": %.2f, "
+            "\"ipc\": %.2f, \"branch_misses_per_op\": %.4f, "
+            "\"cache_misses_per_op\": %.4f",
+            per_op[CYCLES], per_op[INSTRUCTIONS], ipc,
+            per_op[BRANCH_MISSES], per_op[CACHE_MISSES]);
+      }
+      *os_ << Util::StringPrintf(", \"checksum\": %llu}",
+                                 static_cast<unsigned long long>(checksum))
+           << std::endl;
+    } else {
+      *os_ << Util::StringPrintf("%-48s %-6s %9.2f ns/op", name.c_str(),
+                                 trie_name.c_str(), ns_per_op);
+      if (counters_.available()) {
+        *os_ << Util::StringPrintf(
+            " %9.1f cycles/op %5.2f IPC %7.4f br-miss/op %7.4f cache-miss/op",
+            per_op[CYCLES], ipc, per_op[BRANCH_MISSES],
+            per_op[CACHE_MISSES]);
+      }
+      *os_ << std::endl;
+    }
+  }
+
+ private:
+  std::ostream *os_;
+  HardwareCounters counters_;
+
+  DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+// Returns --num_keys random integers in [0, size).
+std::vector<int> SampleIntegers(int size) {
+  CHECK_GT(size, 0);
+  std::vector<int> result(FLAGS_num_keys);
+  for (size_t i = 0; i < result.size(); ++i) {
+    result[i] = Util::Random(size);
+  }
+  return result;
+}
+
+// Measures the LoudsTrie API and Louds and SimpleSuccinctBitVectorIndex
+// under it over the trie image.  The search benchmarks are run with and
+// without the fan-out table of the system dictionary.
+void RunTrieBenchmarks(const string &trie_name, const uint8 *image,
+                       Benchmark *benchmark) {
+  const TrieImage sections = ParseTrieImage(image);
+
+  SimpleSuccinctBitVectorIndex terminal;
+  terminal.Init(sections.terminal, sections.terminal_size);
+  const int num_keys = terminal.GetNum1Bits();
+  const std::vector<int> key_ids = SampleIntegers(num_keys);
+
+  LoudsTrie trie;
+  CHECK(trie.Open(image));
+  std::vector<string> keys(key_ids.size());
+  {
+    char buf[LoudsTrie::kMaxDepth + 1];
+    for (size_t i = 0; i < key_ids.size(); ++i) {
+      keys[i] = trie.RestoreKeyString(key_ids[i], buf).as_string();
+    }
+  }
+  // Keys whose last bytes are altered, most of which are missing.
+  std::vector<string> missing_keys(keys);
+  for (size_t i = 0; i < missing_keys.size(); ++i) {
+    if (!missing_keys[i].empty()) {
+      missing_keys[i][missing_keys[i].size() - 1] ^= 0x5a;
+    }
+  }
+
+  for (int fan_out_depth = 0; fan_out_depth <= 2; fan_out_depth += 2) {
+    LoudsTrie search_trie;
+    CHECK(search_trie.Open(image, 0, 0, 0, 0, 0, fan_out_depth));
+    const string suffix = Util::StringPrintf("/fan_out%d", fan_out_depth);
+    benchmark->Run("LoudsTrie::Traverse" + suffix, trie_name, keys.size(),
+                   [&search_trie, &keys]() {
+      uint64 sum = 0;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        LoudsTrie::Node node;
+        sum += search_trie.Traverse(keys[i], &node) ? node.node_id() : 0;
+      }
+      return sum;
+    });
+    benchmark->Run("LoudsTrie::ExactSearch" + suffix, trie_name, keys.size(),
+                   [&search_trie, &keys]() {
+      uint64 sum = 0;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        sum += search_trie.ExactSearch(keys[i]);
+      }
+      return sum;
+    });
+    benchmark->Run("LoudsTrie::ExactSearch/miss" + suffix, trie_name,
+                   missing_keys.size(), [&search_trie, &missing_keys]() {
+      uint64 sum = 0;
+      for (size_t i = 0; i < missing_keys.size(); ++i) {
+        sum += search_trie.ExactSearch(missing_keys[i]);
+      }
+      return sum;
+    });
+    benchmark->Run("LoudsTrie::PrefixSearch" + suffix, trie_name,
+                   keys.size(), [&search_trie, &keys]() {
+      uint64 sum = 0;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        search_trie.PrefixSearch(
+            keys[i], [&sum](StringPiece key, StringPiece::size_type len,
+                            const LoudsTrie &found, LoudsTrie::Node node) {
+              sum += found.GetKeyIdOfTerminalNode(node);
+            });
+      }
+      return sum;
+    });
+  }
+
+  // The cache sizes are those of the key trie of the system dictionary.
+  LoudsTrie cached_trie;
+  CHECK(cached_trie.Open(image, 1024, 1024, 4 * 1024, 4 * 1024, 1024));
+  benchmark->Run("LoudsTrie::RestoreKeyString", trie_name, key_ids.size(),
+                 [&cached_trie, &key_ids]() {
+    uint64 sum = 0;
+    char buf[LoudsTrie::kMaxDepth + 1];
+    for (size_t i = 0; i < key_ids.size(); ++i) {
+      sum += cached_trie.RestoreKeyString(key_ids[i], buf).size();
+    }
+    return sum;
+  });
+
+  // Louds over the whole tree: the depth-first traversal visits every node,
+  // and the upward traversal walks from the terminal nodes of the sampled
+  // keys to the root.
+  Louds louds;
+  louds.Init(sections.louds, sections.louds_size);
+  // Every node but the super root has a 1-bit in the LOUDS bit vector.
+  SimpleSuccinctBitVectorIndex louds_index;
+  louds_index.Init(sections.louds, sections.louds_size);
+  const int num_nodes = louds_index.GetNum1Bits();
+  benchmark->Run("Louds::DepthFirstTraversal", trie_name, num_nodes,
+                 [&louds]() {
+    uint64 sum = 0;
+    std::vector<Louds::Node> stack(1);
+    while (!stack.empty()) {
+      Louds::Node node = stack.back();
+      stack.pop_back();
+      if (!louds.IsValidNode(node)) {
+        continue;
+      }
+      sum += node.node_id();
+      Louds::Node sibling = node;
+      Louds::MoveToNextSibling(&sibling);
+      stack.push_back(sibling);
+      louds.MoveToFirstChild(&node);
+      stack.push_back(node);
+    }
+    return sum;
+  });
+  std::vector<int> node_ids(key_ids.size());
+  for (size_t i = 0; i < key_ids.size(); ++i) {
+    node_ids[i] = terminal.Select1(key_ids[i] + 1) + 1;
+  }
+  benchmark->Run("Louds::MoveToParent", trie_name, node_ids.size(),
+                 [&louds, &node_ids]() {
+    uint64 sum = 0;
+    for (size_t i = 0; i < node_ids.size(); ++i) {
+      Louds::Node node;
+      louds.InitNodeFromNodeId(node_ids[i], &node);
+      while (!Louds::IsRoot(node)) {
+        louds.MoveToParent(&node);
+        ++sum;
+      }
+    }
+    return sum;
+  });
+
+  // The index of the LOUDS bit vector without caches, for every
+  // implementation of the bit counting.
+  const int num_bits = sections.louds_size * 8;
+  const std::vector<int> positions = SampleIntegers(num_bits);
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    if (!SimpleSuccinctBitVectorIndex::IsAvailable(kImplementations[i].impl)) {
+      continue;
+    }
+    SimpleSuccinctBitVectorIndex index;
+    index.set_implementation(kImplementations[i].impl);
+    index.Init(sections.louds, sections.louds_size);
+    const std::vector<int> ranks0 = SampleIntegers(index.GetNum0Bits());
+    const std::vector<int> ranks1 = SampleIntegers(index.GetNum1Bits());
+    const string suffix = string("/") + kImplementations[i].name;
+    benchmark->Run("SimpleSuccinctBitVectorIndex::Rank1" + suffix, trie_name,
+                   positions.size(), [&index, &positions]() {
+      uint64 sum = 0;
+      for (size_t j = 0; j < positions.size(); ++j) {
+        sum += index.Rank1(positions[j]);
+      }
+      return sum;
+    });
+    benchmark->Run("SimpleSuccinctBitVectorIndex::Select0" + suffix,
+                   trie_name, ranks0.size(), [&index, &ranks0]() {
+      uint64 sum = 0;
+      for (size_t j = 0; j < ranks0.size(); ++j) {
+        sum += index.Select0(ranks0[j] + 1);
+      }
+      return sum;
+    });
+    benchmark->Run("SimpleSuccinctBitVectorIndex::Select1" + suffix,
+                   trie_name, ranks1.size(), [&index, &ranks1]() {
+      uint64 sum = 0;
+      for (size_t j = 0; j < ranks1.size(); ++j) {
+        sum += index.Select1(ranks1[j] + 1);
+      }
+      return sum;
+    });
+  }
+}
+
+// Measures BitVectorBasedArray::Get() over the token array, which has an
+// element for each key of the key trie.
+void RunArrayBenchmark(const uint8 *image, int num_elements,
+                       Benchmark *benchmark) {
+  BitVectorBasedArray array;
+  array.Open(image);
+  const std::vector<int> indices = SampleIntegers(num_elements);
+  benchmark->Run("BitVectorBasedArray::Get", "tokens", indices.size(),
+                 [&array, &indices]() {
+    uint64 sum = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+      size_t length = 0;
+      array.Get(indices[i], &length);
+      sum += length;
+    }
+    return sum;
+  });
+}
+
+}  // namespace
+}  // namespace louds
+}  // namespace storage
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv, false);
+  using mozc::dictionary::DictionaryFile;
+  using mozc::dictionary::DictionaryFileCodecFactory;
+  using mozc::dictionary::SystemDictionaryCodecFactory;
+  using mozc::dictionary::SystemDictionaryCodecInterface;
+
+  DictionaryFile file(DictionaryFileCodecFactory::GetCodec());
+  // Holds the data of the OSS data set when --dictionary is not given.
+  std::unique_ptr<mozc::oss::OssDataManager> data_manager;
+  if (FLAGS_dictionary.empty()) {
+    data_manager.reset(new mozc::oss::OssDataManager());
+    const char *data = nullptr;
+    int size = 0;
+    data_manager->GetSystemDictionaryData(&data, &size);
+    CHECK(file.OpenFromImage(data, size));
+  } else {
+    CHECK(file.OpenFromFile(FLAGS_dictionary))
+        << "Cannot open " << FLAGS_dictionary;
+  }
+
+  const SystemDictionaryCodecInterface *codec =
+      SystemDictionaryCodecFactory::GetCodec();
+  int len = 0;
+  const uint8 *key_image = reinterpret_cast<const uint8 *>(
+      file.GetSection(codec->GetSectionNameForKey(), &len));
+  const uint8 *value_image = reinterpret_cast<const uint8 *>(
+      file.GetSection(codec->GetSectionNameForValue(), &len));
+  const uint8 *token_image = reinterpret_cast<const uint8 *>(
+      file.GetSection(codec->GetSectionNameForTokens(), &len));
+  CHECK(key_image != nullptr && value_image != nullptr &&
+        token_image != nullptr) << "Broken system dictionary";
+
+  // Fixes the seed so that every run uses the same samples.
+  mozc::Util::SetRandomSeed(0);
+  mozc::storage::louds::Benchmark benchmark(&std::cout);
+  mozc::storage::louds::RunTrieBenchmarks("key", key_image, &benchmark);
+  mozc::storage::louds::RunTrieBenchmarks("value", value_image, &benchmark);
+
+  // The token array has an element for each key.
+  const mozc::storage::louds::TrieImage key_sections =
+      mozc::storage::louds::ParseTrieImage(key_image);
+  mozc::storage::louds::SimpleSuccinctBitVectorIndex key_terminal;
+  key_terminal.Init(key_sections.terminal, key_sections.terminal_size);
+  mozc::storage::louds::RunArrayBenchmark(
+      token_image, key_terminal.GetNum1Bits(), &benchmark);
+  return 0;
+}
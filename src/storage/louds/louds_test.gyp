@@ -101,6 +101,24 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'louds_benchmark',
+      'type': 'executable',
+      'sources': [
+        'louds_benchmark.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../data_manager/oss/oss_data_manager.gyp:oss_data_manager',
+        '../../dictionary/file/dictionary_file.gyp:codec_factory',
+        '../../dictionary/file/dictionary_file.gyp:dictionary_file',
+        '../../dictionary/system/system_dictionary.gyp:system_dictionary_codec',
+        'louds.gyp:bit_vector_based_array',
+        'louds.gyp:louds',
+        'louds.gyp:louds_trie',
+        'louds.gyp:simple_succinct_bit_vector_index',
+      ],
+    },
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
       'target_name': 'storage_louds_all_test',
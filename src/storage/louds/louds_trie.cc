@@ -50,7 +50,8 @@ bool LoudsTrie::Open(const uint8 *image,
                      size_t louds_lb1_cache_size,
                      size_t louds_select0_cache_size,
                      size_t louds_select1_cache_size,
-                     size_t termvec_lb1_cache_size) {
+                     size_t termvec_lb1_cache_size,
+                     int fan_out_depth) {
   // Reads a binary image data, which is compatible with rx.
   // The format is as follows:
   // [trie size: little endian 4byte int]
@@ -91,6 +92,7 @@ bool LoudsTrie::Open(const uint8 *image,
                             0,  // Select0 is not carried out.
                             termvec_lb1_cache_size);
   edge_character_ = reinterpret_cast<const char*>(edge_character);
+  BuildFanOutTable(fan_out_depth);
 
   return true;
 }
@@ -99,9 +101,52 @@ void LoudsTrie::Close() {
   louds_.Reset();
   terminal_bit_vector_.Reset();
   edge_character_ = nullptr;
+  fan_out_table_.clear();
+  fan_out_end_node_id_ = 0;
+}
+
+void LoudsTrie::BuildFanOutTable(int depth) {
+  DCHECK_GE(depth, 0);
+  DCHECK_LE(depth, 2);
+  fan_out_table_.clear();
+  fan_out_end_node_id_ = 0;
+  if (depth <= 0) {
+    return;
+  }
+
+  // The nodes whose children are in the table: the root, and its children at
+  // depth 2.
+  std::vector<Node> parents(1);  // Root
+  if (depth >= 2) {
+    for (Node node = MoveToFirstChild(parents[0]); IsValidNode(node);
+         MoveToNextSibling(&node)) {
+      parents.push_back(node);
+    }
+  }
+  fan_out_table_.resize(256 * parents.size());
+  for (size_t i = 0; i < parents.size(); ++i) {
+    DCHECK_EQ(i + 1, parents[i].node_id());
+    Node *block = &fan_out_table_[256 * i];
+    Node node = MoveToFirstChild(parents[i]);
+    for (; IsValidNode(node); MoveToNextSibling(&node)) {
+      block[static_cast<uint8>(GetEdgeLabelToParentNode(node))] = node;
+    }
+    // Fill the missing labels with the invalid node after the last child.
+    for (size_t label = 0; label < 256; ++label) {
+      if (Louds::IsRoot(block[label])) {
+        block[label] = node;
+      }
+    }
+  }
+  fan_out_end_node_id_ = parents.size() + 1;
 }
 
 bool LoudsTrie::MoveToChildByLabel(char label, Node *node) const {
+  if (node->node_id() < fan_out_end_node_id_) {
+    *node = fan_out_table_[256 * (node->node_id() - 1) +
+                           static_cast<uint8>(label)];
+    return IsValidNode(*node);
+  }
   MoveToFirstChild(node);
   while (IsValidNode(*node)) {
     if (GetEdgeLabelToParentNode(*node) == label) {
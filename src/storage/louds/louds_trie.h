@@ -31,6 +31,7 @@
 #define MOZC_STORAGE_LOUDS_LOUDS_TRIE_H_
 
 #include <memory>
+#include <vector>
 
 #include "base/port.h"
 #include "base/string_piece.h"
@@ -49,21 +50,38 @@ class LoudsTrie {
   // This class stores a traversal state.
   typedef Louds::Node Node;
 
-  LoudsTrie() : edge_character_(nullptr) {}
+  LoudsTrie() : edge_character_(nullptr), fan_out_end_node_id_(0) {}
   ~LoudsTrie() {}
 
   // Opens the binary image and constructs the data structure.  The first four
   // cache sizes are passed to the underlying LOUDS.  See louds.h for more
-  // information of cache size.  The last one is passed to the underlying
+  // information of cache size.  The next one is passed to the underlying
   // terminal bit vector.  This class doesn't own the "data", so it is caller's
   // reponsibility to keep the data alive until Close is invoked.  See .cc file
   // for the detailed format of the binary image.
+  //
+  // If |fan_out_depth| is 1 or 2, a table mapping the edge labels of the top
+  // one or two levels directly to the child nodes is built, so that
+  // MoveToChildByLabel() from such nodes doesn't scan the siblings.  The table
+  // takes 2KB for the root plus 2KB for each child of the root at depth 2.
+  bool Open(const uint8 *data,
+            size_t louds_lb0_cache_size,
+            size_t louds_lb1_cache_size,
+            size_t louds_select0_cache_size,
+            size_t louds_select1_cache_size,
+            size_t termvec_lb1_cache_size,
+            int fan_out_depth);
+
   bool Open(const uint8 *data,
             size_t louds_lb0_cache_size,
             size_t louds_lb1_cache_size,
             size_t louds_select0_cache_size,
             size_t louds_select1_cache_size,
-            size_t termvec_lb1_cache_size);
+            size_t termvec_lb1_cache_size) {
+    return Open(data, louds_lb0_cache_size, louds_lb1_cache_size,
+                louds_select0_cache_size, louds_select1_cache_size,
+                termvec_lb1_cache_size, 0);
+  }
 
   bool Open(const uint8 *data) {
     return Open(data, 0, 0, 0, 0, 0);
@@ -210,6 +228,15 @@ class LoudsTrie {
   // In other words, id=2 in louds_ corresponds to edge_character_[1].
   const char *edge_character_;
 
+  // fan_out_table_[256 * (id - 1) + label] is the child of the node of |id|
+  // with |label|, or the invalid node that MoveToChildByLabel() would end at,
+  // for the node IDs less than fan_out_end_node_id_.  Since the node IDs are
+  // assigned in BFS order, the root (ID 1) and its children are contiguous.
+  std::vector<Node> fan_out_table_;
+  int fan_out_end_node_id_;
+
+  void BuildFanOutTable(int depth);
+
   DISALLOW_COPY_AND_ASSIGN(LoudsTrie);
 };
 
@@ -30,6 +30,7 @@
 #include "storage/louds/louds_trie_builder.h"
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include "base/logging.h"
@@ -51,34 +52,95 @@ void LoudsTrieBuilder::Add(const string &word) {
 
 namespace {
 
-// A pair of word and its original index in the (sorted) word_list_.
-class Entry {
- public:
-  Entry(const string &word, size_t original_index)
-      : word_(&word), original_index_(original_index) {
-  }
-
-  const string &word() const { return *word_; }
-  size_t original_index() const { return original_index_; }
+// Sorts the words shorter than this by std::sort in RadixSort.
+const ptrdiff_t kMinRadixSortSize = 32;
 
- private:
-  const string *word_;
-  size_t original_index_;
-};
+// Returns the bucket of |word| for the byte at |depth|.  The words ending
+// before |depth| come first, as in the lexicographical order.
+inline size_t GetBucket(const string &word, size_t depth) {
+  return depth < word.size() ? static_cast<uint8>(word[depth]) + 1 : 0;
+}
 
-class EntryLengthLessThan {
- public:
-  explicit EntryLengthLessThan(size_t length) : length_(length) {
+// Sorts [begin, end) in the lexicographical order of std::string by the
+// in-place MSD radix sort (American flag sort).  The words must share the
+// first |depth| bytes.
+void RadixSort(string *begin, string *end, size_t depth) {
+  while (end - begin >= kMinRadixSortSize) {
+    const size_t kNumBuckets = 257;
+    size_t counts[kNumBuckets] = {};
+    for (const string *it = begin; it != end; ++it) {
+      ++counts[GetBucket(*it, depth)];
+    }
+    string *bucket_begin[kNumBuckets];
+    string *bucket_next[kNumBuckets];
+    string *pos = begin;
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      bucket_begin[b] = bucket_next[b] = pos;
+      pos += counts[b];
+    }
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      string *const bucket_end = bucket_begin[b] + counts[b];
+      while (bucket_next[b] != bucket_end) {
+        string *it = bucket_next[b];
+        const size_t target = GetBucket(*it, depth);
+        if (target == b) {
+          ++bucket_next[b];
+        } else {
+          it->swap(*bucket_next[target]++);
+        }
+      }
+    }
+    // The words in the bucket 0 are equal.  Recurse into the buckets but the
+    // largest one, which is handled by the loop.
+    size_t largest = 1;
+    for (size_t b = 2; b < kNumBuckets; ++b) {
+      if (counts[b] > counts[largest]) {
+        largest = b;
+      }
+    }
+    for (size_t b = 1; b < kNumBuckets; ++b) {
+      if (b != largest && counts[b] > 1) {
+        RadixSort(bucket_begin[b], bucket_begin[b] + counts[b], depth + 1);
+      }
+    }
+    begin = bucket_begin[largest];
+    end = begin + counts[largest];
+    ++depth;
   }
+  std::sort(begin, end);
+}
 
-  bool operator()(const Entry &entry) {
-    return entry.word().length() < length_;
+// Returns the length of the longest common prefix.
+size_t GetCommonPrefixLength(const string &a, const string &b) {
+  const size_t size = min(a.size(), b.size());
+  size_t i = 0;
+  while (i < size && a[i] == b[i]) {
+    ++i;
   }
+  return i;
+}
 
- private:
-  size_t length_;
+// A word in the (sorted) word_list_ being output.
+struct Entry {
+  const string *word;
+  // The index in the word_list_.
+  size_t original_index;
+  // The length of the common prefix with the previous entry in the list.
+  size_t common_prefix_length;
+  // The length of the word as a C string, i.e. up to the first '\0'.
+  size_t c_str_length;
 };
 
+// Returns true if the first |length| bytes of |entry| equal those of |prev|,
+// which is the previous entry of |entry|.  Note that the words have been
+// compared with |prev| truncated at the first '\0' so keep the behavior not
+// to change the output.
+inline bool HasSamePrefix(const Entry &prev, const Entry &entry,
+                          size_t length) {
+  return entry.common_prefix_length >= length &&
+         prev.c_str_length >= length;
+}
+
 void PushInt(size_t value, string* image) {
   // Make sure the value is fit in the 32-bit value.
   CHECK_EQ(value & ~0xFFFFFFFF, 0);
@@ -95,13 +157,18 @@ void LoudsTrieBuilder::Build() {
   CHECK(!built_);
 
   // Initialize for the build. Sort and de-dup the words.
-  std::sort(word_list_.begin(), word_list_.end());
+  if (!word_list_.empty()) {
+    RadixSort(&word_list_[0], &word_list_[0] + word_list_.size(), 0);
+  }
   word_list_.erase(std::unique(word_list_.begin(), word_list_.end()),
                    word_list_.end());
-  std::vector<Entry> entry_list;
-  entry_list.reserve(word_list_.size());
+  std::vector<Entry> entry_list(word_list_.size());
   for (size_t i = 0; i < word_list_.size(); ++i) {
-    entry_list.push_back(Entry(word_list_[i], i));
+    entry_list[i].word = &word_list_[i];
+    entry_list[i].original_index = i;
+    entry_list[i].common_prefix_length =
+        i == 0 ? 0 : GetCommonPrefixLength(word_list_[i - 1], word_list_[i]);
+    entry_list[i].c_str_length = strlen(word_list_[i].c_str());
   }
   id_list_.resize(word_list_.size(), - 1);
 
@@ -155,27 +222,28 @@ void LoudsTrieBuilder::Build() {
   // depth, and skip "edge check" for the entries.
   // This doesn't break the edge check condition, and stop bit check condition,
   // but adds a chance to output stop bits for leaves.
+  //
+  // The prefixes are compared by the length of the common prefix with the
+  // previous entry, which is kept up to date on removing entries: for sorted
+  // words a <= b <= c, the common prefix of a and c is the shorter one of
+  // those of (a, b) and (b, c).
   int id = 0;
   for (size_t depth = 0; !entry_list.empty(); ++depth) {
     for (size_t i = 0; i < entry_list.size(); ++i) {
-      const string &word = entry_list[i].word();
+      const string &word = *entry_list[i].word;
       if (word.length() > depth &&
-          (i == 0 ||
-           // To ensure the entry_list[i - 1].word().length >= depth + 1,
-           // we call c_str() (which adds '\0' if necessary) as a hack.
-           word.compare(
-               0, depth + 1,
-               entry_list[i - 1].word().c_str(), 0, depth + 1) != 0)) {
+          (i == 0 || !HasSamePrefix(entry_list[i - 1], entry_list[i],
+                                    depth + 1))) {
         // This is the first string of this node. Output an edge.
         trie_stream.PushBit(1);
-        edge_character.push_back(entry_list[i].word()[depth]);
+        edge_character.push_back(word[depth]);
 
-        if (entry_list[i].word().length() == depth + 1) {
+        if (word.length() == depth + 1) {
           // This is a terminal node.
           // Note that the terminal string should be at the first of
           // strings sharing the node. So the check above should work well.
           terminal_stream.PushBit(1);
-          id_list_[entry_list[i].original_index()] = id;
+          id_list_[entry_list[i].original_index] = id;
           ++id;
         } else {
           // This is not a terminal node.
@@ -184,16 +252,33 @@ void LoudsTrieBuilder::Build() {
       }
 
       if (i == entry_list.size() - 1 ||
-          word.compare(0, depth, entry_list[i + 1].word(), 0, depth) != 0) {
+          entry_list[i + 1].common_prefix_length < depth) {
         // This is the last child (string) for the parent.
         trie_stream.PushBit(0);
       }
     }
 
     // Remove all terminal strings.
-    entry_list.erase(std::remove_if(entry_list.begin(), entry_list.end(),
-                                    EntryLengthLessThan(depth + 1)),
-                     entry_list.end());
+    size_t num_entries = 0;
+    size_t common_prefix_length = 0;
+    bool removed = false;
+    for (size_t i = 0; i < entry_list.size(); ++i) {
+      if (entry_list[i].word->length() < depth + 1) {
+        common_prefix_length = removed ?
+            min(common_prefix_length, entry_list[i].common_prefix_length) :
+            entry_list[i].common_prefix_length;
+        removed = true;
+        continue;
+      }
+      entry_list[num_entries] = entry_list[i];
+      if (removed) {
+        entry_list[num_entries].common_prefix_length =
+            min(common_prefix_length, entry_list[i].common_prefix_length);
+        removed = false;
+      }
+      ++num_entries;
+    }
+    entry_list.resize(num_entries);
   }
 
   // Set 32-bits alignment.
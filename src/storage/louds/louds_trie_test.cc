@@ -29,6 +29,8 @@
 
 #include "storage/louds/louds_trie.h"
 
+#include <cstdlib>
+#include <string>
 #include <vector>
 
 #include "base/port.h"
@@ -552,6 +554,65 @@ TEST_P(LoudsTrieTest, RestoreKeyString) {
 }
 INSTANTIATE_TEST_CASE(GenRestoreKeyStringTest);
 
+// The fan-out table must not change the result of any traversal.
+TEST(LoudsTrieTest, FanOutTable) {
+  srand(0);
+  std::vector<string> keys;
+  LoudsTrieBuilder builder;
+  for (int i = 0; i < 2000; ++i) {
+    // Use a small alphabet with a few high bytes so that the top levels are
+    // dense and the labels cover both signed and unsigned char values.
+    string key;
+    const int length = 1 + rand() % 5;
+    for (int j = 0; j < length; ++j) {
+      key += static_cast<char>((rand() % 2 == 0) ? 'a' + rand() % 20
+                                                  : 0xE0 + rand() % 8);
+    }
+    keys.push_back(key);
+    builder.Add(key);
+  }
+  builder.Build();
+  const uint8 *image = reinterpret_cast<const uint8 *>(builder.image().data());
+
+  LoudsTrie expected;
+  expected.Open(image);
+  for (int depth = 1; depth <= 2; ++depth) {
+    LoudsTrie trie;
+    trie.Open(image, 0, 0, 0, 0, 0, depth);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      // Look up a registered key and a key that may not be in the trie.
+      const string queries[] = {keys[i], keys[i] + keys[(i + 1) % keys.size()],
+                                keys[i].substr(0, 1) + "z"};
+      for (size_t j = 0; j < arraysize(queries); ++j) {
+        const string &query = queries[j];
+        EXPECT_EQ(expected.ExactSearch(query), trie.ExactSearch(query))
+            << depth << ", " << query;
+
+        std::vector<RecordCallbackArgs::CallbackArgs> expected_args, args;
+        expected.PrefixSearch(query, RecordCallbackArgs(&expected_args));
+        trie.PrefixSearch(query, RecordCallbackArgs(&args));
+        ASSERT_EQ(expected_args.size(), args.size()) << depth << ", " << query;
+        for (size_t k = 0; k < args.size(); ++k) {
+          EXPECT_EQ(expected_args[k].prefix_len, args[k].prefix_len);
+          EXPECT_EQ(expected_args[k].node, args[k].node);
+        }
+
+        // Failed moves end at the same invalid node.
+        LoudsTrie::Node expected_node, node;
+        for (size_t k = 0; k < query.size(); ++k) {
+          const bool found = expected.MoveToChildByLabel(query[k],
+                                                         &expected_node);
+          ASSERT_EQ(found, trie.MoveToChildByLabel(query[k], &node));
+          ASSERT_EQ(expected_node, node);
+          if (!found) {
+            break;
+          }
+        }
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace louds
 }  // namespace storage
@@ -30,6 +30,7 @@
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <vector>
 
@@ -37,6 +38,20 @@
 #include "base/logging.h"
 #include "base/port.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MOZC_LOUDS_X86_64
+#include <immintrin.h>
+// The tree is built without -mpopcnt or -mbmi2, so the functions using them
+// are compiled for the instruction sets individually and are called only if
+// the CPU supports them.
+#define MOZC_LOUDS_TARGET(name) __attribute__((target(name)))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define MOZC_LOUDS_X86_64
+#include <intrin.h>
+#include <immintrin.h>
+#define MOZC_LOUDS_TARGET(name)
+#endif
+
 namespace mozc {
 namespace storage {
 namespace louds {
@@ -64,7 +79,6 @@ class ZeroBitAdapter : public AdapterBase<int> {
 };
 
 #ifdef __GNUC__
-// TODO(hidehiko): Support XMM and 64-bits popcount for 64bits architectures.
 inline int BitCount1(uint32 x) {
   return __builtin_popcount(x);
 }
@@ -128,6 +142,193 @@ void InitIndex(
   CHECK_EQ(chunk_length + 1, index->size());
 }
 
+inline uint64 LoadWord64(const uint8 *ptr) {
+  // The data is aligned only to 32 bits.
+  uint64 word;
+  memcpy(&word, ptr, sizeof(word));
+  return word;
+}
+
+inline uint32 LoadWord32(const uint8 *ptr) {
+  return *reinterpret_cast<const uint32 *>(ptr);
+}
+
+// Returns the position of the n-th (1-origin) 1-bit in |word|, which must
+// have at least n 1-bits.  The byte containing the bit is found from the
+// prefix sums of the byte-wise popcounts, so that at most 8 bits are scanned.
+inline int SelectInWordBroadword(uint64 word, int n) {
+  uint64 sums = word - ((word >> 1) & 0x5555555555555555ULL);
+  sums = (sums & 0x3333333333333333ULL) +
+         ((sums >> 2) & 0x3333333333333333ULL);
+  sums = (sums + (sums >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  // The k-th byte is the number of 1-bits in the bytes [0, k].
+  sums *= 0x0101010101010101ULL;
+  int shift = 0;
+  while (shift < 56 && static_cast<int>((sums >> shift) & 0xFF) < n) {
+    shift += 8;
+  }
+  if (shift > 0) {
+    n -= static_cast<int>((sums >> (shift - 8)) & 0xFF);
+  }
+  for (uint32 byte = (word >> shift) & 0xFF; ; byte >>= 1, ++shift) {
+    n -= byte & 1;
+    if (n == 0) {
+      return shift;
+    }
+  }
+}
+
+// The bit operations on words used by the PORTABLE implementation.
+struct PortableOps {
+  static int PopCount(uint64 x) {
+#if defined(__GNUC__) && !defined(__x86_64__) && !defined(__i386__)
+    // Compiled to vcnt/cnt on ARM with NEON.
+    return __builtin_popcountll(x);
+#else
+    // Without -mpopcnt, GCC calls a table-based function in libgcc for the
+    // builtin, which is slower than the inlined arithmetic.
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  static int Select(uint64 word, int n) {
+    return SelectInWordBroadword(word, n);
+  }
+};
+
+#ifdef MOZC_LOUDS_X86_64
+struct PopcntOps {
+  static int PopCount(uint64 x) {
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(x));
+#else
+    return __builtin_popcountll(x);
+#endif  // _MSC_VER
+  }
+
+  static int Select(uint64 word, int n) {
+    return SelectInWordBroadword(word, n);
+  }
+};
+
+struct Bmi2Ops {
+  static int PopCount(uint64 x) {
+    return PopcntOps::PopCount(x);
+  }
+
+  // pdep deposits the n-th bit of the mask to the position of the n-th 1-bit
+  // of |word|.
+  MOZC_LOUDS_TARGET("bmi,bmi2") static int Select(uint64 word, int n) {
+    return static_cast<int>(_tzcnt_u64(_pdep_u64(1ULL << (n - 1), word)));
+  }
+};
+#endif  // MOZC_LOUDS_X86_64
+
+// Returns the number of 1-bits in the first |num_bits| bits from |ptr|.
+template <typename Ops>
+inline int CountBits1(const uint8 *ptr, int num_bits) {
+  int result = 0;
+  for (; num_bits >= 64; ptr += 8, num_bits -= 64) {
+    result += Ops::PopCount(LoadWord64(ptr));
+  }
+  // Read the rest in 32 bits not to go beyond the data.
+  if (num_bits >= 32) {
+    result += Ops::PopCount(LoadWord32(ptr));
+    ptr += 4;
+    num_bits -= 32;
+  }
+  if (num_bits > 0) {
+    result += Ops::PopCount(
+        static_cast<uint32>(LoadWord32(ptr) << (32 - num_bits)));
+  }
+  return result;
+}
+
+// Returns the offset from |ptr| of the n-th (1-origin) |kBit| in
+// [ptr, end).  The bit must exist.
+template <typename Ops, int kBit>
+inline int SelectBits(const uint8 *ptr, const uint8 *end, int n) {
+  int offset = 0;
+  for (; ptr + 8 <= end; ptr += 8, offset += 64) {
+    const uint64 word = kBit ? LoadWord64(ptr) : ~LoadWord64(ptr);
+    const int bit_count = Ops::PopCount(word);
+    if (bit_count >= n) {
+      return offset + Ops::Select(word, n);
+    }
+    n -= bit_count;
+  }
+  // The last 32 bits of the data.
+  DCHECK(ptr + 4 <= end);
+  const uint32 word = kBit ? LoadWord32(ptr) : ~LoadWord32(ptr);
+  DCHECK_GE(Ops::PopCount(word), n);
+  return offset + Ops::Select(word, n);
+}
+
+int CountBits1Portable(const uint8 *ptr, int num_bits) {
+  return CountBits1<PortableOps>(ptr, num_bits);
+}
+
+int SelectBits0Portable(const uint8 *ptr, const uint8 *end, int n) {
+  return SelectBits<PortableOps, 0>(ptr, end, n);
+}
+
+int SelectBits1Portable(const uint8 *ptr, const uint8 *end, int n) {
+  return SelectBits<PortableOps, 1>(ptr, end, n);
+}
+
+#ifdef MOZC_LOUDS_X86_64
+MOZC_LOUDS_TARGET("popcnt")
+int CountBits1Popcnt(const uint8 *ptr, int num_bits) {
+  return CountBits1<PopcntOps>(ptr, num_bits);
+}
+
+MOZC_LOUDS_TARGET("popcnt")
+int SelectBits0Popcnt(const uint8 *ptr, const uint8 *end, int n) {
+  return SelectBits<PopcntOps, 0>(ptr, end, n);
+}
+
+MOZC_LOUDS_TARGET("popcnt")
+int SelectBits1Popcnt(const uint8 *ptr, const uint8 *end, int n) {
+  return SelectBits<PopcntOps, 1>(ptr, end, n);
+}
+
+MOZC_LOUDS_TARGET("popcnt,bmi,bmi2")
+int SelectBits0Bmi2(const uint8 *ptr, const uint8 *end, int n) {
+  return SelectBits<Bmi2Ops, 0>(ptr, end, n);
+}
+
+MOZC_LOUDS_TARGET("popcnt,bmi,bmi2")
+int SelectBits1Bmi2(const uint8 *ptr, const uint8 *end, int n) {
+  return SelectBits<Bmi2Ops, 1>(ptr, end, n);
+}
+
+bool CpuSupportsPopcnt() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 23)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("popcnt");
+#endif  // _MSC_VER
+}
+
+bool CpuSupportsBmi2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, 7, 0);
+  // BMI1 for tzcnt and BMI2 for pdep.
+  return (info[1] & (1 << 3)) != 0 && (info[1] & (1 << 8)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+#endif  // _MSC_VER
+}
+#endif  // MOZC_LOUDS_X86_64
+
 void InitLowerBound0Cache(const std::vector<int> &index, int chunk_size,
                           size_t increment, size_t size,
                           std::vector<const int *> *cache) {
@@ -165,6 +366,63 @@ void InitLowerBound1Cache(const std::vector<int> &index, int chunk_size,
 
 }  // namespace
 
+struct SimpleSuccinctBitVectorIndex::WordOps {
+  // Returns the number of 1-bits in the first |num_bits| bits from |ptr|.
+  int (*count_bits1)(const uint8 *ptr, int num_bits);
+  // Return the bit offset from |ptr| of the n-th 0-bit and 1-bit in
+  // [ptr, end), respectively.
+  int (*select_bits0)(const uint8 *ptr, const uint8 *end, int n);
+  int (*select_bits1)(const uint8 *ptr, const uint8 *end, int n);
+};
+
+const SimpleSuccinctBitVectorIndex::WordOps *
+SimpleSuccinctBitVectorIndex::GetWordOps(Implementation impl) {
+  DCHECK(IsAvailable(impl)) << impl;
+  static const WordOps kPortableOps = {
+      &CountBits1Portable, &SelectBits0Portable, &SelectBits1Portable,
+  };
+#ifdef MOZC_LOUDS_X86_64
+  static const WordOps kPopcntOps = {
+      &CountBits1Popcnt, &SelectBits0Popcnt, &SelectBits1Popcnt,
+  };
+  static const WordOps kBmi2Ops = {
+      &CountBits1Popcnt, &SelectBits0Bmi2, &SelectBits1Bmi2,
+  };
+  switch (impl) {
+    case POPCNT:
+      return &kPopcntOps;
+    case BMI2:
+      return &kBmi2Ops;
+    default:
+      break;
+  }
+#endif  // MOZC_LOUDS_X86_64
+  return &kPortableOps;
+}
+
+SimpleSuccinctBitVectorIndex::Implementation
+SimpleSuccinctBitVectorIndex::GetDefaultImplementation() {
+  static const Implementation kDefault =
+      IsAvailable(BMI2) ? BMI2 :
+      IsAvailable(POPCNT) ? POPCNT : PORTABLE;
+  return kDefault;
+}
+
+bool SimpleSuccinctBitVectorIndex::IsAvailable(Implementation impl) {
+  switch (impl) {
+    case PORTABLE:
+      return true;
+#ifdef MOZC_LOUDS_X86_64
+    case POPCNT:
+      return CpuSupportsPopcnt();
+    case BMI2:
+      return CpuSupportsPopcnt() && CpuSupportsBmi2();
+#endif  // MOZC_LOUDS_X86_64
+    default:
+      return false;
+  }
+}
+
 void SimpleSuccinctBitVectorIndex::Init(const uint8 *data, int length,
                                         size_t lb0_cache_size,
                                         size_t lb1_cache_size) {
@@ -204,22 +462,11 @@ void SimpleSuccinctBitVectorIndex::Reset() {
 int SimpleSuccinctBitVectorIndex::Rank1(int n) const {
   // Look up pre-computed 1-bits for the preceding chunks.
   const int num_chunks = n / (chunk_size_ * 8);
-  int result = index_[n / (chunk_size_ * 8)];
-
-  // Count 1-bits for remaining "words".
-  result += Count1Bits(
-      reinterpret_cast<const uint32 *>(data_ + num_chunks * chunk_size_),
-      (n / 8 - num_chunks * chunk_size_) / 4);
-
-  // Count 1-bits for remaining "bits".
-  if (n % 32 > 0) {
-    const int index = n / 32;
-    const int shift = 32 - n % 32;
-    result +=
-        BitCount1(reinterpret_cast<const uint32 *>(data_)[index] << shift);
-  }
+  const int result = index_[num_chunks];
 
-  return result;
+  // Count 1-bits for remaining bits.
+  return result + word_ops_->count_bits1(data_ + num_chunks * chunk_size_,
+                                         n - num_chunks * chunk_size_ * 8);
 }
 
 int SimpleSuccinctBitVectorIndex::Select0(int n) const {
@@ -243,26 +490,10 @@ int SimpleSuccinctBitVectorIndex::Select0(int n) const {
   DCHECK_GE(chunk_index, 0);
   n -= chunk_size_ * 8 * chunk_index - index_[chunk_index];
 
-  // Linear search on remaining "words"
-  const uint32 *ptr =
-      reinterpret_cast<const uint32 *>(data_) + chunk_index * chunk_size_ / 4;
-  while (true) {
-    const int bit_count = BitCount0(*ptr);
-    if (bit_count >= n) {
-      break;
-    }
-    n -= bit_count;
-    ++ptr;
-  }
-
-  int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
-  for (uint32 word = ~(*ptr); n > 0; word >>= 1, ++index) {
-    n -= (word & 1);
-  }
-
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
+  // Search on remaining words.
+  return chunk_size_ * 8 * chunk_index +
+         word_ops_->select_bits0(data_ + chunk_index * chunk_size_,
+                                 data_ + length_, n);
 }
 
 int SimpleSuccinctBitVectorIndex::Select1(int n) const {
@@ -282,26 +513,23 @@ int SimpleSuccinctBitVectorIndex::Select1(int n) const {
   DCHECK_GE(chunk_index, 0);
   n -= index_[chunk_index];
 
-  // Linear search on remaining "words"
-  const uint32 *ptr =
-      reinterpret_cast<const uint32 *>(data_) + chunk_index * chunk_size_ / 4;
-  while (true) {
-    const int bit_count = BitCount1(*ptr);
-    if (bit_count >= n) {
-      break;
-    }
-    n -= bit_count;
-    ++ptr;
-  }
-
-  int index = (ptr - reinterpret_cast<const uint32 *>(data_)) * 32;
-  for (uint32 word = *ptr; n > 0; word >>= 1, ++index) {
-    n -= (word & 1);
-  }
+  // Search on remaining words.
+  return chunk_size_ * 8 * chunk_index +
+         word_ops_->select_bits1(data_ + chunk_index * chunk_size_,
+                                 data_ + length_, n);
+}
 
-  // Index points to the "next bit" of the target one.
-  // Thus, subtract one to adjust.
-  return index - 1;
+int SimpleSuccinctBitVectorIndex::Select0From(int position, int n) const {
+  DCHECK_GT(n, 0);
+  DCHECK_GE(position, 0);
+
+  // Start from the 32-bit word containing the position, and count the 0-bits
+  // before the position in the word as well.
+  const int word_index = position / 32;
+  const uint8 *ptr = data_ + word_index * 4;
+  const int num_skipped_bits = position % 32;
+  n += num_skipped_bits - word_ops_->count_bits1(ptr, num_skipped_bits);
+  return word_index * 32 + word_ops_->select_bits0(ptr, data_ + length_, n);
 }
 
 }  // namespace louds
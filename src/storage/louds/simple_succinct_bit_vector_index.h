@@ -40,13 +40,24 @@ namespace louds {
 // This is simple(naive) C++ implementation of succinct bit vector.
 class SimpleSuccinctBitVectorIndex {
  public:
+  // Implementations of the counting and the in-word selection of bits.  The
+  // fastest one available on the CPU is used by default.  PORTABLE processes
+  // 64-bit words with broadword arithmetic, POPCNT uses the popcnt
+  // instruction, and BMI2 additionally uses pdep for the in-word selection.
+  enum Implementation {
+    PORTABLE,
+    POPCNT,
+    BMI2,
+  };
+
   // The default chunk_size is 32.
   SimpleSuccinctBitVectorIndex()
       : data_(nullptr),
         length_(0),
         chunk_size_(32),
         lb0_cache_increment_(1),
-        lb1_cache_increment_(1) {}
+        lb1_cache_increment_(1),
+        word_ops_(GetWordOps(GetDefaultImplementation())) {}
 
   // chunk_size is in bytes, and must be greater than or equal to 4
   // and power of 2, at the moment, although we may relax the restriction
@@ -56,7 +67,20 @@ class SimpleSuccinctBitVectorIndex {
         length_(0),
         chunk_size_(chunk_size),
         lb0_cache_increment_(1),
-        lb1_cache_increment_(1) {}
+        lb1_cache_increment_(1),
+        word_ops_(GetWordOps(GetDefaultImplementation())) {}
+
+  // Returns the fastest implementation available on this machine.
+  static Implementation GetDefaultImplementation();
+
+  // Returns true if |impl| can run on this machine.
+  static bool IsAvailable(Implementation impl);
+
+  // Overrides the implementation, which must be available.  Exposed for
+  // testing.
+  void set_implementation(Implementation impl) {
+    word_ops_ = GetWordOps(impl);
+  }
 
   // Initializes the index. This class doesn't have the ownership of the memory
   // pointed by data, so it is caller's responsibility to manage its life time.
@@ -95,10 +119,25 @@ class SimpleSuccinctBitVectorIndex {
   // Returned index is 0-origin.
   int Select1(int n) const;
 
+  // Returns the position of n-th 0-bit at or after |position| (n is
+  // 1-origin).  This scans the words from |position| without the index, so
+  // it's faster than Select0 when the bit is known to be close.
+  int Select0From(int position, int n) const;
+
+  // Returns the bytes allocated for the index, excluding the bit vector.
+  size_t GetAllocatedBytes() const {
+    return index_.capacity() * sizeof(int) +
+           (lb0_cache_.capacity() + lb1_cache_.capacity()) *
+           sizeof(const int *);
+  }
+
   int GetNum1Bits() const { return index_.back(); }
   int GetNum0Bits() const { return 8 * length_ - index_.back(); }
 
  private:
+  struct WordOps;
+  static const WordOps *GetWordOps(Implementation impl);
+
   const uint8 *data_;
   int length_;
   int chunk_size_;
@@ -108,6 +147,7 @@ class SimpleSuccinctBitVectorIndex {
   std::vector<const int *> lb0_cache_;
   int lb1_cache_increment_;
   std::vector<const int *> lb1_cache_;
+  const WordOps *word_ops_;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleSuccinctBitVectorIndex);
 };
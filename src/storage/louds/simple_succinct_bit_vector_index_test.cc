@@ -29,6 +29,9 @@
 
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 
+#include <cstdlib>
+#include <vector>
+
 #include "testing/base/public/gunit.h"
 
 namespace {
@@ -190,4 +193,65 @@ TEST_P(SimpleSuccinctBitVectorIndexTest, Pattern2) {
 }
 INSTANTIATE_TEST_CASE(GenPattern2Test);
 
+// Every implementation must agree with the naive counting, including the
+// chunks not aligned to 64 bits and the data whose length is not a multiple
+// of 8 bytes.
+TEST(SimpleSuccinctBitVectorIndexImplementationTest, CompareWithNaiveCount) {
+  const SimpleSuccinctBitVectorIndex::Implementation kImplementations[] = {
+      SimpleSuccinctBitVectorIndex::PORTABLE,
+      SimpleSuccinctBitVectorIndex::POPCNT,
+      SimpleSuccinctBitVectorIndex::BMI2,
+  };
+  const int kChunkSizes[] = {4, 8, 32};
+  srand(0);
+  // 4 * 101 bytes, i.e., has a trailing 32-bit word.
+  std::vector<uint32> words(101);
+  for (size_t i = 0; i < words.size(); ++i) {
+    // Mix sparse and dense words.
+    words[i] = (i % 3 == 0) ? (1u << (rand() % 32)) : rand() * 2654435761u;
+  }
+  const uint8 *data = reinterpret_cast<const uint8 *>(words.data());
+  const int num_bits = words.size() * 32;
+
+  std::vector<int> rank1(num_bits + 1, 0);
+  std::vector<int> select0, select1;
+  for (int i = 0; i < num_bits; ++i) {
+    const bool bit = (data[i / 8] >> (i % 8)) & 1;
+    rank1[i + 1] = rank1[i] + bit;
+    (bit ? &select1 : &select0)->push_back(i);
+  }
+
+  for (size_t i = 0; i < arraysize(kImplementations); ++i) {
+    if (!SimpleSuccinctBitVectorIndex::IsAvailable(kImplementations[i])) {
+      continue;
+    }
+    for (size_t j = 0; j < arraysize(kChunkSizes); ++j) {
+      SimpleSuccinctBitVectorIndex bit_vector(kChunkSizes[j]);
+      bit_vector.set_implementation(kImplementations[i]);
+      bit_vector.Init(data, words.size() * 4, 8, 8);
+      for (int n = 0; n <= num_bits; ++n) {
+        ASSERT_EQ(rank1[n], bit_vector.Rank1(n))
+            << kImplementations[i] << ", " << kChunkSizes[j] << ", " << n;
+      }
+      for (size_t n = 0; n < select0.size(); ++n) {
+        ASSERT_EQ(select0[n], bit_vector.Select0(n + 1))
+            << kImplementations[i] << ", " << kChunkSizes[j] << ", " << n;
+      }
+      for (size_t n = 0; n < select1.size(); ++n) {
+        ASSERT_EQ(select1[n], bit_vector.Select1(n + 1))
+            << kImplementations[i] << ", " << kChunkSizes[j] << ", " << n;
+      }
+      for (int position = 0; position < num_bits; position += 7) {
+        const int num_0bits = position - rank1[position];
+        for (int n = 1; n <= 70 && num_0bits + n <= static_cast<int>(select0.size()); ++n) {
+          ASSERT_EQ(select0[num_0bits + n - 1],
+                    bit_vector.Select0From(position, n))
+              << kImplementations[i] << ", " << kChunkSizes[j] << ", "
+              << position << ", " << n;
+        }
+      }
+    }
+  }
+}
+
 }  // namespace
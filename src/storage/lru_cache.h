@@ -31,8 +31,8 @@
 #define MOZC_STORAGE_LRU_CACHE_H_
 
 #include <cstring>
-#include <map>
 #include <string>
+#include <unordered_map>
 
 #include "base/logging.h"
 #include "base/port.h"
@@ -70,6 +70,12 @@ class LRUCache {
   // Caller needs to set the value
   Element* Insert(const Key &key);
 
+  // Adds the specified key at the tail of the LRU list, i.e., as the least
+  // recently used one, and returns the Element added to the cache.  Unlike
+  // Insert(), no entry is evicted; returns NULL if the key is already in the
+  // cache or the cache is full.  Caller needs to set the value.
+  Element* InsertAtTail(const Key &key);
+
   // Returns the cached value associated with the key, or NULL if the cache
   // does not contain an entry for that key.  The caller does not assume
   // ownership of the returned value.  The reference returned by Lookup() could
@@ -96,6 +102,10 @@ class LRUCache {
   // Returns the number of entries currently in the cache.
   size_t Size() const;
 
+  // Returns the bytes of the elements allocated so far and the hash table,
+  // not including the memory owned by the keys and the values.
+  size_t GetAllocatedBytes() const;
+
   bool HasKey(const Key &key) const;
 
   // Returns the head of LRU list
@@ -132,12 +142,18 @@ class LRUCache {
   // Adds the specified element to the head of the LRU list.
   void PushLRUHead(Element* element);
 
+  // Adds the specified element, which is not in the LRU list, to the tail of
+  // the LRU list.
+  void PushLRUTail(Element* element);
+
   // Evict is similar to Erase, except that it adds the eviction callback and
   // element to a list of eviction calls, and takes an element so that another
   // lookup is not necessary.
   bool Evict(Element* element);
 
-  typedef std::map<Key, Element*> Table;
+  // Hashed, since the order of the keys is never used.  Key needs
+  // std::hash.
+  typedef std::unordered_map<Key, Element*> Table;
 
   Table* table_;
   Element* free_list_;     // singly linked list of Element
@@ -266,6 +282,19 @@ void LRUCache<Key, Value>::PushLRUHead(Element* element) {
   }
 }
 
+template<typename Key, typename Value>
+void LRUCache<Key, Value>::PushLRUTail(Element* element) {
+  element->next = NULL;
+  element->prev = lru_tail_;
+  if (lru_tail_ != NULL) {
+    lru_tail_->next = element;
+  }
+  lru_tail_ = element;
+  if (lru_head_ == NULL) {
+    lru_head_ = element;
+  }
+}
+
 template<typename Key, typename Value>
 bool LRUCache<Key, Value>::Evict(Element* e) {
   if (e != NULL) {
@@ -350,6 +379,23 @@ LRUCache<Key, Value>::Insert(const Key& key) {
   return e;
 }
 
+template<typename Key, typename Value>
+typename LRUCache<Key, Value>::Element *
+LRUCache<Key, Value>::InsertAtTail(const Key& key) {
+  if (LookupInternal(key) != NULL) {
+    return NULL;
+  }
+  Element* e = NextFreeElement();
+  if (e == NULL) {
+    return NULL;
+  }
+  e->key = key;
+  (*table_)[key] = e;
+  PushLRUTail(e);
+
+  return e;
+}
+
 template<typename Key, typename Value>
 Value* LRUCache<Key, Value>::MutableLookup(const Key& key) {
   Element* e = LookupInternal(key);
@@ -407,6 +453,15 @@ size_t LRUCache<Key, Value>::Size() const {
   return table_->size();
 }
 
+template<typename Key, typename Value>
+size_t LRUCache<Key, Value>::GetAllocatedBytes() const {
+  // Each node of the table holds the pair and the pointer to the next node.
+  return block_capacity_ * sizeof(Element) +
+         table_->bucket_count() * sizeof(void *) +
+         table_->size() *
+             (sizeof(typename Table::value_type) + sizeof(void *));
+}
+
 }  // namespace storage
 }  // namespace mozc
 #endif  // MOZC_STORAGE_LRU_CACHE_H_
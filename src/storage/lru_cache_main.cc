@@ -28,15 +28,121 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <iostream>  // NOLINT
+#include <list>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/flags.h"
 #include "base/init_mozc.h"
+#include "base/number_util.h"
+#include "base/stopwatch.h"
 #include "base/util.h"
 #include "storage/lru_cache.h"
 
+DEFINE_bool(benchmark, false,
+            "compare LRUCache with a std::map indexed LRU instead of "
+            "reading the commands from stdin");
+DEFINE_int32(cache_size, 10000, "the cache size for --benchmark");
+DEFINE_int32(num_keys, 20000, "the number of distinct keys for --benchmark");
+DEFINE_int32(num_operations, 1000000,
+             "the number of Insert() and Lookup() calls for --benchmark");
+
+namespace {
+
+// An LRU cache indexed by std::map, like LRUCache used to be, as the
+// baseline of --benchmark.
+template <typename Key, typename Value>
+class MapIndexedLRUCache {
+ public:
+  explicit MapIndexedLRUCache(size_t max_elements)
+      : max_elements_(max_elements) {}
+
+  void Insert(const Key &key, const Value &value) {
+    typename Table::iterator it = table_.find(key);
+    if (it != table_.end()) {
+      list_.erase(it->second);
+      table_.erase(it);
+    } else if (table_.size() >= max_elements_) {
+      table_.erase(list_.back().first);
+      list_.pop_back();
+    }
+    list_.push_front(std::make_pair(key, value));
+    table_[key] = list_.begin();
+  }
+
+  const Value *Lookup(const Key &key) {
+    typename Table::iterator it = table_.find(key);
+    if (it == table_.end()) {
+      return NULL;
+    }
+    list_.splice(list_.begin(), list_, it->second);
+    return &it->second->second;
+  }
+
+ private:
+  typedef std::list<std::pair<Key, Value> > List;
+  typedef std::map<Key, typename List::iterator> Table;
+
+  size_t max_elements_;
+  List list_;
+  Table table_;
+};
+
+// Runs the same sequence of operations on |cache| and returns the elapsed
+// time in milliseconds.  |num_hits| is set to the number of the successful
+// lookups so that the two caches can be checked to agree.
+template <typename Cache>
+int64 RunBenchmark(const std::vector<string> &keys,
+                   const std::vector<uint32> &operations,
+                   Cache *cache, int *num_hits) {
+  *num_hits = 0;
+  mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+  for (size_t i = 0; i < operations.size(); ++i) {
+    const string &key = keys[operations[i] >> 1];
+    if (operations[i] & 1) {
+      cache->Insert(key, i);
+    } else if (cache->Lookup(key) != NULL) {
+      ++*num_hits;
+    }
+  }
+  stopwatch.Stop();
+  return stopwatch.GetElapsedMilliseconds();
+}
+
+void Benchmark() {
+  std::vector<string> keys;
+  for (int i = 0; i < FLAGS_num_keys; ++i) {
+    keys.push_back("key" + mozc::NumberUtil::SimpleItoa(i));
+  }
+  // The lowest bit tells if it's an insertion.
+  std::vector<uint32> operations;
+  for (int i = 0; i < FLAGS_num_operations; ++i) {
+    operations.push_back((mozc::Util::Random(FLAGS_num_keys) << 1) |
+                         mozc::Util::Random(2));
+  }
+
+  int num_hits = 0;
+  mozc::storage::LRUCache<string, size_t> cache(FLAGS_cache_size);
+  cout << "LRUCache: "
+       << RunBenchmark(keys, operations, &cache, &num_hits) << " ms, "
+       << num_hits << " hits" << endl;
+  MapIndexedLRUCache<string, size_t> baseline(FLAGS_cache_size);
+  cout << "std::map: "
+       << RunBenchmark(keys, operations, &baseline, &num_hits) << " ms, "
+       << num_hits << " hits" << endl;
+}
+
+}  // namespace
+
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, false);
+  if (FLAGS_benchmark) {
+    Benchmark();
+    return 0;
+  }
+
   mozc::storage::LRUCache<string, string> cache(5);
 
   string line;
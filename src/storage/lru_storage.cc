@@ -33,20 +33,23 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
-#include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/clock.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/hash.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
+#include "base/thread.h"
 #include "base/util.h"
+#include "storage/ephemeral_mode.h"
 
 namespace mozc {
 namespace storage {
@@ -54,6 +57,18 @@ namespace storage {
 namespace {
 const size_t kMaxLRUSize   = 1000000;  // 1M
 const size_t kMaxValueSize = 1024;     // 1024 byte
+// The granularity of the dirty page tracking.
+const size_t kDirtyPageSize = 4096;
+// The first field of the header holds the value size in the lower bits and
+// the fingerprint version in the upper 8 bits.
+const int kFingerprintVersionShift = 24;
+const uint32 kValueSizeMask = (1 << kFingerprintVersionShift) - 1;
+
+uint32 EncodeValueSizeField(size_t value_size,
+                            Hash::FingerprintVersion fingerprint_version) {
+  return static_cast<uint32>(value_size) |
+      (static_cast<uint32>(fingerprint_version) << kFingerprintVersionShift);
+}
 
 template <class T>
 inline void ReadValue(char **ptr, T *value) {
@@ -91,6 +106,63 @@ class CompareByTimeStamp {
     return GetTimeStamp(a) > GetTimeStamp(b);
   }
 };
+
+// Orders the indices of |entries| from the newest to the oldest, and the
+// equally old ones by the indices.
+class CompareIndexByTimeStamp {
+ public:
+  explicit CompareIndexByTimeStamp(const std::vector<const char *> &entries)
+      : entries_(entries) {}
+
+  bool operator()(size_t a, size_t b) const {
+    const uint32 a_time = GetTimeStamp(entries_[a]);
+    const uint32 b_time = GetTimeStamp(entries_[b]);
+    return a_time != b_time ? a_time > b_time : a < b;
+  }
+
+ private:
+  const std::vector<const char *> &entries_;
+};
+
+// Removes the duplicated fingerprints from a partition of the entries,
+// keeping the newest one, or the first one if they are equally new.
+class DeduplicateThread : public Thread {
+ public:
+  DeduplicateThread(const std::vector<const char *> *entries,
+                    const std::vector<size_t> *partition)
+      : entries_(entries), partition_(partition) {}
+
+  void Run() override {
+    std::unordered_map<uint64, size_t> newest;
+    newest.reserve(partition_->size());
+    for (size_t i = 0; i < partition_->size(); ++i) {
+      const size_t index = (*partition_)[i];
+      const char *entry = (*entries_)[index];
+      std::pair<std::unordered_map<uint64, size_t>::iterator, bool> result =
+          newest.insert(std::make_pair(GetFP(entry), index));
+      if (!result.second &&
+          GetTimeStamp(entry) >
+              GetTimeStamp((*entries_)[result.first->second])) {
+        result.first->second = index;
+      }
+    }
+    result_.clear();
+    result_.reserve(newest.size());
+    for (std::unordered_map<uint64, size_t>::const_iterator it = newest.begin();
+         it != newest.end(); ++it) {
+      result_.push_back(it->second);
+    }
+  }
+
+  const std::vector<size_t> &result() const { return result_; }
+
+ private:
+  const std::vector<const char *> *entries_;
+  const std::vector<size_t> *partition_;
+  std::vector<size_t> result_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeduplicateThread);
+};
 }  // namespace
 
 class LRUStorage::Node {
@@ -106,30 +178,24 @@ class LRUStorage::Node {
   DISALLOW_COPY_AND_ASSIGN(Node);
 };
 
+// The nodes are allocated at once, since the list never exceeds |max_size|.
 class LRUStorage::LRUList {
  public:
   explicit LRUList(size_t max_size)
-      : max_size_(max_size), size_(0), last_(NULL), top_(NULL) {
+      : max_size_(max_size), size_(0), nodes_(new Node[max_size]),
+        last_(NULL), top_(NULL) {
   }
 
-  ~LRUList() {
-    Clear();
-  }
+  ~LRUList() {}
 
   void Clear() {
-    Node *node = top_;
-    while (node != NULL) {
-      Node *next = node->next;
-      delete node;
-      node = next;
-    }
     size_ = 0;
     top_ = last_ = NULL;
   }
 
   Node *Add(char *value) {
     if (size_ < max_size_) {
-      Node *node = new Node;
+      Node *node = &nodes_[size_];
       node->value = value;
       if (last_ == NULL) {
         node->prev = NULL;
@@ -151,6 +217,10 @@ class LRUStorage::LRUList {
     return (top_ == NULL);
   }
 
+  size_t GetAllocatedBytes() const {
+    return max_size_ * sizeof(Node);
+  }
+
   size_t size() const {
     return size_;
   }
@@ -179,12 +249,97 @@ class LRUStorage::LRUList {
  private:
   size_t max_size_;
   size_t size_;
+  std::unique_ptr<Node[]> nodes_;
   Node *last_;
   Node *top_;
 
   DISALLOW_COPY_AND_ASSIGN(LRUList);
 };
 
+// Open addressing hash table from fingerprints to nodes with linear probing.
+// The capacity is a power of two at least twice the maximum number of the
+// entries, so that the probe sequences stay short.  The fingerprints are
+// already uniformly distributed, so their low bits are used as the bucket.
+class LRUStorage::Index {
+ public:
+  explicit Index(size_t max_size) : mask_(0) {
+    size_t capacity = 2;
+    while (capacity < 2 * max_size) {
+      capacity <<= 1;
+    }
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+  }
+
+  size_t GetAllocatedBytes() const {
+    return MemoryStats::GetHeapBytes(slots_);
+  }
+
+  Node *Find(uint64 fp) const {
+    for (size_t i = Bucket(fp); slots_[i].node != NULL; i = (i + 1) & mask_) {
+      if (slots_[i].fp == fp) {
+        return slots_[i].node;
+      }
+    }
+    return NULL;
+  }
+
+  // Does nothing if |fp| is already in the table.
+  void Insert(uint64 fp, Node *node) {
+    DCHECK(node);
+    size_t i = Bucket(fp);
+    for (; slots_[i].node != NULL; i = (i + 1) & mask_) {
+      if (slots_[i].fp == fp) {
+        return;
+      }
+    }
+    slots_[i].fp = fp;
+    slots_[i].node = node;
+  }
+
+  // Removes |fp| by shifting the following entries of the probe sequence
+  // back, so that no tombstone is needed.
+  void Erase(uint64 fp) {
+    size_t i = Bucket(fp);
+    for (; slots_[i].node != NULL; i = (i + 1) & mask_) {
+      if (slots_[i].fp == fp) {
+        break;
+      }
+    }
+    if (slots_[i].node == NULL) {
+      return;
+    }
+    for (size_t j = (i + 1) & mask_; slots_[j].node != NULL;
+         j = (j + 1) & mask_) {
+      // The entry at |j| can fill the hole at |i| unless its bucket lies
+      // cyclically in (i, j].
+      const size_t k = Bucket(slots_[j].fp);
+      const bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+      if (!stays) {
+        slots_[i] = slots_[j];
+        i = j;
+      }
+    }
+    slots_[i].node = NULL;
+  }
+
+ private:
+  struct Slot {
+    Slot() : fp(0), node(NULL) {}
+    uint64 fp;
+    Node *node;  // NULL for an empty slot.
+  };
+
+  size_t Bucket(uint64 fp) const {
+    return static_cast<size_t>(fp) & mask_;
+  }
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(Index);
+};
+
 LRUStorage *LRUStorage::Create(const char *filename) {
   std::unique_ptr<LRUStorage> n(new LRUStorage);
   if (!n->Open(filename)) {
@@ -210,6 +365,16 @@ bool LRUStorage::CreateStorageFile(const char *filename,
                                    size_t value_size,
                                    size_t size,
                                    uint32 seed) {
+  return CreateStorageFile(filename, value_size, size, seed,
+                           Hash::FINGERPRINT_V1);
+}
+
+bool LRUStorage::CreateStorageFile(
+    const char *filename,
+    size_t value_size,
+    size_t size,
+    uint32 seed,
+    Hash::FingerprintVersion fingerprint_version) {
   if (value_size == 0 || value_size > kMaxValueSize) {
     LOG(ERROR) << "value_size is out of range";
     return false;
@@ -225,13 +390,16 @@ bool LRUStorage::CreateStorageFile(const char *filename,
     return false;
   }
 
+  IOStats::ScopedOperation operation(IOStats::LRU_STORAGE, IOStats::WRITE);
   OutputFileStream ofs(filename, std::ios::binary | std::ios::out);
   if (!ofs) {
     LOG(ERROR) << "cannot open " << filename;
     return false;
   }
+  operation.set_bytes(12 + (value_size + 12) * size);
 
-  const uint32 value_size_uint32 = static_cast<uint32>(value_size);
+  const uint32 value_size_uint32 =
+      EncodeValueSizeField(value_size, fingerprint_version);
   const uint32 size_uint32 = static_cast<uint32>(size);
 
   ofs.write(reinterpret_cast<const char *>(&value_size_uint32),
@@ -255,22 +423,119 @@ bool LRUStorage::CreateStorageFile(const char *filename,
   return true;
 }
 
+bool LRUStorage::CreateMergedStorageFile(
+    const char *filename,
+    const std::vector<const LRUStorage *> &storages,
+    size_t size,
+    int num_threads) {
+  if (storages.empty()) {
+    LOG(ERROR) << "no storage to merge";
+    return false;
+  }
+  const size_t value_size = storages[0]->value_size();
+  const uint32 seed = storages[0]->seed();
+  const Hash::FingerprintVersion fingerprint_version =
+      storages[0]->fingerprint_version();
+  for (size_t i = 1; i < storages.size(); ++i) {
+    if (storages[i]->value_size() != value_size ||
+        storages[i]->seed() != seed ||
+        storages[i]->fingerprint_version() != fingerprint_version) {
+      LOG(ERROR) << "value_size, seed or fingerprint version is different: "
+                 << storages[i]->filename();
+      return false;
+    }
+  }
+  if (size == 0 || size > kMaxLRUSize) {
+    LOG(ERROR) << "size is out of range";
+    return false;
+  }
+
+  // Collect the used entries, and partition them by the fingerprints.
+  const size_t num_partitions = static_cast<size_t>(max(num_threads, 1));
+  const size_t entry_size = value_size + 12;
+  std::vector<const char *> entries;
+  std::vector<std::vector<size_t>> partitions(num_partitions);
+  for (size_t i = 0; i < storages.size(); ++i) {
+    for (const char *ptr = storages[i]->begin_; ptr < storages[i]->end_;
+         ptr += entry_size) {
+      if (GetTimeStamp(ptr) == 0) {
+        continue;
+      }
+      partitions[GetFP(ptr) % num_partitions].push_back(entries.size());
+      entries.push_back(ptr);
+    }
+  }
+
+  std::vector<std::unique_ptr<DeduplicateThread>> threads;
+  for (size_t i = 0; i < num_partitions; ++i) {
+    threads.emplace_back(new DeduplicateThread(&entries, &partitions[i]));
+  }
+  // The last partition is processed in this thread.
+  for (size_t i = 0; i + 1 < threads.size(); ++i) {
+    threads[i]->SetJoinable(true);
+    threads[i]->Start("LRUStorageMerge");
+  }
+  threads.back()->Run();
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    if (i + 1 < threads.size()) {
+      threads[i]->Join();
+    }
+    indices.insert(indices.end(), threads[i]->result().begin(),
+                   threads[i]->result().end());
+  }
+
+  // Lay out the entries from the newest.
+  std::sort(indices.begin(), indices.end(), CompareIndexByTimeStamp(entries));
+  if (indices.size() > size) {
+    indices.resize(size);
+  }
+
+  IOStats::ScopedOperation operation(IOStats::LRU_STORAGE, IOStats::WRITE);
+  OutputFileStream ofs(filename, std::ios::binary | std::ios::out);
+  if (!ofs) {
+    LOG(ERROR) << "cannot open " << filename;
+    return false;
+  }
+  operation.set_bytes(12 + entry_size * size);
+
+  const uint32 value_size_uint32 =
+      EncodeValueSizeField(value_size, fingerprint_version);
+  const uint32 size_uint32 = static_cast<uint32>(size);
+  ofs.write(reinterpret_cast<const char *>(&value_size_uint32),
+            sizeof(value_size_uint32));
+  ofs.write(reinterpret_cast<const char *>(&size_uint32),
+            sizeof(size_uint32));
+  ofs.write(reinterpret_cast<const char *>(&seed), sizeof(seed));
+  for (size_t i = 0; i < indices.size(); ++i) {
+    ofs.write(entries[indices[i]], static_cast<std::streamsize>(entry_size));
+  }
+  const std::vector<char> empty_entry(entry_size, '\0');
+  for (size_t i = indices.size(); i < size; ++i) {
+    ofs.write(empty_entry.data(), static_cast<std::streamsize>(entry_size));
+  }
+
+  return ofs.good();
+}
+
 // Reopen file after initializing mapped page.
 bool LRUStorage::Clear() {
   // Don't need to clear the page if the lru list is empty
-  if (mmap_.get() == NULL || lru_list_.get() == NULL ||
+  if (data_ == NULL || lru_list_.get() == NULL ||
       lru_list_->size() == 0) {
     return true;
   }
   const size_t offset =
       sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
-  if (offset >= mmap_->size()) {   // should not happen
+  const size_t data_size = end_ - data_;
+  if (offset >= data_size) {   // should not happen
     return false;
   }
-  memset(mmap_->begin() + offset, '\0', mmap_->size() - offset);
+  memset(data_ + offset, '\0', data_size - offset);
+  MarkDirty(data_ + offset, data_size - offset);
   lru_list_.reset();
-  map_.clear();
-  Open(mmap_->begin(), mmap_->size());
+  index_.reset();
+  Open(data_, data_size);
   return true;
 }
 
@@ -287,7 +552,8 @@ bool LRUStorage::Merge(const LRUStorage &storage) {
     return false;
   }
 
-  if (seed_ != storage.seed_) {
+  if (seed_ != storage.seed_ ||
+      fingerprint_version_ != storage.fingerprint_version_) {
     return false;
   }
 
@@ -334,16 +600,19 @@ bool LRUStorage::Merge(const LRUStorage &storage) {
   if (new_size < old_size) {
     memset(begin_ + new_size, '\0', old_size - new_size);
   }
+  MarkDirty(begin_, old_size);
 
-  return Open(mmap_->begin(), mmap_->size());
+  return Open(data_, end_ - data_);
 }
 
 LRUStorage::LRUStorage()
     : value_size_(0),
       size_(0),
       seed_(0),
+      fingerprint_version_(Hash::FINGERPRINT_V1),
       last_item_(NULL),
-      begin_(NULL), end_(NULL) {}
+      data_(NULL), begin_(NULL), end_(NULL),
+      num_dirty_pages_(0) {}
 
 LRUStorage::~LRUStorage() {
   Close();
@@ -353,12 +622,28 @@ bool LRUStorage::OpenOrCreate(const char *filename,
                               size_t new_value_size,
                               size_t new_size,
                               uint32 new_seed) {
+  return OpenOrCreate(filename, new_value_size, new_size, new_seed,
+                      Hash::FINGERPRINT_V1);
+}
+
+bool LRUStorage::OpenOrCreate(
+    const char *filename,
+    size_t new_value_size,
+    size_t new_size,
+    uint32 new_seed,
+    Hash::FingerprintVersion new_fingerprint_version) {
+  if (EphemeralMode::IsEnabled()) {
+    return OpenInMemory(filename, new_value_size, new_size, new_seed,
+                        new_fingerprint_version);
+  }
+
   if (!FileUtil::FileExists(filename)) {
     // This is also an expected scenario. Let's create a new data file.
     VLOG(1) << filename << " does not exist. Creating a new one.";
     if (!LRUStorage::CreateStorageFile(filename,
                                        new_value_size,
-                                       new_size, new_seed)) {
+                                       new_size, new_seed,
+                                       new_fingerprint_version)) {
       LOG(ERROR) << "CreateStorageFile failed against " << filename;
       return false;
     }
@@ -376,7 +661,8 @@ bool LRUStorage::OpenOrCreate(const char *filename,
     //     data file and the content is actually valid.
     if (!LRUStorage::CreateStorageFile(filename,
                                        new_value_size,
-                                       new_size, new_seed)) {
+                                       new_size, new_seed,
+                                       new_fingerprint_version)) {
       LOG(ERROR) << "CreateStorageFile failed";
       return false;
     }
@@ -391,7 +677,8 @@ bool LRUStorage::OpenOrCreate(const char *filename,
   if (new_value_size != value_size() || new_size != size()) {
     Close();
     if (!LRUStorage::CreateStorageFile(filename, new_value_size,
-                                       new_size, new_seed)) {
+                                       new_size, new_seed,
+                                       new_fingerprint_version)) {
       LOG(ERROR) << "CreateStorageFile failed";
       return false;
     }
@@ -412,6 +699,8 @@ bool LRUStorage::OpenOrCreate(const char *filename,
 }
 
 bool LRUStorage::Open(const char *filename) {
+  // All the entries are read to build the index.
+  IOStats::ScopedOperation operation(IOStats::LRU_STORAGE, IOStats::READ);
   mmap_.reset(new Mmap);
 
   if (mmap_.get() == NULL) {
@@ -424,6 +713,8 @@ bool LRUStorage::Open(const char *filename) {
                << " with read+write mode";
     return false;
   }
+  dirty_.assign((mmap_->size() + kDirtyPageSize - 1) / kDirtyPageSize, false);
+  num_dirty_pages_ = 0;
 
   if (mmap_->size() < 8) {
     LOG(ERROR) << "file size is too small";
@@ -431,10 +722,49 @@ bool LRUStorage::Open(const char *filename) {
   }
 
   filename_ = filename;
+  operation.set_bytes(mmap_->size());
   return Open(mmap_->begin(), mmap_->size());
 }
 
+bool LRUStorage::OpenInMemory(
+    const char *filename,
+    size_t new_value_size,
+    size_t new_size,
+    uint32 new_seed,
+    Hash::FingerprintVersion new_fingerprint_version) {
+  // The data in memory is what would be in the file, so reopening it, e.g.,
+  // on reloading the user data, keeps the data.
+  if (memory_.get() != NULL && filename_ == filename &&
+      new_value_size == value_size() && new_size == size()) {
+    return true;
+  }
+  Close();
+
+  if (new_value_size == 0 || new_value_size > kMaxValueSize ||
+      new_value_size % 4 != 0 || new_size == 0 || new_size > kMaxLRUSize) {
+    LOG(ERROR) << "value_size or size is out of range";
+    return false;
+  }
+
+  const uint32 header[] = {
+    EncodeValueSizeField(new_value_size, new_fingerprint_version),
+    static_cast<uint32>(new_size),
+    new_seed,
+  };
+  const size_t data_size = sizeof(header) + (new_value_size + 12) * new_size;
+  memory_.reset(new char[data_size]);
+  memcpy(memory_.get(), header, sizeof(header));
+  memset(memory_.get() + sizeof(header), '\0', data_size - sizeof(header));
+  if (!Open(memory_.get(), data_size)) {
+    Close();
+    return false;
+  }
+  filename_ = filename;
+  return true;
+}
+
 bool LRUStorage::Open(char *ptr, size_t ptr_size) {
+  data_ = ptr;
   begin_ = ptr;
   end_ = ptr + ptr_size;
 
@@ -445,9 +775,18 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
   ReadValue<uint32>(&begin_, &size_uint32);
   ReadValue<uint32>(&begin_, &seed_);
 
-  value_size_ = static_cast<size_t>(value_size_uint32);
+  value_size_ = static_cast<size_t>(value_size_uint32 & kValueSizeMask);
   size_ = static_cast<size_t>(size_uint32);
 
+  const uint32 fingerprint_version =
+      value_size_uint32 >> kFingerprintVersionShift;
+  if (fingerprint_version >= Hash::NUM_FINGERPRINT_VERSIONS) {
+    LOG(ERROR) << "Unknown fingerprint version: " << fingerprint_version;
+    return false;
+  }
+  fingerprint_version_ =
+      static_cast<Hash::FingerprintVersion>(fingerprint_version);
+
   if (value_size_ % 4 != 0) {
     LOG(ERROR) << "value_size_ must be 4 byte alignment";
     return false;
@@ -463,7 +802,7 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
     return false;
   }
 
-  const size_t file_size = mmap_->size() - 12;
+  const size_t file_size = ptr_size - 12;
   if ((value_size_ + 12) * size_ != file_size) {
     LOG(ERROR) << "LRU file is broken";
     return false;
@@ -479,12 +818,12 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
   std::stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
 
   lru_list_.reset(new LRUList(size_));
-  map_.clear();
+  index_.reset(new Index(size_));
   last_item_ = NULL;
   for (size_t i = 0; i < ary.size(); ++i) {
     if (GetTimeStamp(ary[i]) != 0) {
       Node *node = lru_list_->Add(ary[i]);
-      map_.insert(std::make_pair(GetFP(ary[i]), node));
+      index_->Insert(GetFP(ary[i]), node);
     } else if (last_item_ == NULL) {
       last_item_ = ary[i];
     }
@@ -496,8 +835,95 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
 void LRUStorage::Close() {
   filename_.clear();
   mmap_.reset();
+  memory_.reset();
+  data_ = NULL;
+  begin_ = NULL;
+  end_ = NULL;
   lru_list_.reset();
-  map_.clear();
+  index_.reset();
+  dirty_.clear();
+  num_dirty_pages_ = 0;
+}
+
+void LRUStorage::MarkDirty(const char *ptr, size_t len) {
+  if (mmap_.get() == NULL || len == 0) {
+    return;
+  }
+  DCHECK_GE(ptr, mmap_->begin());
+  DCHECK_LE(ptr + len, mmap_->end());
+  const size_t offset = ptr - mmap_->begin();
+  const size_t last = (offset + len - 1) / kDirtyPageSize;
+  for (size_t page = offset / kDirtyPageSize; page <= last; ++page) {
+    if (!dirty_[page]) {
+      dirty_[page] = true;
+      ++num_dirty_pages_;
+    }
+  }
+}
+
+bool LRUStorage::Flush() {
+  if (mmap_.get() == NULL || num_dirty_pages_ == 0) {
+    return true;
+  }
+#ifdef MOZC_USE_PEPPER_FILE_IO
+  // The whole file is written at once.
+  IOStats::ScopedOperation operation(IOStats::LRU_STORAGE, IOStats::SYNC);
+  operation.set_bytes(mmap_->size());
+  if (!mmap_->SyncToFile()) {
+    return false;
+  }
+  dirty_.assign(dirty_.size(), false);
+  num_dirty_pages_ = 0;
+  return true;
+#else  // MOZC_USE_PEPPER_FILE_IO
+  // Each run of the contiguous dirty pages is written back at once.
+  bool result = true;
+  const size_t num_pages = dirty_.size();
+  for (size_t begin = 0; begin < num_pages; ++begin) {
+    if (!dirty_[begin]) {
+      continue;
+    }
+    size_t end = begin + 1;
+    while (end < num_pages && dirty_[end]) {
+      ++end;
+    }
+    const size_t offset = begin * kDirtyPageSize;
+    const size_t len = min(end * kDirtyPageSize, mmap_->size()) - offset;
+    IOStats::ScopedOperation operation(IOStats::LRU_STORAGE, IOStats::SYNC);
+    operation.set_bytes(len);
+    if (Mmap::MaybeFlush(mmap_->begin() + offset, len)) {
+      for (size_t page = begin; page < end; ++page) {
+        dirty_[page] = false;
+      }
+      num_dirty_pages_ -= end - begin;
+    } else {
+      LOG(WARNING) << "Failed to flush " << filename_;
+      result = false;
+    }
+    begin = end;
+  }
+  return result;
+#endif  // MOZC_USE_PEPPER_FILE_IO
+}
+
+size_t LRUStorage::dirty_pages() const {
+  return num_dirty_pages_;
+}
+
+MemoryStats::Usage LRUStorage::GetMemoryUsage(StringPiece component) const {
+  MemoryStats::Usage usage;
+  component.CopyToString(&usage.component);
+  usage.count = used_size();
+  if (data_ == NULL) {
+    return usage;
+  }
+  const size_t heap_bytes = index_->GetAllocatedBytes() +
+                            lru_list_->GetAllocatedBytes() +
+                            dirty_.capacity() / 8;
+  usage.virtual_bytes = (end_ - data_) + heap_bytes;
+  usage.resident_bytes =
+      MemoryStats::GetResidentBytes(data_, end_ - data_) + heap_bytes;
+  return usage;
 }
 
 const char* LRUStorage::Lookup(const string &key) const {
@@ -507,13 +933,33 @@ const char* LRUStorage::Lookup(const string &key) const {
 
 const char* LRUStorage::Lookup(const string &key,
                                uint32 *last_access_time) const {
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::const_iterator it = map_.find(fp);
-  if (it == map_.end()) {
+  if (index_.get() == NULL) {
+    return NULL;
+  }
+  const Node *node = index_->Find(Fingerprint(key));
+  if (node == NULL) {
     return NULL;
   }
-  *last_access_time = GetTimeStamp(it->second->value);
-  return GetValue(it->second->value);
+  *last_access_time = GetTimeStamp(node->value);
+  return GetValue(node->value);
+}
+
+uint64 LRUStorage::Fingerprint(StringPiece key) const {
+  return Hash::FingerprintWithVersion(fingerprint_version_, key, seed_);
+}
+
+void LRUStorage::LookupFingerprints(const uint64 *fps, size_t size,
+                                    const char **values,
+                                    uint32 *last_access_times) const {
+  for (size_t i = 0; i < size; ++i) {
+    const Node *node = index_.get() == NULL ? NULL : index_->Find(fps[i]);
+    if (node == NULL) {
+      values[i] = NULL;
+      continue;
+    }
+    values[i] = GetValue(node->value);
+    last_access_times[i] = GetTimeStamp(node->value);
+  }
 }
 
 bool LRUStorage::GetAllValues(std::vector<string> *values) const {
@@ -539,11 +985,11 @@ bool LRUStorage::Touch(const string &key) {
     return false;
   }
 
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value);
-    lru_list_->MoveToTop(it->second);
+  Node *node = index_->Find(Fingerprint(key));
+  if (node != NULL) {     // find in the cache
+    Update(node->value);
+    MarkDirty(node->value, value_size_ + 12);
+    lru_list_->MoveToTop(node);
     return true;
   }
   return false;
@@ -554,29 +1000,31 @@ bool LRUStorage::Insert(const string &key, const char *value) {
     return false;
   }
 
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
+  const uint64 fp = Fingerprint(key);
+  Node *found = index_->Find(fp);
+  if (found != NULL) {     // find in the cache
+    Update(found->value, fp, value, value_size_);
+    MarkDirty(found->value, value_size_ + 12);
+    lru_list_->MoveToTop(found);
   } else if (lru_list_->size() >= size_ ||
              last_item_ == NULL) {  // not found, but cache is FULL
     Node *node = lru_list_->GetLastNode();
     const uint64 old_fp = GetFP(node->value);  // remove oldest item
-    std::map<uint64, Node *>::iterator old_it = map_.find(old_fp);
-    if (old_it != map_.end()) {
-      map_.erase(old_it);
+    if (index_->Find(old_fp) == node) {
+      index_->Erase(old_fp);
     }
     lru_list_->MoveToTop(node);
     Update(node->value, fp, value, value_size_);
-    map_.insert(std::make_pair(fp, node));
-  } else if (last_item_ < mmap_->end()) {  // not found, cahce is not FULL
+    MarkDirty(node->value, value_size_ + 12);
+    index_->Insert(fp, node);
+  } else if (last_item_ < end_) {  // not found, cahce is not FULL
     Node *node = lru_list_->Add(last_item_);
     lru_list_->MoveToTop(node);
     Update(node->value, fp, value, value_size_);
-    map_.insert(std::make_pair(fp, node));
+    MarkDirty(node->value, value_size_ + 12);
+    index_->Insert(fp, node);
     last_item_ += (value_size_ + 12);
-    if (last_item_ >= mmap_->end()) {
+    if (last_item_ >= end_) {
       last_item_ = NULL;
     }
   } else {
@@ -592,11 +1040,12 @@ bool LRUStorage::TryInsert(const string &key, const char *value) {
     return false;
   }
 
-  const uint64 fp = Hash::FingerprintWithSeed(key, seed_);
-  std::map<uint64, Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
+  const uint64 fp = Fingerprint(key);
+  Node *node = index_->Find(fp);
+  if (node != NULL) {     // find in the cache
+    Update(node->value, fp, value, value_size_);
+    MarkDirty(node->value, value_size_ + 12);
+    lru_list_->MoveToTop(node);
   }
 
   return true;
@@ -618,6 +1067,10 @@ uint32 LRUStorage::seed() const {
   return seed_;
 }
 
+Hash::FingerprintVersion LRUStorage::fingerprint_version() const {
+  return fingerprint_version_;
+}
+
 const string &LRUStorage::filename() const {
   return filename_;
 }
@@ -635,6 +1088,7 @@ void LRUStorage::Write(size_t i,
   } else {
     LOG(ERROR) << "value size is not " << value_size_ << " byte.";
   }
+  MarkDirty(ptr, value_size_ + 12);
 }
 
 void LRUStorage::Read(size_t i,
@@ -30,12 +30,14 @@
 #ifndef MOZC_STORAGE_LRU_STORAGE_H_
 #define MOZC_STORAGE_LRU_STORAGE_H_
 
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "base/hash.h"
+#include "base/memory_stats.h"
 #include "base/port.h"
+#include "base/string_piece.h"
 
 namespace mozc {
 
@@ -59,12 +61,31 @@ class LRUStorage {
                     size_t new_size,
                     uint32 new_seed);
 
+  // Same as above, but the new file uses |new_fingerprint_version|.  The
+  // existing file keeps its fingerprint version.
+  bool OpenOrCreate(const char *filename,
+                    size_t new_value_size,
+                    size_t new_size,
+                    uint32 new_seed,
+                    Hash::FingerprintVersion new_fingerprint_version);
+
   // Lookup key
   const char *Lookup(const string &key,
                      uint32 *last_access_time) const;
 
   const char *Lookup(const string &key) const;
 
+  // Returns the fingerprint of |key| in this storage, which is accepted by
+  // LookupFingerprints().
+  uint64 Fingerprint(StringPiece key) const;
+
+  // Looks up the |size| fingerprints at once.  Sets values[i] and
+  // last_access_times[i] to the value and the last access time of fps[i], or
+  // sets values[i] to NULL if it's not found.
+  void LookupFingerprints(const uint64 *fps, size_t size,
+                          const char **values,
+                          uint32 *last_access_times) const;
+
   // Returns all values.
   // The order is new to old (*values->begin() is the newest).
   bool GetAllValues(std::vector<string> *values) const;
@@ -89,10 +110,25 @@ class LRUStorage {
   bool TryInsert(const string &key,
                  const char *value);
 
+  // Writes the pages modified since the last Flush() back to the file and
+  // waits for the completion.  Otherwise, when the modifications reach the
+  // disk is up to the OS.  Returns false if it failed, in which case the pages
+  // stay dirty.
+  bool Flush();
+
+  // Returns the number of the pages modified since the last Flush().
+  size_t dirty_pages() const;
+
+  // Returns the usage of the mapped file, or of the memory in EphemeralMode,
+  // and of the index in heap as |component|.  The file is written by this
+  // process only, so none of it is counted as shared.
+  MemoryStats::Usage GetMemoryUsage(StringPiece component) const;
+
   size_t value_size() const;
   size_t size() const;
   size_t used_size() const;
   uint32 seed() const;
+  Hash::FingerprintVersion fingerprint_version() const;
   const string &filename() const;
 
   // Write one entry at |i| th index.
@@ -124,23 +160,64 @@ class LRUStorage {
                                 size_t value_size,
                                 size_t size,
                                 uint32 seed);
+
+  // Creates an empty LRU db file whose keys are hashed with
+  // |fingerprint_version|.  The version is stored in the upper 8 bits of the
+  // value size in the header, which are 0 for FINGERPRINT_V1, so the files of
+  // FINGERPRINT_V1 keep the same format as before.
+  static bool CreateStorageFile(const char *filename,
+                                size_t value_size,
+                                size_t size,
+                                uint32 seed,
+                                Hash::FingerprintVersion fingerprint_version);
+
+  // Creates a new db file from the entries of |storages|, which must have
+  // the same value size, seed and fingerprint version.  For each key, only the newest entry is
+  // kept, and the entries are laid out from the newest to the oldest.  The
+  // oldest ones are dropped if they don't fit in |size|.  The duplicated
+  // keys are removed in |num_threads| threads, each of which handles a
+  // partition of the fingerprints.
+  static bool CreateMergedStorageFile(
+      const char *filename,
+      const std::vector<const LRUStorage *> &storages,
+      size_t size,
+      int num_threads);
  private:
+  class Index;
   class LRUList;
   class Node;
 
+  // Used instead of the file in EphemeralMode.
+  bool OpenInMemory(const char *filename,
+                    size_t new_value_size,
+                    size_t new_size,
+                    uint32 new_seed,
+                    Hash::FingerprintVersion new_fingerprint_version);
+
   // load from memory buffer
   bool Open(char *ptr, size_t ptr_size);
 
+  // Marks the pages of the mapped file which [ptr, ptr + len) spans as dirty.
+  void MarkDirty(const char *ptr, size_t len);
+
   size_t value_size_;
   size_t size_;
   uint32 seed_;
+  Hash::FingerprintVersion fingerprint_version_;
   char *last_item_;
+  // The beginning of the data including the header.
+  char *data_;
   char *begin_;
   char *end_;
   string filename_;
-  std::map<uint64, Node *> map_;
+  std::unique_ptr<Index> index_;
   std::unique_ptr<LRUList> lru_list_;
   std::unique_ptr<Mmap> mmap_;
+  // The data kept in memory instead of |mmap_| in EphemeralMode.
+  std::unique_ptr<char[]> memory_;
+  // Dirty flags of the pages of |mmap_|.
+  std::vector<bool> dirty_;
+  size_t num_dirty_pages_;
 
   DISALLOW_COPY_AND_ASSIGN(LRUStorage);
 };
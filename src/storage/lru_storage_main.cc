@@ -27,9 +27,13 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/number_util.h"
 #include "base/port.h"
 #include "base/util.h"
 #include "storage/lru_storage.h"
@@ -37,15 +41,49 @@
 DEFINE_bool(create_db, false, "initialize database");
 DEFINE_string(file, "test.db", "");
 DEFINE_int32(size, 10, "size");
+DEFINE_string(merge, "",
+              "comma separated database files to be compacted and merged "
+              "into --file.  The size is the largest one of them unless "
+              "--create_db is also given");
+DEFINE_int32(num_threads, 4, "the number of threads for --merge");
+DEFINE_bool(fingerprint_v2, false,
+            "use the fingerprint V2 for the database of --create_db");
 
 using mozc::storage::LRUStorage;
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv, false);
 
+  if (!FLAGS_merge.empty()) {
+    vector<string> filenames;
+    mozc::Util::SplitStringUsing(FLAGS_merge, ",", &filenames);
+    vector<std::unique_ptr<LRUStorage>> storages;
+    vector<const LRUStorage *> inputs;
+    size_t size = FLAGS_create_db ? FLAGS_size : 0;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      storages.emplace_back(new LRUStorage);
+      CHECK(storages.back()->Open(filenames[i].c_str())) << filenames[i];
+      inputs.push_back(storages.back().get());
+      if (!FLAGS_create_db) {
+        size = max(size, storages.back()->size());
+      }
+      LOG(INFO) << filenames[i] << ": used_size="
+                << storages.back()->used_size();
+    }
+    CHECK(LRUStorage::CreateMergedStorageFile(
+        FLAGS_file.c_str(), inputs, size, FLAGS_num_threads));
+    LRUStorage s;
+    CHECK(s.Open(FLAGS_file.c_str()));
+    LOG(INFO) << FLAGS_file << ": size=" << s.size()
+              << " used_size=" << s.used_size();
+    return 0;
+  }
+
   if (FLAGS_create_db) {
     CHECK(LRUStorage::CreateStorageFile(
-        FLAGS_file.c_str(), static_cast<uint32>(4), FLAGS_size, 0xff02));
+        FLAGS_file.c_str(), static_cast<uint32>(4), FLAGS_size, 0xff02,
+        FLAGS_fingerprint_v2 ? mozc::Hash::FINGERPRINT_V2
+                             : mozc::Hash::FINGERPRINT_V1));
   }
 
   LRUStorage s;
@@ -55,6 +93,7 @@ int main(int argc, char **argv) {
   LOG(INFO) << "used_size=" << s.used_size();
   LOG(INFO) << "usage=" << 100.0 * s.used_size() / s.size() << "%";
   LOG(INFO) << "value_size=" << s.value_size();
+  LOG(INFO) << "fingerprint_version=" << s.fingerprint_version();
 
   string line;
   vector<string> fields;
@@ -71,7 +110,8 @@ int main(int argc, char **argv) {
         cout << "not found " << fields[1] << endl;
       }
     } else if (fields.size() >= 3 && fields[0] == "i") {
-      uint32 value = atoi32(fields[2].c_str());
+      uint32 value = 0;
+      mozc::NumberUtil::SafeStrToUInt32(fields[2], &value);
       s.Insert(fields[1], reinterpret_cast<const char*>(&value));
     } else {
       LOG(INFO) << "unknown command: " << line;
@@ -37,9 +37,12 @@
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
+#include "base/number_util.h"
 #include "base/port.h"
 #include "base/util.h"
+#include "storage/ephemeral_mode.h"
 #include "storage/lru_cache.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
@@ -146,6 +149,71 @@ TEST_F(LRUStorageTest, LRUStorageTest) {
   }
 }
 
+// Inserts keys drawn from a small pool many times, so that the same entries
+// are evicted and inserted again and again.
+TEST_F(LRUStorageTest, RepeatedEviction) {
+  const uint32 kSize = 64;
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, kSize, 0x76fef);
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+
+  std::vector<string> keys;
+  for (int i = 0; i < 3 * kSize; ++i) {
+    keys.push_back("key" + NumberUtil::SimpleItoa(i));
+  }
+  mozc::storage::LRUCache<string, uint32> cache(kSize);
+  for (int i = 0; i < 20000; ++i) {
+    const string &key = keys[Util::Random(keys.size())];
+    const uint32 value = static_cast<uint32>(i);
+    cache.Insert(key, value);
+    storage.Insert(key, reinterpret_cast<const char *>(&value));
+  }
+  EXPECT_EQ(kSize, storage.used_size());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const uint32 *expected = cache.Lookup(keys[i]);
+    const uint32 *actual =
+        reinterpret_cast<const uint32 *>(storage.Lookup(keys[i]));
+    if (expected == NULL) {
+      EXPECT_TRUE(actual == NULL) << keys[i];
+    } else {
+      ASSERT_TRUE(actual != NULL) << keys[i];
+      EXPECT_EQ(*expected, *actual) << keys[i];
+    }
+  }
+}
+
+TEST_F(LRUStorageTest, Flush) {
+  const string file = GetTemporaryFilePath();
+  // The 12-byte header and 4096 entries of 16 bytes span 17 pages.
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 4096, 0x76fef);
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+  EXPECT_EQ(0, storage.dirty_pages());
+  EXPECT_TRUE(storage.Flush());
+
+  storage.Insert("foo", "abcd");
+  EXPECT_EQ(1, storage.dirty_pages());
+  storage.Touch("foo");
+  EXPECT_EQ(1, storage.dirty_pages());
+  storage.Write(4000, 1, "efgh", 1);
+  EXPECT_EQ(2, storage.dirty_pages());
+  EXPECT_TRUE(storage.Flush());
+  EXPECT_EQ(0, storage.dirty_pages());
+
+  // The flushed data is in the file.
+  LRUStorage storage2;
+  ASSERT_TRUE(storage2.Open(file.c_str()));
+  ASSERT_TRUE(storage2.Lookup("foo") != NULL);
+  EXPECT_EQ("abcd", string(storage2.Lookup("foo"), 4));
+
+  EXPECT_TRUE(storage.Clear());
+  EXPECT_EQ(17, storage.dirty_pages());
+  EXPECT_TRUE(storage.Flush());
+  EXPECT_EQ(0, storage.dirty_pages());
+}
+
 struct Entry {
   uint64 key;
   uint32 last_access_time;
@@ -189,6 +257,85 @@ TEST_F(LRUStorageTest, ReadWriteTest) {
   }
 }
 
+TEST_F(LRUStorageTest, LookupFingerprints) {
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 10, 0x76fef);
+  LRUStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+  storage.Insert("foo", "abcd");
+  storage.Insert("bar", "efgh");
+
+  const uint64 fps[] = {
+    storage.Fingerprint("bar"),
+    storage.Fingerprint("baz"),
+    storage.Fingerprint("foo"),
+  };
+  const char *values[arraysize(fps)];
+  uint32 last_access_times[arraysize(fps)];
+  storage.LookupFingerprints(fps, arraysize(fps), values, last_access_times);
+
+  uint32 last_access_time = 0;
+  ASSERT_NE(nullptr, values[0]);
+  EXPECT_EQ(string(storage.Lookup("bar", &last_access_time), 4),
+            string(values[0], 4));
+  EXPECT_EQ(last_access_time, last_access_times[0]);
+  EXPECT_EQ(nullptr, values[1]);
+  ASSERT_NE(nullptr, values[2]);
+  EXPECT_EQ(string(storage.Lookup("foo", &last_access_time), 4),
+            string(values[2], 4));
+  EXPECT_EQ(last_access_time, last_access_times[2]);
+}
+
+TEST_F(LRUStorageTest, FingerprintVersion) {
+  const string file1 = GetTemporaryFilePath() + ".tmp1";
+  const string file2 = GetTemporaryFilePath() + ".tmp2";
+  ASSERT_TRUE(LRUStorage::CreateStorageFile(file1.c_str(), 4, 10, 0x76fef));
+  ASSERT_TRUE(LRUStorage::CreateStorageFile(file2.c_str(), 4, 10, 0x76fef,
+                                            Hash::FINGERPRINT_V2));
+
+  // The header of FINGERPRINT_V1 is the same as before.
+  {
+    InputFileStream ifs(file1.c_str(), std::ios::binary);
+    uint32 value_size_field = 0;
+    ifs.read(reinterpret_cast<char *>(&value_size_field),
+             sizeof(value_size_field));
+    EXPECT_EQ(4, value_size_field);
+  }
+
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(file1.c_str()));
+    EXPECT_EQ(Hash::FINGERPRINT_V1, storage.fingerprint_version());
+    EXPECT_EQ(Hash::FingerprintWithSeed("foo", 0x76fef),
+              storage.Fingerprint("foo"));
+  }
+
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(file2.c_str()));
+    EXPECT_EQ(4, storage.value_size());
+    EXPECT_EQ(Hash::FINGERPRINT_V2, storage.fingerprint_version());
+    EXPECT_EQ(Hash::FingerprintV2WithSeed("foo", 0x76fef),
+              storage.Fingerprint("foo"));
+    storage.Insert("foo", "abcd");
+  }
+
+  {
+    LRUStorage storage;
+    ASSERT_TRUE(storage.Open(file2.c_str()));
+    EXPECT_EQ(Hash::FINGERPRINT_V2, storage.fingerprint_version());
+    const char *value = storage.Lookup("foo");
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ("abcd", string(value, 4));
+
+    // The storages hashed differently cannot be merged.
+    EXPECT_FALSE(storage.Merge(file1.c_str()));
+  }
+
+  FileUtil::Unlink(file1);
+  FileUtil::Unlink(file2);
+}
+
 TEST_F(LRUStorageTest, Merge) {
   const string file1 = GetTemporaryFilePath() + ".tmp1";
   const string file2 = GetTemporaryFilePath() + ".tmp2";
@@ -312,6 +459,95 @@ TEST_F(LRUStorageTest, Merge) {
   FileUtil::Unlink(file2);
 }
 
+TEST_F(LRUStorageTest, CreateMergedStorageFile) {
+  const string file1 = GetTemporaryFilePath() + ".tmp1";
+  const string file2 = GetTemporaryFilePath() + ".tmp2";
+  const string file3 = GetTemporaryFilePath() + ".tmp3";
+  const string output = GetTemporaryFilePath() + ".out";
+
+  LRUStorage::CreateStorageFile(file1.c_str(), 4, 8, 0x76fef);
+  LRUStorage::CreateStorageFile(file2.c_str(), 4, 4, 0x76fef);
+  LRUStorage::CreateStorageFile(file3.c_str(), 4, 4, 0x76fee);
+  LRUStorage storage1;
+  ASSERT_TRUE(storage1.Open(file1.c_str()));
+  storage1.Write(0, 1, "val1", 10);
+  storage1.Write(2, 2, "val2", 20);
+  storage1.Write(3, 3, "val3", 30);
+  storage1.Write(5, 4, "val4", 40);
+  LRUStorage storage2;
+  ASSERT_TRUE(storage2.Open(file2.c_str()));
+  storage2.Write(0, 2, "new2", 50);
+  storage2.Write(1, 5, "val5", 20);
+  storage2.Write(2, 3, "old3", 5);
+  storage2.Write(3, 4, "dup4", 40);
+  LRUStorage storage3;
+  ASSERT_TRUE(storage3.Open(file3.c_str()));
+
+  std::vector<const LRUStorage *> storages;
+  storages.push_back(&storage1);
+  storages.push_back(&storage2);
+
+  // The results don't depend on the number of threads.
+  for (int num_threads = 1; num_threads <= 3; ++num_threads) {
+    ASSERT_TRUE(LRUStorage::CreateMergedStorageFile(
+        output.c_str(), storages, 6, num_threads));
+    LRUStorage merged;
+    ASSERT_TRUE(merged.Open(output.c_str()));
+    EXPECT_EQ(4, merged.value_size());
+    EXPECT_EQ(6, merged.size());
+    EXPECT_EQ(0x76fef, merged.seed());
+    EXPECT_EQ(5, merged.used_size());
+
+    // From the newest to the oldest.  The first storage wins for the
+    // equally new ones.
+    const struct {
+      uint64 fp;
+      const char *value;
+      uint32 last_access_time;
+    } kExpected[] = {
+      {2, "new2", 50},
+      {4, "val4", 40},
+      {3, "val3", 30},
+      {5, "val5", 20},
+      {1, "val1", 10},
+      {0, "\0\0\0\0", 0},
+    };
+    for (size_t i = 0; i < arraysize(kExpected); ++i) {
+      uint64 fp;
+      string value;
+      uint32 last_access_time;
+      merged.Read(i, &fp, &value, &last_access_time);
+      EXPECT_EQ(kExpected[i].fp, fp) << i;
+      EXPECT_EQ(string(kExpected[i].value, 4), value) << i;
+      EXPECT_EQ(kExpected[i].last_access_time, last_access_time) << i;
+    }
+  }
+
+  // The oldest entries are dropped.
+  ASSERT_TRUE(LRUStorage::CreateMergedStorageFile(
+      output.c_str(), storages, 2, 2));
+  {
+    LRUStorage merged;
+    ASSERT_TRUE(merged.Open(output.c_str()));
+    EXPECT_EQ(2, merged.used_size());
+    uint64 fp;
+    string value;
+    uint32 last_access_time;
+    merged.Read(1, &fp, &value, &last_access_time);
+    EXPECT_EQ(4, fp);
+  }
+
+  // The seeds are different.
+  storages.push_back(&storage3);
+  EXPECT_FALSE(LRUStorage::CreateMergedStorageFile(
+      output.c_str(), storages, 6, 2));
+
+  FileUtil::Unlink(file1);
+  FileUtil::Unlink(file2);
+  FileUtil::Unlink(file3);
+  FileUtil::Unlink(output);
+}
+
 TEST_F(LRUStorageTest, InvalidFileOpenTest) {
   LRUStorage storage;
   EXPECT_FALSE(storage.Insert("test", NULL));
@@ -378,5 +614,64 @@ TEST_F(LRUStorageOpenOrCreateTest, OpenOrCreateTest) {
   }
 }
 
+TEST_F(LRUStorageOpenOrCreateTest, FingerprintVersion) {
+  const string file = GetTemporaryFilePath();
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 10, 0x76fef));
+    EXPECT_EQ(Hash::FINGERPRINT_V1, storage.fingerprint_version());
+    storage.Insert("test", "abcd");
+  }
+
+  // The existing file keeps its fingerprint version and data.
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 10, 0x76fef,
+                                     Hash::FINGERPRINT_V2));
+    EXPECT_EQ(Hash::FINGERPRINT_V1, storage.fingerprint_version());
+    EXPECT_NE(nullptr, storage.Lookup("test"));
+  }
+
+  FileUtil::Unlink(file);
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 10, 0x76fef,
+                                     Hash::FINGERPRINT_V2));
+    EXPECT_EQ(Hash::FINGERPRINT_V2, storage.fingerprint_version());
+  }
+}
+
+TEST_F(LRUStorageOpenOrCreateTest, EphemeralMode) {
+  const string file = GetTemporaryFilePath();
+  FileUtil::Unlink(file);
+  EphemeralMode::SetEnabled(true);
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 10, 0x76fef));
+    EXPECT_EQ(4, storage.value_size());
+    EXPECT_EQ(10, storage.size());
+    EXPECT_EQ(0x76fef, storage.seed());
+    for (uint32 v = 0; v < 20; ++v) {
+      storage.Insert("test" + NumberUtil::SimpleItoa(v),
+                     reinterpret_cast<const char *>(&v));
+    }
+    EXPECT_EQ(10, storage.used_size());
+    EXPECT_TRUE(storage.Flush());
+
+    // Reopening keeps the data in memory.
+    EXPECT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 10, 0x76fef));
+    const uint32 *result =
+        reinterpret_cast<const uint32 *>(storage.Lookup("test19"));
+    ASSERT_TRUE(result != NULL);
+    EXPECT_EQ(19, *result);
+    EXPECT_TRUE(storage.Lookup("test0") == NULL);
+
+    EXPECT_TRUE(storage.Clear());
+    EXPECT_EQ(0, storage.used_size());
+  }
+  EXPECT_FALSE(FileUtil::FileExists(file));
+  EphemeralMode::SetEnabled(false);
+}
+
 }  // namespace storage
 }  // namespace mozc
@@ -37,6 +37,8 @@
 #include "base/mutex.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
+#include "storage/ephemeral_mode.h"
+#include "storage/memory_storage.h"
 #include "storage/storage_interface.h"
 #include "storage/tiny_storage.h"
 
@@ -53,8 +55,12 @@ const char kRegistryFileName[] = ".registry.db";   // hidden file
 
 class StorageInitializer {
  public:
-  StorageInitializer() :
-      default_storage_(TinyStorage::New()), current_storage_(NULL) {
+  StorageInitializer() : current_storage_(NULL) {
+    if (EphemeralMode::IsEnabled()) {
+      default_storage_.reset(MemoryStorage::New());
+      return;
+    }
+    default_storage_.reset(TinyStorage::New());
     if (!default_storage_->Open(FileUtil::JoinPath(
             SystemUtil::GetUserProfileDirectory(), kRegistryFileName))) {
       LOG(ERROR) << "cannot open registry";
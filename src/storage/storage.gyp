@@ -35,6 +35,7 @@
       'toolsets': ['target', 'host'],
       'sources': [
         'encrypted_string_storage.cc',
+        'ephemeral_mode.cc',
         'existence_filter.cc',
         'lru_storage.cc',
         'memory_storage.cc',
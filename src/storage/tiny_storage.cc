@@ -40,6 +40,7 @@
 
 #include "base/file_stream.h"
 #include "base/file_util.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
 #include "base/mmap.h"
 #include "base/port.h"
@@ -101,6 +102,8 @@ class TinyStorageImpl : public StorageInterface {
 
  private:
   string filename_;
+  // True if |dic_| differs from the content of |filename_|.  Sync() is a
+  // no-op otherwise, so that unchanged data is not rewritten.
   bool should_sync_;
   std::map<string, string> dic_;
 
@@ -123,9 +126,11 @@ TinyStorageImpl::~TinyStorageImpl() {
 }
 
 bool TinyStorageImpl::Open(const string &filename) {
+  IOStats::ScopedOperation operation(IOStats::TINY_STORAGE, IOStats::READ);
   Mmap mmap;
   dic_.clear();
   filename_ = filename;
+  should_sync_ = true;
   if (!mmap.Open(filename.c_str(), "r")) {
     LOG(WARNING) << "cannot open:" << filename;
     // here we return true if we cannot open the file.
@@ -133,6 +138,7 @@ bool TinyStorageImpl::Open(const string &filename) {
     // we just make an empty file from scratch here.
     return true;
   }
+  operation.set_bytes(mmap.size());
 
   if (mmap.size() > kMaxFileSize) {
     LOG(ERROR) << "tring to open too big file";
@@ -214,6 +220,7 @@ bool TinyStorageImpl::Open(const string &filename) {
     return false;
   }
 
+  should_sync_ = false;
   return true;
 }
 
@@ -227,6 +234,7 @@ bool TinyStorageImpl::Sync() {
     return true;
   }
 
+  IOStats::ScopedOperation operation(IOStats::TINY_STORAGE, IOStats::WRITE);
   const string output_filename = filename_ + ".tmp";
 
   OutputFileStream ofs(output_filename.c_str(),
@@ -264,6 +272,7 @@ bool TinyStorageImpl::Sync() {
   }
 
   magic = static_cast<uint32>(ofs.tellp());
+  operation.set_bytes(magic);
   ofs.seekp(0);
   magic ^= kStorageMagicId;
 
@@ -299,7 +308,15 @@ bool TinyStorageImpl::Insert(const string &key, const string &value) {
     LOG(WARNING) << "invalid key/value is passed";
     return false;
   }
-  dic_[key] = value;
+  std::map<string, string>::iterator it = dic_.find(key);
+  if (it == dic_.end()) {
+    dic_.insert(std::make_pair(key, value));
+  } else if (it->second != value) {
+    it->second = value;
+  } else {
+    // Rewriting the same value doesn't need to be synced.
+    return true;
+  }
   should_sync_ = true;
   return true;
 }
@@ -326,8 +343,10 @@ bool TinyStorageImpl::Lookup(const string &key, string *value) const {
 }
 
 bool TinyStorageImpl::Clear() {
-  dic_.clear();
-  should_sync_ = true;
+  if (!dic_.empty()) {
+    dic_.clear();
+    should_sync_ = true;
+  }
   return Sync();
 }
 
@@ -40,6 +40,8 @@ namespace storage {
 // Use it just for saving small data which
 // are not updated frequently, like timestamp, auth_token, etc.
 // We will replace it with faster and more robust implementation.
+// Sync() rewrites the file with a temporary file and an atomic rename only
+// when the data has been modified since the last Open() or Sync().
 class TinyStorage {
  public:
   // Returns an implementatoin of StorageInterface.
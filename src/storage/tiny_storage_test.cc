@@ -172,5 +172,39 @@ TEST_F(TinyStorageTest, TinyStorageTest) {
   }
 }
 
+TEST_F(TinyStorageTest, SyncOnlyModifiedData) {
+  const string filename = GetTemporaryFilePath();
+  {
+    std::unique_ptr<StorageInterface> storage(CreateStorage());
+    EXPECT_TRUE(storage->Open(filename));
+    EXPECT_TRUE(storage->Insert("key", "value"));
+    EXPECT_TRUE(storage->Sync());
+  }
+  ASSERT_TRUE(FileUtil::FileExists(filename));
+
+  std::unique_ptr<StorageInterface> storage(CreateStorage());
+  EXPECT_TRUE(storage->Open(filename));
+
+  // Removes the file to see whether the following calls rewrite it.
+  ASSERT_TRUE(FileUtil::Unlink(filename));
+  EXPECT_TRUE(storage->Sync());
+  EXPECT_FALSE(FileUtil::FileExists(filename));
+
+  // Inserting the same value doesn't modify the data.
+  EXPECT_TRUE(storage->Insert("key", "value"));
+  EXPECT_TRUE(storage->Sync());
+  EXPECT_FALSE(FileUtil::FileExists(filename));
+
+  EXPECT_TRUE(storage->Insert("key", "value2"));
+  EXPECT_TRUE(storage->Sync());
+  EXPECT_TRUE(FileUtil::FileExists(filename));
+
+  std::unique_ptr<StorageInterface> storage2(CreateStorage());
+  EXPECT_TRUE(storage2->Open(filename));
+  string value;
+  EXPECT_TRUE(storage2->Lookup("key", &value));
+  EXPECT_EQ("value2", value);
+}
+
 }  // namespace storage
 }  // namespace mozc
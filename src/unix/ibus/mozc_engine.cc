@@ -241,6 +241,15 @@ std::unique_ptr<client::ClientInterface> CreateAndConfigureClient() {
   return client;
 }
 
+#ifdef ENABLE_GTK_RENDERER
+renderer::RendererClient *CreateRendererClient() {
+  renderer::RendererClient *renderer_client = new renderer::RendererClient();
+  // Key events should not wait for the renderer.
+  renderer_client->EnableAsyncMode();
+  return renderer_client;
+}
+#endif  // ENABLE_GTK_RENDERER
+
 }  // namespace
 
 MozcEngine::MozcEngine()
@@ -255,7 +264,7 @@ MozcEngine::MozcEngine()
       preedit_handler_(new PreeditHandler()),
 #ifdef ENABLE_GTK_RENDERER
       gtk_candidate_window_handler_(new GtkCandidateWindowHandler(
-          new renderer::RendererClient())),
+          CreateRendererClient())),
 #endif  // ENABLE_GTK_RENDERER
       ibus_candidate_window_handler_(new IBusCandidateWindowHandler()),
       preedit_method_(config::Config::ROMAN) {
@@ -45,8 +45,7 @@ def GetStatsNameList(filename):
   return stats
 
 
-def main():
-  stats_list = GetStatsNameList(sys.argv[1])
+def OutputList(stats_list):
   print '// This header file is generated by gen_stats_list.py'
   for stats in stats_list:
     print 'const char k%s[] = "%s";' % (stats, stats)
@@ -56,5 +55,30 @@ def main():
   print '};'
 
 
+def OutputIdEnum(stats_list):
+  print '// This header file is generated by gen_stats_list.py'
+  print '#ifndef MOZC_USAGE_STATS_USAGE_STATS_ID_H_'
+  print '#define MOZC_USAGE_STATS_USAGE_STATS_ID_H_'
+  print 'namespace mozc {'
+  print 'namespace usage_stats {'
+  print '// The order is the same as kStatsList.'
+  print 'enum StatsId {'
+  for stats in stats_list:
+    print '  k%sId,' % (stats)
+  print '  kNumStatsIds,'
+  print '};'
+  print '}  // namespace usage_stats'
+  print '}  // namespace mozc'
+  print '#endif  // MOZC_USAGE_STATS_USAGE_STATS_ID_H_'
+
+
+def main():
+  stats_list = GetStatsNameList(sys.argv[1])
+  if len(sys.argv) > 2 and sys.argv[2] == '--id_enum':
+    OutputIdEnum(stats_list)
+  else:
+    OutputList(stats_list)
+
+
 if __name__ == '__main__':
   main()
@@ -30,9 +30,12 @@
 #include "usage_stats/usage_stats.h"
 
 #include <algorithm>
+#include <atomic>
 #include <numeric>
+#include <unordered_map>
 
 #include "base/logging.h"
+#include "base/singleton.h"
 #include "config/stats_config_util.h"
 #include "storage/registry.h"
 #include "usage_stats/usage_stats.pb.h"
@@ -45,6 +48,52 @@ const char kRegistryPrefix[] = "usage_stats.";
 
 #include "usage_stats/usage_stats_list.h"
 
+static_assert(arraysize(kStatsList) == kNumStatsIds,
+              "StatsId must cover all the stats in kStatsList");
+
+// Counts and timings recorded through StatsId and not flushed yet.
+struct PendingStats {
+  std::atomic<uint32> count;
+  std::atomic<uint32> num_timings;
+  std::atomic<uint64> total_time;
+  // Stored as ~min so that the zero-initialized value means no minimum yet.
+  std::atomic<uint32> inverted_min_time;
+  std::atomic<uint32> max_time;
+};
+
+// Zero-initialized before any dynamic initialization.
+PendingStats g_pending_stats[kNumStatsIds];
+
+void UpdateMax(std::atomic<uint32> *target, uint32 val) {
+  uint32 current = target->load(std::memory_order_relaxed);
+  while (current < val &&
+         !target->compare_exchange_weak(current, val,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+class StatsIdMap {
+ public:
+  StatsIdMap() {
+    for (size_t i = 0; i < arraysize(kStatsList); ++i) {
+      ids_[kStatsList[i]] = static_cast<StatsId>(i);
+    }
+  }
+
+  bool Lookup(const string &name, StatsId *id) const {
+    const std::unordered_map<string, StatsId>::const_iterator it =
+        ids_.find(name);
+    if (it == ids_.end()) {
+      return false;
+    }
+    *id = it->second;
+    return true;
+  }
+
+ private:
+  std::unordered_map<string, StatsId> ids_;
+};
+
 void AddDoubleValueStats(
     const Stats::DoubleValueStats &src,
     Stats::DoubleValueStats *dest) {
@@ -105,15 +154,58 @@ bool SetterInternal(const string &name, const Stats &stats) {
   }
   return true;
 }
+void AddCountToRegistry(const string &name, uint32 val) {
+  Stats stats;
+  if (GetterInternal(name, Stats::COUNT, &stats)) {
+    stats.set_count(stats.count() + val);
+  } else {
+    stats.set_name(name);
+    stats.set_type(Stats::COUNT);
+    stats.set_count(val);
+  }
+
+  SetterInternal(name, stats);
+}
+
+void AddTimingsToRegistry(const string &name, uint32 num_timings,
+                          uint64 total_time, uint32 min_time,
+                          uint32 max_time) {
+  DCHECK_GT(num_timings, 0);
+  Stats stats;
+  if (GetterInternal(name, Stats::TIMING, &stats)) {
+    stats.set_num_timings(stats.num_timings() + num_timings);
+    stats.set_total_time(stats.total_time() + total_time);
+    stats.set_avg_time(stats.total_time() / stats.num_timings());
+    stats.set_min_time(min(stats.min_time(), min_time));
+    stats.set_max_time(max(stats.max_time(), max_time));
+  } else {
+    stats.set_name(name);
+    stats.set_type(Stats::TIMING);
+    stats.set_num_timings(num_timings);
+    stats.set_total_time(total_time);
+    stats.set_avg_time(total_time / num_timings);
+    stats.set_min_time(min_time);
+    stats.set_max_time(max_time);
+  }
+
+  SetterInternal(name, stats);
+}
+
+void DiscardPendingStats() {
+  for (size_t i = 0; i < kNumStatsIds; ++i) {
+    PendingStats *pending = &g_pending_stats[i];
+    pending->count.store(0, std::memory_order_relaxed);
+    pending->num_timings.store(0, std::memory_order_relaxed);
+    pending->total_time.store(0, std::memory_order_relaxed);
+    pending->inverted_min_time.store(0, std::memory_order_relaxed);
+    pending->max_time.store(0, std::memory_order_relaxed);
+  }
+}
 }  // namespace
 
 bool UsageStats::IsListed(const string &name) {
-  for (size_t i = 0; i < arraysize(kStatsList); ++i) {
-    if (name == kStatsList[i]) {
-      return true;
-    }
-  }
-  return false;
+  StatsId id;
+  return Singleton<StatsIdMap>::get()->Lookup(name, &id);
 }
 
 void UsageStats::ClearStats() {
@@ -139,6 +231,7 @@ void UsageStats::ClearStats() {
 }
 
 void UsageStats::ClearAllStatsForTest() {
+  DiscardPendingStats();
   for (size_t i = 0; i < arraysize(kStatsList); ++i) {
     const string key = string(kRegistryPrefix) + kStatsList[i];
     storage::Registry::Erase(key);
@@ -146,47 +239,76 @@ void UsageStats::ClearAllStatsForTest() {
 }
 
 void UsageStats::IncrementCountBy(const string &name, uint32 val) {
+  StatsId id;
+  if (Singleton<StatsIdMap>::get()->Lookup(name, &id)) {
+    IncrementCountBy(id, val);
+    return;
+  }
   DCHECK(IsListed(name)) << name << " is not in the list";
   if (!config::StatsConfigUtil::IsEnabled()) {
     return;
   }
-
-  Stats stats;
-  if (GetterInternal(name, Stats::COUNT, &stats)) {
-    stats.set_count(stats.count() + val);
-  } else {
-    stats.set_name(name);
-    stats.set_type(Stats::COUNT);
-    stats.set_count(val);
-  }
-
-  SetterInternal(name, stats);
+  AddCountToRegistry(name, val);
 }
 
 void UsageStats::UpdateTiming(const string &name, uint32 val) {
+  StatsId id;
+  if (Singleton<StatsIdMap>::get()->Lookup(name, &id)) {
+    UpdateTiming(id, val);
+    return;
+  }
   DCHECK(IsListed(name)) << name << " is not in the list";
   if (!config::StatsConfigUtil::IsEnabled()) {
     return;
   }
+  AddTimingsToRegistry(name, 1, val, val, val);
+}
 
-  Stats stats;
-  if (GetterInternal(name, Stats::TIMING, &stats)) {
-    stats.set_num_timings(stats.num_timings() + 1);
-    stats.set_total_time(stats.total_time() + val);
-    stats.set_avg_time(stats.total_time() / stats.num_timings());
-    stats.set_min_time(min(stats.min_time(), val));
-    stats.set_max_time(max(stats.max_time(), val));
-  } else {
-    stats.set_name(name);
-    stats.set_type(Stats::TIMING);
-    stats.set_num_timings(1);
-    stats.set_total_time(val);
-    stats.set_avg_time(val);
-    stats.set_min_time(val);
-    stats.set_max_time(val);
-  }
+void UsageStats::IncrementCountBy(StatsId id, uint32 val) {
+  DCHECK_GE(id, 0);
+  DCHECK_LT(id, kNumStatsIds);
+  g_pending_stats[id].count.fetch_add(val, std::memory_order_relaxed);
+}
 
-  SetterInternal(name, stats);
+void UsageStats::UpdateTiming(StatsId id, uint32 val) {
+  DCHECK_GE(id, 0);
+  DCHECK_LT(id, kNumStatsIds);
+  PendingStats *pending = &g_pending_stats[id];
+  pending->total_time.fetch_add(val, std::memory_order_relaxed);
+  UpdateMax(&pending->inverted_min_time, ~val);
+  UpdateMax(&pending->max_time, val);
+  // Published last so that Flush() never sees a timing without its value.
+  pending->num_timings.fetch_add(1, std::memory_order_release);
+}
+
+void UsageStats::Flush() {
+  const bool enabled = config::StatsConfigUtil::IsEnabled();
+  for (size_t i = 0; i < kNumStatsIds; ++i) {
+    PendingStats *pending = &g_pending_stats[i];
+    const uint32 count =
+        pending->count.exchange(0, std::memory_order_relaxed);
+    if (count > 0 && enabled) {
+      AddCountToRegistry(kStatsList[i], count);
+    }
+
+    const uint32 num_timings =
+        pending->num_timings.exchange(0, std::memory_order_acquire);
+    if (num_timings == 0) {
+      continue;
+    }
+    // A timing recorded concurrently may be split between this flush and
+    // the next one, which is fine for the aggregated values.
+    const uint64 total_time =
+        pending->total_time.exchange(0, std::memory_order_relaxed);
+    const uint32 min_time =
+        ~pending->inverted_min_time.exchange(0, std::memory_order_relaxed);
+    const uint32 max_time =
+        pending->max_time.exchange(0, std::memory_order_relaxed);
+    if (enabled) {
+      AddTimingsToRegistry(kStatsList[i], num_timings, total_time,
+                           min(min_time, max_time), max_time);
+    }
+  }
 }
 
 void UsageStats::SetInteger(const string &name, int val) {
@@ -218,6 +340,7 @@ void UsageStats::SetBoolean(const string &name, bool val) {
 }
 
 bool UsageStats::GetCountForTest(const string &name, uint32 *value) {
+  Flush();
   CHECK(value != NULL);
   Stats stats;
   if (!GetterInternal(name, Stats::COUNT, &stats)) {
@@ -233,6 +356,7 @@ bool UsageStats::GetCountForTest(const string &name, uint32 *value) {
 }
 
 bool UsageStats::GetIntegerForTest(const string &name, int32 *value) {
+  Flush();
   CHECK(value != NULL);
   Stats stats;
   if (!GetterInternal(name, Stats::INTEGER, &stats)) {
@@ -248,6 +372,7 @@ bool UsageStats::GetIntegerForTest(const string &name, int32 *value) {
 }
 
 bool UsageStats::GetBooleanForTest(const string &name, bool *value) {
+  Flush();
   CHECK(value != NULL);
   Stats stats;
   if (!GetterInternal(name, Stats::BOOLEAN, &stats)) {
@@ -268,6 +393,7 @@ bool UsageStats::GetTimingForTest(const string &name,
                                   uint32 *avg_time,
                                   uint32 *min_time,
                                   uint32 *max_time) {
+  Flush();
   Stats stats;
   if (!GetterInternal(name, Stats::TIMING, &stats)) {
     return false;
@@ -302,6 +428,7 @@ bool UsageStats::GetTimingForTest(const string &name,
 }
 
 bool UsageStats::GetVirtualKeyboardForTest(const string &name, Stats *stats) {
+  Flush();
   if (!GetterInternal(name, Stats::VIRTUAL_KEYBOARD, stats)) {
     return false;
   }
@@ -316,6 +443,7 @@ bool UsageStats::GetVirtualKeyboardForTest(const string &name, Stats *stats) {
 }
 
 bool UsageStats::GetStatsForTest(const string &name, Stats *stats) {
+  Flush();
   return LoadStats(name, stats);
 }
 
@@ -368,6 +496,7 @@ void UsageStats::StoreTouchEventStats(
 }
 
 bool UsageStats::Sync() {
+  Flush();
   if (!storage::Registry::Sync()) {
     LOG(ERROR) << "sync failed";
     return false;
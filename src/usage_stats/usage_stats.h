@@ -35,6 +35,7 @@
 #include <vector>
 #include "base/port.h"
 #include "usage_stats/usage_stats.pb.h"
+#include "usage_stats/usage_stats_id.h"
 
 namespace mozc {
 namespace usage_stats {
@@ -53,6 +54,21 @@ class UsageStats {
   // Updates current value using given val
   static void UpdateTiming(const string &name, uint32 val);
 
+  // Variants taking an ID generated from stats.def. They only update
+  // in-memory counters without taking any lock; the pending values are
+  // merged into the registry by Flush(). The string versions above forward
+  // to these for listed names; passing an ID also skips the name lookup.
+  static void IncrementCountBy(StatsId id, uint32 val);
+  static void IncrementCount(StatsId id) {
+    IncrementCountBy(id, 1);
+  }
+  static void UpdateTiming(StatsId id, uint32 val);
+
+  // Merges the pending counts and timings into the registry in one batch.
+  // They are dropped if the usage stats are disabled at this point.
+  // Sync() and the getters for unit tests call this.
+  static void Flush();
+
   // Sets integer value
   // Replaces old value with val
   static void SetInteger(const string &name, int val);
@@ -77,13 +93,14 @@ class UsageStats {
       const string &name,
       const std::map<string, TouchEventStatsMap> &touch_stats);
 
-  // Synchronizes (writes) usage data into disk. Returns false on failure.
+  // Flushes pending values and synchronizes (writes) usage data into disk.
+  // Returns false on failure.
   static bool Sync();
 
   // Clears existing data exept for Integer and Boolean stats.
   static void ClearStats();
 
-  // Clears all data.
+  // Clears all data including the pending values not flushed yet.
   static void ClearAllStatsForTest();
 
   // NOTE: These methods are for unit tests.
@@ -30,10 +30,13 @@
 #include "usage_stats/usage_stats.h"
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/port.h"
 #include "base/system_util.h"
+#include "base/thread.h"
 #include "config/stats_config_util.h"
 #include "config/stats_config_util_mock.h"
 #include "storage/registry.h"
@@ -51,6 +54,7 @@ class UsageStatsTest : public ::testing::Test {
   virtual void SetUp() {
     SystemUtil::SetUserProfileDirectory(FLAGS_test_tmpdir);
     EXPECT_TRUE(storage::Registry::Clear());
+    UsageStats::ClearAllStatsForTest();
     mozc::config::StatsConfigUtil::SetHandler(&stats_config_util_);
   }
   virtual void TearDown() {
@@ -58,7 +62,7 @@ class UsageStatsTest : public ::testing::Test {
     EXPECT_TRUE(storage::Registry::Clear());
   }
 
- private:
+ protected:
   mozc::config::StatsConfigUtilMock stats_config_util_;
 };
 
@@ -177,6 +181,127 @@ TEST_F(UsageStatsTest, GetterTest) {
   EXPECT_EQ(2, stats_val.count());
 }
 
+TEST_F(UsageStatsTest, StatsIdTest) {
+  string stats_str;
+  UsageStats::IncrementCount(kShutDownId);
+  UsageStats::IncrementCountBy(kShutDownId, 2);
+  UsageStats::UpdateTiming(kElapsedTimeUSecId, 5);
+  UsageStats::UpdateTiming(kElapsedTimeUSecId, 7);
+  // The string versions are routed to the same pending values.
+  UsageStats::IncrementCount("ShutDown");
+  UsageStats::UpdateTiming("ElapsedTimeUSec", 3);
+
+  // Nothing is written to the registry until flushed.
+  EXPECT_FALSE(storage::Registry::Lookup("usage_stats.ShutDown", &stats_str));
+  EXPECT_FALSE(storage::Registry::Lookup("usage_stats.ElapsedTimeUSec",
+                                         &stats_str));
+  UsageStats::Flush();
+  EXPECT_TRUE(storage::Registry::Lookup("usage_stats.ShutDown", &stats_str));
+
+  uint32 count_val = 0;
+  EXPECT_TRUE(UsageStats::GetCountForTest("ShutDown", &count_val));
+  EXPECT_EQ(4, count_val);
+
+  uint64 total_time = 0;
+  uint32 num_timings = 0;
+  uint32 avg_time = 0;
+  uint32 min_time = 0;
+  uint32 max_time = 0;
+  EXPECT_TRUE(UsageStats::GetTimingForTest("ElapsedTimeUSec", &total_time,
+                                           &num_timings, &avg_time, &min_time,
+                                           &max_time));
+  EXPECT_EQ(15, total_time);
+  EXPECT_EQ(3, num_timings);
+  EXPECT_EQ(5, avg_time);
+  EXPECT_EQ(3, min_time);
+  EXPECT_EQ(7, max_time);
+
+  // Flushed values are merged into the stored ones.
+  UsageStats::IncrementCount(kShutDownId);
+  UsageStats::UpdateTiming(kElapsedTimeUSecId, 10);
+  EXPECT_TRUE(UsageStats::GetCountForTest("ShutDown", &count_val));
+  EXPECT_EQ(5, count_val);
+  EXPECT_TRUE(UsageStats::GetTimingForTest("ElapsedTimeUSec", &total_time,
+                                           &num_timings, &avg_time, &min_time,
+                                           &max_time));
+  EXPECT_EQ(25, total_time);
+  EXPECT_EQ(4, num_timings);
+  EXPECT_EQ(6, avg_time);
+  EXPECT_EQ(3, min_time);
+  EXPECT_EQ(10, max_time);
+}
+
+TEST_F(UsageStatsTest, FlushWhenDisabledTest) {
+  UsageStats::IncrementCount(kShutDownId);
+  UsageStats::UpdateTiming(kElapsedTimeUSecId, 5);
+  stats_config_util_.SetEnabled(false);
+  UsageStats::Flush();
+
+  // The pending values are dropped, not kept for the next flush.
+  stats_config_util_.SetEnabled(true);
+  Stats stats;
+  EXPECT_FALSE(UsageStats::GetStatsForTest("ShutDown", &stats));
+  EXPECT_FALSE(UsageStats::GetStatsForTest("ElapsedTimeUSec", &stats));
+}
+
+TEST_F(UsageStatsTest, ClearAllStatsDiscardsPendingValues) {
+  UsageStats::IncrementCount(kShutDownId);
+  UsageStats::UpdateTiming(kElapsedTimeUSecId, 5);
+  UsageStats::ClearAllStatsForTest();
+  Stats stats;
+  EXPECT_FALSE(UsageStats::GetStatsForTest("ShutDown", &stats));
+  EXPECT_FALSE(UsageStats::GetStatsForTest("ElapsedTimeUSec", &stats));
+}
+
+namespace {
+class IncrementThread : public Thread {
+ public:
+  explicit IncrementThread(int num_increments)
+      : num_increments_(num_increments) {}
+
+  virtual void Run() {
+    for (int i = 0; i < num_increments_; ++i) {
+      UsageStats::IncrementCount(kShutDownId);
+      UsageStats::UpdateTiming(kElapsedTimeUSecId, i + 1);
+    }
+  }
+
+ private:
+  const int num_increments_;
+};
+}  // namespace
+
+TEST_F(UsageStatsTest, ConcurrentUpdateTest) {
+  const int kNumThreads = 4;
+  const int kNumIncrements = 1000;
+  std::vector<std::unique_ptr<IncrementThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back(new IncrementThread(kNumIncrements));
+    threads.back()->SetJoinable(true);
+    threads.back()->Start("IncrementThread");
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+  }
+
+  uint32 count_val = 0;
+  EXPECT_TRUE(UsageStats::GetCountForTest("ShutDown", &count_val));
+  EXPECT_EQ(kNumThreads * kNumIncrements, count_val);
+
+  uint64 total_time = 0;
+  uint32 num_timings = 0;
+  uint32 min_time = 0;
+  uint32 max_time = 0;
+  EXPECT_TRUE(UsageStats::GetTimingForTest("ElapsedTimeUSec", &total_time,
+                                           &num_timings, NULL, &min_time,
+                                           &max_time));
+  EXPECT_EQ(kNumThreads * kNumIncrements * (kNumIncrements + 1) / 2,
+            total_time);
+  EXPECT_EQ(kNumThreads * kNumIncrements, num_timings);
+  EXPECT_EQ(1, min_time);
+  EXPECT_EQ(kNumIncrements, max_time);
+}
+
 namespace {
 void SetDoubleValueStats(
     uint32 num, double total, double square_total,
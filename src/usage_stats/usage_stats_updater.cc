@@ -39,6 +39,7 @@
 #include "base/android_util.h"
 #endif  // OS_ANDROID
 #include "base/config_file_stream.h"
+#include "base/io_stats.h"
 #include "base/logging.h"
 #include "base/mac_util.h"
 #include "base/number_util.h"
@@ -193,10 +194,47 @@ void UpdateConfigStats(const config::Config &config) {
   UsageStats::SetBoolean("ConfigUseLocalUsageDictionary",
                          use_local_usage_dictionary);
 }
+
+void IncrementCountIfChanged(const string &name, uint64 last_value,
+                             uint64 value) {
+  if (value > last_value) {
+    UsageStats::IncrementCountBy(name, static_cast<uint32>(value - last_value));
+  }
+}
+
+// Counts the increase of the storage I/O since the last call.  The bytes and
+// the time are rounded down after summing up, so that the small operations
+// are counted as well.
+void UpdateStorageIOStats() {
+  static IOStats::Stats last_stats[IOStats::NUM_COMPONENTS];
+  for (int i = 0; i < IOStats::NUM_COMPONENTS; ++i) {
+    const IOStats::Component component = static_cast<IOStats::Component>(i);
+    IOStats::Stats stats;
+    IOStats::GetStats(component, &stats);
+    const IOStats::Stats &last = last_stats[i];
+    const string prefix =
+        string("StorageIO") + IOStats::GetComponentName(component);
+    IncrementCountIfChanged(prefix + "ReadKBytes", last.read_bytes / 1024,
+                            stats.read_bytes / 1024);
+    IncrementCountIfChanged(prefix + "ReadCount", last.read_count,
+                            stats.read_count);
+    IncrementCountIfChanged(prefix + "WriteKBytes", last.write_bytes / 1024,
+                            stats.write_bytes / 1024);
+    IncrementCountIfChanged(prefix + "WriteCount", last.write_count,
+                            stats.write_count);
+    IncrementCountIfChanged(prefix + "SyncCount", last.sync_count,
+                            stats.sync_count);
+    IncrementCountIfChanged(prefix + "TimeMSec",
+                            last.time_microseconds / 1000,
+                            stats.time_microseconds / 1000);
+    last_stats[i] = stats;
+  }
+}
 }  // namespace
 
 void UsageStatsUpdater::UpdateStats(const config::Config &config) {
   UpdateConfigStats(config);
+  UpdateStorageIOStats();
 
   // Get total memory in MB.
   const uint32 memory_in_mb =
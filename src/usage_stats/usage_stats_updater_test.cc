@@ -31,6 +31,7 @@
 
 #include <string>
 
+#include "base/io_stats.h"
 #include "base/port.h"
 #include "base/system_util.h"
 #include "base/util.h"
@@ -183,5 +184,23 @@ TEST_F(UsageStatsUpdaterTest, IMEActivationKeyCustomizedTest) {
   }
 }
 
+TEST_F(UsageStatsUpdaterTest, StorageIOStatsTest) {
+  Config config;
+  ConfigHandler::GetDefaultConfig(&config);
+
+  // Only the I/O after the last update should be counted.
+  UsageStatsUpdater::UpdateStats(config);
+  UsageStats::ClearAllStatsForTest();
+
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::WRITE, 3000, 10);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::WRITE, 3000, 10);
+  IOStats::Record(IOStats::TINY_STORAGE, IOStats::SYNC, 100, 10);
+  UsageStatsUpdater::UpdateStats(config);
+  EXPECT_COUNT_STATS("StorageIOTinyStorageWriteCount", 2);
+  EXPECT_COUNT_STATS("StorageIOTinyStorageWriteKBytes", 5);
+  EXPECT_COUNT_STATS("StorageIOTinyStorageSyncCount", 1);
+  EXPECT_STATS_NOT_EXIST("StorageIOTinyStorageReadCount");
+}
+
 }  // namespace usage_stats
 }  // namespace mozc
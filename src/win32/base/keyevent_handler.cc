@@ -675,6 +675,17 @@ KeyEventHandlerResult KeyEventHandler::HandleKey(
     return result;
   }
 
+  // When the IME is off, only the key-down of a direct mode key is sent to
+  // the server.  Let the other keys pass through before translating them,
+  // which involves keyboard layout lookups.
+  if (!ime_state.open &&
+      (!is_key_down || behavior.direct_mode_keys.empty())) {
+    result.succeeded = true;
+    result.should_be_eaten = false;
+    result.should_be_sent_to_server = false;
+    return result;
+  }
+
   if (!ConvertToKeyEvent(virtual_key, scan_code, is_key_down, false,
                          behavior, ime_state, keyboard_status, keyboard, key)) {
     result.succeeded = true;